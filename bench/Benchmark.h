@@ -0,0 +1,172 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+// std
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rkcommon {
+  namespace bench {
+
+    /*! Per-run state handed to a benchmark, modelled after Google
+        Benchmark's benchmark::State. The timed region is the body of the
+        keepRunning() loop:
+
+          static void myBench(State &state)
+          {
+            // setup
+            while (state.keepRunning()) {
+              // measured work
+            }
+            state.setItemsProcessed(state.iterations() * n);
+          }
+          RKCOMMON_BENCHMARK("family/name", myBench);
+     */
+    class State
+    {
+     public:
+      explicit State(size_t maxIterations);
+
+      bool keepRunning();
+
+      // Exclude the enclosed region from the measurement
+      void pauseTiming();
+      void resumeTiming();
+
+      size_t iterations() const;
+      int threads() const;
+
+      void setItemsProcessed(size_t items);
+
+      // A named value reported next to the timings (e.g. "ns_per_index")
+      void setCounter(const std::string &name, double value);
+
+      // Abort this run, e.g. if the backend can't make progress
+      void skipWithError(const std::string &message);
+      bool errorOccurred() const;
+
+     private:
+      friend class Runner;
+
+      using clock = std::chrono::steady_clock;
+
+      size_t maxIterations{0};
+      size_t iteration{0};
+      int numThreads{1};
+      bool running{false};
+      bool paused{false};
+
+      clock::time_point startTime;
+      clock::duration elapsed{0};
+
+      size_t itemsProcessed{0};
+      std::map<std::string, double> counters;
+      std::string errorMessage;
+    };
+
+    using benchmark_fcn_t = void (*)(State &);
+
+    // Returns the benchmarks registered through RKCOMMON_BENCHMARK()
+    std::vector<std::pair<std::string, benchmark_fcn_t>> &registeredBenchmarks();
+
+    struct Registrar
+    {
+      Registrar(const char *name, benchmark_fcn_t fcn)
+      {
+        registeredBenchmarks().emplace_back(name, fcn);
+      }
+    };
+
+    // Prevent the compiler from optimizing away a computed 'value'
+    template <typename T>
+    inline void doNotOptimize(const T &value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      asm volatile("" : : "r,m"(value) : "memory");
+#else
+      static volatile const T *sink;
+      sink = &value;
+#endif
+    }
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    inline State::State(size_t _maxIterations) : maxIterations(_maxIterations)
+    {
+    }
+
+    inline bool State::keepRunning()
+    {
+      if (!running) {
+        running   = true;
+        startTime = clock::now();
+      }
+
+      if (iteration < maxIterations && errorMessage.empty()) {
+        iteration++;
+        return true;
+      }
+
+      if (!paused)
+        elapsed += clock::now() - startTime;
+      running = false;
+      return false;
+    }
+
+    inline void State::pauseTiming()
+    {
+      elapsed += clock::now() - startTime;
+      paused = true;
+    }
+
+    inline void State::resumeTiming()
+    {
+      paused    = false;
+      startTime = clock::now();
+    }
+
+    inline size_t State::iterations() const
+    {
+      return iteration;
+    }
+
+    inline int State::threads() const
+    {
+      return numThreads;
+    }
+
+    inline void State::setItemsProcessed(size_t items)
+    {
+      itemsProcessed = items;
+    }
+
+    inline void State::setCounter(const std::string &name, double value)
+    {
+      counters[name] = value;
+    }
+
+    inline void State::skipWithError(const std::string &message)
+    {
+      errorMessage = message;
+    }
+
+    inline bool State::errorOccurred() const
+    {
+      return !errorMessage.empty();
+    }
+
+  }  // namespace bench
+}  // namespace rkcommon
+
+#define RKCOMMON_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define RKCOMMON_BENCHMARK_CONCAT(a, b) RKCOMMON_BENCHMARK_CONCAT_IMPL(a, b)
+
+#define RKCOMMON_BENCHMARK(name, fcn)                                        \
+  static rkcommon::bench::Registrar RKCOMMON_BENCHMARK_CONCAT(               \
+      rkcommon_benchmark_registrar_, __LINE__)(name, fcn)
@@ -0,0 +1,182 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/array3D/Array3DView.h"
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+using namespace rkcommon::bench;
+
+static const vec3i dims(256, 256, 64);
+
+static std::shared_ptr<ActualArray3D<uint8_t>> &byteVolume()
+{
+  static std::shared_ptr<ActualArray3D<uint8_t>> v;
+  if (!v) {
+    v = std::make_shared<ActualArray3D<uint8_t>>(dims + 2);
+    for_each(v->size(), [&](const vec3i &idx) {
+      v->set(idx, uint8_t(idx.x ^ idx.y ^ idx.z));
+    });
+  }
+  return v;
+}
+
+// uint8 voxels read as float through a sub box, the usual wrapper chain
+static std::shared_ptr<Array3D<float>> &wrappedVolume()
+{
+  static std::shared_ptr<Array3D<float>> v;
+  if (!v) {
+    auto accessor =
+        std::make_shared<Array3DAccessor<uint8_t, float>>(byteVolume());
+    v = std::make_shared<SubBoxArray3D<float>>(accessor,
+                                               box3i(vec3i(1), dims + 1));
+  }
+  return v;
+}
+
+static ActualArray3D<float> &floatVolume()
+{
+  static ActualArray3D<float> v(dims);
+  static bool initialized = false;
+  if (!initialized) {
+    for_each(dims, [&](const vec3i &idx) {
+      v.set(idx, float((idx.x ^ idx.y ^ idx.z) & 255));
+    });
+    initialized = true;
+  }
+  return v;
+}
+
+static void valueRangePerCell(State &state)
+{
+  const Array3D<float> &volume = *wrappedVolume();
+
+  while (state.keepRunning()) {
+    range1f r = volume.get(vec3i(0));
+    for_each(dims, [&](const vec3i &idx) { r.extend(volume.get(idx)); });
+    doNotOptimize(r);
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+// the same chain as views, inlined into the loop
+static void valueRangePerCellView(State &state)
+{
+  const auto volume =
+      subBox(convert<float>(*byteVolume()), box3i(vec3i(1), dims + 1));
+
+  while (state.keepRunning()) {
+    range1f r = volume.get(vec3i(0));
+    for_each(dims, [&](const vec3i &idx) { r.extend(volume.get(idx)); });
+    doNotOptimize(r);
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+static void valueRangeRows(State &state)
+{
+  const Array3D<float> &volume = *wrappedVolume();
+
+  while (state.keepRunning())
+    doNotOptimize(volume.getValueRange());
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+static void valueRangeActual(State &state)
+{
+  const ActualArray3D<float> &volume = floatVolume();
+
+  while (state.keepRunning())
+    doNotOptimize(volume.getValueRange());
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+static void macrocellGrid(State &state)
+{
+  const ActualArray3D<float> &volume = floatVolume();
+
+  while (state.keepRunning())
+    doNotOptimize(volume.computeMacrocellGrid(16)->value);
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+RKCOMMON_BENCHMARK("Array3D/getValueRange/per_cell_get", valueRangePerCell);
+RKCOMMON_BENCHMARK("Array3D/getValueRange/per_cell_view",
+                   valueRangePerCellView);
+RKCOMMON_BENCHMARK("Array3D/getValueRange/rows", valueRangeRows);
+RKCOMMON_BENCHMARK("Array3D/getValueRange/actual_float", valueRangeActual);
+RKCOMMON_BENCHMARK("Array3D/computeMacrocellGrid", macrocellGrid);
+
+// Array3D::get() per cell through each adaptor over float voxels, one virtual
+// call per cell and wrapper
+static std::shared_ptr<Array3D<float>> sharedFloatVolume()
+{
+  return std::shared_ptr<Array3D<float>>(&floatVolume(),
+                                         [](Array3D<float> *) {});
+}
+
+static void getPerCell(State &state, const Array3D<float> &volume)
+{
+  while (state.keepRunning()) {
+    float sum = 0.f;
+    for_each(dims, [&](const vec3i &idx) { sum += volume.get(idx); });
+    doNotOptimize(sum);
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+static void getActual(State &state)
+{
+  getPerCell(state, floatVolume());
+}
+
+static void getAccessor(State &state)
+{
+  getPerCell(state, Array3DAccessor<uint8_t, float>(byteVolume()));
+}
+
+static void getSubBox(State &state)
+{
+  getPerCell(state,
+             SubBoxArray3D<float>(sharedFloatVolume(), box3i(vec3i(0), dims)));
+}
+
+static void getIndexShifted(State &state)
+{
+  getPerCell(state,
+             IndexShiftedArray3D<float>(sharedFloatVolume(), vec3i(1, 2, 3)));
+}
+
+static void getRepeater(State &state)
+{
+  auto tile = std::make_shared<ActualArray3D<float>>(dims / 4);
+  tile->clear(1.f);
+  getPerCell(state, Array3DRepeater<float>(tile, dims));
+}
+
+static void getMultiSlice(State &state)
+{
+  std::vector<std::shared_ptr<Array3D<float>>> slices;
+  for (int z = 0; z < dims.z; ++z) {
+    auto slice =
+        std::make_shared<ActualArray3D<float>>(vec3i(dims.x, dims.y, 1));
+    slice->clear(float(z));
+    slices.push_back(slice);
+  }
+  getPerCell(state, MultiSliceArray3D<float>(slices));
+}
+
+RKCOMMON_BENCHMARK("Array3D/get/actual", getActual);
+RKCOMMON_BENCHMARK("Array3D/get/accessor", getAccessor);
+RKCOMMON_BENCHMARK("Array3D/get/sub_box", getSubBox);
+RKCOMMON_BENCHMARK("Array3D/get/index_shifted", getIndexShifted);
+RKCOMMON_BENCHMARK("Array3D/get/repeater", getRepeater);
+RKCOMMON_BENCHMARK("Array3D/get/multi_slice", getMultiSlice);
@@ -0,0 +1,161 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/array3D/BrickedArray3D.h"
+#include "rkcommon/utility/random.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+using namespace rkcommon::bench;
+
+static const vec3i dims(512, 512, 64);
+static const size_t numLookups = 1 << 20;
+
+static ActualArray3D<float> &linearVolume()
+{
+  static ActualArray3D<float> v(dims);
+  static bool initialized = false;
+  if (!initialized) {
+    for_each(dims, [&](const vec3i &idx) {
+      v.set(idx, float((idx.x ^ idx.y ^ idx.z) & 255));
+    });
+    initialized = true;
+  }
+  return v;
+}
+
+static BrickedArray3D<float> &brickedVolume()
+{
+  static BrickedArray3D<float> v(linearVolume());
+  return v;
+}
+
+static std::vector<vec3f> &positions()
+{
+  static std::vector<vec3f> p;
+  if (p.empty()) {
+    p.resize(numLookups);
+    utility::fillUniform(utility::philox_stream(7), 0, p.data(), numLookups);
+    for (auto &pos : p)
+      pos *= vec3f(dims - 1) - 1e-3f;
+  }
+  return p;
+}
+
+static vec3ul cellOffsets(const ActualArray3D<float> &volume, const vec3i &)
+{
+  return vec3ul(1, volume.dims.x, size_t(volume.dims.x) * volume.dims.y);
+}
+
+static vec3ul cellOffsets(const BrickedArray3D<float> &volume, const vec3i &i)
+{
+  return volume.cellOffsets(i);
+}
+
+// trilinear interpolation from the eight voxels around each position
+template <typename VOLUME_T>
+static void trilinear(State &state, const VOLUME_T &volume)
+{
+  const float *value = &volume.value[0];
+
+  while (state.keepRunning()) {
+    float sum = 0.f;
+    for (const vec3f &p : positions()) {
+      const vec3i i   = vec3i(p);
+      const vec3f f   = p - vec3f(i);
+      const vec3ul o  = cellOffsets(volume, i);
+      const float *c0 = value + volume.indexOf(i);
+      const float *c1 = c0 + o.z;
+      const float x00 = c0[0] + f.x * (c0[o.x] - c0[0]);
+      const float x10 = c0[o.y] + f.x * (c0[o.y + o.x] - c0[o.y]);
+      const float x01 = c1[0] + f.x * (c1[o.x] - c1[0]);
+      const float x11 = c1[o.y] + f.x * (c1[o.y + o.x] - c1[o.y]);
+      const float y0  = x00 + f.y * (x10 - x00);
+      const float y1  = x01 + f.y * (x11 - x01);
+      sum += y0 + f.z * (y1 - y0);
+    }
+    doNotOptimize(sum);
+  }
+
+  state.setItemsProcessed(state.iterations() * numLookups);
+}
+
+static void trilinearLinear(State &state)
+{
+  trilinear(state, linearVolume());
+}
+
+static void trilinearBricked(State &state)
+{
+  trilinear(state, brickedVolume());
+}
+
+// eight clamped get() calls through the interface per lookup
+static void trilinearPerCellGet(State &state)
+{
+  const Array3D<float> &volume = linearVolume();
+
+  while (state.keepRunning()) {
+    float sum = 0.f;
+    for (const vec3f &p : positions()) {
+      const vec3i i   = vec3i(p);
+      const vec3f f   = p - vec3f(i);
+      const float x00 =
+          lerp(f.x, volume.get(i), volume.get(i + vec3i(1, 0, 0)));
+      const float x10 = lerp(
+          f.x, volume.get(i + vec3i(0, 1, 0)), volume.get(i + vec3i(1, 1, 0)));
+      const float x01 = lerp(
+          f.x, volume.get(i + vec3i(0, 0, 1)), volume.get(i + vec3i(1, 0, 1)));
+      const float x11 = lerp(
+          f.x, volume.get(i + vec3i(0, 1, 1)), volume.get(i + vec3i(1, 1, 1)));
+      sum += lerp(f.z, lerp(f.y, x00, x10), lerp(f.y, x01, x11));
+    }
+    doNotOptimize(sum);
+  }
+
+  state.setItemsProcessed(state.iterations() * numLookups);
+}
+
+template <typename VOLUME_T>
+static void sampleTrilinear(State &state, const VOLUME_T &volume)
+{
+  std::vector<float> out(numLookups);
+
+  while (state.keepRunning()) {
+    volume.sampleTrilinear(positions().data(), out.data(), numLookups);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numLookups);
+}
+
+static void sampleTrilinearLinear(State &state)
+{
+  sampleTrilinear(state, linearVolume());
+}
+
+static void sampleTrilinearBricked(State &state)
+{
+  sampleTrilinear(state, brickedVolume());
+}
+
+static void toBricked(State &state)
+{
+  while (state.keepRunning()) {
+    BrickedArray3D<float> bricked(linearVolume());
+    doNotOptimize(bricked.value.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+RKCOMMON_BENCHMARK("Array3D/trilinear/linear", trilinearLinear);
+RKCOMMON_BENCHMARK("Array3D/trilinear/bricked", trilinearBricked);
+RKCOMMON_BENCHMARK("Array3D/trilinear/per_cell_get", trilinearPerCellGet);
+RKCOMMON_BENCHMARK("Array3D/sampleTrilinear/linear", sampleTrilinearLinear);
+RKCOMMON_BENCHMARK("Array3D/sampleTrilinear/bricked", sampleTrilinearBricked);
+RKCOMMON_BENCHMARK("Array3D/convert_to_bricked", toBricked);
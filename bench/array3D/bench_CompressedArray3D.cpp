@@ -0,0 +1,64 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/array3D/CompressedArray3D.h"
+// std
+#include <cmath>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+using namespace rkcommon::bench;
+
+static const vec3i dims(256, 256, 64);
+
+static ActualArray3D<float> &smoothVolume()
+{
+  static ActualArray3D<float> v(dims);
+  static bool initialized = false;
+  if (!initialized) {
+    for_each(dims, [&](const vec3i &idx) {
+      v.set(idx,
+            std::sin(idx.x * 0.05f) * std::cos(idx.y * 0.03f) + idx.z * 0.1f);
+    });
+    initialized = true;
+  }
+  return v;
+}
+
+template <Compression MODE>
+static void compress(State &state)
+{
+  while (state.keepRunning()) {
+    CompressedArray3D<float> compressed(smoothVolume(), MODE, 8);
+    doNotOptimize(compressed.compressedBytes());
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+// decodes every brick once, as rows fill from the per-thread cache
+template <Compression MODE>
+static void decompress(State &state)
+{
+  const CompressedArray3D<float> compressed(smoothVolume(), MODE, 8);
+  std::vector<float> out(longProduct(dims));
+
+  while (state.keepRunning()) {
+    compressed.getBlock(box3i(vec3i(0), dims), out.data());
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+RKCOMMON_BENCHMARK("CompressedArray3D/compress/lossless",
+                   compress<Compression::LOSSLESS>);
+RKCOMMON_BENCHMARK("CompressedArray3D/compress/fixed_rate",
+                   compress<Compression::FIXED_RATE>);
+RKCOMMON_BENCHMARK("CompressedArray3D/getBlock/lossless",
+                   decompress<Compression::LOSSLESS>);
+RKCOMMON_BENCHMARK("CompressedArray3D/getBlock/fixed_rate",
+                   decompress<Compression::FIXED_RATE>);
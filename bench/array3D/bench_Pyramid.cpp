@@ -0,0 +1,68 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/array3D/Pyramid.h"
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+using namespace rkcommon::bench;
+
+static const vec3i dims(256, 256, 256);
+
+static ActualArray3D<float> &volume()
+{
+  static ActualArray3D<float> v(dims);
+  static bool initialized = false;
+  if (!initialized) {
+    for_each(dims, [&](const vec3i &idx) {
+      v.set(idx, float((idx.x * 7 + idx.y * 13 + idx.z * 29) % 251));
+    });
+    initialized = true;
+  }
+  return v;
+}
+
+// one level by get() per cell, for comparison
+static void serialLevel(State &state)
+{
+  const ActualArray3D<float> &in = volume();
+  ActualArray3D<float> out(pyramidLevelSize(dims));
+  while (state.keepRunning()) {
+    for_each(out.size(), [&](const vec3i &idx) {
+      float sum = 0.f;
+      for (int i = 0; i < 8; i++)
+        sum += in.get(2 * idx + vec3i(i & 1, (i >> 1) & 1, i >> 2));
+      out.set(idx, .125f * sum);
+    });
+    doNotOptimize(out.value);
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+template <PyramidFilter FILTER>
+static void level(State &state)
+{
+  ActualArray3D<float> out(pyramidLevelSize(dims));
+  while (state.keepRunning()) {
+    array3D::detail::downsample(volume(), out, FILTER);
+    doNotOptimize(out.value);
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+static void pyramid(State &state)
+{
+  while (state.keepRunning())
+    doNotOptimize(buildPyramid(volume()).size());
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+RKCOMMON_BENCHMARK("Pyramid/level_serial", serialLevel);
+RKCOMMON_BENCHMARK("Pyramid/level_average", level<PyramidFilter::AVERAGE>);
+RKCOMMON_BENCHMARK("Pyramid/level_max", level<PyramidFilter::MAX>);
+RKCOMMON_BENCHMARK("Pyramid/build", pyramid);
@@ -0,0 +1,73 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/array3D/SparseArray3D.h"
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+using namespace rkcommon::bench;
+
+static const vec3i dims(256, 256, 256);
+
+// a few percent of the cells in a shell, the rest empty
+static ActualArray3D<float> &sparseVolume()
+{
+  static ActualArray3D<float> v(dims);
+  static bool initialized = false;
+  if (!initialized) {
+    for_each(dims, [&](const vec3i &idx) {
+      const float r = length(vec3f(idx) - vec3f(128.f));
+      v.set(idx, r > 100.f && r < 104.f ? r : 0.f);
+    });
+    initialized = true;
+  }
+  return v;
+}
+
+static void fromDense(State &state)
+{
+  while (state.keepRunning()) {
+    SparseArray3D<float> sparse(sparseVolume(), 0.f);
+    doNotOptimize(sparse.numLeaves());
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+// the dense array scans every cell
+static void denseValueRange(State &state)
+{
+  while (state.keepRunning())
+    doNotOptimize(sparseVolume().getValueRange(vec3i(1), dims - 1));
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+// whole nodes and leaves answer from their ranges
+static void sparseValueRange(State &state)
+{
+  const SparseArray3D<float> sparse(sparseVolume(), 0.f);
+  while (state.keepRunning())
+    doNotOptimize(sparse.getValueRange(vec3i(1), dims - 1));
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+static void forEachActive(State &state)
+{
+  const SparseArray3D<float> sparse(sparseVolume(), 0.f);
+  while (state.keepRunning()) {
+    float sum = 0.f;
+    sparse.for_each_active([&](const vec3i &, float v) { sum += v; });
+    doNotOptimize(sum);
+  }
+
+  state.setItemsProcessed(state.iterations() * sparse.numActiveCells());
+}
+
+RKCOMMON_BENCHMARK("SparseArray3D/from_dense", fromDense);
+RKCOMMON_BENCHMARK("SparseArray3D/getValueRange/dense", denseValueRange);
+RKCOMMON_BENCHMARK("SparseArray3D/getValueRange/sparse", sparseValueRange);
+RKCOMMON_BENCHMARK("SparseArray3D/for_each_active", forEachActive);
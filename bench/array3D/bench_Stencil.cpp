@@ -0,0 +1,103 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/array3D/Stencil.h"
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+using namespace rkcommon::bench;
+
+static const vec3i dims(256, 256, 256);
+
+static ActualArray3D<float> &volume()
+{
+  static ActualArray3D<float> v(dims);
+  static bool initialized = false;
+  if (!initialized) {
+    for_each(dims, [&](const vec3i &idx) {
+      v.set(idx, float((idx.x * 7 + idx.y * 13 + idx.z * 29) % 251));
+    });
+    initialized = true;
+  }
+  return v;
+}
+
+// 3x3x3 mean with 27 virtual get()s per cell, for comparison
+static void boxNaive(State &state)
+{
+  const Array3D<float> &in = volume();
+  ActualArray3D<float> out(dims);
+  while (state.keepRunning()) {
+    parallel_for_each(vec3i(0), dims, vec3i(64, 16, 16), [&](const vec3i &i) {
+      float sum = 0.f;
+      for (int z = -1; z <= 1; z++)
+        for (int y = -1; y <= 1; y++)
+          for (int x = -1; x <= 1; x++)
+            sum += in.get(clamp(i + vec3i(x, y, z), vec3i(0), dims - 1));
+      out.set(i, sum / 27.f);
+    });
+    doNotOptimize(out.value);
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+static void boxStencil(State &state)
+{
+  ActualArray3D<float> out(dims);
+  while (state.keepRunning()) {
+    applyStencil(volume(),
+                 out,
+                 vec3i(1),
+                 [](const StencilTile<float> &tile,
+                    const vec3i &begin,
+                    int count,
+                    float *o) {
+                   const ptrdiff_t sy = tile.stride(1), sz = tile.stride(2);
+                   const float *c     = tile.at(begin) - sy - sz;
+                   for (int x = 0; x < count; x++)
+                     o[x] = 0.f;
+                   for (int n = 0; n < 9; n++) {
+                     const float *row = c + (n % 3) * sy + (n / 3) * sz;
+                     for (int x = 0; x < count; x++)
+                       o[x] += row[x - 1] + row[x] + row[x + 1];
+                   }
+                   for (int x = 0; x < count; x++)
+                     o[x] *= 1.f / 27.f;
+                 });
+    doNotOptimize(out.value);
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+static void boxSeparable(State &state)
+{
+  ActualArray3D<float> out(dims);
+  const std::vector<float> w(3, 1.f / 3.f);
+  while (state.keepRunning()) {
+    convolveSeparable(volume(), out, w);
+    doNotOptimize(out.value);
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+static void gaussianSeparable(State &state)
+{
+  ActualArray3D<float> out(dims);
+  const std::vector<float> w = gaussianWeights(2.f, 4);
+  while (state.keepRunning()) {
+    convolveSeparable(volume(), out, w);
+    doNotOptimize(out.value);
+  }
+
+  state.setItemsProcessed(state.iterations() * longProduct(dims));
+}
+
+RKCOMMON_BENCHMARK("Stencil/box3_naive", boxNaive);
+RKCOMMON_BENCHMARK("Stencil/box3_applyStencil", boxStencil);
+RKCOMMON_BENCHMARK("Stencil/box3_separable", boxSeparable);
+RKCOMMON_BENCHMARK("Stencil/gaussian9_separable", gaussianSeparable);
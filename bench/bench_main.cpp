@@ -0,0 +1,418 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Benchmark.h"
+
+// rkcommon
+#include "rkcommon/tasking/tasking_system_init.h"
+#include "rkcommon/utility/StringManip.h"
+#include "rkcommon/version.h"
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace rkcommon {
+  namespace bench {
+
+    std::vector<std::pair<std::string, benchmark_fcn_t>> &registeredBenchmarks()
+    {
+      static std::vector<std::pair<std::string, benchmark_fcn_t>> benchmarks;
+      return benchmarks;
+    }
+
+    using tasking::TaskingBackend;
+
+    static const char *backendName(TaskingBackend backend)
+    {
+      switch (backend) {
+      case TaskingBackend::TBB:
+        return "tbb";
+      case TaskingBackend::OPENMP:
+        return "openmp";
+      case TaskingBackend::INTERNAL:
+        return "internal";
+      default:
+        return "serial";
+      }
+    }
+
+    struct Options
+    {
+      std::string filter{"."};
+      double minTime{0.2};
+      bool json{false};
+      std::string outFile;
+      std::vector<int> threads;
+      std::vector<TaskingBackend> backends;
+    };
+
+    struct Result
+    {
+      std::string name;
+      std::string family;
+      std::string backend;
+      int threads{1};
+      size_t iterations{0};
+      double realTimeNs{0.0};  // per iteration
+      double cpuTimeNs{0.0};   // per iteration, whole process
+      double itemsPerSecond{0.0};
+      std::map<std::string, double> counters;
+      std::string errorMessage;
+    };
+
+    class Runner
+    {
+     public:
+      explicit Runner(const Options &options) : options(options) {}
+
+      Result run(const std::string &family,
+                 benchmark_fcn_t fcn,
+                 TaskingBackend backend,
+                 int threads) const;
+
+     private:
+      const Options &options;
+    };
+
+    Result Runner::run(const std::string &family,
+                       benchmark_fcn_t fcn,
+                       TaskingBackend backend,
+                       int threads) const
+    {
+      Result result;
+      result.family  = family;
+      result.backend = backendName(backend);
+      result.threads = threads;
+      result.name    = family + "/backend:" + result.backend
+                    + "/threads:" + std::to_string(threads);
+
+      // grow the iteration count until a run takes at least 'minTime'
+      size_t iterations = 1;
+      while (true) {
+        State state(iterations);
+        state.numThreads = threads;
+
+        const std::clock_t cpuStart = std::clock();
+        fcn(state);
+        const std::clock_t cpuEnd = std::clock();
+
+        const double seconds =
+            std::chrono::duration<double>(state.elapsed).count();
+        const size_t maxIterations = 1000000000;
+
+        if (state.errorOccurred() || seconds >= options.minTime
+            || iterations >= maxIterations) {
+          const double n    = double(std::max(state.iterations(), size_t(1)));
+          result.iterations = state.iterations();
+          result.realTimeNs = seconds * 1e9 / n;
+          result.cpuTimeNs =
+              double(cpuEnd - cpuStart) / CLOCKS_PER_SEC * 1e9 / n;
+          if (state.itemsProcessed && seconds > 0.0)
+            result.itemsPerSecond = double(state.itemsProcessed) / seconds;
+          result.counters     = state.counters;
+          result.errorMessage = state.errorMessage;
+          return result;
+        }
+
+        // same heuristic as Google Benchmark: aim a bit past 'minTime', but
+        // grow at most 10x per step
+        const double multiplier =
+            seconds <= options.minTime / 10.0
+                ? 10.0
+                : options.minTime * 1.4 / std::max(seconds, 1e-9);
+        iterations = std::min(
+            maxIterations,
+            std::max(iterations + 1,
+                     size_t(std::ceil(double(iterations) * multiplier))));
+      }
+    }
+
+    // Output /////////////////////////////////////////////////////////////////
+
+    static std::string jsonString(const std::string &s)
+    {
+      std::ostringstream os;
+      os << '"';
+      for (char c : s) {
+        switch (c) {
+        case '"':
+          os << "\\\"";
+          break;
+        case '\\':
+          os << "\\\\";
+          break;
+        case '\n':
+          os << "\\n";
+          break;
+        default:
+          if ((unsigned char)c < 0x20)
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+               << int(c) << std::dec;
+          else
+            os << c;
+        }
+      }
+      os << '"';
+      return os.str();
+    }
+
+    static std::string currentDate()
+    {
+      char buf[64]          = {0};
+      const std::time_t now = std::time(nullptr);
+      std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+      return buf;
+    }
+
+    // Google Benchmark compatible JSON, with 'backend' and 'threads' added
+    static void writeJson(std::ostream &os, const std::vector<Result> &results)
+    {
+      os << std::setprecision(10);
+      os << "{\n";
+      os << "  \"context\": {\n";
+      os << "    \"date\": " << jsonString(currentDate()) << ",\n";
+      os << "    \"num_cpus\": " << std::thread::hardware_concurrency()
+         << ",\n";
+      os << "    \"rkcommon_version\": " << jsonString(RKCOMMON_VERSION)
+         << ",\n";
+#ifdef NDEBUG
+      os << "    \"library_build_type\": \"release\"\n";
+#else
+      os << "    \"library_build_type\": \"debug\"\n";
+#endif
+      os << "  },\n";
+      os << "  \"benchmarks\": [";
+
+      for (size_t i = 0; i < results.size(); ++i) {
+        const auto &r = results[i];
+        os << (i == 0 ? "\n" : ",\n") << "    {\n";
+        os << "      \"name\": " << jsonString(r.name) << ",\n";
+        os << "      \"family\": " << jsonString(r.family) << ",\n";
+        os << "      \"backend\": " << jsonString(r.backend) << ",\n";
+        os << "      \"threads\": " << r.threads << ",\n";
+        if (!r.errorMessage.empty()) {
+          os << "      \"error_occurred\": true,\n";
+          os << "      \"error_message\": " << jsonString(r.errorMessage)
+             << ",\n";
+        }
+        os << "      \"iterations\": " << r.iterations << ",\n";
+        os << "      \"real_time\": " << r.realTimeNs << ",\n";
+        os << "      \"cpu_time\": " << r.cpuTimeNs << ",\n";
+        os << "      \"time_unit\": \"ns\"";
+        if (r.itemsPerSecond > 0.0)
+          os << ",\n      \"items_per_second\": " << r.itemsPerSecond;
+        for (const auto &c : r.counters)
+          os << ",\n      " << jsonString(c.first) << ": " << c.second;
+        os << "\n    }";
+      }
+
+      os << "\n  ]\n}\n";
+    }
+
+    static void printHeader()
+    {
+      std::printf("%-64s %14s %14s %12s\n",
+                  "Benchmark",
+                  "Time (ns)",
+                  "CPU (ns)",
+                  "Iterations");
+      std::printf("%s\n", std::string(107, '-').c_str());
+    }
+
+    static void printResult(const Result &r)
+    {
+      if (!r.errorMessage.empty()) {
+        std::printf("%-64s ERROR: %s\n", r.name.c_str(), r.errorMessage.c_str());
+        return;
+      }
+
+      std::printf("%-64s %14.1f %14.1f %12zu",
+                  r.name.c_str(),
+                  r.realTimeNs,
+                  r.cpuTimeNs,
+                  r.iterations);
+      if (r.itemsPerSecond > 0.0)
+        std::printf(" items/s=%.4g", r.itemsPerSecond);
+      for (const auto &c : r.counters)
+        std::printf(" %s=%.4g", c.first.c_str(), c.second);
+      std::printf("\n");
+      std::fflush(stdout);
+    }
+
+    // Command line ///////////////////////////////////////////////////////////
+
+    static void printUsage()
+    {
+      std::cout
+          << "usage: rkcommon_bench [options]\n"
+          << "  --benchmark_filter=<regex>   run matching benchmark families\n"
+          << "  --benchmark_min_time=<sec>   minimum time per run (0.2)\n"
+          << "  --benchmark_format=<fmt>     'console' (default) or 'json'\n"
+          << "  --benchmark_out=<file>       also write JSON results to file\n"
+          << "  --threads=<n,...>            thread counts (1 to #cores)\n"
+          << "  --backends=<name,...>        tbb, openmp, internal, serial\n"
+          << "                               (all available by default)\n"
+          << "  --benchmark_list_tests       print families and exit\n";
+    }
+
+    static bool parseFlag(const std::string &arg,
+                          const std::string &flag,
+                          std::string &value)
+    {
+      const std::string prefix = "--" + flag + "=";
+      if (!utility::beginsWith(arg, prefix))
+        return false;
+      value = arg.substr(prefix.size());
+      return true;
+    }
+
+    static std::vector<int> defaultThreadCounts()
+    {
+      // powers of two up to the number of hardware threads, and that number
+      const int n = std::max(1, int(std::thread::hardware_concurrency()));
+      std::vector<int> threads;
+      for (int t = 1; t < n; t *= 2)
+        threads.push_back(t);
+      threads.push_back(n);
+      return threads;
+    }
+
+    static TaskingBackend parseBackend(const std::string &name)
+    {
+      const std::string n = utility::lowerCase(name);
+      if (n == "tbb")
+        return TaskingBackend::TBB;
+      if (n == "openmp" || n == "omp")
+        return TaskingBackend::OPENMP;
+      if (n == "internal")
+        return TaskingBackend::INTERNAL;
+      if (n == "serial" || n == "debug")
+        return TaskingBackend::SERIAL;
+      throw std::runtime_error("unknown tasking backend '" + name + "'");
+    }
+
+    static int main(int argc, const char *argv[])
+    {
+      Options options;
+      bool listOnly = false;
+
+      for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        std::string value;
+        if (arg == "--help" || arg == "-h") {
+          printUsage();
+          return 0;
+        } else if (arg == "--benchmark_list_tests") {
+          listOnly = true;
+        } else if (parseFlag(arg, "benchmark_filter", value)) {
+          options.filter = value;
+        } else if (parseFlag(arg, "benchmark_min_time", value)) {
+          options.minTime = std::atof(value.c_str());
+        } else if (parseFlag(arg, "benchmark_format", value)) {
+          options.json = value == "json";
+        } else if (parseFlag(arg, "benchmark_out", value)) {
+          options.outFile = value;
+        } else if (parseFlag(arg, "threads", value)) {
+          for (const auto &t : utility::split(value, ','))
+            options.threads.push_back(std::max(1, std::atoi(t.c_str())));
+        } else if (parseFlag(arg, "backends", value)) {
+          for (const auto &b : utility::split(value, ','))
+            options.backends.push_back(parseBackend(b));
+        } else {
+          std::cerr << "unknown option '" << arg << "'\n";
+          printUsage();
+          return 1;
+        }
+      }
+
+      if (options.threads.empty())
+        options.threads = defaultThreadCounts();
+
+      if (options.backends.empty()) {
+        for (auto b : {TaskingBackend::TBB,
+                       TaskingBackend::OPENMP,
+                       TaskingBackend::INTERNAL,
+                       TaskingBackend::SERIAL}) {
+          if (tasking::isTaskingBackendAvailable(b))
+            options.backends.push_back(b);
+        }
+      }
+
+      const std::regex filter(options.filter);
+      std::vector<std::pair<std::string, benchmark_fcn_t>> selected;
+      for (const auto &b : registeredBenchmarks()) {
+        if (std::regex_search(b.first, filter))
+          selected.push_back(b);
+      }
+
+      if (listOnly) {
+        for (const auto &b : selected)
+          std::cout << b.first << "\n";
+        return 0;
+      }
+
+      if (!options.json)
+        printHeader();
+
+      Runner runner(options);
+      std::vector<Result> results;
+
+      for (auto backend : options.backends) {
+        if (!tasking::isTaskingBackendAvailable(backend)) {
+          std::cerr << "skipping unavailable backend '" << backendName(backend)
+                    << "'\n";
+          continue;
+        }
+
+        // the serial backend ignores the thread count
+        std::vector<int> threads = options.threads;
+        if (backend == TaskingBackend::SERIAL)
+          threads = {1};
+
+        for (int t : threads) {
+          tasking::initTaskingSystem(backend, t);
+          for (const auto &b : selected) {
+            results.push_back(runner.run(b.first, b.second, backend, t));
+            if (!options.json)
+              printResult(results.back());
+          }
+        }
+      }
+
+      if (options.json)
+        writeJson(std::cout, results);
+
+      if (!options.outFile.empty()) {
+        std::ofstream out(options.outFile);
+        if (!out) {
+          std::cerr << "could not open '" << options.outFile << "'\n";
+          return 1;
+        }
+        writeJson(out, results);
+      }
+
+      return 0;
+    }
+
+  }  // namespace bench
+}  // namespace rkcommon
+
+int main(int argc, const char *argv[])
+{
+  try {
+    return rkcommon::bench::main(argc, argv);
+  } catch (const std::exception &e) {
+    std::cerr << "rkcommon_bench: " << e.what() << "\n";
+    return 1;
+  }
+}
@@ -0,0 +1,82 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/containers/ConcurrentHashMap.h"
+#include "rkcommon/tasking/parallel_for.h"
+// std
+#include <mutex>
+#include <unordered_map>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::containers;
+
+static const int numLookups = 1 << 20;
+static const int numKeys    = 4096;
+
+// What a mutex around a std::unordered_map costs for the same lookups
+static void mutexMap(State &state)
+{
+  std::unordered_map<int, int> map;
+  std::mutex mutex;
+  for (int k = 0; k < numKeys; ++k)
+    map[k] = k;
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(numLookups / 1024, [&](int task) {
+      int sum = 0;
+      for (int i = 0; i < 1024; ++i) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sum += map.find((task * 1024 + i) * 7 % numKeys)->second;
+      }
+      doNotOptimize(sum);
+    });
+  }
+
+  state.setItemsProcessed(state.iterations() * numLookups);
+}
+
+static void concurrentMap(State &state)
+{
+  ConcurrentHashMap<int, int> map;
+  for (int k = 0; k < numKeys; ++k)
+    map.emplace(k, k);
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(numLookups / 1024, [&](int task) {
+      int sum = 0;
+      for (int i = 0; i < 1024; ++i)
+        sum += *map.find((task * 1024 + i) * 7 % numKeys);
+      doNotOptimize(sum);
+    });
+  }
+
+  state.setItemsProcessed(state.iterations() * numLookups);
+}
+
+// With one pin() over a batch of lookups, the nested ones skip the fence
+static void concurrentMapPinned(State &state)
+{
+  ConcurrentHashMap<int, int> map;
+  for (int k = 0; k < numKeys; ++k)
+    map.emplace(k, k);
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(numLookups / 1024, [&](int task) {
+      auto guard = map.pin();
+      int sum    = 0;
+      for (int i = 0; i < 1024; ++i)
+        sum += *map.find((task * 1024 + i) * 7 % numKeys);
+      doNotOptimize(sum);
+    });
+  }
+
+  state.setItemsProcessed(state.iterations() * numLookups);
+}
+
+RKCOMMON_BENCHMARK("ConcurrentHashMap/find/mutex_unordered_map", mutexMap);
+RKCOMMON_BENCHMARK("ConcurrentHashMap/find/lock_free", concurrentMap);
+RKCOMMON_BENCHMARK("ConcurrentHashMap/find/lock_free_pinned",
+                   concurrentMapPinned);
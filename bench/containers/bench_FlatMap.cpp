@@ -0,0 +1,93 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/containers/FlatMap.h"
+// std
+#include <map>
+#include <unordered_map>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::containers;
+
+static const int lookupsPerIteration = 1 << 14;
+
+// Hits on a map of SIZE int keys, spread over the map with a stride so the
+// linear searches do not always end early
+template <typename MAP, int SIZE>
+static void lookup(State &state)
+{
+  MAP map;
+  for (int k = 0; k < SIZE; ++k)
+    map[k * 3] = k;
+
+  while (state.keepRunning()) {
+    int sum = 0;
+    for (int i = 0; i < lookupsPerIteration; ++i)
+      sum += map.at((i * 7 % SIZE) * 3);
+    doNotOptimize(sum);
+  }
+
+  state.setItemsProcessed(state.iterations() * lookupsPerIteration);
+}
+
+// One per container, as the macro would split template argument lists
+template <int SIZE>
+static void insertionOrder(State &state)
+{
+  lookup<FlatMap<int, int>, SIZE>(state);
+}
+
+template <int SIZE>
+static void sortedKeys(State &state)
+{
+  lookup<FlatMap<int, int, SortedKeys>, SIZE>(state);
+}
+
+template <int SIZE>
+static void splitKeys(State &state)
+{
+  lookup<FlatMap<int, int, SplitKeys>, SIZE>(state);
+}
+
+template <int SIZE>
+static void stdMap(State &state)
+{
+  lookup<std::map<int, int>, SIZE>(state);
+}
+
+template <int SIZE>
+static void stdUnorderedMap(State &state)
+{
+  lookup<std::unordered_map<int, int>, SIZE>(state);
+}
+
+RKCOMMON_BENCHMARK("FlatMap/lookup/4/insertion_order", insertionOrder<4>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/4/sorted_keys", sortedKeys<4>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/4/split_keys", splitKeys<4>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/4/std_map", stdMap<4>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/4/std_unordered_map", stdUnorderedMap<4>);
+
+RKCOMMON_BENCHMARK("FlatMap/lookup/32/insertion_order", insertionOrder<32>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/32/sorted_keys", sortedKeys<32>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/32/split_keys", splitKeys<32>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/32/std_map", stdMap<32>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/32/std_unordered_map",
+                   stdUnorderedMap<32>);
+
+RKCOMMON_BENCHMARK("FlatMap/lookup/256/insertion_order", insertionOrder<256>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/256/sorted_keys", sortedKeys<256>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/256/split_keys", splitKeys<256>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/256/std_map", stdMap<256>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/256/std_unordered_map",
+                   stdUnorderedMap<256>);
+
+RKCOMMON_BENCHMARK("FlatMap/lookup/2048/insertion_order",
+                   insertionOrder<2048>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/2048/sorted_keys", sortedKeys<2048>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/2048/split_keys", splitKeys<2048>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/2048/std_map", stdMap<2048>);
+RKCOMMON_BENCHMARK("FlatMap/lookup/2048/std_unordered_map",
+                   stdUnorderedMap<2048>);
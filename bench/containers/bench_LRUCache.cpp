@@ -0,0 +1,40 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/containers/LRUCache.h"
+#include "rkcommon/tasking/parallel_for.h"
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::containers;
+
+static const int numLookups = 1 << 20;
+static const int numKeys    = 4096;
+
+// Lookups of resident keys from all threads; with a single shard they
+// all contend for one lock
+template <int SHARDS>
+static void concurrentHits(State &state)
+{
+  // room to spare, as the keys do not spread evenly over the shards
+  LRUCache<int, int> cache(4 * numKeys * sizeof(int), SHARDS);
+  for (int k = 0; k < numKeys; ++k)
+    cache.insert(k, k);
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(numLookups / 1024, [&](int task) {
+      int sum = 0;
+      for (int i = 0; i < 1024; ++i)
+        sum += *cache.get_or_load((task * 1024 + i) * 7 % numKeys,
+                                  [](int k) { return k; });
+      doNotOptimize(sum);
+    });
+  }
+
+  state.setItemsProcessed(state.iterations() * numLookups);
+}
+
+RKCOMMON_BENCHMARK("LRUCache/concurrent_hits/1_shard", concurrentHits<1>);
+RKCOMMON_BENCHMARK("LRUCache/concurrent_hits/64_shards", concurrentHits<64>);
@@ -0,0 +1,41 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/containers/TransactionalBuffer.h"
+#include "rkcommon/tasking/parallel_for.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::containers;
+
+static const int pushesPerTask = 1 << 14;
+
+// Every tasking thread pushes at once, e.g. work items found while
+// rendering tiles, and the buffer is consumed once per iteration
+template <typename BUFFER>
+static void pushContended(State &state)
+{
+  const int numTasks = tasking::numTaskingThreads();
+  BUFFER buffer;
+  std::vector<int> recycled;
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(numTasks, [&](int task) {
+      for (int i = 0; i < pushesPerTask; ++i)
+        buffer.push_back(task + i);
+    });
+    recycled = buffer.consume(std::move(recycled));
+    doNotOptimize(recycled.data());
+    recycled.clear();
+  }
+
+  state.setItemsProcessed(state.iterations() * numTasks * pushesPerTask);
+}
+
+RKCOMMON_BENCHMARK("TransactionalBuffer/push/mutex",
+                   pushContended<TransactionalBuffer<int>>);
+RKCOMMON_BENCHMARK("TransactionalBuffer/push/mpsc",
+                   pushContended<MPSCTransactionalBuffer<int>>);
@@ -0,0 +1,111 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/BVH.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static const size_t numBoxes   = 1 << 20;
+static const size_t numQueries = 1024;
+
+// instances scattered over a 1000^3 scene
+static std::vector<box3f> &boxes()
+{
+  static std::vector<box3f> b;
+  if (b.empty()) {
+    b.resize(numBoxes);
+    uint32_t state = 1;
+    auto rnd       = [&]() {
+      state = state * 1664525u + 1013904223u;
+      return float(state >> 8) / float(1 << 24);
+    };
+    for (auto &box : b) {
+      const vec3f p(1000.f * rnd(), 1000.f * rnd(), 1000.f * rnd());
+      box = box3f(p, p + vec3f(1.f + rnd()));
+    }
+  }
+  return b;
+}
+
+static std::vector<box3f> &queries()
+{
+  static std::vector<box3f> q;
+  if (q.empty()) {
+    for (size_t i = 0; i < numQueries; ++i) {
+      const vec3f p(float(i % 32) * 30.f, float(i / 32) * 30.f, 500.f);
+      q.push_back(box3f(p, p + vec3f(10.f)));
+    }
+  }
+  return q;
+}
+
+template <bool MORTON>
+static void build(State &state)
+{
+  BVHBuildSettings settings;
+  settings.mortonPresort = MORTON;
+
+  BVH bvh;
+  while (state.keepRunning()) {
+    bvh.build(boxes().data(), numBoxes, settings);
+    doNotOptimize(bvh.numNodes());
+  }
+
+  state.setItemsProcessed(state.iterations() * numBoxes);
+}
+
+static void refit(State &state)
+{
+  BVH bvh(boxes().data(), numBoxes);
+  while (state.keepRunning()) {
+    bvh.refit(boxes().data());
+    doNotOptimize(bvh.nodes().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numBoxes);
+}
+
+// Culling by a linear scan over all boxes, for comparison
+static void queryLinear(State &state)
+{
+  while (state.keepRunning()) {
+    size_t hits = 0;
+    for (size_t q = 0; q < 16; ++q) {
+      for (const auto &b : boxes())
+        hits += touchingOrOverlapping(b, queries()[q]);
+    }
+    doNotOptimize(hits);
+  }
+
+  state.setItemsProcessed(state.iterations() * 16);
+}
+
+template <bool MORTON>
+static void query(State &state)
+{
+  BVHBuildSettings settings;
+  settings.mortonPresort = MORTON;
+  BVH bvh(boxes().data(), numBoxes, settings);
+
+  while (state.keepRunning()) {
+    size_t hits = 0;
+    for (const auto &q : queries())
+      bvh.query(q, [&](uint32_t) { hits++; });
+    doNotOptimize(hits);
+  }
+
+  state.setItemsProcessed(state.iterations() * numQueries);
+}
+
+RKCOMMON_BENCHMARK("BVH/build_SAH", build<false>);
+RKCOMMON_BENCHMARK("BVH/build_Morton", build<true>);
+RKCOMMON_BENCHMARK("BVH/refit", refit);
+RKCOMMON_BENCHMARK("BVH/query_linear_scan", queryLinear);
+RKCOMMON_BENCHMARK("BVH/query_SAH", query<false>);
+RKCOMMON_BENCHMARK("BVH/query_Morton", query<true>);
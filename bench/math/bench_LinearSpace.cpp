@@ -0,0 +1,88 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/AffineSpace.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static const size_t numMatrices = 1 << 12;
+
+template <typename L>
+static const std::vector<L> &matrices()
+{
+  static const std::vector<L> m = []() {
+    std::vector<L> m(numMatrices);
+    for (size_t i = 0; i < numMatrices; ++i) {
+      const float angle = float(i) * .01f;
+      m[i] = L::rotate(vec3f(1.f, float(i % 3), .5f), angle)
+          * L::scale(vec3f(1.f + float(i % 4), 2.f, .5f));
+    }
+    return m;
+  }();
+  return m;
+}
+
+// the general inverse through the adjugate, as for instance transforms
+template <typename L>
+static void inverse(State &state)
+{
+  const std::vector<L> &m = matrices<L>();
+  std::vector<L> out(numMatrices);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numMatrices; ++i)
+      out[i] = m[i].inverse();
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numMatrices);
+}
+
+RKCOMMON_BENCHMARK("LinearSpace3/inverse/float", inverse<LinearSpace3f>);
+RKCOMMON_BENCHMARK("LinearSpace3/inverse/aligned", inverse<LinearSpace3fa>);
+
+// matrix products, as when flattening a transform hierarchy
+template <typename L>
+static void multiply(State &state)
+{
+  const std::vector<L> &m = matrices<L>();
+  std::vector<L> out(numMatrices);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numMatrices; ++i)
+      out[i] = m[i] * m[numMatrices - 1 - i];
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numMatrices);
+}
+
+RKCOMMON_BENCHMARK("LinearSpace3/multiply/float", multiply<LinearSpace3f>);
+RKCOMMON_BENCHMARK("LinearSpace3/multiply/aligned", multiply<LinearSpace3fa>);
+
+// one transform applied to many points, with the matrix in registers
+template <typename L>
+static void xfmPoints(State &state)
+{
+  using vec_t = typename L::Vector;
+  const AffineSpaceT<L> xfm(matrices<L>()[7], vec_t(1.f, 2.f, 3.f));
+  std::vector<vec_t> points(numMatrices, vec_t(1.f, 2.f, 3.f));
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numMatrices; ++i)
+      points[i] = xfmPoint(xfm, points[i]);
+    doNotOptimize(points.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numMatrices);
+}
+
+RKCOMMON_BENCHMARK("AffineSpace3/xfmPoint/float", xfmPoints<LinearSpace3f>);
+RKCOMMON_BENCHMARK("AffineSpace3/xfmPoint/aligned",
+                   xfmPoints<LinearSpace3fa>);
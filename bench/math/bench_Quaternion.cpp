@@ -0,0 +1,91 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/LinearSpace.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static const size_t numQuaternions = 1 << 12;
+
+static const std::vector<quaternionf> &rotations()
+{
+  static const std::vector<quaternionf> q = []() {
+    std::vector<quaternionf> q(numQuaternions);
+    for (size_t i = 0; i < numQuaternions; ++i) {
+      q[i] = quaternionf::rotate(vec3f(1.f, float(i % 3), .5f),
+                                 float(i) * .01f);
+    }
+    return q;
+  }();
+  return q;
+}
+
+// composing rotations, as when walking a skeleton
+static void multiply(State &state)
+{
+  const std::vector<quaternionf> &q = rotations();
+  std::vector<quaternionf> out(numQuaternions);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numQuaternions; ++i)
+      out[i] = q[i] * q[numQuaternions - 1 - i];
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numQuaternions);
+}
+
+// rotating a point by each quaternion
+static void rotatePoint(State &state)
+{
+  const std::vector<quaternionf> &q = rotations();
+  std::vector<vec3f> out(numQuaternions);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numQuaternions; ++i)
+      out[i] = xfmPoint(q[i], vec3f(1.f, 2.f, 3.f));
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numQuaternions);
+}
+
+static void normalizeEach(State &state)
+{
+  const std::vector<quaternionf> &q = rotations();
+  std::vector<quaternionf> out(numQuaternions);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numQuaternions; ++i)
+      out[i] = normalize(q[i] * 2.f);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numQuaternions);
+}
+
+// to a matrix, e.g. once per instance before transforming its points
+static void toLinearSpace(State &state)
+{
+  const std::vector<quaternionf> &q = rotations();
+  std::vector<LinearSpace3f> out(numQuaternions);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numQuaternions; ++i)
+      out[i] = LinearSpace3f(q[i]);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numQuaternions);
+}
+
+RKCOMMON_BENCHMARK("Quaternion/multiply", multiply);
+RKCOMMON_BENCHMARK("Quaternion/xfmPoint", rotatePoint);
+RKCOMMON_BENCHMARK("Quaternion/normalize", normalizeEach);
+RKCOMMON_BENCHMARK("Quaternion/to_LinearSpace3f", toLinearSpace);
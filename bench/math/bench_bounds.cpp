@@ -0,0 +1,62 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/bounds.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static const size_t numBoxes = 1 << 20;
+
+static std::vector<box3f> &boxes()
+{
+  static std::vector<box3f> b;
+  if (b.empty()) {
+    b.resize(numBoxes);
+    for (size_t i = 0; i < numBoxes; ++i) {
+      const vec3f p(i % 1021, i % 509, i % 31);
+      b[i] = box3f(p, p + vec3f(1.f));
+    }
+  }
+  return b;
+}
+
+// One extend() per box and centroid
+static void scalarLoop(State &state)
+{
+  while (state.keepRunning()) {
+    box3f bounds(empty);
+    box3f centroidBounds(empty);
+    for (const auto &b : boxes()) {
+      bounds.extend(b);
+      centroidBounds.extend(b.center());
+    }
+    doNotOptimize(bounds);
+    doNotOptimize(centroidBounds);
+  }
+
+  state.setItemsProcessed(state.iterations() * numBoxes);
+}
+
+template <bool PARALLEL>
+static void batched(State &state)
+{
+  box3f centroidBounds;
+
+  while (state.keepRunning()) {
+    doNotOptimize(
+        computeBounds(boxes().data(), numBoxes, &centroidBounds, PARALLEL));
+    doNotOptimize(centroidBounds);
+  }
+
+  state.setItemsProcessed(state.iterations() * numBoxes);
+}
+
+RKCOMMON_BENCHMARK("computeBounds/scalar_loop", scalarLoop);
+RKCOMMON_BENCHMARK("computeBounds/batched", batched<false>);
+RKCOMMON_BENCHMARK("computeBounds/batched_parallel", batched<true>);
@@ -0,0 +1,114 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/fastmath.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static constexpr int W = NATIVE_PACKET_WIDTH < 4 ? 4 : NATIVE_PACKET_WIDTH;
+
+static const size_t numValues = 1 << 16;
+
+static std::vector<float> &values()
+{
+  static std::vector<float> v;
+  if (v.empty()) {
+    v.resize(numValues);
+    for (size_t i = 0; i < numValues; ++i)
+      v[i] = float(i) / numValues;
+  }
+  return v;
+}
+
+template <typename FCN_T>
+static void scalarLoop(State &state, FCN_T &&fcn)
+{
+  std::vector<float> out(numValues);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numValues; ++i)
+      out[i] = fcn(values()[i]);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numValues);
+}
+
+template <typename FCN_T>
+static void packetLoop(State &state, FCN_T &&fcn)
+{
+  std::vector<float> out(numValues);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numValues; i += W)
+      vfloat<W>::storeu(&out[i], fcn(vfloat<W>::loadu(&values()[i])));
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numValues);
+}
+
+static void stdPow(State &state)
+{
+  scalarLoop(state, [](float x) { return std::pow(x, 1.f / 2.2f); });
+}
+
+static void stdSin(State &state)
+{
+  scalarLoop(state, [](float x) { return std::sin(x); });
+}
+
+template <MathPrecision P>
+static void fastPowScalar(State &state)
+{
+  scalarLoop(state, [](float x) { return fast_pow<P>(x, 1.f / 2.2f); });
+}
+
+template <MathPrecision P>
+static void fastPowPacket(State &state)
+{
+  packetLoop(state,
+             [](const vfloat<W> &x) { return fast_pow<P>(x, 1.f / 2.2f); });
+}
+
+template <MathPrecision P>
+static void fastSinPacket(State &state)
+{
+  packetLoop(state, [](const vfloat<W> &x) { return fast_sin<P>(x); });
+}
+
+static void srgbScalar(State &state)
+{
+  scalarLoop(state, [](float x) { return linear_to_srgb(x); });
+}
+
+static void srgbBuffer(State &state)
+{
+  std::vector<float> out(numValues);
+
+  while (state.keepRunning()) {
+    linear_to_srgb(values().data(), out.data(), numValues);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numValues);
+}
+
+RKCOMMON_BENCHMARK("fastmath/pow/std", stdPow);
+RKCOMMON_BENCHMARK("fastmath/pow/scalar_accurate",
+                   fastPowScalar<MathPrecision::Accurate>);
+RKCOMMON_BENCHMARK("fastmath/pow/packet_accurate",
+                   fastPowPacket<MathPrecision::Accurate>);
+RKCOMMON_BENCHMARK("fastmath/pow/packet_fast",
+                   fastPowPacket<MathPrecision::Fast>);
+RKCOMMON_BENCHMARK("fastmath/sin/std", stdSin);
+RKCOMMON_BENCHMARK("fastmath/sin/packet_accurate",
+                   fastSinPacket<MathPrecision::Accurate>);
+RKCOMMON_BENCHMARK("fastmath/linear_to_srgb/scalar", srgbScalar);
+RKCOMMON_BENCHMARK("fastmath/linear_to_srgb/buffer", srgbBuffer);
@@ -0,0 +1,84 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/frustum.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static const size_t numBoxes = 1 << 20;
+
+static const Frustum frustum =
+    Frustum::perspective(AffineSpace3f::lookat(vec3f(0.f, 0.f, -10.f),
+                                               vec3f(60.f, 10.f, 30.f),
+                                               vec3f(0.f, 1.f, 0.f)),
+                         60.f,
+                         1.5f,
+                         .1f,
+                         80.f);
+
+// instances on a 128^2 x 64 grid, in grid order
+static std::vector<box3f> &boxes()
+{
+  static std::vector<box3f> b;
+  if (b.empty()) {
+    b.resize(numBoxes);
+    for (size_t i = 0; i < numBoxes; ++i) {
+      const vec3f p(i % 128, (i / 128) % 64, i / (128 * 64));
+      b[i] = box3f(p, p + .8f);
+    }
+  }
+  return b;
+}
+
+static std::vector<uint8_t> &mask()
+{
+  static std::vector<uint8_t> m(numBoxes);
+  return m;
+}
+
+// One isVisible() call per box
+static void scalarLoop(State &state)
+{
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numBoxes; ++i)
+      mask()[i] = frustum.isVisible(boxes()[i]);
+    doNotOptimize(mask().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numBoxes);
+}
+
+// The same, with a plane hint per box kept across frames
+static void scalarHints(State &state)
+{
+  std::vector<int> hints(numBoxes, 0);
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numBoxes; ++i)
+      mask()[i] = frustum.isVisible(boxes()[i], &hints[i]);
+    doNotOptimize(mask().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numBoxes);
+}
+
+template <bool PARALLEL>
+static void batched(State &state)
+{
+  while (state.keepRunning()) {
+    frustum.cull(boxes().data(), numBoxes, mask().data(), PARALLEL);
+    doNotOptimize(mask().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numBoxes);
+}
+
+RKCOMMON_BENCHMARK("frustumCull/scalar_loop", scalarLoop);
+RKCOMMON_BENCHMARK("frustumCull/scalar_plane_hints", scalarHints);
+RKCOMMON_BENCHMARK("frustumCull/batched", batched<false>);
+RKCOMMON_BENCHMARK("frustumCull/batched_parallel", batched<true>);
@@ -0,0 +1,89 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/packet.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static const int W        = NATIVE_PACKET_WIDTH < 4 ? 4 : NATIVE_PACKET_WIDTH;
+static const int numNodes = 4096;
+
+// the child boxes of 'numNodes' BVH nodes, once as AoS and once as SoA
+struct Scene
+{
+  std::vector<box3f> boxes;
+  std::vector<box3vf<W>> nodes;
+
+  Scene() : boxes(numNodes * W), nodes(numNodes)
+  {
+    for (int n = 0; n < numNodes; ++n) {
+      for (int i = 0; i < W; ++i) {
+        const vec3f lower(n % 17, i - W / 2, (n * i) % 5 - 2.f);
+        boxes[n * W + i] = box3f(lower, lower + vec3f(1.f));
+        nodes[n].lower.x[i] = lower.x;
+        nodes[n].lower.y[i] = lower.y;
+        nodes[n].lower.z[i] = lower.z;
+        nodes[n].upper.x[i] = lower.x + 1.f;
+        nodes[n].upper.y[i] = lower.y + 1.f;
+        nodes[n].upper.z[i] = lower.z + 1.f;
+      }
+    }
+  }
+};
+
+static const Scene &scene()
+{
+  static Scene s;
+  return s;
+}
+
+static const vec3f org(-1.f, .1f, .2f);
+static const vec3f dir(1.f, .05f, -.02f);
+
+// one intersectRayBox(org, dir, box) per box
+static void scalarPerBox(State &state)
+{
+  while (state.keepRunning()) {
+    int hits = 0;
+    for (const auto &b : scene().boxes)
+      hits += !intersectRayBox(org, dir, b).empty();
+    doNotOptimize(hits);
+  }
+  state.setItemsProcessed(state.iterations() * numNodes * W);
+}
+
+// the reciprocal direction computed once per ray
+static void scalarRayInvDir(State &state)
+{
+  const RayInvDir3f ray(org, dir);
+  while (state.keepRunning()) {
+    int hits = 0;
+    for (const auto &b : scene().boxes)
+      hits += !intersectRayBox(ray, b).empty();
+    doNotOptimize(hits);
+  }
+  state.setItemsProcessed(state.iterations() * numNodes * W);
+}
+
+// one ray against the W children of each node at once
+static void packetPerNode(State &state)
+{
+  const RayInvDir3f ray(org, dir);
+  while (state.keepRunning()) {
+    int hits = 0;
+    for (const auto &n : scene().nodes)
+      hits += popcnt(intersectRayBox(ray, n).hit);
+    doNotOptimize(hits);
+  }
+  state.setItemsProcessed(state.iterations() * numNodes * W);
+}
+
+RKCOMMON_BENCHMARK("intersectRayBox/scalar", scalarPerBox);
+RKCOMMON_BENCHMARK("intersectRayBox/scalar_RayInvDir", scalarRayInvDir);
+RKCOMMON_BENCHMARK("intersectRayBox/packet", packetPerNode);
@@ -0,0 +1,73 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/morton.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static const size_t numPoints = 1 << 20;
+
+static const box3f bounds(vec3f(0.f), vec3f(1021.f, 509.f, 31.f));
+
+static std::vector<vec3f> &points()
+{
+  static std::vector<vec3f> p;
+  if (p.empty()) {
+    p.resize(numPoints);
+    for (size_t i = 0; i < numPoints; ++i)
+      p[i] = vec3f(i % 1021, i % 509, i % 31);
+  }
+  return p;
+}
+
+static std::vector<uint32_t> &codes()
+{
+  static std::vector<uint32_t> c(numPoints);
+  return c;
+}
+
+// One quantize() and mortonEncode() call per point
+static void scalarLoop(State &state)
+{
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numPoints; ++i)
+      codes()[i] = mortonEncode(quantize(points()[i], bounds, 10));
+    doNotOptimize(codes().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numPoints);
+}
+
+template <bool PARALLEL>
+static void batched(State &state)
+{
+  while (state.keepRunning()) {
+    mortonCodes(bounds, points().data(), codes().data(), numPoints, PARALLEL);
+    doNotOptimize(codes().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numPoints);
+}
+
+// One hilbertEncode() per point, for comparison with the Morton order
+static void hilbert(State &state)
+{
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numPoints; ++i)
+      codes()[i] = hilbertEncode(quantize(points()[i], bounds, 10));
+    doNotOptimize(codes().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numPoints);
+}
+
+RKCOMMON_BENCHMARK("mortonCodes/scalar_loop", scalarLoop);
+RKCOMMON_BENCHMARK("mortonCodes/batched", batched<false>);
+RKCOMMON_BENCHMARK("mortonCodes/batched_parallel", batched<true>);
+RKCOMMON_BENCHMARK("mortonCodes/hilbert_loop", hilbert);
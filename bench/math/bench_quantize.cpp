@@ -0,0 +1,110 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/quantize.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static const size_t numPoints = 1 << 20;
+
+static const box3f bounds(vec3f(0.f), vec3f(1021.f, 509.f, 31.f));
+
+static const QuantizationDomain<uint16_t> quantization(bounds);
+
+static std::vector<vec3f> &points()
+{
+  static std::vector<vec3f> p;
+  if (p.empty()) {
+    p.resize(numPoints);
+    for (size_t i = 0; i < numPoints; ++i)
+      p[i] = vec3f(i % 1021, i % 509, i % 31);
+  }
+  return p;
+}
+
+static std::vector<QuantizedVec3us> &quantized()
+{
+  static std::vector<QuantizedVec3us> q;
+  if (q.empty()) {
+    q.resize(numPoints);
+    quantization.quantize(points().data(), q.data(), numPoints);
+  }
+  return q;
+}
+
+static std::vector<vec3f> &output()
+{
+  static std::vector<vec3f> o(numPoints);
+  return o;
+}
+
+// What reading uncompressed positions costs
+static void copyFloat(State &state)
+{
+  while (state.keepRunning()) {
+    std::copy(points().begin(), points().end(), output().begin());
+    doNotOptimize(output().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numPoints);
+}
+
+static void quantizeBulk(State &state)
+{
+  while (state.keepRunning()) {
+    quantization.quantize(
+        points().data(), quantized().data(), numPoints, false);
+    doNotOptimize(quantized().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numPoints);
+}
+
+// One dequantize() call per point
+static void dequantizeLoop(State &state)
+{
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numPoints; ++i)
+      output()[i] = quantization.dequantize(quantized()[i]);
+    doNotOptimize(output().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numPoints);
+}
+
+template <bool PARALLEL>
+static void dequantizeBulk(State &state)
+{
+  while (state.keepRunning()) {
+    quantization.dequantize(
+        quantized().data(), output().data(), numPoints, PARALLEL);
+    doNotOptimize(output().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numPoints);
+}
+
+static void decodeNormals(State &state)
+{
+  std::vector<vec2s> encoded(numPoints);
+  encodeOctahedral(points().data(), encoded.data(), numPoints);
+  while (state.keepRunning()) {
+    decodeOctahedral(encoded.data(), output().data(), numPoints, false);
+    doNotOptimize(output().data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numPoints);
+}
+
+RKCOMMON_BENCHMARK("quantize/copy_vec3f", copyFloat);
+RKCOMMON_BENCHMARK("quantize/quantize_bulk", quantizeBulk);
+RKCOMMON_BENCHMARK("quantize/dequantize_loop", dequantizeLoop);
+RKCOMMON_BENCHMARK("quantize/dequantize_bulk", dequantizeBulk<false>);
+RKCOMMON_BENCHMARK("quantize/dequantize_parallel", dequantizeBulk<true>);
+RKCOMMON_BENCHMARK("quantize/decode_octahedral", decodeNormals);
@@ -0,0 +1,118 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/quaternionArray.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static const size_t numQuaternions = 1 << 18;
+
+struct Streams
+{
+  Streams()
+      : r(numQuaternions),
+        i(numQuaternions),
+        j(numQuaternions),
+        k(numQuaternions)
+  {
+  }
+
+  QuaternionStreams streams()
+  {
+    return QuaternionStreams(r.data(), i.data(), j.data(), k.data());
+  }
+
+  std::vector<float> r, i, j, k;
+};
+
+static Streams &keys(int which)
+{
+  static Streams s[3];
+  static bool initialized = false;
+  if (!initialized) {
+    for (size_t idx = 0; idx < numQuaternions; ++idx) {
+      const vec3f axis(1.f, float(idx % 5), 2.f);
+      const quatf a = quatf::rotate(axis, .01f * (idx % 311));
+      const quatf b = quatf::rotate(axis, -.02f * (idx % 173));
+      s[0].r[idx] = a.r;
+      s[0].i[idx] = a.i;
+      s[0].j[idx] = a.j;
+      s[0].k[idx] = a.k;
+      s[1].r[idx] = b.r;
+      s[1].i[idx] = b.i;
+      s[1].j[idx] = b.j;
+      s[1].k[idx] = b.k;
+    }
+    initialized = true;
+  }
+  return s[which];
+}
+
+// One scalar slerp() call per quaternion
+static void scalarLoop(State &state)
+{
+  const QuaternionStreams a = keys(0).streams();
+  const QuaternionStreams b = keys(1).streams();
+  const QuaternionStreams out = keys(2).streams();
+
+  while (state.keepRunning()) {
+    for (size_t idx = 0; idx < numQuaternions; ++idx) {
+      const quatf q = slerp(.3f, a[idx], b[idx]);
+      out.r[idx] = q.r;
+      out.i[idx] = q.i;
+      out.j[idx] = q.j;
+      out.k[idx] = q.k;
+    }
+    doNotOptimize(out.r);
+  }
+
+  state.setItemsProcessed(state.iterations() * numQuaternions);
+}
+
+template <MathPrecision P>
+static void batched(State &state)
+{
+  while (state.keepRunning()) {
+    slerp(.3f,
+          keys(0).streams(),
+          keys(1).streams(),
+          keys(2).streams(),
+          numQuaternions,
+          P,
+          false);
+    doNotOptimize(keys(2).r.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numQuaternions);
+}
+
+template <MathPrecision P>
+static void batchedNlerp(State &state)
+{
+  while (state.keepRunning()) {
+    nlerp(.3f,
+          keys(0).streams(),
+          keys(1).streams(),
+          keys(2).streams(),
+          numQuaternions,
+          P,
+          false);
+    doNotOptimize(keys(2).r.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numQuaternions);
+}
+
+RKCOMMON_BENCHMARK("slerp/scalar_loop", scalarLoop);
+RKCOMMON_BENCHMARK("slerp/batched", batched<MathPrecision::Accurate>);
+RKCOMMON_BENCHMARK("slerp/batched_fast", batched<MathPrecision::Fast>);
+RKCOMMON_BENCHMARK("slerp/batched_nlerp",
+                   batchedNlerp<MathPrecision::Accurate>);
+RKCOMMON_BENCHMARK("slerp/batched_nlerp_fast",
+                   batchedNlerp<MathPrecision::Fast>);
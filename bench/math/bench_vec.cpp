@@ -0,0 +1,123 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/vec.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+// small enough to stay in L2, so the arithmetic is measured, not the memory
+static const size_t numVectors = 1 << 12;
+
+template <typename VEC>
+static const std::vector<VEC> &vectors()
+{
+  static const std::vector<VEC> v = []() {
+    std::vector<VEC> v(numVectors);
+    for (size_t i = 0; i < numVectors; ++i)
+      v[i] = VEC(float(i % 7) + .5f, float(i % 5) - 2.f, float(i % 3) + 1.f);
+    return v;
+  }();
+  return v;
+}
+
+template <>
+const std::vector<vec4f> &vectors<vec4f>()
+{
+  static const std::vector<vec4f> v = []() {
+    std::vector<vec4f> v(numVectors);
+    for (size_t i = 0; i < numVectors; ++i) {
+      v[i] = vec4f(
+          float(i % 7) + .5f, float(i % 5) - 2.f, float(i % 3) + 1.f, 1.f);
+    }
+    return v;
+  }();
+  return v;
+}
+
+// a * b + c per element, as in shading and integrators
+template <typename VEC>
+static void madd(State &state)
+{
+  const std::vector<VEC> &a = vectors<VEC>();
+  std::vector<VEC> out(numVectors);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numVectors; ++i)
+      out[i] = a[i] * a[numVectors - 1 - i] + a[i];
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numVectors);
+}
+
+RKCOMMON_BENCHMARK("vec/madd/vec3f", madd<vec3f>);
+RKCOMMON_BENCHMARK("vec/madd/vec3fa", madd<vec3fa>);
+RKCOMMON_BENCHMARK("vec/madd/vec4f", madd<vec4f>);
+
+// the sum of dot products, a dependent chain through the accumulator
+template <typename VEC>
+static void dotSum(State &state)
+{
+  const std::vector<VEC> &a = vectors<VEC>();
+
+  while (state.keepRunning()) {
+    float sum = 0.f;
+    for (size_t i = 0; i < numVectors; ++i)
+      sum += dot(a[i], a[numVectors - 1 - i]);
+    doNotOptimize(sum);
+  }
+
+  state.setItemsProcessed(state.iterations() * numVectors);
+}
+
+RKCOMMON_BENCHMARK("vec/dot/vec3f", dotSum<vec3f>);
+RKCOMMON_BENCHMARK("vec/dot/vec3fa", dotSum<vec3fa>);
+RKCOMMON_BENCHMARK("vec/dot/vec4f", dotSum<vec4f>);
+
+// normalize(cross(a, b)), as for geometric normals
+template <typename VEC>
+static void crossNormalize(State &state)
+{
+  const std::vector<VEC> &a = vectors<VEC>();
+  std::vector<VEC> out(numVectors);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numVectors; ++i)
+      out[i] = normalize(cross(a[i], a[numVectors - 1 - i] + VEC(1.f)));
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numVectors);
+}
+
+RKCOMMON_BENCHMARK("vec/cross_normalize/vec3f", crossNormalize<vec3f>);
+RKCOMMON_BENCHMARK("vec/cross_normalize/vec3fa", crossNormalize<vec3fa>);
+
+// component-wise min/max reductions, as when computing bounds
+template <typename VEC>
+static void minMax(State &state)
+{
+  const std::vector<VEC> &a = vectors<VEC>();
+
+  while (state.keepRunning()) {
+    VEC lo(pos_inf), hi(neg_inf);
+    for (size_t i = 0; i < numVectors; ++i) {
+      lo = min(lo, a[i]);
+      hi = max(hi, a[i]);
+    }
+    doNotOptimize(lo);
+    doNotOptimize(hi);
+  }
+
+  state.setItemsProcessed(state.iterations() * numVectors);
+}
+
+RKCOMMON_BENCHMARK("vec/min_max/vec3f", minMax<vec3f>);
+RKCOMMON_BENCHMARK("vec/min_max/vec3fa", minMax<vec3fa>);
+RKCOMMON_BENCHMARK("vec/min_max/vec4f", minMax<vec4f>);
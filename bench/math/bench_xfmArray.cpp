@@ -0,0 +1,185 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/xfmArray.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+
+static const size_t numPoints = 1 << 20;
+
+static const AffineSpace3f &transform()
+{
+  static const AffineSpace3f xfm =
+      AffineSpace3f::translate(vec3f(1.f, 2.f, 3.f)) *
+      AffineSpace3f::rotate(vec3f(0.f, 1.f, 0.f), .5f);
+  return xfm;
+}
+
+static std::vector<vec3f> &points()
+{
+  static std::vector<vec3f> p(numPoints, vec3f(1.f, 2.f, 3.f));
+  return p;
+}
+
+// One xfmPoint() call per point, extending the bounds as it goes
+static void scalarLoop(State &state)
+{
+  std::vector<vec3f> out(numPoints);
+
+  while (state.keepRunning()) {
+    box3f bounds(empty);
+    for (size_t i = 0; i < numPoints; ++i) {
+      out[i] = xfmPoint(transform(), points()[i]);
+      bounds.extend(out[i]);
+    }
+    doNotOptimize(bounds);
+  }
+
+  state.setItemsProcessed(state.iterations() * numPoints);
+}
+
+template <bool PARALLEL>
+static void batched(State &state)
+{
+  std::vector<vec3f> out(numPoints);
+
+  while (state.keepRunning()) {
+    doNotOptimize(xfmPoints(
+        transform(), points().data(), out.data(), numPoints, PARALLEL));
+  }
+
+  state.setItemsProcessed(state.iterations() * numPoints);
+}
+
+RKCOMMON_BENCHMARK("xfmPoints/scalar_loop", scalarLoop);
+RKCOMMON_BENCHMARK("xfmPoints/batched", batched<false>);
+RKCOMMON_BENCHMARK("xfmPoints/batched_parallel", batched<true>);
+
+static const size_t numInstances = 1 << 16;
+
+static std::vector<AffineSpace3f> &instanceTransforms()
+{
+  static std::vector<AffineSpace3f> xfms;
+  if (xfms.empty()) {
+    xfms.resize(numInstances);
+    for (size_t i = 0; i < numInstances; ++i)
+      xfms[i] = AffineSpace3f::translate(vec3f(i % 97, i % 89, i % 83)) *
+                AffineSpace3f::rotate(vec3f(0.f, 1.f, 0.f), .01f * i);
+  }
+  return xfms;
+}
+
+// Eight xfmPoint() calls per instance, like xfmBounds() used to do
+static void instanceCorners(State &state)
+{
+  const box3f object(vec3f(-1.f), vec3f(1.f));
+  std::vector<box3f> out(numInstances);
+
+  while (state.keepRunning()) {
+    box3f bounds(empty);
+    for (size_t i = 0; i < numInstances; ++i) {
+      box3f b(empty);
+      for (int c = 0; c < 8; ++c) {
+        const vec3f corner(c & 1 ? object.upper.x : object.lower.x,
+                           c & 2 ? object.upper.y : object.lower.y,
+                           c & 4 ? object.upper.z : object.lower.z);
+        b.extend(xfmPoint(instanceTransforms()[i], corner));
+      }
+      out[i] = b;
+      bounds.extend(b);
+    }
+    doNotOptimize(bounds);
+  }
+
+  state.setItemsProcessed(state.iterations() * numInstances);
+}
+
+static void instanceLoop(State &state)
+{
+  const box3f object(vec3f(-1.f), vec3f(1.f));
+  std::vector<box3f> out(numInstances);
+
+  while (state.keepRunning()) {
+    box3f bounds(empty);
+    for (size_t i = 0; i < numInstances; ++i) {
+      out[i] = xfmBounds(instanceTransforms()[i], object);
+      bounds.extend(out[i]);
+    }
+    doNotOptimize(bounds);
+  }
+
+  state.setItemsProcessed(state.iterations() * numInstances);
+}
+
+template <bool PARALLEL>
+static void instanceBatched(State &state)
+{
+  const box3f object(vec3f(-1.f), vec3f(1.f));
+  std::vector<box3f> out(numInstances);
+
+  while (state.keepRunning()) {
+    doNotOptimize(xfmBounds(instanceTransforms().data(),
+                            utility::DataView<box3f>(&object, 0),
+                            out.data(),
+                            numInstances,
+                            PARALLEL));
+  }
+
+  state.setItemsProcessed(state.iterations() * numInstances);
+}
+
+RKCOMMON_BENCHMARK("xfmBounds/corners_loop", instanceCorners);
+RKCOMMON_BENCHMARK("xfmBounds/scalar_loop", instanceLoop);
+RKCOMMON_BENCHMARK("xfmBounds/batched", instanceBatched<false>);
+RKCOMMON_BENCHMARK("xfmBounds/batched_parallel", instanceBatched<true>);
+
+// One rcp() call per instance
+static void rcpLoop(State &state)
+{
+  std::vector<AffineSpace3f> out(numInstances);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numInstances; ++i)
+      out[i] = rcp(instanceTransforms()[i]);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numInstances);
+}
+
+template <bool PARALLEL>
+static void rcpBatched(State &state)
+{
+  std::vector<AffineSpace3f> out(numInstances);
+
+  while (state.keepRunning()) {
+    rcp(instanceTransforms().data(), out.data(), numInstances, PARALLEL);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numInstances);
+}
+
+static void rcpOrthonormalBatched(State &state)
+{
+  std::vector<AffineSpace3f> out(numInstances);
+
+  while (state.keepRunning()) {
+    rcpOrthonormal(
+        instanceTransforms().data(), out.data(), numInstances, false);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numInstances);
+}
+
+RKCOMMON_BENCHMARK("rcp/scalar_loop", rcpLoop);
+RKCOMMON_BENCHMARK("rcp/batched", rcpBatched<false>);
+RKCOMMON_BENCHMARK("rcp/batched_parallel", rcpBatched<true>);
+RKCOMMON_BENCHMARK("rcp/orthonormal_batched", rcpOrthonormalBatched);
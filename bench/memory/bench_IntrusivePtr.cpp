@@ -0,0 +1,100 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/memory/IntrusivePtr.h"
+// std
+#include <memory>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::memory;
+
+static const int numHandles = 1 << 12;
+
+template <typename COUNTER>
+struct Geometry : public BasicRefCountedObject<COUNTER>
+{
+  float value{1.f};
+};
+
+struct PlainGeometry
+{
+  float value{1.f};
+};
+
+// Copying a list of handles to distinct objects, as when a scene snapshot
+// takes references to its geometries; the copies are released at the end of
+// each iteration
+template <typename HANDLE, typename MAKE_FCN>
+static void copyList(State &state, MAKE_FCN &&make)
+{
+  std::vector<HANDLE> handles;
+  for (int i = 0; i < numHandles; ++i)
+    handles.push_back(make());
+
+  while (state.keepRunning()) {
+    std::vector<HANDLE> copies(handles);
+    doNotOptimize(copies.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numHandles);
+}
+
+template <typename COUNTER>
+static void copyIntrusive(State &state)
+{
+  copyList<IntrusivePtr<Geometry<COUNTER>>>(
+      state, []() { return make_intrusive<Geometry<COUNTER>>(); });
+}
+
+static void copyShared(State &state)
+{
+  copyList<std::shared_ptr<PlainGeometry>>(
+      state, []() { return std::make_shared<PlainGeometry>(); });
+}
+
+// the floor: the same list of raw pointers
+static void copyRaw(State &state)
+{
+  std::vector<std::unique_ptr<PlainGeometry>> owners;
+  copyList<PlainGeometry *>(state, [&]() {
+    owners.emplace_back(new PlainGeometry);
+    return owners.back().get();
+  });
+}
+
+RKCOMMON_BENCHMARK("IntrusivePtr/copy/atomic", copyIntrusive<AtomicRefCounter>);
+RKCOMMON_BENCHMARK("IntrusivePtr/copy/single_thread",
+                   copyIntrusive<SingleThreadRefCounter>);
+RKCOMMON_BENCHMARK("IntrusivePtr/copy/std_shared_ptr", copyShared);
+RKCOMMON_BENCHMARK("IntrusivePtr/copy/raw_pointer", copyRaw);
+
+// Creating and releasing objects, for the allocation and the counter setup
+template <typename COUNTER>
+static void makeIntrusive(State &state)
+{
+  while (state.keepRunning()) {
+    for (int i = 0; i < numHandles; ++i)
+      doNotOptimize(make_intrusive<Geometry<COUNTER>>()->value);
+  }
+
+  state.setItemsProcessed(state.iterations() * numHandles);
+}
+
+static void makeShared(State &state)
+{
+  while (state.keepRunning()) {
+    for (int i = 0; i < numHandles; ++i)
+      doNotOptimize(std::make_shared<PlainGeometry>()->value);
+  }
+
+  state.setItemsProcessed(state.iterations() * numHandles);
+}
+
+RKCOMMON_BENCHMARK("IntrusivePtr/make/atomic", makeIntrusive<AtomicRefCounter>);
+RKCOMMON_BENCHMARK("IntrusivePtr/make/single_thread",
+                   makeIntrusive<SingleThreadRefCounter>);
+RKCOMMON_BENCHMARK("IntrusivePtr/make/std_shared_ptr", makeShared);
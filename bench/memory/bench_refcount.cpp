@@ -0,0 +1,79 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/memory/RefCount.h"
+#include "rkcommon/tasking/parallel_for.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::memory;
+
+static const int copiesPerTask = 1 << 16;
+
+template <typename COUNTER>
+struct Primitive : public BasicRefCountedObject<COUNTER>
+{
+  float value{1.f};
+};
+
+// Handles copied into and out of an inner loop, as when gathering the
+// primitives of a leaf
+template <typename HANDLE, typename T>
+static float innerLoop(const Ref<T> &object)
+{
+  float sum = 0.f;
+  for (int i = 0; i < copiesPerTask; ++i) {
+    HANDLE copy(object);
+    sum += copy->value;
+    doNotOptimize(copy);
+  }
+  return sum;
+}
+
+// Every task copies handles to its own object
+template <typename COUNTER, typename HANDLE = Ref<Primitive<COUNTER>>>
+static void copyPerTask(State &state)
+{
+  const int numTasks = tasking::numTaskingThreads();
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(numTasks, [&](int) {
+      Ref<Primitive<COUNTER>> object(new Primitive<COUNTER>);
+      object->refDec();
+      doNotOptimize(innerLoop<HANDLE>(object));
+    });
+  }
+
+  state.setItemsProcessed(state.iterations() * numTasks * copiesPerTask);
+}
+
+RKCOMMON_BENCHMARK("refcount/atomic_per_task", copyPerTask<AtomicRefCounter>);
+RKCOMMON_BENCHMARK("refcount/biased_per_task", copyPerTask<BiasedRefCounter>);
+RKCOMMON_BENCHMARK("refcount/single_thread_per_task",
+                   copyPerTask<SingleThreadRefCounter>);
+
+// All tasks copy handles to one shared object, contending for its counter
+template <typename COUNTER, typename HANDLE = Ref<Primitive<COUNTER>>>
+static void copyShared(State &state)
+{
+  const int numTasks = tasking::numTaskingThreads();
+  Ref<Primitive<COUNTER>> object(new Primitive<COUNTER>);
+  object->refDec();
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(numTasks, [&](int) {
+      doNotOptimize(innerLoop<HANDLE>(object));
+    });
+  }
+
+  state.setItemsProcessed(state.iterations() * numTasks * copiesPerTask);
+}
+
+RKCOMMON_BENCHMARK("refcount/atomic_shared", copyShared<AtomicRefCounter>);
+RKCOMMON_BENCHMARK("refcount/biased_shared", copyShared<BiasedRefCounter>);
+RKCOMMON_BENCHMARK(
+    "refcount/view_shared",
+    (copyShared<AtomicRefCounter, RefView<Primitive<AtomicRefCounter>>>));
@@ -0,0 +1,52 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/memory/ScratchBuffer.h"
+#include "rkcommon/tasking/parallel_for.h"
+
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::memory;
+
+static const int numRows  = 1 << 12;
+static const int rowWidth = 1920;
+
+// A temporary row per task, the pattern of writeImage() and tiled kernels
+template <typename KERNEL>
+static void rows(State &state, KERNEL &&kernel)
+{
+  while (state.keepRunning())
+    tasking::parallel_for(numRows, kernel);
+
+  state.setItemsProcessed(state.iterations() * numRows);
+}
+
+static void fillRow(float *row, int y)
+{
+  for (int x = 0; x < rowWidth; ++x)
+    row[x] = float(x + y);
+  doNotOptimize(row[y % rowWidth]);
+}
+
+static void rowsHeap(State &state)
+{
+  rows(state, [](int y) {
+    std::vector<float> row(rowWidth);
+    fillRow(row.data(), y);
+  });
+}
+
+static void rowsScratch(State &state)
+{
+  rows(state, [](int y) {
+    ScratchScope scratch;
+    fillRow(scratch.allocate<float>(rowWidth), y);
+  });
+}
+
+RKCOMMON_BENCHMARK("scratch/row_heap", rowsHeap);
+RKCOMMON_BENCHMARK("scratch/row_scratch", rowsScratch);
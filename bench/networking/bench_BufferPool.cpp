@@ -0,0 +1,78 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/networking/BufferPool.h"
+#include "rkcommon/networking/DataStreaming.h"
+// std
+#include <cstring>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::networking;
+
+// a message of a few small fields, as frame updates send many of
+static const int numFields = 64;
+
+static void writeMessageFresh(State &state)
+{
+  while (state.keepRunning()) {
+    BufferWriter writer;
+    for (int i = 0; i < numFields; i++)
+      writer << i << float(i);
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numFields);
+}
+
+static void writeMessagePooled(State &state)
+{
+  BufferPool pool;
+
+  while (state.keepRunning()) {
+    BufferWriter writer(pool);
+    for (int i = 0; i < numFields; i++)
+      writer << i << float(i);
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numFields);
+}
+
+// receive buffers of varying sizes up to 1MB, filled as recv() does
+static const size_t recvSizes[] = {
+    4 << 10, 300 << 10, 1 << 20, 40 << 10, 600 << 10};
+
+static void recvBufferFresh(State &state)
+{
+  size_t i = 0;
+  while (state.keepRunning()) {
+    auto buf = std::make_shared<utility::OwnedArray<uint8_t>>();
+    buf->resize(recvSizes[i++ % 5]);
+    std::memset(buf->data(), 1, buf->size());
+    doNotOptimize(buf->data());
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+
+static void recvBufferPooled(State &state)
+{
+  BufferPool pool;
+
+  size_t i = 0;
+  while (state.keepRunning()) {
+    auto buf = pool.acquire(recvSizes[i++ % 5]);
+    std::memset(buf->data(), 1, buf->size());
+    doNotOptimize(buf->data());
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+
+RKCOMMON_BENCHMARK("BufferPool/writeMessage/fresh", writeMessageFresh);
+RKCOMMON_BENCHMARK("BufferPool/writeMessage/pooled", writeMessagePooled);
+RKCOMMON_BENCHMARK("BufferPool/recvBuffer/fresh", recvBufferFresh);
+RKCOMMON_BENCHMARK("BufferPool/recvBuffer/pooled", recvBufferPooled);
@@ -0,0 +1,92 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/networking/Checksum.h"
+// std
+#include <cstring>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::networking;
+
+// a 1 MiB payload, as items of 1 byte
+static const size_t payloadSize = size_t(1) << 20;
+
+static std::vector<uint8_t> makePayload()
+{
+  std::vector<uint8_t> payload(payloadSize);
+  for (size_t i = 0; i < payload.size(); i++)
+    payload[i] = uint8_t(i * 131 + (i >> 10));
+  return payload;
+}
+
+static void crc32cPayload(State &state)
+{
+  const std::vector<uint8_t> payload = makePayload();
+
+  while (state.keepRunning())
+    doNotOptimize(crc32c(payload.data(), payload.size()));
+
+  state.setItemsProcessed(state.iterations() * payloadSize);
+}
+
+// serializing the payload in 4 KiB writes, without and with the checksum
+static void writePayload(State &state)
+{
+  const std::vector<uint8_t> payload = makePayload();
+  BufferWriter writer;
+  writer.reserve(payloadSize);
+
+  while (state.keepRunning()) {
+    writer.clear();
+    for (size_t i = 0; i < payloadSize; i += 4096)
+      writer.write(payload.data() + i, 4096);
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * payloadSize);
+}
+
+static void writePayloadChecksummed(State &state)
+{
+  const std::vector<uint8_t> payload = makePayload();
+  BufferWriter writer;
+  writer.reserve(payloadSize + sizeof(uint32_t));
+
+  while (state.keepRunning()) {
+    writer.clear();
+    ChecksummingWriteStream checksummed(writer);
+    for (size_t i = 0; i < payloadSize; i += 4096)
+      checksummed.write(payload.data() + i, 4096);
+    checksummed.writeChecksum();
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * payloadSize);
+}
+
+// hashing the written buffer in a second pass instead
+static void writePayloadThenChecksum(State &state)
+{
+  const std::vector<uint8_t> payload = makePayload();
+  BufferWriter writer;
+  writer.reserve(payloadSize + sizeof(uint32_t));
+
+  while (state.keepRunning()) {
+    writer.clear();
+    for (size_t i = 0; i < payloadSize; i += 4096)
+      writer.write(payload.data() + i, 4096);
+    writer << crc32c(writer.buffer->data(), writer.buffer->size());
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * payloadSize);
+}
+
+RKCOMMON_BENCHMARK("Checksum/crc32c/1MiB", crc32cPayload);
+RKCOMMON_BENCHMARK("Checksum/write/plain", writePayload);
+RKCOMMON_BENCHMARK("Checksum/write/checksummed", writePayloadChecksummed);
+RKCOMMON_BENCHMARK("Checksum/write/secondPass", writePayloadThenChecksum);
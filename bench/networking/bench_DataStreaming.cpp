@@ -0,0 +1,229 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/vec.h"
+#include "rkcommon/networking/CompressedStream.h"
+#include "rkcommon/networking/DataStreaming.h"
+// std
+#include <string>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+using namespace rkcommon::networking;
+
+static const size_t numVertices = 1 << 20;
+
+static void writeVector(State &state)
+{
+  const std::vector<vec3f> vertices(numVertices, vec3f(1.f, 2.f, 3.f));
+
+  while (state.keepRunning()) {
+    BufferWriter writer;
+    writer << vertices;
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numVertices);
+}
+
+static void readVector(State &state)
+{
+  BufferWriter writer;
+  writer << std::vector<vec3f>(numVertices, vec3f(1.f, 2.f, 3.f));
+
+  while (state.keepRunning()) {
+    BufferReader reader(writer.buffer);
+    std::vector<vec3f> vertices;
+    reader >> vertices;
+    doNotOptimize(vertices.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numVertices);
+}
+
+// a frame of many small fields, as scene updates are
+static const int numFields = 1 << 16;
+
+static void writeSmallFields(State &state)
+{
+  while (state.keepRunning()) {
+    BufferWriter writer;
+    for (int i = 0; i < numFields; i++)
+      writer << i << float(i);
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numFields);
+}
+
+static void writeSmallFieldsPooled(State &state)
+{
+  auto pooled = std::make_shared<utility::OwnedArray<uint8_t>>();
+
+  while (state.keepRunning()) {
+    BufferWriter writer(pooled);
+    for (int i = 0; i < numFields; i++)
+      writer << i << float(i);
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numFields);
+}
+
+// the same fields into a FixedBufferWriter of the size they need
+static void writeSmallFieldsFixed(State &state)
+{
+  const size_t size = numFields * (sizeof(int) + sizeof(float));
+
+  while (state.keepRunning()) {
+    FixedBufferWriter writer(size);
+    for (int i = 0; i < numFields; i++)
+      writer << i << float(i);
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numFields);
+}
+
+// non-POD vectors go element by element: names of scene objects
+static const int numNames = 1 << 16;
+
+static std::vector<std::string> makeNames()
+{
+  std::vector<std::string> names(numNames);
+  for (int i = 0; i < numNames; i++)
+    names[i] = "geometry_instance_" + std::to_string(i);
+  return names;
+}
+
+static void writeStrings(State &state)
+{
+  const std::vector<std::string> names = makeNames();
+
+  while (state.keepRunning()) {
+    BufferWriter writer;
+    writer << names;
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numNames);
+}
+
+static void readStrings(State &state)
+{
+  BufferWriter writer;
+  writer << makeNames();
+
+  while (state.keepRunning()) {
+    BufferReader reader(writer.buffer);
+    std::vector<std::string> names;
+    reader >> names;
+    doNotOptimize(names.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numNames);
+}
+
+// the triangle indices of a grid mesh, packed as signed deltas
+static std::vector<uint32_t> makeIndices()
+{
+  const uint32_t n = 1024;
+  std::vector<uint32_t> indices;
+  for (uint32_t y = 0; y + 1 < n; y++) {
+    for (uint32_t x = 0; x + 1 < n; x++) {
+      const uint32_t i = y * n + x;
+      for (uint32_t v : {i, i + 1, i + n, i + 1, i + n + 1, i + n})
+        indices.push_back(v);
+    }
+  }
+  return indices;
+}
+
+static void writePackedIndices(State &state)
+{
+  const auto indices = makeIndices();
+  auto pooled        = std::make_shared<utility::OwnedArray<uint8_t>>();
+
+  while (state.keepRunning()) {
+    BufferWriter writer(pooled);
+    writePacked(writer, indices, PackedCoding::SIGNED_DELTA);
+    doNotOptimize(writer.buffer->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * indices.size());
+}
+
+static void readPackedIndices(State &state)
+{
+  const auto indices = makeIndices();
+  BufferWriter writer;
+  writePacked(writer, indices, PackedCoding::SIGNED_DELTA);
+
+  std::vector<uint32_t> decoded;
+  while (state.keepRunning()) {
+    BufferReader reader(writer.buffer);
+    readPacked(reader, decoded, PackedCoding::SIGNED_DELTA);
+    doNotOptimize(decoded.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * indices.size());
+}
+
+// a grid of vertices, compressed in the default 256 KiB blocks
+static std::shared_ptr<utility::OwnedArray<uint8_t>> makeGrid()
+{
+  std::vector<vec3f> vertices;
+  for (size_t i = 0; i < numVertices; i++)
+    vertices.emplace_back(float(i % 1024), float(i / 1024), 0.f);
+
+  BufferWriter writer;
+  writer << vertices;
+  return writer.buffer;
+}
+
+template <StreamCompression COMPRESSION>
+static void compress(State &state)
+{
+  auto grid = makeGrid();
+
+  while (state.keepRunning()) {
+    auto packed = compressBuffer(*grid, COMPRESSION);
+    doNotOptimize(packed->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * grid->size());
+}
+
+static void decompress(State &state)
+{
+  auto grid   = makeGrid();
+  auto packed = compressBuffer(*grid);
+
+  while (state.keepRunning()) {
+    auto unpacked = decompressBuffer(*packed);
+    doNotOptimize(unpacked->data());
+  }
+
+  state.setItemsProcessed(state.iterations() * grid->size());
+}
+
+RKCOMMON_BENCHMARK("DataStreaming/write_vector_vec3f", writeVector);
+RKCOMMON_BENCHMARK("DataStreaming/read_vector_vec3f", readVector);
+RKCOMMON_BENCHMARK("DataStreaming/write_small_fields", writeSmallFields);
+RKCOMMON_BENCHMARK("DataStreaming/write_small_fields_pooled",
+                   writeSmallFieldsPooled);
+RKCOMMON_BENCHMARK("DataStreaming/write_small_fields_fixed",
+                   writeSmallFieldsFixed);
+RKCOMMON_BENCHMARK("DataStreaming/write_vector_string", writeStrings);
+RKCOMMON_BENCHMARK("DataStreaming/read_vector_string", readStrings);
+RKCOMMON_BENCHMARK("DataStreaming/compress_lz4",
+                   compress<StreamCompression::LZ4>);
+RKCOMMON_BENCHMARK("DataStreaming/compress_lz4_high",
+                   compress<StreamCompression::LZ4_HIGH>);
+RKCOMMON_BENCHMARK("DataStreaming/decompress_lz4", decompress);
+RKCOMMON_BENCHMARK("DataStreaming/write_packed_indices", writePackedIndices);
+RKCOMMON_BENCHMARK("DataStreaming/read_packed_indices", readPackedIndices);
@@ -0,0 +1,174 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _WIN32
+
+#include "../Benchmark.h"
+
+#include "rkcommon/networking/SharedMemoryFabric.h"
+#include "rkcommon/networking/SocketFabric.h"
+#include "rkcommon/utility/OwnedArray.h"
+// std
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::networking;
+
+// What the root asks the worker for: receive 'count' messages of 'size'
+// bytes, then answer with the header; a 'size' of STOP ends the worker
+struct Header
+{
+  uint32_t count;
+  uint32_t size;
+};
+
+static const uint32_t STOP = ~0u;
+
+static std::shared_ptr<utility::OwnedArray<uint8_t>> makeMessage(size_t size)
+{
+  auto message = std::make_shared<utility::OwnedArray<uint8_t>>();
+  message->resize(size);
+  std::memset(message->data(), 1, size);
+  return message;
+}
+
+static void sendHeader(Fabric &fabric, const Header &header, int rank)
+{
+  auto message = makeMessage(sizeof(Header));
+  std::memcpy(message->data(), &header, sizeof(Header));
+  fabric.send(message, rank);
+}
+
+static Header recvHeader(Fabric &fabric, int rank)
+{
+  utility::OwnedArray<uint8_t> message;
+  message.resize(sizeof(Header));
+  fabric.recv(message, rank);
+  Header header;
+  std::memcpy(&header, message.data(), sizeof(Header));
+  return header;
+}
+
+// A root and a worker in two threads of this process
+struct Loopback
+{
+  Loopback(std::shared_ptr<Fabric> _root, std::shared_ptr<Fabric> _worker)
+      : root(_root), workerFabric(_worker)
+  {
+    worker = std::thread([this]() {
+      utility::OwnedArray<uint8_t> buffer;
+      while (true) {
+        const Header header = recvHeader(*workerFabric, 0);
+        if (header.size == STOP)
+          break;
+        buffer.resize(header.size);
+        for (uint32_t i = 0; i < header.count; ++i)
+          workerFabric->recv(buffer, 0);
+        sendHeader(*workerFabric, header, 0);
+      }
+    });
+  }
+
+  ~Loopback()
+  {
+    sendHeader(*root, {0, STOP}, 1);
+    worker.join();
+  }
+
+  // send the messages and wait for the worker to have received them
+  void roundTrip(uint32_t count,
+                 const std::shared_ptr<utility::OwnedArray<uint8_t>> &message)
+  {
+    sendHeader(*root, {count, uint32_t(message ? message->size() : 0)}, 1);
+    for (uint32_t i = 0; i < count; ++i)
+      root->send(message, 1);
+    recvHeader(*root, 1);
+  }
+
+  std::shared_ptr<Fabric> root;
+  std::shared_ptr<Fabric> workerFabric;
+  std::thread worker;
+};
+
+static std::unique_ptr<Loopback> socketLoopback(const std::string &address)
+{
+  SocketListener listener(address);
+  std::shared_ptr<Fabric> worker;
+  std::thread connecting([&]() {
+    worker = SocketFabric::connect(listener.address(), 1);
+  });
+  std::shared_ptr<Fabric> root = listener.accept(1);
+  connecting.join();
+  return rkcommon::make_unique<Loopback>(root, worker);
+}
+
+static std::unique_ptr<Loopback> tcpLoopback()
+{
+  return socketLoopback("127.0.0.1:0");
+}
+
+static std::unique_ptr<Loopback> unixLoopback()
+{
+  return socketLoopback("unix:/tmp/rkcommon_bench_fabric_"
+                        + std::to_string(getpid()));
+}
+
+static std::unique_ptr<Loopback> sharedMemoryLoopback()
+{
+  static std::atomic<int> segments{0};
+  const std::string name = "/rkcommon_bench_fabric_"
+      + std::to_string(getpid()) + "_" + std::to_string(segments++);
+  auto root   = std::make_shared<SharedMemoryFabric>(name, 0, 2);
+  auto worker = std::make_shared<SharedMemoryFabric>(name, 1, 2);
+  return rkcommon::make_unique<Loopback>(root, worker);
+}
+
+// Streaming 1 MiB messages to the worker, in MB per second
+static const uint32_t messagesPerIteration = 16;
+static const size_t messageSize            = size_t(1) << 20;
+
+template <std::unique_ptr<Loopback> (*MAKE_LOOPBACK)()>
+static void bandwidth(State &state)
+{
+  std::unique_ptr<Loopback> loopback = MAKE_LOOPBACK();
+  const auto message                 = makeMessage(messageSize);
+
+  const auto start = std::chrono::steady_clock::now();
+  while (state.keepRunning())
+    loopback->roundTrip(messagesPerIteration, message);
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  const double megabytes =
+      double(state.iterations()) * messagesPerIteration * messageSize / 1e6;
+  state.setItemsProcessed(state.iterations() * messagesPerIteration);
+  state.setCounter("MB_per_s", megabytes / seconds);
+}
+
+// The round trip of a header to the worker and back
+template <std::unique_ptr<Loopback> (*MAKE_LOOPBACK)()>
+static void latency(State &state)
+{
+  std::unique_ptr<Loopback> loopback = MAKE_LOOPBACK();
+
+  while (state.keepRunning())
+    loopback->roundTrip(0, nullptr);
+
+  state.setItemsProcessed(state.iterations());
+}
+
+RKCOMMON_BENCHMARK("Fabric/bandwidth/tcp", bandwidth<tcpLoopback>);
+RKCOMMON_BENCHMARK("Fabric/bandwidth/unix", bandwidth<unixLoopback>);
+RKCOMMON_BENCHMARK("Fabric/bandwidth/shared_memory",
+                   bandwidth<sharedMemoryLoopback>);
+RKCOMMON_BENCHMARK("Fabric/latency/tcp", latency<tcpLoopback>);
+RKCOMMON_BENCHMARK("Fabric/latency/unix", latency<unixLoopback>);
+RKCOMMON_BENCHMARK("Fabric/latency/shared_memory",
+                   latency<sharedMemoryLoopback>);
+
+#endif
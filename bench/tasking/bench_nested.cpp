@@ -0,0 +1,141 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/tasking/parallel_for.h"
+#include "rkcommon/tasking/parallel_reduce.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+// std
+#include <algorithm>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+
+// Outer loop over tiles (e.g. images or meshes), each running its own inner
+// parallel loop
+static void nestedParallelFor(State &state)
+{
+  const int outer = 16;
+  const int inner = 4096;
+  std::vector<float> out(outer * inner);
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(outer, [&](int o) {
+      tasking::parallel_for(inner, [&](int i) {
+        float x = float(i);
+        for (int k = 0; k < 16; ++k)
+          x = x * 0.999f + 1.f;
+        out[o * inner + i] = x;
+      });
+    });
+  }
+
+  doNotOptimize(out.data());
+  state.setItemsProcessed(state.iterations() * outer * inner);
+}
+
+RKCOMMON_BENCHMARK("nested/parallel_for_16x4096", nestedParallelFor);
+
+// Many small outer iterations whose inner loops are too short to be worth
+// splitting; measures the overhead of nesting itself
+static void nestedSmallInner(State &state)
+{
+  const int outer = 4096;
+  const int inner = 8;
+  std::vector<float> out(outer * inner);
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(outer, [&](int o) {
+      tasking::parallel_for(inner, [&](int i) {
+        out[o * inner + i] = float(o) * 0.5f + float(i);
+      });
+    });
+  }
+
+  doNotOptimize(out.data());
+  state.setItemsProcessed(state.iterations() * outer * inner);
+}
+
+RKCOMMON_BENCHMARK("nested/parallel_for_4096x8", nestedSmallInner);
+
+// Three levels with irregular cost per outer iteration (e.g. scenes with
+// differently sized objects), reducing at the innermost level
+static void nestedThreeLevels(State &state)
+{
+  const int scenes = 8;
+  const int objects = 32;
+  std::vector<float> out(scenes * objects);
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(scenes, [&](int s) {
+      tasking::parallel_for(objects, [&](int o) {
+        const int prims = 256 * (1 + (s * objects + o) % 7);
+        out[s * objects + o] = tasking::parallel_reduce(
+            prims,
+            0.f,
+            [&](int p) { return float(p % 13) * 0.25f; },
+            [](float a, float b) { return a + b; });
+      });
+    });
+  }
+
+  doNotOptimize(out.data());
+  state.setItemsProcessed(state.iterations() * scenes * objects);
+}
+
+RKCOMMON_BENCHMARK("nested/parallel_reduce_8x32xN", nestedThreeLevels);
+
+// Mandelbrot rows: realistic, irregular per-index costs which reward load
+// balancing; run for each thread count this gives a scaling curve
+static void mandelbrot(State &state)
+{
+  const int width = 256, height = 256, maxIter = 256;
+  std::vector<int> image(width * height);
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(height, [&](int y) {
+      for (int x = 0; x < width; ++x) {
+        const float cr = -2.f + 2.5f * x / width;
+        const float ci = -1.25f + 2.5f * y / height;
+        float zr = 0.f, zi = 0.f;
+        int n    = 0;
+        while (n < maxIter && zr * zr + zi * zi < 4.f) {
+          const float t = zr * zr - zi * zi + cr;
+          zi            = 2.f * zr * zi + ci;
+          zr            = t;
+          ++n;
+        }
+        image[y * width + x] = n;
+      }
+    });
+  }
+
+  doNotOptimize(image.data());
+  state.setItemsProcessed(state.iterations() * width * height);
+  state.setCounter("num_tasking_threads", tasking::numTaskingThreads());
+}
+
+RKCOMMON_BENCHMARK("kernel/mandelbrot_256", mandelbrot);
+
+// Memory bound reduction over a large array
+static void sumReduce(State &state)
+{
+  const int n = 1 << 22;
+  std::vector<float> data(n, 1.f);
+
+  float sum = 0.f;
+  while (state.keepRunning()) {
+    sum = tasking::parallel_reduce(
+        n,
+        0.f,
+        [&](int i) { return data[i]; },
+        [](float a, float b) { return a + b; });
+  }
+
+  doNotOptimize(sum);
+  state.setItemsProcessed(state.iterations() * n);
+}
+
+RKCOMMON_BENCHMARK("kernel/parallel_reduce_sum_4M", sumReduce);
@@ -0,0 +1,133 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/tasking/parallel_for.h"
+// std
+#include <cmath>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+
+// A few dozen flops per index, small enough that scheduling costs show
+static inline float smallKernel(int i)
+{
+  float x = float(i) * 1e-6f;
+  for (int k = 0; k < 8; ++k)
+    x = x * 1.0001f + std::sqrt(x + 1.f);
+  return x;
+}
+
+// Cost of parallel_for() itself: the body only stores its index
+static void parallelForOverhead(State &state)
+{
+  const int n = 1 << 20;
+  std::vector<int> out(n);
+
+  while (state.keepRunning())
+    tasking::parallel_for(n, [&](int i) { out[i] = i; });
+
+  doNotOptimize(out.data());
+  state.setItemsProcessed(state.iterations() * n);
+}
+
+RKCOMMON_BENCHMARK("parallel_for/overhead_per_index", parallelForOverhead);
+
+// Fixed cost parallel_for() over a handful of indices, e.g. per-frame setup
+static void parallelForSmall(State &state)
+{
+  const int n = 64;
+  std::vector<float> out(n);
+
+  while (state.keepRunning())
+    tasking::parallel_for(n, [&](int i) { out[i] = smallKernel(i); });
+
+  doNotOptimize(out.data());
+  state.setItemsProcessed(state.iterations() * n);
+}
+
+RKCOMMON_BENCHMARK("parallel_for/launch_64", parallelForSmall);
+
+static void fineGrained(State &state)
+{
+  const int n = 1 << 18;
+  std::vector<float> out(n);
+
+  while (state.keepRunning())
+    tasking::parallel_for(n, [&](int i) { out[i] = smallKernel(i); });
+
+  doNotOptimize(out.data());
+  state.setItemsProcessed(state.iterations() * n);
+}
+
+RKCOMMON_BENCHMARK("parallel_for/fine_grained", fineGrained);
+
+template <int BLOCK_SIZE>
+static void inBlocksOf(State &state)
+{
+  const int n = 1 << 18;
+  std::vector<float> out(n);
+
+  while (state.keepRunning()) {
+    tasking::parallel_in_blocks_of<BLOCK_SIZE>(n, [&](int begin, int end) {
+      for (int i = begin; i < end; ++i)
+        out[i] = smallKernel(i);
+    });
+  }
+
+  doNotOptimize(out.data());
+  state.setItemsProcessed(state.iterations() * n);
+}
+
+RKCOMMON_BENCHMARK("parallel_in_blocks_of/16", inBlocksOf<16>);
+RKCOMMON_BENCHMARK("parallel_in_blocks_of/256", inBlocksOf<256>);
+RKCOMMON_BENCHMARK("parallel_in_blocks_of/4096", inBlocksOf<4096>);
+
+// The loop of inBlocksOf() with the block size learned at runtime
+static void tunedBlocks(State &state)
+{
+  static tasking::TuningSlot slot("bench/parallel_for_range/tuned");
+
+  const int n = 1 << 18;
+  std::vector<float> out(n);
+
+  while (state.keepRunning()) {
+    tasking::parallel_for_range(0, n, slot, [&](int begin, int end) {
+      for (int i = begin; i < end; ++i)
+        out[i] = smallKernel(i);
+    });
+  }
+
+  doNotOptimize(out.data());
+  state.setItemsProcessed(state.iterations() * n);
+}
+
+RKCOMMON_BENCHMARK("parallel_for_range/tuned", tunedBlocks);
+
+/* The same loop over a working set which fits the combined L2 caches, run
+   again and again as by an iterative solver; with a hint each thread gets
+   back the part of the data it touched last time */
+template <bool HINT>
+static void repeatedSweep(State &state)
+{
+  const int n = 1 << 18;
+  std::vector<float> data(n, 1.f);
+  tasking::AffinityHint hint;
+
+  auto sweep = [&](int i) { data[i] = data[i] * 0.5f + smallKernel(i); };
+
+  while (state.keepRunning()) {
+    if (HINT)
+      tasking::parallel_for(n, hint, sweep);
+    else
+      tasking::parallel_for(n, sweep);
+  }
+
+  doNotOptimize(data.data());
+  state.setItemsProcessed(state.iterations() * n);
+}
+
+RKCOMMON_BENCHMARK("parallel_for/repeated_sweep", repeatedSweep<false>);
+RKCOMMON_BENCHMARK("parallel_for/repeated_sweep_affinity", repeatedSweep<true>);
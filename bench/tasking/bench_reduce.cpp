@@ -0,0 +1,61 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/tasking/parallel_reduce.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+
+static const int N_ELEMENTS = 1 << 22;
+
+static std::vector<float> values()
+{
+  std::vector<float> v(N_ELEMENTS);
+  for (int i = 0; i < N_ELEMENTS; ++i)
+    v[i] = float(i % 1000) * 1e-3f;
+  return v;
+}
+
+// Sum of a float array, grouped as the scheduling happens to go
+static void reduceSum(State &state)
+{
+  const std::vector<float> v = values();
+  float sum                  = 0.f;
+
+  while (state.keepRunning()) {
+    sum = tasking::parallel_reduce(
+        N_ELEMENTS,
+        0.f,
+        [&](int i) { return v[i]; },
+        [](float a, float b) { return a + b; });
+  }
+
+  doNotOptimize(sum);
+  state.setItemsProcessed(state.iterations() * N_ELEMENTS);
+}
+
+RKCOMMON_BENCHMARK("parallel_reduce/sum", reduceSum);
+
+// The same sum, reproducible for any number of threads
+static void reduceSumDeterministic(State &state)
+{
+  const std::vector<float> v = values();
+  float sum                  = 0.f;
+
+  while (state.keepRunning()) {
+    sum = tasking::parallel_reduce_deterministic(
+        N_ELEMENTS,
+        0.f,
+        [&](int i) { return v[i]; },
+        [](float a, float b) { return a + b; });
+  }
+
+  doNotOptimize(sum);
+  state.setItemsProcessed(state.iterations() * N_ELEMENTS);
+}
+
+RKCOMMON_BENCHMARK("parallel_reduce/sum_deterministic", reduceSumDeterministic);
@@ -0,0 +1,115 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/tasking/AsyncLoop.h"
+#include "rkcommon/tasking/async.h"
+#include "rkcommon/tasking/schedule.h"
+// std
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+
+// Backends without worker threads (e.g. Internal with one thread) never pick
+// up scheduled work while the caller spins, so latency loops give up after
+// this long instead of hanging
+static const auto timeout = std::chrono::seconds(2);
+
+static bool spinUntil(const std::atomic<bool> &flag)
+{
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!flag.load(std::memory_order_acquire)) {
+    if (std::chrono::steady_clock::now() > deadline)
+      return false;
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+// Round trip from schedule() until the task has started running
+static void scheduleLatency(State &state)
+{
+  while (state.keepRunning()) {
+    auto started = std::make_shared<std::atomic<bool>>(false);
+    tasking::schedule([=]() { started->store(true); });
+    if (!spinUntil(*started)) {
+      state.skipWithError("scheduled task did not run");
+      break;
+    }
+  }
+}
+
+RKCOMMON_BENCHMARK("schedule/latency", scheduleLatency);
+
+// Throughput of many independent schedule() calls
+static void scheduleThroughput(State &state)
+{
+  const int n = 1000;
+
+  while (state.keepRunning()) {
+    auto remaining = std::make_shared<std::atomic<int>>(n);
+    for (int i = 0; i < n; ++i)
+      tasking::schedule([=]() { remaining->fetch_sub(1); });
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (remaining->load() != 0) {
+      if (std::chrono::steady_clock::now() > deadline)
+        break;
+      std::this_thread::yield();
+    }
+    if (remaining->load() != 0) {
+      state.skipWithError("scheduled tasks did not run");
+      break;
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * n);
+}
+
+RKCOMMON_BENCHMARK("schedule/throughput_1000", scheduleThroughput);
+
+// Round trip of async() until its future is ready
+static void asyncLatency(State &state)
+{
+  while (state.keepRunning()) {
+    auto future = tasking::async([]() { return 1; });
+    if (future.wait_for(timeout) != std::future_status::ready) {
+      state.skipWithError("async task did not run");
+      break;
+    }
+    doNotOptimize(future.get());
+  }
+}
+
+RKCOMMON_BENCHMARK("async/latency", asyncLatency);
+
+// Time from AsyncLoop::start() until the loop body runs, then stop()
+static void asyncLoopWakeup(State &state)
+{
+  std::atomic<bool> ran{false};
+  tasking::AsyncLoop loop([&]() {
+    ran.store(true, std::memory_order_release);
+    std::this_thread::yield();
+  });
+
+  while (state.keepRunning()) {
+    ran = false;
+    loop.start();
+    const bool woke = spinUntil(ran);
+
+    state.pauseTiming();
+    loop.stop();
+    state.resumeTiming();
+
+    if (!woke) {
+      state.skipWithError("AsyncLoop body did not run");
+      break;
+    }
+  }
+}
+
+RKCOMMON_BENCHMARK("AsyncLoop/wakeup_latency", asyncLoopWakeup);
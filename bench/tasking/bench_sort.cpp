@@ -0,0 +1,105 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/tasking/parallel_partition.h"
+#include "rkcommon/tasking/parallel_sort.h"
+// std
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+
+static const size_t numPrimitives = 1 << 20;
+
+static std::vector<uint32_t> mortonCodes()
+{
+  std::mt19937 rng(7);
+  std::vector<uint32_t> codes(numPrimitives);
+  for (auto &c : codes)
+    c = rng() >> 2;  // 30 bit codes
+  return codes;
+}
+
+// Reference: one core
+static void stdSort(State &state)
+{
+  const auto input = mortonCodes();
+  std::vector<uint32_t> keys;
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    keys = input;
+    state.resumeTiming();
+    std::sort(keys.begin(), keys.end());
+  }
+
+  doNotOptimize(keys.data());
+  state.setItemsProcessed(state.iterations() * numPrimitives);
+}
+
+RKCOMMON_BENCHMARK("sort/std_sort_1M", stdSort);
+
+static void parallelSort(State &state)
+{
+  const auto input = mortonCodes();
+  std::vector<uint32_t> keys;
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    keys = input;
+    state.resumeTiming();
+    tasking::parallel_sort(keys.begin(), keys.end());
+  }
+
+  doNotOptimize(keys.data());
+  state.setItemsProcessed(state.iterations() * numPrimitives);
+}
+
+RKCOMMON_BENCHMARK("sort/parallel_sort_1M", parallelSort);
+
+// Morton codes with primitive IDs as payload, as when building an LBVH
+static void parallelRadixSort(State &state)
+{
+  const auto input = mortonCodes();
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> ids(numPrimitives);
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    keys = input;
+    for (size_t i = 0; i < numPrimitives; ++i)
+      ids[i] = uint32_t(i);
+    state.resumeTiming();
+    tasking::parallel_radix_sort(keys.data(), ids.data(), numPrimitives);
+  }
+
+  doNotOptimize(ids.data());
+  state.setItemsProcessed(state.iterations() * numPrimitives);
+}
+
+RKCOMMON_BENCHMARK("sort/parallel_radix_sort_1M", parallelRadixSort);
+
+// Object split of a BVH node at the middle of the code range
+static void parallelPartition(State &state)
+{
+  const auto input = mortonCodes();
+  std::vector<uint32_t> keys;
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    keys = input;
+    state.resumeTiming();
+    auto split = tasking::parallel_partition(
+        keys, [](uint32_t c) { return c < (1u << 29); });
+    doNotOptimize(split);
+  }
+
+  state.setItemsProcessed(state.iterations() * numPrimitives);
+}
+
+RKCOMMON_BENCHMARK("sort/parallel_partition_1M", parallelPartition);
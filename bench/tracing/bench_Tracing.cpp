@@ -0,0 +1,207 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#define RKCOMMON_ENABLE_PROFILING
+#include "rkcommon/tasking/parallel_for.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+#include "rkcommon/tracing/Tracing.h"
+// std
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::tracing;
+
+static const int eventsPerIteration = 1 << 16;
+
+// The events would otherwise pile up in memory over the runs: the flight
+// recorder keeps recycling the same chunks of each thread instead, which
+// leaves out only the allocation of a new chunk every few thousand events
+struct FlightRecorder
+{
+  explicit FlightRecorder(int cpuTimeSampling = 0)
+  {
+    startFlightRecorder(eventsPerIteration);
+    setCpuTimeSampling(cpuTimeSampling);
+  }
+
+  ~FlightRecorder()
+  {
+    setCpuTimeSampling(1);
+    stopFlightRecorder();
+  }
+};
+
+// Begin/end pairs on one thread, with the CPU time of every 'sampling'th
+template <int SAMPLING>
+static void beginEnd(State &state)
+{
+  FlightRecorder recorder(SAMPLING);
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < eventsPerIteration; ++i) {
+      beginEvent("bench", "tracing");
+      endEvent();
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * eventsPerIteration);
+}
+
+RKCOMMON_BENCHMARK("tracing/begin_end", beginEnd<0>);
+RKCOMMON_BENCHMARK("tracing/begin_end_cpu_time_every_16th", beginEnd<16>);
+RKCOMMON_BENCHMARK("tracing/begin_end_cpu_time", beginEnd<1>);
+
+// Begin/end pairs on all tasking threads at once
+static void beginEndContended(State &state)
+{
+  FlightRecorder recorder;
+  const int numTasks = tasking::numTaskingThreads();
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(numTasks, [&](int) {
+      for (int i = 0; i < eventsPerIteration; ++i) {
+        beginEvent("bench", "tracing");
+        endEvent();
+      }
+    });
+  }
+
+  state.setItemsProcessed(state.iterations() * numTasks * eventsPerIteration);
+}
+
+RKCOMMON_BENCHMARK("tracing/begin_end_contended", beginEndContended);
+
+// The same pairs through RKCOMMON_TRACE_SCOPE, which skips the string cache
+static void traceScope(State &state)
+{
+  FlightRecorder recorder;
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < eventsPerIteration; ++i) {
+      RKCOMMON_TRACE_SCOPE("bench");
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * eventsPerIteration);
+}
+
+RKCOMMON_BENCHMARK("tracing/trace_scope", traceScope);
+
+// Names the string cache of the thread misses, which go to the process wide
+// table of interned strings: copies of a few names, as formatted names are
+static void stringCacheMiss(State &state)
+{
+  const int numNames = 64;
+  std::string names[numNames];
+  for (int i = 0; i < numNames; ++i)
+    names[i] = "bench" + std::to_string(i);
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < eventsPerIteration; ++i) {
+      const std::string name = names[i % numNames];
+      doNotOptimize(internString(name.c_str()));
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * eventsPerIteration);
+}
+
+RKCOMMON_BENCHMARK("tracing/string_cache_miss", stringCacheMiss);
+
+static void setCounters(State &state)
+{
+  FlightRecorder recorder;
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < eventsPerIteration; ++i)
+      setCounter("bench", uint64_t(i));
+  }
+
+  state.setItemsProcessed(state.iterations() * eventsPerIteration);
+}
+
+RKCOMMON_BENCHMARK("tracing/set_counter", setCounters);
+
+static void recordMemoryUse(State &state)
+{
+  FlightRecorder recorder;
+
+  while (state.keepRunning())
+    recordMemUse();
+
+  state.setItemsProcessed(state.iterations());
+}
+
+RKCOMMON_BENCHMARK("tracing/record_mem_use", recordMemoryUse);
+
+// saveLog() in MB of JSON per second. It writes all events held, also
+// those earlier runs left on their threads, so only the rate compares
+static void saveLogThroughput(State &state)
+{
+  const char *logFile = "bench_tracing.json";
+  FlightRecorder recorder;
+  for (int i = 0; i < eventsPerIteration / 2; ++i) {
+    beginEvent("bench", "tracing");
+    endEvent();
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  while (state.keepRunning())
+    saveLog(logFile, "rkcommon_bench");
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  std::ifstream file(logFile, std::ios::binary | std::ios::ate);
+  const double megabytes = double(file.tellg()) / (1 << 20);
+  file.close();
+  std::remove(logFile);
+  state.setCounter("MB_per_s", state.iterations() * megabytes / seconds);
+}
+
+RKCOMMON_BENCHMARK("tracing/save_log", saveLogThroughput);
+
+// The resident memory the timeline takes per event, on a new thread so that
+// no chunks are reused
+static void memoryPerEvent(State &state)
+{
+  const auto residentBytes = []() {
+    const std::string status = getProcStatus();
+    const size_t rss = status.find("VmRSS:");
+    return rss == std::string::npos
+        ? 0.0
+        : std::atof(status.c_str() + rss + 6) * 1024.0;
+  };
+  if (residentBytes() == 0.0) {
+    state.skipWithError("the resident memory is not available");
+    return;
+  }
+
+  setCpuTimeSampling(0);
+  double bytes = 0.0;
+  while (state.keepRunning()) {
+    const double before = residentBytes();
+    std::thread([]() {
+      for (int i = 0; i < eventsPerIteration; ++i) {
+        beginEvent("bench", "tracing");
+        endEvent();
+      }
+    }).join();
+    bytes += residentBytes() - before;
+  }
+  setCpuTimeSampling(1);
+
+  const double events = double(state.iterations()) * 2 * eventsPerIteration;
+  state.setItemsProcessed(state.iterations() * 2 * eventsPerIteration);
+  state.setCounter("bytes_per_event", bytes / events);
+}
+
+RKCOMMON_BENCHMARK("tracing/memory_per_event", memoryPerEvent);
@@ -0,0 +1,133 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/AffineSpace.h"
+#include "rkcommon/utility/Any.h"
+#include "rkcommon/utility/Optional.h"
+// std
+#include <string>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+using namespace rkcommon::utility;
+
+static const int valuesPerIteration = 1 << 12;
+
+// More than Any keeps inline, so it goes to the heap
+struct LargeValue
+{
+  float values[32]{};
+};
+
+template <typename T>
+static T valueAt(int i);
+
+template <>
+int valueAt<int>(int i)
+{
+  return i;
+}
+
+template <>
+vec3f valueAt<vec3f>(int i)
+{
+  return vec3f(float(i));
+}
+
+template <>
+AffineSpace3f valueAt<AffineSpace3f>(int i)
+{
+  return AffineSpace3f::translate(vec3f(float(i)));
+}
+
+template <>
+std::string valueAt<std::string>(int i)
+{
+  // beyond the small string buffer
+  return std::string(32, char('a' + i % 26));
+}
+
+template <>
+LargeValue valueAt<LargeValue>(int i)
+{
+  LargeValue v;
+  v.values[0] = float(i);
+  return v;
+}
+
+// Constructing an Any from a value and reading it back, as setParam() and
+// getParam() do
+template <typename T>
+static void anyConstruct(State &state)
+{
+  std::vector<T> values;
+  for (int i = 0; i < valuesPerIteration; ++i)
+    values.push_back(valueAt<T>(i));
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < valuesPerIteration; ++i) {
+      Any any(values[i]);
+      doNotOptimize(any.get<T>());
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * valuesPerIteration);
+}
+
+RKCOMMON_BENCHMARK("Any/construct/int", anyConstruct<int>);
+RKCOMMON_BENCHMARK("Any/construct/vec3f", anyConstruct<vec3f>);
+RKCOMMON_BENCHMARK("Any/construct/AffineSpace3f", anyConstruct<AffineSpace3f>);
+RKCOMMON_BENCHMARK("Any/construct/string", anyConstruct<std::string>);
+RKCOMMON_BENCHMARK("Any/construct/large_value", anyConstruct<LargeValue>);
+
+// Copies of an Any, e.g. of parameter lists
+template <typename T>
+static void anyCopy(State &state)
+{
+  std::vector<Any> values;
+  for (int i = 0; i < valuesPerIteration; ++i)
+    values.emplace_back(valueAt<T>(i));
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < valuesPerIteration; ++i) {
+      Any copy(values[i]);
+      doNotOptimize(copy.get<T>());
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * valuesPerIteration);
+}
+
+RKCOMMON_BENCHMARK("Any/copy/int", anyCopy<int>);
+RKCOMMON_BENCHMARK("Any/copy/AffineSpace3f", anyCopy<AffineSpace3f>);
+RKCOMMON_BENCHMARK("Any/copy/string", anyCopy<std::string>);
+RKCOMMON_BENCHMARK("Any/copy/large_value", anyCopy<LargeValue>);
+
+// Constructing an engaged Optional and reading it back
+template <typename T>
+static void optionalConstruct(State &state)
+{
+  std::vector<T> values;
+  for (int i = 0; i < valuesPerIteration; ++i)
+    values.push_back(valueAt<T>(i));
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < valuesPerIteration; ++i) {
+      Optional<T> optional(values[i]);
+      doNotOptimize(*optional);
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * valuesPerIteration);
+}
+
+RKCOMMON_BENCHMARK("Optional/construct/int", optionalConstruct<int>);
+RKCOMMON_BENCHMARK("Optional/construct/vec3f", optionalConstruct<vec3f>);
+RKCOMMON_BENCHMARK("Optional/construct/AffineSpace3f",
+                   optionalConstruct<AffineSpace3f>);
+RKCOMMON_BENCHMARK("Optional/construct/string",
+                   optionalConstruct<std::string>);
@@ -0,0 +1,100 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/vec.h"
+#include "rkcommon/utility/DataView.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+using namespace rkcommon::utility;
+
+// interleaved position, normal and texture coordinates
+struct Vertex
+{
+  vec3f position;
+  vec3f normal;
+  vec2f uv;
+};
+
+static const size_t numVertices = 1 << 14;
+
+// The loop of operator[] this replaces, in vertices per second
+static void scalarLoop(State &state)
+{
+  std::vector<Vertex> vertices(numVertices);
+  std::vector<vec3f> out(numVertices);
+  DataView<vec3f> normals(&vertices[0].normal, sizeof(Vertex));
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numVertices; ++i)
+      out[i] = normals[i];
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numVertices);
+}
+
+RKCOMMON_BENCHMARK("utility/DataView/scalar_loop", scalarLoop);
+
+template <bool PARALLEL>
+static void copyTo(State &state)
+{
+  std::vector<Vertex> vertices(numVertices);
+  std::vector<vec3f> out(numVertices);
+  DataView<vec3f> normals(&vertices[0].normal, sizeof(Vertex));
+
+  while (state.keepRunning()) {
+    normals.copyTo(out.data(), 0, numVertices, PARALLEL);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numVertices);
+}
+
+RKCOMMON_BENCHMARK("utility/DataView/copyTo", copyTo<false>);
+RKCOMMON_BENCHMARK("utility/DataView/copyTo_parallel", copyTo<true>);
+
+// Vertices of shuffled triangles
+static void gather(State &state)
+{
+  std::vector<Vertex> vertices(numVertices);
+  std::vector<uint32_t> indices(numVertices);
+  for (size_t i = 0; i < numVertices; ++i)
+    indices[i] = uint32_t((i * 2654435761u) % numVertices);
+  std::vector<vec3f> out(numVertices);
+  DataView<vec3f> positions(&vertices[0].position, sizeof(Vertex));
+
+  while (state.keepRunning()) {
+    positions.gather(indices.data(), out.data(), numVertices, false);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numVertices);
+}
+
+RKCOMMON_BENCHMARK("utility/DataView/gather", gather);
+
+static void scalarGather(State &state)
+{
+  std::vector<Vertex> vertices(numVertices);
+  std::vector<uint32_t> indices(numVertices);
+  for (size_t i = 0; i < numVertices; ++i)
+    indices[i] = uint32_t((i * 2654435761u) % numVertices);
+  std::vector<vec3f> out(numVertices);
+  DataView<vec3f> positions(&vertices[0].position, sizeof(Vertex));
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numVertices; ++i)
+      out[i] = positions[indices[i]];
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numVertices);
+}
+
+RKCOMMON_BENCHMARK("utility/DataView/scalar_gather", scalarGather);
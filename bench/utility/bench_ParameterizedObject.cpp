@@ -0,0 +1,66 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/utility/ParameterizedObject.h"
+// std
+#include <string>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::utility;
+
+// an object committed per frame, its parameters read by name
+static const int numParams = 64;
+
+static std::vector<std::string> paramNames()
+{
+  std::vector<std::string> names;
+  for (int i = 0; i < numParams; ++i)
+    names.push_back("parameter" + std::to_string(i));
+  return names;
+}
+
+template <typename KEY>
+static void getParams(State &state, const std::vector<KEY> &keys)
+{
+  ParameterizedObject object;
+  for (int i = 0; i < numParams; ++i)
+    object.setParam(keys[i], float(i));
+
+  while (state.keepRunning()) {
+    float sum = 0.f;
+    for (int i = 0; i < numParams; ++i)
+      sum += object.getParam<float>(keys[i], 0.f);
+    doNotOptimize(sum);
+  }
+
+  state.setItemsProcessed(state.iterations() * numParams);
+}
+
+static void getParamByString(State &state)
+{
+  getParams(state, paramNames());
+}
+
+static void getParamByLiteral(State &state)
+{
+  const std::vector<std::string> names = paramNames();
+  std::vector<const char *> literals;
+  for (const auto &name : names)
+    literals.push_back(name.c_str());
+  getParams(state, literals);
+}
+
+static void getParamByKey(State &state)
+{
+  const std::vector<std::string> names = paramNames();
+  std::vector<ParamKey> keys(names.begin(), names.end());
+  getParams(state, keys);
+}
+
+RKCOMMON_BENCHMARK("ParameterizedObject/get_param_string", getParamByString);
+RKCOMMON_BENCHMARK("ParameterizedObject/get_param_literal", getParamByLiteral);
+RKCOMMON_BENCHMARK("ParameterizedObject/get_param_key", getParamByKey);
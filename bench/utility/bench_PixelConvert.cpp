@@ -0,0 +1,92 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/math/rkmath.h"
+#include "rkcommon/utility/PixelConvert.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+using namespace rkcommon::utility;
+
+// a 1080p RGBA32F frame with values in [0, 2)
+static const int sizeX = 1920;
+static const int sizeY = 1080;
+
+static std::vector<float> frame()
+{
+  std::vector<float> pixels(4 * size_t(sizeX) * sizeY);
+  uint32_t state = 1;
+  for (auto &p : pixels) {
+    state = state * 1664525u + 1013904223u;
+    p     = (state >> 8) / float(1 << 23);
+  }
+  return pixels;
+}
+
+// The scalar loop of a display path: per component, pow() based sRGB
+static void scalarSRGBA8(State &state)
+{
+  const std::vector<float> pixels = frame();
+  std::vector<uint8_t> out(pixels.size());
+
+  while (state.keepRunning()) {
+    for (int y = 0; y < sizeY; ++y) {
+      const float *in = &pixels[4 * size_t(sizeY - 1 - y) * sizeX];
+      uint8_t *o      = &out[4 * size_t(y) * sizeX];
+      for (int x = 0; x < sizeX; ++x) {
+        for (int c = 0; c < 4; ++c) {
+          float v = in[4 * x + c];
+          if (c < 3)
+            v = linear_to_srgb(v);
+          o[4 * x + c] = uint8_t(clamp(v, 0.f, 1.f) * 255.f + 0.5f);
+        }
+      }
+    }
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * size_t(sizeX) * sizeY);
+}
+
+RKCOMMON_BENCHMARK("utility/PixelConvert/scalar_srgba8", scalarSRGBA8);
+
+// Converting and flipping a frame, in pixels per second
+template <PixelFormat FORMAT, Tonemap TONEMAP>
+static void convert(State &state)
+{
+  const std::vector<float> pixels = frame();
+  std::vector<uint8_t> out(pixelSize(FORMAT) * size_t(sizeX) * sizeY);
+
+  PixelConversion conversion;
+  conversion.tonemap = TONEMAP;
+  conversion.flipY   = true;
+
+  while (state.keepRunning()) {
+    convertPixels(pixels.data(),
+                  PixelFormat::RGBA32F,
+                  out.data(),
+                  FORMAT,
+                  sizeX,
+                  sizeY,
+                  conversion);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * size_t(sizeX) * sizeY);
+}
+
+RKCOMMON_BENCHMARK("utility/PixelConvert/rgba8",
+                   (convert<PixelFormat::RGBA8, Tonemap::NONE>));
+RKCOMMON_BENCHMARK("utility/PixelConvert/srgba8",
+                   (convert<PixelFormat::SRGBA8, Tonemap::NONE>));
+RKCOMMON_BENCHMARK("utility/PixelConvert/srgb8_aces",
+                   (convert<PixelFormat::SRGB8, Tonemap::ACES>));
+RKCOMMON_BENCHMARK("utility/PixelConvert/rgba16f",
+                   (convert<PixelFormat::RGBA16F, Tonemap::NONE>));
+RKCOMMON_BENCHMARK("utility/PixelConvert/l8",
+                   (convert<PixelFormat::L8, Tonemap::NONE>));
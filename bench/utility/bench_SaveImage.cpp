@@ -0,0 +1,119 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/utility/SaveImage.h"
+// std
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+using namespace rkcommon::utility;
+
+// a 1080p frame: gradients, a flat area and some noise
+static const int sizeX = 1920;
+static const int sizeY = 1080;
+
+static std::vector<vec4f> frame()
+{
+  std::vector<vec4f> pixels(size_t(sizeX) * sizeY);
+  uint32_t state = 1;
+  for (int y = 0; y < sizeY; ++y) {
+    for (int x = 0; x < sizeX; ++x) {
+      state         = state * 1664525u + 1013904223u;
+      const float n = (state >> 28) / 1024.f;
+      pixels[size_t(y) * sizeX + x] =
+          x < sizeX / 4 ? vec4f(0.2f, 0.3f, 0.4f, 1.f)
+                        : vec4f(float(x) / sizeX, float(y) / sizeY, n, 1.f);
+    }
+  }
+  return pixels;
+}
+
+template <bool SRGB>
+static void convertRGBA8(State &state)
+{
+  const std::vector<vec4f> pixels = frame();
+  std::vector<uint32_t> rgba(pixels.size());
+
+  while (state.keepRunning()) {
+    convertToRGBA8(pixels.data(), rgba.data(), pixels.size(), SRGB);
+    doNotOptimize(rgba.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * pixels.size());
+}
+
+RKCOMMON_BENCHMARK("utility/SaveImage/convert_rgba8_linear",
+                   convertRGBA8<false>);
+RKCOMMON_BENCHMARK("utility/SaveImage/convert_rgba8_srgb", convertRGBA8<true>);
+
+// Encoding a frame in memory, in pixels per second and the compressed size
+template <ImageFormat FORMAT>
+static void encode(State &state)
+{
+  const std::vector<vec4f> pixels = frame();
+
+  size_t bytes = 0;
+  while (state.keepRunning()) {
+    const std::vector<uint8_t> encoded =
+        encodeImage(FORMAT, sizeX, sizeY, pixels.data());
+    bytes = encoded.size();
+  }
+
+  state.setItemsProcessed(state.iterations() * pixels.size());
+  state.setCounter("bytes_per_pixel", double(bytes) / pixels.size());
+}
+
+RKCOMMON_BENCHMARK("utility/SaveImage/encode_ppm", encode<ImageFormat::PPM>);
+RKCOMMON_BENCHMARK("utility/SaveImage/encode_qoi", encode<ImageFormat::QOI>);
+RKCOMMON_BENCHMARK("utility/SaveImage/encode_png", encode<ImageFormat::PNG>);
+RKCOMMON_BENCHMARK("utility/SaveImage/encode_exr", encode<ImageFormat::EXR>);
+
+// Writing a frame to disk, in milliseconds per megapixel
+template <typename WRITE_FCN>
+static void writeFile(State &state, const char *fileName, WRITE_FCN &&write)
+{
+  const auto start = std::chrono::steady_clock::now();
+  while (state.keepRunning())
+    write(fileName);
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  std::remove(fileName);
+
+  const double megapixels = sizeX * sizeY * 1e-6;
+  state.setItemsProcessed(state.iterations() * size_t(sizeX) * sizeY);
+  state.setCounter("ms_per_megapixel",
+                   seconds * 1e3 / (state.iterations() * megapixels));
+}
+
+static void writePPMFile(State &state)
+{
+  const std::vector<vec4f> pixels = frame();
+  std::vector<uint32_t> rgba(pixels.size());
+  convertToRGBA8(pixels.data(), rgba.data(), pixels.size(), true);
+
+  writeFile(state, "bench_SaveImage.ppm", [&](const char *fileName) {
+    writePPM(fileName, sizeX, sizeY, rgba.data());
+  });
+}
+
+static void writePFMFile(State &state)
+{
+  const std::vector<vec4f> pixels = frame();
+  std::vector<vec3f> rgb(pixels.size());
+  for (size_t i = 0; i < pixels.size(); ++i)
+    rgb[i] = vec3f(pixels[i].x, pixels[i].y, pixels[i].z);
+
+  writeFile(state, "bench_SaveImage.pfm", [&](const char *fileName) {
+    writePFM(fileName, sizeX, sizeY, rgb.data());
+  });
+}
+
+RKCOMMON_BENCHMARK("utility/SaveImage/write_ppm", writePPMFile);
+RKCOMMON_BENCHMARK("utility/SaveImage/write_pfm", writePFMFile);
@@ -0,0 +1,87 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/containers/SmallVector.h"
+#include "rkcommon/utility/StringManip.h"
+// std
+#include <string>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::utility;
+
+// a parameter list as it comes from a command line or config file
+static const std::string parameters =
+    "camera.position=0,1,5 camera.direction=0,0,-1 camera.fovy=60 "
+    "renderer=pathtracer spp=4 maxPathLength=20 backgroundColor=0.1,0.1,0.1 "
+    "light.type=ambient light.intensity=0.5 tonemap=ACES exposure=1.2";
+
+// Splitting into a std::vector<std::string>, in pieces per second
+static void splitStrings(State &state)
+{
+  size_t pieces = 0;
+  while (state.keepRunning()) {
+    auto tokens = split(parameters, ' ');
+    pieces += tokens.size();
+    doNotOptimize(tokens.data());
+  }
+  state.setItemsProcessed(pieces);
+}
+
+RKCOMMON_BENCHMARK("utility/StringManip/split", splitStrings);
+
+// Splitting into views in a SmallVector, without allocating
+static void splitViews(State &state)
+{
+  size_t pieces = 0;
+  containers::SmallVector<StringView, 16> tokens;
+  while (state.keepRunning()) {
+    tokens.clear();
+    split_view(parameters, ' ', tokens);
+    pieces += tokens.size();
+    doNotOptimize(tokens.data());
+  }
+  state.setItemsProcessed(pieces);
+}
+
+RKCOMMON_BENCHMARK("utility/StringManip/split_view", splitViews);
+
+// Iterating over the pieces on a set of delimiters
+static void iterateTokens(State &state)
+{
+  size_t pieces = 0;
+  while (state.keepRunning()) {
+    for (StringView token : tokens(parameters, " =,")) {
+      doNotOptimize(token.data());
+      ++pieces;
+    }
+  }
+  state.setItemsProcessed(pieces);
+}
+
+RKCOMMON_BENCHMARK("utility/StringManip/tokens", iterateTokens);
+
+// Converting to lower case, in bytes per second
+static void lowerCaseCopy(State &state)
+{
+  while (state.keepRunning())
+    doNotOptimize(lowerCase(parameters).data());
+  state.setItemsProcessed(state.iterations() * parameters.size());
+}
+
+RKCOMMON_BENCHMARK("utility/StringManip/lowerCase", lowerCaseCopy);
+
+static void lowerCaseOwnString(State &state)
+{
+  std::string str = parameters;
+  while (state.keepRunning()) {
+    lowerCaseInPlace(str);
+    doNotOptimize(str.data());
+  }
+  state.setItemsProcessed(state.iterations() * str.size());
+}
+
+RKCOMMON_BENCHMARK("utility/StringManip/lowerCaseInPlace",
+                   lowerCaseOwnString);
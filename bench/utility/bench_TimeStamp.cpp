@@ -0,0 +1,35 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/tasking/parallel_for.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+#include "rkcommon/utility/TimeStamp.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::utility;
+
+static const int renewalsPerTask = 1 << 16;
+
+// Every task marks its own objects modified, as in a parallel scene update
+static void renewPerTask(State &state)
+{
+  const int numTasks = tasking::numTaskingThreads();
+  std::vector<TimeStamp> stamps(numTasks * 64);
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(numTasks, [&](int task) {
+      TimeStamp *own = &stamps[task * 64];
+      for (int i = 0; i < renewalsPerTask; ++i)
+        own[i % 64].renew();
+    });
+  }
+
+  state.setItemsProcessed(state.iterations() * numTasks * renewalsPerTask);
+}
+
+RKCOMMON_BENCHMARK("utility/TimeStamp/renew_per_task", renewPerTask);
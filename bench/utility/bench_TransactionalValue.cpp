@@ -0,0 +1,87 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/utility/TransactionalValue.h"
+#include "rkcommon/utility/TripleBufferedValue.h"
+// std
+#include <atomic>
+#include <thread>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::utility;
+
+// a camera a GUI thread hands to a rendering thread
+struct Camera
+{
+  float values[16]{};
+};
+
+static const int valuesPerIteration = 1 << 12;
+
+// Assignments and updates on one thread, without contention
+template <typename VALUE>
+static void handoff(State &state)
+{
+  VALUE value;
+  Camera camera;
+
+  while (state.keepRunning()) {
+    for (int i = 0; i < valuesPerIteration; ++i) {
+      camera.values[0] = float(i);
+      value            = camera;
+      doNotOptimize(value.update());
+      doNotOptimize(value.ref().values[0]);
+    }
+  }
+
+  state.setItemsProcessed(state.iterations() * valuesPerIteration);
+}
+
+RKCOMMON_BENCHMARK("utility/TransactionalValue/handoff/mutex",
+                   handoff<TransactionalValue<Camera>>);
+RKCOMMON_BENCHMARK("utility/TransactionalValue/handoff/triple_buffered",
+                   handoff<TripleBufferedValue<Camera>>);
+
+// The consumer updates and reads as fast as it can while a producer thread
+// keeps assigning new values; counts the values each side got through
+template <typename VALUE>
+static void producerConsumer(State &state)
+{
+  VALUE value;
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> produced{0};
+
+  std::thread producer([&]() {
+    Camera camera;
+    size_t count = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      camera.values[0] = float(count++);
+      value            = camera;
+    }
+    produced = count;
+  });
+
+  size_t updates = 0;
+  while (state.keepRunning()) {
+    for (int i = 0; i < valuesPerIteration; ++i) {
+      updates += value.update();
+      doNotOptimize(value.ref().values[0]);
+    }
+  }
+
+  stop = true;
+  producer.join();
+
+  state.setItemsProcessed(state.iterations() * valuesPerIteration);
+  state.setCounter("values_received", double(updates));
+  state.setCounter("values_produced", double(produced));
+}
+
+RKCOMMON_BENCHMARK("utility/TransactionalValue/producer_consumer/mutex",
+                   producerConsumer<TransactionalValue<Camera>>);
+RKCOMMON_BENCHMARK(
+    "utility/TransactionalValue/producer_consumer/triple_buffered",
+    producerConsumer<TripleBufferedValue<Camera>>);
@@ -0,0 +1,74 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/utility/TypedArrayView.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::math;
+using namespace rkcommon::utility;
+
+// 64K values, converted within the caches
+static const size_t numValues = 1 << 16;
+
+// Element by element through get(), in values per second
+template <typename T>
+static void getLoop(State &state)
+{
+  const std::vector<T> values(numValues, T(1));
+  const TypedArrayView view(values.data(), numValues);
+  std::vector<float> out(numValues);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numValues; ++i)
+      out[i] = view.get<float>(i);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numValues);
+}
+
+RKCOMMON_BENCHMARK("utility/TypedArrayView/get_uint8", getLoop<uint8_t>);
+RKCOMMON_BENCHMARK("utility/TypedArrayView/get_half", getLoop<half>);
+
+template <typename T>
+static void convertTo(State &state)
+{
+  const std::vector<T> values(numValues, T(1));
+  const TypedArrayView view(values.data(), numValues);
+  std::vector<float> out(numValues);
+
+  while (state.keepRunning()) {
+    view.convertTo(out.data(), false);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numValues);
+}
+
+RKCOMMON_BENCHMARK("utility/TypedArrayView/convertTo_uint8",
+                   convertTo<uint8_t>);
+RKCOMMON_BENCHMARK("utility/TypedArrayView/convertTo_half", convertTo<half>);
+
+// Summing all values a chunk at a time, without a converted copy
+static void chunkedSum(State &state)
+{
+  const std::vector<half> values(numValues, half(1.f));
+  const TypedArrayView view(values.data(), numValues);
+
+  while (state.keepRunning()) {
+    float sum = 0.f;
+    for (const ConvertedChunk<float> &c : view.chunks<float>())
+      for (float v : c)
+        sum += v;
+    doNotOptimize(sum);
+  }
+
+  state.setItemsProcessed(state.iterations() * numValues);
+}
+
+RKCOMMON_BENCHMARK("utility/TypedArrayView/chunked_sum_half", chunkedSum);
@@ -0,0 +1,46 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/utility/demangle.h"
+// std
+#include <map>
+#include <string>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::utility;
+
+using Type = std::map<std::string, int>;
+
+// Type names per second
+static void demangleEachTime(State &state)
+{
+  while (state.keepRunning())
+    doNotOptimize(demangle(typeid(Type).name()));
+
+  state.setItemsProcessed(state.iterations());
+}
+
+RKCOMMON_BENCHMARK("utility/demangle/demangle", demangleEachTime);
+
+static void cachedName(State &state)
+{
+  while (state.keepRunning())
+    doNotOptimize(demangledName(typeid(Type)));
+
+  state.setItemsProcessed(state.iterations());
+}
+
+RKCOMMON_BENCHMARK("utility/demangle/demangledName", cachedName);
+
+static void signatureName(State &state)
+{
+  while (state.keepRunning())
+    doNotOptimize(typeName<Type>());
+
+  state.setItemsProcessed(state.iterations());
+}
+
+RKCOMMON_BENCHMARK("utility/demangle/typeName", signatureName);
@@ -0,0 +1,82 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/utility/multidim_index_sequence.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+
+static const vec2ul dims(1920, 1080);
+
+// an image-space loop writing one value per pixel
+static void reshapePerIndex(State &state)
+{
+  const index_sequence_2D seq(dims);
+  std::vector<float> image(seq.total_indices());
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < seq.total_indices(); ++i) {
+      const vec2ul c = seq.reshape(i);
+      image[i]       = float(c.x + c.y);
+    }
+    doNotOptimize(image.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * seq.total_indices());
+}
+
+static void iterate(State &state)
+{
+  const index_sequence_2D seq(dims);
+  std::vector<float> image(seq.total_indices());
+
+  while (state.keepRunning()) {
+    size_t i = 0;
+    for (const auto &c : seq)
+      image[i++] = float(c.x + c.y);
+    doNotOptimize(image.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * seq.total_indices());
+}
+
+static void parallelFor(State &state)
+{
+  const index_sequence_2D seq(dims);
+  std::vector<float> image(seq.total_indices());
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(seq, [&](const vec2ul &c) {
+      image[c.x + dims.x * c.y] = float(c.x + c.y);
+    });
+    doNotOptimize(image.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * seq.total_indices());
+}
+
+static void parallelForTiled(State &state)
+{
+  const tiled_sequence_2D seq(dims, vec2ul(64));
+  std::vector<float> image(seq.total_indices());
+
+  while (state.keepRunning()) {
+    tasking::parallel_for(seq, [&](const vec2ul &c) {
+      image[c.x + dims.x * c.y] = float(c.x + c.y);
+    });
+    doNotOptimize(image.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * seq.total_indices());
+}
+
+RKCOMMON_BENCHMARK("multidim_index_sequence/reshape_per_index",
+                   reshapePerIndex);
+RKCOMMON_BENCHMARK("multidim_index_sequence/iterate", iterate);
+RKCOMMON_BENCHMARK("multidim_index_sequence/parallel_for", parallelFor);
+RKCOMMON_BENCHMARK("multidim_index_sequence/parallel_for_tiled",
+                   parallelForTiled);
@@ -0,0 +1,61 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/utility/random.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::utility;
+
+static const size_t numValues = 1 << 20;
+
+static void pcg32Loop(State &state)
+{
+  std::vector<float> out(numValues);
+  pcg32_biased_float_distribution dist(42, 0, 0.f, 1.f);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numValues; ++i)
+      out[i] = dist();
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numValues);
+}
+
+static void philoxLoop(State &state)
+{
+  std::vector<float> out(numValues);
+  const philox_stream stream(42);
+
+  while (state.keepRunning()) {
+    for (size_t i = 0; i < numValues; ++i)
+      out[i] = stream.uniform(i);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numValues);
+}
+
+template <bool PARALLEL>
+static void philoxFill(State &state)
+{
+  std::vector<float> out(numValues);
+  const philox_stream stream(42);
+
+  while (state.keepRunning()) {
+    fillUniform(stream, 0, out.data(), numValues, PARALLEL);
+    doNotOptimize(out.data());
+  }
+
+  state.setItemsProcessed(state.iterations() * numValues);
+}
+
+RKCOMMON_BENCHMARK("random/uniform/pcg32", pcg32Loop);
+RKCOMMON_BENCHMARK("random/uniform/philox_scalar", philoxLoop);
+RKCOMMON_BENCHMARK("random/uniform/fillUniform", philoxFill<false>);
+RKCOMMON_BENCHMARK("random/uniform/fillUniform_parallel", philoxFill<true>);
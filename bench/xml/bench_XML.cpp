@@ -0,0 +1,197 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Benchmark.h"
+
+#include "rkcommon/xml/XML.h"
+// std
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::bench;
+using namespace rkcommon::xml;
+
+static const char *sceneXmlFile = "bench_XML_scene.xml";
+static const char *xmlFile      = "bench_XML.xml";
+static const char *binFile      = "bench_XML.bin";
+
+// a scene graph of many small nodes with properties and content, as
+// exporters write them
+static const int numMeshes = 20000;
+
+static void writeScene(Writer &writer, const std::vector<float> &vertices)
+{
+  writer.writeHeader("1.0");
+  writer.openNode("scene");
+  writer.writeProperty("name", "bench");
+  for (int m = 0; m < numMeshes; ++m) {
+    writer.openNode("mesh");
+    writer.writeProperty("id", std::to_string(m));
+    writer.writeProperty("material", "material" + std::to_string(m % 64));
+    writer.openNode("transform");
+    writer.writeProperty("translate", "1.5 -2.25 3.125");
+    writer.writeProperty("rotate", "0 1 0 45");
+    writer.closeNode();
+    writer.writeContent("bounds", "-1 -1 -1 1 1 1");
+    if (!vertices.empty()) {
+      writer.alignData(16);
+      const size_t offset =
+          writer.writeData(vertices.data(), vertices.size() * sizeof(float));
+      writer.writeProperty("ofs", std::to_string(offset));
+    }
+    writer.closeNode();
+  }
+  writer.closeNode();
+  writer.writeFooter();
+}
+
+static double fileMegabytes(const char *fileName)
+{
+  std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+  return double(file.tellg()) / (1 << 20);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                       - start)
+      .count();
+}
+
+// the scene's XML, without binary data, written once for the parsers and
+// removed at exit
+struct SceneFile
+{
+  SceneFile()
+  {
+    FILE *xml = std::fopen(sceneXmlFile, "wb");
+    FILE *bin = std::fopen(binFile, "wb");
+    {
+      Writer writer(xml, bin);
+      writeScene(writer, {});
+    }
+    std::fclose(xml);
+    std::fclose(bin);
+    std::remove(binFile);
+  }
+
+  ~SceneFile()
+  {
+    std::remove(sceneXmlFile);
+  }
+};
+
+static std::string sceneFile()
+{
+  static SceneFile file;
+  return sceneXmlFile;
+}
+
+// Parsing in MB of XML per second, into a tree, a mapped tree and events
+static void readTree(State &state)
+{
+  const std::string fileName = sceneFile();
+
+  const auto start = std::chrono::steady_clock::now();
+  while (state.keepRunning())
+    doNotOptimize(readXML(fileName).child.size());
+  const double seconds = secondsSince(start);
+
+  state.setItemsProcessed(state.iterations() * numMeshes);
+  const double megabytes = fileMegabytes(sceneXmlFile);
+  state.setCounter("MB_per_s", state.iterations() * megabytes / seconds);
+}
+
+static void mapTree(State &state)
+{
+  const std::string fileName = sceneFile();
+
+  const auto start = std::chrono::steady_clock::now();
+  while (state.keepRunning())
+    doNotOptimize(mapXML(fileName).get());
+  const double seconds = secondsSince(start);
+
+  state.setItemsProcessed(state.iterations() * numMeshes);
+  const double megabytes = fileMegabytes(sceneXmlFile);
+  state.setCounter("MB_per_s", state.iterations() * megabytes / seconds);
+}
+
+struct CountingHandler : public XMLHandler
+{
+  size_t properties{0};
+
+  void onProperty(StringView, StringView) override
+  {
+    properties++;
+  }
+};
+
+static void parseEvents(State &state)
+{
+  const std::string fileName = sceneFile();
+
+  const auto start = std::chrono::steady_clock::now();
+  while (state.keepRunning()) {
+    CountingHandler handler;
+    parseXML(fileName, handler);
+    doNotOptimize(handler.properties);
+  }
+  const double seconds = secondsSince(start);
+
+  state.setItemsProcessed(state.iterations() * numMeshes);
+  const double megabytes = fileMegabytes(sceneXmlFile);
+  state.setCounter("MB_per_s", state.iterations() * megabytes / seconds);
+}
+
+RKCOMMON_BENCHMARK("XML/readXML", readTree);
+RKCOMMON_BENCHMARK("XML/mapXML", mapTree);
+RKCOMMON_BENCHMARK("XML/parseXML", parseEvents);
+
+// Writing the scene, in MB of XML and binary data per second; with vertex
+// data the binary side-file is written inline or from the background thread
+static void writeThroughput(State &state, bool withData, bool asyncData)
+{
+  const std::vector<float> vertices(withData ? 3 * 256 : 0, 1.f);
+
+  const auto start = std::chrono::steady_clock::now();
+  while (state.keepRunning()) {
+    FILE *xml = std::fopen(xmlFile, "wb");
+    FILE *bin = std::fopen(binFile, "wb");
+    {
+      Writer writer(xml, bin, asyncData);
+      writeScene(writer, vertices);
+    }
+    std::fclose(xml);
+    std::fclose(bin);
+  }
+  const double seconds = secondsSince(start);
+
+  const double megabytes = fileMegabytes(xmlFile) + fileMegabytes(binFile);
+  std::remove(xmlFile);
+  std::remove(binFile);
+  state.setItemsProcessed(state.iterations() * numMeshes);
+  state.setCounter("MB_per_s", state.iterations() * megabytes / seconds);
+}
+
+static void writeText(State &state)
+{
+  writeThroughput(state, false, false);
+}
+
+static void writeWithData(State &state)
+{
+  writeThroughput(state, true, false);
+}
+
+static void writeWithAsyncData(State &state)
+{
+  writeThroughput(state, true, true);
+}
+
+RKCOMMON_BENCHMARK("XML/Writer/text", writeText);
+RKCOMMON_BENCHMARK("XML/Writer/with_data", writeWithData);
+RKCOMMON_BENCHMARK("XML/Writer/with_async_data", writeWithAsyncData);
@@ -150,10 +150,10 @@ endmacro()
 
 macro(rkcommon_configure_tasking_system)
   set(RKCOMMON_TASKING_SYSTEM TBB CACHE STRING
-      "Per-node thread tasking system [TBB,OpenMP,Internal,Debug]")
+      "Per-node thread tasking system [TBB,OpenMP,Internal,Debug,Dynamic]")
 
   set_property(CACHE RKCOMMON_TASKING_SYSTEM PROPERTY
-               STRINGS TBB OpenMP Internal Debug)
+               STRINGS TBB OpenMP Internal Debug Dynamic)
 
   # NOTE(jda) - Make the RKCOMMON_TASKING_SYSTEM build option case-insensitive
   string(TOUPPER ${RKCOMMON_TASKING_SYSTEM} RKCOMMON_TASKING_SYSTEM_ID)
@@ -162,9 +162,13 @@ macro(rkcommon_configure_tasking_system)
   set(RKCOMMON_TASKING_OPENMP   FALSE)
   set(RKCOMMON_TASKING_INTERNAL FALSE)
   set(RKCOMMON_TASKING_DEBUG    FALSE)
+  set(RKCOMMON_TASKING_DYNAMIC  FALSE)
 
   if(${RKCOMMON_TASKING_SYSTEM_ID} STREQUAL "TBB")
     set(RKCOMMON_TASKING_TBB TRUE)
+  elseif(${RKCOMMON_TASKING_SYSTEM_ID} STREQUAL "DYNAMIC")
+    # backend is picked at runtime, see rkcommon_create_tasking_target()
+    set(RKCOMMON_TASKING_DYNAMIC TRUE)
   else()
     unset(TBB_INCLUDE_DIR          CACHE)
     unset(TBB_LIBRARY              CACHE)
@@ -227,6 +231,32 @@ macro(rkcommon_create_tasking_target FROM_INSTALL)
     endif()
   elseif(RKCOMMON_TASKING_INTERNAL)
     set(RKCOMMON_TASKING_DEFINITIONS RKCOMMON_TASKING_INTERNAL)
+  elseif(RKCOMMON_TASKING_DYNAMIC)
+    # Internal and serial backends are always available, TBB (2021+ config
+    # packages only) and OpenMP are added when found. An installed rkcommon
+    # requires the same optional backends it was built with.
+    set(RKCOMMON_TASKING_DEFINITIONS RKCOMMON_TASKING_DYNAMIC)
+    if (${FROM_INSTALL})
+      if (RKCOMMON_TASKING_DYNAMIC_TBB)
+        find_dependency_39(TBB 2021.1 COMPONENTS tbb tbbmalloc CONFIG)
+      endif()
+      if (RKCOMMON_TASKING_DYNAMIC_OPENMP)
+        find_dependency_39(OpenMP)
+      endif()
+    else()
+      find_package(TBB 2021.1 QUIET COMPONENTS tbb tbbmalloc CONFIG)
+      find_package(OpenMP QUIET)
+      set(RKCOMMON_TASKING_DYNAMIC_TBB ${TBB_FOUND})
+      set(RKCOMMON_TASKING_DYNAMIC_OPENMP ${OpenMP_FOUND})
+    endif()
+    if (RKCOMMON_TASKING_DYNAMIC_TBB)
+      list(APPEND RKCOMMON_TASKING_LIBS TBB::tbb TBB::tbbmalloc)
+      list(APPEND RKCOMMON_TASKING_DEFINITIONS RKCOMMON_TASKING_HAS_TBB)
+    endif()
+    if (RKCOMMON_TASKING_DYNAMIC_OPENMP)
+      list(APPEND RKCOMMON_TASKING_LIBS OpenMP::OpenMP_CXX)
+      list(APPEND RKCOMMON_TASKING_DEFINITIONS RKCOMMON_TASKING_HAS_OMP)
+    endif()
   else()#Debug
     # Do nothing, will fall back to scalar code (useful for debugging)
   endif()
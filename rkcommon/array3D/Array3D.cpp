@@ -0,0 +1,262 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Array3D.h"
+#include "../math/dispatch.h"
+
+namespace rkcommon {
+  namespace array3D {
+    namespace detail {
+
+      namespace {
+
+        /* W positions at once: the corner indices are computed in 32 bit
+           integer lanes and the corners fetched with gathers, which only
+           AVX2 and AVX-512 have. Other targets use the scalar loop. */
+
+#if defined(__AVX512F__) && !defined(RKCOMMON_NO_SIMD)
+#define RKCOMMON_SAMPLE_GATHER
+        constexpr int W = 16;
+
+        struct vint
+        {
+          __m512i v;
+        };
+
+        inline vint set1(int a)
+        {
+          return {_mm512_set1_epi32(a)};
+        }
+
+        inline vint operator+(vint a, vint b)
+        {
+          return {_mm512_add_epi32(a.v, b.v)};
+        }
+
+        inline vint min(vint a, vint b)
+        {
+          return {_mm512_min_epi32(a.v, b.v)};
+        }
+
+        inline vint operator*(vint a, int b)
+        {
+          return {_mm512_mullo_epi32(a.v, _mm512_set1_epi32(b))};
+        }
+
+        inline vint operator&(vint a, int b)
+        {
+          return {_mm512_and_si512(a.v, _mm512_set1_epi32(b))};
+        }
+
+        inline vint operator>>(vint a, int s)
+        {
+          return {_mm512_srl_epi32(a.v, _mm_cvtsi32_si128(s))};
+        }
+
+        inline vint operator<<(vint a, int s)
+        {
+          return {_mm512_sll_epi32(a.v, _mm_cvtsi32_si128(s))};
+        }
+
+        // rounds towards zero
+        inline vint toInt(const math::vfloat<W> &a)
+        {
+          return {_mm512_cvttps_epi32(a.v)};
+        }
+
+        inline math::vfloat<W> toFloat(vint a)
+        {
+          return _mm512_cvtepi32_ps(a.v);
+        }
+
+        inline math::vfloat<W> gather(const float *base, vint index)
+        {
+          return _mm512_i32gather_ps(index.v, base, 4);
+        }
+#elif defined(__AVX2__) && !defined(RKCOMMON_NO_SIMD)
+#define RKCOMMON_SAMPLE_GATHER
+        constexpr int W = 8;
+
+        struct vint
+        {
+          __m256i v;
+        };
+
+        inline vint set1(int a)
+        {
+          return {_mm256_set1_epi32(a)};
+        }
+
+        inline vint operator+(vint a, vint b)
+        {
+          return {_mm256_add_epi32(a.v, b.v)};
+        }
+
+        inline vint min(vint a, vint b)
+        {
+          return {_mm256_min_epi32(a.v, b.v)};
+        }
+
+        inline vint operator*(vint a, int b)
+        {
+          return {_mm256_mullo_epi32(a.v, _mm256_set1_epi32(b))};
+        }
+
+        inline vint operator&(vint a, int b)
+        {
+          return {_mm256_and_si256(a.v, _mm256_set1_epi32(b))};
+        }
+
+        inline vint operator>>(vint a, int s)
+        {
+          return {_mm256_srl_epi32(a.v, _mm_cvtsi32_si128(s))};
+        }
+
+        inline vint operator<<(vint a, int s)
+        {
+          return {_mm256_sll_epi32(a.v, _mm_cvtsi32_si128(s))};
+        }
+
+        // rounds towards zero
+        inline vint toInt(const math::vfloat<W> &a)
+        {
+          return {_mm256_cvttps_epi32(a.v)};
+        }
+
+        inline math::vfloat<W> toFloat(vint a)
+        {
+          return _mm256_cvtepi32_ps(a.v);
+        }
+
+        inline math::vfloat<W> gather(const float *base, vint index)
+        {
+          return _mm256_i32gather_ps(base, index.v, 4);
+        }
+#endif
+
+#ifdef RKCOMMON_SAMPLE_GATHER
+        using vfloat = math::vfloat<W>;
+        using vbool  = math::vbool<W>;
+
+        // VoxelLayout::offset() per lane
+        inline vint offset(const VoxelLayout<float> &layout, int axis, vint p)
+        {
+          const int shift = layout.brickShift;
+          const int local = (1 << shift) - 1;
+          return (p >> shift) * int(layout.brickStride[axis]) +
+                 ((p & local) << axis * shift);
+        }
+
+        inline vfloat lerp(const vfloat &f, const vfloat &a, const vfloat &b)
+        {
+          return a + f * (b - a);
+        }
+
+        // trilinearCell() per lane
+        inline vfloat cell(const vfloat &pos,
+                           int dims,
+                           vint &lower,
+                           vint &upper,
+                           vbool &inside)
+        {
+          const vfloat last(float(dims - 1));
+          inside = inside & (pos >= 0.f) & (pos <= last);
+          // max() returns its second operand for NaN, as trilinearCell()
+          const vfloat p = min(max(pos, vfloat(0.f)), last);
+          lower          = toInt(p);
+          upper          = min(lower + set1(1), set1(dims - 1));
+          return p - toFloat(lower);
+        }
+
+        inline void sampleTrilinearW(const VoxelLayout<float> &layout,
+                                     const vec3f *pos,
+                                     float *out,
+                                     const float *outside)
+        {
+          const math::vec3vf<W> p = math::loadAoS<W>(pos);
+
+          vint lx, ux, ly, uy, lz, uz;
+          vbool inside(true);
+          const vfloat fx = cell(p.x, layout.dims.x, lx, ux, inside);
+          const vfloat fy = cell(p.y, layout.dims.y, ly, uy, inside);
+          const vfloat fz = cell(p.z, layout.dims.z, lz, uz, inside);
+
+          const vint x0 = offset(layout, 0, lx);
+          const vint x1 = offset(layout, 0, ux);
+          const vint y0 = offset(layout, 1, ly);
+          const vint y1 = offset(layout, 1, uy);
+          const vint z0 = offset(layout, 2, lz);
+          const vint z1 = offset(layout, 2, uz);
+
+          const float *v  = layout.values;
+          const vint i00  = y0 + z0;
+          const vint i10  = y1 + z0;
+          const vint i01  = y0 + z1;
+          const vint i11  = y1 + z1;
+          const vfloat c0 = lerp(fx, gather(v, x0 + i00), gather(v, x1 + i00));
+          const vfloat c1 = lerp(fx, gather(v, x0 + i10), gather(v, x1 + i10));
+          const vfloat c2 = lerp(fx, gather(v, x0 + i01), gather(v, x1 + i01));
+          const vfloat c3 = lerp(fx, gather(v, x0 + i11), gather(v, x1 + i11));
+          vfloat result   = lerp(fz, lerp(fy, c0, c1), lerp(fy, c2, c3));
+
+          if (outside)
+            result = select(inside, result, vfloat(*outside));
+          vfloat::storeu(out, result);
+        }
+#endif
+
+      }  // namespace
+
+      // entry points, built once per instruction set (see dispatch.h) /////
+
+      namespace RKCOMMON_ISA_NAMESPACE {
+
+        void sampleTrilinear(const VoxelLayout<float> &layout,
+                             const vec3f *pos,
+                             float *out,
+                             size_t n,
+                             const float *outside)
+        {
+          size_t i = 0;
+#ifdef RKCOMMON_SAMPLE_GATHER
+          // the gathers take 32 bit indices
+          const size_t lastBrick = size_t(layout.dims.z - 1) >>
+                                   layout.brickShift;
+          const size_t storage = (lastBrick + 1) * layout.brickStride.z;
+          if (storage <= size_t(INT32_MAX)) {
+            for (; i + W <= n; i += W)
+              sampleTrilinearW(layout, pos + i, out + i, outside);
+          }
+#endif
+          detail::sampleTrilinear<float>(
+              layout, pos + i, out + i, n - i, outside);
+        }
+
+      }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+      // Array3D.h definitions ////////////////////////////////////////////////
+
+      using SampleTrilinearFcn = void(const VoxelLayout<float> &,
+                                      const vec3f *,
+                                      float *,
+                                      size_t,
+                                      const float *);
+
+      RKCOMMON_ISA_DECLARE(SampleTrilinearFcn sampleTrilinear)
+
+      void sampleTrilinear(const VoxelLayout<float> &layout,
+                           const vec3f *pos,
+                           float *out,
+                           size_t n,
+                           const float *outside)
+      {
+        static SampleTrilinearFcn *const fcn =
+            RKCOMMON_ISA_SELECT(SampleTrilinearFcn, sampleTrilinear);
+        fcn(layout, pos, out, n, outside);
+      }
+#endif
+
+    }  // namespace detail
+  }  // namespace array3D
+}  // namespace rkcommon
@@ -4,15 +4,103 @@
 #pragma once
 
 // ospray
+#include <algorithm>
+#include <memory>
 #include <sstream>
+#include <type_traits>
 #include <vector>
 #include "../common.h"
+#include "../math/packet.h"
 #include "../math/range.h"
+#include "../memory/malloc.h"
+#include "../tasking/parallel_for.h"
+#include "../tasking/parallel_reduce.h"
+#include "../utility/MappedArray.h"
 #include "for_each.h"
 
 namespace rkcommon {
   namespace array3D {
 
+    template <typename value_t>
+    struct ActualArray3D;
+
+    namespace detail {
+
+      /*! where the voxels of a volume are in memory, for the sampling
+        kernels: bricks of 2^brickShift voxels per side, x fastest within
+        and across the bricks. brickShift 0 is the plain x fastest layout
+        of ActualArray3D. */
+      template <typename T>
+      struct VoxelLayout
+      {
+        VoxelLayout(const T *values,
+                    const vec3i &dims,
+                    const vec3i &bricks,
+                    int brickShift);
+
+        /*! voxel (x, y, z) is values[offset(0, x) + offset(1, y) +
+          offset(2, z)] */
+        size_t offset(int axis, int p) const;
+
+        const T *values;
+        vec3i dims;
+        int brickShift;
+        vec3ul brickStride;
+      };
+
+      // value type of weighted sums of T: float for scalars, vec3f for vec3f
+      template <typename T>
+      using interpolant_t = decltype(1.f * std::declval<const T &>());
+
+      // whether sampleTrilinear() works for T (not e.g. for range_t<T>)
+      template <typename T, typename = void>
+      struct is_interpolatable : std::false_type
+      {
+      };
+
+      template <typename T>
+      struct is_interpolatable<
+          T,
+          decltype(void(T(std::declval<interpolant_t<T>>() +
+                          std::declval<interpolant_t<T>>())))>
+          : std::true_type
+      {
+      };
+
+      /*! clamps 'pos' to the cell [lower, upper] of a volume with 'dims'
+        voxels, where upper is lower + 1 clamped to the volume, and
+        returns whether 'pos' was inside [0, dims - 1] */
+      bool trilinearCell(const vec3f &pos,
+                         const vec3i &dims,
+                         vec3i &lower,
+                         vec3i &upper,
+                         vec3f &frac);
+
+      /*! trilinear interpolation of the cell corners c[0..8), x fastest
+        (c[1] is the corner at +x). Integer results are rounded. */
+      template <typename T>
+      T trilinear(const T *c, const vec3f &frac);
+
+      /*! out[i] = value at pos[i] read through 'layout', or '*outside' if
+        'outside' is given and pos[i] is outside the volume */
+      template <typename T>
+      void sampleTrilinear(const VoxelLayout<T> &layout,
+                           const vec3f *pos,
+                           T *out,
+                           size_t n,
+                           const T *outside);
+
+      /*! the float version gathers W positions at once with AVX2 and
+        AVX-512 (see dispatch.h) */
+      RKCOMMON_INTERFACE void sampleTrilinear(
+          const VoxelLayout<float> &layout,
+          const vec3f *pos,
+          float *out,
+          size_t n,
+          const float *outside);
+
+    }  // namespace detail
+
     /*! ABSTRACTION for a 3D array of data */
     template <typename value_t>
     struct Array3D
@@ -27,14 +115,28 @@ namespace rkcommon {
         nearest cell in volume if 'where' is outside) */
       virtual value_t get(const vec3i &where) const = 0;
 
+      /*! get the values of the 'count' cells starting at 'begin' along x,
+        as get() would return them. The default calls get() per cell;
+        implementations override it to copy or convert whole rows, so
+        bulk reads cost one virtual call per row instead of per cell */
+      virtual void getRow(const vec3i &begin, int count, value_t *out) const;
+
+      /*! get the values of all cells in [box.lower, box.upper), x
+        fastest, with one getRow() per row */
+      virtual void getBlock(const box3i &box, value_t *out) const;
+
+      /*! get the range of the values of the 'count' (at least one) cells
+        starting at 'begin' along x. The default reads them with
+        getRow() */
+      virtual range_t<value_t> getRowRange(const vec3i &begin,
+                                           int count) const;
+
       /*! get the range/interval of all cell values in the given
-        begin/end region of the volume */
-      range_t<value_t> getValueRange(const vec3i &begin, const vec3i &end) const
-      {
-        range_t<value_t> v = get(begin);
-        for_each(begin, end, [&](const vec3i &idx) { v.extend(get(idx)); });
-        return v;
-      }
+        begin/end region of the volume, reduced in parallel over tiles
+        of rows. Arrays that keep coarser ranges may answer it from
+        those */
+      virtual range_t<value_t> getValueRange(const vec3i &begin,
+                                             const vec3i &end) const;
 
       /*! get value range over entire volume */
       range_t<value_t> getValueRange() const
@@ -44,6 +146,50 @@ namespace rkcommon {
 
       /*! returns number of elements (as 64-bit int) across all dimensions */
       virtual size_t numElements() const = 0;
+
+      /*! coarse grid of value ranges for empty space skipping: macrocell
+        'c' holds the range of the cells in [c * cellSize, (c + 1) *
+        cellSize], clipped to the volume. The upper bound is inclusive,
+        so the range also bounds anything interpolated inside the
+        macrocell. Computed in parallel. */
+      std::shared_ptr<ActualArray3D<range_t<value_t>>> computeMacrocellGrid(
+          int cellSize) const;
+
+      /*! recompute the macrocells of 'grid' (from computeMacrocellGrid()
+        with the same 'cellSize') that overlap the cells in 'changed',
+        e.g. after some set() calls */
+      void updateMacrocellGrid(ActualArray3D<range_t<value_t>> &grid,
+                               int cellSize,
+                               const box3i &changed) const;
+
+      /*! trilinearly interpolated value at 'pos' in cell coordinates
+        (cell 'i' is at position 'i'), clamped to the volume like get().
+        Only for value types that can be interpolated, e.g. scalars and
+        vec3f; others throw. */
+      value_t sampleTrilinear(const vec3f &pos) const;
+
+      /*! sampleTrilinear() at the 'n' positions 'pos' */
+      void sampleTrilinear(const vec3f *pos, value_t *out, size_t n) const;
+
+      /*! sampleTrilinear() at the 'n' positions 'pos', but positions
+        outside [0, size() - 1] give 'outside' instead of being clamped */
+      void sampleTrilinear(const vec3f *pos,
+                           value_t *out,
+                           size_t n,
+                           const value_t &outside) const;
+
+     protected:
+      /*! the batch behind all sampleTrilinear() calls, 'outside' is null
+        for clamping. The default interpolates get() values; arrays that
+        own their voxels override it to read them directly. */
+      virtual void sampleTrilinearBatch(const vec3f *pos,
+                                        value_t *out,
+                                        size_t n,
+                                        const value_t *outside) const;
+
+     private:
+      range_t<value_t> getValueRangeSerial(const vec3i &begin,
+                                           const vec3i &end) const;
     };
 
     /*! implementation for an actual array3d that stores a 3D array of values */
@@ -51,11 +197,9 @@ namespace rkcommon {
     struct ActualArray3D : public Array3D<value_t>
     {
       ActualArray3D(const vec3i &dims, void *externalMem = nullptr);
-      ~ActualArray3D() override
-      {
-        if (valuesAreMine)
-          delete[] value;
-      }
+      /*! allocate the values with memory::numaAlignedMalloc() instead */
+      ActualArray3D(const vec3i &dims, memory::NumaPolicy numaPolicy);
+      ~ActualArray3D() override;
 
       /*! return size (ie, "dimensions") of volume */
       vec3i size() const override;
@@ -65,6 +209,18 @@ namespace rkcommon {
         \warning 'where' MUST be a valid cell location */
       value_t get(const vec3i &where) const override;
 
+      void getRow(const vec3i &begin, int count, value_t *out) const override;
+
+      range_t<value_t> getRowRange(const vec3i &begin,
+                                   int count) const override;
+
+      using Array3D<value_t>::sampleTrilinear;
+
+      /*! Array3D::sampleTrilinear() without the virtual call */
+      value_t sampleTrilinear(const vec3f &pos) const;
+
+      detail::VoxelLayout<value_t> voxelLayout() const;
+
       /*! set cell value at location to given value
 
         \warning 'where' MUST be a valid cell location */
@@ -86,6 +242,14 @@ namespace rkcommon {
       // bool that specified whether it was us that alloc'ed this mem,
       // and thus, whether we should free it upon termination.
       bool valuesAreMine;
+      // whether 'value' came from numaAlignedMalloc() rather than new[]
+      bool valuesAreNuma{false};
+
+     protected:
+      void sampleTrilinearBatch(const vec3f *pos,
+                                value_t *out,
+                                size_t n,
+                                const value_t *outside) const override;
     };
 
     /*! shifts another array3d by a given amount */
@@ -112,6 +276,20 @@ namespace rkcommon {
         return actual->get((where + size() + shift) % size());
       }
 
+      void getRow(const vec3i &begin, int count, value_t *out) const override
+      {
+        const vec3i dims = size();
+        vec3i where      = (begin + dims + shift) % dims;
+        // one piece up to the wrap around and one after it (per period)
+        while (count > 0) {
+          const int n = std::min(count, dims.x - where.x);
+          actual->getRow(where, n, out);
+          out += n;
+          count -= n;
+          where.x = 0;
+        }
+      }
+
       /*! set cell value at location to given value
 
         \warning 'where' MUST be a valid cell location */
@@ -145,6 +323,8 @@ namespace rkcommon {
         \warning 'where' MUST be a valid cell location */
       out_t get(const vec3i &where) const override;
 
+      void getRow(const vec3i &begin, int count, out_t *out) const override;
+
       /*! returns number of elements (as 64-bit int) across all dimensions */
       size_t numElements() const override;
 
@@ -169,6 +349,8 @@ namespace rkcommon {
         \warning 'where' MUST be a valid cell location */
       T get(const vec3i &where) const override;
 
+      void getRow(const vec3i &begin, int count, T *out) const override;
+
       /*! returns number of elements (as 64-bit int) across all dimensions */
       size_t numElements() const override;
 
@@ -204,6 +386,11 @@ namespace rkcommon {
         return actual->get(where + clipBox.lower);
       }
 
+      void getRow(const vec3i &begin, int count, value_t *out) const override
+      {
+        actual->getRow(begin + clipBox.lower, count, out);
+      }
+
       /*! set cell value at location to given value
 
         \warning 'where' MUST be a valid cell location */
@@ -248,6 +435,12 @@ namespace rkcommon {
             vec3i(where.x, where.y, 0));
       }
 
+      void getRow(const vec3i &begin, int count, value_t *out) const override
+      {
+        slice[clamp(begin.z, 0, (int)slice.size() - 1)]->getRow(
+            vec3i(begin.x, begin.y, 0), count, out);
+      }
+
       /*! set cell value at location to given value
 
         \warning 'where' MUST be a valid cell location */
@@ -273,16 +466,415 @@ namespace rkcommon {
     std::shared_ptr<Array3D<T>> RKCOMMON_INTERFACE
     loadRAW(const std::string &fileName, const vec3i &dims);
 
-    /*! load raw file with given dimensions. the 'type' of the raw
-      file (uint8,float,...) is given through the function's
-      template parameter */
-    template <typename T>
-    std::shared_ptr<Array3D<T>> RKCOMMON_INTERFACE
-    mmapRAW(const std::string &fileName, const vec3i &dims);
 #endif
 
+    namespace detail {
+      // holds the mapping while ActualArray3D is constructed on top of it
+      template <typename T>
+      struct MappedValues
+      {
+        template <typename... Args>
+        MappedValues(Args &&... args) : values(std::forward<Args>(args)...)
+        {
+        }
+
+        utility::MappedArray<T> values;
+      };
+    }  // namespace detail
+
+    /*! ActualArray3D on a memory mapped raw file, voxels are read in on
+        first access. COPY_ON_WRITE keeps set() working without ever
+        writing back to the file. */
+    template <typename value_t>
+    struct MappedArray3D : private detail::MappedValues<value_t>,
+                           public ActualArray3D<value_t>
+    {
+      MappedArray3D(const std::string &fileName,
+                    const vec3i &dims,
+                    utility::MapMode mode = utility::MapMode::COPY_ON_WRITE,
+                    size_t offset         = 0);
+    };
+
+    /*! map raw file with given dimensions instead of loading it. the
+      'type' of the raw file (uint8,float,...) is given through the
+      function's template parameter */
+    template <typename T>
+    std::shared_ptr<Array3D<T>> mmapRAW(const std::string &fileName,
+                                        const vec3i &dims);
+
+    /*! @{ whole array operations, run in parallel over tiles of whole
+      rows with one getRow() per row (converted in stack sized pieces
+      where the types differ) */
+
+    /*! copy 'source' into 'dest' of the same size, converting the values
+      to out_t */
+    template <typename in_t, typename out_t>
+    void copy(const Array3D<in_t> &source, ActualArray3D<out_t> &dest);
+
+    /*! set all values of 'dest' to 't' */
+    template <typename T>
+    void fill(ActualArray3D<T> &dest, const T &t);
+
+    /*! copy 'source', e.g. an Array3DAccessor view, into a new
+      ActualArray3D of out_t (of in_t by default). The values are placed
+      by 'numaPolicy'; with FIRST_TOUCH_PARALLEL they are spread like
+      the rows of parallel loops over the array. */
+    template <typename out_t = void, typename in_t>
+    std::shared_ptr<ActualArray3D<
+        typename std::conditional<std::is_void<out_t>::value, in_t, out_t>::
+            type>>
+    materialize(const Array3D<in_t> &source,
+                memory::NumaPolicy numaPolicy =
+                    memory::NumaPolicy::FIRST_TOUCH_PARALLEL);
+    /*! @} */
+
     // Inlined definitions ////////////////////////////////////////////////////
 
+    namespace detail {
+
+      // range of v[0, n), n >= 1
+      template <typename T>
+      inline typename std::enable_if<!std::is_arithmetic<T>::value,
+                                     range_t<T>>::type
+      rangeOf(const T *v, size_t n)
+      {
+        range_t<T> r(v[0]);
+        for (size_t i = 1; i < n; i++)
+          r.extend(v[i]);
+        return r;
+      }
+
+      // with independent lanes the compiler turns into SIMD min/max
+      template <typename T>
+      inline typename std::enable_if<std::is_arithmetic<T>::value,
+                                     range_t<T>>::type
+      rangeOf(const T *v, size_t n)
+      {
+        constexpr size_t LANES = 64 / sizeof(T);
+        T lo[LANES], hi[LANES];
+        for (size_t j = 0; j < LANES; j++)
+          lo[j] = hi[j] = v[0];
+
+        size_t i = 0;
+        for (; i + LANES <= n; i += LANES)
+          for (size_t j = 0; j < LANES; j++) {
+            lo[j] = v[i + j] < lo[j] ? v[i + j] : lo[j];
+            hi[j] = hi[j] < v[i + j] ? v[i + j] : hi[j];
+          }
+        for (; i < n; i++) {
+          lo[0] = v[i] < lo[0] ? v[i] : lo[0];
+          hi[0] = hi[0] < v[i] ? v[i] : hi[0];
+        }
+
+        range_t<T> r(lo[0], hi[0]);
+        for (size_t j = 1; j < LANES; j++)
+          r.extend(range_t<T>(lo[j], hi[j]));
+        return r;
+      }
+
+      // compilers keep float ?: scalar without fast-math, use packets,
+      // tagged like them as the code differs between instruction sets
+      inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+        inline range_t<float> rangeOf(const float *v, size_t n)
+        {
+          using vfloat4 = math::vfloat<4>;
+          vfloat4 lo[4], hi[4];
+          for (int j = 0; j < 4; j++)
+            lo[j] = hi[j] = vfloat4(v[0]);
+
+          size_t i = 0;
+          for (; i + 16 <= n; i += 16)
+            for (int j = 0; j < 4; j++) {
+              const vfloat4 x = vfloat4::loadu(v + i + 4 * j);
+              lo[j]           = min(lo[j], x);
+              hi[j]           = max(hi[j], x);
+            }
+
+          const vfloat4 l = min(min(lo[0], lo[1]), min(lo[2], lo[3]));
+          const vfloat4 h = max(max(hi[0], hi[1]), max(hi[2], hi[3]));
+          range_t<float> r(reduce_min(l), reduce_max(h));
+          for (; i < n; i++)
+            r.extend(v[i]);
+          return r;
+        }
+
+      }  // namespace RKCOMMON_PACKET_NAMESPACE
+
+      // regions of up to this many cells are reduced serially
+      constexpr size_t VALUE_RANGE_SERIAL_CELLS = 64 * 1024;
+
+      template <typename T>
+      inline VoxelLayout<T>::VoxelLayout(const T *values,
+                                         const vec3i &dims,
+                                         const vec3i &bricks,
+                                         int brickShift)
+          : values(values),
+            dims(dims),
+            brickShift(brickShift),
+            brickStride(size_t(1) << 3 * brickShift,
+                        size_t(bricks.x) << 3 * brickShift,
+                        size_t(bricks.x) * bricks.y << 3 * brickShift)
+      {
+      }
+
+      template <typename T>
+      inline size_t VoxelLayout<T>::offset(int axis, int p) const
+      {
+        const int local = p & ((1 << brickShift) - 1);
+        return size_t(p >> brickShift) * brickStride[axis] +
+               (size_t(local) << axis * brickShift);
+      }
+
+      inline bool trilinearCell(const vec3f &pos,
+                                const vec3i &dims,
+                                vec3i &lower,
+                                vec3i &upper,
+                                vec3f &frac)
+      {
+        bool inside = true;
+        for (int a = 0; a < 3; a++) {
+          const float last = float(dims[a] - 1);
+          inside = inside && pos[a] >= 0.f && pos[a] <= last;
+          // NaN ends up at 0 as well
+          const float p = pos[a] > 0.f ? std::min(pos[a], last) : 0.f;
+          lower[a]      = int(p);
+          upper[a]      = std::min(lower[a] + 1, dims[a] - 1);
+          frac[a]       = p - float(lower[a]);
+        }
+        return inside;
+      }
+
+      template <typename T, typename I>
+      inline typename std::enable_if<std::is_integral<T>::value, T>::type
+      fromInterpolant(const I &v)
+      {
+        return T(v < 0.f ? v - 0.5f : v + 0.5f);
+      }
+
+      template <typename T, typename I>
+      inline typename std::enable_if<!std::is_integral<T>::value, T>::type
+      fromInterpolant(const I &v)
+      {
+        return T(v);
+      }
+
+      template <typename T>
+      inline T trilinear(const T *c, const vec3f &f)
+      {
+        using I     = interpolant_t<T>;
+        const I x00 = (1.f - f.x) * c[0] + f.x * c[1];
+        const I x10 = (1.f - f.x) * c[2] + f.x * c[3];
+        const I x01 = (1.f - f.x) * c[4] + f.x * c[5];
+        const I x11 = (1.f - f.x) * c[6] + f.x * c[7];
+        const I y0  = (1.f - f.y) * x00 + f.y * x10;
+        const I y1  = (1.f - f.y) * x01 + f.y * x11;
+        return fromInterpolant<T>((1.f - f.z) * y0 + f.z * y1);
+      }
+
+      /* the sampling loop, with 'fetch(lower, upper, c)' reading the
+         corners of a cell */
+      template <typename T, typename FetchFcn>
+      inline void sampleTrilinearWith(const vec3i &dims,
+                                      const FetchFcn &fetch,
+                                      const vec3f *pos,
+                                      T *out,
+                                      size_t n,
+                                      const T *outside,
+                                      std::true_type)
+      {
+        for (size_t i = 0; i < n; i++) {
+          vec3i lower, upper;
+          vec3f frac;
+          if (!trilinearCell(pos[i], dims, lower, upper, frac) && outside) {
+            out[i] = *outside;
+            continue;
+          }
+          T c[8];
+          fetch(lower, upper, c);
+          out[i] = trilinear(c, frac);
+        }
+      }
+
+      template <typename T, typename FetchFcn>
+      inline void sampleTrilinearWith(const vec3i &,
+                                      const FetchFcn &,
+                                      const vec3f *,
+                                      T *,
+                                      size_t,
+                                      const T *,
+                                      std::false_type)
+      {
+        throw std::runtime_error(
+            "sampleTrilinear(): the value type cannot be interpolated");
+      }
+
+      template <typename T>
+      inline void sampleTrilinear(const VoxelLayout<T> &layout,
+                                  const vec3f *pos,
+                                  T *out,
+                                  size_t n,
+                                  const T *outside)
+      {
+        const T *v = layout.values;
+        auto fetch = [&](const vec3i &lower, const vec3i &upper, T *c) {
+          const size_t x0 = layout.offset(0, lower.x);
+          const size_t x1 = layout.offset(0, upper.x);
+          const size_t y0 = layout.offset(1, lower.y);
+          const size_t y1 = layout.offset(1, upper.y);
+          const size_t z0 = layout.offset(2, lower.z);
+          const size_t z1 = layout.offset(2, upper.z);
+          c[0]            = v[x0 + y0 + z0];
+          c[1]            = v[x1 + y0 + z0];
+          c[2]            = v[x0 + y1 + z0];
+          c[3]            = v[x1 + y1 + z0];
+          c[4]            = v[x0 + y0 + z1];
+          c[5]            = v[x1 + y0 + z1];
+          c[6]            = v[x0 + y1 + z1];
+          c[7]            = v[x1 + y1 + z1];
+        };
+        sampleTrilinearWith(
+            layout.dims, fetch, pos, out, n, outside, is_interpolatable<T>());
+      }
+
+    }  // namespace detail
+
+    // Array3D //
+
+    template <typename T>
+    inline void Array3D<T>::getRow(const vec3i &begin, int count, T *out) const
+    {
+      for (int i = 0; i < count; i++)
+        out[i] = get(vec3i(begin.x + i, begin.y, begin.z));
+    }
+
+    template <typename T>
+    inline void Array3D<T>::getBlock(const box3i &box, T *out) const
+    {
+      const vec3i dims = box.size();
+      if (anyLessThan(dims, vec3i(1)))
+        return;
+
+      for (int z = box.lower.z; z < box.upper.z; z++)
+        for (int y = box.lower.y; y < box.upper.y; y++) {
+          getRow(vec3i(box.lower.x, y, z), dims.x, out);
+          out += dims.x;
+        }
+    }
+
+    template <typename T>
+    inline range_t<T> Array3D<T>::getRowRange(const vec3i &begin,
+                                              int count) const
+    {
+      // read in stack sized pieces
+      constexpr int chunkSize = 256;
+      T values[chunkSize];
+      range_t<T> r;
+      for (int i = 0; i < count; i += chunkSize) {
+        const int n = std::min(chunkSize, count - i);
+        getRow(vec3i(begin.x + i, begin.y, begin.z), n, values);
+        const range_t<T> chunk = detail::rangeOf(values, n);
+        r = i == 0 ? chunk : range_t<T>(min(r.lower, chunk.lower),
+                                        max(r.upper, chunk.upper));
+      }
+      return r;
+    }
+
+    template <typename T>
+    inline range_t<T> Array3D<T>::getValueRangeSerial(const vec3i &begin,
+                                                      const vec3i &end) const
+    {
+      range_t<T> v = getRowRange(begin, end.x - begin.x);
+      for (int z = begin.z; z < end.z; z++)
+        for (int y = begin.y; y < end.y; y++)
+          v.extend(getRowRange(vec3i(begin.x, y, z), end.x - begin.x));
+      return v;
+    }
+
+    template <typename T>
+    inline range_t<T> Array3D<T>::getValueRange(const vec3i &begin,
+                                                const vec3i &end) const
+    {
+      if (anyLessThan(end, begin + 1))
+        return get(begin);
+
+      const vec3i dims = end - begin;
+      if (longProduct(dims) <= detail::VALUE_RANGE_SERIAL_CELLS)
+        return getValueRangeSerial(begin, end);
+
+      // tiles of whole rows, about VALUE_RANGE_SERIAL_CELLS each
+      const int rows = std::max<int>(
+          1, int(detail::VALUE_RANGE_SERIAL_CELLS / size_t(dims.x)));
+      const vec2i tile(std::min(dims.y, rows),
+                       std::max(1, std::min(dims.z, rows / dims.y)));
+      const vec2i tiles((dims.y + tile.x - 1) / tile.x,
+                        (dims.z + tile.y - 1) / tile.y);
+
+      // any value of the region is neutral for the union of ranges
+      const range_t<T> first = get(begin);
+      return tasking::parallel_reduce(
+          size_t(tiles.x) * tiles.y,
+          first,
+          [&](size_t i) {
+            const vec3i lower(begin.x,
+                              begin.y + int(i % tiles.x) * tile.x,
+                              begin.z + int(i / tiles.x) * tile.y);
+            const vec3i upper(end.x,
+                              std::min(end.y, lower.y + tile.x),
+                              std::min(end.z, lower.z + tile.y));
+            return getValueRangeSerial(lower, upper);
+          },
+          [](const range_t<T> &a, const range_t<T> &b) {
+            return range_t<T>(min(a.lower, b.lower), max(a.upper, b.upper));
+          });
+    }
+
+    template <typename T>
+    inline T Array3D<T>::sampleTrilinear(const vec3f &pos) const
+    {
+      T result;
+      sampleTrilinearBatch(&pos, &result, 1, nullptr);
+      return result;
+    }
+
+    template <typename T>
+    inline void Array3D<T>::sampleTrilinear(const vec3f *pos,
+                                            T *out,
+                                            size_t n) const
+    {
+      sampleTrilinearBatch(pos, out, n, nullptr);
+    }
+
+    template <typename T>
+    inline void Array3D<T>::sampleTrilinear(const vec3f *pos,
+                                            T *out,
+                                            size_t n,
+                                            const T &outside) const
+    {
+      sampleTrilinearBatch(pos, out, n, &outside);
+    }
+
+    template <typename T>
+    inline void Array3D<T>::sampleTrilinearBatch(const vec3f *pos,
+                                                 T *out,
+                                                 size_t n,
+                                                 const T *outside) const
+    {
+      auto fetch = [&](const vec3i &lower, const vec3i &upper, T *c) {
+        for (int i = 0; i < 8; i++)
+          c[i] = get(vec3i(i & 1 ? upper.x : lower.x,
+                           i & 2 ? upper.y : lower.y,
+                           i & 4 ? upper.z : lower.z));
+      };
+      detail::sampleTrilinearWith(size(),
+                                  fetch,
+                                  pos,
+                                  out,
+                                  n,
+                                  outside,
+                                  detail::is_interpolatable<T>());
+    }
+
     // ActualArray3D //
 
     template <typename T>
@@ -304,6 +896,63 @@ namespace rkcommon {
       return v;
     }
 
+    template <typename T>
+    inline void ActualArray3D<T>::getRow(const vec3i &begin,
+                                         int count,
+                                         T *out) const
+    {
+      // clamped like get(): the row, then its ends across x
+      const T *row = value + indexOf(vec3i(0,
+                                           clamp(begin.y, 0, dims.y - 1),
+                                           clamp(begin.z, 0, dims.z - 1)));
+      int i = 0;
+      for (; i < count && begin.x + i < 0; i++)
+        out[i] = row[0];
+      const int inside = std::min(count, dims.x - begin.x);
+      if (inside > i) {
+        std::copy(row + begin.x + i, row + begin.x + inside, out + i);
+        i = inside;
+      }
+      for (; i < count; i++)
+        out[i] = row[dims.x - 1];
+    }
+
+    template <typename T>
+    inline range_t<T> ActualArray3D<T>::getRowRange(const vec3i &begin,
+                                                    int count) const
+    {
+      // get() clamps, so only the inside part of the row matters
+      const T *row = value + indexOf(vec3i(0,
+                                           clamp(begin.y, 0, dims.y - 1),
+                                           clamp(begin.z, 0, dims.z - 1)));
+      const int lower = clamp(begin.x, 0, dims.x - 1);
+      const int upper = clamp(begin.x + count - 1, 0, dims.x - 1);
+      return detail::rangeOf(row + lower, size_t(upper - lower + 1));
+    }
+
+    template <typename T>
+    inline T ActualArray3D<T>::sampleTrilinear(const vec3f &pos) const
+    {
+      T result;
+      detail::sampleTrilinear<T>(voxelLayout(), &pos, &result, 1, nullptr);
+      return result;
+    }
+
+    template <typename T>
+    inline detail::VoxelLayout<T> ActualArray3D<T>::voxelLayout() const
+    {
+      return detail::VoxelLayout<T>(value, dims, dims, 0);
+    }
+
+    template <typename T>
+    inline void ActualArray3D<T>::sampleTrilinearBatch(const vec3f *pos,
+                                                       T *out,
+                                                       size_t n,
+                                                       const T *outside) const
+    {
+      detail::sampleTrilinear(voxelLayout(), pos, out, n, outside);
+    }
+
     template <typename T>
     inline size_t ActualArray3D<T>::numElements() const
     {
@@ -329,6 +978,40 @@ namespace rkcommon {
       }
     }
 
+    template <typename T>
+    inline ActualArray3D<T>::ActualArray3D(const vec3i &dims,
+                                           memory::NumaPolicy numaPolicy)
+        : dims(dims), value(nullptr), valuesAreMine(true), valuesAreNuma(true)
+    {
+      const size_t numVoxels = longProduct(dims);
+      value                  = (T *)memory::numaAlignedMalloc(
+          numVoxels * sizeof(T), std::max<size_t>(alignof(T), 64), numaPolicy);
+      if (!value) {
+        std::stringstream ss;
+        ss << "could not allocate memory for Array3D of dimensions " << dims
+           << " (in Array3D::Array3D())";
+        throw std::runtime_error(ss.str());
+      }
+      for (size_t i = 0; i < numVoxels; ++i)
+        new (value + i) T;
+    }
+
+    template <typename T>
+    inline ActualArray3D<T>::~ActualArray3D()
+    {
+      if (!valuesAreMine)
+        return;
+
+      if (valuesAreNuma) {
+        const size_t numVoxels = numElements();
+        for (size_t i = 0; i < numVoxels; ++i)
+          value[i].~T();
+        memory::numaAlignedFree(value, numVoxels * sizeof(T));
+      } else {
+        delete[] value;
+      }
+    }
+
     template <typename T>
     inline void ActualArray3D<T>::set(const vec3i &where, const T &t)
     {
@@ -338,7 +1021,150 @@ namespace rkcommon {
     template <typename T>
     inline void ActualArray3D<T>::clear(const T &t)
     {
-      for_each(size(), [&](const vec3i &idx) { set(idx, t); });
+      array3D::fill(*this, t);
+    }
+
+    // Whole array operations //
+
+    namespace detail {
+
+      /*! calls 'fcn(y, z)' for all rows of an array of 'dims' in parallel,
+        in tiles of consecutive rows of about VALUE_RANGE_SERIAL_CELLS
+        cells, so each tile covers a contiguous range of the values */
+      template <typename FCN_T>
+      inline void parallel_for_rows(const vec3i &dims, FCN_T &&fcn)
+      {
+        if (anyLessThan(dims, vec3i(1)))
+          return;
+
+        const int rows = std::max<int>(
+            1, int(VALUE_RANGE_SERIAL_CELLS / size_t(dims.x)));
+        const vec2i tile(std::min(dims.y, rows),
+                         std::max(1, std::min(dims.z, rows / dims.y)));
+        tasking::parallel_for_tiled(
+            vec2i(0), vec2i(dims.y, dims.z), tile, [&](const box2i &t) {
+              for (int z = t.lower.y; z < t.upper.y; z++)
+                for (int y = t.lower.x; y < t.upper.x; y++)
+                  fcn(y, z);
+            });
+      }
+
+      template <typename T>
+      inline void getRowAs(const Array3D<T> &source,
+                           const vec3i &begin,
+                           int count,
+                           T *out)
+      {
+        source.getRow(begin, count, out);
+      }
+
+      // converted in stack sized pieces, as Array3DAccessor::getRow()
+      template <typename in_t, typename out_t>
+      inline void getRowAs(const Array3D<in_t> &source,
+                           const vec3i &begin,
+                           int count,
+                           out_t *out)
+      {
+        constexpr int chunkSize = 256;
+        in_t in[chunkSize];
+        for (int i = 0; i < count; i += chunkSize) {
+          const int n = std::min(chunkSize, count - i);
+          source.getRow(vec3i(begin.x + i, begin.y, begin.z), n, in);
+          // a plain loop, vectorized for arithmetic types
+          for (int j = 0; j < n; j++)
+            out[i + j] = static_cast<out_t>(in[j]);
+        }
+      }
+
+    }  // namespace detail
+
+    template <typename in_t, typename out_t>
+    inline void copy(const Array3D<in_t> &source, ActualArray3D<out_t> &dest)
+    {
+      if (source.size() != dest.dims)
+        throw std::runtime_error("array3D::copy(): the sizes differ");
+
+      detail::parallel_for_rows(dest.dims, [&](int y, int z) {
+        const vec3i begin(0, y, z);
+        detail::getRowAs(
+            source, begin, dest.dims.x, dest.value + dest.indexOf(begin));
+      });
+    }
+
+    template <typename T>
+    inline void fill(ActualArray3D<T> &dest, const T &t)
+    {
+      detail::parallel_for_rows(dest.dims, [&](int y, int z) {
+        T *row = dest.value + dest.indexOf(vec3i(0, y, z));
+        std::fill(row, row + dest.dims.x, t);
+      });
+    }
+
+    template <typename out_t, typename in_t>
+    inline std::shared_ptr<ActualArray3D<
+        typename std::conditional<std::is_void<out_t>::value, in_t, out_t>::
+            type>>
+    materialize(const Array3D<in_t> &source, memory::NumaPolicy numaPolicy)
+    {
+      using value_t = typename std::
+          conditional<std::is_void<out_t>::value, in_t, out_t>::type;
+      auto result =
+          std::make_shared<ActualArray3D<value_t>>(source.size(), numaPolicy);
+      array3D::copy(source, *result);
+      return result;
+    }
+
+    // Array3D macrocells //
+
+    template <typename T>
+    inline std::shared_ptr<ActualArray3D<range_t<T>>>
+    Array3D<T>::computeMacrocellGrid(int cellSize) const
+    {
+      if (cellSize < 1)
+        throw std::runtime_error("computeMacrocellGrid(): invalid cell size");
+
+      const vec3i gridDims = (size() + cellSize - 1) / cellSize;
+      auto grid = std::make_shared<ActualArray3D<range_t<T>>>(gridDims);
+      updateMacrocellGrid(*grid, cellSize, box3i(vec3i(0), size()));
+      return grid;
+    }
+
+    template <typename T>
+    inline void Array3D<T>::updateMacrocellGrid(
+        ActualArray3D<range_t<T>> &grid,
+        int cellSize,
+        const box3i &changed) const
+    {
+      const vec3i dims = size();
+      // macrocell c covers cells [c * cellSize, (c + 1) * cellSize]
+      const box3i cells(max((changed.lower - 1) / cellSize, vec3i(0)),
+                        min((changed.upper - 1) / cellSize + 1, grid.dims));
+
+      tasking::parallel_for(longProduct(cells.size()), [&](size_t i) {
+        const vec3i c     = cells.lower + coordsOf(i, cells.size());
+        const vec3i lower = c * cellSize;
+        const vec3i upper = min(lower + cellSize + 1, dims);
+        grid.set(c, getValueRangeSerial(lower, upper));
+      });
+    }
+
+    // MappedArray3D //
+
+    template <typename T>
+    inline MappedArray3D<T>::MappedArray3D(const std::string &fileName,
+                                           const vec3i &dims,
+                                           utility::MapMode mode,
+                                           size_t offset)
+        : detail::MappedValues<T>(fileName, mode, offset, longProduct(dims)),
+          ActualArray3D<T>(dims, detail::MappedValues<T>::values.data())
+    {
+    }
+
+    template <typename T>
+    inline std::shared_ptr<Array3D<T>> mmapRAW(const std::string &fileName,
+                                               const vec3i &dims)
+    {
+      return std::make_shared<MappedArray3D<T>>(fileName, dims);
     }
 
     // Array3DAccessor //
@@ -362,6 +1188,22 @@ namespace rkcommon {
       return (out_t)actual->get(where);
     }
 
+    template <typename in_t, typename out_t>
+    inline void Array3DAccessor<in_t, out_t>::getRow(const vec3i &begin,
+                                                     int count,
+                                                     out_t *out) const
+    {
+      // converted in stack sized pieces
+      constexpr int chunkSize = 256;
+      in_t in[chunkSize];
+      for (int i = 0; i < count; i += chunkSize) {
+        const int n = std::min(chunkSize, count - i);
+        actual->getRow(vec3i(begin.x + i, begin.y, begin.z), n, in);
+        for (int j = 0; j < n; j++)
+          out[i + j] = (out_t)in[j];
+      }
+    }
+
     template <typename in_t, typename out_t>
     inline size_t Array3DAccessor<in_t, out_t>::numElements() const
     {
@@ -401,6 +1243,35 @@ namespace rkcommon {
       return actual->get(where);
     }
 
+    template <typename T>
+    inline void Array3DRepeater<T>::getRow(const vec3i &begin,
+                                           int count,
+                                           T *out) const
+    {
+      const vec3i where = begin % repeatedSize;
+      const vec3i flip  = (begin / repeatedSize) % 2;
+      const vec3i src(where.x,
+                      flip.y ? repeatedSize.y - 1 - where.y : where.y,
+                      flip.z ? repeatedSize.z - 1 - where.z : where.z);
+
+      // runs of the same mirroring along x, reversed if mirrored
+      int x = begin.x;
+      while (count > 0) {
+        const int wx = x % repeatedSize.x;
+        const int n  = std::min(count, repeatedSize.x - wx);
+        if ((x / repeatedSize.x) % 2) {
+          actual->getRow(
+              vec3i(repeatedSize.x - wx - n, src.y, src.z), n, out);
+          std::reverse(out, out + n);
+        } else {
+          actual->getRow(vec3i(wx, src.y, src.z), n, out);
+        }
+        out += n;
+        count -= n;
+        x += n;
+      }
+    }
+
     template <typename T>
     inline size_t Array3DRepeater<T>::numElements() const
     {
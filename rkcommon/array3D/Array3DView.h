@@ -0,0 +1,274 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include "Array3D.h"
+
+/*! \file array3D/Array3DView.h Non-virtual counterparts of the
+    Array3DAccessor, SubBoxArray3D, Array3DRepeater and IndexShiftedArray3D
+    wrappers.
+
+    A view is any small copyable type with a 'value_type', size() and a
+    get() that clamps like Array3D::get(). Views hold the view they adapt by
+    value, so a stack like
+
+      subBox(repeat(convert<float>(volume), dims), box)
+
+    is one type whose get() inlines into for_each() loops, with no virtual
+    calls or reference counts on the way. The innermost view only refers to
+    its array, which has to outlive the views built on it. makeArray3D()
+    turns a view back into an Array3D where the interface is needed. */
+
+namespace rkcommon {
+  namespace array3D {
+
+    namespace detail {
+
+      template <typename T>
+      std::true_type isArray3D(const Array3D<T> *);
+      std::false_type isArray3D(...);
+
+      template <typename A>
+      using is_array3d = decltype(isArray3D(std::declval<const A *>()));
+
+    }  // namespace detail
+
+    /*! view of an array3d of type A. Unless A is abstract, get() calls
+        A::get() directly instead of through the vtable, so A has to be the
+        type the array was created as (or one that does not override
+        get()) */
+    template <typename A>
+    struct ArrayRefView
+    {
+      using value_type = decltype(std::declval<const A &>().get(vec3i()));
+
+      explicit ArrayRefView(const A &array) : array(&array) {}
+
+      vec3i size() const
+      {
+        return array->size();
+      }
+
+      value_type get(const vec3i &where) const
+      {
+        return get(where, std::is_abstract<A>());
+      }
+
+     private:
+      value_type get(const vec3i &where, std::false_type) const
+      {
+        return array->A::get(where);
+      }
+
+      value_type get(const vec3i &where, std::true_type) const
+      {
+        return array->get(where);
+      }
+
+      const A *array;
+    };
+
+    /*! makes a view of one value type look like one of another type, like
+        Array3DAccessor */
+    template <typename V, typename out_t>
+    struct ConvertView
+    {
+      using value_type = out_t;
+
+      explicit ConvertView(const V &source) : source(source) {}
+
+      vec3i size() const
+      {
+        return source.size();
+      }
+
+      out_t get(const vec3i &where) const
+      {
+        return (out_t)source.get(where);
+      }
+
+      const V source;
+    };
+
+    /*! the cells of a view inside 'clipBox', like SubBoxArray3D */
+    template <typename V>
+    struct SubBoxView
+    {
+      using value_type = typename V::value_type;
+
+      SubBoxView(const V &source, const box3i &clipBox)
+          : source(source), clipBox(clipBox)
+      {
+      }
+
+      vec3i size() const
+      {
+        return clipBox.size();
+      }
+
+      value_type get(const vec3i &where) const
+      {
+        return source.get(where + clipBox.lower);
+      }
+
+      const V source;
+      const box3i clipBox;
+    };
+
+    /*! a view of size 'dims' that repeats the source view, mirrored on
+        every other period so there are no seams (as Array3DRepeater does) */
+    template <typename V>
+    struct RepeatView
+    {
+      using value_type = typename V::value_type;
+
+      RepeatView(const V &source, const vec3i &dims)
+          : source(source), dims(dims), period(source.size())
+      {
+      }
+
+      vec3i size() const
+      {
+        return dims;
+      }
+
+      value_type get(const vec3i &_where) const
+      {
+        vec3i where         = _where % period;
+        const vec3i flipped = (_where / period) % 2;
+        if (flipped.x)
+          where.x = period.x - 1 - where.x;
+        if (flipped.y)
+          where.y = period.y - 1 - where.y;
+        if (flipped.z)
+          where.z = period.z - 1 - where.z;
+        return source.get(where);
+      }
+
+      const V source;
+      const vec3i dims;
+      const vec3i period;
+    };
+
+    /*! a view shifted by 'shift' cells with wrap around, like
+        IndexShiftedArray3D */
+    template <typename V>
+    struct ShiftView
+    {
+      using value_type = typename V::value_type;
+
+      ShiftView(const V &source, const vec3i &shift)
+          : source(source), shift(shift)
+      {
+      }
+
+      vec3i size() const
+      {
+        return source.size();
+      }
+
+      value_type get(const vec3i &where) const
+      {
+        const vec3i dims = source.size();
+        return source.get((where + dims + shift) % dims);
+      }
+
+      const V source;
+      const vec3i shift;
+    };
+
+    /*! implements the Array3D interface on top of a view, which it owns */
+    template <typename V>
+    struct ViewArray3D : public Array3D<typename V::value_type>
+    {
+      using value_t = typename V::value_type;
+
+      explicit ViewArray3D(const V &view) : view(view) {}
+
+      /*! return size (ie, "dimensions") of volume */
+      vec3i size() const override
+      {
+        return view.size();
+      }
+
+      /*! get cell value at location
+
+        \warning 'where' MUST be a valid cell location */
+      value_t get(const vec3i &where) const override
+      {
+        return view.get(where);
+      }
+
+      void getRow(const vec3i &begin, int count, value_t *out) const override
+      {
+        for (int i = 0; i < count; i++)
+          out[i] = view.get(vec3i(begin.x + i, begin.y, begin.z));
+      }
+
+      /*! returns number of elements (as 64-bit int) across all dimensions */
+      size_t numElements() const override
+      {
+        return longProduct(view.size());
+      }
+
+      const V view;
+    };
+
+    // Factories //////////////////////////////////////////////////////////////
+
+    /*! view of an array3d, referencing it */
+    template <typename A>
+    inline typename std::enable_if<detail::is_array3d<A>::value,
+                                   ArrayRefView<A>>::type
+    view(const A &array)
+    {
+      return ArrayRefView<A>(array);
+    }
+
+    /*! views are their own views */
+    template <typename V>
+    inline typename std::enable_if<!detail::is_array3d<V>::value, V>::type
+    view(const V &v)
+    {
+      return v;
+    }
+
+    template <typename S>
+    using view_t = decltype(view(std::declval<const S &>()));
+
+    template <typename out_t, typename S>
+    inline ConvertView<view_t<S>, out_t> convert(const S &source)
+    {
+      return ConvertView<view_t<S>, out_t>(view(source));
+    }
+
+    template <typename S>
+    inline SubBoxView<view_t<S>> subBox(const S &source, const box3i &clipBox)
+    {
+      return SubBoxView<view_t<S>>(view(source), clipBox);
+    }
+
+    template <typename S>
+    inline RepeatView<view_t<S>> repeat(const S &source, const vec3i &dims)
+    {
+      return RepeatView<view_t<S>>(view(source), dims);
+    }
+
+    template <typename S>
+    inline ShiftView<view_t<S>> shift(const S &source, const vec3i &shift)
+    {
+      return ShiftView<view_t<S>>(view(source), shift);
+    }
+
+    template <typename S>
+    inline std::shared_ptr<Array3D<typename view_t<S>::value_type>>
+    makeArray3D(const S &source)
+    {
+      return std::make_shared<ViewArray3D<view_t<S>>>(view(source));
+    }
+
+  }  // namespace array3D
+}  // namespace rkcommon
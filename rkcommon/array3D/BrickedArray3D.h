@@ -0,0 +1,354 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include "../containers/UninitVector.h"
+#include "../tasking/parallel_for.h"
+#include "Array3D.h"
+
+namespace rkcommon {
+  namespace array3D {
+
+    /*! array3d that stores its values in bricks of BRICK_SIZE^3 voxels
+        instead of one x-fastest slab (see ActualArray3D). Each brick is
+        contiguous (x fastest within the brick) and the bricks follow each
+        other x fastest, so the neighbors of a voxel in all three directions
+        are usually in the same few cache lines, which makes gradient and
+        trilinear lookups much cheaper than the dims.x*dims.y strides of the
+        linear layout. The values are backed by huge pages where possible,
+        without them the TLB misses of scattered lookups eat most of the
+        gain.
+
+        Bricks along the upper faces of the volume are padded to full size;
+        the padding voxels are value initialized and never read by get(). */
+    template <typename value_t, int BRICK_SIZE = 8>
+    struct BrickedArray3D : public Array3D<value_t>
+    {
+      static_assert(BRICK_SIZE >= 2 && (BRICK_SIZE & (BRICK_SIZE - 1)) == 0,
+                    "BrickedArray3D brick size must be a power of two");
+
+      BrickedArray3D(const vec3i &dims);
+      /*! bricked copy of 'source', converted in parallel */
+      explicit BrickedArray3D(const ActualArray3D<value_t> &source);
+      explicit BrickedArray3D(const Array3D<value_t> &source);
+
+      /*! return size (ie, "dimensions") of volume */
+      vec3i size() const override;
+
+      /*! get cell value at given location, clamped to the volume */
+      value_t get(const vec3i &where) const override;
+
+      void getRow(const vec3i &begin, int count, value_t *out) const override;
+
+      using Array3D<value_t>::sampleTrilinear;
+
+      /*! Array3D::sampleTrilinear() without the virtual call */
+      value_t sampleTrilinear(const vec3f &pos) const;
+
+      detail::VoxelLayout<value_t> voxelLayout() const;
+
+      /*! set cell value at location to given value
+
+        \warning 'where' MUST be a valid cell location */
+      void set(const vec3i &where, const value_t &t);
+
+      void clear(const value_t &t);
+
+      /*! returns number of elements (as 64-bit int) across all dimensions */
+      size_t numElements() const override;
+
+      /* compute the (1D) index into 'value' for a (3D) grid coordinate */
+      size_t indexOf(const vec3i &pos) const;
+
+      /*! steps from indexOf(lower) to the indices of lower + (1, 0, 0),
+          lower + (0, 1, 0) and lower + (0, 0, 1), which also combine, so
+          the eight corners of the cell at 'lower' (e.g. for trilinear
+          interpolation) cost one indexOf(). 'lower + 1' must be valid. */
+      vec3ul cellOffsets(const vec3i &lower) const;
+
+      /*! copy all values into 'dest' (of the same size) in parallel */
+      void copyTo(ActualArray3D<value_t> &dest) const;
+
+      // Brick level access //
+
+      /*! number of bricks along each dimension */
+      vec3i numBricks() const;
+
+      /*! the voxels covered by 'brick', clipped to the volume */
+      box3i brickBounds(const vec3i &brick) const;
+
+      /*! the BRICK_SIZE^3 values of 'brick', indexed by localIndex() */
+      value_t *brickData(const vec3i &brick);
+      const value_t *brickData(const vec3i &brick) const;
+
+      /*! index of voxel 'local' (each component in [0, BRICK_SIZE)) within
+          the data of its brick */
+      static size_t localIndex(const vec3i &local);
+
+      /*! call 'functor(const box3i &bounds, value_t *data)' for every
+          brick, where 'bounds' is brickBounds() and voxel 'idx' is
+          data[localIndex(idx - bounds.lower)]. The parallel version calls
+          it concurrently for different bricks. */
+      template <typename Functor>
+      void for_each_brick(Functor &&functor);
+      template <typename Functor>
+      void for_each_brick(Functor &&functor) const;
+      template <typename Functor>
+      void parallel_for_each_brick(Functor &&functor);
+      template <typename Functor>
+      void parallel_for_each_brick(Functor &&functor) const;
+
+      const vec3i dims;
+      const vec3i bricks;
+      containers::UninitVector<value_t, memory::HugePages::ADVISED> value;
+
+     protected:
+      void sampleTrilinearBatch(const vec3f *pos,
+                                value_t *out,
+                                size_t n,
+                                const value_t *outside) const override;
+
+     private:
+      size_t brickIndex(const vec3i &brick) const;
+    };
+
+    // Inlined definitions ////////////////////////////////////////////////////
+
+    template <typename T, int B>
+    inline BrickedArray3D<T, B>::BrickedArray3D(const vec3i &dims)
+        : dims(dims),
+          bricks((dims + vec3i(B - 1)) / B),
+          value(longProduct(bricks) * B * B * B, T())
+    {
+    }
+
+    template <typename T, int B>
+    inline BrickedArray3D<T, B>::BrickedArray3D(
+        const ActualArray3D<T> &source)
+        : BrickedArray3D(source.size())
+    {
+      parallel_for_each_brick([&](const box3i &bounds, T *data) {
+        const int width = bounds.upper.x - bounds.lower.x;
+        for (int z = bounds.lower.z; z < bounds.upper.z; z++)
+          for (int y = bounds.lower.y; y < bounds.upper.y; y++) {
+            const vec3i first(bounds.lower.x, y, z);
+            const T *row = source.value + source.indexOf(first);
+            std::copy(
+                row, row + width, data + localIndex(first - bounds.lower));
+          }
+      });
+    }
+
+    template <typename T, int B>
+    inline BrickedArray3D<T, B>::BrickedArray3D(const Array3D<T> &source)
+        : BrickedArray3D(source.size())
+    {
+      parallel_for_each_brick([&](const box3i &bounds, T *data) {
+        for_each(bounds, [&](const vec3i &idx) {
+          data[localIndex(idx - bounds.lower)] = source.get(idx);
+        });
+      });
+    }
+
+    template <typename T, int B>
+    inline vec3i BrickedArray3D<T, B>::size() const
+    {
+      return dims;
+    }
+
+    template <typename T, int B>
+    inline T BrickedArray3D<T, B>::get(const vec3i &_where) const
+    {
+      const vec3i where = max(vec3i(0), min(_where, dims - vec3i(1)));
+      const size_t index = indexOf(where);
+      assert(index < value.size());
+      return value[index];
+    }
+
+    template <typename T, int B>
+    inline void BrickedArray3D<T, B>::getRow(const vec3i &begin,
+                                             int count,
+                                             T *out) const
+    {
+      // clamped like get(): a piece per brick, then the ends across x
+      const int y = clamp(begin.y, 0, dims.y - 1);
+      const int z = clamp(begin.z, 0, dims.z - 1);
+
+      int i = 0;
+      for (; i < count && begin.x + i < 0; i++)
+        out[i] = value[indexOf(vec3i(0, y, z))];
+      const int inside = std::min(count, dims.x - begin.x);
+      while (i < inside) {
+        const int x   = begin.x + i;
+        const int n   = std::min(inside - i, B - x % B);
+        const T *from = value.data() + indexOf(vec3i(x, y, z));
+        std::copy(from, from + n, out + i);
+        i += n;
+      }
+      for (; i < count; i++)
+        out[i] = value[indexOf(vec3i(dims.x - 1, y, z))];
+    }
+
+    template <typename T, int B>
+    inline T BrickedArray3D<T, B>::sampleTrilinear(const vec3f &pos) const
+    {
+      T result;
+      detail::sampleTrilinear<T>(voxelLayout(), &pos, &result, 1, nullptr);
+      return result;
+    }
+
+    template <typename T, int B>
+    inline detail::VoxelLayout<T> BrickedArray3D<T, B>::voxelLayout() const
+    {
+      int shift = 0;
+      while ((1 << shift) < B)
+        shift++;
+      return detail::VoxelLayout<T>(value.data(), dims, bricks, shift);
+    }
+
+    template <typename T, int B>
+    inline void BrickedArray3D<T, B>::sampleTrilinearBatch(
+        const vec3f *pos, T *out, size_t n, const T *outside) const
+    {
+      detail::sampleTrilinear(voxelLayout(), pos, out, n, outside);
+    }
+
+    template <typename T, int B>
+    inline void BrickedArray3D<T, B>::set(const vec3i &where, const T &t)
+    {
+      value[indexOf(where)] = t;
+    }
+
+    template <typename T, int B>
+    inline void BrickedArray3D<T, B>::clear(const T &t)
+    {
+      std::fill(value.begin(), value.end(), t);
+    }
+
+    template <typename T, int B>
+    inline size_t BrickedArray3D<T, B>::numElements() const
+    {
+      return longProduct(dims);
+    }
+
+    template <typename T, int B>
+    inline size_t BrickedArray3D<T, B>::indexOf(const vec3i &pos) const
+    {
+      // unsigned division by the power of two brick size is a shift
+      const vec3ui p(pos);
+      const vec3i brick(p / unsigned(B));
+      const vec3i local(p % unsigned(B));
+      return brickIndex(brick) + localIndex(local);
+    }
+
+    template <typename T, int B>
+    inline vec3ul BrickedArray3D<T, B>::cellOffsets(const vec3i &lower) const
+    {
+      const vec3i local(vec3ui(lower) % unsigned(B));
+      const size_t brickX = size_t(B) * B * B;
+      const size_t brickY = brickX * bricks.x;
+      const size_t brickZ = brickY * bricks.y;
+      // within the brick, or from its last layer to the next brick's first
+      return vec3ul(local.x < B - 1 ? 1 : brickX - (B - 1),
+                    local.y < B - 1 ? B : brickY - (B - 1) * B,
+                    local.z < B - 1 ? B * B : brickZ - (B - 1) * B * B);
+    }
+
+    template <typename T, int B>
+    inline void BrickedArray3D<T, B>::copyTo(ActualArray3D<T> &dest) const
+    {
+      if (dest.size() != dims)
+        throw std::runtime_error("BrickedArray3D::copyTo(): size mismatch");
+
+      parallel_for_each_brick([&](const box3i &bounds, const T *data) {
+        const int width = bounds.upper.x - bounds.lower.x;
+        for (int z = bounds.lower.z; z < bounds.upper.z; z++)
+          for (int y = bounds.lower.y; y < bounds.upper.y; y++) {
+            const vec3i first(bounds.lower.x, y, z);
+            const T *row = data + localIndex(first - bounds.lower);
+            std::copy(row, row + width, dest.value + dest.indexOf(first));
+          }
+      });
+    }
+
+    template <typename T, int B>
+    inline vec3i BrickedArray3D<T, B>::numBricks() const
+    {
+      return bricks;
+    }
+
+    template <typename T, int B>
+    inline box3i BrickedArray3D<T, B>::brickBounds(const vec3i &brick) const
+    {
+      const vec3i lower = brick * B;
+      return box3i(lower, min(lower + vec3i(B), dims));
+    }
+
+    template <typename T, int B>
+    inline T *BrickedArray3D<T, B>::brickData(const vec3i &brick)
+    {
+      return value.data() + brickIndex(brick);
+    }
+
+    template <typename T, int B>
+    inline const T *BrickedArray3D<T, B>::brickData(const vec3i &brick) const
+    {
+      return value.data() + brickIndex(brick);
+    }
+
+    template <typename T, int B>
+    inline size_t BrickedArray3D<T, B>::localIndex(const vec3i &local)
+    {
+      return local.x + B * (local.y + size_t(B) * local.z);
+    }
+
+    template <typename T, int B>
+    template <typename Functor>
+    inline void BrickedArray3D<T, B>::for_each_brick(Functor &&functor)
+    {
+      for_each(bricks, [&](const vec3i &brick) {
+        functor(brickBounds(brick), brickData(brick));
+      });
+    }
+
+    template <typename T, int B>
+    template <typename Functor>
+    inline void BrickedArray3D<T, B>::for_each_brick(Functor &&functor) const
+    {
+      for_each(bricks, [&](const vec3i &brick) {
+        functor(brickBounds(brick), brickData(brick));
+      });
+    }
+
+    template <typename T, int B>
+    template <typename Functor>
+    inline void BrickedArray3D<T, B>::parallel_for_each_brick(
+        Functor &&functor)
+    {
+      tasking::parallel_for(longProduct(bricks), [&](size_t i) {
+        const vec3i brick = coordsOf(i, bricks);
+        functor(brickBounds(brick), brickData(brick));
+      });
+    }
+
+    template <typename T, int B>
+    template <typename Functor>
+    inline void BrickedArray3D<T, B>::parallel_for_each_brick(
+        Functor &&functor) const
+    {
+      tasking::parallel_for(longProduct(bricks), [&](size_t i) {
+        const vec3i brick = coordsOf(i, bricks);
+        functor(brickBounds(brick), brickData(brick));
+      });
+    }
+
+    template <typename T, int B>
+    inline size_t BrickedArray3D<T, B>::brickIndex(const vec3i &brick) const
+    {
+      return longIndex(brick, bricks) * (size_t(B) * B * B);
+    }
+
+  }  // namespace array3D
+}  // namespace rkcommon
@@ -0,0 +1,622 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "../tasking/ThreadLocal.h"
+#include "BrickedArray3D.h"
+
+namespace rkcommon {
+  namespace array3D {
+
+    /*! codecs of CompressedArray3D: LOSSLESS predicts each value from its
+        neighbor along x (or y, z at the start of a row) and bit packs the
+        residuals in groups of 32, FIXED_RATE quantizes groups of 64 values
+        to a fixed number of bits within their range */
+    enum class Compression
+    {
+      LOSSLESS,
+      FIXED_RATE
+    };
+
+    namespace detail {
+
+      template <size_t SIZE>
+      struct bits_of;
+
+      template <>
+      struct bits_of<1>
+      {
+        using type = uint8_t;
+      };
+
+      template <>
+      struct bits_of<2>
+      {
+        using type = uint16_t;
+      };
+
+      template <>
+      struct bits_of<4>
+      {
+        using type = uint32_t;
+      };
+
+      template <>
+      struct bits_of<8>
+      {
+        using type = uint64_t;
+      };
+
+      // unsigned integer with the bits of T
+      template <typename T>
+      using bits_t = typename bits_of<sizeof(T)>::type;
+
+      /* the bits of 'v', with floats flipped so that close values have
+         close integers across the sign (integers stay as they are, their
+         differences wrap around anyway) */
+      template <typename T>
+      inline bits_t<T> toOrderedBits(T v)
+      {
+        using U = bits_t<T>;
+        U u;
+        std::memcpy(&u, &v, sizeof(T));
+        if (std::is_floating_point<T>::value) {
+          const U sign = U(U(1) << (8 * sizeof(T) - 1));
+          u            = (u & sign) ? U(~u) : U(u | sign);
+        }
+        return u;
+      }
+
+      template <typename T>
+      inline T fromOrderedBits(bits_t<T> u)
+      {
+        using U = bits_t<T>;
+        if (std::is_floating_point<T>::value) {
+          const U sign = U(U(1) << (8 * sizeof(T) - 1));
+          u            = (u & sign) ? U(u & ~sign) : U(~u);
+        }
+        T v;
+        std::memcpy(&v, &u, sizeof(T));
+        return v;
+      }
+
+      // little endian bit stream of values of up to 32 bits
+      struct BitWriter
+      {
+        explicit BitWriter(std::vector<uint8_t> &out) : out(out) {}
+
+        void put(uint64_t value, int bits)
+        {
+          acc |= value << count;
+          count += bits;
+          for (; count >= 8; count -= 8, acc >>= 8)
+            out.push_back(uint8_t(acc));
+        }
+
+        std::vector<uint8_t> &out;
+        uint64_t acc{0};
+        int count{0};
+      };
+
+      struct BitReader
+      {
+        explicit BitReader(const uint8_t *in) : in(in) {}
+
+        uint32_t get(int bits)
+        {
+          for (; count < bits; count += 8)
+            acc |= uint64_t(*in++) << count;
+          const uint32_t value = uint32_t(acc & ((uint64_t(1) << bits) - 1));
+          acc >>= bits;
+          count -= bits;
+          return value;
+        }
+
+        const uint8_t *in;
+        uint64_t acc{0};
+        int count{0};
+      };
+
+      constexpr int LOSSLESS_GROUP   = 32;
+      constexpr int FIXED_RATE_GROUP = 64;
+
+      // index of the value v[i] is predicted from, 'i' itself for none
+      inline size_t predictorOf(size_t i, int B)
+      {
+        if (i % B)
+          return i - 1;
+        if ((i / B) % B)
+          return i - B;
+        return i >= size_t(B) * B ? i - size_t(B) * B : i;
+      }
+
+      template <typename U>
+      inline void putBits(BitWriter &w, U value, int bits)
+      {
+        if (bits > 32) {
+          w.put(uint32_t(value), 32);
+          w.put(uint64_t(value) >> 32, bits - 32);
+        } else if (bits > 0) {
+          w.put(uint64_t(value), bits);
+        }
+      }
+
+      template <typename U>
+      inline U getBits(BitReader &r, int bits)
+      {
+        if (bits > 32) {
+          const U low = r.get(32);
+          return U(low | U(uint64_t(r.get(bits - 32)) << 16 << 16));
+        }
+        return bits > 0 ? U(r.get(bits)) : U(0);
+      }
+
+      /*! append the lossless encoding of the B^3 values 'v' to 'out' */
+      template <typename T>
+      inline void encodeLossless(const T *v, int B, std::vector<uint8_t> &out)
+      {
+        using U           = bits_t<T>;
+        constexpr int MSB = 8 * sizeof(U) - 1;
+        const size_t n    = size_t(B) * B * B;
+
+        U residual[LOSSLESS_GROUP];
+        for (size_t g = 0; g < n; g += LOSSLESS_GROUP) {
+          U any = 0;
+          for (int j = 0; j < LOSSLESS_GROUP; j++) {
+            const size_t i = g + j;
+            const size_t p = predictorOf(i, B);
+            const U d      = U(toOrderedBits(v[i]) -
+                          (p == i ? U(0) : toOrderedBits(v[p])));
+            // zigzag, small negative differences become small as well
+            residual[j] = U(U(d << 1) ^ U(U(0) - U(d >> MSB)));
+            any |= residual[j];
+          }
+
+          int bits = 0;
+          while (bits <= MSB && (any >> bits))
+            bits++;
+          out.push_back(uint8_t(bits));
+
+          BitWriter w(out);
+          for (int j = 0; j < LOSSLESS_GROUP; j++)
+            putBits(w, residual[j], bits);
+        }
+      }
+
+      template <typename T>
+      inline void decodeLossless(const uint8_t *in, int B, T *v)
+      {
+        using U        = bits_t<T>;
+        const size_t n = size_t(B) * B * B;
+
+        for (size_t g = 0; g < n; g += LOSSLESS_GROUP) {
+          const int bits = *in++;
+          BitReader r(in);
+          for (int j = 0; j < LOSSLESS_GROUP; j++) {
+            const size_t i = g + j;
+            const size_t p = predictorOf(i, B);
+            const U z      = getBits<U>(r, bits);
+            const U d      = U(U(z >> 1) ^ U(U(0) - U(z & 1)));
+            v[i]           = fromOrderedBits<T>(
+                U((p == i ? U(0) : toOrderedBits(v[p])) + d));
+          }
+          in += LOSSLESS_GROUP * bits / 8;
+        }
+      }
+
+      template <typename T>
+      inline typename std::enable_if<std::is_integral<T>::value, T>::type
+      fromQuantized(double v)
+      {
+        return T(std::llround(v));
+      }
+
+      template <typename T>
+      inline typename std::enable_if<!std::is_integral<T>::value, T>::type
+      fromQuantized(double v)
+      {
+        return T(v);
+      }
+
+      /*! append the fixed rate encoding of the B^3 values 'v' to 'out':
+        per group the range, then 'rate' bits per value */
+      template <typename T>
+      inline void encodeFixedRate(const T *v,
+                                  int B,
+                                  int rate,
+                                  std::vector<uint8_t> &out)
+      {
+        const size_t n      = size_t(B) * B * B;
+        const double levels = double((uint64_t(1) << rate) - 1);
+
+        for (size_t g = 0; g < n; g += FIXED_RATE_GROUP) {
+          const auto range =
+              std::minmax_element(v + g, v + g + FIXED_RATE_GROUP);
+          const T lo = *range.first, hi = *range.second;
+          const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&lo);
+          out.insert(out.end(), bytes, bytes + sizeof(T));
+          bytes = reinterpret_cast<const uint8_t *>(&hi);
+          out.insert(out.end(), bytes, bytes + sizeof(T));
+
+          const double scale =
+              hi > lo ? levels / (double(hi) - double(lo)) : 0.0;
+          BitWriter w(out);
+          for (int j = 0; j < FIXED_RATE_GROUP; j++) {
+            const double q = (double(v[g + j]) - double(lo)) * scale;
+            w.put(uint64_t(std::min(levels, q + 0.5)), rate);
+          }
+        }
+      }
+
+      template <typename T>
+      inline void decodeFixedRate(const uint8_t *in, int B, int rate, T *v)
+      {
+        const size_t n      = size_t(B) * B * B;
+        const double levels = double((uint64_t(1) << rate) - 1);
+
+        for (size_t g = 0; g < n; g += FIXED_RATE_GROUP) {
+          T lo, hi;
+          std::memcpy(&lo, in, sizeof(T));
+          std::memcpy(&hi, in + sizeof(T), sizeof(T));
+          in += 2 * sizeof(T);
+
+          const double step = (double(hi) - double(lo)) / levels;
+          BitReader r(in);
+          for (int j = 0; j < FIXED_RATE_GROUP; j++)
+            v[g + j] = fromQuantized<T>(double(lo) + r.get(rate) * step);
+          in += FIXED_RATE_GROUP * rate / 8;
+        }
+      }
+
+    }  // namespace detail
+
+    /*! read-only array3d that keeps its values compressed, in bricks of
+        BRICK_SIZE^3 values that are compressed independently (and in
+        parallel on construction). Reads decompress whole bricks into a
+        per-thread cache holding a row of bricks along x, so row-order
+        scans decode every brick once and concurrent readers never wait
+        for each other.
+
+        FIXED_RATE stores 'bitsPerValue' (1 to 32) bits per value plus the
+        range of every 64 values, so the error is at most half of that
+        range / (2^bitsPerValue - 1). It assumes finite values. */
+    template <typename value_t, int BRICK_SIZE = 16>
+    struct CompressedArray3D : public Array3D<value_t>
+    {
+      static_assert(std::is_arithmetic<value_t>::value,
+                    "CompressedArray3D only stores scalar values");
+      static_assert(BRICK_SIZE >= 4 && (BRICK_SIZE & (BRICK_SIZE - 1)) == 0,
+                    "CompressedArray3D brick size must be a power of two");
+
+      explicit CompressedArray3D(
+          const Array3D<value_t> &source,
+          Compression compression = Compression::LOSSLESS,
+          int bitsPerValue        = 8);
+
+      /*! return size (ie, "dimensions") of volume */
+      vec3i size() const override;
+
+      /*! get cell value at given location, clamped to the volume */
+      value_t get(const vec3i &where) const override;
+
+      void getRow(const vec3i &begin, int count, value_t *out) const override;
+
+      /*! reads rows grouped by the row of bricks they fall in, so every
+        brick is decompressed once */
+      void getBlock(const box3i &box, value_t *out) const override;
+
+      range_t<value_t> getRowRange(const vec3i &begin,
+                                   int count) const override;
+
+      /*! bricks inside the region answer from the ranges kept on
+        construction, the others are decompressed */
+      range_t<value_t> getValueRange(const vec3i &begin,
+                                     const vec3i &end) const override;
+
+      using Array3D<value_t>::getValueRange;
+
+      /*! returns number of elements (as 64-bit int) across all dimensions */
+      size_t numElements() const override;
+
+      vec3i numBricks() const;
+
+      /*! decompress the BRICK_SIZE^3 values of 'brick' (padded at the
+        upper faces of the volume) into 'out', indexed by
+        BrickedArray3D::localIndex() */
+      void decompressBrick(const vec3i &brick, value_t *out) const;
+
+      /*! bytes of compressed data, including the brick offsets */
+      size_t compressedBytes() const;
+
+      Compression compression() const;
+
+     private:
+      static constexpr int MIN_CACHE_BRICKS = 4;
+      static constexpr int MAX_CACHE_BRICKS = 64;
+
+      struct CachedBrick
+      {
+        size_t index{size_t(-1)};
+        std::vector<value_t> values;
+      };
+
+      struct ThreadCache
+      {
+        // direct mapped, so a row of bricks never evicts itself
+        std::vector<CachedBrick> bricks;
+      };
+
+      void decompressBrick(size_t index, value_t *out) const;
+      /*! first coordinate past the clamped brick of 'v' along an axis of
+        'n' cells, at most 'end' */
+      static int nextBrickBoundary(int v, int end, int n);
+      const value_t *cachedBrick(const vec3i &brick) const;
+
+      const vec3i dims;
+      const vec3i bricks;
+      const Compression mode;
+      const int bitsPerValue;
+      const int cacheBricks;
+      // brick i is data[offsets[i], offsets[i + 1])
+      std::vector<size_t> offsets;
+      std::vector<uint8_t> data;
+      std::vector<range_t<value_t>> brickRanges;
+      mutable tasking::ThreadLocal<ThreadCache> cache;
+    };
+
+    // Inlined definitions ////////////////////////////////////////////////////
+
+    template <typename T, int B>
+    inline CompressedArray3D<T, B>::CompressedArray3D(
+        const Array3D<T> &source, Compression compression, int bitsPerValue)
+        : dims(source.size()),
+          bricks((dims + vec3i(B - 1)) / B),
+          mode(compression),
+          bitsPerValue(bitsPerValue),
+          cacheBricks(clamp(bricks.x, MIN_CACHE_BRICKS, MAX_CACHE_BRICKS))
+    {
+      if (mode == Compression::FIXED_RATE &&
+          (bitsPerValue < 1 || bitsPerValue > 32)) {
+        throw std::runtime_error(
+            "CompressedArray3D: bitsPerValue must be in [1, 32]");
+      }
+
+      const size_t numBricks = longProduct(bricks);
+      std::vector<std::vector<uint8_t>> encoded(numBricks);
+      brickRanges.resize(numBricks);
+
+      tasking::parallel_for(numBricks, [&](size_t i) {
+        // padding repeats the faces, as get() clamps
+        std::vector<T> values(B * B * B);
+        const vec3i lower = coordsOf(i, bricks) * B;
+        for (int z = 0; z < B; z++)
+          for (int y = 0; y < B; y++) {
+            const vec3i row(0, y, z);
+            source.getRow(lower + row,
+                          B,
+                          values.data() +
+                              BrickedArray3D<T, B>::localIndex(row));
+          }
+
+        brickRanges[i] = detail::rangeOf(values.data(), values.size());
+
+        if (mode == Compression::LOSSLESS)
+          detail::encodeLossless(values.data(), B, encoded[i]);
+        else
+          detail::encodeFixedRate(values.data(), B, bitsPerValue, encoded[i]);
+      });
+
+      offsets.resize(numBricks + 1, 0);
+      for (size_t i = 0; i < numBricks; i++)
+        offsets[i + 1] = offsets[i] + encoded[i].size();
+
+      data.resize(offsets.back());
+      tasking::parallel_for(numBricks, [&](size_t i) {
+        std::copy(encoded[i].begin(), encoded[i].end(), &data[offsets[i]]);
+      });
+    }
+
+    template <typename T, int B>
+    inline vec3i CompressedArray3D<T, B>::size() const
+    {
+      return dims;
+    }
+
+    template <typename T, int B>
+    inline T CompressedArray3D<T, B>::get(const vec3i &_where) const
+    {
+      const vec3i where = max(vec3i(0), min(_where, dims - vec3i(1)));
+      return cachedBrick(where / B)[BrickedArray3D<T, B>::localIndex(
+          where % B)];
+    }
+
+    template <typename T, int B>
+    inline void CompressedArray3D<T, B>::getRow(const vec3i &begin,
+                                                int count,
+                                                T *out) const
+    {
+      // clamped like get(): a piece per brick, then the ends across x
+      const int y = clamp(begin.y, 0, dims.y - 1);
+      const int z = clamp(begin.z, 0, dims.z - 1);
+
+      int i = 0;
+      for (; i < count && begin.x + i < 0; i++)
+        out[i] = get(vec3i(0, y, z));
+      const int inside = std::min(count, dims.x - begin.x);
+      while (i < inside) {
+        const vec3i where(begin.x + i, y, z);
+        const int n   = std::min(inside - i, B - where.x % B);
+        const T *from = cachedBrick(where / B) +
+                        BrickedArray3D<T, B>::localIndex(where % B);
+        std::copy(from, from + n, out + i);
+        i += n;
+      }
+      for (; i < count; i++)
+        out[i] = get(vec3i(dims.x - 1, y, z));
+    }
+
+    template <typename T, int B>
+    inline void CompressedArray3D<T, B>::getBlock(const box3i &box,
+                                                  T *out) const
+    {
+      const vec3i size = box.size();
+      if (anyLessThan(size, vec3i(1)))
+        return;
+
+      for (int z0 = box.lower.z; z0 < box.upper.z;) {
+        const int z1 = nextBrickBoundary(z0, box.upper.z, dims.z);
+        for (int y0 = box.lower.y; y0 < box.upper.y;) {
+          const int y1 = nextBrickBoundary(y0, box.upper.y, dims.y);
+          for (int z = z0; z < z1; z++)
+            for (int y = y0; y < y1; y++) {
+              const vec3i row = vec3i(0, y, z) - box.lower;
+              getRow(vec3i(box.lower.x, y, z),
+                     size.x,
+                     out + (size_t(row.z) * size.y + row.y) * size.x);
+            }
+          y0 = y1;
+        }
+        z0 = z1;
+      }
+    }
+
+    template <typename T, int B>
+    inline range_t<T> CompressedArray3D<T, B>::getRowRange(const vec3i &begin,
+                                                           int count) const
+    {
+      // get() clamps, so only the inside part of the row matters
+      const int y     = clamp(begin.y, 0, dims.y - 1);
+      const int z     = clamp(begin.z, 0, dims.z - 1);
+      const int lower = clamp(begin.x, 0, dims.x - 1);
+      const int upper = clamp(begin.x + count - 1, 0, dims.x - 1);
+
+      range_t<T> range = get(vec3i(lower, y, z));
+      for (int x = lower; x <= upper;) {
+        const vec3i where(x, y, z);
+        const int n   = std::min(upper + 1 - x, B - x % B);
+        const T *from = cachedBrick(where / B) +
+                        BrickedArray3D<T, B>::localIndex(where % B);
+        range.extend(detail::rangeOf(from, size_t(n)));
+        x += n;
+      }
+      return range;
+    }
+
+    template <typename T, int B>
+    inline range_t<T> CompressedArray3D<T, B>::getValueRange(
+        const vec3i &begin, const vec3i &end) const
+    {
+      if (anyLessThan(end, begin + 1))
+        return get(begin);
+
+      // get() clamps, so only the inside part of the region matters
+      const vec3i lower = max(vec3i(0), min(begin, dims - vec3i(1)));
+      const vec3i upper =
+          max(vec3i(0), min(end, dims) - vec3i(1)) + vec3i(1);
+      const vec3i first = lower / B;
+      const vec3i count = (upper - vec3i(1)) / B - first + vec3i(1);
+
+      return tasking::parallel_reduce(
+          longProduct(count),
+          range_t<T>(get(lower)),
+          [&](size_t i) {
+            const vec3i brick  = first + coordsOf(i, count);
+            const vec3i origin = brick * B;
+            const vec3i from   = max(lower, origin);
+            const vec3i to     = min(upper, origin + vec3i(B));
+            // the padding repeats the faces, so a whole brick's range is
+            // the range of its cells inside the volume
+            if (from == origin && to == min(dims, origin + vec3i(B)))
+              return brickRanges[longIndex(brick, bricks)];
+
+            const T *values = cachedBrick(brick);
+            range_t<T> range =
+                values[BrickedArray3D<T, B>::localIndex(from - origin)];
+            for (int z = from.z; z < to.z; z++)
+              for (int y = from.y; y < to.y; y++) {
+                const vec3i row = vec3i(from.x, y, z) - origin;
+                range.extend(detail::rangeOf(
+                    values + BrickedArray3D<T, B>::localIndex(row),
+                    size_t(to.x - from.x)));
+              }
+            return range;
+          },
+          [](const range_t<T> &a, const range_t<T> &b) {
+            return range_t<T>(min(a.lower, b.lower), max(a.upper, b.upper));
+          });
+    }
+
+    template <typename T, int B>
+    inline size_t CompressedArray3D<T, B>::numElements() const
+    {
+      return longProduct(dims);
+    }
+
+    template <typename T, int B>
+    inline vec3i CompressedArray3D<T, B>::numBricks() const
+    {
+      return bricks;
+    }
+
+    template <typename T, int B>
+    inline void CompressedArray3D<T, B>::decompressBrick(const vec3i &brick,
+                                                         T *out) const
+    {
+      decompressBrick(longIndex(brick, bricks), out);
+    }
+
+    template <typename T, int B>
+    inline size_t CompressedArray3D<T, B>::compressedBytes() const
+    {
+      return data.size() + offsets.size() * sizeof(size_t);
+    }
+
+    template <typename T, int B>
+    inline Compression CompressedArray3D<T, B>::compression() const
+    {
+      return mode;
+    }
+
+    template <typename T, int B>
+    inline void CompressedArray3D<T, B>::decompressBrick(size_t index,
+                                                         T *out) const
+    {
+      const uint8_t *in = data.data() + offsets[index];
+      if (mode == Compression::LOSSLESS)
+        detail::decodeLossless(in, B, out);
+      else
+        detail::decodeFixedRate(in, B, bitsPerValue, out);
+    }
+
+    template <typename T, int B>
+    inline int CompressedArray3D<T, B>::nextBrickBoundary(int v,
+                                                          int end,
+                                                          int n)
+    {
+      const int brick = clamp(v, 0, n - 1) / B;
+      return brick == (n - 1) / B ? end : std::min(end, (brick + 1) * B);
+    }
+
+    template <typename T, int B>
+    inline const T *CompressedArray3D<T, B>::cachedBrick(
+        const vec3i &brick) const
+    {
+      const size_t index = longIndex(brick, bricks);
+      std::vector<CachedBrick> &slots = cache.local().bricks;
+      if (slots.empty())
+        slots.resize(cacheBricks);
+      CachedBrick &slot = slots[index % cacheBricks];
+      if (slot.index != index) {
+        slot.values.resize(size_t(B) * B * B);
+        decompressBrick(index, slot.values.data());
+        slot.index = index;
+      }
+      return slot.values.data();
+    }
+
+  }  // namespace array3D
+}  // namespace rkcommon
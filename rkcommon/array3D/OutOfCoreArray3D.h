@@ -0,0 +1,412 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include "../containers/FlatHashMap.h"
+#include "../tasking/schedule.h"
+#include "../utility/MappedArray.h"
+#include "BrickedArray3D.h"
+
+namespace rkcommon {
+  namespace array3D {
+
+    /*! how the voxels of the file behind an OutOfCoreArray3D are stored:
+        LINEAR is a plain raw file, x fastest (as read by mmapRAW()), and
+        BRICKED the 'value' of a BrickedArray3D with the same brick size,
+        as written by saveBricked() */
+    enum class VolumeFileLayout
+    {
+      LINEAR,
+      BRICKED
+    };
+
+    struct BrickCacheStats
+    {
+      size_t hits{0};
+      size_t misses{0};
+      // bricks loaded by prefetch tasks
+      size_t prefetched{0};
+      size_t evicted{0};
+    };
+
+    namespace detail {
+
+      /* The bricks of an OutOfCoreArray3D that are in memory, most recently
+         used first. Bricks are loaded outside the lock and handed out as
+         shared pointers, so evicting one never pulls it from under a
+         reader. Prefetch tasks only hold a weak_ptr to the cache. */
+      template <typename T>
+      struct BrickCache
+      {
+        using Brick = std::vector<T>;
+
+        BrickCache(const std::string &fileName,
+                   const vec3i &dims,
+                   int brickSize,
+                   VolumeFileLayout layout,
+                   size_t offset,
+                   size_t memoryBudget);
+
+        /*! brick 'b', loaded on a miss */
+        std::shared_ptr<const Brick> brick(const vec3i &b);
+
+        /*! load 'b' if it isn't resident, from a prefetch task */
+        void prefetchBrick(const vec3i &b);
+
+        size_t brickIndex(const vec3i &b) const;
+        std::shared_ptr<const Brick> load(const vec3i &b) const;
+        // returns the resident copy if another thread was faster
+        std::shared_ptr<const Brick> insert(size_t index,
+                                            std::shared_ptr<const Brick> data);
+        void schedulePrefetch(const vec3i &b);
+
+        struct Entry
+        {
+          std::shared_ptr<const Brick> data;
+          std::list<size_t>::iterator lru;
+        };
+
+        const vec3i dims;
+        const int brickSize;
+        const vec3i bricks;
+        const VolumeFileLayout layout;
+        const size_t capacity;  // in bricks
+        utility::MappedFile file;
+
+        std::weak_ptr<BrickCache> self;
+        std::atomic<bool> prefetchNeighbors{true};
+
+        std::mutex mutex;
+        containers::FlatHashMap<size_t, Entry> resident;
+        std::list<size_t> lru;
+        containers::FlatHashMap<size_t, bool> pending;
+        BrickCacheStats stats;
+      };
+
+    }  // namespace detail
+
+    /*! read-only array3d on a raw file that need not fit into memory:
+        bricks of BRICK_SIZE^3 voxels are read from the memory mapped file
+        on first access and kept in an LRU cache of at most 'memoryBudget'
+        bytes (at least one brick). Readers may briefly keep evicted bricks
+        alive, so the budget can be exceeded by the bricks in use.
+
+        A miss also schedules the six face neighbors of the brick to be
+        loaded by tasking::schedule(), as interpolation and most traversals
+        touch them next. All access is thread safe, so getValueRange(),
+        for_each() and sampleTrilinear() work unchanged. */
+    template <typename value_t, int BRICK_SIZE = 32>
+    struct OutOfCoreArray3D : public Array3D<value_t>
+    {
+      OutOfCoreArray3D(const std::string &fileName,
+                       const vec3i &dims,
+                       size_t memoryBudget,
+                       VolumeFileLayout layout = VolumeFileLayout::LINEAR,
+                       size_t offset           = 0);
+
+      /*! return size (ie, "dimensions") of volume */
+      vec3i size() const override;
+
+      /*! get cell value at given location, clamped to the volume */
+      value_t get(const vec3i &where) const override;
+
+      void getRow(const vec3i &begin, int count, value_t *out) const override;
+
+      /*! returns number of elements (as 64-bit int) across all dimensions */
+      size_t numElements() const override;
+
+      /*! start loading the bricks overlapping 'region' in the background */
+      void prefetch(const box3i &region) const;
+
+      /*! whether misses prefetch the neighbors of the brick, on by default */
+      void setPrefetchNeighbors(bool enabled);
+
+      vec3i numBricks() const;
+      size_t residentBricks() const;
+      BrickCacheStats stats() const;
+
+     private:
+      using Brick = typename detail::BrickCache<value_t>::Brick;
+
+      std::shared_ptr<detail::BrickCache<value_t>> cache;
+    };
+
+    /*! write 'volume' to a file in the VolumeFileLayout::BRICKED layout */
+    template <typename T, int B>
+    void saveBricked(const std::string &fileName,
+                     const BrickedArray3D<T, B> &volume);
+
+    // Inlined definitions ////////////////////////////////////////////////////
+
+    namespace detail {
+
+      template <typename T>
+      inline BrickCache<T>::BrickCache(const std::string &fileName,
+                                       const vec3i &dims,
+                                       int brickSize,
+                                       VolumeFileLayout layout,
+                                       size_t offset,
+                                       size_t memoryBudget)
+          : dims(dims),
+            brickSize(brickSize),
+            bricks((dims + vec3i(brickSize - 1)) / brickSize),
+            layout(layout),
+            capacity(std::max<size_t>(
+                1,
+                memoryBudget / (sizeof(T) * brickSize * brickSize *
+                                size_t(brickSize)))),
+            file(fileName, utility::MapMode::READ_ONLY, offset)
+      {
+        const size_t numValues = layout == VolumeFileLayout::LINEAR
+            ? longProduct(dims)
+            : longProduct(bricks) * brickSize * brickSize * brickSize;
+        if (file.size() < numValues * sizeof(T))
+          throw std::runtime_error("OutOfCoreArray3D: file '" + fileName +
+                                   "' is too small");
+        if (layout == VolumeFileLayout::LINEAR)
+          file.advise(utility::MapAccess::RANDOM);
+      }
+
+      template <typename T>
+      inline size_t BrickCache<T>::brickIndex(const vec3i &b) const
+      {
+        return longIndex(b, bricks);
+      }
+
+      template <typename T>
+      inline std::shared_ptr<const typename BrickCache<T>::Brick>
+      BrickCache<T>::brick(const vec3i &b)
+      {
+        const size_t index = brickIndex(b);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          auto it = resident.find(index);
+          if (it != resident.end()) {
+            lru.splice(lru.begin(), lru, it->second.lru);
+            stats.hits++;
+            return it->second.data;
+          }
+          stats.misses++;
+        }
+
+        if (prefetchNeighbors) {
+          for (int axis = 0; axis < 3; axis++)
+            for (int step = -1; step <= 1; step += 2) {
+              vec3i n = b;
+              n[axis] += step;
+              if (n[axis] >= 0 && n[axis] < bricks[axis])
+                schedulePrefetch(n);
+            }
+        }
+
+        return insert(index, load(b));
+      }
+
+      template <typename T>
+      inline void BrickCache<T>::prefetchBrick(const vec3i &b)
+      {
+        const size_t index = brickIndex(b);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (resident.contains(index)) {
+            pending.erase(index);
+            return;
+          }
+        }
+
+        insert(index, load(b));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.erase(index);
+        stats.prefetched++;
+      }
+
+      template <typename T>
+      inline std::shared_ptr<const typename BrickCache<T>::Brick>
+      BrickCache<T>::load(const vec3i &b) const
+      {
+        const int B = brickSize;
+        auto data   = std::make_shared<Brick>(size_t(B) * B * B);
+        const T *values = static_cast<const T *>(file.data());
+
+        if (layout == VolumeFileLayout::BRICKED) {
+          const T *from = values + brickIndex(b) * data->size();
+          std::copy(from, from + data->size(), data->begin());
+          return data;
+        }
+
+        // rows of the file, padding stays value initialized
+        const vec3i lower = b * B;
+        const vec3i upper = min(lower + vec3i(B), dims);
+        for (int z = lower.z; z < upper.z; z++)
+          for (int y = lower.y; y < upper.y; y++) {
+            const T *row = values + longIndex(vec3i(lower.x, y, z), dims);
+            const size_t local =
+                B * ((y - lower.y) + size_t(B) * (z - lower.z));
+            std::copy(row, row + (upper.x - lower.x), data->begin() + local);
+          }
+        return data;
+      }
+
+      template <typename T>
+      inline std::shared_ptr<const typename BrickCache<T>::Brick>
+      BrickCache<T>::insert(size_t index, std::shared_ptr<const Brick> data)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = resident.find(index);
+        if (it != resident.end())
+          return it->second.data;
+
+        while (resident.size() >= capacity) {
+          resident.erase(lru.back());
+          lru.pop_back();
+          stats.evicted++;
+        }
+
+        lru.push_front(index);
+        resident.insert({index, Entry{data, lru.begin()}});
+        return data;
+      }
+
+      template <typename T>
+      inline void BrickCache<T>::schedulePrefetch(const vec3i &b)
+      {
+        const size_t index = brickIndex(b);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (resident.contains(index) || !pending.insert({index, true}).second)
+            return;
+        }
+
+        std::weak_ptr<BrickCache> weak = self;
+        tasking::schedule([weak, b]() {
+          if (auto cache = weak.lock())
+            cache->prefetchBrick(b);
+        });
+      }
+
+    }  // namespace detail
+
+    template <typename T, int B>
+    inline OutOfCoreArray3D<T, B>::OutOfCoreArray3D(
+        const std::string &fileName,
+        const vec3i &dims,
+        size_t memoryBudget,
+        VolumeFileLayout layout,
+        size_t offset)
+        : cache(std::make_shared<detail::BrickCache<T>>(
+              fileName, dims, B, layout, offset, memoryBudget))
+    {
+      cache->self = cache;
+    }
+
+    template <typename T, int B>
+    inline vec3i OutOfCoreArray3D<T, B>::size() const
+    {
+      return cache->dims;
+    }
+
+    template <typename T, int B>
+    inline T OutOfCoreArray3D<T, B>::get(const vec3i &_where) const
+    {
+      const vec3i where = max(vec3i(0), min(_where, cache->dims - vec3i(1)));
+      const std::shared_ptr<const Brick> brick = cache->brick(where / B);
+      return (*brick)[BrickedArray3D<T, B>::localIndex(where % B)];
+    }
+
+    template <typename T, int B>
+    inline void OutOfCoreArray3D<T, B>::getRow(const vec3i &begin,
+                                               int count,
+                                               T *out) const
+    {
+      // clamped like get(): a piece per brick, then the ends across x
+      const vec3i dims = cache->dims;
+      const int y      = clamp(begin.y, 0, dims.y - 1);
+      const int z      = clamp(begin.z, 0, dims.z - 1);
+
+      int i = 0;
+      if (count > 0 && begin.x < 0) {
+        const T first = get(vec3i(0, y, z));
+        for (; i < count && begin.x + i < 0; i++)
+          out[i] = first;
+      }
+      const int inside = std::min(count, dims.x - begin.x);
+      while (i < inside) {
+        const vec3i where(begin.x + i, y, z);
+        const int n = std::min(inside - i, B - where.x % B);
+        const std::shared_ptr<const Brick> brick = cache->brick(where / B);
+        const T *from =
+            brick->data() + BrickedArray3D<T, B>::localIndex(where % B);
+        std::copy(from, from + n, out + i);
+        i += n;
+      }
+      if (i < count) {
+        const T last = get(vec3i(dims.x - 1, y, z));
+        for (; i < count; i++)
+          out[i] = last;
+      }
+    }
+
+    template <typename T, int B>
+    inline size_t OutOfCoreArray3D<T, B>::numElements() const
+    {
+      return longProduct(cache->dims);
+    }
+
+    template <typename T, int B>
+    inline void OutOfCoreArray3D<T, B>::prefetch(const box3i &region) const
+    {
+      const box3i clipped(max(region.lower, vec3i(0)),
+                          min(region.upper, cache->dims));
+      if (anyLessThan(clipped.upper, clipped.lower + 1))
+        return;
+      const box3i bricks(clipped.lower / B, (clipped.upper - 1) / B + 1);
+      for_each(bricks, [&](const vec3i &b) { cache->schedulePrefetch(b); });
+    }
+
+    template <typename T, int B>
+    inline void OutOfCoreArray3D<T, B>::setPrefetchNeighbors(bool enabled)
+    {
+      cache->prefetchNeighbors = enabled;
+    }
+
+    template <typename T, int B>
+    inline vec3i OutOfCoreArray3D<T, B>::numBricks() const
+    {
+      return cache->bricks;
+    }
+
+    template <typename T, int B>
+    inline size_t OutOfCoreArray3D<T, B>::residentBricks() const
+    {
+      std::lock_guard<std::mutex> lock(cache->mutex);
+      return cache->resident.size();
+    }
+
+    template <typename T, int B>
+    inline BrickCacheStats OutOfCoreArray3D<T, B>::stats() const
+    {
+      std::lock_guard<std::mutex> lock(cache->mutex);
+      return cache->stats;
+    }
+
+    template <typename T, int B>
+    inline void saveBricked(const std::string &fileName,
+                            const BrickedArray3D<T, B> &volume)
+    {
+      std::ofstream file(fileName, std::ios::binary);
+      file.write(reinterpret_cast<const char *>(volume.value.data()),
+                 volume.value.size() * sizeof(T));
+      if (!file)
+        throw std::runtime_error("saveBricked(): could not write '" +
+                                 fileName + "'");
+    }
+
+  }  // namespace array3D
+}  // namespace rkcommon
@@ -0,0 +1,265 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <mutex>
+#include "../memory/ScratchBuffer.h"
+#include "Array3D.h"
+
+namespace rkcommon {
+  namespace array3D {
+
+    /*! how a pyramid level combines the (up to) 2^3 cells below each of
+        its cells; BOX is the mean, the same as AVERAGE */
+    enum class PyramidFilter
+    {
+      AVERAGE,
+      BOX = AVERAGE,
+      MIN,
+      MAX
+    };
+
+    /*! size of the level above one of 'dims': half of it, rounded up */
+    inline vec3i pyramidLevelSize(const vec3i &dims)
+    {
+      return max(vec3i(1), (dims + 1) / 2);
+    }
+
+    /*! number of levels of a pyramid over 'dims', including the source
+        level and the final 1x1x1 one */
+    inline int pyramidNumLevels(const vec3i &dims)
+    {
+      int n = 1;
+      for (vec3i d = dims; d != vec3i(1); d = pyramidLevelSize(d))
+        n++;
+      return n;
+    }
+
+    namespace detail {
+
+      // min and max by operator<, branch free for scalars
+      template <typename T>
+      inline T lesser(const T &a, const T &b)
+      {
+        return b < a ? b : a;
+      }
+
+      template <typename T>
+      inline T greater(const T &a, const T &b)
+      {
+        return a < b ? b : a;
+      }
+
+      // rows of output cells per task
+      inline int downsampleRowsPerTask(int width)
+      {
+        return std::max(1, (16 << 10) / std::max(1, width));
+      }
+
+      /*! the level above 'in' into 'out' (of pyramidLevelSize(in.size())),
+          in parallel over blocks of output rows. Odd edges repeat their
+          last cell, which for AVERAGE gives the mean of the cells that
+          are inside. */
+      template <typename T>
+      void downsample(const Array3D<T> &in,
+                      ActualArray3D<T> &out,
+                      PyramidFilter filter)
+      {
+        using I = interpolant_t<T>;
+
+        const vec3i inDims  = in.size();
+        const vec3i outDims = out.size();
+        assert(outDims == pyramidLevelSize(inDims));
+
+        const int width       = outDims.x;
+        const int numRows     = outDims.y * outDims.z;
+        const int rowsPerTask = downsampleRowsPerTask(width);
+        const int numTasks    = (numRows + rowsPerTask - 1) / rowsPerTask;
+
+        tasking::parallel_for(numTasks, [&](int task) {
+          memory::ScratchScope scratch;
+          // the four input rows, padded to an even length
+          const int n = 2 * width;
+          T *rows[4];
+          for (int r = 0; r < 4; r++)
+            rows[r] = scratch.allocate<T>(n);
+          I *sum = scratch.allocate<I>(n);
+          T *ext = scratch.allocate<T>(n);
+
+          const int begin = task * rowsPerTask;
+          const int end   = std::min(begin + rowsPerTask, numRows);
+          for (int row = begin; row < end; row++) {
+            const int y  = row % outDims.y;
+            const int z  = row / outDims.y;
+            const int y1 = std::min(2 * y + 1, inDims.y - 1);
+            const int z1 = std::min(2 * z + 1, inDims.z - 1);
+            // getRow() clamps, so an odd row end repeats its last cell
+            in.getRow(vec3i(0, 2 * y, 2 * z), n, rows[0]);
+            in.getRow(vec3i(0, y1, 2 * z), n, rows[1]);
+            in.getRow(vec3i(0, 2 * y, z1), n, rows[2]);
+            in.getRow(vec3i(0, y1, z1), n, rows[3]);
+
+            T *o = out.value + out.indexOf(vec3i(0, y, z));
+            if (filter == PyramidFilter::AVERAGE) {
+              for (int x = 0; x < n; x++)
+                sum[x] = (1.f * rows[0][x] + 1.f * rows[1][x]) +
+                         (1.f * rows[2][x] + 1.f * rows[3][x]);
+              for (int x = 0; x < width; x++)
+                o[x] = fromInterpolant<T>(.125f *
+                                          (sum[2 * x] + sum[2 * x + 1]));
+            } else if (filter == PyramidFilter::MIN) {
+              for (int x = 0; x < n; x++)
+                ext[x] = lesser(lesser(rows[0][x], rows[1][x]),
+                                lesser(rows[2][x], rows[3][x]));
+              for (int x = 0; x < width; x++)
+                o[x] = lesser(ext[2 * x], ext[2 * x + 1]);
+            } else {
+              for (int x = 0; x < n; x++)
+                ext[x] = greater(greater(rows[0][x], rows[1][x]),
+                                 greater(rows[2][x], rows[3][x]));
+              for (int x = 0; x < width; x++)
+                o[x] = greater(ext[2 * x], ext[2 * x + 1]);
+            }
+          }
+        });
+      }
+
+    }  // namespace detail
+
+    /*! the levels above 'source', from half its size down to 1x1x1 (or at
+        most 'maxLevels' of them), each computed in parallel from the one
+        below it */
+    template <typename T>
+    std::vector<std::shared_ptr<ActualArray3D<T>>> buildPyramid(
+        const Array3D<T> &source,
+        PyramidFilter filter = PyramidFilter::AVERAGE,
+        int maxLevels        = -1)
+    {
+      std::vector<std::shared_ptr<ActualArray3D<T>>> levels;
+      const Array3D<T> *below = &source;
+      while (below->size() != vec3i(1) &&
+             (maxLevels < 0 || int(levels.size()) < maxLevels)) {
+        auto level = std::make_shared<ActualArray3D<T>>(
+            pyramidLevelSize(below->size()));
+        detail::downsample(*below, *level, filter);
+        levels.push_back(level);
+        below = level.get();
+      }
+      return levels;
+    }
+
+    /*! a pyramid over 'source' whose levels are computed when first asked
+        for and then cached; level 0 is the source itself. level() may be
+        called from several threads, returned levels stay valid until
+        clear(). */
+    template <typename T>
+    class VolumePyramid
+    {
+     public:
+      VolumePyramid(std::shared_ptr<const Array3D<T>> source,
+                    PyramidFilter filter = PyramidFilter::AVERAGE);
+
+      int numLevels() const;
+
+      vec3i levelSize(int level) const;
+
+      const Array3D<T> &level(int level);
+
+      /*! whether 'level' is source or cached */
+      bool isCached(int level) const;
+
+      /*! drops the cached levels */
+      void clear();
+
+      size_t cachedBytes() const;
+
+     private:
+      std::shared_ptr<const Array3D<T>> source;
+      PyramidFilter filter;
+      // levels[i] is level i + 1, or null
+      std::vector<std::shared_ptr<ActualArray3D<T>>> levels;
+      mutable std::mutex mutex;
+    };
+
+    // Inlined VolumePyramid members //////////////////////////////////////////
+
+    template <typename T>
+    inline VolumePyramid<T>::VolumePyramid(
+        std::shared_ptr<const Array3D<T>> _source, PyramidFilter filter)
+        : source(std::move(_source)), filter(filter)
+    {
+      if (!source)
+        throw std::runtime_error("VolumePyramid needs a source array");
+      levels.resize(pyramidNumLevels(source->size()) - 1);
+    }
+
+    template <typename T>
+    inline int VolumePyramid<T>::numLevels() const
+    {
+      return int(levels.size()) + 1;
+    }
+
+    template <typename T>
+    inline vec3i VolumePyramid<T>::levelSize(int level) const
+    {
+      vec3i dims = source->size();
+      for (int l = 0; l < level; l++)
+        dims = pyramidLevelSize(dims);
+      return dims;
+    }
+
+    template <typename T>
+    inline const Array3D<T> &VolumePyramid<T>::level(int level)
+    {
+      if (level < 0 || level >= numLevels())
+        throw std::out_of_range("VolumePyramid level out of range");
+      if (level == 0)
+        return *source;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      // from the highest cached level below, up to 'level'
+      int l = level;
+      while (l > 0 && !levels[l - 1])
+        l--;
+      for (; l < level; l++) {
+        const Array3D<T> &below =
+            l == 0 ? *source : static_cast<const Array3D<T> &>(*levels[l - 1]);
+        auto next = std::make_shared<ActualArray3D<T>>(
+            pyramidLevelSize(below.size()));
+        detail::downsample(below, *next, filter);
+        levels[l] = next;
+      }
+      return *levels[level - 1];
+    }
+
+    template <typename T>
+    inline bool VolumePyramid<T>::isCached(int level) const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return level == 0 || (level > 0 && level < numLevels() &&
+                             levels[level - 1] != nullptr);
+    }
+
+    template <typename T>
+    inline void VolumePyramid<T>::clear()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto &l : levels)
+        l.reset();
+    }
+
+    template <typename T>
+    inline size_t VolumePyramid<T>::cachedBytes() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      size_t bytes = 0;
+      for (const auto &l : levels) {
+        if (l)
+          bytes += l->numElements() * sizeof(T);
+      }
+      return bytes;
+    }
+
+  }  // namespace array3D
+}  // namespace rkcommon
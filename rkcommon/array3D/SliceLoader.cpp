@@ -0,0 +1,54 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "SliceLoader.h"
+// std
+#include <fstream>
+
+namespace rkcommon {
+  namespace array3D {
+
+    static void readBytes(std::ifstream &file,
+                          const std::string &fileName,
+                          size_t offset,
+                          std::vector<uint8_t> &bytes)
+    {
+      file.seekg(std::streamoff(offset));
+      file.read(reinterpret_cast<char *>(bytes.data()),
+                std::streamsize(bytes.size()));
+      if (!file)
+        throw std::runtime_error("could not read slice from '" + fileName +
+                                 "'");
+    }
+
+    SliceReadFcn rawSliceReader(const std::string &fileName,
+                                size_t sliceBytes,
+                                size_t offset)
+    {
+      auto file = std::make_shared<std::ifstream>(fileName, std::ios::binary);
+      if (!*file)
+        throw std::runtime_error("could not open '" + fileName + "'");
+
+      return [=](int z, std::vector<uint8_t> &bytes) {
+        bytes.resize(sliceBytes);
+        readBytes(*file, fileName, offset + size_t(z) * sliceBytes, bytes);
+      };
+    }
+
+    SliceReadFcn sliceFileReader(const std::vector<std::string> &fileNames)
+    {
+      return [=](int z, std::vector<uint8_t> &bytes) {
+        if (z < 0 || size_t(z) >= fileNames.size())
+          throw std::runtime_error("no file for slice " + std::to_string(z));
+
+        const std::string &fileName = fileNames[z];
+        std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+        if (!file)
+          throw std::runtime_error("could not open '" + fileName + "'");
+        bytes.resize(size_t(file.tellg()));
+        readBytes(file, fileName, 0, bytes);
+      };
+    }
+
+  }  // namespace array3D
+}  // namespace rkcommon
@@ -0,0 +1,324 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Array3D.h"
+
+namespace rkcommon {
+  namespace array3D {
+
+    /*! reads the bytes of slice 'z' into 'bytes'; called for z = 0, 1, ...
+        in order, on the I/O thread of a SliceLoader */
+    using SliceReadFcn =
+        std::function<void(int z, std::vector<uint8_t> &bytes)>;
+
+    /*! decodes the bytes of one slice into 'slice', sized (dims.x, dims.y,
+        1); called on the thread consuming the slices, so it may use
+        parallel_for */
+    template <typename T>
+    using SliceDecodeFcn = std::function<void(
+        const std::vector<uint8_t> &bytes, ActualArray3D<T> &slice)>;
+
+    /*! reads consecutive slices of 'sliceBytes' bytes from a raw file,
+        starting 'offset' bytes into it */
+    RKCOMMON_INTERFACE SliceReadFcn
+    rawSliceReader(const std::string &fileName,
+                   size_t sliceBytes,
+                   size_t offset = 0);
+
+    /*! reads each slice from a file of its own (for image stacks, with a
+        decoder for the image format) */
+    RKCOMMON_INTERFACE SliceReadFcn
+    sliceFileReader(const std::vector<std::string> &fileNames);
+
+    /*! decodes raw slices of 'in_t' values, converting rows in parallel */
+    template <typename in_t, typename T = in_t>
+    SliceDecodeFcn<T> rawSliceDecoder();
+
+    /*! loads a volume slice by slice in a pipeline: a thread of its own
+        reads the bytes of up to 'readAhead' slices ahead, while the thread
+        calling next() decodes them. Slices that have been loaded are usable
+        (from any thread, through slice()) while later ones are still being
+        read; next(), release() and array() belong to one thread. */
+    template <typename T>
+    struct SliceLoader
+    {
+      SliceLoader(const vec3i &dims,
+                  SliceReadFcn read,
+                  SliceDecodeFcn<T> decode,
+                  int readAhead = 4);
+
+      /*! stops reading, dropping the slices read ahead */
+      ~SliceLoader();
+
+      /*! decode the next slice, waiting for its bytes, and return it;
+          returns nullptr once all slices are loaded. Rethrows the errors of
+          reading the slice */
+      std::shared_ptr<ActualArray3D<T>> next();
+
+      /*! number of slices next() has returned, 0 to dims.z */
+      int loadedSlices() const;
+
+      /*! loaded slice 'z', or nullptr if it is not loaded yet or has been
+          released */
+      std::shared_ptr<ActualArray3D<T>> slice(int z) const;
+
+      /*! drop the loader's reference to a loaded slice, to bound memory */
+      void release(int z);
+
+      /*! load the remaining slices and return the whole volume (the slices
+          must not have been released) */
+      std::shared_ptr<MultiSliceArray3D<T>> array();
+
+      const vec3i dims;
+
+     private:
+      struct ReadSlice
+      {
+        std::vector<uint8_t> bytes;
+        std::exception_ptr error;
+      };
+
+      void readLoop(SliceReadFcn read);
+
+      const SliceDecodeFcn<T> decode;
+      const size_t readAhead;
+
+      std::vector<std::shared_ptr<ActualArray3D<T>>> slices;
+      std::atomic<int> loaded{0};
+
+      std::mutex mutex;
+      std::condition_variable changed;
+      std::deque<ReadSlice> queue;
+      bool stopping{false};
+      std::thread reader;
+    };
+
+    /*! the slices within 'radius' of slice 'z', as a filter running over
+        the volume slice by slice sees them */
+    template <typename T>
+    struct SliceWindow
+    {
+      int z;
+      int radius;
+      vec3i dims;
+
+      /*! value at 'where', clamped to the volume like Array3D::get();
+          'where.z' must be within 'radius' of 'z' */
+      T get(const vec3i &where) const;
+
+      /*! slice 'sz', clamped to the volume, within 'radius' of 'z' */
+      const ActualArray3D<T> &slice(int sz) const;
+
+      // slices[i] is slice max(0, z - radius) + i
+      std::vector<std::shared_ptr<ActualArray3D<T>>> slices;
+    };
+
+    /*! streams the volume through 'fcn(const SliceWindow<T> &)', called for
+        z = 0, 1, ... in order. Slices leaving the window are released from
+        the loader, so at most 2 * radius + 1 slices are held decoded at any
+        time (plus 'readAhead' read ahead) and volumes larger than memory
+        can be filtered. */
+    template <typename T, typename FCN_T>
+    void forEachSliceWindow(SliceLoader<T> &loader, int radius, FCN_T &&fcn);
+
+    // Inlined definitions ////////////////////////////////////////////////////
+
+    template <typename in_t, typename T>
+    inline SliceDecodeFcn<T> rawSliceDecoder()
+    {
+      return [](const std::vector<uint8_t> &bytes, ActualArray3D<T> &slice) {
+        const vec3i dims = slice.size();
+        if (bytes.size() < longProduct(dims) * sizeof(in_t))
+          throw std::runtime_error("rawSliceDecoder: slice is too short");
+
+        tasking::parallel_for(dims.y, [&](int y) {
+          const size_t begin = size_t(y) * dims.x;
+          const uint8_t *in  = bytes.data() + begin * sizeof(in_t);
+          for (int x = 0; x < dims.x; x++) {
+            in_t v;
+            std::memcpy(&v, in + x * sizeof(in_t), sizeof(in_t));
+            slice.value[begin + x] = (T)v;
+          }
+        });
+      };
+    }
+
+    // SliceLoader //
+
+    template <typename T>
+    inline SliceLoader<T>::SliceLoader(const vec3i &dims,
+                                       SliceReadFcn read,
+                                       SliceDecodeFcn<T> decode,
+                                       int readAhead)
+        : dims(dims),
+          decode(std::move(decode)),
+          readAhead(std::max(1, readAhead)),
+          slices(std::max(0, dims.z))
+    {
+      reader = std::thread(&SliceLoader<T>::readLoop, this, std::move(read));
+    }
+
+    template <typename T>
+    inline SliceLoader<T>::~SliceLoader()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+      }
+      changed.notify_all();
+      reader.join();
+    }
+
+    template <typename T>
+    inline void SliceLoader<T>::readLoop(SliceReadFcn read)
+    {
+      for (int z = 0; z < dims.z; z++) {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          changed.wait(
+              lock, [&]() { return stopping || queue.size() < readAhead; });
+          if (stopping)
+            return;
+        }
+
+        ReadSlice slice;
+        try {
+          read(z, slice.bytes);
+        } catch (...) {
+          slice.error = std::current_exception();
+        }
+
+        const bool failed = bool(slice.error);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          queue.push_back(std::move(slice));
+        }
+        changed.notify_all();
+        if (failed)
+          return;
+      }
+    }
+
+    template <typename T>
+    inline std::shared_ptr<ActualArray3D<T>> SliceLoader<T>::next()
+    {
+      const int z = loaded.load();
+      if (z >= dims.z)
+        return nullptr;
+
+      ReadSlice read;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return !queue.empty(); });
+        if (queue.front().error)
+          std::rethrow_exception(queue.front().error);
+        read = std::move(queue.front());
+        queue.pop_front();
+      }
+      changed.notify_all();
+
+      auto slice =
+          std::make_shared<ActualArray3D<T>>(vec3i(dims.x, dims.y, 1));
+      decode(read.bytes, *slice);
+
+      slices[z] = slice;
+      loaded.store(z + 1);
+      return slice;
+    }
+
+    template <typename T>
+    inline int SliceLoader<T>::loadedSlices() const
+    {
+      return loaded.load();
+    }
+
+    template <typename T>
+    inline std::shared_ptr<ActualArray3D<T>> SliceLoader<T>::slice(
+        int z) const
+    {
+      return z >= 0 && z < loaded.load() ? slices[z] : nullptr;
+    }
+
+    template <typename T>
+    inline void SliceLoader<T>::release(int z)
+    {
+      if (z >= 0 && z < loaded.load())
+        slices[z].reset();
+    }
+
+    template <typename T>
+    inline std::shared_ptr<MultiSliceArray3D<T>> SliceLoader<T>::array()
+    {
+      while (next())
+        ;
+
+      std::vector<std::shared_ptr<Array3D<T>>> all(slices.begin(),
+                                                   slices.end());
+      for (const auto &s : all) {
+        if (!s)
+          throw std::runtime_error("SliceLoader: slice has been released");
+      }
+      return std::make_shared<MultiSliceArray3D<T>>(all);
+    }
+
+    // SliceWindow //
+
+    template <typename T>
+    inline const ActualArray3D<T> &SliceWindow<T>::slice(int sz) const
+    {
+      const int first = std::max(0, z - radius);
+      sz              = clamp(sz, 0, dims.z - 1);
+      assert(sz - first >= 0 && sz - first < int(slices.size()));
+      return *slices[sz - first];
+    }
+
+    template <typename T>
+    inline T SliceWindow<T>::get(const vec3i &where) const
+    {
+      return slice(where.z).get(vec3i(where.x, where.y, 0));
+    }
+
+    template <typename T, typename FCN_T>
+    inline void forEachSliceWindow(SliceLoader<T> &loader,
+                                   int radius,
+                                   FCN_T &&fcn)
+    {
+      const int numSlices = loader.dims.z;
+      SliceWindow<T> window;
+      window.radius = radius;
+      window.dims   = loader.dims;
+
+      for (int z = 0; z < numSlices; z++) {
+        // the window needs [z - radius, z + radius], clamped
+        const int last = std::min(numSlices - 1, z + radius);
+        while (loader.loadedSlices() <= last)
+          loader.next();
+
+        const int first = std::max(0, z - radius);
+        if (z - radius - 1 >= 0) {
+          window.slices.erase(window.slices.begin());
+          loader.release(z - radius - 1);
+        }
+        while (int(window.slices.size()) < last - first + 1) {
+          window.slices.push_back(
+              loader.slice(first + int(window.slices.size())));
+        }
+
+        window.z = z;
+        fcn(static_cast<const SliceWindow<T> &>(window));
+      }
+    }
+
+  }  // namespace array3D
+}  // namespace rkcommon
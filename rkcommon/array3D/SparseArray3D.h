@@ -0,0 +1,586 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include "../containers/BitVector.h"
+#include "../tasking/parallel_sort.h"
+#include "BrickedArray3D.h"
+
+namespace rkcommon {
+  namespace array3D {
+
+    /*! read-only array3d for mostly empty volumes, stored VDB-like as a
+        tree: a dense root table covers the volume with internal nodes of
+        NODE_SIZE^3 leaf slots, and each leaf is a dense brick of
+        LEAF_SIZE^3 values (x fastest, see BrickedArray3D::localIndex()).
+        Cells outside of all leaves have the background value, so memory
+        scales with the occupied leaves, not with the bounding box; an
+        internal node costs 4 bytes per slot and exists only where one of
+        its leaves does.
+
+        A cell is active if it was given a value on construction (from a
+        dense array: if its value differs from the background). Leaves
+        keep a bit mask of their active cells for for_each_active(), and
+        both leaves and nodes keep the range of their values, from which
+        getValueRange() answers whole leaves and nodes without reading
+        them. */
+    template <typename value_t, int LEAF_SIZE = 8, int NODE_SIZE = 16>
+    struct SparseArray3D : public Array3D<value_t>
+    {
+      static_assert(LEAF_SIZE >= 4 && (LEAF_SIZE & (LEAF_SIZE - 1)) == 0,
+                    "SparseArray3D leaf size must be a power of two >= 4");
+      static_assert(NODE_SIZE >= 2 && (NODE_SIZE & (NODE_SIZE - 1)) == 0,
+                    "SparseArray3D node size must be a power of two");
+
+      static constexpr uint32_t INVALID = uint32_t(-1);
+
+      /*! the active cells of 'source', built in parallel over nodes */
+      SparseArray3D(const Array3D<value_t> &source,
+                    const value_t &background);
+
+      /*! 'n' active cells from a stream of (coords[i], values[i]), in any
+          order, sorted into leaves in parallel. Later duplicates win;
+          coordinates outside [0, dims) throw. */
+      SparseArray3D(const vec3i &dims,
+                    const value_t &background,
+                    const vec3i *coords,
+                    const value_t *values,
+                    size_t n);
+
+      /*! return size (ie, "dimensions") of volume */
+      vec3i size() const override;
+
+      /*! get cell value at given location, clamped to the volume */
+      value_t get(const vec3i &where) const override;
+
+      void getRow(const vec3i &begin, int count, value_t *out) const override;
+
+      /*! leaves and nodes inside the region answer from their ranges,
+          empty slots with the background value */
+      range_t<value_t> getValueRange(const vec3i &begin,
+                                     const vec3i &end) const override;
+
+      using Array3D<value_t>::getValueRange;
+
+      /*! returns number of elements (as 64-bit int) across all dimensions */
+      size_t numElements() const override;
+
+      const value_t &background() const;
+
+      bool isActive(const vec3i &where) const;
+
+      size_t numActiveCells() const;
+      size_t numLeaves() const;
+      size_t numNodes() const;
+
+      /*! bytes of the tree: root table, nodes, leaf values and masks */
+      size_t memoryBytes() const;
+
+      /*! call 'functor(const vec3i &idx, const value_t &value)' for each
+          active cell, leaf by leaf. The parallel version calls it
+          concurrently for different leaves. */
+      template <typename Functor>
+      void for_each_active(Functor &&functor) const;
+      template <typename Functor>
+      void parallel_for_each_active(Functor &&functor) const;
+
+     private:
+      static constexpr int LEAF_CELLS  = LEAF_SIZE * LEAF_SIZE * LEAF_SIZE;
+      static constexpr int MASK_WORDS  = LEAF_CELLS / 64;
+      static constexpr int NODE_SLOTS  = NODE_SIZE * NODE_SIZE * NODE_SIZE;
+      static constexpr int NODE_EXTENT = LEAF_SIZE * NODE_SIZE;
+
+      struct Node
+      {
+        Node();
+
+        uint32_t leaves[NODE_SLOTS];
+        range_t<value_t> range;
+      };
+
+      SparseArray3D(const vec3i &dims, const value_t &background);
+
+      // storage for 'n' leaves, filled with the background
+      void allocateLeaves(size_t n);
+      // make 'leaf' the one in 'slot' of root cell 'r', adding its node
+      void addLeaf(size_t r, int slot, size_t leaf);
+      // leaf and node ranges, once all leaves are filled
+      void finalize();
+
+      // leaf index of the cell, or INVALID
+      uint32_t leafOf(const vec3i &where) const;
+      size_t rootIndex(const vec3i &where) const;
+      static int slotOf(const vec3i &where);
+
+      box3i leafBounds(uint32_t leaf) const;
+      range_t<value_t> rangeInLeaf(uint32_t leaf, const box3i &box) const;
+      range_t<value_t> rangeInNode(const Node &node,
+                                   const vec3i &origin,
+                                   const box3i &box) const;
+
+      const vec3i dims;
+      const vec3i rootDims;
+      const value_t backgroundValue;
+      size_t activeCells{0};
+
+      std::vector<uint32_t> root;  // node index per root cell, or INVALID
+      std::vector<Node> nodes;
+      // leaf i holds values[i * LEAF_CELLS, (i + 1) * LEAF_CELLS)
+      std::vector<value_t> values;
+      std::vector<uint64_t> masks;
+      std::vector<vec3i> leafOrigins;
+      std::vector<range_t<value_t>> leafRanges;
+    };
+
+    // Inlined definitions ////////////////////////////////////////////////////
+
+    template <typename T, int B, int N>
+    constexpr uint32_t SparseArray3D<T, B, N>::INVALID;
+
+    template <typename T, int B, int N>
+    inline SparseArray3D<T, B, N>::Node::Node()
+    {
+      std::fill(leaves, leaves + NODE_SLOTS, INVALID);
+    }
+
+    template <typename T, int B, int N>
+    inline SparseArray3D<T, B, N>::SparseArray3D(const vec3i &dims,
+                                                 const T &background)
+        : dims(dims),
+          rootDims((dims + vec3i(NODE_EXTENT - 1)) / NODE_EXTENT),
+          backgroundValue(background),
+          root(longProduct(rootDims), INVALID)
+    {
+    }
+
+    template <typename T, int B, int N>
+    inline SparseArray3D<T, B, N>::SparseArray3D(const Array3D<T> &source,
+                                                 const T &background)
+        : SparseArray3D(source.size(), background)
+    {
+      // the active leaves of each root cell, gathered in parallel
+      struct Pending
+      {
+        std::vector<int> slots;
+        std::vector<T> values;
+      };
+
+      std::vector<Pending> pending(root.size());
+      tasking::parallel_for(root.size(), [&](size_t r) {
+        const vec3i origin = coordsOf(r, rootDims) * NODE_EXTENT;
+        std::vector<T> leaf(LEAF_CELLS);
+        for (int slot = 0; slot < NODE_SLOTS; slot++) {
+          const vec3i lower = origin + coordsOf(slot, vec3i(N)) * B;
+          if (anyLessThan(dims - vec3i(1), lower))
+            continue;
+          const vec3i upper = min(lower + vec3i(B), dims);
+
+          std::fill(leaf.begin(), leaf.end(), background);
+          bool active = false;
+          for (int z = lower.z; z < upper.z; z++)
+            for (int y = lower.y; y < upper.y; y++) {
+              const vec3i row(0, y - lower.y, z - lower.z);
+              T *out = leaf.data() + BrickedArray3D<T, B>::localIndex(row);
+              source.getRow(vec3i(lower.x, y, z), upper.x - lower.x, out);
+              for (int x = 0; x < upper.x - lower.x && !active; x++)
+                active = !(out[x] == background);
+            }
+
+          if (active) {
+            pending[r].slots.push_back(slot);
+            pending[r].values.insert(
+                pending[r].values.end(), leaf.begin(), leaf.end());
+          }
+        }
+      });
+
+      std::vector<size_t> firstLeaf(root.size() + 1, 0);
+      for (size_t r = 0; r < root.size(); r++)
+        firstLeaf[r + 1] = firstLeaf[r] + pending[r].slots.size();
+
+      allocateLeaves(firstLeaf.back());
+      for (size_t r = 0; r < root.size(); r++) {
+        for (size_t k = 0; k < pending[r].slots.size(); k++)
+          addLeaf(r, pending[r].slots[k], firstLeaf[r] + k);
+      }
+
+      tasking::parallel_for(root.size(), [&](size_t r) {
+        const size_t leaf = firstLeaf[r];
+        std::copy(pending[r].values.begin(),
+                  pending[r].values.end(),
+                  values.begin() + leaf * LEAF_CELLS);
+        std::vector<T>().swap(pending[r].values);
+
+        for (size_t k = 0; k < pending[r].slots.size(); k++) {
+          const box3i bounds = leafBounds(uint32_t(leaf + k));
+          const T *v         = values.data() + (leaf + k) * LEAF_CELLS;
+          uint64_t *mask     = masks.data() + (leaf + k) * MASK_WORDS;
+          for_each(bounds, [&](const vec3i &idx) {
+            const size_t i =
+                BrickedArray3D<T, B>::localIndex(idx - bounds.lower);
+            if (!(v[i] == background))
+              mask[i / 64] |= uint64_t(1) << (i % 64);
+          });
+        }
+      });
+
+      finalize();
+    }
+
+    template <typename T, int B, int N>
+    inline SparseArray3D<T, B, N>::SparseArray3D(const vec3i &dims,
+                                                 const T &background,
+                                                 const vec3i *coords,
+                                                 const T *streamValues,
+                                                 size_t n)
+        : SparseArray3D(dims, background)
+    {
+      // sort the cells by leaf, with the leaves of a node next to each other
+      std::vector<uint64_t> keys(n);
+      std::vector<size_t> order(n);
+      std::atomic<bool> outside(false);
+      tasking::parallel_for(n, [&](size_t i) {
+        const vec3i &p = coords[i];
+        if (anyLessThan(p, vec3i(0)) || anyLessThan(dims - vec3i(1), p)) {
+          outside = true;
+          return;
+        }
+        keys[i]  = uint64_t(rootIndex(p)) * NODE_SLOTS + slotOf(p);
+        order[i] = i;
+      });
+
+      if (outside)
+        throw std::runtime_error("SparseArray3D: voxel outside the volume");
+
+      tasking::parallel_radix_sort(keys.data(), order.data(), n);
+
+      std::vector<size_t> runs;  // first cell of each leaf, then n
+      for (size_t i = 0; i < n; i++) {
+        if (i == 0 || keys[i] != keys[i - 1])
+          runs.push_back(i);
+      }
+      runs.push_back(n);
+
+      const size_t numLeaves = runs.size() - 1;
+      allocateLeaves(numLeaves);
+      for (size_t leaf = 0; leaf < numLeaves; leaf++) {
+        const uint64_t key = keys[runs[leaf]];
+        addLeaf(size_t(key / NODE_SLOTS), int(key % NODE_SLOTS), leaf);
+      }
+
+      // stable sort, so later duplicates are written last
+      tasking::parallel_for(numLeaves, [&](size_t leaf) {
+        const vec3i origin = leafOrigins[leaf];
+        T *v               = values.data() + leaf * LEAF_CELLS;
+        uint64_t *mask     = masks.data() + leaf * MASK_WORDS;
+        for (size_t k = runs[leaf]; k < runs[leaf + 1]; k++) {
+          const size_t i =
+              BrickedArray3D<T, B>::localIndex(coords[order[k]] - origin);
+          v[i] = streamValues[order[k]];
+          mask[i / 64] |= uint64_t(1) << (i % 64);
+        }
+      });
+
+      finalize();
+    }
+
+    template <typename T, int B, int N>
+    inline vec3i SparseArray3D<T, B, N>::size() const
+    {
+      return dims;
+    }
+
+    template <typename T, int B, int N>
+    inline T SparseArray3D<T, B, N>::get(const vec3i &_where) const
+    {
+      const vec3i where   = max(vec3i(0), min(_where, dims - vec3i(1)));
+      const uint32_t leaf = leafOf(where);
+      if (leaf == INVALID)
+        return backgroundValue;
+      return values[leaf * size_t(LEAF_CELLS) +
+                    BrickedArray3D<T, B>::localIndex(where % B)];
+    }
+
+    template <typename T, int B, int N>
+    inline void SparseArray3D<T, B, N>::getRow(const vec3i &begin,
+                                               int count,
+                                               T *out) const
+    {
+      // clamped like get(): a piece per leaf, then the ends across x
+      const int y = clamp(begin.y, 0, dims.y - 1);
+      const int z = clamp(begin.z, 0, dims.z - 1);
+
+      int i = 0;
+      for (; i < count && begin.x + i < 0; i++)
+        out[i] = get(vec3i(0, y, z));
+      const int inside = std::min(count, dims.x - begin.x);
+      while (i < inside) {
+        const vec3i where(begin.x + i, y, z);
+        const int n         = std::min(inside - i, B - where.x % B);
+        const uint32_t leaf = leafOf(where);
+        if (leaf == INVALID)
+          std::fill(out + i, out + i + n, backgroundValue);
+        else {
+          const T *from = values.data() + leaf * size_t(LEAF_CELLS) +
+                          BrickedArray3D<T, B>::localIndex(where % B);
+          std::copy(from, from + n, out + i);
+        }
+        i += n;
+      }
+      for (; i < count; i++)
+        out[i] = get(vec3i(dims.x - 1, y, z));
+    }
+
+    template <typename T, int B, int N>
+    inline range_t<T> SparseArray3D<T, B, N>::getValueRange(
+        const vec3i &begin, const vec3i &end) const
+    {
+      if (anyLessThan(end, begin + 1))
+        return get(begin);
+
+      // get() clamps, so only the inside part of the region matters
+      const vec3i lower = max(vec3i(0), min(begin, dims - vec3i(1)));
+      const vec3i upper =
+          max(vec3i(0), min(end, dims) - vec3i(1)) + vec3i(1);
+      const vec3i first = lower / NODE_EXTENT;
+      const vec3i count = (upper - vec3i(1)) / NODE_EXTENT - first + vec3i(1);
+
+      return tasking::parallel_reduce(
+          longProduct(count),
+          range_t<T>(get(lower)),
+          [&](size_t i) {
+            const vec3i cell   = first + coordsOf(i, count);
+            const vec3i origin = cell * NODE_EXTENT;
+            const uint32_t node = root[longIndex(cell, rootDims)];
+            if (node == INVALID)
+              return range_t<T>(backgroundValue);
+
+            const box3i box(max(lower, origin),
+                            min(upper, origin + vec3i(NODE_EXTENT)));
+            if (box.lower == origin &&
+                box.upper == min(dims, origin + vec3i(NODE_EXTENT)))
+              return nodes[node].range;
+            return rangeInNode(nodes[node], origin, box);
+          },
+          [](const range_t<T> &a, const range_t<T> &b) {
+            return range_t<T>(min(a.lower, b.lower), max(a.upper, b.upper));
+          });
+    }
+
+    template <typename T, int B, int N>
+    inline size_t SparseArray3D<T, B, N>::numElements() const
+    {
+      return longProduct(dims);
+    }
+
+    template <typename T, int B, int N>
+    inline const T &SparseArray3D<T, B, N>::background() const
+    {
+      return backgroundValue;
+    }
+
+    template <typename T, int B, int N>
+    inline bool SparseArray3D<T, B, N>::isActive(const vec3i &where) const
+    {
+      if (anyLessThan(where, vec3i(0)) || anyLessThan(dims - vec3i(1), where))
+        return false;
+      const uint32_t leaf = leafOf(where);
+      if (leaf == INVALID)
+        return false;
+      const size_t i = BrickedArray3D<T, B>::localIndex(where % B);
+      return (masks[leaf * size_t(MASK_WORDS) + i / 64] >> (i % 64)) & 1;
+    }
+
+    template <typename T, int B, int N>
+    inline size_t SparseArray3D<T, B, N>::numActiveCells() const
+    {
+      return activeCells;
+    }
+
+    template <typename T, int B, int N>
+    inline size_t SparseArray3D<T, B, N>::numLeaves() const
+    {
+      return leafOrigins.size();
+    }
+
+    template <typename T, int B, int N>
+    inline size_t SparseArray3D<T, B, N>::numNodes() const
+    {
+      return nodes.size();
+    }
+
+    template <typename T, int B, int N>
+    inline size_t SparseArray3D<T, B, N>::memoryBytes() const
+    {
+      return root.size() * sizeof(uint32_t) + nodes.size() * sizeof(Node) +
+             values.size() * sizeof(T) + masks.size() * sizeof(uint64_t) +
+             leafOrigins.size() * (sizeof(vec3i) + sizeof(range_t<T>));
+    }
+
+    template <typename T, int B, int N>
+    template <typename Functor>
+    inline void SparseArray3D<T, B, N>::for_each_active(
+        Functor &&functor) const
+    {
+      for (size_t leaf = 0; leaf < numLeaves(); leaf++) {
+        const T *v            = values.data() + leaf * LEAF_CELLS;
+        const uint64_t *mask  = masks.data() + leaf * MASK_WORDS;
+        const vec3i origin    = leafOrigins[leaf];
+        for (int w = 0; w < MASK_WORDS; w++) {
+          for (uint64_t bits = mask[w]; bits; bits &= bits - 1) {
+            const int i =
+                64 * w + int(containers::detail::countTrailingZeros64(bits));
+            functor(origin + coordsOf(i, vec3i(B)), v[i]);
+          }
+        }
+      }
+    }
+
+    template <typename T, int B, int N>
+    template <typename Functor>
+    inline void SparseArray3D<T, B, N>::parallel_for_each_active(
+        Functor &&functor) const
+    {
+      tasking::parallel_for(numLeaves(), [&](size_t leaf) {
+        const T *v            = values.data() + leaf * LEAF_CELLS;
+        const uint64_t *mask  = masks.data() + leaf * MASK_WORDS;
+        const vec3i origin    = leafOrigins[leaf];
+        for (int w = 0; w < MASK_WORDS; w++) {
+          for (uint64_t bits = mask[w]; bits; bits &= bits - 1) {
+            const int i =
+                64 * w + int(containers::detail::countTrailingZeros64(bits));
+            functor(origin + coordsOf(i, vec3i(B)), v[i]);
+          }
+        }
+      });
+    }
+
+    template <typename T, int B, int N>
+    inline void SparseArray3D<T, B, N>::allocateLeaves(size_t n)
+    {
+      values.assign(n * LEAF_CELLS, backgroundValue);
+      masks.assign(n * MASK_WORDS, 0);
+      leafOrigins.resize(n);
+      leafRanges.resize(n);
+    }
+
+    template <typename T, int B, int N>
+    inline void SparseArray3D<T, B, N>::addLeaf(size_t r,
+                                                int slot,
+                                                size_t leaf)
+    {
+      if (root[r] == INVALID) {
+        root[r] = uint32_t(nodes.size());
+        nodes.emplace_back();
+      }
+      nodes[root[r]].leaves[slot] = uint32_t(leaf);
+      leafOrigins[leaf] =
+          coordsOf(r, rootDims) * NODE_EXTENT + coordsOf(slot, vec3i(N)) * B;
+    }
+
+    template <typename T, int B, int N>
+    inline void SparseArray3D<T, B, N>::finalize()
+    {
+      tasking::parallel_for(numLeaves(), [&](size_t leaf) {
+        leafRanges[leaf] = rangeInLeaf(uint32_t(leaf), leafBounds(leaf));
+      });
+
+      // a node whose leaves miss some of its cells also has background
+      tasking::parallel_for(root.size(), [&](size_t r) {
+        if (root[r] == INVALID)
+          return;
+        Node &node         = nodes[root[r]];
+        const vec3i origin = coordsOf(r, rootDims) * NODE_EXTENT;
+        bool first         = true;
+        for (int slot = 0; slot < NODE_SLOTS; slot++) {
+          const vec3i lower = origin + coordsOf(slot, vec3i(N)) * B;
+          if (anyLessThan(dims - vec3i(1), lower))
+            continue;
+          const uint32_t leaf = node.leaves[slot];
+          const range_t<T> range =
+              leaf == INVALID ? range_t<T>(backgroundValue) : leafRanges[leaf];
+          if (first)
+            node.range = range;
+          else
+            node.range.extend(range);
+          first = false;
+        }
+      });
+
+      activeCells = containers::detail::popcountWords(masks.data(),
+                                                      masks.size());
+    }
+
+    template <typename T, int B, int N>
+    inline uint32_t SparseArray3D<T, B, N>::leafOf(const vec3i &where) const
+    {
+      const uint32_t node = root[rootIndex(where)];
+      return node == INVALID ? INVALID : nodes[node].leaves[slotOf(where)];
+    }
+
+    template <typename T, int B, int N>
+    inline size_t SparseArray3D<T, B, N>::rootIndex(const vec3i &where) const
+    {
+      return longIndex(where / NODE_EXTENT, rootDims);
+    }
+
+    template <typename T, int B, int N>
+    inline int SparseArray3D<T, B, N>::slotOf(const vec3i &where)
+    {
+      const vec3i s = (where / B) % N;
+      return s.x + N * (s.y + N * s.z);
+    }
+
+    template <typename T, int B, int N>
+    inline box3i SparseArray3D<T, B, N>::leafBounds(uint32_t leaf) const
+    {
+      const vec3i lower = leafOrigins[leaf];
+      return box3i(lower, min(lower + vec3i(B), dims));
+    }
+
+    template <typename T, int B, int N>
+    inline range_t<T> SparseArray3D<T, B, N>::rangeInLeaf(
+        uint32_t leaf, const box3i &box) const
+    {
+      const vec3i origin = leafOrigins[leaf];
+      const T *v         = values.data() + leaf * size_t(LEAF_CELLS);
+      range_t<T> range(v[BrickedArray3D<T, B>::localIndex(box.lower - origin)]);
+      for (int z = box.lower.z; z < box.upper.z; z++)
+        for (int y = box.lower.y; y < box.upper.y; y++) {
+          const vec3i row = vec3i(box.lower.x, y, z) - origin;
+          range.extend(
+              detail::rangeOf(v + BrickedArray3D<T, B>::localIndex(row),
+                              size_t(box.upper.x - box.lower.x)));
+        }
+      return range;
+    }
+
+    template <typename T, int B, int N>
+    inline range_t<T> SparseArray3D<T, B, N>::rangeInNode(
+        const Node &node, const vec3i &origin, const box3i &box) const
+    {
+      const vec3i first = (box.lower - origin) / B;
+      const vec3i last  = (box.upper - vec3i(1) - origin) / B;
+
+      range_t<T> range(get(box.lower));
+      for (int z = first.z; z <= last.z; z++)
+        for (int y = first.y; y <= last.y; y++)
+          for (int x = first.x; x <= last.x; x++) {
+            const uint32_t leaf = node.leaves[x + N * (y + N * z)];
+            if (leaf == INVALID) {
+              range.extend(backgroundValue);
+              continue;
+            }
+            const box3i bounds = leafBounds(leaf);
+            const box3i part(max(box.lower, bounds.lower),
+                             min(box.upper, bounds.upper));
+            range.extend(part == bounds ? leafRanges[leaf]
+                                        : rangeInLeaf(leaf, part));
+          }
+      return range;
+    }
+
+  }  // namespace array3D
+}  // namespace rkcommon
@@ -0,0 +1,214 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cmath>
+#include "../memory/ScratchBuffer.h"
+#include "../tasking/parallel_for_tiled.h"
+#include "Array3D.h"
+
+namespace rkcommon {
+  namespace array3D {
+
+    /*! a dense copy of the cells in [lower, lower + dims) of a volume,
+        clamped to it like Array3D::get(); what a stencil kernel reads. At
+        cells of a row, the neighbors along y and z are at fixed offsets
+        (stride(1), stride(2)) so that loops along x vectorize. */
+    template <typename T>
+    struct StencilTile
+    {
+      const T *values;
+      vec3i lower;
+      vec3i dims;
+
+      ptrdiff_t stride(int axis) const
+      {
+        return axis == 0 ? 1
+                         : axis == 1 ? ptrdiff_t(dims.x)
+                                     : ptrdiff_t(dims.x) * dims.y;
+      }
+
+      /*! the cell at 'where', in volume coordinates */
+      const T *at(const vec3i &where) const
+      {
+        const vec3i p = where - lower;
+        assert(p.x >= 0 && p.y >= 0 && p.z >= 0);
+        assert(p.x < dims.x && p.y < dims.y && p.z < dims.z);
+        return values + p.x + size_t(dims.x) * (p.y + size_t(dims.y) * p.z);
+      }
+    };
+
+    /*! runs a stencil of 'radius' cells over 'in', in parallel over tiles
+        of (at most) 'tileSize' cells. Each tile is read into a
+        StencilTile grown by the radius, with one getRow() per row, and
+        then 'fcn(const StencilTile<IN_T> &tile, const vec3i &begin, int
+        count, OUT_T *out)' computes the 'count' cells of the row starting
+        at 'begin' into 'out'. 'out' must have the size of 'in' and must
+        not be the same array. */
+    template <typename IN_T, typename OUT_T, typename KERNEL_T>
+    void applyStencil(const Array3D<IN_T> &in,
+                      ActualArray3D<OUT_T> &out,
+                      const vec3i &radius,
+                      KERNEL_T &&fcn,
+                      const vec3i &tileSize = vec3i(64, 16, 16))
+    {
+      const vec3i dims = in.size();
+      if (out.size() != dims)
+        throw std::runtime_error("applyStencil(): output size mismatch");
+      if (anyLessThan(radius, vec3i(0)))
+        throw std::runtime_error("applyStencil(): negative radius");
+
+      tasking::parallel_for_tiled(
+          vec3i(0), dims, tileSize, [&](const box3i &box) {
+            memory::ScratchScope scratch;
+            StencilTile<IN_T> tile;
+            tile.lower = box.lower - radius;
+            tile.dims  = box.size() + 2 * radius;
+            IN_T *values =
+                scratch.allocate<IN_T>(size_t(tile.dims.long_product()));
+            tile.values = values;
+
+            // the halo rows and columns repeat the volume's edges
+            for (int z = 0; z < tile.dims.z; z++)
+              for (int y = 0; y < tile.dims.y; y++) {
+                in.getRow(tile.lower + vec3i(0, y, z),
+                          tile.dims.x,
+                          values + tile.stride(1) * y + tile.stride(2) * z);
+              }
+
+            const int count = box.size().x;
+            for (int z = box.lower.z; z < box.upper.z; z++)
+              for (int y = box.lower.y; y < box.upper.y; y++) {
+                const vec3i begin(box.lower.x, y, z);
+                fcn(tile, begin, count, out.value + out.indexOf(begin));
+              }
+          });
+    }
+
+    /*! two volumes of the same size to alternate between in multi-pass
+        filters: each pass reads front() and writes back(), then swap()
+        makes its result the new front(). The buffers are allocated once. */
+    template <typename T>
+    class PingPongBuffers
+    {
+     public:
+      explicit PingPongBuffers(const vec3i &dims)
+      {
+        buffers[0].reset(new ActualArray3D<T>(dims));
+        buffers[1].reset(new ActualArray3D<T>(dims));
+      }
+
+      ActualArray3D<T> &front()
+      {
+        return *buffers[current];
+      }
+
+      ActualArray3D<T> &back()
+      {
+        return *buffers[1 - current];
+      }
+
+      void swap()
+      {
+        current = 1 - current;
+      }
+
+     private:
+      std::unique_ptr<ActualArray3D<T>> buffers[2];
+      int current{0};
+    };
+
+    namespace detail {
+
+      /*! one pass of a separable convolution, along 'axis' */
+      template <typename IN_T, typename OUT_T>
+      void convolveAxis(const Array3D<IN_T> &in,
+                        ActualArray3D<OUT_T> &out,
+                        int axis,
+                        const std::vector<float> &weights)
+      {
+        using I = interpolant_t<IN_T>;
+
+        if (weights.size() % 2 == 0)
+          throw std::runtime_error(
+              "convolveSeparable(): kernels need an odd number of weights");
+        const int r = int(weights.size() / 2);
+        vec3i radius(0);
+        radius[axis] = r;
+
+        applyStencil(
+            in,
+            out,
+            radius,
+            [&](const StencilTile<IN_T> &tile,
+                const vec3i &begin,
+                int count,
+                OUT_T *o) {
+              memory::ScratchScope scratch;
+              I *sum = scratch.allocate<I>(count);
+
+              const ptrdiff_t stride = tile.stride(axis);
+              const IN_T *c          = tile.at(begin) - r * stride;
+              for (int x = 0; x < count; x++)
+                sum[x] = weights[0] * c[x];
+              for (size_t k = 1; k < weights.size(); k++) {
+                const float w = weights[k];
+                c += stride;
+                for (int x = 0; x < count; x++)
+                  sum[x] = sum[x] + w * c[x];
+              }
+              for (int x = 0; x < count; x++)
+                o[x] = fromInterpolant<OUT_T>(sum[x]);
+            });
+      }
+
+    }  // namespace detail
+
+    /*! convolves 'in' with the separable kernel wx (x) wy (x) wz, each an
+        odd number of weights centered on the cell, into 'out' (of the
+        same size). Runs one pass per axis through intermediate volumes of
+        interpolant_t<T>, so integer volumes round once at the end. Cells
+        outside the volume repeat its edges. */
+    template <typename T>
+    void convolveSeparable(const Array3D<T> &in,
+                           ActualArray3D<T> &out,
+                           const std::vector<float> &wx,
+                           const std::vector<float> &wy,
+                           const std::vector<float> &wz)
+    {
+      using I = detail::interpolant_t<T>;
+      PingPongBuffers<I> buffers(in.size());
+
+      detail::convolveAxis(in, buffers.back(), 0, wx);
+      buffers.swap();
+      detail::convolveAxis<I, I>(buffers.front(), buffers.back(), 1, wy);
+      buffers.swap();
+      detail::convolveAxis<I, T>(buffers.front(), out, 2, wz);
+    }
+
+    /*! the same kernel 'w' along all axes */
+    template <typename T>
+    void convolveSeparable(const Array3D<T> &in,
+                           ActualArray3D<T> &out,
+                           const std::vector<float> &w)
+    {
+      convolveSeparable(in, out, w, w, w);
+    }
+
+    /*! the 2 * radius + 1 weights of a normalized Gaussian kernel */
+    inline std::vector<float> gaussianWeights(float sigma, int radius)
+    {
+      std::vector<float> w(2 * radius + 1);
+      float sum = 0.f;
+      for (int i = -radius; i <= radius; i++) {
+        w[i + radius] = std::exp(-.5f * (i * i) / (sigma * sigma));
+        sum += w[i + radius];
+      }
+      for (auto &v : w)
+        v /= sum;
+      return w;
+    }
+
+  }  // namespace array3D
+}  // namespace rkcommon
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "../math/box.h"
+#include "../tasking/parallel_for_tiled.h"
 
 /*! \file array3D/for_each Helper templates to do 3D iterations via
   lambda functions */
@@ -71,5 +72,49 @@ namespace rkcommon {
       for_each(coords.lower, coords.upper, std::forward<Functor>(functor));
     }
 
+    /*! iterate through all indices in [lower,upper) in parallel, EXCLUDING
+        the 'upper' value. The domain is split into bricks of 'tileSize'
+        voxels; each brick is walked serially (x fastest) by one worker, so
+        neighboring voxels are processed by the same thread. The functor
+        must be safe to call concurrently for different indices. */
+    template <typename Functor>
+    inline void parallel_for_each(const vec3i &lower,
+                                  const vec3i &upper,
+                                  const vec3i &tileSize,
+                                  Functor &&functor)
+    {
+      tasking::parallel_for_tiled(
+          lower, upper, tileSize, [&](const box3i &tile) {
+            for_each(tile.lower, tile.upper, functor);
+          });
+    }
+
+    template <typename Functor>
+    inline void parallel_for_each(const box3i &coords,
+                                  const vec3i &tileSize,
+                                  Functor &&functor)
+    {
+      parallel_for_each(coords.lower,
+                        coords.upper,
+                        tileSize,
+                        std::forward<Functor>(functor));
+    }
+
+    /*! 2D version of parallel_for_each(), iterating over all vec2i indices
+        in [lower,upper) in tiles of 'tileSize' pixels */
+    template <typename Functor>
+    inline void parallel_for_each(const vec2i &lower,
+                                  const vec2i &upper,
+                                  const vec2i &tileSize,
+                                  Functor &&functor)
+    {
+      tasking::parallel_for_tiled(
+          lower, upper, tileSize, [&](const box2i &tile) {
+            for (int iy = tile.lower.y; iy < tile.upper.y; iy++)
+              for (int ix = tile.lower.x; ix < tile.upper.x; ix++)
+                functor(vec2i(ix, iy));
+          });
+    }
+
   }  // namespace array3D
 }  // namespace rkcommon
@@ -3,7 +3,13 @@
 
 #include "common.h"
 #include "os/library.h"
+#include "utility/Config.h"
+#include <algorithm>
+#include <cctype>
 #include <cmath>
+#if defined(__X86_64__) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
 
 namespace rkcommon {
 
@@ -20,6 +26,22 @@ namespace rkcommon {
     LibraryRepository::getInstance()->add(anchorAddress, name, version);
   }
 
+  void loadLibrary(const void *anchorAddress,
+                   const std::string &name,
+                   const std::vector<int> &version,
+                   const LibraryOptions &options)
+  {
+    LibraryRepository::getInstance()->add(
+        anchorAddress, name, version, options);
+  }
+
+  void loadLibraries(const void *anchorAddress,
+                     const std::vector<std::string> &names,
+                     const LibraryOptions &options)
+  {
+    LibraryRepository::getInstance()->add(anchorAddress, names, options);
+  }
+
   void unloadLibrary(const std::string &name)
   {
     LibraryRepository::getInstance()->remove(name);
@@ -30,6 +52,11 @@ namespace rkcommon {
     return LibraryRepository::getInstance()->getSymbol(name);
   }
 
+  std::vector<void *> getSymbols(const std::vector<std::string> &names)
+  {
+    return LibraryRepository::getInstance()->getSymbols(names);
+  }
+
 #ifdef _WIN32
 #define osp_snprintf sprintf_s
 #else
@@ -92,4 +119,185 @@ namespace rkcommon {
 
 #undef osp_snprintf
 
+  // CPU feature detection ///////////////////////////////////////////////////
+
+#ifdef __X86_64__
+  namespace {
+
+    struct CpuidRegs
+    {
+      uint32_t eax{0}, ebx{0}, ecx{0}, edx{0};
+    };
+
+    CpuidRegs cpuid(uint32_t leaf, uint32_t subleaf = 0)
+    {
+      CpuidRegs r;
+#ifdef _MSC_VER
+      int regs[4];
+      __cpuidex(regs, int(leaf), int(subleaf));
+      r.eax = uint32_t(regs[0]);
+      r.ebx = uint32_t(regs[1]);
+      r.ecx = uint32_t(regs[2]);
+      r.edx = uint32_t(regs[3]);
+#else
+      __cpuid_count(leaf, subleaf, r.eax, r.ebx, r.ecx, r.edx);
+#endif
+      return r;
+    }
+
+    // register state the OS saves on context switches (XCR0)
+    uint64_t xgetbv0()
+    {
+#ifdef _MSC_VER
+      return _xgetbv(0);
+#else
+      uint32_t eax, edx;
+      __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+      return (uint64_t(edx) << 32) | eax;
+#endif
+    }
+
+    inline bool bit(uint32_t reg, int b)
+    {
+      return (reg >> b) & 1;
+    }
+
+  }  // namespace
+#endif
+
+  CpuIsa hostIsa()
+  {
+#ifdef __X86_64__
+    const uint32_t maxLeaf = cpuid(0).eax;
+    const CpuidRegs l1     = cpuid(1);
+    const CpuidRegs l7     = maxLeaf >= 7 ? cpuid(7) : CpuidRegs();
+    const CpuidRegs e1 =
+        cpuid(0x80000000).eax >= 0x80000001 ? cpuid(0x80000001) : CpuidRegs();
+
+    if (!bit(l1.edx, 26))
+      return CpuIsa::Scalar;
+
+    const bool sse42 = bit(l1.ecx, 20) && bit(l1.ecx, 23);
+    if (!sse42)
+      return CpuIsa::SSE2;
+
+    // AVX needs the OS to save the YMM (and for AVX-512 the ZMM and
+    // opmask) registers as well
+    const uint64_t xcr0 = bit(l1.ecx, 27) ? xgetbv0() : 0;
+    const bool avx2 = (xcr0 & 0x6) == 0x6 && bit(l1.ecx, 28) &&
+                      bit(l1.ecx, 12) && bit(l1.ecx, 29) && bit(l7.ebx, 3) &&
+                      bit(l7.ebx, 5) && bit(l7.ebx, 8) && bit(e1.ecx, 5);
+    if (!avx2)
+      return CpuIsa::SSE42;
+
+    const bool avx512 = (xcr0 & 0xe6) == 0xe6 && bit(l7.ebx, 16) &&
+                        bit(l7.ebx, 17) && bit(l7.ebx, 28) &&
+                        bit(l7.ebx, 30) && bit(l7.ebx, 31);
+    return avx512 ? CpuIsa::AVX512 : CpuIsa::AVX2;
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    return CpuIsa::NEON;
+#else
+    return CpuIsa::Scalar;
+#endif
+  }
+
+  // the instruction set the library itself is compiled for
+  static CpuIsa baseIsa()
+  {
+#if defined(RKCOMMON_NO_SIMD)
+    return CpuIsa::Scalar;
+#elif defined(__AVX512F__) && defined(__AVX512CD__) && \
+    defined(__AVX512DQ__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+    return CpuIsa::AVX512;
+#elif defined(__AVX2__) && defined(__FMA__) && defined(__F16C__) && \
+    defined(__BMI2__)
+    return CpuIsa::AVX2;
+#elif defined(__SSE4_2__)
+    return CpuIsa::SSE42;
+#elif defined(__X86_64__)
+    return CpuIsa::SSE2;
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    return CpuIsa::NEON;
+#else
+    return CpuIsa::Scalar;
+#endif
+  }
+
+  // RKCOMMON_ISA_DISPATCH_* are set by the build for the compiled variants
+  static bool hasVariant(CpuIsa isa)
+  {
+    switch (isa) {
+#ifdef RKCOMMON_ISA_DISPATCH_SSE42
+    case CpuIsa::SSE42:
+      return true;
+#endif
+#ifdef RKCOMMON_ISA_DISPATCH_AVX2
+    case CpuIsa::AVX2:
+      return true;
+#endif
+#ifdef RKCOMMON_ISA_DISPATCH_AVX512
+    case CpuIsa::AVX512:
+      return true;
+#endif
+    default:
+      return isa == baseIsa();
+    }
+  }
+
+  static CpuIsa requestedIsa()
+  {
+    const std::string name = utility::config::isa().get();
+    if (name.empty())
+      return CpuIsa::AVX512;
+
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) {
+      return char(std::tolower(static_cast<unsigned char>(c)));
+    });
+
+    for (CpuIsa isa : {CpuIsa::Scalar,
+                       CpuIsa::NEON,
+                       CpuIsa::SSE2,
+                       CpuIsa::SSE42,
+                       CpuIsa::AVX2,
+                       CpuIsa::AVX512}) {
+      if (lower == isaName(isa))
+        return isa;
+    }
+
+    WARNING("ignoring unknown RKCOMMON_ISA '" + name + "'");
+    return CpuIsa::AVX512;
+  }
+
+  CpuIsa activeIsa()
+  {
+    static const CpuIsa isa = []() {
+      const CpuIsa base = baseIsa();
+      CpuIsa best       = std::min(hostIsa(), requestedIsa());
+      while (best > base && !hasVariant(best))
+        best = CpuIsa(int(best) - 1);
+      return std::max(best, base);
+    }();
+    return isa;
+  }
+
+  const char *isaName(CpuIsa isa)
+  {
+    switch (isa) {
+    case CpuIsa::Scalar:
+      return "scalar";
+    case CpuIsa::NEON:
+      return "neon";
+    case CpuIsa::SSE2:
+      return "sse2";
+    case CpuIsa::SSE42:
+      return "sse4.2";
+    case CpuIsa::AVX2:
+      return "avx2";
+    case CpuIsa::AVX512:
+      return "avx512";
+    }
+    return "unknown";
+  }
+
 }  // namespace rkcommon
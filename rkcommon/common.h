@@ -50,19 +50,77 @@ namespace rkcommon {
                                       int where,
                                       int howMany);
 
+  // How loadLibrary() opens a library
+  struct LibraryOptions
+  {
+    // bind the library's own references to other libraries on their first
+    // call (RTLD_LAZY) instead of all at once while loading (RTLD_NOW), which
+    // reports missing ones up front; ignored on Windows
+    bool lazyBinding{true};
+    // open the library on the first getSymbol() which gets to it, instead of
+    // right away; errors opening it are thrown from there
+    bool deferred{false};
+  };
+
   // anchorAddress = nullptr will disable anchored loads
   RKCOMMON_INTERFACE void loadLibrary(
       const void *anchorAddress, const std::string &name,
       const std::vector<int> &version = {});
 
+  RKCOMMON_INTERFACE void loadLibrary(const void *anchorAddress,
+                                      const std::string &name,
+                                      const std::vector<int> &version,
+                                      const LibraryOptions &options);
+
+  // loads independent libraries in parallel, keeping the order of 'names'
+  // for symbol lookups; throws the first error after adding the others
+  RKCOMMON_INTERFACE void loadLibraries(const void *anchorAddress,
+                                        const std::vector<std::string> &names,
+                                        const LibraryOptions &options = {});
+
   RKCOMMON_INTERFACE void unloadLibrary(const std::string &name);
 
   RKCOMMON_INTERFACE void *getSymbol(const std::string &name);
 
+  // getSymbol() as a function pointer, e.g. getSymbol<void(int)>("init")
+  template <typename FCN_T>
+  inline FCN_T *getSymbol(const std::string &name)
+  {
+    return reinterpret_cast<FCN_T *>(getSymbol(name));
+  }
+
+  // resolves a batch of symbols at once, e.g. all entry points of a library
+  // right after loading it
+  RKCOMMON_INTERFACE std::vector<void *> getSymbols(
+      const std::vector<std::string> &names);
+
   RKCOMMON_INTERFACE std::string prettyDouble(double x);
 
   RKCOMMON_INTERFACE std::string prettyNumber(size_t x);
 
+  /* Instruction sets of the multi-versioned math kernels (see
+     math/dispatch.h), ordered by capability within each architecture */
+  enum class CpuIsa
+  {
+    Scalar,
+    NEON,
+    SSE2,
+    SSE42,   // with POPCNT
+    AVX2,    // with FMA, F16C, BMI1/2 and LZCNT
+    AVX512,  // AVX-512 F, CD, DQ, BW and VL
+  };
+
+  // best instruction set supported by both the host CPU and the OS
+  RKCOMMON_INTERFACE CpuIsa hostIsa();
+
+  /* Instruction set the kernels run with: hostIsa(), capped by the
+     RKCOMMON_ISA environment variable (scalar, neon, sse2, sse4.2, avx2 or
+     avx512) and lowered to the best variant this build of rkcommon has.
+     Determined once, on the first call. */
+  RKCOMMON_INTERFACE CpuIsa activeIsa();
+
+  RKCOMMON_INTERFACE const char *isaName(CpuIsa isa);
+
   // NOTE(jda) - Implement make_unique() as it didn't show up until C++14...
   template <typename T, typename... Args>
   inline std::unique_ptr<T> make_unique(Args &&... args)
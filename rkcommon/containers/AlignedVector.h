@@ -12,5 +12,21 @@ namespace rkcommon {
     template <typename T>
     using AlignedVector = std::vector<T, aligned_allocator<T>>;
 
+    // Same alignment, large vectors are placed on NUMA nodes by POLICY
+    template <typename T,
+              memory::NumaPolicy POLICY =
+                  memory::NumaPolicy::FIRST_TOUCH_PARALLEL>
+    using NumaAlignedVector = std::vector<T, numa_aligned_allocator<T, POLICY>>;
+
+    // Same alignment, in host memory a GPU can access
+    template <typename T,
+              memory::DeviceMemory KIND = memory::DeviceMemory::HOST_PINNED>
+    using DeviceAlignedVector =
+        std::vector<T, device_aligned_allocator<T, KIND>>;
+
+    // Same alignment, but allocated from a memory::Arena
+    template <typename T>
+    using ArenaVector = std::vector<T, memory::ArenaAllocator<T>>;
+
   }  // namespace containers
 }  // namespace rkcommon
\ No newline at end of file
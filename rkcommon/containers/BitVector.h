@@ -0,0 +1,542 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "../tasking/parallel_for.h"
+#include "../tasking/tasking_system_init.h"
+#include "AlignedVector.h"
+
+#ifndef RKCOMMON_NO_SIMD
+#ifdef _WIN32
+#include <intrin.h>
+#elif defined(__ARM_NEON)
+#include "../math/arm/emulation.h"
+#else
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#endif
+#endif
+
+namespace rkcommon {
+  namespace containers {
+
+    namespace detail {
+
+      inline uint32_t popcount64(uint64_t x)
+      {
+#if defined(_MSC_VER) && defined(_M_X64)
+        return uint32_t(__popcnt64(x));
+#elif defined(_MSC_VER)
+        x = x - ((x >> 1) & 0x5555555555555555ull);
+        x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+        x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+        return uint32_t((x * 0x0101010101010101ull) >> 56);
+#else
+        return uint32_t(__builtin_popcountll(x));
+#endif
+      }
+
+      inline uint32_t countTrailingZeros64(uint64_t x)
+      {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanForward64(&index, x);
+        return uint32_t(index);
+#else
+        return uint32_t(__builtin_ctzll(x));
+#endif
+      }
+
+      // Number of set bits in 'n' words
+      inline size_t popcountWords(const uint64_t *words, size_t n)
+      {
+        size_t i     = 0;
+        size_t total = 0;
+#ifndef RKCOMMON_NO_SIMD
+        // per-byte counts with the SWAR popcount, summed by psadbw
+#if defined(__AVX2__)
+        {
+          const __m256i m1 = _mm256_set1_epi8(0x55);
+          const __m256i m2 = _mm256_set1_epi8(0x33);
+          const __m256i m4 = _mm256_set1_epi8(0x0f);
+          __m256i acc      = _mm256_setzero_si256();
+          for (; i + 4 <= n; i += 4) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(words + i));
+            v = _mm256_sub_epi8(v, _mm256_and_si256(_mm256_srli_epi64(v, 1), m1));
+            v = _mm256_add_epi8(_mm256_and_si256(v, m2),
+                                _mm256_and_si256(_mm256_srli_epi64(v, 2), m2));
+            v = _mm256_and_si256(_mm256_add_epi8(v, _mm256_srli_epi64(v, 4)), m4);
+            acc = _mm256_add_epi64(acc,
+                                   _mm256_sad_epu8(v, _mm256_setzero_si256()));
+          }
+          alignas(32) uint64_t sums[4];
+          _mm256_store_si256((__m256i *)sums, acc);
+          total += sums[0] + sums[1] + sums[2] + sums[3];
+        }
+#endif
+        const __m128i m1 = _mm_set1_epi8(0x55);
+        const __m128i m2 = _mm_set1_epi8(0x33);
+        const __m128i m4 = _mm_set1_epi8(0x0f);
+        __m128i acc      = _mm_setzero_si128();
+        for (; i + 2 <= n; i += 2) {
+          __m128i v = _mm_loadu_si128((const __m128i *)(words + i));
+          v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi64(v, 1), m1));
+          v = _mm_add_epi8(_mm_and_si128(v, m2),
+                           _mm_and_si128(_mm_srli_epi64(v, 2), m2));
+          v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi64(v, 4)), m4);
+          acc = _mm_add_epi64(acc, _mm_sad_epu8(v, _mm_setzero_si128()));
+        }
+        alignas(16) uint64_t sums[2];
+        _mm_store_si128((__m128i *)sums, acc);
+        total += sums[0] + sums[1];
+#endif
+        for (; i < n; ++i)
+          total += popcount64(words[i]);
+        return total;
+      }
+
+    }  // namespace detail
+
+    /* A dynamically sized bitset packed into 64-bit words, e.g. for
+       visibility masks or dirty flags which would take 8x the memory as a
+       byte array. Unlike std::vector<bool> the words are exposed, so bulk
+       operations and counting run a word (or SIMD vector) at a time. Bits
+       past size() are kept zero. */
+    class BitVector
+    {
+     public:
+      using word_t = uint64_t;
+
+      static constexpr size_t BITS_PER_WORD = 64;
+
+      BitVector() = default;
+      explicit BitVector(size_t numBits, bool value = false);
+
+      // Single bits //
+
+      bool operator[](size_t i) const;
+      bool test(size_t i) const;
+
+      void set(size_t i);
+      void set(size_t i, bool value);
+      void reset(size_t i);
+      void flip(size_t i);
+
+      // All bits //
+
+      void set();
+      void reset();
+      void flip();
+
+      size_t count() const;
+      bool any() const;
+      bool none() const;
+      bool all() const;
+
+      // Index of the first set bit at or after 'i', size() if there is none
+      size_t find_next_set(size_t i) const;
+      size_t find_first_set() const;
+
+      // Bulk operations, both sides must have the same size //
+
+      BitVector &operator&=(const BitVector &other);
+      BitVector &operator|=(const BitVector &other);
+      BitVector &operator^=(const BitVector &other);
+
+      // Clear the bits which are set in 'other'
+      BitVector &andNot(const BitVector &other);
+
+      /* Call 'fcn(size_t index)' for every set bit, in parallel. The words
+         are split into tasks holding about the same number of set bits, so
+         sparse and dense regions are balanced. */
+      template <typename FCN_T>
+      void parallel_for_each_set_bit(FCN_T &&fcn) const;
+
+      // Properties //
+
+      size_t size() const;
+      bool empty() const;
+
+      size_t numWords() const;
+      word_t *data();
+      const word_t *data() const;
+
+      // Mutation //
+
+      void resize(size_t numBits, bool value = false);
+      void clear();
+
+     private:
+      static size_t wordsFor(size_t numBits);
+
+      // Zero the unused bits of the last word
+      void trim();
+
+      template <typename OP>
+      BitVector &combine(const BitVector &other, OP &&op);
+
+      // Data members //
+
+      AlignedVector<word_t> words;
+      size_t numBits{0};
+    };
+
+    bool operator==(const BitVector &a, const BitVector &b);
+    bool operator!=(const BitVector &a, const BitVector &b);
+
+    BitVector operator&(BitVector a, const BitVector &b);
+    BitVector operator|(BitVector a, const BitVector &b);
+    BitVector operator^(BitVector a, const BitVector &b);
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    inline BitVector::BitVector(size_t numBits, bool value)
+    {
+      resize(numBits, value);
+    }
+
+    inline size_t BitVector::wordsFor(size_t numBits)
+    {
+      return (numBits + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    }
+
+    inline void BitVector::trim()
+    {
+      const size_t tail = numBits % BITS_PER_WORD;
+      if (tail)
+        words.back() &= (word_t(1) << tail) - 1;
+    }
+
+    inline bool BitVector::operator[](size_t i) const
+    {
+      return (words[i / BITS_PER_WORD] >> (i % BITS_PER_WORD)) & 1;
+    }
+
+    inline bool BitVector::test(size_t i) const
+    {
+      if (i >= numBits)
+        throw std::out_of_range("BitVector index out of range");
+      return (*this)[i];
+    }
+
+    inline void BitVector::set(size_t i)
+    {
+      words[i / BITS_PER_WORD] |= word_t(1) << (i % BITS_PER_WORD);
+    }
+
+    inline void BitVector::set(size_t i, bool value)
+    {
+      if (value)
+        set(i);
+      else
+        reset(i);
+    }
+
+    inline void BitVector::reset(size_t i)
+    {
+      words[i / BITS_PER_WORD] &= ~(word_t(1) << (i % BITS_PER_WORD));
+    }
+
+    inline void BitVector::flip(size_t i)
+    {
+      words[i / BITS_PER_WORD] ^= word_t(1) << (i % BITS_PER_WORD);
+    }
+
+    inline void BitVector::set()
+    {
+      std::fill(words.begin(), words.end(), ~word_t(0));
+      trim();
+    }
+
+    inline void BitVector::reset()
+    {
+      std::fill(words.begin(), words.end(), word_t(0));
+    }
+
+    inline void BitVector::flip()
+    {
+      for (auto &w : words)
+        w = ~w;
+      trim();
+    }
+
+    inline size_t BitVector::count() const
+    {
+      return detail::popcountWords(words.data(), words.size());
+    }
+
+    inline bool BitVector::any() const
+    {
+      return std::any_of(
+          words.begin(), words.end(), [](word_t w) { return w != 0; });
+    }
+
+    inline bool BitVector::none() const
+    {
+      return !any();
+    }
+
+    inline bool BitVector::all() const
+    {
+      return count() == numBits;
+    }
+
+    inline size_t BitVector::find_next_set(size_t i) const
+    {
+      if (i >= numBits)
+        return numBits;
+
+      size_t w    = i / BITS_PER_WORD;
+      word_t bits = words[w] & (~word_t(0) << (i % BITS_PER_WORD));
+      while (!bits) {
+        if (++w == words.size())
+          return numBits;
+        bits = words[w];
+      }
+      return w * BITS_PER_WORD + detail::countTrailingZeros64(bits);
+    }
+
+    inline size_t BitVector::find_first_set() const
+    {
+      return find_next_set(0);
+    }
+
+    template <typename OP>
+    inline BitVector &BitVector::combine(const BitVector &other, OP &&op)
+    {
+      if (other.numBits != numBits)
+        throw std::runtime_error("BitVector sizes do not match");
+
+      word_t *a       = words.data();
+      const word_t *b = other.words.data();
+      const size_t n  = words.size();
+      size_t i        = 0;
+#ifndef RKCOMMON_NO_SIMD
+      // the storage of both is aligned to 64 bytes
+      for (; i + 2 <= n; i += 2) {
+        const __m128i va = _mm_load_si128((const __m128i *)(a + i));
+        const __m128i vb = _mm_load_si128((const __m128i *)(b + i));
+        _mm_store_si128((__m128i *)(a + i), op(va, vb));
+      }
+#endif
+      for (; i < n; ++i)
+        a[i] = op(a[i], b[i]);
+      return *this;
+    }
+
+    // Word and SIMD variants of the bulk operations //
+
+    namespace detail {
+
+      struct BitAnd
+      {
+        uint64_t operator()(uint64_t a, uint64_t b) const
+        {
+          return a & b;
+        }
+#ifndef RKCOMMON_NO_SIMD
+        __m128i operator()(__m128i a, __m128i b) const
+        {
+          return _mm_and_si128(a, b);
+        }
+#endif
+      };
+
+      struct BitOr
+      {
+        uint64_t operator()(uint64_t a, uint64_t b) const
+        {
+          return a | b;
+        }
+#ifndef RKCOMMON_NO_SIMD
+        __m128i operator()(__m128i a, __m128i b) const
+        {
+          return _mm_or_si128(a, b);
+        }
+#endif
+      };
+
+      struct BitXor
+      {
+        uint64_t operator()(uint64_t a, uint64_t b) const
+        {
+          return a ^ b;
+        }
+#ifndef RKCOMMON_NO_SIMD
+        __m128i operator()(__m128i a, __m128i b) const
+        {
+          return _mm_xor_si128(a, b);
+        }
+#endif
+      };
+
+      struct BitAndNot
+      {
+        uint64_t operator()(uint64_t a, uint64_t b) const
+        {
+          return a & ~b;
+        }
+#ifndef RKCOMMON_NO_SIMD
+        __m128i operator()(__m128i a, __m128i b) const
+        {
+          return _mm_andnot_si128(b, a);
+        }
+#endif
+      };
+
+    }  // namespace detail
+
+    inline BitVector &BitVector::operator&=(const BitVector &other)
+    {
+      return combine(other, detail::BitAnd());
+    }
+
+    inline BitVector &BitVector::operator|=(const BitVector &other)
+    {
+      return combine(other, detail::BitOr());
+    }
+
+    inline BitVector &BitVector::operator^=(const BitVector &other)
+    {
+      return combine(other, detail::BitXor());
+    }
+
+    inline BitVector &BitVector::andNot(const BitVector &other)
+    {
+      return combine(other, detail::BitAndNot());
+    }
+
+    template <typename FCN_T>
+    inline void BitVector::parallel_for_each_set_bit(FCN_T &&fcn) const
+    {
+      // count the bits of blocks of words, then cut the word range into
+      // tasks at block boundaries whenever enough set bits were passed
+      const size_t WORDS_PER_BLOCK = 64;
+      const size_t numBlocks =
+          (words.size() + WORDS_PER_BLOCK - 1) / WORDS_PER_BLOCK;
+      if (numBlocks == 0)
+        return;
+
+      std::vector<size_t> blockCounts(numBlocks);
+      tasking::parallel_for(numBlocks, [&](size_t b) {
+        const size_t first = b * WORDS_PER_BLOCK;
+        blockCounts[b]     = detail::popcountWords(
+            words.data() + first,
+            std::min(WORDS_PER_BLOCK, words.size() - first));
+      });
+
+      size_t total = 0;
+      for (size_t c : blockCounts)
+        total += c;
+      if (total == 0)
+        return;
+
+      const size_t numTasks = std::min<size_t>(
+          numBlocks, 4 * size_t(std::max(1, tasking::numTaskingThreads())));
+      const size_t bitsPerTask = (total + numTasks - 1) / numTasks;
+
+      std::vector<size_t> taskBegin(1, 0);
+      size_t acc = 0;
+      for (size_t b = 0; b < numBlocks; ++b) {
+        acc += blockCounts[b];
+        if (acc >= bitsPerTask && b + 1 < numBlocks) {
+          taskBegin.push_back((b + 1) * WORDS_PER_BLOCK);
+          acc = 0;
+        }
+      }
+      taskBegin.push_back(words.size());
+
+      tasking::parallel_for(taskBegin.size() - 1, [&](size_t t) {
+        for (size_t w = taskBegin[t]; w < taskBegin[t + 1]; ++w) {
+          word_t bits = words[w];
+          while (bits) {
+            fcn(w * BITS_PER_WORD + detail::countTrailingZeros64(bits));
+            bits &= bits - 1;
+          }
+        }
+      });
+    }
+
+    inline size_t BitVector::size() const
+    {
+      return numBits;
+    }
+
+    inline bool BitVector::empty() const
+    {
+      return numBits == 0;
+    }
+
+    inline size_t BitVector::numWords() const
+    {
+      return words.size();
+    }
+
+    inline BitVector::word_t *BitVector::data()
+    {
+      return words.data();
+    }
+
+    inline const BitVector::word_t *BitVector::data() const
+    {
+      return words.data();
+    }
+
+    inline void BitVector::resize(size_t newNumBits, bool value)
+    {
+      const size_t oldNumBits = numBits;
+      words.resize(wordsFor(newNumBits), value ? ~word_t(0) : word_t(0));
+
+      // the unused bits of the old last word are zero, set them too
+      if (value && newNumBits > oldNumBits && oldNumBits % BITS_PER_WORD) {
+        words[oldNumBits / BITS_PER_WORD] |= ~word_t(0)
+                                             << (oldNumBits % BITS_PER_WORD);
+      }
+
+      numBits = newNumBits;
+      trim();
+    }
+
+    inline void BitVector::clear()
+    {
+      words.clear();
+      numBits = 0;
+    }
+
+    inline bool operator==(const BitVector &a, const BitVector &b)
+    {
+      return a.size() == b.size()
+             && std::equal(a.data(), a.data() + a.numWords(), b.data());
+    }
+
+    inline bool operator!=(const BitVector &a, const BitVector &b)
+    {
+      return !(a == b);
+    }
+
+    inline BitVector operator&(BitVector a, const BitVector &b)
+    {
+      return a &= b;
+    }
+
+    inline BitVector operator|(BitVector a, const BitVector &b)
+    {
+      return a |= b;
+    }
+
+    inline BitVector operator^(BitVector a, const BitVector &b)
+    {
+      return a ^= b;
+    }
+
+  }  // namespace containers
+}  // namespace rkcommon
@@ -0,0 +1,417 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../memory/EpochManager.h"
+#include "FlatHashMap.h"
+// std
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace rkcommon {
+  namespace containers {
+
+    /* A hash map for lookup tables shared across threads, e.g. per-thread
+       records or parameter tables, which are read far more often than
+       written.
+
+       find() takes no lock and writes no shared memory: it walks bucket
+       chains of atomic pointers while pinned to the map's EpochManager.
+       Writers lock one of NUM_STRIPES mutexes by the key's hash, so
+       writes of different keys mostly proceed in parallel; growing the
+       table locks all of them. Erased entries, replaced values and old
+       tables are retired to the EpochManager and freed once no reader can
+       see them anymore.
+
+       Values are immutable once inserted. References returned by find(),
+       emplace() and insert_or_assign() stay valid until the key is erased
+       or assigned (or the map is cleared), and then for as long as the
+       caller keeps a pin() taken before that. Pinning costs a fence, which
+       nested pins skip: batches of lookups are cheaper under one pin(). */
+    template <typename K,
+              typename V,
+              typename HASH  = FlatHash<K>,
+              typename EQUAL = FlatEqual<K>>
+    class ConcurrentHashMap
+    {
+     public:
+      static constexpr size_t NUM_STRIPES = 64;
+
+      explicit ConcurrentHashMap(size_t capacity = 0);
+      ~ConcurrentHashMap();
+
+      ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+      ConcurrentHashMap &operator=(const ConcurrentHashMap &) = delete;
+
+      /*! keeps the references of concurrently erased keys valid */
+      memory::EpochManager::Guard pin() const;
+
+      // Lock-free lookups //
+
+      /*! the value of 'key', or nullptr */
+      const V *find(const K &key) const;
+
+      bool contains(const K &key) const;
+
+      /*! calls 'fcn(const K &, const V &)' for all entries, while pinned;
+          concurrent writes may or may not be seen */
+      template <typename FCN_T>
+      void for_each(FCN_T &&fcn) const;
+
+      size_t size() const;
+      bool empty() const;
+
+      // Writes //
+
+      /*! inserts V(args...) if 'key' is not in the map; returns the value
+          of 'key' and whether it was inserted */
+      template <typename... ARGS>
+      std::pair<const V &, bool> emplace(const K &key, ARGS &&... args);
+
+      /*! sets the value of 'key'; returns it and whether it was inserted */
+      std::pair<const V &, bool> insert_or_assign(const K &key, V value);
+
+      bool erase(const K &key);
+
+      void clear();
+
+     private:
+      struct Node
+      {
+        template <typename... ARGS>
+        Node(const K &key, ARGS &&... args)
+            : key(key), value(std::forward<ARGS>(args)...)
+        {
+        }
+
+        const K key;
+        const V value;
+      };
+
+      // entries of a bucket chain; the nodes outlive the tables
+      struct Link
+      {
+        std::atomic<Link *> next;
+        std::atomic<Node *> node;
+        size_t hash;
+      };
+
+      struct Table
+      {
+        explicit Table(size_t numBuckets);
+        ~Table();
+
+        const size_t mask;
+        std::atomic<Link *> *buckets;
+      };
+
+      template <typename T, typename... ARGS>
+      static T *create(ARGS &&... args);
+      template <typename T>
+      static void destroy(T *object);
+
+      static size_t hashOf(const K &key);
+
+      Link *findLink(const Table &table, const K &key, size_t hash) const;
+
+      // relinks all entries into a table with twice the buckets
+      void grow(const Table *seen);
+
+      // Data members //
+
+      std::atomic<Table *> table;
+      std::atomic<size_t> count{0};
+      mutable memory::EpochManager epochs;
+      std::mutex stripes[NUM_STRIPES];
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline ConcurrentHashMap<K, V, HASH, EQUAL>::Table::Table(
+        size_t numBuckets)
+        : mask(numBuckets - 1),
+          buckets(new std::atomic<Link *>[numBuckets])
+    {
+      for (size_t i = 0; i < numBuckets; i++)
+        buckets[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline ConcurrentHashMap<K, V, HASH, EQUAL>::Table::~Table()
+    {
+      for (size_t i = 0; i <= mask; i++) {
+        Link *l = buckets[i].load(std::memory_order_relaxed);
+        while (l) {
+          Link *next = l->next.load(std::memory_order_relaxed);
+          destroy(l);
+          l = next;
+        }
+      }
+      delete[] buckets;
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    template <typename T, typename... ARGS>
+    inline T *ConcurrentHashMap<K, V, HASH, EQUAL>::create(ARGS &&... args)
+    {
+      // alignedMalloc() memory, as EpochManager::retireObject() expects
+      void *ptr =
+          memory::alignedMalloc(sizeof(T), alignof(T) > 16 ? alignof(T) : 16);
+      try {
+        return new (ptr) T(std::forward<ARGS>(args)...);
+      } catch (...) {
+        memory::alignedFree(ptr);
+        throw;
+      }
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    template <typename T>
+    inline void ConcurrentHashMap<K, V, HASH, EQUAL>::destroy(T *object)
+    {
+      object->~T();
+      memory::alignedFree(object);
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline size_t ConcurrentHashMap<K, V, HASH, EQUAL>::hashOf(const K &key)
+    {
+      // remixed, as the low bits pick both the bucket and the stripe
+      return size_t(detail::mixHashBits(uint64_t(HASH()(key))));
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline ConcurrentHashMap<K, V, HASH, EQUAL>::ConcurrentHashMap(
+        size_t capacity)
+    {
+      // the stripe of a bucket is fixed as long as there are at least as
+      // many buckets as stripes
+      size_t n = NUM_STRIPES;
+      while (n < capacity)
+        n *= 2;
+      table.store(create<Table>(n), std::memory_order_relaxed);
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline ConcurrentHashMap<K, V, HASH, EQUAL>::~ConcurrentHashMap()
+    {
+      Table *t = table.load(std::memory_order_relaxed);
+      for (size_t i = 0; i <= t->mask; i++) {
+        for (Link *l = t->buckets[i].load(std::memory_order_relaxed); l;
+             l       = l->next.load(std::memory_order_relaxed)) {
+          destroy(l->node.load(std::memory_order_relaxed));
+        }
+      }
+      destroy(t);
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline memory::EpochManager::Guard
+    ConcurrentHashMap<K, V, HASH, EQUAL>::pin() const
+    {
+      return epochs.pin();
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline typename ConcurrentHashMap<K, V, HASH, EQUAL>::Link *
+    ConcurrentHashMap<K, V, HASH, EQUAL>::findLink(const Table &t,
+                                                   const K &key,
+                                                   size_t hash) const
+    {
+      Link *l = t.buckets[hash & t.mask].load(std::memory_order_acquire);
+      for (; l; l = l->next.load(std::memory_order_acquire)) {
+        if (l->hash == hash &&
+            EQUAL()(l->node.load(std::memory_order_acquire)->key, key))
+          return l;
+      }
+      return nullptr;
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline const V *ConcurrentHashMap<K, V, HASH, EQUAL>::find(
+        const K &key) const
+    {
+      auto guard    = epochs.pin();
+      const Table *t = table.load(std::memory_order_acquire);
+      Link *l       = findLink(*t, key, hashOf(key));
+      return l ? &l->node.load(std::memory_order_acquire)->value : nullptr;
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline bool ConcurrentHashMap<K, V, HASH, EQUAL>::contains(
+        const K &key) const
+    {
+      return find(key) != nullptr;
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    template <typename FCN_T>
+    inline void ConcurrentHashMap<K, V, HASH, EQUAL>::for_each(
+        FCN_T &&fcn) const
+    {
+      auto guard     = epochs.pin();
+      const Table *t = table.load(std::memory_order_acquire);
+      for (size_t i = 0; i <= t->mask; i++) {
+        for (Link *l = t->buckets[i].load(std::memory_order_acquire); l;
+             l       = l->next.load(std::memory_order_acquire)) {
+          const Node *node = l->node.load(std::memory_order_acquire);
+          fcn(node->key, node->value);
+        }
+      }
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline size_t ConcurrentHashMap<K, V, HASH, EQUAL>::size() const
+    {
+      return count.load(std::memory_order_relaxed);
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline bool ConcurrentHashMap<K, V, HASH, EQUAL>::empty() const
+    {
+      return size() == 0;
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    template <typename... ARGS>
+    inline std::pair<const V &, bool>
+    ConcurrentHashMap<K, V, HASH, EQUAL>::emplace(const K &key,
+                                                  ARGS &&... args)
+    {
+      const size_t hash = hashOf(key);
+      const Node *node  = nullptr;
+      Table *t          = nullptr;
+      size_t buckets    = 0;
+      {
+        std::lock_guard<std::mutex> lock(stripes[hash % NUM_STRIPES]);
+        t = table.load(std::memory_order_relaxed);
+        if (Link *l = findLink(*t, key, hash)) {
+          return {l->node.load(std::memory_order_relaxed)->value, false};
+        }
+
+        node    = create<Node>(key, std::forward<ARGS>(args)...);
+        Link *l = create<Link>();
+        l->node.store(const_cast<Node *>(node), std::memory_order_relaxed);
+        l->hash = hash;
+        std::atomic<Link *> &head = t->buckets[hash & t->mask];
+        l->next.store(head.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+        head.store(l, std::memory_order_release);
+        count.fetch_add(1, std::memory_order_relaxed);
+        // read under the lock: once it is released, a grow() of another
+        // thread may retire 't', which only serves as a token from here on
+        buckets = t->mask + 1;
+      }
+
+      // at a load factor of 2, like the chains of std::unordered_map grow
+      if (count.load(std::memory_order_relaxed) > 2 * buckets)
+        grow(t);
+      return {node->value, true};
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline std::pair<const V &, bool>
+    ConcurrentHashMap<K, V, HASH, EQUAL>::insert_or_assign(const K &key,
+                                                           V value)
+    {
+      const size_t hash = hashOf(key);
+      {
+        std::lock_guard<std::mutex> lock(stripes[hash % NUM_STRIPES]);
+        Table *t = table.load(std::memory_order_relaxed);
+        if (Link *l = findLink(*t, key, hash)) {
+          Node *node = create<Node>(key, std::move(value));
+          epochs.retireObject(
+              l->node.exchange(node, std::memory_order_acq_rel));
+          return {node->value, false};
+        }
+      }
+      // not there: emplace() locks again and only moves from 'value' if it
+      // inserts; another thread's insert in between is assigned instead
+      auto inserted = emplace(key, std::move(value));
+      if (inserted.second)
+        return inserted;
+      return insert_or_assign(key, std::move(value));
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline bool ConcurrentHashMap<K, V, HASH, EQUAL>::erase(const K &key)
+    {
+      const size_t hash = hashOf(key);
+      std::lock_guard<std::mutex> lock(stripes[hash % NUM_STRIPES]);
+      Table *t                    = table.load(std::memory_order_relaxed);
+      std::atomic<Link *> *before = &t->buckets[hash & t->mask];
+      for (Link *l = before->load(std::memory_order_relaxed); l;
+           before  = &l->next, l = before->load(std::memory_order_relaxed)) {
+        Node *node = l->node.load(std::memory_order_relaxed);
+        if (l->hash == hash && EQUAL()(node->key, key)) {
+          // readers on 'l' still find their way on through its next
+          before->store(l->next.load(std::memory_order_relaxed),
+                        std::memory_order_release);
+          count.fetch_sub(1, std::memory_order_relaxed);
+          epochs.retireObject(node);
+          epochs.retireObject(l);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline void ConcurrentHashMap<K, V, HASH, EQUAL>::grow(const Table *seen)
+    {
+      for (auto &s : stripes)
+        s.lock();
+
+      Table *old = table.load(std::memory_order_relaxed);
+      // another thread may have grown the table meanwhile
+      if (old == seen) {
+        // new links, as readers may still walk the chains of 'old'
+        Table *t = create<Table>(2 * (old->mask + 1));
+        for (size_t i = 0; i <= old->mask; i++) {
+          for (Link *l = old->buckets[i].load(std::memory_order_relaxed); l;
+               l       = l->next.load(std::memory_order_relaxed)) {
+            Link *copy = create<Link>();
+            copy->node.store(l->node.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+            copy->hash                = l->hash;
+            std::atomic<Link *> &head = t->buckets[l->hash & t->mask];
+            copy->next.store(head.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+            head.store(copy, std::memory_order_relaxed);
+          }
+        }
+        table.store(t, std::memory_order_release);
+        epochs.retireObject(old);
+      }
+
+      for (auto &s : stripes)
+        s.unlock();
+    }
+
+    template <typename K, typename V, typename HASH, typename EQUAL>
+    inline void ConcurrentHashMap<K, V, HASH, EQUAL>::clear()
+    {
+      for (auto &s : stripes)
+        s.lock();
+
+      Table *old = table.load(std::memory_order_relaxed);
+      for (size_t i = 0; i <= old->mask; i++) {
+        for (Link *l = old->buckets[i].load(std::memory_order_relaxed); l;
+             l       = l->next.load(std::memory_order_relaxed)) {
+          epochs.retireObject(l->node.load(std::memory_order_relaxed));
+        }
+      }
+      table.store(create<Table>(old->mask + 1), std::memory_order_release);
+      count.store(0, std::memory_order_relaxed);
+      epochs.retireObject(old);
+
+      for (auto &s : stripes)
+        s.unlock();
+    }
+
+  }  // namespace containers
+}  // namespace rkcommon
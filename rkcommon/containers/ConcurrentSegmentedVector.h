@@ -0,0 +1,496 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "../memory/malloc.h"
+#include "../tasking/parallel_for.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace rkcommon {
+  namespace containers {
+
+    namespace detail {
+
+      inline uint32_t log2Floor(uint64_t x)
+      {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanReverse64(&index, x);
+        return uint32_t(index);
+#else
+        return 63 - uint32_t(__builtin_clzll(x));
+#endif
+      }
+
+    }  // namespace detail
+
+    /* An append-only vector which many threads can grow at the same time.
+       Elements live in segments which are never moved, so references and
+       pointers to them stay valid until clear() or destruction. Segment k
+       holds FIRST_SEGMENT_SIZE << k elements and is allocated on first use.
+
+       grow_by(), push_back() and emplace_back() are thread-safe and return
+       the index of the (first) new element; a chunk claimed by grow_by() is
+       contiguous in index space, and in memory unless it crosses into the
+       next segment. size() counts elements which are still being
+       constructed by other threads, so only read elements another thread
+       appended after synchronizing with it. clear() and iterating are not
+       thread-safe with respect to growing. */
+    template <typename T, size_t FIRST_SEGMENT_SIZE = 64>
+    class ConcurrentSegmentedVector
+    {
+      static_assert(FIRST_SEGMENT_SIZE > 0
+                        && (FIRST_SEGMENT_SIZE & (FIRST_SEGMENT_SIZE - 1)) == 0,
+                    "ConcurrentSegmentedVector<> requires FIRST_SEGMENT_SIZE "
+                    "to be a power of two");
+
+      template <typename VECTOR_T, typename VALUE_T>
+      class Iterator;
+
+     public:
+      using value_type     = T;
+      using size_type      = size_t;
+      using iterator       = Iterator<ConcurrentSegmentedVector, T>;
+      using const_iterator = Iterator<const ConcurrentSegmentedVector, const T>;
+
+      ConcurrentSegmentedVector();
+      ~ConcurrentSegmentedVector();
+
+      ConcurrentSegmentedVector(const ConcurrentSegmentedVector &) = delete;
+      ConcurrentSegmentedVector &operator=(const ConcurrentSegmentedVector &) =
+          delete;
+
+      // Thread-safe growth //
+
+      size_t grow_by(size_t n);
+      size_t grow_by(size_t n, const T &value);
+
+      size_t push_back(const T &value);
+      size_t push_back(T &&value);
+
+      template <typename... Args>
+      T &emplace_back(Args &&... args);
+
+      // Element access //
+
+      T &operator[](size_t i);
+      const T &operator[](size_t i) const;
+
+      T &back();
+      const T &back() const;
+
+      // Properties //
+
+      size_t size() const;
+      bool empty() const;
+
+      // Not thread-safe //
+
+      void clear();
+
+      // Call 'fcn(T *begin, size_t count)' for each contiguous run of
+      // elements, in order
+      template <typename FCN_T>
+      void forEachChunk(FCN_T &&fcn);
+      template <typename FCN_T>
+      void forEachChunk(FCN_T &&fcn) const;
+
+      // Call 'fcn(T &)' for all elements using tasking::parallel_for(), in
+      // blocks of FIRST_SEGMENT_SIZE which never cross a segment
+      template <typename FCN_T>
+      void parallel_for_each(FCN_T &&fcn);
+      template <typename FCN_T>
+      void parallel_for_each(FCN_T &&fcn) const;
+
+      // Iterators //
+
+      iterator begin();
+      const_iterator begin() const;
+      const_iterator cbegin() const;
+
+      iterator end();
+      const_iterator end() const;
+      const_iterator cend() const;
+
+     private:
+      static constexpr size_t MAX_SEGMENTS = 64;
+
+      static size_t segmentOf(size_t i);
+      static size_t segmentBase(size_t segment);
+      static size_t segmentSize(size_t segment);
+
+      T *ensureSegment(size_t segment);
+      T *address(size_t i) const;
+
+      // Claim 'n' indices and construct them with 'construct(T *)'
+      template <typename CONSTRUCT_T>
+      size_t claim(size_t n, CONSTRUCT_T &&construct);
+
+      // Data members //
+
+      std::atomic<size_t> size_{0};
+      std::atomic<T *> segments[MAX_SEGMENTS];
+    };
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    template <typename VECTOR_T, typename VALUE_T>
+    class ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::Iterator
+    {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type        = typename std::remove_const<VALUE_T>::type;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = VALUE_T *;
+      using reference         = VALUE_T &;
+
+      Iterator() = default;
+      Iterator(VECTOR_T *v, size_t i) : v(v), i(i) {}
+
+      reference operator*() const
+      {
+        return (*v)[i];
+      }
+
+      pointer operator->() const
+      {
+        return &(*v)[i];
+      }
+
+      Iterator &operator++()
+      {
+        ++i;
+        return *this;
+      }
+
+      Iterator operator++(int)
+      {
+        Iterator old = *this;
+        ++i;
+        return old;
+      }
+
+      bool operator==(const Iterator &other) const
+      {
+        return i == other.i;
+      }
+
+      bool operator!=(const Iterator &other) const
+      {
+        return i != other.i;
+      }
+
+     private:
+      VECTOR_T *v{nullptr};
+      size_t i{0};
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    constexpr size_t
+        ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::MAX_SEGMENTS;
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline ConcurrentSegmentedVector<T,
+                                     FIRST_SEGMENT_SIZE>::ConcurrentSegmentedVector()
+    {
+      for (auto &s : segments)
+        s.store(nullptr, std::memory_order_relaxed);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline ConcurrentSegmentedVector<T,
+                                     FIRST_SEGMENT_SIZE>::~ConcurrentSegmentedVector()
+    {
+      clear();
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline size_t ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::segmentOf(
+        size_t i)
+    {
+      return detail::log2Floor(i / FIRST_SEGMENT_SIZE + 1);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline size_t
+    ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::segmentBase(
+        size_t segment)
+    {
+      return FIRST_SEGMENT_SIZE * ((size_t(1) << segment) - 1);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline size_t
+    ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::segmentSize(
+        size_t segment)
+    {
+      return FIRST_SEGMENT_SIZE << segment;
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline T *ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::ensureSegment(
+        size_t segment)
+    {
+      T *s = segments[segment].load(std::memory_order_acquire);
+      if (s)
+        return s;
+
+      // several threads may race to allocate the segment, one of them wins
+      T *fresh = memory::alignedMalloc<T>(segmentSize(segment),
+                                          std::max<size_t>(alignof(T), 64));
+      if (segments[segment].compare_exchange_strong(
+              s, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+        return fresh;
+
+      memory::alignedFree(fresh);
+      return s;
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline T *ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::address(
+        size_t i) const
+    {
+      const size_t segment = segmentOf(i);
+      return segments[segment].load(std::memory_order_acquire)
+             + (i - segmentBase(segment));
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    template <typename CONSTRUCT_T>
+    inline size_t ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::claim(
+        size_t n, CONSTRUCT_T &&construct)
+    {
+      const size_t first = size_.fetch_add(n);
+      const size_t last  = first + n;
+
+      size_t i = first;
+      while (i < last) {
+        const size_t segment = segmentOf(i);
+        T *s                 = ensureSegment(segment);
+        const size_t base    = segmentBase(segment);
+        const size_t end     = std::min(last, base + segmentSize(segment));
+        for (; i < end; ++i)
+          construct(s + (i - base));
+      }
+
+      return first;
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline size_t ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::grow_by(
+        size_t n)
+    {
+      return claim(n, [](T *p) { new (p) T(); });
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline size_t ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::grow_by(
+        size_t n, const T &value)
+    {
+      return claim(n, [&](T *p) { new (p) T(value); });
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline size_t ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::push_back(
+        const T &value)
+    {
+      return claim(1, [&](T *p) { new (p) T(value); });
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline size_t ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::push_back(
+        T &&value)
+    {
+      return claim(1, [&](T *p) { new (p) T(std::move(value)); });
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    template <typename... Args>
+    inline T &ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::emplace_back(
+        Args &&... args)
+    {
+      T *result = nullptr;
+      claim(1, [&](T *p) { result = new (p) T(std::forward<Args>(args)...); });
+      return *result;
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline T &ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::operator[](
+        size_t i)
+    {
+      return *address(i);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline const T &ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::
+    operator[](size_t i) const
+    {
+      return *address(i);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline T &ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::back()
+    {
+      return *address(size() - 1);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline const T &ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::back()
+        const
+    {
+      return *address(size() - 1);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline size_t ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::size() const
+    {
+      return size_.load(std::memory_order_acquire);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline bool ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::empty() const
+    {
+      return size() == 0;
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline void ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::clear()
+    {
+      forEachChunk([](T *begin, size_t count) {
+        for (size_t i = 0; i < count; ++i)
+          begin[i].~T();
+      });
+
+      for (auto &s : segments) {
+        memory::alignedFree(s.load());
+        s.store(nullptr);
+      }
+
+      size_.store(0);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    template <typename FCN_T>
+    inline void ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::forEachChunk(
+        FCN_T &&fcn)
+    {
+      const size_t count = size();
+      for (size_t segment = 0; segmentBase(segment) < count; ++segment) {
+        const size_t base = segmentBase(segment);
+        fcn(segments[segment].load(std::memory_order_acquire),
+            std::min(segmentSize(segment), count - base));
+      }
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    template <typename FCN_T>
+    inline void ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::forEachChunk(
+        FCN_T &&fcn) const
+    {
+      const size_t count = size();
+      for (size_t segment = 0; segmentBase(segment) < count; ++segment) {
+        const size_t base = segmentBase(segment);
+        fcn(static_cast<const T *>(
+                segments[segment].load(std::memory_order_acquire)),
+            std::min(segmentSize(segment), count - base));
+      }
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    template <typename FCN_T>
+    inline void
+    ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::parallel_for_each(
+        FCN_T &&fcn)
+    {
+      const size_t count     = size();
+      const size_t numBlocks = (count + FIRST_SEGMENT_SIZE - 1)
+                               / FIRST_SEGMENT_SIZE;
+      tasking::parallel_for(numBlocks, [&](size_t block) {
+        const size_t first = block * FIRST_SEGMENT_SIZE;
+        const size_t last  = std::min(count, first + FIRST_SEGMENT_SIZE);
+        T *p               = address(first);
+        for (size_t i = first; i < last; ++i, ++p)
+          fcn(*p);
+      });
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    template <typename FCN_T>
+    inline void
+    ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::parallel_for_each(
+        FCN_T &&fcn) const
+    {
+      const size_t count     = size();
+      const size_t numBlocks = (count + FIRST_SEGMENT_SIZE - 1)
+                               / FIRST_SEGMENT_SIZE;
+      tasking::parallel_for(numBlocks, [&](size_t block) {
+        const size_t first = block * FIRST_SEGMENT_SIZE;
+        const size_t last  = std::min(count, first + FIRST_SEGMENT_SIZE);
+        const T *p         = address(first);
+        for (size_t i = first; i < last; ++i, ++p)
+          fcn(*p);
+      });
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline typename ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::iterator
+    ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::begin()
+    {
+      return iterator(this, 0);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline typename ConcurrentSegmentedVector<T,
+                                              FIRST_SEGMENT_SIZE>::const_iterator
+    ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::begin() const
+    {
+      return const_iterator(this, 0);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline typename ConcurrentSegmentedVector<T,
+                                              FIRST_SEGMENT_SIZE>::const_iterator
+    ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::cbegin() const
+    {
+      return const_iterator(this, 0);
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline typename ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::iterator
+    ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::end()
+    {
+      return iterator(this, size());
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline typename ConcurrentSegmentedVector<T,
+                                              FIRST_SEGMENT_SIZE>::const_iterator
+    ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::end() const
+    {
+      return const_iterator(this, size());
+    }
+
+    template <typename T, size_t FIRST_SEGMENT_SIZE>
+    inline typename ConcurrentSegmentedVector<T,
+                                              FIRST_SEGMENT_SIZE>::const_iterator
+    ConcurrentSegmentedVector<T, FIRST_SEGMENT_SIZE>::cend() const
+    {
+      return const_iterator(this, size());
+    }
+
+  }  // namespace containers
+}  // namespace rkcommon
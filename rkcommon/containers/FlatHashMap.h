@@ -0,0 +1,719 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "AlignedVector.h"
+
+// Include vector intrinsics for probing control bytes
+#ifndef RKCOMMON_NO_SIMD
+#if defined(_WIN32)
+#include <intrin.h>
+#elif defined(__ARM_NEON)
+#include "../math/arm/emulation.h"
+#else
+#include <emmintrin.h>
+#endif
+#endif
+
+namespace rkcommon {
+  namespace containers {
+
+    // Default hash of FlatHashMap. Strings hash the same whether given as
+    // std::string or const char *, so either can be used to look up keys.
+    template <typename KEY, typename = void>
+    struct FlatHash
+    {
+      size_t operator()(const KEY &key) const
+      {
+        return std::hash<KEY>()(key);
+      }
+    };
+
+    namespace detail {
+
+      // 64-bit finalizer of splitmix64, spreads integer keys over all bits
+      inline uint64_t mixHashBits(uint64_t x)
+      {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+      }
+
+      inline uint32_t countTrailingZeros(uint32_t x)
+      {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanForward(&index, x);
+        return uint32_t(index);
+#else
+        return uint32_t(__builtin_ctz(x));
+#endif
+      }
+
+      // FNV-1a
+      inline uint64_t hashBytes(const char *data, size_t size)
+      {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; ++i) {
+          h ^= uint64_t(uint8_t(data[i]));
+          h *= 0x100000001b3ull;
+        }
+        return mixHashBits(h);
+      }
+
+    }  // namespace detail
+
+    template <typename KEY>
+    struct FlatHash<KEY,
+                    typename std::enable_if<std::is_integral<KEY>::value
+                                            || std::is_enum<KEY>::value
+                                            || std::is_pointer<KEY>::value>::type>
+    {
+      size_t operator()(const KEY &key) const
+      {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &key, sizeof(KEY) < 8 ? sizeof(KEY) : 8);
+        return size_t(detail::mixHashBits(bits));
+      }
+    };
+
+    template <>
+    struct FlatHash<std::string>
+    {
+      using is_transparent = void;
+
+      size_t operator()(const std::string &key) const
+      {
+        return size_t(detail::hashBytes(key.data(), key.size()));
+      }
+
+      size_t operator()(const char *key) const
+      {
+        return size_t(detail::hashBytes(key, std::strlen(key)));
+      }
+    };
+
+    // Default key comparison of FlatHashMap, also compares std::string keys
+    // against const char * without a temporary std::string
+    template <typename KEY>
+    struct FlatEqual
+    {
+      bool operator()(const KEY &a, const KEY &b) const
+      {
+        return a == b;
+      }
+    };
+
+    template <>
+    struct FlatEqual<std::string>
+    {
+      using is_transparent = void;
+
+      bool operator()(const std::string &a, const std::string &b) const
+      {
+        return a == b;
+      }
+
+      bool operator()(const std::string &a, const char *b) const
+      {
+        return a.compare(b) == 0;
+      }
+    };
+
+    /* An unordered map with O(1) lookups which, unlike std::unordered_map<>,
+       does not allocate a node per item: items live in one contiguous
+       aligned array. It uses open addressing with one control byte per slot
+       (the Swiss table design): 7 bits of each key's hash are kept in the
+       control bytes, which are probed 16 at a time with SIMD compares, so
+       keys are only compared for likely matches.
+
+       Lookups are templated on the key type: with the default FlatHash and
+       FlatEqual a const char * finds std::string keys without constructing
+       a temporary. Iterators and references are invalidated by inserts
+       which grow the map, and keys must not be modified through iterators.
+     */
+    template <typename KEY,
+              typename VALUE,
+              typename HASH  = FlatHash<KEY>,
+              typename EQUAL = FlatEqual<KEY>>
+    class FlatHashMap
+    {
+      template <bool CONST>
+      class Iterator;
+
+     public:
+      using item_t      = std::pair<KEY, VALUE>;
+      using iterator_t  = Iterator<false>;
+      using citerator_t = Iterator<true>;
+
+      FlatHashMap() = default;
+      FlatHashMap(const FlatHashMap &other);
+      FlatHashMap(FlatHashMap &&other);
+      ~FlatHashMap();
+
+      FlatHashMap &operator=(const FlatHashMap &other);
+      FlatHashMap &operator=(FlatHashMap &&other);
+
+      // Key-based lookups //
+
+      template <typename K>
+      VALUE &at(const K &key);
+      template <typename K>
+      const VALUE &at(const K &key) const;
+
+      VALUE &operator[](const KEY &key);
+
+      template <typename K>
+      iterator_t find(const K &key);
+      template <typename K>
+      citerator_t find(const K &key) const;
+
+      template <typename K>
+      bool contains(const K &key) const;
+
+      // Property queries //
+
+      size_t size() const;
+      bool empty() const;
+
+      // Number of slots, the map grows when 7/8 of them are used
+      size_t capacity() const;
+
+      // Storage mutation //
+
+      // Returns the item of 'key' and whether it was inserted
+      std::pair<iterator_t, bool> insert(const item_t &item);
+
+      template <typename K>
+      bool erase(const K &key);
+
+      void clear();
+
+      // Make room for 'size' items without growing
+      void reserve(size_t size);
+
+      // Iterators //
+
+      iterator_t begin();
+      citerator_t begin() const;
+      citerator_t cbegin() const;
+
+      iterator_t end();
+      citerator_t end() const;
+      citerator_t cend() const;
+
+     private:
+      static constexpr size_t GROUP_SIZE = 16;
+
+      static constexpr int8_t EMPTY   = -128;  // 0b10000000
+      static constexpr int8_t DELETED = -2;    // 0b11111110
+
+      using slot_t =
+          typename std::aligned_storage<sizeof(item_t), alignof(item_t)>::type;
+
+      template <bool CONST>
+      class Iterator
+      {
+       public:
+        using map_t = typename std::
+            conditional<CONST, const FlatHashMap, FlatHashMap>::type;
+        using value_type = item_t;
+        using reference =
+            typename std::conditional<CONST, const item_t &, item_t &>::type;
+        using pointer =
+            typename std::conditional<CONST, const item_t *, item_t *>::type;
+        using difference_type   = ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iterator() = default;
+        Iterator(map_t *map, size_t index) : map(map), index(index)
+        {
+          skipUnused();
+        }
+
+        // iterator_t converts to citerator_t
+        template <bool C = CONST, typename = typename std::enable_if<C>::type>
+        Iterator(const Iterator<false> &other)
+            : map(other.map), index(other.index)
+        {
+        }
+
+        reference operator*() const
+        {
+          return *map->item(index);
+        }
+
+        pointer operator->() const
+        {
+          return map->item(index);
+        }
+
+        Iterator &operator++()
+        {
+          ++index;
+          skipUnused();
+          return *this;
+        }
+
+        Iterator operator++(int)
+        {
+          Iterator old = *this;
+          ++*this;
+          return old;
+        }
+
+        bool operator==(const Iterator &other) const
+        {
+          return index == other.index;
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+          return index != other.index;
+        }
+
+       private:
+        template <bool>
+        friend class Iterator;
+
+        void skipUnused()
+        {
+          while (index < map->capacity() && map->control[index] < 0)
+            ++index;
+        }
+
+        map_t *map{nullptr};
+        size_t index{0};
+      };
+
+      // Helpers //
+
+      item_t *item(size_t index);
+      const item_t *item(size_t index) const;
+
+      // Bit i set for each control byte i of the group at 'group' equal to
+      // 'value'
+      uint32_t matchGroup(size_t group, int8_t value) const;
+
+      // Same for EMPTY or DELETED control bytes, the ones with the sign set
+      uint32_t matchFree(size_t group) const;
+
+      template <typename K>
+      size_t findIndex(const K &key) const;
+
+      // Slot for a new item with hash 'h', growing the map if needed
+      size_t prepareInsert(size_t h);
+
+      void rehash(size_t newCapacity);
+      void destroyItems();
+
+      static uint8_t h2(size_t h);
+
+      // Data //
+
+      AlignedVector<int8_t> control;  // EMPTY, DELETED or h2 of the item
+      AlignedVector<slot_t> slots;
+
+      size_t numItems{0};
+      size_t growthLeft{0};  // inserts into EMPTY slots before rehashing
+
+      HASH hasher;
+      EQUAL equal;
+    };
+
+    // Inlined definitions ////////////////////////////////////////////////////
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    constexpr size_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::GROUP_SIZE;
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    constexpr int8_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::EMPTY;
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    constexpr int8_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::DELETED;
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline FlatHashMap<KEY, VALUE, HASH, EQUAL>::FlatHashMap(
+        const FlatHashMap &other)
+        : hasher(other.hasher), equal(other.equal)
+    {
+      reserve(other.size());
+      for (const auto &i : other)
+        insert(i);
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline FlatHashMap<KEY, VALUE, HASH, EQUAL>::FlatHashMap(
+        FlatHashMap &&other)
+        : hasher(other.hasher), equal(other.equal)
+    {
+      *this = std::move(other);
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline FlatHashMap<KEY, VALUE, HASH, EQUAL>::~FlatHashMap()
+    {
+      destroyItems();
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline FlatHashMap<KEY, VALUE, HASH, EQUAL>
+        &FlatHashMap<KEY, VALUE, HASH, EQUAL>::operator=(
+            const FlatHashMap &other)
+    {
+      if (this != &other) {
+        FlatHashMap copy(other);
+        *this = std::move(copy);
+      }
+      return *this;
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline FlatHashMap<KEY, VALUE, HASH, EQUAL>
+        &FlatHashMap<KEY, VALUE, HASH, EQUAL>::operator=(FlatHashMap &&other)
+    {
+      if (this != &other) {
+        clear();
+        control.swap(other.control);
+        slots.swap(other.slots);
+        std::swap(numItems, other.numItems);
+        std::swap(growthLeft, other.growthLeft);
+        std::swap(hasher, other.hasher);
+        std::swap(equal, other.equal);
+      }
+      return *this;
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    template <typename K>
+    inline VALUE &FlatHashMap<KEY, VALUE, HASH, EQUAL>::at(const K &key)
+    {
+      const size_t index = findIndex(key);
+      if (index == capacity())
+        throw std::out_of_range("key wasn't found in FlatHashMap<>");
+      return item(index)->second;
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    template <typename K>
+    inline const VALUE &FlatHashMap<KEY, VALUE, HASH, EQUAL>::at(
+        const K &key) const
+    {
+      const size_t index = findIndex(key);
+      if (index == capacity())
+        throw std::out_of_range("key wasn't found in FlatHashMap<>");
+      return item(index)->second;
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline VALUE &FlatHashMap<KEY, VALUE, HASH, EQUAL>::operator[](
+        const KEY &key)
+    {
+      return insert(item_t(key, VALUE())).first->second;
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    template <typename K>
+    inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::iterator_t
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::find(const K &key)
+    {
+      return iterator_t(this, findIndex(key));
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    template <typename K>
+    inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::citerator_t
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::find(const K &key) const
+    {
+      return citerator_t(this, findIndex(key));
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    template <typename K>
+    inline bool FlatHashMap<KEY, VALUE, HASH, EQUAL>::contains(
+        const K &key) const
+    {
+      return findIndex(key) != capacity();
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline size_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::size() const
+    {
+      return numItems;
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline bool FlatHashMap<KEY, VALUE, HASH, EQUAL>::empty() const
+    {
+      return numItems == 0;
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline size_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::capacity() const
+    {
+      return control.size();
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline std::pair<typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::iterator_t,
+                     bool>
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::insert(const item_t &i)
+    {
+      const size_t existing = findIndex(i.first);
+      if (existing != capacity())
+        return std::make_pair(iterator_t(this, existing), false);
+
+      const size_t index = prepareInsert(hasher(i.first));
+      new (&slots[index]) item_t(i);
+      return std::make_pair(iterator_t(this, index), true);
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    template <typename K>
+    inline bool FlatHashMap<KEY, VALUE, HASH, EQUAL>::erase(const K &key)
+    {
+      const size_t index = findIndex(key);
+      if (index == capacity())
+        return false;
+
+      item(index)->~item_t();
+      --numItems;
+
+      // probes only continue past groups without EMPTY slots, so if this
+      // group has one the slot can become EMPTY instead of a tombstone
+      const size_t group = index / GROUP_SIZE;
+      if (matchGroup(group, EMPTY)) {
+        control[index] = EMPTY;
+        ++growthLeft;
+      } else {
+        control[index] = DELETED;
+      }
+      return true;
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline void FlatHashMap<KEY, VALUE, HASH, EQUAL>::clear()
+    {
+      destroyItems();
+      std::fill(control.begin(), control.end(), EMPTY);
+      numItems   = 0;
+      growthLeft = capacity() - capacity() / 8;
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline void FlatHashMap<KEY, VALUE, HASH, EQUAL>::reserve(size_t size)
+    {
+      size_t newCapacity = GROUP_SIZE;
+      while (newCapacity - newCapacity / 8 < size)
+        newCapacity *= 2;
+      if (newCapacity > capacity())
+        rehash(newCapacity);
+    }
+
+    // Iterators //
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::iterator_t
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::begin()
+    {
+      return iterator_t(this, 0);
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::citerator_t
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::begin() const
+    {
+      return cbegin();
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::citerator_t
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::cbegin() const
+    {
+      return citerator_t(this, 0);
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::iterator_t
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::end()
+    {
+      return iterator_t(this, capacity());
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::citerator_t
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::end() const
+    {
+      return cend();
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::citerator_t
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::cend() const
+    {
+      return citerator_t(this, capacity());
+    }
+
+    // Helper functions //
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::item_t *
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::item(size_t index)
+    {
+      return reinterpret_cast<item_t *>(&slots[index]);
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline const typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::item_t *
+    FlatHashMap<KEY, VALUE, HASH, EQUAL>::item(size_t index) const
+    {
+      return reinterpret_cast<const item_t *>(&slots[index]);
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline uint32_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::matchGroup(
+        size_t group, int8_t value) const
+    {
+      const int8_t *ctrl = control.data() + group * GROUP_SIZE;
+#ifndef RKCOMMON_NO_SIMD
+      const __m128i bytes = _mm_load_si128((const __m128i *)ctrl);
+      return uint32_t(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(value))));
+#else
+      uint32_t mask = 0;
+      for (size_t i = 0; i < GROUP_SIZE; ++i)
+        mask |= uint32_t(ctrl[i] == value) << i;
+      return mask;
+#endif
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline uint32_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::matchFree(
+        size_t group) const
+    {
+      const int8_t *ctrl = control.data() + group * GROUP_SIZE;
+#ifndef RKCOMMON_NO_SIMD
+      return uint32_t(_mm_movemask_epi8(_mm_load_si128((const __m128i *)ctrl)));
+#else
+      uint32_t mask = 0;
+      for (size_t i = 0; i < GROUP_SIZE; ++i)
+        mask |= uint32_t(ctrl[i] < 0) << i;
+      return mask;
+#endif
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline uint8_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::h2(size_t h)
+    {
+      return uint8_t(h & 0x7f);
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    template <typename K>
+    inline size_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::findIndex(
+        const K &key) const
+    {
+      if (numItems == 0)
+        return capacity();
+
+      const size_t h         = hasher(key);
+      const size_t groupMask = capacity() / GROUP_SIZE - 1;
+
+      // triangular probing visits every group when their count is a power
+      // of two
+      size_t group = (h >> 7) & groupMask;
+      for (size_t step = 1;; ++step) {
+        uint32_t candidates = matchGroup(group, int8_t(h2(h)));
+        while (candidates) {
+          const size_t index =
+              group * GROUP_SIZE + detail::countTrailingZeros(candidates);
+          if (equal(item(index)->first, key))
+            return index;
+          candidates &= candidates - 1;
+        }
+
+        if (matchGroup(group, EMPTY) || step > groupMask)
+          return capacity();
+
+        group = (group + step) & groupMask;
+      }
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline size_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::prepareInsert(size_t h)
+    {
+      if (growthLeft == 0) {
+        // mostly tombstones: clean up in place, otherwise grow
+        const size_t newCapacity =
+            numItems < capacity() / 2 && capacity() > 0
+                ? capacity()
+                : std::max(GROUP_SIZE, capacity() * 2);
+        rehash(newCapacity);
+      }
+
+      const size_t groupMask = capacity() / GROUP_SIZE - 1;
+
+      size_t group = (h >> 7) & groupMask;
+      for (size_t step = 1;; ++step) {
+        const uint32_t free = matchFree(group);
+        if (free) {
+          const size_t index =
+              group * GROUP_SIZE + detail::countTrailingZeros(free);
+          if (control[index] == EMPTY)
+            --growthLeft;
+          control[index] = int8_t(h2(h));
+          ++numItems;
+          return index;
+        }
+        group = (group + step) & groupMask;
+      }
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline void FlatHashMap<KEY, VALUE, HASH, EQUAL>::rehash(
+        size_t newCapacity)
+    {
+      AlignedVector<int8_t> oldControl(newCapacity, EMPTY);
+      AlignedVector<slot_t> oldSlots(newCapacity);
+      oldControl.swap(control);
+      oldSlots.swap(slots);
+
+      numItems   = 0;
+      growthLeft = newCapacity - newCapacity / 8;
+
+      for (size_t i = 0; i < oldControl.size(); ++i) {
+        if (oldControl[i] < 0)
+          continue;
+        item_t *old        = reinterpret_cast<item_t *>(&oldSlots[i]);
+        const size_t index = prepareInsert(hasher(old->first));
+        new (&slots[index]) item_t(std::move(*old));
+        old->~item_t();
+      }
+    }
+
+    template <typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline void FlatHashMap<KEY, VALUE, HASH, EQUAL>::destroyItems()
+    {
+      for (size_t i = 0; i < control.size(); ++i) {
+        if (control[i] >= 0)
+          item(i)->~item_t();
+      }
+    }
+
+  }  // namespace containers
+}  // namespace rkcommon
@@ -4,23 +4,73 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+// Include vector intrinsics for SplitKeys searches
+#ifndef RKCOMMON_NO_SIMD
+#if defined(_WIN32)
+#include <intrin.h>
+#elif defined(__ARM_NEON)
+#include "../math/arm/emulation.h"
+#else
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#endif
+#endif
+
 namespace rkcommon {
   namespace containers {
 
+    // Storage policies of FlatMap //
+
+    // Items stay in insertion order, lookups are a linear search (default)
+    struct InsertionOrder
+    {
+    };
+
+    // Items are kept sorted by key (requires KEY::operator<), lookups are a
+    // binary search and inserts O(n)
+    struct SortedKeys
+    {
+    };
+
+    // Items stay in insertion order, but the keys are mirrored in a separate
+    // array which is searched 4 to 8 keys at a time with SIMD compares;
+    // for integral and pointer keys
+    struct SplitKeys
+    {
+    };
+
     // A small map data structure with a similar interface to std::map<>, but
     // uses an underlying std::vector<> to store the key/value pairs instead of
     // a tree. This makes lookups O(n), but inserts are O(1) and it is sortable
     // like an array to enable things like std::binary_search() on either the
-    // keys or values.
-    template <typename KEY, typename VALUE>
+    // keys or values. With the SortedKeys and SplitKeys policies keys must not
+    // be modified through iterators. ALLOCATOR is used for all storage, e.g.
+    // a memory::ArenaAllocator<> for maps which only live for one frame.
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY    = InsertionOrder,
+              typename ALLOCATOR = std::allocator<std::pair<KEY, VALUE>>>
     struct FlatMap
     {
+      static_assert(!std::is_same<POLICY, SplitKeys>::value
+                        || std::is_integral<KEY>::value
+                        || std::is_pointer<KEY>::value
+                        || std::is_enum<KEY>::value,
+                    "FlatMap<> with SplitKeys requires integral, enum or "
+                    "pointer keys");
+
       using item_t       = std::pair<KEY, VALUE>;
-      using storage_t    = std::vector<item_t>;
+      using storage_t    = std::vector<item_t, ALLOCATOR>;
       using iterator_t   = decltype(std::declval<storage_t>().begin());
       using citerator_t  = decltype(std::declval<storage_t>().cbegin());
       using riterator_t  = decltype(std::declval<storage_t>().rbegin());
@@ -29,6 +79,8 @@ namespace rkcommon {
       FlatMap()  = default;
       ~FlatMap() = default;
 
+      explicit FlatMap(const ALLOCATOR &allocator);
+
       // Key-based lookups //
 
       VALUE &at(const KEY &key);
@@ -80,15 +132,97 @@ namespace rkcommon {
       iterator_t lookup(const KEY &key);
       citerator_t lookup(const KEY &key) const;
 
+      // Index of 'key' (size() if not found), or for SortedKeys of the first
+      // item not less than 'key'
+      size_t findIndex(const KEY &key, InsertionOrder) const;
+      size_t findIndex(const KEY &key, SortedKeys) const;
+      size_t findIndex(const KEY &key, SplitKeys) const;
+
+      bool matches(size_t index, const KEY &key) const;
+
       // Data //
 
+      using key_allocator_t = typename std::allocator_traits<
+          ALLOCATOR>::template rebind_alloc<KEY>;
+
       storage_t values;
+      std::vector<KEY, key_allocator_t> keys;  // SplitKeys only
     };
 
+    namespace detail {
+
+      // Index of the first of 'n' keys equal to 'key', 'n' if there is none
+      template <typename KEY>
+      inline size_t simdFindKey(const KEY *keys, size_t n, const KEY &key)
+      {
+        size_t i = 0;
+#ifndef RKCOMMON_NO_SIMD
+        if (sizeof(KEY) == 4 || sizeof(KEY) == 8) {
+          // compare 32-bit lanes, a key matches if all its bytes did
+          const int laneMask = (1 << sizeof(KEY)) - 1;
+          uint64_t bits      = 0;
+          std::memcpy(&bits, &key, sizeof(KEY));
+
+#if defined(__AVX2__)
+          const __m256i needle256 =
+              sizeof(KEY) == 4 ? _mm256_set1_epi32(int(bits))
+                               : _mm256_set1_epi64x(int64_t(bits));
+          const size_t perVector256 = 32 / sizeof(KEY);
+          for (; i + perVector256 <= n; i += perVector256) {
+            const __m256i v = _mm256_loadu_si256((const __m256i *)(keys + i));
+            const uint32_t mask = uint32_t(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi32(v, needle256)));
+            if (mask) {
+              for (size_t j = 0; j < perVector256; ++j) {
+                if (((mask >> (j * sizeof(KEY))) & laneMask)
+                    == uint32_t(laneMask))
+                  return i + j;
+              }
+            }
+          }
+#endif
+          const __m128i needle = sizeof(KEY) == 4
+                                     ? _mm_set1_epi32(int(bits))
+                                     : _mm_set1_epi64x(int64_t(bits));
+          const size_t perVector = 16 / sizeof(KEY);
+          for (; i + perVector <= n; i += perVector) {
+            const __m128i v = _mm_loadu_si128((const __m128i *)(keys + i));
+            const int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(v, needle));
+            if (mask) {
+              for (size_t j = 0; j < perVector; ++j) {
+                if (((mask >> (j * sizeof(KEY))) & laneMask) == laneMask)
+                  return i + j;
+              }
+            }
+          }
+        }
+#endif
+        for (; i < n; ++i) {
+          if (keys[i] == key)
+            return i;
+        }
+        return n;
+      }
+
+    }  // namespace detail
+
     // Inlined definitions ////////////////////////////////////////////////////
 
-    template <typename KEY, typename VALUE>
-    inline VALUE &FlatMap<KEY, VALUE>::at(const KEY &key)
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::FlatMap(
+        const ALLOCATOR &allocator)
+        : values(allocator), keys(key_allocator_t(allocator))
+    {
+    }
+
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline VALUE &FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::at(const KEY &key)
     {
       auto itr = lookup(key);
       if (itr == values.end())
@@ -96,8 +230,12 @@ namespace rkcommon {
       return itr->second;
     }
 
-    template <typename KEY, typename VALUE>
-    inline const VALUE &FlatMap<KEY, VALUE>::at(const KEY &key) const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline const VALUE &FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::at(
+        const KEY &key) const
     {
       auto itr = lookup(key);
       if (itr == values.end())
@@ -105,20 +243,35 @@ namespace rkcommon {
       return itr->second;
     }
 
-    template <typename KEY, typename VALUE>
-    inline VALUE &FlatMap<KEY, VALUE>::operator[](const KEY &key)
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline VALUE &FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::operator[](
+        const KEY &key)
     {
-      auto itr = lookup(key);
-      if (itr == values.end()) {
-        values.push_back(std::make_pair(key, VALUE()));
-        return values.back().second;
-      } else {
+      const size_t index = findIndex(key, POLICY());
+      if (matches(index, key))
+        return values[index].second;
+
+      if (std::is_same<POLICY, SortedKeys>::value) {
+        auto itr =
+            values.insert(values.begin() + index, std::make_pair(key, VALUE()));
         return itr->second;
       }
+
+      if (std::is_same<POLICY, SplitKeys>::value)
+        keys.push_back(key);
+      values.push_back(std::make_pair(key, VALUE()));
+      return values.back().second;
     }
 
-    template <typename KEY, typename VALUE>
-    inline const VALUE &FlatMap<KEY, VALUE>::operator[](const KEY &key) const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline const VALUE &FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::operator[](
+        const KEY &key) const
     {
       auto itr = lookup(key);
       if (itr == values.end()) {
@@ -129,163 +282,283 @@ namespace rkcommon {
       }
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::item_t &FlatMap<KEY, VALUE>::at_index(
-        size_t index)
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::item_t &
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::at_index(size_t index)
     {
       return values.at(index);
     }
 
-    template <typename KEY, typename VALUE>
-    inline const typename FlatMap<KEY, VALUE>::item_t &
-    FlatMap<KEY, VALUE>::at_index(size_t index) const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline const typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::item_t &
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::at_index(size_t index) const
     {
       return values.at(index);
     }
 
-    template <typename KEY, typename VALUE>
-    inline size_t FlatMap<KEY, VALUE>::size() const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline size_t FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::size() const
     {
       return values.size();
     }
 
-    template <typename KEY, typename VALUE>
-    inline size_t FlatMap<KEY, VALUE>::empty() const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline size_t FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::empty() const
     {
       return values.empty();
     }
 
-    template <typename KEY, typename VALUE>
-    inline bool FlatMap<KEY, VALUE>::contains(const KEY &key) const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline bool FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::contains(
+        const KEY &key) const
     {
       return lookup(key) != values.cend();
     }
 
-    template <typename KEY, typename VALUE>
-    inline void FlatMap<KEY, VALUE>::erase(const KEY &key)
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline void FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::erase(const KEY &key)
     {
-      auto itr = std::stable_partition(
-          values.begin(), values.end(), [&](const item_t &i) {
-            return i.first != key;
-          });
+      const size_t index = findIndex(key, POLICY());
+      if (!matches(index, key))
+        return;
 
-      values.resize(std::distance(values.begin(), itr));
+      values.erase(values.begin() + index);
+      if (std::is_same<POLICY, SplitKeys>::value)
+        keys.erase(keys.begin() + index);
     }
 
-    template <typename KEY, typename VALUE>
-    inline void FlatMap<KEY, VALUE>::clear()
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline void FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::clear()
     {
       values.clear();
+      keys.clear();
     }
 
-    template <typename KEY, typename VALUE>
-    inline void FlatMap<KEY, VALUE>::reserve(size_t size)
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline void FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::reserve(size_t size)
     {
-      return values.reserve(size);
+      values.reserve(size);
+      if (std::is_same<POLICY, SplitKeys>::value)
+        keys.reserve(size);
     }
 
     // Iterators //
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::iterator_t FlatMap<KEY, VALUE>::begin()
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::iterator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::begin()
     {
       return values.begin();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::citerator_t
-    FlatMap<KEY, VALUE>::begin() const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::citerator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::begin() const
     {
       return cbegin();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::citerator_t
-    FlatMap<KEY, VALUE>::cbegin() const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::citerator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::cbegin() const
     {
       return values.cbegin();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::iterator_t FlatMap<KEY, VALUE>::end()
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::iterator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::end()
     {
       return values.end();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::citerator_t FlatMap<KEY, VALUE>::end()
-        const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::citerator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::end() const
     {
       return cend();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::citerator_t FlatMap<KEY, VALUE>::cend()
-        const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::citerator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::cend() const
     {
       return values.cend();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::riterator_t
-    FlatMap<KEY, VALUE>::rbegin()
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::riterator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::rbegin()
     {
       return values.rbegin();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::criterator_t
-    FlatMap<KEY, VALUE>::rbegin() const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::criterator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::rbegin() const
     {
       return crbegin();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::criterator_t
-    FlatMap<KEY, VALUE>::crbegin() const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::criterator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::crbegin() const
     {
       return values.crbegin();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::riterator_t FlatMap<KEY, VALUE>::rend()
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::riterator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::rend()
     {
       return values.rend();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::criterator_t
-    FlatMap<KEY, VALUE>::rend() const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::criterator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::rend() const
     {
       return crend();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::criterator_t
-    FlatMap<KEY, VALUE>::crend() const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::criterator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::crend() const
     {
       return values.crend();
     }
 
     // Helper functions //
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::iterator_t FlatMap<KEY, VALUE>::lookup(
-        const KEY &key)
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::iterator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::lookup(const KEY &key)
+    {
+      const size_t index = findIndex(key, POLICY());
+      return matches(index, key) ? values.begin() + index : values.end();
+    }
+
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline typename FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::citerator_t
+    FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::lookup(const KEY &key) const
     {
-      return std::find_if(values.begin(), values.end(), [&](item_t &item) {
-        return item.first == key;
-      });
+      const size_t index = findIndex(key, POLICY());
+      return matches(index, key) ? values.cbegin() + index : values.cend();
     }
 
-    template <typename KEY, typename VALUE>
-    inline typename FlatMap<KEY, VALUE>::citerator_t
-    FlatMap<KEY, VALUE>::lookup(const KEY &key) const
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline size_t FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::findIndex(
+        const KEY &key, InsertionOrder) const
     {
-      return std::find_if(
+      auto itr = std::find_if(
           values.cbegin(), values.cend(), [&](const item_t &item) {
             return item.first == key;
           });
+      return std::distance(values.cbegin(), itr);
+    }
+
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline size_t FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::findIndex(
+        const KEY &key, SortedKeys) const
+    {
+      auto itr = std::lower_bound(
+          values.cbegin(),
+          values.cend(),
+          key,
+          [](const item_t &item, const KEY &k) { return item.first < k; });
+      return std::distance(values.cbegin(), itr);
+    }
+
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline size_t FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::findIndex(
+        const KEY &key, SplitKeys) const
+    {
+      return detail::simdFindKey(keys.data(), keys.size(), key);
+    }
+
+    template <typename KEY,
+              typename VALUE,
+              typename POLICY,
+              typename ALLOCATOR>
+    inline bool FlatMap<KEY, VALUE, POLICY, ALLOCATOR>::matches(
+        size_t index, const KEY &key) const
+    {
+      return index < values.size() && values[index].first == key;
     }
 
   }  // namespace containers
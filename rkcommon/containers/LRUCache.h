@@ -0,0 +1,379 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../tracing/Tracing.h"
+#include "FlatHashMap.h"
+// std
+#include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rkcommon {
+  namespace containers {
+
+    struct LRUCacheStats
+    {
+      size_t hits{0};
+      // lookups which loaded the value, or waited for another thread to
+      size_t misses{0};
+      size_t evictions{0};
+      // the current contents
+      size_t entries{0};
+      size_t bytes{0};
+    };
+
+    /* A bounded, thread-safe key-value cache which evicts the least
+       recently used values once they exceed 'memoryBudget' bytes, as told
+       by 'sizeOf' (sizeof(V) by default).
+
+       The keys are split over independently locked shards by their hash,
+       each with an equal part of the budget and its own LRU order, so that
+       threads rarely contend. A shard always keeps its most recent value,
+       even if that alone exceeds its budget.
+
+       Values are handed out as shared pointers, so evicting one never
+       pulls it from under a reader; readers may briefly keep evicted
+       values alive beyond the budget. get_or_load() calls the loader
+       outside of the lock and at most once per key and miss: concurrent
+       misses of the same key wait for the first one's result (or
+       exception). A loader must not look up its own key. */
+    template <typename K, typename V, typename HASH = FlatHash<K>>
+    class LRUCache
+    {
+     public:
+      using value_t = std::shared_ptr<const V>;
+      using size_fcn_t = std::function<size_t(const V &)>;
+
+      explicit LRUCache(size_t memoryBudget,
+                        size_t numShards = 16,
+                        size_fcn_t sizeOf = defaultSizeOf);
+
+      LRUCache(const LRUCache &) = delete;
+      LRUCache &operator=(const LRUCache &) = delete;
+
+      /*! the value of 'key', or nullptr; a hit makes it the most recent */
+      value_t get(const K &key);
+
+      /*! the value of 'key', from 'loader(key)' (returning a V) on a miss */
+      template <typename LOADER_T>
+      value_t get_or_load(const K &key, LOADER_T &&loader);
+
+      /*! sets the value of 'key', replacing a resident one */
+      value_t insert(const K &key, V value);
+
+      bool contains(const K &key) const;
+
+      bool erase(const K &key);
+
+      void clear();
+
+      size_t size() const;
+      size_t memoryBytes() const;
+      size_t memoryBudget() const;
+      size_t numShards() const;
+
+      LRUCacheStats stats() const;
+
+      /*! zeros the hits, misses and evictions */
+      void resetStats();
+
+      /*! records stats() as the tracing counters "<name>.hits",
+          "<name>.misses", "<name>.evictions", "<name>.entries" and
+          "<name>.bytes"; a no-op unless RKCOMMON_ENABLE_PROFILING is
+          defined */
+      void traceStatistics(const char *name) const;
+
+     private:
+      static size_t defaultSizeOf(const V &)
+      {
+        return sizeof(V);
+      }
+
+      struct Entry
+      {
+        value_t value;
+        size_t bytes;
+        typename std::list<K>::iterator lru;
+      };
+
+      struct Shard
+      {
+        mutable std::mutex mutex;
+        FlatHashMap<K, Entry, HASH> resident;
+        // most recently used first
+        std::list<K> lru;
+        // loads in flight
+        FlatHashMap<K, std::shared_future<value_t>, HASH> pending;
+        size_t bytes{0};
+        size_t hits{0};
+        size_t misses{0};
+        size_t evictions{0};
+      };
+
+      Shard &shardOf(const K &key);
+      const Shard &shardOf(const K &key) const;
+
+      // all under the shard's lock
+      value_t hit(Shard &shard, Entry &entry);
+      value_t store(Shard &shard, const K &key, value_t value, bool replace);
+      void evict(Shard &shard, size_t incomingBytes);
+
+      size_t budget;
+      size_t shardBudget;
+      size_fcn_t sizeOf;
+      std::vector<std::unique_ptr<Shard>> shards;
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    template <typename K, typename V, typename HASH>
+    inline LRUCache<K, V, HASH>::LRUCache(size_t memoryBudget,
+                                          size_t numShards,
+                                          size_fcn_t sizeOf)
+        : budget(memoryBudget), sizeOf(std::move(sizeOf))
+    {
+      // a power of two, for the shard mask
+      size_t n = 1;
+      while (n < numShards)
+        n *= 2;
+      shards.resize(n);
+      for (auto &s : shards)
+        s.reset(new Shard);
+      shardBudget = budget / n;
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline typename LRUCache<K, V, HASH>::Shard &LRUCache<K, V, HASH>::shardOf(
+        const K &key)
+    {
+      // remixed, as the maps of the shards index by the low hash bits
+      const uint64_t h = detail::mixHashBits(uint64_t(HASH()(key)));
+      return *shards[size_t(h) & (shards.size() - 1)];
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline const typename LRUCache<K, V, HASH>::Shard &
+    LRUCache<K, V, HASH>::shardOf(const K &key) const
+    {
+      return const_cast<LRUCache *>(this)->shardOf(key);
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline typename LRUCache<K, V, HASH>::value_t LRUCache<K, V, HASH>::hit(
+        Shard &shard, Entry &entry)
+    {
+      shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru);
+      shard.hits++;
+      return entry.value;
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline void LRUCache<K, V, HASH>::evict(Shard &shard, size_t incomingBytes)
+    {
+      while (!shard.lru.empty() && shard.bytes + incomingBytes > shardBudget) {
+        auto it = shard.resident.find(shard.lru.back());
+        shard.bytes -= it->second.bytes;
+        shard.resident.erase(shard.lru.back());
+        shard.lru.pop_back();
+        shard.evictions++;
+      }
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline typename LRUCache<K, V, HASH>::value_t LRUCache<K, V, HASH>::store(
+        Shard &shard, const K &key, value_t value, bool replace)
+    {
+      auto it = shard.resident.find(key);
+      if (it != shard.resident.end()) {
+        if (!replace)
+          return it->second.value;
+        shard.bytes -= it->second.bytes;
+        shard.lru.erase(it->second.lru);
+        shard.resident.erase(key);
+      }
+
+      const size_t bytes = sizeOf(*value);
+      evict(shard, bytes);
+      shard.lru.push_front(key);
+      shard.resident.insert({key, Entry{value, bytes, shard.lru.begin()}});
+      shard.bytes += bytes;
+      return value;
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline typename LRUCache<K, V, HASH>::value_t LRUCache<K, V, HASH>::get(
+        const K &key)
+    {
+      Shard &shard = shardOf(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto it = shard.resident.find(key);
+      if (it == shard.resident.end()) {
+        shard.misses++;
+        return nullptr;
+      }
+      return hit(shard, it->second);
+    }
+
+    template <typename K, typename V, typename HASH>
+    template <typename LOADER_T>
+    inline typename LRUCache<K, V, HASH>::value_t
+    LRUCache<K, V, HASH>::get_or_load(const K &key, LOADER_T &&loader)
+    {
+      Shard &shard = shardOf(key);
+      std::promise<value_t> promise;
+      {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        auto it = shard.resident.find(key);
+        if (it != shard.resident.end())
+          return hit(shard, it->second);
+
+        shard.misses++;
+        auto p = shard.pending.find(key);
+        if (p != shard.pending.end()) {
+          std::shared_future<value_t> loading = p->second;
+          lock.unlock();
+          return loading.get();
+        }
+        shard.pending.insert({key, promise.get_future().share()});
+      }
+
+      value_t value;
+      try {
+        value = std::make_shared<const V>(loader(key));
+      } catch (...) {
+        {
+          std::lock_guard<std::mutex> lock(shard.mutex);
+          shard.pending.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.pending.erase(key);
+        // an insert() during the load wins
+        value = store(shard, key, std::move(value), false);
+      }
+      promise.set_value(value);
+      return value;
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline typename LRUCache<K, V, HASH>::value_t LRUCache<K, V, HASH>::insert(
+        const K &key, V value)
+    {
+      value_t v = std::make_shared<const V>(std::move(value));
+      Shard &shard = shardOf(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      return store(shard, key, std::move(v), true);
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline bool LRUCache<K, V, HASH>::contains(const K &key) const
+    {
+      const Shard &shard = shardOf(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      return shard.resident.contains(key);
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline bool LRUCache<K, V, HASH>::erase(const K &key)
+    {
+      Shard &shard = shardOf(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto it = shard.resident.find(key);
+      if (it == shard.resident.end())
+        return false;
+      shard.bytes -= it->second.bytes;
+      shard.lru.erase(it->second.lru);
+      shard.resident.erase(key);
+      return true;
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline void LRUCache<K, V, HASH>::clear()
+    {
+      for (auto &s : shards) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->resident.clear();
+        s->lru.clear();
+        s->bytes = 0;
+      }
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline size_t LRUCache<K, V, HASH>::size() const
+    {
+      return stats().entries;
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline size_t LRUCache<K, V, HASH>::memoryBytes() const
+    {
+      return stats().bytes;
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline size_t LRUCache<K, V, HASH>::memoryBudget() const
+    {
+      return budget;
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline size_t LRUCache<K, V, HASH>::numShards() const
+    {
+      return shards.size();
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline LRUCacheStats LRUCache<K, V, HASH>::stats() const
+    {
+      LRUCacheStats s;
+      for (const auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        s.hits += shard->hits;
+        s.misses += shard->misses;
+        s.evictions += shard->evictions;
+        s.entries += shard->resident.size();
+        s.bytes += shard->bytes;
+      }
+      return s;
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline void LRUCache<K, V, HASH>::resetStats()
+    {
+      for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->hits      = 0;
+        shard->misses    = 0;
+        shard->evictions = 0;
+      }
+    }
+
+    template <typename K, typename V, typename HASH>
+    inline void LRUCache<K, V, HASH>::traceStatistics(const char *name) const
+    {
+#ifdef RKCOMMON_ENABLE_PROFILING
+      const LRUCacheStats s    = stats();
+      const std::string prefix = std::string(name) + ".";
+      tracing::setCounter((prefix + "hits").c_str(), s.hits);
+      tracing::setCounter((prefix + "misses").c_str(), s.misses);
+      tracing::setCounter((prefix + "evictions").c_str(), s.evictions);
+      tracing::setCounter((prefix + "entries").c_str(), s.entries);
+      tracing::setCounter((prefix + "bytes").c_str(), s.bytes);
+#else
+      (void)name;
+#endif
+    }
+
+  }  // namespace containers
+}  // namespace rkcommon
@@ -0,0 +1,394 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "../tasking/schedule.h"
+#include "../tasking/tasking_system_init.h"
+
+namespace rkcommon {
+  namespace containers {
+
+    // Concurrency policies of RingBuffer //
+
+    // one producer thread and one consumer thread
+    struct SPSC
+    {
+    };
+
+    // any number of producer and consumer threads
+    struct MPMC
+    {
+    };
+
+    /* A bounded lock-free FIFO queue, for pipelines which should apply
+       backpressure instead of growing without limit. The capacity is rounded
+       up to a power of two. The try_*() functions never block; push() and
+       pop() wait for space or items, backing off according to a
+       tasking::WaitPolicy (spin, then yield, then sleep) and running the
+       tasks pinned to the waiting thread meanwhile (see schedule_on_thread()).
+
+       The SPSC policy is a classic ring with cache-line padded head and tail
+       indices. MPMC uses a sequence number per slot (D. Vyukov's bounded
+       queue), which lets producers and consumers claim slots with one CAS. */
+    template <typename T, typename POLICY = MPMC>
+    class RingBuffer
+    {
+     public:
+      explicit RingBuffer(size_t capacity,
+                          const tasking::WaitPolicy &waitPolicy = {});
+      ~RingBuffer();
+
+      RingBuffer(const RingBuffer &) = delete;
+      RingBuffer &operator=(const RingBuffer &) = delete;
+
+      // Non-blocking, false if the queue is full or empty respectively //
+
+      bool try_push(const T &value);
+      bool try_push(T &&value);
+
+      bool try_pop(T &value);
+
+      // Push up to 'n' items copied from 'items', returns how many fit
+      size_t try_push_n(const T *items, size_t n);
+
+      // Pop up to 'n' items into 'items', returns how many were available
+      size_t try_pop_n(T *items, size_t n);
+
+      // Blocking, wait until there is space or an item //
+
+      void push(const T &value);
+      void push(T &&value);
+
+      T pop();
+
+      // Properties //
+
+      size_t capacity() const;
+
+      // Approximate while other threads push or pop
+      size_t size() const;
+      bool empty() const;
+
+     private:
+      static constexpr size_t CACHE_LINE = 64;
+
+      using storage_t =
+          typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+      struct Slot
+      {
+        std::atomic<size_t> sequence;  // MPMC only
+        storage_t storage;
+
+        T *value()
+        {
+          return reinterpret_cast<T *>(&storage);
+        }
+      };
+
+      static size_t roundUpToPowerOf2(size_t n);
+
+      // Claim up to 'n' consecutive slots for writing (or reading), returns
+      // the first position and sets 'n' to the number claimed
+      bool claimPush(size_t &pos, size_t &n);
+      bool claimPop(size_t &pos, size_t &n);
+      void publishPush(size_t pos, size_t n);
+      void publishPop(size_t pos, size_t n);
+
+      template <typename V>
+      bool tryPushOne(V &&value);
+
+      template <typename PREDICATE>
+      void waitUntil(PREDICATE &&done);
+
+      // Data members //
+
+      const size_t mask;
+      std::unique_ptr<Slot[]> slots;
+      tasking::WaitPolicy waitPolicy;
+
+      // next position to push (tail) and to pop (head); the cached copies
+      // of the other side's index save SPSC cache line transfers
+      alignas(CACHE_LINE) std::atomic<size_t> tail{0};
+      size_t cachedHead{0};
+      alignas(CACHE_LINE) std::atomic<size_t> head{0};
+      size_t cachedTail{0};
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    template <typename T, typename POLICY>
+    inline size_t RingBuffer<T, POLICY>::roundUpToPowerOf2(size_t n)
+    {
+      size_t result = 1;
+      while (result < n)
+        result <<= 1;
+      return result;
+    }
+
+    template <typename T, typename POLICY>
+    inline RingBuffer<T, POLICY>::RingBuffer(
+        size_t capacity, const tasking::WaitPolicy &_waitPolicy)
+        : mask(roundUpToPowerOf2(capacity < 2 ? 2 : capacity) - 1),
+          slots(new Slot[mask + 1]),
+          waitPolicy(_waitPolicy)
+    {
+      for (size_t i = 0; i <= mask; ++i)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    template <typename T, typename POLICY>
+    inline RingBuffer<T, POLICY>::~RingBuffer()
+    {
+      const size_t end = tail.load();
+      for (size_t pos = head.load(); pos != end; ++pos)
+        slots[pos & mask].value()->~T();
+    }
+
+    template <typename T, typename POLICY>
+    inline bool RingBuffer<T, POLICY>::claimPush(size_t &pos, size_t &n)
+    {
+      const size_t capacity = mask + 1;
+
+      if (std::is_same<POLICY, SPSC>::value) {
+        pos = tail.load(std::memory_order_relaxed);
+        if (pos + n - cachedHead > capacity) {
+          cachedHead = head.load(std::memory_order_acquire);
+          n          = std::min(n, capacity - (pos - cachedHead));
+        }
+        return n > 0;
+      }
+
+      pos = tail.load(std::memory_order_relaxed);
+      for (;;) {
+        // count the free slots starting at 'pos'
+        size_t available = 0;
+        for (; available < n; ++available) {
+          const size_t seq = slots[(pos + available) & mask].sequence.load(
+              std::memory_order_acquire);
+          if (seq != pos + available)
+            break;
+        }
+
+        if (available == 0) {
+          const size_t seq =
+              slots[pos & mask].sequence.load(std::memory_order_acquire);
+          // the slot still holds an item from the previous lap: full
+          if (intptr_t(seq) - intptr_t(pos) < 0)
+            return false;
+          pos = tail.load(std::memory_order_relaxed);
+          continue;
+        }
+
+        if (tail.compare_exchange_weak(
+                pos, pos + available, std::memory_order_relaxed)) {
+          n = available;
+          return true;
+        }
+      }
+    }
+
+    template <typename T, typename POLICY>
+    inline bool RingBuffer<T, POLICY>::claimPop(size_t &pos, size_t &n)
+    {
+      if (std::is_same<POLICY, SPSC>::value) {
+        pos = head.load(std::memory_order_relaxed);
+        if (cachedTail - pos < n) {
+          cachedTail = tail.load(std::memory_order_acquire);
+          n          = std::min(n, cachedTail - pos);
+        }
+        return n > 0;
+      }
+
+      pos = head.load(std::memory_order_relaxed);
+      for (;;) {
+        size_t available = 0;
+        for (; available < n; ++available) {
+          const size_t seq = slots[(pos + available) & mask].sequence.load(
+              std::memory_order_acquire);
+          if (seq != pos + available + 1)
+            break;
+        }
+
+        if (available == 0) {
+          const size_t seq =
+              slots[pos & mask].sequence.load(std::memory_order_acquire);
+          // the slot has not been written in this lap yet: empty
+          if (intptr_t(seq) - intptr_t(pos + 1) < 0)
+            return false;
+          pos = head.load(std::memory_order_relaxed);
+          continue;
+        }
+
+        if (head.compare_exchange_weak(
+                pos, pos + available, std::memory_order_relaxed)) {
+          n = available;
+          return true;
+        }
+      }
+    }
+
+    template <typename T, typename POLICY>
+    inline void RingBuffer<T, POLICY>::publishPush(size_t pos, size_t n)
+    {
+      if (std::is_same<POLICY, SPSC>::value) {
+        tail.store(pos + n, std::memory_order_release);
+      } else {
+        for (size_t i = 0; i < n; ++i) {
+          slots[(pos + i) & mask].sequence.store(pos + i + 1,
+                                                 std::memory_order_release);
+        }
+      }
+    }
+
+    template <typename T, typename POLICY>
+    inline void RingBuffer<T, POLICY>::publishPop(size_t pos, size_t n)
+    {
+      if (std::is_same<POLICY, SPSC>::value) {
+        head.store(pos + n, std::memory_order_release);
+      } else {
+        for (size_t i = 0; i < n; ++i) {
+          slots[(pos + i) & mask].sequence.store(pos + i + mask + 1,
+                                                 std::memory_order_release);
+        }
+      }
+    }
+
+    template <typename T, typename POLICY>
+    template <typename V>
+    inline bool RingBuffer<T, POLICY>::tryPushOne(V &&value)
+    {
+      size_t pos = 0, n = 1;
+      if (!claimPush(pos, n))
+        return false;
+      new (slots[pos & mask].value()) T(std::forward<V>(value));
+      publishPush(pos, 1);
+      return true;
+    }
+
+    template <typename T, typename POLICY>
+    inline bool RingBuffer<T, POLICY>::try_push(const T &value)
+    {
+      return tryPushOne(value);
+    }
+
+    template <typename T, typename POLICY>
+    inline bool RingBuffer<T, POLICY>::try_push(T &&value)
+    {
+      return tryPushOne(std::move(value));
+    }
+
+    template <typename T, typename POLICY>
+    inline bool RingBuffer<T, POLICY>::try_pop(T &value)
+    {
+      return try_pop_n(&value, 1) == 1;
+    }
+
+    template <typename T, typename POLICY>
+    inline size_t RingBuffer<T, POLICY>::try_push_n(const T *items, size_t n)
+    {
+      size_t pos = 0;
+      if (n == 0 || !claimPush(pos, n))
+        return 0;
+      for (size_t i = 0; i < n; ++i)
+        new (slots[(pos + i) & mask].value()) T(items[i]);
+      publishPush(pos, n);
+      return n;
+    }
+
+    template <typename T, typename POLICY>
+    inline size_t RingBuffer<T, POLICY>::try_pop_n(T *items, size_t n)
+    {
+      size_t pos = 0;
+      if (n == 0 || !claimPop(pos, n))
+        return 0;
+      for (size_t i = 0; i < n; ++i) {
+        T *v     = slots[(pos + i) & mask].value();
+        items[i] = std::move(*v);
+        v->~T();
+      }
+      publishPop(pos, n);
+      return n;
+    }
+
+    template <typename T, typename POLICY>
+    template <typename PREDICATE>
+    inline void RingBuffer<T, POLICY>::waitUntil(PREDICATE &&done)
+    {
+      for (uint32_t i = 0; i < waitPolicy.spinIterations; ++i) {
+        if (done())
+          return;
+      }
+
+      for (uint32_t i = 0; !done(); ++i) {
+        tasking::runPinnedTasks();
+        if (waitPolicy.alwaysHot || i < waitPolicy.yieldIterations)
+          std::this_thread::yield();
+        else
+          std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+
+    template <typename T, typename POLICY>
+    inline void RingBuffer<T, POLICY>::push(const T &value)
+    {
+      waitUntil([&]() { return tryPushOne(value); });
+    }
+
+    template <typename T, typename POLICY>
+    inline void RingBuffer<T, POLICY>::push(T &&value)
+    {
+      // only moved from once a slot was claimed
+      waitUntil([&]() { return tryPushOne(std::move(value)); });
+    }
+
+    template <typename T, typename POLICY>
+    inline T RingBuffer<T, POLICY>::pop()
+    {
+      size_t pos = 0;
+      waitUntil([&]() {
+        size_t n = 1;
+        return claimPop(pos, n);
+      });
+
+      T *v = slots[pos & mask].value();
+      T result(std::move(*v));
+      v->~T();
+      publishPop(pos, 1);
+      return result;
+    }
+
+    template <typename T, typename POLICY>
+    inline size_t RingBuffer<T, POLICY>::capacity() const
+    {
+      return mask + 1;
+    }
+
+    template <typename T, typename POLICY>
+    inline size_t RingBuffer<T, POLICY>::size() const
+    {
+      const size_t h = head.load(std::memory_order_acquire);
+      const size_t t = tail.load(std::memory_order_acquire);
+      return t > h ? std::min(t - h, mask + 1) : 0;
+    }
+
+    template <typename T, typename POLICY>
+    inline bool RingBuffer<T, POLICY>::empty() const
+    {
+      return size() == 0;
+    }
+
+  }  // namespace containers
+}  // namespace rkcommon
@@ -0,0 +1,454 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "../memory/malloc.h"
+
+namespace rkcommon {
+  namespace containers {
+
+    /* A std::vector<>-like container which keeps up to N elements inline,
+       e.g. on the stack for temporaries, and only spills to alignedMalloc()
+       when it grows beyond that. Moving a SmallVector which is still inline
+       moves the elements one by one, and like std::vector<> iterators are
+       invalidated by growing. */
+    template <typename T, size_t N>
+    class SmallVector
+    {
+     public:
+      using value_type      = T;
+      using size_type       = size_t;
+      using reference       = T &;
+      using const_reference = const T &;
+      using iterator        = T *;
+      using const_iterator  = const T *;
+
+      SmallVector() = default;
+      SmallVector(size_t count, const T &value);
+      SmallVector(std::initializer_list<T> init);
+
+      template <typename INPUT_IT,
+                typename = typename std::enable_if<!std::is_integral<
+                    INPUT_IT>::value>::type>
+      SmallVector(INPUT_IT first, INPUT_IT last);
+
+      SmallVector(const SmallVector &other);
+      SmallVector(SmallVector &&other);
+      ~SmallVector();
+
+      SmallVector &operator=(const SmallVector &other);
+      SmallVector &operator=(SmallVector &&other);
+
+      // Element access //
+
+      T &operator[](size_t i);
+      const T &operator[](size_t i) const;
+
+      T &at(size_t i);
+      const T &at(size_t i) const;
+
+      T &front();
+      const T &front() const;
+      T &back();
+      const T &back() const;
+
+      T *data();
+      const T *data() const;
+
+      // Properties //
+
+      size_t size() const;
+      size_t capacity() const;
+      bool empty() const;
+
+      // true while the elements are stored inline
+      bool isSmall() const;
+
+      // Mutation //
+
+      void push_back(const T &value);
+      void push_back(T &&value);
+
+      template <typename... Args>
+      T &emplace_back(Args &&... args);
+
+      void pop_back();
+
+      iterator erase(const_iterator pos);
+
+      void clear();
+      void reserve(size_t newCapacity);
+      void resize(size_t newSize);
+      void resize(size_t newSize, const T &value);
+
+      // Iterators //
+
+      iterator begin();
+      const_iterator begin() const;
+      const_iterator cbegin() const;
+
+      iterator end();
+      const_iterator end() const;
+      const_iterator cend() const;
+
+     private:
+      using storage_t =
+          typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+      T *inlineData();
+      void grow(size_t minCapacity);
+
+      // Data members //
+
+      T *begin_{inlineData()};
+      size_t size_{0};
+      size_t capacity_{N};
+      storage_t inlineStorage[N > 0 ? N : 1];
+    };
+
+    template <typename T, size_t N>
+    bool operator==(const SmallVector<T, N> &a, const SmallVector<T, N> &b);
+
+    template <typename T, size_t N>
+    bool operator!=(const SmallVector<T, N> &a, const SmallVector<T, N> &b);
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    template <typename T, size_t N>
+    inline SmallVector<T, N>::SmallVector(size_t count, const T &value)
+    {
+      resize(count, value);
+    }
+
+    template <typename T, size_t N>
+    inline SmallVector<T, N>::SmallVector(std::initializer_list<T> init)
+        : SmallVector(init.begin(), init.end())
+    {
+    }
+
+    template <typename T, size_t N>
+    template <typename INPUT_IT, typename>
+    inline SmallVector<T, N>::SmallVector(INPUT_IT first, INPUT_IT last)
+    {
+      for (; first != last; ++first)
+        emplace_back(*first);
+    }
+
+    template <typename T, size_t N>
+    inline SmallVector<T, N>::SmallVector(const SmallVector &other)
+    {
+      reserve(other.size());
+      for (const auto &v : other)
+        new (begin_ + size_++) T(v);
+    }
+
+    template <typename T, size_t N>
+    inline SmallVector<T, N>::SmallVector(SmallVector &&other)
+    {
+      *this = std::move(other);
+    }
+
+    template <typename T, size_t N>
+    inline SmallVector<T, N>::~SmallVector()
+    {
+      clear();
+      if (!isSmall())
+        memory::alignedFree(begin_);
+    }
+
+    template <typename T, size_t N>
+    inline SmallVector<T, N> &SmallVector<T, N>::operator=(
+        const SmallVector &other)
+    {
+      if (this != &other) {
+        clear();
+        reserve(other.size());
+        for (const auto &v : other)
+          new (begin_ + size_++) T(v);
+      }
+      return *this;
+    }
+
+    template <typename T, size_t N>
+    inline SmallVector<T, N> &SmallVector<T, N>::operator=(SmallVector &&other)
+    {
+      if (this == &other)
+        return *this;
+
+      clear();
+
+      if (!other.isSmall()) {
+        // take over the heap storage
+        if (!isSmall())
+          memory::alignedFree(begin_);
+        begin_          = other.begin_;
+        size_           = other.size_;
+        capacity_       = other.capacity_;
+        other.begin_    = other.inlineData();
+        other.size_     = 0;
+        other.capacity_ = N;
+      } else {
+        reserve(other.size());
+        for (auto &v : other)
+          new (begin_ + size_++) T(std::move(v));
+        other.clear();
+      }
+      return *this;
+    }
+
+    template <typename T, size_t N>
+    inline T &SmallVector<T, N>::operator[](size_t i)
+    {
+      return begin_[i];
+    }
+
+    template <typename T, size_t N>
+    inline const T &SmallVector<T, N>::operator[](size_t i) const
+    {
+      return begin_[i];
+    }
+
+    template <typename T, size_t N>
+    inline T &SmallVector<T, N>::at(size_t i)
+    {
+      if (i >= size_)
+        throw std::out_of_range("SmallVector<> index out of range");
+      return begin_[i];
+    }
+
+    template <typename T, size_t N>
+    inline const T &SmallVector<T, N>::at(size_t i) const
+    {
+      if (i >= size_)
+        throw std::out_of_range("SmallVector<> index out of range");
+      return begin_[i];
+    }
+
+    template <typename T, size_t N>
+    inline T &SmallVector<T, N>::front()
+    {
+      return begin_[0];
+    }
+
+    template <typename T, size_t N>
+    inline const T &SmallVector<T, N>::front() const
+    {
+      return begin_[0];
+    }
+
+    template <typename T, size_t N>
+    inline T &SmallVector<T, N>::back()
+    {
+      return begin_[size_ - 1];
+    }
+
+    template <typename T, size_t N>
+    inline const T &SmallVector<T, N>::back() const
+    {
+      return begin_[size_ - 1];
+    }
+
+    template <typename T, size_t N>
+    inline T *SmallVector<T, N>::data()
+    {
+      return begin_;
+    }
+
+    template <typename T, size_t N>
+    inline const T *SmallVector<T, N>::data() const
+    {
+      return begin_;
+    }
+
+    template <typename T, size_t N>
+    inline size_t SmallVector<T, N>::size() const
+    {
+      return size_;
+    }
+
+    template <typename T, size_t N>
+    inline size_t SmallVector<T, N>::capacity() const
+    {
+      return capacity_;
+    }
+
+    template <typename T, size_t N>
+    inline bool SmallVector<T, N>::empty() const
+    {
+      return size_ == 0;
+    }
+
+    template <typename T, size_t N>
+    inline bool SmallVector<T, N>::isSmall() const
+    {
+      return begin_ == reinterpret_cast<const T *>(inlineStorage);
+    }
+
+    template <typename T, size_t N>
+    inline void SmallVector<T, N>::push_back(const T &value)
+    {
+      emplace_back(value);
+    }
+
+    template <typename T, size_t N>
+    inline void SmallVector<T, N>::push_back(T &&value)
+    {
+      emplace_back(std::move(value));
+    }
+
+    template <typename T, size_t N>
+    template <typename... Args>
+    inline T &SmallVector<T, N>::emplace_back(Args &&... args)
+    {
+      if (size_ == capacity_) {
+        // 'args' may refer into this vector, construct before moving
+        T value(std::forward<Args>(args)...);
+        grow(size_ + 1);
+        new (begin_ + size_) T(std::move(value));
+      } else {
+        new (begin_ + size_) T(std::forward<Args>(args)...);
+      }
+      return begin_[size_++];
+    }
+
+    template <typename T, size_t N>
+    inline void SmallVector<T, N>::pop_back()
+    {
+      begin_[--size_].~T();
+    }
+
+    template <typename T, size_t N>
+    inline typename SmallVector<T, N>::iterator SmallVector<T, N>::erase(
+        const_iterator pos)
+    {
+      iterator itr = begin_ + (pos - begin_);
+      std::move(itr + 1, end(), itr);
+      pop_back();
+      return itr;
+    }
+
+    template <typename T, size_t N>
+    inline void SmallVector<T, N>::clear()
+    {
+      for (size_t i = 0; i < size_; ++i)
+        begin_[i].~T();
+      size_ = 0;
+    }
+
+    template <typename T, size_t N>
+    inline void SmallVector<T, N>::reserve(size_t newCapacity)
+    {
+      if (newCapacity > capacity_)
+        grow(newCapacity);
+    }
+
+    template <typename T, size_t N>
+    inline void SmallVector<T, N>::resize(size_t newSize)
+    {
+      reserve(newSize);
+      while (size_ > newSize)
+        pop_back();
+      while (size_ < newSize)
+        new (begin_ + size_++) T();
+    }
+
+    template <typename T, size_t N>
+    inline void SmallVector<T, N>::resize(size_t newSize, const T &value)
+    {
+      reserve(newSize);
+      while (size_ > newSize)
+        pop_back();
+      while (size_ < newSize)
+        new (begin_ + size_++) T(value);
+    }
+
+    template <typename T, size_t N>
+    inline typename SmallVector<T, N>::iterator SmallVector<T, N>::begin()
+    {
+      return begin_;
+    }
+
+    template <typename T, size_t N>
+    inline typename SmallVector<T, N>::const_iterator
+    SmallVector<T, N>::begin() const
+    {
+      return begin_;
+    }
+
+    template <typename T, size_t N>
+    inline typename SmallVector<T, N>::const_iterator
+    SmallVector<T, N>::cbegin() const
+    {
+      return begin_;
+    }
+
+    template <typename T, size_t N>
+    inline typename SmallVector<T, N>::iterator SmallVector<T, N>::end()
+    {
+      return begin_ + size_;
+    }
+
+    template <typename T, size_t N>
+    inline typename SmallVector<T, N>::const_iterator SmallVector<T, N>::end()
+        const
+    {
+      return begin_ + size_;
+    }
+
+    template <typename T, size_t N>
+    inline typename SmallVector<T, N>::const_iterator
+    SmallVector<T, N>::cend() const
+    {
+      return begin_ + size_;
+    }
+
+    template <typename T, size_t N>
+    inline T *SmallVector<T, N>::inlineData()
+    {
+      return reinterpret_cast<T *>(inlineStorage);
+    }
+
+    template <typename T, size_t N>
+    inline void SmallVector<T, N>::grow(size_t minCapacity)
+    {
+      const size_t newCapacity = std::max(minCapacity, 2 * capacity_);
+      T *newData               = memory::alignedMalloc<T>(
+          newCapacity, std::max<size_t>(alignof(T), 16));
+
+      for (size_t i = 0; i < size_; ++i) {
+        new (newData + i) T(std::move(begin_[i]));
+        begin_[i].~T();
+      }
+
+      if (!isSmall())
+        memory::alignedFree(begin_);
+
+      begin_    = newData;
+      capacity_ = newCapacity;
+    }
+
+    template <typename T, size_t N>
+    inline bool operator==(const SmallVector<T, N> &a,
+                           const SmallVector<T, N> &b)
+    {
+      return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+
+    template <typename T, size_t N>
+    inline bool operator!=(const SmallVector<T, N> &a,
+                           const SmallVector<T, N> &b)
+    {
+      return !(a == b);
+    }
+
+  }  // namespace containers
+}  // namespace rkcommon
@@ -0,0 +1,616 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../math/vec.h"
+#include "../utility/ArrayView.h"
+#include "../utility/DataView.h"
+#include "AlignedVector.h"
+
+#ifndef RKCOMMON_NO_SIMD
+#ifdef _WIN32
+#include <intrin.h>
+#elif defined(__ARM_NEON)
+#include "../math/arm/emulation.h"
+#else
+#include <emmintrin.h>
+#endif
+#endif
+
+namespace rkcommon {
+  namespace containers {
+
+    template <typename VEC_T>
+    class SoAVector;
+
+    namespace detail {
+
+      // Proxy references to one element of a SoAVector, exposing the
+      // components as members like vec_t<> does //
+
+      template <typename S, int N>
+      struct SoAComponents;
+
+      template <typename S>
+      struct SoAComponents<S, 2>
+      {
+        SoAComponents(S *const *streams, size_t i)
+            : x(streams[0][i]), y(streams[1][i])
+        {
+        }
+
+        template <typename VEC_T>
+        VEC_T load() const
+        {
+          VEC_T v;
+          v.x = x;
+          v.y = y;
+          return v;
+        }
+
+        template <typename VEC_T>
+        void store(const VEC_T &v) const
+        {
+          x = v.x;
+          y = v.y;
+        }
+
+        S &x, &y;
+      };
+
+      template <typename S>
+      struct SoAComponents<S, 3>
+      {
+        SoAComponents(S *const *streams, size_t i)
+            : x(streams[0][i]), y(streams[1][i]), z(streams[2][i])
+        {
+        }
+
+        template <typename VEC_T>
+        VEC_T load() const
+        {
+          VEC_T v;
+          v.x = x;
+          v.y = y;
+          v.z = z;
+          return v;
+        }
+
+        template <typename VEC_T>
+        void store(const VEC_T &v) const
+        {
+          x = v.x;
+          y = v.y;
+          z = v.z;
+        }
+
+        S &x, &y, &z;
+      };
+
+      template <typename S>
+      struct SoAComponents<S, 4>
+      {
+        SoAComponents(S *const *streams, size_t i)
+            : x(streams[0][i]),
+              y(streams[1][i]),
+              z(streams[2][i]),
+              w(streams[3][i])
+        {
+        }
+
+        template <typename VEC_T>
+        VEC_T load() const
+        {
+          VEC_T v;
+          v.x = x;
+          v.y = y;
+          v.z = z;
+          v.w = w;
+          return v;
+        }
+
+        template <typename VEC_T>
+        void store(const VEC_T &v) const
+        {
+          x = v.x;
+          y = v.y;
+          z = v.z;
+          w = v.w;
+        }
+
+        S &x, &y, &z, &w;
+      };
+
+      template <typename VEC_T, typename S, int N>
+      struct SoAReference : public SoAComponents<S, N>
+      {
+        using SoAComponents<S, N>::SoAComponents;
+
+        operator VEC_T() const
+        {
+          return this->template load<VEC_T>();
+        }
+
+        const SoAReference &operator=(const VEC_T &v) const
+        {
+          this->store(v);
+          return *this;
+        }
+
+        // assign values, not the references themselves
+        const SoAReference &operator=(const SoAReference &other) const
+        {
+          this->store(VEC_T(other));
+          return *this;
+        }
+
+        template <typename OS>
+        const SoAReference &operator=(
+            const SoAReference<VEC_T, OS, N> &other) const
+        {
+          this->store(VEC_T(other));
+          return *this;
+        }
+      };
+
+      template <typename VEC_T>
+      struct soa_traits;
+
+      template <typename T, int N, bool ALIGN>
+      struct soa_traits<math::vec_t<T, N, ALIGN>>
+      {
+        using scalar_t = T;
+        // vec3fa's padding is not stored
+        static constexpr int NUM_COMPONENTS = N;
+        // floats per AoS element if it can be transposed with SSE (four
+        // floats, i.e. one __m128, or three packed ones), else 0
+        static constexpr int SIMD_WIDTH =
+            std::is_same<T, float>::value
+                ? (sizeof(math::vec_t<T, N, ALIGN>) == 16
+                       ? 4
+                       : (sizeof(math::vec_t<T, N, ALIGN>) == 12 ? 3 : 0))
+                : 0;
+      };
+
+    }  // namespace detail
+
+    /* A std::vector<>-like container of vec_t<> elements, which stores each
+       component in its own aligned stream (structure of arrays) so that
+       kernels can load 4 or 8 x's, y's, ... at once instead of transposing
+       every vector first. Elements are accessed through proxy references
+       with x/y/z/w members which convert to and assign from VEC_T.
+
+       gather() and scatter() convert from and to an array of structures,
+       using SSE (or NEON through sse2neon) for float vectors. */
+    template <typename VEC_T>
+    class SoAVector
+    {
+     public:
+      using traits_t = detail::soa_traits<VEC_T>;
+      using scalar_t = typename traits_t::scalar_t;
+      using value_type = VEC_T;
+      using size_type  = size_t;
+
+      static constexpr int NUM_COMPONENTS = traits_t::NUM_COMPONENTS;
+
+      using reference =
+          detail::SoAReference<VEC_T, scalar_t, NUM_COMPONENTS>;
+      using const_reference =
+          detail::SoAReference<VEC_T, const scalar_t, NUM_COMPONENTS>;
+
+      SoAVector() = default;
+      explicit SoAVector(size_t count);
+      SoAVector(size_t count, const VEC_T &value);
+
+      // Element access //
+
+      reference operator[](size_t i);
+      const_reference operator[](size_t i) const;
+
+      reference at(size_t i);
+      const_reference at(size_t i) const;
+
+      // Component streams, each 'size()' elements long //
+
+      scalar_t *data(int component);
+      const scalar_t *data(int component) const;
+
+      utility::ArrayView<scalar_t> component(int component);
+      utility::DataView<scalar_t> componentView(int component) const;
+
+      // Properties //
+
+      size_t size() const;
+      bool empty() const;
+
+      // Mutation //
+
+      void push_back(const VEC_T &value);
+      void pop_back();
+
+      void clear();
+      void reserve(size_t newCapacity);
+      void resize(size_t newSize);
+      void resize(size_t newSize, const VEC_T &value);
+
+      // Conversion from/to an array of structures //
+
+      // Replace the contents by 'count' elements read from 'aos'
+      void gather(const VEC_T *aos, size_t count);
+      void gather(const AlignedVector<VEC_T> &aos);
+      // Strided input, e.g. positions interleaved with other attributes
+      void gather(const utility::DataView<VEC_T> &aos, size_t count);
+
+      // Write all elements to 'aos', which must hold 'size()' elements
+      void scatter(VEC_T *aos) const;
+      void scatter(AlignedVector<VEC_T> &aos) const;
+
+     private:
+      template <typename S>
+      void streamPointers(S **streams) const;
+
+      using simd_width_t = std::integral_constant<int, traits_t::SIMD_WIDTH>;
+
+      // no SIMD conversion for this element type
+      template <int W>
+      void gatherSIMD(const VEC_T *,
+                      size_t,
+                      size_t &,
+                      std::integral_constant<int, W>)
+      {
+      }
+      template <int W>
+      void scatterSIMD(VEC_T *, size_t &, std::integral_constant<int, W>) const
+      {
+      }
+
+#ifndef RKCOMMON_NO_SIMD
+      void gatherSIMD(const VEC_T *aos,
+                      size_t count,
+                      size_t &i,
+                      std::integral_constant<int, 4>);
+      void gatherSIMD(const VEC_T *aos,
+                      size_t count,
+                      size_t &i,
+                      std::integral_constant<int, 3>);
+
+      void scatterSIMD(VEC_T *aos,
+                       size_t &i,
+                       std::integral_constant<int, 4>) const;
+      void scatterSIMD(VEC_T *aos,
+                       size_t &i,
+                       std::integral_constant<int, 3>) const;
+#endif
+
+      // Data members //
+
+      AlignedVector<scalar_t> streams[NUM_COMPONENTS];
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    template <typename VEC_T>
+    constexpr int SoAVector<VEC_T>::NUM_COMPONENTS;
+
+    template <typename VEC_T>
+    inline SoAVector<VEC_T>::SoAVector(size_t count)
+    {
+      resize(count);
+    }
+
+    template <typename VEC_T>
+    inline SoAVector<VEC_T>::SoAVector(size_t count, const VEC_T &value)
+    {
+      resize(count, value);
+    }
+
+    template <typename VEC_T>
+    template <typename S>
+    inline void SoAVector<VEC_T>::streamPointers(S **ptrs) const
+    {
+      for (int c = 0; c < NUM_COMPONENTS; ++c)
+        ptrs[c] = const_cast<S *>(streams[c].data());
+    }
+
+    template <typename VEC_T>
+    inline typename SoAVector<VEC_T>::reference SoAVector<VEC_T>::operator[](
+        size_t i)
+    {
+      scalar_t *ptrs[NUM_COMPONENTS];
+      streamPointers(ptrs);
+      return reference(ptrs, i);
+    }
+
+    template <typename VEC_T>
+    inline typename SoAVector<VEC_T>::const_reference
+    SoAVector<VEC_T>::operator[](size_t i) const
+    {
+      const scalar_t *ptrs[NUM_COMPONENTS];
+      streamPointers(ptrs);
+      return const_reference(ptrs, i);
+    }
+
+    template <typename VEC_T>
+    inline typename SoAVector<VEC_T>::reference SoAVector<VEC_T>::at(size_t i)
+    {
+      if (i >= size())
+        throw std::out_of_range("SoAVector<> index out of range");
+      return (*this)[i];
+    }
+
+    template <typename VEC_T>
+    inline typename SoAVector<VEC_T>::const_reference SoAVector<VEC_T>::at(
+        size_t i) const
+    {
+      if (i >= size())
+        throw std::out_of_range("SoAVector<> index out of range");
+      return (*this)[i];
+    }
+
+    template <typename VEC_T>
+    inline typename SoAVector<VEC_T>::scalar_t *SoAVector<VEC_T>::data(
+        int c)
+    {
+      return streams[c].data();
+    }
+
+    template <typename VEC_T>
+    inline const typename SoAVector<VEC_T>::scalar_t *SoAVector<VEC_T>::data(
+        int c) const
+    {
+      return streams[c].data();
+    }
+
+    template <typename VEC_T>
+    inline utility::ArrayView<typename SoAVector<VEC_T>::scalar_t>
+    SoAVector<VEC_T>::component(int c)
+    {
+      return utility::ArrayView<scalar_t>(streams[c].data(), size());
+    }
+
+    template <typename VEC_T>
+    inline utility::DataView<typename SoAVector<VEC_T>::scalar_t>
+    SoAVector<VEC_T>::componentView(int c) const
+    {
+      return utility::DataView<scalar_t>(streams[c].data());
+    }
+
+    template <typename VEC_T>
+    inline size_t SoAVector<VEC_T>::size() const
+    {
+      return streams[0].size();
+    }
+
+    template <typename VEC_T>
+    inline bool SoAVector<VEC_T>::empty() const
+    {
+      return size() == 0;
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::push_back(const VEC_T &value)
+    {
+      const scalar_t *v = &value.x;
+      for (int c = 0; c < NUM_COMPONENTS; ++c)
+        streams[c].push_back(v[c]);
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::pop_back()
+    {
+      for (auto &s : streams)
+        s.pop_back();
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::clear()
+    {
+      for (auto &s : streams)
+        s.clear();
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::reserve(size_t newCapacity)
+    {
+      for (auto &s : streams)
+        s.reserve(newCapacity);
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::resize(size_t newSize)
+    {
+      for (auto &s : streams)
+        s.resize(newSize);
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::resize(size_t newSize, const VEC_T &value)
+    {
+      const scalar_t *v = &value.x;
+      for (int c = 0; c < NUM_COMPONENTS; ++c)
+        streams[c].resize(newSize, v[c]);
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::gather(const VEC_T *aos, size_t count)
+    {
+      resize(count);
+
+      size_t i = 0;
+      gatherSIMD(aos, count, i, simd_width_t());
+
+      for (; i < count; ++i) {
+        const scalar_t *v = &aos[i].x;
+        for (int c = 0; c < NUM_COMPONENTS; ++c)
+          streams[c][i] = v[c];
+      }
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::gather(const AlignedVector<VEC_T> &aos)
+    {
+      gather(aos.data(), aos.size());
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::gather(const utility::DataView<VEC_T> &aos,
+                                         size_t count)
+    {
+      resize(count);
+      for (size_t i = 0; i < count; ++i) {
+        const scalar_t *v = &aos[i].x;
+        for (int c = 0; c < NUM_COMPONENTS; ++c)
+          streams[c][i] = v[c];
+      }
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::scatter(VEC_T *aos) const
+    {
+      size_t i = 0;
+      scatterSIMD(aos, i, simd_width_t());
+
+      for (; i < size(); ++i) {
+        scalar_t *v = &aos[i].x;
+        for (int c = 0; c < NUM_COMPONENTS; ++c)
+          v[c] = streams[c][i];
+      }
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::scatter(AlignedVector<VEC_T> &aos) const
+    {
+      aos.resize(size());
+      scatter(aos.data());
+    }
+
+    // Transpose 4 AoS elements at a time, 'i' is left at the first element
+    // which still has to be converted
+#ifndef RKCOMMON_NO_SIMD
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::gatherSIMD(const VEC_T *aos,
+                                             size_t count,
+                                             size_t &i,
+                                             std::integral_constant<int, 4>)
+    {
+      const float *src = reinterpret_cast<const float *>(aos);
+      float *dst[NUM_COMPONENTS];
+      streamPointers(dst);
+      for (; i + 4 <= count; i += 4, src += 16) {
+        const __m128 r0 = _mm_loadu_ps(src + 0);
+        const __m128 r1 = _mm_loadu_ps(src + 4);
+        const __m128 r2 = _mm_loadu_ps(src + 8);
+        const __m128 r3 = _mm_loadu_ps(src + 12);
+        const __m128 t0 = _mm_unpacklo_ps(r0, r1);  // x0 x1 y0 y1
+        const __m128 t1 = _mm_unpacklo_ps(r2, r3);  // x2 x3 y2 y3
+        const __m128 t2 = _mm_unpackhi_ps(r0, r1);  // z0 z1 w0 w1
+        const __m128 t3 = _mm_unpackhi_ps(r2, r3);  // z2 z3 w2 w3
+        _mm_storeu_ps(dst[0] + i, _mm_movelh_ps(t0, t1));
+        _mm_storeu_ps(dst[1] + i, _mm_movehl_ps(t1, t0));
+        _mm_storeu_ps(dst[2] + i, _mm_movelh_ps(t2, t3));
+        if (NUM_COMPONENTS == 4)
+          _mm_storeu_ps(dst[NUM_COMPONENTS - 1] + i, _mm_movehl_ps(t3, t2));
+      }
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::gatherSIMD(const VEC_T *aos,
+                                             size_t count,
+                                             size_t &i,
+                                             std::integral_constant<int, 3>)
+    {
+      const float *src = reinterpret_cast<const float *>(aos);
+      float *dst[NUM_COMPONENTS];
+      streamPointers(dst);
+      for (; i + 4 <= count; i += 4, src += 12) {
+        const __m128 a = _mm_loadu_ps(src + 0);  // x0 y0 z0 x1
+        const __m128 b = _mm_loadu_ps(src + 4);  // y1 z1 x2 y2
+        const __m128 c = _mm_loadu_ps(src + 8);  // z2 x3 y3 z3
+        const __m128 x23 =
+            _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));  // x2 x2 x3 x3
+        const __m128 y01 =
+            _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));  // y0 y0 y1 y1
+        const __m128 y23 =
+            _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));  // y2 y2 y3 y3
+        const __m128 z01 =
+            _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));  // z0 z0 z1 z1
+        const __m128 z23 =
+            _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));  // z2 z2 z3 z3
+        _mm_storeu_ps(dst[0] + i,
+                      _mm_shuffle_ps(a, x23, _MM_SHUFFLE(2, 0, 3, 0)));
+        _mm_storeu_ps(dst[1] + i,
+                      _mm_shuffle_ps(y01, y23, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(dst[2] + i,
+                      _mm_shuffle_ps(z01, z23, _MM_SHUFFLE(2, 0, 2, 0)));
+      }
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::scatterSIMD(
+        VEC_T *aos, size_t &i, std::integral_constant<int, 4>) const
+    {
+      const size_t count = size();
+      float *dst         = reinterpret_cast<float *>(aos);
+      const float *src[NUM_COMPONENTS];
+      streamPointers(src);
+      for (; i + 4 <= count; i += 4, dst += 16) {
+        const __m128 x = _mm_loadu_ps(src[0] + i);
+        const __m128 y = _mm_loadu_ps(src[1] + i);
+        const __m128 z = _mm_loadu_ps(src[2] + i);
+        // vec3fa's padding is written as zero
+        const __m128 w = NUM_COMPONENTS == 4
+                             ? _mm_loadu_ps(src[NUM_COMPONENTS - 1] + i)
+                             : _mm_setzero_ps();
+        const __m128 t0 = _mm_unpacklo_ps(x, y);  // x0 y0 x1 y1
+        const __m128 t1 = _mm_unpacklo_ps(z, w);  // z0 w0 z1 w1
+        const __m128 t2 = _mm_unpackhi_ps(x, y);  // x2 y2 x3 y3
+        const __m128 t3 = _mm_unpackhi_ps(z, w);  // z2 w2 z3 w3
+        _mm_storeu_ps(dst + 0, _mm_movelh_ps(t0, t1));
+        _mm_storeu_ps(dst + 4, _mm_movehl_ps(t1, t0));
+        _mm_storeu_ps(dst + 8, _mm_movelh_ps(t2, t3));
+        _mm_storeu_ps(dst + 12, _mm_movehl_ps(t3, t2));
+      }
+    }
+
+    template <typename VEC_T>
+    inline void SoAVector<VEC_T>::scatterSIMD(
+        VEC_T *aos, size_t &i, std::integral_constant<int, 3>) const
+    {
+      const size_t count = size();
+      float *dst         = reinterpret_cast<float *>(aos);
+      const float *src[NUM_COMPONENTS];
+      streamPointers(src);
+      for (; i + 4 <= count; i += 4, dst += 12) {
+        const __m128 x    = _mm_loadu_ps(src[0] + i);
+        const __m128 y    = _mm_loadu_ps(src[1] + i);
+        const __m128 z    = _mm_loadu_ps(src[2] + i);
+        const __m128 xy01 = _mm_unpacklo_ps(x, y);  // x0 y0 x1 y1
+        const __m128 xy23 = _mm_unpackhi_ps(x, y);  // x2 y2 x3 y3
+        const __m128 zx01 =
+            _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));  // z0 z0 x1 x1
+        const __m128 yz11 =
+            _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));  // y1 y1 z1 z1
+        const __m128 zx23 =
+            _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));  // z2 z2 x3 x3
+        const __m128 yz33 =
+            _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));  // y3 y3 z3 z3
+        // x0 y0 z0 x1
+        _mm_storeu_ps(dst + 0,
+                      _mm_shuffle_ps(xy01, zx01, _MM_SHUFFLE(2, 0, 1, 0)));
+        // y1 z1 x2 y2
+        _mm_storeu_ps(dst + 4,
+                      _mm_shuffle_ps(yz11, xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+        // z2 x3 y3 z3
+        _mm_storeu_ps(dst + 8,
+                      _mm_shuffle_ps(zx23, yz33, _MM_SHUFFLE(2, 0, 2, 0)));
+      }
+    }
+#endif
+
+  }  // namespace containers
+}  // namespace rkcommon
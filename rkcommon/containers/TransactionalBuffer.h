@@ -3,7 +3,14 @@
 
 #pragma once
 
+#include "../memory/malloc.h"
+// std
+#include <atomic>
+#include <cstdint>
+#include <iterator>
 #include <mutex>
+#include <new>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -22,6 +29,11 @@ namespace rkcommon {
       // Take all contents of the buffer (consumer)
       std::vector<T> consume();
 
+      // Same, but the buffer continues in the storage of 'recycled' (e.g. the
+      // vector returned by the previous consume()), so steady-state pushes
+      // do not allocate
+      std::vector<T> consume(std::vector<T> &&recycled);
+
       size_t size() const;
 
       bool empty() const;
@@ -59,6 +71,16 @@ namespace rkcommon {
       return std::move(buffer);
     }
 
+    template <typename T>
+    inline std::vector<T> TransactionalBuffer<T>::consume(
+        std::vector<T> &&recycled)
+    {
+      recycled.clear();
+      std::lock_guard<std::mutex> lock(bufferMutex);
+      std::swap(buffer, recycled);
+      return std::move(recycled);
+    }
+
     template <typename T>
     inline size_t TransactionalBuffer<T>::size() const
     {
@@ -73,5 +95,214 @@ namespace rkcommon {
       return buffer.empty();
     }
 
+
+    // A multi-producer/single-consumer TransactionalBuffer without a shared
+    // lock: each producer thread appends to its own segment, which is only
+    // ever contended by consume() taking it over. Items of a single producer
+    // keep their order, items of different producers are not ordered.
+    // consume() must not be called by several threads at the same time.
+    template <typename T>
+    struct MPSCTransactionalBuffer
+    {
+      MPSCTransactionalBuffer() = default;
+      ~MPSCTransactionalBuffer();
+
+      MPSCTransactionalBuffer(const MPSCTransactionalBuffer &) = delete;
+      MPSCTransactionalBuffer &operator=(const MPSCTransactionalBuffer &) =
+          delete;
+
+      // Insert into the buffer (producer)
+      void push_back(const T &);
+      void push_back(T &&);
+
+      // Take all contents of the buffer (consumer)
+      std::vector<T> consume();
+
+      // Same, but the returned batch is built in the storage of 'recycled'
+      std::vector<T> consume(std::vector<T> &&recycled);
+
+      // Approximate while producers are pushing
+      size_t size() const;
+
+      bool empty() const;
+
+     private:
+      struct alignas(64) Segment
+      {
+        std::thread::id owner;
+        Segment *next{nullptr};
+
+        // only contended while consume() takes over the items
+        std::atomic<bool> locked{false};
+        std::atomic<size_t> count{0};
+        std::vector<T> items;
+
+        void lock();
+        void unlock();
+      };
+
+      Segment &segmentForThisThread();
+
+      template <typename V>
+      void push(V &&v);
+
+      // Data members //
+
+      // lock-free list of all segments, only ever grows
+      std::atomic<Segment *> segments{nullptr};
+
+      // tells a thread's cached segment apart from one of a destroyed buffer
+      // which lived at the same address
+      const uint64_t id{nextId()};
+
+      static uint64_t nextId();
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    template <typename T>
+    inline MPSCTransactionalBuffer<T>::~MPSCTransactionalBuffer()
+    {
+      Segment *s = segments.load();
+      while (s) {
+        Segment *next = s->next;
+        s->~Segment();
+        memory::alignedFree(s);
+        s = next;
+      }
+    }
+
+    template <typename T>
+    inline void MPSCTransactionalBuffer<T>::Segment::lock()
+    {
+      while (locked.exchange(true, std::memory_order_acquire))
+        std::this_thread::yield();
+    }
+
+    template <typename T>
+    inline void MPSCTransactionalBuffer<T>::Segment::unlock()
+    {
+      locked.store(false, std::memory_order_release);
+    }
+
+    template <typename T>
+    inline uint64_t MPSCTransactionalBuffer<T>::nextId()
+    {
+      static std::atomic<uint64_t> counter{0};
+      return ++counter;
+    }
+
+    template <typename T>
+    inline typename MPSCTransactionalBuffer<T>::Segment &
+    MPSCTransactionalBuffer<T>::segmentForThisThread()
+    {
+      // producers usually push to the same buffer over and over
+      struct Cache
+      {
+        uint64_t id{0};
+        Segment *segment{nullptr};
+      };
+      static thread_local Cache cache;
+
+      if (cache.id == id)
+        return *cache.segment;
+
+      const std::thread::id self = std::this_thread::get_id();
+
+      Segment *s = segments.load(std::memory_order_acquire);
+      for (; s; s = s->next) {
+        if (s->owner == self)
+          break;
+      }
+
+      if (!s) {
+        // C++11 'new' does not align segments to cache lines
+        s = new (memory::alignedMalloc(sizeof(Segment), alignof(Segment)))
+            Segment;
+        s->owner = self;
+        s->next  = segments.load(std::memory_order_relaxed);
+        while (!segments.compare_exchange_weak(
+            s->next, s, std::memory_order_release, std::memory_order_relaxed))
+          ;
+      }
+
+      cache.id      = id;
+      cache.segment = s;
+      return *s;
+    }
+
+    template <typename T>
+    template <typename V>
+    inline void MPSCTransactionalBuffer<T>::push(V &&v)
+    {
+      Segment &s = segmentForThisThread();
+      s.lock();
+      s.items.push_back(std::forward<V>(v));
+      s.count.store(s.items.size(), std::memory_order_relaxed);
+      s.unlock();
+    }
+
+    template <typename T>
+    inline void MPSCTransactionalBuffer<T>::push_back(const T &v)
+    {
+      push(v);
+    }
+
+    template <typename T>
+    inline void MPSCTransactionalBuffer<T>::push_back(T &&v)
+    {
+      push(std::move(v));
+    }
+
+    template <typename T>
+    inline std::vector<T> MPSCTransactionalBuffer<T>::consume()
+    {
+      return consume(std::vector<T>());
+    }
+
+    template <typename T>
+    inline std::vector<T> MPSCTransactionalBuffer<T>::consume(
+        std::vector<T> &&recycled)
+    {
+      std::vector<T> result = std::move(recycled);
+      result.clear();
+
+      for (Segment *s = segments.load(std::memory_order_acquire); s;
+           s          = s->next) {
+        if (s->count.load(std::memory_order_relaxed) == 0)
+          continue;
+        s->lock();
+        if (result.empty()) {
+          // segments keep their capacity, hand over the batch's storage
+          std::swap(result, s->items);
+        } else {
+          result.insert(result.end(),
+                        std::make_move_iterator(s->items.begin()),
+                        std::make_move_iterator(s->items.end()));
+        }
+        s->items.clear();
+        s->count.store(0, std::memory_order_relaxed);
+        s->unlock();
+      }
+
+      return result;
+    }
+
+    template <typename T>
+    inline size_t MPSCTransactionalBuffer<T>::size() const
+    {
+      size_t total = 0;
+      for (Segment *s = segments.load(std::memory_order_acquire); s;
+           s          = s->next)
+        total += s->count.load(std::memory_order_relaxed);
+      return total;
+    }
+
+    template <typename T>
+    inline bool MPSCTransactionalBuffer<T>::empty() const
+    {
+      return size() == 0;
+    }
+
   }  // namespace containers
 }  // namespace rkcommon
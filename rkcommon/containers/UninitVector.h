@@ -0,0 +1,152 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "../memory/malloc.h"
+
+namespace rkcommon {
+  namespace containers {
+
+    // Allocator which default-initializes instead of value-initializing, so
+    // resize() on vectors of trivially constructible types (pixels, voxels)
+    // leaves the new elements uninitialized instead of zero filling them.
+    // Allocations are 64 byte aligned, and large ones are backed by huge
+    // pages according to 'PAGES'.
+    template <typename T, memory::HugePages PAGES = memory::HugePages::NONE>
+    struct uninitialized_allocator
+    {
+      using value_type = T;
+
+      template <typename U>
+      struct rebind
+      {
+        using other = uninitialized_allocator<U, PAGES>;
+      };
+
+      uninitialized_allocator() = default;
+
+      template <typename U>
+      uninitialized_allocator(const uninitialized_allocator<U, PAGES> &)
+      {
+      }
+
+      T *allocate(size_t n) const;
+      void deallocate(T *p, size_t n) const;
+
+      // 'new (p) U' rather than 'new (p) U()', see above
+      template <typename U>
+      void construct(U *p) const;
+
+      template <typename U, typename... Args>
+      void construct(U *p, Args &&... args) const;
+
+      template <typename U>
+      bool operator==(const uninitialized_allocator<U, PAGES> &) const
+      {
+        return true;
+      }
+
+      template <typename U>
+      bool operator!=(const uninitialized_allocator<U, PAGES> &) const
+      {
+        return false;
+      }
+    };
+
+    template <typename T, memory::HugePages PAGES = memory::HugePages::NONE>
+    using UninitVector = std::vector<T, uninitialized_allocator<T, PAGES>>;
+
+    // Any allocator ALLOC (aligned_allocator, numa_aligned_allocator,
+    // memory::ArenaAllocator, ...) with the default-initializing construct()
+    // of uninitialized_allocator
+    template <typename ALLOC>
+    struct default_init_allocator : public ALLOC
+    {
+      using traits     = std::allocator_traits<ALLOC>;
+      using value_type = typename traits::value_type;
+
+      template <typename U>
+      struct rebind
+      {
+        using other =
+            default_init_allocator<typename traits::template rebind_alloc<U>>;
+      };
+
+      default_init_allocator() = default;
+
+      default_init_allocator(const ALLOC &allocator) : ALLOC(allocator) {}
+
+      template <typename OTHER_ALLOC>
+      default_init_allocator(const default_init_allocator<OTHER_ALLOC> &other)
+          : ALLOC(static_cast<const OTHER_ALLOC &>(other))
+      {
+      }
+
+      template <typename U>
+      void construct(U *p)
+      {
+        ::new (static_cast<void *>(p)) U;
+      }
+
+      template <typename U, typename... Args>
+      void construct(U *p, Args &&... args)
+      {
+        traits::construct(
+            static_cast<ALLOC &>(*this), p, std::forward<Args>(args)...);
+      }
+    };
+
+    // Inlined member definitions /////////////////////////////////////////////
+
+    template <typename T, memory::HugePages PAGES>
+    inline T *uninitialized_allocator<T, PAGES>::allocate(size_t n) const
+    {
+      if (n == 0)
+        return nullptr;
+
+      if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+        throw std::bad_alloc();
+
+      void *p = PAGES == memory::HugePages::NONE
+                    ? memory::alignedMalloc(n * sizeof(T), 64)
+                    : memory::hugePageMalloc(n * sizeof(T), PAGES);
+      if (p == nullptr)
+        throw std::bad_alloc();
+
+      return static_cast<T *>(p);
+    }
+
+    template <typename T, memory::HugePages PAGES>
+    inline void uninitialized_allocator<T, PAGES>::deallocate(T *p,
+                                                              size_t n) const
+    {
+      if (PAGES == memory::HugePages::NONE)
+        memory::alignedFree(p);
+      else
+        memory::hugePageFree(p, n * sizeof(T), PAGES);
+    }
+
+    template <typename T, memory::HugePages PAGES>
+    template <typename U>
+    inline void uninitialized_allocator<T, PAGES>::construct(U *p) const
+    {
+      ::new (static_cast<void *>(p)) U;
+    }
+
+    template <typename T, memory::HugePages PAGES>
+    template <typename U, typename... Args>
+    inline void uninitialized_allocator<T, PAGES>::construct(
+        U *p, Args &&... args) const
+    {
+      ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+    }
+
+  }  // namespace containers
+}  // namespace rkcommon
@@ -169,5 +169,148 @@ namespace rkcommon {
       p->~T();
     }
 
+    /* Variant of aligned_allocator<> which places large allocations on NUMA
+       nodes according to POLICY, see memory::numaAlignedMalloc(). Note that
+       the pages are placed when allocate() is called, before the container
+       constructs (and thereby touches) the elements. */
+    template <typename T,
+              memory::NumaPolicy POLICY =
+                  memory::NumaPolicy::FIRST_TOUCH_PARALLEL,
+              int alignment = OSPRAY_DEFAULT_ALIGNMENT>
+    struct numa_aligned_allocator
+    {
+      using value_type = T;
+
+      template <typename U>
+      struct rebind
+      {
+        using other = numa_aligned_allocator<U, POLICY, alignment>;
+      };
+
+      numa_aligned_allocator() = default;
+
+      template <typename U>
+      numa_aligned_allocator(
+          const numa_aligned_allocator<U, POLICY, alignment> &)
+      {
+      }
+
+      T *allocate(const size_t n) const
+      {
+        if (n == 0)
+          return nullptr;
+
+        if (n > size_t(-1) / sizeof(T)) {
+          throw std::length_error(
+              "numa_aligned_allocator<T>::allocate() – Integer overflow.");
+        }
+
+        void *const pv =
+            memory::numaAlignedMalloc(n * sizeof(T), alignment, POLICY);
+
+        if (pv == nullptr)
+          throw std::bad_alloc();
+
+        return static_cast<T *>(pv);
+      }
+
+      void deallocate(T *const p, const size_t n) const
+      {
+        memory::numaAlignedFree(p, n * sizeof(T));
+      }
+
+      template <typename U>
+      bool operator==(
+          const numa_aligned_allocator<U, POLICY, alignment> &) const
+      {
+        return true;
+      }
+
+      template <typename U>
+      bool operator!=(
+          const numa_aligned_allocator<U, POLICY, alignment> &) const
+      {
+        return false;
+      }
+    };
+
+    /*! Aligned allocator for host memory a GPU can access, see
+        memory::deviceAlignedMalloc(); without a memory::DeviceAllocator
+        set this is ordinary aligned memory. */
+    template <typename T,
+              memory::DeviceMemory KIND = memory::DeviceMemory::HOST_PINNED,
+              int alignment             = 64>
+    struct device_aligned_allocator
+    {
+      using value_type = T;
+
+      template <typename U>
+      struct rebind
+      {
+        using other = device_aligned_allocator<U, KIND, alignment>;
+      };
+
+      device_aligned_allocator() = default;
+
+      template <typename U>
+      device_aligned_allocator(
+          const device_aligned_allocator<U, KIND, alignment> &)
+      {
+      }
+
+      T *allocate(const size_t n) const
+      {
+        if (n == 0)
+          return nullptr;
+
+        if (n > size_t(-1) / sizeof(T)) {
+          throw std::length_error(
+              "device_aligned_allocator<T>::allocate() – Integer overflow.");
+        }
+
+        void *const pv =
+            memory::deviceAlignedMalloc(n * sizeof(T), KIND, alignment);
+
+        if (pv == nullptr)
+          throw std::bad_alloc();
+
+        return static_cast<T *>(pv);
+      }
+
+      void deallocate(T *const p, const size_t) const
+      {
+        memory::deviceAlignedFree(p);
+      }
+
+      template <typename U>
+      bool operator==(
+          const device_aligned_allocator<U, KIND, alignment> &) const
+      {
+        return true;
+      }
+
+      template <typename U>
+      bool operator!=(
+          const device_aligned_allocator<U, KIND, alignment> &) const
+      {
+        return false;
+      }
+    };
+
+    /*! Whether memory from ALLOC may be device accessible: PAGEABLE for
+        all but the device_aligned_allocator */
+    template <typename ALLOC>
+    struct allocator_device_memory
+    {
+      static constexpr memory::DeviceMemory value =
+          memory::DeviceMemory::PAGEABLE;
+    };
+
+    template <typename T, memory::DeviceMemory KIND, int alignment>
+    struct allocator_device_memory<device_aligned_allocator<T, KIND, alignment>>
+    {
+      static constexpr memory::DeviceMemory value = KIND;
+    };
+
   }  // namespace containers
 }  // namespace rkcommon
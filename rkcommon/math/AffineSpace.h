@@ -156,6 +156,14 @@ namespace rkcommon {
       return AffineSpaceT<L>(il, -(il * a.p));
     }
 
+    // rcp() of a rigid transform, which only needs the transpose of 'a.l'
+    template <typename L>
+    inline AffineSpaceT<L> rcpOrthonormal(const AffineSpaceT<L> &a)
+    {
+      L il = rcpOrthonormal(a.l);
+      return AffineSpaceT<L>(il, -(il * a.p));
+    }
+
     ///////////////////////////////////////////////////////////////////////////
     // Binary Operators
     ///////////////////////////////////////////////////////////////////////////
@@ -237,31 +245,66 @@ namespace rkcommon {
       return xfmNormal(m.l, n);
     }
 
+    /*! Bounds of the transformed box without transforming its 8 corners
+        (J. Arvo, "Transforming Axis-Aligned Bounding Boxes"): each column
+        of 'm.l' scaled by the lower and upper bound of its axis adds its
+        min to the lower and its max to the upper corner. Empty boxes stay
+        empty. */
     template <typename S, bool A = false>
     inline const box_t<S, 3, A> xfmBounds(
         const AffineSpaceT<LinearSpace3<vec_t<S, 3, A>>> &m,
         const box_t<S, 3, A> &b)
     {
-      box_t<S, 3, A> dst = empty;
-      const vec_t<S, 3, A> p0(b.lower.x, b.lower.y, b.lower.z);
-      dst.extend(xfmPoint(m, p0));
-      const vec_t<S, 3, A> p1(b.lower.x, b.lower.y, b.upper.z);
-      dst.extend(xfmPoint(m, p1));
-      const vec_t<S, 3, A> p2(b.lower.x, b.upper.y, b.lower.z);
-      dst.extend(xfmPoint(m, p2));
-      const vec_t<S, 3, A> p3(b.lower.x, b.upper.y, b.upper.z);
-      dst.extend(xfmPoint(m, p3));
-      const vec_t<S, 3, A> p4(b.upper.x, b.lower.y, b.lower.z);
-      dst.extend(xfmPoint(m, p4));
-      const vec_t<S, 3, A> p5(b.upper.x, b.lower.y, b.upper.z);
-      dst.extend(xfmPoint(m, p5));
-      const vec_t<S, 3, A> p6(b.upper.x, b.upper.y, b.lower.z);
-      dst.extend(xfmPoint(m, p6));
-      const vec_t<S, 3, A> p7(b.upper.x, b.upper.y, b.upper.z);
-      dst.extend(xfmPoint(m, p7));
+      using V = vec_t<S, 3, A>;
+
+      if (b.empty())
+        return box_t<S, 3, A>(empty);
+
+      box_t<S, 3, A> dst(m.p, m.p);
+      auto addAxis = [&](const V &column, S lower, S upper) {
+        const V lo = column * lower;
+        const V hi = column * upper;
+        dst.lower  = dst.lower + min(lo, hi);
+        dst.upper  = dst.upper + max(lo, hi);
+      };
+      addAxis(m.l.vx, b.lower.x, b.upper.x);
+      addAxis(m.l.vy, b.lower.y, b.upper.y);
+      addAxis(m.l.vz, b.lower.z, b.upper.z);
       return dst;
     }
 
+#ifndef RKCOMMON_NO_SIMD
+    // the same with the columns of 'm.l' and both corners in SSE registers
+    inline box3fa xfmBounds(const AffineSpaceT<LinearSpace3fa> &m,
+                            const box3fa &b)
+    {
+      if (b.empty())
+        return box3fa(empty);
+
+      const __m128 blo = detail::load4(b.lower);
+      const __m128 bhi = detail::load4(b.upper);
+
+      __m128 lower = detail::load4(m.p);
+      __m128 upper = lower;
+
+#define xfmBoundsAxis(column, axis)                                          \
+  {                                                                          \
+    const __m128 c  = detail::load4(column);                                 \
+    const __m128 lo = _mm_mul_ps(c, _mm_shuffle_ps(blo, blo, axis));         \
+    const __m128 hi = _mm_mul_ps(c, _mm_shuffle_ps(bhi, bhi, axis));         \
+    lower           = _mm_add_ps(lower, _mm_min_ps(lo, hi));                 \
+    upper           = _mm_add_ps(upper, _mm_max_ps(lo, hi));                 \
+  }
+
+      xfmBoundsAxis(m.l.vx, _MM_SHUFFLE(0, 0, 0, 0));
+      xfmBoundsAxis(m.l.vy, _MM_SHUFFLE(1, 1, 1, 1));
+      xfmBoundsAxis(m.l.vz, _MM_SHUFFLE(2, 2, 2, 2));
+#undef xfmBoundsAxis
+
+      return box3fa(detail::store3fa(lower), detail::store3fa(upper));
+    }
+#endif
+
     ///////////////////////////////////////////////////////////////////////////
     /// Comparison Operators
     ///////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,559 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "BVH.h"
+#include "bounds.h"
+#include "morton.h"
+#include "../containers/ConcurrentSegmentedVector.h"
+#include "../tasking/parallel_reduce.h"
+#include "../tasking/parallel_sort.h"
+// std
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace rkcommon {
+  namespace math {
+
+    constexpr int BVH::WIDTH;
+    constexpr int BVH::MAX_DEPTH;
+    constexpr uint32_t BVH::INVALID;
+
+    static_assert(sizeof(BVH::Node) == 128,
+                  "BVH::Node should fill exactly two cache lines");
+
+    namespace {
+
+      constexpr int MAX_BINS = 32;
+
+      // primitives per parallel task, and the smallest subtree built or
+      // binned in parallel
+      constexpr size_t BLOCK_SIZE = 4 * 1024;
+
+      /* past this depth subtrees are split at the object median, which
+         at least halves them per level and so bounds the depth of the
+         tree by BVH::MAX_DEPTH */
+      constexpr int MEDIAN_SPLIT_DEPTH = 32;
+
+      struct BuildRecord
+      {
+        size_t begin;
+        size_t end;
+        box3f bounds;
+        box3f centroidBounds;
+
+        size_t size() const
+        {
+          return end - begin;
+        }
+      };
+
+      struct BoundsPair
+      {
+        box3f bounds{empty};
+        box3f centroidBounds{empty};
+      };
+
+      struct Bins
+      {
+        box3f bounds[3][MAX_BINS];
+        box3f centroidBounds[3][MAX_BINS];
+        uint32_t count[3][MAX_BINS];
+
+        Bins()
+        {
+          for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < MAX_BINS; ++b) {
+              bounds[a][b]         = box3f(empty);
+              centroidBounds[a][b] = box3f(empty);
+              count[a][b]          = 0;
+            }
+          }
+        }
+
+        void merge(const Bins &other)
+        {
+          for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < MAX_BINS; ++b) {
+              bounds[a][b].extend(other.bounds[a][b]);
+              centroidBounds[a][b].extend(other.centroidBounds[a][b]);
+              count[a][b] += other.count[a][b];
+            }
+          }
+        }
+      };
+
+      inline float halfArea(const box3f &b)
+      {
+        const vec3f d = b.size();
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+      }
+
+      class Builder
+      {
+       public:
+        Builder(const box3f *primBounds,
+                size_t n,
+                const BVHBuildSettings &settings,
+                std::vector<uint32_t> &primIDs);
+
+        void build(containers::AlignedVector<BVH::Node> &nodes);
+
+       private:
+        BuildRecord makeRecord(size_t begin, size_t end) const;
+
+        void buildNode(size_t nodeIndex, const BuildRecord &r, int depth);
+
+        void split(const BuildRecord &r,
+                   bool median,
+                   BuildRecord &left,
+                   BuildRecord &right);
+        bool splitSAH(const BuildRecord &r,
+                      BuildRecord &left,
+                      BuildRecord &right);
+        bool splitMorton(const BuildRecord &r,
+                         BuildRecord &left,
+                         BuildRecord &right);
+        void splitMedian(const BuildRecord &r,
+                         BuildRecord &left,
+                         BuildRecord &right);
+
+        const box3f *primBounds;
+        size_t n;
+        size_t maxLeafSize;
+        int numBins;
+        bool morton;
+        bool parallel;
+
+        std::vector<uint32_t> &primIDs;
+        std::vector<vec3f> centroids;  // by primitive ID
+        std::vector<uint32_t> codes;   // by position in primIDs
+        box3f rootBounds;
+        box3f rootCentroidBounds;
+
+        containers::ConcurrentSegmentedVector<BVH::Node> nodes;
+      };
+
+      Builder::Builder(const box3f *_primBounds,
+                       size_t _n,
+                       const BVHBuildSettings &settings,
+                       std::vector<uint32_t> &_primIDs)
+          : primBounds(_primBounds),
+            n(_n),
+            maxLeafSize(size_t(std::max(settings.maxLeafSize, 1))),
+            numBins(std::min(std::max(settings.numBins, 2), MAX_BINS)),
+            morton(settings.mortonPresort),
+            parallel(settings.parallel),
+            primIDs(_primIDs),
+            centroids(_n)
+      {
+        primIDs.resize(n);
+
+        auto init = [&](size_t b) {
+          const size_t end = std::min(n, (b + 1) * BLOCK_SIZE);
+          for (size_t i = b * BLOCK_SIZE; i < end; ++i) {
+            primIDs[i]   = uint32_t(i);
+            centroids[i] = primBounds[i].center();
+          }
+        };
+
+        const size_t numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        if (parallel && numBlocks > 1)
+          tasking::parallel_for(numBlocks, init);
+        else {
+          for (size_t b = 0; b < numBlocks; ++b)
+            init(b);
+        }
+
+        rootBounds =
+            computeBounds(primBounds, n, &rootCentroidBounds, parallel);
+
+        if (morton) {
+          codes.resize(n);
+          mortonCodes(
+              rootCentroidBounds, centroids.data(), codes.data(), n, parallel);
+          tasking::parallel_radix_sort(codes.data(), primIDs.data(), n);
+        }
+      }
+
+      void Builder::build(containers::AlignedVector<BVH::Node> &result)
+      {
+        BuildRecord root;
+        root.begin          = 0;
+        root.end            = n;
+        root.bounds         = rootBounds;
+        root.centroidBounds = rootCentroidBounds;
+
+        buildNode(nodes.push_back(BVH::Node()), root, 0);
+
+        result.resize(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i)
+          result[i] = nodes[i];
+      }
+
+      BuildRecord Builder::makeRecord(size_t begin, size_t end) const
+      {
+        auto boundsOf = [&](size_t b, size_t e) {
+          BoundsPair bp;
+          for (size_t i = b; i < e; ++i) {
+            bp.bounds.extend(primBounds[primIDs[i]]);
+            bp.centroidBounds.extend(centroids[primIDs[i]]);
+          }
+          return bp;
+        };
+
+        BoundsPair bp;
+        const size_t size = end - begin;
+        if (parallel && size >= 2 * BLOCK_SIZE) {
+          bp = tasking::parallel_reduce(
+              (size + BLOCK_SIZE - 1) / BLOCK_SIZE,
+              BoundsPair(),
+              [&](size_t b) {
+                const size_t first = begin + b * BLOCK_SIZE;
+                return boundsOf(first, std::min(end, first + BLOCK_SIZE));
+              },
+              [](const BoundsPair &a, const BoundsPair &b) {
+                BoundsPair r = a;
+                r.bounds.extend(b.bounds);
+                r.centroidBounds.extend(b.centroidBounds);
+                return r;
+              });
+        } else {
+          bp = boundsOf(begin, end);
+        }
+
+        BuildRecord r;
+        r.begin          = begin;
+        r.end            = end;
+        r.bounds         = bp.bounds;
+        r.centroidBounds = bp.centroidBounds;
+        return r;
+      }
+
+      void Builder::buildNode(size_t nodeIndex,
+                              const BuildRecord &r,
+                              int depth)
+      {
+        const bool median = depth >= MEDIAN_SPLIT_DEPTH;
+
+        // keep splitting the largest child until the node is full
+        BuildRecord children[BVH::WIDTH];
+        int numChildren       = 0;
+        children[numChildren++] = r;
+
+        while (numChildren < BVH::WIDTH) {
+          int best       = -1;
+          float bestSize = -1.f;
+          for (int i = 0; i < numChildren; ++i) {
+            if (children[i].size() <= maxLeafSize)
+              continue;
+            const float size = median ? float(children[i].size())
+                                      : halfArea(children[i].bounds);
+            if (size > bestSize) {
+              best     = i;
+              bestSize = size;
+            }
+          }
+
+          if (best < 0)
+            break;
+
+          BuildRecord left, right;
+          split(children[best], median, left, right);
+          children[best]          = left;
+          children[numChildren++] = right;
+        }
+
+        // stays in place while other tasks append nodes
+        BVH::Node &node = nodes[nodeIndex];
+
+        int inner[BVH::WIDTH];
+        int numInner = 0;
+        for (int i = 0; i < numChildren; ++i) {
+          node.setChildBounds(i, children[i].bounds);
+          if (children[i].size() <= maxLeafSize) {
+            node.child[i] = uint32_t(children[i].begin);
+            node.count[i] = uint32_t(children[i].size());
+          } else {
+            node.child[i]     = uint32_t(nodes.push_back(BVH::Node()));
+            inner[numInner++] = i;
+          }
+        }
+
+        auto buildChild = [&](int k) {
+          const int i = inner[k];
+          buildNode(node.child[i], children[i], depth + 1);
+        };
+
+        if (parallel && numInner > 1 && r.size() >= BLOCK_SIZE)
+          tasking::parallel_for(numInner, buildChild);
+        else {
+          for (int k = 0; k < numInner; ++k)
+            buildChild(k);
+        }
+      }
+
+      void Builder::split(const BuildRecord &r,
+                          bool median,
+                          BuildRecord &left,
+                          BuildRecord &right)
+      {
+        if (!median) {
+          if (morton ? splitMorton(r, left, right) : splitSAH(r, left, right))
+            return;
+        }
+        splitMedian(r, left, right);
+      }
+
+      bool Builder::splitSAH(const BuildRecord &r,
+                             BuildRecord &left,
+                             BuildRecord &right)
+      {
+        const vec3f lower  = r.centroidBounds.lower;
+        const vec3f extent = r.centroidBounds.size();
+
+        vec3f scale;
+        for (int a = 0; a < 3; ++a) {
+          // slightly less than numBins, so the upper bound lands in the last
+          scale[a] = extent[a] > 0.f ? numBins * .99999f / extent[a] : 0.f;
+        }
+
+        if (scale.x == 0.f && scale.y == 0.f && scale.z == 0.f)
+          return false;  // all centroids in one place
+
+        auto binOf = [&](const vec3f &c, int a) {
+          return std::min(std::max(int((c[a] - lower[a]) * scale[a]), 0),
+                          numBins - 1);
+        };
+
+        auto binRange = [&](size_t begin, size_t end) {
+          Bins bins;
+          for (size_t i = begin; i < end; ++i) {
+            const uint32_t id = primIDs[i];
+            const vec3f &c    = centroids[id];
+            for (int a = 0; a < 3; ++a) {
+              const int b = binOf(c, a);
+              bins.bounds[a][b].extend(primBounds[id]);
+              bins.centroidBounds[a][b].extend(c);
+              bins.count[a][b]++;
+            }
+          }
+          return bins;
+        };
+
+        Bins bins;
+        if (parallel && r.size() >= 2 * BLOCK_SIZE) {
+          bins = tasking::parallel_reduce(
+              (r.size() + BLOCK_SIZE - 1) / BLOCK_SIZE,
+              Bins(),
+              [&](size_t b) {
+                const size_t first = r.begin + b * BLOCK_SIZE;
+                return binRange(first, std::min(r.end, first + BLOCK_SIZE));
+              },
+              [](const Bins &a, const Bins &b) {
+                Bins merged = a;
+                merged.merge(b);
+                return merged;
+              });
+        } else {
+          bins = binRange(r.begin, r.end);
+        }
+
+        // sweep from both sides, bins [0, pos) go left
+        float bestCost = std::numeric_limits<float>::infinity();
+        int bestAxis   = -1;
+        int bestPos    = 0;
+        for (int a = 0; a < 3; ++a) {
+          if (scale[a] == 0.f)
+            continue;
+
+          float leftCost[MAX_BINS];
+          uint32_t leftCount[MAX_BINS];
+          box3f acc(empty);
+          uint32_t count = 0;
+          for (int b = 0; b < numBins; ++b) {
+            acc.extend(bins.bounds[a][b]);
+            count += bins.count[a][b];
+            leftCount[b] = count;
+            leftCost[b]  = count ? halfArea(acc) * count : 0.f;
+          }
+
+          acc   = box3f(empty);
+          count = 0;
+          for (int b = numBins - 1; b > 0; --b) {
+            acc.extend(bins.bounds[a][b]);
+            count += bins.count[a][b];
+            if (count == 0 || leftCount[b - 1] == 0)
+              continue;
+            const float cost = leftCost[b - 1] + halfArea(acc) * count;
+            if (cost < bestCost) {
+              bestCost = cost;
+              bestAxis = a;
+              bestPos  = b;
+            }
+          }
+        }
+
+        if (bestAxis < 0)
+          return false;
+
+        const size_t mid =
+            std::partition(primIDs.begin() + r.begin,
+                           primIDs.begin() + r.end,
+                           [&](uint32_t id) {
+                             return binOf(centroids[id], bestAxis) < bestPos;
+                           })
+            - primIDs.begin();
+
+        left.begin  = r.begin;
+        left.end    = mid;
+        right.begin = mid;
+        right.end   = r.end;
+
+        left.bounds = left.centroidBounds = box3f(empty);
+        right.bounds = right.centroidBounds = box3f(empty);
+        for (int b = 0; b < numBins; ++b) {
+          BuildRecord &side = b < bestPos ? left : right;
+          side.bounds.extend(bins.bounds[bestAxis][b]);
+          side.centroidBounds.extend(bins.centroidBounds[bestAxis][b]);
+        }
+
+        return true;
+      }
+
+      bool Builder::splitMorton(const BuildRecord &r,
+                                BuildRecord &left,
+                                BuildRecord &right)
+      {
+        const uint32_t first = codes[r.begin];
+        const uint32_t last  = codes[r.end - 1];
+        if (first == last)
+          return false;
+
+        // the range shares all code bits above the highest differing one,
+        // so it is sorted into those with that bit clear and those with it
+        // set
+        uint32_t bit = first ^ last;
+        while (bit & (bit - 1))
+          bit &= bit - 1;
+
+        const size_t mid =
+            std::partition_point(codes.begin() + r.begin,
+                                 codes.begin() + r.end,
+                                 [&](uint32_t code) { return !(code & bit); })
+            - codes.begin();
+
+        left  = makeRecord(r.begin, mid);
+        right = makeRecord(mid, r.end);
+        return true;
+      }
+
+      void Builder::splitMedian(const BuildRecord &r,
+                                BuildRecord &left,
+                                BuildRecord &right)
+      {
+        const size_t mid = r.begin + r.size() / 2;
+
+        // Morton order is already spatially coherent, and the codes must
+        // stay in step with primIDs
+        if (!morton) {
+          const vec3f extent = r.centroidBounds.size();
+          const int axis     = extent.x >= extent.y
+                               ? (extent.x >= extent.z ? 0 : 2)
+                               : (extent.y >= extent.z ? 1 : 2);
+          std::nth_element(primIDs.begin() + r.begin,
+                           primIDs.begin() + mid,
+                           primIDs.begin() + r.end,
+                           [&](uint32_t a, uint32_t b) {
+                             return centroids[a][axis] < centroids[b][axis];
+                           });
+        }
+
+        left  = makeRecord(r.begin, mid);
+        right = makeRecord(mid, r.end);
+      }
+
+    }  // namespace
+
+    BVH::BVH(const box3f *primBounds,
+             size_t numPrimitives,
+             const BVHBuildSettings &settings)
+    {
+      build(primBounds, numPrimitives, settings);
+    }
+
+    void BVH::build(const box3f *primBounds,
+                    size_t numPrimitives,
+                    const BVHBuildSettings &settings)
+    {
+      if (numPrimitives >= size_t(INVALID)) {
+        throw std::runtime_error(
+            "rkcommon::math::BVH supports less than 2^32 - 1 primitives");
+      }
+
+      nodeArray.clear();
+      primIDArray.clear();
+      primBoundsArray.clear();
+
+      if (numPrimitives == 0)
+        return;
+
+      Builder builder(primBounds, numPrimitives, settings, primIDArray);
+      builder.build(nodeArray);
+
+      primBoundsArray.resize(numPrimitives);
+      refit(primBounds, settings.parallel);
+    }
+
+    void BVH::refit(const box3f *primBounds, bool parallel)
+    {
+      const size_t numPrims  = primIDArray.size();
+      const size_t numBlocks = (numPrims + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+      auto gather = [&](size_t b) {
+        const size_t end = std::min(numPrims, (b + 1) * BLOCK_SIZE);
+        for (size_t i = b * BLOCK_SIZE; i < end; ++i)
+          primBoundsArray[i] = primBounds[primIDArray[i]];
+      };
+
+      auto refitLeaves = [&](size_t b) {
+        const size_t end = std::min(nodeArray.size(), (b + 1) * BLOCK_SIZE);
+        for (size_t n = b * BLOCK_SIZE; n < end; ++n) {
+          Node &node = nodeArray[n];
+          for (int i = 0; i < WIDTH; ++i) {
+            if (node.count[i] == 0)
+              continue;
+            box3f leaf(math::empty);
+            for (uint32_t p = 0; p < node.count[i]; ++p)
+              leaf.extend(primBoundsArray[node.child[i] + p]);
+            node.setChildBounds(i, leaf);
+          }
+        }
+      };
+
+      const size_t numNodeBlocks =
+          (nodeArray.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+      if (parallel && numBlocks > 1) {
+        tasking::parallel_for(numBlocks, gather);
+        tasking::parallel_for(numNodeBlocks, refitLeaves);
+      } else {
+        for (size_t b = 0; b < numBlocks; ++b)
+          gather(b);
+        for (size_t b = 0; b < numNodeBlocks; ++b)
+          refitLeaves(b);
+      }
+
+      // children come after their parents, so a reverse sweep sees every
+      // child node refitted before its parent reads its bounds
+      for (size_t n = nodeArray.size(); n-- > 0;) {
+        Node &node = nodeArray[n];
+        for (int i = 0; i < WIDTH; ++i) {
+          if (node.child[i] != INVALID && node.count[i] == 0)
+            node.setChildBounds(i, nodeArray[node.child[i]].bounds());
+        }
+      }
+    }
+
+  }  // namespace math
+}  // namespace rkcommon
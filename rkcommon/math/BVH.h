@@ -0,0 +1,360 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "packet.h"
+#include "../containers/AlignedVector.h"
+#include "../tasking/parallel_for.h"
+// std
+#include <cstdint>
+#include <vector>
+
+namespace rkcommon {
+  namespace math {
+
+    struct BVHBuildSettings
+    {
+      // leaves hold at most this many primitives
+      int maxLeafSize{4};
+      // SAH bins per axis, at most 32
+      int numBins{16};
+      /* sort the primitives by the Morton codes of their centroids and
+         split at code boundaries instead of binning: builds several times
+         faster, e.g. for bounds which change every frame, at the price of
+         somewhat more nodes visited per query */
+      bool mortonPresort{false};
+      bool parallel{true};
+    };
+
+    /*! Bounding volume hierarchy over box3f primitives (instances, meshes,
+        bricks, ...) for picking and culling in logarithmic instead of
+        linear time:
+
+          BVH bvh(bounds.data(), bounds.size());
+
+          // everything overlapping a region
+          bvh.query(region, [&](uint32_t primID) {
+            visible.push_back(primID);
+          });
+
+          // closest primitive along a ray
+          range1f t(0.f, inf);
+          uint32_t hit = BVH::INVALID;
+          bvh.intersect(org, dir, t, [&](uint32_t primID, range1f &t) {
+            if (intersectPrimitive(primID, org, dir, t)) {  // shortens t
+              hit = primID;
+            }
+          });
+
+        The builder bins the primitive centroids into numBins slabs per axis
+        and splits at the lowest surface area heuristic (SAH) cost; large
+        subtrees are binned through tasking::parallel_reduce() and built
+        through tasking::parallel_for(). Nodes have WIDTH children whose
+        bounds are stored as SoA, so a ray or box is tested against all of
+        them with one packet test (see packet.h).
+
+        query() and intersect() report each primitive whose bounds
+        overlap the box or are entered by the ray within 'tRange'. The
+        batched versions run one query per array element, in parallel. */
+    class RKCOMMON_INTERFACE BVH
+    {
+     public:
+      static constexpr int WIDTH = 4;
+
+      // subtrees are never deeper than this many nodes
+      static constexpr int MAX_DEPTH = 64;
+
+      static constexpr uint32_t INVALID = uint32_t(-1);
+
+      /* WIDTH children in two cache lines. A child is an inner node
+         (child[i] indexes nodes(), count[i] == 0), a leaf (count[i]
+         primitives from primIDs()[child[i]] on) or unused (child[i] ==
+         INVALID). Children always come after their parent in nodes(). */
+      struct alignas(64) Node
+      {
+        Node();
+
+        box3vf<WIDTH> childBounds() const;
+        box3f childBounds(int i) const;
+        void setChildBounds(int i, const box3f &b);
+
+        // union of the bounds of all used children
+        box3f bounds() const;
+
+        float lower[3][WIDTH];
+        float upper[3][WIDTH];
+        uint32_t child[WIDTH];
+        uint32_t count[WIDTH];
+      };
+
+      BVH() = default;
+      BVH(const box3f *primBounds,
+          size_t numPrimitives,
+          const BVHBuildSettings &settings = BVHBuildSettings());
+
+      void build(const box3f *primBounds,
+                 size_t numPrimitives,
+                 const BVHBuildSettings &settings = BVHBuildSettings());
+
+      /* Update all bounds for moved primitives, keeping the tree: much
+         cheaper than a rebuild, but queries slow down the further the
+         primitives move from where they were during build(). */
+      void refit(const box3f *primBounds, bool parallel = true);
+
+      // Calls 'fcn(primID)' for each primitive overlapping 'box'
+      template <typename FCN_T>
+      void query(const box3f &box, FCN_T &&fcn) const;
+
+      /* Calls 'fcn(primID, tRange)' for each primitive whose bounds the ray
+         enters within 'tRange', nearest nodes first. 'fcn' may shorten
+         'tRange.upper' when it finds a hit, which culls everything behind
+         it. */
+      template <typename FCN_T>
+      void intersect(const vec3f &org,
+                     const vec3f &dir,
+                     range1f &tRange,
+                     FCN_T &&fcn) const;
+
+      // Batched queries: 'fcn(queryIndex, primID)'
+      template <typename FCN_T>
+      void query(const box3f *boxes, size_t n, FCN_T &&fcn) const;
+
+      // Batched rays: 'fcn(rayIndex, primID, tRanges[rayIndex])'
+      template <typename FCN_T>
+      void intersect(const vec3f *orgs,
+                     const vec3f *dirs,
+                     range1f *tRanges,
+                     size_t n,
+                     FCN_T &&fcn) const;
+
+      bool empty() const;
+      size_t numPrimitives() const;
+      size_t numNodes() const;
+
+      box3f bounds() const;
+
+      const containers::AlignedVector<Node> &nodes() const;
+
+      // primitive IDs in leaf order
+      const std::vector<uint32_t> &primIDs() const;
+
+     private:
+      containers::AlignedVector<Node> nodeArray;
+      std::vector<uint32_t> primIDArray;
+      // bounds of the primitives in leaf order, for the final tests
+      std::vector<box3f> primBoundsArray;
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    inline BVH::Node::Node()
+    {
+      for (int i = 0; i < WIDTH; ++i) {
+        setChildBounds(i, box3f(math::empty));
+        child[i] = INVALID;
+        count[i] = 0;
+      }
+    }
+
+    inline box3vf<BVH::WIDTH> BVH::Node::childBounds() const
+    {
+      using vf = vfloat<WIDTH>;
+      return box3vf<WIDTH>(
+          vec3vf<WIDTH>(
+              vf::load(lower[0]), vf::load(lower[1]), vf::load(lower[2])),
+          vec3vf<WIDTH>(
+              vf::load(upper[0]), vf::load(upper[1]), vf::load(upper[2])));
+    }
+
+    inline box3f BVH::Node::childBounds(int i) const
+    {
+      return box3f(vec3f(lower[0][i], lower[1][i], lower[2][i]),
+                   vec3f(upper[0][i], upper[1][i], upper[2][i]));
+    }
+
+    inline void BVH::Node::setChildBounds(int i, const box3f &b)
+    {
+      for (int k = 0; k < 3; ++k) {
+        lower[k][i] = b.lower[k];
+        upper[k][i] = b.upper[k];
+      }
+    }
+
+    inline box3f BVH::Node::bounds() const
+    {
+      box3f b(math::empty);
+      for (int i = 0; i < WIDTH; ++i) {
+        if (child[i] != INVALID)
+          b.extend(childBounds(i));
+      }
+      return b;
+    }
+
+    template <typename FCN_T>
+    inline void BVH::query(const box3f &box, FCN_T &&fcn) const
+    {
+      if (nodeArray.empty())
+        return;
+
+      const box3vf<WIDTH> queryBox(vec3vf<WIDTH>(box.lower),
+                                   vec3vf<WIDTH>(box.upper));
+
+      // each node visited pushes at most WIDTH - 1 more than it pops
+      uint32_t stack[MAX_DEPTH * (WIDTH - 1) + 1];
+      int top      = 0;
+      stack[top++] = 0;
+
+      while (top > 0) {
+        const Node &node = nodeArray[stack[--top]];
+        const uint32_t hits =
+            movemask(touchingOrOverlapping(node.childBounds(), queryBox));
+
+        for (uint32_t bits = hits; bits; bits &= bits - 1) {
+          int i = 0;
+          while (!(bits & (1u << i)))
+            ++i;
+
+          if (node.child[i] == INVALID)
+            continue;
+
+          if (node.count[i] == 0) {
+            stack[top++] = node.child[i];
+            continue;
+          }
+
+          const uint32_t end = node.child[i] + node.count[i];
+          for (uint32_t p = node.child[i]; p < end; ++p) {
+            if (touchingOrOverlapping(primBoundsArray[p], box))
+              fcn(primIDArray[p]);
+          }
+        }
+      }
+    }
+
+    template <typename FCN_T>
+    inline void BVH::intersect(const vec3f &org,
+                               const vec3f &dir,
+                               range1f &tRange,
+                               FCN_T &&fcn) const
+    {
+      if (nodeArray.empty())
+        return;
+
+      const RayInvDir3f ray(org, dir);
+
+      struct Entry
+      {
+        uint32_t child;
+        uint32_t count;
+        float tNear;
+      };
+
+      Entry stack[MAX_DEPTH * (WIDTH - 1) + 1];
+      int top      = 0;
+      stack[top++] = {0, 0, tRange.lower};
+
+      while (top > 0) {
+        const Entry e = stack[--top];
+        if (e.tNear > tRange.upper)
+          continue;  // behind a hit found since it was pushed
+
+        if (e.count != 0) {
+          for (uint32_t p = e.child; p < e.child + e.count; ++p) {
+            if (!intersectRayBox(ray, primBoundsArray[p], tRange).empty())
+              fcn(primIDArray[p], tRange);
+          }
+          continue;
+        }
+
+        const Node &node = nodeArray[e.child];
+        const RayBoxHit<WIDTH> hit =
+            intersectRayBox(ray, node.childBounds(), tRange);
+
+        // sorted far to near, so the nearest child is popped first
+        Entry hits[WIDTH];
+        int numHits = 0;
+        for (uint32_t bits = movemask(hit.hit); bits; bits &= bits - 1) {
+          int i = 0;
+          while (!(bits & (1u << i)))
+            ++i;
+
+          if (node.child[i] == INVALID)
+            continue;
+
+          const Entry c = {node.child[i], node.count[i], hit.t.lower[i]};
+          int k         = numHits++;
+          for (; k > 0 && hits[k - 1].tNear < c.tNear; --k)
+            hits[k] = hits[k - 1];
+          hits[k] = c;
+        }
+
+        for (int k = 0; k < numHits; ++k)
+          stack[top++] = hits[k];
+      }
+    }
+
+    template <typename FCN_T>
+    inline void BVH::query(const box3f *boxes, size_t n, FCN_T &&fcn) const
+    {
+      constexpr size_t BLOCK_SIZE = 64;
+      tasking::parallel_for((n + BLOCK_SIZE - 1) / BLOCK_SIZE, [&](size_t b) {
+        const size_t end = std::min(n, (b + 1) * BLOCK_SIZE);
+        for (size_t i = b * BLOCK_SIZE; i < end; ++i)
+          query(boxes[i], [&](uint32_t primID) { fcn(i, primID); });
+      });
+    }
+
+    template <typename FCN_T>
+    inline void BVH::intersect(const vec3f *orgs,
+                               const vec3f *dirs,
+                               range1f *tRanges,
+                               size_t n,
+                               FCN_T &&fcn) const
+    {
+      constexpr size_t BLOCK_SIZE = 64;
+      tasking::parallel_for((n + BLOCK_SIZE - 1) / BLOCK_SIZE, [&](size_t b) {
+        const size_t end = std::min(n, (b + 1) * BLOCK_SIZE);
+        for (size_t i = b * BLOCK_SIZE; i < end; ++i) {
+          intersect(orgs[i],
+                    dirs[i],
+                    tRanges[i],
+                    [&](uint32_t primID, range1f &tRange) {
+                      fcn(i, primID, tRange);
+                    });
+        }
+      });
+    }
+
+    inline bool BVH::empty() const
+    {
+      return nodeArray.empty();
+    }
+
+    inline size_t BVH::numPrimitives() const
+    {
+      return primIDArray.size();
+    }
+
+    inline size_t BVH::numNodes() const
+    {
+      return nodeArray.size();
+    }
+
+    inline box3f BVH::bounds() const
+    {
+      return nodeArray.empty() ? box3f(math::empty) : nodeArray[0].bounds();
+    }
+
+    inline const containers::AlignedVector<BVH::Node> &BVH::nodes() const
+    {
+      return nodeArray;
+    }
+
+    inline const std::vector<uint32_t> &BVH::primIDs() const
+    {
+      return primIDArray;
+    }
+
+  }  // namespace math
+}  // namespace rkcommon
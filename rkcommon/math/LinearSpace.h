@@ -324,7 +324,7 @@ namespace rkcommon {
       }
 
       /*! compute the determinant of the matrix */
-      inline const Scalar det() const
+      inline Scalar det() const
       {
         return dot(vx, cross(vy, vz));
       }
@@ -434,6 +434,14 @@ namespace rkcommon {
       return a.inverse();
     }
 
+    /* inverse of an orthonormal matrix, e.g. a pure rotation, which is just
+       its transpose */
+    template <typename T>
+    inline LinearSpace3<T> rcpOrthonormal(const LinearSpace3<T> &a)
+    {
+      return a.transposed();
+    }
+
     /* constructs a coordinate frame from a normalized normal */
     template <typename T>
     inline LinearSpace3<T> frame(const T &N)
@@ -578,5 +586,103 @@ namespace rkcommon {
     using linear2f = LinearSpace2f;
     using linear3f = LinearSpace3f;
 
+#ifndef RKCOMMON_NO_SIMD
+    namespace detail {
+
+      // columns of 'm' in SSE registers, lane 3 is unused
+      __forceinline void loadColumns(const LinearSpace3fa &m,
+                                     __m128 &c0,
+                                     __m128 &c1,
+                                     __m128 &c2)
+      {
+        c0 = load4(m.vx);
+        c1 = load4(m.vy);
+        c2 = load4(m.vz);
+      }
+
+      __forceinline void loadColumns(const LinearSpace3f &m,
+                                     __m128 &c0,
+                                     __m128 &c1,
+                                     __m128 &c2)
+      {
+        static_assert(sizeof(LinearSpace3f) == 9 * sizeof(float),
+                      "LinearSpace3f columns must be contiguous");
+        // the last column is loaded from vy.z on to stay inside of 'm'
+        c0             = _mm_loadu_ps(&m.vx.x);
+        c1             = _mm_loadu_ps(&m.vy.x);
+        const __m128 t = _mm_loadu_ps(&m.vy.z);
+        c2             = _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 3, 2, 1));
+      }
+
+      __forceinline LinearSpace3fa storeColumns3fa(__m128 c0,
+                                                   __m128 c1,
+                                                   __m128 c2)
+      {
+        return LinearSpace3fa(store3fa(c0), store3fa(c1), store3fa(c2));
+      }
+
+      __forceinline LinearSpace3f storeColumns3f(__m128 c0,
+                                                 __m128 c1,
+                                                 __m128 c2)
+      {
+        return LinearSpace3f(store3f(c0), store3f(c1), store3f(c2));
+      }
+
+      // cross(a, b) with the operations of the scalar code
+      __forceinline __m128 cross4(__m128 a, __m128 b)
+      {
+        const __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 a_zxy = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+        const __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 b_zxy = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+        return _mm_sub_ps(_mm_mul_ps(a_yzx, b_zxy), _mm_mul_ps(a_zxy, b_yzx));
+      }
+
+    }  // namespace detail
+
+    /* det(), inverse() and transposed() of the single precision spaces with
+       the columns in SSE registers; the cofactors are cross products of
+       the columns, so inverse() needs a single division by det() */
+
+    // clang-format off
+#define linear3_simd_members(type, store)                                    \
+  template <>                                                                \
+  inline float type::det() const                                             \
+  {                                                                          \
+    __m128 c0, c1, c2;                                                       \
+    detail::loadColumns(*this, c0, c1, c2);                                  \
+    return detail::sum3(_mm_mul_ps(c0, detail::cross4(c1, c2)));             \
+  }                                                                          \
+                                                                             \
+  template <>                                                                \
+  inline const type type::transposed() const                                 \
+  {                                                                          \
+    __m128 c0, c1, c2, c3 = _mm_setzero_ps();                                \
+    detail::loadColumns(*this, c0, c1, c2);                                  \
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);                                       \
+    return detail::store(c0, c1, c2);                                        \
+  }                                                                          \
+                                                                             \
+  template <>                                                                \
+  inline const type type::inverse() const                                    \
+  {                                                                          \
+    __m128 c0, c1, c2;                                                       \
+    detail::loadColumns(*this, c0, c1, c2);                                  \
+    __m128 r0 = detail::cross4(c1, c2);                                      \
+    __m128 r1 = detail::cross4(c2, c0);                                      \
+    __m128 r2 = detail::cross4(c0, c1);                                      \
+    __m128 r3 = _mm_setzero_ps();                                            \
+    const __m128 d = _mm_set1_ps(detail::sum3(_mm_mul_ps(c0, r0)));          \
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);                                       \
+    return detail::store(                                                    \
+        _mm_div_ps(r0, d), _mm_div_ps(r1, d), _mm_div_ps(r2, d));            \
+  }
+
+    linear3_simd_members(LinearSpace3f, storeColumns3f)
+    linear3_simd_members(LinearSpace3fa, storeColumns3fa)
+#undef linear3_simd_members
+    // clang-format on
+#endif
+
   }  // namespace math
 }  // namespace rkcommon
@@ -351,6 +351,16 @@ namespace rkcommon {
       return fa * a + fb * b;
     }
 
+    template <typename T>
+    // a, b must be normalized; cheaper than slerp() but not constant speed
+    inline QuaternionT<T> nlerp(const float factor,
+                                const QuaternionT<T> &_a,
+                                const QuaternionT<T> &b)
+    {
+      const QuaternionT<T> a = dot(_a, b) < 0. ? -_a : _a;
+      return normalize(rkcommon::math::lerp(factor, a, b));
+    }
+
     using quaternionf = QuaternionT<float>;
     using quatf = QuaternionT<float>;
     using quaterniond = QuaternionT<double>;
@@ -0,0 +1,355 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "bounds.h"
+#include "dispatch.h"
+#include "../tasking/parallel_reduce.h"
+#include "packet.h"
+
+namespace rkcommon {
+  namespace math {
+
+    static constexpr int W = NATIVE_PACKET_WIDTH < 4 ? 4 : NATIVE_PACKET_WIDTH;
+
+    static_assert(sizeof(vec3f) == 3 * sizeof(float),
+                  "computeBounds() streams vec3f arrays as floats");
+    static_assert(sizeof(box3f) == 6 * sizeof(float),
+                  "computeBounds() streams box3f arrays as floats");
+
+    // elements per parallel task
+    static constexpr size_t BOUNDS_CHUNK_SIZE = 16 * 1024;
+
+    namespace {
+
+      struct BoundsPair
+      {
+        box3f bounds;
+        box3f centroidBounds;
+      };
+
+    }  // namespace
+
+    /* Contiguous arrays are streamed as floats without any shuffling: 3
+       packets cover W points (or W/2 boxes), so lane l of packet k always
+       holds component (k * W + l) % 3 (or % 6 for boxes). The lanes are
+       sorted into components once at the end. */
+
+    static box3f streamPointBounds(const vec3f *points, size_t n)
+    {
+      if (n == 0)
+        return box3f(empty);
+
+      const float *f = &points[0].x;
+
+      vfloat<W> lo[3], hi[3];
+      for (int k = 0; k < 3; ++k) {
+        lo[k] = vfloat<W>(float(pos_inf));
+        hi[k] = vfloat<W>(float(neg_inf));
+      }
+
+      size_t i = 0;
+      for (; i + W <= n; i += W) {
+        for (int k = 0; k < 3; ++k) {
+          const vfloat<W> v = vfloat<W>::loadu(f + 3 * i + k * W);
+          lo[k]             = min(lo[k], v);
+          hi[k]             = max(hi[k], v);
+        }
+      }
+
+      box3f bounds(empty);
+      for (int k = 0; k < 3; ++k) {
+        for (int l = 0; l < W; ++l) {
+          const int c     = (k * W + l) % 3;
+          bounds.lower[c] = std::min(bounds.lower[c], lo[k][l]);
+          bounds.upper[c] = std::max(bounds.upper[c], hi[k][l]);
+        }
+      }
+
+      for (; i < n; ++i)
+        bounds.extend(points[i]);
+
+      return bounds;
+    }
+
+    template <bool CENTROIDS>
+    static BoundsPair streamBoxBounds(const box3f *boxes, size_t n)
+    {
+      static_assert(W % 2 == 0, "packets must hold whole boxes");
+      constexpr size_t BOXES_PER_STEP = W / 2;
+
+      if (n == 0)
+        return BoundsPair();
+
+      const float *f = &boxes[0].lower.x;
+
+      // lane-wise lower+upper sums live in the lanes of lower components
+      vfloat<W> lo[3], hi[3], centerLo[3], centerHi[3];
+      for (int k = 0; k < 3; ++k) {
+        lo[k] = centerLo[k] = vfloat<W>(float(pos_inf));
+        hi[k] = centerHi[k] = vfloat<W>(float(neg_inf));
+      }
+
+      // the centroid loads read 3 floats past each step, so the last box
+      // is always left to the scalar tail
+      size_t i = 0;
+      for (; i + BOXES_PER_STEP < n; i += BOXES_PER_STEP) {
+        for (int k = 0; k < 3; ++k) {
+          const float *p    = f + 6 * i + k * W;
+          const vfloat<W> v = vfloat<W>::loadu(p);
+          lo[k]             = min(lo[k], v);
+          hi[k]             = max(hi[k], v);
+          if (CENTROIDS) {
+            const vfloat<W> sum = v + vfloat<W>::loadu(p + 3);
+            centerLo[k]         = min(centerLo[k], sum);
+            centerHi[k]         = max(centerHi[k], sum);
+          }
+        }
+      }
+
+      BoundsPair result;
+      for (int k = 0; k < 3; ++k) {
+        for (int l = 0; l < W; ++l) {
+          const int c = (k * W + l) % 6;
+          box3f &b = result.bounds;
+          if (c < 3) {
+            b.lower[c] = std::min(b.lower[c], lo[k][l]);
+            if (CENTROIDS) {
+              box3f &cb   = result.centroidBounds;
+              cb.lower[c] = std::min(cb.lower[c], .5f * centerLo[k][l]);
+              cb.upper[c] = std::max(cb.upper[c], .5f * centerHi[k][l]);
+            }
+          } else {
+            b.upper[c - 3] = std::max(b.upper[c - 3], hi[k][l]);
+          }
+        }
+      }
+
+      for (; i < n; ++i) {
+        result.bounds.extend(boxes[i]);
+        if (CENTROIDS)
+          result.centroidBounds.extend(boxes[i].center());
+      }
+
+      return result;
+    }
+
+    // Strided input is gathered into SoA packets instead
+
+    static box3f gatherPointBounds(const utility::DataView<vec3f> &points,
+                                   size_t begin,
+                                   size_t end)
+    {
+      box3vf<W> packetBounds(empty);
+
+      size_t i = begin;
+      for (; i + W <= end; i += W) {
+        vec3vf<W> p;
+        for (int l = 0; l < W; ++l) {
+          const vec3f &v = points[i + l];
+          p.x[l]         = v.x;
+          p.y[l]         = v.y;
+          p.z[l]         = v.z;
+        }
+        packetBounds.extend(p);
+      }
+
+      box3f bounds = reduce_bounds(packetBounds);
+      for (; i < end; ++i)
+        bounds.extend(points[i]);
+      return bounds;
+    }
+
+    template <bool CENTROIDS>
+    static BoundsPair gatherBoxBounds(const utility::DataView<box3f> &boxes,
+                                      size_t begin,
+                                      size_t end)
+    {
+      box3vf<W> packetBounds(empty);
+      box3vf<W> packetCentroidBounds(empty);
+
+      size_t i = begin;
+      for (; i + W <= end; i += W) {
+        box3vf<W> b;
+        for (int l = 0; l < W; ++l) {
+          const box3f &v = boxes[i + l];
+          b.lower.x[l]   = v.lower.x;
+          b.lower.y[l]   = v.lower.y;
+          b.lower.z[l]   = v.lower.z;
+          b.upper.x[l]   = v.upper.x;
+          b.upper.y[l]   = v.upper.y;
+          b.upper.z[l]   = v.upper.z;
+        }
+        packetBounds.extend(b);
+        if (CENTROIDS)
+          packetCentroidBounds.extend(b.center());
+      }
+
+      BoundsPair result;
+      result.bounds = reduce_bounds(packetBounds);
+      if (CENTROIDS)
+        result.centroidBounds = reduce_bounds(packetCentroidBounds);
+
+      for (; i < end; ++i) {
+        result.bounds.extend(boxes[i]);
+        if (CENTROIDS)
+          result.centroidBounds.extend(boxes[i].center());
+      }
+
+      return result;
+    }
+
+    // calls 'fcn(begin, end)' on chunks of [0,n), merging the BoundsPairs
+    template <typename FCN_T>
+    static BoundsPair reduceChunks(size_t n, bool parallel, FCN_T &&fcn)
+    {
+      if (!parallel || n < BOUNDS_PARALLEL_THRESHOLD)
+        return fcn(size_t(0), n);
+
+      return tasking::parallel_reduce(
+          divRoundUp(n, BOUNDS_CHUNK_SIZE),
+          BoundsPair(),
+          [&](size_t chunk) {
+            const size_t begin = chunk * BOUNDS_CHUNK_SIZE;
+            return fcn(begin, std::min(n, begin + BOUNDS_CHUNK_SIZE));
+          },
+          [](BoundsPair a, const BoundsPair &b) {
+            a.bounds.extend(b.bounds);
+            a.centroidBounds.extend(b.centroidBounds);
+            return a;
+          });
+    }
+
+    template <typename FCN_T>
+    static BoundsPair reduceBoxChunks(size_t n,
+                                      box3f *centroidBounds,
+                                      bool parallel,
+                                      FCN_T &&fcn)
+    {
+      BoundsPair result = reduceChunks(n, parallel, fcn);
+      if (centroidBounds)
+        *centroidBounds = result.centroidBounds;
+      return result;
+    }
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      box3f computeBounds(const vec3f *points, size_t n, bool parallel)
+      {
+        return reduceChunks(n, parallel, [&](size_t begin, size_t end) {
+                 BoundsPair r;
+                 r.bounds = streamPointBounds(points + begin, end - begin);
+                 return r;
+               })
+            .bounds;
+      }
+
+      box3f computeBounds(const utility::DataView<vec3f> &points,
+                          size_t n,
+                          bool parallel)
+      {
+        return reduceChunks(n, parallel, [&](size_t begin, size_t end) {
+                 BoundsPair r;
+                 r.bounds = gatherPointBounds(points, begin, end);
+                 return r;
+               })
+            .bounds;
+      }
+
+      box3f computeBounds(const box3f *boxes,
+                          size_t n,
+                          box3f *centroidBounds,
+                          bool parallel)
+      {
+        return reduceBoxChunks(
+                   n,
+                   centroidBounds,
+                   parallel,
+                   [&](size_t begin, size_t end) {
+                     return centroidBounds
+                                ? streamBoxBounds<true>(boxes + begin,
+                                                        end - begin)
+                                : streamBoxBounds<false>(boxes + begin,
+                                                         end - begin);
+                   })
+            .bounds;
+      }
+
+      box3f computeBounds(const utility::DataView<box3f> &boxes,
+                          size_t n,
+                          box3f *centroidBounds,
+                          bool parallel)
+      {
+        return reduceBoxChunks(n,
+                               centroidBounds,
+                               parallel,
+                               [&](size_t begin, size_t end) {
+                                 return centroidBounds
+                                            ? gatherBoxBounds<true>(
+                                                  boxes, begin, end)
+                                            : gatherBoxBounds<false>(
+                                                  boxes, begin, end);
+                               })
+            .bounds;
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // bounds.h definitions ////////////////////////////////////////////////////
+
+    using PointBoundsFcn = box3f(const vec3f *, size_t, bool);
+    using PointViewBoundsFcn = box3f(const utility::DataView<vec3f> &,
+                                     size_t,
+                                     bool);
+    using BoxBoundsFcn = box3f(const box3f *, size_t, box3f *, bool);
+    using BoxViewBoundsFcn = box3f(const utility::DataView<box3f> &,
+                                   size_t,
+                                   box3f *,
+                                   bool);
+
+    RKCOMMON_ISA_DECLARE(PointBoundsFcn computeBounds)
+    RKCOMMON_ISA_DECLARE(PointViewBoundsFcn computeBounds)
+    RKCOMMON_ISA_DECLARE(BoxBoundsFcn computeBounds)
+    RKCOMMON_ISA_DECLARE(BoxViewBoundsFcn computeBounds)
+
+    box3f computeBounds(const vec3f *points, size_t n, bool parallel)
+    {
+      static PointBoundsFcn *const fcn =
+          RKCOMMON_ISA_SELECT(PointBoundsFcn, computeBounds);
+      return fcn(points, n, parallel);
+    }
+
+    box3f computeBounds(const utility::DataView<vec3f> &points,
+                        size_t n,
+                        bool parallel)
+    {
+      static PointViewBoundsFcn *const fcn =
+          RKCOMMON_ISA_SELECT(PointViewBoundsFcn, computeBounds);
+      return fcn(points, n, parallel);
+    }
+
+    box3f computeBounds(const box3f *boxes,
+                        size_t n,
+                        box3f *centroidBounds,
+                        bool parallel)
+    {
+      static BoxBoundsFcn *const fcn =
+          RKCOMMON_ISA_SELECT(BoxBoundsFcn, computeBounds);
+      return fcn(boxes, n, centroidBounds, parallel);
+    }
+
+    box3f computeBounds(const utility::DataView<box3f> &boxes,
+                        size_t n,
+                        box3f *centroidBounds,
+                        bool parallel)
+    {
+      static BoxViewBoundsFcn *const fcn =
+          RKCOMMON_ISA_SELECT(BoxViewBoundsFcn, computeBounds);
+      return fcn(boxes, n, centroidBounds, parallel);
+    }
+#endif
+
+  }  // namespace math
+}  // namespace rkcommon
@@ -0,0 +1,44 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "box.h"
+#include "../utility/DataView.h"
+
+namespace rkcommon {
+  namespace math {
+
+    /* Bounds of 'n' points or boxes. The min/max run a SIMD packet at a
+       time (see packet.h), and with 'parallel' arrays of at least
+       BOUNDS_PARALLEL_THRESHOLD elements are reduced in chunks through
+       tasking::parallel_reduce(). The result is the same as a loop of
+       box3f::extend(), and is empty for n == 0.
+
+       For boxes, 'centroidBounds' optionally receives the bounds of their
+       center() points from the same pass, as needed by BVH builders. */
+
+    constexpr size_t BOUNDS_PARALLEL_THRESHOLD = 64 * 1024;
+
+    RKCOMMON_INTERFACE box3f computeBounds(const vec3f *points,
+                                           size_t n,
+                                           bool parallel = true);
+
+    RKCOMMON_INTERFACE box3f
+    computeBounds(const utility::DataView<vec3f> &points,
+                  size_t n,
+                  bool parallel = true);
+
+    RKCOMMON_INTERFACE box3f computeBounds(const box3f *boxes,
+                                           size_t n,
+                                           box3f *centroidBounds = nullptr,
+                                           bool parallel         = true);
+
+    RKCOMMON_INTERFACE box3f
+    computeBounds(const utility::DataView<box3f> &boxes,
+                  size_t n,
+                  box3f *centroidBounds = nullptr,
+                  bool parallel         = true);
+
+  }  // namespace math
+}  // namespace rkcommon
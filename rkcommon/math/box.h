@@ -17,13 +17,13 @@ namespace rkcommon {
     // box free functions /////////////////////////////////////////////////////
 
     template <typename scalar_t>
-    inline scalar_t area(const box_t<scalar_t, 2> &b)
+    constexpr scalar_t area(const box_t<scalar_t, 2> &b)
     {
       return b.size().product();
     }
 
     template <typename scalar_t, bool A>
-    inline scalar_t area(const box_t<scalar_t, 3, A> &b)
+    constexpr scalar_t area(const box_t<scalar_t, 3, A> &b)
     {
       const auto size = b.size();
       return 2.f * (size.x * size.y + size.x * size.z + size.y * size.z);
@@ -31,7 +31,7 @@ namespace rkcommon {
 
     /*! return the volume of the 3D box - undefined for empty boxes */
     template <typename scalar_t, bool A>
-    inline scalar_t volume(const box_t<scalar_t, 3, A> &b)
+    constexpr scalar_t volume(const box_t<scalar_t, 3, A> &b)
     {
       return b.size().product();
     }
@@ -41,78 +41,83 @@ namespace rkcommon {
         they do not have any actual overlapping _volume_!) then this is
         still true */
     template <typename scalar_t, bool A>
-    inline bool touchingOrOverlapping(const box_t<scalar_t, 3, A> &a,
-                                      const box_t<scalar_t, 3, A> &b)
+    constexpr bool touchingOrOverlapping(const box_t<scalar_t, 3, A> &a,
+                                         const box_t<scalar_t, 3, A> &b)
     {
-      if (a.lower.x > b.upper.x)
-        return false;
-      if (a.lower.y > b.upper.y)
-        return false;
-      if (a.lower.z > b.upper.z)
-        return false;
-
-      if (b.lower.x > a.upper.x)
-        return false;
-      if (b.lower.y > a.upper.y)
-        return false;
-      if (b.lower.z > a.upper.z)
-        return false;
-
-      return true;
+      return !(a.lower.x > b.upper.x || a.lower.y > b.upper.y ||
+               a.lower.z > b.upper.z || b.lower.x > a.upper.x ||
+               b.lower.y > a.upper.y || b.lower.z > a.upper.z);
     }
 
     template <typename scalar_t, bool A>
-    inline bool touchingOrOverlapping(const box_t<scalar_t, 2, A> &a,
-                                      const box_t<scalar_t, 2, A> &b)
+    constexpr bool touchingOrOverlapping(const box_t<scalar_t, 2, A> &a,
+                                         const box_t<scalar_t, 2, A> &b)
     {
-      if (a.lower.x > b.upper.x)
-        return false;
-      if (a.lower.y > b.upper.y)
-        return false;
-
-      if (b.lower.x > a.upper.x)
-        return false;
-      if (b.lower.y > a.upper.y)
-        return false;
-
-      return true;
+      return !(a.lower.x > b.upper.x || a.lower.y > b.upper.y ||
+               b.lower.x > a.upper.x || b.lower.y > a.upper.y);
     }
 
     /*! compute the intersection of two boxes */
     template <typename T, int N, bool A>
-    inline box_t<T, N, A> intersectionOf(const box_t<T, N, A> &a,
-                                         const box_t<T, N, A> &b)
+    constexpr box_t<T, N, A> intersectionOf(const box_t<T, N, A> &a,
+                                            const box_t<T, N, A> &b)
     {
       return box_t<T, N, A>(max(a.lower, b.lower), min(a.upper, b.upper));
     }
 
     template <typename T, int N, bool A>
-    inline bool disjoint(const box_t<T, N, A> &a, const box_t<T, N, A> &b)
+    constexpr bool disjoint(const box_t<T, N, A> &a, const box_t<T, N, A> &b)
     {
       return anyLessThan(a.upper, b.lower) || anyLessThan(b.upper, a.lower);
     }
 
     /*! returns the center of the box (not valid for empty boxes) */
     template <typename T, int N, bool A>
-    inline vec_t<T, N, A> center(const box_t<T, N, A> &b)
+    constexpr vec_t<T, N, A> center(const box_t<T, N, A> &b)
     {
       return b.center();
     }
 
+    /*! ray origin and reciprocal direction, computed once per ray for
+        repeated slab tests with intersectRayBox() */
+    template <typename T, int N>
+    struct RayInvDir
+    {
+      RayInvDir() = default;
+      RayInvDir(const vec_t<T, N> &org, const vec_t<T, N> &dir)
+          : org(org), rdir(rcp_safe(dir))
+      {
+      }
+
+      vec_t<T, N> org;
+      vec_t<T, N> rdir;
+    };
+
+    /*! entry/exit distances of the ray in the box, clipped to 'tRange';
+        the result is empty if the ray misses the box */
     template <typename T, int N>
     inline range_t<T> intersectRayBox(
-        const vec_t<T, N> &org,
-        const vec_t<T, N> &dir,
+        const RayInvDir<T, N> &ray,
         const box_t<T, N> &box,
         const range_t<T> &tRange = range_t<T>(0, inf))
     {
-      const auto mins = (box.lower - org) * rcp_safe(dir);
-      const auto maxs = (box.upper - org) * rcp_safe(dir);
+      const auto mins = (box.lower - ray.org) * ray.rdir;
+      const auto maxs = (box.upper - ray.org) * ray.rdir;
       return range_t<T>(
           reduce_max(vec_t<T, N + 1>(min(mins, maxs), tRange.lower)),
           reduce_min(vec_t<T, N + 1>(max(mins, maxs), tRange.upper)));
     }
 
+    template <typename T, int N>
+    inline range_t<T> intersectRayBox(
+        const vec_t<T, N> &org,
+        const vec_t<T, N> &dir,
+        const box_t<T, N> &box,
+        const range_t<T> &tRange = range_t<T>(0, inf))
+    {
+      return intersectRayBox(RayInvDir<T, N>(org, dir), box, tRange);
+    }
+
     using box1i  = range_t<int32_t>;
     using box2i  = box_t<int32_t, 2>;
     using box3i  = box_t<int32_t, 3>;
@@ -123,6 +128,8 @@ namespace rkcommon {
     using box4f  = box_t<float, 4>;
     using box3fa = box_t<float, 3, 1>;
 
+    using RayInvDir3f = RayInvDir<float, 3>;
+
     // this is just a renaming - in some cases the code reads cleaner if
     // we're talking about 'regions' than about boxes
     using region2i = box2i;
@@ -19,51 +19,51 @@ namespace rkcommon {
 
     static struct ZeroTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return 0;
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return 0;
       }
-      __forceinline operator long long() const
+      __forceinline constexpr operator long long() const
       {
         return 0;
       }
-      __forceinline operator unsigned long long() const
+      __forceinline constexpr operator unsigned long long() const
       {
         return 0;
       }
-      __forceinline operator long() const
+      __forceinline constexpr operator long() const
       {
         return 0;
       }
-      __forceinline operator unsigned long() const
+      __forceinline constexpr operator unsigned long() const
       {
         return 0;
       }
-      __forceinline operator int() const
+      __forceinline constexpr operator int() const
       {
         return 0;
       }
-      __forceinline operator unsigned int() const
+      __forceinline constexpr operator unsigned int() const
       {
         return 0;
       }
-      __forceinline operator short() const
+      __forceinline constexpr operator short() const
       {
         return 0;
       }
-      __forceinline operator unsigned short() const
+      __forceinline constexpr operator unsigned short() const
       {
         return 0;
       }
-      __forceinline operator char() const
+      __forceinline constexpr operator char() const
       {
         return 0;
       }
-      __forceinline operator unsigned char() const
+      __forceinline constexpr operator unsigned char() const
       {
         return 0;
       }
@@ -71,51 +71,51 @@ namespace rkcommon {
 
     static struct OneTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return 1;
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return 1;
       }
-      __forceinline operator long long() const
+      __forceinline constexpr operator long long() const
       {
         return 1;
       }
-      __forceinline operator unsigned long long() const
+      __forceinline constexpr operator unsigned long long() const
       {
         return 1;
       }
-      __forceinline operator long() const
+      __forceinline constexpr operator long() const
       {
         return 1;
       }
-      __forceinline operator unsigned long() const
+      __forceinline constexpr operator unsigned long() const
       {
         return 1;
       }
-      __forceinline operator int() const
+      __forceinline constexpr operator int() const
       {
         return 1;
       }
-      __forceinline operator unsigned int() const
+      __forceinline constexpr operator unsigned int() const
       {
         return 1;
       }
-      __forceinline operator short() const
+      __forceinline constexpr operator short() const
       {
         return 1;
       }
-      __forceinline operator unsigned short() const
+      __forceinline constexpr operator unsigned short() const
       {
         return 1;
       }
-      __forceinline operator char() const
+      __forceinline constexpr operator char() const
       {
         return 1;
       }
-      __forceinline operator unsigned char() const
+      __forceinline constexpr operator unsigned char() const
       {
         return 1;
       }
@@ -123,51 +123,51 @@ namespace rkcommon {
 
     static struct NegInfTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return -std::numeric_limits<double>::infinity();
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return -std::numeric_limits<float>::infinity();
       }
-      __forceinline operator long long() const
+      __forceinline constexpr operator long long() const
       {
         return std::numeric_limits<long long>::min();
       }
-      __forceinline operator unsigned long long() const
+      __forceinline constexpr operator unsigned long long() const
       {
         return std::numeric_limits<unsigned long long>::min();
       }
-      __forceinline operator long() const
+      __forceinline constexpr operator long() const
       {
         return std::numeric_limits<long>::min();
       }
-      __forceinline operator unsigned long() const
+      __forceinline constexpr operator unsigned long() const
       {
         return std::numeric_limits<unsigned long>::min();
       }
-      __forceinline operator int() const
+      __forceinline constexpr operator int() const
       {
         return std::numeric_limits<int>::min();
       }
-      __forceinline operator unsigned int() const
+      __forceinline constexpr operator unsigned int() const
       {
         return std::numeric_limits<unsigned int>::min();
       }
-      __forceinline operator short() const
+      __forceinline constexpr operator short() const
       {
         return std::numeric_limits<short>::min();
       }
-      __forceinline operator unsigned short() const
+      __forceinline constexpr operator unsigned short() const
       {
         return std::numeric_limits<unsigned short>::min();
       }
-      __forceinline operator char() const
+      __forceinline constexpr operator char() const
       {
         return std::numeric_limits<char>::min();
       }
-      __forceinline operator unsigned char() const
+      __forceinline constexpr operator unsigned char() const
       {
         return std::numeric_limits<unsigned char>::min();
       }
@@ -176,51 +176,51 @@ namespace rkcommon {
 
     static struct PosInfTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return std::numeric_limits<double>::infinity();
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return std::numeric_limits<float>::infinity();
       }
-      __forceinline operator long long() const
+      __forceinline constexpr operator long long() const
       {
         return std::numeric_limits<long long>::max();
       }
-      __forceinline operator unsigned long long() const
+      __forceinline constexpr operator unsigned long long() const
       {
         return std::numeric_limits<unsigned long long>::max();
       }
-      __forceinline operator long() const
+      __forceinline constexpr operator long() const
       {
         return std::numeric_limits<long>::max();
       }
-      __forceinline operator unsigned long() const
+      __forceinline constexpr operator unsigned long() const
       {
         return std::numeric_limits<unsigned long>::max();
       }
-      __forceinline operator int() const
+      __forceinline constexpr operator int() const
       {
         return std::numeric_limits<int>::max();
       }
-      __forceinline operator unsigned int() const
+      __forceinline constexpr operator unsigned int() const
       {
         return std::numeric_limits<unsigned int>::max();
       }
-      __forceinline operator short() const
+      __forceinline constexpr operator short() const
       {
         return std::numeric_limits<short>::max();
       }
-      __forceinline operator unsigned short() const
+      __forceinline constexpr operator unsigned short() const
       {
         return std::numeric_limits<unsigned short>::max();
       }
-      __forceinline operator char() const
+      __forceinline constexpr operator char() const
       {
         return std::numeric_limits<char>::max();
       }
-      __forceinline operator unsigned char() const
+      __forceinline constexpr operator unsigned char() const
       {
         return std::numeric_limits<unsigned char>::max();
       }
@@ -228,11 +228,11 @@ namespace rkcommon {
 
     static struct NaNTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return std::numeric_limits<double>::quiet_NaN();
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return std::numeric_limits<float>::quiet_NaN();
       }
@@ -240,11 +240,11 @@ namespace rkcommon {
 
     static struct UlpTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return std::numeric_limits<double>::epsilon();
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return std::numeric_limits<float>::epsilon();
       }
@@ -252,11 +252,11 @@ namespace rkcommon {
 
     static struct PiTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return M_PI;
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return M_PI;
       }
@@ -264,11 +264,11 @@ namespace rkcommon {
 
     static struct OneOverPiTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return M_1_PI;
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return M_1_PI;
       }
@@ -276,11 +276,11 @@ namespace rkcommon {
 
     static struct TwoPiTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return 2.0 * M_PI;
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return 2.0 * M_PI;
       }
@@ -288,11 +288,11 @@ namespace rkcommon {
 
     static struct HalfPiTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return M_PI_2;
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return M_PI_2;
       }
@@ -300,11 +300,11 @@ namespace rkcommon {
 
     static struct OneOverTwoPiTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return 0.5 * M_1_PI;
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return 0.5 * M_1_PI;
       }
@@ -312,11 +312,11 @@ namespace rkcommon {
 
     static struct FourPiTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return 4.0 * M_PI;
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return 4.0 * M_PI;
       }
@@ -324,11 +324,11 @@ namespace rkcommon {
 
     static struct QuarterPiTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return M_PI_4;
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return M_PI_4;
       }
@@ -336,11 +336,11 @@ namespace rkcommon {
 
     static struct OneOverFourPiTy
     {
-      __forceinline operator double() const
+      __forceinline constexpr operator double() const
       {
         return 0.25 * M_1_PI;
       }
-      __forceinline operator float() const
+      __forceinline constexpr operator float() const
       {
         return 0.25 * M_1_PI;
       }
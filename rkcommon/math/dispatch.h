@@ -0,0 +1,109 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+
+/* Multi-versioned kernels, for the library's own sources only.
+
+   With RKCOMMON_ISA_DISPATCH the bulk kernel sources are compiled once more
+   for each extra instruction set, with -DRKCOMMON_ISA=<isa> and the matching
+   compiler flags (see rkcommon/CMakeLists.txt). Every compilation puts its
+   entry points into namespace RKCOMMON_ISA_NAMESPACE (isa_base, isa_sse42,
+   isa_avx2 or isa_avx512). The base compilation additionally defines the
+   public functions, which call the variant for activeIsa() through a
+   function pointer picked on first use:
+
+     namespace RKCOMMON_ISA_NAMESPACE {
+       void scale(float *v, size_t n) { ... }
+     }
+
+   #ifdef RKCOMMON_ISA_DISPATCHER
+     using ScaleFcn = void(float *, size_t);
+     RKCOMMON_ISA_DECLARE(ScaleFcn scale)
+
+     void scale(float *v, size_t n)
+     {
+       static ScaleFcn *const fcn = RKCOMMON_ISA_SELECT(ScaleFcn, scale);
+       fcn(v, n);
+     }
+   #endif
+*/
+
+#ifndef RKCOMMON_ISA
+#define RKCOMMON_ISA base
+#define RKCOMMON_ISA_DISPATCHER
+#endif
+
+#define RKCOMMON_ISA_CONCAT2(a, b) a##b
+#define RKCOMMON_ISA_CONCAT(a, b) RKCOMMON_ISA_CONCAT2(a, b)
+#define RKCOMMON_ISA_NAMESPACE RKCOMMON_ISA_CONCAT(isa_, RKCOMMON_ISA)
+
+// clang-format off
+#ifdef RKCOMMON_ISA_DISPATCH_SSE42
+#define RKCOMMON_ISA_DECLARE_SSE42(decl) namespace isa_sse42 { decl; }
+#define RKCOMMON_ISA_SSE42(name) isa_sse42::name
+#else
+#define RKCOMMON_ISA_DECLARE_SSE42(decl)
+#define RKCOMMON_ISA_SSE42(name) nullptr
+#endif
+
+#ifdef RKCOMMON_ISA_DISPATCH_AVX2
+#define RKCOMMON_ISA_DECLARE_AVX2(decl) namespace isa_avx2 { decl; }
+#define RKCOMMON_ISA_AVX2(name) isa_avx2::name
+#else
+#define RKCOMMON_ISA_DECLARE_AVX2(decl)
+#define RKCOMMON_ISA_AVX2(name) nullptr
+#endif
+
+#ifdef RKCOMMON_ISA_DISPATCH_AVX512
+#define RKCOMMON_ISA_DECLARE_AVX512(decl) namespace isa_avx512 { decl; }
+#define RKCOMMON_ISA_AVX512(name) isa_avx512::name
+#else
+#define RKCOMMON_ISA_DECLARE_AVX512(decl)
+#define RKCOMMON_ISA_AVX512(name) nullptr
+#endif
+// clang-format on
+
+// declares 'decl' in the namespaces of the other compiled variants
+#define RKCOMMON_ISA_DECLARE(decl) \
+  RKCOMMON_ISA_DECLARE_SSE42(decl) \
+  RKCOMMON_ISA_DECLARE_AVX2(decl)  \
+  RKCOMMON_ISA_DECLARE_AVX512(decl)
+
+// the variant of 'name' (with function type 'type') for activeIsa()
+#define RKCOMMON_ISA_SELECT(type, name)                         \
+  ::rkcommon::detail::selectIsa<type>(isa_base::name,           \
+                                      RKCOMMON_ISA_SSE42(name), \
+                                      RKCOMMON_ISA_AVX2(name),  \
+                                      RKCOMMON_ISA_AVX512(name))
+
+namespace rkcommon {
+  namespace detail {
+
+    template <typename FCN_T>
+    inline FCN_T *selectIsa(FCN_T *base,
+                            FCN_T *sse42,
+                            FCN_T *avx2,
+                            FCN_T *avx512)
+    {
+      FCN_T *variant = nullptr;
+      switch (activeIsa()) {
+      case CpuIsa::AVX512:
+        variant = avx512;
+        break;
+      case CpuIsa::AVX2:
+        variant = avx2;
+        break;
+      case CpuIsa::SSE42:
+        variant = sse42;
+        break;
+      default:
+        break;
+      }
+      return variant ? variant : base;
+    }
+
+  }  // namespace detail
+}  // namespace rkcommon
@@ -0,0 +1,75 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "fastmath.h"
+#include "dispatch.h"
+
+namespace rkcommon {
+  namespace math {
+
+    static constexpr int W = NATIVE_PACKET_WIDTH < 4 ? 4 : NATIVE_PACKET_WIDTH;
+
+    // calls 'fcn' on packets of 'in', masking the last one to the tail
+    template <typename FCN_T>
+    static void transformPackets(const float *in,
+                                 float *out,
+                                 size_t n,
+                                 FCN_T &&fcn)
+    {
+      size_t i = 0;
+      for (; i + W <= n; i += W)
+        vfloat<W>::storeu(out + i, fcn(vfloat<W>::loadu(in + i)));
+
+      if (i < n) {
+        vfloat<W> lane;
+        for (int l = 0; l < W; ++l)
+          lane[l] = float(l);
+
+        const vbool<W> tail = lane < float(n - i);
+        vfloat<W>::storeu(tail, out + i, fcn(vfloat<W>::loadu(tail, in + i)));
+      }
+    }
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      void linear_to_srgb(const float *in, float *out, size_t n)
+      {
+        transformPackets(
+            in, out, n, [](const vfloat<W> &v) { return linear_to_srgb(v); });
+      }
+
+      void srgb_to_linear(const float *in, float *out, size_t n)
+      {
+        transformPackets(
+            in, out, n, [](const vfloat<W> &v) { return srgb_to_linear(v); });
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // fastmath.h definitions //////////////////////////////////////////////////
+
+    using ConvertFcn = void(const float *, float *, size_t);
+
+    RKCOMMON_ISA_DECLARE(ConvertFcn linear_to_srgb)
+    RKCOMMON_ISA_DECLARE(ConvertFcn srgb_to_linear)
+
+    void linear_to_srgb(const float *in, float *out, size_t n)
+    {
+      static ConvertFcn *const fcn =
+          RKCOMMON_ISA_SELECT(ConvertFcn, linear_to_srgb);
+      fcn(in, out, n);
+    }
+
+    void srgb_to_linear(const float *in, float *out, size_t n)
+    {
+      static ConvertFcn *const fcn =
+          RKCOMMON_ISA_SELECT(ConvertFcn, srgb_to_linear);
+      fcn(in, out, n);
+    }
+#endif
+
+  }  // namespace math
+}  // namespace rkcommon
@@ -0,0 +1,544 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "packet.h"
+// std
+#include <cstring>
+
+/* Fast polynomial approximations of exp/log/pow/sin/cos for float, vfloat<W>
+   packets (see packet.h) and vec_t of either, graded by MathPrecision:
+
+     fast_exp(x), fast_exp2(x)  -- results below 2^-126 flush to zero and
+                                   results above about 2^127.5 are +inf
+     fast_log(x), fast_log2(x)  -- for normalized x > 0; 0 gives -inf,
+                                   negative x NaN and +inf +inf
+     fast_pow(x, y)             -- exp2(y * log2(x)) for x >= 0; any x to
+                                   the power of 0 is 1
+     fast_sin(x), fast_cos(x), fast_sincos(x, s, c)
+                                -- for |x| <= 8192
+     fast_rcp(x), fast_rsqrt(x) -- Fast is the hardware estimate plus one
+                                   Newton-Raphson step, Accurate divides
+
+   Accurate results are within a few ulp (fast_pow loses about one ulp per
+   unit of |y * log2(x)|), Fast ones within about 1e-4 relative (absolute
+   for sin/cos). Denormal and NaN inputs give unspecified results.
+
+   The speedup comes from the packet versions, which replace per-lane libm
+   calls; the scalar float versions compute the same results one at a time
+   and are rarely faster than std::pow() and friends.
+
+   Usage: fast_pow<MathPrecision::Fast>(color, 1.f / 2.2f) */
+
+namespace rkcommon {
+  namespace math {
+
+    enum class MathPrecision
+    {
+      Fast,     // about 1e-4 relative error
+      Accurate  // within a few ulp
+    };
+
+    namespace detail {
+      inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+        // Per-type bit manipulation ///////////////////////////////////////////
+
+        inline float select(bool mask, float a, float b)
+        {
+          return mask ? a : b;
+        }
+
+        // nearest integer, ties to even
+        inline float roundToInt(float x)
+        {
+#ifdef RKCOMMON_NO_SIMD
+          return std::nearbyint(x);
+#else
+          return float(_mm_cvtss_si32(_mm_set_ss(x)));
+#endif
+        }
+
+        // 2^n for integral n in [-127, 128]; -127 gives 0 and 128 +inf
+        inline float pow2i(float n)
+        {
+          const int32_t bits = (int32_t(n) + 127) << 23;
+          float r;
+          std::memcpy(&r, &bits, sizeof(r));
+          return r;
+        }
+
+        // x = m * 2^e with m in [0.5, 1), for normalized x > 0
+        inline float splitExponent(float x, float &e)
+        {
+          int32_t bits;
+          std::memcpy(&bits, &x, sizeof(bits));
+          e    = float(((bits >> 23) & 0xff) - 126);
+          bits = (bits & 0x007fffff) | 0x3f000000;
+          float m;
+          std::memcpy(&m, &bits, sizeof(m));
+          return m;
+        }
+
+        template <int W>
+        inline vfloat<W> roundToInt(const vfloat<W> &x)
+        {
+          vfloat<W> r;
+          for (int i = 0; i < W; ++i)
+            r[i] = roundToInt(x[i]);
+          return r;
+        }
+
+        template <int W>
+        inline vfloat<W> pow2i(const vfloat<W> &n)
+        {
+          vfloat<W> r;
+          for (int i = 0; i < W; ++i)
+            r[i] = pow2i(n[i]);
+          return r;
+        }
+
+        template <int W>
+        inline vfloat<W> splitExponent(const vfloat<W> &x, vfloat<W> &e)
+        {
+          vfloat<W> m;
+          for (int i = 0; i < W; ++i)
+            m[i] = splitExponent(x[i], e[i]);
+          return m;
+        }
+
+#ifdef RKCOMMON_PACKET_SSE
+        inline vfloat<4> roundToInt(const vfloat<4> &x)
+        {
+          return _mm_cvtepi32_ps(_mm_cvtps_epi32(x.v));
+        }
+
+        inline vfloat<4> pow2i(const vfloat<4> &n)
+        {
+          const __m128i i = _mm_add_epi32(_mm_cvttps_epi32(n.v),
+                                          _mm_set1_epi32(127));
+          return _mm_castsi128_ps(_mm_slli_epi32(i, 23));
+        }
+
+        inline vfloat<4> splitExponent(const vfloat<4> &x, vfloat<4> &e)
+        {
+          const __m128i bits = _mm_castps_si128(x.v);
+          e                  = _mm_cvtepi32_ps(
+              _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+          const __m128 mantissa = _mm_castsi128_ps(_mm_set1_epi32(0x007fffff));
+          return _mm_or_ps(_mm_and_ps(x.v, mantissa), _mm_set1_ps(.5f));
+        }
+#endif
+
+#ifdef RKCOMMON_PACKET_AVX
+        inline vfloat<8> roundToInt(const vfloat<8> &x)
+        {
+          return _mm256_round_ps(x.v,
+                                 _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        }
+
+#ifdef __AVX2__
+        inline vfloat<8> pow2i(const vfloat<8> &n)
+        {
+          const __m256i i = _mm256_add_epi32(_mm256_cvttps_epi32(n.v),
+                                             _mm256_set1_epi32(127));
+          return _mm256_castsi256_ps(_mm256_slli_epi32(i, 23));
+        }
+
+        inline vfloat<8> splitExponent(const vfloat<8> &x, vfloat<8> &e)
+        {
+          const __m256i bits = _mm256_castps_si256(x.v);
+          e                  = _mm256_cvtepi32_ps(_mm256_sub_epi32(
+              _mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+          const __m256 mantissa =
+              _mm256_castsi256_ps(_mm256_set1_epi32(0x007fffff));
+          return _mm256_or_ps(_mm256_and_ps(x.v, mantissa),
+                              _mm256_set1_ps(.5f));
+        }
+#else
+        // AVX1 has no 256-bit integer ops, so both halves go through SSE
+        inline vfloat<8> pow2i(const vfloat<8> &n)
+        {
+          const vfloat<4> lo = pow2i(vfloat<4>(_mm256_castps256_ps128(n.v)));
+          const vfloat<4> hi = pow2i(vfloat<4>(_mm256_extractf128_ps(n.v, 1)));
+          return _mm256_insertf128_ps(_mm256_castps128_ps256(lo.v), hi.v, 1);
+        }
+
+        inline vfloat<8> splitExponent(const vfloat<8> &x, vfloat<8> &e)
+        {
+          vfloat<4> elo, ehi;
+          const vfloat<4> lo =
+              splitExponent(vfloat<4>(_mm256_castps256_ps128(x.v)), elo);
+          const vfloat<4> hi =
+              splitExponent(vfloat<4>(_mm256_extractf128_ps(x.v, 1)), ehi);
+          e = _mm256_insertf128_ps(_mm256_castps128_ps256(elo.v), ehi.v, 1);
+          return _mm256_insertf128_ps(_mm256_castps128_ps256(lo.v), hi.v, 1);
+        }
+#endif
+#endif
+
+#ifdef RKCOMMON_PACKET_AVX512
+        inline vfloat<16> roundToInt(const vfloat<16> &x)
+        {
+          return _mm512_roundscale_ps(x.v, _MM_FROUND_TO_NEAREST_INT);
+        }
+
+        inline vfloat<16> pow2i(const vfloat<16> &n)
+        {
+          const __m512i i = _mm512_add_epi32(_mm512_cvttps_epi32(n.v),
+                                             _mm512_set1_epi32(127));
+          return _mm512_castsi512_ps(_mm512_slli_epi32(i, 23));
+        }
+
+        inline vfloat<16> splitExponent(const vfloat<16> &x, vfloat<16> &e)
+        {
+          const __m512i bits = _mm512_castps_si512(x.v);
+          e                  = _mm512_cvtepi32_ps(_mm512_sub_epi32(
+              _mm512_srli_epi32(bits, 23), _mm512_set1_epi32(126)));
+          const __m512i m = _mm512_or_si512(
+              _mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)),
+              _mm512_set1_epi32(0x3f000000));
+          return _mm512_castsi512_ps(m);
+        }
+#endif
+
+        // Kernels, for T = float or vfloat<W> /////////////////////////////////
+
+        // e^r for |r| <= ln(2) / 2 (Cephes expf)
+        template <typename T>
+        inline T expPoly(const T &r)
+        {
+          T p = madd(T(1.9875691500e-4f), r, T(1.3981999507e-3f));
+          p   = madd(p, r, T(8.3334519073e-3f));
+          p   = madd(p, r, T(4.1665795894e-2f));
+          p   = madd(p, r, T(1.6666665459e-1f));
+          p   = madd(p, r, T(5.0000001201e-1f));
+          return madd(p, r * r, r + 1.f);
+        }
+
+        // ln(1 + f) - f for f in [sqrt(0.5) - 1, sqrt(2) - 1] (Cephes logf)
+        template <typename T>
+        inline T logPoly(const T &f)
+        {
+          const T z = f * f;
+          T p       = madd(T(7.0376836292e-2f), f, T(-1.1514610310e-1f));
+          p         = madd(p, f, T(1.1676998740e-1f));
+          p         = madd(p, f, T(-1.2420140846e-1f));
+          p         = madd(p, f, T(1.4249322787e-1f));
+          p         = madd(p, f, T(-1.6668057665e-1f));
+          p         = madd(p, f, T(2.0000714765e-1f));
+          p         = madd(p, f, T(-2.4999993993e-1f));
+          p         = madd(p, f, T(3.3333331174e-1f));
+          return madd(f * z, p, z * -.5f);
+        }
+
+        // x = (1 + f) * 2^e with 1 + f in [sqrt(0.5), sqrt(2))
+        template <typename T>
+        inline T splitLog(const T &x, T &e)
+        {
+          const T m         = splitExponent(x, e);
+          const auto belowS = m < float(0.70710678118654752440);
+          e                 = e - select(belowS, T(1.f), T(0.f));
+          return select(belowS, m + m, m) - 1.f;
+        }
+
+        // -inf for 0, NaN for negative x, x itself for +inf and NaN
+        template <typename T>
+        inline T logSpecialCases(const T &x, const T &r)
+        {
+          const T special = select(x == 0.f, T(float(neg_inf)), T(float(nan)));
+          return select(x > 0.f, select(x < float(pos_inf), r, x), special);
+        }
+
+        template <MathPrecision P, typename T>
+        inline T fast_exp2(const T &x)
+        {
+          const T xc = min(max(x, T(-127.f)), T(128.f));
+          const T n  = roundToInt(xc);
+          const T f  = xc - n;
+
+          T p;
+          if (P == MathPrecision::Fast) {
+            p = madd(T(5.500892858e-02f), f, T(2.422109601e-01f));
+            p = madd(p, f, T(6.932829276e-01f));
+            p = madd(p, f, T(1.f));
+          } else {
+            p = expPoly(f * float(0.69314718055994530942));
+          }
+          return p * pow2i(n);
+        }
+
+        template <MathPrecision P, typename T>
+        inline T fast_exp(const T &x)
+        {
+          if (P == MathPrecision::Fast)
+            return fast_exp2<P>(x * float(1.44269504088896340736));
+
+          // ln(2) split in an exact high part and the rest (Cody-Waite)
+          const T xc = min(max(x, T(-127.f * float(0.69314718055994530942))),
+                           T(128.f * float(0.69314718055994530942)));
+          const T n  = roundToInt(xc * float(1.44269504088896340736));
+          const T r =
+              madd(n, T(2.12194440e-4f), madd(n, T(-0.693359375f), xc));
+          return expPoly(r) * pow2i(n);
+        }
+
+        template <MathPrecision P, typename T>
+        inline T fast_log2(const T &x)
+        {
+          T e;
+          const T f = splitLog(x, e);
+
+          T r;
+          if (P == MathPrecision::Fast) {
+            T p = madd(T(2.611697727e-01f), f, T(-3.924614170e-01f));
+            p   = madd(p, f, T(4.846483001e-01f));
+            p   = madd(p, f, T(-7.204624321e-01f));
+            p   = madd(p, f, T(1.442655846e+00f));
+            r   = madd(p, f, e);
+          } else {
+            r = madd(f + logPoly(f), T(float(1.44269504088896340736)), e);
+          }
+          return logSpecialCases(x, r);
+        }
+
+        template <MathPrecision P, typename T>
+        inline T fast_log(const T &x)
+        {
+          if (P == MathPrecision::Fast)
+            return fast_log2<P>(x) * float(0.69314718055994530942);
+
+          T e;
+          const T f = splitLog(x, e);
+          const T y = madd(e, T(-2.12194440e-4f), logPoly(f));
+          return logSpecialCases(x, madd(e, T(0.693359375f), f + y));
+        }
+
+        template <MathPrecision P, typename T>
+        inline T fast_pow(const T &x, const T &y)
+        {
+          const T r = fast_exp2<P>(y * fast_log2<P>(x));
+          return select(y == 0.f, T(1.f), r);
+        }
+
+        /* x = r + q * pi/2 + 2k * pi with r in [-pi/4, pi/4] and quadrant q in
+           {0, 1, 2, 3}; pi/2 is split in three parts (Cody-Waite), the first
+           two exact when multiplied by q for |x| <= 8192 */
+        template <typename T>
+        inline T reduceQuadrant(const T &x, T &q)
+        {
+          const T n = roundToInt(x * float(0.63661977236758134308));
+          q         = n - 4.f * roundToInt(madd(n, T(.25f), T(-.375f)));
+          T r       = madd(n, T(-1.5703125f), x);
+          r         = madd(n, T(-4.837512969970703125e-4f), r);
+          return madd(n, T(-7.54978995489188216e-8f), r);
+        }
+
+        // sin(r) and cos(r) for r in [-pi/4, pi/4] (Cephes sinf/cosf)
+        template <MathPrecision P, typename T>
+        inline void sinCosPoly(const T &r, T &s, T &c)
+        {
+          const T z = r * r;
+          T ps, pc;
+          if (P == MathPrecision::Fast) {
+            ps = madd(T(8.163281932e-03f), z, T(-1.666339038e-01f));
+            pc = T(4.089930520e-02f);
+          } else {
+            ps = madd(T(-1.9515295891e-4f), z, T(8.3321608736e-3f));
+            ps = madd(ps, z, T(-1.6666654611e-1f));
+            pc = madd(T(2.443315711809948e-5f), z, T(-1.388731625493765e-3f));
+            pc = madd(pc, z, T(4.166664568298827e-2f));
+          }
+          s = madd(r * z, ps, r);
+          c = madd(z * z, pc, madd(z, T(-.5f), T(1.f)));
+        }
+
+        template <MathPrecision P, typename T>
+        inline void fast_sincos(const T &x, T &sinx, T &cosx)
+        {
+          T q, s, c;
+          sinCosPoly<P>(reduceQuadrant(x, q), s, c);
+
+          const auto swap = (q == 1.f) | (q == 3.f);
+          const T sr      = select(swap, c, s);
+          const T cr      = select(swap, s, c);
+          sinx            = select(q >= 2.f, -sr, sr);
+          cosx            = select((q == 1.f) | (q == 2.f), -cr, cr);
+        }
+
+        template <MathPrecision P, typename T>
+        inline T fast_sin(const T &x)
+        {
+          T s, c;
+          fast_sincos<P>(x, s, c);
+          return s;
+        }
+
+        template <MathPrecision P, typename T>
+        inline T fast_cos(const T &x)
+        {
+          T s, c;
+          fast_sincos<P>(x, s, c);
+          return c;
+        }
+
+        using std::sqrt;
+
+        // Fast: estimate plus one Newton-Raphson step; Accurate: division
+        template <MathPrecision P, typename T>
+        inline T fast_rcp(const T &x)
+        {
+          return P == MathPrecision::Fast ? rcp(x) : T(1.f) / x;
+        }
+
+        template <MathPrecision P, typename T>
+        inline T fast_rsqrt(const T &x)
+        {
+          return P == MathPrecision::Fast ? rsqrt(x) : T(1.f) / sqrt(x);
+        }
+
+      }  // namespace RKCOMMON_PACKET_NAMESPACE
+    }  // namespace detail
+
+    inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+      // Public functions //////////////////////////////////////////////////////
+
+#define fastmath_unary_function(name)                                        \
+  template <MathPrecision P = MathPrecision::Accurate>                       \
+  inline float name(float x)                                                 \
+  {                                                                          \
+    return detail::name<P>(x);                                               \
+  }                                                                          \
+  template <MathPrecision P = MathPrecision::Accurate, int W>                 \
+  inline vfloat<W> name(const vfloat<W> &x)                                  \
+  {                                                                          \
+    return detail::name<P>(x);                                               \
+  }                                                                          \
+  template <MathPrecision P = MathPrecision::Accurate, typename T>            \
+  inline vec_t<T, 2> name(const vec_t<T, 2> &v)                              \
+  {                                                                          \
+    return vec_t<T, 2>(name<P>(v.x), name<P>(v.y));                          \
+  }                                                                          \
+  template <MathPrecision P = MathPrecision::Accurate, typename T, bool A>    \
+  inline vec_t<T, 3, A> name(const vec_t<T, 3, A> &v)                        \
+  {                                                                          \
+    return vec_t<T, 3, A>(name<P>(v.x), name<P>(v.y), name<P>(v.z));         \
+  }                                                                          \
+  template <MathPrecision P = MathPrecision::Accurate, typename T>            \
+  inline vec_t<T, 4> name(const vec_t<T, 4> &v)                              \
+  {                                                                          \
+    return vec_t<T, 4>(                                                      \
+        name<P>(v.x), name<P>(v.y), name<P>(v.z), name<P>(v.w));             \
+  }
+
+      // clang-format off
+      fastmath_unary_function(fast_exp)
+      fastmath_unary_function(fast_exp2)
+      fastmath_unary_function(fast_log)
+      fastmath_unary_function(fast_log2)
+      fastmath_unary_function(fast_sin)
+      fastmath_unary_function(fast_cos)
+      fastmath_unary_function(fast_rcp)
+      fastmath_unary_function(fast_rsqrt)
+      // clang-format on
+#undef fastmath_unary_function
+
+      template <MathPrecision P = MathPrecision::Accurate>
+      inline float fast_pow(float x, float y)
+      {
+        return detail::fast_pow<P>(x, y);
+      }
+
+      template <MathPrecision P = MathPrecision::Accurate, int W>
+      inline vfloat<W> fast_pow(const vfloat<W> &x, const vfloat<W> &y)
+      {
+        return detail::fast_pow<P>(x, y);
+      }
+
+      template <MathPrecision P = MathPrecision::Accurate, int W>
+      inline vfloat<W> fast_pow(const vfloat<W> &x, float y)
+      {
+        return detail::fast_pow<P>(x, vfloat<W>(y));
+      }
+
+      // component-wise, with the same exponent for each component
+      template <MathPrecision P = MathPrecision::Accurate, typename T>
+      inline vec_t<T, 2> fast_pow(const vec_t<T, 2> &v, float y)
+      {
+        return vec_t<T, 2>(fast_pow<P>(v.x, y), fast_pow<P>(v.y, y));
+      }
+
+      template <MathPrecision P = MathPrecision::Accurate, typename T, bool A>
+      inline vec_t<T, 3, A> fast_pow(const vec_t<T, 3, A> &v, float y)
+      {
+        return vec_t<T, 3, A>(
+            fast_pow<P>(v.x, y), fast_pow<P>(v.y, y), fast_pow<P>(v.z, y));
+      }
+
+      template <MathPrecision P = MathPrecision::Accurate, typename T>
+      inline vec_t<T, 4> fast_pow(const vec_t<T, 4> &v, float y)
+      {
+        return vec_t<T, 4>(fast_pow<P>(v.x, y),
+                           fast_pow<P>(v.y, y),
+                           fast_pow<P>(v.z, y),
+                           fast_pow<P>(v.w, y));
+      }
+
+      template <MathPrecision P = MathPrecision::Accurate>
+      inline void fast_sincos(float x, float &s, float &c)
+      {
+        detail::fast_sincos<P>(x, s, c);
+      }
+
+      template <MathPrecision P = MathPrecision::Accurate, int W>
+      inline void fast_sincos(const vfloat<W> &x, vfloat<W> &s, vfloat<W> &c)
+      {
+        detail::fast_sincos<P>(x, s, c);
+      }
+
+      // sRGB //////////////////////////////////////////////////////////////////
+
+      /* Packet versions of linear_to_srgb()/srgb_to_linear() in rkmath.h,
+         following APPROXIMATE_SRGB in the same way, within 1e-4 relative */
+
+      template <int W>
+      inline vfloat<W> linear_to_srgb(const vfloat<W> &f)
+      {
+        const vfloat<W> c = max(f, vfloat<W>(0.f));
+#ifdef APPROXIMATE_SRGB
+        return fast_pow<MathPrecision::Fast>(c, 1.f / 2.2f);
+#else
+        const vfloat<W> p = fast_pow<MathPrecision::Fast>(c, 1.f / 2.4f);
+        return select(c <= 0.0031308f, 12.92f * c, p * 1.055f - 0.055f);
+#endif
+      }
+
+      template <int W>
+      inline vfloat<W> srgb_to_linear(const vfloat<W> &f)
+      {
+        const vfloat<W> c = max(f, vfloat<W>(0.f));
+#ifdef APPROXIMATE_SRGB
+        return fast_pow<MathPrecision::Fast>(c, 2.2f);
+#else
+        const vfloat<W> p = fast_pow<MathPrecision::Fast>(
+            (c + 0.055f) * float(1. / 1.055), 2.4f);
+        return select(c <= 0.04045f, c * float(1. / 12.92), p);
+#endif
+      }
+
+    }  // namespace RKCOMMON_PACKET_NAMESPACE
+
+    /* linear_to_srgb()/srgb_to_linear() of 'n' floats a packet at a time,
+       e.g. all channels of an image; 'out' may be the same array as 'in' */
+    RKCOMMON_INTERFACE void linear_to_srgb(const float *in,
+                                           float *out,
+                                           size_t n);
+
+    RKCOMMON_INTERFACE void srgb_to_linear(const float *in,
+                                           float *out,
+                                           size_t n);
+
+  }  // namespace math
+}  // namespace rkcommon
@@ -0,0 +1,157 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "frustum.h"
+#include "dispatch.h"
+#include "../tasking/parallel_for.h"
+#include "packet.h"
+
+namespace rkcommon {
+  namespace math {
+
+    static constexpr int W = NATIVE_PACKET_WIDTH < 4 ? 4 : NATIVE_PACKET_WIDTH;
+
+    // boxes per parallel task
+    static constexpr size_t FRUSTUM_CHUNK_SIZE = 16 * 1024;
+
+    // W boxes from 'begin' in SoA layout; lanes past 'end' repeat the last
+    template <typename BOX_T>
+    static inline box3vf<W> gatherBoxes(const BOX_T *boxes,
+                                        size_t begin,
+                                        size_t end)
+    {
+      box3vf<W> r;
+      for (int l = 0; l < W; ++l) {
+        const BOX_T &b = boxes[std::min(begin + l, end - 1)];
+        r.lower.x[l]   = b.lower.x;
+        r.lower.y[l]   = b.lower.y;
+        r.lower.z[l]   = b.lower.z;
+        r.upper.x[l]   = b.upper.x;
+        r.upper.y[l]   = b.upper.y;
+        r.upper.z[l]   = b.upper.z;
+      }
+      return r;
+    }
+
+    /* The corner farthest along a plane's normal picks lower or upper per
+       axis by the sign of the (uniform) normal, so that the packet test is
+       3 multiplies and adds per plane without any per-lane selects. */
+    template <typename BOX_T>
+    static void cullRange(const Frustum &frustum,
+                          const BOX_T *boxes,
+                          uint8_t *mask,
+                          size_t begin,
+                          size_t end)
+    {
+      // the plane which culled the last packet is tested first
+      int first = 0;
+      for (size_t i = begin; i < end; i += W) {
+        const box3vf<W> b = gatherBoxes(boxes, i, end);
+
+        vbool<W> visible(true);
+        for (int k = 0; k < 6; ++k) {
+          const int p        = (first + k) % 6;
+          const vec4f &plane = frustum.planes[p];
+          const vfloat<W> &x = plane.x >= 0.f ? b.upper.x : b.lower.x;
+          const vfloat<W> &y = plane.y >= 0.f ? b.upper.y : b.lower.y;
+          const vfloat<W> &z = plane.z >= 0.f ? b.upper.z : b.lower.z;
+          const vfloat<W> distance =
+              x * vfloat<W>(plane.x) +
+              (y * vfloat<W>(plane.y) +
+               (z * vfloat<W>(plane.z) + vfloat<W>(plane.w)));
+          visible = visible & (distance >= vfloat<W>(0.f));
+          if (none(visible)) {
+            first = p;
+            break;
+          }
+        }
+
+        const uint32_t bits = movemask(visible);
+        const size_t count  = std::min(size_t(W), end - i);
+        for (size_t l = 0; l < count; ++l)
+          mask[i + l] = uint8_t((bits >> l) & 1);
+      }
+    }
+
+    template <typename BOX_T>
+    static void frustumCullImpl(const Frustum &frustum,
+                                const BOX_T *boxes,
+                                size_t n,
+                                uint8_t *mask,
+                                bool parallel)
+    {
+      if (!parallel || n < FRUSTUM_PARALLEL_THRESHOLD) {
+        cullRange(frustum, boxes, mask, 0, n);
+        return;
+      }
+
+      tasking::parallel_for(divRoundUp(n, FRUSTUM_CHUNK_SIZE), [&](size_t c) {
+        const size_t begin = c * FRUSTUM_CHUNK_SIZE;
+        cullRange(frustum,
+                  boxes,
+                  mask,
+                  begin,
+                  std::min(n, begin + FRUSTUM_CHUNK_SIZE));
+      });
+    }
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      void frustumCull(const Frustum &frustum,
+                       const box3f *boxes,
+                       size_t n,
+                       uint8_t *mask,
+                       bool parallel)
+      {
+        frustumCullImpl(frustum, boxes, n, mask, parallel);
+      }
+
+      void frustumCull(const Frustum &frustum,
+                       const box3fa *boxes,
+                       size_t n,
+                       uint8_t *mask,
+                       bool parallel)
+      {
+        frustumCullImpl(frustum, boxes, n, mask, parallel);
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // frustum.h definitions ///////////////////////////////////////////////////
+
+    using FrustumCullFcn = void(
+        const Frustum &, const box3f *, size_t, uint8_t *, bool);
+    using FrustumCullAlignedFcn = void(
+        const Frustum &, const box3fa *, size_t, uint8_t *, bool);
+
+    RKCOMMON_ISA_DECLARE(FrustumCullFcn frustumCull)
+    RKCOMMON_ISA_DECLARE(FrustumCullAlignedFcn frustumCull)
+
+    void frustumCull(const Frustum &frustum,
+                     const box3f *boxes,
+                     size_t n,
+                     uint8_t *mask,
+                     bool parallel)
+    {
+      static FrustumCullFcn *const fcn =
+          RKCOMMON_ISA_SELECT(FrustumCullFcn, frustumCull);
+      fcn(frustum, boxes, n, mask, parallel);
+    }
+
+    void frustumCull(const Frustum &frustum,
+                     const box3fa *boxes,
+                     size_t n,
+                     uint8_t *mask,
+                     bool parallel)
+    {
+      static FrustumCullAlignedFcn *const fcn =
+          RKCOMMON_ISA_SELECT(FrustumCullAlignedFcn, frustumCull);
+      fcn(frustum, boxes, n, mask, parallel);
+    }
+#endif
+
+  }  // namespace math
+}  // namespace rkcommon
@@ -0,0 +1,213 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "AffineSpace.h"
+#include "box.h"
+// std
+#include <cstdint>
+
+/* View-frustum culling of bounding boxes.
+
+   A Frustum is 6 planes in world space, built from a camera transform and
+   the parameters of a perspective or orthographic projection. A box is
+   culled when it is entirely outside of one of the planes, tested at the
+   box corner farthest along the plane's normal. The test is conservative:
+   it never culls a box which intersects the frustum, but may keep boxes
+   outside of it near its edges.
+
+   cull() tests whole arrays a SIMD packet of boxes at a time, transposed
+   to SoA layout on the fly. The planes of a packet are tested starting
+   with the one which culled the previous packet, and stop as soon as all
+   of its boxes are culled, which pays off for spatially sorted arrays.
+   With 'parallel' arrays of at least FRUSTUM_PARALLEL_THRESHOLD boxes are
+   split across tasking::parallel_for(). */
+
+namespace rkcommon {
+  namespace math {
+
+    constexpr size_t FRUSTUM_PARALLEL_THRESHOLD = 64 * 1024;
+
+    struct Frustum
+    {
+      enum Plane
+      {
+        LEFT,
+        RIGHT,
+        BOTTOM,
+        TOP,
+        NEAR_PLANE,
+        FAR_PLANE
+      };
+
+      /*! plane i keeps the points p with dot(planes[i].xyz, p) +
+          planes[i].w >= 0; the normals are unit length */
+      vec4f planes[6];
+
+      Frustum() = default;
+      explicit Frustum(const vec4f _planes[6]);
+
+      /*! 'camera' maps camera space, which looks down +z with y up, to
+          world space, as AffineSpace3f::lookat() does; 'fovy' is the
+          vertical field of view in degrees and 'aspect' is width / height.
+          LEFT and RIGHT bound camera space x from below and above. */
+      static Frustum perspective(const AffineSpace3f &camera,
+                                 float fovy,
+                                 float aspect,
+                                 float nearDist,
+                                 float farDist);
+
+      /*! a box of 'height' x 'height * aspect' along the view direction */
+      static Frustum orthographic(const AffineSpace3f &camera,
+                                  float height,
+                                  float aspect,
+                                  float nearDist,
+                                  float farDist);
+
+      /*! whether 'box' may be visible. 'planeHint', if given, is the
+          plane to test first and receives the one which culled the box:
+          kept per object, it mostly culls with a single plane test in
+          the next frame. */
+      template <typename BOX_T>
+      bool isVisible(const BOX_T &box, int *planeHint = nullptr) const;
+
+      /*! mask[i] = isVisible(boxes[i]) ? 1 : 0 */
+      void cull(const box3f *boxes,
+                size_t n,
+                uint8_t *mask,
+                bool parallel = true) const;
+
+      void cull(const box3fa *boxes,
+                size_t n,
+                uint8_t *mask,
+                bool parallel = true) const;
+    };
+
+    RKCOMMON_INTERFACE void frustumCull(const Frustum &frustum,
+                                        const box3f *boxes,
+                                        size_t n,
+                                        uint8_t *mask,
+                                        bool parallel = true);
+
+    RKCOMMON_INTERFACE void frustumCull(const Frustum &frustum,
+                                        const box3fa *boxes,
+                                        size_t n,
+                                        uint8_t *mask,
+                                        bool parallel = true);
+
+    // Inlined definitions ////////////////////////////////////////////////////
+
+    namespace detail {
+
+      // the camera space plane 'n', 'd' in world space, normalized
+      inline vec4f worldPlane(const AffineSpace3f &camera,
+                              const vec3f &n,
+                              float d)
+      {
+        const vec3f wn  = xfmNormal(camera.l, n);
+        const float rcp = 1.f / length(wn);
+        return vec4f(wn.x * rcp,
+                     wn.y * rcp,
+                     wn.z * rcp,
+                     (d - dot(wn, camera.p)) * rcp);
+      }
+
+      // signed distance of the box corner farthest along the normal
+      template <typename BOX_T>
+      inline float farthestCornerDistance(const vec4f &plane,
+                                          const BOX_T &box)
+      {
+        const float x = plane.x >= 0.f ? box.upper.x : box.lower.x;
+        const float y = plane.y >= 0.f ? box.upper.y : box.lower.y;
+        const float z = plane.z >= 0.f ? box.upper.z : box.lower.z;
+        return x * plane.x + (y * plane.y + (z * plane.z + plane.w));
+      }
+
+    }  // namespace detail
+
+    inline Frustum::Frustum(const vec4f _planes[6])
+    {
+      for (int i = 0; i < 6; i++)
+        planes[i] = _planes[i];
+    }
+
+    inline Frustum Frustum::perspective(const AffineSpace3f &camera,
+                                        float fovy,
+                                        float aspect,
+                                        float nearDist,
+                                        float farDist)
+    {
+      const float tanY = std::tan(deg2rad(.5f * fovy));
+      const float tanX = tanY * aspect;
+
+      // e.g. the points inside the RIGHT plane have -x + z tanX >= 0
+      Frustum f;
+      f.planes[LEFT] = detail::worldPlane(camera, vec3f(1.f, 0.f, tanX), 0.f);
+      f.planes[RIGHT] =
+          detail::worldPlane(camera, vec3f(-1.f, 0.f, tanX), 0.f);
+      f.planes[BOTTOM] =
+          detail::worldPlane(camera, vec3f(0.f, 1.f, tanY), 0.f);
+      f.planes[TOP] = detail::worldPlane(camera, vec3f(0.f, -1.f, tanY), 0.f);
+      f.planes[NEAR_PLANE] =
+          detail::worldPlane(camera, vec3f(0.f, 0.f, 1.f), -nearDist);
+      f.planes[FAR_PLANE] =
+          detail::worldPlane(camera, vec3f(0.f, 0.f, -1.f), farDist);
+      return f;
+    }
+
+    inline Frustum Frustum::orthographic(const AffineSpace3f &camera,
+                                         float height,
+                                         float aspect,
+                                         float nearDist,
+                                         float farDist)
+    {
+      const float h = .5f * height;
+      const float w = h * aspect;
+
+      Frustum f;
+      f.planes[LEFT]  = detail::worldPlane(camera, vec3f(1.f, 0.f, 0.f), w);
+      f.planes[RIGHT] = detail::worldPlane(camera, vec3f(-1.f, 0.f, 0.f), w);
+      f.planes[BOTTOM] = detail::worldPlane(camera, vec3f(0.f, 1.f, 0.f), h);
+      f.planes[TOP]    = detail::worldPlane(camera, vec3f(0.f, -1.f, 0.f), h);
+      f.planes[NEAR_PLANE] =
+          detail::worldPlane(camera, vec3f(0.f, 0.f, 1.f), -nearDist);
+      f.planes[FAR_PLANE] =
+          detail::worldPlane(camera, vec3f(0.f, 0.f, -1.f), farDist);
+      return f;
+    }
+
+    template <typename BOX_T>
+    inline bool Frustum::isVisible(const BOX_T &box, int *planeHint) const
+    {
+      const int first = planeHint ? *planeHint : 0;
+      for (int k = 0; k < 6; k++) {
+        const int p = (first + k) % 6;
+        // written so that NaN distances cull, as in frustumCull()
+        if (!(detail::farthestCornerDistance(planes[p], box) >= 0.f)) {
+          if (planeHint)
+            *planeHint = p;
+          return false;
+        }
+      }
+      return true;
+    }
+
+    inline void Frustum::cull(const box3f *boxes,
+                              size_t n,
+                              uint8_t *mask,
+                              bool parallel) const
+    {
+      frustumCull(*this, boxes, n, mask, parallel);
+    }
+
+    inline void Frustum::cull(const box3fa *boxes,
+                              size_t n,
+                              uint8_t *mask,
+                              bool parallel) const
+    {
+      frustumCull(*this, boxes, n, mask, parallel);
+    }
+
+  }  // namespace math
+}  // namespace rkcommon
@@ -0,0 +1,269 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "vec.h"
+// std
+#include <cstdint>
+#include <cstring>
+
+#if defined(__F16C__) && !defined(RKCOMMON_NO_SIMD)
+#include <immintrin.h>
+#elif defined(__aarch64__) && !defined(RKCOMMON_NO_SIMD)
+#include <arm_neon.h>
+#endif
+
+/* 16-bit floating point storage types: 'half' (IEEE 754 binary16, 5 bit
+   exponent, 10 bit mantissa) and 'bfloat16' (the upper half of a float, 8
+   bit exponent, 7 bit mantissa). They convert implicitly to and from float,
+   rounding to nearest even, and all arithmetic happens in float. vec3h etc.
+   and DataView<half>, Array3D<half> or Array3DAccessor<half, float> read
+   them back as floats.
+
+   Bulk convert() uses F16C on x86 (when the including translation unit is
+   compiled with it, e.g. -mf16c or -mavx2) and NEON on AArch64. */
+
+namespace rkcommon {
+  namespace math {
+
+    namespace detail {
+
+      inline uint32_t floatBits(float f)
+      {
+        uint32_t u;
+        std::memcpy(&u, &f, sizeof(u));
+        return u;
+      }
+
+      inline float bitsToFloat(uint32_t u)
+      {
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+      }
+
+      // rounds to nearest even, NaNs stay (quiet) NaNs
+      inline uint16_t floatToHalfBits(float f)
+      {
+#if defined(__F16C__) && !defined(RKCOMMON_NO_SIMD)
+        return _cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT);
+#else
+        const uint32_t infinity   = 255u << 23;
+        const uint32_t halfTooBig = (127u + 16u) << 23;
+        // adding this moves a denormal half's mantissa into the low bits
+        const uint32_t denormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+        uint32_t u          = floatBits(f);
+        const uint32_t sign = u & 0x80000000u;
+        u ^= sign;
+
+        uint16_t h;
+        if (u >= halfTooBig) {
+          h = u > infinity ? 0x7e00 : 0x7c00;
+        } else if (u < (113u << 23)) {
+          const float d = bitsToFloat(u) + bitsToFloat(denormMagic);
+          h             = uint16_t(floatBits(d) - denormMagic);
+        } else {
+          const uint32_t mantissaOdd = (u >> 13) & 1;
+          u += (uint32_t(15 - 127) << 23) + 0xfff + mantissaOdd;
+          h = uint16_t(u >> 13);
+        }
+        return h | uint16_t(sign >> 16);
+#endif
+      }
+
+      inline float halfBitsToFloat(uint16_t h)
+      {
+#if defined(__F16C__) && !defined(RKCOMMON_NO_SIMD)
+        return _cvtsh_ss(h);
+#else
+        const uint32_t shiftedExp = 0x7c00u << 13;
+
+        uint32_t u           = uint32_t(h & 0x7fff) << 13;
+        const uint32_t exp   = u & shiftedExp;
+        u += (127u - 15u) << 23;
+
+        if (exp == shiftedExp) {
+          u += (128u - 16u) << 23;  // Inf/NaN
+        } else if (exp == 0) {
+          u += 1u << 23;  // zero/denormal: renormalize
+          u = floatBits(bitsToFloat(u) - bitsToFloat(113u << 23));
+        }
+        return bitsToFloat(u | (uint32_t(h & 0x8000) << 16));
+#endif
+      }
+
+      // rounds to nearest even, NaNs stay (quiet) NaNs
+      inline uint16_t floatToBFloat16Bits(float f)
+      {
+        const uint32_t u = floatBits(f);
+        if ((u & 0x7fffffffu) > 0x7f800000u)
+          return uint16_t((u >> 16) | 0x40);
+        return uint16_t((u + 0x7fffu + ((u >> 16) & 1)) >> 16);
+      }
+
+      inline float bfloat16BitsToFloat(uint16_t b)
+      {
+        return bitsToFloat(uint32_t(b) << 16);
+      }
+
+    }  // namespace detail
+
+    struct half
+    {
+      half() = default;
+
+      half(float f) : bits(detail::floatToHalfBits(f)) {}
+
+      operator float() const
+      {
+        return detail::halfBitsToFloat(bits);
+      }
+
+      static half fromBits(uint16_t bits)
+      {
+        half h;
+        h.bits = bits;
+        return h;
+      }
+
+      uint16_t bits;
+    };
+
+    struct bfloat16
+    {
+      bfloat16() = default;
+
+      bfloat16(float f) : bits(detail::floatToBFloat16Bits(f)) {}
+
+      operator float() const
+      {
+        return detail::bfloat16BitsToFloat(bits);
+      }
+
+      static bfloat16 fromBits(uint16_t bits)
+      {
+        bfloat16 b;
+        b.bits = bits;
+        return b;
+      }
+
+      uint16_t bits;
+    };
+
+    static_assert(sizeof(half) == 2 && sizeof(bfloat16) == 2,
+                  "16-bit float types must be tightly packed");
+
+    /* exact matches, so that (half, half) expressions don't also match the
+       vec4f/vec3fa SIMD overloads through their scalar constructor */
+#define half_arithmetic_operators(T)                                       \
+  inline float operator+(T a, T b)                                         \
+  {                                                                        \
+    return float(a) + float(b);                                            \
+  }                                                                        \
+  inline float operator-(T a, T b)                                         \
+  {                                                                        \
+    return float(a) - float(b);                                            \
+  }                                                                        \
+  inline float operator*(T a, T b)                                         \
+  {                                                                        \
+    return float(a) * float(b);                                            \
+  }                                                                        \
+  inline float operator/(T a, T b)                                         \
+  {                                                                        \
+    return float(a) / float(b);                                            \
+  }                                                                        \
+  inline float operator-(T a)                                              \
+  {                                                                        \
+    return -float(a);                                                      \
+  }
+
+    // clang-format off
+    half_arithmetic_operators(half)
+    half_arithmetic_operators(bfloat16)
+    // clang-format on
+#undef half_arithmetic_operators
+
+  }  // namespace math
+
+  namespace traits {
+
+    template <>
+    struct is_vec_element<math::half>
+    {
+      const static bool value = true;
+    };
+
+    template <>
+    struct is_vec_element<math::bfloat16>
+    {
+      const static bool value = true;
+    };
+
+  }  // namespace traits
+
+  namespace math {
+
+    using vec2h = vec_t<half, 2>;
+    using vec3h = vec_t<half, 3>;
+    using vec4h = vec_t<half, 4>;
+
+    // Bulk conversion ////////////////////////////////////////////////////////
+
+    /* convert 'n' values from 'in' to 'out'; the arrays may not overlap */
+
+    inline void convert(const float *in, half *out, size_t n)
+    {
+      size_t i = 0;
+#if defined(__F16C__) && !defined(RKCOMMON_NO_SIMD)
+      for (; i + 8 <= n; i += 8) {
+        const __m128i h =
+            _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), h);
+      }
+#elif defined(__aarch64__) && !defined(RKCOMMON_NO_SIMD)
+      for (; i + 4 <= n; i += 4) {
+        const float16x4_t h = vcvt_f16_f32(vld1q_f32(in + i));
+        vst1_u16(reinterpret_cast<uint16_t *>(out + i),
+                 vreinterpret_u16_f16(h));
+      }
+#endif
+      for (; i < n; ++i)
+        out[i] = in[i];
+    }
+
+    inline void convert(const half *in, float *out, size_t n)
+    {
+      size_t i = 0;
+#if defined(__F16C__) && !defined(RKCOMMON_NO_SIMD)
+      for (; i + 8 <= n; i += 8) {
+        const __m128i h =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+      }
+#elif defined(__aarch64__) && !defined(RKCOMMON_NO_SIMD)
+      for (; i + 4 <= n; i += 4) {
+        const uint16x4_t h =
+            vld1_u16(reinterpret_cast<const uint16_t *>(in + i));
+        vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(h)));
+      }
+#endif
+      for (; i < n; ++i)
+        out[i] = in[i];
+    }
+
+    inline void convert(const float *in, bfloat16 *out, size_t n)
+    {
+      for (size_t i = 0; i < n; ++i)
+        out[i] = in[i];
+    }
+
+    inline void convert(const bfloat16 *in, float *out, size_t n)
+    {
+      for (size_t i = 0; i < n; ++i)
+        out[i] = in[i];
+    }
+
+  }  // namespace math
+}  // namespace rkcommon
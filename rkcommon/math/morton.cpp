@@ -0,0 +1,364 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "morton.h"
+#include "dispatch.h"
+#include "../tasking/parallel_for.h"
+#include "packet.h"
+
+namespace rkcommon {
+  namespace math {
+
+    // elements per parallel task
+    static constexpr size_t MORTON_CHUNK_SIZE = 16 * 1024;
+
+    namespace {
+
+      /* Quantization runs on vfloat<W> packets; the 32-bit codes are then
+         interleaved with the magic-bit shifts on integer registers, 8 lanes
+         with AVX2 and 4 with SSE2 (or NEON through sse2neon). The lanes of
+         64-bit codes are encoded one by one with mortonEncode64(). */
+
+#if defined(__AVX2__) && !defined(RKCOMMON_NO_SIMD)
+      constexpr int W = 8;
+
+      struct vuint
+      {
+        __m256i v;
+      };
+
+      inline vuint toUInt(const vfloat<W> &f)
+      {
+        return {_mm256_cvttps_epi32(f.v)};
+      }
+
+      inline vuint operator|(vuint a, vuint b)
+      {
+        return {_mm256_or_si256(a.v, b.v)};
+      }
+
+      inline vuint operator&(vuint a, uint32_t mask)
+      {
+        return {_mm256_and_si256(a.v, _mm256_set1_epi32(int(mask)))};
+      }
+
+      inline vuint operator<<(vuint a, int shift)
+      {
+        return {_mm256_slli_epi32(a.v, shift)};
+      }
+
+      inline void storeu(uint32_t *ptr, vuint a)
+      {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(ptr), a.v);
+      }
+#elif defined(RKCOMMON_PACKET_SSE)
+      constexpr int W = 4;
+
+      struct vuint
+      {
+        __m128i v;
+      };
+
+      inline vuint toUInt(const vfloat<W> &f)
+      {
+        return {_mm_cvttps_epi32(f.v)};
+      }
+
+      inline vuint operator|(vuint a, vuint b)
+      {
+        return {_mm_or_si128(a.v, b.v)};
+      }
+
+      inline vuint operator&(vuint a, uint32_t mask)
+      {
+        return {_mm_and_si128(a.v, _mm_set1_epi32(int(mask)))};
+      }
+
+      inline vuint operator<<(vuint a, int shift)
+      {
+        return {_mm_slli_epi32(a.v, shift)};
+      }
+
+      inline void storeu(uint32_t *ptr, vuint a)
+      {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), a.v);
+      }
+#else
+      constexpr int W = 4;
+
+      // per-lane fallback with the same interface
+      struct vuint
+      {
+        uint32_t v[W];
+      };
+
+      inline vuint toUInt(const vfloat<W> &f)
+      {
+        vuint r;
+        for (int i = 0; i < W; ++i)
+          r.v[i] = uint32_t(f[i]);
+        return r;
+      }
+
+      inline vuint operator|(vuint a, vuint b)
+      {
+        for (int i = 0; i < W; ++i)
+          a.v[i] |= b.v[i];
+        return a;
+      }
+
+      inline vuint operator&(vuint a, uint32_t mask)
+      {
+        for (int i = 0; i < W; ++i)
+          a.v[i] &= mask;
+        return a;
+      }
+
+      inline vuint operator<<(vuint a, int shift)
+      {
+        for (int i = 0; i < W; ++i)
+          a.v[i] <<= shift;
+        return a;
+      }
+
+      inline void storeu(uint32_t *ptr, vuint a)
+      {
+        for (int i = 0; i < W; ++i)
+          ptr[i] = a.v[i];
+      }
+#endif
+
+      // detail::part1By2() for all lanes
+      inline vuint part1By2(vuint v)
+      {
+        v = (v | (v << 16)) & 0xff0000ffu;
+        v = (v | (v << 8)) & 0x0300f00fu;
+        v = (v | (v << 4)) & 0x030c30c3u;
+        v = (v | (v << 2)) & 0x09249249u;
+        return v;
+      }
+
+      // quantize() with the per-box values hoisted out of the loop
+      struct Quantizer
+      {
+        Quantizer(const box3f &bounds, int bits)
+            : lower(bounds.lower), cells(float(1u << bits))
+        {
+          const vec3f size = bounds.size();
+          scale.x          = detail::quantizeScale(size.x, cells);
+          scale.y          = detail::quantizeScale(size.y, cells);
+          scale.z          = detail::quantizeScale(size.z, cells);
+        }
+
+        vfloat<W> axis(const vfloat<W> &v, float lo, float s) const
+        {
+          const vfloat<W> q = max((v - lo) * s, vfloat<W>(0.f));
+          return min(q, vfloat<W>(cells - 1.f));
+        }
+
+        vec3f lower;
+        vec3f scale;
+        float cells;
+      };
+
+    }  // namespace
+
+    template <typename INPUT_T>
+    static inline vec3vf<W> gather(const INPUT_T &in, size_t begin)
+    {
+      vec3vf<W> r;
+      for (int i = 0; i < W; ++i) {
+        const vec3f &v = in[begin + i];
+        r.x[i]         = v.x;
+        r.y[i]         = v.y;
+        r.z[i]         = v.z;
+      }
+      return r;
+    }
+
+    template <typename INPUT_T>
+    static void mortonRange(const Quantizer &q,
+                            const INPUT_T &points,
+                            uint32_t *codes,
+                            size_t begin,
+                            size_t end)
+    {
+      size_t i = begin;
+      for (; i + W <= end; i += W) {
+        const vec3vf<W> p = gather(points, i);
+        const vuint x     = toUInt(q.axis(p.x, q.lower.x, q.scale.x));
+        const vuint y     = toUInt(q.axis(p.y, q.lower.y, q.scale.y));
+        const vuint z     = toUInt(q.axis(p.z, q.lower.z, q.scale.z));
+        storeu(codes + i,
+               part1By2(x) | (part1By2(y) << 1) | (part1By2(z) << 2));
+      }
+
+      for (; i < end; ++i) {
+        const vec3f &p = points[i];
+        codes[i]       = mortonEncode(vec3ui(
+            detail::quantizeAxis(p.x, q.lower.x, q.scale.x, q.cells),
+            detail::quantizeAxis(p.y, q.lower.y, q.scale.y, q.cells),
+            detail::quantizeAxis(p.z, q.lower.z, q.scale.z, q.cells)));
+      }
+    }
+
+    template <typename INPUT_T>
+    static void mortonRange(const Quantizer &q,
+                            const INPUT_T &points,
+                            uint64_t *codes,
+                            size_t begin,
+                            size_t end)
+    {
+      size_t i = begin;
+      for (; i + W <= end; i += W) {
+        const vec3vf<W> p = gather(points, i);
+        uint32_t x[W], y[W], z[W];
+        storeu(x, toUInt(q.axis(p.x, q.lower.x, q.scale.x)));
+        storeu(y, toUInt(q.axis(p.y, q.lower.y, q.scale.y)));
+        storeu(z, toUInt(q.axis(p.z, q.lower.z, q.scale.z)));
+        for (int l = 0; l < W; ++l)
+          codes[i + l] = mortonEncode64(vec3ui(x[l], y[l], z[l]));
+      }
+
+      for (; i < end; ++i) {
+        const vec3f &p = points[i];
+        codes[i]       = mortonEncode64(vec3ui(
+            detail::quantizeAxis(p.x, q.lower.x, q.scale.x, q.cells),
+            detail::quantizeAxis(p.y, q.lower.y, q.scale.y, q.cells),
+            detail::quantizeAxis(p.z, q.lower.z, q.scale.z, q.cells)));
+      }
+    }
+
+    template <typename INPUT_T, typename CODE_T>
+    static void mortonCodesImpl(const box3f &bounds,
+                                const INPUT_T &points,
+                                CODE_T *codes,
+                                size_t n,
+                                bool parallel)
+    {
+      const Quantizer q(bounds, sizeof(CODE_T) == 8 ? 21 : 10);
+
+      if (!parallel || n < MORTON_PARALLEL_THRESHOLD) {
+        mortonRange(q, points, codes, 0, n);
+        return;
+      }
+
+      tasking::parallel_for(divRoundUp(n, MORTON_CHUNK_SIZE), [&](size_t c) {
+        const size_t begin = c * MORTON_CHUNK_SIZE;
+        mortonRange(
+            q, points, codes, begin, std::min(n, begin + MORTON_CHUNK_SIZE));
+      });
+    }
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      void mortonCodes(const box3f &bounds,
+                       const vec3f *points,
+                       uint32_t *codes,
+                       size_t n,
+                       bool parallel)
+      {
+        mortonCodesImpl(bounds, points, codes, n, parallel);
+      }
+
+      void mortonCodes(const box3f &bounds,
+                       const utility::DataView<vec3f> &points,
+                       uint32_t *codes,
+                       size_t n,
+                       bool parallel)
+      {
+        mortonCodesImpl(bounds, points, codes, n, parallel);
+      }
+
+      void mortonCodes(const box3f &bounds,
+                       const vec3f *points,
+                       uint64_t *codes,
+                       size_t n,
+                       bool parallel)
+      {
+        mortonCodesImpl(bounds, points, codes, n, parallel);
+      }
+
+      void mortonCodes(const box3f &bounds,
+                       const utility::DataView<vec3f> &points,
+                       uint64_t *codes,
+                       size_t n,
+                       bool parallel)
+      {
+        mortonCodesImpl(bounds, points, codes, n, parallel);
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // morton.h definitions ////////////////////////////////////////////////////
+
+    using Morton32Fcn = void(
+        const box3f &, const vec3f *, uint32_t *, size_t, bool);
+    using Morton32ViewFcn = void(const box3f &,
+                                 const utility::DataView<vec3f> &,
+                                 uint32_t *,
+                                 size_t,
+                                 bool);
+    using Morton64Fcn = void(
+        const box3f &, const vec3f *, uint64_t *, size_t, bool);
+    using Morton64ViewFcn = void(const box3f &,
+                                 const utility::DataView<vec3f> &,
+                                 uint64_t *,
+                                 size_t,
+                                 bool);
+
+    RKCOMMON_ISA_DECLARE(Morton32Fcn mortonCodes)
+    RKCOMMON_ISA_DECLARE(Morton32ViewFcn mortonCodes)
+    RKCOMMON_ISA_DECLARE(Morton64Fcn mortonCodes)
+    RKCOMMON_ISA_DECLARE(Morton64ViewFcn mortonCodes)
+
+    void mortonCodes(const box3f &bounds,
+                     const vec3f *points,
+                     uint32_t *codes,
+                     size_t n,
+                     bool parallel)
+    {
+      static Morton32Fcn *const fcn =
+          RKCOMMON_ISA_SELECT(Morton32Fcn, mortonCodes);
+      fcn(bounds, points, codes, n, parallel);
+    }
+
+    void mortonCodes(const box3f &bounds,
+                     const utility::DataView<vec3f> &points,
+                     uint32_t *codes,
+                     size_t n,
+                     bool parallel)
+    {
+      static Morton32ViewFcn *const fcn =
+          RKCOMMON_ISA_SELECT(Morton32ViewFcn, mortonCodes);
+      fcn(bounds, points, codes, n, parallel);
+    }
+
+    void mortonCodes(const box3f &bounds,
+                     const vec3f *points,
+                     uint64_t *codes,
+                     size_t n,
+                     bool parallel)
+    {
+      static Morton64Fcn *const fcn =
+          RKCOMMON_ISA_SELECT(Morton64Fcn, mortonCodes);
+      fcn(bounds, points, codes, n, parallel);
+    }
+
+    void mortonCodes(const box3f &bounds,
+                     const utility::DataView<vec3f> &points,
+                     uint64_t *codes,
+                     size_t n,
+                     bool parallel)
+    {
+      static Morton64ViewFcn *const fcn =
+          RKCOMMON_ISA_SELECT(Morton64ViewFcn, mortonCodes);
+      fcn(bounds, points, codes, n, parallel);
+    }
+#endif
+
+  }  // namespace math
+}  // namespace rkcommon
@@ -0,0 +1,501 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "box.h"
+#include "../utility/DataView.h"
+// std
+#include <cstdint>
+
+#if defined(__BMI2__) && (defined(__x86_64__) || defined(_M_X64)) && \
+    !defined(RKCOMMON_NO_SIMD)
+#define RKCOMMON_MORTON_BMI2
+#include <immintrin.h>
+#endif
+
+/* Space-filling curve codes for BVH builds, bricked volume layouts and
+   cache-coherent tile orders.
+
+   Morton (Z-order) codes interleave the coordinate bits: bit i of x, y and
+   z goes to bit 3i, 3i+1 and 3i+2 of a 3D code (2i and 2i+1 in 2D). 32-bit
+   codes hold 16 bits per axis in 2D and 10 in 3D, 64-bit codes 32 and 21.
+   Higher coordinate bits are ignored. The bit deposit/extract uses BMI2
+   pdep/pext when the including translation unit is compiled with it (e.g.
+   -mbmi2 or -march=haswell), and the usual magic-bit shifts otherwise.
+   Note that pdep/pext are microcoded and slow on AMD CPUs before Zen 3.
+
+   Hilbert codes (Skilling's algorithm) order the same 2^bits cells per axis
+   so that consecutive codes are always neighboring cells, at several times
+   the cost of a Morton code.
+
+   quantize() maps points to the integer grid of a box, and mortonCodes()
+   quantizes and encodes whole arrays a SIMD packet at a time. */
+
+namespace rkcommon {
+  namespace math {
+
+    namespace detail {
+
+      // spread the low 16 bits of 'v' to the even bits
+      inline uint32_t part1By1(uint32_t v)
+      {
+        v &= 0x0000ffffu;
+        v = (v | (v << 8)) & 0x00ff00ffu;
+        v = (v | (v << 4)) & 0x0f0f0f0fu;
+        v = (v | (v << 2)) & 0x33333333u;
+        v = (v | (v << 1)) & 0x55555555u;
+        return v;
+      }
+
+      inline uint32_t compact1By1(uint32_t v)
+      {
+        v &= 0x55555555u;
+        v = (v | (v >> 1)) & 0x33333333u;
+        v = (v | (v >> 2)) & 0x0f0f0f0fu;
+        v = (v | (v >> 4)) & 0x00ff00ffu;
+        v = (v | (v >> 8)) & 0x0000ffffu;
+        return v;
+      }
+
+      // spread the low 10 bits of 'v' to every third bit
+      inline uint32_t part1By2(uint32_t v)
+      {
+        v &= 0x000003ffu;
+        v = (v | (v << 16)) & 0xff0000ffu;
+        v = (v | (v << 8)) & 0x0300f00fu;
+        v = (v | (v << 4)) & 0x030c30c3u;
+        v = (v | (v << 2)) & 0x09249249u;
+        return v;
+      }
+
+      inline uint32_t compact1By2(uint32_t v)
+      {
+        v &= 0x09249249u;
+        v = (v | (v >> 2)) & 0x030c30c3u;
+        v = (v | (v >> 4)) & 0x0300f00fu;
+        v = (v | (v >> 8)) & 0xff0000ffu;
+        v = (v | (v >> 16)) & 0x000003ffu;
+        return v;
+      }
+
+      // spread the low 32 bits of 'v' to the even bits
+      inline uint64_t part1By1(uint64_t v)
+      {
+        v &= 0x00000000ffffffffull;
+        v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+        v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+        v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & 0x5555555555555555ull;
+        return v;
+      }
+
+      inline uint64_t compact1By1(uint64_t v)
+      {
+        v &= 0x5555555555555555ull;
+        v = (v | (v >> 1)) & 0x3333333333333333ull;
+        v = (v | (v >> 2)) & 0x0f0f0f0f0f0f0f0full;
+        v = (v | (v >> 4)) & 0x00ff00ff00ff00ffull;
+        v = (v | (v >> 8)) & 0x0000ffff0000ffffull;
+        v = (v | (v >> 16)) & 0x00000000ffffffffull;
+        return v;
+      }
+
+      // spread the low 21 bits of 'v' to every third bit
+      inline uint64_t part1By2(uint64_t v)
+      {
+        v &= 0x00000000001fffffull;
+        v = (v | (v << 32)) & 0x001f00000000ffffull;
+        v = (v | (v << 16)) & 0x001f0000ff0000ffull;
+        v = (v | (v << 8)) & 0x100f00f00f00f00full;
+        v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+        v = (v | (v << 2)) & 0x1249249249249249ull;
+        return v;
+      }
+
+      inline uint64_t compact1By2(uint64_t v)
+      {
+        v &= 0x1249249249249249ull;
+        v = (v | (v >> 2)) & 0x10c30c30c30c30c3ull;
+        v = (v | (v >> 4)) & 0x100f00f00f00f00full;
+        v = (v | (v >> 8)) & 0x001f0000ff0000ffull;
+        v = (v | (v >> 16)) & 0x001f00000000ffffull;
+        v = (v | (v >> 32)) & 0x00000000001fffffull;
+        return v;
+      }
+
+      /* scatter the low bits of 'v' to the set bits of 'mask' (pdep) and
+         back (pext), for masks only known at runtime */
+      inline uint64_t depositBits(uint64_t v, uint64_t mask)
+      {
+#ifdef RKCOMMON_MORTON_BMI2
+        return _pdep_u64(v, mask);
+#else
+        uint64_t r = 0;
+        for (uint64_t bit = 1; mask; bit <<= 1) {
+          const uint64_t lowest = mask & (~mask + 1);
+          if (v & bit)
+            r |= lowest;
+          mask ^= lowest;
+        }
+        return r;
+#endif
+      }
+
+      inline uint64_t extractBits(uint64_t v, uint64_t mask)
+      {
+#ifdef RKCOMMON_MORTON_BMI2
+        return _pext_u64(v, mask);
+#else
+        uint64_t r = 0;
+        for (uint64_t bit = 1; mask; bit <<= 1) {
+          const uint64_t lowest = mask & (~mask + 1);
+          if (v & lowest)
+            r |= bit;
+          mask ^= lowest;
+        }
+        return r;
+#endif
+      }
+
+      /* Skilling, "Programming the Hilbert curve" (AIP 2004): converts
+         between coordinates and the Hilbert index "transposed" into N
+         words of 'bits' bits, whose interleaving is the index itself */
+      template <int N>
+      inline void axesToTranspose(uint32_t X[N], int bits)
+      {
+        const uint32_t M = 1u << (bits - 1);
+
+        // inverse undo
+        for (uint32_t Q = M; Q > 1; Q >>= 1) {
+          const uint32_t P = Q - 1;
+          for (int i = 0; i < N; ++i) {
+            if (X[i] & Q) {
+              X[0] ^= P;
+            } else {
+              const uint32_t t = (X[0] ^ X[i]) & P;
+              X[0] ^= t;
+              X[i] ^= t;
+            }
+          }
+        }
+
+        // Gray encode
+        for (int i = 1; i < N; ++i)
+          X[i] ^= X[i - 1];
+        uint32_t t = 0;
+        for (uint32_t Q = M; Q > 1; Q >>= 1)
+          if (X[N - 1] & Q)
+            t ^= Q - 1;
+        for (int i = 0; i < N; ++i)
+          X[i] ^= t;
+      }
+
+      template <int N>
+      inline void transposeToAxes(uint32_t X[N], int bits)
+      {
+        const uint64_t end = uint64_t(2) << (bits - 1);
+
+        // Gray decode
+        const uint32_t g = X[N - 1] >> 1;
+        for (int i = N - 1; i > 0; --i)
+          X[i] ^= X[i - 1];
+        X[0] ^= g;
+
+        // undo excess work
+        for (uint64_t Q = 2; Q != end; Q <<= 1) {
+          const uint32_t P = uint32_t(Q - 1);
+          for (int i = N - 1; i >= 0; --i) {
+            if (X[i] & Q) {
+              X[0] ^= P;
+            } else {
+              const uint32_t t = (X[0] ^ X[i]) & P;
+              X[0] ^= t;
+              X[i] ^= t;
+            }
+          }
+        }
+      }
+
+      inline float quantizeScale(float extent, float cells)
+      {
+        return extent > 0.f ? cells / extent : 0.f;
+      }
+
+      inline uint32_t quantizeAxis(float v,
+                                   float lower,
+                                   float scale,
+                                   float cells)
+      {
+        const float q = std::max((v - lower) * scale, 0.f);
+        return uint32_t(std::min(q, cells - 1.f));
+      }
+
+    }  // namespace detail
+
+    // Morton codes ///////////////////////////////////////////////////////////
+
+    inline uint32_t mortonEncode(const vec2ui &p)
+    {
+#ifdef RKCOMMON_MORTON_BMI2
+      return _pdep_u32(p.x, 0x55555555u) | _pdep_u32(p.y, 0xaaaaaaaau);
+#else
+      return detail::part1By1(p.x) | (detail::part1By1(p.y) << 1);
+#endif
+    }
+
+    inline uint32_t mortonEncode(const vec3ui &p)
+    {
+#ifdef RKCOMMON_MORTON_BMI2
+      return _pdep_u32(p.x, 0x09249249u) | _pdep_u32(p.y, 0x12492492u) |
+             _pdep_u32(p.z, 0x24924924u);
+#else
+      return detail::part1By2(p.x) | (detail::part1By2(p.y) << 1) |
+             (detail::part1By2(p.z) << 2);
+#endif
+    }
+
+    inline uint64_t mortonEncode64(const vec2ui &p)
+    {
+#ifdef RKCOMMON_MORTON_BMI2
+      return _pdep_u64(p.x, 0x5555555555555555ull) |
+             _pdep_u64(p.y, 0xaaaaaaaaaaaaaaaaull);
+#else
+      return detail::part1By1(uint64_t(p.x)) |
+             (detail::part1By1(uint64_t(p.y)) << 1);
+#endif
+    }
+
+    inline uint64_t mortonEncode64(const vec3ui &p)
+    {
+#ifdef RKCOMMON_MORTON_BMI2
+      return _pdep_u64(p.x, 0x1249249249249249ull) |
+             _pdep_u64(p.y, 0x2492492492492492ull) |
+             _pdep_u64(p.z, 0x4924924924924924ull);
+#else
+      return detail::part1By2(uint64_t(p.x)) |
+             (detail::part1By2(uint64_t(p.y)) << 1) |
+             (detail::part1By2(uint64_t(p.z)) << 2);
+#endif
+    }
+
+    /* mortonDecode<N>() inverts mortonEncode() of an N-dimensional point,
+       mortonDecode64<N>() inverts mortonEncode64() */
+    template <int N>
+    vec_t<uint32_t, N> mortonDecode(uint32_t code);
+
+    template <int N>
+    vec_t<uint32_t, N> mortonDecode64(uint64_t code);
+
+    template <>
+    inline vec2ui mortonDecode<2>(uint32_t code)
+    {
+#ifdef RKCOMMON_MORTON_BMI2
+      return vec2ui(_pext_u32(code, 0x55555555u),
+                    _pext_u32(code, 0xaaaaaaaau));
+#else
+      return vec2ui(detail::compact1By1(code), detail::compact1By1(code >> 1));
+#endif
+    }
+
+    template <>
+    inline vec3ui mortonDecode<3>(uint32_t code)
+    {
+#ifdef RKCOMMON_MORTON_BMI2
+      return vec3ui(_pext_u32(code, 0x09249249u),
+                    _pext_u32(code, 0x12492492u),
+                    _pext_u32(code, 0x24924924u));
+#else
+      return vec3ui(detail::compact1By2(code),
+                    detail::compact1By2(code >> 1),
+                    detail::compact1By2(code >> 2));
+#endif
+    }
+
+    template <>
+    inline vec2ui mortonDecode64<2>(uint64_t code)
+    {
+#ifdef RKCOMMON_MORTON_BMI2
+      return vec2ui(uint32_t(_pext_u64(code, 0x5555555555555555ull)),
+                    uint32_t(_pext_u64(code, 0xaaaaaaaaaaaaaaaaull)));
+#else
+      return vec2ui(uint32_t(detail::compact1By1(code)),
+                    uint32_t(detail::compact1By1(code >> 1)));
+#endif
+    }
+
+    template <>
+    inline vec3ui mortonDecode64<3>(uint64_t code)
+    {
+#ifdef RKCOMMON_MORTON_BMI2
+      return vec3ui(uint32_t(_pext_u64(code, 0x1249249249249249ull)),
+                    uint32_t(_pext_u64(code, 0x2492492492492492ull)),
+                    uint32_t(_pext_u64(code, 0x4924924924924924ull)));
+#else
+      return vec3ui(uint32_t(detail::compact1By2(code)),
+                    uint32_t(detail::compact1By2(code >> 1)),
+                    uint32_t(detail::compact1By2(code >> 2)));
+#endif
+    }
+
+    // Hilbert codes //////////////////////////////////////////////////////////
+
+    /* 'bits' is the number of bits per axis, at most 16 (2D) or 10 (3D)
+       for 32-bit codes and 32 or 21 for 64-bit codes */
+
+    inline uint32_t hilbertEncode(const vec2ui &p, int bits = 16)
+    {
+      const uint32_t mask = uint32_t((uint64_t(1) << bits) - 1);
+      uint32_t X[2]       = {p.x & mask, p.y & mask};
+      detail::axesToTranspose<2>(X, bits);
+      return mortonEncode(vec2ui(X[1], X[0]));
+    }
+
+    inline uint32_t hilbertEncode(const vec3ui &p, int bits = 10)
+    {
+      const uint32_t mask = (1u << bits) - 1;
+      uint32_t X[3]       = {p.x & mask, p.y & mask, p.z & mask};
+      detail::axesToTranspose<3>(X, bits);
+      return mortonEncode(vec3ui(X[2], X[1], X[0]));
+    }
+
+    inline uint64_t hilbertEncode64(const vec2ui &p, int bits = 32)
+    {
+      const uint32_t mask = uint32_t((uint64_t(1) << bits) - 1);
+      uint32_t X[2]       = {p.x & mask, p.y & mask};
+      detail::axesToTranspose<2>(X, bits);
+      return mortonEncode64(vec2ui(X[1], X[0]));
+    }
+
+    inline uint64_t hilbertEncode64(const vec3ui &p, int bits = 21)
+    {
+      const uint32_t mask = (1u << bits) - 1;
+      uint32_t X[3]       = {p.x & mask, p.y & mask, p.z & mask};
+      detail::axesToTranspose<3>(X, bits);
+      return mortonEncode64(vec3ui(X[2], X[1], X[0]));
+    }
+
+    /* hilbertDecode<N>() inverts hilbertEncode() of an N-dimensional point,
+       hilbertDecode64<N>() inverts hilbertEncode64() */
+    template <int N>
+    vec_t<uint32_t, N> hilbertDecode(uint32_t code,
+                                     int bits = N == 2 ? 16 : 10);
+
+    template <int N>
+    vec_t<uint32_t, N> hilbertDecode64(uint64_t code,
+                                       int bits = N == 2 ? 32 : 21);
+
+    template <>
+    inline vec2ui hilbertDecode<2>(uint32_t code, int bits)
+    {
+      const vec2ui t = mortonDecode<2>(code);
+      uint32_t X[2]  = {t.y, t.x};
+      detail::transposeToAxes<2>(X, bits);
+      return vec2ui(X[0], X[1]);
+    }
+
+    template <>
+    inline vec3ui hilbertDecode<3>(uint32_t code, int bits)
+    {
+      const vec3ui t = mortonDecode<3>(code);
+      uint32_t X[3]  = {t.z, t.y, t.x};
+      detail::transposeToAxes<3>(X, bits);
+      return vec3ui(X[0], X[1], X[2]);
+    }
+
+    template <>
+    inline vec2ui hilbertDecode64<2>(uint64_t code, int bits)
+    {
+      const vec2ui t = mortonDecode64<2>(code);
+      uint32_t X[2]  = {t.y, t.x};
+      detail::transposeToAxes<2>(X, bits);
+      return vec2ui(X[0], X[1]);
+    }
+
+    template <>
+    inline vec3ui hilbertDecode64<3>(uint64_t code, int bits)
+    {
+      const vec3ui t = mortonDecode64<3>(code);
+      uint32_t X[3]  = {t.z, t.y, t.x};
+      detail::transposeToAxes<3>(X, bits);
+      return vec3ui(X[0], X[1], X[2]);
+    }
+
+    // Quantization ///////////////////////////////////////////////////////////
+
+    /* maps 'p' to one of the 2^bits cells per axis of 'bounds' (bits <= 24);
+       points outside are clamped, and flat axes map to cell 0 */
+
+    inline vec2ui quantize(const vec2f &p, const box2f &bounds, int bits)
+    {
+      const float cells = float(1u << bits);
+      const vec2f size  = bounds.size();
+      return vec2ui(
+          detail::quantizeAxis(p.x,
+                               bounds.lower.x,
+                               detail::quantizeScale(size.x, cells),
+                               cells),
+          detail::quantizeAxis(p.y,
+                               bounds.lower.y,
+                               detail::quantizeScale(size.y, cells),
+                               cells));
+    }
+
+    inline vec3ui quantize(const vec3f &p, const box3f &bounds, int bits)
+    {
+      const float cells = float(1u << bits);
+      const vec3f size  = bounds.size();
+      return vec3ui(
+          detail::quantizeAxis(p.x,
+                               bounds.lower.x,
+                               detail::quantizeScale(size.x, cells),
+                               cells),
+          detail::quantizeAxis(p.y,
+                               bounds.lower.y,
+                               detail::quantizeScale(size.y, cells),
+                               cells),
+          detail::quantizeAxis(p.z,
+                               bounds.lower.z,
+                               detail::quantizeScale(size.z, cells),
+                               cells));
+    }
+
+    // Batch encoding /////////////////////////////////////////////////////////
+
+    /* codes[i] = mortonEncode(quantize(points[i], bounds, 10)), or with 21
+       bits and mortonEncode64() for 64-bit codes. 'bounds' usually is the
+       centroid bounds from computeBounds(). With 'parallel' arrays of at
+       least MORTON_PARALLEL_THRESHOLD points are split across
+       tasking::parallel_for(). */
+
+    constexpr size_t MORTON_PARALLEL_THRESHOLD = 64 * 1024;
+
+    RKCOMMON_INTERFACE void mortonCodes(const box3f &bounds,
+                                        const vec3f *points,
+                                        uint32_t *codes,
+                                        size_t n,
+                                        bool parallel = true);
+
+    RKCOMMON_INTERFACE void mortonCodes(
+        const box3f &bounds,
+        const utility::DataView<vec3f> &points,
+        uint32_t *codes,
+        size_t n,
+        bool parallel = true);
+
+    RKCOMMON_INTERFACE void mortonCodes(const box3f &bounds,
+                                        const vec3f *points,
+                                        uint64_t *codes,
+                                        size_t n,
+                                        bool parallel = true);
+
+    RKCOMMON_INTERFACE void mortonCodes(
+        const box3f &bounds,
+        const utility::DataView<vec3f> &points,
+        uint64_t *codes,
+        size_t n,
+        bool parallel = true);
+
+  }  // namespace math
+}  // namespace rkcommon
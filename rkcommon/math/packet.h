@@ -0,0 +1,1771 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "AffineSpace.h"
+// std
+#include <cstdint>
+#include <ostream>
+
+/* SIMD packet types: vfloat<W> holds W floats, vbool<W> the matching lane
+   mask. They compute W independent lanes, so vec3vf<W> and box3vf<W> are
+   W vectors/boxes in SoA layout, used like 'varying' in the ISPC headers.
+
+   Back-ends: SSE (and NEON through sse2neon) for W == 4, AVX for W == 8
+   and AVX-512 for W == 16, each picked by the compiler flags of the
+   including translation unit. Any other width, or a width the target
+   does not support, uses the portable per-lane fallback, which is also
+   the only implementation with RKCOMMON_NO_SIMD. */
+
+#ifndef RKCOMMON_NO_SIMD
+#define RKCOMMON_PACKET_SSE
+#if defined(__AVX__)
+#define RKCOMMON_PACKET_AVX
+#endif
+#if defined(__AVX512F__)
+#define RKCOMMON_PACKET_AVX512
+#endif
+#if !defined(_WIN32) && !defined(__ARM_NEON)
+#if defined(RKCOMMON_PACKET_AVX) || defined(RKCOMMON_PACKET_AVX512)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#endif
+#endif
+
+/* The packet types and everything built on them live in an inline namespace
+   named after the target: their layouts and code differ between translation
+   units compiled for different instruction sets, such as the library's
+   multi-versioned kernels (see dispatch.h) and the including application,
+   so they must not share symbols. */
+#if defined(RKCOMMON_NO_SIMD)
+#define RKCOMMON_PACKET_NAMESPACE packet_scalar
+#elif defined(__AVX512F__)
+#define RKCOMMON_PACKET_NAMESPACE packet_avx512
+#elif defined(__AVX2__)
+#define RKCOMMON_PACKET_NAMESPACE packet_avx2
+#elif defined(__AVX__)
+#define RKCOMMON_PACKET_NAMESPACE packet_avx
+#elif defined(__SSE4_1__)
+#define RKCOMMON_PACKET_NAMESPACE packet_sse41
+#elif defined(__ARM_NEON)
+#define RKCOMMON_PACKET_NAMESPACE packet_neon
+#else
+#define RKCOMMON_PACKET_NAMESPACE packet_sse2
+#endif
+
+namespace rkcommon {
+  namespace math {
+    inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+      // the widest packet the target computes in a single register
+#if defined(RKCOMMON_PACKET_AVX512)
+      constexpr int NATIVE_PACKET_WIDTH = 16;
+#elif defined(RKCOMMON_PACKET_AVX)
+      constexpr int NATIVE_PACKET_WIDTH = 8;
+#elif defined(RKCOMMON_PACKET_SSE)
+      constexpr int NATIVE_PACKET_WIDTH = 4;
+#else
+      constexpr int NATIVE_PACKET_WIDTH = 1;
+#endif
+
+      // Portable fallback /////////////////////////////////////////////////////
+
+      template <int W>
+      struct vbool
+      {
+        static_assert(W > 0 && W <= 32 && (W & (W - 1)) == 0,
+                      "packet width must be a power of two up to 32");
+
+        static constexpr int size = W;
+
+        vbool() = default;
+
+        vbool(bool b)
+        {
+          for (int i = 0; i < W; ++i)
+            m[i] = b;
+        }
+
+        bool operator[](int i) const
+        {
+          return m[i];
+        }
+
+        bool m[W];
+      };
+
+      template <int W>
+      struct alignas(W * sizeof(float)) vfloat
+      {
+        static_assert(W > 0 && W <= 32 && (W & (W - 1)) == 0,
+                      "packet width must be a power of two up to 32");
+
+        static constexpr int size = W;
+
+        vfloat() = default;
+
+        vfloat(float s)
+        {
+          for (int i = 0; i < W; ++i)
+            f[i] = s;
+        }
+
+        float operator[](int i) const
+        {
+          return f[i];
+        }
+
+        float &operator[](int i)
+        {
+          return f[i];
+        }
+
+        // 'ptr' must be aligned to the packet size
+        static vfloat load(const float *ptr);
+        static vfloat loadu(const float *ptr);
+        // inactive lanes are zero and their memory is not read
+        static vfloat loadu(const vbool<W> &mask, const float *ptr);
+
+        static void store(float *ptr, const vfloat &v);
+        static void storeu(float *ptr, const vfloat &v);
+        // only active lanes are written
+        static void storeu(const vbool<W> &mask, float *ptr, const vfloat &v);
+
+        float f[W];
+      };
+
+    }  // namespace RKCOMMON_PACKET_NAMESPACE
+  }  // namespace math
+
+  namespace traits {
+
+    template <int W>
+    struct is_vec_element<math::vfloat<W>>
+    {
+      const static bool value = true;
+    };
+
+  }  // namespace traits
+
+  namespace math {
+    inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+      // Inlined members ///////////////////////////////////////////////////////
+
+      template <int W>
+      inline vfloat<W> vfloat<W>::load(const float *ptr)
+      {
+        return loadu(ptr);
+      }
+
+      template <int W>
+      inline vfloat<W> vfloat<W>::loadu(const float *ptr)
+      {
+        vfloat r;
+        for (int i = 0; i < W; ++i)
+          r.f[i] = ptr[i];
+        return r;
+      }
+
+      template <int W>
+      inline vfloat<W> vfloat<W>::loadu(const vbool<W> &mask, const float *ptr)
+      {
+        vfloat r(0.f);
+        for (int i = 0; i < W; ++i)
+          if (mask[i])
+            r.f[i] = ptr[i];
+        return r;
+      }
+
+      template <int W>
+      inline void vfloat<W>::store(float *ptr, const vfloat &v)
+      {
+        storeu(ptr, v);
+      }
+
+      template <int W>
+      inline void vfloat<W>::storeu(float *ptr, const vfloat &v)
+      {
+        for (int i = 0; i < W; ++i)
+          ptr[i] = v.f[i];
+      }
+
+      template <int W>
+      inline void vfloat<W>::storeu(const vbool<W> &mask,
+                                    float *ptr,
+                                    const vfloat &v)
+      {
+        for (int i = 0; i < W; ++i)
+          if (mask[i])
+            ptr[i] = v.f[i];
+      }
+
+      // Fallback free functions ///////////////////////////////////////////////
+
+      /* The back-ends below add non-template overloads for the (packet,
+         packet) forms, which take precedence over these templates. The
+         mixed scalar forms always forward to them. */
+
+#define packet_binary_operator(name, op)                                 \
+    template <int W>                                                       \
+    inline vfloat<W> name(const vfloat<W> &a, const vfloat<W> &b)          \
+    {                                                                      \
+      vfloat<W> r;                                                         \
+      for (int i = 0; i < W; ++i)                                          \
+        r.f[i] = a.f[i] op b.f[i];                                         \
+      return r;                                                            \
+    }                                                                      \
+    template <int W>                                                       \
+    inline vfloat<W> name(const vfloat<W> &a, const float &b)              \
+    {                                                                      \
+      return a op vfloat<W>(b);                                            \
+    }                                                                      \
+    template <int W>                                                       \
+    inline vfloat<W> name(const float &a, const vfloat<W> &b)              \
+    {                                                                      \
+      return vfloat<W>(a) op b;                                            \
+    }                                                                      \
+    template <int W>                                                       \
+    inline vfloat<W> &name##=(vfloat<W> &a, const vfloat<W> &b)            \
+    {                                                                      \
+      return a = a op b;                                                   \
+    }                                                                      \
+    template <int W>                                                       \
+    inline vfloat<W> &name##=(vfloat<W> &a, const float &b)                \
+    {                                                                      \
+      return a = a op vfloat<W>(b);                                        \
+    }
+
+      // clang-format off
+      packet_binary_operator(operator+, +)
+      packet_binary_operator(operator-, -)
+      packet_binary_operator(operator*, *)
+      packet_binary_operator(operator/, /)
+      // clang-format on
+#undef packet_binary_operator
+
+#define packet_compare_operator(name, op)                                \
+    template <int W>                                                       \
+    inline vbool<W> name(const vfloat<W> &a, const vfloat<W> &b)           \
+    {                                                                      \
+      vbool<W> r;                                                          \
+      for (int i = 0; i < W; ++i)                                          \
+        r.m[i] = a.f[i] op b.f[i];                                         \
+      return r;                                                            \
+    }                                                                      \
+    template <int W>                                                       \
+    inline vbool<W> name(const vfloat<W> &a, const float &b)               \
+    {                                                                      \
+      return a op vfloat<W>(b);                                            \
+    }                                                                      \
+    template <int W>                                                       \
+    inline vbool<W> name(const float &a, const vfloat<W> &b)               \
+    {                                                                      \
+      return vfloat<W>(a) op b;                                            \
+    }
+
+      // clang-format off
+      packet_compare_operator(operator<, <)
+      packet_compare_operator(operator<=, <=)
+      packet_compare_operator(operator>, >)
+      packet_compare_operator(operator>=, >=)
+      packet_compare_operator(operator==, ==)
+      packet_compare_operator(operator!=, !=)
+      // clang-format on
+#undef packet_compare_operator
+
+#define packet_mask_operator(name, op)                             \
+    template <int W>                                                 \
+    inline vbool<W> name(const vbool<W> &a, const vbool<W> &b)       \
+    {                                                                \
+      vbool<W> r;                                                    \
+      for (int i = 0; i < W; ++i)                                    \
+        r.m[i] = a.m[i] op b.m[i];                                   \
+      return r;                                                      \
+    }
+
+      // clang-format off
+      packet_mask_operator(operator&, &&)
+      packet_mask_operator(operator|, ||)
+      packet_mask_operator(operator^, !=)
+      // clang-format on
+#undef packet_mask_operator
+
+      template <int W>
+      inline vbool<W> operator!(const vbool<W> &a)
+      {
+        vbool<W> r;
+        for (int i = 0; i < W; ++i)
+          r.m[i] = !a.m[i];
+        return r;
+      }
+
+      /*! bit i is set if lane i is active */
+      template <int W>
+      inline uint32_t movemask(const vbool<W> &a)
+      {
+        uint32_t r = 0;
+        for (int i = 0; i < W; ++i)
+          r |= uint32_t(a.m[i]) << i;
+        return r;
+      }
+
+      template <int W>
+      inline bool any(const vbool<W> &a)
+      {
+        return movemask(a) != 0;
+      }
+
+      template <int W>
+      inline bool all(const vbool<W> &a)
+      {
+        return movemask(a) == (uint32_t(-1) >> (32 - W));
+      }
+
+      template <int W>
+      inline bool none(const vbool<W> &a)
+      {
+        return movemask(a) == 0;
+      }
+
+      /*! number of active lanes */
+      template <int W>
+      inline int popcnt(const vbool<W> &a)
+      {
+        int count = 0;
+        for (uint32_t bits = movemask(a); bits; bits &= bits - 1)
+          ++count;
+        return count;
+      }
+
+#define packet_unary_functor(name, expr)                         \
+    template <int W>                                               \
+    inline vfloat<W> name(const vfloat<W> &a)                      \
+    {                                                              \
+      vfloat<W> r;                                                 \
+      for (int i = 0; i < W; ++i)                                  \
+        r.f[i] = expr(a.f[i]);                                     \
+      return r;                                                    \
+    }
+
+      // clang-format off
+      packet_unary_functor(operator-, -)
+      packet_unary_functor(abs, std::abs)
+      packet_unary_functor(sqrt, std::sqrt)
+      packet_unary_functor(rcp, math::rcp)
+      packet_unary_functor(rsqrt, math::rsqrt)
+      // clang-format on
+#undef packet_unary_functor
+
+      template <int W>
+      inline vfloat<W> min(const vfloat<W> &a, const vfloat<W> &b)
+      {
+        vfloat<W> r;
+        for (int i = 0; i < W; ++i)
+          r.f[i] = b.f[i] < a.f[i] ? b.f[i] : a.f[i];
+        return r;
+      }
+
+      template <int W>
+      inline vfloat<W> max(const vfloat<W> &a, const vfloat<W> &b)
+      {
+        vfloat<W> r;
+        for (int i = 0; i < W; ++i)
+          r.f[i] = a.f[i] < b.f[i] ? b.f[i] : a.f[i];
+        return r;
+      }
+
+      /*! per lane: 'mask' ? 't' : 'f' */
+      template <int W>
+      inline vfloat<W> select(const vbool<W> &mask,
+                              const vfloat<W> &t,
+                              const vfloat<W> &f)
+      {
+        vfloat<W> r;
+        for (int i = 0; i < W; ++i)
+          r.f[i] = mask[i] ? t.f[i] : f.f[i];
+        return r;
+      }
+
+      template <int W>
+      inline vfloat<W> madd(const vfloat<W> &a,
+                            const vfloat<W> &b,
+                            const vfloat<W> &c)
+      {
+        return a * b + c;
+      }
+
+      template <int W>
+      inline vfloat<W> rcp_safe(const vfloat<W> &a)
+      {
+        const float flt_min    = std::numeric_limits<float>::min();
+        const vfloat<W> tiny = select(
+            a >= 0.f, vfloat<W>(flt_min), vfloat<W>(-flt_min));
+        return rcp(select(abs(a) < flt_min, tiny, a));
+      }
+
+      template <int W>
+      inline float reduce_add(const vfloat<W> &a)
+      {
+        float r = a.f[0];
+        for (int i = 1; i < W; ++i)
+          r += a.f[i];
+        return r;
+      }
+
+      template <int W>
+      inline float reduce_min(const vfloat<W> &a)
+      {
+        float r = a.f[0];
+        for (int i = 1; i < W; ++i)
+          r = std::min(r, a.f[i]);
+        return r;
+      }
+
+      template <int W>
+      inline float reduce_max(const vfloat<W> &a)
+      {
+        float r = a.f[0];
+        for (int i = 1; i < W; ++i)
+          r = std::max(r, a.f[i]);
+        return r;
+      }
+
+      template <int W>
+      inline std::ostream &operator<<(std::ostream &o, const vfloat<W> &v)
+      {
+        o << "<" << v[0];
+        for (int i = 1; i < W; ++i)
+          o << "," << v[i];
+        o << ">";
+        return o;
+      }
+
+      template <int W>
+      inline std::ostream &operator<<(std::ostream &o, const vbool<W> &m)
+      {
+        o << "<" << m[0];
+        for (int i = 1; i < W; ++i)
+          o << "," << m[i];
+        o << ">";
+        return o;
+      }
+
+#ifdef RKCOMMON_PACKET_SSE
+      // SSE back-end (NEON through sse2neon) //////////////////////////////////
+
+      template <>
+      struct vbool<4>
+      {
+        static constexpr int size = 4;
+
+        vbool() = default;
+
+        vbool(__m128 v) : v(v) {}
+
+        vbool(bool b) : v(_mm_castsi128_ps(_mm_set1_epi32(b ? -1 : 0))) {}
+
+        bool operator[](int i) const
+        {
+          return (_mm_movemask_ps(v) >> i) & 1;
+        }
+
+        __m128 v;
+      };
+
+      template <>
+      struct vfloat<4>
+      {
+        static constexpr int size = 4;
+
+        vfloat() = default;
+
+        vfloat(__m128 v) : v(v) {}
+
+        vfloat(float s) : v(_mm_set1_ps(s)) {}
+
+        float operator[](int i) const
+        {
+          return f[i];
+        }
+
+        float &operator[](int i)
+        {
+          return f[i];
+        }
+
+        static vfloat load(const float *ptr)
+        {
+          return _mm_load_ps(ptr);
+        }
+
+        static vfloat loadu(const float *ptr)
+        {
+          return _mm_loadu_ps(ptr);
+        }
+
+        static vfloat loadu(const vbool<4> &mask, const float *ptr)
+        {
+#ifdef RKCOMMON_PACKET_AVX
+          return _mm_maskload_ps(ptr, _mm_castps_si128(mask.v));
+#else
+          vfloat r(0.f);
+          for (int i = 0; i < 4; ++i)
+            if (mask[i])
+              r.f[i] = ptr[i];
+          return r;
+#endif
+        }
+
+        static void store(float *ptr, const vfloat &v)
+        {
+          _mm_store_ps(ptr, v.v);
+        }
+
+        static void storeu(float *ptr, const vfloat &v)
+        {
+          _mm_storeu_ps(ptr, v.v);
+        }
+
+        static void storeu(const vbool<4> &mask, float *ptr, const vfloat &v)
+        {
+#ifdef RKCOMMON_PACKET_AVX
+          _mm_maskstore_ps(ptr, _mm_castps_si128(mask.v), v.v);
+#else
+          for (int i = 0; i < 4; ++i)
+            if (mask[i])
+              ptr[i] = v.f[i];
+#endif
+        }
+
+        union
+        {
+          __m128 v;
+          float f[4];
+        };
+      };
+
+    }  // namespace RKCOMMON_PACKET_NAMESPACE
+
+    namespace detail {
+      inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+        __forceinline __m128 hadd4(__m128 v)
+        {
+          v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+          return _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        }
+
+        __forceinline __m128 hmin4(__m128 v)
+        {
+          v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+          return _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        }
+
+        __forceinline __m128 hmax4(__m128 v)
+        {
+          v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+          return _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        }
+
+      }  // namespace RKCOMMON_PACKET_NAMESPACE
+    }  // namespace detail
+
+    inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+      inline vfloat<4> operator+(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_add_ps(a.v, b.v);
+      }
+
+      inline vfloat<4> operator-(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_sub_ps(a.v, b.v);
+      }
+
+      inline vfloat<4> operator*(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_mul_ps(a.v, b.v);
+      }
+
+      inline vfloat<4> operator/(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_div_ps(a.v, b.v);
+      }
+
+      inline vfloat<4> operator-(const vfloat<4> &a)
+      {
+        return _mm_xor_ps(a.v, _mm_set1_ps(-0.f));
+      }
+
+      inline vbool<4> operator<(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_cmplt_ps(a.v, b.v);
+      }
+
+      inline vbool<4> operator<=(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_cmple_ps(a.v, b.v);
+      }
+
+      inline vbool<4> operator>(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_cmpgt_ps(a.v, b.v);
+      }
+
+      inline vbool<4> operator>=(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_cmpge_ps(a.v, b.v);
+      }
+
+      inline vbool<4> operator==(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_cmpeq_ps(a.v, b.v);
+      }
+
+      inline vbool<4> operator!=(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_cmpneq_ps(a.v, b.v);
+      }
+
+      inline vbool<4> operator&(const vbool<4> &a, const vbool<4> &b)
+      {
+        return _mm_and_ps(a.v, b.v);
+      }
+
+      inline vbool<4> operator|(const vbool<4> &a, const vbool<4> &b)
+      {
+        return _mm_or_ps(a.v, b.v);
+      }
+
+      inline vbool<4> operator^(const vbool<4> &a, const vbool<4> &b)
+      {
+        return _mm_xor_ps(a.v, b.v);
+      }
+
+      inline vbool<4> operator!(const vbool<4> &a)
+      {
+        return _mm_xor_ps(a.v, vbool<4>(true).v);
+      }
+
+      inline uint32_t movemask(const vbool<4> &a)
+      {
+        return _mm_movemask_ps(a.v);
+      }
+
+      inline vfloat<4> abs(const vfloat<4> &a)
+      {
+        return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v);
+      }
+
+      inline vfloat<4> sqrt(const vfloat<4> &a)
+      {
+        return _mm_sqrt_ps(a.v);
+      }
+
+      inline vfloat<4> rcp(const vfloat<4> &a)
+      {
+        // same Newton-Raphson step as the scalar rcp()
+        const __m128 r = _mm_rcp_ps(a.v);
+        return _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(2.f), _mm_mul_ps(r, a.v)));
+      }
+
+      inline vfloat<4> rsqrt(const vfloat<4> &a)
+      {
+        // same Newton-Raphson step as the scalar rsqrt()
+        const __m128 r = _mm_rsqrt_ps(a.v);
+        return _mm_add_ps(
+            _mm_mul_ps(_mm_set1_ps(1.5f), r),
+            _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(a.v, _mm_set1_ps(-0.5f)), r),
+                       _mm_mul_ps(r, r)));
+      }
+
+      inline vfloat<4> min(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_min_ps(a.v, b.v);
+      }
+
+      inline vfloat<4> max(const vfloat<4> &a, const vfloat<4> &b)
+      {
+        return _mm_max_ps(a.v, b.v);
+      }
+
+      inline vfloat<4> select(const vbool<4> &mask,
+                              const vfloat<4> &t,
+                              const vfloat<4> &f)
+      {
+#if defined(__SSE4_1__) || defined(__ARM_NEON)
+        return _mm_blendv_ps(f.v, t.v, mask.v);
+#else
+        return _mm_or_ps(_mm_and_ps(mask.v, t.v), _mm_andnot_ps(mask.v, f.v));
+#endif
+      }
+
+      inline float reduce_add(const vfloat<4> &a)
+      {
+        return _mm_cvtss_f32(detail::hadd4(a.v));
+      }
+
+      inline float reduce_min(const vfloat<4> &a)
+      {
+        return _mm_cvtss_f32(detail::hmin4(a.v));
+      }
+
+      inline float reduce_max(const vfloat<4> &a)
+      {
+        return _mm_cvtss_f32(detail::hmax4(a.v));
+      }
+#endif
+
+#ifdef RKCOMMON_PACKET_AVX
+      // AVX back-end //////////////////////////////////////////////////////////
+
+      template <>
+      struct vbool<8>
+      {
+        static constexpr int size = 8;
+
+        vbool() = default;
+
+        vbool(__m256 v) : v(v) {}
+
+        vbool(bool b) : v(_mm256_castsi256_ps(_mm256_set1_epi32(b ? -1 : 0))) {}
+
+        bool operator[](int i) const
+        {
+          return (_mm256_movemask_ps(v) >> i) & 1;
+        }
+
+        __m256 v;
+      };
+
+      template <>
+      struct vfloat<8>
+      {
+        static constexpr int size = 8;
+
+        vfloat() = default;
+
+        vfloat(__m256 v) : v(v) {}
+
+        vfloat(float s) : v(_mm256_set1_ps(s)) {}
+
+        float operator[](int i) const
+        {
+          return f[i];
+        }
+
+        float &operator[](int i)
+        {
+          return f[i];
+        }
+
+        static vfloat load(const float *ptr)
+        {
+          return _mm256_load_ps(ptr);
+        }
+
+        static vfloat loadu(const float *ptr)
+        {
+          return _mm256_loadu_ps(ptr);
+        }
+
+        static vfloat loadu(const vbool<8> &mask, const float *ptr)
+        {
+          return _mm256_maskload_ps(ptr, _mm256_castps_si256(mask.v));
+        }
+
+        static void store(float *ptr, const vfloat &v)
+        {
+          _mm256_store_ps(ptr, v.v);
+        }
+
+        static void storeu(float *ptr, const vfloat &v)
+        {
+          _mm256_storeu_ps(ptr, v.v);
+        }
+
+        static void storeu(const vbool<8> &mask, float *ptr, const vfloat &v)
+        {
+          _mm256_maskstore_ps(ptr, _mm256_castps_si256(mask.v), v.v);
+        }
+
+        union
+        {
+          __m256 v;
+          float f[8];
+        };
+      };
+
+      inline vfloat<8> operator+(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_add_ps(a.v, b.v);
+      }
+
+      inline vfloat<8> operator-(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_sub_ps(a.v, b.v);
+      }
+
+      inline vfloat<8> operator*(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_mul_ps(a.v, b.v);
+      }
+
+      inline vfloat<8> operator/(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_div_ps(a.v, b.v);
+      }
+
+      inline vfloat<8> operator-(const vfloat<8> &a)
+      {
+        return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.f));
+      }
+
+      inline vbool<8> operator<(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ);
+      }
+
+      inline vbool<8> operator<=(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ);
+      }
+
+      inline vbool<8> operator>(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ);
+      }
+
+      inline vbool<8> operator>=(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ);
+      }
+
+      inline vbool<8> operator==(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ);
+      }
+
+      inline vbool<8> operator!=(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ);
+      }
+
+      inline vbool<8> operator&(const vbool<8> &a, const vbool<8> &b)
+      {
+        return _mm256_and_ps(a.v, b.v);
+      }
+
+      inline vbool<8> operator|(const vbool<8> &a, const vbool<8> &b)
+      {
+        return _mm256_or_ps(a.v, b.v);
+      }
+
+      inline vbool<8> operator^(const vbool<8> &a, const vbool<8> &b)
+      {
+        return _mm256_xor_ps(a.v, b.v);
+      }
+
+      inline vbool<8> operator!(const vbool<8> &a)
+      {
+        return _mm256_xor_ps(a.v, vbool<8>(true).v);
+      }
+
+      inline uint32_t movemask(const vbool<8> &a)
+      {
+        return _mm256_movemask_ps(a.v);
+      }
+
+      inline vfloat<8> abs(const vfloat<8> &a)
+      {
+        return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v);
+      }
+
+      inline vfloat<8> sqrt(const vfloat<8> &a)
+      {
+        return _mm256_sqrt_ps(a.v);
+      }
+
+      inline vfloat<8> rcp(const vfloat<8> &a)
+      {
+        const __m256 r = _mm256_rcp_ps(a.v);
+        return _mm256_mul_ps(
+            r, _mm256_sub_ps(_mm256_set1_ps(2.f), _mm256_mul_ps(r, a.v)));
+      }
+
+      inline vfloat<8> rsqrt(const vfloat<8> &a)
+      {
+        const __m256 r = _mm256_rsqrt_ps(a.v);
+        return _mm256_add_ps(
+            _mm256_mul_ps(_mm256_set1_ps(1.5f), r),
+            _mm256_mul_ps(
+                _mm256_mul_ps(_mm256_mul_ps(a.v, _mm256_set1_ps(-0.5f)), r),
+                _mm256_mul_ps(r, r)));
+      }
+
+      inline vfloat<8> min(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_min_ps(a.v, b.v);
+      }
+
+      inline vfloat<8> max(const vfloat<8> &a, const vfloat<8> &b)
+      {
+        return _mm256_max_ps(a.v, b.v);
+      }
+
+      inline vfloat<8> select(const vbool<8> &mask,
+                              const vfloat<8> &t,
+                              const vfloat<8> &f)
+      {
+        return _mm256_blendv_ps(f.v, t.v, mask.v);
+      }
+
+      inline float reduce_add(const vfloat<8> &a)
+      {
+        return _mm_cvtss_f32(detail::hadd4(_mm_add_ps(
+            _mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1))));
+      }
+
+      inline float reduce_min(const vfloat<8> &a)
+      {
+        return _mm_cvtss_f32(detail::hmin4(_mm_min_ps(
+            _mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1))));
+      }
+
+      inline float reduce_max(const vfloat<8> &a)
+      {
+        return _mm_cvtss_f32(detail::hmax4(_mm_max_ps(
+            _mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1))));
+      }
+#endif
+
+#ifdef RKCOMMON_PACKET_AVX512
+      // AVX-512 back-end //////////////////////////////////////////////////////
+
+      template <>
+      struct vbool<16>
+      {
+        static constexpr int size = 16;
+
+        vbool() = default;
+
+        vbool(__mmask16 v) : v(v) {}
+
+        vbool(bool b) : v(b ? 0xffff : 0) {}
+
+        bool operator[](int i) const
+        {
+          return (v >> i) & 1;
+        }
+
+        __mmask16 v;
+      };
+
+      template <>
+      struct vfloat<16>
+      {
+        static constexpr int size = 16;
+
+        vfloat() = default;
+
+        vfloat(__m512 v) : v(v) {}
+
+        vfloat(float s) : v(_mm512_set1_ps(s)) {}
+
+        float operator[](int i) const
+        {
+          return f[i];
+        }
+
+        float &operator[](int i)
+        {
+          return f[i];
+        }
+
+        static vfloat load(const float *ptr)
+        {
+          return _mm512_load_ps(ptr);
+        }
+
+        static vfloat loadu(const float *ptr)
+        {
+          return _mm512_loadu_ps(ptr);
+        }
+
+        static vfloat loadu(const vbool<16> &mask, const float *ptr)
+        {
+          return _mm512_maskz_loadu_ps(mask.v, ptr);
+        }
+
+        static void store(float *ptr, const vfloat &v)
+        {
+          _mm512_store_ps(ptr, v.v);
+        }
+
+        static void storeu(float *ptr, const vfloat &v)
+        {
+          _mm512_storeu_ps(ptr, v.v);
+        }
+
+        static void storeu(const vbool<16> &mask, float *ptr, const vfloat &v)
+        {
+          _mm512_mask_storeu_ps(ptr, mask.v, v.v);
+        }
+
+        union
+        {
+          __m512 v;
+          float f[16];
+        };
+      };
+
+      inline vfloat<16> operator+(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_add_ps(a.v, b.v);
+      }
+
+      inline vfloat<16> operator-(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_sub_ps(a.v, b.v);
+      }
+
+      inline vfloat<16> operator*(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_mul_ps(a.v, b.v);
+      }
+
+      inline vfloat<16> operator/(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_div_ps(a.v, b.v);
+      }
+
+      inline vfloat<16> operator-(const vfloat<16> &a)
+      {
+        // _mm512_xor_ps needs AVX-512DQ, flip the sign bit as integers
+        return _mm512_castsi512_ps(
+            _mm512_xor_si512(_mm512_castps_si512(a.v),
+                             _mm512_set1_epi32(int32_t(0x80000000))));
+      }
+
+      inline vbool<16> operator<(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ);
+      }
+
+      inline vbool<16> operator<=(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ);
+      }
+
+      inline vbool<16> operator>(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ);
+      }
+
+      inline vbool<16> operator>=(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ);
+      }
+
+      inline vbool<16> operator==(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ);
+      }
+
+      inline vbool<16> operator!=(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_cmp_ps_mask(a.v, b.v, _CMP_NEQ_UQ);
+      }
+
+      inline vbool<16> operator&(const vbool<16> &a, const vbool<16> &b)
+      {
+        return __mmask16(a.v & b.v);
+      }
+
+      inline vbool<16> operator|(const vbool<16> &a, const vbool<16> &b)
+      {
+        return __mmask16(a.v | b.v);
+      }
+
+      inline vbool<16> operator^(const vbool<16> &a, const vbool<16> &b)
+      {
+        return __mmask16(a.v ^ b.v);
+      }
+
+      inline vbool<16> operator!(const vbool<16> &a)
+      {
+        return __mmask16(~a.v);
+      }
+
+      inline uint32_t movemask(const vbool<16> &a)
+      {
+        return a.v;
+      }
+
+      inline vfloat<16> abs(const vfloat<16> &a)
+      {
+        return _mm512_abs_ps(a.v);
+      }
+
+      inline vfloat<16> sqrt(const vfloat<16> &a)
+      {
+        return _mm512_sqrt_ps(a.v);
+      }
+
+      inline vfloat<16> rcp(const vfloat<16> &a)
+      {
+        const __m512 r = _mm512_rcp14_ps(a.v);
+        return _mm512_mul_ps(
+            r, _mm512_sub_ps(_mm512_set1_ps(2.f), _mm512_mul_ps(r, a.v)));
+      }
+
+      inline vfloat<16> rsqrt(const vfloat<16> &a)
+      {
+        const __m512 r = _mm512_rsqrt14_ps(a.v);
+        return _mm512_add_ps(
+            _mm512_mul_ps(_mm512_set1_ps(1.5f), r),
+            _mm512_mul_ps(
+                _mm512_mul_ps(_mm512_mul_ps(a.v, _mm512_set1_ps(-0.5f)), r),
+                _mm512_mul_ps(r, r)));
+      }
+
+      inline vfloat<16> min(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_min_ps(a.v, b.v);
+      }
+
+      inline vfloat<16> max(const vfloat<16> &a, const vfloat<16> &b)
+      {
+        return _mm512_max_ps(a.v, b.v);
+      }
+
+      inline vfloat<16> select(const vbool<16> &mask,
+                               const vfloat<16> &t,
+                               const vfloat<16> &f)
+      {
+        return _mm512_mask_blend_ps(mask.v, f.v, t.v);
+      }
+
+      inline float reduce_add(const vfloat<16> &a)
+      {
+        return _mm512_reduce_add_ps(a.v);
+      }
+
+      inline float reduce_min(const vfloat<16> &a)
+      {
+        return _mm512_reduce_min_ps(a.v);
+      }
+
+      inline float reduce_max(const vfloat<16> &a)
+      {
+        return _mm512_reduce_max_ps(a.v);
+      }
+#endif
+
+      // Packet aliases ////////////////////////////////////////////////////////
+
+      using vbool4   = vbool<4>;
+      using vbool8   = vbool<8>;
+      using vbool16  = vbool<16>;
+      using vfloat4  = vfloat<4>;
+      using vfloat8  = vfloat<8>;
+      using vfloat16 = vfloat<16>;
+
+      template <int W>
+      using vec2vf = vec_t<vfloat<W>, 2>;
+      template <int W>
+      using vec3vf = vec_t<vfloat<W>, 3>;
+      template <int W>
+      using vec4vf = vec_t<vfloat<W>, 4>;
+
+      template <int W>
+      using rangevf = range_t<vfloat<W>>;
+      template <int W>
+      using box3vf = box_t<vfloat<W>, 3>;
+
+      // Packet vectors, ranges and boxes //////////////////////////////////////
+
+      /* vec_t<>'s own comparisons return a single bool, so the lane-wise
+         tests on packet vectors and boxes are free functions returning a
+         mask. */
+
+      template <int W>
+      inline vec2vf<W> select(const vbool<W> &mask,
+                              const vec2vf<W> &t,
+                              const vec2vf<W> &f)
+      {
+        return vec2vf<W>(select(mask, t.x, f.x), select(mask, t.y, f.y));
+      }
+
+      template <int W>
+      inline vec3vf<W> select(const vbool<W> &mask,
+                              const vec3vf<W> &t,
+                              const vec3vf<W> &f)
+      {
+        return vec3vf<W>(select(mask, t.x, f.x),
+                         select(mask, t.y, f.y),
+                         select(mask, t.z, f.z));
+      }
+
+      template <int W>
+      inline vec4vf<W> select(const vbool<W> &mask,
+                              const vec4vf<W> &t,
+                              const vec4vf<W> &f)
+      {
+        return vec4vf<W>(select(mask, t.x, f.x),
+                         select(mask, t.y, f.y),
+                         select(mask, t.z, f.z),
+                         select(mask, t.w, f.w));
+      }
+
+      template <int W, typename T>
+      inline range_t<T> select(const vbool<W> &mask,
+                               const range_t<T> &t,
+                               const range_t<T> &f)
+      {
+        return range_t<T>(select(mask, t.lower, f.lower),
+                          select(mask, t.upper, f.upper));
+      }
+
+      /*! lane i of a packet vector */
+      template <int W>
+      inline vec3f extract(const vec3vf<W> &v, int i)
+      {
+        return vec3f(v.x[i], v.y[i], v.z[i]);
+      }
+
+      template <int W>
+      inline box3f extract(const box3vf<W> &b, int i)
+      {
+        return box3f(extract(b.lower, i), extract(b.upper, i));
+      }
+
+      /*! gather W consecutive AoS vectors into a packet */
+      template <int W>
+      inline vec3vf<W> loadAoS(const vec3f *ptr)
+      {
+        vec3vf<W> r;
+        for (int i = 0; i < W; ++i) {
+          r.x[i] = ptr[i].x;
+          r.y[i] = ptr[i].y;
+          r.z[i] = ptr[i].z;
+        }
+        return r;
+      }
+
+      /*! inactive lanes are zero and their memory is not read */
+      template <int W>
+      inline vec3vf<W> loadAoS(const vbool<W> &mask, const vec3f *ptr)
+      {
+        vec3vf<W> r(0.f);
+        for (int i = 0; i < W; ++i) {
+          if (mask[i]) {
+            r.x[i] = ptr[i].x;
+            r.y[i] = ptr[i].y;
+            r.z[i] = ptr[i].z;
+          }
+        }
+        return r;
+      }
+
+      template <int W>
+      inline void storeAoS(vec3f *ptr, const vec3vf<W> &v)
+      {
+        for (int i = 0; i < W; ++i)
+          ptr[i] = extract(v, i);
+      }
+
+      template <int W>
+      inline void storeAoS(const vbool<W> &mask, vec3f *ptr, const vec3vf<W> &v)
+      {
+        for (int i = 0; i < W; ++i)
+          if (mask[i])
+            ptr[i] = extract(v, i);
+      }
+
+      /*! out[k] lane i = ptr[i * stride + k] for k < 4, i.e. the same 4
+          consecutive floats of W records 'stride' floats apart */
+      template <int W>
+      inline void loadTransposed4(const float *ptr,
+                                  size_t stride,
+                                  vfloat<W> out[4])
+      {
+        for (int i = 0; i < W; ++i)
+          for (int k = 0; k < 4; ++k)
+            out[k][i] = ptr[i * stride + k];
+      }
+
+      /*! the inverse of loadTransposed4() */
+      template <int W>
+      inline void storeTransposed4(float *ptr,
+                                   size_t stride,
+                                   const vfloat<W> in[4])
+      {
+        for (int i = 0; i < W; ++i)
+          for (int k = 0; k < 4; ++k)
+            ptr[i * stride + k] = in[k][i];
+      }
+
+#ifdef RKCOMMON_PACKET_SSE
+    }  // namespace RKCOMMON_PACKET_NAMESPACE
+
+    /* The native widths transpose 4 vectors (3 registers) at a time with
+       shuffles instead of moving each lane through memory */
+    namespace detail {
+      inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+        __forceinline void loadAoS4(const vec3f *ptr,
+                                    __m128 &x,
+                                    __m128 &y,
+                                    __m128 &z)
+        {
+          const float *f = &ptr[0].x;
+          const __m128 a = _mm_loadu_ps(f);      // x0 y0 z0 x1
+          const __m128 b = _mm_loadu_ps(f + 4);  // y1 z1 x2 y2
+          const __m128 c = _mm_loadu_ps(f + 8);  // z2 x3 y3 z3
+
+          const __m128 t0 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+          const __m128 t1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+          x = _mm_shuffle_ps(a, t0, _MM_SHUFFLE(2, 0, 3, 0));
+          y = _mm_shuffle_ps(t1, t0, _MM_SHUFFLE(3, 1, 2, 0));
+          z = _mm_shuffle_ps(t1, c, _MM_SHUFFLE(3, 0, 3, 1));
+        }
+
+        __forceinline void storeAoS4(vec3f *ptr, __m128 x, __m128 y, __m128 z)
+        {
+          // pairs of the 2 components each output register takes from a lane
+          const __m128 x0y0 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0));
+          const __m128 z0x1 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));
+          const __m128 y1z1 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));
+          const __m128 x2y2 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2));
+          const __m128 z2x3 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));
+          const __m128 y3z3 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));
+
+          float *f = &ptr[0].x;
+          _mm_storeu_ps(f, _mm_shuffle_ps(x0y0, z0x1, _MM_SHUFFLE(2, 0, 2, 0)));
+          _mm_storeu_ps(f + 4,
+                        _mm_shuffle_ps(y1z1, x2y2, _MM_SHUFFLE(2, 0, 2, 0)));
+          _mm_storeu_ps(f + 8,
+                        _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));
+        }
+
+        __forceinline void loadTransposed4x4(const float *ptr,
+                                             size_t stride,
+                                             __m128 &r0,
+                                             __m128 &r1,
+                                             __m128 &r2,
+                                             __m128 &r3)
+        {
+          r0 = _mm_loadu_ps(ptr);
+          r1 = _mm_loadu_ps(ptr + stride);
+          r2 = _mm_loadu_ps(ptr + 2 * stride);
+          r3 = _mm_loadu_ps(ptr + 3 * stride);
+          _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        }
+
+        __forceinline void storeTransposed4x4(float *ptr,
+                                              size_t stride,
+                                              __m128 r0,
+                                              __m128 r1,
+                                              __m128 r2,
+                                              __m128 r3)
+        {
+          _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+          _mm_storeu_ps(ptr, r0);
+          _mm_storeu_ps(ptr + stride, r1);
+          _mm_storeu_ps(ptr + 2 * stride, r2);
+          _mm_storeu_ps(ptr + 3 * stride, r3);
+        }
+
+      }  // namespace RKCOMMON_PACKET_NAMESPACE
+    }  // namespace detail
+
+    inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+      template <>
+      inline void loadTransposed4<4>(const float *ptr,
+                                     size_t stride,
+                                     vfloat<4> out[4])
+      {
+        detail::loadTransposed4x4(
+            ptr, stride, out[0].v, out[1].v, out[2].v, out[3].v);
+      }
+
+      template <>
+      inline void storeTransposed4<4>(float *ptr,
+                                      size_t stride,
+                                      const vfloat<4> in[4])
+      {
+        detail::storeTransposed4x4(
+            ptr, stride, in[0].v, in[1].v, in[2].v, in[3].v);
+      }
+
+      template <>
+      inline vec3vf<4> loadAoS<4>(const vec3f *ptr)
+      {
+        __m128 x, y, z;
+        detail::loadAoS4(ptr, x, y, z);
+        return vec3vf<4>(x, y, z);
+      }
+
+      template <>
+      inline void storeAoS<4>(vec3f *ptr, const vec3vf<4> &v)
+      {
+        detail::storeAoS4(ptr, v.x.v, v.y.v, v.z.v);
+      }
+#endif
+
+#ifdef RKCOMMON_PACKET_AVX
+      template <>
+      inline vec3vf<8> loadAoS<8>(const vec3f *ptr)
+      {
+        __m128 x0, y0, z0, x1, y1, z1;
+        detail::loadAoS4(ptr, x0, y0, z0);
+        detail::loadAoS4(ptr + 4, x1, y1, z1);
+        return vec3vf<8>(
+            _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1),
+            _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1),
+            _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1));
+      }
+
+      // named registers: arrays of halves would round trip through memory
+      template <>
+      inline void loadTransposed4<8>(const float *ptr,
+                                     size_t stride,
+                                     vfloat<8> out[4])
+      {
+        __m128 lo0, lo1, lo2, lo3, hi0, hi1, hi2, hi3;
+        detail::loadTransposed4x4(ptr, stride, lo0, lo1, lo2, lo3);
+        detail::loadTransposed4x4(
+            ptr + 4 * stride, stride, hi0, hi1, hi2, hi3);
+        out[0] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo0), hi0, 1);
+        out[1] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo1), hi1, 1);
+        out[2] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo2), hi2, 1);
+        out[3] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo3), hi3, 1);
+      }
+
+      template <>
+      inline void storeTransposed4<8>(float *ptr,
+                                      size_t stride,
+                                      const vfloat<8> in[4])
+      {
+        detail::storeTransposed4x4(ptr,
+                                   stride,
+                                   _mm256_castps256_ps128(in[0].v),
+                                   _mm256_castps256_ps128(in[1].v),
+                                   _mm256_castps256_ps128(in[2].v),
+                                   _mm256_castps256_ps128(in[3].v));
+        detail::storeTransposed4x4(ptr + 4 * stride,
+                                   stride,
+                                   _mm256_extractf128_ps(in[0].v, 1),
+                                   _mm256_extractf128_ps(in[1].v, 1),
+                                   _mm256_extractf128_ps(in[2].v, 1),
+                                   _mm256_extractf128_ps(in[3].v, 1));
+      }
+
+      template <>
+      inline void storeAoS<8>(vec3f *ptr, const vec3vf<8> &v)
+      {
+        detail::storeAoS4(ptr,
+                          _mm256_castps256_ps128(v.x.v),
+                          _mm256_castps256_ps128(v.y.v),
+                          _mm256_castps256_ps128(v.z.v));
+        detail::storeAoS4(ptr + 4,
+                          _mm256_extractf128_ps(v.x.v, 1),
+                          _mm256_extractf128_ps(v.y.v, 1),
+                          _mm256_extractf128_ps(v.z.v, 1));
+      }
+#endif
+
+#ifdef RKCOMMON_PACKET_AVX512
+      template <>
+      inline vec3vf<16> loadAoS<16>(const vec3f *ptr)
+      {
+        __m512 x = _mm512_setzero_ps(), y = x, z = x;
+        __m128 xq, yq, zq;
+
+#define loadAoSQuarter(q)                      \
+    detail::loadAoS4(ptr + 4 * q, xq, yq, zq);   \
+    x = _mm512_insertf32x4(x, xq, q);            \
+    y = _mm512_insertf32x4(y, yq, q);            \
+    z = _mm512_insertf32x4(z, zq, q);
+
+        loadAoSQuarter(0);
+        loadAoSQuarter(1);
+        loadAoSQuarter(2);
+        loadAoSQuarter(3);
+#undef loadAoSQuarter
+
+        return vec3vf<16>(x, y, z);
+      }
+
+      template <>
+      inline void loadTransposed4<16>(const float *ptr,
+                                      size_t stride,
+                                      vfloat<16> out[4])
+      {
+        __m512 r0 = _mm512_setzero_ps(), r1 = r0, r2 = r0, r3 = r0;
+        __m128 q0, q1, q2, q3;
+
+#define loadTransposedQuarter(n)                                     \
+    detail::loadTransposed4x4(ptr + 4 * n * stride, stride, q0, q1, q2, q3); \
+    r0 = _mm512_insertf32x4(r0, q0, n);                                \
+    r1 = _mm512_insertf32x4(r1, q1, n);                                \
+    r2 = _mm512_insertf32x4(r2, q2, n);                                \
+    r3 = _mm512_insertf32x4(r3, q3, n);
+
+        loadTransposedQuarter(0);
+        loadTransposedQuarter(1);
+        loadTransposedQuarter(2);
+        loadTransposedQuarter(3);
+#undef loadTransposedQuarter
+
+        out[0] = r0;
+        out[1] = r1;
+        out[2] = r2;
+        out[3] = r3;
+      }
+
+      template <>
+      inline void storeTransposed4<16>(float *ptr,
+                                       size_t stride,
+                                       const vfloat<16> in[4])
+      {
+#define storeTransposedQuarter(n)                               \
+    detail::storeTransposed4x4(ptr + 4 * n * stride,              \
+                               stride,                            \
+                               _mm512_extractf32x4_ps(in[0].v, n), \
+                               _mm512_extractf32x4_ps(in[1].v, n), \
+                               _mm512_extractf32x4_ps(in[2].v, n), \
+                               _mm512_extractf32x4_ps(in[3].v, n));
+
+        storeTransposedQuarter(0);
+        storeTransposedQuarter(1);
+        storeTransposedQuarter(2);
+        storeTransposedQuarter(3);
+#undef storeTransposedQuarter
+      }
+
+      template <>
+      inline void storeAoS<16>(vec3f *ptr, const vec3vf<16> &v)
+      {
+#define storeAoSQuarter(q)                               \
+    detail::storeAoS4(ptr + 4 * q,                         \
+                      _mm512_extractf32x4_ps(v.x.v, q),    \
+                      _mm512_extractf32x4_ps(v.y.v, q),    \
+                      _mm512_extractf32x4_ps(v.z.v, q));
+
+        storeAoSQuarter(0);
+        storeAoSQuarter(1);
+        storeAoSQuarter(2);
+        storeAoSQuarter(3);
+#undef storeAoSQuarter
+      }
+#endif
+
+      template <int W>
+      inline vfloat<W> reduce_min(const vec3vf<W> &v)
+      {
+        return min(min(v.x, v.y), v.z);
+      }
+
+      template <int W>
+      inline vfloat<W> reduce_max(const vec3vf<W> &v)
+      {
+        return max(max(v.x, v.y), v.z);
+      }
+
+      /*! per lane: box is empty */
+      template <int W>
+      inline vbool<W> isEmpty(const box3vf<W> &b)
+      {
+        return (b.upper.x < b.lower.x) | (b.upper.y < b.lower.y) |
+               (b.upper.z < b.lower.z);
+      }
+
+      /*! per lane: 'p' lies inside (or on the boundary of) 'b' */
+      template <int W>
+      inline vbool<W> contains(const box3vf<W> &b, const vec3vf<W> &p)
+      {
+        return (b.lower.x <= p.x) & (p.x <= b.upper.x) & (b.lower.y <= p.y) &
+               (p.y <= b.upper.y) & (b.lower.z <= p.z) & (p.z <= b.upper.z);
+      }
+
+      /*! per lane: the two boxes touch or overlap */
+      template <int W>
+      inline vbool<W> touchingOrOverlapping(const box3vf<W> &a,
+                                            const box3vf<W> &b)
+      {
+        return (a.lower.x <= b.upper.x) & (a.lower.y <= b.upper.y) &
+               (a.lower.z <= b.upper.z) & (b.lower.x <= a.upper.x) &
+               (b.lower.y <= a.upper.y) & (b.lower.z <= a.upper.z);
+      }
+
+      /*! union of the boxes in all lanes */
+      template <int W>
+      inline box3f reduce_bounds(const box3vf<W> &b)
+      {
+        return box3f(
+            vec3f(reduce_min(b.lower.x),
+                  reduce_min(b.lower.y),
+                  reduce_min(b.lower.z)),
+            vec3f(reduce_max(b.upper.x),
+                  reduce_max(b.upper.y),
+                  reduce_max(b.upper.z)));
+      }
+
+      /*! union of the boxes in the active lanes */
+      template <int W>
+      inline box3f reduce_bounds(const vbool<W> &mask, const box3vf<W> &b)
+      {
+        return reduce_bounds(select(mask, b, box3vf<W>(empty)));
+      }
+
+      // Packet ray/box slab tests /////////////////////////////////////////////
+
+      template <int W>
+      using RayInvDir3vf = RayInvDir<vfloat<W>, 3>;
+
+      /*! per lane result of a packet slab test: the entry/exit distances
+          clipped to the ray's range, and whether the lane hit its box */
+      template <int W>
+      struct RayBoxHit
+      {
+        vbool<W> hit;
+        rangevf<W> t;
+      };
+
+      /*! W rays against W boxes, lane by lane */
+      template <int W>
+      inline RayBoxHit<W> intersectRayBox(
+          const RayInvDir3vf<W> &ray,
+          const box3vf<W> &box,
+          const rangevf<W> &tRange = rangevf<W>(vfloat<W>(0.f),
+                                                vfloat<W>(inf)))
+      {
+        const vec3vf<W> t0   = (box.lower - ray.org) * ray.rdir;
+        const vec3vf<W> t1   = (box.upper - ray.org) * ray.rdir;
+        const vec3vf<W> tMin = min(t0, t1);
+        const vec3vf<W> tMax = max(t0, t1);
+
+        RayBoxHit<W> result;
+        result.t.lower = max(max(tMin.x, tMin.y), max(tMin.z, tRange.lower));
+        result.t.upper = min(min(tMax.x, tMax.y), min(tMax.z, tRange.upper));
+        result.hit     = result.t.lower <= result.t.upper;
+        return result;
+      }
+
+      /*! one ray against W boxes, e.g. the children of a BVH node which
+          stores their bounds as a box3vf<W> */
+      template <int W>
+      inline RayBoxHit<W> intersectRayBox(
+          const RayInvDir3f &ray,
+          const box3vf<W> &boxes,
+          const range1f &tRange = range1f(0, inf))
+      {
+        RayInvDir3vf<W> rays;
+        rays.org  = vec3vf<W>(ray.org);
+        rays.rdir = vec3vf<W>(ray.rdir);
+        return intersectRayBox(rays,
+                               boxes,
+                               rangevf<W>(vfloat<W>(tRange.lower),
+                                          vfloat<W>(tRange.upper)));
+      }
+
+      /*! W rays against one box */
+      template <int W>
+      inline RayBoxHit<W> intersectRayBox(
+          const RayInvDir3vf<W> &rays,
+          const box3f &box,
+          const rangevf<W> &tRange = rangevf<W>(vfloat<W>(0.f),
+                                                vfloat<W>(inf)))
+      {
+        return intersectRayBox(
+            rays,
+            box3vf<W>(vec3vf<W>(box.lower), vec3vf<W>(box.upper)),
+            tRange);
+      }
+
+      // Uniform transforms of packet vectors //////////////////////////////////
+
+    }  // namespace RKCOMMON_PACKET_NAMESPACE
+
+    namespace detail {
+      inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+        // a * s.x + (b * s.y + c * s.z), in the order of the scalar code
+        template <int W>
+        inline vfloat<W> xfmRow(const vec3vf<W> &v, const vec3f &s)
+        {
+          return madd(v.x,
+                      vfloat<W>(s.x),
+                      madd(v.y, vfloat<W>(s.y), v.z * vfloat<W>(s.z)));
+        }
+
+        template <int W>
+        inline vfloat<W> xfmRow(const vec3vf<W> &v, const vec3f &s, float t)
+        {
+          return madd(v.x,
+                      vfloat<W>(s.x),
+                      madd(v.y,
+                           vfloat<W>(s.y),
+                           madd(v.z, vfloat<W>(s.z), vfloat<W>(t))));
+        }
+
+      }  // namespace RKCOMMON_PACKET_NAMESPACE
+    }  // namespace detail
+
+    inline namespace RKCOMMON_PACKET_NAMESPACE {
+
+      template <int W>
+      inline vec3vf<W> xfmVector(const LinearSpace3f &s, const vec3vf<W> &v)
+      {
+        return vec3vf<W>(
+            detail::xfmRow(v, vec3f(s.vx.x, s.vy.x, s.vz.x)),
+            detail::xfmRow(v, vec3f(s.vx.y, s.vy.y, s.vz.y)),
+            detail::xfmRow(v, vec3f(s.vx.z, s.vy.z, s.vz.z)));
+      }
+
+      template <int W>
+      inline vec3vf<W> xfmPoint(const AffineSpace3f &m, const vec3vf<W> &p)
+      {
+        const LinearSpace3f &l = m.l;
+        return vec3vf<W>(
+            detail::xfmRow(p, vec3f(l.vx.x, l.vy.x, l.vz.x), m.p.x),
+            detail::xfmRow(p, vec3f(l.vx.y, l.vy.y, l.vz.y), m.p.y),
+            detail::xfmRow(p, vec3f(l.vx.z, l.vy.z, l.vz.z), m.p.z));
+      }
+
+      template <int W>
+      inline vec3vf<W> xfmVector(const AffineSpace3f &m, const vec3vf<W> &v)
+      {
+        return xfmVector(m.l, v);
+      }
+
+      /*! 'n' is transformed with the inverse transpose of 'm.l' */
+      template <int W>
+      inline vec3vf<W> xfmNormal(const AffineSpace3f &m, const vec3vf<W> &n)
+      {
+        return xfmVector(m.l.inverse().transposed(), n);
+      }
+
+      /*! per lane bounds of the transformed boxes */
+      template <int W>
+      inline box3vf<W> xfmBounds(const AffineSpace3f &m, const box3vf<W> &b)
+      {
+        // center/extent form: the extent transforms with |m.l|
+        const vec3vf<W> center   = .5f * (b.lower + b.upper);
+        const vec3vf<W> halfSize = .5f * (b.upper - b.lower);
+        const LinearSpace3f absL(abs(m.l.vx), abs(m.l.vy), abs(m.l.vz));
+        const vec3vf<W> c = xfmPoint(m, center);
+        const vec3vf<W> e = xfmVector(absL, halfSize);
+        return box3vf<W>(c - e, c + e);
+      }
+
+    }  // namespace RKCOMMON_PACKET_NAMESPACE
+  }  // namespace math
+}  // namespace rkcommon
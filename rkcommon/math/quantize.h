@@ -0,0 +1,516 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../memory/ScratchBuffer.h"
+#include "../utility/DataView.h"
+#include "box.h"
+// std
+#include <cfloat>
+#include <limits>
+
+/* Compact storage for positions and unit normals.
+
+   QuantizedVec3<uint16_t> stores a point as 16-bit fixed point coordinates
+   relative to the box of a QuantizationDomain (6 instead of 12 bytes);
+   QuantizedVec3<uint32_t> gives 32-bit precision, uniform over the box.
+   Unit vectors are stored octahedral-encoded as vec2s (4 bytes).
+
+   The bulk functions run over 4 points (12 components) at a time with
+   loops the compiler vectorizes, in parallel chunks with 'parallel'.
+   DequantizedView and OctahedralNormalView read quantized arrays, also
+   strided ones, back as vec3f like a DataView<vec3f>. */
+
+namespace rkcommon {
+  namespace math {
+
+    template <typename T>
+    struct QuantizedVec3
+    {
+      static_assert(std::is_same<T, uint16_t>::value ||
+                        std::is_same<T, uint32_t>::value,
+                    "QuantizedVec3 stores uint16_t or uint32_t");
+
+      T x, y, z;
+    };
+
+    using QuantizedVec3us = QuantizedVec3<uint16_t>;
+    using QuantizedVec3ui = QuantizedVec3<uint32_t>;
+
+    static_assert(sizeof(QuantizedVec3us) == 6,
+                  "QuantizedVec3 must be tightly packed");
+
+    template <typename T>
+    inline bool operator==(const QuantizedVec3<T> &a,
+                           const QuantizedVec3<T> &b)
+    {
+      return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+
+    template <typename T>
+    inline bool operator!=(const QuantizedVec3<T> &a,
+                           const QuantizedVec3<T> &b)
+    {
+      return !(a == b);
+    }
+
+    /*! maps the points of a box to the levels [0, 2^bits - 1] of
+        QuantizedVec3<T> along each axis, rounding to the nearest level.
+        Points outside of the box are clamped to it. An axis along which
+        the box is flat quantizes to level 0. */
+    template <typename T>
+    class QuantizationDomain
+    {
+     public:
+      // float covers 16-bit levels, 32-bit ones need double
+      using compute_t =
+          typename std::conditional<sizeof(T) <= 2, float, double>::type;
+
+      QuantizationDomain() = default;
+      explicit QuantizationDomain(const box3f &domain);
+
+      const box3f &domain() const;
+
+      /*! the distance between adjacent levels, per axis */
+      vec3f stepSize() const;
+
+      /*! bound on |dequantize(quantize(p)) - p| per axis for points 'p'
+          in the domain: half a step, plus the rounding of floats */
+      vec3f maxError() const;
+
+      QuantizedVec3<T> quantize(const vec3f &p) const;
+      vec3f dequantize(const QuantizedVec3<T> &q) const;
+
+      void quantize(const vec3f *in,
+                    QuantizedVec3<T> *out,
+                    size_t n,
+                    bool parallel = true) const;
+
+      void dequantize(const QuantizedVec3<T> *in,
+                      vec3f *out,
+                      size_t n,
+                      bool parallel = true) const;
+
+     private:
+      void quantizeRange(const vec3f *in, QuantizedVec3<T> *out, size_t n)
+          const;
+      void dequantizeRange(const QuantizedVec3<T> *in, vec3f *out, size_t n)
+          const;
+
+      box3f box{vec3f(0.f), vec3f(0.f)};
+      compute_t lower[3]{0, 0, 0};
+      compute_t scale[3]{0, 0, 0};
+      compute_t step[3]{0, 0, 0};
+    };
+
+    /*! octahedral encoding of the unit vector 'n' (which need not be
+        normalized) as two signed 16-bit fixed point values; decodes to
+        within about 3e-5 radians */
+    inline vec2s encodeOctahedral(const vec3f &n);
+
+    /*! the unit vector of an encoding, normalized */
+    inline vec3f decodeOctahedral(const vec2s &e);
+
+    inline void encodeOctahedral(const vec3f *in,
+                                 vec2s *out,
+                                 size_t n,
+                                 bool parallel = true);
+
+    inline void decodeOctahedral(const vec2s *in,
+                                 vec3f *out,
+                                 size_t n,
+                                 bool parallel = true);
+
+    /*! reads a (strided) array of QuantizedVec3<T> as vec3f, with the
+        interface of DataView<vec3f> apart from returning by value */
+    template <typename T>
+    class DequantizedView
+    {
+     public:
+      DequantizedView() = default;
+      DequantizedView(const utility::DataView<QuantizedVec3<T>> &data,
+                      const QuantizationDomain<T> &domain);
+
+      vec3f operator[](size_t index) const;
+
+      void copyTo(vec3f *out,
+                  size_t first,
+                  size_t count,
+                  bool parallel = true) const;
+
+      void gather(const uint32_t *indices,
+                  vec3f *out,
+                  size_t n,
+                  bool parallel = true) const;
+
+      const utility::DataView<QuantizedVec3<T>> &data() const;
+      const QuantizationDomain<T> &domain() const;
+
+     private:
+      utility::DataView<QuantizedVec3<T>> view;
+      QuantizationDomain<T> quantization;
+    };
+
+    /*! reads a (strided) array of octahedral-encoded normals as vec3f */
+    class OctahedralNormalView
+    {
+     public:
+      OctahedralNormalView() = default;
+      explicit OctahedralNormalView(const utility::DataView<vec2s> &data);
+
+      vec3f operator[](size_t index) const;
+
+      void copyTo(vec3f *out,
+                  size_t first,
+                  size_t count,
+                  bool parallel = true) const;
+
+      void gather(const uint32_t *indices,
+                  vec3f *out,
+                  size_t n,
+                  bool parallel = true) const;
+
+      const utility::DataView<vec2s> &data() const;
+
+     private:
+      utility::DataView<vec2s> view;
+    };
+
+    // Inlined definitions ////////////////////////////////////////////////////
+
+    namespace detail {
+
+      template <typename T, typename C>
+      inline T quantizeLevel(C p, C lower, C scale)
+      {
+        const C maxLevel = C(std::numeric_limits<T>::max());
+        const C v = std::min(std::max((p - lower) * scale, C(0)), maxLevel);
+        // v is not negative, so truncation after adding .5 rounds
+        using int_t = typename std::
+            conditional<sizeof(T) <= 2, int32_t, int64_t>::type;
+        return T(int_t(v + C(.5)));
+      }
+
+      // 'fcn(begin, end)' over [0, n) in DataView sized parallel chunks
+      template <typename FCN_T>
+      inline void forQuantizeChunks(size_t n, bool parallel, FCN_T &&fcn)
+      {
+        utility::detail::forChunks(n, parallel, std::forward<FCN_T>(fcn));
+      }
+
+      // 'fcn(begin, end)' over [begin, end) in blocks that fit in scratch
+      template <typename FCN_T>
+      inline void forScratchBlocks(size_t begin, size_t end, FCN_T &&fcn)
+      {
+        const size_t blockSize = 4096;
+        for (size_t b = begin; b < end; b += blockSize)
+          fcn(b, std::min(b + blockSize, end));
+      }
+
+      inline float signNotZero(float f)
+      {
+        return f < 0.f ? -1.f : 1.f;
+      }
+
+      inline int16_t toSnorm16(float f)
+      {
+        const float v = std::min(std::max(f, -1.f), 1.f) * 32767.f;
+        return int16_t(v < 0.f ? v - .5f : v + .5f);
+      }
+
+    }  // namespace detail
+
+    template <typename T>
+    inline QuantizationDomain<T>::QuantizationDomain(const box3f &domain)
+        : box(domain)
+    {
+      const compute_t maxLevel = compute_t(std::numeric_limits<T>::max());
+      for (int a = 0; a < 3; a++) {
+        const compute_t extent = compute_t(domain.upper[a]) - domain.lower[a];
+        lower[a] = domain.lower[a];
+        scale[a] = extent > 0 ? maxLevel / extent : compute_t(0);
+        step[a]  = extent > 0 ? extent / maxLevel : compute_t(0);
+      }
+    }
+
+    template <typename T>
+    inline const box3f &QuantizationDomain<T>::domain() const
+    {
+      return box;
+    }
+
+    template <typename T>
+    inline vec3f QuantizationDomain<T>::stepSize() const
+    {
+      return vec3f(float(step[0]), float(step[1]), float(step[2]));
+    }
+
+    template <typename T>
+    inline vec3f QuantizationDomain<T>::maxError() const
+    {
+      // the level a float product lands on is off by up to a few of its
+      // ulps, and the dequantized float rounds once more
+      const vec3f magnitude = max(abs(box.lower), abs(box.upper));
+      const float levels    = float(std::numeric_limits<T>::max());
+      const float levelError =
+          std::is_same<compute_t, float>::value ? 4.f * FLT_EPSILON * levels
+                                                : 0.f;
+      return (.5f + levelError) * stepSize() + FLT_EPSILON * magnitude;
+    }
+
+    template <typename T>
+    inline QuantizedVec3<T> QuantizationDomain<T>::quantize(
+        const vec3f &p) const
+    {
+      QuantizedVec3<T> q;
+      q.x = detail::quantizeLevel<T>(compute_t(p.x), lower[0], scale[0]);
+      q.y = detail::quantizeLevel<T>(compute_t(p.y), lower[1], scale[1]);
+      q.z = detail::quantizeLevel<T>(compute_t(p.z), lower[2], scale[2]);
+      return q;
+    }
+
+    template <typename T>
+    inline vec3f QuantizationDomain<T>::dequantize(
+        const QuantizedVec3<T> &q) const
+    {
+      return vec3f(float(lower[0] + compute_t(q.x) * step[0]),
+                   float(lower[1] + compute_t(q.y) * step[1]),
+                   float(lower[2] + compute_t(q.z) * step[2]));
+    }
+
+    template <typename T>
+    inline void QuantizationDomain<T>::quantizeRange(const vec3f *in,
+                                                     QuantizedVec3<T> *out,
+                                                     size_t n) const
+    {
+      // 4 points are 12 components, which repeat the axes 4 times
+      compute_t lower12[12], scale12[12];
+      for (int j = 0; j < 12; j++) {
+        lower12[j] = lower[j % 3];
+        scale12[j] = scale[j % 3];
+      }
+
+      const float *src = reinterpret_cast<const float *>(in);
+      T *dst           = reinterpret_cast<T *>(out);
+      const size_t n4  = n & ~size_t(3);
+      size_t i         = 0;
+      for (; i < n4; i += 4) {
+        for (int j = 0; j < 12; j++) {
+          dst[3 * i + j] = detail::quantizeLevel<T>(
+              compute_t(src[3 * i + j]), lower12[j], scale12[j]);
+        }
+      }
+      for (; i < n; i++)
+        out[i] = quantize(in[i]);
+    }
+
+    template <typename T>
+    inline void QuantizationDomain<T>::dequantizeRange(
+        const QuantizedVec3<T> *in, vec3f *out, size_t n) const
+    {
+      compute_t lower12[12], step12[12];
+      for (int j = 0; j < 12; j++) {
+        lower12[j] = lower[j % 3];
+        step12[j]  = step[j % 3];
+      }
+
+      const T *src    = reinterpret_cast<const T *>(in);
+      float *dst      = reinterpret_cast<float *>(out);
+      const size_t n4 = n & ~size_t(3);
+      size_t i        = 0;
+      for (; i < n4; i += 4) {
+        for (int j = 0; j < 12; j++) {
+          dst[3 * i + j] =
+              float(lower12[j] + compute_t(src[3 * i + j]) * step12[j]);
+        }
+      }
+      for (; i < n; i++)
+        out[i] = dequantize(in[i]);
+    }
+
+    template <typename T>
+    inline void QuantizationDomain<T>::quantize(const vec3f *in,
+                                                QuantizedVec3<T> *out,
+                                                size_t n,
+                                                bool parallel) const
+    {
+      detail::forQuantizeChunks(n, parallel, [&](size_t begin, size_t end) {
+        quantizeRange(in + begin, out + begin, end - begin);
+      });
+    }
+
+    template <typename T>
+    inline void QuantizationDomain<T>::dequantize(const QuantizedVec3<T> *in,
+                                                  vec3f *out,
+                                                  size_t n,
+                                                  bool parallel) const
+    {
+      detail::forQuantizeChunks(n, parallel, [&](size_t begin, size_t end) {
+        dequantizeRange(in + begin, out + begin, end - begin);
+      });
+    }
+
+    inline vec2s encodeOctahedral(const vec3f &n)
+    {
+      const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+      if (l1 == 0.f)
+        return vec2s(0, 0);
+      float u = n.x / l1;
+      float v = n.y / l1;
+      if (n.z < 0.f) {
+        // fold the lower hemisphere over the diagonals
+        const float fu = (1.f - std::abs(v)) * detail::signNotZero(u);
+        const float fv = (1.f - std::abs(u)) * detail::signNotZero(v);
+        u              = fu;
+        v              = fv;
+      }
+      return vec2s(detail::toSnorm16(u), detail::toSnorm16(v));
+    }
+
+    inline vec3f decodeOctahedral(const vec2s &e)
+    {
+      const float u = std::max(e.x * (1.f / 32767.f), -1.f);
+      const float v = std::max(e.y * (1.f / 32767.f), -1.f);
+      const float z = 1.f - std::abs(u) - std::abs(v);
+      // unfolds the lower hemisphere (z < 0) and leaves the upper one
+      const float t = std::max(-z, 0.f);
+      const vec3f n(u + (u >= 0.f ? -t : t), v + (v >= 0.f ? -t : t), z);
+      return n * (1.f / std::sqrt(dot(n, n)));
+    }
+
+    inline void encodeOctahedral(const vec3f *in,
+                                 vec2s *out,
+                                 size_t n,
+                                 bool parallel)
+    {
+      detail::forQuantizeChunks(n, parallel, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+          out[i] = encodeOctahedral(in[i]);
+      });
+    }
+
+    inline void decodeOctahedral(const vec2s *in,
+                                 vec3f *out,
+                                 size_t n,
+                                 bool parallel)
+    {
+      detail::forQuantizeChunks(n, parallel, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+          out[i] = decodeOctahedral(in[i]);
+      });
+    }
+
+    template <typename T>
+    inline DequantizedView<T>::DequantizedView(
+        const utility::DataView<QuantizedVec3<T>> &data,
+        const QuantizationDomain<T> &domain)
+        : view(data), quantization(domain)
+    {
+    }
+
+    template <typename T>
+    inline vec3f DequantizedView<T>::operator[](size_t index) const
+    {
+      return quantization.dequantize(view[index]);
+    }
+
+    template <typename T>
+    inline void DequantizedView<T>::copyTo(vec3f *out,
+                                           size_t first,
+                                           size_t count,
+                                           bool parallel) const
+    {
+      if (view.byteStride() == sizeof(QuantizedVec3<T>)) {
+        quantization.dequantize(&view[first], out, count, parallel);
+        return;
+      }
+      // strided: packed into scratch memory, then dequantized in bulk
+      detail::forQuantizeChunks(
+          count, parallel, [&](size_t chunkBegin, size_t chunkEnd) {
+            memory::ScratchScope scratch;
+            auto *packed = scratch.allocate<QuantizedVec3<T>>(
+                std::min(chunkEnd - chunkBegin, size_t(4096)));
+            detail::forScratchBlocks(
+                chunkBegin, chunkEnd, [&](size_t begin, size_t end) {
+                  view.copyTo(packed, first + begin, end - begin, false);
+                  quantization.dequantize(
+                      packed, out + begin, end - begin, false);
+                });
+          });
+    }
+
+    template <typename T>
+    inline void DequantizedView<T>::gather(const uint32_t *indices,
+                                           vec3f *out,
+                                           size_t n,
+                                           bool parallel) const
+    {
+      detail::forQuantizeChunks(
+          n, parallel, [&](size_t chunkBegin, size_t chunkEnd) {
+            memory::ScratchScope scratch;
+            auto *packed = scratch.allocate<QuantizedVec3<T>>(
+                std::min(chunkEnd - chunkBegin, size_t(4096)));
+            detail::forScratchBlocks(
+                chunkBegin, chunkEnd, [&](size_t begin, size_t end) {
+                  view.gather(indices + begin, packed, end - begin, false);
+                  quantization.dequantize(
+                      packed, out + begin, end - begin, false);
+                });
+          });
+    }
+
+    template <typename T>
+    inline const utility::DataView<QuantizedVec3<T>> &
+    DequantizedView<T>::data() const
+    {
+      return view;
+    }
+
+    template <typename T>
+    inline const QuantizationDomain<T> &DequantizedView<T>::domain() const
+    {
+      return quantization;
+    }
+
+    inline OctahedralNormalView::OctahedralNormalView(
+        const utility::DataView<vec2s> &data)
+        : view(data)
+    {
+    }
+
+    inline vec3f OctahedralNormalView::operator[](size_t index) const
+    {
+      return decodeOctahedral(view[index]);
+    }
+
+    inline void OctahedralNormalView::copyTo(vec3f *out,
+                                             size_t first,
+                                             size_t count,
+                                             bool parallel) const
+    {
+      detail::forQuantizeChunks(
+          count, parallel, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+              out[i] = decodeOctahedral(view[first + i]);
+          });
+    }
+
+    inline void OctahedralNormalView::gather(const uint32_t *indices,
+                                             vec3f *out,
+                                             size_t n,
+                                             bool parallel) const
+    {
+      detail::forQuantizeChunks(n, parallel, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+          out[i] = decodeOctahedral(view[indices[i]]);
+      });
+    }
+
+    inline const utility::DataView<vec2s> &OctahedralNormalView::data() const
+    {
+      return view;
+    }
+
+  }  // namespace math
+}  // namespace rkcommon
@@ -0,0 +1,617 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "quaternionArray.h"
+#include "dispatch.h"
+#include "../tasking/parallel_for.h"
+
+namespace rkcommon {
+  namespace math {
+
+    static constexpr int W = NATIVE_PACKET_WIDTH < 4 ? 4 : NATIVE_PACKET_WIDTH;
+
+    // elements per parallel task
+    static constexpr size_t QUATERNION_CHUNK_SIZE = 16 * 1024;
+
+    namespace {
+
+      struct quatvf
+      {
+        vfloat<W> r, i, j, k;
+      };
+
+      // W LinearSpace3f in SoA layout; the columns are vx, vy and vz
+      struct linearvf
+      {
+        vec3vf<W> vx, vy, vz;
+      };
+
+    }  // namespace
+
+    // calls 'fcn(begin, count)' for each packet of up to W elements
+    template <typename FCN_T>
+    static void forEachPacket(size_t n, bool parallel, FCN_T &&fcn)
+    {
+      auto range = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += W)
+          fcn(i, int(std::min(size_t(W), end - i)));
+      };
+
+      if (!parallel || n < QUATERNION_PARALLEL_THRESHOLD) {
+        range(0, n);
+        return;
+      }
+
+      tasking::parallel_for(
+          divRoundUp(n, QUATERNION_CHUNK_SIZE), [&](size_t chunk) {
+            const size_t begin = chunk * QUATERNION_CHUNK_SIZE;
+            range(begin, std::min(n, begin + QUATERNION_CHUNK_SIZE));
+          });
+    }
+
+    // Loads and stores, the lanes past 'count' are inactive //////////////////
+
+    static inline vbool<W> activeLanes(int count)
+    {
+      vfloat<W> lane;
+      for (int l = 0; l < W; ++l)
+        lane[l] = float(l);
+      return lane < float(count);
+    }
+
+    static inline vfloat<W> loadStream(const float *ptr, int count)
+    {
+      return count == W ? vfloat<W>::loadu(ptr)
+                        : vfloat<W>::loadu(activeLanes(count), ptr);
+    }
+
+    static inline void storeStream(float *ptr, int count, const vfloat<W> &v)
+    {
+      if (count == W)
+        vfloat<W>::storeu(ptr, v);
+      else
+        vfloat<W>::storeu(activeLanes(count), ptr, v);
+    }
+
+    static inline quatvf load(const ConstQuaternionStreams &q,
+                              size_t begin,
+                              int count)
+    {
+      quatvf r;
+      r.r = loadStream(q.r + begin, count);
+      r.i = loadStream(q.i + begin, count);
+      r.j = loadStream(q.j + begin, count);
+      r.k = loadStream(q.k + begin, count);
+      return r;
+    }
+
+    static inline void store(const QuaternionStreams &q,
+                             size_t begin,
+                             int count,
+                             const quatvf &v)
+    {
+      storeStream(q.r + begin, count, v.r);
+      storeStream(q.i + begin, count, v.i);
+      storeStream(q.j + begin, count, v.j);
+      storeStream(q.k + begin, count, v.k);
+    }
+
+    static inline void setLane(vec3vf<W> &v, int l, const vec3f &s)
+    {
+      v.x[l] = s.x;
+      v.y[l] = s.y;
+      v.z[l] = s.z;
+    }
+
+    // inactive lanes are the identity, so they compute nothing invalid
+    static inline linearvf gather(const LinearSpace3f *in, int count)
+    {
+      linearvf r;
+      r.vx = vec3vf<W>(1.f, 0.f, 0.f);
+      r.vy = vec3vf<W>(0.f, 1.f, 0.f);
+      r.vz = vec3vf<W>(0.f, 0.f, 1.f);
+      for (int l = 0; l < count; ++l) {
+        setLane(r.vx, l, in[l].vx);
+        setLane(r.vy, l, in[l].vy);
+        setLane(r.vz, l, in[l].vz);
+      }
+      return r;
+    }
+
+    static inline linearvf gather(const AffineSpace3f *in,
+                                  int count,
+                                  vec3vf<W> &p)
+    {
+      linearvf r;
+      r.vx = vec3vf<W>(1.f, 0.f, 0.f);
+      r.vy = vec3vf<W>(0.f, 1.f, 0.f);
+      r.vz = vec3vf<W>(0.f, 0.f, 1.f);
+      p    = vec3vf<W>(0.f);
+      for (int l = 0; l < count; ++l) {
+        setLane(r.vx, l, in[l].l.vx);
+        setLane(r.vy, l, in[l].l.vy);
+        setLane(r.vz, l, in[l].l.vz);
+        setLane(p, l, in[l].p);
+      }
+      return r;
+    }
+
+    static inline void scatter(LinearSpace3f *out,
+                               int count,
+                               const linearvf &v)
+    {
+      for (int l = 0; l < count; ++l) {
+        out[l].vx = extract(v.vx, l);
+        out[l].vy = extract(v.vy, l);
+        out[l].vz = extract(v.vz, l);
+      }
+    }
+
+    static inline void scatter(AffineSpace3f *out,
+                               int count,
+                               const linearvf &v,
+                               const vec3vf<W> &p)
+    {
+      for (int l = 0; l < count; ++l) {
+        out[l].l.vx = extract(v.vx, l);
+        out[l].l.vy = extract(v.vy, l);
+        out[l].l.vz = extract(v.vz, l);
+        out[l].p    = extract(p, l);
+      }
+    }
+
+    // Packet math ////////////////////////////////////////////////////////////
+
+    static inline vfloat<W> dot(const quatvf &a, const quatvf &b)
+    {
+      return a.r * b.r + a.i * b.i + a.j * b.j + a.k * b.k;
+    }
+
+    static inline quatvf lerp(const vfloat<W> &t,
+                              const quatvf &a,
+                              const quatvf &b)
+    {
+      const vfloat<W> s = 1.f - t;
+      quatvf r;
+      r.r = s * a.r + t * b.r;
+      r.i = s * a.i + t * b.i;
+      r.j = s * a.j + t * b.j;
+      r.k = s * a.k + t * b.k;
+      return r;
+    }
+
+    static inline quatvf scale(const quatvf &q, const vfloat<W> &s)
+    {
+      quatvf r;
+      r.r = q.r * s;
+      r.i = q.i * s;
+      r.j = q.j * s;
+      r.k = q.k * s;
+      return r;
+    }
+
+    // flips 'a' to the same hemisphere as 'b', returns |dot(a, b)|
+    static inline vfloat<W> shortestPath(quatvf &a, const quatvf &b)
+    {
+      const vfloat<W> d    = dot(a, b);
+      const vbool<W> flip  = d < 0.f;
+      a.r                  = select(flip, -a.r, a.r);
+      a.i                  = select(flip, -a.i, a.i);
+      a.j                  = select(flip, -a.j, a.j);
+      a.k                  = select(flip, -a.k, a.k);
+      return abs(d);
+    }
+
+    template <MathPrecision P>
+    static inline quatvf normalize(const quatvf &q)
+    {
+      return scale(q, fast_rsqrt<P>(dot(q, q)));
+    }
+
+    template <MathPrecision P>
+    static inline quatvf nlerp(const vfloat<W> &t, quatvf a, const quatvf &b)
+    {
+      shortestPath(a, b);
+      return normalize<P>(lerp(t, a, b));
+    }
+
+    // acos(x) for x in [0, 1], Abramowitz & Stegun 4.4.46
+    static inline vfloat<W> acosUnit(const vfloat<W> &x)
+    {
+      vfloat<W> p = -0.0012624911f;
+      p           = madd(p, x, vfloat<W>(0.0066700901f));
+      p           = madd(p, x, vfloat<W>(-0.0170881256f));
+      p           = madd(p, x, vfloat<W>(0.0308918810f));
+      p           = madd(p, x, vfloat<W>(-0.0501743046f));
+      p           = madd(p, x, vfloat<W>(0.0889789874f));
+      p           = madd(p, x, vfloat<W>(-0.2145988016f));
+      p           = madd(p, x, vfloat<W>(1.5707963050f));
+      return sqrt(max(1.f - x, vfloat<W>(0.f))) * p;
+    }
+
+    template <MathPrecision P>
+    static inline quatvf slerp(const vfloat<W> &t, quatvf a, const quatvf &b)
+    {
+      const vfloat<W> d = shortestPath(a, b);
+
+      if (P == MathPrecision::Fast) {
+        // Kapoulkine, "Approximating slerp" (2015)
+        const vfloat<W> A =
+            1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+        const vfloat<W> B = 0.848013f + d * (-1.06021f + d * 0.215638f);
+        const vfloat<W> h = t - .5f;
+        const vfloat<W> k = A * h * h + B;
+        const vfloat<W> u = t + t * h * (t - 1.f) * k;
+        return normalize<P>(lerp(u, a, b));
+      }
+
+      // same as the scalar slerp(), incl. the nlerp() for small angles
+      const vfloat<W> theta0 = acosUnit(min(d, vfloat<W>(1.f)));
+      vfloat<W> sinTheta, cosTheta;
+      fast_sincos<P>(theta0 * t, sinTheta, cosTheta);
+      const vfloat<W> sinTheta0 = sqrt(max(1.f - d * d, vfloat<W>(1e-6f)));
+      const vfloat<W> fb        = sinTheta / sinTheta0;
+      const vfloat<W> fa        = cosTheta - d * fb;
+
+      const quatvf nl    = normalize<P>(lerp(t, a, b));
+      const vbool<W> lin = d > .9995f;
+      quatvf r;
+      r.r = select(lin, nl.r, fa * a.r + fb * b.r);
+      r.i = select(lin, nl.i, fa * a.i + fb * b.i);
+      r.j = select(lin, nl.j, fa * a.j + fb * b.j);
+      r.k = select(lin, nl.k, fa * a.k + fb * b.k);
+      return r;
+    }
+
+    // LinearSpace3(const QuaternionT &)
+    static inline linearvf toLinear(const quatvf &q)
+    {
+      const vfloat<W> rr = q.r * q.r, ii = q.i * q.i;
+      const vfloat<W> jj = q.j * q.j, kk = q.k * q.k;
+      const vfloat<W> ij = q.i * q.j, ik = q.i * q.k, jk = q.j * q.k;
+      const vfloat<W> ri = q.r * q.i, rj = q.r * q.j, rk = q.r * q.k;
+
+      linearvf l;
+      l.vx = vec3vf<W>(rr + ii - jj - kk, 2.f * (ij + rk), 2.f * (ik - rj));
+      l.vy = vec3vf<W>(2.f * (ij - rk), rr - ii + jj - kk, 2.f * (jk + ri));
+      l.vz = vec3vf<W>(2.f * (ik + rj), 2.f * (jk - ri), rr - ii - jj + kk);
+      return l;
+    }
+
+    // QuaternionT(vx, vy, vz), with its four cases as selects
+    static inline quatvf fromLinear(const linearvf &l)
+    {
+      const vfloat<W> xx = l.vx.x, yy = l.vy.y, zz = l.vz.z;
+
+      const vbool<W> m0 = xx + yy + zz >= 0.f;
+      const vbool<W> m1 = (!m0) & (xx >= max(yy, zz));
+      const vbool<W> m2 = (!m0) & (!m1) & (yy >= zz);
+
+      const vfloat<W> t = select(
+          m0,
+          1.f + (xx + yy + zz),
+          select(m1,
+                 (1.f + xx) - (yy + zz),
+                 select(m2, (1.f + yy) - (zz + xx), (1.f + zz) - (xx + yy))));
+
+      const vfloat<W> a = l.vy.z - l.vz.y, b = l.vz.x - l.vx.z;
+      const vfloat<W> c = l.vx.y - l.vy.x, d = l.vx.y + l.vy.x;
+      const vfloat<W> e = l.vz.x + l.vx.z, f = l.vy.z + l.vz.y;
+
+      quatvf q;
+      q.r = select(m0, t, select(m1, a, select(m2, b, c)));
+      q.i = select(m0, a, select(m1, t, select(m2, d, e)));
+      q.j = select(m0, b, select(m1, d, select(m2, t, f)));
+      q.k = select(m0, c, select(m1, e, select(m2, f, t)));
+      return scale(q, .5f / sqrt(t));
+    }
+
+    static inline vec3vf<W> mul(const linearvf &a, const vec3vf<W> &v)
+    {
+      return a.vx * v.x + a.vy * v.y + a.vz * v.z;
+    }
+
+    static inline linearvf mul(const linearvf &a, const linearvf &b)
+    {
+      linearvf r;
+      r.vx = mul(a, b.vx);
+      r.vy = mul(a, b.vy);
+      r.vz = mul(a, b.vz);
+      return r;
+    }
+
+    static inline linearvf lerp(const vfloat<W> &t,
+                                const linearvf &a,
+                                const linearvf &b)
+    {
+      const vfloat<W> s = 1.f - t;
+      linearvf r;
+      r.vx = a.vx * s + b.vx * t;
+      r.vy = a.vy * s + b.vy * t;
+      r.vz = a.vz * s + b.vz * t;
+      return r;
+    }
+
+    // Gram-Schmidt: l == toLinear(rotation) * scaleShear
+    static inline void decompose(const linearvf &l,
+                                 quatvf &rotation,
+                                 linearvf &scaleShear)
+    {
+      const vfloat<W> sxx = sqrt(dot(l.vx, l.vx));
+      const vec3vf<W> r0  = l.vx * (1.f / sxx);
+
+      const vfloat<W> sxy = dot(r0, l.vy);
+      const vec3vf<W> u1  = l.vy - r0 * sxy;
+      const vfloat<W> syy = sqrt(dot(u1, u1));
+      const vec3vf<W> r1  = u1 * (1.f / syy);
+
+      const vec3vf<W> r2 = cross(r0, r1);
+
+      linearvf rot;
+      rot.vx   = r0;
+      rot.vy   = r1;
+      rot.vz   = r2;
+      rotation = fromLinear(rot);
+
+      scaleShear.vx = vec3vf<W>(sxx, 0.f, 0.f);
+      scaleShear.vy = vec3vf<W>(sxy, syy, 0.f);
+      scaleShear.vz =
+          vec3vf<W>(dot(r0, l.vz), dot(r1, l.vz), dot(r2, l.vz));
+    }
+
+    template <MathPrecision P>
+    static void interpolateTransformsImpl(float factor,
+                                          const AffineSpace3f *keys0,
+                                          const AffineSpace3f *keys1,
+                                          AffineSpace3f *out,
+                                          size_t n,
+                                          bool parallel)
+    {
+      const vfloat<W> t(factor);
+
+      forEachPacket(n, parallel, [&](size_t begin, int count) {
+        vec3vf<W> p0, p1;
+        const linearvf l0 = gather(keys0 + begin, count, p0);
+        const linearvf l1 = gather(keys1 + begin, count, p1);
+
+        quatvf q0, q1;
+        linearvf s0, s1;
+        decompose(l0, q0, s0);
+        decompose(l1, q1, s1);
+
+        const linearvf l =
+            mul(toLinear(slerp<P>(t, q0, q1)), lerp(t, s0, s1));
+        scatter(out + begin, count, l, p0 * (1.f - t) + p1 * t);
+      });
+    }
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      void slerp(float factor,
+                 const ConstQuaternionStreams &a,
+                 const ConstQuaternionStreams &b,
+                 const QuaternionStreams &out,
+                 size_t n,
+                 MathPrecision precision,
+                 bool parallel)
+      {
+        const vfloat<W> t(factor);
+        forEachPacket(n, parallel, [&](size_t begin, int count) {
+          const quatvf qa = load(a, begin, count);
+          const quatvf qb = load(b, begin, count);
+          store(out,
+                begin,
+                count,
+                precision == MathPrecision::Fast
+                    ? math::slerp<MathPrecision::Fast>(t, qa, qb)
+                    : math::slerp<MathPrecision::Accurate>(t, qa, qb));
+        });
+      }
+
+      void nlerp(float factor,
+                 const ConstQuaternionStreams &a,
+                 const ConstQuaternionStreams &b,
+                 const QuaternionStreams &out,
+                 size_t n,
+                 MathPrecision precision,
+                 bool parallel)
+      {
+        const vfloat<W> t(factor);
+        forEachPacket(n, parallel, [&](size_t begin, int count) {
+          const quatvf qa = load(a, begin, count);
+          const quatvf qb = load(b, begin, count);
+          store(out,
+                begin,
+                count,
+                precision == MathPrecision::Fast
+                    ? math::nlerp<MathPrecision::Fast>(t, qa, qb)
+                    : math::nlerp<MathPrecision::Accurate>(t, qa, qb));
+        });
+      }
+
+      void toLinearSpace(const ConstQuaternionStreams &q,
+                         LinearSpace3f *out,
+                         size_t n,
+                         bool parallel)
+      {
+        forEachPacket(n, parallel, [&](size_t begin, int count) {
+          scatter(out + begin, count, toLinear(load(q, begin, count)));
+        });
+      }
+
+      void decompose(const AffineSpace3f *xfms,
+                     const QuaternionStreams &rotation,
+                     LinearSpace3f *scaleShear,
+                     vec3f *translation,
+                     size_t n,
+                     bool parallel)
+      {
+        forEachPacket(n, parallel, [&](size_t begin, int count) {
+          vec3vf<W> p;
+          const linearvf l = gather(xfms + begin, count, p);
+          quatvf q;
+          linearvf s;
+          math::decompose(l, q, s);
+          store(rotation, begin, count, q);
+          scatter(scaleShear + begin, count, s);
+          for (int i = 0; i < count; ++i)
+            translation[begin + i] = xfms[begin + i].p;
+        });
+      }
+
+      void compose(const ConstQuaternionStreams &rotation,
+                   const LinearSpace3f *scaleShear,
+                   const vec3f *translation,
+                   AffineSpace3f *out,
+                   size_t n,
+                   bool parallel)
+      {
+        forEachPacket(n, parallel, [&](size_t begin, int count) {
+          const linearvf r = toLinear(load(rotation, begin, count));
+          const linearvf l = mul(r, gather(scaleShear + begin, count));
+          for (int i = 0; i < count; ++i) {
+            out[begin + i].l.vx = extract(l.vx, i);
+            out[begin + i].l.vy = extract(l.vy, i);
+            out[begin + i].l.vz = extract(l.vz, i);
+            out[begin + i].p    = translation[begin + i];
+          }
+        });
+      }
+
+      void interpolateTransforms(float factor,
+                                 const AffineSpace3f *keys0,
+                                 const AffineSpace3f *keys1,
+                                 AffineSpace3f *out,
+                                 size_t n,
+                                 MathPrecision precision,
+                                 bool parallel)
+      {
+        if (precision == MathPrecision::Fast)
+          interpolateTransformsImpl<MathPrecision::Fast>(
+              factor, keys0, keys1, out, n, parallel);
+        else
+          interpolateTransformsImpl<MathPrecision::Accurate>(
+              factor, keys0, keys1, out, n, parallel);
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // quaternionArray.h definitions ///////////////////////////////////////////
+
+    using InterpolateFcn = void(float,
+                                const ConstQuaternionStreams &,
+                                const ConstQuaternionStreams &,
+                                const QuaternionStreams &,
+                                size_t,
+                                MathPrecision,
+                                bool);
+    using ToLinearSpaceFcn = void(const ConstQuaternionStreams &,
+                                  LinearSpace3f *,
+                                  size_t,
+                                  bool);
+    using DecomposeFcn = void(const AffineSpace3f *,
+                              const QuaternionStreams &,
+                              LinearSpace3f *,
+                              vec3f *,
+                              size_t,
+                              bool);
+    using ComposeFcn = void(const ConstQuaternionStreams &,
+                            const LinearSpace3f *,
+                            const vec3f *,
+                            AffineSpace3f *,
+                            size_t,
+                            bool);
+    using InterpolateTransformsFcn = void(float,
+                                          const AffineSpace3f *,
+                                          const AffineSpace3f *,
+                                          AffineSpace3f *,
+                                          size_t,
+                                          MathPrecision,
+                                          bool);
+
+    RKCOMMON_ISA_DECLARE(InterpolateFcn slerp)
+    RKCOMMON_ISA_DECLARE(InterpolateFcn nlerp)
+    RKCOMMON_ISA_DECLARE(ToLinearSpaceFcn toLinearSpace)
+    RKCOMMON_ISA_DECLARE(DecomposeFcn decompose)
+    RKCOMMON_ISA_DECLARE(ComposeFcn compose)
+    RKCOMMON_ISA_DECLARE(InterpolateTransformsFcn interpolateTransforms)
+
+    void slerp(float factor,
+               const ConstQuaternionStreams &a,
+               const ConstQuaternionStreams &b,
+               const QuaternionStreams &out,
+               size_t n,
+               MathPrecision precision,
+               bool parallel)
+    {
+      static InterpolateFcn *const fcn =
+          RKCOMMON_ISA_SELECT(InterpolateFcn, slerp);
+      fcn(factor, a, b, out, n, precision, parallel);
+    }
+
+    void nlerp(float factor,
+               const ConstQuaternionStreams &a,
+               const ConstQuaternionStreams &b,
+               const QuaternionStreams &out,
+               size_t n,
+               MathPrecision precision,
+               bool parallel)
+    {
+      static InterpolateFcn *const fcn =
+          RKCOMMON_ISA_SELECT(InterpolateFcn, nlerp);
+      fcn(factor, a, b, out, n, precision, parallel);
+    }
+
+    void toLinearSpace(const ConstQuaternionStreams &q,
+                       LinearSpace3f *out,
+                       size_t n,
+                       bool parallel)
+    {
+      static ToLinearSpaceFcn *const fcn =
+          RKCOMMON_ISA_SELECT(ToLinearSpaceFcn, toLinearSpace);
+      fcn(q, out, n, parallel);
+    }
+
+    void decompose(const AffineSpace3f *xfms,
+                   const QuaternionStreams &rotation,
+                   LinearSpace3f *scaleShear,
+                   vec3f *translation,
+                   size_t n,
+                   bool parallel)
+    {
+      static DecomposeFcn *const fcn =
+          RKCOMMON_ISA_SELECT(DecomposeFcn, decompose);
+      fcn(xfms, rotation, scaleShear, translation, n, parallel);
+    }
+
+    void compose(const ConstQuaternionStreams &rotation,
+                 const LinearSpace3f *scaleShear,
+                 const vec3f *translation,
+                 AffineSpace3f *out,
+                 size_t n,
+                 bool parallel)
+    {
+      static ComposeFcn *const fcn =
+          RKCOMMON_ISA_SELECT(ComposeFcn, compose);
+      fcn(rotation, scaleShear, translation, out, n, parallel);
+    }
+
+    void interpolateTransforms(float factor,
+                               const AffineSpace3f *keys0,
+                               const AffineSpace3f *keys1,
+                               AffineSpace3f *out,
+                               size_t n,
+                               MathPrecision precision,
+                               bool parallel)
+    {
+      static InterpolateTransformsFcn *const fcn =
+          RKCOMMON_ISA_SELECT(InterpolateTransformsFcn, interpolateTransforms);
+      fcn(factor, keys0, keys1, out, n, precision, parallel);
+    }
+#endif
+
+  }  // namespace math
+}  // namespace rkcommon
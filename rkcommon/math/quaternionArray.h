@@ -0,0 +1,109 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "AffineSpace.h"
+#include "fastmath.h"
+
+namespace rkcommon {
+  namespace math {
+
+    /* 'n' quaternions stored as four component streams (structure of
+       arrays), e.g. the data(0..3) streams of a containers::SoAVector<vec4f>
+       holding (i, j, k, r). ConstQuaternionStreams is the read-only view
+       used for inputs. */
+    template <typename T>
+    struct QuaternionStreamsT
+    {
+      QuaternionStreamsT(T *r, T *i, T *j, T *k) : r(r), i(i), j(j), k(k) {}
+
+      // read-write streams also work as read-only ones
+      template <typename U>
+      QuaternionStreamsT(const QuaternionStreamsT<U> &other)
+          : r(other.r), i(other.i), j(other.j), k(other.k)
+      {
+      }
+
+      quatf operator[](size_t idx) const
+      {
+        return quatf(r[idx], i[idx], j[idx], k[idx]);
+      }
+
+      T *r, *i, *j, *k;
+    };
+
+    using QuaternionStreams      = QuaternionStreamsT<float>;
+    using ConstQuaternionStreams = QuaternionStreamsT<const float>;
+
+    /* Batched versions of slerp(), nlerp() and the quaternion <->
+       LinearSpace3f conversions in Quaternion.h/LinearSpace.h, computed a
+       SIMD packet at a time (see packet.h). With 'parallel' arrays of at
+       least QUATERNION_PARALLEL_THRESHOLD elements are split across
+       tasking::parallel_for(). Outputs may be the same arrays as inputs.
+
+       Interpolation takes the shorter way around, like slerp(); inputs
+       must be normalized. MathPrecision::Fast normalizes with the rsqrt()
+       estimate plus a Newton-Raphson step, and turns slerp() into an
+       nlerp() with a corrected factor that stays within about 2e-4 of the
+       exact slerp() but needs no acos/sin/cos. */
+
+    constexpr size_t QUATERNION_PARALLEL_THRESHOLD = 64 * 1024;
+
+    RKCOMMON_INTERFACE void slerp(
+        float factor,
+        const ConstQuaternionStreams &a,
+        const ConstQuaternionStreams &b,
+        const QuaternionStreams &out,
+        size_t n,
+        MathPrecision precision = MathPrecision::Accurate,
+        bool parallel           = true);
+
+    RKCOMMON_INTERFACE void nlerp(
+        float factor,
+        const ConstQuaternionStreams &a,
+        const ConstQuaternionStreams &b,
+        const QuaternionStreams &out,
+        size_t n,
+        MathPrecision precision = MathPrecision::Accurate,
+        bool parallel           = true);
+
+    // out[i] = LinearSpace3f(q[i])
+    RKCOMMON_INTERFACE void toLinearSpace(const ConstQuaternionStreams &q,
+                                          LinearSpace3f *out,
+                                          size_t n,
+                                          bool parallel = true);
+
+    /* Motion keys: xfms[i] == translate(translation[i]) *
+       LinearSpace3f(rotation[i]) * scaleShear[i], where 'rotation' is a
+       normalized quaternion and 'scaleShear' is upper triangular (a
+       mirroring transform gets a negative scaleShear.vz.z). Unlike the
+       matrices themselves, these parts interpolate into valid transforms:
+       slerp() the rotations and lerp() the rest. */
+    RKCOMMON_INTERFACE void decompose(const AffineSpace3f *xfms,
+                                      const QuaternionStreams &rotation,
+                                      LinearSpace3f *scaleShear,
+                                      vec3f *translation,
+                                      size_t n,
+                                      bool parallel = true);
+
+    RKCOMMON_INTERFACE void compose(const ConstQuaternionStreams &rotation,
+                                    const LinearSpace3f *scaleShear,
+                                    const vec3f *translation,
+                                    AffineSpace3f *out,
+                                    size_t n,
+                                    bool parallel = true);
+
+    /* The transforms at 'factor' between two motion keys per instance, as
+       if decompose()d, interpolated and compose()d in one pass */
+    RKCOMMON_INTERFACE void interpolateTransforms(
+        float factor,
+        const AffineSpace3f *keys0,
+        const AffineSpace3f *keys1,
+        AffineSpace3f *out,
+        size_t n,
+        MathPrecision precision = MathPrecision::Accurate,
+        bool parallel           = true);
+
+  }  // namespace math
+}  // namespace rkcommon
@@ -19,7 +19,7 @@ namespace rkcommon {
         can make a range<float>s etc. Vec-types will overwrite that and
         test if _any_ dimension is less */
     template <typename TA, typename TB>
-    inline bool anyLessThan(const TA &a, const TB &b)
+    constexpr bool anyLessThan(const TA &a, const TB &b)
     {
       return a < b;
     }
@@ -29,28 +29,29 @@ namespace rkcommon {
     {
       using bound_t = T;
 
-      range_t() : lower(pos_inf), upper(neg_inf) {}
-      range_t(const EmptyTy &) : lower(pos_inf), upper(neg_inf) {}
-      range_t(const ZeroTy &) : lower(zero), upper(zero) {}
-      range_t(const OneTy &) : lower(zero), upper(one) {}
-      range_t(const T &t) : lower(t), upper(t) {}
-      range_t(const T &_lower, const T &_upper) : lower(_lower), upper(_upper)
+      constexpr range_t() : lower(pos_inf), upper(neg_inf) {}
+      constexpr range_t(const EmptyTy &) : lower(pos_inf), upper(neg_inf) {}
+      constexpr range_t(const ZeroTy &) : lower(zero), upper(zero) {}
+      constexpr range_t(const OneTy &) : lower(zero), upper(one) {}
+      constexpr range_t(const T &t) : lower(t), upper(t) {}
+      constexpr range_t(const T &_lower, const T &_upper)
+          : lower(_lower), upper(_upper)
       {
       }
-      range_t(const T *v) : lower(v[0]), upper(v[1]) {}
+      constexpr range_t(const T *v) : lower(v[0]), upper(v[1]) {}
 
       template <typename other_t>
-      explicit range_t(const range_t<other_t> &other)
+      explicit constexpr range_t(const range_t<other_t> &other)
           : lower(T(other.lower)), upper(T(other.upper))
       {
       }
 
-      inline T size() const
+      constexpr T size() const
       {
         return upper - lower;
       }
 
-      inline T center() const
+      constexpr T center() const
       {
         return .5f * (lower + upper);
       }
@@ -70,7 +71,7 @@ namespace rkcommon {
       /*! take given value t, and 'clamp' it to 'this->'range; ie, if it
           already is inside the range return as is, otherwise move it to
           either lower or upper of this range. */
-      inline T clamp(const T &t) const
+      constexpr T clamp(const T &t) const
       {
         return max(lower, min(t, upper));
       }
@@ -81,12 +82,12 @@ namespace rkcommon {
           const std::string &string,
           const range_t<T> &defaultValue = rkcommon::math::empty);
 
-      inline bool empty() const
+      constexpr bool empty() const
       {
         return anyLessThan(upper, lower);
       }
 
-      inline bool contains(const T &t) const
+      constexpr bool contains(const T &t) const
       {
         return !anyLessThan(t, lower) && !anyLessThan(upper, t);
       }
@@ -113,28 +114,30 @@ namespace rkcommon {
 
     /*! scale range, per dimension */
     template <typename T>
-    inline range_t<T> operator*(const range_t<T> &range, const T &scale)
+    constexpr range_t<T> operator*(const range_t<T> &range, const T &scale)
     {
       return range_t<T>(range.lower * scale, range.upper * scale);
     }
 
     /*! scale range, per dimension */
     template <typename T>
-    inline range_t<T> operator*(const T &scale, const range_t<T> &range)
+    constexpr range_t<T> operator*(const T &scale, const range_t<T> &range)
     {
       return range_t<T>(range.lower * scale, range.upper * scale);
     }
 
     /*! translate a range, per dimension */
     template <typename T>
-    inline range_t<T> operator+(const range_t<T> &range, const T &translation)
+    constexpr range_t<T> operator+(const range_t<T> &range,
+                                   const T &translation)
     {
       return range_t<T>(range.lower + translation, range.upper + translation);
     }
 
     /*! translate a range, per dimension */
     template <typename T>
-    inline range_t<T> operator+(const T &translation, const range_t<T> &range)
+    constexpr range_t<T> operator+(const T &translation,
+                                   const range_t<T> &range)
     {
       return range_t<T>(range.lower + translation, range.upper + translation);
     }
@@ -142,13 +145,13 @@ namespace rkcommon {
     // comparison operators ///////////////////////////////////////////////////
 
     template <typename T>
-    inline bool operator==(const range_t<T> &a, const range_t<T> &b)
+    constexpr bool operator==(const range_t<T> &a, const range_t<T> &b)
     {
       return a.lower == b.lower && a.upper == b.upper;
     }
 
     template <typename T>
-    inline bool operator!=(const range_t<T> &a, const range_t<T> &b)
+    constexpr bool operator!=(const range_t<T> &a, const range_t<T> &b)
     {
       return !(a == b);
     }
@@ -106,7 +106,9 @@ namespace rkcommon {
       return x * T(1.745329251994329576923690768489e-2);
     }
 
-    __forceinline float madd(const float a, const float b, const float c)
+    __forceinline constexpr float madd(const float a,
+                                       const float b,
+                                       const float c)
     {
       return a * b + c;
     }
@@ -136,5 +138,17 @@ namespace rkcommon {
 #endif
     }
 
+    // inverse of linear_to_srgb()
+    inline float srgb_to_linear(const float f)
+    {
+      const float c = std::max(f, 0.f);
+#ifdef APPROXIMATE_SRGB
+      return std::pow(c, 2.2f);
+#else
+      return c <= 0.04045f ? c / 12.92f
+                           : std::pow((c + 0.055f) / 1.055f, 2.4f);
+#endif
+    }
+
   }  // namespace math
 }  // namespace rkcommon
@@ -28,6 +28,18 @@ namespace rkcommon {
       const static bool value = std::is_base_of<vec_base, T>::value;
     };
 
+    /* element types vec_t<> can hold: the arithmetic types, plus the
+       packet types from packet.h and the 16-bit floats from half.h, which
+       specialize this trait */
+    template <typename T>
+    struct is_vec_element
+    {
+      const static bool value = std::is_arithmetic<T>::value;
+    };
+
+    template <typename T>
+    using is_vec_element_t = enable_if_t<is_vec_element<T>::value>;
+
     template <typename VEC_ELEMENT_T, typename TYPE_IN_QUESTION>
     struct is_valid_vec_constructor_type
     {
@@ -50,7 +62,7 @@ namespace rkcommon {
     template <typename T,
       int N,
       bool ALIGN = false,
-      typename = typename traits::is_arithmetic_t<T>>
+      typename = typename traits::is_vec_element_t<T>>
     struct vec_t : public vec_base
     {
       using scalar_t = T;
@@ -65,20 +77,20 @@ namespace rkcommon {
 
       vec_t() = default;
 
-      vec_t(const scalar_t *v) : x(v[0]), y(v[1]) {}
+      constexpr vec_t(const scalar_t *v) : x(v[0]), y(v[1]) {}
 
-      vec_t(scalar_t s) : x(s), y(s) {}
+      constexpr vec_t(scalar_t s) : x(s), y(s) {}
 
       template <typename OT,
                 typename = traits::is_valid_vec_constructor_type_t<T, OT>>
-      vec_t(const OT &s) : x(s), y(s)
+      constexpr vec_t(const OT &s) : x(s), y(s)
       {
       }
 
-      vec_t(scalar_t x, scalar_t y) : x(x), y(y) {}
+      constexpr vec_t(scalar_t x, scalar_t y) : x(x), y(y) {}
 
       template <typename OT, bool OA>
-      vec_t(const vec_t<OT, 2, OA> &o) : x(o.x), y(o.y)
+      constexpr vec_t(const vec_t<OT, 2, OA> &o) : x(o.x), y(o.y)
       {
       }
 
@@ -105,24 +117,24 @@ namespace rkcommon {
       }
 
       /*! return result of reduce_add() across all components */
-      scalar_t sum() const
+      constexpr scalar_t sum() const
       {
         return x + y;
       }
       /*! return result of reduce_mul() across all components */
-      scalar_t product() const
+      constexpr scalar_t product() const
       {
         return x * y;
       }
 
-      size_t long_product() const
+      constexpr size_t long_product() const
       {
         return size_t(x) * size_t(y);
       }
 
       // conversion constructor to other types to enable static_cast
       template <typename OT>
-      explicit operator vec_t<OT, 2>() const
+      explicit constexpr operator vec_t<OT, 2>() const
       {
         return vec_t<OT, 2>(*this);
       }
@@ -138,25 +150,26 @@ namespace rkcommon {
 
       vec_t() = default;
 
-      vec_t(const scalar_t *v) : x(v[0]), y(v[1]), z(v[2]) {}
+      constexpr vec_t(const scalar_t *v) : x(v[0]), y(v[1]), z(v[2]) {}
 
-      vec_t(scalar_t s) : x(s), y(s), z(s) {}
+      constexpr vec_t(scalar_t s) : x(s), y(s), z(s) {}
 
       template <typename OT,
                 typename = traits::is_valid_vec_constructor_type_t<T, OT>>
-      vec_t(const OT &s) : x(s), y(s), z(s)
+      constexpr vec_t(const OT &s) : x(s), y(s), z(s)
       {
       }
 
-      vec_t(scalar_t x, scalar_t y, scalar_t z) : x(x), y(y), z(z) {}
+      constexpr vec_t(scalar_t x, scalar_t y, scalar_t z) : x(x), y(y), z(z) {}
 
       template <typename OT, bool OA>
-      vec_t(const vec_t<OT, 2, OA> &o, scalar_t z) : x(o.x), y(o.y), z(z)
+      constexpr vec_t(const vec_t<OT, 2, OA> &o, scalar_t z)
+          : x(o.x), y(o.y), z(z)
       {
       }
 
       template <typename OT, bool OA>
-      vec_t(const vec_t<OT, 3, OA> &o) : x(o.x), y(o.y), z(o.z)
+      constexpr vec_t(const vec_t<OT, 3, OA> &o) : x(o.x), y(o.y), z(o.z)
       {
       }
 
@@ -183,25 +196,25 @@ namespace rkcommon {
       }
 
       /*! return result of reduce_add() across all components */
-      scalar_t sum() const
+      constexpr scalar_t sum() const
       {
         return x + y + z;
       }
 
       /*! return result of reduce_mul() across all components */
-      scalar_t product() const
+      constexpr scalar_t product() const
       {
         return x * y * z;
       }
 
-      size_t long_product() const
+      constexpr size_t long_product() const
       {
         return size_t(x) * size_t(y) * size_t(z);
       }
 
       // conversion constructor to other types to enable static_cast
       template <typename OT>
-      explicit operator vec_t<OT, 3>() const
+      explicit constexpr operator vec_t<OT, 3>() const
       {
         return vec_t<OT, 3>(*this);
       }
@@ -217,25 +230,33 @@ namespace rkcommon {
 
       vec_t() = default;
 
-      vec_t(const scalar_t *v) : x(v[0]), y(v[1]), z(v[2]) {}
+      constexpr vec_t(const scalar_t *v)
+          : x(v[0]), y(v[1]), z(v[2]), padding_(0)
+      {
+      }
 
-      vec_t(scalar_t s) : x(s), y(s), z(s) {}
+      constexpr vec_t(scalar_t s) : x(s), y(s), z(s), padding_(0) {}
 
       template <typename OT,
                 typename = traits::is_valid_vec_constructor_type_t<T, OT>>
-      vec_t(const OT &s) : x(s), y(s), z(s)
+      constexpr vec_t(const OT &s) : x(s), y(s), z(s), padding_(0)
       {
       }
 
-      vec_t(scalar_t x, scalar_t y, scalar_t z) : x(x), y(y), z(z) {}
+      constexpr vec_t(scalar_t x, scalar_t y, scalar_t z)
+          : x(x), y(y), z(z), padding_(0)
+      {
+      }
 
       template <typename OT, bool OA>
-      vec_t(const vec_t<OT, 2, OA> &o, scalar_t z) : x(o.x), y(o.y), z(z)
+      constexpr vec_t(const vec_t<OT, 2, OA> &o, scalar_t z)
+          : x(o.x), y(o.y), z(z), padding_(0)
       {
       }
 
       template <typename OT, bool OA>
-      vec_t(const vec_t<OT, 3, OA> &o) : x(o.x), y(o.y), z(o.z)
+      constexpr vec_t(const vec_t<OT, 3, OA> &o)
+          : x(o.x), y(o.y), z(o.z), padding_(0)
       {
       }
 
@@ -261,29 +282,29 @@ namespace rkcommon {
       }
 
       /*! return result of reduce_add() across all components */
-      scalar_t sum() const
+      constexpr scalar_t sum() const
       {
         return x + y + z;
       }
       /*! return result of reduce_mul() across all components */
-      scalar_t product() const
+      constexpr scalar_t product() const
       {
         return x * y * z;
       }
 
-      size_t long_product() const
+      constexpr size_t long_product() const
       {
         return size_t(x) * size_t(y) * size_t(z);
       }
 
-      operator vec_t<T, 3>() const
+      constexpr operator vec_t<T, 3>() const
       {
         return vec_t<T, 3>(x, y, z);
       }
 
       // conversion constructor to other types to enable static_cast
       template <typename OT>
-      explicit operator vec_t<OT, 3, true>() const
+      explicit constexpr operator vec_t<OT, 3, true>() const
       {
         return vec_t<OT, 3, true>(*this);
       }
@@ -300,35 +321,36 @@ namespace rkcommon {
 
       vec_t() = default;
 
-      vec_t(const scalar_t *v) : x(v[0]), y(v[1]), z(v[2]), w(v[3]) {}
+      constexpr vec_t(const scalar_t *v) : x(v[0]), y(v[1]), z(v[2]), w(v[3]) {}
 
-      vec_t(scalar_t s) : x(s), y(s), z(s), w(s) {}
+      constexpr vec_t(scalar_t s) : x(s), y(s), z(s), w(s) {}
 
       template <typename OT,
                 typename = traits::is_valid_vec_constructor_type_t<T, OT>>
-      vec_t(const OT &s) : x(s), y(s), z(s), w(s)
+      constexpr vec_t(const OT &s) : x(s), y(s), z(s), w(s)
       {
       }
 
-      vec_t(scalar_t x, scalar_t y, scalar_t z, scalar_t w)
+      constexpr vec_t(scalar_t x, scalar_t y, scalar_t z, scalar_t w)
           : x(x), y(y), z(z), w(w)
       {
       }
 
       template <typename OT, bool OA>
-      vec_t(const vec_t<OT, 2, OA> &o1, const vec_t<OT, 2, OA> &o2)
+      constexpr vec_t(const vec_t<OT, 2, OA> &o1, const vec_t<OT, 2, OA> &o2)
           : x(o1.x), y(o1.y), z(o2.x), w(o2.y)
       {
       }
 
       template <typename OT, bool OA>
-      vec_t(const vec_t<OT, 3, OA> &o, scalar_t w)
+      constexpr vec_t(const vec_t<OT, 3, OA> &o, scalar_t w)
           : x(o.x), y(o.y), z(o.z), w(w)
       {
       }
 
       template <typename OT, bool OA>
-      vec_t(const vec_t<OT, 4, OA> &o) : x(o.x), y(o.y), z(o.z), w(o.w)
+      constexpr vec_t(const vec_t<OT, 4, OA> &o)
+          : x(o.x), y(o.y), z(o.z), w(o.w)
       {
       }
 
@@ -354,24 +376,24 @@ namespace rkcommon {
       }
 
       /*! return result of reduce_add() across all components */
-      scalar_t sum() const
+      constexpr scalar_t sum() const
       {
         return x + y + z + w;
       }
       /*! return result of reduce_mul() across all components */
-      scalar_t product() const
+      constexpr scalar_t product() const
       {
         return x * y * z * w;
       }
 
-      size_t long_product() const
+      constexpr size_t long_product() const
       {
         return size_t(x) * size_t(y) * size_t(z) * size_t(w);
       }
 
       // conversion constructor to other types to enable static_cast
       template <typename OT>
-      explicit operator vec_t<OT, 4>() const
+      explicit constexpr operator vec_t<OT, 4>() const
       {
         return vec_t<OT, 4>(*this);
       }
@@ -383,43 +405,43 @@ namespace rkcommon {
     // unary operators
     // -------------------------------------------------------
     template <typename T>
-    inline vec_t<T, 2> operator-(const vec_t<T, 2> &v)
+    constexpr vec_t<T, 2> operator-(const vec_t<T, 2> &v)
     {
       return vec_t<T, 2>(-v.x, -v.y);
     }
     template <typename T>
-    inline vec_t<T, 3> operator-(const vec_t<T, 3> &v)
+    constexpr vec_t<T, 3> operator-(const vec_t<T, 3> &v)
     {
       return vec_t<T, 3>(-v.x, -v.y, -v.z);
     }
     template <typename T>
-    inline vec_t<T, 3, 1> operator-(const vec_t<T, 3, 1> &v)
+    constexpr vec_t<T, 3, 1> operator-(const vec_t<T, 3, 1> &v)
     {
       return vec_t<T, 3, 1>(-v.x, -v.y, -v.z);
     }
     template <typename T>
-    inline vec_t<T, 4> operator-(const vec_t<T, 4> &v)
+    constexpr vec_t<T, 4> operator-(const vec_t<T, 4> &v)
     {
       return vec_t<T, 4>(-v.x, -v.y, -v.z, -v.w);
     }
 
     template <typename T>
-    inline vec_t<T, 2> operator+(const vec_t<T, 2> &v)
+    constexpr vec_t<T, 2> operator+(const vec_t<T, 2> &v)
     {
       return vec_t<T, 2>(+v.x, +v.y);
     }
     template <typename T>
-    inline vec_t<T, 3> operator+(const vec_t<T, 3> &v)
+    constexpr vec_t<T, 3> operator+(const vec_t<T, 3> &v)
     {
       return vec_t<T, 3>(+v.x, +v.y, +v.z);
     }
     template <typename T>
-    inline vec_t<T, 3, 1> operator+(const vec_t<T, 3, 1> &v)
+    constexpr vec_t<T, 3, 1> operator+(const vec_t<T, 3, 1> &v)
     {
       return vec_t<T, 3, 1>(+v.x, +v.y, +v.z);
     }
     template <typename T>
-    inline vec_t<T, 4> operator+(const vec_t<T, 4> &v)
+    constexpr vec_t<T, 4> operator+(const vec_t<T, 4> &v)
     {
       return vec_t<T, 4>(+v.x, +v.y, +v.z, +v.w);
     }
@@ -464,103 +486,103 @@ namespace rkcommon {
     // binary arithmetic operators
     // -------------------------------------------------------
 
-#define binary_operator(name, op)                                           \
-  /* "vec op vec" */                                                        \
-  template <typename T>                                                     \
-  inline vec_t<T, 2> name(const vec_t<T, 2> &a, const vec_t<T, 2> &b)       \
-  {                                                                         \
-    return vec_t<T, 2>(a.x op b.x, a.y op b.y);                             \
-  }                                                                         \
-                                                                            \
-  template <typename T, bool A, bool B>                                     \
-  inline vec_t<T, 3> name(const vec_t<T, 3, A> &a, const vec_t<T, 3, B> &b) \
-  {                                                                         \
-    return vec_t<T, 3>(a.x op b.x, a.y op b.y, a.z op b.z);                 \
-  }                                                                         \
-                                                                            \
-  template <typename T>                                                     \
-  inline vec_t<T, 4> name(const vec_t<T, 4> &a, const vec_t<T, 4> &b)       \
-  {                                                                         \
-    return vec_t<T, 4>(a.x op b.x, a.y op b.y, a.z op b.z, a.w op b.w);     \
-  }                                                                         \
-                                                                            \
-  /* "vec<T, N> op vec<U, N>" (element types don't match) */                \
-  template <typename T,                                                     \
-            typename U,                                                     \
-            int N,                                                          \
-            bool A,                                                         \
-            typename = traits::is_not_same_t<T, U>>                         \
-  inline auto name(const vec_t<T, N, A> &a, const vec_t<U, N, A> &b)        \
-      ->vec_t<decltype(T() op U()), N, A>                                   \
-  {                                                                         \
-    using vector_t = vec_t<decltype(T() op U()), N, A>;                     \
-    return vector_t(vector_t(a) op vector_t(b));                            \
-  }                                                                         \
-                                                                            \
-  /* "vec op scalar" */                                                     \
-  template <typename T>                                                     \
-  inline vec_t<T, 2> name(const vec_t<T, 2> &a, const T &b)                 \
-  {                                                                         \
-    return vec_t<T, 2>(a.x op b, a.y op b);                                 \
-  }                                                                         \
-                                                                            \
-  template <typename T, bool A>                                             \
-  inline vec_t<T, 3> name(const vec_t<T, 3, A> &a, const T &b)              \
-  {                                                                         \
-    return vec_t<T, 3>(a.x op b, a.y op b, a.z op b);                       \
-  }                                                                         \
-                                                                            \
-  template <typename T>                                                     \
-  inline vec_t<T, 4> name(const vec_t<T, 4> &a, const T &b)                 \
-  {                                                                         \
-    return vec_t<T, 4>(a.x op b, a.y op b, a.z op b, a.w op b);             \
-  }                                                                         \
-                                                                            \
-  /* "vec<T, N> op U" (element types don't match) */                        \
-  template <typename T,                                                     \
-            typename U,                                                     \
-            int N,                                                          \
-            bool A,                                                         \
-            typename = traits::is_not_same_t<T, U>>                         \
-  inline auto name(const vec_t<T, N, A> &a, const U &b)                     \
-      ->vec_t<decltype(T() op U()), N, A>                                   \
-  {                                                                         \
-    using scalar_t = decltype(T() op U());                                  \
-    using vector_t = vec_t<scalar_t, N, A>;                                 \
-    return vector_t(vector_t(a) op scalar_t(b));                            \
-  }                                                                         \
-                                                                            \
-  /* "scalar op vec" */                                                     \
-  template <typename T>                                                     \
-  inline vec_t<T, 2> name(const T &a, const vec_t<T, 2> &b)                 \
-  {                                                                         \
-    return vec_t<T, 2>(a op b.x, a op b.y);                                 \
-  }                                                                         \
-                                                                            \
-  template <typename T, bool A>                                             \
-  inline vec_t<T, 3> name(const T &a, const vec_t<T, 3, A> &b)              \
-  {                                                                         \
-    return vec_t<T, 3>(a op b.x, a op b.y, a op b.z);                       \
-  }                                                                         \
-                                                                            \
-  template <typename T>                                                     \
-  inline vec_t<T, 4> name(const T &a, const vec_t<T, 4> &b)                 \
-  {                                                                         \
-    return vec_t<T, 4>(a op b.x, a op b.y, a op b.z, a op b.w);             \
-  }                                                                         \
-                                                                            \
-  /* "T op vec<U, N>" (element types don't match) */                        \
-  template <typename T,                                                     \
-            typename U,                                                     \
-            int N,                                                          \
-            bool A,                                                         \
-            typename = traits::is_not_same_t<T, U>>                         \
-  inline auto name(const T &a, const vec_t<U, N, A> &b)                     \
-      ->vec_t<decltype(T() op U()), N, A>                                   \
-  {                                                                         \
-    using scalar_t = decltype(T() op U());                                  \
-    using vector_t = vec_t<scalar_t, N, A>;                                 \
-    return vector_t(scalar_t(a) op vector_t(b));                            \
+#define binary_operator(name, op)                                              \
+  /* "vec op vec" */                                                           \
+  template <typename T>                                                        \
+  constexpr vec_t<T, 2> name(const vec_t<T, 2> &a, const vec_t<T, 2> &b)       \
+  {                                                                            \
+    return vec_t<T, 2>(a.x op b.x, a.y op b.y);                                \
+  }                                                                            \
+                                                                               \
+  template <typename T, bool A, bool B>                                        \
+  constexpr vec_t<T, 3> name(const vec_t<T, 3, A> &a, const vec_t<T, 3, B> &b) \
+  {                                                                            \
+    return vec_t<T, 3>(a.x op b.x, a.y op b.y, a.z op b.z);                    \
+  }                                                                            \
+                                                                               \
+  template <typename T>                                                        \
+  constexpr vec_t<T, 4> name(const vec_t<T, 4> &a, const vec_t<T, 4> &b)       \
+  {                                                                            \
+    return vec_t<T, 4>(a.x op b.x, a.y op b.y, a.z op b.z, a.w op b.w);        \
+  }                                                                            \
+                                                                               \
+  /* "vec<T, N> op vec<U, N>" (element types don't match) */                   \
+  template <typename T,                                                        \
+            typename U,                                                        \
+            int N,                                                             \
+            bool A,                                                            \
+            typename = traits::is_not_same_t<T, U>>                            \
+  constexpr auto name(const vec_t<T, N, A> &a, const vec_t<U, N, A> &b)        \
+      ->vec_t<decltype(T() op U()), N, A>                                      \
+  {                                                                            \
+    using vector_t = vec_t<decltype(T() op U()), N, A>;                        \
+    return vector_t(vector_t(a) op vector_t(b));                               \
+  }                                                                            \
+                                                                               \
+  /* "vec op scalar" */                                                        \
+  template <typename T>                                                        \
+  constexpr vec_t<T, 2> name(const vec_t<T, 2> &a, const T &b)                 \
+  {                                                                            \
+    return vec_t<T, 2>(a.x op b, a.y op b);                                    \
+  }                                                                            \
+                                                                               \
+  template <typename T, bool A>                                                \
+  constexpr vec_t<T, 3> name(const vec_t<T, 3, A> &a, const T &b)              \
+  {                                                                            \
+    return vec_t<T, 3>(a.x op b, a.y op b, a.z op b);                          \
+  }                                                                            \
+                                                                               \
+  template <typename T>                                                        \
+  constexpr vec_t<T, 4> name(const vec_t<T, 4> &a, const T &b)                 \
+  {                                                                            \
+    return vec_t<T, 4>(a.x op b, a.y op b, a.z op b, a.w op b);                \
+  }                                                                            \
+                                                                               \
+  /* "vec<T, N> op U" (element types don't match) */                           \
+  template <typename T,                                                        \
+            typename U,                                                        \
+            int N,                                                             \
+            bool A,                                                            \
+            typename = traits::is_not_same_t<T, U>>                            \
+  constexpr auto name(const vec_t<T, N, A> &a, const U &b)                     \
+      ->vec_t<decltype(T() op U()), N, A>                                      \
+  {                                                                            \
+    using scalar_t = decltype(T() op U());                                     \
+    using vector_t = vec_t<scalar_t, N, A>;                                    \
+    return vector_t(vector_t(a) op scalar_t(b));                               \
+  }                                                                            \
+                                                                               \
+  /* "scalar op vec" */                                                        \
+  template <typename T>                                                        \
+  constexpr vec_t<T, 2> name(const T &a, const vec_t<T, 2> &b)                 \
+  {                                                                            \
+    return vec_t<T, 2>(a op b.x, a op b.y);                                    \
+  }                                                                            \
+                                                                               \
+  template <typename T, bool A>                                                \
+  constexpr vec_t<T, 3> name(const T &a, const vec_t<T, 3, A> &b)              \
+  {                                                                            \
+    return vec_t<T, 3>(a op b.x, a op b.y, a op b.z);                          \
+  }                                                                            \
+                                                                               \
+  template <typename T>                                                        \
+  constexpr vec_t<T, 4> name(const T &a, const vec_t<T, 4> &b)                 \
+  {                                                                            \
+    return vec_t<T, 4>(a op b.x, a op b.y, a op b.z, a op b.w);                \
+  }                                                                            \
+                                                                               \
+  /* "T op vec<U, N>" (element types don't match) */                           \
+  template <typename T,                                                        \
+            typename U,                                                        \
+            int N,                                                             \
+            bool A,                                                            \
+            typename = traits::is_not_same_t<T, U>>                            \
+  constexpr auto name(const T &a, const vec_t<U, N, A> &b)                     \
+      ->vec_t<decltype(T() op U()), N, A>                                      \
+  {                                                                            \
+    using scalar_t = decltype(T() op U());                                     \
+    using vector_t = vec_t<scalar_t, N, A>;                                    \
+    return vector_t(scalar_t(a) op vector_t(b));                               \
   }
 
         // clang-format off
@@ -648,68 +670,79 @@ namespace rkcommon {
         // ternary operators (just for compatibility with old embree
         // -------------------------------------------------------
         template <typename T, bool A>
-        inline vec_t<T, 3, A> madd(const vec_t<T, 3, A> &a,
-                                   const vec_t<T, 3, A> &b,
-                                   const vec_t<T, 3, A> &c)
+        constexpr vec_t<T, 3, A> madd(const vec_t<T, 3, A> &a,
+                                      const vec_t<T, 3, A> &b,
+                                      const vec_t<T, 3, A> &c)
     {
       return vec_t<T, 3, A>(
           madd(a.x, b.x, c.x), madd(a.y, b.y, c.y), madd(a.z, b.z, c.z));
     }
 
+    template <typename T>
+    constexpr vec_t<T, 4> madd(const vec_t<T, 4> &a,
+                               const vec_t<T, 4> &b,
+                               const vec_t<T, 4> &c)
+    {
+      return vec_t<T, 4>(madd(a.x, b.x, c.x),
+                         madd(a.y, b.y, c.y),
+                         madd(a.z, b.z, c.z),
+                         madd(a.w, b.w, c.w));
+    }
+
     // -------------------------------------------------------
     // comparison operators
     // -------------------------------------------------------
     template <typename T>
-    inline bool operator==(const vec_t<T, 2> &a, const vec_t<T, 2> &b)
+    constexpr bool operator==(const vec_t<T, 2> &a, const vec_t<T, 2> &b)
     {
       return a.x == b.x && a.y == b.y;
     }
 
     template <typename T, bool A, bool B>
-    inline bool operator==(const vec_t<T, 3, A> &a, const vec_t<T, 3, B> &b)
+    constexpr bool operator==(const vec_t<T, 3, A> &a, const vec_t<T, 3, B> &b)
     {
       return a.x == b.x && a.y == b.y && a.z == b.z;
     }
 
     template <typename T>
-    inline bool operator==(const vec_t<T, 4> &a, const vec_t<T, 4> &b)
+    constexpr bool operator==(const vec_t<T, 4> &a, const vec_t<T, 4> &b)
     {
       return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
     }
 
     template <typename T>
-    inline bool operator!=(const vec_t<T, 2> &a, const vec_t<T, 2> &b)
+    constexpr bool operator!=(const vec_t<T, 2> &a, const vec_t<T, 2> &b)
     {
       return !(a == b);
     }
 
     template <typename T, bool A, bool B>
-    inline bool operator!=(const vec_t<T, 3, A> &a, const vec_t<T, 3, B> &b)
+    constexpr bool operator!=(const vec_t<T, 3, A> &a, const vec_t<T, 3, B> &b)
     {
       return !(a == b);
     }
 
     template <typename T>
-    inline bool operator!=(const vec_t<T, 4> &a, const vec_t<T, 4> &b)
+    constexpr bool operator!=(const vec_t<T, 4> &a, const vec_t<T, 4> &b)
     {
       return !(a == b);
     }
 
     // 'anyLessThan' - return true if any component is less than the other vec's
     template <typename T>
-    inline bool anyLessThan(const vec_t<T, 2> &a, const vec_t<T, 2> &b)
+    constexpr bool anyLessThan(const vec_t<T, 2> &a, const vec_t<T, 2> &b)
     {
       return a.x < b.x || a.y < b.y;
     }
 
     template <typename T, bool A, bool B>
-    inline bool anyLessThan(const vec_t<T, 3, A> &a, const vec_t<T, 3, B> &b)
+    constexpr bool anyLessThan(const vec_t<T, 3, A> &a, const vec_t<T, 3, B> &b)
     {
       return a.x < b.x || a.y < b.y || a.z < b.z;
     }
 
     template <typename T>
-    inline bool anyLessThan(const vec_t<T, 4> &a, const vec_t<T, 4> &b)
+    constexpr bool anyLessThan(const vec_t<T, 4> &a, const vec_t<T, 4> &b)
     {
       return a.x < b.x || a.y < b.y || a.z < b.z || a.w < b.w;
     }
@@ -718,32 +751,32 @@ namespace rkcommon {
     // dot functions
     // -------------------------------------------------------
     template <typename T>
-    inline T dot(const vec_t<T, 2> &a, const vec_t<T, 2> &b)
+    constexpr T dot(const vec_t<T, 2> &a, const vec_t<T, 2> &b)
     {
       return a.x * b.x + a.y * b.y;
     }
     template <typename T>
-    inline T dot(const vec_t<T, 3> &a, const vec_t<T, 3> &b)
+    constexpr T dot(const vec_t<T, 3> &a, const vec_t<T, 3> &b)
     {
       return a.x * b.x + a.y * b.y + a.z * b.z;
     }
     template <typename T>
-    inline T dot(const vec_t<T, 3, 1> &a, const vec_t<T, 3, 1> &b)
+    constexpr T dot(const vec_t<T, 3, 1> &a, const vec_t<T, 3, 1> &b)
     {
       return a.x * b.x + a.y * b.y + a.z * b.z;
     }
     template <typename T>
-    inline T dot(const vec_t<T, 3> &a, const vec_t<T, 3, 1> &b)
+    constexpr T dot(const vec_t<T, 3> &a, const vec_t<T, 3, 1> &b)
     {
       return a.x * b.x + a.y * b.y + a.z * b.z;
     }
     template <typename T>
-    inline T dot(const vec_t<T, 3, 1> &a, const vec_t<T, 3> &b)
+    constexpr T dot(const vec_t<T, 3, 1> &a, const vec_t<T, 3> &b)
     {
       return a.x * b.x + a.y * b.y + a.z * b.z;
     }
     template <typename T>
-    inline T dot(const vec_t<T, 4> &a, const vec_t<T, 4> &b)
+    constexpr T dot(const vec_t<T, 4> &a, const vec_t<T, 4> &b)
     {
       return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
     }
@@ -761,7 +794,8 @@ namespace rkcommon {
     // cross product
     // -------------------------------------------------------
     template <typename T, bool A, bool B>
-    inline vec_t<T, 3> cross(const vec_t<T, 3, A> &a, const vec_t<T, 3, B> &b)
+    constexpr vec_t<T, 3> cross(const vec_t<T, 3, A> &a,
+                                const vec_t<T, 3, B> &b)
     {
       return vec_t<T, 3>(
           a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
@@ -825,23 +859,23 @@ namespace rkcommon {
 // -------------------------------------------------------
 // binary functors
 // -------------------------------------------------------
-#define define_functor(f)                                                   \
-  template <typename T>                                                     \
-  inline vec_t<T, 2> f(const vec_t<T, 2> &a, const vec_t<T, 2> &b)          \
-  {                                                                         \
-    return vec_t<T, 2>(f(a.x, b.x), f(a.y, b.y));                           \
-  }                                                                         \
-                                                                            \
-  template <typename T, bool A>                                             \
-  inline vec_t<T, 3, A> f(const vec_t<T, 3, A> &a, const vec_t<T, 3, A> &b) \
-  {                                                                         \
-    return vec_t<T, 3, A>(f(a.x, b.x), f(a.y, b.y), f(a.z, b.z));           \
-  }                                                                         \
-                                                                            \
-  template <typename T>                                                     \
-  inline vec_t<T, 4> f(const vec_t<T, 4> &a, const vec_t<T, 4> &b)          \
-  {                                                                         \
-    return vec_t<T, 4>(f(a.x, b.x), f(a.y, b.y), f(a.z, b.z), f(a.w, b.w)); \
+#define define_functor(f)                                                      \
+  template <typename T>                                                        \
+  constexpr vec_t<T, 2> f(const vec_t<T, 2> &a, const vec_t<T, 2> &b)          \
+  {                                                                            \
+    return vec_t<T, 2>(f(a.x, b.x), f(a.y, b.y));                              \
+  }                                                                            \
+                                                                               \
+  template <typename T, bool A>                                                \
+  constexpr vec_t<T, 3, A> f(const vec_t<T, 3, A> &a, const vec_t<T, 3, A> &b) \
+  {                                                                            \
+    return vec_t<T, 3, A>(f(a.x, b.x), f(a.y, b.y), f(a.z, b.z));              \
+  }                                                                            \
+                                                                               \
+  template <typename T>                                                        \
+  constexpr vec_t<T, 4> f(const vec_t<T, 4> &a, const vec_t<T, 4> &b)          \
+  {                                                                            \
+    return vec_t<T, 4>(f(a.x, b.x), f(a.y, b.y), f(a.z, b.z), f(a.w, b.w));    \
   }
 
     // clang-format off
@@ -855,65 +889,65 @@ namespace rkcommon {
         // reductions
         // -------------------------------------------------------
         template <typename T, bool A>
-        inline T reduce_add(const vec_t<T, 2, A> &v)
+        constexpr T reduce_add(const vec_t<T, 2, A> &v)
     {
       return v.x + v.y;
     }
     template <typename T, bool A>
-    inline T reduce_add(const vec_t<T, 3, A> &v)
+    constexpr T reduce_add(const vec_t<T, 3, A> &v)
     {
       return v.x + v.y + v.z;
     }
     template <typename T, bool A>
-    inline T reduce_add(const vec_t<T, 4, A> &v)
+    constexpr T reduce_add(const vec_t<T, 4, A> &v)
     {
       return v.x + v.y + v.z + v.w;
     }
 
     template <typename T, bool A>
-    inline T reduce_mul(const vec_t<T, 2, A> &v)
+    constexpr T reduce_mul(const vec_t<T, 2, A> &v)
     {
       return v.x * v.y;
     }
     template <typename T, bool A>
-    inline T reduce_mul(const vec_t<T, 3, A> &v)
+    constexpr T reduce_mul(const vec_t<T, 3, A> &v)
     {
       return v.x * v.y * v.z;
     }
     template <typename T, bool A>
-    inline T reduce_mul(const vec_t<T, 4, A> &v)
+    constexpr T reduce_mul(const vec_t<T, 4, A> &v)
     {
       return v.x * v.y * v.z * v.w;
     }
 
     template <typename T, bool A>
-    inline T reduce_min(const vec_t<T, 2, A> &v)
+    constexpr T reduce_min(const vec_t<T, 2, A> &v)
     {
       return min(v.x, v.y);
     }
     template <typename T, bool A>
-    inline T reduce_min(const vec_t<T, 3, A> &v)
+    constexpr T reduce_min(const vec_t<T, 3, A> &v)
     {
       return min(min(v.x, v.y), v.z);
     }
     template <typename T, bool A>
-    inline T reduce_min(const vec_t<T, 4, A> &v)
+    constexpr T reduce_min(const vec_t<T, 4, A> &v)
     {
       return min(min(v.x, v.y), min(v.z, v.w));
     }
 
     template <typename T, bool A>
-    inline T reduce_max(const vec_t<T, 2, A> &v)
+    constexpr T reduce_max(const vec_t<T, 2, A> &v)
     {
       return max(v.x, v.y);
     }
     template <typename T, bool A>
-    inline T reduce_max(const vec_t<T, 3, A> &v)
+    constexpr T reduce_max(const vec_t<T, 3, A> &v)
     {
       return max(max(v.x, v.y), v.z);
     }
     template <typename T, bool A>
-    inline T reduce_max(const vec_t<T, 4, A> &v)
+    constexpr T reduce_max(const vec_t<T, 4, A> &v)
     {
       return max(max(v.x, v.y), max(v.z, v.w));
     }
@@ -963,6 +997,276 @@ namespace rkcommon {
     typedef vec_t<float, 4> vec4f;
     typedef vec_t<double, 4> vec4d;
 
+#ifndef RKCOMMON_NO_SIMD
+    // -------------------------------------------------------
+    // SSE (NEON through sse2neon) overloads for vec4f and vec3fa
+    // -------------------------------------------------------
+    // The vectors keep their scalar members, so layout and alignment stay
+    // unchanged; the operands are loaded unaligned and the compiler keeps
+    // intermediate results in registers. vec3fa computes on its padding
+    // lane too. Results match the scalar versions bit for bit.
+
+    namespace detail {
+
+      __forceinline __m128 load4(const vec4f &v)
+      {
+        return _mm_loadu_ps(&v.x);
+      }
+
+      __forceinline __m128 load4(const vec3fa &v)
+      {
+        return _mm_loadu_ps(&v.x);
+      }
+
+      __forceinline vec4f store4f(__m128 v)
+      {
+        vec4f r;
+        _mm_storeu_ps(&r.x, v);
+        return r;
+      }
+
+      __forceinline vec3fa store3fa(__m128 v)
+      {
+        vec3fa r;
+        _mm_storeu_ps(&r.x, v);
+        return r;
+      }
+
+      __forceinline vec3f store3f(__m128 v)
+      {
+        float r[4];
+        _mm_storeu_ps(r, v);
+        return vec3f(r[0], r[1], r[2]);
+      }
+
+      // ((v0 + v1) + v2), in the order of the scalar code
+      __forceinline float sum3(__m128 v)
+      {
+        const __m128 s = _mm_add_ss(
+            v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_cvtss_f32(
+            _mm_add_ss(s, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+      }
+
+      __forceinline float sum4(__m128 v)
+      {
+        const __m128 w = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm_cvtss_f32(_mm_add_ss(_mm_set_ss(sum3(v)), w));
+      }
+
+      __forceinline __m128 rcp4(__m128 a)
+      {
+        // same Newton-Raphson step as the scalar rcp()
+        const __m128 r = _mm_rcp_ps(a);
+        return _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(2.f), _mm_mul_ps(r, a)));
+      }
+
+    }  // namespace detail
+
+// In constant expressions, where intrinsics can't be used, the overloads
+// below compute the same results with scalar code instead
+#ifdef RKCOMMON_HAS_IS_CONSTANT_EVALUATED
+#define simd_constexpr constexpr
+#define simd_or_scalar(simd, scalar) \
+  (__builtin_is_constant_evaluated() ? (scalar) : (simd))
+#else
+#define simd_constexpr inline
+#define simd_or_scalar(simd, scalar) (simd)
+#endif
+
+#define simd_binary_operator(name, op, intrinsic)                            \
+  simd_constexpr vec4f name(const vec4f &a, const vec4f &b)                  \
+  {                                                                          \
+    return simd_or_scalar(                                                   \
+        (detail::store4f(intrinsic(detail::load4(a), detail::load4(b)))),    \
+        (vec4f(a.x op b.x, a.y op b.y, a.z op b.z, a.w op b.w)));            \
+  }                                                                          \
+  simd_constexpr vec4f name(const vec4f &a, const float &b)                  \
+  {                                                                          \
+    return simd_or_scalar(                                                   \
+        (detail::store4f(intrinsic(detail::load4(a), _mm_set1_ps(b)))),      \
+        (vec4f(a.x op b, a.y op b, a.z op b, a.w op b)));                    \
+  }                                                                          \
+  simd_constexpr vec4f name(const float &a, const vec4f &b)                  \
+  {                                                                          \
+    return simd_or_scalar(                                                   \
+        (detail::store4f(intrinsic(_mm_set1_ps(a), detail::load4(b)))),      \
+        (vec4f(a op b.x, a op b.y, a op b.z, a op b.w)));                    \
+  }                                                                          \
+  simd_constexpr vec3f name(const vec3fa &a, const vec3fa &b)                \
+  {                                                                          \
+    return simd_or_scalar(                                                   \
+        (detail::store3f(intrinsic(detail::load4(a), detail::load4(b)))),    \
+        (vec3f(a.x op b.x, a.y op b.y, a.z op b.z)));                        \
+  }                                                                          \
+  simd_constexpr vec3f name(const vec3fa &a, const float &b)                 \
+  {                                                                          \
+    return simd_or_scalar(                                                   \
+        (detail::store3f(intrinsic(detail::load4(a), _mm_set1_ps(b)))),      \
+        (vec3f(a.x op b, a.y op b, a.z op b)));                              \
+  }                                                                          \
+  simd_constexpr vec3f name(const float &a, const vec3fa &b)                 \
+  {                                                                          \
+    return simd_or_scalar(                                                   \
+        (detail::store3f(intrinsic(_mm_set1_ps(a), detail::load4(b)))),      \
+        (vec3f(a op b.x, a op b.y, a op b.z)));                              \
+  }
+
+    // clang-format off
+    simd_binary_operator(operator+, +, _mm_add_ps)
+    simd_binary_operator(operator-, -, _mm_sub_ps)
+    simd_binary_operator(operator*, *, _mm_mul_ps)
+    simd_binary_operator(operator/, /, _mm_div_ps)
+    // clang-format on
+#undef simd_binary_operator
+
+#define simd_assignment_operator(name, intrinsic)                           \
+  inline vec4f &name(vec4f &a, const vec4f &b)                              \
+  {                                                                         \
+    _mm_storeu_ps(&a.x, intrinsic(detail::load4(a), detail::load4(b)));     \
+    return a;                                                               \
+  }                                                                         \
+  inline vec4f &name(vec4f &a, const float &b)                              \
+  {                                                                         \
+    _mm_storeu_ps(&a.x, intrinsic(detail::load4(a), _mm_set1_ps(b)));       \
+    return a;                                                               \
+  }                                                                         \
+  inline vec3fa &name(vec3fa &a, const vec3fa &b)                           \
+  {                                                                         \
+    _mm_storeu_ps(&a.x, intrinsic(detail::load4(a), detail::load4(b)));     \
+    return a;                                                               \
+  }                                                                         \
+  inline vec3fa &name(vec3fa &a, const float &b)                            \
+  {                                                                         \
+    _mm_storeu_ps(&a.x, intrinsic(detail::load4(a), _mm_set1_ps(b)));       \
+    return a;                                                               \
+  }
+
+    // clang-format off
+    simd_assignment_operator(operator+=, _mm_add_ps)
+    simd_assignment_operator(operator-=, _mm_sub_ps)
+    simd_assignment_operator(operator*=, _mm_mul_ps)
+    simd_assignment_operator(operator/=, _mm_div_ps)
+    // clang-format on
+#undef simd_assignment_operator
+
+    simd_constexpr vec4f operator-(const vec4f &v)
+    {
+      return simd_or_scalar(
+          (detail::store4f(_mm_xor_ps(detail::load4(v), _mm_set1_ps(-0.f)))),
+          (vec4f(-v.x, -v.y, -v.z, -v.w)));
+    }
+
+    simd_constexpr vec3fa operator-(const vec3fa &v)
+    {
+      return simd_or_scalar(
+          (detail::store3fa(_mm_xor_ps(detail::load4(v), _mm_set1_ps(-0.f)))),
+          (vec3fa(-v.x, -v.y, -v.z)));
+    }
+
+    // operands swapped to return 'a' on ties and NaNs, like std::min/max
+    simd_constexpr vec4f min(const vec4f &a, const vec4f &b)
+    {
+      return simd_or_scalar(
+          (detail::store4f(_mm_min_ps(detail::load4(b), detail::load4(a)))),
+          (vec4f(b.x < a.x ? b.x : a.x,
+                 b.y < a.y ? b.y : a.y,
+                 b.z < a.z ? b.z : a.z,
+                 b.w < a.w ? b.w : a.w)));
+    }
+
+    simd_constexpr vec4f max(const vec4f &a, const vec4f &b)
+    {
+      return simd_or_scalar(
+          (detail::store4f(_mm_max_ps(detail::load4(b), detail::load4(a)))),
+          (vec4f(a.x < b.x ? b.x : a.x,
+                 a.y < b.y ? b.y : a.y,
+                 a.z < b.z ? b.z : a.z,
+                 a.w < b.w ? b.w : a.w)));
+    }
+
+    simd_constexpr vec3fa min(const vec3fa &a, const vec3fa &b)
+    {
+      return simd_or_scalar(
+          (detail::store3fa(_mm_min_ps(detail::load4(b), detail::load4(a)))),
+          (vec3fa(b.x < a.x ? b.x : a.x,
+                  b.y < a.y ? b.y : a.y,
+                  b.z < a.z ? b.z : a.z)));
+    }
+
+    simd_constexpr vec3fa max(const vec3fa &a, const vec3fa &b)
+    {
+      return simd_or_scalar(
+          (detail::store3fa(_mm_max_ps(detail::load4(b), detail::load4(a)))),
+          (vec3fa(a.x < b.x ? b.x : a.x,
+                  a.y < b.y ? b.y : a.y,
+                  a.z < b.z ? b.z : a.z)));
+    }
+
+    simd_constexpr float dot(const vec4f &a, const vec4f &b)
+    {
+      return simd_or_scalar(
+          (detail::sum4(_mm_mul_ps(detail::load4(a), detail::load4(b)))),
+          (a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w));
+    }
+
+    simd_constexpr float dot(const vec3fa &a, const vec3fa &b)
+    {
+      return simd_or_scalar(
+          (detail::sum3(_mm_mul_ps(detail::load4(a), detail::load4(b)))),
+          (a.x * b.x + a.y * b.y + a.z * b.z));
+    }
+
+    inline vec4f normalize(const vec4f &v)
+    {
+      const __m128 a = detail::load4(v);
+      return detail::store4f(
+          _mm_mul_ps(a, _mm_set1_ps(rsqrt(detail::sum4(_mm_mul_ps(a, a))))));
+    }
+
+    inline vec3fa normalize(const vec3fa &v)
+    {
+      const __m128 a = detail::load4(v);
+      return detail::store3fa(
+          _mm_mul_ps(a, _mm_set1_ps(rsqrt(detail::sum3(_mm_mul_ps(a, a))))));
+    }
+
+    inline vec4f rcp(const vec4f &v)
+    {
+      return detail::store4f(detail::rcp4(detail::load4(v)));
+    }
+
+    inline vec3fa rcp(const vec3fa &v)
+    {
+      return detail::store3fa(detail::rcp4(detail::load4(v)));
+    }
+
+    simd_constexpr vec4f madd(const vec4f &a, const vec4f &b, const vec4f &c)
+    {
+      return simd_or_scalar((detail::store4f(_mm_add_ps(
+                                _mm_mul_ps(detail::load4(a), detail::load4(b)),
+                                detail::load4(c)))),
+                            (vec4f(a.x * b.x + c.x,
+                                   a.y * b.y + c.y,
+                                   a.z * b.z + c.z,
+                                   a.w * b.w + c.w)));
+    }
+
+    simd_constexpr vec3fa madd(const vec3fa &a,
+                               const vec3fa &b,
+                               const vec3fa &c)
+    {
+      return simd_or_scalar(
+          (detail::store3fa(_mm_add_ps(
+              _mm_mul_ps(detail::load4(a), detail::load4(b)),
+              detail::load4(c)))),
+          (vec3fa(a.x * b.x + c.x, a.y * b.y + c.y, a.z * b.z + c.z)));
+    }
+
+#undef simd_or_scalar
+#undef simd_constexpr
+#endif
+
     template <typename T, int N>
     inline size_t arg_max(const vec_t<T, N> &v)
     {
@@ -0,0 +1,589 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "xfmArray.h"
+#include "dispatch.h"
+#include "../tasking/parallel_for.h"
+#include "packet.h"
+// std
+#include <vector>
+
+namespace rkcommon {
+  namespace math {
+
+    static constexpr int W = NATIVE_PACKET_WIDTH < 4 ? 4 : NATIVE_PACKET_WIDTH;
+
+    // elements per parallel task
+    static constexpr size_t XFM_CHUNK_SIZE = 16 * 1024;
+
+    static size_t numChunks(size_t n, bool parallel)
+    {
+      return parallel && n >= XFM_PARALLEL_THRESHOLD
+                 ? divRoundUp(n, XFM_CHUNK_SIZE)
+                 : 1;
+    }
+
+    // calls 'fcn(chunk, begin, end)' for each of the 'chunks' ranges of [0,n)
+    template <typename FCN_T>
+    static void forEachChunk(size_t n, size_t chunks, FCN_T &&fcn)
+    {
+      if (chunks == 1) {
+        fcn(0, 0, n);
+        return;
+      }
+
+      tasking::parallel_for(chunks, [&](size_t chunk) {
+        const size_t begin = chunk * XFM_CHUNK_SIZE;
+        fcn(chunk, begin, std::min(n, begin + XFM_CHUNK_SIZE));
+      });
+    }
+
+    // AoS -> SoA for both raw pointers and strided DataViews
+    template <typename INPUT_T>
+    static inline vec3vf<W> gather(const INPUT_T &in, size_t begin)
+    {
+      vec3vf<W> r;
+      for (int i = 0; i < W; ++i) {
+        const vec3f &v = in[begin + i];
+        r.x[i]         = v.x;
+        r.y[i]         = v.y;
+        r.z[i]         = v.z;
+      }
+      return r;
+    }
+
+    static inline vec3vf<W> gather(const vec3f *in, size_t begin)
+    {
+      return loadAoS<W>(in + begin);
+    }
+
+    template <typename INPUT_T>
+    static box3f xfmPointRange(const AffineSpace3f &xfm,
+                               const INPUT_T &in,
+                               vec3f *out,
+                               size_t begin,
+                               size_t end)
+    {
+      box3vf<W> packetBounds(empty);
+
+      size_t i = begin;
+      for (; i + W <= end; i += W) {
+        const vec3vf<W> p = xfmPoint(xfm, gather(in, i));
+        storeAoS(out + i, p);
+        packetBounds.extend(p);
+      }
+
+      box3f bounds = reduce_bounds(packetBounds);
+      for (; i < end; ++i) {
+        out[i] = xfmPoint(xfm, vec3f(in[i]));
+        bounds.extend(out[i]);
+      }
+
+      return bounds;
+    }
+
+    template <typename INPUT_T>
+    static void xfmVectorRange(const LinearSpace3f &l,
+                               const INPUT_T &in,
+                               vec3f *out,
+                               size_t begin,
+                               size_t end)
+    {
+      size_t i = begin;
+      for (; i + W <= end; i += W)
+        storeAoS(out + i, xfmVector(l, gather(in, i)));
+
+      for (; i < end; ++i)
+        out[i] = xfmVector(l, vec3f(in[i]));
+    }
+
+    template <typename INPUT_T>
+    static box3f xfmPointsImpl(const AffineSpace3f &xfm,
+                               const INPUT_T &in,
+                               vec3f *out,
+                               size_t n,
+                               bool parallel)
+    {
+      const size_t chunks = numChunks(n, parallel);
+      std::vector<box3f> chunkBounds(chunks);
+
+      forEachChunk(n, chunks, [&](size_t chunk, size_t begin, size_t end) {
+        chunkBounds[chunk] = xfmPointRange(xfm, in, out, begin, end);
+      });
+
+      box3f bounds(empty);
+      for (const auto &b : chunkBounds)
+        bounds.extend(b);
+      return bounds;
+    }
+
+    template <typename INPUT_T>
+    static void xfmVectorsImpl(const LinearSpace3f &l,
+                               const INPUT_T &in,
+                               vec3f *out,
+                               size_t n,
+                               bool parallel)
+    {
+      forEachChunk(n,
+                   numChunks(n, parallel),
+                   [&](size_t, size_t begin, size_t end) {
+                     xfmVectorRange(l, in, out, begin, end);
+                   });
+    }
+
+    static_assert(sizeof(AffineSpace3f) == 12 * sizeof(float),
+                  "AffineSpace3f arrays are transposed as floats");
+    static_assert(sizeof(box3f) == 6 * sizeof(float),
+                  "box3f arrays are transposed as floats");
+
+    // W transforms as SoA columns, lane by lane for strided input
+    template <typename XFMS_T>
+    static inline void gatherXfms(const XFMS_T &xfms,
+                                  size_t begin,
+                                  vec3vf<W> &vx,
+                                  vec3vf<W> &vy,
+                                  vec3vf<W> &vz,
+                                  vec3vf<W> &p)
+    {
+      for (int i = 0; i < W; ++i) {
+        const AffineSpace3f &xfm = xfms[begin + i];
+        vx.x[i] = xfm.l.vx.x, vx.y[i] = xfm.l.vx.y, vx.z[i] = xfm.l.vx.z;
+        vy.x[i] = xfm.l.vy.x, vy.y[i] = xfm.l.vy.y, vy.z[i] = xfm.l.vy.z;
+        vz.x[i] = xfm.l.vz.x, vz.y[i] = xfm.l.vz.y, vz.z[i] = xfm.l.vz.z;
+        p.x[i] = xfm.p.x, p.y[i] = xfm.p.y, p.z[i] = xfm.p.z;
+      }
+    }
+
+    // ... and as three 4-float transposes of contiguous arrays
+    static inline void gatherXfms(const AffineSpace3f *xfms,
+                                  size_t begin,
+                                  vec3vf<W> &vx,
+                                  vec3vf<W> &vy,
+                                  vec3vf<W> &vz,
+                                  vec3vf<W> &p)
+    {
+      const float *f = &xfms[begin].l.vx.x;
+      vfloat<W> a[4], b[4], c[4];
+      loadTransposed4<W>(f, 12, a);
+      loadTransposed4<W>(f + 4, 12, b);
+      loadTransposed4<W>(f + 8, 12, c);
+      vx = vec3vf<W>(a[0], a[1], a[2]);
+      vy = vec3vf<W>(a[3], b[0], b[1]);
+      vz = vec3vf<W>(b[2], b[3], c[0]);
+      p  = vec3vf<W>(c[1], c[2], c[3]);
+    }
+
+    static inline void scatterXfms(AffineSpace3f *xfms,
+                                   const vec3vf<W> &vx,
+                                   const vec3vf<W> &vy,
+                                   const vec3vf<W> &vz,
+                                   const vec3vf<W> &p)
+    {
+      float *f             = &xfms[0].l.vx.x;
+      const vfloat<W> a[4] = {vx.x, vx.y, vx.z, vy.x};
+      const vfloat<W> b[4] = {vy.y, vy.z, vz.x, vz.y};
+      const vfloat<W> c[4] = {vz.z, p.x, p.y, p.z};
+      storeTransposed4<W>(f, 12, a);
+      storeTransposed4<W>(f + 4, 12, b);
+      storeTransposed4<W>(f + 8, 12, c);
+    }
+
+    template <typename BOXES_T>
+    static inline box3vf<W> gatherBoxes(const BOXES_T &in, size_t begin)
+    {
+      box3vf<W> b;
+      for (int i = 0; i < W; ++i) {
+        const box3f &box = in[begin + i];
+        b.lower.x[i] = box.lower.x, b.upper.x[i] = box.upper.x;
+        b.lower.y[i] = box.lower.y, b.upper.y[i] = box.upper.y;
+        b.lower.z[i] = box.lower.z, b.upper.z[i] = box.upper.z;
+      }
+      return b;
+    }
+
+    // the 4-float loads of a box overlap at lower.z and upper.x
+    static inline box3vf<W> gatherBoxes(const box3f *in, size_t begin)
+    {
+      const float *f = &in[begin].lower.x;
+      vfloat<W> a[4], b[4];
+      loadTransposed4<W>(f, 6, a);
+      loadTransposed4<W>(f + 2, 6, b);
+      return box3vf<W>(vec3vf<W>(a[0], a[1], a[2]),
+                       vec3vf<W>(b[1], b[2], b[3]));
+    }
+
+    // the second store rewrites lower.z and upper.x with the same values
+    static inline void scatterBoxes(box3f *out, const box3vf<W> &b)
+    {
+      float *f             = &out[0].lower.x;
+      const vfloat<W> a[4] = {b.lower.x, b.lower.y, b.lower.z, b.upper.x};
+      const vfloat<W> c[4] = {b.lower.z, b.upper.x, b.upper.y, b.upper.z};
+      storeTransposed4<W>(f, 6, a);
+      storeTransposed4<W>(f + 2, 6, c);
+    }
+
+    /* Per lane Arvo bounds (see xfmBounds() in AffineSpace.h) of W boxes,
+       each with its own transform */
+    template <typename XFMS_T, typename BOXES_T>
+    static inline box3vf<W> xfmBoundsPacket(const XFMS_T &xfms,
+                                            const BOXES_T &in,
+                                            size_t begin)
+    {
+      vec3vf<W> vx, vy, vz, p;
+      gatherXfms(xfms, begin, vx, vy, vz, p);
+      const box3vf<W> b = gatherBoxes(in, begin);
+
+      box3vf<W> r(p, p);
+      auto addAxis = [&](const vec3vf<W> &column,
+                         const vfloat<W> &lower,
+                         const vfloat<W> &upper) {
+        const vec3vf<W> lo = column * lower;
+        const vec3vf<W> hi = column * upper;
+        r.lower            = r.lower + min(lo, hi);
+        r.upper            = r.upper + max(lo, hi);
+      };
+      addAxis(vx, b.lower.x, b.upper.x);
+      addAxis(vy, b.lower.y, b.upper.y);
+      addAxis(vz, b.lower.z, b.upper.z);
+
+      const vbool<W> emptyBoxes = isEmpty(b);
+      const box3vf<W> emptyBox(empty);
+      return box3vf<W>(select(emptyBoxes, emptyBox.lower, r.lower),
+                       select(emptyBoxes, emptyBox.upper, r.upper));
+    }
+
+    template <typename XFMS_T, typename BOXES_T>
+    static box3f xfmBoundsRange(const XFMS_T &xfms,
+                                const BOXES_T &in,
+                                box3f *out,
+                                size_t begin,
+                                size_t end)
+    {
+      box3vf<W> packetBounds(empty);
+
+      size_t i = begin;
+      for (; i + W <= end; i += W) {
+        const box3vf<W> b = xfmBoundsPacket(xfms, in, i);
+        scatterBoxes(out + i, b);
+        packetBounds.extend(b);
+      }
+
+      box3f bounds = reduce_bounds(packetBounds);
+      for (; i < end; ++i) {
+        out[i] = xfmBounds(xfms[i], in[i]);
+        bounds.extend(out[i]);
+      }
+
+      return bounds;
+    }
+
+    template <typename XFMS_T, typename BOXES_T>
+    static box3f xfmBoundsImpl(const XFMS_T &xfms,
+                               const BOXES_T &in,
+                               box3f *out,
+                               size_t n,
+                               bool parallel)
+    {
+      const size_t chunks = numChunks(n, parallel);
+      std::vector<box3f> chunkBounds(chunks);
+
+      forEachChunk(n, chunks, [&](size_t chunk, size_t begin, size_t end) {
+        chunkBounds[chunk] = xfmBoundsRange(xfms, in, out, begin, end);
+      });
+
+      box3f bounds(empty);
+      for (const auto &b : chunkBounds)
+        bounds.extend(b);
+      return bounds;
+    }
+
+    /* W transforms as SoA columns; rcp() of all of them with the same
+       operations as the scalar version, or its transpose for orthonormal
+       ones */
+    template <bool ORTHONORMAL>
+    static void rcpRange(const AffineSpace3f *in,
+                         AffineSpace3f *out,
+                         size_t begin,
+                         size_t end)
+    {
+      size_t i = begin;
+      for (; i + W <= end; i += W) {
+        vec3vf<W> vx, vy, vz, p;
+        gatherXfms(in, i, vx, vy, vz, p);
+
+        // rows of the inverse
+        vec3vf<W> r0 = vx, r1 = vy, r2 = vz;
+        if (!ORTHONORMAL) {
+          r0                = cross(vy, vz);
+          r1                = cross(vz, vx);
+          r2                = cross(vx, vy);
+          const vfloat<W> d = dot(vx, r0);
+          r0                = r0 / d;
+          r1                = r1 / d;
+          r2                = r2 / d;
+        }
+
+        scatterXfms(out + i,
+                    vec3vf<W>(r0.x, r1.x, r2.x),
+                    vec3vf<W>(r0.y, r1.y, r2.y),
+                    vec3vf<W>(r0.z, r1.z, r2.z),
+                    vec3vf<W>(-dot(r0, p), -dot(r1, p), -dot(r2, p)));
+      }
+
+      for (; i < end; ++i)
+        out[i] = ORTHONORMAL ? rcpOrthonormal(in[i]) : rcp(in[i]);
+    }
+
+    template <bool ORTHONORMAL>
+    static void rcpImpl(const AffineSpace3f *in,
+                        AffineSpace3f *out,
+                        size_t n,
+                        bool parallel)
+    {
+      forEachChunk(n,
+                   numChunks(n, parallel),
+                   [&](size_t, size_t begin, size_t end) {
+                     rcpRange<ORTHONORMAL>(in, out, begin, end);
+                   });
+    }
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      box3f xfmPoints(const AffineSpace3f &xfm,
+                      const vec3f *in,
+                      vec3f *out,
+                      size_t n,
+                      bool parallel)
+      {
+        return xfmPointsImpl(xfm, in, out, n, parallel);
+      }
+
+      box3f xfmPoints(const AffineSpace3f &xfm,
+                      const utility::DataView<vec3f> &in,
+                      vec3f *out,
+                      size_t n,
+                      bool parallel)
+      {
+        return xfmPointsImpl(xfm, in, out, n, parallel);
+      }
+
+      void xfmVectors(const AffineSpace3f &xfm,
+                      const vec3f *in,
+                      vec3f *out,
+                      size_t n,
+                      bool parallel)
+      {
+        xfmVectorsImpl(xfm.l, in, out, n, parallel);
+      }
+
+      void xfmVectors(const AffineSpace3f &xfm,
+                      const utility::DataView<vec3f> &in,
+                      vec3f *out,
+                      size_t n,
+                      bool parallel)
+      {
+        xfmVectorsImpl(xfm.l, in, out, n, parallel);
+      }
+
+      void xfmNormals(const AffineSpace3f &xfm,
+                      const vec3f *in,
+                      vec3f *out,
+                      size_t n,
+                      bool parallel)
+      {
+        xfmVectorsImpl(xfm.l.inverse().transposed(), in, out, n, parallel);
+      }
+
+      void xfmNormals(const AffineSpace3f &xfm,
+                      const utility::DataView<vec3f> &in,
+                      vec3f *out,
+                      size_t n,
+                      bool parallel)
+      {
+        xfmVectorsImpl(xfm.l.inverse().transposed(), in, out, n, parallel);
+      }
+
+      box3f xfmBounds(const AffineSpace3f *xfms,
+                      const box3f *in,
+                      box3f *out,
+                      size_t n,
+                      bool parallel)
+      {
+        return xfmBoundsImpl(xfms, in, out, n, parallel);
+      }
+
+      box3f xfmBounds(const utility::DataView<AffineSpace3f> &xfms,
+                      const utility::DataView<box3f> &in,
+                      box3f *out,
+                      size_t n,
+                      bool parallel)
+      {
+        return xfmBoundsImpl(xfms, in, out, n, parallel);
+      }
+
+      void rcp(const AffineSpace3f *in,
+               AffineSpace3f *out,
+               size_t n,
+               bool parallel)
+      {
+        rcpImpl<false>(in, out, n, parallel);
+      }
+
+      void rcpOrthonormal(const AffineSpace3f *in,
+                          AffineSpace3f *out,
+                          size_t n,
+                          bool parallel)
+      {
+        rcpImpl<true>(in, out, n, parallel);
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // xfmArray.h definitions //////////////////////////////////////////////////
+
+    using XfmPointsFcn = box3f(
+        const AffineSpace3f &, const vec3f *, vec3f *, size_t, bool);
+    using XfmPointsViewFcn = box3f(const AffineSpace3f &,
+                                   const utility::DataView<vec3f> &,
+                                   vec3f *,
+                                   size_t,
+                                   bool);
+    using XfmVectorsFcn = void(
+        const AffineSpace3f &, const vec3f *, vec3f *, size_t, bool);
+    using XfmVectorsViewFcn = void(const AffineSpace3f &,
+                                   const utility::DataView<vec3f> &,
+                                   vec3f *,
+                                   size_t,
+                                   bool);
+    using XfmBoundsFcn = box3f(
+        const AffineSpace3f *, const box3f *, box3f *, size_t, bool);
+    using XfmBoundsViewFcn = box3f(const utility::DataView<AffineSpace3f> &,
+                                   const utility::DataView<box3f> &,
+                                   box3f *,
+                                   size_t,
+                                   bool);
+    using RcpFcn = void(const AffineSpace3f *, AffineSpace3f *, size_t, bool);
+
+    RKCOMMON_ISA_DECLARE(XfmPointsFcn xfmPoints)
+    RKCOMMON_ISA_DECLARE(XfmPointsViewFcn xfmPoints)
+    RKCOMMON_ISA_DECLARE(XfmVectorsFcn xfmVectors)
+    RKCOMMON_ISA_DECLARE(XfmVectorsViewFcn xfmVectors)
+    RKCOMMON_ISA_DECLARE(XfmVectorsFcn xfmNormals)
+    RKCOMMON_ISA_DECLARE(XfmVectorsViewFcn xfmNormals)
+    RKCOMMON_ISA_DECLARE(XfmBoundsFcn xfmBounds)
+    RKCOMMON_ISA_DECLARE(XfmBoundsViewFcn xfmBounds)
+    RKCOMMON_ISA_DECLARE(RcpFcn rcp)
+    RKCOMMON_ISA_DECLARE(RcpFcn rcpOrthonormal)
+
+    box3f xfmPoints(const AffineSpace3f &xfm,
+                    const vec3f *in,
+                    vec3f *out,
+                    size_t n,
+                    bool parallel)
+    {
+      static XfmPointsFcn *const fcn =
+          RKCOMMON_ISA_SELECT(XfmPointsFcn, xfmPoints);
+      return fcn(xfm, in, out, n, parallel);
+    }
+
+    box3f xfmPoints(const AffineSpace3f &xfm,
+                    const utility::DataView<vec3f> &in,
+                    vec3f *out,
+                    size_t n,
+                    bool parallel)
+    {
+      static XfmPointsViewFcn *const fcn =
+          RKCOMMON_ISA_SELECT(XfmPointsViewFcn, xfmPoints);
+      return fcn(xfm, in, out, n, parallel);
+    }
+
+    void xfmVectors(const AffineSpace3f &xfm,
+                    const vec3f *in,
+                    vec3f *out,
+                    size_t n,
+                    bool parallel)
+    {
+      static XfmVectorsFcn *const fcn =
+          RKCOMMON_ISA_SELECT(XfmVectorsFcn, xfmVectors);
+      fcn(xfm, in, out, n, parallel);
+    }
+
+    void xfmVectors(const AffineSpace3f &xfm,
+                    const utility::DataView<vec3f> &in,
+                    vec3f *out,
+                    size_t n,
+                    bool parallel)
+    {
+      static XfmVectorsViewFcn *const fcn =
+          RKCOMMON_ISA_SELECT(XfmVectorsViewFcn, xfmVectors);
+      fcn(xfm, in, out, n, parallel);
+    }
+
+    void xfmNormals(const AffineSpace3f &xfm,
+                    const vec3f *in,
+                    vec3f *out,
+                    size_t n,
+                    bool parallel)
+    {
+      static XfmVectorsFcn *const fcn =
+          RKCOMMON_ISA_SELECT(XfmVectorsFcn, xfmNormals);
+      fcn(xfm, in, out, n, parallel);
+    }
+
+    void xfmNormals(const AffineSpace3f &xfm,
+                    const utility::DataView<vec3f> &in,
+                    vec3f *out,
+                    size_t n,
+                    bool parallel)
+    {
+      static XfmVectorsViewFcn *const fcn =
+          RKCOMMON_ISA_SELECT(XfmVectorsViewFcn, xfmNormals);
+      fcn(xfm, in, out, n, parallel);
+    }
+
+    box3f xfmBounds(const AffineSpace3f *xfms,
+                    const box3f *in,
+                    box3f *out,
+                    size_t n,
+                    bool parallel)
+    {
+      static XfmBoundsFcn *const fcn =
+          RKCOMMON_ISA_SELECT(XfmBoundsFcn, xfmBounds);
+      return fcn(xfms, in, out, n, parallel);
+    }
+
+    box3f xfmBounds(const utility::DataView<AffineSpace3f> &xfms,
+                    const utility::DataView<box3f> &in,
+                    box3f *out,
+                    size_t n,
+                    bool parallel)
+    {
+      static XfmBoundsViewFcn *const fcn =
+          RKCOMMON_ISA_SELECT(XfmBoundsViewFcn, xfmBounds);
+      return fcn(xfms, in, out, n, parallel);
+    }
+
+    void rcp(const AffineSpace3f *in,
+             AffineSpace3f *out,
+             size_t n,
+             bool parallel)
+    {
+      static RcpFcn *const fcn = RKCOMMON_ISA_SELECT(RcpFcn, rcp);
+      fcn(in, out, n, parallel);
+    }
+
+    void rcpOrthonormal(const AffineSpace3f *in,
+                        AffineSpace3f *out,
+                        size_t n,
+                        bool parallel)
+    {
+      static RcpFcn *const fcn = RKCOMMON_ISA_SELECT(RcpFcn, rcpOrthonormal);
+      fcn(in, out, n, parallel);
+    }
+#endif
+
+  }  // namespace math
+}  // namespace rkcommon
@@ -0,0 +1,94 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "AffineSpace.h"
+#include "../utility/DataView.h"
+
+namespace rkcommon {
+  namespace math {
+
+    /* Transform 'n' points, vectors or normals with one call. Elements are
+       computed a SIMD packet at a time (see packet.h), and with 'parallel'
+       arrays of at least XFM_PARALLEL_THRESHOLD elements are split across
+       tasking::parallel_for(). 'out' may be the same array as 'in'. The
+       DataView overloads read strided input, e.g. the positions inside an
+       interleaved vertex buffer.
+
+       xfmPoints() also returns the bounds of the transformed points, which
+       is empty for n == 0. */
+
+    constexpr size_t XFM_PARALLEL_THRESHOLD = 64 * 1024;
+
+    RKCOMMON_INTERFACE box3f xfmPoints(const AffineSpace3f &xfm,
+                                       const vec3f *in,
+                                       vec3f *out,
+                                       size_t n,
+                                       bool parallel = true);
+
+    RKCOMMON_INTERFACE box3f
+    xfmPoints(const AffineSpace3f &xfm,
+              const utility::DataView<vec3f> &in,
+              vec3f *out,
+              size_t n,
+              bool parallel = true);
+
+    RKCOMMON_INTERFACE void xfmVectors(const AffineSpace3f &xfm,
+                                       const vec3f *in,
+                                       vec3f *out,
+                                       size_t n,
+                                       bool parallel = true);
+
+    RKCOMMON_INTERFACE void xfmVectors(const AffineSpace3f &xfm,
+                                       const utility::DataView<vec3f> &in,
+                                       vec3f *out,
+                                       size_t n,
+                                       bool parallel = true);
+
+    // normals are transformed with the inverse transpose of 'xfm.l'
+    RKCOMMON_INTERFACE void xfmNormals(const AffineSpace3f &xfm,
+                                       const vec3f *in,
+                                       vec3f *out,
+                                       size_t n,
+                                       bool parallel = true);
+
+    RKCOMMON_INTERFACE void xfmNormals(const AffineSpace3f &xfm,
+                                       const utility::DataView<vec3f> &in,
+                                       vec3f *out,
+                                       size_t n,
+                                       bool parallel = true);
+
+    /* Bounds of 'n' instances: out[i] = xfmBounds(xfms[i], in[i]), e.g. the
+       world bounds of instances from the bounds of their objects. Returns
+       the union of all 'out' boxes. A DataView with a stride of 0 lets all
+       instances share the same object bounds. */
+    RKCOMMON_INTERFACE box3f xfmBounds(const AffineSpace3f *xfms,
+                                       const box3f *in,
+                                       box3f *out,
+                                       size_t n,
+                                       bool parallel = true);
+
+    RKCOMMON_INTERFACE box3f
+    xfmBounds(const utility::DataView<AffineSpace3f> &xfms,
+              const utility::DataView<box3f> &in,
+              box3f *out,
+              size_t n,
+              bool parallel = true);
+
+    /* out[i] = rcp(in[i]), e.g. the world to object transforms of
+       instances. rcpOrthonormal() requires rigid transforms (orthonormal
+       'l', e.g. a rotation plus translation) and inverts them with a
+       transpose. 'out' may be the same array as 'in'. */
+    RKCOMMON_INTERFACE void rcp(const AffineSpace3f *in,
+                                AffineSpace3f *out,
+                                size_t n,
+                                bool parallel = true);
+
+    RKCOMMON_INTERFACE void rcpOrthonormal(const AffineSpace3f *in,
+                                           AffineSpace3f *out,
+                                           size_t n,
+                                           bool parallel = true);
+
+  }  // namespace math
+}  // namespace rkcommon
@@ -3,21 +3,28 @@
 
 #pragma once
 
-#include <functional>
+#include "../utility/InplaceFunction.h"
+// std
 #include <memory>
 #include <utility>
 
 namespace rkcommon {
   namespace memory {
 
+    // Deleters (e.g. lambdas) may capture up to two pointers, the deleter
+    // is stored inside the pointer itself and never allocates
     template <typename T>
-    using DeletedUniquePtr = std::unique_ptr<T, std::function<void(T *)>>;
+    using DeletedUniquePtr =
+        std::unique_ptr<T,
+                        utility::InplaceFunction<void(T *),
+                                                 2 * sizeof(void *)>>;
 
     template <typename T, typename DELETE_FCN, typename... Args>
     inline DeletedUniquePtr<T> make_deleted_unique(DELETE_FCN &&deleter,
                                                    Args &&... args)
     {
-      return DeletedUniquePtr<T>(new T(std::forward<Args>(args)...), deleter);
+      return DeletedUniquePtr<T>(new T(std::forward<Args>(args)...),
+                                 std::forward<DELETE_FCN>(deleter));
     }
 
   }  // namespace memory
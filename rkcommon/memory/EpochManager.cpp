@@ -0,0 +1,161 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "EpochManager.h"
+#include "../tasking/ThreadLocal.h"
+// std
+#include <new>
+
+namespace rkcommon {
+  namespace memory {
+
+    static std::atomic<uint64_t> nextEpochManagerId{1};
+
+    static size_t segmentBegin(size_t segment, size_t segment0Size)
+    {
+      return segment0Size * ((size_t(1) << segment) - 1);
+    }
+
+    EpochManager::EpochManager()
+        : id(nextEpochManagerId.fetch_add(1, std::memory_order_relaxed))
+    {
+      for (auto &s : segments)
+        s.store(nullptr, std::memory_order_relaxed);
+    }
+
+    EpochManager::~EpochManager()
+    {
+      // nobody can be pinned anymore, everything is safe
+      for (size_t s = 0; s < NUM_SEGMENTS; ++s) {
+        Record *records = segments[s].load(std::memory_order_acquire);
+        if (!records)
+          continue;
+        const size_t n = SEGMENT0_SIZE << s;
+        for (size_t i = 0; i < n; ++i) {
+          for (auto &l : records[i].limbo)
+            freeAll(l);
+          records[i].~Record();
+        }
+        alignedFree(records);
+      }
+    }
+
+    void EpochManager::retire(void *ptr, void (*deleter)(void *))
+    {
+      if (!ptr)
+        return;
+
+      Record &r        = record();
+      const uint64_t e = globalEpoch.load(std::memory_order_acquire);
+      Limbo &l         = r.limbo[e % 3];
+      if (l.epoch != e) {
+        // last used three epochs ago, which is safe by now
+        freeAll(l);
+        l.epoch = e;
+      }
+      l.list.push_back({ptr, deleter ? deleter : &alignedFree});
+      retiredCount.fetch_add(1, std::memory_order_relaxed);
+
+      if (++r.retiredSinceCollect >= COLLECT_EVERY)
+        collect();
+    }
+
+    void EpochManager::collect()
+    {
+      Record &r             = record();
+      r.retiredSinceCollect = 0;
+      tryAdvance();
+      freeSafe(r, globalEpoch.load(std::memory_order_acquire));
+    }
+
+    uint64_t EpochManager::epoch() const
+    {
+      return globalEpoch.load(std::memory_order_acquire);
+    }
+
+    size_t EpochManager::numRetired() const
+    {
+      return retiredCount.load(std::memory_order_relaxed);
+    }
+
+    EpochManager::Record &EpochManager::recordForThisThread()
+    {
+      const size_t index = tasking::detail::threadLocalIndex();
+
+      size_t segment = 0;
+      while (index >= segmentBegin(segment + 1, SEGMENT0_SIZE))
+        ++segment;
+
+      Record *records = segments[segment].load(std::memory_order_acquire);
+      if (!records) {
+        // racing threads may both allocate, the loser frees its segment
+        const size_t n = SEGMENT0_SIZE << segment;
+        Record *fresh  = alignedMalloc<Record>(n, alignof(Record));
+        for (size_t i = 0; i < n; ++i)
+          new (fresh + i) Record;
+
+        if (segments[segment].compare_exchange_strong(
+                records, fresh, std::memory_order_acq_rel)) {
+          records = fresh;
+        } else {
+          for (size_t i = 0; i < n; ++i)
+            fresh[i].~Record();
+          alignedFree(fresh);
+        }
+      }
+
+      size_t seen = numRecords.load(std::memory_order_relaxed);
+      while (seen <= index &&
+             !numRecords.compare_exchange_weak(
+                 seen, index + 1, std::memory_order_acq_rel)) {
+      }
+
+      return records[index - segmentBegin(segment, SEGMENT0_SIZE)];
+    }
+
+    bool EpochManager::tryAdvance()
+    {
+      uint64_t e = globalEpoch.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      const size_t n = numRecords.load(std::memory_order_acquire);
+      for (size_t s = 0;
+           s < NUM_SEGMENTS && segmentBegin(s, SEGMENT0_SIZE) < n;
+           ++s) {
+        Record *records = segments[s].load(std::memory_order_acquire);
+        if (!records)
+          continue;
+        const size_t count = SEGMENT0_SIZE << s;
+        for (size_t i = 0; i < count; ++i) {
+          const uint64_t state =
+              records[i].state.load(std::memory_order_acquire);
+          // pinned threads have to catch up with the current epoch first
+          if ((state & 1) && (state >> 1) != e)
+            return false;
+        }
+      }
+
+      return globalEpoch.compare_exchange_strong(
+          e, e + 1, std::memory_order_acq_rel);
+    }
+
+    void EpochManager::freeSafe(Record &r, uint64_t e)
+    {
+      // memory retired in epoch 'e - 2' or earlier is unreachable: every
+      // thread pinned since then has seen at least 'e - 1'
+      for (auto &l : r.limbo) {
+        if (l.epoch + 2 <= e)
+          freeAll(l);
+      }
+    }
+
+    void EpochManager::freeAll(Limbo &limbo)
+    {
+      for (auto &r : limbo.list)
+        r.deleter(r.ptr);
+      retiredCount.fetch_sub(limbo.list.size(), std::memory_order_relaxed);
+      limbo.list.clear();
+    }
+
+  }  // namespace memory
+}  // namespace rkcommon
@@ -0,0 +1,190 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "malloc.h"
+// std
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rkcommon {
+  namespace memory {
+
+    /* Epoch-based reclamation for lock-free data structures: readers pin()
+       the current epoch for as long as they hold pointers into the
+       structure, writers retire() what they unlinked, and retired memory
+       is freed once every thread which was pinned at the time has unpinned
+       since. Pinning is a thread-local lookup plus one fence, there is no
+       shared counter which readers write to.
+
+       Per-thread state is indexed by tasking::detail::threadLocalIndex(),
+       the compact index the tasking workers (and any other thread) also
+       use for ThreadLocal<>. Retired memory is only freed by the thread
+       which retired it, on later calls to retire() or collect(), and by
+       the destructor. */
+    class RKCOMMON_INTERFACE EpochManager
+    {
+     public:
+      // Keeps the calling thread pinned while alive, nesting is allowed
+      class Guard
+      {
+       public:
+        Guard(Guard &&other);
+        ~Guard();
+
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+        Guard &operator=(Guard &&) = delete;
+
+       private:
+        friend class EpochManager;
+        explicit Guard(EpochManager *manager);
+
+        EpochManager *manager;
+      };
+
+      EpochManager();
+      ~EpochManager();
+
+      EpochManager(const EpochManager &) = delete;
+      EpochManager &operator=(const EpochManager &) = delete;
+
+      Guard pin();
+
+      // Free 'ptr' with 'deleter' (alignedFree() if null) once no thread
+      // can reach it anymore
+      void retire(void *ptr, void (*deleter)(void *) = nullptr);
+
+      // Destroy and alignedFree() an object placed in alignedMalloc() memory
+      template <typename T>
+      void retireObject(T *object);
+
+      // Try to advance the epoch and free what the calling thread retired
+      // and is safe by now
+      void collect();
+
+      uint64_t epoch() const;
+
+      // Retired by all threads and not freed yet
+      size_t numRetired() const;
+
+     private:
+      struct Retired
+      {
+        void *ptr;
+        void (*deleter)(void *);
+      };
+
+      // retired during 'epoch'
+      struct Limbo
+      {
+        uint64_t epoch{0};
+        std::vector<Retired> list;
+      };
+
+      struct alignas(64) Record
+      {
+        // (epoch << 1) | 1 while pinned, 0 otherwise
+        std::atomic<uint64_t> state{0};
+        int nesting{0};
+        size_t retiredSinceCollect{0};
+        Limbo limbo[3];
+      };
+
+      void enter();
+      void leave();
+
+      Record &record();
+      Record &recordForThisThread();
+
+      bool tryAdvance();
+      void freeSafe(Record &r, uint64_t globalEpoch);
+      void freeAll(Limbo &limbo);
+
+      static constexpr size_t SEGMENT0_SIZE = 8;
+      static constexpr size_t NUM_SEGMENTS  = 32;
+      static constexpr size_t COLLECT_EVERY = 64;
+
+      // Data members //
+
+      alignas(64) std::atomic<uint64_t> globalEpoch{1};
+      std::atomic<size_t> numRecords{0};  // high water mark of indices
+      std::atomic<size_t> retiredCount{0};
+      std::atomic<Record *> segments[NUM_SEGMENTS];
+
+      // tells a thread's cached record apart from one of a destroyed
+      // manager which lived at the same address
+      const uint64_t id;
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    inline EpochManager::Guard::Guard(EpochManager *_manager)
+        : manager(_manager)
+    {
+      manager->enter();
+    }
+
+    inline EpochManager::Guard::Guard(Guard &&other) : manager(other.manager)
+    {
+      other.manager = nullptr;
+    }
+
+    inline EpochManager::Guard::~Guard()
+    {
+      if (manager)
+        manager->leave();
+    }
+
+    inline EpochManager::Guard EpochManager::pin()
+    {
+      return Guard(this);
+    }
+
+    template <typename T>
+    inline void EpochManager::retireObject(T *object)
+    {
+      retire(object, [](void *ptr) {
+        static_cast<T *>(ptr)->~T();
+        alignedFree(ptr);
+      });
+    }
+
+    inline EpochManager::Record &EpochManager::record()
+    {
+      struct Cache
+      {
+        uint64_t id;
+        Record *record;
+      };
+      static thread_local Cache cache{0, nullptr};
+      if (cache.id != id) {
+        cache.record = &recordForThisThread();
+        cache.id     = id;
+      }
+      return *cache.record;
+    }
+
+    inline void EpochManager::enter()
+    {
+      Record &r = record();
+      if (r.nesting++ == 0) {
+        const uint64_t e = globalEpoch.load(std::memory_order_relaxed);
+        r.state.store((e << 1) | 1, std::memory_order_relaxed);
+        // order the announcement before reading shared pointers
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+      }
+    }
+
+    inline void EpochManager::leave()
+    {
+      Record &r = record();
+      if (--r.nesting == 0)
+        r.state.store(0, std::memory_order_release);
+    }
+
+  }  // namespace memory
+}  // namespace rkcommon
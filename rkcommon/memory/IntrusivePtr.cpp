@@ -0,0 +1,141 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "IntrusivePtr.h"
+// std
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace rkcommon {
+  namespace memory {
+
+    // Merge queues ///////////////////////////////////////////////////////////
+
+    struct BiasedMergeRequest
+    {
+      BiasedRefCounter *counter;
+      const void *object;
+      void (*destroy)(const void *);
+    };
+
+    struct BiasedThread;
+
+    // Threads which own biased objects, by id. Only used on the slow
+    // paths, a single lock is plenty.
+    struct BiasedThreads
+    {
+      std::mutex mutex;
+      std::unordered_map<uint64_t, BiasedThread *> threads;
+      uint64_t nextId{1};
+    };
+
+    static BiasedThreads &biasedThreads()
+    {
+      // leaked, threads may exit after static destruction
+      static BiasedThreads *threads = new BiasedThreads;
+      return *threads;
+    }
+
+    struct BiasedThread
+    {
+      BiasedThread();
+      ~BiasedThread();
+
+      uint64_t id{0};
+      std::vector<BiasedMergeRequest> queue;  // guarded by the global lock
+      std::atomic<bool> pending{false};
+    };
+
+    static BiasedThread &biasedThread()
+    {
+      static thread_local BiasedThread thread;
+      return thread;
+    }
+
+    struct BiasedMergeAccess
+    {
+      static void merge(std::vector<BiasedMergeRequest> &requests)
+      {
+        for (auto &r : requests)
+          r.counter->merge(r.object, r.destroy);
+      }
+    };
+
+    BiasedThread::BiasedThread()
+    {
+      auto &t = biasedThreads();
+      std::lock_guard<std::mutex> lock(t.mutex);
+      id            = t.nextId++;
+      t.threads[id] = this;
+    }
+
+    BiasedThread::~BiasedThread()
+    {
+      // objects queued from now on are merged by the releasing thread
+      {
+        auto &t = biasedThreads();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        t.threads.erase(id);
+      }
+      BiasedMergeAccess::merge(queue);
+    }
+
+    uint64_t detail::registerBiasedThread()
+    {
+      return biasedThread().id;
+    }
+
+    // BiasedRefCounter definitions ///////////////////////////////////////////
+
+    BiasedRefCounter::BiasedRefCounter() : owner(detail::biasedThreadId())
+    {
+      // creating objects is a good time to merge what others released
+      if (biasedThread().pending.load(std::memory_order_relaxed))
+        mergeQueued();
+    }
+
+    void BiasedRefCounter::queueForMerge(const void *object,
+                                         void (*destroy)(const void *))
+    {
+      {
+        auto &t = biasedThreads();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        auto thread = t.threads.find(owner.load(std::memory_order_relaxed));
+        if (thread != t.threads.end()) {
+          thread->second->queue.push_back({this, object, destroy});
+          thread->second->pending.store(true, std::memory_order_relaxed);
+          return;
+        }
+      }
+      // the owner has exited (synchronized through the lock above), so its
+      // count can no longer change
+      merge(object, destroy);
+    }
+
+    void BiasedRefCounter::merge(const void *object,
+                                 void (*destroy)(const void *))
+    {
+      const long long b = biased;
+      biased            = 0;
+      owner.store(NO_OWNER, std::memory_order_relaxed);
+      const long long prev = shared.fetch_add(b * ONE - QUEUED + MERGED,
+                                              std::memory_order_acq_rel);
+      if (countOf(prev) + b == 0)
+        destroy(object);
+    }
+
+    void BiasedRefCounter::mergeQueued()
+    {
+      auto &self = biasedThread();
+      std::vector<BiasedMergeRequest> requests;
+      {
+        std::lock_guard<std::mutex> lock(biasedThreads().mutex);
+        requests.swap(self.queue);
+        self.pending.store(false, std::memory_order_relaxed);
+      }
+      BiasedMergeAccess::merge(requests);
+    }
+
+  }  // namespace memory
+}  // namespace rkcommon
@@ -3,48 +3,316 @@
 
 #pragma once
 
+#include "../common.h"
+#include "malloc.h"
+// std
 #include <atomic>
+#include <cstdint>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
 
 namespace rkcommon {
   namespace memory {
 
-    class RefCountedObject
+    // Reference counter policies //////////////////////////////////////////
+
+    /* A counter starts at 1 for the reference held by the creator. dec()
+       returns true when the last reference was released. */
+
+    // Safe to share between threads, a locked RMW per copy
+    class AtomicRefCounter
+    {
+     public:
+      void inc();
+      bool dec();
+      long long count() const;
+
+     private:
+      std::atomic<long long> counter{1};
+    };
+
+    // Plain integer, for objects which never leave one thread at a time
+    class SingleThreadRefCounter
+    {
+     public:
+      void inc();
+      bool dec();
+      long long count() const;
+
+     private:
+      long long counter{1};
+    };
+
+    /* Biased reference counting: the thread which created the object
+       counts without atomics, all other threads count atomically in a
+       separate shared counter. Suited for objects mostly referenced by the
+       thread that made them.
+
+       The shared count goes negative when other threads release references
+       the owner handed out. The first time that happens the object is
+       queued to the owner, which folds its count into the shared one
+       ("merges") in mergeQueued(); from then on all threads count in the
+       shared counter. The owner also merges when its own count drops to
+       zero. Objects queued to a thread that has exited are merged right
+       away. */
+    class RKCOMMON_INTERFACE BiasedRefCounter
+    {
+     public:
+      BiasedRefCounter();
+
+      void inc();
+      bool dec(const void *object, void (*destroy)(const void *));
+      long long count() const;
+
+      /* Merge the objects queued to the calling thread, releasing those
+         without references left. Call at convenient points (e.g. once per
+         frame) on threads which create many biased objects that are
+         released elsewhere; also done when the thread exits. */
+      static void mergeQueued();
+
+     private:
+      friend struct BiasedMergeAccess;
+
+      enum : long long
+      {
+        QUEUED = 1,
+        MERGED = 2,
+        ONE    = 4  // shared = count * ONE | flags
+      };
+
+      static long long countOf(long long shared);
+      bool isOwner() const;
+
+      void queueForMerge(const void *object, void (*destroy)(const void *));
+      void merge(const void *object, void (*destroy)(const void *));
+
+      static const uint64_t NO_OWNER = ~uint64_t(0);  // after the merge
+
+      std::atomic<uint64_t> owner;
+      long long biased{1};
+      std::atomic<long long> shared{0};
+    };
+
+    namespace detail {
+      // id of the calling thread (never 0 or NO_OWNER), registering it
+      // for merge queues; ids are never reused
+      RKCOMMON_INTERFACE uint64_t registerBiasedThread();
+
+      inline uint64_t biasedThreadId()
+      {
+        static thread_local uint64_t id = 0;
+        if (!id)
+          id = registerBiasedThread();
+        return id;
+      }
+    }  // namespace detail
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Reference counted base class ///////////////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////
+
+    namespace detail {
+      struct RefCountedAccess;
+    }  // namespace detail
+
+    template <typename COUNTER>
+    class BasicRefCountedObject
     {
      public:
-      RefCountedObject()          = default;
-      virtual ~RefCountedObject() = default;
+      using counter_t = COUNTER;
 
-      RefCountedObject(const RefCountedObject &) = delete;
-      RefCountedObject &operator=(const RefCountedObject &) = delete;
-      RefCountedObject(RefCountedObject &&) = delete;
-      RefCountedObject &operator=(RefCountedObject &&) = delete;
+      BasicRefCountedObject()          = default;
+      virtual ~BasicRefCountedObject() = default;
+
+      BasicRefCountedObject(const BasicRefCountedObject &) = delete;
+      BasicRefCountedObject &operator=(const BasicRefCountedObject &) = delete;
+      BasicRefCountedObject(BasicRefCountedObject &&)                 = delete;
+      BasicRefCountedObject &operator=(BasicRefCountedObject &&) = delete;
 
       void refInc() const;
       void refDec() const;
       long long useCount() const;
 
      private:
-      mutable std::atomic<long long> refCounter{1};
+      friend struct detail::RefCountedAccess;
+
+      void destroy() const;
+
+      mutable COUNTER refCounter;
+      // how make_intrusive() wants the object released, 'delete' if null
+      void (*destroyFcn)(const BasicRefCountedObject *){nullptr};
     };
 
+    using RefCountedObject = BasicRefCountedObject<AtomicRefCounter>;
+
+    namespace detail {
+      template <typename COUNTER>
+      std::true_type isRefCounted(const BasicRefCountedObject<COUNTER> *);
+      std::false_type isRefCounted(...);
+    }  // namespace detail
+
+    // Whether T derives from any BasicRefCountedObject<>
+    template <typename T>
+    using is_ref_counted =
+        decltype(detail::isRefCounted(std::declval<T *>()));
+
     // Inlined definitions //
 
-    inline void RefCountedObject::refInc() const
+    inline void AtomicRefCounter::inc()
     {
-      refCounter++;
+      counter.fetch_add(1, std::memory_order_relaxed);
     }
 
-    inline void RefCountedObject::refDec() const
+    inline bool AtomicRefCounter::dec()
     {
-      if ((--refCounter) == 0)
+      return counter.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    inline long long AtomicRefCounter::count() const
+    {
+      return counter.load();
+    }
+
+    inline void SingleThreadRefCounter::inc()
+    {
+      counter++;
+    }
+
+    inline bool SingleThreadRefCounter::dec()
+    {
+      return --counter == 0;
+    }
+
+    inline long long SingleThreadRefCounter::count() const
+    {
+      return counter;
+    }
+
+    inline long long BiasedRefCounter::countOf(long long shared)
+    {
+      return (shared - (shared & (QUEUED | MERGED))) / ONE;
+    }
+
+    inline bool BiasedRefCounter::isOwner() const
+    {
+      return owner.load(std::memory_order_relaxed) == detail::biasedThreadId();
+    }
+
+    inline void BiasedRefCounter::inc()
+    {
+      if (isOwner())
+        biased++;
+      else
+        shared.fetch_add(ONE, std::memory_order_relaxed);
+    }
+
+    inline bool BiasedRefCounter::dec(const void *object,
+                                      void (*destroy)(const void *))
+    {
+      if (isOwner()) {
+        if (--biased > 0)
+          return false;
+        // merge, unless that is already pending in the queue
+        long long s = shared.load(std::memory_order_relaxed);
+        do {
+          if (s & QUEUED)
+            return false;
+        } while (!shared.compare_exchange_weak(
+            s, s | MERGED, std::memory_order_acq_rel));
+        owner.store(NO_OWNER, std::memory_order_relaxed);
+        return countOf(s) == 0;
+      }
+
+      long long s = shared.load(std::memory_order_relaxed);
+      long long next;
+      do {
+        next = s - ONE;
+        if (!(s & (MERGED | QUEUED)) && countOf(next) < 0)
+          next |= QUEUED;
+      } while (!shared.compare_exchange_weak(
+          s, next, std::memory_order_acq_rel));
+
+      if (s & MERGED)
+        return countOf(next) == 0;
+      if ((next & QUEUED) && !(s & QUEUED))
+        queueForMerge(object, destroy);
+      return false;
+    }
+
+    inline long long BiasedRefCounter::count() const
+    {
+      const long long s = shared.load();
+      if (s & MERGED)
+        return countOf(s);
+      // the owner's references are only visible to the owner, elsewhere
+      // they are reported as one
+      return countOf(s) + (isOwner() ? biased : 1);
+    }
+
+    template <typename COUNTER>
+    inline void BasicRefCountedObject<COUNTER>::refInc() const
+    {
+      refCounter.inc();
+    }
+
+    namespace detail {
+      template <typename COUNTER>
+      inline bool releaseRef(COUNTER &counter, const void *)
+      {
+        return counter.dec();
+      }
+
+      struct RefCountedAccess
+      {
+        template <typename COUNTER>
+        static void destroy(const BasicRefCountedObject<COUNTER> *object)
+        {
+          object->destroy();
+        }
+
+        template <typename COUNTER>
+        static void setDestroy(
+            BasicRefCountedObject<COUNTER> *object,
+            void (*fcn)(const BasicRefCountedObject<COUNTER> *))
+        {
+          object->destroyFcn = fcn;
+        }
+      };
+
+      inline void destroyBiased(const void *object)
+      {
+        RefCountedAccess::destroy(
+            static_cast<const BasicRefCountedObject<BiasedRefCounter> *>(
+                object));
+      }
+
+      inline bool releaseRef(BiasedRefCounter &counter, const void *object)
+      {
+        return counter.dec(object, &destroyBiased);
+      }
+    }  // namespace detail
+
+    template <typename COUNTER>
+    inline void BasicRefCountedObject<COUNTER>::refDec() const
+    {
+      if (detail::releaseRef(refCounter, this))
+        destroy();
+    }
+
+    template <typename COUNTER>
+    inline void BasicRefCountedObject<COUNTER>::destroy() const
+    {
+      if (destroyFcn)
+        destroyFcn(this);
+      else
         delete this;
     }
 
-    inline long long RefCountedObject::useCount() const
+    template <typename COUNTER>
+    inline long long BasicRefCountedObject<COUNTER>::useCount() const
     {
-      return refCounter.load();
+      return refCounter.count();
     }
 
     ///////////////////////////////////////////////////////////////////////////
@@ -54,7 +322,7 @@ namespace rkcommon {
     template <typename T>
     class IntrusivePtr
     {
-      static_assert(std::is_base_of<RefCountedObject, T>::value,
+      static_assert(is_ref_counted<T>::value,
                     "IntrusivePtr<T> can only be used with objects derived "
                     "from RefCountedObject");
 
@@ -172,6 +440,148 @@ namespace rkcommon {
       return ptr;
     }
 
+    ///////////////////////////////////////////////////////////////////////////
+    // Pooled construction ////////////////////////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////
+
+    /* Create a T in a FixedPool<T> shared by all objects of that type, so
+       they sit next to each other and creation and release skip the global
+       heap. The last reference returns the slot to the pool. */
+    template <typename T, typename... Args>
+    IntrusivePtr<T> make_intrusive(Args &&... args);
+
+    /* Create a T in 'arena'; the last reference only runs the destructor,
+       the memory comes back with Arena::reset(), which must not happen
+       while the object is still referenced */
+    template <typename T, typename... Args>
+    IntrusivePtr<T> make_intrusive(Arena &arena, Args &&... args);
+
+    namespace detail {
+      // leaked, objects may be released during static destruction
+      template <typename T>
+      inline FixedPool<T> &intrusivePool()
+      {
+        static FixedPool<T> *pool = new FixedPool<T>;
+        return *pool;
+      }
+
+      template <typename T>
+      inline IntrusivePtr<T> adoptPooled(
+          T *object,
+          void (*destroy)(
+              const BasicRefCountedObject<typename T::counter_t> *))
+      {
+        RefCountedAccess::setDestroy(object, destroy);
+        IntrusivePtr<T> ptr(object);
+        object->refDec();  // IntrusivePtr took its own reference
+        return ptr;
+      }
+    }  // namespace detail
+
+    // Inlined definitions //
+
+    template <typename T, typename... Args>
+    inline IntrusivePtr<T> make_intrusive(Args &&... args)
+    {
+      using base_t = BasicRefCountedObject<typename T::counter_t>;
+      return detail::adoptPooled(
+          detail::intrusivePool<T>().create(std::forward<Args>(args)...),
+          [](const base_t *object) {
+            detail::intrusivePool<T>().destroy(
+                const_cast<T *>(static_cast<const T *>(object)));
+          });
+    }
+
+    template <typename T, typename... Args>
+    inline IntrusivePtr<T> make_intrusive(Arena &arena, Args &&... args)
+    {
+      using base_t = BasicRefCountedObject<typename T::counter_t>;
+      T *object    = new (arena.allocate(sizeof(T), alignof(T)))
+          T(std::forward<Args>(args)...);
+      return detail::adoptPooled(object, [](const base_t *object) {
+        static_cast<const T *>(object)->~T();
+      });
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Non-owning view of a RefCountedObject //////////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////
+
+    /* Borrowed pointer which never touches the reference count, for passing
+       objects down into inner loops while an IntrusivePtr elsewhere keeps
+       them alive. ref() takes a real reference when one needs to be kept. */
+    template <typename T>
+    class IntrusiveView
+    {
+      static_assert(is_ref_counted<T>::value,
+                    "IntrusiveView<T> can only be used with objects derived "
+                    "from RefCountedObject");
+
+     public:
+      T *ptr{nullptr};
+
+      IntrusiveView() = default;
+      IntrusiveView(T *const input);
+
+      template <typename O>
+      IntrusiveView(const IntrusivePtr<O> &input);
+
+      template <typename O>
+      IntrusiveView(const IntrusiveView<O> &input);
+
+      IntrusivePtr<T> ref() const;
+
+      operator bool() const;
+
+      T &operator*() const;
+      T *operator->() const;
+    };
+
+    // Inlined definitions //
+
+    template <typename T>
+    inline IntrusiveView<T>::IntrusiveView(T *const input) : ptr(input)
+    {
+    }
+
+    template <typename T>
+    template <typename O>
+    inline IntrusiveView<T>::IntrusiveView(const IntrusivePtr<O> &input)
+        : ptr(input.ptr)
+    {
+    }
+
+    template <typename T>
+    template <typename O>
+    inline IntrusiveView<T>::IntrusiveView(const IntrusiveView<O> &input)
+        : ptr(input.ptr)
+    {
+    }
+
+    template <typename T>
+    inline IntrusivePtr<T> IntrusiveView<T>::ref() const
+    {
+      return IntrusivePtr<T>(ptr);
+    }
+
+    template <typename T>
+    inline IntrusiveView<T>::operator bool() const
+    {
+      return ptr != nullptr;
+    }
+
+    template <typename T>
+    inline T &IntrusiveView<T>::operator*() const
+    {
+      return *ptr;
+    }
+
+    template <typename T>
+    inline T *IntrusiveView<T>::operator->() const
+    {
+      return ptr;
+    }
+
     // Inlined operators //////////////////////////////////////////////////////
 
     template <typename T>
@@ -192,5 +602,17 @@ namespace rkcommon {
       return a.ptr != b.ptr;
     }
 
+    template <typename T>
+    bool operator==(const IntrusiveView<T> &a, const IntrusiveView<T> &b)
+    {
+      return a.ptr == b.ptr;
+    }
+
+    template <typename T>
+    bool operator!=(const IntrusiveView<T> &a, const IntrusiveView<T> &b)
+    {
+      return a.ptr != b.ptr;
+    }
+
   }  // namespace memory
 }  // namespace rkcommon
@@ -14,5 +14,8 @@ namespace rkcommon {
 
     using RefCount = RefCountedObject;
 
+    template <typename T>
+    using RefView = IntrusiveView<T>;
+
   }  // namespace memory
 }  // namespace rkcommon
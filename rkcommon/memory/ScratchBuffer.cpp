@@ -0,0 +1,131 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ScratchBuffer.h"
+#include "malloc.h"
+// std
+#include <algorithm>
+#include <new>
+
+namespace rkcommon {
+  namespace memory {
+
+    ScratchBuffer::ScratchBuffer(size_t _initialSize)
+        : initialSize(std::max(_initialSize, size_t(64)))
+    {
+    }
+
+    ScratchBuffer::~ScratchBuffer()
+    {
+      for (const Block &b : blocks)
+        alignedFree(b.data);
+    }
+
+    ScratchBuffer &ScratchBuffer::current()
+    {
+      // freed when the thread exits, tasking workers included
+      static thread_local ScratchBuffer buffer;
+      return buffer;
+    }
+
+    void ScratchBuffer::useBlock(size_t index)
+    {
+      block = index;
+      ptr   = blocks[index].data;
+      end   = ptr + blocks[index].size;
+    }
+
+    void *ScratchBuffer::allocateSlow(size_t size, size_t align)
+    {
+      assert((align & (align - 1)) == 0);
+
+      // blocks added by earlier peaks, released since
+      for (size_t i = ptr ? block + 1 : 0; i < blocks.size(); ++i) {
+        useBlock(i);
+        char *p = reinterpret_cast<char *>(ALIGN_PTR(ptr, align));
+        if (p <= end && size <= size_t(end - p)) {
+          ptr = p + size;
+          return p;
+        }
+      }
+
+      Block b;
+      b.size = std::max(blocks.empty() ? initialSize : 2 * blocks.back().size,
+                        size + align);
+      b.data = static_cast<char *>(alignedMalloc(b.size, 64));
+      if (!b.data)
+        throw std::bad_alloc();
+      blocks.push_back(b);
+      useBlock(blocks.size() - 1);
+      return allocate(size, align);
+    }
+
+    void ScratchBuffer::release(const Mark &m)
+    {
+      const bool empty = !m.ptr
+          || (m.block == 0 && !blocks.empty() && m.ptr == blocks[0].data);
+      if (!empty) {
+        block = m.block;
+        ptr   = m.ptr;
+        end   = blocks[block].data + blocks[block].size;
+        return;
+      }
+
+      if (blocks.size() > 1) {
+        // grown past its size, replace all blocks by one large enough for
+        // the peak so far
+        const size_t total = bytesReserved();
+        for (const Block &b : blocks)
+          alignedFree(b.data);
+        blocks.clear();
+        ptr = end = nullptr;
+        reserve(total);
+      }
+
+      if (blocks.empty()) {
+        block = 0;
+        ptr = end = nullptr;
+      } else {
+        useBlock(0);
+      }
+    }
+
+    void ScratchBuffer::reserve(size_t size)
+    {
+      // only possible while nothing is allocated
+      if (bytesUsed() != 0 || (!blocks.empty() && blocks[0].size >= size))
+        return;
+
+      for (const Block &b : blocks)
+        alignedFree(b.data);
+      blocks.clear();
+
+      Block b;
+      b.size = std::max(size, initialSize);
+      b.data = static_cast<char *>(alignedMalloc(b.size, 64));
+      if (!b.data)
+        throw std::bad_alloc();
+      blocks.push_back(b);
+      useBlock(0);
+    }
+
+    size_t ScratchBuffer::bytesUsed() const
+    {
+      if (!ptr)
+        return 0;
+      size_t used = size_t(ptr - blocks[block].data);
+      for (size_t i = 0; i < block; ++i)
+        used += blocks[i].size;
+      return used;
+    }
+
+    size_t ScratchBuffer::bytesReserved() const
+    {
+      size_t total = 0;
+      for (const Block &b : blocks)
+        total += b.size;
+      return total;
+    }
+
+  }  // namespace memory
+}  // namespace rkcommon
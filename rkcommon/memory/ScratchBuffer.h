@@ -0,0 +1,164 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+// std
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rkcommon {
+  namespace memory {
+
+    /*! Per-thread LIFO bump allocator for temporary buffers, e.g. a row or
+        tile of a kernel, replacing STACK_BUFFER (which overflows the stack
+        on large sizes) and heap allocations inside loops:
+
+          void shadeRow(int width)
+          {
+            ScratchScope scratch;
+            float *row = scratch.allocate<float>(width);
+            ...
+          }  // 'row' is released here
+
+        Allocating bumps a pointer; releasing a ScratchScope rewinds it to
+        where the scope started. The buffer grows by adding blocks when a
+        thread needs more than it ever did before, and once it is empty
+        again those are merged into one block which is kept, so a thread
+        reaches its steady state size once and then never allocates again.
+
+        Each thread has its own buffer (see current()), including the
+        tasking system's workers. Tasks may use scopes freely: a task run by
+        a thread waiting inside another one finishes before the wait
+        returns, so scopes always stay nested. Memory must not be handed to
+        other threads beyond the scope. No destructors are run. */
+    class RKCOMMON_INTERFACE ScratchBuffer
+    {
+     public:
+      // A position in the buffer to release() back to
+      struct Mark
+      {
+        size_t block;
+        char *ptr;
+      };
+
+      explicit ScratchBuffer(size_t initialSize = size_t(64) << 10);
+      ~ScratchBuffer();
+
+      ScratchBuffer(const ScratchBuffer &) = delete;
+      ScratchBuffer &operator=(const ScratchBuffer &) = delete;
+
+      // The calling thread's buffer
+      static ScratchBuffer &current();
+
+      void *allocate(size_t size, size_t align = 64);
+
+      template <typename T>
+      T *allocate(size_t nElements, size_t align = 64);
+
+      Mark mark() const;
+
+      // Free everything allocated since 'm' was taken
+      void release(const Mark &m);
+
+      // Make sure 'size' bytes fit without growing, e.g. from a
+      // WorkerInitHook
+      void reserve(size_t size);
+
+      size_t bytesUsed() const;
+      size_t bytesReserved() const;
+
+     private:
+      void *allocateSlow(size_t size, size_t align);
+      void useBlock(size_t index);
+
+      struct Block
+      {
+        char *data;
+        size_t size;
+      };
+
+      std::vector<Block> blocks;
+      size_t block{0};     // block allocate() bumps into
+      char *ptr{nullptr};  // next free byte in it
+      char *end{nullptr};
+      size_t initialSize;
+    };
+
+    // Releases everything allocated through it when it goes out of scope
+    class ScratchScope
+    {
+     public:
+      ScratchScope();
+      explicit ScratchScope(ScratchBuffer &buffer);
+      ~ScratchScope();
+
+      ScratchScope(const ScratchScope &) = delete;
+      ScratchScope &operator=(const ScratchScope &) = delete;
+
+      void *allocate(size_t size, size_t align = 64);
+
+      template <typename T>
+      T *allocate(size_t nElements, size_t align = 64);
+
+     private:
+      ScratchBuffer &buffer;
+      ScratchBuffer::Mark start;
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    inline void *ScratchBuffer::allocate(size_t size, size_t align)
+    {
+      char *p = reinterpret_cast<char *>(
+          (reinterpret_cast<uintptr_t>(ptr) + (align - 1))
+          & ~uintptr_t(align - 1));
+      if (ptr && p <= end && size <= size_t(end - p)) {
+        ptr = p + size;
+        return p;
+      }
+      return allocateSlow(size, align);
+    }
+
+    template <typename T>
+    inline T *ScratchBuffer::allocate(size_t nElements, size_t align)
+    {
+      return static_cast<T *>(
+          allocate(nElements * sizeof(T), std::max(align, alignof(T))));
+    }
+
+    inline ScratchBuffer::Mark ScratchBuffer::mark() const
+    {
+      return {block, ptr};
+    }
+
+    inline ScratchScope::ScratchScope() : ScratchScope(ScratchBuffer::current())
+    {
+    }
+
+    inline ScratchScope::ScratchScope(ScratchBuffer &_buffer)
+        : buffer(_buffer), start(_buffer.mark())
+    {
+    }
+
+    inline ScratchScope::~ScratchScope()
+    {
+      buffer.release(start);
+    }
+
+    inline void *ScratchScope::allocate(size_t size, size_t align)
+    {
+      return buffer.allocate(size, align);
+    }
+
+    template <typename T>
+    inline T *ScratchScope::allocate(size_t nElements, size_t align)
+    {
+      return buffer.allocate<T>(nElements, align);
+    }
+
+  }  // namespace memory
+}  // namespace rkcommon
@@ -2,6 +2,16 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "malloc.h"
+#include "../tasking/detail/thread_affinity.h"
+#include "../tasking/parallel_for.h"
+// std
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
 #if defined(RKCOMMON_TASKING_TBB)
 #define __TBB_NO_IMPLICIT_LINKAGE 1
 #define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
@@ -14,10 +24,21 @@
 #endif
 #endif
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
 namespace rkcommon {
   namespace memory {
 
-    void *alignedMalloc(size_t size, size_t align)
+    static void *rawAlignedMalloc(size_t size, size_t align)
     {
       assert((align & (align - 1)) == 0);
 #if defined(RKCOMMON_TASKING_TBB)
@@ -31,7 +52,7 @@ namespace rkcommon {
 #endif
     }
 
-    void alignedFree(void *ptr)
+    static void rawAlignedFree(void *ptr)
     {
 #if defined(RKCOMMON_TASKING_TBB)
       scalable_aligned_free(ptr);
@@ -44,5 +65,564 @@ namespace rkcommon {
 #endif
     }
 
+    // Allocation tracking //////////////////////////////////////////////////
+
+    namespace {
+
+      struct TagRecord
+      {
+        std::string name;
+        std::atomic<size_t> liveBytes{0};
+        std::atomic<size_t> peakBytes{0};
+        std::atomic<size_t> allocatedBytes{0};
+        std::atomic<uint64_t> numAllocations{0};
+        std::atomic<uint64_t> numFrees{0};
+      };
+
+      struct TrackedAllocation
+      {
+        size_t size;
+        TagRecord *tag;
+      };
+
+      struct AllocationTracker
+      {
+        static constexpr size_t NUM_SHARDS = 64;
+
+        // sharded by address so concurrent allocations rarely contend
+        struct alignas(64) Shard
+        {
+          std::mutex mutex;
+          std::unordered_map<void *, TrackedAllocation> allocations;
+        };
+
+        Shard shards[NUM_SHARDS];
+
+        std::mutex tagMutex;
+        std::unordered_map<const char *, std::unique_ptr<TagRecord>> tags;
+        std::vector<TagRecord *> tagOrder;
+
+        Shard &shardFor(void *ptr)
+        {
+          const size_t p = reinterpret_cast<size_t>(ptr);
+          return shards[((p >> 6) ^ (p >> 16)) % NUM_SHARDS];
+        }
+
+        TagRecord *record(const char *tag)
+        {
+          std::lock_guard<std::mutex> lock(tagMutex);
+          auto &r = tags[tag];
+          if (!r) {
+            r       = make_unique<TagRecord>();
+            r->name = tag ? tag : "untagged";
+            tagOrder.push_back(r.get());
+          }
+          return r.get();
+        }
+      };
+
+      // never destroyed, memory may still be freed during static destruction
+      AllocationTracker &tracker()
+      {
+        // C++11 'new' does not align the shards, and the untracked raw
+        // allocation doesn't recurse into the tracker
+        static AllocationTracker *t = new (rawAlignedMalloc(
+            sizeof(AllocationTracker), alignof(AllocationTracker)))
+            AllocationTracker;
+        return *t;
+      }
+
+      std::atomic<bool> trackingEnabled{false};
+      std::atomic<size_t> numTracked{0};
+
+      thread_local const char *currentTag = nullptr;
+
+      TagRecord *currentTagRecord()
+      {
+        // the tag usually stays the same for many allocations
+        static thread_local const char *cachedTag   = nullptr;
+        static thread_local TagRecord *cachedRecord = nullptr;
+        if (!cachedRecord || cachedTag != currentTag) {
+          cachedTag    = currentTag;
+          cachedRecord = tracker().record(currentTag);
+        }
+        return cachedRecord;
+      }
+
+      void trackAllocation(void *ptr, size_t size)
+      {
+        TagRecord *tag = currentTagRecord();
+
+        auto &shard = tracker().shardFor(ptr);
+        {
+          std::lock_guard<std::mutex> lock(shard.mutex);
+          shard.allocations[ptr] = {size, tag};
+        }
+        numTracked++;
+
+        const size_t live = tag->liveBytes.fetch_add(size) + size;
+        size_t peak       = tag->peakBytes.load();
+        while (live > peak && !tag->peakBytes.compare_exchange_weak(peak, live))
+          ;
+        tag->allocatedBytes += size;
+        tag->numAllocations++;
+      }
+
+      void untrackAllocation(void *ptr)
+      {
+        TrackedAllocation a;
+        auto &shard = tracker().shardFor(ptr);
+        {
+          std::lock_guard<std::mutex> lock(shard.mutex);
+          auto found = shard.allocations.find(ptr);
+          if (found == shard.allocations.end())
+            return;
+          a = found->second;
+          shard.allocations.erase(found);
+        }
+        numTracked--;
+
+        a.tag->liveBytes -= a.size;
+        a.tag->numFrees++;
+      }
+
+    }  // namespace
+
+    void setAllocationTracking(bool enabled)
+    {
+      trackingEnabled = enabled;
+    }
+
+    bool allocationTrackingEnabled()
+    {
+      return trackingEnabled;
+    }
+
+    std::vector<AllocationStats> allocationStatistics()
+    {
+      auto &t = tracker();
+      std::lock_guard<std::mutex> lock(t.tagMutex);
+
+      std::vector<AllocationStats> stats;
+      for (const TagRecord *r : t.tagOrder) {
+        AllocationStats s;
+        s.tag            = r->name.c_str();
+        s.liveBytes      = r->liveBytes;
+        s.peakBytes      = r->peakBytes;
+        s.allocatedBytes = r->allocatedBytes;
+        s.numAllocations = r->numAllocations;
+        s.numFrees       = r->numFrees;
+        stats.push_back(s);
+      }
+      return stats;
+    }
+
+    ScopedAllocationTag::ScopedAllocationTag(const char *tag)
+        : previous(currentTag)
+    {
+      currentTag = tag;
+    }
+
+    ScopedAllocationTag::~ScopedAllocationTag()
+    {
+      currentTag = previous;
+    }
+
+    // Aligned allocation /////////////////////////////////////////////////////
+
+    void *alignedMalloc(size_t size, size_t align)
+    {
+      void *ptr = rawAlignedMalloc(size, align);
+      if (ptr && trackingEnabled.load(std::memory_order_relaxed))
+        trackAllocation(ptr, size);
+      return ptr;
+    }
+
+    void alignedFree(void *ptr)
+    {
+      if (ptr && numTracked.load(std::memory_order_relaxed) > 0)
+        untrackAllocation(ptr);
+      rawAlignedFree(ptr);
+    }
+
+    size_t hugePageSize()
+    {
+#ifdef _WIN32
+      static const size_t size = [] {
+        const size_t s = GetLargePageMinimum();
+        return s ? s : size_t(2) << 20;
+      }();
+      return size;
+#else
+      return size_t(2) << 20;
+#endif
+    }
+
+    static size_t roundToHugePages(size_t size)
+    {
+      const size_t page = hugePageSize();
+      return (size + page - 1) / page * page;
+    }
+
+    void *hugePageMalloc(size_t size, HugePages mode)
+    {
+      if (mode == HugePages::NONE || size < hugePageSize())
+        return alignedMalloc(size, 64);
+
+      const size_t mappedSize = roundToHugePages(size);
+      void *ptr               = nullptr;
+
+#ifdef _WIN32
+      // needs the "Lock pages in memory" privilege
+      if (mode == HugePages::RESERVED) {
+        ptr = VirtualAlloc(nullptr,
+                           mappedSize,
+                           MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                           PAGE_READWRITE);
+      }
+      if (!ptr) {
+        ptr = VirtualAlloc(
+            nullptr, mappedSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+      }
+#else
+#ifdef MAP_HUGETLB
+      if (mode == HugePages::RESERVED) {
+        ptr = mmap(nullptr,
+                   mappedSize,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                   -1,
+                   0);
+        if (ptr == MAP_FAILED)
+          ptr = nullptr;
+      }
+#endif
+      if (!ptr) {
+        ptr = mmap(nullptr,
+                   mappedSize,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS,
+                   -1,
+                   0);
+        if (ptr == MAP_FAILED)
+          return nullptr;
+#ifdef MADV_HUGEPAGE
+        madvise(ptr, mappedSize, MADV_HUGEPAGE);
+#endif
+      }
+#endif
+
+      return ptr;
+    }
+
+    void hugePageFree(void *ptr, size_t size, HugePages mode)
+    {
+      if (!ptr)
+        return;
+
+      if (mode == HugePages::NONE || size < hugePageSize()) {
+        alignedFree(ptr);
+        return;
+      }
+
+#ifdef _WIN32
+      VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+      munmap(ptr, roundToHugePages(size));
+#endif
+    }
+
+    // NUMA placement ////////////////////////////////////////////////////////
+
+    static const size_t numaPageSize = 4096;
+
+#if defined(__linux__) && defined(SYS_mbind)
+    // mbind() without a libnuma dependency, failures (single node kernels,
+    // restricted containers) leave the range to first touch
+    enum MbindMode
+    {
+      MBIND_PREFERRED  = 1,
+      MBIND_INTERLEAVE = 3
+    };
+
+    static void bindToNodes(void *ptr,
+                            size_t size,
+                            MbindMode mode,
+                            const std::vector<int> &nodeIds)
+    {
+      const int maskBits    = 1024;
+      const int bitsPerWord = 8 * sizeof(unsigned long);
+      unsigned long mask[maskBits / bitsPerWord] = {};
+      for (int id : nodeIds) {
+        if (id >= 0 && id < maskBits)
+          mask[id / bitsPerWord] |= 1ul << (id % bitsPerWord);
+      }
+
+      // the kernel expects one more than the number of mask bits
+      syscall(SYS_mbind, ptr, size, mode, mask, maskBits + 1, 0);
+    }
+#endif
+
+    static void touchInParallel(void *ptr, size_t size)
+    {
+      char *bytes           = static_cast<char *>(ptr);
+      const size_t numPages = (size + numaPageSize - 1) / numaPageSize;
+      const size_t numTasks =
+          std::min<size_t>(numPages, tasking::numTaskingThreads());
+      tasking::parallel_for(numTasks, [&](size_t task) {
+        const size_t begin = task * numPages / numTasks;
+        const size_t end   = (task + 1) * numPages / numTasks;
+        for (size_t page = begin; page < end; ++page)
+          bytes[page * numaPageSize] = 0;
+      });
+    }
+
+    void *numaAlignedMalloc(size_t size,
+                            size_t align,
+                            NumaPolicy policy,
+                            int node)
+    {
+      assert(align <= numaPageSize);
+
+      if (size < hugePageSize()) {
+        void *ptr = alignedMalloc(size, align);
+        if (ptr)
+          std::memset(ptr, 0, size);
+        return ptr;
+      }
+
+      const size_t mappedSize = roundToHugePages(size);
+      const auto &nodes       = tasking::detail::numaTopology();
+      const int numNodes      = int(nodes.size());
+
+      int nodeIndex = 0;
+      if (policy == NumaPolicy::LOCAL) {
+        const int id = node < 0 ? tasking::currentNumaNode() : node;
+        for (int i = 0; i < numNodes; ++i)
+          if (nodes[i].id == id)
+            nodeIndex = i;
+      }
+
+      void *ptr = nullptr;
+
+#ifdef _WIN32
+      HANDLE process = GetCurrentProcess();
+      if (policy == NumaPolicy::LOCAL && numNodes > 0) {
+        ptr = VirtualAllocExNuma(process,
+                                 nullptr,
+                                 mappedSize,
+                                 MEM_RESERVE | MEM_COMMIT,
+                                 PAGE_READWRITE,
+                                 nodes[nodeIndex].id);
+      } else if (policy == NumaPolicy::INTERLEAVED && numNodes > 1) {
+        // commit huge page sized slices round-robin over the nodes
+        ptr = VirtualAlloc(nullptr, mappedSize, MEM_RESERVE, PAGE_READWRITE);
+        const size_t slice = hugePageSize();
+        for (size_t offset = 0; ptr && offset < mappedSize; offset += slice) {
+          const DWORD id = nodes[(offset / slice) % numNodes].id;
+          if (!VirtualAllocExNuma(process,
+                                  static_cast<char *>(ptr) + offset,
+                                  slice,
+                                  MEM_COMMIT,
+                                  PAGE_READWRITE,
+                                  id)) {
+            VirtualFree(ptr, 0, MEM_RELEASE);
+            ptr = nullptr;
+          }
+        }
+      }
+      if (!ptr) {
+        ptr = VirtualAlloc(
+            nullptr, mappedSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+      }
+      if (!ptr)
+        return nullptr;
+#else
+      ptr = mmap(nullptr,
+                 mappedSize,
+                 PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS,
+                 -1,
+                 0);
+      if (ptr == MAP_FAILED)
+        return nullptr;
+#if defined(__linux__) && defined(SYS_mbind)
+      if (numNodes > 1 && policy == NumaPolicy::LOCAL)
+        bindToNodes(ptr, mappedSize, MBIND_PREFERRED, {nodes[nodeIndex].id});
+      else if (numNodes > 1 && policy == NumaPolicy::INTERLEAVED) {
+        std::vector<int> ids;
+        for (const auto &n : nodes)
+          ids.push_back(n.id);
+        bindToNodes(ptr, mappedSize, MBIND_INTERLEAVE, ids);
+      }
+#endif
+#endif
+
+      if (policy == NumaPolicy::FIRST_TOUCH_PARALLEL)
+        touchInParallel(ptr, mappedSize);
+
+      return ptr;
+    }
+
+    void numaAlignedFree(void *ptr, size_t size)
+    {
+      if (!ptr)
+        return;
+
+      if (size < hugePageSize()) {
+        alignedFree(ptr);
+        return;
+      }
+
+#ifdef _WIN32
+      VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+      munmap(ptr, roundToHugePages(size));
+#endif
+    }
+
+    // Device accessible memory ///////////////////////////////////////////////
+
+    /* stored in front of each deviceAlignedMalloc() allocation, with the
+       allocator it came from, so that it is freed through that allocator
+       also if another one has been set in between */
+    struct DeviceAllocation
+    {
+      void *base;
+      size_t size;
+      DeviceMemory kind;
+      DeviceAllocator allocator;
+    };
+
+    static std::mutex deviceAllocatorMutex;
+    static DeviceAllocator currentDeviceAllocator;
+
+    static DeviceAllocation *deviceAllocationOf(const void *ptr)
+    {
+      return reinterpret_cast<DeviceAllocation *>(
+                 const_cast<void *>(ptr))
+          - 1;
+    }
+
+    void setDeviceAllocator(const DeviceAllocator &allocator)
+    {
+      std::lock_guard<std::mutex> lock(deviceAllocatorMutex);
+      currentDeviceAllocator = allocator;
+    }
+
+    void *deviceAlignedMalloc(size_t size, DeviceMemory kind, size_t align)
+    {
+      DeviceAllocator allocator;
+      if (kind != DeviceMemory::PAGEABLE) {
+        std::lock_guard<std::mutex> lock(deviceAllocatorMutex);
+        allocator = currentDeviceAllocator;
+      }
+      if (!allocator.allocate || !allocator.free) {
+        allocator = DeviceAllocator();
+        kind      = DeviceMemory::PAGEABLE;
+      }
+
+      // the header takes a multiple of 'align' in front of the data
+      align = std::max(align, alignof(DeviceAllocation));
+      const size_t headerSize =
+          (sizeof(DeviceAllocation) + align - 1) / align * align;
+
+      const size_t allocatedSize = headerSize + size;
+      void *base = allocator.allocate
+          ? allocator.allocate(allocatedSize, align, kind, allocator.userData)
+          : alignedMalloc(allocatedSize, align);
+      if (!base)
+        return nullptr;
+
+      void *ptr = static_cast<char *>(base) + headerSize;
+      *deviceAllocationOf(ptr) =
+          DeviceAllocation{base, allocatedSize, kind, allocator};
+      return ptr;
+    }
+
+    void deviceAlignedFree(void *ptr)
+    {
+      if (!ptr)
+        return;
+
+      const DeviceAllocation a = *deviceAllocationOf(ptr);
+      if (a.allocator.free)
+        a.allocator.free(a.base, a.size, a.kind, a.allocator.userData);
+      else
+        alignedFree(a.base);
+    }
+
+    DeviceMemory deviceMemoryOf(const void *ptr)
+    {
+      return ptr ? deviceAllocationOf(ptr)->kind : DeviceMemory::PAGEABLE;
+    }
+
+    // Arena definitions ///////////////////////////////////////////////////////
+
+    Arena::Arena(size_t _blockSize, HugePages _hugePages)
+        : blockSize(_blockSize), hugePages(_hugePages)
+    {
+    }
+
+    Arena::~Arena()
+    {
+      release();
+    }
+
+    void *Arena::allocate(size_t size, size_t align)
+    {
+      assert((align & (align - 1)) == 0);
+
+      for (; current < blocks.size(); ++current, offset = 0) {
+        const Block &b = blocks[current];
+        const size_t begin =
+            ALIGN_PTR(b.data + offset, align) - size_t(b.data);
+        if (begin + size <= b.size) {
+          offset = begin + size;
+          used += size;
+          return b.data + begin;
+        }
+      }
+
+      // none of the blocks has room left, add one
+      Block b;
+      b.size = std::max(blockSize, size + align);
+      b.data = static_cast<char *>(hugePageMalloc(b.size, hugePages));
+      if (!b.data)
+        throw std::bad_alloc();
+      blocks.push_back(b);
+      current = blocks.size() - 1;
+      offset  = 0;
+      return allocate(size, align);
+    }
+
+    void Arena::reset()
+    {
+      current = 0;
+      offset  = 0;
+      used    = 0;
+    }
+
+    void Arena::release()
+    {
+      for (const Block &b : blocks)
+        hugePageFree(b.data, b.size, hugePages);
+      blocks.clear();
+      reset();
+    }
+
+    size_t Arena::bytesUsed() const
+    {
+      return used;
+    }
+
+    size_t Arena::bytesReserved() const
+    {
+      size_t total = 0;
+      for (const Block &b : blocks)
+        total += b.size;
+      return total;
+    }
+
   }  // namespace memory
 }  // namespace rkcommon
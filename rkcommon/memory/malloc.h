@@ -4,6 +4,14 @@
 #pragma once
 
 #include "../common.h"
+// std
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace rkcommon {
   namespace memory {
@@ -21,11 +29,460 @@ namespace rkcommon {
       return (T *)alignedMalloc(nElements * sizeof(T), align);
     }
 
+    // Allocation tracking //////////////////////////////////////////////////
+
+    /*! Counters of the memory allocated through alignedMalloc() under one
+        tag (see ScopedAllocationTag), "untagged" for everything else */
+    struct AllocationStats
+    {
+      const char *tag{nullptr};
+      size_t liveBytes{0};
+      size_t peakBytes{0};
+      size_t allocatedBytes{0};  // total over all allocations
+      uint64_t numAllocations{0};
+      uint64_t numFrees{0};
+    };
+
+    /*! Tracking is off by default. While it is on, alignedMalloc() records
+        the size and the current tag of every allocation, which costs a
+        lock per allocation and free; memory allocated while it was on is
+        still accounted when freed after turning it off. */
+    RKCOMMON_INTERFACE void setAllocationTracking(bool enabled);
+    RKCOMMON_INTERFACE bool allocationTrackingEnabled();
+
+    /*! Counters of all tags seen so far, see also
+        tracing::recordAllocationCounters() */
+    RKCOMMON_INTERFACE std::vector<AllocationStats> allocationStatistics();
+
+    /*! Attribute the tracked allocations made by this thread to 'tag' for
+        the lifetime of this object. Tags are told apart by pointer, so use
+        string literals or otherwise persistent strings. */
+    class RKCOMMON_INTERFACE ScopedAllocationTag
+    {
+     public:
+      explicit ScopedAllocationTag(const char *tag);
+      ~ScopedAllocationTag();
+
+      ScopedAllocationTag(const ScopedAllocationTag &) = delete;
+      ScopedAllocationTag &operator=(const ScopedAllocationTag &) = delete;
+
+     private:
+      const char *previous;
+    };
+
+    /*! how hugePageMalloc() backs allocations: ADVISED asks the OS to use
+        transparent huge pages for the range (madvise(MADV_HUGEPAGE) on
+        Linux), RESERVED maps it from the reserved huge page pool
+        (MAP_HUGETLB, MEM_LARGE_PAGES on Windows) and falls back to ADVISED
+        if that is exhausted or not permitted */
+    enum class HugePages
+    {
+      NONE,
+      ADVISED,
+      RESERVED
+    };
+
+    /*! page aligned allocation backed by huge pages where possible, to cut
+        TLB misses on large buffers; allocations below hugePageSize() use
+        alignedMalloc(). Memory has to be released with hugePageFree() and
+        the same size and mode. */
+    RKCOMMON_INTERFACE void *hugePageMalloc(
+        size_t size, HugePages mode = HugePages::ADVISED);
+    RKCOMMON_INTERFACE void hugePageFree(
+        void *ptr, size_t size, HugePages mode = HugePages::ADVISED);
+
+    /*! size of the huge pages used by hugePageMalloc() (2MB on x86) */
+    RKCOMMON_INTERFACE size_t hugePageSize();
+
+    /*! where numaAlignedMalloc() places the pages of an allocation: LOCAL
+        on a single node, INTERLEAVED round-robin over all nodes (for data
+        every thread reads), FIRST_TOUCH_PARALLEL faults the pages in from
+        a tasking::parallel_for() over the range, so that each worker's
+        share lands on its node and later parallel loops over the same
+        range mostly access local memory */
+    enum class NumaPolicy
+    {
+      LOCAL,
+      INTERLEAVED,
+      FIRST_TOUCH_PARALLEL
+    };
+
+    /*! page aligned allocation placed according to 'policy'; 'node' picks
+        the OS node for LOCAL, -1 for the caller's. The memory is zeroed,
+        'align' may be at most 4KB. Allocations below hugePageSize() use
+        alignedMalloc(). Memory has to be released with numaAlignedFree()
+        and the same size. Without OS support for placing pages, all
+        policies fall back to plain first touch. */
+    RKCOMMON_INTERFACE void *numaAlignedMalloc(
+        size_t size,
+        size_t align      = 64,
+        NumaPolicy policy = NumaPolicy::FIRST_TOUCH_PARALLEL,
+        int node          = -1);
+    RKCOMMON_INTERFACE void numaAlignedFree(void *ptr, size_t size);
+
+    /*! host memory a GPU can access: PAGEABLE is ordinary memory, which
+        uploads first copy to a pinned staging buffer; HOST_PINNED is page
+        locked host memory the device reads by DMA (e.g.
+        sycl::malloc_host(), cudaMallocHost()); SHARED migrates between
+        host and device on demand (sycl::malloc_shared(),
+        cudaMallocManaged()) */
+    enum class DeviceMemory
+    {
+      PAGEABLE,
+      HOST_PINNED,
+      SHARED
+    };
+
+    /*! Callbacks deviceAlignedMalloc() allocates through, so that rkcommon
+        does not depend on any GPU runtime: the application sets them up
+        with the runtime and context it uploads with. allocate() returns
+        memory of 'kind' aligned to 'align', or nullptr; free() gets back
+        what allocate() returned. */
+    struct DeviceAllocator
+    {
+      void *(*allocate)(size_t size,
+                        size_t align,
+                        DeviceMemory kind,
+                        void *userData){nullptr};
+      void (*free)(void *ptr,
+                   size_t size,
+                   DeviceMemory kind,
+                   void *userData){nullptr};
+      void *userData{nullptr};
+    };
+
+    /*! used by all later deviceAlignedMalloc() calls; a DeviceAllocator()
+        without callbacks turns device memory off again. Memory is always
+        released through the allocator it came from. */
+    RKCOMMON_INTERFACE void setDeviceAllocator(
+        const DeviceAllocator &allocator);
+
+    /*! aligned allocation of 'kind' from the device allocator; PAGEABLE,
+        or any kind while no device allocator is set, is alignedMalloc()
+        memory. Memory has to be released with deviceAlignedFree(). */
+    RKCOMMON_INTERFACE void *deviceAlignedMalloc(
+        size_t size,
+        DeviceMemory kind = DeviceMemory::HOST_PINNED,
+        size_t align      = 64);
+    RKCOMMON_INTERFACE void deviceAlignedFree(void *ptr);
+
+    /*! the kind of memory deviceAlignedMalloc() returned 'ptr' as */
+    RKCOMMON_INTERFACE DeviceMemory deviceMemoryOf(const void *ptr);
+
+    /*! Bump allocator for transient data, e.g. everything built for one
+        frame: allocate() carves aligned ranges out of large blocks and
+        reset() rewinds them all at once, keeping the blocks for the next
+        frame, so steady state frames do not touch the global heap.
+        Individual allocations are never freed and no destructors are run.
+        Not thread-safe, use one Arena per thread. */
+    class RKCOMMON_INTERFACE Arena
+    {
+     public:
+      explicit Arena(size_t blockSize = size_t(1) << 20,
+                     HugePages hugePages  = HugePages::NONE);
+      ~Arena();
+
+      Arena(const Arena &) = delete;
+      Arena &operator=(const Arena &) = delete;
+
+      void *allocate(size_t size, size_t align = 64);
+
+      template <typename T>
+      T *allocate(size_t nElements, size_t align = 64);
+
+      // Make all memory available again, keeping the blocks
+      void reset();
+
+      // Return all blocks to the system
+      void release();
+
+      size_t bytesUsed() const;
+      size_t bytesReserved() const;
+
+     private:
+      struct Block
+      {
+        char *data;
+        size_t size;
+      };
+
+      std::vector<Block> blocks;
+      size_t current{0};  // block allocate() bumps into
+      size_t offset{0};   // within the current block
+      size_t used{0};
+      size_t blockSize;
+      HugePages hugePages;
+    };
+
+    /*! STL allocator handing out memory from an Arena, e.g. for
+        std::vector<T, ArenaAllocator<T>> (the per-frame counterpart of
+        containers::AlignedVector) or containers::FlatMap<>. Deallocation is
+        a no-op, the memory comes back with Arena::reset(). */
+    template <typename T, size_t ALIGNMENT = 64>
+    struct ArenaAllocator
+    {
+      using value_type = T;
+
+      template <typename U>
+      struct rebind
+      {
+        using other = ArenaAllocator<U, ALIGNMENT>;
+      };
+
+      explicit ArenaAllocator(Arena &arena) : arena(&arena) {}
+
+      template <typename U>
+      ArenaAllocator(const ArenaAllocator<U, ALIGNMENT> &other)
+          : arena(other.arena)
+      {
+      }
+
+      T *allocate(size_t n)
+      {
+        return arena->allocate<T>(
+            n, ALIGNMENT > alignof(T) ? ALIGNMENT : alignof(T));
+      }
+
+      void deallocate(T *, size_t) {}
+
+      template <typename U>
+      bool operator==(const ArenaAllocator<U, ALIGNMENT> &other) const
+      {
+        return arena == other.arena;
+      }
+
+      template <typename U>
+      bool operator!=(const ArenaAllocator<U, ALIGNMENT> &other) const
+      {
+        return arena != other.arena;
+      }
+
+      Arena *arena;
+    };
+
+    /*! Pool of fixed size slots for objects of type T which are allocated
+        and released one at a time. Every thread allocates from its own free
+        list without synchronization; a slot released by another thread is
+        pushed onto a lock-free return list of the owning thread, which
+        takes it back when its own free list runs empty. Slots are carved
+        from blocks of 'slotsPerBlock' which are only returned to the system
+        when the pool is destroyed. */
+    template <typename T>
+    class FixedPool
+    {
+     public:
+      explicit FixedPool(size_t slotsPerBlock = 256);
+      ~FixedPool();
+
+      FixedPool(const FixedPool &) = delete;
+      FixedPool &operator=(const FixedPool &) = delete;
+
+      // Uninitialized storage for one T
+      T *allocate();
+
+      // Return storage from allocate(), from any thread
+      void deallocate(T *ptr);
+
+      template <typename... Args>
+      T *create(Args &&... args);
+
+      void destroy(T *ptr);
+
+     private:
+      struct ThreadCache;
+
+      struct Slot
+      {
+        ThreadCache *owner;
+        Slot *next;
+        alignas(T) unsigned char storage[sizeof(T)];
+      };
+
+      struct alignas(64) ThreadCache
+      {
+        std::thread::id thread;
+        ThreadCache *next{nullptr};
+        Slot *freeList{nullptr};
+        std::vector<Slot *> blocks;
+
+        // slots released by other threads
+        alignas(64) std::atomic<Slot *> returned{nullptr};
+      };
+
+      ThreadCache &cacheForThisThread();
+
+      static Slot *slotOf(T *ptr);
+
+      // Data members //
+
+      const size_t slotsPerBlock;
+
+      // lock-free list of all thread caches, only ever grows
+      std::atomic<ThreadCache *> caches{nullptr};
+
+      // tells a thread's cached pointer apart from one of a destroyed pool
+      // which lived at the same address
+      const uint64_t id{nextId()};
+
+      static uint64_t nextId();
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    template <typename T>
+    inline T *Arena::allocate(size_t nElements, size_t align)
+    {
+      return static_cast<T *>(allocate(nElements * sizeof(T), align));
+    }
+
+    template <typename T>
+    inline FixedPool<T>::FixedPool(size_t _slotsPerBlock)
+        : slotsPerBlock(_slotsPerBlock > 0 ? _slotsPerBlock : 1)
+    {
+    }
+
+    template <typename T>
+    inline FixedPool<T>::~FixedPool()
+    {
+      ThreadCache *c = caches.load();
+      while (c) {
+        ThreadCache *next = c->next;
+        for (Slot *block : c->blocks)
+          alignedFree(block);
+        c->~ThreadCache();
+        alignedFree(c);
+        c = next;
+      }
+    }
+
+    template <typename T>
+    inline uint64_t FixedPool<T>::nextId()
+    {
+      static std::atomic<uint64_t> counter{0};
+      return ++counter;
+    }
+
+    template <typename T>
+    inline typename FixedPool<T>::ThreadCache &
+    FixedPool<T>::cacheForThisThread()
+    {
+      // threads usually allocate from the same pool over and over
+      struct Cache
+      {
+        uint64_t id{0};
+        ThreadCache *cache{nullptr};
+      };
+      static thread_local Cache last;
+
+      if (last.id == id)
+        return *last.cache;
+
+      const std::thread::id self = std::this_thread::get_id();
+
+      ThreadCache *c = caches.load(std::memory_order_acquire);
+      for (; c; c = c->next) {
+        if (c->thread == self)
+          break;
+      }
+
+      if (!c) {
+        // C++11 'new' does not align the caches to cache lines
+        c = new (alignedMalloc(sizeof(ThreadCache), alignof(ThreadCache)))
+            ThreadCache;
+        c->thread = self;
+        c->next   = caches.load(std::memory_order_relaxed);
+        while (!caches.compare_exchange_weak(
+            c->next, c, std::memory_order_release, std::memory_order_relaxed))
+          ;
+      }
+
+      last.id    = id;
+      last.cache = c;
+      return *c;
+    }
+
+    template <typename T>
+    inline typename FixedPool<T>::Slot *FixedPool<T>::slotOf(T *ptr)
+    {
+      return reinterpret_cast<Slot *>(reinterpret_cast<unsigned char *>(ptr)
+                                      - offsetof(Slot, storage));
+    }
+
+    template <typename T>
+    inline T *FixedPool<T>::allocate()
+    {
+      ThreadCache &c = cacheForThisThread();
+
+      if (!c.freeList)
+        c.freeList = c.returned.exchange(nullptr, std::memory_order_acquire);
+
+      if (!c.freeList) {
+        Slot *block = alignedMalloc<Slot>(
+            slotsPerBlock, alignof(Slot) > 64 ? alignof(Slot) : 64);
+        if (!block)
+          throw std::bad_alloc();
+        c.blocks.push_back(block);
+        for (size_t i = 0; i < slotsPerBlock; ++i) {
+          block[i].owner = &c;
+          block[i].next  = i + 1 < slotsPerBlock ? &block[i + 1] : nullptr;
+        }
+        c.freeList = block;
+      }
+
+      Slot *s    = c.freeList;
+      c.freeList = s->next;
+      return reinterpret_cast<T *>(s->storage);
+    }
+
+    template <typename T>
+    inline void FixedPool<T>::deallocate(T *ptr)
+    {
+      if (!ptr)
+        return;
+
+      Slot *s            = slotOf(ptr);
+      ThreadCache *owner = s->owner;
+
+      if (owner == &cacheForThisThread()) {
+        s->next         = owner->freeList;
+        owner->freeList = s;
+      } else {
+        s->next = owner->returned.load(std::memory_order_relaxed);
+        while (!owner->returned.compare_exchange_weak(
+            s->next, s, std::memory_order_release, std::memory_order_relaxed))
+          ;
+      }
+    }
+
+    template <typename T>
+    template <typename... Args>
+    inline T *FixedPool<T>::create(Args &&... args)
+    {
+      T *ptr = allocate();
+      try {
+        return new (ptr) T(std::forward<Args>(args)...);
+      } catch (...) {
+        deallocate(ptr);
+        throw;
+      }
+    }
+
+    template <typename T>
+    inline void FixedPool<T>::destroy(T *ptr)
+    {
+      if (!ptr)
+        return;
+      ptr->~T();
+      deallocate(ptr);
+    }
+
     inline bool isAligned(void *ptr, int alignment = 64)
     {
       return reinterpret_cast<size_t>(ptr) % alignment == 0;
     }
 
+    // NOTE: STACK_BUFFER overflows the stack on large sizes, prefer a
+    //       ScratchScope (see ScratchBuffer.h)
     // NOTE(jda) - can't use function wrapped alloca solution as Clang won't
     //             inline  a function containing alloca()...but works w/ gcc+icc
 #if 0
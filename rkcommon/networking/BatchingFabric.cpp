@@ -0,0 +1,180 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "BatchingFabric.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace rkcommon {
+  namespace networking {
+
+    BatchingPolicy BatchingPolicy::interactive()
+    {
+      return BatchingPolicy();
+    }
+
+    BatchingPolicy BatchingPolicy::throughput()
+    {
+      BatchingPolicy policy;
+      policy.maxBatchBytes    = 1024 * 1024;
+      policy.maxBatchMessages = 64 * 1024;
+      policy.maxDelay         = std::chrono::milliseconds(10);
+      return policy;
+    }
+
+    BatchingFabric::BatchingFabric(std::shared_ptr<Fabric> fabric,
+                                   const BatchingPolicy &policy)
+        : fabric(std::move(fabric)), currentPolicy(policy)
+    {
+    }
+
+    void BatchingFabric::setPolicy(const BatchingPolicy &policy)
+    {
+      currentPolicy = policy;
+    }
+
+    const BatchingPolicy &BatchingFabric::policy() const
+    {
+      return currentPolicy;
+    }
+
+    void BatchingFabric::flush()
+    {
+      for (auto &b : outgoing) {
+        if (b.second.count > 0)
+          sendBatch(b.first, b.second);
+      }
+    }
+
+    void BatchingFabric::poll()
+    {
+      const auto now = Clock::now();
+      for (auto &b : outgoing) {
+        if (b.second.count > 0
+            && now - b.second.started >= currentPolicy.maxDelay)
+          sendBatch(b.first, b.second);
+      }
+    }
+
+    void BatchingFabric::sendBcast(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf)
+    {
+      append(bcastRank, buf);
+    }
+
+    void BatchingFabric::flushBcastSends()
+    {
+      flush();
+      fabric->flushBcastSends();
+    }
+
+    static void copyMessage(const utility::AbstractArray<uint8_t> &message,
+                            utility::AbstractArray<uint8_t> &buf)
+    {
+      if (message.size() != buf.size()) {
+        throw std::runtime_error(
+            "BatchingFabric: the message size does not match the buffer");
+      }
+      if (message.size() > 0)
+        std::memcpy(buf.data(), message.data(), message.size());
+    }
+
+    void BatchingFabric::recvBcast(utility::AbstractArray<uint8_t> &buf)
+    {
+      copyMessage(*recvBcastShared(), buf);
+    }
+
+    void BatchingFabric::send(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf, int rank)
+    {
+      if (rank < 0)
+        throw std::runtime_error("BatchingFabric::send: invalid rank");
+      append(rank, buf);
+    }
+
+    void BatchingFabric::recv(utility::AbstractArray<uint8_t> &buf, int rank)
+    {
+      copyMessage(*recvShared(rank), buf);
+    }
+
+    std::shared_ptr<utility::AbstractArray<uint8_t>>
+    BatchingFabric::recvShared(int rank)
+    {
+      if (rank < 0)
+        throw std::runtime_error("BatchingFabric::recv: invalid rank");
+      flush();
+      return next(rank);
+    }
+
+    std::shared_ptr<utility::AbstractArray<uint8_t>>
+    BatchingFabric::recvBcastShared()
+    {
+      flush();
+      return next(bcastRank);
+    }
+
+    void BatchingFabric::append(
+        int rank, const std::shared_ptr<utility::AbstractArray<uint8_t>> &buf)
+    {
+      Batch &batch = outgoing[rank];
+      if (!batch.messages)
+        batch.messages.reset(new IOVecWriter());
+      if (batch.count == 0)
+        batch.started = Clock::now();
+
+      const size_t before = batch.messages->position();
+      writeVarint(*batch.messages, buf->size());
+      batch.messages->writeShared(buf->data(), buf->size(), buf);
+      batch.bytes += batch.messages->position() - before;
+      batch.count++;
+
+      if (batch.bytes >= currentPolicy.maxBatchBytes
+          || batch.count >= currentPolicy.maxBatchMessages)
+        sendBatch(rank, batch);
+      poll();
+    }
+
+    void BatchingFabric::sendBatch(int rank, Batch &batch)
+    {
+      auto header         = bufferPool().acquire(sizeof(uint64_t));
+      const uint64_t size = batch.bytes;
+      std::memcpy(header->data(), &size, sizeof(size));
+
+      if (rank == bcastRank) {
+        fabric->sendBcast(header);
+        fabric->sendBcast(batch.messages->coalesce());
+      } else {
+        fabric->send(header, rank);
+        fabric->sendSegments(*batch.messages, rank);
+      }
+
+      batch.messages.reset(new IOVecWriter());
+      batch.count = 0;
+      batch.bytes = 0;
+    }
+
+    std::shared_ptr<utility::AbstractArray<uint8_t>> BatchingFabric::next(
+        int rank)
+    {
+      std::unique_ptr<BufferReader> &reader = incoming[rank];
+      if (!reader || reader->end()) {
+        uint64_t size = 0;
+        utility::ArrayView<uint8_t> header((uint8_t *)&size, sizeof(size));
+        std::shared_ptr<utility::AbstractArray<uint8_t>> batch;
+        if (rank == bcastRank) {
+          fabric->recvBcast(header);
+          batch = fabric->recvBcastPooled(size_t(size));
+        } else {
+          fabric->recv(header, rank);
+          batch = fabric->recvPooled(size_t(size), rank);
+        }
+        reader.reset(new BufferReader(batch));
+      }
+
+      const size_t size = size_t(readVarint(*reader));
+      return reader->view<uint8_t>(size);
+    }
+
+  }  // namespace networking
+}  // namespace rkcommon
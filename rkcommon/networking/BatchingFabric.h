@@ -0,0 +1,103 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include "DataStreaming.h"
+#include "Fabric.h"
+
+namespace rkcommon {
+  namespace networking {
+
+    /*! when BatchingFabric sends a batch */
+    struct RKCOMMON_INTERFACE BatchingPolicy
+    {
+      size_t maxBatchBytes    = 16 * 1024;
+      size_t maxBatchMessages = 1024;
+      std::chrono::microseconds maxDelay{200};
+
+      // small batches sent soon, for per-frame parameter updates
+      static BatchingPolicy interactive();
+
+      // large batches, for bulk transfers where latency matters less
+      static BatchingPolicy throughput();
+    };
+
+    /*! Fabric decorator coalescing the messages sent to each rank (and the
+      broadcasts) into batches, which go over 'fabric' as two messages: the
+      size of the batch, then its messages, each framed by its size as a
+      varint. Messages of at least 4 KiB are referenced rather than copied
+      into the batch, on fabrics which gather segments.
+
+      Nothing runs in the background: a batch is sent once it holds
+      'maxBatchBytes' or 'maxBatchMessages', when a later call finds it
+      older than 'maxDelay', and on flush(). recv() and recvBcast() flush
+      all batches first, so a rank waiting for a reply has sent its
+      request. Both sides of the fabric have to batch. */
+    struct RKCOMMON_INTERFACE BatchingFabric : public Fabric
+    {
+      explicit BatchingFabric(std::shared_ptr<Fabric> fabric,
+                              const BatchingPolicy &policy = BatchingPolicy());
+
+      /*! does not send what is still batched, call flush() first */
+      ~BatchingFabric() override = default;
+
+      void setPolicy(const BatchingPolicy &policy);
+      const BatchingPolicy &policy() const;
+
+      /*! send all batches */
+      void flush();
+
+      /*! send the batches older than 'maxDelay' */
+      void poll();
+
+      void sendBcast(
+          std::shared_ptr<utility::AbstractArray<uint8_t>> buf) override;
+
+      /*! flush() and flush the broadcasts of 'fabric' */
+      void flushBcastSends() override;
+
+      void recvBcast(utility::AbstractArray<uint8_t> &buf) override;
+
+      void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+                int rank) override;
+
+      /*! checks that 'buf' has the size of the message */
+      void recv(utility::AbstractArray<uint8_t> &buf, int rank) override;
+
+      /*! @{ the next message from 'rank' (or the next broadcast) whatever
+        its size, in place in the batch it came with */
+      std::shared_ptr<utility::AbstractArray<uint8_t>> recvShared(int rank);
+      std::shared_ptr<utility::AbstractArray<uint8_t>> recvBcastShared();
+      /*! @} */
+
+     private:
+      using Clock = std::chrono::steady_clock;
+
+      struct Batch
+      {
+        std::unique_ptr<IOVecWriter> messages;
+        size_t count{0};
+        size_t bytes{0};
+        Clock::time_point started;
+      };
+
+      // a broadcast batch for rank -1
+      void append(int rank,
+                  const std::shared_ptr<utility::AbstractArray<uint8_t>> &buf);
+      void sendBatch(int rank, Batch &batch);
+      std::shared_ptr<utility::AbstractArray<uint8_t>> next(int rank);
+
+      static const int bcastRank = -1;
+
+      std::shared_ptr<Fabric> fabric;
+      BatchingPolicy currentPolicy;
+
+      std::map<int, Batch> outgoing;
+      std::map<int, std::unique_ptr<BufferReader>> incoming;
+    };
+
+  }  // namespace networking
+}  // namespace rkcommon
@@ -0,0 +1,238 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "BufferPool.h"
+#include "../tracing/Tracing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rkcommon {
+  namespace networking {
+
+    using array_t = utility::OwnedArray<uint8_t>;
+
+    // the smallest size class, 256 bytes
+    static constexpr int MIN_CLASS_SHIFT = 8;
+
+    // the classes above the requested one a buffer may be taken from
+    static constexpr int MAX_CLASS_STEPS = 2;
+
+    // the class of the buffers with at least 'capacity' bytes
+    static int classAbove(size_t capacity)
+    {
+      int c = 0;
+      while ((size_t(1) << (c + MIN_CLASS_SHIFT)) < capacity)
+        c++;
+      return c;
+    }
+
+    // the class a buffer of 'capacity' bytes goes back to
+    static int classBelow(size_t capacity)
+    {
+      int c = 0;
+      while ((size_t(2) << (c + MIN_CLASS_SHIFT)) <= capacity)
+        c++;
+      return c;
+    }
+
+    static size_t classBytes(int c)
+    {
+      return size_t(1) << (c + MIN_CLASS_SHIFT);
+    }
+
+    struct BufferPool::State
+    {
+      struct SizeClass
+      {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<array_t>> free;
+      };
+
+      State(size_t maxRetainedBytes, size_t maxBufferSize);
+
+      std::unique_ptr<array_t> take(size_t capacity);
+      void give(std::unique_ptr<array_t> array);
+
+      const size_t maxRetainedBytes;
+      const size_t maxBufferSize;
+      std::vector<SizeClass> classes;
+
+      std::atomic<size_t> retainedBytes{0};
+      std::atomic<size_t> acquires{0};
+      std::atomic<size_t> hits{0};
+    };
+
+    // gives the buffers back to their pool, if it still exists
+    struct BufferPool::Recycler
+    {
+      std::weak_ptr<State> pool;
+
+      void operator()(array_t *array) const
+      {
+        std::unique_ptr<array_t> owned(array);
+        auto state = pool.lock();
+        if (state)
+          state->give(std::move(owned));
+      }
+    };
+
+    BufferPool::State::State(size_t _maxRetainedBytes, size_t _maxBufferSize)
+        : maxRetainedBytes(_maxRetainedBytes),
+          maxBufferSize(_maxBufferSize),
+          classes(_maxBufferSize < classBytes(0)
+                      ? 0
+                      : classBelow(_maxBufferSize) + 1)
+    {
+    }
+
+    std::unique_ptr<array_t> BufferPool::State::take(size_t capacity)
+    {
+      acquires.fetch_add(1, std::memory_order_relaxed);
+
+      // too large for the classes below 'maxBufferSize'
+      const int c = capacity > maxBufferSize ? -1 : classAbove(capacity);
+      if (c < 0 || c >= int(classes.size())) {
+        std::unique_ptr<array_t> array(new array_t);
+        array->reserve(capacity);
+        return array;
+      }
+
+      // buffers grown past their class (e.g. by a BufferWriter) are taken
+      // for smaller ones too, wasting at most 3/4 of them
+      const int last = std::min(c + MAX_CLASS_STEPS, int(classes.size()) - 1);
+      for (int k = c; k <= last; k++) {
+        SizeClass &sc = classes[k];
+        std::lock_guard<std::mutex> lock(sc.mutex);
+        if (!sc.free.empty()) {
+          std::unique_ptr<array_t> array = std::move(sc.free.back());
+          sc.free.pop_back();
+          retainedBytes.fetch_sub(array->capacity());
+          hits.fetch_add(1, std::memory_order_relaxed);
+          return array;
+        }
+      }
+
+      std::unique_ptr<array_t> array(new array_t);
+      array->reserve(classBytes(c));
+      return array;
+    }
+
+    void BufferPool::State::give(std::unique_ptr<array_t> array)
+    {
+      const size_t capacity = array->capacity();
+      if (capacity < classBytes(0) || capacity > maxBufferSize)
+        return;
+
+      if (retainedBytes.fetch_add(capacity) + capacity > maxRetainedBytes) {
+        retainedBytes.fetch_sub(capacity);
+        return;
+      }
+
+      array->resize(0);
+      SizeClass &sc = classes[classBelow(capacity)];
+      std::lock_guard<std::mutex> lock(sc.mutex);
+      sc.free.push_back(std::move(array));
+    }
+
+    // BufferPool definitions /////////////////////////////////////////////////
+
+    BufferPool::BufferPool(size_t maxRetainedBytes, size_t maxBufferSize)
+        : state(std::make_shared<State>(maxRetainedBytes, maxBufferSize))
+    {
+    }
+
+    BufferPool::~BufferPool() = default;
+
+    std::shared_ptr<utility::AbstractArray<uint8_t>> BufferPool::acquire(
+        size_t size)
+    {
+      auto array = acquireGrowable(size);
+      array->resize(size);
+      return array;
+    }
+
+    std::shared_ptr<utility::FixedArray<uint8_t>> BufferPool::acquireFixed(
+        size_t size)
+    {
+      if (size == 0)
+        return std::make_shared<utility::FixedArray<uint8_t>>();
+
+      auto array = acquireGrowable(size);
+      array->resize(size);
+      // the FixedArray shares the ownership of the pooled array
+      std::shared_ptr<uint8_t> memory(array, array->data());
+      return std::make_shared<utility::FixedArray<uint8_t>>(memory, size);
+    }
+
+    std::shared_ptr<utility::OwnedArray<uint8_t>> BufferPool::acquireGrowable(
+        size_t capacity)
+    {
+      return std::shared_ptr<array_t>(state->take(capacity).release(),
+                                      Recycler{state});
+    }
+
+    void BufferPool::trim()
+    {
+      for (auto &sc : state->classes) {
+        std::vector<std::unique_ptr<array_t>> freed;
+        {
+          std::lock_guard<std::mutex> lock(sc.mutex);
+          freed.swap(sc.free);
+          for (const auto &array : freed)
+            state->retainedBytes.fetch_sub(array->capacity());
+        }
+      }
+    }
+
+    size_t BufferPool::maxRetainedBytes() const
+    {
+      return state->maxRetainedBytes;
+    }
+
+    size_t BufferPool::maxBufferSize() const
+    {
+      return state->maxBufferSize;
+    }
+
+    BufferPoolStats BufferPool::stats() const
+    {
+      BufferPoolStats s;
+      s.acquires = state->acquires.load(std::memory_order_relaxed);
+      s.hits     = state->hits.load(std::memory_order_relaxed);
+      for (auto &sc : state->classes) {
+        std::lock_guard<std::mutex> lock(sc.mutex);
+        s.retainedBuffers += sc.free.size();
+        for (const auto &array : sc.free)
+          s.retainedBytes += array->capacity();
+      }
+      return s;
+    }
+
+    void BufferPool::traceStatistics(const char *name) const
+    {
+#ifdef RKCOMMON_ENABLE_PROFILING
+      const BufferPoolStats s  = stats();
+      const std::string prefix = std::string(name) + ".";
+      tracing::setCounter((prefix + "acquires").c_str(), s.acquires);
+      tracing::setCounter((prefix + "hits").c_str(), s.hits);
+      tracing::setCounter((prefix + "retainedBuffers").c_str(),
+                          s.retainedBuffers);
+      tracing::setCounter((prefix + "retainedBytes").c_str(), s.retainedBytes);
+#else
+      (void)name;
+#endif
+    }
+
+    std::shared_ptr<BufferPool> defaultBufferPool()
+    {
+      // buffers outliving it at exit are freed by their last user
+      static std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>();
+      return pool;
+    }
+
+  }  // namespace networking
+}  // namespace rkcommon
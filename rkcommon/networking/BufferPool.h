@@ -0,0 +1,80 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+#include "../utility/AbstractArray.h"
+#include "../utility/FixedArray.h"
+#include "../utility/OwnedArray.h"
+
+#include <memory>
+
+namespace rkcommon {
+  namespace networking {
+
+    struct BufferPoolStats
+    {
+      size_t acquires{0};
+      // acquires served by a buffer of the pool
+      size_t hits{0};
+      // the buffers kept for reuse
+      size_t retainedBuffers{0};
+      size_t retainedBytes{0};
+    };
+
+    /*! Recycles the byte buffers of messages. Buffers are handed out as
+      shared pointers which give the memory back to the pool when their
+      last reference drops (or free it, once the pool is gone), so they can
+      be passed to Fabric::send() and kept by readers like any other array.
+
+      The buffers are kept in power of two size classes, from 256 bytes
+      to 'maxBufferSize', and a request is served from its class or the
+      two above it; larger ones are allocated and freed as usual, as are
+      buffers which would take the retained memory over
+      'maxRetainedBytes'. All members are thread-safe. */
+    struct RKCOMMON_INTERFACE BufferPool
+    {
+      explicit BufferPool(size_t maxRetainedBytes = size_t(256) << 20,
+                          size_t maxBufferSize    = size_t(64) << 20);
+      ~BufferPool();
+
+      BufferPool(const BufferPool &) = delete;
+      BufferPool &operator=(const BufferPool &) = delete;
+
+      /*! 'size' uninitialized bytes */
+      std::shared_ptr<utility::AbstractArray<uint8_t>> acquire(size_t size);
+
+      /*! acquire(), as the array type of FixedBufferWriter */
+      std::shared_ptr<utility::FixedArray<uint8_t>> acquireFixed(size_t size);
+
+      /*! an empty array with room for at least 'capacity' bytes, e.g. for a
+        BufferWriter; it goes back to the pool with the capacity it has
+        grown to */
+      std::shared_ptr<utility::OwnedArray<uint8_t>> acquireGrowable(
+          size_t capacity = 0);
+
+      /*! frees the retained buffers */
+      void trim();
+
+      size_t maxRetainedBytes() const;
+      size_t maxBufferSize() const;
+
+      BufferPoolStats stats() const;
+
+      /*! records stats() as the tracing counters "<name>.acquires",
+        "<name>.hits", "<name>.retainedBuffers" and "<name>.retainedBytes";
+        a no-op unless RKCOMMON_ENABLE_PROFILING is defined */
+      void traceStatistics(const char *name) const;
+
+     private:
+      struct State;
+      struct Recycler;
+      std::shared_ptr<State> state;
+    };
+
+    /*! the pool of fabrics and writers not given another one */
+    RKCOMMON_INTERFACE std::shared_ptr<BufferPool> defaultBufferPool();
+
+  }  // namespace networking
+}  // namespace rkcommon
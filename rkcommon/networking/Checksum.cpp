@@ -0,0 +1,385 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Checksum.h"
+#include "../math/dispatch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if !defined(RKCOMMON_NO_SIMD) && defined(__SSE4_2__) && \
+    (defined(__x86_64__) || defined(_M_X64))
+#define RKCOMMON_CRC32C_SSE42
+#include <nmmintrin.h>
+#elif !defined(RKCOMMON_NO_SIMD) && defined(__ARM_FEATURE_CRC32) && \
+    defined(__aarch64__)
+#define RKCOMMON_CRC32C_ARMV8
+#include <arm_acle.h>
+#endif
+
+namespace rkcommon {
+  namespace networking {
+
+    namespace {
+
+      const uint32_t crc32cPolynomial = 0x82f63b78u;  // reflected
+
+      inline uint64_t read64(const uint8_t *p)
+      {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+      }
+
+#if defined(RKCOMMON_CRC32C_SSE42) || defined(RKCOMMON_CRC32C_ARMV8)
+#if defined(RKCOMMON_CRC32C_SSE42)
+      inline uint32_t crc32cWord(uint32_t crc, uint64_t v)
+      {
+        return uint32_t(_mm_crc32_u64(crc, v));
+      }
+
+      inline uint32_t crc32cByte(uint32_t crc, uint8_t v)
+      {
+        return _mm_crc32_u8(crc, v);
+      }
+#else
+      inline uint32_t crc32cWord(uint32_t crc, uint64_t v)
+      {
+        return __crc32cd(crc, v);
+      }
+
+      inline uint32_t crc32cByte(uint32_t crc, uint8_t v)
+      {
+        return __crc32cb(crc, v);
+      }
+#endif
+
+      /* The crc32 instruction takes 3 cycles, but a new one can start every
+         cycle: three independent streams over consecutive blocks run at
+         about 3x the speed of one. Their CRCs are combined by shifting the
+         earlier ones over the bytes of the later blocks, with tables of
+         that (linear) shift of the CRC register, as in zlib's
+         crc32_combine() */
+      const size_t longBlock  = 8192;
+      const size_t shortBlock = 256;
+
+      // 'vec' times the 32x32 bit matrix 'mat' over GF(2)
+      uint32_t gf2Times(const uint32_t *mat, uint32_t vec)
+      {
+        uint32_t sum = 0;
+        for (; vec; vec >>= 1, mat++) {
+          if (vec & 1)
+            sum ^= *mat;
+        }
+        return sum;
+      }
+
+      void gf2Square(uint32_t *square, const uint32_t *mat)
+      {
+        for (int n = 0; n < 32; n++)
+          square[n] = gf2Times(mat, mat[n]);
+      }
+
+      struct Crc32cShift
+      {
+        // table[k][b]: the register after 'bytes' zeros, from b << 8k
+        uint32_t table[4][256];
+
+        // 'bytes' has to be a power of two
+        explicit Crc32cShift(size_t bytes)
+        {
+          // the shift by one zero bit, then squared to 2^n bits
+          uint32_t op[32], squared[32];
+          op[0] = crc32cPolynomial;
+          for (int n = 1; n < 32; n++)
+            op[n] = 1u << (n - 1);
+          for (size_t bits = 1; bits < 8 * bytes; bits *= 2) {
+            gf2Square(squared, op);
+            std::memcpy(op, squared, sizeof(op));
+          }
+
+          for (uint32_t b = 0; b < 256; b++) {
+            for (int k = 0; k < 4; k++)
+              table[k][b] = gf2Times(op, b << (8 * k));
+          }
+        }
+
+        uint32_t operator()(uint32_t crc) const
+        {
+          return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^
+              table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+        }
+      };
+
+      // 'crc' over as many runs of 3 blocks as fit into 'size' bytes
+      template <size_t BLOCK>
+      inline uint32_t crc32cInterleaved(uint32_t crc,
+                                        const uint8_t *&p,
+                                        size_t &size,
+                                        const Crc32cShift &shift)
+      {
+        for (; size >= 3 * BLOCK; p += 3 * BLOCK, size -= 3 * BLOCK) {
+          uint32_t crc1 = 0, crc2 = 0;
+          for (size_t i = 0; i < BLOCK; i += 8) {
+            crc  = crc32cWord(crc, read64(p + i));
+            crc1 = crc32cWord(crc1, read64(p + BLOCK + i));
+            crc2 = crc32cWord(crc2, read64(p + 2 * BLOCK + i));
+          }
+          crc = shift(crc) ^ crc1;
+          crc = shift(crc) ^ crc2;
+        }
+        return crc;
+      }
+
+      uint32_t crc32cHardware(uint32_t crc, const uint8_t *p, size_t size)
+      {
+        static const Crc32cShift longShift(longBlock);
+        static const Crc32cShift shortShift(shortBlock);
+
+        crc = crc32cInterleaved<longBlock>(crc, p, size, longShift);
+        crc = crc32cInterleaved<shortBlock>(crc, p, size, shortShift);
+        for (; size >= 8; p += 8, size -= 8)
+          crc = crc32cWord(crc, read64(p));
+        for (; size > 0; p++, size--)
+          crc = crc32cByte(crc, *p);
+        return crc;
+      }
+#else
+      // slicing-by-8: table[k][b] is the CRC of byte b followed by k zeros
+      struct Crc32cTables
+      {
+        uint32_t table[8][256];
+
+        Crc32cTables()
+        {
+          for (uint32_t b = 0; b < 256; b++) {
+            uint32_t crc = b;
+            for (int bit = 0; bit < 8; bit++)
+              crc = (crc >> 1) ^ (crc32cPolynomial & (0u - (crc & 1)));
+            table[0][b] = crc;
+          }
+          for (int k = 1; k < 8; k++) {
+            for (uint32_t b = 0; b < 256; b++) {
+              const uint32_t prev = table[k - 1][b];
+              table[k][b]         = (prev >> 8) ^ table[0][prev & 0xff];
+            }
+          }
+        }
+      };
+
+      uint32_t crc32cTable(uint32_t crc, const uint8_t *p, size_t size)
+      {
+        static const Crc32cTables tables;
+        const uint32_t(*t)[256] = tables.table;
+        for (; size >= 8; p += 8, size -= 8) {
+          const uint64_t v  = read64(p) ^ crc;
+          const uint32_t lo = uint32_t(v);
+          const uint32_t hi = uint32_t(v >> 32);
+          crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+              t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^ t[3][hi & 0xff] ^
+              t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^
+              t[0][hi >> 24];
+        }
+        for (; size > 0; p++, size--)
+          crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+        return crc;
+      }
+#endif
+
+    }  // namespace
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      // 'crc' and the result are the CRC register, i.e. not inverted
+      uint32_t crc32cUpdate(uint32_t crc, const uint8_t *p, size_t size)
+      {
+#if defined(RKCOMMON_CRC32C_SSE42) || defined(RKCOMMON_CRC32C_ARMV8)
+        return crc32cHardware(crc, p, size);
+#else
+        return crc32cTable(crc, p, size);
+#endif
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // Checksum.h definitions //////////////////////////////////////////////////
+
+    using Crc32cUpdateFcn = uint32_t(uint32_t, const uint8_t *, size_t);
+
+    RKCOMMON_ISA_DECLARE(Crc32cUpdateFcn crc32cUpdate)
+
+    uint32_t crc32c(const void *data, size_t size, uint32_t crc)
+    {
+      static Crc32cUpdateFcn *const fcn =
+          RKCOMMON_ISA_SELECT(Crc32cUpdateFcn, crc32cUpdate);
+      return ~fcn(~crc, static_cast<const uint8_t *>(data), size);
+    }
+
+    namespace {
+
+      /* copy 'size' bytes from 'src' to 'dst' and return their checksum,
+         both in one pass over blocks that stay in cache */
+      uint32_t copyChecksummed(uint8_t *dst, const uint8_t *src, size_t size)
+      {
+        const size_t blockSize = 16 * 1024;
+        uint32_t crc           = 0;
+        for (size_t i = 0; i < size; i += blockSize) {
+          const size_t n = std::min(blockSize, size - i);
+          crc            = crc32c(src + i, n, crc);
+          std::memcpy(dst + i, src + i, n);
+        }
+        return crc;
+      }
+
+    }  // namespace
+
+    // ChecksummingWriteStream definitions ////////////////////////////////////
+
+    ChecksummingWriteStream::ChecksummingWriteStream(WriteStream &out)
+        : out(out)
+    {
+    }
+
+    void ChecksummingWriteStream::write(const void *mem, size_t size)
+    {
+      crc = crc32c(mem, size, crc);
+      out.write(mem, size);
+    }
+
+    void ChecksummingWriteStream::writeShared(
+        const void *mem, size_t size, const std::shared_ptr<const void> &owner)
+    {
+      crc = crc32c(mem, size, crc);
+      out.writeShared(mem, size, owner);
+    }
+
+    size_t ChecksummingWriteStream::position() const
+    {
+      return out.position();
+    }
+
+    void ChecksummingWriteStream::flush()
+    {
+      out.flush();
+    }
+
+    uint32_t ChecksummingWriteStream::checksum() const
+    {
+      return crc;
+    }
+
+    void ChecksummingWriteStream::writeChecksum()
+    {
+      out << crc;
+      crc = 0;
+    }
+
+    // ChecksummingReadStream definitions /////////////////////////////////////
+
+    ChecksummingReadStream::ChecksummingReadStream(ReadStream &in) : in(in) {}
+
+    void ChecksummingReadStream::read(void *mem, size_t size)
+    {
+      if (mem) {
+        in.read(mem, size);
+        crc = crc32c(mem, size, crc);
+        return;
+      }
+
+      // skipped bytes (e.g. the padding of writeAligned()) count as well
+      uint8_t skipped[4096];
+      while (size > 0) {
+        const size_t n = std::min(size, sizeof(skipped));
+        in.read(skipped, n);
+        crc = crc32c(skipped, n, crc);
+        size -= n;
+      }
+    }
+
+    bool ChecksummingReadStream::end()
+    {
+      return in.end();
+    }
+
+    uint32_t ChecksummingReadStream::checksum() const
+    {
+      return crc;
+    }
+
+    void ChecksummingReadStream::verifyChecksum()
+    {
+      uint32_t expected;
+      in >> expected;
+      const uint32_t actual = crc;
+      crc                   = 0;
+      if (actual != expected)
+        throw std::runtime_error("ChecksummingReadStream: checksum mismatch");
+    }
+
+    // ChecksummingFabric definitions /////////////////////////////////////////
+
+    ChecksummingFabric::ChecksummingFabric(std::shared_ptr<Fabric> fabric)
+        : fabric(std::move(fabric))
+    {
+    }
+
+    void ChecksummingFabric::sendBcast(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf)
+    {
+      const size_t size = buf->size();
+      auto message      = bufferPool().acquire(size + sizeof(uint32_t));
+      const uint32_t crc =
+          copyChecksummed(message->data(), buf->data(), size);
+      std::memcpy(message->data() + size, &crc, sizeof(crc));
+      fabric->sendBcast(message);
+    }
+
+    void ChecksummingFabric::flushBcastSends()
+    {
+      fabric->flushBcastSends();
+    }
+
+    void ChecksummingFabric::recvBcast(utility::AbstractArray<uint8_t> &buf)
+    {
+      const size_t size = buf.size();
+      auto message = fabric->recvBcastPooled(size + sizeof(uint32_t));
+      uint32_t expected;
+      std::memcpy(&expected, message->data() + size, sizeof(expected));
+      if (copyChecksummed(buf.data(), message->data(), size) != expected) {
+        throw std::runtime_error(
+            "ChecksummingFabric: checksum mismatch in a broadcast");
+      }
+    }
+
+    void ChecksummingFabric::send(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf, int rank)
+    {
+      const uint32_t crc = crc32c(buf->data(), buf->size());
+      IOVecWriter message;
+      message.writeShared(buf->data(), buf->size(), buf);
+      message << crc;
+      fabric->sendSegments(message, rank);
+    }
+
+    void ChecksummingFabric::recv(utility::AbstractArray<uint8_t> &buf,
+                                  int rank)
+    {
+      const size_t size = buf.size();
+      auto message = fabric->recvPooled(size + sizeof(uint32_t), rank);
+      uint32_t expected;
+      std::memcpy(&expected, message->data() + size, sizeof(expected));
+      if (copyChecksummed(buf.data(), message->data(), size) != expected) {
+        throw std::runtime_error(
+            "ChecksummingFabric: checksum mismatch in a message from rank "
+            + std::to_string(rank));
+      }
+    }
+#endif
+
+  }  // namespace networking
+}  // namespace rkcommon
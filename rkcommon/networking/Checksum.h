@@ -0,0 +1,101 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "DataStreaming.h"
+#include "Fabric.h"
+
+namespace rkcommon {
+  namespace networking {
+
+    /*! CRC-32C (Castagnoli) of 'size' bytes, continuing from the checksum
+      'crc' of the bytes before them, so crc32c(b, nb, crc32c(a, na)) is
+      the checksum of a followed by b. Uses the crc32 instructions of SSE4.2
+      (picked at runtime, see math/dispatch.h) or ARMv8 where the build
+      targets them, a table otherwise */
+    RKCOMMON_INTERFACE uint32_t crc32c(const void *data,
+                                       size_t size,
+                                       uint32_t crc = 0);
+
+    /*! Write stream decorator passing everything to 'out' and computing its
+     * checksum on the way, while the bytes are in cache. writeChecksum()
+     * appends the checksum to 'out' as a 4 byte trailer, for a
+     * ChecksummingReadStream to verify.
+     */
+    struct RKCOMMON_INTERFACE ChecksummingWriteStream : public WriteStream
+    {
+      explicit ChecksummingWriteStream(WriteStream &out);
+
+      void write(const void *mem, size_t size) override;
+
+      void writeShared(const void *mem,
+                       size_t size,
+                       const std::shared_ptr<const void> &owner) override;
+
+      /*! the position in 'out', so writeAligned() aligns to it */
+      size_t position() const override;
+
+      void flush() override;
+
+      // The checksum of the bytes written since the last trailer
+      uint32_t checksum() const;
+
+      // Write the checksum to 'out' and start the next one
+      void writeChecksum();
+
+     private:
+      WriteStream &out;
+      uint32_t crc{0};
+    };
+
+    /*! Read stream decorator computing the checksum of what it reads from
+     * 'in', to be compared with the trailer of a ChecksummingWriteStream
+     */
+    struct RKCOMMON_INTERFACE ChecksummingReadStream : public ReadStream
+    {
+      explicit ChecksummingReadStream(ReadStream &in);
+
+      void read(void *mem, size_t size) override;
+
+      bool end() override;
+
+      // The checksum of the bytes read since the last trailer
+      uint32_t checksum() const;
+
+      /*! read the trailer from 'in' and start the next checksum; throws
+        if it does not match the bytes read */
+      void verifyChecksum();
+
+     private:
+      ReadStream &in;
+      uint32_t crc{0};
+    };
+
+    /*! Fabric decorator sending every message over 'fabric' with its
+      checksum as a 4 byte trailer, which receives verify in the pass that
+      copies the message to its destination, throwing on a mismatch. Sends
+      gather the message and trailer where 'fabric' can, broadcasts copy
+      them into one buffer. Both sides of the fabric have to use it. */
+    struct RKCOMMON_INTERFACE ChecksummingFabric : public Fabric
+    {
+      explicit ChecksummingFabric(std::shared_ptr<Fabric> fabric);
+
+      void sendBcast(
+          std::shared_ptr<utility::AbstractArray<uint8_t>> buf) override;
+
+      void flushBcastSends() override;
+
+      void recvBcast(utility::AbstractArray<uint8_t> &buf) override;
+
+      void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+                int rank) override;
+
+      void recv(utility::AbstractArray<uint8_t> &buf, int rank) override;
+
+     private:
+      std::shared_ptr<Fabric> fabric;
+    };
+
+  }  // namespace networking
+}  // namespace rkcommon
@@ -0,0 +1,528 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "CompressedStream.h"
+#include "../containers/BitVector.h"
+#include "../tasking/parallel_for.h"
+#include "../tasking/tasking_system_init.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace rkcommon {
+  namespace networking {
+
+    namespace {
+
+      // LZ4 block format ////////////////////////////////////////////////////
+
+      // the last 5 bytes are literals, and the last match starts at least
+      // 12 bytes before the end of the block
+      const size_t minMatch     = 4;
+      const size_t lastLiterals = 5;
+      const size_t mfLimit      = 12;
+      const size_t maxOffset    = 65535;
+      const int hashBits        = 16;
+
+      inline uint32_t read32(const uint8_t *p)
+      {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+      }
+
+      inline uint32_t hash(uint32_t v)
+      {
+        return (v * 2654435761u) >> (32 - hashBits);
+      }
+
+      // number of equal bytes at 'ref' and 'ip', not reading from 'limit' on
+      inline size_t matchLength(const uint8_t *ref,
+                                const uint8_t *ip,
+                                const uint8_t *limit)
+      {
+        const uint8_t *start = ip;
+        while (ip + 8 <= limit) {
+          uint64_t a, b;
+          std::memcpy(&a, ref, 8);
+          std::memcpy(&b, ip, 8);
+          if (a != b)
+            return size_t(ip - start) +
+                containers::detail::countTrailingZeros64(a ^ b) / 8;
+          ref += 8;
+          ip += 8;
+        }
+        while (ip < limit && *ref == *ip) {
+          ref++;
+          ip++;
+        }
+        return size_t(ip - start);
+      }
+
+      inline void writeLength(std::vector<uint8_t> &out, size_t length)
+      {
+        for (; length >= 255; length -= 255)
+          out.push_back(255);
+        out.push_back(uint8_t(length));
+      }
+
+      // literals followed by a match, or only literals if 'length' is 0
+      inline void writeSequence(std::vector<uint8_t> &out,
+                                const uint8_t *literals,
+                                size_t numLiterals,
+                                size_t offset,
+                                size_t length)
+      {
+        const size_t matchCode = length ? length - minMatch : 0;
+        out.push_back(uint8_t((std::min<size_t>(numLiterals, 15) << 4) |
+                              std::min<size_t>(matchCode, 15)));
+        if (numLiterals >= 15)
+          writeLength(out, numLiterals - 15);
+        out.insert(out.end(), literals, literals + numLiterals);
+
+        if (length) {
+          out.push_back(uint8_t(offset));
+          out.push_back(uint8_t(offset >> 8));
+          if (matchCode >= 15)
+            writeLength(out, matchCode - 15);
+        }
+      }
+
+      void compressLZ4(const uint8_t *src,
+                       size_t size,
+                       std::vector<uint8_t> &out,
+                       bool high)
+      {
+        out.clear();
+        out.reserve(size + size / 255 + 16);
+
+        const uint8_t *const end = src + size;
+        const uint8_t *anchor    = src;
+
+        if (size > mfLimit) {
+          const uint8_t *const matchLimit = end - lastLiterals;
+          std::vector<int32_t> head(size_t(1) << hashBits, -1);
+          // earlier positions of the same hash, when searching further
+          std::vector<int32_t> chain(high ? size : 0);
+          const int maxAttempts = high ? 64 : 1;
+
+          auto insert = [&](const uint8_t *p) {
+            const uint32_t h = hash(read32(p));
+            if (high)
+              chain[p - src] = head[h];
+            head[h] = int32_t(p - src);
+          };
+
+          const uint8_t *ip = src;
+          while (ip + mfLimit <= end) {
+            const uint32_t h  = hash(read32(ip));
+            int32_t candidate = head[h];
+            if (high)
+              chain[ip - src] = candidate;
+            head[h] = int32_t(ip - src);
+
+            const uint8_t *ref = nullptr;
+            size_t length      = 0;
+            for (int attempt = 0; attempt < maxAttempts && candidate >= 0;
+                 attempt++) {
+              const uint8_t *c = src + candidate;
+              if (size_t(ip - c) > maxOffset)
+                break;
+              if (read32(c) == read32(ip)) {
+                const size_t l = minMatch +
+                    matchLength(c + minMatch, ip + minMatch, matchLimit);
+                if (l > length) {
+                  length = l;
+                  ref    = c;
+                }
+              }
+              candidate = high ? chain[candidate] : -1;
+            }
+
+            if (length < minMatch) {
+              // skip faster through data that does not compress
+              ip += high ? 1 : 1 + (size_t(ip - anchor) >> 6);
+              continue;
+            }
+
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+              ip--;
+              ref--;
+              length++;
+            }
+
+            writeSequence(out,
+                          anchor,
+                          size_t(ip - anchor),
+                          size_t(ip - ref),
+                          length);
+
+            const uint8_t *next = ip + length;
+            if (high) {
+              for (const uint8_t *p = ip + 1; p < next && p + mfLimit <= end;
+                   p++)
+                insert(p);
+            } else if (next - 2 >= src && next - 2 + mfLimit <= end) {
+              insert(next - 2);
+            }
+            ip     = next;
+            anchor = ip;
+          }
+        }
+
+        writeSequence(out, anchor, size_t(end - anchor), 0, 0);
+      }
+
+      void decompressLZ4(const uint8_t *src,
+                         size_t srcSize,
+                         uint8_t *dst,
+                         size_t dstSize)
+      {
+        const uint8_t *ip         = src;
+        const uint8_t *const iend = src + srcSize;
+        uint8_t *op               = dst;
+        uint8_t *const oend       = dst + dstSize;
+
+        auto corrupt = []() {
+          throw std::runtime_error("CompressedReadStream: corrupt block");
+        };
+
+        auto readLength = [&](size_t length) {
+          if (length == 15) {
+            uint8_t b;
+            do {
+              if (ip >= iend)
+                corrupt();
+              b = *ip++;
+              length += b;
+            } while (b == 255);
+          }
+          return length;
+        };
+
+        while (true) {
+          if (ip >= iend)
+            corrupt();
+          const uint8_t token = *ip++;
+
+          const size_t numLiterals = readLength(token >> 4);
+          if (numLiterals > size_t(iend - ip) ||
+              numLiterals > size_t(oend - op))
+            corrupt();
+          std::memcpy(op, ip, numLiterals);
+          ip += numLiterals;
+          op += numLiterals;
+
+          if (ip == iend)
+            break;
+
+          if (iend - ip < 2)
+            corrupt();
+          const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+          ip += 2;
+          if (offset == 0 || offset > size_t(op - dst))
+            corrupt();
+
+          size_t length = readLength(token & 15) + minMatch;
+          if (length > size_t(oend - op))
+            corrupt();
+
+          const uint8_t *ref = op - offset;
+          if (offset >= length) {
+            std::memcpy(op, ref, length);
+            op += length;
+          } else {
+            // overlapping, repeats the last 'offset' bytes
+            while (length--)
+              *op++ = *ref++;
+          }
+        }
+
+        if (op != oend)
+          corrupt();
+      }
+
+      // Block frames ////////////////////////////////////////////////////////
+
+      // each block is its raw size, then the size of the payload with the
+      // top bit set if the payload is the raw bytes
+      const uint32_t storedFlag = 0x80000000u;
+
+      struct Frame
+      {
+        uint32_t rawSize;
+        uint32_t payload;
+
+        bool stored() const
+        {
+          return payload & storedFlag;
+        }
+
+        size_t payloadSize() const
+        {
+          return payload & ~storedFlag;
+        }
+      };
+
+    }  // namespace
+
+    // CompressedWriteStream //
+
+    CompressedWriteStream::CompressedWriteStream(WriteStream &out,
+                                                 StreamCompression compression,
+                                                 size_t blockSize,
+                                                 int parallelBlocks)
+        : out(out),
+          compression(compression),
+          blockSize(std::max(size_t(1024),
+                             std::min(blockSize, size_t(storedFlag - 1)))),
+          maxBlocks(size_t(
+              parallelBlocks > 0 ? parallelBlocks
+                                 : std::max(1, tasking::numTaskingThreads())))
+    {
+      pending.reserve(this->blockSize * maxBlocks);
+    }
+
+    void CompressedWriteStream::write(const void *mem, size_t size)
+    {
+      const uint8_t *bytes = (const uint8_t *)mem;
+      writtenRaw += size;
+      while (size > 0) {
+        const size_t n =
+            std::min(size, blockSize * maxBlocks - pending.size());
+        if (bytes) {
+          pending.insert(pending.end(), bytes, bytes + n);
+          bytes += n;
+        } else {
+          pending.resize(pending.size() + n, 0);
+        }
+        size -= n;
+        if (pending.size() == blockSize * maxBlocks)
+          compressBlocks();
+      }
+    }
+
+    size_t CompressedWriteStream::position() const
+    {
+      return writtenRaw;
+    }
+
+    void CompressedWriteStream::flush()
+    {
+      compressBlocks();
+      out.flush();
+    }
+
+    size_t CompressedWriteStream::rawSize() const
+    {
+      return writtenRaw;
+    }
+
+    size_t CompressedWriteStream::compressedSize() const
+    {
+      return writtenCompressed;
+    }
+
+    void CompressedWriteStream::compressBlocks()
+    {
+      const size_t numBlocks = (pending.size() + blockSize - 1) / blockSize;
+      if (compressed.size() < numBlocks)
+        compressed.resize(numBlocks);
+
+      const bool high = compression == StreamCompression::LZ4_HIGH;
+      tasking::parallel_for(numBlocks, [&](size_t i) {
+        const size_t begin = i * blockSize;
+        const size_t size  = std::min(blockSize, pending.size() - begin);
+        compressLZ4(pending.data() + begin, size, compressed[i], high);
+      });
+
+      for (size_t i = 0; i < numBlocks; i++) {
+        const size_t begin = i * blockSize;
+        const size_t size  = std::min(blockSize, pending.size() - begin);
+        const bool stored  = compressed[i].size() >= size;
+
+        Frame frame;
+        frame.rawSize = uint32_t(size);
+        frame.payload = stored ? uint32_t(size) | storedFlag
+                               : uint32_t(compressed[i].size());
+        out << frame.rawSize << frame.payload;
+        if (stored)
+          out.write(pending.data() + begin, size);
+        else
+          out.write(compressed[i].data(), compressed[i].size());
+        writtenCompressed += sizeof(Frame) + frame.payloadSize();
+      }
+
+      pending.clear();
+    }
+
+    // CompressedReadStream //
+
+    CompressedReadStream::CompressedReadStream(ReadStream &in) : in(in) {}
+
+    void CompressedReadStream::read(void *mem, size_t size)
+    {
+      uint8_t *bytes = (uint8_t *)mem;
+      while (size > 0) {
+        if (cursor == block.size())
+          readBlock();
+        const size_t n = std::min(size, block.size() - cursor);
+        if (bytes) {
+          std::memcpy(bytes, block.data() + cursor, n);
+          bytes += n;
+        }
+        cursor += n;
+        size -= n;
+      }
+    }
+
+    bool CompressedReadStream::end()
+    {
+      return cursor == block.size() && in.end();
+    }
+
+    void CompressedReadStream::readBlock()
+    {
+      Frame frame;
+      in >> frame.rawSize >> frame.payload;
+      if (frame.rawSize == 0 || frame.payloadSize() > frame.rawSize)
+        throw std::runtime_error("CompressedReadStream: corrupt block");
+
+      block.resize(frame.rawSize);
+      cursor = 0;
+      if (frame.stored()) {
+        in.read(block.data(), block.size());
+      } else {
+        packed.resize(frame.payloadSize());
+        in.read(packed.data(), packed.size());
+        decompressLZ4(packed.data(), packed.size(), block.data(), block.size());
+      }
+    }
+
+    // Buffers //
+
+    std::shared_ptr<utility::OwnedArray<uint8_t>> compressBuffer(
+        const utility::AbstractArray<uint8_t> &data,
+        StreamCompression compression)
+    {
+      BufferWriter writer;
+      CompressedWriteStream compressed(writer, compression);
+      compressed.write(data.data(), data.size());
+      compressed.flush();
+      return writer.buffer;
+    }
+
+    std::shared_ptr<utility::OwnedArray<uint8_t>> decompressBuffer(
+        const utility::AbstractArray<uint8_t> &data)
+    {
+      // find the frames first, to decode them in parallel
+      struct Block
+      {
+        Frame frame;
+        size_t in, out;
+      };
+      std::vector<Block> blocks;
+      size_t in = 0, out = 0;
+      while (in < data.size()) {
+        Block b;
+        if (data.size() - in < sizeof(Frame))
+          throw std::runtime_error("decompressBuffer: truncated buffer");
+        std::memcpy(&b.frame.rawSize, data.data() + in, 4);
+        std::memcpy(&b.frame.payload, data.data() + in + 4, 4);
+        b.in  = in + sizeof(Frame);
+        b.out = out;
+        if (b.frame.payloadSize() > data.size() - b.in)
+          throw std::runtime_error("decompressBuffer: truncated buffer");
+        in = b.in + b.frame.payloadSize();
+        out += b.frame.rawSize;
+        blocks.push_back(b);
+      }
+
+      auto result = defaultBufferPool()->acquireGrowable(out);
+      result->resize(out);
+      // errors are collected, as tasks must not throw
+      std::vector<uint8_t> corrupt(blocks.size(), 0);
+      tasking::parallel_for(blocks.size(), [&](size_t i) {
+        const Block &b = blocks[i];
+        if (b.frame.stored()) {
+          corrupt[i] = b.frame.payloadSize() != b.frame.rawSize;
+          if (!corrupt[i]) {
+            std::memcpy(
+                result->data() + b.out, data.data() + b.in, b.frame.rawSize);
+          }
+          return;
+        }
+        try {
+          decompressLZ4(data.data() + b.in,
+                        b.frame.payloadSize(),
+                        result->data() + b.out,
+                        b.frame.rawSize);
+        } catch (const std::exception &) {
+          corrupt[i] = 1;
+        }
+      });
+      if (std::find(corrupt.begin(), corrupt.end(), 1) != corrupt.end())
+        throw std::runtime_error("decompressBuffer: corrupt block");
+      return result;
+    }
+
+    // Fabrics //
+
+    static std::shared_ptr<utility::OwnedArray<uint8_t>> sizeMessage(
+        size_t size)
+    {
+      auto message     = std::make_shared<utility::OwnedArray<uint8_t>>();
+      const uint64_t s = size;
+      message->reset((uint8_t *)&s, sizeof(s));
+      return message;
+    }
+
+    static size_t messageSize(const utility::AbstractArray<uint8_t> &message)
+    {
+      uint64_t size;
+      std::memcpy(&size, message.data(), sizeof(size));
+      return size_t(size);
+    }
+
+    void sendCompressed(Fabric &fabric,
+                        const utility::AbstractArray<uint8_t> &data,
+                        int rank,
+                        StreamCompression compression)
+    {
+      auto compressed = compressBuffer(data, compression);
+      fabric.send(sizeMessage(compressed->size()), rank);
+      fabric.send(compressed, rank);
+    }
+
+    std::shared_ptr<utility::OwnedArray<uint8_t>> recvCompressed(
+        Fabric &fabric, int rank)
+    {
+      utility::OwnedArray<uint8_t> size;
+      size.resize(sizeof(uint64_t));
+      fabric.recv(size, rank);
+      auto compressed = fabric.recvPooled(messageSize(size), rank);
+      return decompressBuffer(*compressed);
+    }
+
+    void sendBcastCompressed(Fabric &fabric,
+                             const utility::AbstractArray<uint8_t> &data,
+                             StreamCompression compression)
+    {
+      auto compressed = compressBuffer(data, compression);
+      fabric.sendBcast(sizeMessage(compressed->size()));
+      fabric.sendBcast(compressed);
+    }
+
+    std::shared_ptr<utility::OwnedArray<uint8_t>> recvBcastCompressed(
+        Fabric &fabric)
+    {
+      utility::OwnedArray<uint8_t> size;
+      size.resize(sizeof(uint64_t));
+      fabric.recvBcast(size);
+      auto compressed = fabric.recvBcastPooled(messageSize(size));
+      return decompressBuffer(*compressed);
+    }
+
+  }  // namespace networking
+}  // namespace rkcommon
@@ -0,0 +1,118 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "DataStreaming.h"
+#include "Fabric.h"
+
+namespace rkcommon {
+  namespace networking {
+
+    /*! block codecs of CompressedWriteStream. Both write the LZ4 block
+      format and decode with the same (fast) decoder: LZ4 takes the first
+      match it finds, LZ4_HIGH searches up to 64 earlier positions for the
+      longest one, compressing 2-4x slower for a better ratio */
+    enum class StreamCompression
+    {
+      LZ4,
+      LZ4_HIGH
+    };
+
+    /*! Write stream decorator compressing everything written to it in blocks
+     * of 'blockSize' bytes. Up to 'parallelBlocks' blocks are buffered and
+     * compressed with tasking::parallel_for; 0 picks one per tasking
+     * thread. Blocks which do not compress are stored as they are.
+     *
+     * The compressed blocks go to 'out' whenever enough of them are full,
+     * and on flush(), which has to be called once everything is written (the
+     * destructor does not, as it could not report errors). The blocks are
+     * read back with a CompressedReadStream.
+     */
+    struct RKCOMMON_INTERFACE CompressedWriteStream : public WriteStream
+    {
+      explicit CompressedWriteStream(
+          WriteStream &out,
+          StreamCompression compression = StreamCompression::LZ4,
+          size_t blockSize              = 256 * 1024,
+          int parallelBlocks            = 0);
+
+      void write(const void *mem, size_t size) override;
+
+      size_t position() const override;
+
+      /*! compress and write the buffered bytes, then flush 'out' */
+      void flush() override;
+
+      // Number of bytes written to this stream
+      size_t rawSize() const;
+
+      // Number of bytes written to 'out' so far
+      size_t compressedSize() const;
+
+     private:
+      void compressBlocks();
+
+      WriteStream &out;
+      const StreamCompression compression;
+      const size_t blockSize;
+      const size_t maxBlocks;
+
+      std::vector<uint8_t> pending;  // raw bytes not compressed yet
+      std::vector<std::vector<uint8_t>> compressed;
+      size_t writtenRaw{0};
+      size_t writtenCompressed{0};
+    };
+
+    /*! Read stream decorator reading what a CompressedWriteStream wrote to
+     * the stream 'in'
+     */
+    struct RKCOMMON_INTERFACE CompressedReadStream : public ReadStream
+    {
+      explicit CompressedReadStream(ReadStream &in);
+
+      void read(void *mem, size_t size) override;
+
+      bool end() override;
+
+     private:
+      void readBlock();
+
+      ReadStream &in;
+      std::vector<uint8_t> block;
+      std::vector<uint8_t> packed;
+      size_t cursor{0};
+    };
+
+    /*! @{ compress 'data' into one buffer, or decompress such a buffer */
+    RKCOMMON_INTERFACE std::shared_ptr<utility::OwnedArray<uint8_t>>
+    compressBuffer(const utility::AbstractArray<uint8_t> &data,
+                   StreamCompression compression = StreamCompression::LZ4);
+
+    RKCOMMON_INTERFACE std::shared_ptr<utility::OwnedArray<uint8_t>>
+    decompressBuffer(const utility::AbstractArray<uint8_t> &data);
+    /*! @} */
+
+    /*! @{ send a buffer over a fabric compressed, as two messages: the
+      compressed size and the compressed bytes. The receiving side does not
+      need to know the size of the buffer. */
+    RKCOMMON_INTERFACE void sendCompressed(
+        Fabric &fabric,
+        const utility::AbstractArray<uint8_t> &data,
+        int rank,
+        StreamCompression compression = StreamCompression::LZ4);
+
+    RKCOMMON_INTERFACE std::shared_ptr<utility::OwnedArray<uint8_t>>
+    recvCompressed(Fabric &fabric, int rank);
+
+    RKCOMMON_INTERFACE void sendBcastCompressed(
+        Fabric &fabric,
+        const utility::AbstractArray<uint8_t> &data,
+        StreamCompression compression = StreamCompression::LZ4);
+
+    RKCOMMON_INTERFACE std::shared_ptr<utility::OwnedArray<uint8_t>>
+    recvBcastCompressed(Fabric &fabric);
+    /*! @} */
+
+  }  // namespace networking
+}  // namespace rkcommon
@@ -3,23 +3,76 @@
 
 #include "DataStreaming.h"
 #include "../common.h"
+#include "../utility/MappedArray.h"
 
+#include <algorithm>
 #include <vector>
+#ifndef _WIN32
+#include <limits.h>
+#include <sys/uio.h>
+#include <cerrno>
+#endif
 
 namespace rkcommon {
   namespace networking {
 
+    void WriteStream::writeShared(const void *mem,
+                                  size_t size,
+                                  const std::shared_ptr<const void> &)
+    {
+      write(mem, size);
+    }
+
+    size_t WriteStream::position() const
+    {
+      throw std::runtime_error(
+          "WriteStream::position: the stream does not count its bytes");
+    }
+
     BufferWriter::BufferWriter()
         : buffer(std::make_shared<utility::OwnedArray<uint8_t>>())
     {
     }
 
+    BufferWriter::BufferWriter(
+        const std::shared_ptr<utility::OwnedArray<uint8_t>> &pooled)
+        : buffer(pooled)
+    {
+      clear();
+    }
+
+    BufferWriter::BufferWriter(BufferPool &pool, size_t capacity)
+        : buffer(pool.acquireGrowable(capacity))
+    {
+    }
+
     void BufferWriter::write(const void *mem, size_t size)
     {
       const size_t bsize = buffer->size();
-      buffer->resize(buffer->size() + size, 0);
-      if (mem && size > 0)
+      if (bsize + size > buffer->capacity())
+        buffer->reserve(std::max(bsize + size, 2 * buffer->capacity()));
+      buffer->resize(bsize + size);
+      if (size == 0)
+        return;
+      if (mem)
         std::memcpy(buffer->begin() + bsize, mem, size);
+      else
+        std::memset(buffer->begin() + bsize, 0, size);
+    }
+
+    size_t BufferWriter::position() const
+    {
+      return buffer->size();
+    }
+
+    void BufferWriter::reserve(size_t size)
+    {
+      buffer->reserve(buffer->size() + size);
+    }
+
+    void BufferWriter::clear()
+    {
+      buffer->resize(0);
     }
 
     BufferReader::BufferReader(
@@ -28,6 +81,20 @@ namespace rkcommon {
     {
     }
 
+    static std::shared_ptr<utility::AbstractArray<uint8_t>> mapFile(
+        const std::string &fileName)
+    {
+      auto mapped = std::make_shared<utility::MappedArray<uint8_t>>(
+          fileName, utility::MapMode::COPY_ON_WRITE);
+      mapped->advise(utility::MapAccess::SEQUENTIAL);
+      return mapped;
+    }
+
+    BufferReader::BufferReader(const std::string &fileName)
+        : buffer(mapFile(fileName))
+    {
+    }
+
     void BufferReader::read(void *mem, size_t size)
     {
       if (cursor + size > buffer->size())
@@ -43,19 +110,140 @@ namespace rkcommon {
       return cursor >= buffer->size();
     }
 
+    IOVecWriter::IOVecWriter(size_t minSharedSize)
+        : minSharedSize(minSharedSize)
+    {
+    }
+
+    void IOVecWriter::write(const void *mem, size_t size)
+    {
+      if (size == 0)
+        return;
+
+      const size_t offset = copied.size();
+      copied.resize(offset + size, 0);
+      if (mem)
+        std::memcpy(copied.data() + offset, mem, size);
+
+      // consecutive copies form one segment
+      if (!pieces.empty() && !pieces.back().shared)
+        pieces.back().size += size;
+      else
+        pieces.push_back({nullptr, offset, size});
+    }
+
+    void IOVecWriter::writeShared(const void *mem,
+                                  size_t size,
+                                  const std::shared_ptr<const void> &owner)
+    {
+      if (size < minSharedSize || !mem) {
+        write(mem, size);
+        return;
+      }
+
+      pieces.push_back({mem, 0, size});
+      owners.push_back(owner);
+    }
+
+    std::vector<IOVecWriter::Segment> IOVecWriter::segments() const
+    {
+      std::vector<Segment> result;
+      result.reserve(pieces.size());
+      for (const Piece &p : pieces) {
+        result.push_back(
+            {p.shared ? p.shared : copied.data() + p.offset, p.size});
+      }
+      return result;
+    }
+
+    size_t IOVecWriter::size() const
+    {
+      size_t total = 0;
+      for (const Piece &p : pieces)
+        total += p.size;
+      return total;
+    }
+
+    size_t IOVecWriter::position() const
+    {
+      return size();
+    }
+
+    size_t IOVecWriter::copiedSize() const
+    {
+      return copied.size();
+    }
+
+    std::shared_ptr<utility::OwnedArray<uint8_t>> IOVecWriter::coalesce()
+        const
+    {
+      auto buffer = defaultBufferPool()->acquireGrowable(size());
+      buffer->resize_uninitialized(size());
+      uint8_t *out = buffer->begin();
+      for (const Segment &s : segments()) {
+        std::memcpy(out, s.data, s.size);
+        out += s.size;
+      }
+      return buffer;
+    }
+
+#ifndef _WIN32
+    void IOVecWriter::writeTo(int fd) const
+    {
+#ifdef IOV_MAX
+      const size_t maxIOV = IOV_MAX;
+#else
+      const size_t maxIOV = 1024;
+#endif
+      std::vector<iovec> iov;
+      for (const Segment &s : segments())
+        iov.push_back({const_cast<void *>(s.data), s.size});
+
+      size_t first = 0;
+      while (first < iov.size()) {
+        const size_t n        = std::min(maxIOV, iov.size() - first);
+        const ssize_t written = ::writev(fd, iov.data() + first, int(n));
+        if (written < 0) {
+          if (errno == EINTR)
+            continue;
+          throw std::runtime_error("IOVecWriter::writeTo: writev failed");
+        }
+
+        // skip what was written, resuming within a partial segment
+        size_t left = size_t(written);
+        while (first < iov.size() && left >= iov[first].iov_len)
+          left -= iov[first++].iov_len;
+        if (left > 0) {
+          iov[first].iov_base = (uint8_t *)iov[first].iov_base + left;
+          iov[first].iov_len -= left;
+        }
+      }
+    }
+#endif
+
     void WriteSizeCalculator::write(const void *, size_t size)
     {
       writtenSize += size;
     }
 
+    size_t WriteSizeCalculator::position() const
+    {
+      return writtenSize;
+    }
+
     FixedBufferWriter::FixedBufferWriter(size_t size)
         : buffer(std::make_shared<utility::FixedArray<uint8_t>>(size))
     {
     }
 
+    FixedBufferWriter::FixedBufferWriter(size_t size, BufferPool &pool)
+        : buffer(pool.acquireFixed(size))
+    {
+    }
+
     void FixedBufferWriter::write(const void *mem, size_t size)
     {
-      if (cursor + size >= buffer->size()) {
+      if (cursor + size > buffer->size()) {
         throw std::runtime_error(
             "FixedBufferWriter::write size exceeds buffer");
       }
@@ -64,9 +252,14 @@ namespace rkcommon {
       cursor += size;
     }
 
+    size_t FixedBufferWriter::position() const
+    {
+      return cursor;
+    }
+
     void *FixedBufferWriter::reserve(size_t size)
     {
-      if (cursor + size >= buffer->size()) {
+      if (cursor + size > buffer->size()) {
         throw std::runtime_error(
             "FixedBufferWriter::reserve size exceeds buffer");
       }
@@ -92,5 +285,28 @@ namespace rkcommon {
       return buffer->size();
     }
 
+    void writeVarint(WriteStream &buf, uint64_t value)
+    {
+      uint8_t bytes[10];
+      size_t n = 0;
+      for (; value >= 0x80; value >>= 7)
+        bytes[n++] = uint8_t(value | 0x80);
+      bytes[n++] = uint8_t(value);
+      buf.write(bytes, n);
+    }
+
+    uint64_t readVarint(ReadStream &buf)
+    {
+      uint64_t value = 0;
+      for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+        buf.read(&byte, 1);
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          return value;
+      }
+      throw std::runtime_error("readVarint: more than 10 bytes");
+    }
+
   }  // namespace networking
 }  // namespace rkcommon
@@ -9,7 +9,12 @@
 #include "../utility/FixedArray.h"
 #include "../utility/FixedArrayView.h"
 #include "../utility/OwnedArray.h"
+#include "BufferPool.h"
 
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 namespace rkcommon {
@@ -21,6 +26,18 @@ namespace rkcommon {
       virtual ~WriteStream() = default;
 
       virtual void write(const void *mem, size_t size) = 0;
+
+      /*! write memory owned by 'owner', which streams that can send it
+        later may keep a reference to instead of copying it. The default
+        copies, like write() */
+      virtual void writeShared(const void *mem,
+                               size_t size,
+                               const std::shared_ptr<const void> &owner);
+
+      /*! number of bytes written so far, which writeAligned() pads from.
+        Streams that do not count them throw */
+      virtual size_t position() const;
+
       virtual void flush() {}
     };
 
@@ -35,12 +52,43 @@ namespace rkcommon {
       virtual bool end() = 0;
     };
 
+    /*! Writes to a growing buffer. The capacity grows geometrically and the
+     * bytes are only written once, so many small writes cost amortized
+     * O(1) each.
+     */
     struct RKCOMMON_INTERFACE BufferWriter : WriteStream
     {
       BufferWriter();
 
+      /* Write into 'pooled', a buffer of a previous frame which has not
+       * been sent yet or has been sent already, keeping its capacity.
+       * Anything in it is discarded.
+       */
+      explicit BufferWriter(
+          const std::shared_ptr<utility::OwnedArray<uint8_t>> &pooled);
+
+      /* Write into a buffer of 'pool' with room for 'capacity' bytes, which
+       * goes back to the pool once it has been sent and dropped
+       */
+      explicit BufferWriter(BufferPool &pool, size_t capacity = 0);
+
       void write(const void *mem, size_t size) override;
 
+      size_t position() const override;
+
+      // Make room for 'size' more bytes without growing again
+      void reserve(size_t size);
+
+      // Discard the bytes written, keeping the capacity for the next frame
+      void clear();
+
+      /* Serialize with 'fcn(WriteStream &)' twice: first into a
+       * WriteSizeCalculator, then into this buffer reserved to the exact
+       * size, so the buffer never grows while writing
+       */
+      template <typename FCN_T>
+      void writeSized(FCN_T &&fcn);
+
       std::shared_ptr<utility::OwnedArray<uint8_t>> buffer;
     };
 
@@ -48,6 +96,11 @@ namespace rkcommon {
     {
       BufferReader(const std::shared_ptr<utility::AbstractArray<uint8_t>> &buf);
 
+      /* Read a file in place through a copy-on-write utility::MappedArray,
+       * pages are only loaded as the cursor reaches them
+       */
+      explicit BufferReader(const std::string &fileName);
+
       void read(void *mem, size_t size) override;
 
       /* Get a view of the buffer at the current cursor with the desired number of
@@ -58,12 +111,93 @@ namespace rkcommon {
       template <typename T>
       std::shared_ptr<utility::ArrayView<T>> getView(size_t count);
 
+      /* A view of the buffer, which keeps the buffer alive */
+      template <typename T>
+      struct View : public utility::ArrayView<T>
+      {
+        View(T *data,
+             size_t count,
+             const std::shared_ptr<utility::AbstractArray<uint8_t>> &owner);
+
+        const std::shared_ptr<utility::AbstractArray<uint8_t>> owner;
+      };
+
+      /* Like getView(), but the view keeps the buffer alive, so the array
+       * can be used in place (e.g. as the externalMem of an ActualArray3D)
+       * after the reader is gone. If the elements are not aligned for T in
+       * the buffer they are copied instead; writeAligned() pads the array
+       * so they are
+       */
+      template <typename T>
+      std::shared_ptr<utility::AbstractArray<T>> view(size_t count);
+
+      /* Read an array written by writeAligned() with view() */
+      template <typename T>
+      std::shared_ptr<utility::AbstractArray<T>> viewAligned();
+
       bool end() override;
 
       size_t cursor = 0;
       const std::shared_ptr<utility::AbstractArray<uint8_t>> buffer;
     };
 
+    /*! Scatter/gather write stream: small writes are copied into an internal
+     * buffer, but writeShared() data of at least 'minSharedSize' bytes is
+     * only referenced (and kept alive through its owner). The segments are
+     * sent as they are, e.g. with writev() or one MPI send each, so large
+     * arrays are never copied into a staging buffer. The bytes are the same
+     * as a BufferWriter would produce.
+     */
+    struct RKCOMMON_INTERFACE IOVecWriter : public WriteStream
+    {
+      struct Segment
+      {
+        const void *data;
+        size_t size;
+      };
+
+      explicit IOVecWriter(size_t minSharedSize = 4096);
+
+      void write(const void *mem, size_t size) override;
+
+      void writeShared(const void *mem,
+                       size_t size,
+                       const std::shared_ptr<const void> &owner) override;
+
+      size_t position() const override;
+
+      // The segments in order; valid until the next write
+      std::vector<Segment> segments() const;
+
+      // Total number of bytes written
+      size_t size() const;
+
+      // Number of bytes copied into the internal buffer
+      size_t copiedSize() const;
+
+      // All bytes in one buffer, for transports that cannot gather
+      std::shared_ptr<utility::OwnedArray<uint8_t>> coalesce() const;
+
+#ifndef _WIN32
+      // Write all segments to a file descriptor (socket, pipe, file) with
+      // writev(), resuming after partial writes
+      void writeTo(int fd) const;
+#endif
+
+     private:
+      struct Piece
+      {
+        const void *shared;  // nullptr for a range of 'copied'
+        size_t offset;
+        size_t size;
+      };
+
+      const size_t minSharedSize;
+      std::vector<uint8_t> copied;
+      std::vector<Piece> pieces;
+      std::vector<std::shared_ptr<const void>> owners;
+    };
+
     /*! Utility which behaves as a write stream, but just computes the number of
      * bytes which have been written to it
      */
@@ -71,6 +205,8 @@ namespace rkcommon {
     {
       void write(const void *mem, size_t size) override;
 
+      size_t position() const override;
+
       size_t writtenSize = 0;
     };
 
@@ -84,8 +220,13 @@ namespace rkcommon {
 
       FixedBufferWriter(size_t size);
 
+      // Write into a buffer of 'size' bytes from 'pool'
+      FixedBufferWriter(size_t size, BufferPool &pool);
+
       void write(const void *mem, size_t size) override;
 
+      size_t position() const override;
+
       // Reserve space in the buffer and return the pointer to the start of it
       void *reserve(size_t size);
 
@@ -102,6 +243,15 @@ namespace rkcommon {
       std::shared_ptr<utility::FixedArray<uint8_t>> buffer;
     };
 
+    template <typename FCN_T>
+    inline void BufferWriter::writeSized(FCN_T &&fcn)
+    {
+      WriteSizeCalculator calculator;
+      fcn(static_cast<WriteStream &>(calculator));
+      reserve(calculator.writtenSize);
+      fcn(static_cast<WriteStream &>(*this));
+    }
+
     /*! generic stream operators into/out of streams, for raw data blocks */
     template <typename T>
     inline WriteStream &operator<<(WriteStream &buf, const T &rh)
@@ -117,10 +267,24 @@ namespace rkcommon {
       return buf;
     }
 
+    namespace detail {
+
+      /*! vectors of these are streamed as one block; the bytes are the same
+       * as streaming them element by element with the generic operators */
+      template <typename T>
+      using is_bulk_streamable =
+          std::integral_constant<bool,
+                                 std::is_trivially_copyable<T>::value &&
+                                     !std::is_same<T, bool>::value>;
+
+    }  // namespace detail
+
     /*! @{ stream operators into/out of read/write streams, for std::vectors
      * of non-POD types*/
-    template <typename T>
-    inline WriteStream &operator<<(WriteStream &buf, const std::vector<T> &rh)
+    template <typename T, typename A>
+    inline typename std::enable_if<!detail::is_bulk_streamable<T>::value,
+                                   WriteStream &>::type
+    operator<<(WriteStream &buf, const std::vector<T, A> &rh)
     {
       const size_t sz = rh.size();
       buf << sz;
@@ -131,8 +295,10 @@ namespace rkcommon {
       return buf;
     }
 
-    template <typename T>
-    inline ReadStream &operator>>(ReadStream &buf, std::vector<T> &rh)
+    template <typename T, typename A>
+    inline typename std::enable_if<!detail::is_bulk_streamable<T>::value,
+                                   ReadStream &>::type
+    operator>>(ReadStream &buf, std::vector<T, A> &rh)
     {
       size_t sz;
       buf >> sz;
@@ -145,6 +311,36 @@ namespace rkcommon {
     }
     /*! @} */
 
+    /*! @{ stream operators for std::vectors of trivially copyable types: the
+     * size, then all elements in one write()/read(). With an allocator that
+     * does not value-initialize (containers::UninitVector), reading does not
+     * touch the elements before filling them */
+    template <typename T, typename A>
+    inline typename std::enable_if<detail::is_bulk_streamable<T>::value,
+                                   WriteStream &>::type
+    operator<<(WriteStream &buf, const std::vector<T, A> &rh)
+    {
+      const size_t sz = rh.size();
+      buf << sz;
+      if (sz > 0)
+        buf.write(rh.data(), sizeof(T) * sz);
+      return buf;
+    }
+
+    template <typename T, typename A>
+    inline typename std::enable_if<detail::is_bulk_streamable<T>::value,
+                                   ReadStream &>::type
+    operator>>(ReadStream &buf, std::vector<T, A> &rh)
+    {
+      size_t sz;
+      buf >> sz;
+      rh.resize(sz);
+      if (sz > 0)
+        buf.read(rh.data(), sizeof(T) * sz);
+      return buf;
+    }
+    /*! @} */
+
     /*! @{ stream operators into/out of read/write streams, for AbstractArray<T>
      */
     template <typename T>
@@ -156,8 +352,85 @@ namespace rkcommon {
       buf.write((const byte_t *)rh.data(), sizeof(T) * sz);
       return buf;
     }
+
+    /*! shared arrays are written like AbstractArray<T>, but through
+     * WriteStream::writeShared(), keeping a reference to the array where
+     * the stream can */
+    template <typename T>
+    inline WriteStream &operator<<(
+        WriteStream &buf, const std::shared_ptr<utility::AbstractArray<T>> &rh)
+    {
+      const size_t sz = rh->size();
+      buf << sz;
+      buf.writeShared(rh->data(), sizeof(T) * sz, rh);
+      return buf;
+    }
     /*! @} */
 
+    namespace detail {
+
+      /*! writes the size of an array and the padding after it, so the
+       * data following starts at a multiple of 'alignment' bytes into the
+       * stream */
+      inline void writeAlignedHeader(WriteStream &buf,
+                                     size_t size,
+                                     size_t alignment)
+      {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+          throw std::runtime_error("writeAligned: alignment must be 2^n");
+
+        const size_t dataBegin =
+            buf.position() + sizeof(size_t) + sizeof(uint32_t);
+        const uint32_t padding =
+            uint32_t((alignment - dataBegin % alignment) % alignment);
+        buf << size << padding;
+        const uint8_t zeros[256] = {};
+        for (uint32_t left = padding; left > 0;) {
+          const uint32_t n = std::min(left, uint32_t(sizeof(zeros)));
+          buf.write(zeros, n);
+          left -= n;
+        }
+      }
+
+    }  // namespace detail
+
+    /*! @{ write an array like operator<< does, followed by zero padding so
+     * its data starts at a multiple of 'alignment' bytes into the stream
+     * (and into a receiving buffer aligned as much). BufferReader reads it
+     * in place with viewAligned(), other streams with readAligned() */
+    template <typename T>
+    inline void writeAligned(WriteStream &buf,
+                             const utility::AbstractArray<T> &array,
+                             size_t alignment = 64)
+    {
+      detail::writeAlignedHeader(buf, array.size(), alignment);
+      buf.write(array.data(), sizeof(T) * array.size());
+    }
+
+    template <typename T>
+    inline void writeAligned(
+        WriteStream &buf,
+        const std::shared_ptr<utility::AbstractArray<T>> &array,
+        size_t alignment = 64)
+    {
+      detail::writeAlignedHeader(buf, array->size(), alignment);
+      buf.writeShared(array->data(), sizeof(T) * array->size(), array);
+    }
+    /*! @} */
+
+    /*! read an array written by writeAligned() from any stream */
+    template <typename T, typename A>
+    inline void readAligned(ReadStream &buf, std::vector<T, A> &array)
+    {
+      size_t size;
+      uint32_t padding;
+      buf >> size >> padding;
+      buf.read(nullptr, padding);
+      array.resize(size);
+      if (size > 0)
+        buf.read(array.data(), sizeof(T) * size);
+    }
+
     /*! @{ serialize operations for strings */
     inline WriteStream &operator<<(WriteStream &buf, const std::string &rh)
     {
@@ -183,6 +456,78 @@ namespace rkcommon {
       buf.read((void *)rh.data(), sz);
       return buf;
     }
+    /*! @} */
+
+    /*! @{ LEB128 variable length integers: 7 bits per byte, low bits first,
+      so values below 128 take one byte and size_t sizes rarely more than
+      four. Signed values are zig-zag mapped first (0, -1, 1, -2, ... to 0,
+      1, 2, 3, ...), which keeps small magnitudes of either sign short */
+    inline uint64_t zigZagEncode(int64_t v)
+    {
+      return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+    }
+
+    inline int64_t zigZagDecode(uint64_t v)
+    {
+      return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+
+    RKCOMMON_INTERFACE void writeVarint(WriteStream &buf, uint64_t value);
+
+    RKCOMMON_INTERFACE uint64_t readVarint(ReadStream &buf);
+
+    inline void writeSignedVarint(WriteStream &buf, int64_t value)
+    {
+      writeVarint(buf, zigZagEncode(value));
+    }
+
+    inline int64_t readSignedVarint(ReadStream &buf)
+    {
+      return zigZagDecode(readVarint(buf));
+    }
+    /*! @} */
+
+    /*! what writePacked() packs: the values, the differences between
+      consecutive values (for sorted IDs; unsorted arrays still round trip,
+      but cost 4 bytes per decrease), or the zig-zag mapped differences (for
+      index buffers, whose indices go back and forth) */
+    enum class PackedCoding
+    {
+      PLAIN,
+      DELTA,
+      SIGNED_DELTA
+    };
+
+    /*! @{ write uint32_t arrays in the StreamVByte layout: the count as a
+      varint, a control byte with the byte lengths of every 4 values, then
+      1-4 bytes per value. readPacked() decodes 4 values per byte shuffle
+      on CPUs with SSSE3, and the prefix sums of deltas with SIMD too */
+    RKCOMMON_INTERFACE void writePacked(
+        WriteStream &buf,
+        const uint32_t *values,
+        size_t count,
+        PackedCoding coding = PackedCoding::PLAIN);
+
+    inline void writePacked(WriteStream &buf,
+                            const utility::AbstractArray<uint32_t> &values,
+                            PackedCoding coding = PackedCoding::PLAIN)
+    {
+      writePacked(buf, values.data(), values.size(), coding);
+    }
+
+    template <typename A>
+    inline void writePacked(WriteStream &buf,
+                            const std::vector<uint32_t, A> &values,
+                            PackedCoding coding = PackedCoding::PLAIN)
+    {
+      writePacked(buf, values.data(), values.size(), coding);
+    }
+
+    /*! 'coding' has to be the one the array was written with */
+    RKCOMMON_INTERFACE void readPacked(
+        ReadStream &buf,
+        std::vector<uint32_t> &values,
+        PackedCoding coding = PackedCoding::PLAIN);
 
     template <typename T>
     std::shared_ptr<utility::ArrayView<T>> BufferReader::getView(size_t count)
@@ -193,10 +538,55 @@ namespace rkcommon {
         throw std::runtime_error("Attempt to read past end of BufferReader!");
       }
 
-      auto view = std::make_shared<utility::ArrayView<T>>(buffer->begin() + cursor, size);
+      auto view = std::make_shared<utility::ArrayView<T>>(
+          reinterpret_cast<T *>(buffer->begin() + cursor), count);
+      cursor += size;
+      return view;
+    }
+
+    template <typename T>
+    inline BufferReader::View<T>::View(
+        T *data,
+        size_t count,
+        const std::shared_ptr<utility::AbstractArray<uint8_t>> &owner)
+        : utility::ArrayView<T>(data, count), owner(owner)
+    {
+    }
+
+    template <typename T>
+    std::shared_ptr<utility::AbstractArray<T>> BufferReader::view(
+        size_t count)
+    {
+      const size_t size = count * sizeof(T);
+
+      if (cursor + size > buffer->size()) {
+        throw std::runtime_error("Attempt to read past end of BufferReader!");
+      }
+
+      uint8_t *data = buffer->begin() + cursor;
+      std::shared_ptr<utility::AbstractArray<T>> view;
+      if (uintptr_t(data) % alignof(T) == 0) {
+        view = std::make_shared<View<T>>(
+            reinterpret_cast<T *>(data), count, buffer);
+      } else {
+        auto copy = std::make_shared<utility::OwnedArray<T>>();
+        copy->resize(count);
+        std::memcpy(copy->data(), data, size);
+        view = copy;
+      }
       cursor += size;
       return view;
     }
 
+    template <typename T>
+    std::shared_ptr<utility::AbstractArray<T>> BufferReader::viewAligned()
+    {
+      size_t count;
+      uint32_t padding;
+      *this >> count >> padding;
+      read(nullptr, padding);
+      return view<T>(count);
+    }
+
   }  // namespace networking
 }  // namespace rkcommon
@@ -1,15 +1,154 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
 #include <memory>
+#include <stdexcept>
+#include <thread>
 #include "../common.h"
 #include "../utility/AbstractArray.h"
 #include "Fabric.h"
+#include "DataStreaming.h"
 
 namespace rkcommon {
   namespace networking {
-    Fabric::Fabric() {}
+    /*! the thread of the default recvAsync(), receiving into buffers of
+      the fabric's pool in the order the receives were posted */
+    struct Fabric::AsyncReceiver
+    {
+      using Buffer = std::shared_ptr<utility::AbstractArray<uint8_t>>;
+
+      struct Pending
+      {
+        size_t size;
+        int rank;  // -1 for a broadcast
+        tasking::Promise<Buffer> promise;
+      };
+
+      explicit AsyncReceiver(Fabric &fabric)
+          : fabric(fabric), thread(&AsyncReceiver::run, this)
+      {
+      }
+
+      ~AsyncReceiver()
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          stopping = true;
+        }
+        changed.notify_all();
+        thread.join();
+      }
+
+      tasking::Future<Buffer> post(size_t size, int rank)
+      {
+        Pending pending{size, rank, tasking::Promise<Buffer>()};
+        auto future = pending.promise.getFuture();
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          queue.push_back(std::move(pending));
+        }
+        changed.notify_all();
+        return future;
+      }
+
+      void run()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+          changed.wait(lock, [&]() { return stopping || !queue.empty(); });
+          if (stopping) {
+            // the derived fabric is destroyed already, fail what is left
+            for (auto &pending : queue) {
+              pending.promise.setException(std::make_exception_ptr(
+                  std::runtime_error("Fabric destroyed before the receive")));
+            }
+            return;
+          }
+          Pending pending = std::move(queue.front());
+          queue.pop_front();
+          lock.unlock();
+
+          try {
+            Buffer buf = fabric.bufferPool().acquire(pending.size);
+            if (pending.rank < 0)
+              fabric.recvBcast(*buf);
+            else
+              fabric.recv(*buf, pending.rank);
+            pending.promise.setValue(std::move(buf));
+          } catch (...) {
+            pending.promise.setException(std::current_exception());
+          }
+          lock.lock();
+        }
+      }
+
+      Fabric &fabric;
+      std::mutex mutex;
+      std::condition_variable changed;
+      std::deque<Pending> queue;
+      bool stopping{false};
+      std::thread thread;
+    };
+
+    Fabric::Fabric() : pool(defaultBufferPool()) {}
+
+    Fabric::~Fabric() = default;
+
+    void Fabric::sendSegments(const IOVecWriter &data, int rank)
+    {
+      send(data.coalesce(), rank);
+    }
+
+    std::shared_ptr<utility::AbstractArray<uint8_t>> Fabric::recvPooled(
+        size_t size, int rank)
+    {
+      auto buf = pool->acquire(size);
+      recv(*buf, rank);
+      return buf;
+    }
+
+    std::shared_ptr<utility::AbstractArray<uint8_t>> Fabric::recvBcastPooled(
+        size_t size)
+    {
+      auto buf = pool->acquire(size);
+      recvBcast(*buf);
+      return buf;
+    }
+
+    tasking::Future<std::shared_ptr<utility::AbstractArray<uint8_t>>>
+    Fabric::recvAsync(size_t size, int rank)
+    {
+      return asyncReceiver().post(size, rank);
+    }
+
+    tasking::Future<std::shared_ptr<utility::AbstractArray<uint8_t>>>
+    Fabric::recvBcastAsync(size_t size)
+    {
+      return asyncReceiver().post(size, -1);
+    }
+
+    Fabric::AsyncReceiver &Fabric::asyncReceiver()
+    {
+      std::call_once(receiverStarted, [&]() {
+        receiver = make_unique<AsyncReceiver>(*this);
+      });
+      return *receiver;
+    }
+
+    BufferPool &Fabric::bufferPool() const
+    {
+      return *pool;
+    }
+
+    void Fabric::setBufferPool(std::shared_ptr<BufferPool> _pool)
+    {
+      if (!_pool)
+        throw std::runtime_error("Fabric::setBufferPool: null pool");
+      pool = std::move(_pool);
+    }
   }
 }
 
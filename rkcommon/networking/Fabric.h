@@ -5,18 +5,23 @@
 
 #include <cstdlib>
 #include <memory>
+#include <mutex>
 #include "../common.h"
+#include "../tasking/Future.h"
 #include "../utility/AbstractArray.h"
+#include "BufferPool.h"
 
 namespace rkcommon {
   namespace networking {
 
+    struct IOVecWriter;
+
     /*! abstraction for a physical fabric that can transmit data -
       sockets, mpi, etc */
     struct RKCOMMON_INTERFACE Fabric
     {
       Fabric();
-      virtual ~Fabric() = default;
+      virtual ~Fabric();
 
       // Broadcast the data to all clients on the other end of the fabric
       // TODO: only makes sense to call on the root rank, so maybe a separate
@@ -37,6 +42,53 @@ namespace rkcommon {
 
       // Receive data from a specific rank on the fabric (callable on any rank)
       virtual void recv(utility::AbstractArray<uint8_t> &buf, int rank) = 0;
+
+      // Send the segments of 'data' to a specific rank as one message, which
+      // is received like a send() of the same bytes. Fabrics that can gather
+      // (writev/sendmsg, one MPI send per segment) should override this; the
+      // default coalesces the segments into one buffer for send()
+      virtual void sendSegments(const IOVecWriter &data, int rank);
+
+      /*! recv() of 'size' bytes into a buffer of bufferPool() */
+      std::shared_ptr<utility::AbstractArray<uint8_t>> recvPooled(size_t size,
+                                                                  int rank);
+
+      /*! recvBcast() of 'size' bytes into a buffer of bufferPool() */
+      std::shared_ptr<utility::AbstractArray<uint8_t>> recvBcastPooled(
+          size_t size);
+
+      /*! recv() of 'size' bytes from 'rank' into a buffer of
+        bufferPool(), without blocking: the future holds the buffer once the
+        message has arrived, and continuations chained with then() run as
+        tasks, so messages are handled while other work goes on instead of
+        on a thread waiting for each peer. The receives from a rank complete
+        in the order they were posted; while some are pending, the rank
+        must not be received from with recv(), and the fabric must not be
+        destroyed.
+
+        The default runs recv() on one thread per fabric, for the receives
+        of all ranks in the order they were posted. Fabrics which can wait
+        for several ranks at once override it. */
+      virtual tasking::Future<std::shared_ptr<utility::AbstractArray<uint8_t>>>
+      recvAsync(size_t size, int rank);
+
+      /*! recvAsync() of a broadcast */
+      virtual tasking::Future<std::shared_ptr<utility::AbstractArray<uint8_t>>>
+      recvBcastAsync(size_t size);
+
+      /*! the pool the fabric takes its message buffers from,
+        defaultBufferPool() unless set */
+      BufferPool &bufferPool() const;
+      void setBufferPool(std::shared_ptr<BufferPool> pool);
+
+     private:
+      struct AsyncReceiver;
+      AsyncReceiver &asyncReceiver();
+
+      std::shared_ptr<BufferPool> pool;
+
+      std::once_flag receiverStarted;
+      std::unique_ptr<AsyncReceiver> receiver;
     };
 
   }  // namespace networking
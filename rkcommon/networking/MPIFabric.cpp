@@ -0,0 +1,237 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "MPIFabric.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <string>
+
+namespace rkcommon {
+  namespace networking {
+
+    // point to point messages of the fabric, on its own communicator
+    static const int messageTag = 1;
+
+    static void checkMPI(int status, const char *call)
+    {
+      if (status != MPI_SUCCESS) {
+        char message[MPI_MAX_ERROR_STRING];
+        int length = 0;
+        MPI_Error_string(status, message, &length);
+        throw std::runtime_error(std::string("MPIFabric: ") + call
+                                 + " failed (" + std::string(message, length)
+                                 + ")");
+      }
+    }
+
+    static void waitAll(std::vector<MPI_Request> &requests)
+    {
+      if (!requests.empty()) {
+        checkMPI(MPI_Waitall(int(requests.size()),
+                             requests.data(),
+                             MPI_STATUSES_IGNORE),
+                 "MPI_Waitall");
+      }
+    }
+
+    struct MPIFabric::Handle::Pending
+    {
+      std::vector<MPI_Request> requests;
+      std::shared_ptr<utility::AbstractArray<uint8_t>> buffer;
+
+      bool test()
+      {
+        int done = 1;
+        if (!requests.empty()) {
+          checkMPI(MPI_Testall(int(requests.size()),
+                               requests.data(),
+                               &done,
+                               MPI_STATUSES_IGNORE),
+                   "MPI_Testall");
+        }
+        if (done)
+          release();
+        return done;
+      }
+
+      void wait()
+      {
+        waitAll(requests);
+        release();
+      }
+
+      void release()
+      {
+        requests.clear();
+        buffer.reset();
+      }
+    };
+
+    bool MPIFabric::Handle::test()
+    {
+      return !pending || pending->test();
+    }
+
+    void MPIFabric::Handle::wait()
+    {
+      if (pending)
+        pending->wait();
+    }
+
+    MPIFabric::MPIFabric(MPI_Comm comm, int bcastRoot, size_t chunkSize)
+        : bcastRoot(bcastRoot),
+          chunkSize(std::max(size_t(1), std::min(chunkSize, size_t(INT_MAX))))
+    {
+      checkMPI(MPI_Comm_dup(comm, &this->comm), "MPI_Comm_dup");
+      // report errors through checkMPI() instead of aborting
+      MPI_Comm_set_errhandler(this->comm, MPI_ERRORS_RETURN);
+      MPI_Comm_rank(this->comm, &myRank);
+      MPI_Comm_size(this->comm, &ranks);
+      if (bcastRoot < 0 || bcastRoot >= ranks)
+        throw std::runtime_error("MPIFabric: invalid broadcast root");
+    }
+
+    MPIFabric::~MPIFabric()
+    {
+      for (auto &pending : inFlight)
+        pending->wait();
+      MPI_Comm_free(&comm);
+    }
+
+    int MPIFabric::rank() const
+    {
+      return myRank;
+    }
+
+    int MPIFabric::numRanks() const
+    {
+      return ranks;
+    }
+
+    template <typename START_FCN>
+    MPIFabric::Handle MPIFabric::start(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+        START_FCN &&startChunk)
+    {
+      reapCompleted();
+
+      auto pending      = std::make_shared<Handle::Pending>();
+      pending->buffer   = std::move(buf);
+      uint8_t *data     = pending->buffer->begin();
+      const size_t size = pending->buffer->size();
+      for (size_t offset = 0; offset < size; offset += chunkSize) {
+        MPI_Request request;
+        startChunk(data + offset,
+                   int(std::min(chunkSize, size - offset)),
+                   &request);
+        pending->requests.push_back(request);
+      }
+
+      inFlight.push_back(pending);
+      Handle handle;
+      handle.pending = pending;
+      return handle;
+    }
+
+    void MPIFabric::reapCompleted()
+    {
+      auto done = [](const std::shared_ptr<Handle::Pending> &pending) {
+        return pending->test();
+      };
+      inFlight.erase(std::remove_if(inFlight.begin(), inFlight.end(), done),
+                     inFlight.end());
+    }
+
+    MPIFabric::Handle MPIFabric::isendBcast(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf)
+    {
+      if (myRank != bcastRoot)
+        throw std::runtime_error("MPIFabric: only the root broadcasts");
+
+      return start(std::move(buf),
+                   [&](uint8_t *chunk, int count, MPI_Request *request) {
+                     checkMPI(MPI_Ibcast(chunk,
+                                         count,
+                                         MPI_BYTE,
+                                         bcastRoot,
+                                         comm,
+                                         request),
+                              "MPI_Ibcast");
+                   });
+    }
+
+    MPIFabric::Handle MPIFabric::isend(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf, int rank)
+    {
+      return start(std::move(buf),
+                   [&](uint8_t *chunk, int count, MPI_Request *request) {
+                     checkMPI(MPI_Isend(chunk,
+                                        count,
+                                        MPI_BYTE,
+                                        rank,
+                                        messageTag,
+                                        comm,
+                                        request),
+                              "MPI_Isend");
+                   });
+    }
+
+    void MPIFabric::sendBcast(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf)
+    {
+      isendBcast(std::move(buf));
+    }
+
+    void MPIFabric::flushBcastSends()
+    {
+      for (auto &pending : inFlight)
+        pending->wait();
+      inFlight.clear();
+    }
+
+    void MPIFabric::recvBcast(utility::AbstractArray<uint8_t> &buf)
+    {
+      std::vector<MPI_Request> requests;
+      for (size_t offset = 0; offset < buf.size(); offset += chunkSize) {
+        MPI_Request request;
+        checkMPI(MPI_Ibcast(buf.begin() + offset,
+                            int(std::min(chunkSize, buf.size() - offset)),
+                            MPI_BYTE,
+                            bcastRoot,
+                            comm,
+                            &request),
+                 "MPI_Ibcast");
+        requests.push_back(request);
+      }
+      waitAll(requests);
+    }
+
+    void MPIFabric::send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+                         int rank)
+    {
+      isend(std::move(buf), rank);
+    }
+
+    void MPIFabric::recv(utility::AbstractArray<uint8_t> &buf, int rank)
+    {
+      // chunks between two ranks with one tag arrive in order
+      std::vector<MPI_Request> requests;
+      for (size_t offset = 0; offset < buf.size(); offset += chunkSize) {
+        MPI_Request request;
+        checkMPI(MPI_Irecv(buf.begin() + offset,
+                           int(std::min(chunkSize, buf.size() - offset)),
+                           MPI_BYTE,
+                           rank,
+                           messageTag,
+                           comm,
+                           &request),
+                 "MPI_Irecv");
+        requests.push_back(request);
+      }
+      waitAll(requests);
+    }
+
+  }  // namespace networking
+}  // namespace rkcommon
@@ -0,0 +1,106 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <mpi.h>
+#include <vector>
+#include "Fabric.h"
+
+#ifdef _WIN32
+#ifdef rkcommon_mpi_EXPORTS
+#define RKCOMMON_MPI_INTERFACE __declspec(dllexport)
+#else
+#define RKCOMMON_MPI_INTERFACE __declspec(dllimport)
+#endif
+#else
+#define RKCOMMON_MPI_INTERFACE
+#endif
+
+namespace rkcommon {
+  namespace networking {
+
+    /*! Fabric over an MPI communicator, built into the rkcommon_mpi library
+      (RKCOMMON_BUILD_MPI).
+
+      Sends are non-blocking: sendBcast() starts MPI_Ibcast and send()
+      MPI_Isend, holding a reference to the buffer until they complete, so
+      several sends are in flight at once. Messages are split into chunks
+      of at most 'chunkSize' bytes, which pipelines large broadcasts through
+      the MPI implementation's broadcast tree and keeps counts below the
+      2 GB limit of an int. flushBcastSends() is the synchronization point
+      that waits for all sends; receives block until their data is there.
+
+      As with MPI, messages have to be received with the size they were sent
+      with, and all ranks have to take part in broadcasts in the same order.
+      The fabric is not thread safe. */
+    struct RKCOMMON_MPI_INTERFACE MPIFabric : public Fabric
+    {
+      /*! completion of one non-blocking send */
+      struct RKCOMMON_MPI_INTERFACE Handle
+      {
+        Handle() = default;
+
+        /*! whether the send has completed, without blocking */
+        bool test();
+
+        /*! block until the send has completed */
+        void wait();
+
+       private:
+        friend struct MPIFabric;
+        struct Pending;
+        std::shared_ptr<Pending> pending;
+      };
+
+      /*! broadcasts come from 'bcastRoot' in 'comm', which is duplicated so
+        the fabric's messages do not mix with the caller's */
+      MPIFabric(MPI_Comm comm,
+                int bcastRoot    = 0,
+                size_t chunkSize = size_t(64) << 20);
+
+      /*! waits for the sends in flight */
+      ~MPIFabric() override;
+
+      int rank() const;
+      int numRanks() const;
+
+      /*! start a broadcast from the root; only on the root */
+      Handle isendBcast(std::shared_ptr<utility::AbstractArray<uint8_t>> buf);
+
+      /*! start a send to 'rank' */
+      Handle isend(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+                   int rank);
+
+      void sendBcast(
+          std::shared_ptr<utility::AbstractArray<uint8_t>> buf) override;
+
+      /*! wait until all sends (not only broadcasts) have completed */
+      void flushBcastSends() override;
+
+      void recvBcast(utility::AbstractArray<uint8_t> &buf) override;
+
+      void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+                int rank) override;
+
+      void recv(utility::AbstractArray<uint8_t> &buf, int rank) override;
+
+     private:
+      template <typename START_FCN>
+      Handle start(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+                   START_FCN &&startChunk);
+
+      // releases the buffers of completed sends
+      void reapCompleted();
+
+      MPI_Comm comm;
+      int myRank;
+      int ranks;
+      const int bcastRoot;
+      const size_t chunkSize;
+
+      std::vector<std::shared_ptr<Handle::Pending>> inFlight;
+    };
+
+  }  // namespace networking
+}  // namespace rkcommon
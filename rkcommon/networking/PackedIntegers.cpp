@@ -0,0 +1,257 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "DataStreaming.h"
+#include "../math/dispatch.h"
+
+#if defined(__SSSE3__) && !defined(RKCOMMON_NO_SIMD)
+#define RKCOMMON_PACKED_SSSE3
+#include <tmmintrin.h>
+#endif
+
+namespace rkcommon {
+  namespace networking {
+
+    namespace {
+
+      // the value packed for 'v' after 'prev', and back
+      template <PackedCoding CODING>
+      inline uint32_t toPacked(uint32_t v, uint32_t prev)
+      {
+        if (CODING == PackedCoding::PLAIN)
+          return v;
+        const uint32_t delta = v - prev;
+        if (CODING == PackedCoding::DELTA)
+          return delta;
+        return (delta << 1) ^ uint32_t(int32_t(delta) >> 31);
+      }
+
+      template <PackedCoding CODING>
+      inline uint32_t fromPacked(uint32_t p, uint32_t prev)
+      {
+        if (CODING == PackedCoding::PLAIN)
+          return p;
+        if (CODING == PackedCoding::DELTA)
+          return prev + p;
+        return prev + ((p >> 1) ^ (0u - (p & 1)));
+      }
+
+#ifdef RKCOMMON_PACKED_SSSE3
+      /* pshufb masks moving the 1-4 bytes of 4 values to their 32-bit
+         lanes, zeroing the others, and the total length of the values,
+         for every control byte */
+      struct ShuffleTable
+      {
+        ShuffleTable()
+        {
+          for (int c = 0; c < 256; c++) {
+            uint8_t offset = 0;
+            for (int lane = 0; lane < 4; lane++) {
+              const int length = ((c >> (2 * lane)) & 3) + 1;
+              for (int b = 0; b < 4; b++) {
+                mask[c][4 * lane + b] =
+                    b < length ? uint8_t(offset + b) : uint8_t(0x80);
+              }
+              offset += uint8_t(length);
+            }
+            this->length[c] = offset;
+          }
+        }
+
+        uint8_t mask[256][16];
+        uint8_t length[256];
+      };
+
+      const ShuffleTable &shuffleTable()
+      {
+        static const ShuffleTable table;
+        return table;
+      }
+
+      template <PackedCoding CODING>
+      inline __m128i fromPacked(__m128i p, __m128i prev)
+      {
+        if (CODING == PackedCoding::PLAIN)
+          return p;
+        if (CODING == PackedCoding::SIGNED_DELTA) {
+          const __m128i sign =
+              _mm_sub_epi32(_mm_setzero_si128(),
+                            _mm_and_si128(p, _mm_set1_epi32(1)));
+          p = _mm_xor_si128(_mm_srli_epi32(p, 1), sign);
+        }
+        // prefix sum of the 4 deltas, plus the last value before them
+        p = _mm_add_epi32(p, _mm_slli_si128(p, 4));
+        p = _mm_add_epi32(p, _mm_slli_si128(p, 8));
+        return _mm_add_epi32(p, _mm_shuffle_epi32(prev, 0xff));
+      }
+#endif
+
+      /* 'data' has to be readable for 16 bytes past the packed values, as
+         the SIMD loop loads 16 bytes for every 4 values */
+      template <PackedCoding CODING>
+      void decodePackedImpl(const uint8_t *control,
+                            const uint8_t *data,
+                            size_t count,
+                            uint32_t *out)
+      {
+        size_t i      = 0;
+        uint32_t prev = 0;
+
+#ifdef RKCOMMON_PACKED_SSSE3
+        const ShuffleTable &table = shuffleTable();
+        __m128i last              = _mm_setzero_si128();
+        for (; i + 4 <= count; i += 4) {
+          const uint8_t c = control[i / 4];
+          const __m128i p = _mm_shuffle_epi8(
+              _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)),
+              _mm_loadu_si128(
+                  reinterpret_cast<const __m128i *>(table.mask[c])));
+          last = fromPacked<CODING>(p, last);
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), last);
+          data += table.length[c];
+        }
+        prev = uint32_t(_mm_cvtsi128_si32(_mm_shuffle_epi32(last, 0xff)));
+#endif
+
+        for (; i < count; i++) {
+          const uint32_t code = (control[i / 4] >> (2 * (i % 4))) & 3;
+          uint32_t p          = 0;
+          for (uint32_t b = 0; b <= code; b++)
+            p |= uint32_t(data[b]) << (8 * b);
+          data += code + 1;
+          out[i] = prev = fromPacked<CODING>(p, prev);
+        }
+      }
+
+    }  // namespace
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      void decodePacked(const uint8_t *control,
+                        const uint8_t *data,
+                        size_t count,
+                        uint32_t *out,
+                        PackedCoding coding)
+      {
+        switch (coding) {
+        case PackedCoding::PLAIN:
+          decodePackedImpl<PackedCoding::PLAIN>(control, data, count, out);
+          break;
+        case PackedCoding::DELTA:
+          decodePackedImpl<PackedCoding::DELTA>(control, data, count, out);
+          break;
+        case PackedCoding::SIGNED_DELTA:
+          decodePackedImpl<PackedCoding::SIGNED_DELTA>(
+              control, data, count, out);
+          break;
+        }
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // DataStreaming.h definitions /////////////////////////////////////////////
+
+    namespace {
+
+      // 0-3 for values of 1-4 bytes
+      inline uint32_t lengthCode(uint32_t v)
+      {
+        return v < (1u << 8) ? 0 : v < (1u << 16) ? 1 : v < (1u << 24) ? 2 : 3;
+      }
+
+      template <PackedCoding CODING>
+      uint8_t *encodePacked(const uint32_t *values,
+                            size_t count,
+                            uint8_t *control,
+                            uint8_t *data)
+      {
+        uint32_t prev = 0;
+        for (size_t i = 0; i < count; i++) {
+          uint32_t p          = toPacked<CODING>(values[i], prev);
+          const uint32_t code = lengthCode(p);
+          control[i / 4] |= uint8_t(code << (2 * (i % 4)));
+          for (uint32_t b = 0; b <= code; b++, p >>= 8)
+            *data++ = uint8_t(p);
+          prev = values[i];
+        }
+        return data;
+      }
+
+      // number of data bytes after the control bytes of 'count' values
+      size_t packedDataSize(const uint8_t *control, size_t count)
+      {
+        size_t size = 0;
+        for (size_t i = 0; i < count / 4; i++) {
+          const uint8_t c = control[i];
+          size += 4 + (c & 3) + ((c >> 2) & 3) + ((c >> 4) & 3) + (c >> 6);
+        }
+        for (size_t i = count / 4 * 4; i < count; i++)
+          size += 1 + ((control[i / 4] >> (2 * (i % 4))) & 3);
+        return size;
+      }
+
+    }  // namespace
+
+    using DecodePackedFcn = void(
+        const uint8_t *, const uint8_t *, size_t, uint32_t *, PackedCoding);
+
+    RKCOMMON_ISA_DECLARE(DecodePackedFcn decodePacked)
+
+    void writePacked(WriteStream &buf,
+                     const uint32_t *values,
+                     size_t count,
+                     PackedCoding coding)
+    {
+      writeVarint(buf, count);
+
+      // the control bytes, then at most 4 bytes per value
+      const size_t controlSize = (count + 3) / 4;
+      std::vector<uint8_t> packed(controlSize + 4 * count);
+      uint8_t *control = packed.data();
+      uint8_t *data    = control + controlSize;
+      uint8_t *end     = nullptr;
+      switch (coding) {
+      case PackedCoding::PLAIN:
+        end = encodePacked<PackedCoding::PLAIN>(values, count, control, data);
+        break;
+      case PackedCoding::DELTA:
+        end = encodePacked<PackedCoding::DELTA>(values, count, control, data);
+        break;
+      case PackedCoding::SIGNED_DELTA:
+        end = encodePacked<PackedCoding::SIGNED_DELTA>(
+            values, count, control, data);
+        break;
+      }
+      buf.write(packed.data(), size_t(end - packed.data()));
+    }
+
+    void readPacked(ReadStream &buf,
+                    std::vector<uint32_t> &values,
+                    PackedCoding coding)
+    {
+      const size_t count       = size_t(readVarint(buf));
+      const size_t controlSize = (count + 3) / 4;
+      std::vector<uint8_t> packed(controlSize);
+      buf.read(packed.data(), controlSize);
+
+      // zeros after the values for the 16 byte loads of decodePacked()
+      const size_t dataSize = packedDataSize(packed.data(), count);
+      packed.resize(controlSize + dataSize + 16);
+      buf.read(packed.data() + controlSize, dataSize);
+
+      static DecodePackedFcn *const fcn =
+          RKCOMMON_ISA_SELECT(DecodePackedFcn, decodePacked);
+      values.resize(count);
+      fcn(packed.data(),
+          packed.data() + controlSize,
+          count,
+          values.data(),
+          coding);
+    }
+#endif
+
+  }  // namespace networking
+}  // namespace rkcommon
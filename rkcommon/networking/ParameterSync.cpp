@@ -0,0 +1,262 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ParameterSync.h"
+#include "../math/AffineSpace.h"
+#include "../math/box.h"
+#include "../math/vec.h"
+
+#include <stdexcept>
+
+namespace rkcommon {
+  namespace networking {
+
+    using utility::Any;
+    using utility::ParameterizedObject;
+
+    namespace {
+
+      // the type tags of a delta; 0 is not a type, new ones go at the end
+      enum ParamTag : uint8_t
+      {
+        UNSUPPORTED = 0,
+        BOOL,
+        INT,
+        UINT,
+        INT64,
+        UINT64,
+        FLOAT,
+        DOUBLE,
+        STRING,
+        VEC2F,
+        VEC3F,
+        VEC4F,
+        VEC2I,
+        VEC3I,
+        VEC4I,
+        BOX3F,
+        AFFINE3F
+      };
+
+      // values are written as their bytes, unless overloaded below
+      template <typename T>
+      inline void writeValue(WriteStream &out, const T &v)
+      {
+        out << v;
+      }
+
+      template <typename T>
+      inline void readValue(ReadStream &in, T &v)
+      {
+        in >> v;
+      }
+
+      inline void writeValue(WriteStream &out, const bool &v)
+      {
+        out << uint8_t(v);
+      }
+
+      inline void readValue(ReadStream &in, bool &v)
+      {
+        uint8_t byte;
+        in >> byte;
+        v = byte != 0;
+      }
+
+      inline void writeValue(WriteStream &out, const int &v)
+      {
+        writeSignedVarint(out, v);
+      }
+
+      inline void readValue(ReadStream &in, int &v)
+      {
+        v = int(readSignedVarint(in));
+      }
+
+      inline void writeValue(WriteStream &out, const unsigned int &v)
+      {
+        writeVarint(out, v);
+      }
+
+      inline void readValue(ReadStream &in, unsigned int &v)
+      {
+        v = unsigned(readVarint(in));
+      }
+
+      inline void writeValue(WriteStream &out, const int64_t &v)
+      {
+        writeSignedVarint(out, v);
+      }
+
+      inline void readValue(ReadStream &in, int64_t &v)
+      {
+        v = readSignedVarint(in);
+      }
+
+      inline void writeValue(WriteStream &out, const uint64_t &v)
+      {
+        writeVarint(out, v);
+      }
+
+      inline void readValue(ReadStream &in, uint64_t &v)
+      {
+        v = readVarint(in);
+      }
+
+      inline void writeValue(WriteStream &out, const std::string &v)
+      {
+        writeVarint(out, v.size());
+        out.write(v.data(), v.size());
+      }
+
+      inline void readValue(ReadStream &in, std::string &v)
+      {
+        v.resize(readVarint(in));
+        in.read(&v[0], v.size());
+      }
+
+      // the types of the tags, in their order
+      template <ParamTag TAG>
+      struct TagType;
+
+#define RKCOMMON_PARAM_TAG_TYPE(tag, type) \
+  template <>                              \
+  struct TagType<tag>                      \
+  {                                        \
+    using T = type;                        \
+  };
+
+      RKCOMMON_PARAM_TAG_TYPE(BOOL, bool)
+      RKCOMMON_PARAM_TAG_TYPE(INT, int)
+      RKCOMMON_PARAM_TAG_TYPE(UINT, unsigned int)
+      RKCOMMON_PARAM_TAG_TYPE(INT64, int64_t)
+      RKCOMMON_PARAM_TAG_TYPE(UINT64, uint64_t)
+      RKCOMMON_PARAM_TAG_TYPE(FLOAT, float)
+      RKCOMMON_PARAM_TAG_TYPE(DOUBLE, double)
+      RKCOMMON_PARAM_TAG_TYPE(STRING, std::string)
+      RKCOMMON_PARAM_TAG_TYPE(VEC2F, math::vec2f)
+      RKCOMMON_PARAM_TAG_TYPE(VEC3F, math::vec3f)
+      RKCOMMON_PARAM_TAG_TYPE(VEC4F, math::vec4f)
+      RKCOMMON_PARAM_TAG_TYPE(VEC2I, math::vec2i)
+      RKCOMMON_PARAM_TAG_TYPE(VEC3I, math::vec3i)
+      RKCOMMON_PARAM_TAG_TYPE(VEC4I, math::vec4i)
+      RKCOMMON_PARAM_TAG_TYPE(BOX3F, math::box3f)
+      RKCOMMON_PARAM_TAG_TYPE(AFFINE3F, math::affine3f)
+
+#undef RKCOMMON_PARAM_TAG_TYPE
+
+      // the tag of the value held by 'data', checking TAG and those after
+      template <ParamTag TAG = BOOL>
+      inline ParamTag tagOf(const Any &data)
+      {
+        return data.is<typename TagType<TAG>::T>()
+            ? TAG
+            : tagOf<ParamTag(TAG + 1)>(data);
+      }
+
+      template <>
+      inline ParamTag tagOf<ParamTag(AFFINE3F + 1)>(const Any &)
+      {
+        return UNSUPPORTED;
+      }
+
+      template <ParamTag TAG = BOOL>
+      inline void writeTagged(WriteStream &out, ParamTag tag, const Any &data)
+      {
+        if (tag == TAG)
+          writeValue(out, data.get<typename TagType<TAG>::T>());
+        else
+          writeTagged<ParamTag(TAG + 1)>(out, tag, data);
+      }
+
+      template <>
+      inline void writeTagged<ParamTag(AFFINE3F + 1)>(WriteStream &,
+                                                      ParamTag,
+                                                      const Any &)
+      {
+      }
+
+      template <ParamTag TAG = BOOL>
+      inline void readTagged(ReadStream &in,
+                             ParamTag tag,
+                             const std::string &name,
+                             ParameterizedObject &object)
+      {
+        if (tag == TAG) {
+          typename TagType<TAG>::T value;
+          readValue(in, value);
+          object.setParam(name, value);
+        } else {
+          readTagged<ParamTag(TAG + 1)>(in, tag, name, object);
+        }
+      }
+
+      template <>
+      inline void readTagged<ParamTag(AFFINE3F + 1)>(ReadStream &,
+                                                     ParamTag tag,
+                                                     const std::string &name,
+                                                     ParameterizedObject &)
+      {
+        throw std::runtime_error("applyParamDelta: unknown type tag "
+                                 + std::to_string(int(tag))
+                                 + " of parameter '" + name + "'");
+      }
+
+    }  // namespace
+
+    size_t writeParamDelta(WriteStream &out,
+                           const ParameterizedObject &object,
+                           size_t since,
+                           std::vector<std::string> *skipped)
+    {
+      const size_t now = utility::TimeStamp();
+
+      // counted first, as the parameters which cannot be written are left
+      // out of the count
+      using Param   = ParameterizedObject::Param;
+      size_t numSet = 0;
+      object.forEachParamSince(since, [&](const Param &p) {
+        if (tagOf(p.data) != UNSUPPORTED)
+          numSet++;
+        else if (skipped)
+          skipped->push_back(p.name);
+      });
+
+      writeVarint(out, numSet);
+      object.forEachParamSince(since, [&](const Param &p) {
+        const ParamTag tag = tagOf(p.data);
+        if (tag == UNSUPPORTED)
+          return;
+        writeValue(out, p.name);
+        out << uint8_t(tag);
+        writeTagged(out, tag, p.data);
+      });
+
+      size_t numRemoved = 0;
+      object.forEachRemovedParamSince(
+          since, [&](const std::string &) { numRemoved++; });
+      writeVarint(out, numRemoved);
+      object.forEachRemovedParamSince(
+          since, [&](const std::string &name) { writeValue(out, name); });
+
+      return now;
+    }
+
+    void applyParamDelta(ReadStream &in, ParameterizedObject &object)
+    {
+      std::string name;
+      for (uint64_t n = readVarint(in); n > 0; n--) {
+        readValue(in, name);
+        uint8_t tag;
+        in >> tag;
+        readTagged(in, ParamTag(tag), name, object);
+      }
+
+      for (uint64_t n = readVarint(in); n > 0; n--) {
+        readValue(in, name);
+        object.removeParam(name);
+      }
+    }
+
+  }  // namespace networking
+}  // namespace rkcommon
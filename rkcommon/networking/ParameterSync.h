@@ -0,0 +1,46 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../utility/ParameterizedObject.h"
+#include "DataStreaming.h"
+
+#include <string>
+#include <vector>
+
+namespace rkcommon {
+  namespace networking {
+
+    /*! @{ Synchronize the parameters of a ParameterizedObject with a copy of
+      it elsewhere, sending only what changed since the last time:
+
+        size_t synced = 0;  // everything, the first time
+        ...
+        synced = writeParamDelta(stream, object, synced);
+
+      and applyParamDelta(stream, copy) on the other side. A delta holds the
+      parameters set at or after 'since' and the names of those removed
+      since, so its size scales with the changes rather than with the
+      object.
+
+      Each value is a type tag byte followed by the value: integers as
+      (zig-zag) varints, bool as one byte, strings as a varint length and
+      their characters, and float, double, the float and int32_t vec2-4,
+      box3f and affine3f as their bytes. Parameters of other types (e.g.
+      pointers to objects, which a remote copy has to resolve in its own
+      way) are not written; their names go to 'skipped' if given. */
+    RKCOMMON_INTERFACE size_t
+    writeParamDelta(WriteStream &out,
+                    const utility::ParameterizedObject &object,
+                    size_t since                       = 0,
+                    std::vector<std::string> *skipped = nullptr);
+
+    /*! set and remove the parameters of a delta; throws for unknown type
+      tags, e.g. from a newer writer */
+    RKCOMMON_INTERFACE void applyParamDelta(
+        ReadStream &in, utility::ParameterizedObject &object);
+    /*! @} */
+
+  }  // namespace networking
+}  // namespace rkcommon
@@ -0,0 +1,507 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _WIN32
+
+#include "SharedMemoryFabric.h"
+#include "SocketFabric.h"
+#include "../utility/ArrayView.h"
+#include "../utility/OwnedArray.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace rkcommon {
+  namespace networking {
+
+    static const uint64_t segmentMagic = 0x726b636f6d73686dull;
+
+    static size_t roundUp(size_t size, size_t alignment)
+    {
+      return (size + alignment - 1) / alignment * alignment;
+    }
+
+    // Segment layout ////////////////////////////////////////////////////////
+
+    namespace {
+
+      struct alignas(64) SegmentHeader
+      {
+        std::atomic<uint64_t> magic;
+        std::atomic<uint32_t> attached;
+        uint32_t numRanks;
+        uint64_t ringBytes;
+        uint64_t heapBytes;
+      };
+
+      // write and read positions of a ring, on cache lines of their own
+      struct RingIndices
+      {
+        alignas(64) std::atomic<uint64_t> head;
+        alignas(64) std::atomic<uint64_t> tail;
+      };
+
+      // starts each block of a heap
+      struct alignas(64) BlockHeader
+      {
+        std::atomic<int32_t> refs;
+        uint64_t size;
+      };
+
+      struct Message
+      {
+        uint64_t size;
+        uint64_t offset;  // of the block header in the sender's heap
+        uint64_t inHeap;
+      };
+
+    }  // namespace
+
+    /*! the mapped segment; blocks handed out keep it mapped */
+    struct SharedMemoryFabric::Segment
+    {
+      Segment(const std::string &name,
+              bool create,
+              int numRanks,
+              size_t ringBytes,
+              size_t heapBytes);
+      ~Segment();
+
+      SegmentHeader &header() const
+      {
+        return *(SegmentHeader *)base;
+      }
+
+      RingIndices &indices(int from, int to) const
+      {
+        return ((RingIndices *)(base + sizeof(SegmentHeader)))
+            [size_t(from) * numRanks + to];
+      }
+
+      uint8_t *ring(int from, int to) const
+      {
+        return base + ringsBegin + (size_t(from) * numRanks + to) * ringBytes;
+      }
+
+      uint8_t *heap(int rank) const
+      {
+        return base + heapsBegin + size_t(rank) * heapBytes;
+      }
+
+      const int numRanks;
+      const size_t ringBytes;
+      const size_t heapBytes;
+      size_t ringsBegin;
+      size_t heapsBegin;
+      size_t totalBytes;
+      uint8_t *base{nullptr};
+    };
+
+    SharedMemoryFabric::Segment::Segment(const std::string &name,
+                                         bool create,
+                                         int numRanks,
+                                         size_t ringBytes,
+                                         size_t heapBytes)
+        : numRanks(numRanks),
+          ringBytes(roundUp(ringBytes, 64)),
+          heapBytes(roundUp(heapBytes, 64))
+    {
+      const size_t pairs = size_t(numRanks) * numRanks;
+      ringsBegin = sizeof(SegmentHeader) + pairs * sizeof(RingIndices);
+      heapsBegin = ringsBegin + pairs * this->ringBytes;
+      totalBytes = heapsBegin + size_t(numRanks) * this->heapBytes;
+
+      int fd = -1;
+      if (create) {
+        // a segment left behind by a crashed run is replaced
+        shm_unlink(name.c_str());
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd >= 0 && ftruncate(fd, off_t(totalBytes)) != 0) {
+          close(fd);
+          fd = -1;
+        }
+      } else {
+        // wait for rank 0 to create the segment
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (true) {
+          fd = shm_open(name.c_str(), O_RDWR, 0600);
+          struct stat info;
+          if (fd >= 0 && fstat(fd, &info) == 0 &&
+              size_t(info.st_size) >= totalBytes)
+            break;
+          if (fd >= 0)
+            close(fd);
+          fd = -1;
+          if (std::chrono::steady_clock::now() > deadline)
+            break;
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }
+      if (fd < 0) {
+        throw std::runtime_error("SharedMemoryFabric: cannot open '" + name
+                                 + "' (" + std::strerror(errno) + ")");
+      }
+
+      void *mem = mmap(
+          nullptr, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (mem == MAP_FAILED) {
+        throw std::runtime_error("SharedMemoryFabric: cannot map '" + name
+                                 + "' (" + std::strerror(errno) + ")");
+      }
+      base = (uint8_t *)mem;
+
+      // the new segment is zero filled, which is what the atomics start at
+      SegmentHeader &h = header();
+      if (create) {
+        h.numRanks  = uint32_t(numRanks);
+        h.ringBytes = this->ringBytes;
+        h.heapBytes = this->heapBytes;
+        h.magic.store(segmentMagic, std::memory_order_release);
+      } else {
+        while (h.magic.load(std::memory_order_acquire) != segmentMagic)
+          std::this_thread::yield();
+        if (h.numRanks != uint32_t(numRanks) ||
+            h.ringBytes != this->ringBytes || h.heapBytes != this->heapBytes) {
+          munmap(base, totalBytes);
+          throw std::runtime_error(
+              "SharedMemoryFabric: '" + name + "' has another layout");
+        }
+      }
+
+      if (int(h.attached.fetch_add(1) + 1) == numRanks)
+        shm_unlink(name.c_str());
+    }
+
+    SharedMemoryFabric::Segment::~Segment()
+    {
+      munmap(base, totalBytes);
+    }
+
+    /*! an array in a heap of the segment; the sender and each receiver
+      hold a reference on it */
+    struct SharedMemoryFabric::Block : public utility::ArrayView<uint8_t>
+    {
+      Block(const std::shared_ptr<Segment> &segment, BlockHeader *header)
+          : utility::ArrayView<uint8_t>((uint8_t *)(header + 1),
+                                        header->size),
+            segment(segment),
+            header(header)
+      {
+      }
+
+      ~Block() override
+      {
+        header->refs.fetch_sub(1, std::memory_order_release);
+      }
+
+      const std::shared_ptr<Segment> segment;
+      BlockHeader *const header;
+    };
+
+    // SharedMemoryFabric //
+
+    SharedMemoryFabric::SharedMemoryFabric(const std::string &name,
+                                           int rank,
+                                           int numRanks,
+                                           size_t ringBytes,
+                                           size_t heapBytes)
+        : myRank(rank), ranks(numRanks)
+    {
+      if (numRanks < 1 || rank < 0 || rank >= numRanks)
+        throw std::runtime_error("SharedMemoryFabric: invalid rank");
+      segment = std::make_shared<Segment>(
+          name, rank == 0, numRanks, ringBytes, heapBytes);
+    }
+
+    SharedMemoryFabric::~SharedMemoryFabric() = default;
+
+    int SharedMemoryFabric::rank() const
+    {
+      return myRank;
+    }
+
+    int SharedMemoryFabric::numRanks() const
+    {
+      return ranks;
+    }
+
+    void SharedMemoryFabric::checkRank(int rank) const
+    {
+      if (rank < 0 || rank >= ranks || rank == myRank) {
+        throw std::runtime_error("SharedMemoryFabric: invalid peer rank "
+                                 + std::to_string(rank));
+      }
+    }
+
+    std::shared_ptr<SharedMemoryFabric::Block>
+    SharedMemoryFabric::allocateBlock(size_t size)
+    {
+      uint8_t *heap = segment->heap(myRank);
+
+      // forget the blocks all ranks are done with
+      for (auto b = heapBlocks.begin(); b != heapBlocks.end();) {
+        const BlockHeader *h = (const BlockHeader *)(heap + b->first);
+        if (h->refs.load(std::memory_order_acquire) == 0)
+          b = heapBlocks.erase(b);
+        else
+          ++b;
+      }
+
+      // first fit
+      const size_t needed = sizeof(BlockHeader) + roundUp(size, 64);
+      size_t offset       = 0;
+      for (const auto &b : heapBlocks) {
+        if (b.first - offset >= needed)
+          break;
+        offset = b.first + b.second;
+      }
+      if (offset + needed > segment->heapBytes)
+        return nullptr;
+
+      heapBlocks[offset] = needed;
+      BlockHeader *h     = (BlockHeader *)(heap + offset);
+      h->size            = size;
+      h->refs.store(1, std::memory_order_relaxed);
+      return std::make_shared<Block>(segment, h);
+    }
+
+    std::shared_ptr<utility::AbstractArray<uint8_t>>
+    SharedMemoryFabric::allocate(size_t size)
+    {
+      auto block = allocateBlock(size);
+      if (block)
+        return block;
+
+      return bufferPool().acquire(size);
+    }
+
+    void SharedMemoryFabric::writeRing(int rank,
+                                       const void *bytes,
+                                       size_t size)
+    {
+      RingIndices &indices  = segment->indices(myRank, rank);
+      uint8_t *ring         = segment->ring(myRank, rank);
+      const size_t capacity = segment->ringBytes;
+      const uint8_t *data   = (const uint8_t *)bytes;
+
+      uint64_t head = indices.head.load(std::memory_order_relaxed);
+      while (size > 0) {
+        const uint64_t tail = indices.tail.load(std::memory_order_acquire);
+        const size_t space  = capacity - size_t(head - tail);
+        if (space == 0) {
+          std::this_thread::yield();
+          continue;
+        }
+        const size_t at = size_t(head % capacity);
+        const size_t n  = std::min({size, space, capacity - at});
+        std::memcpy(ring + at, data, n);
+        data += n;
+        size -= n;
+        head += n;
+        indices.head.store(head, std::memory_order_release);
+      }
+    }
+
+    void SharedMemoryFabric::readRing(int rank, void *bytes, size_t size)
+    {
+      RingIndices &indices  = segment->indices(rank, myRank);
+      const uint8_t *ring   = segment->ring(rank, myRank);
+      const size_t capacity = segment->ringBytes;
+      uint8_t *data         = (uint8_t *)bytes;
+
+      uint64_t tail = indices.tail.load(std::memory_order_relaxed);
+      while (size > 0) {
+        const uint64_t head = indices.head.load(std::memory_order_acquire);
+        if (head == tail) {
+          std::this_thread::yield();
+          continue;
+        }
+        const size_t at = size_t(tail % capacity);
+        const size_t available = size_t(head - tail);
+        const size_t n         = std::min({size, available, capacity - at});
+        std::memcpy(data, ring + at, n);
+        data += n;
+        size -= n;
+        tail += n;
+        indices.tail.store(tail, std::memory_order_release);
+      }
+    }
+
+    void SharedMemoryFabric::sendBcast(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf)
+    {
+      if (myRank != 0)
+        throw std::runtime_error("SharedMemoryFabric: only rank 0 broadcasts");
+
+      // one copy into the heap for all ranks
+      std::shared_ptr<utility::AbstractArray<uint8_t>> shared = buf;
+      if (!std::dynamic_pointer_cast<Block>(buf) &&
+          buf->size() >= minHeapMessage) {
+        auto block = allocateBlock(buf->size());
+        if (block) {
+          std::memcpy(block->data(), buf->data(), buf->size());
+          shared = block;
+        }
+      }
+      for (int r = 1; r < ranks; r++)
+        send(shared, r);
+    }
+
+    void SharedMemoryFabric::flushBcastSends()
+    {
+      for (int r = 0; r < ranks; r++) {
+        if (r == myRank)
+          continue;
+        RingIndices &indices = segment->indices(myRank, r);
+        const uint64_t head  = indices.head.load(std::memory_order_relaxed);
+        while (indices.tail.load(std::memory_order_acquire) != head)
+          std::this_thread::yield();
+      }
+    }
+
+    void SharedMemoryFabric::recvBcast(utility::AbstractArray<uint8_t> &buf)
+    {
+      recv(buf, 0);
+    }
+
+    void SharedMemoryFabric::send(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf, int rank)
+    {
+      checkRank(rank);
+
+      auto block = std::dynamic_pointer_cast<Block>(buf);
+      if (block && block->segment != segment)
+        block = nullptr;
+      if (!block && buf->size() >= minHeapMessage) {
+        block = allocateBlock(buf->size());
+        if (block)
+          std::memcpy(block->data(), buf->data(), buf->size());
+      }
+
+      Message message;
+      message.size = buf->size();
+      if (block) {
+        // the receiver's reference, dropped once it has the data
+        block->header->refs.fetch_add(1, std::memory_order_relaxed);
+        message.offset =
+            size_t((uint8_t *)block->header - segment->heap(myRank));
+        message.inHeap = 1;
+      } else {
+        message.offset = 0;
+        message.inHeap = 0;
+      }
+      writeRing(rank, &message, sizeof(message));
+      if (!message.inHeap)
+        writeRing(rank, buf->data(), buf->size());
+    }
+
+    void SharedMemoryFabric::recv(utility::AbstractArray<uint8_t> &buf,
+                                  int rank)
+    {
+      auto message = recvShared(rank);
+      if (message->size() != buf.size()) {
+        throw std::runtime_error(
+            "SharedMemoryFabric: received " + std::to_string(message->size())
+            + " bytes instead of " + std::to_string(buf.size()));
+      }
+      if (buf.size() > 0)
+        std::memcpy(buf.data(), message->data(), buf.size());
+    }
+
+    std::shared_ptr<utility::AbstractArray<uint8_t>>
+    SharedMemoryFabric::recvShared(int rank)
+    {
+      checkRank(rank);
+      Message message;
+      readRing(rank, &message, sizeof(message));
+
+      // the message comes after the sender's writes to the block
+      if (message.inHeap) {
+        auto *header = (BlockHeader *)(segment->heap(rank) + message.offset);
+        return std::make_shared<Block>(segment, header);
+      }
+
+      auto bytes = bufferPool().acquire(message.size);
+      readRing(rank, bytes->data(), message.size);
+      return bytes;
+    }
+
+    // Automatic selection //
+
+    static const size_t hostNameBytes = 256;
+
+    static std::string hostName()
+    {
+      char name[hostNameBytes] = {};
+      gethostname(name, hostNameBytes - 1);
+      return name;
+    }
+
+    std::shared_ptr<Fabric> acceptFabric(SocketListener &listener,
+                                         int numWorkers)
+    {
+      auto sockets = listener.accept(numWorkers);
+
+      bool local = true;
+      for (int r = 1; r <= numWorkers; r++) {
+        utility::OwnedArray<uint8_t> name;
+        name.resize(hostNameBytes, 0);
+        sockets->recv(name, r);
+        local = local && std::string((const char *)name.data()) == hostName();
+      }
+
+      // 1 and the segment's name to use shared memory, 0 for sockets
+      auto reply = std::make_shared<utility::OwnedArray<uint8_t>>();
+      reply->resize(1 + hostNameBytes, 0);
+      std::shared_ptr<Fabric> fabric = sockets;
+      if (local) {
+        static std::atomic<int> segments{0};
+        const std::string name = "/rkcommon_fabric_"
+            + std::to_string(getpid()) + "_" + std::to_string(segments++);
+        fabric = std::make_shared<SharedMemoryFabric>(name, 0, numWorkers + 1);
+        (*reply)[0] = 1;
+        std::memcpy(reply->data() + 1, name.c_str(), name.size());
+      }
+      sockets->sendBcast(reply);
+      sockets->flushBcastSends();
+      return fabric;
+    }
+
+    std::shared_ptr<Fabric> connectFabric(const std::string &address,
+                                          int rank)
+    {
+      auto sockets = SocketFabric::connect(address, rank);
+
+      auto name = std::make_shared<utility::OwnedArray<uint8_t>>();
+      name->resize(hostNameBytes, 0);
+      const std::string host = hostName();
+      std::memcpy(name->data(), host.c_str(), host.size());
+      sockets->send(name, 0);
+
+      utility::OwnedArray<uint8_t> reply;
+      reply.resize(1 + hostNameBytes, 0);
+      sockets->recvBcast(reply);
+      if (!reply[0])
+        return sockets;
+
+      return std::make_shared<SharedMemoryFabric>(
+          std::string((const char *)reply.data() + 1),
+          rank,
+          sockets->numRanks());
+    }
+
+  }  // namespace networking
+}  // namespace rkcommon
+
+#endif
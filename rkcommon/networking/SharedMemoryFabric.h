@@ -0,0 +1,107 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#ifndef _WIN32
+
+#include <map>
+#include <string>
+#include "Fabric.h"
+
+namespace rkcommon {
+  namespace networking {
+
+    struct SocketListener;
+
+    /*! Fabric between processes (or threads) on one host, through a POSIX
+      shared memory segment called 'name'.
+
+      Every pair of ranks has a lock-free single producer, single consumer
+      ring buffer of 'ringBytes' for the messages from one to the other, and
+      every rank a heap of 'heapBytes' in the segment. Arrays from
+      allocate() live in the sender's heap, so sending one only passes its
+      offset: recvShared() returns it in place on the receiving rank, and
+      it is reused once all ranks have let go of it. Other messages of at
+      least 'minHeapMessage' bytes are copied into the heap once instead of
+      being streamed through the ring, so send() does not wait for the
+      receiver; smaller ones go through the ring.
+
+      The messages are framed, so recv() checks that 'buf' has the size
+      that was sent. Broadcasts come from rank 0. Rank 0 creates the
+      segment; the name is unlinked once all ranks have attached to it. */
+    struct RKCOMMON_INTERFACE SharedMemoryFabric : public Fabric
+    {
+      SharedMemoryFabric(const std::string &name,
+                         int rank,
+                         int numRanks,
+                         size_t ringBytes = size_t(1) << 20,
+                         size_t heapBytes = size_t(64) << 20);
+
+      ~SharedMemoryFabric() override;
+
+      int rank() const;
+      int numRanks() const;
+
+      /*! an array in this rank's part of the segment, which is sent without
+        copying; falls back to a buffer of bufferPool() (sent as a copy)
+        when the heap is full */
+      std::shared_ptr<utility::AbstractArray<uint8_t>> allocate(size_t size);
+
+      void sendBcast(
+          std::shared_ptr<utility::AbstractArray<uint8_t>> buf) override;
+
+      /*! wait until the other ranks have received all messages sent to
+        them (not only broadcasts) */
+      void flushBcastSends() override;
+
+      void recvBcast(utility::AbstractArray<uint8_t> &buf) override;
+
+      void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+                int rank) override;
+
+      void recv(utility::AbstractArray<uint8_t> &buf, int rank) override;
+
+      /*! receive the next message from 'rank' whatever its size, in place
+        if it was sent through the heap */
+      std::shared_ptr<utility::AbstractArray<uint8_t>> recvShared(int rank);
+
+      // messages at least this large go through the heap
+      size_t minHeapMessage = 64 * 1024;
+
+     private:
+      struct Segment;
+      struct Block;
+
+      void checkRank(int rank) const;
+
+      // stream bytes through the ring to or from 'rank', waiting for room
+      // or data
+      void writeRing(int rank, const void *bytes, size_t size);
+      void readRing(int rank, void *bytes, size_t size);
+
+      // a block in this rank's heap, or nullptr if it is full
+      std::shared_ptr<Block> allocateBlock(size_t size);
+
+      const int myRank;
+      const int ranks;
+      std::shared_ptr<Segment> segment;
+
+      // offset -> size of the blocks of this rank's heap not released yet
+      std::map<size_t, size_t> heapBlocks;
+    };
+
+    /*! @{ set up a fabric among the workers connecting to 'listener':
+      a SharedMemoryFabric if all ranks run on this host, otherwise the
+      SocketFabric the ranks connected with */
+    RKCOMMON_INTERFACE std::shared_ptr<Fabric> acceptFabric(
+        SocketListener &listener, int numWorkers);
+
+    RKCOMMON_INTERFACE std::shared_ptr<Fabric> connectFabric(
+        const std::string &address, int rank);
+    /*! @} */
+
+  }  // namespace networking
+}  // namespace rkcommon
+
+#endif
@@ -0,0 +1,599 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _WIN32
+
+#include "SocketFabric.h"
+#include "DataStreaming.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace rkcommon {
+  namespace networking {
+
+    // socket buffers large enough to keep a fast link busy
+    static const int socketBufferSize = 4 << 20;
+
+    static const std::string unixPrefix = "unix:";
+
+    static std::runtime_error socketError(const std::string &what)
+    {
+      return std::runtime_error(
+          "SocketFabric: " + what + " (" + std::strerror(errno) + ")");
+    }
+
+    static void tuneTcp(int fd)
+    {
+      const int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      setsockopt(fd,
+                 SOL_SOCKET,
+                 SO_SNDBUF,
+                 &socketBufferSize,
+                 sizeof(socketBufferSize));
+      setsockopt(fd,
+                 SOL_SOCKET,
+                 SO_RCVBUF,
+                 &socketBufferSize,
+                 sizeof(socketBufferSize));
+    }
+
+    static void sendAll(int fd, const void *data, size_t size)
+    {
+      const uint8_t *bytes = (const uint8_t *)data;
+      while (size > 0) {
+        const ssize_t sent = ::send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+          if (errno == EINTR)
+            continue;
+          throw socketError("send failed");
+        }
+        bytes += sent;
+        size -= size_t(sent);
+      }
+    }
+
+    static void recvAll(int fd, void *data, size_t size)
+    {
+      uint8_t *bytes = (uint8_t *)data;
+      while (size > 0) {
+        const ssize_t received = ::recv(fd, bytes, size, 0);
+        if (received < 0) {
+          if (errno == EINTR)
+            continue;
+          throw socketError("recv failed");
+        }
+        if (received == 0)
+          throw std::runtime_error("SocketFabric: connection closed");
+        bytes += received;
+        size -= size_t(received);
+      }
+    }
+
+    static sockaddr_un unixAddress(const std::string &path)
+    {
+      sockaddr_un addr;
+      std::memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      if (path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("SocketFabric: socket path is too long");
+      std::memcpy(addr.sun_path, path.c_str(), path.size());
+      return addr;
+    }
+
+    // "host:port" to its addresses, for listening if 'passive'
+    static addrinfo *tcpAddresses(const std::string &address, bool passive)
+    {
+      const size_t colon = address.rfind(':');
+      if (colon == std::string::npos) {
+        throw std::runtime_error(
+            "SocketFabric: address '" + address + "' is not host:port");
+      }
+      const std::string host = address.substr(0, colon);
+      const std::string port = address.substr(colon + 1);
+
+      addrinfo hints;
+      std::memset(&hints, 0, sizeof(hints));
+      hints.ai_family   = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      hints.ai_flags    = passive ? AI_PASSIVE : 0;
+
+      addrinfo *result = nullptr;
+      const int status = getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                                     port.c_str(),
+                                     &hints,
+                                     &result);
+      if (status != 0) {
+        throw std::runtime_error("SocketFabric: cannot resolve '" + address
+                                 + "' (" + gai_strerror(status) + ")");
+      }
+      return result;
+    }
+
+    int connectSocket(const std::string &address)
+    {
+      if (address.compare(0, unixPrefix.size(), unixPrefix) == 0) {
+        const sockaddr_un addr =
+            unixAddress(address.substr(unixPrefix.size()));
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+          throw socketError("cannot create socket");
+        if (::connect(fd, (const sockaddr *)&addr, sizeof(addr)) != 0) {
+          ::close(fd);
+          throw socketError("cannot connect to '" + address + "'");
+        }
+        return fd;
+      }
+
+      addrinfo *addresses = tcpAddresses(address, false);
+      int fd              = -1;
+      for (addrinfo *a = addresses; a && fd < 0; a = a->ai_next) {
+        fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0)
+          continue;
+        tuneTcp(fd);
+        if (::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+          ::close(fd);
+          fd = -1;
+        }
+      }
+      freeaddrinfo(addresses);
+      if (fd < 0)
+        throw socketError("cannot connect to '" + address + "'");
+      return fd;
+    }
+
+    // SocketFabric //
+
+    SocketFabric::SocketFabric(int rank,
+                               int numRanks,
+                               const std::vector<int> &sockets)
+        : myRank(rank), ranks(numRanks), sockets(sockets)
+    {
+      this->sockets.resize(std::max(size_t(numRanks), sockets.size()), -1);
+      ioThread = std::thread(&SocketFabric::ioLoop, this);
+    }
+
+    SocketFabric::~SocketFabric()
+    {
+      if (recvThread.joinable()) {
+        {
+          std::lock_guard<std::mutex> lock(recvMutex);
+          recvStopping = true;
+        }
+        wakeRecvLoop();
+        recvThread.join();
+        ::close(wakeupPipe[0]);
+        ::close(wakeupPipe[1]);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+      }
+      changed.notify_all();
+      ioThread.join();
+
+      for (int fd : sockets) {
+        if (fd >= 0)
+          ::close(fd);
+      }
+    }
+
+    std::shared_ptr<SocketFabric> SocketFabric::connect(
+        const std::string &address, int rank)
+    {
+      if (rank < 1)
+        throw std::runtime_error("SocketFabric::connect: rank must be > 0");
+
+      const int fd = connectSocket(address);
+      int32_t numRanks;
+      try {
+        const int32_t hello = rank;
+        sendAll(fd, &hello, sizeof(hello));
+        recvAll(fd, &numRanks, sizeof(numRanks));
+      } catch (...) {
+        ::close(fd);
+        throw;
+      }
+
+      std::vector<int> sockets(numRanks, -1);
+      sockets[0] = fd;
+      return std::make_shared<SocketFabric>(rank, numRanks, sockets);
+    }
+
+    int SocketFabric::rank() const
+    {
+      return myRank;
+    }
+
+    int SocketFabric::numRanks() const
+    {
+      return ranks;
+    }
+
+    int SocketFabric::socketTo(int rank) const
+    {
+      if (rank < 0 || rank >= int(sockets.size()) || sockets[rank] < 0) {
+        throw std::runtime_error("SocketFabric: no connection to rank "
+                                 + std::to_string(rank));
+      }
+      return sockets[rank];
+    }
+
+    void SocketFabric::enqueue(Outgoing outgoing)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error)
+          std::rethrow_exception(error);
+        queue.push_back(std::move(outgoing));
+        pending++;
+      }
+      changed.notify_all();
+    }
+
+    void SocketFabric::sendBcast(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf)
+    {
+      if (myRank != 0)
+        throw std::runtime_error("SocketFabric: only the root broadcasts");
+      for (int r = 1; r < ranks; r++)
+        send(buf, r);
+    }
+
+    void SocketFabric::flushBcastSends()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&]() { return pending == 0; });
+      if (error)
+        std::rethrow_exception(error);
+    }
+
+    void SocketFabric::recvBcast(utility::AbstractArray<uint8_t> &buf)
+    {
+      recv(buf, 0);
+    }
+
+    void SocketFabric::send(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf, int rank)
+    {
+      enqueue({socketTo(rank), std::move(buf), nullptr});
+    }
+
+    void SocketFabric::recv(utility::AbstractArray<uint8_t> &buf, int rank)
+    {
+      recvAll(socketTo(rank), buf.data(), buf.size());
+    }
+
+    void SocketFabric::sendSegments(const IOVecWriter &data, int rank)
+    {
+      // the copy shares the large segments, and only copies the small ones
+      enqueue({socketTo(rank), nullptr, std::make_shared<IOVecWriter>(data)});
+    }
+
+    tasking::Future<std::shared_ptr<utility::AbstractArray<uint8_t>>>
+    SocketFabric::recvAsync(size_t size, int rank)
+    {
+      socketTo(rank);
+
+      std::call_once(recvStarted, [&]() {
+        if (::pipe(wakeupPipe) != 0)
+          throw socketError("cannot create pipe");
+        // wake-ups coalesce, a full pipe is as good as one more byte
+        for (int fd : wakeupPipe)
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        asyncRecvs.resize(sockets.size());
+        recvThread = std::thread(&SocketFabric::recvLoop, this);
+      });
+
+      AsyncRecv pending{bufferPool().acquire(size), 0, {}};
+      auto future = pending.promise.getFuture();
+      {
+        std::lock_guard<std::mutex> lock(recvMutex);
+        if (recvError)
+          pending.promise.setException(recvError);
+        else
+          asyncRecvs[rank].push_back(std::move(pending));
+      }
+      wakeRecvLoop();
+      return future;
+    }
+
+    tasking::Future<std::shared_ptr<utility::AbstractArray<uint8_t>>>
+    SocketFabric::recvBcastAsync(size_t size)
+    {
+      return recvAsync(size, 0);
+    }
+
+    void SocketFabric::wakeRecvLoop()
+    {
+      const char wake = 0;
+      const ssize_t written = ::write(wakeupPipe[1], &wake, 1);
+      (void)written;
+    }
+
+    void SocketFabric::failAsyncRecvs(std::exception_ptr error)
+    {
+      std::vector<AsyncRecv> failed;
+      {
+        std::lock_guard<std::mutex> lock(recvMutex);
+        for (auto &pending : asyncRecvs) {
+          for (auto &p : pending)
+            failed.push_back(std::move(p));
+          pending.clear();
+        }
+        recvError = error;
+      }
+      for (auto &f : failed)
+        f.promise.setException(error);
+    }
+
+    void SocketFabric::recvLoop()
+    {
+      std::vector<pollfd> fds;
+      std::vector<int> polledRanks;
+      std::vector<bool> headDone;
+      while (true) {
+        fds.assign(1, pollfd{wakeupPipe[0], POLLIN, 0});
+        polledRanks.clear();
+        headDone.clear();
+        bool anyDone = false;
+        {
+          std::lock_guard<std::mutex> lock(recvMutex);
+          if (recvStopping)
+            break;
+          for (size_t r = 0; r < asyncRecvs.size(); r++) {
+            if (!asyncRecvs[r].empty()) {
+              const AsyncRecv &head = asyncRecvs[r].front();
+              fds.push_back(pollfd{sockets[r], POLLIN, 0});
+              polledRanks.push_back(int(r));
+              // receives of 0 bytes complete without waiting for data
+              headDone.push_back(head.received == head.buffer->size());
+              anyDone = anyDone || headDone.back();
+            }
+          }
+        }
+
+        if (::poll(fds.data(), fds.size(), anyDone ? 0 : -1) < 0) {
+          if (errno == EINTR)
+            continue;
+          failAsyncRecvs(std::make_exception_ptr(socketError("poll failed")));
+          return;
+        }
+
+        if (fds[0].revents) {
+          char drain[64];
+          while (::read(wakeupPipe[0], drain, sizeof(drain)) > 0)
+            ;
+        }
+
+        for (size_t i = 1; i < fds.size(); i++) {
+          if (!fds[i].revents && !headDone[i - 1])
+            continue;
+          const int r = polledRanks[i - 1];
+          // read as much as has arrived, into as many receives as it fills
+          while (true) {
+            AsyncRecv *head = nullptr;
+            {
+              // the receive stays in place while others are posted
+              std::lock_guard<std::mutex> lock(recvMutex);
+              if (asyncRecvs[r].empty())
+                break;
+              head = &asyncRecvs[r].front();
+            }
+
+            std::exception_ptr failed;
+            const size_t size = head->buffer->size();
+            if (head->received < size) {
+              const ssize_t n = ::recv(fds[i].fd,
+                                       head->buffer->data() + head->received,
+                                       size - head->received,
+                                       MSG_DONTWAIT);
+              if (n < 0 && errno == EINTR)
+                continue;
+              if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+              if (n < 0) {
+                failed = std::make_exception_ptr(socketError("recv failed"));
+              } else if (n == 0) {
+                failed = std::make_exception_ptr(
+                    std::runtime_error("SocketFabric: connection closed"));
+              } else {
+                head->received += size_t(n);
+                if (head->received < size)
+                  continue;
+              }
+            }
+
+            std::unique_lock<std::mutex> lock(recvMutex);
+            AsyncRecv done = std::move(asyncRecvs[r].front());
+            asyncRecvs[r].pop_front();
+            lock.unlock();
+            if (failed)
+              done.promise.setException(failed);
+            else
+              done.promise.setValue(std::move(done.buffer));
+          }
+        }
+      }
+
+      failAsyncRecvs(std::make_exception_ptr(
+          std::runtime_error("SocketFabric destroyed before the receive")));
+    }
+
+    void SocketFabric::ioLoop()
+    {
+      // a peer going away fails the write instead of killing the process
+      sigset_t pipe;
+      sigemptyset(&pipe);
+      sigaddset(&pipe, SIGPIPE);
+      pthread_sigmask(SIG_BLOCK, &pipe, nullptr);
+
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true) {
+        changed.wait(lock, [&]() { return stopping || !queue.empty(); });
+        if (queue.empty())
+          return;
+
+        Outgoing outgoing = std::move(queue.front());
+        queue.pop_front();
+
+        lock.unlock();
+        std::exception_ptr failed;
+        try {
+          if (outgoing.segments)
+            outgoing.segments->writeTo(outgoing.fd);
+          else
+            sendAll(outgoing.fd,
+                    outgoing.buffer->data(),
+                    outgoing.buffer->size());
+        } catch (...) {
+          failed = std::current_exception();
+        }
+        outgoing = Outgoing();
+        lock.lock();
+
+        if (failed) {
+          // the stream is broken, so drop what is queued behind it
+          error = failed;
+          queue.clear();
+          pending = 0;
+        } else {
+          pending--;
+        }
+        changed.notify_all();
+      }
+    }
+
+    // SocketListener //
+
+    SocketListener::SocketListener(const std::string &address)
+    {
+      if (address.compare(0, unixPrefix.size(), unixPrefix) == 0) {
+        unixPath               = address.substr(unixPrefix.size());
+        const sockaddr_un addr = unixAddress(unixPath);
+        fd                     = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+          throw socketError("cannot create socket");
+        ::unlink(unixPath.c_str());
+        if (::bind(fd, (const sockaddr *)&addr, sizeof(addr)) != 0) {
+          ::close(fd);
+          throw socketError("cannot bind '" + address + "'");
+        }
+        boundAddress = address;
+      } else {
+        addrinfo *addresses = tcpAddresses(address, true);
+        for (addrinfo *a = addresses; a && fd < 0; a = a->ai_next) {
+          fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+          if (fd < 0)
+            continue;
+          const int one = 1;
+          setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+          // accepted sockets inherit the buffer sizes
+          tuneTcp(fd);
+          if (::bind(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            ::close(fd);
+            fd = -1;
+          }
+        }
+        freeaddrinfo(addresses);
+        if (fd < 0)
+          throw socketError("cannot bind '" + address + "'");
+
+        sockaddr_storage bound;
+        socklen_t length = sizeof(bound);
+        getsockname(fd, (sockaddr *)&bound, &length);
+        char port[NI_MAXSERV];
+        getnameinfo((const sockaddr *)&bound,
+                    length,
+                    nullptr,
+                    0,
+                    port,
+                    sizeof(port),
+                    NI_NUMERICSERV);
+        boundAddress = address.substr(0, address.rfind(':') + 1) + port;
+      }
+
+      if (::listen(fd, SOMAXCONN) != 0) {
+        ::close(fd);
+        throw socketError("cannot listen on '" + address + "'");
+      }
+    }
+
+    SocketListener::~SocketListener()
+    {
+      ::close(fd);
+      if (!unixPath.empty())
+        ::unlink(unixPath.c_str());
+    }
+
+    std::string SocketListener::address() const
+    {
+      return boundAddress;
+    }
+
+    std::shared_ptr<SocketFabric> SocketListener::accept(int numWorkers)
+    {
+      const int32_t numRanks = numWorkers + 1;
+      std::vector<int> sockets(numRanks, -1);
+      auto closeAll = [&]() {
+        for (int s : sockets) {
+          if (s >= 0)
+            ::close(s);
+        }
+      };
+
+      try {
+        for (int i = 0; i < numWorkers; i++) {
+          const int peer = ::accept(fd, nullptr, nullptr);
+          if (peer < 0) {
+            if (errno == EINTR) {
+              i--;
+              continue;
+            }
+            throw socketError("accept failed");
+          }
+
+          int32_t rank = -1;
+          try {
+            recvAll(peer, &rank, sizeof(rank));
+          } catch (...) {
+            ::close(peer);
+            throw;
+          }
+          if (rank < 1 || rank >= numRanks || sockets[rank] >= 0) {
+            ::close(peer);
+            throw std::runtime_error("SocketListener: unexpected rank "
+                                     + std::to_string(rank));
+          }
+          sockets[rank] = peer;
+        }
+
+        for (int r = 1; r < numRanks; r++)
+          sendAll(sockets[r], &numRanks, sizeof(numRanks));
+      } catch (...) {
+        closeAll();
+        throw;
+      }
+
+      return std::make_shared<SocketFabric>(0, numRanks, sockets);
+    }
+
+  }  // namespace networking
+}  // namespace rkcommon
+
+#endif
@@ -0,0 +1,148 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#ifndef _WIN32
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Fabric.h"
+
+namespace rkcommon {
+  namespace networking {
+
+    /*! Fabric over stream sockets between a root (rank 0) and the workers
+      (ranks 1 to numRanks() - 1) connected to it: TCP, or Unix-domain
+      sockets for ranks on the same machine.
+
+      Sends return right away: the buffers are queued and a background I/O
+      thread writes them in order, holding a reference to each until it has
+      been written. flushBcastSends() waits for the queue to drain, and
+      errors of the I/O thread are rethrown by the next send or flush.
+      recv() reads on the calling thread, exactly buf.size() bytes, so
+      messages have to be received with the size they were sent with (as
+      with MPI). recvAsync() reads on one receive thread, which waits for
+      all ranks with pending receives at once. */
+    struct RKCOMMON_INTERFACE SocketFabric : public Fabric
+    {
+      /*! takes ownership of connected sockets, 'sockets[r]' being the one
+        to rank r (-1 for ranks there is no connection to) */
+      SocketFabric(int rank, int numRanks, const std::vector<int> &sockets);
+
+      /*! finishes the queued sends and closes the sockets */
+      ~SocketFabric() override;
+
+      /*! connect a worker to the root listening at 'address' (see
+        SocketListener) */
+      static std::shared_ptr<SocketFabric> connect(const std::string &address,
+                                                   int rank);
+
+      int rank() const;
+      int numRanks() const;
+
+      /*! send to all workers; only on the root */
+      void sendBcast(
+          std::shared_ptr<utility::AbstractArray<uint8_t>> buf) override;
+
+      /*! wait until all queued sends (not only broadcasts) are written */
+      void flushBcastSends() override;
+
+      /*! receive a broadcast from the root; only on the workers */
+      void recvBcast(utility::AbstractArray<uint8_t> &buf) override;
+
+      void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+                int rank) override;
+
+      void recv(utility::AbstractArray<uint8_t> &buf, int rank) override;
+
+      /*! queued like send(), then written with writev() without copying
+        the shared segments */
+      void sendSegments(const IOVecWriter &data, int rank) override;
+
+      /*! read by the receive thread, started on the first call, as the
+        bytes arrive on any of the sockets */
+      tasking::Future<std::shared_ptr<utility::AbstractArray<uint8_t>>>
+      recvAsync(size_t size, int rank) override;
+
+      /*! recvAsync() from the root; only on the workers */
+      tasking::Future<std::shared_ptr<utility::AbstractArray<uint8_t>>>
+      recvBcastAsync(size_t size) override;
+
+     private:
+      struct Outgoing
+      {
+        int fd;
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buffer;
+        std::shared_ptr<IOVecWriter> segments;
+      };
+
+      struct AsyncRecv
+      {
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buffer;
+        size_t received;
+        tasking::Promise<std::shared_ptr<utility::AbstractArray<uint8_t>>>
+            promise;
+      };
+
+      int socketTo(int rank) const;
+      void enqueue(Outgoing outgoing);
+      void ioLoop();
+      void recvLoop();
+      void wakeRecvLoop();
+      void failAsyncRecvs(std::exception_ptr error);
+
+      const int myRank;
+      const int ranks;
+      std::vector<int> sockets;
+
+      std::mutex mutex;
+      std::condition_variable changed;
+      std::deque<Outgoing> queue;
+      size_t pending{0};  // queued or being written
+      std::exception_ptr error;
+      bool stopping{false};
+      std::thread ioThread;
+
+      std::once_flag recvStarted;
+      std::mutex recvMutex;
+      std::vector<std::deque<AsyncRecv>> asyncRecvs;  // per rank
+      std::exception_ptr recvError;
+      bool recvStopping{false};
+      int wakeupPipe[2]{-1, -1};  // wakes up the receive thread
+      std::thread recvThread;
+    };
+
+    /*! the root's end of setting up a SocketFabric: listens at 'address',
+      which is either "host:port" (port 0 picks a free one) or
+      "unix:/path/to/socket" */
+    struct RKCOMMON_INTERFACE SocketListener
+    {
+      explicit SocketListener(const std::string &address);
+      ~SocketListener();
+
+      /*! the address the workers connect to, with the port picked */
+      std::string address() const;
+
+      /*! wait for the workers of ranks 1 to 'numWorkers' to connect */
+      std::shared_ptr<SocketFabric> accept(int numWorkers);
+
+     private:
+      int fd{-1};
+      std::string boundAddress;
+      std::string unixPath;
+    };
+
+    /*! a stream socket connected to 'address', in the formats of
+      SocketListener, for protocols of their own over the same addresses */
+    RKCOMMON_INTERFACE int connectSocket(const std::string &address);
+
+  }  // namespace networking
+}  // namespace rkcommon
+
+#endif
@@ -0,0 +1,811 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "AsyncFile.h"
+// std
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define RKCOMMON_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace rkcommon {
+
+  namespace detail {
+
+#ifdef _WIN32
+    using FileHandle                  = HANDLE;
+    static const FileHandle NO_HANDLE = INVALID_HANDLE_VALUE;
+#else
+    using FileHandle                  = int;
+    static const FileHandle NO_HANDLE = -1;
+#endif
+
+    // the largest transfer of one system call; longer requests are split
+    static const size_t MAX_TRANSFER = size_t(1) << 30;
+
+    struct AsyncFileRequest
+    {
+#ifdef _WIN32
+      struct Overlapped : public OVERLAPPED
+      {
+        AsyncFileRequest *request;
+      };
+
+      Overlapped overlapped;
+#else
+      struct iovec iov;
+#endif
+      bool write;
+      uint8_t *data;
+      size_t size;
+      uint64_t offset;
+      size_t done;
+      bool direct;  // through the unbuffered handle
+      tasking::Promise<size_t> promise;
+
+      uint8_t *next() const
+      {
+        return data + done;
+      }
+
+      size_t nextSize() const
+      {
+        return std::min(size - done, MAX_TRANSFER);
+      }
+
+      uint64_t nextOffset() const
+      {
+        return offset + done;
+      }
+    };
+
+    static std::string systemError()
+    {
+#ifdef _WIN32
+      char message[256];
+      const DWORD length = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM
+                                              | FORMAT_MESSAGE_IGNORE_INSERTS,
+                                          nullptr,
+                                          GetLastError(),
+                                          0,
+                                          message,
+                                          sizeof(message),
+                                          nullptr);
+      return std::string(message, length);
+#else
+      return std::strerror(errno);
+#endif
+    }
+
+    /* the open file and the bookkeeping of the requests in flight; the
+       backends start the transfers, and report them to progress() */
+    struct AsyncFileBackend
+    {
+      AsyncFileBackend(const FileName &fileName,
+                       AsyncFile::Mode mode,
+                       const AsyncFileOptions &options);
+
+      virtual ~AsyncFileBackend();
+
+      virtual const char *name() const = 0;
+
+      void submit(bool write,
+                  void *data,
+                  size_t size,
+                  uint64_t offset,
+                  const tasking::Promise<size_t> &promise);
+
+      void wait();
+
+      FileHandle handle(const AsyncFileRequest &r) const
+      {
+        return r.direct ? directHandle : fileHandle;
+      }
+
+      FileHandle fileHandle{NO_HANDLE};
+      FileHandle directHandle{NO_HANDLE};
+
+     protected:
+      // start the transfer of the rest of 'r'
+      virtual void start(AsyncFileRequest *r) = 0;
+
+      // after 'r' transferred 'bytes' more, 0 at the end of the file
+      void progress(AsyncFileRequest *r, size_t bytes);
+
+      void fail(AsyncFileRequest *r, const std::string &error);
+
+     private:
+      // after its promise is set
+      void finish(AsyncFileRequest *r);
+
+      std::string fileName;
+      const unsigned int queueDepth;
+
+      std::mutex mutex;
+      std::condition_variable changed;
+      unsigned int inFlight{0};
+    };
+
+#ifdef _WIN32
+
+    static HANDLE openFile(const FileName &fileName,
+                           AsyncFile::Mode mode,
+                           bool create,
+                           DWORD flags)
+    {
+      const DWORD access = mode == AsyncFile::READ ? GENERIC_READ
+          : mode == AsyncFile::WRITE               ? GENERIC_WRITE
+                                     : GENERIC_READ | GENERIC_WRITE;
+      const DWORD disposition = !create ? OPEN_EXISTING
+          : mode == AsyncFile::WRITE    ? CREATE_ALWAYS
+                                        : OPEN_ALWAYS;
+      return CreateFileA(fileName.c_str(),
+                         access,
+                         FILE_SHARE_READ | FILE_SHARE_WRITE,
+                         nullptr,
+                         disposition,
+                         FILE_ATTRIBUTE_NORMAL | flags,
+                         nullptr);
+    }
+
+    AsyncFileBackend::AsyncFileBackend(const FileName &fileName,
+                                       AsyncFile::Mode mode,
+                                       const AsyncFileOptions &options)
+        : fileName(fileName.str()),
+          queueDepth(std::max(options.queueDepth, 1u))
+    {
+      fileHandle = openFile(fileName, mode, true, FILE_FLAG_OVERLAPPED);
+      if (fileHandle == NO_HANDLE) {
+        throw std::runtime_error("AsyncFile: could not open '"
+                                 + fileName.str() + "': " + systemError());
+      }
+      if (options.direct) {
+        directHandle = openFile(fileName,
+                                mode,
+                                false,
+                                FILE_FLAG_OVERLAPPED
+                                    | FILE_FLAG_NO_BUFFERING);
+      }
+    }
+
+    AsyncFileBackend::~AsyncFileBackend()
+    {
+      if (directHandle != NO_HANDLE)
+        CloseHandle(directHandle);
+      CloseHandle(fileHandle);
+    }
+
+#else
+
+    AsyncFileBackend::AsyncFileBackend(const FileName &fileName,
+                                       AsyncFile::Mode mode,
+                                       const AsyncFileOptions &options)
+        : fileName(fileName.str()),
+          queueDepth(std::max(options.queueDepth, 1u))
+    {
+      const int access = mode == AsyncFile::READ ? O_RDONLY
+          : mode == AsyncFile::WRITE             ? O_WRONLY
+                                                 : O_RDWR;
+      const int create = mode == AsyncFile::READ ? 0
+          : mode == AsyncFile::WRITE             ? O_CREAT | O_TRUNC
+                                                 : O_CREAT;
+
+      fileHandle = open(fileName.c_str(), access | create | O_CLOEXEC, 0666);
+      if (fileHandle == NO_HANDLE) {
+        throw std::runtime_error("AsyncFile: could not open '"
+                                 + fileName.str() + "': " + systemError());
+      }
+
+      // file systems without O_DIRECT (e.g. tmpfs) fail with EINVAL, and
+      // the file is then only used through the page cache
+      if (options.direct) {
+#if defined(O_DIRECT)
+        directHandle = open(fileName.c_str(), access | O_CLOEXEC | O_DIRECT);
+#elif defined(F_NOCACHE)
+        directHandle = open(fileName.c_str(), access | O_CLOEXEC);
+        if (directHandle != NO_HANDLE && fcntl(directHandle, F_NOCACHE, 1)) {
+          close(directHandle);
+          directHandle = NO_HANDLE;
+        }
+#endif
+      }
+    }
+
+    AsyncFileBackend::~AsyncFileBackend()
+    {
+      if (directHandle != NO_HANDLE)
+        close(directHandle);
+      close(fileHandle);
+    }
+
+#endif
+
+    void AsyncFileBackend::submit(bool write,
+                                  void *data,
+                                  size_t size,
+                                  uint64_t offset,
+                                  const tasking::Promise<size_t> &promise)
+    {
+      const size_t alignment = AsyncFile::directAlignment();
+
+      std::unique_ptr<AsyncFileRequest> r(new AsyncFileRequest);
+      r->write   = write;
+      r->data    = static_cast<uint8_t *>(data);
+      r->size    = size;
+      r->offset  = offset;
+      r->done    = 0;
+      r->direct  = directHandle != NO_HANDLE && size % alignment == 0
+          && offset % alignment == 0 && uintptr_t(data) % alignment == 0;
+      r->promise = promise;
+
+      if (size == 0) {
+        promise.setValue(0);
+        return;
+      }
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return inFlight < queueDepth; });
+        inFlight++;
+      }
+
+      start(r.release());
+    }
+
+    void AsyncFileBackend::wait()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&]() { return inFlight == 0; });
+    }
+
+    void AsyncFileBackend::progress(AsyncFileRequest *r, size_t bytes)
+    {
+      if (bytes == 0 && r->write) {
+        fail(r, "nothing written");
+        return;
+      }
+
+      r->done += bytes;
+      if (r->done == r->size || (bytes == 0 && !r->direct)) {
+        r->promise.setValue(r->done);
+        finish(r);
+        return;
+      }
+
+      // the rest of a partial transfer is no longer aligned, and an
+      // unbuffered read past the end of the file stops at a block boundary
+      // rather than at the end of the file
+      r->direct = false;
+      start(r);
+    }
+
+    void AsyncFileBackend::fail(AsyncFileRequest *r, const std::string &error)
+    {
+      r->promise.setException(std::make_exception_ptr(std::runtime_error(
+          std::string("AsyncFile: could not ")
+          + (r->write ? "write to '" : "read from '") + fileName
+          + "': " + error)));
+      finish(r);
+    }
+
+    void AsyncFileBackend::finish(AsyncFileRequest *r)
+    {
+      delete r;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      inFlight--;
+      changed.notify_all();
+    }
+
+#ifndef _WIN32
+
+    // Threads ////////////////////////////////////////////////////////////////
+
+    /* a few threads taking turns at a queue of requests, each done with
+       pread()/pwrite() until complete */
+    struct ThreadBackend : public AsyncFileBackend
+    {
+      ThreadBackend(const FileName &fileName,
+                    AsyncFile::Mode mode,
+                    const AsyncFileOptions &options)
+          : AsyncFileBackend(fileName, mode, options)
+      {
+        const unsigned int numThreads =
+            std::max(std::min(options.queueDepth, 4u), 1u);
+        for (unsigned int i = 0; i < numThreads; i++)
+          threads.emplace_back([&]() { run(); });
+      }
+
+      ~ThreadBackend() override
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          stopping = true;
+        }
+        changed.notify_all();
+        for (auto &t : threads)
+          t.join();
+      }
+
+      const char *name() const override
+      {
+        return "threads";
+      }
+
+     protected:
+      void start(AsyncFileRequest *r) override
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          queue.push_back(r);
+        }
+        changed.notify_one();
+      }
+
+     private:
+      void run()
+      {
+        while (AsyncFileRequest *r = next())
+          transfer(r);
+      }
+
+      // nullptr once stopping
+      AsyncFileRequest *next()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return stopping || !queue.empty(); });
+        if (queue.empty())
+          return nullptr;
+        AsyncFileRequest *r = queue.front();
+        queue.pop_front();
+        return r;
+      }
+
+      void transfer(AsyncFileRequest *r)
+      {
+        ssize_t result;
+        do {
+          result = r->write ? pwrite(handle(*r),
+                                     r->next(),
+                                     r->nextSize(),
+                                     off_t(r->nextOffset()))
+                            : pread(handle(*r),
+                                    r->next(),
+                                    r->nextSize(),
+                                    off_t(r->nextOffset()));
+        } while (result < 0 && errno == EINTR);
+
+        // progress() starts the rest of a partial transfer, which queues it
+        // again rather than going on here
+        if (result < 0)
+          fail(r, systemError());
+        else
+          progress(r, size_t(result));
+      }
+
+      std::mutex mutex;
+      std::condition_variable changed;
+      std::deque<AsyncFileRequest *> queue;
+      bool stopping{false};
+      std::vector<std::thread> threads;
+    };
+
+#endif
+
+#ifdef RKCOMMON_HAVE_IO_URING
+
+    // io_uring ///////////////////////////////////////////////////////////////
+
+    /* one submission and completion ring per file, set up with the raw
+       system calls rather than liburing; submissions go in under a lock from
+       any thread, and one thread waits for and handles the completions. The
+       queue depth bounds the requests in flight, so neither ring overflows.
+       Readv and writev are used as they are there since the first kernels
+       with io_uring (5.1). */
+    struct UringBackend : public AsyncFileBackend
+    {
+      UringBackend(const FileName &fileName,
+                   AsyncFile::Mode mode,
+                   const AsyncFileOptions &options)
+          : AsyncFileBackend(fileName, mode, options)
+      {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring = int(syscall(__NR_io_uring_setup,
+                           std::max(options.queueDepth, 1u),
+                           &params));
+        if (ring < 0)
+          return;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize =
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+          sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+        sqRing = map(sqRingSize, IORING_OFF_SQ_RING);
+        cqRing = params.features & IORING_FEAT_SINGLE_MMAP
+            ? sqRing
+            : map(cqRingSize, IORING_OFF_CQ_RING);
+        sqes = static_cast<io_uring_sqe *>(map(sqesSize, IORING_OFF_SQES));
+        if (!sqRing || !cqRing || !sqes) {
+          unmap();
+          return;
+        }
+
+        uint8_t *sq = static_cast<uint8_t *>(sqRing);
+        sqTail      = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sqArray     = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        uint8_t *cq = static_cast<uint8_t *>(cqRing);
+        cqHead      = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cqTail      = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes   = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        completionThread = std::thread([&]() { complete(); });
+      }
+
+      // io_uring_setup() fails on kernels without it, or where it is turned
+      // off (kernel.io_uring_disabled) or filtered out (seccomp)
+      bool valid() const
+      {
+        return completionThread.joinable();
+      }
+
+      ~UringBackend() override
+      {
+        if (valid()) {
+          // a request without one to wake up and stop the completion thread
+          push(IORING_OP_NOP, NO_HANDLE, nullptr, 0, 0);
+          completionThread.join();
+        }
+        unmap();
+      }
+
+      const char *name() const override
+      {
+        return "io_uring";
+      }
+
+     protected:
+      void start(AsyncFileRequest *r) override
+      {
+        r->iov.iov_base = r->next();
+        r->iov.iov_len  = r->nextSize();
+        push(r->write ? IORING_OP_WRITEV : IORING_OP_READV,
+             handle(*r),
+             &r->iov,
+             r->nextOffset(),
+             uint64_t(uintptr_t(r)));
+      }
+
+     private:
+      void *map(size_t size, off_t offset)
+      {
+        void *p = mmap(nullptr,
+                       size,
+                       PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE,
+                       ring,
+                       offset);
+        return p == MAP_FAILED ? nullptr : p;
+      }
+
+      // Safe to call again, the destructor does after a failed constructor
+      void unmap()
+      {
+        if (sqes)
+          munmap(sqes, sqesSize);
+        if (cqRing && cqRing != sqRing)
+          munmap(cqRing, cqRingSize);
+        if (sqRing)
+          munmap(sqRing, sqRingSize);
+        if (ring >= 0)
+          close(ring);
+        sqes   = nullptr;
+        cqRing = nullptr;
+        sqRing = nullptr;
+        ring   = -1;
+      }
+
+      void push(uint8_t opcode,
+                int fd,
+                const struct iovec *iov,
+                uint64_t offset,
+                uint64_t userData)
+      {
+        std::lock_guard<std::mutex> lock(submitMutex);
+
+        const unsigned tail = *sqTail;
+        const unsigned i    = tail & sqMask;
+        io_uring_sqe &sqe   = sqes[i];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode    = opcode;
+        sqe.fd        = fd;
+        sqe.off       = offset;
+        sqe.addr      = uint64_t(uintptr_t(iov));
+        sqe.len       = iov ? 1 : 0;
+        sqe.user_data = userData;
+        sqArray[i]    = i;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        while (syscall(__NR_io_uring_enter, ring, 1, 0, 0, nullptr, 0) < 0
+               && (errno == EINTR || errno == EAGAIN))
+          ;
+      }
+
+      void complete()
+      {
+        for (;;) {
+          const unsigned head = *cqHead;
+          if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            syscall(__NR_io_uring_enter,
+                    ring,
+                    0,
+                    1,
+                    IORING_ENTER_GETEVENTS,
+                    nullptr,
+                    0);
+            continue;
+          }
+
+          const io_uring_cqe cqe = cqes[head & cqMask];
+          __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+
+          if (cqe.user_data == 0)
+            return;
+
+          auto *r = reinterpret_cast<AsyncFileRequest *>(
+              uintptr_t(cqe.user_data));
+          if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+            start(r);
+          else if (cqe.res < 0)
+            fail(r, std::strerror(-cqe.res));
+          else
+            progress(r, size_t(cqe.res));
+        }
+      }
+
+      int ring{-1};
+      void *sqRing{nullptr};
+      void *cqRing{nullptr};
+      io_uring_sqe *sqes{nullptr};
+      size_t sqRingSize{0};
+      size_t cqRingSize{0};
+      size_t sqesSize{0};
+
+      unsigned *sqTail{nullptr};
+      unsigned sqMask{0};
+      unsigned *sqArray{nullptr};
+      unsigned *cqHead{nullptr};
+      unsigned *cqTail{nullptr};
+      unsigned cqMask{0};
+      io_uring_cqe *cqes{nullptr};
+
+      std::mutex submitMutex;
+      std::thread completionThread;
+    };
+
+#endif
+
+#ifdef _WIN32
+
+    // Overlapped I/O /////////////////////////////////////////////////////////
+
+    /* the transfers are started with ReadFile()/WriteFile() on the
+       overlapped handles, and one thread waits for their completions on an
+       I/O completion port */
+    struct OverlappedBackend : public AsyncFileBackend
+    {
+      OverlappedBackend(const FileName &fileName,
+                        AsyncFile::Mode mode,
+                        const AsyncFileOptions &options)
+          : AsyncFileBackend(fileName, mode, options)
+      {
+        port = CreateIoCompletionPort(fileHandle, nullptr, 1, 1);
+        if (!port) {
+          throw std::runtime_error(
+              "AsyncFile: could not create an I/O completion port: "
+              + systemError());
+        }
+        if (directHandle != NO_HANDLE
+            && !CreateIoCompletionPort(directHandle, port, 1, 1)) {
+          CloseHandle(directHandle);
+          directHandle = NO_HANDLE;
+        }
+
+        completionThread = std::thread([&]() { complete(); });
+      }
+
+      ~OverlappedBackend() override
+      {
+        // a completion with key 0 stops the completion thread
+        PostQueuedCompletionStatus(port, 0, 0, nullptr);
+        completionThread.join();
+        CloseHandle(port);
+      }
+
+      const char *name() const override
+      {
+        return "overlapped";
+      }
+
+     protected:
+      void start(AsyncFileRequest *r) override
+      {
+        auto &o = r->overlapped;
+        std::memset(&o, 0, sizeof(OVERLAPPED));
+        o.Offset     = DWORD(r->nextOffset());
+        o.OffsetHigh = DWORD(r->nextOffset() >> 32);
+        o.request    = r;
+
+        const BOOL ok = r->write ? WriteFile(handle(*r),
+                                             r->next(),
+                                             DWORD(r->nextSize()),
+                                             nullptr,
+                                             &o)
+                                 : ReadFile(handle(*r),
+                                            r->next(),
+                                            DWORD(r->nextSize()),
+                                            nullptr,
+                                            &o);
+
+        // also transfers done right away are reported to the port
+        if (!ok) {
+          const DWORD error = GetLastError();
+          if (error == ERROR_HANDLE_EOF)
+            progress(r, 0);
+          else if (error != ERROR_IO_PENDING)
+            fail(r, systemError());
+        }
+      }
+
+     private:
+      void complete()
+      {
+        for (;;) {
+          DWORD bytes   = 0;
+          ULONG_PTR key = 0;
+          OVERLAPPED *o = nullptr;
+          const BOOL ok = GetQueuedCompletionStatus(
+              port, &bytes, &key, &o, INFINITE);
+          if (key == 0)
+            return;
+          if (!o)
+            continue;
+
+          AsyncFileRequest *r =
+              static_cast<AsyncFileRequest::Overlapped *>(o)->request;
+          if (ok || GetLastError() == ERROR_HANDLE_EOF)
+            progress(r, bytes);
+          else
+            fail(r, systemError());
+        }
+      }
+
+      HANDLE port{nullptr};
+      std::thread completionThread;
+    };
+
+#endif
+
+    static std::unique_ptr<AsyncFileBackend> makeBackend(
+        const FileName &fileName,
+        AsyncFile::Mode mode,
+        const AsyncFileOptions &options)
+    {
+#ifdef _WIN32
+      return std::unique_ptr<AsyncFileBackend>(
+          new OverlappedBackend(fileName, mode, options));
+#else
+#ifdef RKCOMMON_HAVE_IO_URING
+      if (!options.useThreads) {
+        std::unique_ptr<UringBackend> uring(
+            new UringBackend(fileName, mode, options));
+        if (uring->valid())
+          return std::unique_ptr<AsyncFileBackend>(uring.release());
+      }
+#endif
+      return std::unique_ptr<AsyncFileBackend>(
+          new ThreadBackend(fileName, mode, options));
+#endif
+    }
+
+  }  // namespace detail
+
+  AsyncFile::AsyncFile(const FileName &fileName,
+                       Mode mode,
+                       const AsyncFileOptions &options)
+      : impl(detail::makeBackend(fileName, mode, options))
+  {
+  }
+
+  AsyncFile::~AsyncFile()
+  {
+    impl->wait();
+  }
+
+  tasking::Future<size_t> AsyncFile::readAt(void *data,
+                                            size_t size,
+                                            uint64_t offset)
+  {
+    tasking::Promise<size_t> promise;
+    impl->submit(false, data, size, offset, promise);
+    return promise.getFuture();
+  }
+
+  tasking::Future<size_t> AsyncFile::writeAt(const void *data,
+                                             size_t size,
+                                             uint64_t offset)
+  {
+    tasking::Promise<size_t> promise;
+    impl->submit(true, const_cast<void *>(data), size, offset, promise);
+    return promise.getFuture();
+  }
+
+  void AsyncFile::wait()
+  {
+    impl->wait();
+  }
+
+  uint64_t AsyncFile::size() const
+  {
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(impl->fileHandle, &size))
+      throw std::runtime_error("AsyncFile: " + detail::systemError());
+    return uint64_t(size.QuadPart);
+#else
+    struct stat info;
+    if (fstat(impl->fileHandle, &info))
+      throw std::runtime_error("AsyncFile: " + detail::systemError());
+    return uint64_t(info.st_size);
+#endif
+  }
+
+  const char *AsyncFile::backend() const
+  {
+    return impl->name();
+  }
+
+  bool AsyncFile::isDirect() const
+  {
+    return impl->directHandle != detail::NO_HANDLE;
+  }
+
+  size_t AsyncFile::directAlignment()
+  {
+    // the largest logical block size in common use (4Kn drives), which
+    // also satisfies 512-byte sector devices
+    return 4096;
+  }
+
+}  // namespace rkcommon
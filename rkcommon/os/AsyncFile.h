@@ -0,0 +1,96 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+#include "../tasking/Future.h"
+#include "FileName.h"
+// std
+#include <cstdint>
+#include <memory>
+
+namespace rkcommon {
+
+  namespace detail {
+    struct AsyncFileBackend;
+  }  // namespace detail
+
+  struct AsyncFileOptions
+  {
+    // open the file once more unbuffered (O_DIRECT, FILE_FLAG_NO_BUFFERING)
+    // and use that for the requests whose buffer, offset and size are all
+    // multiples of AsyncFile::directAlignment(), e.g. large sequential
+    // reads which would only evict everything else from the page cache;
+    // ignored where the file system does not support it
+    bool direct{false};
+    // the portable thread pool backend, also where io_uring or overlapped
+    // I/O is available
+    bool useThreads{false};
+    // requests in flight at once; further ones wait for a free slot
+    unsigned int queueDepth{64};
+  };
+
+  /*! Positioned reads and writes which return right away, with a future
+    of the number of bytes transferred:
+
+      AsyncFile file("volume.raw", AsyncFile::READ);
+      auto header = file.readAt(&h, sizeof(h), 0);
+      auto slab   = file.readAt(voxels, slabBytes, sizeof(h));
+      header.get();  // waits, rethrowing errors of the read
+
+    The requests go to io_uring on Linux, to overlapped I/O on an I/O
+    completion port on Windows, and to a few threads doing pread()/pwrite()
+    elsewhere (or where the kernel does not allow io_uring). They may
+    complete in any order; the buffers have to stay valid until they have.
+    A read returns fewer bytes than asked for only at the end of the file;
+    a write is complete or fails. The futures are fulfilled on the
+    completion thread, so work on the data belongs in then() rather than
+    in onReady(). */
+  class RKCOMMON_INTERFACE AsyncFile
+  {
+   public:
+    enum Mode
+    {
+      READ,        // an existing file
+      WRITE,       // created, or truncated if it exists
+      READ_WRITE,  // created if it does not exist
+    };
+
+    AsyncFile(const FileName &fileName,
+              Mode mode,
+              const AsyncFileOptions &options = AsyncFileOptions());
+
+    /*! waits for the requests in flight, then closes the file */
+    ~AsyncFile();
+
+    AsyncFile(const AsyncFile &) = delete;
+    AsyncFile &operator=(const AsyncFile &) = delete;
+
+    tasking::Future<size_t> readAt(void *data, size_t size, uint64_t offset);
+
+    tasking::Future<size_t> writeAt(const void *data,
+                                    size_t size,
+                                    uint64_t offset);
+
+    /*! wait for the requests in flight */
+    void wait();
+
+    /*! the size of the file now, including completed writes */
+    uint64_t size() const;
+
+    /*! "io_uring", "overlapped" or "threads" */
+    const char *backend() const;
+
+    /*! whether requests with aligned buffers, offsets and sizes go around
+      the page cache */
+    bool isDirect() const;
+
+    /*! the alignment of unbuffered requests, see AsyncFileOptions::direct */
+    static size_t directAlignment();
+
+   private:
+    std::unique_ptr<detail::AsyncFileBackend> impl;
+  };
+
+}  // namespace rkcommon
@@ -3,8 +3,12 @@
 
 #include "library.h"
 #include "FileName.h"
+#include "../tasking/async.h"
+#include "../tasking/parallel_for.h"
+#include "../tracing/Tracing.h"
 
 #include <algorithm>
+#include <exception>
 
 #ifndef _WIN32
 #include <dlfcn.h>
@@ -113,28 +117,47 @@ namespace {
   #endif
   }
 
+  // library_location() once per anchor, which is mostly the same one for all
+  // libraries of an application
+  std::string cached_library_location(const void *address)
+  {
+    static std::mutex mutex;
+    static std::unordered_map<const void *, std::string> locations;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto location = locations.find(address);
+    if (location == locations.end())
+      location = locations.emplace(address, library_location(address)).first;
+    return location->second;
+  }
+
 }  // namespace
 
 namespace rkcommon {
 
   Library::Library(
       const void *anchorAddress, const std::string &name, const Version &version)
-      : libraryName(name), libraryVersion(version)
+      : Library(anchorAddress, name, version, LibraryOptions())
   {
-    bool success = false;
+  }
 
+  Library::Library(const void *anchorAddress,
+                   const std::string &name,
+                   const Version &version,
+                   const LibraryOptions &options)
+      : libraryName(name), libraryVersion(version), options(options)
+  {
     try {
-      success = loadLibrary(anchorAddress);
+      if (anchorAddress != nullptr)
+        libraryLocation = cached_library_location(anchorAddress);
     } catch (const std::exception &e) {
       // handle exceptions from e.g. library_location()
       throw std::runtime_error(
           "Load of " + name + " failed due to: '" + e.what() + "'");
     }
 
-    if (!success) {
-      throw std::runtime_error(
-          "Load of " + name + " failed due to: '" + errorMessage + "'");
-    }
+    if (!options.deferred)
+      open();
   }
 
   Library::Library(void *const _lib)
@@ -142,18 +165,32 @@ namespace rkcommon {
   {
   }
 
-  bool Library::loadLibrary(const void *anchorAddress)
+  void Library::open() const
+  {
+    if (lib.load(std::memory_order_acquire) != nullptr)
+      return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (lib.load(std::memory_order_relaxed) == nullptr && !loadLibrary()) {
+      throw std::runtime_error(
+          "Load of " + libraryName + " failed due to: '" + errorMessage + "'");
+    }
+  }
+
+  bool Library::loadLibrary() const
   {
+#ifdef RKCOMMON_ENABLE_PROFILING
+    tracing::TraceScope trace(("load " + libraryName).c_str(), "library");
+#endif
+
     std::string file = libraryName;
     std::string errorMsg;
-    std::string libLocation = anchorAddress != nullptr
-        ? library_location(anchorAddress)
-        : std::string();
+    void *handle = nullptr;
 
 #ifdef _WIN32
-    std::string fullName = libLocation + file + ".dll";
-    lib                  = LoadLibrary(fullName.c_str());
-    if (lib == nullptr) {
+    std::string fullName = libraryLocation + file + ".dll";
+    handle               = LoadLibrary(fullName.c_str());
+    if (handle == nullptr) {
       DWORD err = GetLastError();
       LPTSTR lpMsgBuf;
       FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER |
@@ -175,24 +212,26 @@ namespace rkcommon {
     for (int i: libraryVersion)
       versionStr += "." + std::to_string(i);
 
-    std::string fullName = libLocation + "lib" + file;
+    std::string fullName = libraryLocation + "lib" + file;
 #if defined(__MACOSX__) || defined(__APPLE__)
     fullName += versionStr + ".dylib";
 #else
     fullName += ".so" + versionStr;
 #endif
 
-    lib = dlopen(fullName.c_str(), RTLD_LAZY | RTLD_LOCAL);
-    if (lib == nullptr)
+    const int binding = options.lazyBinding ? RTLD_LAZY : RTLD_NOW;
+    handle = dlopen(fullName.c_str(), binding | RTLD_LOCAL);
+    if (handle == nullptr)
       errorMsg = dlerror();
 #endif
 
-    if (lib == nullptr) {
+    if (handle == nullptr) {
       errorMessage =
           "could not open module lib " + libraryName + ": " + errorMsg;
       return false;
     }
 
+    lib.store(handle, std::memory_order_release);
     return true;
   }
 
@@ -203,11 +242,12 @@ namespace rkcommon {
      * at exit (see https://github.com/google/sanitizers/issues/89)
      */
 #ifndef RKCOMMON_ADDRSAN
-    if (freeLibOnDelete && lib) {
+    void *handle = lib.load();
+    if (freeLibOnDelete && handle) {
 #ifdef _WIN32
-      FreeLibrary((HMODULE)lib);
+      FreeLibrary((HMODULE)handle);
 #else
-      dlclose(lib);
+      dlclose(handle);
 #endif
     }
 #endif
@@ -215,15 +255,25 @@ namespace rkcommon {
 
   void *Library::getSymbol(const std::string &sym) const
   {
+    open();
+    void *handle = lib.load(std::memory_order_relaxed);
 #ifdef _WIN32
-    return GetProcAddress((HMODULE)lib, sym.c_str());
+    return GetProcAddress((HMODULE)handle, sym.c_str());
 #else
-    return dlsym(lib, sym.c_str());
+    return dlsym(handle, sym.c_str());
 #endif
   }
 
+  bool Library::isOpen() const
+  {
+    return lib.load(std::memory_order_acquire) != nullptr;
+  }
+
   std::unique_ptr<LibraryRepository> LibraryRepository::instance;
 
+  // starts past 0, which SymbolHandle uses for 'never resolved'
+  static std::atomic<uint64_t> libraryGeneration{1};
+
   LibraryRepository *LibraryRepository::getInstance()
   {
     if (instance.get() == nullptr)
@@ -235,6 +285,7 @@ namespace rkcommon {
   void LibraryRepository::cleanupInstance()
   {
     LibraryRepository::instance.reset();
+    libraryGeneration++;
   }
 
   LibraryRepository::~LibraryRepository()
@@ -247,34 +298,140 @@ namespace rkcommon {
 
   void LibraryRepository::add(const void *anchorAddress,
     const std::string &name, const Library::Version &version)
+  {
+    add(anchorAddress, name, version, LibraryOptions());
+  }
+
+  void LibraryRepository::add(const void *anchorAddress,
+                              const std::string &name,
+                              const Library::Version &version,
+                              const LibraryOptions &options)
   {
     if (libraryExists(name))
       return; // lib already loaded.
 
-    repo.push_back(rkcommon::make_unique<Library>(
-      anchorAddress, name, version));
+    // opened outside the lock, which lookups of other threads need
+    auto lib =
+        rkcommon::make_unique<Library>(anchorAddress, name, version, options);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (findLibrary(name) != repo.end())
+      return;
+    repo.push_back(std::move(lib));
+    symbols.clear();
+    libraryGeneration++;
+  }
+
+  void LibraryRepository::add(const void *anchorAddress,
+                              const std::vector<std::string> &names,
+                              const LibraryOptions &options)
+  {
+    std::vector<std::string> missing;
+    for (const auto &name : names) {
+      if (!libraryExists(name)
+          && std::find(missing.begin(), missing.end(), name) == missing.end())
+        missing.push_back(name);
+    }
+
+    // how much of the loading the system loader lets run in parallel varies,
+    // but the lookups of each library's location and dependencies do
+    std::vector<std::unique_ptr<Library>> libs(missing.size());
+    std::vector<std::exception_ptr> errors(missing.size());
+    tasking::parallel_for(missing.size(), [&](size_t i) {
+      try {
+        libs[i] = rkcommon::make_unique<Library>(
+            anchorAddress, missing[i], Library::Version(), options);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto &lib : libs) {
+        if (lib && findLibrary(lib->libraryName) == repo.end())
+          repo.push_back(std::move(lib));
+      }
+      symbols.clear();
+      libraryGeneration++;
+    }
+
+    for (const auto &error : errors) {
+      if (error)
+        std::rethrow_exception(error);
+    }
   }
 
   void LibraryRepository::remove(const std::string &name)
   {
+    std::lock_guard<std::mutex> lock(mutex);
     auto lib = findLibrary(name);
     if (lib != repo.end()) {
       repo.erase(lib);
+      symbols.clear();
+      libraryGeneration++;
     }
   }
 
   void *LibraryRepository::getSymbol(const std::string &name) const
   {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookup(name);
+  }
+
+  void *LibraryRepository::getSymbol(
+      const std::string &name, uint64_t &generation) const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // add() and remove() hold the lock, so this is the generation of 'repo'
+    generation = libraryGeneration;
+    return lookup(name);
+  }
+
+  std::vector<void *> LibraryRepository::getSymbols(
+      const std::vector<std::string> &names) const
+  {
+    std::vector<void *> syms;
+    syms.reserve(names.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &name : names)
+      syms.push_back(lookup(name));
+    return syms;
+  }
+
+  uint64_t LibraryRepository::generation()
+  {
+    return libraryGeneration;
+  }
+
+  void *LibraryRepository::lookup(const std::string &name) const
+  {
+    auto cached = symbols.find(name);
+    if (cached != symbols.end())
+      return cached->second;
+
     void *sym = nullptr;
     for (auto lib = repo.cbegin(); sym == nullptr && lib != repo.end(); ++lib) {
       sym = (*lib)->getSymbol(name);
     }
 
+    symbols.emplace(name, sym);
     return sym;
   }
 
+  std::future<void> loadLibrariesAsync(const void *anchorAddress,
+                                       const std::vector<std::string> &names,
+                                       const LibraryOptions &options)
+  {
+    return tasking::async([=]() {
+      LibraryRepository::getInstance()->add(anchorAddress, names, options);
+    });
+  }
+
   bool LibraryRepository::libraryExists(const std::string &name) const
   {
+    std::lock_guard<std::mutex> lock(mutex);
     return findLibrary(name) != repo.end();
   }
 
@@ -3,8 +3,15 @@
 
 #include "../common.h"
 // std
+#include <atomic>
+#include <cstdint>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace rkcommon {
@@ -17,20 +24,32 @@ namespace rkcommon {
     // Opens a shared library; anchorAddress = nullptr will disable anchored loads
     Library(const void *anchorAddress,
       const std::string &name, const Version &version);
+    Library(const void *anchorAddress,
+            const std::string &name,
+            const Version &version,
+            const LibraryOptions &options);
     ~Library();
 
-    // Returns address of a symbol from the library
+    // Returns address of a symbol from the library, opening a deferred one
     void *getSymbol(const std::string &sym) const;
 
+    // False for a deferred library which no getSymbol() has opened yet
+    bool isOpen() const;
+
    private:
     Library(void *const lib);
 
-    bool loadLibrary(const void *anchorAddress);
+    // opens the library if not done yet, throwing if it fails
+    void open() const;
+    bool loadLibrary() const;
 
     std::string libraryName;
     Version libraryVersion;
-    std::string errorMessage;
-    void *lib{nullptr};
+    std::string libraryLocation;
+    LibraryOptions options;
+    mutable std::string errorMessage;
+    mutable std::mutex mutex;
+    mutable std::atomic<void *> lib{nullptr};
     bool freeLibOnDelete{true};
 
     friend class LibraryRepository;
@@ -53,11 +72,34 @@ namespace rkcommon {
     // add/remove a library to/from the repo
     void add(const void *anchorAddress,
       const std::string &name, const Library::Version &version = {});
+    void add(const void *anchorAddress,
+             const std::string &name,
+             const Library::Version &version,
+             const LibraryOptions &options);
+    // adds libraries in parallel on the task system, see loadLibraries()
+    void add(const void *anchorAddress,
+             const std::vector<std::string> &names,
+             const LibraryOptions &options = {});
     void remove(const std::string &name);
 
-    // Returns address of a symbol from any library in the repo
+    // Returns address of a symbol from any library in the repo; lookups are
+    // cached (also those which fail) until a library is added or removed
     void *getSymbol(const std::string &sym) const;
 
+    // Same as above, also returning the generation() the lookup was made in
+    void *getSymbol(const std::string &sym, uint64_t &generation) const;
+
+    // Returns a symbol as a function pointer, e.g. getSymbol<void(int)>()
+    template <typename FCN_T>
+    FCN_T *getSymbol(const std::string &sym) const;
+
+    // Resolves a batch of symbols under one lock, e.g. all entry points of a
+    // library right after loading it, in the order of 'syms'
+    std::vector<void *> getSymbols(const std::vector<std::string> &syms) const;
+
+    // Changes whenever a library is added or removed, or the repo cleaned up
+    static uint64_t generation();
+
     bool libraryExists(const std::string &name) const;
 
    private:
@@ -71,6 +113,89 @@ namespace rkcommon {
     static std::unique_ptr<LibraryRepository> instance;
     LibraryRepository() = default;
 
+    void *lookup(const std::string &sym) const;
+
     std::vector<std::unique_ptr<Library>> repo;
+
+    mutable std::mutex mutex;
+    mutable std::unordered_map<std::string, void *> symbols;
   };
+
+  // loadLibraries() in the background, e.g. while the application parses its
+  // arguments; the future throws the error of a library which failed
+  RKCOMMON_INTERFACE std::future<void> loadLibrariesAsync(
+      const void *anchorAddress,
+      const std::vector<std::string> &names,
+      const LibraryOptions &options = {});
+
+  /* A function from a loaded library, resolved on first use and again only
+     when the set of loaded libraries changes; meant to be a static at the
+     call site:
+
+       static SymbolHandle<Renderer *()> create("createRenderer");
+       Renderer *r = create();
+  */
+  template <typename FCN_T>
+  class SymbolHandle;
+
+  template <typename R, typename... Args>
+  class SymbolHandle<R(Args...)>
+  {
+   public:
+    explicit SymbolHandle(const std::string &name) : name(name) {}
+
+    SymbolHandle(const SymbolHandle &) = delete;
+    SymbolHandle &operator=(const SymbolHandle &) = delete;
+
+    // nullptr if no loaded library has the symbol
+    R (*get() const)(Args...);
+
+    explicit operator bool() const
+    {
+      return get() != nullptr;
+    }
+
+    R operator()(Args... args) const
+    {
+      auto fcn = get();
+      if (!fcn)
+        throw std::runtime_error("symbol '" + name + "' not found");
+      return fcn(std::forward<Args>(args)...);
+    }
+
+   private:
+    using Fcn = R(Args...);
+
+    std::string name;
+    mutable std::atomic<Fcn *> fcn{nullptr};
+    // generation() of the libraries 'fcn' was resolved in, 0 for never
+    mutable std::atomic<uint64_t> resolved{0};
+    mutable std::mutex mutex;
+  };
+
+  // Inlined LibraryRepository definitions ////////////////////////////////////
+
+  template <typename FCN_T>
+  inline FCN_T *LibraryRepository::getSymbol(const std::string &sym) const
+  {
+    return reinterpret_cast<FCN_T *>(getSymbol(sym));
+  }
+
+  // Inlined SymbolHandle definitions /////////////////////////////////////////
+
+  template <typename R, typename... Args>
+  inline R (*SymbolHandle<R(Args...)>::get() const)(Args...)
+  {
+    if (resolved.load(std::memory_order_acquire)
+        != LibraryRepository::generation()) {
+      // one resolution at a time, so 'fcn' and 'resolved' stay a pair
+      std::lock_guard<std::mutex> lock(mutex);
+      uint64_t current = 0;
+      void *sym =
+          LibraryRepository::getInstance()->getSymbol(name, current);
+      fcn.store(reinterpret_cast<Fcn *>(sym), std::memory_order_relaxed);
+      resolved.store(current, std::memory_order_release);
+    }
+    return fcn.load(std::memory_order_relaxed);
+  }
 }  // namespace rkcommon
@@ -71,6 +71,18 @@
 #define MAYBE_UNUSED
 #endif
 
+// whether __builtin_is_constant_evaluated() (std::is_constant_evaluated()
+// before C++20) is available, for constexpr functions with SIMD paths
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define RKCOMMON_HAS_IS_CONSTANT_EVALUATED
+#endif
+#elif defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 9
+#define RKCOMMON_HAS_IS_CONSTANT_EVALUATED
+#elif defined(_MSC_VER) && _MSC_VER >= 1925
+#define RKCOMMON_HAS_IS_CONSTANT_EVALUATED
+#endif
+
 #if defined(_MSC_VER) && !defined(__INTEL_COMPILER)
 #define likely(expr) (expr)
 #define unlikely(expr) (expr)
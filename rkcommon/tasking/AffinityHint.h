@@ -0,0 +1,141 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#ifdef RKCOMMON_TASKING_TBB
+#  define __TBB_NO_IMPLICIT_LINKAGE 1
+#  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#  include <tbb/partitioner.h>
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      /* Which thread ran which chunk of the last loop, for the Internal
+         backend. Threads first run the chunks they ran last time, then
+         take the ones left over by others, recording the new owner. */
+      struct AffinityRecord
+      {
+        size_t numUnits{0};
+        size_t chunkSize{1};
+        uint32_t numThreads{0};
+
+        std::vector<uint32_t> owner;
+        // chunks sorted by owner, those of thread t starting at firstChunk[t]
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> firstChunk;
+        std::unique_ptr<std::atomic<bool>[]> claimed;
+
+        size_t numChunks() const
+        {
+          return owner.size();
+        }
+
+        /* Plans a loop over 'units' on 'threads' threads, keeping the
+           recorded owners if the loop has the same shape as the last one,
+           else starting from contiguous blocks of chunks per thread */
+        void prepare(size_t units, uint32_t threads)
+        {
+          if (units != numUnits || threads != numThreads || owner.empty()) {
+            numUnits   = units;
+            numThreads = std::max(threads, 1u);
+
+            // a few chunks per thread leave room to balance the load
+            const size_t target = 4 * size_t(numThreads);
+            chunkSize           = (units + target - 1) / target;
+
+            const size_t chunks = (units + chunkSize - 1) / chunkSize;
+            owner.resize(chunks);
+            for (size_t c = 0; c < chunks; ++c)
+              owner[c] = uint32_t(c * numThreads / chunks);
+            order.resize(chunks);
+            claimed.reset(new std::atomic<bool>[chunks]);
+          }
+
+          // counting sort of the chunks by owner
+          firstChunk.assign(numThreads + 1, 0);
+          for (uint32_t t : owner)
+            firstChunk[t + 1]++;
+          for (uint32_t t = 0; t < numThreads; ++t)
+            firstChunk[t + 1] += firstChunk[t];
+          for (size_t c = 0; c < owner.size(); ++c) {
+            order[firstChunk[owner[c]]++] = uint32_t(c);
+            claimed[c].store(false, std::memory_order_relaxed);
+          }
+          for (uint32_t t = numThreads; t > 0; --t)
+            firstChunk[t] = firstChunk[t - 1];
+          firstChunk[0] = 0;
+        }
+
+        void reset()
+        {
+          numUnits = 0;
+          owner.clear();
+        }
+      };
+
+    }  // namespace detail
+
+    /*! Remembers which threads ran which parts of a parallel_for() or
+        parallel_in_blocks_of(), so that the next loop over the same number
+        of indices given the same hint hands each part to the same thread
+        again, which likely still has its data in cache; e.g. for solvers or
+        progressive renderers looping over the same data every iteration:
+
+          AffinityHint hint;
+          for (int frame = 0; ...)
+            parallel_for(numTiles, hint, [&](int i) { ... });
+
+        TBB uses a tbb::affinity_partitioner, the Internal backend replays
+        the recorded chunk to thread mapping (threads without work of their
+        own take chunks recorded for others) and OpenMP uses a static
+        schedule. Dynamic builds ignore the hint. A hint is meant for one
+        loop, it must not be used by loops running concurrently. */
+    class AffinityHint
+    {
+     public:
+      AffinityHint() = default;
+      AffinityHint(const AffinityHint &) = delete;
+      AffinityHint &operator=(const AffinityHint &) = delete;
+
+      // Forgets the recorded placement
+      void reset()
+      {
+        record.reset();
+#ifdef RKCOMMON_TASKING_TBB
+        partitioner.reset(new tbb::affinity_partitioner());
+#endif
+      }
+
+      // Used by the tasking implementation
+      detail::AffinityRecord &internalRecord()
+      {
+        return record;
+      }
+
+#ifdef RKCOMMON_TASKING_TBB
+      tbb::affinity_partitioner &tbbPartitioner()
+      {
+        return *partitioner;
+      }
+#endif
+
+     private:
+      detail::AffinityRecord record;
+#ifdef RKCOMMON_TASKING_TBB
+      std::unique_ptr<tbb::affinity_partitioner> partitioner{
+          new tbb::affinity_partitioner()};
+#endif
+    };
+
+  }  // namespace tasking
+}  // namespace rkcommon
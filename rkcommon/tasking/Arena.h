@@ -0,0 +1,73 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+#include "../utility/FunctionRef.h"
+#include "tasking_system_init.h"
+// std
+#include <functional>
+#include <memory>
+
+namespace rkcommon {
+  namespace tasking {
+
+    /*! An Arena is an isolated pool of worker threads with its own
+        concurrency limit and priority. Work submitted to an arena (through
+        execute(), or the Arena& overloads of parallel_for(), schedule() and
+        async()) only runs on the arena's threads plus the submitting thread,
+        so a long running job in one arena can't starve latency sensitive
+        work in another. Nested tasking calls made from inside the arena stay
+        in the arena.
+
+        Backend mapping:
+          TBB      -> tbb::task_arena
+          Internal -> a separate enkiTS scheduler (at least one worker thread)
+          OpenMP   -> nested parallel regions are limited to maxConcurrency
+                      threads; priority is a hint only
+          Debug    -> runs everything serially on the calling thread
+        A Dynamic build uses the backend current when the arena is created.
+
+        On hybrid CPUs 'coreType' keeps the arena's threads on one type of
+        core, e.g. PERFORMANCE for latency critical work. TBB needs its
+        tbbbind library to do so, OpenMP ignores it, and on homogeneous
+        systems or with UNKNOWN the threads may run on any core.
+     */
+    class RKCOMMON_INTERFACE Arena
+    {
+     public:
+      enum class Priority
+      {
+        LOW,
+        NORMAL,
+        HIGH
+      };
+
+      // maxConcurrency <= 0 uses the number of hardware threads
+      explicit Arena(int maxConcurrency = -1,
+                     Priority priority  = Priority::NORMAL,
+                     CoreType coreType  = CoreType::UNKNOWN);
+      ~Arena();
+
+      Arena(const Arena &) = delete;
+      Arena &operator=(const Arena &) = delete;
+
+      int maxConcurrency() const;
+      Priority priority() const;
+      CoreType coreType() const;
+
+      // Run 'fcn' in this arena and wait for it; tasking calls it makes use
+      // this arena's threads
+      void execute(utility::FunctionRef<void()> fcn);
+
+      // Run 'fcn' asynchronously on one of this arena's threads
+      void enqueue(std::function<void()> fcn);
+
+     private:
+      struct Impl;
+      std::unique_ptr<Impl> impl;
+    };
+
+  }  // namespace tasking
+}  // namespace rkcommon
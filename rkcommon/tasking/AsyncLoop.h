@@ -3,14 +3,20 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <thread>
 
 #include "../traits/rktraits.h"
+#include "../utility/Config.h"
+#include "../utility/FunctionRef.h"
 
+#include "CancellationToken.h"
 #include "schedule.h"
 #include "tasking_system_init.h"
 
@@ -24,6 +30,17 @@ namespace rkcommon {
 
         An AsyncLoop has to be explicitly started, it is not automatically
         started on construction.
+
+        If constructed with a CancellationToken, the token is checked before
+        each call of the loop body: cancelling it stops the loop as if stop()
+        was called (without waiting). The token has to be reset() before the
+        loop can be started again.
+
+        The loop body may take a 'const CancellationToken &', which is
+        cancelled by stop(INTERRUPT) (and on destruction) so long iterations,
+        e.g. a parallel_for() over a frame, can return early instead of
+        delaying the stop by a whole iteration. setTargetRate() limits how
+        often the body is called, sleeping until the next iteration is due.
      */
     class AsyncLoop
     {
@@ -35,15 +52,51 @@ namespace rkcommon {
         TASK   = 2
       };
 
+      enum StopMode
+      {
+        // let the current iteration of the loop body finish
+        WAIT_FOR_ITERATION = 0,
+        // also cancel the token passed into the loop body
+        INTERRUPT = 1
+      };
+
+      // Latencies are in seconds: from start() until the loop body is
+      // entered, and from stop() until it returns
+      struct Statistics
+      {
+        size_t iterations{0};
+        size_t starts{0};
+        size_t stops{0};
+        double lastStartLatency{0.0};
+        double maxStartLatency{0.0};
+        double lastStopLatency{0.0};
+        double maxStopLatency{0.0};
+      };
+
       template <typename LOOP_BODY_FCN>
       AsyncLoop(LOOP_BODY_FCN &&fcn, LaunchMethod m = AUTO);
 
+      template <typename LOOP_BODY_FCN>
+      AsyncLoop(LOOP_BODY_FCN &&fcn,
+                const CancellationToken &token,
+                LaunchMethod m = AUTO);
+
       ~AsyncLoop();
 
       void start();
-      void stop();
+      void stop(StopMode mode = WAIT_FOR_ITERATION);
+
+      // Call the loop body at most 'iterationsPerSecond' times per second,
+      // <= 0 runs it back to back (the default)
+      void setTargetRate(double iterationsPerSecond);
+      double targetRate() const;
+
+      Statistics statistics() const;
+      void resetStatistics();
 
      private:
+      using clock_t = std::chrono::steady_clock;
+
       // Struct shared with the background thread to avoid dangling ptrs or
       // tricky synchronization when destroying the AsyncLoop and scheduling
       // threads with TBB, since we don't have a join point to sync with
@@ -56,17 +109,88 @@ namespace rkcommon {
 
         std::condition_variable runningCond;
         std::mutex runningMutex;
+
+        CancellationToken token;
+        // passed into the loop body, cancelled by stop(INTERRUPT)
+        CancellationToken interrupt;
+
+        // 0 for no pacing
+        std::atomic<int64_t> periodNs{0};
+
+        // set by start(), cleared when the first iteration begins
+        std::atomic<bool> startPending{false};
+        clock_t::time_point startRequested;
+
+        std::atomic<size_t> iterations{0};
+        mutable std::mutex statsMutex;
+        Statistics stats;
+      };
+
+      // The loop body shares the allocation of the shared state, so the
+      // function run by the thread or task only holds two small references
+      template <typename BODY_T>
+      struct AsyncLoopDataWithBody : public AsyncLoopData
+      {
+        explicit AsyncLoopDataWithBody(BODY_T b) : body(std::move(b)) {}
+
+        BODY_T body;
       };
 
       std::shared_ptr<AsyncLoopData> loop;
       std::thread backgroundThread;
     };
 
+    namespace detail {
+
+      // Loop bodies may or may not take the interrupt token
+      template <typename FCN>
+      inline auto invokeLoopBody(const FCN &fcn,
+                                 const CancellationToken &token,
+                                 int) -> decltype(fcn(token), void())
+      {
+        fcn(token);
+      }
+
+      template <typename FCN>
+      inline void invokeLoopBody(const FCN &fcn,
+                                 const CancellationToken &,
+                                 long)
+      {
+        fcn();
+      }
+
+      template <typename FCN>
+      struct AsyncLoopBody
+      {
+        void operator()(const CancellationToken &token) const
+        {
+          invokeLoopBody(fcn, token, 0);
+        }
+
+        FCN fcn;
+      };
+
+      inline double secondsBetween(std::chrono::steady_clock::time_point a,
+                                   std::chrono::steady_clock::time_point b)
+      {
+        return std::chrono::duration<double>(b - a).count();
+      }
+
+    }  // namespace detail
+
     // Inlined members
     // //////////////////////////////////////////////////////////
 
     template <typename LOOP_BODY_FCN>
     inline AsyncLoop::AsyncLoop(LOOP_BODY_FCN &&fcn, AsyncLoop::LaunchMethod m)
+        : AsyncLoop(std::forward<LOOP_BODY_FCN>(fcn), CancellationToken(), m)
+    {
+    }
+
+    template <typename LOOP_BODY_FCN>
+    inline AsyncLoop::AsyncLoop(LOOP_BODY_FCN &&fcn,
+                                const CancellationToken &token,
+                                AsyncLoop::LaunchMethod m)
         : loop(nullptr)
     {
       static_assert(traits::has_operator_method<LOOP_BODY_FCN>::value,
@@ -74,19 +198,67 @@ namespace rkcommon {
                     "method 'void LOOP_BODY_FCN::operator()' in order to "
                     "construct the loop instance.");
 
-      std::shared_ptr<AsyncLoopData> l = std::make_shared<AsyncLoopData>();
-      loop                             = l;
+      using body_t =
+          detail::AsyncLoopBody<typename std::decay<LOOP_BODY_FCN>::type>;
+      auto state = std::make_shared<AsyncLoopDataWithBody<body_t>>(
+          body_t{std::forward<LOOP_BODY_FCN>(fcn)});
+      state->token = token;
+      loop         = state;
+
+      std::shared_ptr<AsyncLoopData> l = state;
+      utility::FunctionRef<void(const CancellationToken &)> body(state->body);
+
+      auto mainLoop = [l, body]() {
+        clock_t::time_point nextIteration = clock_t::now();
+        bool paced                        = false;
 
-      auto mainLoop = [l, fcn]() {
         while (l->threadShouldBeAlive) {
-          if (!l->threadShouldBeAlive)
-            return;
+          if (l->shouldBeRunning && l->token.isCancelled()) {
+            l->shouldBeRunning = false;
+          } else if (l->shouldBeRunning) {
+            const int64_t periodNs = l->periodNs.load();
+            if (periodNs > 0 && paced) {
+              // sleep until the next iteration is due, stop() wakes us up
+              std::unique_lock<std::mutex> lock(l->runningMutex);
+              l->runningCond.wait_until(lock, nextIteration, [&] {
+                return !l->shouldBeRunning.load() ||
+                       !l->threadShouldBeAlive.load();
+              });
+            }
 
-          if (l->shouldBeRunning) {
+            // announce the iteration before re-checking, so stop() either
+            // sees us inside the body or we see it stopped the loop
             l->insideLoopBody = true;
-            fcn();
+            if (!l->shouldBeRunning || !l->threadShouldBeAlive) {
+              l->insideLoopBody = false;
+              paced             = false;
+              continue;
+            }
+
+            const clock_t::time_point now = clock_t::now();
+            if (l->startPending.exchange(false)) {
+              std::lock_guard<std::mutex> lock(l->statsMutex);
+              const double latency =
+                  detail::secondsBetween(l->startRequested, now);
+              l->stats.lastStartLatency = latency;
+              l->stats.maxStartLatency =
+                  std::max(l->stats.maxStartLatency, latency);
+            }
+
+            if (periodNs > 0) {
+              // don't try to catch up on iterations that were late
+              nextIteration = paced ? nextIteration : now;
+              nextIteration += std::chrono::nanoseconds(periodNs);
+              if (nextIteration < now)
+                nextIteration = now;
+              paced = true;
+            }
+
+            body(l->interrupt);
+            l->iterations++;
             l->insideLoopBody = false;
           } else {
+            paced = false;
             std::unique_lock<std::mutex> lock(l->runningMutex);
             l->runningCond.wait(lock, [&] {
               return l->shouldBeRunning.load() ||
@@ -96,8 +268,10 @@ namespace rkcommon {
         }
       };
 
-      if (m == AUTO)
-        m = tasking::numTaskingThreads() > 4 ? TASK : THREAD;
+      if (m == AUTO) {
+        const int taskThreads = utility::config::asyncLoopTaskThreads();
+        m = tasking::numTaskingThreads() > taskThreads ? TASK : THREAD;
+      }
 
       if (m == THREAD)
         backgroundThread = std::thread(mainLoop);
@@ -116,6 +290,7 @@ namespace rkcommon {
         loop->threadShouldBeAlive = false;
         loop->shouldBeRunning     = false;
       }
+      loop->interrupt.cancel();
       loop->runningCond.notify_one();
 
       if (backgroundThread.joinable()) {
@@ -126,6 +301,14 @@ namespace rkcommon {
     inline void AsyncLoop::start()
     {
       if (!loop->shouldBeRunning) {
+        loop->interrupt.reset();
+        {
+          std::lock_guard<std::mutex> lock(loop->statsMutex);
+          loop->startRequested = clock_t::now();
+          loop->stats.starts++;
+        }
+        loop->startPending = true;
+
         // Note that the mutex here is still required even though these vars
         // are atomic, because we need to sync with the condition variable
         // waiting state on the async thread. Otherwise we might signal and the
@@ -138,15 +321,61 @@ namespace rkcommon {
       }
     }
 
-    inline void AsyncLoop::stop()
+    inline void AsyncLoop::stop(StopMode mode)
     {
       if (loop->shouldBeRunning) {
-        loop->shouldBeRunning = false;
+        const clock_t::time_point begin = clock_t::now();
+
+        if (mode == INTERRUPT)
+          loop->interrupt.cancel();
+        {
+          // wake the loop up if it is sleeping for pacing
+          std::unique_lock<std::mutex> lock(loop->runningMutex);
+          loop->shouldBeRunning = false;
+        }
+        loop->runningCond.notify_one();
+
         while (loop->insideLoopBody.load()) {
           std::this_thread::yield();
         }
+        loop->startPending = false;
+
+        const double latency = detail::secondsBetween(begin, clock_t::now());
+        std::lock_guard<std::mutex> lock(loop->statsMutex);
+        loop->stats.stops++;
+        loop->stats.lastStopLatency = latency;
+        loop->stats.maxStopLatency =
+            std::max(loop->stats.maxStopLatency, latency);
       }
     }
 
+    inline void AsyncLoop::setTargetRate(double iterationsPerSecond)
+    {
+      loop->periodNs = iterationsPerSecond > 0.0
+                           ? int64_t(1e9 / iterationsPerSecond)
+                           : int64_t(0);
+    }
+
+    inline double AsyncLoop::targetRate() const
+    {
+      const int64_t periodNs = loop->periodNs.load();
+      return periodNs > 0 ? 1e9 / double(periodNs) : 0.0;
+    }
+
+    inline AsyncLoop::Statistics AsyncLoop::statistics() const
+    {
+      std::lock_guard<std::mutex> lock(loop->statsMutex);
+      Statistics result = loop->stats;
+      result.iterations = loop->iterations.load();
+      return result;
+    }
+
+    inline void AsyncLoop::resetStatistics()
+    {
+      std::lock_guard<std::mutex> lock(loop->statsMutex);
+      loop->stats      = Statistics();
+      loop->iterations = 0;
+    }
+
   }  // namespace tasking
 }  // namespace rkcommon
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "detail/async_task.inl"
+#include "detail/task_tracing.h"
 
 #include <atomic>
 #include <functional>
@@ -14,11 +15,14 @@ namespace rkcommon {
     template <typename T>
     struct AsyncTask
     {
-      AsyncTask(std::function<T()> fcn)
-          : taskImpl([this, fcn]() {
-              retValue    = fcn();
-              jobFinished = true;
-            })
+      AsyncTask(std::function<T()> fcn,
+                TaskPriority priority = TaskPriority::NORMAL)
+          : taskImpl(detail::tracedFcn("async",
+                                       [this, fcn]() {
+                                         retValue    = fcn();
+                                         jobFinished = true;
+                                       }),
+                     priority)
       {
       }
 
@@ -0,0 +1,109 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef RKCOMMON_TASKING_TBB
+#  define __TBB_NO_IMPLICIT_LINKAGE 1
+#  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#  include <tbb/task_group.h>
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+
+    /*! A CancellationToken lets one thread ask running or pending work to
+        stop early. Copies share the same state, so a token can be captured
+        by value in scheduled tasks and cancelled from anywhere.
+
+        Cancellation is cooperative: parallel_for(), parallel_in_blocks_of(),
+        schedule() and AsyncLoop check the token between chunks of work, so
+        work already started runs to the end of its chunk. On TBB, cancel()
+        also calls task_group_context::cancel_group_execution() on running
+        parallel_for()s, so TBB stops handing out their remaining ranges.
+     */
+    class CancellationToken
+    {
+     public:
+      CancellationToken();
+
+      // Request cancellation of all work observing this token
+      void cancel() const;
+
+      // Clear a previous cancel(), e.g. to reuse the token for the next frame
+      void reset() const;
+
+      bool isCancelled() const;
+
+#ifdef RKCOMMON_TASKING_TBB
+      // Used by the tasking implementation to forward cancel() to TBB
+      void attach(tbb::task_group_context *context) const;
+      void detach(tbb::task_group_context *context) const;
+#endif
+
+     private:
+      struct State
+      {
+        std::atomic<bool> cancelled{false};
+#ifdef RKCOMMON_TASKING_TBB
+        std::mutex mutex;
+        std::vector<tbb::task_group_context *> contexts;
+#endif
+      };
+
+      std::shared_ptr<State> state;
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    inline CancellationToken::CancellationToken()
+        : state(std::make_shared<State>())
+    {
+    }
+
+    inline void CancellationToken::cancel() const
+    {
+      state->cancelled = true;
+#ifdef RKCOMMON_TASKING_TBB
+      std::lock_guard<std::mutex> lock(state->mutex);
+      for (auto *context : state->contexts)
+        context->cancel_group_execution();
+#endif
+    }
+
+    inline void CancellationToken::reset() const
+    {
+      state->cancelled = false;
+    }
+
+    inline bool CancellationToken::isCancelled() const
+    {
+      return state->cancelled.load(std::memory_order_relaxed);
+    }
+
+#ifdef RKCOMMON_TASKING_TBB
+    inline void CancellationToken::attach(tbb::task_group_context *context) const
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->contexts.push_back(context);
+      // a cancel() which raced with attaching must not be lost
+      if (state->cancelled)
+        context->cancel_group_execution();
+    }
+
+    inline void CancellationToken::detach(tbb::task_group_context *context) const
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      auto &c = state->contexts;
+      c.erase(std::remove(c.begin(), c.end(), context), c.end());
+    }
+#endif
+
+  }  // namespace tasking
+}  // namespace rkcommon
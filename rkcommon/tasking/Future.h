@@ -0,0 +1,514 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../utility/Optional.h"
+#include "async.h"
+#include "schedule.h"
+
+namespace rkcommon {
+  namespace tasking {
+
+    /*! A Future<T> is a handle to a value which is produced asynchronously
+        on the tasking system. Unlike std::future, work can be chained onto
+        a Future with then(): the continuation is scheduled as a new task
+        when the predecessor completes, instead of a thread blocking in
+        wait() in between. Futures are cheap to copy (shared state), and
+        get() may be called any number of times, similar to
+        std::shared_future.
+
+        Exceptions thrown by a task are stored and re-thrown by get(); they
+        propagate through then() chains without running the continuations.
+
+        Example:
+
+          auto f = async_future([]() { return loadScene(); })
+                       .then([](const Scene &s) { return buildBVH(s); })
+                       .then([](const BVH &b) { render(b); });
+          f.wait();
+     */
+    template <typename T>
+    class Future;
+
+    namespace detail {
+
+      template <typename T>
+      struct FutureValue
+      {
+        template <typename FCN_T, typename... Args>
+        void run(FCN_T &fcn, Args &&... args)
+        {
+          value = fcn(std::forward<Args>(args)...);
+        }
+
+        const T &get() const
+        {
+          return *value;
+        }
+
+        utility::Optional<T> value;
+      };
+
+      template <>
+      struct FutureValue<void>
+      {
+        template <typename FCN_T, typename... Args>
+        void run(FCN_T &fcn, Args &&... args)
+        {
+          fcn(std::forward<Args>(args)...);
+        }
+
+        void get() const {}
+      };
+
+      template <typename T>
+      struct FutureState
+      {
+        // Run 'fcn(args...)' and publish its result (or exception)
+        template <typename FCN_T, typename... Args>
+        void fulfill(FCN_T &fcn, Args &&... args);
+
+        void fail(std::exception_ptr e);
+
+        // Run 'fcn' as a task once this state is ready
+        void onReady(std::function<void()> fcn);
+
+        bool isReady() const;
+        void wait();
+
+        FutureValue<T> value;
+        std::exception_ptr error;
+
+       private:
+        void publish();
+
+        std::atomic<bool> ready{false};
+        std::mutex mutex;
+        std::condition_variable readyCond;
+        std::vector<std::function<void()>> continuations;
+      };
+
+      template <typename T>
+      template <typename FCN_T, typename... Args>
+      inline void FutureState<T>::fulfill(FCN_T &fcn, Args &&... args)
+      {
+        try {
+          value.run(fcn, std::forward<Args>(args)...);
+        } catch (...) {
+          error = std::current_exception();
+        }
+        publish();
+      }
+
+      template <typename T>
+      inline void FutureState<T>::fail(std::exception_ptr e)
+      {
+        error = e;
+        publish();
+      }
+
+      template <typename T>
+      inline void FutureState<T>::onReady(std::function<void()> fcn)
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!ready) {
+            continuations.push_back(std::move(fcn));
+            return;
+          }
+        }
+        schedule(std::move(fcn));
+      }
+
+      template <typename T>
+      inline bool FutureState<T>::isReady() const
+      {
+        return ready.load();
+      }
+
+      template <typename T>
+      inline void FutureState<T>::wait()
+      {
+        if (ready)
+          return;
+#if defined(RKCOMMON_TASKING_INTERNAL)
+        /* The task setting the value may be queued behind this thread, the
+           only one of a single threaded pool, so run tasks while there are
+           any. Then spin briefly and block until publish(), waking up now
+           and then for tasks queued by threads outside of the pool. */
+        int idle = 0;
+        while (!ready) {
+          if (detail::tryRunTaskInternal()) {
+            idle = 0;
+          } else if (++idle < 64) {
+            std::this_thread::yield();
+          } else {
+            std::unique_lock<std::mutex> lock(mutex);
+            readyCond.wait_for(lock, std::chrono::milliseconds(1), [&]() {
+              return ready.load();
+            });
+          }
+        }
+#else
+        std::unique_lock<std::mutex> lock(mutex);
+        readyCond.wait(lock, [&]() { return ready.load(); });
+#endif
+      }
+
+      template <typename T>
+      inline void FutureState<T>::publish()
+      {
+        std::vector<std::function<void()>> toRun;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          ready = true;
+          toRun.swap(continuations);
+        }
+        readyCond.notify_all();
+
+        for (auto &c : toRun)
+          schedule(std::move(c));
+      }
+
+      template <typename FCN_T, typename ARG_T>
+      struct continuation_result
+      {
+#if defined(__cpp_lib_is_invocable) && __cpp_lib_is_invocable >= 201703
+        using type = std::invoke_result_t<FCN_T, const ARG_T &>;
+#else
+        using type = typename std::result_of<FCN_T(const ARG_T &)>::type;
+#endif
+      };
+
+      template <typename FCN_T>
+      struct continuation_result<FCN_T, void>
+      {
+        using type = operator_return_t<FCN_T>;
+      };
+
+    }  // namespace detail
+
+    template <typename T>
+    class Future
+    {
+     public:
+      Future() = default;
+
+      bool valid() const;
+      bool isReady() const;
+
+      // Block until the value is available
+      void wait() const;
+
+      // Wait for and return the value, re-throwing any stored exception
+      auto get() const -> decltype(std::declval<detail::FutureValue<T>>().get());
+
+      // Schedule 'fcn(value)' (or 'fcn()' for Future<void>) to run once this
+      // future is ready, returning a future of its result
+      template <typename FCN_T>
+      auto then(FCN_T &&fcn) const
+          -> Future<typename detail::continuation_result<FCN_T, T>::type>;
+
+      // Schedule 'fcn()' to run once this future is ready, also if it holds
+      // an exception instead of a value (e.g. to release resources)
+      void onReady(std::function<void()> fcn) const;
+
+     private:
+      template <typename U>
+      friend class Future;
+
+      template <typename TASK_T>
+      friend auto async_future(TASK_T &&fcn)
+          -> Future<operator_return_t<TASK_T>>;
+
+      template <typename U>
+      friend auto when_all(const std::vector<Future<U>> &futures)
+          -> Future<std::vector<U>>;
+
+      template <typename U>
+      friend Future<size_t> when_any(const std::vector<Future<U>> &futures);
+
+      template <typename U>
+      friend Future<typename std::decay<U>::type> make_ready_future(U &&value);
+
+      template <typename U>
+      friend class Promise;
+
+      explicit Future(std::shared_ptr<detail::FutureState<T>> s)
+          : state(std::move(s))
+      {
+      }
+
+      void checkValid() const;
+
+      std::shared_ptr<detail::FutureState<T>> state;
+    };
+
+    // Future<> creation //////////////////////////////////////////////////////
+
+    // NOTE: like async(), this takes a lambda which should take captured
+    //       variables by *value* to ensure no captured references race with
+    //       the task itself.
+    template <typename TASK_T>
+    inline auto async_future(TASK_T &&fcn) -> Future<operator_return_t<TASK_T>>
+    {
+      static_assert(traits::has_operator_method<TASK_T>::value,
+                    "rkcommon::tasking::async_future() requires the "
+                    "implementation of method 'RETURN_T TASK_T::operator()', "
+                    "where RETURN_T is the return value of the passed in "
+                    "task.");
+
+      using result_t = operator_return_t<TASK_T>;
+      using fcn_t    = typename std::decay<TASK_T>::type;
+
+      auto state = std::make_shared<detail::FutureState<result_t>>();
+
+      fcn_t f(std::forward<TASK_T>(fcn));
+      schedule([state, f]() { state->fulfill(f); });
+
+      return Future<result_t>(state);
+    }
+
+    template <typename U>
+    inline Future<typename std::decay<U>::type> make_ready_future(U &&value)
+    {
+      using value_t = typename std::decay<U>::type;
+      auto state    = std::make_shared<detail::FutureState<value_t>>();
+      auto fcn      = [&]() -> value_t { return std::forward<U>(value); };
+      state->fulfill(fcn);
+      return Future<value_t>(state);
+    }
+
+    /*! The producing end of a Future which is fulfilled outside of a task,
+        e.g. by an I/O thread. Copies share the same future; exactly one of
+        them sets the value or the exception, once. */
+    template <typename T>
+    class Promise
+    {
+     public:
+      Promise();
+
+      Future<T> getFuture() const;
+
+      // The arguments construct the value, none for Promise<void>
+      template <typename... Args>
+      void setValue(Args &&... args) const;
+
+      void setException(std::exception_ptr e) const;
+
+     private:
+      std::shared_ptr<detail::FutureState<T>> state;
+    };
+
+    /*! Returns a future which becomes ready once all given futures are ready,
+        holding their values in order. If any of them failed, the first stored
+        exception (in order) is propagated instead. */
+    template <typename T>
+    inline auto when_all(const std::vector<Future<T>> &futures)
+        -> Future<std::vector<T>>
+    {
+      using result_t = std::vector<T>;
+
+      auto state = std::make_shared<detail::FutureState<result_t>>();
+
+      if (futures.empty()) {
+        auto fcn = []() { return result_t(); };
+        state->fulfill(fcn);
+        return Future<result_t>(state);
+      }
+
+      for (const auto &f : futures)
+        f.checkValid();
+
+      auto remaining = std::make_shared<std::atomic<size_t>>(futures.size());
+
+      for (const auto &f : futures) {
+        f.state->onReady([state, remaining, futures]() {
+          if (--(*remaining) != 0)
+            return;
+
+          for (const auto &p : futures) {
+            if (p.state->error) {
+              state->fail(p.state->error);
+              return;
+            }
+          }
+
+          auto collect = [&]() {
+            result_t values;
+            values.reserve(futures.size());
+            for (const auto &p : futures)
+              values.push_back(p.state->value.get());
+            return values;
+          };
+          state->fulfill(collect);
+        });
+      }
+
+      return Future<result_t>(state);
+    }
+
+    /*! Returns a future which becomes ready as soon as any of the given
+        futures is ready, holding the index of that future. */
+    template <typename T>
+    inline Future<size_t> when_any(const std::vector<Future<T>> &futures)
+    {
+      if (futures.empty())
+        throw std::runtime_error("when_any() called with no futures");
+
+      for (const auto &f : futures)
+        f.checkValid();
+
+      auto state = std::make_shared<detail::FutureState<size_t>>();
+      auto done  = std::make_shared<std::atomic<bool>>(false);
+
+      for (size_t i = 0; i < futures.size(); ++i) {
+        futures[i].state->onReady([state, done, i]() {
+          if (!done->exchange(true)) {
+            auto index = [=]() { return i; };
+            state->fulfill(index);
+          }
+        });
+      }
+
+      return Future<size_t>(state);
+    }
+
+    // Inlined Promise<T> members /////////////////////////////////////////////
+
+    template <typename T>
+    inline Promise<T>::Promise()
+        : state(std::make_shared<detail::FutureState<T>>())
+    {
+    }
+
+    template <typename T>
+    inline Future<T> Promise<T>::getFuture() const
+    {
+      return Future<T>(state);
+    }
+
+    template <typename T>
+    template <typename... Args>
+    inline void Promise<T>::setValue(Args &&... args) const
+    {
+      // T(...) is void() for Promise<void>
+      auto fcn = [&]() { return T(std::forward<Args>(args)...); };
+      state->fulfill(fcn);
+    }
+
+    template <typename T>
+    inline void Promise<T>::setException(std::exception_ptr e) const
+    {
+      state->fail(e);
+    }
+
+    // Inlined Future<T> members //////////////////////////////////////////////
+
+    template <typename T>
+    inline bool Future<T>::valid() const
+    {
+      return state.get() != nullptr;
+    }
+
+    template <typename T>
+    inline bool Future<T>::isReady() const
+    {
+      return valid() && state->isReady();
+    }
+
+    template <typename T>
+    inline void Future<T>::wait() const
+    {
+      checkValid();
+      state->wait();
+    }
+
+    template <typename T>
+    inline auto Future<T>::get() const
+        -> decltype(std::declval<detail::FutureValue<T>>().get())
+    {
+      wait();
+      if (state->error)
+        std::rethrow_exception(state->error);
+      return state->value.get();
+    }
+
+    template <typename T>
+    template <typename FCN_T>
+    inline auto Future<T>::then(FCN_T &&fcn) const
+        -> Future<typename detail::continuation_result<FCN_T, T>::type>
+    {
+      checkValid();
+
+      using result_t = typename detail::continuation_result<FCN_T, T>::type;
+      using fcn_t    = typename std::decay<FCN_T>::type;
+
+      auto next = std::make_shared<detail::FutureState<result_t>>();
+      auto prev = state;
+
+      fcn_t f(std::forward<FCN_T>(fcn));
+      state->onReady([prev, next, f]() {
+        if (prev->error)
+          next->fail(prev->error);
+        else {
+          auto run = [&]() { return f(prev->value.get()); };
+          next->fulfill(run);
+        }
+      });
+
+      return Future<result_t>(next);
+    }
+
+    template <>
+    template <typename FCN_T>
+    inline auto Future<void>::then(FCN_T &&fcn) const
+        -> Future<typename detail::continuation_result<FCN_T, void>::type>
+    {
+      checkValid();
+
+      using result_t = typename detail::continuation_result<FCN_T, void>::type;
+      using fcn_t    = typename std::decay<FCN_T>::type;
+
+      auto next = std::make_shared<detail::FutureState<result_t>>();
+      auto prev = state;
+
+      fcn_t f(std::forward<FCN_T>(fcn));
+      state->onReady([prev, next, f]() {
+        if (prev->error)
+          next->fail(prev->error);
+        else
+          next->fulfill(f);
+      });
+
+      return Future<result_t>(next);
+    }
+
+    template <typename T>
+    inline void Future<T>::onReady(std::function<void()> fcn) const
+    {
+      checkValid();
+      state->onReady(std::move(fcn));
+    }
+
+    template <typename T>
+    inline void Future<T>::checkValid() const
+    {
+      if (!valid())
+        throw std::runtime_error("operation on an invalid tasking::Future");
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
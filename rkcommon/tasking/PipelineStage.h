@@ -0,0 +1,84 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+// std
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rkcommon {
+  namespace tasking {
+
+    /*! How a stage of parallel_pipeline() runs its items: one at a time in
+        the order the first stage produced them, one at a time in any order,
+        or several at once. */
+    enum class StageMode
+    {
+      SERIAL_IN_ORDER,
+      SERIAL_OUT_OF_ORDER,
+      PARALLEL
+    };
+
+    // Passed to the first stage, which calls stop() at the end of the stream
+    class PipelineControl
+    {
+     public:
+      // The value returned by the stage calling stop() is discarded
+      void stop()
+      {
+        isStopped = true;
+      }
+
+      bool stopped() const
+      {
+        return isStopped;
+      }
+
+     private:
+      bool isStopped{false};
+    };
+
+    /*! A stage of parallel_pipeline() taking items of type IN and producing
+        items of type OUT; see makePipelineStage(). The first stage has
+        IN = void and is called as 'OUT fcn(PipelineControl &)', the last
+        one has OUT = void. */
+    template <typename IN, typename OUT, typename FCN_T>
+    struct PipelineStage
+    {
+      using input_type  = IN;
+      using output_type = OUT;
+
+      StageMode mode;
+      FCN_T fcn;
+      const char *name;
+    };
+
+    template <typename IN, typename OUT, typename FCN_T>
+    inline PipelineStage<IN, OUT, typename std::decay<FCN_T>::type>
+    makePipelineStage(StageMode mode, FCN_T &&fcn, const char *name = "")
+    {
+      return {mode, std::forward<FCN_T>(fcn), name};
+    }
+
+    struct PipelineStageStatistics
+    {
+      const char *name{""};
+      uint64_t items{0};            // items run through the stage
+      uint64_t busyNanoseconds{0};  // time spent in the stage function
+      uint64_t deferred{0};  // items queued behind a serial stage (not TBB)
+    };
+
+    /*! Per-stage counters of one parallel_pipeline() run: the serial stage
+        with the most busy time bounds the throughput, while many deferred
+        items in front of an in-order stage hint at too few tokens. */
+    struct PipelineStatistics
+    {
+      std::vector<PipelineStageStatistics> stages;
+      uint64_t elapsedNanoseconds{0};
+    };
+
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,407 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+/* C++20 coroutines running on the tasking system. Everything below is only
+   compiled by C++20 compilers with coroutine support, which define
+   RKCOMMON_HAS_COROUTINES; rkcommon itself stays C++11. */
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine) \
+    && __has_include(<coroutine>)
+#  define RKCOMMON_HAS_COROUTINES 1
+#endif
+
+#ifdef RKCOMMON_HAS_COROUTINES
+
+#include "Arena.h"
+#include "parallel_for.h"
+#include "schedule.h"
+// std
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#if defined(RKCOMMON_TASKING_INTERNAL)
+#  include "detail/TaskSys.h"
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+
+    template <typename T = void>
+    class Task;
+
+    namespace detail {
+
+      struct TaskPromiseBase
+      {
+        // Resumes the coroutine awaiting this one, if any
+        struct FinalAwaiter
+        {
+          bool await_ready() noexcept
+          {
+            return false;
+          }
+
+          template <typename PROMISE_T>
+          std::coroutine_handle<> await_suspend(
+              std::coroutine_handle<PROMISE_T> h) noexcept
+          {
+            return h.promise().continuation;
+          }
+
+          void await_resume() noexcept {}
+        };
+
+        // tasks are lazy, they start when awaited
+        std::suspend_always initial_suspend() noexcept
+        {
+          return {};
+        }
+
+        FinalAwaiter final_suspend() noexcept
+        {
+          return {};
+        }
+
+        void unhandled_exception()
+        {
+          error = std::current_exception();
+        }
+
+        std::coroutine_handle<> continuation{std::noop_coroutine()};
+        std::exception_ptr error;
+      };
+
+      template <typename T>
+      struct TaskPromise : public TaskPromiseBase
+      {
+        tasking::Task<T> get_return_object();
+
+        template <typename VALUE_T>
+        void return_value(VALUE_T &&v)
+        {
+          value.emplace(std::forward<VALUE_T>(v));
+        }
+
+        T result()
+        {
+          if (error)
+            std::rethrow_exception(error);
+          return std::move(*value);
+        }
+
+        std::optional<T> value;
+      };
+
+      template <>
+      struct TaskPromise<void> : public TaskPromiseBase
+      {
+        tasking::Task<void> get_return_object();
+
+        void return_void() {}
+
+        void result()
+        {
+          if (error)
+            std::rethrow_exception(error);
+        }
+      };
+
+    }  // namespace detail
+
+    /*! A lazily started coroutine producing a T. It starts running when
+        co_await-ed, on the awaiting thread, and the awaiting coroutine
+        resumes on whichever thread the task finishes on. Tasks move to the
+        tasking system's threads by awaiting schedule_on() or
+        async_parallel_for(), so long chains of asynchronous steps hold no
+        thread while they wait:
+
+          Task<Mesh> loadMesh(std::string file)
+          {
+            co_await schedule_on();  // continue on a tasking thread
+            Mesh mesh = parse(file);
+            co_await async_parallel_for(mesh.numTriangles(), [&](size_t i) {
+              mesh.computeNormal(i);
+            });
+            co_return mesh;
+          }
+
+          Mesh mesh = sync_wait(loadMesh("bunny.obj"));
+
+        Exceptions thrown by a task are re-thrown by co_await. A task must
+        be awaited (or passed to sync_wait() or to_future()) at most once. */
+    template <typename T>
+    class [[nodiscard]] Task
+    {
+     public:
+      using promise_type = detail::TaskPromise<T>;
+
+      Task() = default;
+      ~Task();
+
+      Task(Task &&other) noexcept;
+      Task &operator=(Task &&other) noexcept;
+
+      Task(const Task &) = delete;
+      Task &operator=(const Task &) = delete;
+
+      bool valid() const;
+
+      auto operator co_await() noexcept;
+
+     private:
+      friend promise_type;
+
+      explicit Task(std::coroutine_handle<promise_type> h);
+
+      std::coroutine_handle<promise_type> handle;
+    };
+
+    // co_await-ed to continue on a tasking thread (see schedule())
+    struct ScheduleAwaiter
+    {
+      bool await_ready() noexcept
+      {
+        return false;
+      }
+
+      void await_suspend(std::coroutine_handle<> h)
+      {
+        // the coroutine, including this awaiter, may be gone once queued
+        if (Arena *a = arena)
+          a->enqueue([h]() { h.resume(); });
+        else
+          schedule([h]() { h.resume(); }, priority);
+      }
+
+      void await_resume() noexcept {}
+
+      Arena *arena{nullptr};
+      TaskPriority priority{TaskPriority::NORMAL};
+    };
+
+    inline ScheduleAwaiter schedule_on(
+        TaskPriority priority = TaskPriority::NORMAL)
+    {
+      return {nullptr, priority};
+    }
+
+    // Continue on one of the threads of 'arena'
+    inline ScheduleAwaiter schedule_on(Arena &arena)
+    {
+      return {&arena, TaskPriority::NORMAL};
+    }
+
+    // co_await-ed to run a parallel_for() as a task, see async_parallel_for()
+    template <typename INDEX_T, typename TASK_T>
+    struct ParallelForAwaiter
+    {
+      bool await_ready() noexcept
+      {
+        return false;
+      }
+
+      void await_suspend(std::coroutine_handle<> h)
+      {
+        schedule([this, h]() {
+          try {
+            parallel_for(nTasks, fcn);
+          } catch (...) {
+            error = std::current_exception();
+          }
+          h.resume();
+        });
+      }
+
+      void await_resume()
+      {
+        if (error)
+          std::rethrow_exception(error);
+      }
+
+      INDEX_T nTasks;
+      TASK_T fcn;
+      std::exception_ptr error;
+    };
+
+    /* Suspends the awaiting coroutine until parallel_for(nTasks, fcn) has
+       run on the tasking system, then resumes it on the thread finishing
+       the loop */
+    template <typename INDEX_T, typename TASK_T>
+    inline ParallelForAwaiter<INDEX_T, typename std::decay<TASK_T>::type>
+    async_parallel_for(INDEX_T nTasks, TASK_T &&fcn)
+    {
+      return {nTasks, std::forward<TASK_T>(fcn), nullptr};
+    }
+
+    namespace detail {
+
+      // A coroutine which starts at once and cleans up after itself
+      struct DetachedCoroutine
+      {
+        struct promise_type
+        {
+          DetachedCoroutine get_return_object() noexcept
+          {
+            return {};
+          }
+
+          std::suspend_never initial_suspend() noexcept
+          {
+            return {};
+          }
+
+          std::suspend_never final_suspend() noexcept
+          {
+            return {};
+          }
+
+          void return_void() noexcept {}
+
+          void unhandled_exception() noexcept
+          {
+            std::terminate();
+          }
+        };
+      };
+
+      // Runs 'task' into 'promise', then decrements 'pending' if given
+      template <typename T>
+      inline DetachedCoroutine fulfil(tasking::Task<T> task,
+                                     std::promise<T> promise,
+                                     std::atomic<int> *pending)
+      {
+        try {
+          if constexpr (std::is_void<T>::value) {
+            co_await task;
+            promise.set_value();
+          } else {
+            promise.set_value(co_await task);
+          }
+        } catch (...) {
+          promise.set_exception(std::current_exception());
+        }
+        if (pending)
+          (*pending)--;
+      }
+
+    }  // namespace detail
+
+    // Starts 'task' on the calling thread, the future gets its result
+    template <typename T>
+    inline std::future<T> to_future(Task<T> task)
+    {
+      std::promise<T> promise;
+      std::future<T> future = promise.get_future();
+      detail::fulfil(std::move(task), std::move(promise), nullptr);
+      return future;
+    }
+
+    /* Runs 'task' to completion and returns its result, or re-throws its
+       exception. On the Internal backend the calling thread runs tasks
+       while it waits, like the other waiting tasking calls. */
+    template <typename T>
+    inline T sync_wait(Task<T> task)
+    {
+      std::atomic<int> pending{1};
+      std::promise<T> promise;
+      std::future<T> future = promise.get_future();
+      detail::fulfil(std::move(task), std::move(promise), &pending);
+#if defined(RKCOMMON_TASKING_INTERNAL)
+      detail::waitInternal(pending);
+#endif
+      return future.get();
+    }
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    namespace detail {
+
+      template <typename T>
+      inline tasking::Task<T> TaskPromise<T>::get_return_object()
+      {
+        return tasking::Task<T>(
+            std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+      }
+
+      inline tasking::Task<void> TaskPromise<void>::get_return_object()
+      {
+        return tasking::Task<void>(
+            std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+      }
+
+    }  // namespace detail
+
+    template <typename T>
+    inline Task<T>::Task(std::coroutine_handle<promise_type> h) : handle(h)
+    {
+    }
+
+    template <typename T>
+    inline Task<T>::~Task()
+    {
+      if (handle)
+        handle.destroy();
+    }
+
+    template <typename T>
+    inline Task<T>::Task(Task &&other) noexcept
+        : handle(std::exchange(other.handle, nullptr))
+    {
+    }
+
+    template <typename T>
+    inline Task<T> &Task<T>::operator=(Task &&other) noexcept
+    {
+      if (this != &other) {
+        if (handle)
+          handle.destroy();
+        handle = std::exchange(other.handle, nullptr);
+      }
+      return *this;
+    }
+
+    template <typename T>
+    inline bool Task<T>::valid() const
+    {
+      return bool(handle);
+    }
+
+    template <typename T>
+    inline auto Task<T>::operator co_await() noexcept
+    {
+      struct Awaiter
+      {
+        bool await_ready() noexcept
+        {
+          return handle.done();
+        }
+
+        // start the task, symmetric transfer avoids growing the stack
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h)
+        {
+          handle.promise().continuation = h;
+          return handle;
+        }
+
+        T await_resume()
+        {
+          return handle.promise().result();
+        }
+
+        std::coroutine_handle<promise_type> handle;
+      };
+
+      return Awaiter{handle};
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
+
+#endif
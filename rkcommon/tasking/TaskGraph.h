@@ -0,0 +1,155 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+#include "../traits/rktraits.h"
+#include "detail/task_graph.inl"
+
+#include <stdexcept>
+
+namespace rkcommon {
+  namespace tasking {
+
+    /*! A TaskGraph is a set of tasks (nodes) with "happens-before"
+        dependencies between them (edges). execute() runs every node exactly
+        once, starting each node as soon as all of its predecessors have
+        finished, and returns when the whole graph is done. This avoids the
+        idle cores that show up when a DAG is flattened into phases of
+        parallel_for() with a barrier in between.
+
+        A graph can be executed any number of times. The backend state is
+        only (re)built on the first execute() after the graph was modified,
+        so re-running an unchanged graph does not allocate.
+
+        Example:
+
+          TaskGraph g;
+          auto load   = g.addNode([&]() { loadScene(); });
+          auto build  = g.addNode([&]() { buildBVH(); });
+          auto render = g.addNode([&]() { render(); });
+          g.addEdge(load, build);
+          g.addEdge(build, render);
+
+          for (;;)
+            g.execute();
+     */
+    class TaskGraph
+    {
+     public:
+      using NodeID = size_t;
+
+      TaskGraph() = default;
+      ~TaskGraph() = default;
+
+      TaskGraph(const TaskGraph &) = delete;
+      TaskGraph &operator=(const TaskGraph &) = delete;
+
+      template <typename TASK_T>
+      NodeID addNode(TASK_T &&fcn);
+
+      // Make 'after' wait for 'before' to finish
+      void addEdge(NodeID before, NodeID after);
+
+      // Run the graph to completion, throws if the graph has a cycle
+      void execute();
+
+      size_t numNodes() const;
+      bool empty() const;
+
+      void clear();
+
+     private:
+      void finalize();
+
+      std::vector<detail::TaskGraphNode> nodes;
+      std::vector<size_t> topologicalOrder;
+      std::unique_ptr<detail::TaskGraphImpl> impl;
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    template <typename TASK_T>
+    inline TaskGraph::NodeID TaskGraph::addNode(TASK_T &&fcn)
+    {
+      static_assert(traits::has_operator_method<TASK_T>::value,
+                    "rkcommon::tasking::TaskGraph::addNode() requires the "
+                    "implementation of method 'void TASK_T::operator()'.");
+
+      impl.reset();
+      nodes.emplace_back();
+      nodes.back().fcn = std::forward<TASK_T>(fcn);
+      return nodes.size() - 1;
+    }
+
+    inline void TaskGraph::addEdge(NodeID before, NodeID after)
+    {
+      if (before >= nodes.size() || after >= nodes.size())
+        throw std::out_of_range("TaskGraph::addEdge(): invalid node ID");
+
+      if (before == after)
+        throw std::runtime_error("TaskGraph::addEdge(): node can't depend on "
+                                 "itself");
+
+      impl.reset();
+      nodes[before].successors.push_back(after);
+      nodes[after].numPredecessors++;
+    }
+
+    inline void TaskGraph::execute()
+    {
+      if (nodes.empty())
+        return;
+
+      if (!impl)
+        finalize();
+
+      impl->execute();
+    }
+
+    inline size_t TaskGraph::numNodes() const
+    {
+      return nodes.size();
+    }
+
+    inline bool TaskGraph::empty() const
+    {
+      return nodes.empty();
+    }
+
+    inline void TaskGraph::clear()
+    {
+      impl.reset();
+      nodes.clear();
+      topologicalOrder.clear();
+    }
+
+    inline void TaskGraph::finalize()
+    {
+      // validate the graph is acyclic (Kahn's algorithm)
+      std::vector<int> pending(nodes.size());
+      topologicalOrder.clear();
+      topologicalOrder.reserve(nodes.size());
+
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        pending[i] = nodes[i].numPredecessors;
+        if (pending[i] == 0)
+          topologicalOrder.push_back(i);
+      }
+
+      for (size_t i = 0; i < topologicalOrder.size(); ++i) {
+        for (auto s : nodes[topologicalOrder[i]].successors) {
+          if (--pending[s] == 0)
+            topologicalOrder.push_back(s);
+        }
+      }
+
+      if (topologicalOrder.size() != nodes.size())
+        throw std::runtime_error("TaskGraph::execute(): graph has a cycle");
+
+      impl = make_unique<detail::TaskGraphImpl>(nodes, topologicalOrder);
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,30 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+namespace rkcommon {
+  namespace tasking {
+
+    /*! Priority of a task passed to schedule(), async() or AsyncTask, e.g.
+        LOW for BVH rebuilds, texture prefetching or log flushing which must
+        not delay frame critical work.
+
+        Backend mapping:
+          TBB      -> shared tbb::task_arena instances created with the
+                      matching tbb::task_arena::priority
+          Internal -> one enkiTS pipe per priority; idle threads take the
+                      highest priority work first, and a thread waiting for
+                      a task only helps with work of at least its priority
+          OpenMP   -> ignored, each task runs on its own std::thread
+          Debug    -> ignored, tasks run synchronously
+     */
+    enum class TaskPriority
+    {
+      LOW,
+      NORMAL,
+      HIGH
+    };
+
+  }  // namespace tasking
+}  // namespace rkcommon
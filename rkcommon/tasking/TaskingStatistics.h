@@ -0,0 +1,78 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+// std
+#include <cstdint>
+#include <vector>
+
+namespace rkcommon {
+  namespace tasking {
+
+    struct WorkerStatistics
+    {
+      uint64_t tasksExecuted{0};      // task partitions run by the worker
+      uint64_t busyNanoseconds{0};    // time spent running them
+      uint64_t sleepNanoseconds{0};   // time spent asleep waiting for work
+      uint64_t wakes{0};              // number of times woken up
+      uint64_t steals{0};             // partitions taken from another worker
+      uint64_t splits{0};             // partitions queued for other workers
+      uint64_t pipeFullFallbacks{0};  // partitions run inline, queue was full
+    };
+
+    // The state of a TuningSlot
+    struct TunedLoopStatistics
+    {
+      const char *name{""};
+      uint64_t loops{0};                // loops which updated the estimate
+      uint64_t grainSize{0};            // last grain size handed out
+      double nanosecondsPerIndex{0.0};  // estimated time per index
+    };
+
+    /*! Scheduler counters to tell load imbalance, oversubscription and
+        sleep/wake latency apart. They are only collected by the Internal
+        backend, and only if rkcommon was configured with
+        RKCOMMON_TASKING_STATISTICS=ON; otherwise the counting code is
+        compiled out and 'enabled' is false. The grain sizes learned by the
+        live TuningSlots are reported by every backend. */
+    struct TaskingStatistics
+    {
+      bool enabled{false};
+      // indexed by worker thread, worker 0 accumulates all threads which are
+      // not owned by the tasking system (e.g. the one calling parallel_for())
+      std::vector<WorkerStatistics> workers;
+      std::vector<TunedLoopStatistics> tunedLoops;
+
+      WorkerStatistics total() const;
+    };
+
+    TaskingStatistics RKCOMMON_INTERFACE getStatistics();
+
+    void RKCOMMON_INTERFACE resetStatistics();
+
+    // Record the totals of getStatistics() as rkcommon::tracing counters
+    // ("tasking.tasksExecuted", ...), a no-op unless RKCOMMON_ENABLE_PROFILING
+    // is defined
+    void RKCOMMON_INTERFACE traceStatistics();
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+    inline WorkerStatistics TaskingStatistics::total() const
+    {
+      WorkerStatistics sum;
+      for (const auto &w : workers) {
+        sum.tasksExecuted += w.tasksExecuted;
+        sum.busyNanoseconds += w.busyNanoseconds;
+        sum.sleepNanoseconds += w.sleepNanoseconds;
+        sum.wakes += w.wakes;
+        sum.steals += w.steals;
+        sum.splits += w.splits;
+        sum.pipeFullFallbacks += w.pipeFullFallbacks;
+      }
+      return sum;
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,324 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+// std
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef RKCOMMON_TASKING_TBB
+#  define __TBB_NO_IMPLICIT_LINKAGE 1
+#  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#  include <tbb/cache_aligned_allocator.h>
+#  include <tbb/enumerable_thread_specific.h>
+#else
+#  include "../memory/malloc.h"
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+
+    namespace detail {
+
+      // Small index of the calling thread, unique among all live threads and
+      // recycled when a thread exits, so arrays indexed by it stay compact
+      size_t RKCOMMON_INTERFACE threadLocalIndex();
+
+    }  // namespace detail
+
+    /* Enumerable thread-local storage: each thread calling local() gets its
+       own instance of T, constructed on first use (as a copy of the exemplar
+       passed to the constructor, or default constructed), so per-thread
+       partial results, scratch buffers or RNG states can be used inside a
+       parallel_for() without synchronization and enumerated afterwards with
+       for_each() or combine(). Instances are padded to separate cache lines.
+
+       local() is thread-safe; for_each(), combine(), size() and clear() are
+       not, and must only be called while no other thread uses this object
+       (e.g. after the parallel loop returned).
+
+       TBB builds map this to tbb::enumerable_thread_specific. All other
+       backends index an array of slots by detail::threadLocalIndex(); as
+       indices are recycled, a new thread may pick up the instance left by a
+       thread which has exited. */
+    template <typename T>
+    class ThreadLocal
+    {
+     public:
+      ThreadLocal();
+      explicit ThreadLocal(const T &exemplar);
+      ~ThreadLocal();
+
+      ThreadLocal(const ThreadLocal &) = delete;
+      ThreadLocal &operator=(const ThreadLocal &) = delete;
+
+      // The calling thread's instance; 'exists' is false if it was just
+      // constructed
+      T &local();
+      T &local(bool &exists);
+
+      // Number of instances constructed so far
+      size_t size() const;
+
+      // Call 'fcn(T &)' on every instance
+      template <typename FCN_T>
+      void for_each(FCN_T &&fcn);
+      template <typename FCN_T>
+      void for_each(FCN_T &&fcn) const;
+
+      // Fold all instances with 'combineFcn(T, T) -> T', returns a copy of
+      // the exemplar if no instance exists
+      template <typename COMBINE_T>
+      T combine(COMBINE_T &&combineFcn) const;
+
+      // Destroy all instances
+      void clear();
+
+     private:
+#ifdef RKCOMMON_TASKING_TBB
+      tbb::enumerable_thread_specific<T,
+                                      tbb::cache_aligned_allocator<T>,
+                                      tbb::ets_key_per_instance>
+          values;
+#else
+      struct alignas(64) Slot
+      {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        bool constructed;
+
+        T &value()
+        {
+          return *reinterpret_cast<T *>(&storage);
+        }
+      };
+
+      // segment 's' holds SEGMENT0_SIZE << s slots, so any index maps to a
+      // slot without locking or moving existing ones when growing
+      static constexpr size_t SEGMENT0_SIZE = 8;
+      static constexpr size_t NUM_SEGMENTS  = 32;
+
+      static size_t segmentOf(size_t index);
+      static size_t segmentBegin(size_t segment);
+      static size_t segmentSize(size_t segment);
+
+      Slot &slot(size_t index);
+
+      T exemplar;
+      std::atomic<size_t> count{0};
+      std::atomic<Slot *> segments[NUM_SEGMENTS];
+#endif
+    };
+
+    // Inlined members ////////////////////////////////////////////////////////
+
+#ifdef RKCOMMON_TASKING_TBB
+
+    template <typename T>
+    inline ThreadLocal<T>::ThreadLocal() = default;
+
+    template <typename T>
+    inline ThreadLocal<T>::ThreadLocal(const T &exemplar) : values(exemplar)
+    {
+    }
+
+    template <typename T>
+    inline ThreadLocal<T>::~ThreadLocal() = default;
+
+    template <typename T>
+    inline T &ThreadLocal<T>::local()
+    {
+      return values.local();
+    }
+
+    template <typename T>
+    inline T &ThreadLocal<T>::local(bool &exists)
+    {
+      return values.local(exists);
+    }
+
+    template <typename T>
+    inline size_t ThreadLocal<T>::size() const
+    {
+      return values.size();
+    }
+
+    template <typename T>
+    template <typename FCN_T>
+    inline void ThreadLocal<T>::for_each(FCN_T &&fcn)
+    {
+      for (auto &v : values)
+        fcn(v);
+    }
+
+    template <typename T>
+    template <typename FCN_T>
+    inline void ThreadLocal<T>::for_each(FCN_T &&fcn) const
+    {
+      for (const auto &v : values)
+        fcn(v);
+    }
+
+    template <typename T>
+    template <typename COMBINE_T>
+    inline T ThreadLocal<T>::combine(COMBINE_T &&combineFcn) const
+    {
+      return const_cast<decltype(values) &>(values).combine(
+          std::forward<COMBINE_T>(combineFcn));
+    }
+
+    template <typename T>
+    inline void ThreadLocal<T>::clear()
+    {
+      values.clear();
+    }
+
+#else
+
+    template <typename T>
+    inline ThreadLocal<T>::ThreadLocal() : ThreadLocal(T())
+    {
+    }
+
+    template <typename T>
+    inline ThreadLocal<T>::ThreadLocal(const T &exemplar) : exemplar(exemplar)
+    {
+      for (auto &s : segments)
+        s.store(nullptr, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    inline ThreadLocal<T>::~ThreadLocal()
+    {
+      clear();
+      for (auto &s : segments)
+        memory::alignedFree(s.load(std::memory_order_relaxed));
+    }
+
+    template <typename T>
+    inline T &ThreadLocal<T>::local()
+    {
+      bool exists;
+      return local(exists);
+    }
+
+    template <typename T>
+    inline T &ThreadLocal<T>::local(bool &exists)
+    {
+      Slot &s = slot(detail::threadLocalIndex());
+      exists  = s.constructed;
+      if (!exists) {
+        new (&s.storage) T(exemplar);
+        s.constructed = true;
+        count.fetch_add(1, std::memory_order_relaxed);
+      }
+      return s.value();
+    }
+
+    template <typename T>
+    inline size_t ThreadLocal<T>::size() const
+    {
+      return count.load(std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    template <typename FCN_T>
+    inline void ThreadLocal<T>::for_each(FCN_T &&fcn)
+    {
+      for (size_t s = 0; s < NUM_SEGMENTS; ++s) {
+        Slot *slots = segments[s].load(std::memory_order_acquire);
+        if (!slots)
+          continue;
+        for (size_t i = 0; i < segmentSize(s); ++i) {
+          if (slots[i].constructed)
+            fcn(slots[i].value());
+        }
+      }
+    }
+
+    template <typename T>
+    template <typename FCN_T>
+    inline void ThreadLocal<T>::for_each(FCN_T &&fcn) const
+    {
+      const_cast<ThreadLocal *>(this)->for_each(
+          [&](T &v) { fcn(static_cast<const T &>(v)); });
+    }
+
+    template <typename T>
+    template <typename COMBINE_T>
+    inline T ThreadLocal<T>::combine(COMBINE_T &&combineFcn) const
+    {
+      bool first = true;
+      T result   = exemplar;
+      for_each([&](const T &v) {
+        result = first ? v : combineFcn(result, v);
+        first  = false;
+      });
+      return result;
+    }
+
+    template <typename T>
+    inline void ThreadLocal<T>::clear()
+    {
+      for_each([](T &v) { v.~T(); });
+      for (size_t s = 0; s < NUM_SEGMENTS; ++s) {
+        Slot *slots = segments[s].load(std::memory_order_acquire);
+        for (size_t i = 0; slots && i < segmentSize(s); ++i)
+          slots[i].constructed = false;
+      }
+      count.store(0, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    inline size_t ThreadLocal<T>::segmentOf(size_t index)
+    {
+      size_t segment = 0;
+      while (index >= segmentBegin(segment + 1))
+        ++segment;
+      return segment;
+    }
+
+    template <typename T>
+    inline size_t ThreadLocal<T>::segmentBegin(size_t segment)
+    {
+      return SEGMENT0_SIZE * ((size_t(1) << segment) - 1);
+    }
+
+    template <typename T>
+    inline size_t ThreadLocal<T>::segmentSize(size_t segment)
+    {
+      return SEGMENT0_SIZE << segment;
+    }
+
+    template <typename T>
+    inline typename ThreadLocal<T>::Slot &ThreadLocal<T>::slot(size_t index)
+    {
+      const size_t segment = segmentOf(index);
+      Slot *slots = segments[segment].load(std::memory_order_acquire);
+
+      if (!slots) {
+        // racing threads may both allocate, the loser frees its segment
+        const size_t n = segmentSize(segment);
+        Slot *fresh    = memory::alignedMalloc<Slot>(n, alignof(Slot));
+        for (size_t i = 0; i < n; ++i)
+          fresh[i].constructed = false;
+
+        if (segments[segment].compare_exchange_strong(
+                slots, fresh, std::memory_order_acq_rel)) {
+          slots = fresh;
+        } else {
+          memory::alignedFree(fresh);
+        }
+      }
+
+      return slots[index - segmentBegin(segment)];
+    }
+
+#endif
+
+  }  // namespace tasking
+}  // namespace rkcommon
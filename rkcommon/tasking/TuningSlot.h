@@ -0,0 +1,74 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+// std
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace rkcommon {
+  namespace tasking {
+
+    /*! The grain size learned for one parallel loop, usually a static at
+        its call site:
+
+          static TuningSlot slot("shadeTiles");
+          parallel_for(numTiles, slot, [&](int i) { ... });
+
+        Each loop given the slot times its chunks and updates the running
+        estimate of the time per index; the next loop uses chunks of about
+        'targetChunkTime', so tiny bodies are batched until the scheduling
+        overhead no longer matters, while long ones are split into at least
+        a few chunks per thread to balance the load. Loops cheaper than one
+        chunk run on the calling thread. The chosen values are reported by
+        getStatistics(). TBB builds keep using TBB's auto_partitioner, which
+        adapts by itself, and leave the slot untouched.
+
+        Slots may be shared by concurrent loops. */
+    class RKCOMMON_INTERFACE TuningSlot
+    {
+     public:
+      explicit TuningSlot(const char *name,
+                          std::chrono::nanoseconds targetChunkTime =
+                              std::chrono::microseconds(50));
+      ~TuningSlot();
+
+      TuningSlot(const TuningSlot &) = delete;
+      TuningSlot &operator=(const TuningSlot &) = delete;
+
+      const char *name() const;
+
+      std::chrono::nanoseconds targetChunkTime() const;
+
+      // The grain size for a loop over 'numIndices' indices
+      uint64_t grainSize(uint64_t numIndices) const;
+
+      // Adds the measured time of a loop's chunks to the estimate
+      void record(uint64_t numIndices, uint64_t busyNanoseconds);
+
+      // The last grain size handed out, 0 before the first loop
+      uint64_t lastGrainSize() const;
+
+      // Estimated time per index, 0 before the first loop
+      double nanosecondsPerIndex() const;
+
+      uint64_t numLoops() const;
+
+      // Forgets what was learned
+      void reset();
+
+     private:
+      const char *slotName;
+      std::chrono::nanoseconds target;
+
+      mutable std::mutex mutex;
+      double nsPerIndex{0.0};
+      mutable uint64_t lastGrain{0};
+      uint64_t loops{0};
+    };
+
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -22,7 +22,9 @@ namespace rkcommon {
     //             variables by *value* to ensure no captured references race
     //             with the task itself.
     template <typename TASK_T>
-    inline auto async(TASK_T &&fcn) -> std::future<operator_return_t<TASK_T>>
+    inline auto async(TASK_T &&fcn,
+                      TaskPriority priority = TaskPriority::NORMAL)
+        -> std::future<operator_return_t<TASK_T>>
     {
       static_assert(traits::has_operator_method<TASK_T>::value,
                     "rkcommon::tasking::async() requires the implementation of"
@@ -34,7 +36,32 @@ namespace rkcommon {
       auto task   = new package_t(std::forward<TASK_T>(fcn));
       auto future = task->get_future();
 
-      schedule([=]() {
+      schedule(
+          [=]() {
+            (*task)();
+            delete task;
+          },
+          priority);
+
+      return future;
+    }
+
+    // async() run on the threads of 'arena' instead of the default pool
+    template <typename TASK_T>
+    inline auto async(Arena &arena, TASK_T &&fcn)
+        -> std::future<operator_return_t<TASK_T>>
+    {
+      static_assert(traits::has_operator_method<TASK_T>::value,
+                    "rkcommon::tasking::async() requires the implementation of"
+                    "method 'RETURN_T TASK_T::operator()', where RETURN_T "
+                    "is the return value of the passed in task.");
+
+      using package_t = std::packaged_task<operator_return_t<TASK_T>()>;
+
+      auto task   = new package_t(std::forward<TASK_T>(fcn));
+      auto future = task->get_future();
+
+      schedule(arena, [=]() {
         (*task)();
         delete task;
       });
@@ -0,0 +1,222 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../Arena.h"
+#include "dynamic_backend.h"
+#include "thread_affinity.h"
+
+// tasking system internals
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+#define __TBB_NO_IMPLICIT_LINKAGE 1
+#define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#include <tbb/task_arena.h>
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+#include <omp.h>
+#endif
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+#include "TaskSys.h"
+#endif
+
+// std
+#include <algorithm>
+#include <thread>
+// rkcommon
+#include "../../utility/OnScopeExit.h"
+
+namespace rkcommon {
+  namespace tasking {
+
+    struct Arena::Impl
+    {
+      Impl(int maxConcurrency, Priority priority, CoreType coreType);
+
+      int maxConcurrency;
+      Priority priority;
+      CoreType coreType;
+      // fixed at construction, a Dynamic build may switch backends later
+      TaskingBackend backend;
+
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+      tbb::task_arena arena;  // threads are only created on first use
+#endif
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+      std::unique_ptr<enki::TaskScheduler> scheduler;
+#endif
+    };
+
+    static int resolveConcurrency(int maxConcurrency)
+    {
+      if (maxConcurrency > 0)
+        return maxConcurrency;
+      return std::max(1, int(std::thread::hardware_concurrency()));
+    }
+
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+    static tbb::task_arena makeTbbArena(int maxConcurrency,
+                                        Arena::Priority priority,
+                                        CoreType coreType)
+    {
+      // with a single slot no master slot is reserved, else enqueue()d work
+      // would never be picked up by a worker
+      const unsigned reserved = maxConcurrency > 1 ? 1 : 0;
+#if TBB_INTERFACE_VERSION >= 12000
+      auto tbbPriority = tbb::task_arena::priority::normal;
+      if (priority == Arena::Priority::LOW)
+        tbbPriority = tbb::task_arena::priority::low;
+      else if (priority == Arena::Priority::HIGH)
+        tbbPriority = tbb::task_arena::priority::high;
+#if TBB_INTERFACE_VERSION >= 12020
+      // core types are ordered from the most efficient to the fastest, and
+      // there is only 'automatic' without tbbbind
+      const std::vector<tbb::core_type_id> types = tbb::info::core_types();
+      if (coreType != CoreType::UNKNOWN && types.size() > 1) {
+        tbb::task_arena::constraints constraints(tbb::task_arena::automatic,
+                                                 maxConcurrency);
+        constraints.set_core_type(coreType == CoreType::PERFORMANCE
+                                      ? types.back()
+                                      : types.front());
+        return tbb::task_arena(constraints, reserved, tbbPriority);
+      }
+#else
+      (void)coreType;
+#endif
+      return tbb::task_arena(maxConcurrency, reserved, tbbPriority);
+#else
+      (void)priority;
+      (void)coreType;
+      return tbb::task_arena(maxConcurrency, reserved);
+#endif
+    }
+#endif
+
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+    // enkiTS thread init callbacks take no context, so one per core type
+    static void pinToPerformanceCores(uint32_t)
+    {
+      detail::pinCurrentThread(
+          detail::cpusOfCoreType(CoreType::PERFORMANCE));
+    }
+
+    static void pinToEfficiencyCores(uint32_t)
+    {
+      detail::pinCurrentThread(detail::cpusOfCoreType(CoreType::EFFICIENCY));
+    }
+#endif
+
+    Arena::Impl::Impl(int _maxConcurrency,
+                      Priority _priority,
+                      CoreType _coreType)
+        : maxConcurrency(resolveConcurrency(_maxConcurrency)),
+          priority(_priority),
+          coreType(_coreType),
+          backend(currentTaskingBackend())
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+          ,
+          arena(makeTbbArena(maxConcurrency, priority, coreType))
+#endif
+    {
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+      if (backend == TaskingBackend::INTERNAL) {
+        // thread 0 of an enkiTS scheduler is whoever waits on it, so make
+        // sure there is always a worker to run enqueue()d tasks
+        enki::TaskSchedulerConfig config;
+        config.numThreads     = uint32_t(std::max(2, maxConcurrency));
+        config.partitionScale = uint32_t(detail::coreSpeedRatio());
+        if (detail::hasHybridCores() && coreType == CoreType::PERFORMANCE)
+          config.threadInit = pinToPerformanceCores;
+        else if (detail::hasHybridCores() && coreType == CoreType::EFFICIENCY)
+          config.threadInit = pinToEfficiencyCores;
+        scheduler = make_unique<enki::TaskScheduler>();
+        scheduler->Initialize(config);
+      }
+#endif
+    }
+
+    // Arena definitions //////////////////////////////////////////////////////
+
+    Arena::Arena(int maxConcurrency, Priority priority, CoreType coreType)
+        : impl(make_unique<Impl>(maxConcurrency, priority, coreType))
+    {
+    }
+
+    Arena::~Arena() = default;
+
+    int Arena::maxConcurrency() const
+    {
+      return impl->maxConcurrency;
+    }
+
+    Arena::Priority Arena::priority() const
+    {
+      return impl->priority;
+    }
+
+    CoreType Arena::coreType() const
+    {
+      return impl->coreType;
+    }
+
+    void Arena::execute(utility::FunctionRef<void()> fcn)
+    {
+      switch (impl->backend) {
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+      case TaskingBackend::TBB:
+        impl->arena.execute(fcn);
+        break;
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+      case TaskingBackend::OPENMP: {
+        const int previous = omp_get_max_threads();
+        omp_set_num_threads(impl->maxConcurrency);
+        utility::OnScopeExit restore([=]() { omp_set_num_threads(previous); });
+        fcn();
+        break;
+      }
+#endif
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+      case TaskingBackend::INTERNAL: {
+        auto *previous =
+            detail::setArenaSchedulerInternal(impl->scheduler.get());
+        utility::OnScopeExit restore(
+            [=]() { detail::setArenaSchedulerInternal(previous); });
+        fcn();
+        break;
+      }
+#endif
+      default:
+        fcn();
+      }
+    }
+
+    void Arena::enqueue(std::function<void()> fcn)
+    {
+      switch (impl->backend) {
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+      case TaskingBackend::TBB:
+        impl->arena.enqueue(std::move(fcn));
+        break;
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+      case TaskingBackend::OPENMP: {
+        const int maxThreads = impl->maxConcurrency;
+        std::thread thread([=]() {
+          omp_set_num_threads(maxThreads);
+          fcn();
+        });
+        thread.detach();
+        break;
+      }
+#endif
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+      case TaskingBackend::INTERNAL:
+        execute([&]() { detail::schedule_internal(std::move(fcn)); });
+        break;
+#endif
+      default:
+        fcn();
+      }
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
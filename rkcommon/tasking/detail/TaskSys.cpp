@@ -2,10 +2,13 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "TaskSys.h"
+#include "thread_affinity.h"
 // ospray
 #include "../../platform.h"
 // stl
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace rkcommon {
   namespace tasking {
@@ -13,34 +16,278 @@ namespace rkcommon {
 
       // TaskSys definitions //////////////////////////////////////////////////
 
+      /* Pool of PooledTasks owned by one thread. The owner allocates from and
+         returns to 'local' without synchronization, other threads return
+         tasks through the lock-free 'remote' stack which the owner drains
+         in one go when 'local' runs dry. Pools are never freed while the
+         library is loaded: when its thread exits a pool is handed to the
+         next new thread, as tasks it owns may still be in flight. */
+      struct TaskPool
+      {
+        static constexpr int BLOCK_SIZE = 64;
+
+        PooledTask *local{nullptr};
+        std::atomic<PooledTask *> remote{nullptr};
+        std::vector<std::unique_ptr<PooledTask[]>> blocks;
+      };
+
+      // declared before g_ts so the pools outlive the scheduler's threads
+      static std::mutex g_poolMutex;
+      static std::vector<std::unique_ptr<TaskPool>> g_pools;
+      static std::vector<TaskPool *> g_orphanedPools;
+
+      struct ThreadTaskPool
+      {
+        ~ThreadTaskPool()
+        {
+          if (pool) {
+            std::lock_guard<std::mutex> lock(g_poolMutex);
+            g_orphanedPools.push_back(pool);
+          }
+        }
+
+        TaskPool *get()
+        {
+          if (!pool) {
+            std::lock_guard<std::mutex> lock(g_poolMutex);
+            if (!g_orphanedPools.empty()) {
+              pool = g_orphanedPools.back();
+              g_orphanedPools.pop_back();
+            } else {
+              g_pools.push_back(make_unique<TaskPool>());
+              pool = g_pools.back().get();
+            }
+          }
+          return pool;
+        }
+
+        TaskPool *pool{nullptr};
+      };
+
+      static thread_local ThreadTaskPool t_taskPool;
+
       static std::unique_ptr<enki::TaskScheduler> g_ts;
+      // set while a thread executes inside a tasking::Arena
+      static thread_local enki::TaskScheduler *t_arenaScheduler = nullptr;
+      static AffinitySettings g_affinity;
+      static int g_numThreads{0};
+      static std::function<void(int)> g_workerInit;
+
+      static void initWorkerThread(uint32_t threadNum)
+      {
+        if (g_affinity.policy != AffinityPolicy::NONE) {
+          pinCurrentThread(affinityCpusForThread(
+              g_affinity, int(threadNum), g_numThreads));
+        }
+        if (g_workerInit)
+          g_workerInit(int(threadNum));
+      }
+
+      // The scheduler tasking calls on this thread go to: the arena being
+      // executed, else the one owning this worker thread, else the global one
+      static enki::TaskScheduler *currentScheduler()
+      {
+        if (t_arenaScheduler)
+          return t_arenaScheduler;
+
+        auto *ts = enki::TaskScheduler::GetTaskSchedulerForThisThread();
+        if (ts)
+          return ts;
+
+        if (g_ts.get() == nullptr)
+          initTaskSystemInternal(-1);
+
+        return g_ts.get();
+      }
 
       // Interface definitions ////////////////////////////////////////////////
 
-      void initTaskSystemInternal(int nThreads)
+      void initTaskSystemInternal(int nThreads,
+                                  bool workStealing,
+                                  const AffinitySettings &affinity,
+                                  const WaitPolicy &waitPolicy,
+                                  std::function<void(int)> workerInit)
       {
-        g_ts = std::unique_ptr<enki::TaskScheduler>(new enki::TaskScheduler());
+        // tear down the old scheduler first, its threads may still read the
+        // affinity settings while starting up
+        g_ts.reset();
         if (nThreads < 1)
           nThreads = enki::GetNumHardwareThreads();
-        g_ts->Initialize(nThreads);
+
+        g_affinity   = affinity;
+        g_numThreads = nThreads;
+        g_workerInit = std::move(workerInit);
+
+        enki::TaskSchedulerConfig config;
+        config.numThreads   = nThreads;
+        config.workStealing = workStealing;
+        config.spinCount    = waitPolicy.spinIterations;
+        config.yieldCount   = waitPolicy.yieldIterations;
+        config.alwaysHot    = waitPolicy.alwaysHot;
+        // finer ranges let the fast cores of hybrid CPUs take more of them
+        config.partitionScale = uint32_t(coreSpeedRatio());
+        if (affinity.policy != AffinityPolicy::NONE || g_workerInit)
+          config.threadInit = initWorkerThread;
+
+        g_ts = std::unique_ptr<enki::TaskScheduler>(new enki::TaskScheduler());
+        g_ts->Initialize(config);
+      }
+
+      void shutdownTaskSystemInternal()
+      {
+        g_ts.reset();
       }
 
       int numThreadsTaskSystemInternal()
       {
-        return g_ts->GetNumTaskThreads();
+        return currentScheduler()->GetNumTaskThreads();
       }
 
-      void scheduleTaskInternal(Task *task)
+      void setActiveThreadsTaskSystemInternal(int numThreads)
       {
         if (g_ts.get() == nullptr)
           initTaskSystemInternal(-1);
+        g_ts->SetNumActiveThreads(uint32_t(numThreads));
+      }
 
-        g_ts->AddTaskSetToPipe(task);
+      int activeThreadsTaskSystemInternal()
+      {
+        if (g_ts.get() == nullptr)
+          initTaskSystemInternal(-1);
+        return int(g_ts->GetNumActiveThreads());
+      }
+
+      bool statisticsTaskSystemInternal(
+          std::vector<enki::ThreadStatistics> &stats)
+      {
+        auto *ts = currentScheduler();
+        stats.resize(ts->GetNumTaskThreads());
+        for (uint32_t i = 0; i < uint32_t(stats.size()); ++i) {
+          if (!ts->GetThreadStatistics(i, &stats[i])) {
+            stats.clear();
+            return false;
+          }
+        }
+        return true;
+      }
+
+      void resetStatisticsTaskSystemInternal()
+      {
+        currentScheduler()->ResetStatistics();
+      }
+
+      void scheduleTaskInternal(Task *task)
+      {
+        currentScheduler()->AddTaskSetToPipe(task);
       }
 
       void waitInternal(Task *task)
       {
-        g_ts->WaitforTask(task);
+        currentScheduler()->WaitforTask(task);
+      }
+
+      bool tryRunTaskInternal()
+      {
+        return currentScheduler()->TryRunTask();
+      }
+
+      // Fire-and-forget pinned task, freed by the scheduler's thread once run
+      struct FunctionPinnedTask : public enki::IPinnedTask
+      {
+        FunctionPinnedTask(uint32_t threadNum, std::function<void()> fcn)
+            : IPinnedTask(threadNum), fcn(std::move(fcn))
+        {
+        }
+
+        void Execute() override
+        {
+          fcn();
+        }
+
+        void OnCompleted() override
+        {
+          delete this;
+        }
+
+        std::function<void()> fcn;
+      };
+
+      void scheduleOnThreadInternal(uint32_t threadNum,
+                                    std::function<void()> fcn)
+      {
+        auto *ts = currentScheduler();
+        ts->AddPinnedTask(new FunctionPinnedTask(threadNum, std::move(fcn)));
+      }
+
+      void runPinnedTasksInternal()
+      {
+        currentScheduler()->RunPinnedTasks();
+      }
+
+      void waitInternal(const std::atomic<int> &counter)
+      {
+        auto *ts = currentScheduler();
+        while (counter.load() != 0)
+          ts->WaitforTask(nullptr);
+      }
+
+      PooledTask *allocatePooledTaskInternal()
+      {
+        TaskPool *pool = t_taskPool.get();
+
+        if (!pool->local) {
+          PooledTask *returned =
+              pool->remote.exchange(nullptr, std::memory_order_acquire);
+          // the running thread releases a task just before the scheduler's
+          // final update of it, so wait for that before handing it out again
+          for (PooledTask *t = returned; t; t = t->next) {
+            while (!t->GetIsComplete())
+              std::this_thread::yield();
+          }
+          pool->local = returned;
+        }
+
+        if (!pool->local) {
+          std::unique_ptr<PooledTask[]> block(
+              new PooledTask[TaskPool::BLOCK_SIZE]);
+          for (int i = 0; i < TaskPool::BLOCK_SIZE; ++i) {
+            block[i].owner = pool;
+            block[i].next  = i + 1 < TaskPool::BLOCK_SIZE ? &block[i + 1]
+                                                         : nullptr;
+          }
+          pool->local = &block[0];
+          pool->blocks.push_back(std::move(block));
+        }
+
+        PooledTask *task = pool->local;
+        pool->local      = task->next;
+        task->next       = nullptr;
+        return task;
+      }
+
+      void PooledTask::ExecuteRange(enki::TaskSetPartition, uint32_t)
+      {
+        invoke(storage);
+        destroy(storage);
+
+        TaskPool *pool = owner;
+        if (pool == t_taskPool.pool) {
+          next        = pool->local;
+          pool->local = this;
+        } else {
+          PooledTask *head = pool->remote.load(std::memory_order_relaxed);
+          do {
+            next = head;
+          } while (!pool->remote.compare_exchange_weak(
+              head, this, std::memory_order_release, std::memory_order_relaxed));
+        }
+      }
+
+      enki::TaskScheduler *setArenaSchedulerInternal(enki::TaskScheduler *ts)
+      {
+        auto *previous   = t_arenaScheduler;
+        t_arenaScheduler = ts;
+        return previous;
       }
 
     }  // namespace detail
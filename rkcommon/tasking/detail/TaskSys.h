@@ -4,6 +4,18 @@
 #pragma once
 
 #include "../../common.h"
+#include "../../containers/AlignedVector.h"
+#include "../AffinityHint.h"
+#include "../TaskPriority.h"
+#include "../tasking_system_init.h"
+// std
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <vector>
 // enkiTS
 #include "enkiTS/TaskScheduler.h"
 
@@ -15,14 +27,77 @@ namespace rkcommon {
 
       using Task = enki::ITaskSet;
 
-      void RKCOMMON_INTERFACE initTaskSystemInternal(int numThreads = -1);
+      // 'workStealing' selects the scheduler's Chase-Lev deque mode, which
+      // balances highly irregular per-task costs better than the default;
+      // 'affinity' is applied to each worker thread as it starts, followed
+      // by 'workerInit', and idle workers wait for new tasks according to
+      // 'waitPolicy'
+      void RKCOMMON_INTERFACE
+      initTaskSystemInternal(int numThreads                      = -1,
+                             bool workStealing                   = false,
+                             const AffinitySettings &affinity    = {},
+                             const WaitPolicy &waitPolicy        = {},
+                             std::function<void(int)> workerInit = nullptr);
+
+      // Stop the default scheduler's threads, e.g. when a Dynamic build
+      // switches to another backend. It is restarted by the next tasking call.
+      void RKCOMMON_INTERFACE shutdownTaskSystemInternal();
 
       int RKCOMMON_INTERFACE numThreadsTaskSystemInternal();
 
+      // Park or unpark workers of the default scheduler, keeping 'numThreads'
+      // (including thread 0) running tasks
+      void RKCOMMON_INTERFACE
+      setActiveThreadsTaskSystemInternal(int numThreads);
+
+      int RKCOMMON_INTERFACE activeThreadsTaskSystemInternal();
+
+      // Per worker counters of the current scheduler, false if enkiTS was
+      // built without ENKITS_STATISTICS
+      bool RKCOMMON_INTERFACE
+      statisticsTaskSystemInternal(std::vector<enki::ThreadStatistics> &stats);
+
+      void RKCOMMON_INTERFACE resetStatisticsTaskSystemInternal();
+
       void RKCOMMON_INTERFACE scheduleTaskInternal(Task *task);
 
       void RKCOMMON_INTERFACE waitInternal(Task *task);
 
+      // Run one task on the calling thread, false if there was none
+      bool RKCOMMON_INTERFACE tryRunTaskInternal();
+
+      // Run 'fcn' on worker 'threadNum' of the current scheduler; 0 denotes
+      // the threads not owned by it, which run such tasks in
+      // runPinnedTasksInternal() or while waiting for other tasks
+      void RKCOMMON_INTERFACE
+      scheduleOnThreadInternal(uint32_t threadNum, std::function<void()> fcn);
+
+      void RKCOMMON_INTERFACE runPinnedTasksInternal();
+
+      // Run tasks on the calling thread until 'counter' drops to zero
+      void RKCOMMON_INTERFACE waitInternal(const std::atomic<int> &counter);
+
+      // Direct tasking calls made by this thread to 'ts' (nullptr restores the
+      // default scheduler), returning the previous setting. Used by Arena.
+      enki::TaskScheduler *RKCOMMON_INTERFACE
+      setArenaSchedulerInternal(enki::TaskScheduler *ts);
+
+      /* Grain size for a parallel loop over 'setSize' elements started from
+         inside another one: at nesting depth d the loop is cut into at most
+         4 * numThreads / 4^d pieces, as the enclosing levels already keep
+         the workers busy and finer pieces would only add scheduling and
+         waiting overhead. Returns 1 at the top level. */
+      inline uint32_t nestedMinRangeInternal(uint32_t setSize)
+      {
+        const uint32_t depth = enki::TaskScheduler::GetNestingDepth();
+        if (depth == 0)
+          return 1;
+        const uint32_t numThreads = uint32_t(numThreadsTaskSystemInternal());
+        const uint32_t numPieces =
+            depth < 16 ? std::max(1u, (4 * numThreads) >> (2 * depth)) : 1u;
+        return std::max(1u, (setSize + numPieces - 1) / numPieces);
+      }
+
       template <typename TASK_T>
       inline void parallel_for_internal(int nTasks, TASK_T &&fcn)
       {
@@ -44,30 +119,286 @@ namespace rkcommon {
           }
         };
 
+        const uint32_t minRange = nestedMinRangeInternal(uint32_t(nTasks));
+        if (minRange >= uint32_t(nTasks)) {
+          // nested loop not worth splitting, don't schedule and wait at all
+          for (int i = 0; i < nTasks; ++i)
+            fcn(i);
+          return;
+        }
+
         LocalTask task(nTasks, std::forward<TASK_T>(fcn));
+        task.m_MinRange = minRange;
         scheduleTaskInternal(&task);
         waitInternal(&task);
       }
 
-      template <typename TASK_T>
-      inline void schedule_internal(TASK_T &&fcn)
+      template <typename INDEX_T, typename TASK_T>
+      inline void parallel_for_range_internal(INDEX_T begin,
+                                              INDEX_T end,
+                                              INDEX_T grainSize,
+                                              TASK_T &&fcn)
       {
         struct LocalTask : public Task
         {
-          TASK_T t;
+          const TASK_T &t;
+          INDEX_T offset;
 
-          LocalTask(TASK_T &&fcn) : Task(1), t(std::forward<TASK_T>(fcn)) {}
+          LocalTask(INDEX_T begin, INDEX_T end, INDEX_T grainSize, TASK_T &&fcn)
+              : Task(uint32_t(end - begin), uint32_t(grainSize)),
+                t(std::forward<TASK_T>(fcn)),
+                offset(begin)
+          {
+          }
 
           ~LocalTask() override = default;
 
-          void ExecuteRange(enki::TaskSetPartition, uint32_t) override
+          void ExecuteRange(enki::TaskSetPartition tp, uint32_t) override
           {
-            t();
-            delete this;
+            t(offset + INDEX_T(tp.start), offset + INDEX_T(tp.end));
           }
         };
 
-        auto *task = new LocalTask(std::forward<TASK_T>(fcn));
+        const uint32_t minRange = std::max(
+            uint32_t(grainSize), nestedMinRangeInternal(uint32_t(end - begin)));
+        if (end > begin && minRange >= uint32_t(end - begin)) {
+          // nested loop not worth splitting, run it as a single range
+          fcn(begin, end);
+          return;
+        }
+
+        LocalTask task(begin, end, grainSize, std::forward<TASK_T>(fcn));
+        task.m_MinRange = minRange;
+        scheduleTaskInternal(&task);
+        waitInternal(&task);
+      }
+
+      /* Runs fcn(begin, end) on the chunks planned by 'record', each thread
+         its own chunks of the last loop first, then those not yet taken */
+      template <typename INDEX_T, typename TASK_T>
+      inline void parallel_for_affinity_internal(INDEX_T numUnits,
+                                                 AffinityRecord &record,
+                                                 TASK_T &&fcn)
+      {
+        if (enki::TaskScheduler::GetNestingDepth() > 0) {
+          // the enclosing loop decides the placement already
+          parallel_for_range_internal(
+              INDEX_T(0), numUnits, INDEX_T(1), std::forward<TASK_T>(fcn));
+          return;
+        }
+
+        const uint32_t numThreads = uint32_t(numThreadsTaskSystemInternal());
+        record.prepare(size_t(numUnits), numThreads);
+
+        struct LocalTask : public Task
+        {
+          const TASK_T &t;
+          INDEX_T numUnits;
+          AffinityRecord &record;
+
+          LocalTask(INDEX_T numUnits, AffinityRecord &record, TASK_T &&fcn)
+              : Task(record.numThreads),
+                t(std::forward<TASK_T>(fcn)),
+                numUnits(numUnits),
+                record(record)
+          {
+          }
+
+          ~LocalTask() override = default;
+
+          void runChunk(uint32_t chunk, uint32_t thread) const
+          {
+            if (record.claimed[chunk].exchange(true, std::memory_order_relaxed))
+              return;
+            const size_t begin = chunk * record.chunkSize;
+            const size_t end =
+                std::min(begin + record.chunkSize, size_t(numUnits));
+            t(INDEX_T(begin), INDEX_T(end));
+            record.owner[chunk] = thread;
+          }
+
+          void ExecuteRange(enki::TaskSetPartition, uint32_t threadnum) override
+          {
+            const uint32_t thread = threadnum % record.numThreads;
+            const uint32_t *order = record.order.data();
+            const uint32_t *first = record.firstChunk.data();
+            const uint32_t chunks = uint32_t(record.numChunks());
+            for (uint32_t i = first[thread]; i < first[thread + 1]; ++i)
+              runChunk(order[i], thread);
+
+            // help with the chunks of threads which did not show up (yet),
+            // starting at different ones to not contend for the same chunks
+            const uint32_t start = first[thread];
+            for (uint32_t i = 0; i < chunks; ++i)
+              runChunk(order[(start + i) % chunks], thread);
+          }
+        };
+
+        LocalTask task(numUnits, record, std::forward<TASK_T>(fcn));
+        task.m_MinRange = 1;
+        scheduleTaskInternal(&task);
+        waitInternal(&task);
+      }
+
+      template <typename VALUE_T, typename MAP_T, typename COMBINE_T>
+      inline VALUE_T parallel_reduce_internal(int nTasks,
+                                              const VALUE_T &identity,
+                                              MAP_T &&mapFcn,
+                                              COMBINE_T &&combineFcn)
+      {
+        // one slot per worker (indexed by enkiTS' 'threadnum'), each on its
+        // own cache line to avoid false sharing between workers
+        struct alignas(64) Partial
+        {
+          VALUE_T value;
+        };
+
+        struct LocalTask : public Task
+        {
+          const VALUE_T &identity;
+          const MAP_T &m;
+          const COMBINE_T &c;
+          containers::AlignedVector<Partial> &partials;
+
+          LocalTask(int numTasks,
+                    const VALUE_T &identity,
+                    const MAP_T &mapFcn,
+                    const COMBINE_T &combineFcn,
+                    containers::AlignedVector<Partial> &partials)
+              : Task(numTasks),
+                identity(identity),
+                m(mapFcn),
+                c(combineFcn),
+                partials(partials)
+          {
+          }
+
+          ~LocalTask() override = default;
+
+          void ExecuteRange(enki::TaskSetPartition tp,
+                            uint32_t threadnum) override
+          {
+            VALUE_T acc = identity;
+            for (auto i = tp.start; i < tp.end; ++i)
+              acc = c(acc, m(i));
+            VALUE_T &slot = partials[threadnum].value;
+            slot          = c(slot, acc);
+          }
+        };
+
+        const uint32_t minRange = nestedMinRangeInternal(uint32_t(nTasks));
+        if (minRange >= uint32_t(nTasks)) {
+          VALUE_T acc = identity;
+          for (int i = 0; i < nTasks; ++i)
+            acc = combineFcn(acc, mapFcn(i));
+          return combineFcn(identity, acc);
+        }
+
+        containers::AlignedVector<Partial> partials(
+            numThreadsTaskSystemInternal(), Partial{identity});
+
+        LocalTask task(nTasks, identity, mapFcn, combineFcn, partials);
+        task.m_MinRange = minRange;
+        scheduleTaskInternal(&task);
+        waitInternal(&task);
+
+        VALUE_T result = identity;
+        for (const auto &p : partials)
+          result = combineFcn(result, p.value);
+        return result;
+      }
+
+      struct TaskPool;
+
+      /* Fire-and-forget task used by schedule(). These are recycled through
+         per-thread free lists (see allocatePooledTaskInternal()), and small
+         functors are stored inline, so scheduling a task usually does not
+         touch the general purpose allocator. */
+      struct RKCOMMON_INTERFACE PooledTask : public Task
+      {
+        static constexpr size_t STORAGE_SIZE = 64;
+
+        PooledTask() : Task(1) {}
+        ~PooledTask() override = default;
+
+        template <typename FCN_T>
+        void emplace(FCN_T &&fcn);
+        template <typename FCN_T>
+        void emplace(FCN_T &&fcn, std::true_type);
+        template <typename FCN_T>
+        void emplace(FCN_T &&fcn, std::false_type);
+
+        void ExecuteRange(enki::TaskSetPartition, uint32_t) override;
+
+        alignas(alignof(std::max_align_t)) unsigned char storage[STORAGE_SIZE];
+        void (*invoke)(void *){nullptr};
+        void (*destroy)(void *){nullptr};
+
+        TaskPool *owner{nullptr};
+        PooledTask *next{nullptr};
+      };
+
+      PooledTask *RKCOMMON_INTERFACE allocatePooledTaskInternal();
+
+      template <typename FCN_T>
+      inline void PooledTask::emplace(FCN_T &&fcn)
+      {
+        using fcn_t = typename std::decay<FCN_T>::type;
+        using fits_inline =
+            std::integral_constant<bool,
+                                   sizeof(fcn_t) <= STORAGE_SIZE
+                                       && alignof(fcn_t)
+                                              <= alignof(std::max_align_t)>;
+        emplace(std::forward<FCN_T>(fcn), fits_inline());
+      }
+
+      template <typename FCN_T>
+      inline void PooledTask::emplace(FCN_T &&fcn, std::true_type)
+      {
+        using fcn_t = typename std::decay<FCN_T>::type;
+        new (storage) fcn_t(std::forward<FCN_T>(fcn));
+        invoke  = [](void *p) { (*static_cast<fcn_t *>(p))(); };
+        destroy = [](void *p) { static_cast<fcn_t *>(p)->~fcn_t(); };
+      }
+
+      template <typename FCN_T>
+      inline void PooledTask::emplace(FCN_T &&fcn, std::false_type)
+      {
+        // too large to store inline, keep only a pointer to it
+        using fcn_t   = typename std::decay<FCN_T>::type;
+        auto *heapFcn = new fcn_t(std::forward<FCN_T>(fcn));
+        std::memcpy(storage, &heapFcn, sizeof(heapFcn));
+        invoke = [](void *p) {
+          fcn_t *f;
+          std::memcpy(&f, p, sizeof(f));
+          (*f)();
+        };
+        destroy = [](void *p) {
+          fcn_t *f;
+          std::memcpy(&f, p, sizeof(f));
+          delete f;
+        };
+      }
+
+      inline enki::TaskPriority enkiPriority(TaskPriority priority)
+      {
+        switch (priority) {
+        case TaskPriority::HIGH:
+          return enki::TASK_PRIORITY_HIGH;
+        case TaskPriority::LOW:
+          return enki::TASK_PRIORITY_LOW;
+        default:
+          return enki::TASK_PRIORITY_MED;
+        }
+      }
+
+      template <typename TASK_T>
+      inline void schedule_internal(
+          TASK_T &&fcn, TaskPriority priority = TaskPriority::NORMAL)
+      {
+        auto *task = allocatePooledTaskInternal();
+        task->emplace(std::forward<TASK_T>(fcn));
+        task->m_Priority = enkiPriority(priority);
         scheduleTaskInternal(task);
       }
 
@@ -0,0 +1,76 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../TaskingStatistics.h"
+#include "dynamic_backend.h"
+
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+#include "TaskSys.h"
+#endif
+
+// rkcommon
+#include "../../tracing/Tracing.h"
+
+namespace rkcommon {
+  namespace tasking {
+
+    namespace detail {
+
+      // see TuningSlot.cpp
+      std::vector<TunedLoopStatistics> tunedLoopStatistics();
+
+    }  // namespace detail
+
+    TaskingStatistics getStatistics()
+    {
+      TaskingStatistics stats;
+      stats.tunedLoops = detail::tunedLoopStatistics();
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+      if (currentTaskingBackend() != TaskingBackend::INTERNAL)
+        return stats;
+
+      std::vector<enki::ThreadStatistics> threads;
+      stats.enabled = detail::statisticsTaskSystemInternal(threads);
+      for (const auto &t : threads) {
+        WorkerStatistics w;
+        w.tasksExecuted     = t.tasksExecuted;
+        w.busyNanoseconds   = t.busyNs;
+        w.sleepNanoseconds  = t.sleepNs;
+        w.wakes             = t.wakes;
+        w.steals            = t.steals;
+        w.splits            = t.splits;
+        w.pipeFullFallbacks = t.pipeFullFallbacks;
+        stats.workers.push_back(w);
+      }
+#endif
+      return stats;
+    }
+
+    void resetStatistics()
+    {
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+      if (currentTaskingBackend() == TaskingBackend::INTERNAL)
+        detail::resetStatisticsTaskSystemInternal();
+#endif
+    }
+
+    void traceStatistics()
+    {
+#ifdef RKCOMMON_ENABLE_PROFILING
+      const TaskingStatistics stats = getStatistics();
+      if (!stats.enabled)
+        return;
+
+      const WorkerStatistics t = stats.total();
+      tracing::setCounter("tasking.tasksExecuted", t.tasksExecuted);
+      tracing::setCounter("tasking.busyNanoseconds", t.busyNanoseconds);
+      tracing::setCounter("tasking.sleepNanoseconds", t.sleepNanoseconds);
+      tracing::setCounter("tasking.wakes", t.wakes);
+      tracing::setCounter("tasking.steals", t.steals);
+      tracing::setCounter("tasking.splits", t.splits);
+      tracing::setCounter("tasking.pipeFullFallbacks", t.pipeFullFallbacks);
+#endif
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,68 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../ThreadLocal.h"
+// std
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      // Hands out the smallest free index, so the slot arrays only grow with
+      // the number of threads alive at the same time
+      struct ThreadIndexRegistry
+      {
+        size_t acquire()
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (freeIndices.empty())
+            return nextIndex++;
+          const size_t index = freeIndices.top();
+          freeIndices.pop();
+          return index;
+        }
+
+        void release(size_t index)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          freeIndices.push(index);
+        }
+
+       private:
+        std::mutex mutex;
+        size_t nextIndex{0};
+        std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>>
+            freeIndices;
+      };
+
+      static ThreadIndexRegistry &threadIndexRegistry()
+      {
+        // intentionally leaked: threads may exit after static destruction
+        static ThreadIndexRegistry *registry = new ThreadIndexRegistry;
+        return *registry;
+      }
+
+      struct ThreadIndex
+      {
+        ThreadIndex() : index(threadIndexRegistry().acquire()) {}
+        ~ThreadIndex()
+        {
+          threadIndexRegistry().release(index);
+        }
+
+        const size_t index;
+      };
+
+      size_t threadLocalIndex()
+      {
+        static thread_local ThreadIndex threadIndex;
+        return threadIndex.index;
+      }
+
+    }  // namespace detail
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,135 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../TuningSlot.h"
+#include "../TaskingStatistics.h"
+#include "../tasking_system_init.h"
+// std
+#include <algorithm>
+#include <vector>
+
+namespace rkcommon {
+  namespace tasking {
+
+    // All live slots, reported by getStatistics()
+    struct TuningRegistry
+    {
+      std::mutex mutex;
+      std::vector<TuningSlot *> slots;
+    };
+
+    static TuningRegistry &registry()
+    {
+      static TuningRegistry r;
+      return r;
+    }
+
+    TuningSlot::TuningSlot(const char *name,
+                           std::chrono::nanoseconds targetChunkTime)
+        : slotName(name), target(targetChunkTime)
+    {
+      TuningRegistry &r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.slots.push_back(this);
+    }
+
+    TuningSlot::~TuningSlot()
+    {
+      TuningRegistry &r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.slots.erase(std::remove(r.slots.begin(), r.slots.end(), this),
+                    r.slots.end());
+    }
+
+    const char *TuningSlot::name() const
+    {
+      return slotName;
+    }
+
+    std::chrono::nanoseconds TuningSlot::targetChunkTime() const
+    {
+      return target;
+    }
+
+    uint64_t TuningSlot::grainSize(uint64_t numIndices) const
+    {
+      const uint64_t numThreads = uint64_t(std::max(numTaskingThreads(), 1));
+      // a few chunks per thread leave room to balance the load
+      const uint64_t maxGrain =
+          std::max<uint64_t>((numIndices + 4 * numThreads - 1)
+                                 / (4 * numThreads),
+                             1);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      uint64_t grain = maxGrain;
+      if (nsPerIndex > 0.0) {
+        const double indices = double(target.count()) / nsPerIndex;
+        if (indices >= double(numIndices))
+          grain = std::max<uint64_t>(numIndices, 1);  // not worth splitting
+        else
+          grain = std::min(std::max(uint64_t(indices), uint64_t(1)), maxGrain);
+      }
+      lastGrain = grain;
+      return grain;
+    }
+
+    void TuningSlot::record(uint64_t numIndices, uint64_t busyNanoseconds)
+    {
+      if (numIndices == 0)
+        return;
+
+      const double measured = double(busyNanoseconds) / double(numIndices);
+      std::lock_guard<std::mutex> lock(mutex);
+      // smoothed, single slow or fast loops don't swing the grain size
+      nsPerIndex = loops == 0 ? measured : 0.75 * nsPerIndex + 0.25 * measured;
+      loops++;
+    }
+
+    uint64_t TuningSlot::lastGrainSize() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return lastGrain;
+    }
+
+    double TuningSlot::nanosecondsPerIndex() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return nsPerIndex;
+    }
+
+    uint64_t TuningSlot::numLoops() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return loops;
+    }
+
+    void TuningSlot::reset()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      nsPerIndex = 0.0;
+      lastGrain  = 0;
+      loops      = 0;
+    }
+
+    namespace detail {
+
+      std::vector<TunedLoopStatistics> tunedLoopStatistics()
+      {
+        std::vector<TunedLoopStatistics> loops;
+        TuningRegistry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const TuningSlot *slot : r.slots) {
+          TunedLoopStatistics s;
+          s.name                = slot->name();
+          s.loops               = slot->numLoops();
+          s.grainSize           = slot->lastGrainSize();
+          s.nanosecondsPerIndex = slot->nanosecondsPerIndex();
+          loops.push_back(s);
+        }
+        return loops;
+      }
+
+    }  // namespace detail
+
+  }  // namespace tasking
+}  // namespace rkcommon
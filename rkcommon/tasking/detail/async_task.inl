@@ -3,14 +3,20 @@
 
 #pragma once
 
+#include "../TaskPriority.h"
+
 #if defined(RKCOMMON_TASKING_TBB)
 #define __TBB_NO_IMPLICIT_LINKAGE 1
 #define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
 #include <tbb/task_group.h>
+#include "task_priority.h"
+#include "tbb_context.h"
 #elif defined(RKCOMMON_TASKING_OMP)
 #include <thread>
 #elif defined(RKCOMMON_TASKING_INTERNAL)
 #include "TaskSys.h"
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+#include "dynamic_backend.h"
 #endif
 
 namespace rkcommon {
@@ -20,12 +26,16 @@ namespace rkcommon {
       template <typename TASK_T>
       struct AsyncTaskImpl
       {
-        AsyncTaskImpl(TASK_T &&fcn);
+        AsyncTaskImpl(TASK_T &&fcn,
+                      TaskPriority priority = TaskPriority::NORMAL);
         void wait();
 
        private:
 #if defined(RKCOMMON_TASKING_TBB)
-        tbb::task_group taskGroup;
+        tbb::task_group_context context;
+        tbb::task_group taskGroup{context};
+        // nullptr for TaskPriority::NORMAL
+        tbb::task_arena *arena{nullptr};
 #elif defined(RKCOMMON_TASKING_OMP)
         std::thread thread;
 #elif defined(RKCOMMON_TASKING_INTERNAL)
@@ -39,6 +49,8 @@ namespace rkcommon {
           }
         };
         LocalTask task;
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+        DynamicAsyncTask task;
 #endif
       };
 
@@ -46,22 +58,36 @@ namespace rkcommon {
       // ////////////////////////////////////////////////////
 
       template <typename TASK_T>
-      inline AsyncTaskImpl<TASK_T>::AsyncTaskImpl(TASK_T &&fcn)
+      inline AsyncTaskImpl<TASK_T>::AsyncTaskImpl(TASK_T &&fcn,
+                                                   TaskPriority priority)
 #if defined(RKCOMMON_TASKING_TBB)
       {
-        taskGroup.run(std::forward<TASK_T>(fcn));
+        initTbbContext(context);
+        if (priority == TaskPriority::NORMAL) {
+          taskGroup.run(std::forward<TASK_T>(fcn));
+        } else {
+          arena = &detail::tbbPriorityArena(priority);
+          arena->execute([&]() { taskGroup.run(std::forward<TASK_T>(fcn)); });
+        }
       }
 #elif defined(RKCOMMON_TASKING_OMP)
           : thread(std::forward<TASK_T>(fcn))
       {
+        (void)priority;
       }
 #elif defined(RKCOMMON_TASKING_INTERNAL)
           : task(std::forward<TASK_T>(fcn))
       {
+        task.m_Priority = detail::enkiPriority(priority);
         detail::scheduleTaskInternal(&task);
       }
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+          : task(std::forward<TASK_T>(fcn), priority)
+      {
+      }
 #else
       {
+        (void)priority;
         fcn();
       }
 #endif
@@ -70,12 +96,17 @@ namespace rkcommon {
       inline void AsyncTaskImpl<TASK_T>::wait()
       {
 #if defined(RKCOMMON_TASKING_TBB)
-        taskGroup.wait();
+        if (arena)
+          arena->execute([&]() { taskGroup.wait(); });
+        else
+          taskGroup.wait();
 #elif defined(RKCOMMON_TASKING_OMP)
         if (thread.joinable())
           thread.join();
 #elif defined(RKCOMMON_TASKING_INTERNAL)
         detail::waitInternal(&task);
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+        task.wait();
 #endif
       }
     }  // namespace detail
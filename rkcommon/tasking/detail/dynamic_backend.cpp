@@ -0,0 +1,221 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "dynamic_backend.h"
+
+// tasking system internals
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+#define __TBB_NO_IMPLICIT_LINKAGE 1
+#define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+#include <omp.h>
+#endif
+#include "TaskSys.h"
+#include "task_priority.h"
+#include "tbb_context.h"
+
+// std
+#include <algorithm>
+#include <thread>
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      void dynamicParallelForRange(size_t begin,
+                                   size_t end,
+                                   size_t grainSize,
+                                   range_fcn_t fcn,
+                                   void *data)
+      {
+        grainSize = std::max(grainSize, size_t(1));
+
+        switch (currentTaskingBackend()) {
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+        case TaskingBackend::TBB: {
+          tbb::task_group_context context;
+          initTbbContext(context);
+          tbb::parallel_for(tbb::blocked_range<size_t>(begin, end, grainSize),
+                            [&](const tbb::blocked_range<size_t> &r) {
+                              fcn(data, r.begin(), r.end());
+                            },
+                            context);
+          break;
+        }
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+        case TaskingBackend::OPENMP: {
+          const long long numChunks =
+              (long long)((end - begin + grainSize - 1) / grainSize);
+#pragma omp parallel for schedule(dynamic)
+          for (long long chunk = 0; chunk < numChunks; ++chunk) {
+            const size_t chunkBegin = begin + size_t(chunk) * grainSize;
+            const size_t chunkEnd   = std::min(chunkBegin + grainSize, end);
+            fcn(data, chunkBegin, chunkEnd);
+          }
+          break;
+        }
+#endif
+        case TaskingBackend::INTERNAL:
+          parallel_for_range_internal(
+              begin, end, grainSize, [&](size_t b, size_t e) {
+                fcn(data, b, e);
+              });
+          break;
+        default:  // SERIAL
+          fcn(data, begin, end);
+        }
+      }
+
+      template <typename FCN_T>
+      static void dynamicScheduleImpl(FCN_T fcn, TaskPriority priority)
+      {
+        switch (currentTaskingBackend()) {
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+        case TaskingBackend::TBB: {
+          if (priority == TaskPriority::NORMAL) {
+            tbb::task_arena ta = tbb::task_arena(tbb::task_arena::attach());
+            ta.enqueue(std::move(fcn));
+          } else {
+            tbbPriorityArena(priority).enqueue(std::move(fcn));
+          }
+          break;
+        }
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+        case TaskingBackend::OPENMP: {
+          std::thread thread(std::move(fcn));
+          thread.detach();
+          break;
+        }
+#endif
+        case TaskingBackend::INTERNAL:
+          schedule_internal(std::move(fcn), priority);
+          break;
+        default:  // SERIAL --> synchronous!
+          fcn();
+        }
+      }
+
+      void dynamicSchedule(std::function<void()> fcn, TaskPriority priority)
+      {
+        dynamicScheduleImpl(std::move(fcn), priority);
+      }
+
+      void dynamicSchedule(ScheduledFunction fcn, TaskPriority priority)
+      {
+        dynamicScheduleImpl(std::move(fcn), priority);
+      }
+
+      // DynamicAsyncTask definitions /////////////////////////////////////////
+
+      struct DynamicAsyncTask::Impl
+      {
+        Impl(std::function<void()> fcn, TaskPriority priority);
+
+        void wait();
+
+        TaskingBackend backend;
+
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+        tbb::task_group_context context;
+        tbb::task_group taskGroup{context};
+        // nullptr for TaskPriority::NORMAL
+        tbb::task_arena *arena{nullptr};
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+        std::thread thread;
+#endif
+        struct LocalTask : public Task
+        {
+          std::function<void()> t;
+          void ExecuteRange(enki::TaskSetPartition, uint32_t) override
+          {
+            t();
+          }
+        };
+        LocalTask task;
+      };
+
+      DynamicAsyncTask::Impl::Impl(std::function<void()> fcn,
+                                   TaskPriority priority)
+          : backend(currentTaskingBackend())
+      {
+        switch (backend) {
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+        case TaskingBackend::TBB:
+          initTbbContext(context);
+          if (priority == TaskPriority::NORMAL) {
+            taskGroup.run(std::move(fcn));
+          } else {
+            arena = &tbbPriorityArena(priority);
+            arena->execute([&]() { taskGroup.run(std::move(fcn)); });
+          }
+          break;
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+        case TaskingBackend::OPENMP:
+          thread = std::thread(std::move(fcn));
+          break;
+#endif
+        case TaskingBackend::INTERNAL:
+          task.t          = std::move(fcn);
+          task.m_Priority = enkiPriority(priority);
+          scheduleTaskInternal(&task);
+          break;
+        default:  // SERIAL
+          (void)priority;
+          fcn();
+        }
+      }
+
+      void DynamicAsyncTask::Impl::wait()
+      {
+        switch (backend) {
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+        case TaskingBackend::TBB:
+          if (arena)
+            arena->execute([&]() { taskGroup.wait(); });
+          else
+            taskGroup.wait();
+          break;
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+        case TaskingBackend::OPENMP:
+          if (thread.joinable())
+            thread.join();
+          break;
+#endif
+        case TaskingBackend::INTERNAL:
+          waitInternal(&task);
+          break;
+        default:
+          break;
+        }
+      }
+
+      DynamicAsyncTask::DynamicAsyncTask(std::function<void()> fcn,
+                                         TaskPriority priority)
+          : impl(make_unique<Impl>(std::move(fcn), priority))
+      {
+      }
+
+      DynamicAsyncTask::~DynamicAsyncTask()
+      {
+        // a still running std::thread or task set must not be destroyed
+        impl->wait();
+      }
+
+      void DynamicAsyncTask::wait()
+      {
+        impl->wait();
+      }
+
+    }  // namespace detail
+  }    // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,96 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../../common.h"
+#include "../../utility/InplaceFunction.h"
+#include "../TaskPriority.h"
+#include "../tasking_system_init.h"
+// std
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+// Backends compiled into this build, whether it is a static or Dynamic one
+#if defined(RKCOMMON_TASKING_TBB) \
+    || (defined(RKCOMMON_TASKING_DYNAMIC) && defined(RKCOMMON_TASKING_HAS_TBB))
+#define RKCOMMON_TASKING_WITH_TBB 1
+#endif
+#if defined(RKCOMMON_TASKING_OMP) \
+    || (defined(RKCOMMON_TASKING_DYNAMIC) && defined(RKCOMMON_TASKING_HAS_OMP))
+#define RKCOMMON_TASKING_WITH_OMP 1
+#endif
+#if defined(RKCOMMON_TASKING_INTERNAL) || defined(RKCOMMON_TASKING_DYNAMIC)
+#define RKCOMMON_TASKING_WITH_INTERNAL 1
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      // Type erased entry points of a Dynamic build, each one forwards to
+      // currentTaskingBackend(). Static builds never call these.
+
+      using range_fcn_t = void (*)(void *data, size_t begin, size_t end);
+
+      // Call fcn(data, b, e) on sub-ranges of [begin, end), which are about
+      // 'grainSize' long, and wait for all of them
+      void RKCOMMON_INTERFACE dynamicParallelForRange(size_t begin,
+                                                      size_t end,
+                                                      size_t grainSize,
+                                                      range_fcn_t fcn,
+                                                      void *data);
+
+      void RKCOMMON_INTERFACE dynamicSchedule(
+          std::function<void()> fcn,
+          TaskPriority priority = TaskPriority::NORMAL);
+
+      // Small tasks are passed inline, fitting the Internal backend's pooled
+      // task storage, so scheduling them does not allocate
+      using ScheduledFunction =
+          utility::InplaceFunction<void(), 6 * sizeof(void *)>;
+
+      void RKCOMMON_INTERFACE dynamicSchedule(
+          ScheduledFunction fcn, TaskPriority priority = TaskPriority::NORMAL);
+
+      // One function running asynchronously on the backend, see AsyncTaskImpl
+      class RKCOMMON_INTERFACE DynamicAsyncTask
+      {
+       public:
+        explicit DynamicAsyncTask(std::function<void()> fcn,
+                                  TaskPriority priority = TaskPriority::NORMAL);
+        ~DynamicAsyncTask();
+
+        void wait();
+
+       private:
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+      };
+
+      template <typename INDEX_T, typename RANGE_FCN_T>
+      inline void dynamic_parallel_for_range(INDEX_T begin,
+                                             INDEX_T end,
+                                             INDEX_T grainSize,
+                                             RANGE_FCN_T &&fcn)
+      {
+        using fcn_t = typename std::remove_reference<RANGE_FCN_T>::type;
+
+        if (!(begin < end))
+          return;
+
+        dynamicParallelForRange(
+            size_t(begin),
+            size_t(end),
+            size_t(grainSize),
+            [](void *data, size_t b, size_t e) {
+              (*static_cast<fcn_t *>(data))(INDEX_T(b), INDEX_T(e));
+            },
+            const_cast<void *>(static_cast<const void *>(&fcn)));
+      }
+
+    }  // namespace detail
+  }    // namespace tasking
+}  // namespace rkcommon
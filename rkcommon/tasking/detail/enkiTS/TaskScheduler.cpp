@@ -20,6 +20,9 @@
 
 #include "TaskScheduler.h"
 #include "LockLessMultiReadPipe.h"
+#include "WorkStealingDeque.h"
+
+#include <thread>
 
 #if defined __i386__ || defined __x86_64__
 #include "x86intrin.h"
@@ -27,17 +30,33 @@
 #include <intrin.h>
 #endif
 
+#ifdef ENKITS_STATISTICS
+#include <atomic>
+#include <chrono>
+#endif
+
 using namespace enki;
 
 
 static const uint32_t PIPESIZE_LOG2              = 8;
-static const uint32_t SPIN_COUNT                 = 100;
+static const uint32_t DEQUESIZE_LOG2             = 8;
 static const uint32_t SPIN_BACKOFF_MULTIPLIER    = 10;
+static const uint32_t MAX_SPIN_BACKOFF           = 100 * SPIN_BACKOFF_MULTIPLIER;
 static const uint32_t MAX_NUM_INITIAL_PARTITIONS = 8;
 
 // each software thread gets it's own copy of gtl_threadNum, so this is safe to use as a static variable
 static THREAD_LOCAL uint32_t                             gtl_threadNum       = 0;
 
+// the scheduler gtl_threadNum refers to, NULL for threads not created by a scheduler.
+// Several schedulers may exist, so a task thread of one is only thread 0 of any other.
+static THREAD_LOCAL TaskScheduler*                       gtl_pCurrTS         = NULL;
+
+// state of the per thread random number generator used to pick steal victims, 0 until seeded
+static THREAD_LOCAL uint32_t                             gtl_stealRngState   = 0;
+
+// number of task sets of more than one element being run by this thread, see GetNestingDepth()
+static THREAD_LOCAL uint32_t                             gtl_nestingDepth    = 0;
+
 namespace enki
 {
     struct SubTaskSet
@@ -49,6 +68,8 @@ namespace enki
     // we derive class TaskPipe rather than typedef to get forward declaration working easily
     class TaskPipe : public LockLessMultiReadPipe<PIPESIZE_LOG2,enki::SubTaskSet> {};
 
+    class TaskDeque : public WorkStealingDeque<DEQUESIZE_LOG2,enki::SubTaskSet> {};
+
     struct ThreadArgs
     {
         uint32_t        threadNum;
@@ -56,10 +77,50 @@ namespace enki
     };
 
     class PinnedTaskList : public LocklessMultiWriteIntrusiveList<IPinnedTask> {};
+
+#ifdef ENKITS_STATISTICS
+    // counters are written with relaxed atomics as every thread not created
+    // by the scheduler shares thread 0's, padded to keep threads apart
+    struct ThreadStatisticsStore
+    {
+        std::atomic<uint64_t> tasksExecuted;
+        std::atomic<uint64_t> busyNs;
+        std::atomic<uint64_t> sleepNs;
+        std::atomic<uint64_t> wakes;
+        std::atomic<uint64_t> steals;
+        std::atomic<uint64_t> splits;
+        std::atomic<uint64_t> pipeFullFallbacks;
+        char                  padding[ 128 - 7 * sizeof( std::atomic<uint64_t> ) ];
+    };
+#endif
+}
+
+#ifdef ENKITS_STATISTICS
+static uint64_t StatNowNs()
+{
+    return uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count() );
 }
 
+#define ENKITS_STAT_ADD( threadNum_, counter_, value_ ) \
+    m_pStatsPerThread[ threadNum_ ].counter_.fetch_add( value_, std::memory_order_relaxed )
+#define ENKITS_STAT_START( var_ ) const uint64_t var_ = StatNowNs()
+#else
+#define ENKITS_STAT_ADD( threadNum_, counter_, value_ )
+#define ENKITS_STAT_START( var_ )
+#endif
+
 namespace
 {
+    void             ExecuteSubTask( const SubTaskSet& subTask_, uint32_t threadNum_ )
+    {
+        // single element sets (scheduled functions) do not count as a level of nesting
+        const uint32_t nesting = subTask_.pTask->m_SetSize > 1 ? 1 : 0;
+        gtl_nestingDepth += nesting;
+        subTask_.pTask->ExecuteRange( subTask_.partition, threadNum_ );
+        gtl_nestingDepth -= nesting;
+    }
+
     SubTaskSet       SplitTask( SubTaskSet& subTask_, uint32_t rangeToSplit_ )
     {
         SubTaskSet splitTask = subTask_;
@@ -74,6 +135,22 @@ namespace
         return splitTask;
     }
 
+    // xorshift32, sufficient for spreading steal attempts over victims
+    uint32_t StealRandom( uint32_t threadNum_ )
+    {
+        uint32_t x = gtl_stealRngState;
+        if( 0 == x )
+        {
+            x = 2463534242u ^ ( ( threadNum_ + 1 ) * 2654435761u );
+            if( 0 == x ) { x = 1; }
+        }
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        gtl_stealRngState = x;
+        return x;
+    }
+
     #if ( defined _WIN32 && ( defined _M_IX86  || defined _M_X64 ) ) || ( defined __i386__ || defined __x86_64__ )
     static void SpinWait( uint32_t spinCount_ )
     {
@@ -98,6 +175,11 @@ namespace
 }
 
 
+static uint32_t ThreadNumFor( const TaskScheduler* pTS_ )
+{
+    return gtl_pCurrTS == pTS_ ? gtl_threadNum : 0;
+}
+
 static void SafeCallback(ProfilerCallbackFunc func_, uint32_t threadnum_)
 {
     if( func_ )
@@ -117,32 +199,51 @@ THREADFUNC_DECL TaskScheduler::TaskingThreadFunction( void* pArgs )
     uint32_t threadNum                = args.threadNum;
     TaskScheduler*  pTS                = args.pTaskScheduler;
     gtl_threadNum      = threadNum;
+    gtl_pCurrTS        = pTS;
 
+    SafeCallback( pTS->m_ThreadInitFunc, threadNum );
     SafeCallback( pTS->m_ProfilerCallbacks.threadStart, threadNum );
 
-    uint32_t spinCount = SPIN_COUNT + 1;
+    // idle threads spin, then yield, then sleep (unless always hot); a
+    // thread which never ran a task starts out asleep
+    const uint32_t spinEnd  = pTS->m_SpinCount;
+    const uint32_t yieldEnd = spinEnd + pTS->m_YieldCount;
+    uint32_t idleCount = pTS->m_bAlwaysHot ? 0 : yieldEnd + 1;
     uint32_t hintPipeToCheck_io = threadNum + 1;    // does not need to be clamped.
     while( pTS->m_bRunning )
     {
-        if(!pTS->TryRunTask( threadNum, hintPipeToCheck_io ) )
+        if( threadNum >= pTS->m_NumActiveThreads )
         {
-            // no tasks, will spin then wait
-            ++spinCount;
-            if( spinCount > SPIN_COUNT )
+            pTS->Park( threadNum );
+            idleCount = 0;
+        }
+        else if(!pTS->TryRunTask( threadNum, TASK_PRIORITY_NUM - 1, hintPipeToCheck_io ) )
+        {
+            if( idleCount <= yieldEnd ) { ++idleCount; }
+            if( idleCount <= spinEnd )
             {
-                pTS->WaitForTasks( threadNum );
-                spinCount = 0;
+                // Note: see https://software.intel.com/en-us/articles/a-common-construct-to-avoid-the-contention-of-threads-architecture-agnostic-spin-wait-loops
+                uint32_t spinBackoffCount = idleCount * SPIN_BACKOFF_MULTIPLIER;
+                if( spinBackoffCount > MAX_SPIN_BACKOFF ) { spinBackoffCount = MAX_SPIN_BACKOFF; }
+                SpinWait( spinBackoffCount );
+            }
+            else if( idleCount <= yieldEnd || pTS->m_bAlwaysHot )
+            {
+                // counted as idle for WaitforAll(), which would otherwise
+                // wait for an always hot thread to sleep
+                AtomicAdd( &pTS->m_NumThreadsYielding, 1 );
+                std::this_thread::yield();
+                AtomicAdd( &pTS->m_NumThreadsYielding, -1 );
             }
             else
             {
-                // Note: see https://software.intel.com/en-us/articles/a-common-construct-to-avoid-the-contention-of-threads-architecture-agnostic-spin-wait-loops
-                uint32_t spinBackoffCount = spinCount * SPIN_BACKOFF_MULTIPLIER;
-                SpinWait( spinBackoffCount );
+                pTS->WaitForTasks( threadNum );
+                idleCount = 0;
             }
         }
         else
         {
-            spinCount = 0;
+            idleCount = 0;
         }
     }
 
@@ -162,6 +263,7 @@ void TaskScheduler::StartThreads()
     m_bRunning = true;
 
     SemaphoreCreate( m_NewTaskSemaphore );
+    SemaphoreCreate( m_ParkSemaphore );
 
     // we create one less thread than m_NumThreads as the main thread counts as one
     m_pThreadArgStore = new ThreadArgs[m_NumThreads];
@@ -170,6 +272,9 @@ void TaskScheduler::StartThreads()
     m_pThreadArgStore[0].pTaskScheduler = this;
     m_pThreadIDs[0] = 0;
     m_NumThreadsWaiting = 0;
+    m_NumThreadsYielding = 0;
+    m_NumThreadsParked = 0;
+    m_NumActiveThreads = m_NumThreads;
     m_NumThreadsRunning = 1;// acount for main thread
     for( uint32_t thread = 1; thread < m_NumThreads; ++thread )
     {
@@ -189,7 +294,7 @@ void TaskScheduler::StartThreads()
     }
     else
     {
-        m_NumPartitions = m_NumThreads * (m_NumThreads - 1);
+        m_NumPartitions = m_NumThreads * (m_NumThreads - 1) * m_PartitionScale;
         m_NumInitialPartitions = m_NumThreads - 1;
         if( m_NumInitialPartitions > MAX_NUM_INITIAL_PARTITIONS )
         {
@@ -210,6 +315,7 @@ void TaskScheduler::StopThreads( bool bWait_ )
         {
             // keep firing event to ensure all threads pick up state of m_bRunning
             SemaphoreSignal( m_NewTaskSemaphore, m_NumThreadsRunning );
+            SemaphoreSignal( m_ParkSemaphore, m_NumThreadsRunning );
         }
 
         for( uint32_t thread = 1; thread < m_NumThreads; ++thread )
@@ -223,21 +329,80 @@ void TaskScheduler::StopThreads( bool bWait_ )
         m_pThreadArgStore = 0;
         m_pThreadIDs = 0;
         SemaphoreClose( m_NewTaskSemaphore );
+        SemaphoreClose( m_ParkSemaphore );
 
         m_bHaveThreads = false;
         m_NumThreadsWaiting = 0;
+        m_NumThreadsParked = 0;
         m_NumThreadsRunning = 0;
     }
 }
 
-bool TaskScheduler::TryRunTask( uint32_t threadNum, uint32_t& hintPipeToCheck_io_ )
+bool TaskScheduler::TryRunTask( uint32_t threadNum, uint32_t priorityOfLowestToRun_, uint32_t& hintPipeToCheck_io_, const ICompletable* pHelpWith_ )
 {
     // Run any tasks for this thread
     RunPinnedTasks( threadNum );
 
-    // check for tasks
+    // check for tasks, highest priority first
     SubTaskSet subTask;
-    bool bHaveTask = m_pPipesPerThread[ threadNum ].WriterTryReadFront( &subTask );
+    bool bHaveTask = false;
+    for( uint32_t priority = 0; !bHaveTask && priority <= priorityOfLowestToRun_; ++priority )
+    {
+        bHaveTask = TryGetTask( threadNum, priority, hintPipeToCheck_io_, pHelpWith_, &subTask );
+    }
+
+    if( bHaveTask )
+    {
+
+        uint32_t partitionSize = subTask.partition.end - subTask.partition.start;
+        if( subTask.pTask->m_RangeToRun < partitionSize )
+        {
+            SubTaskSet taskToRun = SplitTask( subTask, subTask.pTask->m_RangeToRun );
+            SplitAndAddTask( threadNum, subTask, subTask.pTask->m_RangeToRun );
+            ENKITS_STAT_START( startNs );
+            ExecuteSubTask( taskToRun, threadNum );
+            ENKITS_STAT_ADD( threadNum, busyNs, StatNowNs() - startNs );
+            AtomicAdd( &taskToRun.pTask->m_RunningCount, -1 );
+        }
+        else
+        {
+
+            // the task has already been divided up by AddTaskSetToPipe, so just run it
+            ENKITS_STAT_START( startNs );
+            ExecuteSubTask( subTask, threadNum );
+            ENKITS_STAT_ADD( threadNum, busyNs, StatNowNs() - startNs );
+            AtomicAdd( &subTask.pTask->m_RunningCount, -1 );
+        }
+        ENKITS_STAT_ADD( threadNum, tasksExecuted, 1 );
+    }
+
+    return bHaveTask;
+
+}
+
+bool TaskScheduler::CanHelpWith( const SubTaskSet& subTask_, const ICompletable* pHelpWith_ )
+{
+    // help-first waiting: pieces of the awaited task, or of task sets added at least as deep
+    // as the waiting thread (which finish before the wait could), but no outer level work
+    return !pHelpWith_
+        || subTask_.pTask == pHelpWith_
+        || subTask_.pTask->m_NestingDepth >= gtl_nestingDepth;
+}
+
+bool TaskScheduler::TryGetTask( uint32_t threadNum, uint32_t priority_, uint32_t& hintPipeToCheck_io_, const ICompletable* pHelpWith_, SubTaskSet* pSubTask_ )
+{
+    if( m_bWorkStealing )
+    {
+        return TryGetTaskWorkStealing( threadNum, priority_, pHelpWith_, pSubTask_ );
+    }
+
+    TaskPipe* pPipes = m_pPipesPerThread[ priority_ ];
+    bool bHaveTask = pPipes[ threadNum ].WriterTryReadFront( pSubTask_ );
+    if( bHaveTask && !CanHelpWith( *pSubTask_, pHelpWith_ ) )
+    {
+        // put it back, run it only if that fails
+        bHaveTask = !pPipes[ threadNum ].WriterTryWriteFront( *pSubTask_ );
+    }
 
     uint32_t threadToCheck = hintPipeToCheck_io_;
     uint32_t checkCount = 0;
@@ -246,7 +411,12 @@ bool TaskScheduler::TryRunTask( uint32_t threadNum, uint32_t& hintPipeToCheck_io
         threadToCheck = ( hintPipeToCheck_io_ + checkCount ) % m_NumThreads;
         if( threadToCheck != threadNum )
         {
-            bHaveTask = m_pPipesPerThread[ threadToCheck ].ReaderTryReadBack( &subTask );
+            bHaveTask = pPipes[ threadToCheck ].ReaderTryReadBack( pSubTask_ );
+            if( bHaveTask && !CanHelpWith( *pSubTask_, pHelpWith_ ) )
+            {
+                // move it into this thread's pipe, where threads which are not waiting will find it
+                bHaveTask = !pPipes[ threadNum ].WriterTryWriteFront( *pSubTask_ );
+            }
         }
         ++checkCount;
     }
@@ -255,26 +425,76 @@ bool TaskScheduler::TryRunTask( uint32_t threadNum, uint32_t& hintPipeToCheck_io
     {
         // update hint, will preserve value unless actually got task from another thread.
         hintPipeToCheck_io_ = threadToCheck;
-
-        uint32_t partitionSize = subTask.partition.end - subTask.partition.start;
-        if( subTask.pTask->m_RangeToRun < partitionSize )
+        if( threadToCheck != threadNum )
         {
-            SubTaskSet taskToRun = SplitTask( subTask, subTask.pTask->m_RangeToRun );
-            SplitAndAddTask( threadNum, subTask, subTask.pTask->m_RangeToRun );
-            taskToRun.pTask->ExecuteRange( taskToRun.partition, threadNum );
-            AtomicAdd( &taskToRun.pTask->m_RunningCount, -1 );
+            ENKITS_STAT_ADD( threadNum, steals, 1 );
         }
-        else
+    }
+    return bHaveTask;
+}
+
+bool TaskScheduler::TryGetTaskWorkStealing( uint32_t threadNum, uint32_t priority_, const ICompletable* pHelpWith_, SubTaskSet* pSubTask_ )
+{
+    TaskDeque* pDeques = m_pDequesPerThread[ priority_ ];
+
+    // own work first, newest (cache warm) range at the bottom of the deque
+    if( pDeques[ threadNum ].OwnerTryPop( pSubTask_ ) )
+    {
+        if( CanHelpWith( *pSubTask_, pHelpWith_ ) || !pDeques[ threadNum ].OwnerTryPush( *pSubTask_ ) )
         {
+            return true;
+        }
+    }
+    if( m_NumThreads < 2 )
+    {
+        return false;
+    }
 
-            // the task has already been divided up by AddTaskSetToPipe, so just run it
-            subTask.pTask->ExecuteRange( subTask.partition, threadNum );
-            AtomicAdd( &subTask.pTask->m_RunningCount, -1 );
+    // steal the oldest range from a random victim, falling back to a sweep
+    // of all other threads so that queued work is never missed
+    uint32_t victim = StealRandom( threadNum ) % ( m_NumThreads - 1 );
+    if( victim >= threadNum ) { ++victim; }
+    for( uint32_t checkCount = 1; checkCount < m_NumThreads; ++checkCount )
+    {
+        if( pDeques[ victim ].ThiefTrySteal( pSubTask_ ) )
+        {
+            if( CanHelpWith( *pSubTask_, pHelpWith_ ) || !pDeques[ threadNum ].OwnerTryPush( *pSubTask_ ) )
+            {
+                ENKITS_STAT_ADD( threadNum, steals, 1 );
+                return true;
+            }
         }
+        victim = ( victim + 1 ) % m_NumThreads;
+        if( victim == threadNum ) { victim = ( victim + 1 ) % m_NumThreads; }
     }
+    return false;
+}
 
-    return bHaveTask;
+bool TaskScheduler::TryAddTask( uint32_t threadNum_, const SubTaskSet& subTask_ )
+{
+    const uint32_t priority = subTask_.pTask->m_Priority;
+    if( m_bWorkStealing )
+    {
+        return m_pDequesPerThread[ priority ][ threadNum_ ].OwnerTryPush( subTask_ );
+    }
+    return m_pPipesPerThread[ priority ][ threadNum_ ].WriterTryWriteFront( subTask_ );
+}
 
+bool TaskScheduler::HaveTasksQueued() const
+{
+    for( uint32_t priority = 0; priority < TASK_PRIORITY_NUM; ++priority )
+    {
+        for( uint32_t thread = 0; thread < m_NumThreads; ++thread )
+        {
+            const bool bEmpty = m_bWorkStealing ? m_pDequesPerThread[ priority ][ thread ].IsEmpty()
+                                                : m_pPipesPerThread[ priority ][ thread ].IsPipeEmpty();
+            if( !bEmpty )
+            {
+                return true;
+            }
+        }
+    }
+    return false;
 }
 
 void TaskScheduler::WaitForTasks( uint32_t threadNum )
@@ -286,15 +506,7 @@ void TaskScheduler::WaitForTasks( uint32_t threadNum )
     // but they will then go back to sleep.
     AtomicAdd( &m_NumThreadsWaiting, 1 );
 
-    bool bHaveTasks = false;
-    for( uint32_t thread = 0; thread < m_NumThreads; ++thread )
-    {
-        if( !m_pPipesPerThread[ thread ].IsPipeEmpty() )
-        {
-            bHaveTasks = true;
-            break;
-        }
-    }
+    bool bHaveTasks = HaveTasksQueued();
     if( !bHaveTasks && !m_pPinnedTaskListPerThread[ threadNum ].IsListEmpty() )
     {
         bHaveTasks = true;
@@ -302,13 +514,59 @@ void TaskScheduler::WaitForTasks( uint32_t threadNum )
     if( !bHaveTasks )
     {
         SafeCallback( m_ProfilerCallbacks.waitStart, threadNum );
+        ENKITS_STAT_START( startNs );
         SemaphoreWait( m_NewTaskSemaphore );
+        ENKITS_STAT_ADD( threadNum, sleepNs, StatNowNs() - startNs );
+        ENKITS_STAT_ADD( threadNum, wakes, 1 );
         SafeCallback( m_ProfilerCallbacks.waitStop, threadNum );
     }
 
     AtomicAdd( &m_NumThreadsWaiting, -1 );
 }
 
+void TaskScheduler::Park( uint32_t threadNum )
+{
+    // counted before checking, like in WaitForTasks(), so that raising the
+    // active count or adding a pinned task meanwhile signals this thread
+    AtomicAdd( &m_NumThreadsParked, 1 );
+
+    RunPinnedTasks( threadNum );
+    if( m_bRunning && threadNum >= m_NumActiveThreads
+        && m_pPinnedTaskListPerThread[ threadNum ].IsListEmpty() )
+    {
+        SafeCallback( m_ProfilerCallbacks.waitStart, threadNum );
+        SemaphoreWait( m_ParkSemaphore );
+        SafeCallback( m_ProfilerCallbacks.waitStop, threadNum );
+    }
+
+    AtomicAdd( &m_NumThreadsParked, -1 );
+}
+
+void TaskScheduler::SetNumActiveThreads( uint32_t numActive_ )
+{
+    if( numActive_ < 1 ) { numActive_ = 1; }
+    if( numActive_ > m_NumThreads ) { numActive_ = m_NumThreads; }
+
+    // a full barrier, so that threads parking concurrently either see the
+    // new count or are counted in m_NumThreadsParked below
+    uint32_t prev = m_NumActiveThreads;
+    while( AtomicCompareAndSwap( &m_NumActiveThreads, numActive_, prev ) != prev )
+    {
+        prev = m_NumActiveThreads;
+    }
+
+    // woken threads which stay parked go back to sleep
+    if( numActive_ > prev && m_NumThreadsParked > 0 )
+    {
+        SemaphoreSignal( m_ParkSemaphore, m_NumThreadsParked );
+    }
+}
+
+uint32_t TaskScheduler::GetNumActiveThreads() const
+{
+    return m_NumActiveThreads;
+}
+
 void TaskScheduler::WakeThreads(  int32_t maxToWake_ )
 {
     if( maxToWake_ > 0 && maxToWake_  < m_NumThreadsWaiting )
@@ -327,9 +585,9 @@ void TaskScheduler::SplitAndAddTask( uint32_t threadNum_, SubTaskSet subTask_, u
     {
         SubTaskSet taskToAdd = SplitTask( subTask_, rangeToSplit_ );
 
-        // add the partition to the pipe
+        // add the partition to the pipe (or deque)
         AtomicAdd( &subTask_.pTask->m_RunningCount, 1 );
-        if( !m_pPipesPerThread[ threadNum_ ].WriterTryWriteFront( taskToAdd ) )
+        if( !TryAddTask( threadNum_, taskToAdd ) )
         {
 
             // alter range to run the appropriate fraction
@@ -338,11 +596,16 @@ void TaskScheduler::SplitAndAddTask( uint32_t threadNum_, SubTaskSet subTask_, u
                 taskToAdd.partition.end = taskToAdd.partition.start + taskToAdd.pTask->m_RangeToRun;
                 subTask_.partition.start = taskToAdd.partition.end;
             }
-            taskToAdd.pTask->ExecuteRange( taskToAdd.partition, threadNum_ );
+            ENKITS_STAT_START( startNs );
+            ExecuteSubTask( taskToAdd, threadNum_ );
+            ENKITS_STAT_ADD( threadNum_, busyNs, StatNowNs() - startNs );
+            ENKITS_STAT_ADD( threadNum_, tasksExecuted, 1 );
+            ENKITS_STAT_ADD( threadNum_, pipeFullFallbacks, 1 );
             AtomicAdd( &subTask_.pTask->m_RunningCount, -1 );
         }
         else
         {
+            ENKITS_STAT_ADD( threadNum_, splits, 1 );
             WakeThreads( 1 );
         }
     }
@@ -352,6 +615,7 @@ void TaskScheduler::SplitAndAddTask( uint32_t threadNum_, SubTaskSet subTask_, u
 void    TaskScheduler::AddTaskSetToPipe( ITaskSet* pTaskSet )
 {
     pTaskSet->m_RunningCount = 0;
+    pTaskSet->m_NestingDepth = gtl_nestingDepth;
 
     // divide task up and add to pipe
     pTaskSet->m_RangeToRun = pTaskSet->m_SetSize / m_NumPartitions;
@@ -364,7 +628,7 @@ void    TaskScheduler::AddTaskSetToPipe( ITaskSet* pTaskSet )
     subTask.pTask = pTaskSet;
     subTask.partition.start = 0;
     subTask.partition.end = pTaskSet->m_SetSize;
-    SplitAndAddTask( gtl_threadNum, subTask, rangeToSplit );
+    SplitAndAddTask( ThreadNumFor( this ), subTask, rangeToSplit );
 }
 
 void TaskScheduler::AddPinnedTask( IPinnedTask* pTask_ )
@@ -372,11 +636,15 @@ void TaskScheduler::AddPinnedTask( IPinnedTask* pTask_ )
     pTask_->m_RunningCount = 1;
     m_pPinnedTaskListPerThread[ pTask_->threadNum ].WriterWriteFront( pTask_ );
     WakeThreads();
+    if( pTask_->threadNum >= m_NumActiveThreads && m_NumThreadsParked > 0 )
+    {
+        SemaphoreSignal( m_ParkSemaphore, m_NumThreadsParked );
+    }
 }
 
 void TaskScheduler::RunPinnedTasks()
 {
-    uint32_t threadNum = gtl_threadNum;
+    uint32_t threadNum = ThreadNumFor( this );
     RunPinnedTasks( threadNum );
 }
 
@@ -388,47 +656,58 @@ void TaskScheduler::RunPinnedTasks( uint32_t threadNum )
         pPinnedTaskSet = m_pPinnedTaskListPerThread[ threadNum ].ReaderReadBack();
         if( pPinnedTaskSet )
         {
+            ENKITS_STAT_START( startNs );
             pPinnedTaskSet->Execute();
+            ENKITS_STAT_ADD( threadNum, busyNs, StatNowNs() - startNs );
+            ENKITS_STAT_ADD( threadNum, tasksExecuted, 1 );
             pPinnedTaskSet->m_RunningCount = 0;
+            pPinnedTaskSet->OnCompleted();
         }
     } while( pPinnedTaskSet );
 }
 
 void    TaskScheduler::WaitforTask( const ICompletable* pCompletable_ )
 {
-    uint32_t hintPipeToCheck_io = gtl_threadNum + 1;    // does not need to be clamped.
+    uint32_t threadNum = ThreadNumFor( this );
+    uint32_t hintPipeToCheck_io = threadNum + 1;    // does not need to be clamped.
     if( pCompletable_ )
     {
+        // lower priority tasks could hold this thread up for long, leave
+        // them to otherwise idle threads
+        const uint32_t priorityOfLowestToRun = pCompletable_->m_Priority;
+        // nested waits help first, see GetNestingDepth()
+        const ICompletable* pHelpWith = gtl_nestingDepth > 0 ? pCompletable_ : NULL;
         while( pCompletable_->m_RunningCount )
         {
-            TryRunTask( gtl_threadNum, hintPipeToCheck_io );
+            TryRunTask( threadNum, priorityOfLowestToRun, hintPipeToCheck_io, pHelpWith );
             // should add a spin then wait for task completion event.
         }
     }
     else
     {
-            TryRunTask( gtl_threadNum, hintPipeToCheck_io );
+            TryRunTask( threadNum, TASK_PRIORITY_NUM - 1, hintPipeToCheck_io );
     }
 }
 
+bool    TaskScheduler::TryRunTask()
+{
+    uint32_t threadNum = ThreadNumFor( this );
+    uint32_t hintPipeToCheck_io = threadNum + 1;    // does not need to be clamped.
+    return TryRunTask( threadNum, TASK_PRIORITY_NUM - 1, hintPipeToCheck_io );
+}
+
 void    TaskScheduler::WaitforAll()
 {
     bool bHaveTasks = true;
-     uint32_t hintPipeToCheck_io = gtl_threadNum  + 1;    // does not need to be clamped.
+    uint32_t threadNum = ThreadNumFor( this );
+     uint32_t hintPipeToCheck_io = threadNum  + 1;    // does not need to be clamped.
     int32_t threadsRunning = m_NumThreadsRunning - 1;
-    while( bHaveTasks || m_NumThreadsWaiting < threadsRunning )
+    while( bHaveTasks || m_NumThreadsWaiting + m_NumThreadsYielding + m_NumThreadsParked < threadsRunning )
     {
-        bHaveTasks = TryRunTask( gtl_threadNum, hintPipeToCheck_io );
+        bHaveTasks = TryRunTask( threadNum, TASK_PRIORITY_NUM - 1, hintPipeToCheck_io );
         if( !bHaveTasks )
         {
-            for( uint32_t thread = 0; thread < m_NumThreads; ++thread )
-            {
-                if( !m_pPipesPerThread[ thread ].IsPipeEmpty() )
-                {
-                    bHaveTasks = true;
-                    break;
-                }
-            }
+            bHaveTasks = HaveTasksQueued();
         }
      }
 }
@@ -437,11 +716,30 @@ void    TaskScheduler::WaitforAllAndShutdown()
 {
     WaitforAll();
     StopThreads(true);
-    delete[] m_pPipesPerThread;
-    m_pPipesPerThread = 0;
+    for( uint32_t priority = 0; priority < TASK_PRIORITY_NUM; ++priority )
+    {
+        delete[] m_pPipesPerThread[ priority ];
+        m_pPipesPerThread[ priority ] = 0;
+        delete[] m_pDequesPerThread[ priority ];
+        m_pDequesPerThread[ priority ] = 0;
+    }
 
     delete[] m_pPinnedTaskListPerThread;
     m_pPinnedTaskListPerThread = 0;
+#ifdef ENKITS_STATISTICS
+    delete[] m_pStatsPerThread;
+#endif
+    m_pStatsPerThread = 0;
+}
+
+TaskScheduler*  TaskScheduler::GetTaskSchedulerForThisThread()
+{
+    return gtl_pCurrTS;
+}
+
+uint32_t        TaskScheduler::GetNestingDepth()
+{
+    return gtl_nestingDepth;
 }
 
 uint32_t        TaskScheduler::GetNumTaskThreads() const
@@ -449,8 +747,53 @@ uint32_t        TaskScheduler::GetNumTaskThreads() const
     return m_NumThreads;
 }
 
+bool            TaskScheduler::GetThreadStatistics( uint32_t threadNum_, ThreadStatistics* pStats_ ) const
+{
+#ifdef ENKITS_STATISTICS
+    if( !m_pStatsPerThread || threadNum_ >= m_NumThreads )
+    {
+        return false;
+    }
+    const ThreadStatisticsStore& store = m_pStatsPerThread[ threadNum_ ];
+    pStats_->tasksExecuted     = store.tasksExecuted.load( std::memory_order_relaxed );
+    pStats_->busyNs            = store.busyNs.load( std::memory_order_relaxed );
+    pStats_->sleepNs           = store.sleepNs.load( std::memory_order_relaxed );
+    pStats_->wakes             = store.wakes.load( std::memory_order_relaxed );
+    pStats_->steals            = store.steals.load( std::memory_order_relaxed );
+    pStats_->splits            = store.splits.load( std::memory_order_relaxed );
+    pStats_->pipeFullFallbacks = store.pipeFullFallbacks.load( std::memory_order_relaxed );
+    return true;
+#else
+    (void)threadNum_;
+    (void)pStats_;
+    return false;
+#endif
+}
+
+void            TaskScheduler::ResetStatistics()
+{
+#ifdef ENKITS_STATISTICS
+    for( uint32_t thread = 0; m_pStatsPerThread && thread < m_NumThreads; ++thread )
+    {
+        ThreadStatisticsStore& store = m_pStatsPerThread[ thread ];
+        store.tasksExecuted     = 0;
+        store.busyNs            = 0;
+        store.sleepNs           = 0;
+        store.wakes             = 0;
+        store.steals            = 0;
+        store.splits            = 0;
+        store.pipeFullFallbacks = 0;
+    }
+#endif
+}
+
 TaskScheduler::TaskScheduler()
-        : m_pPipesPerThread(NULL)
+        : m_bWorkStealing(false)
+        , m_ThreadInitFunc(NULL)
+        , m_SpinCount(0)
+        , m_YieldCount(0)
+        , m_bAlwaysHot(false)
+        , m_PartitionScale(1)
         , m_pPinnedTaskListPerThread(NULL)
         , m_NumThreads(0)
         , m_pThreadArgStore(NULL)
@@ -458,10 +801,19 @@ TaskScheduler::TaskScheduler()
         , m_bRunning(false)
         , m_NumThreadsRunning(0)
         , m_NumThreadsWaiting(0)
+        , m_NumThreadsYielding(0)
+        , m_NumThreadsParked(0)
+        , m_NumActiveThreads(0)
         , m_NumPartitions(0)
         , m_bHaveThreads(false)
+        , m_pStatsPerThread(NULL)
 {
     memset(&m_ProfilerCallbacks, 0, sizeof(m_ProfilerCallbacks));
+    for( uint32_t priority = 0; priority < TASK_PRIORITY_NUM; ++priority )
+    {
+        m_pPipesPerThread[ priority ]  = NULL;
+        m_pDequesPerThread[ priority ] = NULL;
+    }
 }
 
 TaskScheduler::~TaskScheduler()
@@ -471,21 +823,59 @@ TaskScheduler::~TaskScheduler()
 #endif
 }
 
-void    TaskScheduler::Initialize( uint32_t numThreads_ )
+void    TaskScheduler::Initialize( const TaskSchedulerConfig& config_ )
 {
-    assert( numThreads_ );
+    assert( config_.numThreads );
     StopThreads( true ); // Stops threads, waiting for them.
-    delete[] m_pPipesPerThread;
+    for( uint32_t priority = 0; priority < TASK_PRIORITY_NUM; ++priority )
+    {
+        delete[] m_pPipesPerThread[ priority ];
+        delete[] m_pDequesPerThread[ priority ];
+        m_pPipesPerThread[ priority ]  = 0;
+        m_pDequesPerThread[ priority ] = 0;
+    }
     delete[] m_pPinnedTaskListPerThread;
-
-    m_NumThreads = numThreads_;
-
-    m_pPipesPerThread          = new TaskPipe[ m_NumThreads ];
+#ifdef ENKITS_STATISTICS
+    delete[] m_pStatsPerThread;
+#endif
+    m_pStatsPerThread = 0;
+
+    m_NumThreads    = config_.numThreads;
+    m_bWorkStealing = config_.workStealing;
+    m_ThreadInitFunc = config_.threadInit;
+    m_SpinCount      = config_.spinCount;
+    m_YieldCount     = config_.yieldCount;
+    m_bAlwaysHot     = config_.alwaysHot;
+    m_PartitionScale = config_.partitionScale ? config_.partitionScale : 1;
+
+    // only the queues for the selected mode are allocated
+    for( uint32_t priority = 0; priority < TASK_PRIORITY_NUM; ++priority )
+    {
+        if( m_bWorkStealing )
+        {
+            m_pDequesPerThread[ priority ] = new TaskDeque[ m_NumThreads ];
+        }
+        else
+        {
+            m_pPipesPerThread[ priority ]  = new TaskPipe[ m_NumThreads ];
+        }
+    }
     m_pPinnedTaskListPerThread = new PinnedTaskList[ m_NumThreads ];
+#ifdef ENKITS_STATISTICS
+    m_pStatsPerThread          = new ThreadStatisticsStore[ m_NumThreads ];
+    ResetStatistics();
+#endif
 
     StartThreads();
 }
 
+void    TaskScheduler::Initialize( uint32_t numThreads_ )
+{
+    TaskSchedulerConfig config;
+    config.numThreads = numThreads_;
+    Initialize( config );
+}
+
 void   TaskScheduler::Initialize()
 {
     Initialize( GetNumHardwareThreads() );
@@ -46,21 +46,38 @@ namespace enki
 
     class  TaskScheduler;
     class  TaskPipe;
+    class  TaskDeque;
     class  PinnedTaskList;
     struct ThreadArgs;
     struct SubTaskSet;
+    struct ThreadStatisticsStore;
+
+    // Tasks are queued in one pipe (or deque) per priority, idle threads take
+    // higher priority work first, so low priority tasks only run on threads
+    // which have nothing else to do.
+    enum TaskPriority
+    {
+        TASK_PRIORITY_HIGH,
+        TASK_PRIORITY_MED,
+        TASK_PRIORITY_LOW,
+        TASK_PRIORITY_NUM
+    };
 
     // ICompletable is a base class used to check for completion.
     // Do not use this class directly, instead derive from ITaskSet or IPinnedTask.
     class ICompletable
     {
     public:
-        ICompletable() :        m_RunningCount(0) {}
+        ICompletable() :        m_Priority(TASK_PRIORITY_MED), m_RunningCount(0) {}
         virtual ~ICompletable() = default;
         bool                    GetIsComplete() {
             bool bRet = ( 0 == m_RunningCount );
             BASE_MEMORYBARRIER_ACQUIRE();
             return bRet; }
+
+        // Set before adding the task, waiting for it only runs tasks of the
+        // same or higher priority.
+        TaskPriority            m_Priority;
     private:
         friend class            TaskScheduler;
         volatile int32_t        m_RunningCount;
@@ -75,18 +92,21 @@ namespace enki
             : m_SetSize(1)
             , m_MinRange(1)
             , m_RangeToRun(1)
+            , m_NestingDepth(0)
         {}
 
         ITaskSet( uint32_t setSize_ )
             : m_SetSize( setSize_ )
             , m_MinRange(1)
             , m_RangeToRun(1)
+            , m_NestingDepth(0)
         {}
 
         ITaskSet( uint32_t setSize_, uint32_t minRange_ )
             : m_SetSize( setSize_ )
             , m_MinRange( minRange_ )
             , m_RangeToRun(minRange_)
+            , m_NestingDepth(0)
         {}
 
         virtual ~ITaskSet() override = default;
@@ -113,6 +133,7 @@ namespace enki
     private:
         friend class            TaskScheduler;
         uint32_t                m_RangeToRun;
+        uint32_t                m_NestingDepth;     // GetNestingDepth() of the thread which added the set
     };
 
     // Subclass IPinnedTask to create tasks which cab be run on a given thread only.
@@ -129,6 +150,9 @@ namespace enki
         // Should never be called as should be overridden.
         virtual void            Execute() { assert(false); }
 
+        // Called after the task has been marked complete, nothing touches the
+        // task afterwards, so fire-and-forget tasks may delete themselves here.
+        virtual void            OnCompleted() {}
 
         uint32_t                 threadNum; // thread to run this pinned task on
         IPinnedTask* volatile pNext;        // Do not use. For intrusive list only.
@@ -144,6 +168,60 @@ namespace enki
         ProfilerCallbackFunc waitStop;
     };
 
+    // TaskSchedulerConfig - options passed to Initialize( config_ )
+    struct TaskSchedulerConfig
+    {
+        // numThreads (must be > 0), see Initialize( numThreads_ )
+        uint32_t numThreads;
+
+        // workStealing - if true, each thread keeps its work in a Chase-Lev
+        // deque which it runs LIFO, and idle threads steal the oldest
+        // (largest) ranges from randomly chosen victims. This balances
+        // highly irregular task costs better than the default pipes.
+        bool     workStealing;
+
+        // threadInit - if set, called on each task thread other than thread 0
+        // when it starts, before it runs any tasks, e.g. to set CPU affinity.
+        ProfilerCallbackFunc threadInit;
+
+        // spinCount, yieldCount - an idle task thread spins (with backoff)
+        // spinCount times, then yields yieldCount times before it sleeps on
+        // the new task semaphore, where waking it costs several microseconds.
+        // alwaysHot - never sleep, keep yielding after spinning instead.
+        uint32_t spinCount;
+        uint32_t yieldCount;
+        bool     alwaysHot;
+
+        // partitionScale - task sets are cut into partitionScale times more
+        // ranges than threads would need on equally fast cores, so that on
+        // hybrid CPUs the fast cores take more ranges while the last ones
+        // still running on slow cores are short.
+        uint32_t partitionScale;
+
+        TaskSchedulerConfig()
+            : numThreads( 0 ), workStealing( false ), threadInit( 0 )
+            , spinCount( 100 ), yieldCount( 0 ), alwaysHot( false )
+            , partitionScale( 1 ) {}
+    };
+
+    // ThreadStatistics - per thread counters, only collected when enkiTS is
+    // built with ENKITS_STATISTICS defined. Thread 0 accumulates the work of
+    // all threads not created by the scheduler.
+    struct ThreadStatistics
+    {
+        uint64_t tasksExecuted;     // partitions (and pinned tasks) run
+        uint64_t busyNs;            // time spent running them
+        uint64_t sleepNs;           // time spent waiting for new tasks
+        uint64_t wakes;             // number of times woken from that wait
+        uint64_t steals;            // partitions taken from another thread
+        uint64_t splits;            // partitions queued by SplitAndAddTask
+        uint64_t pipeFullFallbacks; // partitions run inline as the queue was full
+
+        ThreadStatistics()
+            : tasksExecuted( 0 ), busyNs( 0 ), sleepNs( 0 ), wakes( 0 )
+            , steals( 0 ), splits( 0 ), pipeFullFallbacks( 0 ) {}
+    };
+
     class TaskScheduler
     {
     public:
@@ -163,6 +241,10 @@ namespace enki
         // the thread on which the initialize was called.
         ENKITS_API void            Initialize( uint32_t numThreads_ );
 
+        // Initialize( config_ ) - as Initialize( config_.numThreads ), using
+        // any further options set in config_.
+        ENKITS_API void            Initialize( const TaskSchedulerConfig& config_ );
+
 
         // Adds the TaskSet to pipe and returns if the pipe is not full.
         // If the pipe is full, pTaskSet is run.
@@ -181,6 +263,11 @@ namespace enki
         // if called with 0 it will try to run tasks, and return if none available.
         ENKITS_API void            WaitforTask( const ICompletable* pCompletable_ );
 
+        // Runs one task if there is one, returning whether it did. For threads
+        // waiting on other events, which help with tasks until there are none
+        // left and then block.
+        ENKITS_API bool            TryRunTask();
+
         // WaitforTaskSet, deprecated interface use WaitforTask
         inline void     WaitforTaskSet( const ICompletable* pCompletable_ ) { WaitforTask( pCompletable_ ); }
 
@@ -196,21 +283,62 @@ namespace enki
         // to account for the main thread.
         ENKITS_API uint32_t        GetNumTaskThreads() const;
 
+        // Parks task threads numActive_ and up once they finish their current
+        // task, until a later call raises the count again. Tasks they queued
+        // are run by the other threads, and pinned tasks by the parked thread
+        // itself. numActive_ is clamped to [ 1, GetNumTaskThreads() ].
+        ENKITS_API void            SetNumActiveThreads( uint32_t numActive_ );
+
+        // Returns the number of threads not parked, including the main thread.
+        ENKITS_API uint32_t        GetNumActiveThreads() const;
+
+        // Returns the scheduler which created the calling thread, or NULL if
+        // it was not created by a TaskScheduler (e.g. the main thread).
+        ENKITS_API static TaskScheduler* GetTaskSchedulerForThisThread();
+
+        // Returns how many task sets of more than one element are currently
+        // running on the calling thread, i.e. 0 outside of any task set, 1 in
+        // the body of a top level parallel loop, 2 in a loop nested in that...
+        // While waiting for a task at depth >= 1 a thread only helps with the
+        // awaited task and task sets added at the same or a deeper level, so
+        // outer level work never stacks up on top of the wait.
+        ENKITS_API static uint32_t GetNestingDepth();
+
         // Returns the ProfilerCallbacks structure so that it can be modified to
         // set the callbacks.
         ENKITS_API ProfilerCallbacks* GetProfilerCallbacks();
 
+        // Copies the counters of thread threadNum_ ( < GetNumTaskThreads() ) to
+        // pStats_, returns false if statistics are not compiled in.
+        ENKITS_API bool            GetThreadStatistics( uint32_t threadNum_, ThreadStatistics* pStats_ ) const;
+
+        // Sets the counters of all threads back to zero.
+        ENKITS_API void            ResetStatistics();
+
     private:
         static THREADFUNC_DECL  TaskingThreadFunction( void* pArgs );
         void             WaitForTasks( uint32_t threadNum );
+        void             Park( uint32_t threadNum );
         void             RunPinnedTasks( uint32_t threadNum );
-        bool             TryRunTask( uint32_t threadNum, uint32_t& hintPipeToCheck_io_ );
+        bool             TryRunTask( uint32_t threadNum, uint32_t priorityOfLowestToRun_, uint32_t& hintPipeToCheck_io_, const ICompletable* pHelpWith_ = NULL );
+        bool             TryGetTask( uint32_t threadNum, uint32_t priority_, uint32_t& hintPipeToCheck_io_, const ICompletable* pHelpWith_, SubTaskSet* pSubTask_ );
+        bool             TryGetTaskWorkStealing( uint32_t threadNum, uint32_t priority_, const ICompletable* pHelpWith_, SubTaskSet* pSubTask_ );
+        bool             TryAddTask( uint32_t threadNum_, const SubTaskSet& subTask_ );
+        static bool      CanHelpWith( const SubTaskSet& subTask_, const ICompletable* pHelpWith_ );
+        bool             HaveTasksQueued() const;
         void             StartThreads();
         void             StopThreads( bool bWait_ );
         void             SplitAndAddTask( uint32_t threadNum_, SubTaskSet subTask_, uint32_t rangeToSplit_ );
         void             WakeThreads( int32_t maxToWake_ = 0 );
 
-        TaskPipe*                                                m_pPipesPerThread;
+        TaskPipe*                                                m_pPipesPerThread[ TASK_PRIORITY_NUM ];
+        TaskDeque*                                               m_pDequesPerThread[ TASK_PRIORITY_NUM ];
+        bool                                                     m_bWorkStealing;
+        ProfilerCallbackFunc                                     m_ThreadInitFunc;
+        uint32_t                                                 m_SpinCount;
+        uint32_t                                                 m_YieldCount;
+        bool                                                     m_bAlwaysHot;
+        uint32_t                                                 m_PartitionScale;
         PinnedTaskList*                                          m_pPinnedTaskListPerThread;
 
         uint32_t                                                 m_NumThreads;
@@ -219,11 +347,16 @@ namespace enki
         volatile bool                                            m_bRunning;
         volatile int32_t                                         m_NumThreadsRunning;
         volatile int32_t                                         m_NumThreadsWaiting;
+        volatile int32_t                                         m_NumThreadsYielding; // idle always hot threads
+        volatile int32_t                                         m_NumThreadsParked;
+        volatile uint32_t                                        m_NumActiveThreads;
         uint32_t                                                 m_NumPartitions;
         uint32_t                                                 m_NumInitialPartitions;
         semaphoreid_t                                            m_NewTaskSemaphore;
+        semaphoreid_t                                            m_ParkSemaphore;
         bool                                                     m_bHaveThreads;
         ProfilerCallbacks                                         m_ProfilerCallbacks;
+        ThreadStatisticsStore*                                   m_pStatsPerThread;
 
         TaskScheduler( const TaskScheduler& nocopy );
         TaskScheduler& operator=( const TaskScheduler& nocopy );
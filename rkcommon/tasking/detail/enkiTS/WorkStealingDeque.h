@@ -0,0 +1,128 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+namespace enki
+{
+    // WorkStealingDeque - fixed capacity Chase-Lev work-stealing deque,
+    // using the C11 memory model formulation from Le, Pop, Cohen and
+    // Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory
+    // Models" (PPoPP 2013).
+    // The owning thread pushes and pops at the bottom (LIFO, cache warm),
+    // any other thread may steal from the top (FIFO, oldest and usually
+    // largest work items first).
+    // As with LockLessMultiReadPipe the capacity is fixed at 2^cSizeLog2, and
+    // OwnerTryPush() returns false when the deque is full so that the caller
+    // can run the item directly instead.
+    // T is the contained type, and must be trivially copyable.
+    template<uint8_t cSizeLog2, typename T> class WorkStealingDeque
+    {
+    public:
+        WorkStealingDeque() : m_Top(0), m_Bottom(0) {}
+
+        // OwnerTryPush returns false if the deque is full
+        // Only thread safe for the owning thread
+        bool OwnerTryPush( const T& in );
+
+        // OwnerTryPop returns false if the deque is empty, or the last item
+        // was concurrently stolen. Only thread safe for the owning thread
+        bool OwnerTryPop( T* pOut );
+
+        // ThiefTrySteal returns false if the deque was empty or another thread
+        // won the race for the top item. Thread safe for any thread
+        bool ThiefTrySteal( T* pOut );
+
+        // IsEmpty() is a utility function, not intended for general use
+        bool IsEmpty() const
+        {
+            return m_Bottom.load( std::memory_order_relaxed ) <=
+                   m_Top.load( std::memory_order_relaxed );
+        }
+
+    private:
+        const static int64_t            ms_cSize        = ( 1 << cSizeLog2 );
+        const static int64_t            ms_cIndexMask   = ms_cSize - 1;
+
+        // top and bottom are padded onto separate cache lines, as top is
+        // written by thieves and bottom only by the owner. Padding is used
+        // rather than alignas so that arrays of deques can be created with
+        // new[] prior to C++17.
+        std::atomic<int64_t>            m_Top;
+        char                            m_PadTop[ 64 - sizeof( int64_t ) ];
+        std::atomic<int64_t>            m_Bottom;
+        char                            m_PadBottom[ 64 - sizeof( int64_t ) ];
+        T                               m_Buffer[ ms_cSize ];
+    };
+
+    template<uint8_t cSizeLog2, typename T> inline
+        bool WorkStealingDeque<cSizeLog2,T>::OwnerTryPush( const T& in )
+    {
+        const int64_t bottom = m_Bottom.load( std::memory_order_relaxed );
+        const int64_t top    = m_Top.load( std::memory_order_acquire );
+        if( bottom - top >= ms_cSize )
+        {
+            return false;
+        }
+
+        m_Buffer[ bottom & ms_cIndexMask ] = in;
+        std::atomic_thread_fence( std::memory_order_release );
+        m_Bottom.store( bottom + 1, std::memory_order_relaxed );
+        return true;
+    }
+
+    template<uint8_t cSizeLog2, typename T> inline
+        bool WorkStealingDeque<cSizeLog2,T>::OwnerTryPop( T* pOut )
+    {
+        const int64_t bottom = m_Bottom.load( std::memory_order_relaxed ) - 1;
+        m_Bottom.store( bottom, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        int64_t top = m_Top.load( std::memory_order_relaxed );
+
+        if( top > bottom )
+        {
+            // empty
+            m_Bottom.store( bottom + 1, std::memory_order_relaxed );
+            return false;
+        }
+
+        *pOut = m_Buffer[ bottom & ms_cIndexMask ];
+        if( top == bottom )
+        {
+            // last item, race against thieves for it
+            const bool bWon = m_Top.compare_exchange_strong( top, top + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed );
+            m_Bottom.store( bottom + 1, std::memory_order_relaxed );
+            return bWon;
+        }
+        return true;
+    }
+
+    template<uint8_t cSizeLog2, typename T> inline
+        bool WorkStealingDeque<cSizeLog2,T>::ThiefTrySteal( T* pOut )
+    {
+        int64_t top = m_Top.load( std::memory_order_acquire );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        const int64_t bottom = m_Bottom.load( std::memory_order_acquire );
+
+        if( top >= bottom )
+        {
+            return false;
+        }
+
+        // the item may be overwritten by the owner once top moves on, which
+        // the CAS below detects - so only hand it out if we won
+        T item = m_Buffer[ top & ms_cIndexMask ];
+        if( !m_Top.compare_exchange_strong( top, top + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed ) )
+        {
+            return false;
+        }
+
+        *pOut = item;
+        return true;
+    }
+}
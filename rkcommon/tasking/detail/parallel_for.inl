@@ -3,14 +3,29 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <utility>
 
+#include "../AffinityHint.h"
+#include "../CancellationToken.h"
+#include "../TuningSlot.h"
+#include "../../utility/OnScopeExit.h"
+#include "task_tracing.h"
+
 #ifdef RKCOMMON_TASKING_TBB
 #  define __TBB_NO_IMPLICIT_LINKAGE 1
 #  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#  include <tbb/blocked_range.h>
 #  include <tbb/parallel_for.h>
+#  include <tbb/task_group.h>
+#  include "tbb_context.h"
 #elif defined(RKCOMMON_TASKING_INTERNAL)
 #  include "TaskSys.h"
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+#  include "dynamic_backend.h"
 #endif
 
 namespace rkcommon {
@@ -18,10 +33,70 @@ namespace rkcommon {
     namespace detail {
 
       template<typename INDEX_T, typename TASK_T>
-      inline void parallel_for_impl(INDEX_T nTasks, TASK_T&& fcn)
+      inline void parallel_for_range_backend(INDEX_T begin,
+                                             INDEX_T end,
+                                             INDEX_T grainSize,
+                                             TASK_T&& fcn)
       {
 #ifdef RKCOMMON_TASKING_TBB
-        tbb::parallel_for(INDEX_T(0), nTasks, std::forward<TASK_T>(fcn));
+        tbb::task_group_context context;
+        initTbbContext(context);
+        tbb::parallel_for(tbb::blocked_range<INDEX_T>(begin, end, grainSize),
+                          [&](const tbb::blocked_range<INDEX_T> &r) {
+                            fcn(r.begin(), r.end());
+                          },
+                          context);
+#elif defined(RKCOMMON_TASKING_OMP)
+        const INDEX_T numChunks = (end - begin + grainSize - 1) / grainSize;
+#       pragma omp parallel for schedule(dynamic)
+        for (INDEX_T chunk = 0; chunk < numChunks; ++chunk) {
+          const INDEX_T chunkBegin = begin + chunk * grainSize;
+          const INDEX_T chunkEnd   = std::min(chunkBegin + grainSize, end);
+          fcn(chunkBegin, chunkEnd);
+        }
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+        detail::parallel_for_range_internal(
+            begin, end, grainSize, std::forward<TASK_T>(fcn));
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+        detail::dynamic_parallel_for_range(begin, end, grainSize, fcn);
+#else // Debug (no tasking system)
+        fcn(begin, end);
+#endif
+      }
+
+      template<typename INDEX_T, typename TASK_T>
+      inline void parallel_for_range_impl(INDEX_T begin,
+                                          INDEX_T end,
+                                          INDEX_T grainSize,
+                                          TASK_T&& fcn)
+      {
+#ifdef RKCOMMON_ENABLE_PROFILING
+        TaskSpawn spawn("parallel_for");
+        parallel_for_range_backend(
+            begin, end, grainSize, [&](INDEX_T chunkBegin, INDEX_T chunkEnd) {
+              TracedTask task(spawn);
+              fcn(chunkBegin, chunkEnd);
+            });
+#else
+        parallel_for_range_backend(
+            begin, end, grainSize, std::forward<TASK_T>(fcn));
+#endif
+      }
+
+      template<typename INDEX_T, typename TASK_T>
+      inline void parallel_for_impl(INDEX_T nTasks, TASK_T&& fcn)
+      {
+#ifdef RKCOMMON_ENABLE_PROFILING
+        // the same partitioning, traced per chunk rather than per index
+        parallel_for_range_impl(
+            INDEX_T(0), nTasks, INDEX_T(1), [&](INDEX_T begin, INDEX_T end) {
+              for (INDEX_T taskIndex = begin; taskIndex < end; ++taskIndex)
+                fcn(taskIndex);
+            });
+#elif defined(RKCOMMON_TASKING_TBB)
+        tbb::task_group_context context;
+        initTbbContext(context);
+        tbb::parallel_for(INDEX_T(0), nTasks, fcn, context);
 #elif defined(RKCOMMON_TASKING_OMP)
 #       pragma omp parallel for schedule(dynamic)
         for (INDEX_T taskIndex = 0; taskIndex < nTasks; ++taskIndex) {
@@ -29,6 +104,12 @@ namespace rkcommon {
         }
 #elif defined(RKCOMMON_TASKING_INTERNAL)
         detail::parallel_for_internal(nTasks, std::forward<TASK_T>(fcn));
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+        detail::dynamic_parallel_for_range(
+            INDEX_T(0), nTasks, INDEX_T(1), [&](INDEX_T begin, INDEX_T end) {
+              for (INDEX_T taskIndex = begin; taskIndex < end; ++taskIndex)
+                fcn(taskIndex);
+            });
 #else // Debug (no tasking system)
         for (INDEX_T taskIndex = 0; taskIndex < nTasks; ++taskIndex) {
           fcn(taskIndex);
@@ -36,6 +117,133 @@ namespace rkcommon {
 #endif
       }
 
+      // Calls fcn(begin, end) on ranges of [0, numUnits), placed on threads
+      // as recorded by 'hint'
+      template<typename INDEX_T, typename TASK_T>
+      inline void parallel_for_affinity_impl(INDEX_T numUnits,
+                                             AffinityHint &hint,
+                                             TASK_T&& fcn)
+      {
+        if (!(INDEX_T(0) < numUnits))
+          return;
+#ifdef RKCOMMON_ENABLE_PROFILING
+        TaskSpawn spawn("parallel_for");
+        auto chunk = [&](INDEX_T begin, INDEX_T end) {
+          TracedTask task(spawn);
+          fcn(begin, end);
+        };
+#else
+        auto &chunk = fcn;
+#endif
+
+#ifdef RKCOMMON_TASKING_TBB
+        tbb::task_group_context context;
+        initTbbContext(context);
+        tbb::parallel_for(tbb::blocked_range<INDEX_T>(INDEX_T(0), numUnits),
+                          [&](const tbb::blocked_range<INDEX_T> &r) {
+                            chunk(r.begin(), r.end());
+                          },
+                          hint.tbbPartitioner(),
+                          context);
+#elif defined(RKCOMMON_TASKING_OMP)
+        // a static schedule hands the same units to the same threads
+        (void)hint;
+#       pragma omp parallel for schedule(static)
+        for (INDEX_T i = 0; i < numUnits; ++i)
+          chunk(i, INDEX_T(i + 1));
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+        detail::parallel_for_affinity_internal(
+            numUnits, hint.internalRecord(), chunk);
+#else
+        (void)hint;
+        parallel_for_range_backend(INDEX_T(0), numUnits, INDEX_T(1), chunk);
+#endif
+      }
+
+      // Calls fcn(begin, end) on chunks of [begin, end) sized by 'slot',
+      // adding their time to its estimate
+      template<typename INDEX_T, typename TASK_T>
+      inline void parallel_for_tuned_impl(INDEX_T begin,
+                                          INDEX_T end,
+                                          TuningSlot &slot,
+                                          TASK_T&& fcn)
+      {
+#ifdef RKCOMMON_TASKING_TBB
+        // TBB's auto_partitioner adapts the chunks by itself
+        (void)slot;
+        parallel_for_range_impl(begin, end, INDEX_T(1), fcn);
+#else
+        using clock = std::chrono::steady_clock;
+
+        const uint64_t numIndices = uint64_t(end - begin);
+        const INDEX_T grainSize   = INDEX_T(slot.grainSize(numIndices));
+
+        std::atomic<uint64_t> busyNanoseconds{0};
+        parallel_for_range_impl(
+            begin, end, grainSize, [&](INDEX_T chunkBegin, INDEX_T chunkEnd) {
+              const clock::time_point start = clock::now();
+              fcn(chunkBegin, chunkEnd);
+              busyNanoseconds += uint64_t(
+                  std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      clock::now() - start)
+                      .count());
+            });
+
+        slot.record(numIndices, busyNanoseconds);
+#endif
+      }
+
+      // Chunks of indices between which a token is checked: enough for good
+      // load balancing, few enough to keep the checks out of inner loops
+      template <typename INDEX_T>
+      inline INDEX_T cancellation_grain_size(INDEX_T nTasks)
+      {
+        return std::max(INDEX_T(1), INDEX_T(nTasks / 256));
+      }
+
+      template<typename INDEX_T, typename TASK_T>
+      inline void parallel_for_impl(INDEX_T nTasks,
+                                    TASK_T&& fcn,
+                                    const CancellationToken &token)
+      {
+        if (token.isCancelled())
+          return;
+
+        // backends may hand out larger ranges than the grain size (e.g.
+        // enkiTS with few threads), so sub-ranges of 'grainSize' are checked
+        const INDEX_T grainSize = cancellation_grain_size(nTasks);
+        auto chunk = [&](INDEX_T begin, INDEX_T end) {
+          while (begin < end && !token.isCancelled()) {
+            const INDEX_T chunkEnd =
+                end - begin > grainSize ? INDEX_T(begin + grainSize) : end;
+            for (INDEX_T i = begin; i < chunkEnd; ++i)
+              fcn(i);
+            begin = chunkEnd;
+          }
+        };
+
+#ifdef RKCOMMON_TASKING_TBB
+#ifdef RKCOMMON_ENABLE_PROFILING
+        TaskSpawn spawn("parallel_for");
+#endif
+        tbb::task_group_context context;
+        initTbbContext(context);
+        token.attach(&context);
+        utility::OnScopeExit detach([&]() { token.detach(&context); });
+        tbb::parallel_for(
+            tbb::blocked_range<INDEX_T>(INDEX_T(0), nTasks, grainSize),
+            [&](const tbb::blocked_range<INDEX_T> &r) {
+#ifdef RKCOMMON_ENABLE_PROFILING
+              TracedTask task(spawn);
+#endif
+              chunk(r.begin(), r.end());
+            },
+            context);
+#else
+        parallel_for_range_impl(INDEX_T(0), nTasks, grainSize, chunk);
+#endif
+      }
+
     } // ::rkcommon::tasking::detail
   } // ::rkcommon::tasking
 } // ::rkcommon
@@ -0,0 +1,102 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <utility>
+
+#include "../../math/box.h"
+
+#ifdef RKCOMMON_TASKING_TBB
+#  define __TBB_NO_IMPLICIT_LINKAGE 1
+#  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#  include <tbb/blocked_range2d.h>
+#  include <tbb/blocked_range3d.h>
+#  include <tbb/parallel_for.h>
+#  include "tbb_context.h"
+#else
+#  include "parallel_for.inl"
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      using math::box2i;
+      using math::box3i;
+      using math::vec2i;
+      using math::vec3i;
+
+      template <typename TASK_T>
+      inline void parallel_for_tiled_impl(const vec2i &lower,
+                                          const vec2i &upper,
+                                          const vec2i &tileSize,
+                                          TASK_T &&fcn)
+      {
+#ifdef RKCOMMON_TASKING_TBB
+        tbb::task_group_context context;
+        initTbbContext(context);
+        tbb::parallel_for(
+            tbb::blocked_range2d<int>(
+                lower.y, upper.y, tileSize.y, lower.x, upper.x, tileSize.x),
+            [&](const tbb::blocked_range2d<int> &r) {
+              fcn(box2i(vec2i(r.cols().begin(), r.rows().begin()),
+                        vec2i(r.cols().end(), r.rows().end())));
+            },
+            context);
+#else
+        const vec2i numTiles = (upper - lower + tileSize - 1) / tileSize;
+        parallel_for_impl(numTiles.product(), [&](int tileID) {
+          const vec2i tile(tileID % numTiles.x, tileID / numTiles.x);
+          const vec2i begin = lower + tile * tileSize;
+          const vec2i end   = min(begin + tileSize, upper);
+          fcn(box2i(begin, end));
+        });
+#endif
+      }
+
+      template <typename TASK_T>
+      inline void parallel_for_tiled_impl(const vec3i &lower,
+                                          const vec3i &upper,
+                                          const vec3i &tileSize,
+                                          TASK_T &&fcn)
+      {
+#ifdef RKCOMMON_TASKING_TBB
+        tbb::task_group_context context;
+        initTbbContext(context);
+        tbb::parallel_for(
+            tbb::blocked_range3d<int>(lower.z,
+                                      upper.z,
+                                      tileSize.z,
+                                      lower.y,
+                                      upper.y,
+                                      tileSize.y,
+                                      lower.x,
+                                      upper.x,
+                                      tileSize.x),
+            [&](const tbb::blocked_range3d<int> &r) {
+              fcn(box3i(
+                  vec3i(r.cols().begin(), r.rows().begin(), r.pages().begin()),
+                  vec3i(r.cols().end(), r.rows().end(), r.pages().end())));
+            },
+            context);
+#else
+        // tiles are enumerated x-fastest, so consecutive tasks stay within
+        // the same slab of z-slices
+        const vec3i numTiles = (upper - lower + tileSize - 1) / tileSize;
+        const int numTilesXY = numTiles.x * numTiles.y;
+        parallel_for_impl(numTilesXY * numTiles.z, [&](int tileID) {
+          const int tileXY = tileID % numTilesXY;
+          const vec3i tile(
+              tileXY % numTiles.x, tileXY / numTiles.x, tileID / numTilesXY);
+          const vec3i begin = lower + tile * tileSize;
+          const vec3i end   = min(begin + tileSize, upper);
+          fcn(box3i(begin, end));
+        });
+#endif
+      }
+
+    } // ::rkcommon::tasking::detail
+  } // ::rkcommon::tasking
+} // ::rkcommon
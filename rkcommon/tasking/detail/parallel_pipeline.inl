@@ -0,0 +1,617 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../../containers/RingBuffer.h"
+#include "../PipelineStage.h"
+#include "schedule.inl"
+
+#if defined(RKCOMMON_TASKING_TBB)
+#  define __TBB_NO_IMPLICIT_LINKAGE 1
+#  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#  include <tbb/parallel_pipeline.h>
+#  include "tbb_context.h"
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+#  include "TaskSys.h"
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+#  include <thread>
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      struct PipelineStageCounters
+      {
+        std::atomic<uint64_t> items{0};
+        std::atomic<uint64_t> busyNanoseconds{0};
+        std::atomic<uint64_t> deferred{0};
+      };
+
+      // Runs fcn() and adds its duration to 'counters'
+      template <typename FCN_T>
+      inline auto timedStage(PipelineStageCounters &counters, FCN_T &&fcn)
+          -> decltype(fcn())
+      {
+        using clock = std::chrono::steady_clock;
+        struct Timer
+        {
+          PipelineStageCounters &counters;
+          clock::time_point start;
+          ~Timer()
+          {
+            counters.busyNanoseconds += uint64_t(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now() - start)
+                    .count());
+          }
+        } timer{counters, clock::now()};
+        return fcn();
+      }
+
+      // The items in flight between two stages, one slot per token
+      template <typename T>
+      class PipelineSlots
+      {
+       public:
+        void allocate(size_t numTokens)
+        {
+          storage.reset(new storage_t[numTokens]);
+        }
+
+        void put(size_t token, T &&value)
+        {
+          new (&storage[token]) T(std::move(value));
+        }
+
+        T take(size_t token)
+        {
+          T *value = reinterpret_cast<T *>(&storage[token]);
+          T result(std::move(*value));
+          value->~T();
+          return result;
+        }
+
+       private:
+        using storage_t =
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+        std::unique_ptr<storage_t[]> storage;
+      };
+
+      template <>
+      class PipelineSlots<void>
+      {
+       public:
+        void allocate(size_t) {}
+      };
+
+      // Calls a stage on the item of 'token', moving it from 'in' to 'out'
+      template <typename IN, typename OUT>
+      struct PipelineCall
+      {
+        template <typename STAGE_T>
+        static void run(STAGE_T &stage,
+                        PipelineSlots<IN> &in,
+                        PipelineSlots<OUT> &out,
+                        size_t token)
+        {
+          out.put(token, stage.fcn(in.take(token)));
+        }
+      };
+
+      template <typename IN>
+      struct PipelineCall<IN, void>
+      {
+        template <typename STAGE_T>
+        static void run(STAGE_T &stage,
+                        PipelineSlots<IN> &in,
+                        PipelineSlots<void> &,
+                        size_t token)
+        {
+          stage.fcn(in.take(token));
+        }
+      };
+
+      // Calls the first stage, false once it stopped the pipeline
+      template <typename OUT>
+      struct PipelineInput
+      {
+        template <typename STAGE_T>
+        static bool run(STAGE_T &stage, PipelineSlots<OUT> &out, size_t token)
+        {
+          PipelineControl control;
+          OUT value = stage.fcn(control);
+          if (control.stopped())
+            return false;
+          out.put(token, std::move(value));
+          return true;
+        }
+      };
+
+      template <>
+      struct PipelineInput<void>
+      {
+        template <typename STAGE_T>
+        static bool run(STAGE_T &stage, PipelineSlots<void> &, size_t)
+        {
+          PipelineControl control;
+          stage.fcn(control);
+          return !control.stopped();
+        }
+      };
+
+      // Whether the OUT of each stage is the IN of the next one
+      template <typename... STAGES>
+      struct PipelineChained : std::true_type
+      {
+      };
+
+      template <typename A, typename B, typename... REST>
+      struct PipelineChained<A, B, REST...>
+          : std::integral_constant<
+                bool,
+                std::is_same<typename A::output_type,
+                             typename B::input_type>::value
+                    && PipelineChained<B, REST...>::value>
+      {
+      };
+
+      struct PipelineItem
+      {
+        size_t token;
+        uint64_t seq;  // position in the stream of the first stage
+      };
+
+      /*! Runs the items of a pipeline as tasks, without ever blocking a
+          thread: an item which finds a serial stage busy (or, in order, not
+          yet at its turn) is parked with the stage, and whichever item
+          leaves the stage next continues it in a new task. Each item holds
+          one of 'maxTokens' tokens from its production by the first stage
+          until it leaves the last stage; the first stage produces whenever
+          a token is free. The typed stage calls are in PipelineExecution. */
+      class PipelineEngine
+      {
+       public:
+        PipelineEngine(size_t maxTokens, std::vector<StageMode> modes);
+        virtual ~PipelineEngine() = default;
+
+        void run();
+
+        PipelineStageCounters &counters(size_t stage);
+
+       protected:
+        // The first stage produces the item of 'token', false at the end
+        virtual bool produce(size_t token) = 0;
+        // Stage 'stage' > 0 processes the item of 'token'
+        virtual void consume(size_t stage, size_t token) = 0;
+
+        const size_t maxTokens;
+
+       private:
+        struct Stage
+        {
+          StageMode mode{StageMode::PARALLEL};
+          PipelineStageCounters counters;
+
+          std::mutex mutex;
+          bool busy{false};
+          /* The parked items, at most one per token. SERIAL_IN_ORDER keeps
+             them at seq % maxTokens, flagged in 'parked', as none can be
+             'maxTokens' or more ahead of the next one to run;
+             SERIAL_OUT_OF_ORDER uses 'window' as a FIFO ring of 'numParked'
+             items starting at 'first'. */
+          std::vector<PipelineItem> window;
+          std::vector<char> parked;
+          uint64_t nextSeq{0};
+          size_t first{0};
+          size_t numParked{0};
+        };
+
+        void pump();
+        void advance(PipelineItem item, size_t stage, bool admitted);
+        void spawn(PipelineItem item, size_t stage);
+        void finish(PipelineItem item);
+
+        // Lets 'item' into a serial stage, or parks it
+        bool enter(Stage &s, const PipelineItem &item);
+        // Leaves a serial stage, handing it to 'next' if one is parked
+        bool leave(Stage &s, PipelineItem &next);
+
+        const size_t numStages;
+        std::unique_ptr<Stage[]> stages;
+
+        containers::RingBuffer<size_t> freeTokens;
+        std::atomic<bool> pumping{false};
+        std::atomic<bool> inputDone{false};
+        uint64_t nextInputSeq{0};  // guarded by 'pumping'
+
+        // the input while it produces plus the items in flight
+        std::atomic<int> remaining{1};
+      };
+
+      template <typename... STAGES>
+      class PipelineExecution : public PipelineEngine
+      {
+       public:
+        PipelineExecution(size_t maxTokens, STAGES &... stages);
+
+       private:
+        bool produce(size_t token) override;
+        void consume(size_t stage, size_t token) override;
+
+        template <size_t I>
+        void allocateSlots(std::integral_constant<size_t, I>);
+        void allocateSlots(std::integral_constant<size_t, sizeof...(STAGES)>)
+        {
+        }
+
+        template <size_t I>
+        void consumeAt(size_t stage,
+                       size_t token,
+                       std::integral_constant<size_t, I>);
+        void consumeAt(size_t,
+                       size_t,
+                       std::integral_constant<size_t, sizeof...(STAGES)>)
+        {
+        }
+
+        std::tuple<STAGES &...> stages;
+        std::tuple<PipelineSlots<typename STAGES::output_type>...> slots;
+      };
+
+#ifdef RKCOMMON_TASKING_TBB
+      inline tbb::filter_mode tbbFilterMode(StageMode mode)
+      {
+        switch (mode) {
+        case StageMode::SERIAL_IN_ORDER:
+          return tbb::filter_mode::serial_in_order;
+        case StageMode::SERIAL_OUT_OF_ORDER:
+          return tbb::filter_mode::serial_out_of_order;
+        default:
+          return tbb::filter_mode::parallel;
+        }
+      }
+
+      // tbb::make_filter() of a stage, counting into 'counters'
+      template <typename IN, typename OUT>
+      struct TbbPipelineFilter
+      {
+        template <typename STAGE_T>
+        static tbb::filter<IN, OUT> make(STAGE_T &stage,
+                                         PipelineStageCounters &counters)
+        {
+          STAGE_T *s               = &stage;
+          PipelineStageCounters *c = &counters;
+          return tbb::make_filter<IN, OUT>(
+              tbbFilterMode(stage.mode), [s, c](IN value) -> OUT {
+                c->items++;
+                return timedStage(
+                    *c, [&]() { return s->fcn(std::move(value)); });
+              });
+        }
+      };
+
+      template <typename OUT>
+      struct TbbPipelineFilter<void, OUT>
+      {
+        template <typename STAGE_T>
+        static tbb::filter<void, OUT> make(STAGE_T &stage,
+                                           PipelineStageCounters &counters)
+        {
+          STAGE_T *s               = &stage;
+          PipelineStageCounters *c = &counters;
+          return tbb::make_filter<void, OUT>(
+              tbbFilterMode(stage.mode), [s, c](tbb::flow_control &fc) -> OUT {
+                PipelineControl control;
+                OUT value =
+                    timedStage(*c, [&]() -> OUT { return s->fcn(control); });
+                if (control.stopped())
+                  fc.stop();
+                else
+                  c->items++;
+                return value;
+              });
+        }
+      };
+
+      template <>
+      struct TbbPipelineFilter<void, void>
+      {
+        template <typename STAGE_T>
+        static tbb::filter<void, void> make(STAGE_T &stage,
+                                            PipelineStageCounters &counters)
+        {
+          STAGE_T *s               = &stage;
+          PipelineStageCounters *c = &counters;
+          return tbb::make_filter<void, void>(
+              tbbFilterMode(stage.mode), [s, c](tbb::flow_control &fc) {
+                PipelineControl control;
+                timedStage(*c, [&]() { s->fcn(control); });
+                if (control.stopped())
+                  fc.stop();
+                else
+                  c->items++;
+              });
+        }
+      };
+
+      // The filters of stages I.. of 'stages' joined with operator&
+      template <size_t I,
+                typename TUPLE_T,
+                bool LAST = I + 1 == std::tuple_size<TUPLE_T>::value>
+      struct TbbPipelineChain
+      {
+        using stage_t = typename std::decay<
+            typename std::tuple_element<I, TUPLE_T>::type>::type;
+
+        static tbb::filter<typename stage_t::input_type, void> make(
+            TUPLE_T &stages, PipelineStageCounters *counters)
+        {
+          return TbbPipelineFilter<typename stage_t::input_type,
+                                   typename stage_t::output_type>::
+                     make(std::get<I>(stages), counters[I])
+                 & TbbPipelineChain<I + 1, TUPLE_T>::make(stages, counters);
+        }
+      };
+
+      template <size_t I, typename TUPLE_T>
+      struct TbbPipelineChain<I, TUPLE_T, true>
+      {
+        using stage_t = typename std::decay<
+            typename std::tuple_element<I, TUPLE_T>::type>::type;
+
+        static tbb::filter<typename stage_t::input_type, void> make(
+            TUPLE_T &stages, PipelineStageCounters *counters)
+        {
+          return TbbPipelineFilter<typename stage_t::input_type,
+                                   void>::make(std::get<I>(stages),
+                                               counters[I]);
+        }
+      };
+#endif
+
+      // Inlined PipelineEngine members ///////////////////////////////////////
+
+      inline PipelineEngine::PipelineEngine(size_t _maxTokens,
+                                            std::vector<StageMode> modes)
+          : maxTokens(_maxTokens),
+            numStages(modes.size()),
+            stages(new Stage[modes.size()]),
+            freeTokens(_maxTokens)
+      {
+        for (size_t i = 0; i < numStages; ++i) {
+          Stage &s = stages[i];
+          s.mode   = modes[i];
+          if (s.mode != StageMode::PARALLEL) {
+            s.window.resize(maxTokens);
+            s.parked.assign(maxTokens, 0);
+          }
+        }
+
+        for (size_t token = 0; token < maxTokens; ++token)
+          freeTokens.try_push(token);
+      }
+
+      inline PipelineStageCounters &PipelineEngine::counters(size_t stage)
+      {
+        return stages[stage].counters;
+      }
+
+      inline void PipelineEngine::run()
+      {
+#if defined(RKCOMMON_TASKING_OMP)
+#pragma omp parallel
+#pragma omp single
+        pump();
+        // the end of the parallel region waits for all tasks
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+        pump();
+        waitInternal(remaining);
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+        pump();
+        while (remaining.load() > 0) {
+          runPinnedTasks();
+          std::this_thread::yield();
+        }
+#else  // Debug --> one item at a time (TBB runs tbb::parallel_pipeline)
+        for (;;) {
+          const bool produced =
+              timedStage(stages[0].counters, [&]() { return produce(0); });
+          if (!produced)
+            break;
+          stages[0].counters.items++;
+          for (size_t s = 1; s < numStages; ++s) {
+            timedStage(stages[s].counters, [&]() { consume(s, 0); });
+            stages[s].counters.items++;
+          }
+        }
+#endif
+      }
+
+      inline void PipelineEngine::pump()
+      {
+        for (;;) {
+          bool expected = false;
+          if (!pumping.compare_exchange_strong(expected, true))
+            return;
+
+          bool stopped = false;
+          size_t token = 0;
+          while (!inputDone && freeTokens.try_pop(token)) {
+            const PipelineItem item{token, nextInputSeq};
+            stopped = !timedStage(stages[0].counters,
+                                  [&]() { return produce(token); });
+            if (stopped) {
+              freeTokens.try_push(token);
+              inputDone = true;
+            } else {
+              nextInputSeq++;
+              stages[0].counters.items++;
+              remaining++;
+              spawn(item, 1);
+            }
+          }
+
+          pumping = false;
+          if (inputDone) {
+            // the pipeline may be gone once this drops to zero
+            if (stopped)
+              remaining--;
+            return;
+          }
+          // tokens freed meanwhile may have found the pump busy
+          if (freeTokens.empty())
+            return;
+        }
+      }
+
+      inline void PipelineEngine::advance(PipelineItem item,
+                                          size_t stage,
+                                          bool admitted)
+      {
+        for (; stage < numStages; ++stage, admitted = false) {
+          Stage &s          = stages[stage];
+          const bool serial = s.mode != StageMode::PARALLEL;
+          if (serial && !admitted && !enter(s, item))
+            return;  // continued by the item leaving the stage before it
+
+          timedStage(s.counters, [&]() { consume(stage, item.token); });
+          s.counters.items++;
+
+          PipelineItem next{0, 0};
+          if (serial && leave(s, next))
+            spawn(next, stage);
+        }
+        finish(item);
+      }
+
+      inline void PipelineEngine::spawn(PipelineItem item, size_t stage)
+      {
+#if defined(RKCOMMON_TASKING_OMP)
+#pragma omp task firstprivate(item, stage)
+        advance(item, stage, true);
+#else
+        schedule_impl([=]() { advance(item, stage, true); });
+#endif
+      }
+
+      inline void PipelineEngine::finish(PipelineItem item)
+      {
+        freeTokens.try_push(item.token);
+        pump();
+        // the pipeline may be gone once this drops to zero
+        remaining--;
+      }
+
+      inline bool PipelineEngine::enter(Stage &s, const PipelineItem &item)
+      {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.mode == StageMode::SERIAL_IN_ORDER) {
+          if (!s.busy && item.seq == s.nextSeq) {
+            s.busy = true;
+            return true;
+          }
+          const size_t slot = size_t(item.seq % maxTokens);
+          s.window[slot]    = item;
+          s.parked[slot]    = 1;
+        } else {
+          if (!s.busy) {
+            s.busy = true;
+            return true;
+          }
+          s.window[(s.first + s.numParked++) % maxTokens] = item;
+        }
+        s.counters.deferred++;
+        return false;
+      }
+
+      inline bool PipelineEngine::leave(Stage &s, PipelineItem &next)
+      {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.mode == StageMode::SERIAL_IN_ORDER) {
+          const size_t slot = size_t(++s.nextSeq % maxTokens);
+          if (s.parked[slot] && s.window[slot].seq == s.nextSeq) {
+            s.parked[slot] = 0;
+            next           = s.window[slot];
+            return true;
+          }
+        } else if (s.numParked > 0) {
+          next    = s.window[s.first];
+          s.first = (s.first + 1) % maxTokens;
+          s.numParked--;
+          return true;
+        }
+        s.busy = false;
+        return false;
+      }
+
+      // Inlined PipelineExecution members ////////////////////////////////////
+
+      template <typename... STAGES>
+      inline PipelineExecution<STAGES...>::PipelineExecution(
+          size_t maxTokens, STAGES &... _stages)
+          : PipelineEngine(maxTokens, {_stages.mode...}), stages(_stages...)
+      {
+        allocateSlots(std::integral_constant<size_t, 0>());
+      }
+
+      template <typename... STAGES>
+      template <size_t I>
+      inline void PipelineExecution<STAGES...>::allocateSlots(
+          std::integral_constant<size_t, I>)
+      {
+        std::get<I>(slots).allocate(maxTokens);
+        allocateSlots(std::integral_constant<size_t, I + 1>());
+      }
+
+      template <typename... STAGES>
+      inline bool PipelineExecution<STAGES...>::produce(size_t token)
+      {
+        using stage_t =
+            typename std::tuple_element<0, std::tuple<STAGES...>>::type;
+        return PipelineInput<typename stage_t::output_type>::run(
+            std::get<0>(stages), std::get<0>(slots), token);
+      }
+
+      template <typename... STAGES>
+      inline void PipelineExecution<STAGES...>::consume(size_t stage,
+                                                        size_t token)
+      {
+        consumeAt(stage, token, std::integral_constant<size_t, 1>());
+      }
+
+      template <typename... STAGES>
+      template <size_t I>
+      inline void PipelineExecution<STAGES...>::consumeAt(
+          size_t stage, size_t token, std::integral_constant<size_t, I>)
+      {
+        if (stage != I) {
+          consumeAt(stage, token, std::integral_constant<size_t, I + 1>());
+          return;
+        }
+
+        using stage_t =
+            typename std::tuple_element<I, std::tuple<STAGES...>>::type;
+        PipelineCall<typename stage_t::input_type,
+                     typename stage_t::output_type>::run(std::get<I>(stages),
+                                                         std::get<I - 1>(slots),
+                                                         std::get<I>(slots),
+                                                         token);
+      }
+
+    }  // namespace detail
+  }    // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,122 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <utility>
+
+#ifdef RKCOMMON_TASKING_TBB
+#  define __TBB_NO_IMPLICIT_LINKAGE 1
+#  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#  include <tbb/blocked_range.h>
+#  include <tbb/parallel_reduce.h>
+#  include "tbb_context.h"
+#elif defined(RKCOMMON_TASKING_OMP)
+#  include <omp.h>
+#  include "../../containers/AlignedVector.h"
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+#  include "TaskSys.h"
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+#  include <algorithm>
+#  include "../../containers/AlignedVector.h"
+#  include "dynamic_backend.h"
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      template <typename INDEX_T,
+                typename VALUE_T,
+                typename MAP_T,
+                typename COMBINE_T>
+      inline VALUE_T parallel_reduce_impl(INDEX_T nTasks,
+                                          const VALUE_T &identity,
+                                          MAP_T &&mapFcn,
+                                          COMBINE_T &&combineFcn)
+      {
+#ifdef RKCOMMON_TASKING_TBB
+        tbb::task_group_context context;
+        initTbbContext(context);
+        return tbb::parallel_reduce(
+            tbb::blocked_range<INDEX_T>(INDEX_T(0), nTasks),
+            identity,
+            [&](const tbb::blocked_range<INDEX_T> &r, VALUE_T acc) {
+              for (INDEX_T i = r.begin(); i != r.end(); ++i)
+                acc = combineFcn(acc, mapFcn(i));
+              return acc;
+            },
+            [&](const VALUE_T &a, const VALUE_T &b) {
+              return combineFcn(a, b);
+            },
+            context);
+#elif defined(RKCOMMON_TASKING_OMP)
+        // NOTE: OpenMP 'reduction' clauses can't name arbitrary functors, so
+        //       each thread reduces into its own padded slot instead
+        struct alignas(64) Partial
+        {
+          VALUE_T value;
+        };
+
+        containers::AlignedVector<Partial> partials(omp_get_max_threads(),
+                                                    Partial{identity});
+#       pragma omp parallel
+        {
+          VALUE_T acc = identity;
+#         pragma omp for schedule(dynamic) nowait
+          for (INDEX_T taskIndex = 0; taskIndex < nTasks; ++taskIndex)
+            acc = combineFcn(acc, mapFcn(taskIndex));
+          partials[omp_get_thread_num()].value = acc;
+        }
+
+        VALUE_T result = identity;
+        for (const auto &p : partials)
+          result = combineFcn(result, p.value);
+        return result;
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+        return detail::parallel_reduce_internal(nTasks,
+                                                identity,
+                                                std::forward<MAP_T>(mapFcn),
+                                                std::forward<COMBINE_T>(combineFcn));
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+        // a fixed number of chunks, each reduced into its own padded slot
+        struct alignas(64) Partial
+        {
+          VALUE_T value;
+        };
+
+        if (nTasks <= INDEX_T(0))
+          return identity;
+
+        const INDEX_T numChunks = std::min(nTasks, INDEX_T(256));
+        const INDEX_T chunkSize = (nTasks + numChunks - 1) / numChunks;
+
+        containers::AlignedVector<Partial> partials(size_t(numChunks),
+                                                    Partial{identity});
+        detail::dynamic_parallel_for_range(
+            INDEX_T(0), numChunks, INDEX_T(1), [&](INDEX_T begin, INDEX_T end) {
+              for (INDEX_T chunk = begin; chunk < end; ++chunk) {
+                const INDEX_T first = chunk * chunkSize;
+                const INDEX_T last  = std::min(nTasks, first + chunkSize);
+                VALUE_T acc = identity;
+                for (INDEX_T taskIndex = first; taskIndex < last; ++taskIndex)
+                  acc = combineFcn(acc, mapFcn(taskIndex));
+                partials[chunk].value = acc;
+              }
+            });
+
+        VALUE_T result = identity;
+        for (const auto &p : partials)
+          result = combineFcn(result, p.value);
+        return result;
+#else // Debug (no tasking system)
+        VALUE_T result = identity;
+        for (INDEX_T taskIndex = 0; taskIndex < nTasks; ++taskIndex)
+          result = combineFcn(result, mapFcn(taskIndex));
+        return result;
+#endif
+      }
+
+    } // ::rkcommon::tasking::detail
+  } // ::rkcommon::tasking
+} // ::rkcommon
@@ -0,0 +1,245 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "../parallel_for.h"
+
+#ifdef RKCOMMON_TASKING_TBB
+#  define __TBB_NO_IMPLICIT_LINKAGE 1
+#  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#  include <tbb/parallel_sort.h>
+#  include "tbb_context.h"
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      // ranges up to this size are sorted by a single std::sort()
+      static constexpr size_t SORT_RUN_SIZE = 16384;
+      // upper bound on the number of runs (and merge tasks per round)
+      static constexpr size_t SORT_MAX_RUNS = 64;
+
+      // Merge neighbouring pairs of sorted runs of 'src' (delimited by
+      // 'bounds') into 'dst', returning the bounds of the merged runs. Each
+      // pair is split into 'piecesPerPair' independent std::merge() calls by
+      // cutting the longer run evenly and binary searching the cut in the
+      // other one. An odd last run is paired with an empty one (moved).
+      template <typename SRC_T, typename DST_T, typename COMPARE_T>
+      inline std::vector<size_t> merge_sorted_runs(
+          SRC_T src,
+          DST_T dst,
+          const std::vector<size_t> &bounds,
+          size_t piecesPerPair,
+          COMPARE_T &comp)
+      {
+        const size_t numRuns  = bounds.size() - 1;
+        const size_t numPairs = (numRuns + 1) / 2;
+
+        parallel_for(numPairs * piecesPerPair, [&](size_t taskIndex) {
+          const size_t pair  = taskIndex / piecesPerPair;
+          const size_t piece = taskIndex % piecesPerPair;
+
+          const size_t a0 = bounds[2 * pair];
+          const size_t a1 = bounds[2 * pair + 1];
+          const size_t b1 = bounds[std::min(2 * pair + 2, numRuns)];
+          const size_t b0 = a1;
+
+          size_t aBegin, aEnd, bBegin, bEnd;
+          if (a1 - a0 >= b1 - b0) {
+            auto cut = [&](size_t p) -> std::pair<size_t, size_t> {
+              if (p == 0)
+                return std::make_pair(a0, b0);
+              if (p == piecesPerPair)
+                return std::make_pair(a1, b1);
+              const size_t ia = a0 + (a1 - a0) * p / piecesPerPair;
+              const size_t jb =
+                  std::lower_bound(src + b0, src + b1, src[ia], comp) - src;
+              return std::make_pair(ia, jb);
+            };
+            const auto first = cut(piece);
+            const auto last  = cut(piece + 1);
+            aBegin = first.first, bBegin = first.second;
+            aEnd = last.first, bEnd = last.second;
+          } else {
+            auto cut = [&](size_t p) -> std::pair<size_t, size_t> {
+              if (p == 0)
+                return std::make_pair(a0, b0);
+              if (p == piecesPerPair)
+                return std::make_pair(a1, b1);
+              const size_t jb = b0 + (b1 - b0) * p / piecesPerPair;
+              const size_t ia =
+                  std::upper_bound(src + a0, src + a1, src[jb], comp) - src;
+              return std::make_pair(ia, jb);
+            };
+            const auto first = cut(piece);
+            const auto last  = cut(piece + 1);
+            aBegin = first.first, bBegin = first.second;
+            aEnd = last.first, bEnd = last.second;
+          }
+
+          const size_t outBegin = a0 + (aBegin - a0) + (bBegin - b0);
+          std::merge(std::make_move_iterator(src + aBegin),
+                     std::make_move_iterator(src + aEnd),
+                     std::make_move_iterator(src + bBegin),
+                     std::make_move_iterator(src + bEnd),
+                     dst + outBegin,
+                     comp);
+        });
+
+        std::vector<size_t> merged;
+        for (size_t i = 0; i < numRuns; i += 2)
+          merged.push_back(bounds[i]);
+        merged.push_back(bounds.back());
+        return merged;
+      }
+
+      template <typename ITERATOR_T, typename COMPARE_T>
+      inline void parallel_sort_impl(ITERATOR_T begin,
+                                     ITERATOR_T end,
+                                     COMPARE_T &comp)
+      {
+#ifdef RKCOMMON_TASKING_TBB
+        tbbRunInContext([&]() { tbb::parallel_sort(begin, end, comp); });
+#else
+        // NOTE: a parallel merge sort on top of parallel_for(), so it runs on
+        //       whatever backend parallel_for() dispatches to: the range is
+        //       split into runs which are sorted independently, then merged
+        //       pairwise through a scratch buffer until one run is left
+        using VALUE_T = typename std::iterator_traits<ITERATOR_T>::value_type;
+
+        const size_t n = std::distance(begin, end);
+        if (n <= 2 * SORT_RUN_SIZE) {
+          std::sort(begin, end, comp);
+          return;
+        }
+
+        const size_t numRuns =
+            std::min(SORT_MAX_RUNS, (n + SORT_RUN_SIZE - 1) / SORT_RUN_SIZE);
+
+        std::vector<size_t> bounds(numRuns + 1);
+        for (size_t r = 0; r <= numRuns; ++r)
+          bounds[r] = n * r / numRuns;
+
+        parallel_for(numRuns, [&](size_t r) {
+          std::sort(begin + bounds[r], begin + bounds[r + 1], comp);
+        });
+
+        std::vector<VALUE_T> scratch(n);
+        bool inScratch = false;
+
+        while (bounds.size() > 2) {
+          const size_t numPairs      = bounds.size() / 2;
+          const size_t piecesPerPair = std::max(size_t(1), numRuns / numPairs);
+          if (inScratch) {
+            bounds = merge_sorted_runs(
+                scratch.begin(), begin, bounds, piecesPerPair, comp);
+          } else {
+            bounds = merge_sorted_runs(
+                begin, scratch.begin(), bounds, piecesPerPair, comp);
+          }
+          inScratch = !inScratch;
+        }
+
+        if (inScratch) {
+          parallel_for(numRuns, [&](size_t r) {
+            std::move(scratch.begin() + n * r / numRuns,
+                      scratch.begin() + n * (r + 1) / numRuns,
+                      begin + n * r / numRuns);
+          });
+        }
+#endif
+      }
+
+      // LSD radix sort over 8 bit digits, stable. Each pass builds one
+      // histogram per block in parallel, turns them into per-(digit, block)
+      // offsets, then scatters each block in parallel. Passes on which all
+      // keys share the same digit are skipped.
+      template <typename KEY_T, typename VALUE_T>
+      inline void parallel_radix_sort_impl(KEY_T *keys,
+                                           VALUE_T *values,
+                                           size_t n)
+      {
+        static constexpr size_t RADIX      = 256;
+        static constexpr size_t BLOCK_SIZE = 16384;
+        static constexpr size_t MAX_BLOCKS = 64;
+
+        if (n < 2)
+          return;
+
+        const size_t numBlocks =
+            std::min(MAX_BLOCKS, (n + BLOCK_SIZE - 1) / BLOCK_SIZE);
+
+        std::vector<KEY_T> keyScratch(n);
+        std::vector<VALUE_T> valueScratch(values ? n : 0);
+        std::vector<size_t> offsets(numBlocks * RADIX);
+
+        KEY_T *srcKeys     = keys;
+        KEY_T *dstKeys     = keyScratch.data();
+        VALUE_T *srcValues = values;
+        VALUE_T *dstValues = values ? valueScratch.data() : nullptr;
+
+        for (size_t pass = 0; pass < sizeof(KEY_T); ++pass) {
+          const size_t shift = 8 * pass;
+
+          parallel_for(numBlocks, [&](size_t b) {
+            size_t *histogram = &offsets[b * RADIX];
+            std::fill(histogram, histogram + RADIX, size_t(0));
+            const size_t end = n * (b + 1) / numBlocks;
+            for (size_t i = n * b / numBlocks; i < end; ++i)
+              histogram[(srcKeys[i] >> shift) & (RADIX - 1)]++;
+          });
+
+          bool trivialPass = false;
+          size_t sum       = 0;
+          for (size_t digit = 0; digit < RADIX; ++digit) {
+            size_t digitCount = 0;
+            for (size_t b = 0; b < numBlocks; ++b) {
+              const size_t count = offsets[b * RADIX + digit];
+              offsets[b * RADIX + digit] = sum;
+              sum += count;
+              digitCount += count;
+            }
+            trivialPass |= (digitCount == n);
+          }
+
+          if (trivialPass)
+            continue;
+
+          parallel_for(numBlocks, [&](size_t b) {
+            size_t *offset   = &offsets[b * RADIX];
+            const size_t end = n * (b + 1) / numBlocks;
+            for (size_t i = n * b / numBlocks; i < end; ++i) {
+              const size_t pos = offset[(srcKeys[i] >> shift) & (RADIX - 1)]++;
+              dstKeys[pos]     = srcKeys[i];
+              if (srcValues)
+                dstValues[pos] = std::move(srcValues[i]);
+            }
+          });
+
+          std::swap(srcKeys, dstKeys);
+          std::swap(srcValues, dstValues);
+        }
+
+        if (srcKeys != keys) {
+          parallel_for(numBlocks, [&](size_t b) {
+            const size_t begin = n * b / numBlocks;
+            const size_t end   = n * (b + 1) / numBlocks;
+            std::copy(srcKeys + begin, srcKeys + end, keys + begin);
+            if (srcValues) {
+              std::move(
+                  srcValues + begin, srcValues + end, values + begin);
+            }
+          });
+        }
+      }
+
+    } // ::rkcommon::tasking::detail
+  } // ::rkcommon::tasking
+} // ::rkcommon
@@ -0,0 +1,182 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../schedule.h"
+#include "../tasking_system_init.h"
+#include "dynamic_backend.h"
+
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+#include "TaskSys.h"
+#endif
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      // Emulated pinned tasks for backends without addressable workers ///////
+
+      // Lock-free multi-producer queue; concurrent drain() calls each take a
+      // disjoint batch
+      struct PinnedQueue
+      {
+        struct Node
+        {
+          std::function<void()> fcn;
+          Node *next;
+        };
+
+        void push(std::function<void()> fcn)
+        {
+          Node *node =
+              new Node{std::move(fcn), head.load(std::memory_order_relaxed)};
+          while (!head.compare_exchange_weak(node->next,
+                                             node,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed))
+            ;
+        }
+
+        // Run everything queued so far in submission order; tasks pushed
+        // meanwhile are left for the next call
+        void drain()
+        {
+          Node *list = head.exchange(nullptr, std::memory_order_acquire);
+
+          Node *ordered = nullptr;
+          while (list) {
+            Node *next = list->next;
+            list->next = ordered;
+            ordered    = list;
+            list       = next;
+          }
+
+          while (ordered) {
+            std::unique_ptr<Node> node(ordered);
+            ordered = node->next;
+            node->fcn();
+          }
+        }
+
+       private:
+        std::atomic<Node *> head{nullptr};
+      };
+
+      // index of the emulated pinned thread running on this thread, 0 if none
+      static thread_local uint32_t t_pinnedThreadIndex = 0;
+
+      struct PinnedThread
+      {
+        explicit PinnedThread(uint32_t index)
+        {
+          std::thread([this, index]() {
+            t_pinnedThreadIndex = index;
+            while (true) {
+              {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [&]() { return pending; });
+                pending = false;
+              }
+              queue.drain();
+            }
+          }).detach();
+        }
+
+        void push(std::function<void()> fcn)
+        {
+          queue.push(std::move(fcn));
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = true;
+          }
+          wakeup.notify_one();
+        }
+
+        PinnedQueue queue;
+
+       private:
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        bool pending{false};
+      };
+
+      struct PinnedThreads
+      {
+        PinnedQueue mainQueue;
+
+        PinnedThread &thread(uint32_t index)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (threads.size() <= index)
+            threads.resize(index + 1);
+          if (!threads[index])
+            threads[index].reset(new PinnedThread(index));
+          return *threads[index];
+        }
+
+       private:
+        std::mutex mutex;
+        std::vector<std::unique_ptr<PinnedThread>> threads;
+      };
+
+      static PinnedThreads &pinnedThreads()
+      {
+        // intentionally leaked: the (detached) threads never exit
+        static PinnedThreads *threads = new PinnedThreads;
+        return *threads;
+      }
+
+      static void checkThreadIndex(uint32_t threadIndex, int numThreads)
+      {
+        if (threadIndex >= uint32_t(std::max(numThreads, 1))) {
+          throw std::runtime_error(
+              "rkcommon::tasking::schedule_on_thread(): thread index "
+              + std::to_string(threadIndex) + " is out of range, there are "
+              + std::to_string(std::max(numThreads, 1)) + " tasking threads");
+        }
+      }
+
+      void scheduleOnThread(uint32_t threadIndex, std::function<void()> fcn)
+      {
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+        if (currentTaskingBackend() == TaskingBackend::INTERNAL) {
+          checkThreadIndex(threadIndex, numThreadsTaskSystemInternal());
+          scheduleOnThreadInternal(threadIndex, std::move(fcn));
+          return;
+        }
+#endif
+        checkThreadIndex(threadIndex, numTaskingThreads());
+        if (threadIndex == 0)
+          pinnedThreads().mainQueue.push(std::move(fcn));
+        else
+          pinnedThreads().thread(threadIndex).push(std::move(fcn));
+      }
+
+    }  // namespace detail
+
+    void runPinnedTasks()
+    {
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+      if (currentTaskingBackend() == TaskingBackend::INTERNAL)
+        detail::runPinnedTasksInternal();
+#endif
+      // also covers tasks queued before a Dynamic build switched backends
+      auto &threads = detail::pinnedThreads();
+      if (detail::t_pinnedThreadIndex != 0)
+        threads.thread(detail::t_pinnedThreadIndex).queue.drain();
+      else
+        threads.mainQueue.drain();
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -3,35 +3,79 @@
 
 #pragma once
 
+#include <type_traits>
 #include <utility>
 
+#include "../TaskPriority.h"
+#include "task_tracing.h"
+
 #ifdef RKCOMMON_TASKING_TBB
 #  define __TBB_NO_IMPLICIT_LINKAGE 1
 #  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
 #  include "tbb/task_arena.h"
+#  include "task_priority.h"
 #elif defined(RKCOMMON_TASKING_OMP)
 #  include <thread>
 #elif defined(RKCOMMON_TASKING_INTERNAL)
 #  include "TaskSys.h"
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+#  include "dynamic_backend.h"
 #endif
 
 namespace rkcommon {
   namespace tasking {
     namespace detail {
 
+#ifdef RKCOMMON_TASKING_DYNAMIC
+      // Tasks fitting a ScheduledFunction are type erased without allocating
+      template <typename TASK_T>
+      inline void dynamic_schedule(TASK_T &&task,
+                                   TaskPriority priority,
+                                   std::true_type)
+      {
+        detail::dynamicSchedule(ScheduledFunction(std::forward<TASK_T>(task)),
+                                priority);
+      }
+
+      template <typename TASK_T>
+      inline void dynamic_schedule(TASK_T &&task,
+                                   TaskPriority priority,
+                                   std::false_type)
+      {
+        detail::dynamicSchedule(
+            std::function<void()>(std::forward<TASK_T>(task)), priority);
+      }
+#endif
+
       template<typename TASK_T>
-      inline void schedule_impl(TASK_T fcn)
+      inline void schedule_impl(TASK_T fcn,
+                                TaskPriority priority = TaskPriority::NORMAL)
       {
+        auto &&task = tracedFcn("schedule", std::move(fcn));
 #ifdef RKCOMMON_TASKING_TBB
-        tbb::task_arena ta = tbb::task_arena(tbb::task_arena::attach());
-        ta.enqueue(fcn);
+        if (priority == TaskPriority::NORMAL) {
+          tbb::task_arena ta = tbb::task_arena(tbb::task_arena::attach());
+          ta.enqueue(std::move(task));
+        } else {
+          detail::tbbPriorityArena(priority).enqueue(std::move(task));
+        }
 #elif defined(RKCOMMON_TASKING_OMP)
-        std::thread thread(fcn);
+        (void)priority;
+        std::thread thread(std::move(task));
         thread.detach();
 #elif defined(RKCOMMON_TASKING_INTERNAL)
-        detail::schedule_internal(std::move(fcn));
+        detail::schedule_internal(std::move(task), priority);
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+        using task_t = typename std::decay<decltype(task)>::type;
+        using fits_inline = std::integral_constant<
+            bool,
+            sizeof(task_t) <= ScheduledFunction::capacity
+                && alignof(task_t) <= ScheduledFunction::alignment
+                && std::is_copy_constructible<task_t>::value>;
+        dynamic_schedule(std::move(task), priority, fits_inline());
 #else// Debug --> synchronous!
-        fcn();
+        (void)priority;
+        task();
 #endif
       }
 
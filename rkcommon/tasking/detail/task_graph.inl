@@ -0,0 +1,204 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#if defined(RKCOMMON_TASKING_TBB)
+#define __TBB_NO_IMPLICIT_LINKAGE 1
+#define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#include <tbb/flow_graph.h>
+#include "tbb_context.h"
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+#include "TaskSys.h"
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+#include <algorithm>
+#include "dynamic_backend.h"
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      struct TaskGraphNode
+      {
+        std::function<void()> fcn;
+        std::vector<size_t> successors;
+        int numPredecessors{0};
+      };
+
+      // Backend specific execution state of a (validated) TaskGraph. It is
+      // rebuilt whenever the graph changes, and reused across executions.
+      struct TaskGraphImpl
+      {
+        TaskGraphImpl(const std::vector<TaskGraphNode> &nodes,
+                      const std::vector<size_t> &topologicalOrder);
+        ~TaskGraphImpl();
+
+        void execute();
+
+       private:
+        const std::vector<TaskGraphNode> &nodes;
+        const std::vector<size_t> &order;
+
+#if defined(RKCOMMON_TASKING_TBB)
+        using flow_node_t = tbb::flow::continue_node<tbb::flow::continue_msg>;
+
+        tbb::task_group_context context;
+        tbb::flow::graph graph{context};
+        std::vector<std::unique_ptr<flow_node_t>> flowNodes;
+#elif defined(RKCOMMON_TASKING_OMP)
+        void spawn(size_t id);
+
+        std::unique_ptr<std::atomic<int>[]> pending;
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+        struct NodeTask : public Task
+        {
+          TaskGraphImpl *graph{nullptr};
+          size_t id{0};
+          std::atomic<int> pending{0};
+
+          void ExecuteRange(enki::TaskSetPartition, uint32_t) override
+          {
+            graph->runNode(id);
+          }
+        };
+
+        void runNode(size_t id);
+
+        std::unique_ptr<NodeTask[]> tasks;
+        std::atomic<int> remaining{0};
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+        // nodes grouped by their longest distance from a root; each level
+        // runs as one parallel loop after the previous one has finished
+        std::vector<std::vector<size_t>> levels;
+#endif
+      };
+
+      // Inlined definitions //////////////////////////////////////////////////
+
+      inline TaskGraphImpl::TaskGraphImpl(
+          const std::vector<TaskGraphNode> &_nodes,
+          const std::vector<size_t> &topologicalOrder)
+          : nodes(_nodes), order(topologicalOrder)
+      {
+#if defined(RKCOMMON_TASKING_TBB)
+        initTbbContext(context);
+        flowNodes.reserve(nodes.size());
+        for (const auto &n : nodes) {
+          const std::function<void()> *fcn = &n.fcn;
+          flowNodes.emplace_back(new flow_node_t(
+              graph, [fcn](const tbb::flow::continue_msg &) { (*fcn)(); }));
+        }
+
+        for (size_t i = 0; i < nodes.size(); ++i) {
+          for (auto s : nodes[i].successors)
+            tbb::flow::make_edge(*flowNodes[i], *flowNodes[s]);
+        }
+#elif defined(RKCOMMON_TASKING_OMP)
+        pending.reset(new std::atomic<int>[nodes.size()]);
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+        tasks.reset(new NodeTask[nodes.size()]);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+          tasks[i].graph = this;
+          tasks[i].id    = i;
+        }
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+        std::vector<size_t> depth(nodes.size(), 0);
+        for (auto id : order) {
+          for (auto s : nodes[id].successors)
+            depth[s] = std::max(depth[s], depth[id] + 1);
+          if (depth[id] >= levels.size())
+            levels.resize(depth[id] + 1);
+          levels[depth[id]].push_back(id);
+        }
+#endif
+      }
+
+      inline TaskGraphImpl::~TaskGraphImpl()
+      {
+#if defined(RKCOMMON_TASKING_TBB)
+        graph.wait_for_all();
+#endif
+      }
+
+      inline void TaskGraphImpl::execute()
+      {
+#if defined(RKCOMMON_TASKING_TBB)
+        for (size_t i = 0; i < nodes.size(); ++i) {
+          if (nodes[i].numPredecessors == 0)
+            flowNodes[i]->try_put(tbb::flow::continue_msg());
+        }
+        graph.wait_for_all();
+#elif defined(RKCOMMON_TASKING_OMP)
+        for (size_t i = 0; i < nodes.size(); ++i)
+          pending[i] = nodes[i].numPredecessors;
+
+#pragma omp parallel
+#pragma omp single
+        {
+          for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i].numPredecessors == 0)
+              spawn(i);
+          }
+        }
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+        for (size_t i = 0; i < nodes.size(); ++i)
+          tasks[i].pending = nodes[i].numPredecessors;
+        remaining = int(nodes.size());
+
+        for (size_t i = 0; i < nodes.size(); ++i) {
+          if (nodes[i].numPredecessors == 0)
+            scheduleTaskInternal(&tasks[i]);
+        }
+
+        waitInternal(remaining);
+
+        // make sure every task set has fully retired before it gets reused
+        for (size_t i = 0; i < nodes.size(); ++i)
+          waitInternal(&tasks[i]);
+#elif defined(RKCOMMON_TASKING_DYNAMIC)
+        for (const auto &level : levels) {
+          dynamic_parallel_for_range(
+              size_t(0), level.size(), size_t(1), [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                  nodes[level[i]].fcn();
+              });
+        }
+#else  // Debug --> run nodes serially in dependency order
+        for (auto id : order)
+          nodes[id].fcn();
+#endif
+      }
+
+#if defined(RKCOMMON_TASKING_OMP)
+      inline void TaskGraphImpl::spawn(size_t id)
+      {
+#pragma omp task firstprivate(id)
+        {
+          nodes[id].fcn();
+          for (auto s : nodes[id].successors) {
+            if (--pending[s] == 0)
+              spawn(s);
+          }
+        }
+      }
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+      inline void TaskGraphImpl::runNode(size_t id)
+      {
+        nodes[id].fcn();
+        for (auto s : nodes[id].successors) {
+          if (--tasks[s].pending == 0)
+            scheduleTaskInternal(&tasks[s]);
+        }
+        remaining--;
+      }
+#endif
+
+    }  // namespace detail
+  }    // namespace tasking
+}  // namespace rkcommon
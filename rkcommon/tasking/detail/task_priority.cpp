@@ -0,0 +1,38 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "task_priority.h"
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+      static tbb::task_arena *makeTbbPriorityArena(TaskPriority priority)
+      {
+#if TBB_INTERFACE_VERSION >= 12000
+        auto tbbPriority = tbb::task_arena::priority::normal;
+        if (priority == TaskPriority::LOW)
+          tbbPriority = tbb::task_arena::priority::low;
+        else if (priority == TaskPriority::HIGH)
+          tbbPriority = tbb::task_arena::priority::high;
+        return new tbb::task_arena(
+            tbb::task_arena::automatic, 1, tbbPriority);
+#else
+        (void)priority;
+        return new tbb::task_arena();
+#endif
+      }
+
+      tbb::task_arena &tbbPriorityArena(TaskPriority priority)
+      {
+        // intentionally leaked: enqueued tasks may outlive static destruction
+        static tbb::task_arena *low  = makeTbbPriorityArena(TaskPriority::LOW);
+        static tbb::task_arena *high = makeTbbPriorityArena(TaskPriority::HIGH);
+        return priority == TaskPriority::LOW ? *low : *high;
+      }
+#endif
+
+    }  // namespace detail
+  }    // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,29 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../../common.h"
+#include "../TaskPriority.h"
+#include "dynamic_backend.h"
+
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+#  define __TBB_NO_IMPLICIT_LINKAGE 1
+#  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#  include <tbb/task_arena.h>
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+      // Arena shared by all tasks of 'priority' (other than NORMAL, which
+      // attaches to the caller's arena as before), created on first use
+      tbb::task_arena RKCOMMON_INTERFACE &tbbPriorityArena(
+          TaskPriority priority);
+#endif
+
+    }  // namespace detail
+  }    // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,103 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <utility>
+
+#ifdef RKCOMMON_ENABLE_PROFILING
+#include <atomic>
+#include "../../tracing/Tracing.h"
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+#ifdef RKCOMMON_ENABLE_PROFILING
+
+      /* Built with RKCOMMON_ENABLE_PROFILING, parallel_for(), schedule() and
+         AsyncTask record a trace event on the thread running each task (or
+         chunk of a parallel loop), named after the innermost event open
+         where the tasks were created, or after the call if there is none.
+         A flow event links the creation to the first task to run, so that
+         the scheduling delay and the load balance of the workers show up
+         in chrome://tracing or ui.perfetto.dev. */
+      struct TaskSpawn
+      {
+        explicit TaskSpawn(const char *call)
+            : call(call),
+              region(tracing::currentRegion()),
+              flow(tracing::beginFlow(call))
+        {
+        }
+
+        TaskSpawn(const TaskSpawn &other)
+            : call(other.call),
+              region(other.region),
+              flow(other.flow),
+              linked(other.linked.load())
+        {
+        }
+
+        const char *call;
+        const char *region;
+        uint64_t flow;
+        // set by the first task to run
+        std::atomic<bool> linked{false};
+      };
+
+      // the trace event of a task, for its lifetime
+      struct TracedTask
+      {
+        explicit TracedTask(TaskSpawn &spawn)
+        {
+          tracing::beginEvent(spawn.region ? spawn.region : spawn.call,
+                              "tasking");
+          if (!spawn.linked.exchange(true, std::memory_order_relaxed))
+            tracing::endFlow(spawn.call, spawn.flow);
+        }
+
+        ~TracedTask()
+        {
+          tracing::endEvent();
+        }
+      };
+
+      // 'fcn' run as a TracedTask, for schedule() and AsyncTask; 'fcn'
+      // itself without RKCOMMON_ENABLE_PROFILING
+      template <typename TASK_T>
+      struct TracedFcn
+      {
+        TracedFcn(const char *call, TASK_T &&fcn)
+            : spawn(call), fcn(std::forward<TASK_T>(fcn))
+        {
+        }
+
+        // const for backends which run copies of const tasks (TBB)
+        void operator()() const
+        {
+          TracedTask task(spawn);
+          fcn();
+        }
+
+        mutable TaskSpawn spawn;
+        mutable typename std::decay<TASK_T>::type fcn;
+      };
+
+      template <typename TASK_T>
+      inline TracedFcn<TASK_T> tracedFcn(const char *call, TASK_T &&fcn)
+      {
+        return TracedFcn<TASK_T>(call, std::forward<TASK_T>(fcn));
+      }
+#else
+      template <typename TASK_T>
+      inline TASK_T &&tracedFcn(const char *, TASK_T &&fcn)
+      {
+        return std::forward<TASK_T>(fcn);
+      }
+#endif
+
+    }  // namespace detail
+  }    // namespace tasking
+}  // namespace rkcommon
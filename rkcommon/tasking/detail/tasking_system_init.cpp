@@ -2,20 +2,33 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "../tasking_system_init.h"
+#include "dynamic_backend.h"
+#include "tbb_context.h"
+#include "thread_affinity.h"
 
 // tasking system internals
-#if defined(RKCOMMON_TASKING_TBB)
+#if defined(RKCOMMON_TASKING_WITH_TBB)
 #define __TBB_NO_IMPLICIT_LINKAGE 1
 #define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
 #define TBB_PREVIEW_GLOBAL_CONTROL 1
 #include <tbb/global_control.h>
-#elif defined(RKCOMMON_TASKING_OMP)
+#include <tbb/task_arena.h>
+#include <tbb/task_scheduler_observer.h>
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
 #include <omp.h>
-#elif defined(RKCOMMON_TASKING_INTERNAL)
+#endif
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
 #include "TaskSys.h"
 #endif
 
 // std
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 #include <thread>
 
 // intrinsics
@@ -46,56 +59,402 @@
 
 // rkcommon
 #include "../../common.h"
+#include "../../utility/Config.h"
 
 namespace rkcommon {
   namespace tasking {
 
+    // Worker initialization //
+
+    struct WorkerInitRegistry
+    {
+      std::mutex mutex;
+      std::vector<std::pair<int, WorkerInitHook>> hooks;
+      int nextId{0};
+    };
+
+    static WorkerInitRegistry &workerInitRegistry()
+    {
+      static WorkerInitRegistry r;
+      return r;
+    }
+
+    // What each thread runs once for one initTaskingSystem() call
+    struct WorkerInit
+    {
+      AffinitySettings affinity;
+      int numThreads{1};
+      bool flushDenormals{false};
+      std::vector<WorkerInitHook> hooks;
+      unsigned generation{0};
+
+      bool empty() const
+      {
+        return affinity.policy == AffinityPolicy::NONE && !flushDenormals
+            && hooks.empty();
+      }
+    };
+
+    static std::atomic<unsigned> g_workerInitGeneration{0};
+    // the generation this thread last ran, TBB threads join arenas often
+    static thread_local unsigned t_workerInitGeneration = 0;
+
+    static void runWorkerInit(const WorkerInit &init,
+                              int index,
+                              bool pin = true)
+    {
+      if (t_workerInitGeneration == init.generation)
+        return;
+      t_workerInitGeneration = init.generation;
+
+      if (pin && index > 0 && init.affinity.policy != AffinityPolicy::NONE) {
+        detail::pinCurrentThread(detail::affinityCpusForThread(
+            init.affinity, index, init.numThreads));
+      }
+      if (init.flushDenormals) {
+        _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+        _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+      }
+      for (const auto &hook : init.hooks)
+        hook(index);
+    }
+
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+    // Whether TBB contexts capture flushed floating point settings
+    static std::atomic<bool> g_tbbFlushDenormals{false};
+
+    namespace detail {
+
+      void initTbbContext(tbb::task_group_context &context)
+      {
+        if (!g_tbbFlushDenormals.load(std::memory_order_relaxed))
+          return;
+#if !defined(RKCOMMON_NO_SIMD) && !defined(__ARM_NEON)
+        // flushed whether or not the calling thread ran the worker init
+        const unsigned int csr = _mm_getcsr();
+        _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+        _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+        context.capture_fp_settings();
+        _mm_setcsr(csr);
+#else
+        context.capture_fp_settings();
+#endif
+      }
+
+    }  // namespace detail
+#endif
+
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+    // Initializes TBB threads as they join the (implicit) arena. Arena slot
+    // 0 is the thread which called initTaskingSystem(), initialized already.
+    struct worker_init_observer : public tbb::task_scheduler_observer
+    {
+      worker_init_observer(std::shared_ptr<const WorkerInit> init)
+          : init(std::move(init))
+      {
+        observe(true);
+      }
+
+      ~worker_init_observer()
+      {
+        observe(false);
+      }
+
+      void on_scheduler_entry(bool) override
+      {
+        runWorkerInit(*init, tbb::this_task_arena::current_thread_index());
+      }
+
+      std::shared_ptr<const WorkerInit> init;
+    };
+#endif
+
     struct tasking_system_handle
     {
-      tasking_system_handle(int numThreads) : numThreads(numThreads)
+      tasking_system_handle(TaskingBackend backend,
+                            int numThreads,
+                            WorkerInit &&workerInit,
+                            const WaitPolicy &waitPolicy)
+          : backend(backend),
+            numThreads(numThreads),
+            affinity(workerInit.affinity)
       {
-#if defined(RKCOMMON_TASKING_TBB)
-        if (numThreads > 0)
-          tbb_gc = make_unique<tbb::global_control>(
-              tbb::global_control::max_allowed_parallelism, numThreads);
-#elif defined(RKCOMMON_TASKING_OMP)
-        if (numThreads > 0)
-          omp_set_num_threads(numThreads);
-#elif defined(RKCOMMON_TASKING_INTERNAL)
-        detail::initTaskSystemInternal(numThreads <= 0 ? -1 : numThreads);
+        switch (backend) {
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+        case TaskingBackend::TBB:
+          if (numThreads > 0)
+            tbb_gc = make_unique<tbb::global_control>(
+                tbb::global_control::max_allowed_parallelism, numThreads);
+          g_tbbFlushDenormals = workerInit.flushDenormals;
+          if (!workerInit.empty()) {
+            workerInit.numThreads = numThreads > 0
+                ? numThreads
+                : tbb::this_task_arena::max_concurrency();
+            tbb_observer = make_unique<worker_init_observer>(
+                std::make_shared<const WorkerInit>(std::move(workerInit)));
+          }
+          break;
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+        case TaskingBackend::OPENMP:
+          if (numThreads > 0)
+            omp_set_num_threads(numThreads);
+          if (!workerInit.empty()) {
+#pragma omp parallel
+            {
+#pragma omp single
+              workerInit.numThreads = omp_get_num_threads();
+              runWorkerInit(workerInit, omp_get_thread_num());
+            }
+          }
+          break;
+#endif
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+        case TaskingBackend::INTERNAL: {
+          const bool workStealing = utility::config::taskingWorkStealing();
+          // enkiTS pins its workers itself
+          std::function<void(int)> initWorker;
+          if (workerInit.flushDenormals || !workerInit.hooks.empty()) {
+            auto init  = std::make_shared<const WorkerInit>(workerInit);
+            initWorker = [init](int index) {
+              runWorkerInit(*init, index, false);
+            };
+          }
+          detail::initTaskSystemInternal(numThreads <= 0 ? -1 : numThreads,
+                                         workStealing,
+                                         workerInit.affinity,
+                                         waitPolicy,
+                                         std::move(initWorker));
+          break;
+        }
 #endif
+        default:
+          (void)workerInit;
+          (void)waitPolicy;
+        }
+        poolThreads = active_threads();
       }
 
       int num_threads()
       {
-#if defined(RKCOMMON_TASKING_TBB)
-        return tbb::global_control::active_value(
-            tbb::global_control::max_allowed_parallelism);
-#elif defined(RKCOMMON_TASKING_OMP)
-        return omp_get_max_threads();
-#elif defined(RKCOMMON_TASKING_INTERNAL)
-        return detail::numThreadsTaskSystemInternal();
-#else
-        return 1;
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+        if (backend == TaskingBackend::INTERNAL)
+          return detail::numThreadsTaskSystemInternal();
+#endif
+        return poolThreads;
+      }
+
+      int active_threads()
+      {
+        switch (backend) {
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+        case TaskingBackend::TBB:
+          return tbb::global_control::active_value(
+              tbb::global_control::max_allowed_parallelism);
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+        case TaskingBackend::OPENMP:
+          return omp_get_max_threads();
+#endif
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+        case TaskingBackend::INTERNAL:
+          return detail::activeThreadsTaskSystemInternal();
+#endif
+        default:
+          return 1;
+        }
+      }
+
+      void set_active_threads(int n)
+      {
+        n = (n <= 0 || n > num_threads()) ? num_threads() : n;
+        switch (backend) {
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+        case TaskingBackend::TBB:
+          // the smallest of all global_controls applies, so the old one has
+          // to go first when growing
+          tbb_gc.reset();
+          tbb_gc = make_unique<tbb::global_control>(
+              tbb::global_control::max_allowed_parallelism, n);
+          break;
 #endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+        case TaskingBackend::OPENMP:
+          omp_set_num_threads(n);
+          break;
+#endif
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+        case TaskingBackend::INTERNAL:
+          detail::setActiveThreadsTaskSystemInternal(n);
+          break;
+#endif
+        default:
+          (void)n;
+        }
       }
 
+      TaskingBackend backend;
       int numThreads{-1};
-#if defined(RKCOMMON_TASKING_TBB)
+      AffinitySettings affinity;
+      // threads of the system as initialized, before setActiveThreads()
+      int poolThreads{1};
+#if defined(RKCOMMON_TASKING_WITH_TBB)
       std::unique_ptr<tbb::global_control> tbb_gc;
+      std::unique_ptr<worker_init_observer> tbb_observer;
 #endif
     };
 
     static std::unique_ptr<tasking_system_handle> g_tasking_handle;
 
+#if defined(RKCOMMON_TASKING_DYNAMIC)
+    // -1 until a backend is passed to initTaskingSystem()
+    static std::atomic<int> g_selected_backend{-1};
+
+    static TaskingBackend defaultTaskingBackend()
+    {
+      std::string name = utility::config::taskingBackend();
+      std::transform(name.begin(), name.end(), name.begin(), [](char c) {
+        return char(std::tolower(c));
+      });
+
+      // unknown or unavailable names fall through to the default order
+      if (name == "tbb" && isTaskingBackendAvailable(TaskingBackend::TBB))
+        return TaskingBackend::TBB;
+      if ((name == "openmp" || name == "omp")
+          && isTaskingBackendAvailable(TaskingBackend::OPENMP))
+        return TaskingBackend::OPENMP;
+      if (name == "internal")
+        return TaskingBackend::INTERNAL;
+      if (name == "serial" || name == "debug")
+        return TaskingBackend::SERIAL;
+
+      if (isTaskingBackendAvailable(TaskingBackend::TBB))
+        return TaskingBackend::TBB;
+      if (isTaskingBackendAvailable(TaskingBackend::OPENMP))
+        return TaskingBackend::OPENMP;
+      return TaskingBackend::INTERNAL;
+    }
+#endif
+
     void initTaskingSystem(int numThreads, bool flushDenormals)
     {
-      if (flushDenormals) {
-        _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
-        _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+      initTaskingSystem(numThreads, flushDenormals, AffinitySettings());
+    }
+
+    void initTaskingSystem(int numThreads,
+                           bool flushDenormals,
+                           const AffinitySettings &affinity)
+    {
+      initTaskingSystem(
+          currentTaskingBackend(), numThreads, flushDenormals, affinity);
+    }
+
+    void initTaskingSystem(TaskingBackend backend,
+                           int numThreads,
+                           bool flushDenormals,
+                           const AffinitySettings &affinity,
+                           const WaitPolicy &waitPolicy)
+    {
+      if (!isTaskingBackendAvailable(backend))
+        throw std::runtime_error(
+            "rkcommon::tasking::initTaskingSystem(): the requested tasking "
+            "backend is not available in this build");
+
+      WorkerInit workerInit;
+      workerInit.affinity       = affinity;
+      workerInit.numThreads     = numThreads;
+      workerInit.flushDenormals = flushDenormals;
+      workerInit.generation     = ++g_workerInitGeneration;
+      {
+        WorkerInitRegistry &r = workerInitRegistry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const auto &h : r.hooks)
+          workerInit.hooks.push_back(h.second);
       }
 
-      g_tasking_handle = make_unique<tasking_system_handle>(numThreads);
+      // the calling thread is never pinned
+      runWorkerInit(workerInit, 0);
+
+      // release the previous handle first so that its observer and global
+      // control limits don't overlap with the new ones
+      g_tasking_handle.reset();
+
+#if defined(RKCOMMON_TASKING_DYNAMIC)
+      // don't leave idle enkiTS workers behind when switching away
+      if (currentTaskingBackend() == TaskingBackend::INTERNAL
+          && backend != TaskingBackend::INTERNAL)
+        detail::shutdownTaskSystemInternal();
+      g_selected_backend = int(backend);
+#endif
+
+      g_tasking_handle = make_unique<tasking_system_handle>(
+          backend, numThreads, std::move(workerInit), waitPolicy);
+    }
+
+    int addWorkerInitHook(WorkerInitHook hook)
+    {
+      WorkerInitRegistry &r = workerInitRegistry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.hooks.emplace_back(r.nextId, std::move(hook));
+      return r.nextId++;
+    }
+
+    void removeWorkerInitHook(int id)
+    {
+      WorkerInitRegistry &r = workerInitRegistry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.hooks.erase(
+          std::remove_if(r.hooks.begin(),
+                         r.hooks.end(),
+                         [&](const std::pair<int, WorkerInitHook> &h) {
+                           return h.first == id;
+                         }),
+          r.hooks.end());
+    }
+
+    bool isTaskingBackendAvailable(TaskingBackend backend)
+    {
+      switch (backend) {
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+      case TaskingBackend::TBB:
+        return true;
+#endif
+#if defined(RKCOMMON_TASKING_WITH_OMP)
+      case TaskingBackend::OPENMP:
+        return true;
+#endif
+#if defined(RKCOMMON_TASKING_WITH_INTERNAL)
+      case TaskingBackend::INTERNAL:
+        return true;
+#endif
+#if defined(RKCOMMON_TASKING_DYNAMIC) \
+    || !(defined(RKCOMMON_TASKING_TBB) || defined(RKCOMMON_TASKING_OMP) \
+         || defined(RKCOMMON_TASKING_INTERNAL))
+      case TaskingBackend::SERIAL:
+        return true;
+#endif
+      default:
+        return false;
+      }
+    }
+
+    TaskingBackend currentTaskingBackend()
+    {
+#if defined(RKCOMMON_TASKING_DYNAMIC)
+      const int selected = g_selected_backend.load(std::memory_order_relaxed);
+      if (selected >= 0)
+        return TaskingBackend(selected);
+      static const TaskingBackend fromEnvironment = defaultTaskingBackend();
+      return fromEnvironment;
+#elif defined(RKCOMMON_TASKING_TBB)
+      return TaskingBackend::TBB;
+#elif defined(RKCOMMON_TASKING_OMP)
+      return TaskingBackend::OPENMP;
+#elif defined(RKCOMMON_TASKING_INTERNAL)
+      return TaskingBackend::INTERNAL;
+#else
+      return TaskingBackend::SERIAL;
+#endif
     }
 
     int numTaskingThreads()
@@ -106,5 +465,52 @@ namespace rkcommon {
         return g_tasking_handle->num_threads();
     }
 
+    void setActiveThreads(int numThreads)
+    {
+      if (!g_tasking_handle.get())
+        initTaskingSystem();
+      g_tasking_handle->set_active_threads(numThreads);
+    }
+
+    int activeTaskingThreads()
+    {
+      if (!g_tasking_handle.get())
+        return 0;
+      else
+        return g_tasking_handle->active_threads();
+    }
+
+    int numNumaNodes()
+    {
+      return int(detail::numaTopology().size());
+    }
+
+    int currentNumaNode()
+    {
+      return detail::numaNodeOfCpu(detail::currentCpu());
+    }
+
+    bool hasHybridCores()
+    {
+      return detail::hasHybridCores();
+    }
+
+    CoreType currentCoreType()
+    {
+      return detail::currentCoreType();
+    }
+
+    CoreType workerCoreType(int threadIndex)
+    {
+      // the thread which called initTaskingSystem() is never pinned
+      if (!g_tasking_handle.get() || threadIndex <= 0
+          || threadIndex >= numTaskingThreads())
+        return CoreType::UNKNOWN;
+      return detail::coreTypeOfCpus(
+          detail::affinityCpusForThread(g_tasking_handle->affinity,
+                                        threadIndex,
+                                        numTaskingThreads()));
+    }
+
   }  // namespace tasking
 }  // namespace rkcommon
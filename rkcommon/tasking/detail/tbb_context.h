@@ -0,0 +1,43 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../../common.h"
+#include "dynamic_backend.h"
+
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+#  define __TBB_NO_IMPLICIT_LINKAGE 1
+#  define __TBBMALLOC_NO_IMPLICIT_LINKAGE 1
+#  include <tbb/task_group.h>
+#endif
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+#if defined(RKCOMMON_TASKING_WITH_TBB)
+      /* TBB runs tasks with the floating point settings of their context,
+         which are those its arena captured when it was created unless the
+         context captured its own. That would undo the denormal flushing of
+         initTaskingSystem() on workers and callers alike, so each TBB
+         algorithm call runs in a context passed through this first: with
+         'flushDenormals' it captures flushed settings, which nested calls
+         inherit; otherwise it is left as is. */
+      RKCOMMON_INTERFACE void initTbbContext(tbb::task_group_context &context);
+
+      // Runs 'fcn' as a task of a context passed through initTbbContext(),
+      // for TBB algorithms not taking a context
+      template <typename FCN_T>
+      inline void tbbRunInContext(const FCN_T &fcn)
+      {
+        tbb::task_group_context context;
+        initTbbContext(context);
+        tbb::task_group group(context);
+        group.run_and_wait(fcn);
+      }
+#endif
+
+    }  // namespace detail
+  }    // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,501 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "thread_affinity.h"
+
+#if defined(_WIN32)
+#include "../../platform.h"
+#elif defined(__linux__)
+#include <dirent.h>
+#include <sched.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#endif
+#if defined(__X86_64__) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__X86_64__)
+#include <cpuid.h>
+#endif
+
+// std
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <thread>
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      namespace {
+
+        struct Topology
+        {
+          Topology();
+
+          std::vector<NumaNode> nodes;
+          std::vector<int> cpuToNode;  // indexed by CPU, -1 if not available
+
+          std::vector<CoreType> cpuToCoreType;  // indexed by CPU
+          std::vector<int> cpusOfType[3];       // indexed by CoreType
+          int speedRatio{1};
+
+         private:
+          void detectCoreTypes(const std::vector<bool> &available);
+        };
+
+#ifdef __linux__
+        // Parse a sysfs CPU list such as "0-3,8,10-11"
+        std::vector<int> parseCpuList(const std::string &list)
+        {
+          std::vector<int> cpus;
+          size_t pos = 0;
+          while (pos < list.size()) {
+            size_t end = list.find(',', pos);
+            if (end == std::string::npos)
+              end = list.size();
+            const std::string item = list.substr(pos, end - pos);
+            const size_t dash      = item.find('-');
+            if (!item.empty() && std::isdigit(item[0])) {
+              const int first = std::atoi(item.c_str());
+              const int last  = dash == std::string::npos
+                                   ? first
+                                   : std::atoi(item.c_str() + dash + 1);
+              for (int c = first; c <= last; ++c)
+                cpus.push_back(c);
+            }
+            pos = end + 1;
+          }
+          return cpus;
+        }
+
+        std::string readFirstLine(const std::string &path)
+        {
+          std::string line;
+          FILE *file = std::fopen(path.c_str(), "r");
+          if (!file)
+            return line;
+          char buf[4096];
+          if (std::fgets(buf, sizeof(buf), file))
+            line = buf;
+          std::fclose(file);
+          while (!line.empty() && std::isspace(line.back()))
+            line.pop_back();
+          return line;
+        }
+#endif
+
+        Topology::Topology()
+        {
+          std::vector<bool> available;
+
+#if defined(__linux__)
+          cpu_set_t mask;
+          CPU_ZERO(&mask);
+          if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+              if (CPU_ISSET(c, &mask)) {
+                available.resize(c + 1, false);
+                available[c] = true;
+              }
+          }
+
+          const std::string root = "/sys/devices/system/node/";
+          if (DIR *dir = opendir(root.c_str())) {
+            while (dirent *entry = readdir(dir)) {
+              if (std::strncmp(entry->d_name, "node", 4) != 0
+                  || !std::isdigit(entry->d_name[4]))
+                continue;
+              NumaNode node;
+              node.id = std::atoi(entry->d_name + 4);
+              node.cpus =
+                  parseCpuList(readFirstLine(root + entry->d_name + "/cpulist"));
+              nodes.push_back(node);
+            }
+            closedir(dir);
+          }
+#elif defined(_WIN32)
+          DWORD_PTR processMask = 0, systemMask = 0;
+          if (GetProcessAffinityMask(
+                  GetCurrentProcess(), &processMask, &systemMask)) {
+            for (int c = 0; c < int(sizeof(DWORD_PTR) * 8); ++c)
+              if (processMask & (DWORD_PTR(1) << c)) {
+                available.resize(c + 1, false);
+                available[c] = true;
+              }
+          }
+
+          ULONG highestNode = 0;
+          if (GetNumaHighestNodeNumber(&highestNode)) {
+            for (ULONG n = 0; n <= highestNode; ++n) {
+              ULONGLONG nodeMask = 0;
+              if (!GetNumaNodeProcessorMask(UCHAR(n), &nodeMask))
+                continue;
+              NumaNode node;
+              node.id = int(n);
+              for (int c = 0; c < 64; ++c)
+                if (nodeMask & (ULONGLONG(1) << c))
+                  node.cpus.push_back(c);
+              nodes.push_back(node);
+            }
+          }
+#endif
+
+          // fall back to a single node with all CPUs if the OS can't tell us
+          if (available.empty())
+            available.resize(std::max(1u, std::thread::hardware_concurrency()),
+                             true);
+          if (nodes.empty()) {
+            NumaNode node;
+            for (int c = 0; c < int(available.size()); ++c)
+              node.cpus.push_back(c);
+            nodes.push_back(node);
+          }
+
+          cpuToNode.assign(available.size(), -1);
+          for (auto &node : nodes) {
+            node.cpus.erase(std::remove_if(node.cpus.begin(),
+                                           node.cpus.end(),
+                                           [&](int c) {
+                                             return c >= int(available.size())
+                                                    || !available[c];
+                                           }),
+                            node.cpus.end());
+            std::sort(node.cpus.begin(), node.cpus.end());
+            for (int c : node.cpus)
+              cpuToNode[c] = node.id;
+          }
+
+          nodes.erase(
+              std::remove_if(nodes.begin(),
+                             nodes.end(),
+                             [](const NumaNode &n) { return n.cpus.empty(); }),
+              nodes.end());
+          std::sort(nodes.begin(),
+                    nodes.end(),
+                    [](const NumaNode &a, const NumaNode &b) {
+                      return a.id < b.id;
+                    });
+
+          if (nodes.empty()) {
+            // process mask and node lists disagree entirely, trust the mask
+            NumaNode node;
+            for (int c = 0; c < int(available.size()); ++c)
+              if (available[c]) {
+                node.cpus.push_back(c);
+                cpuToNode[c] = 0;
+              }
+            nodes.push_back(node);
+          }
+
+          detectCoreTypes(available);
+        }
+
+        void Topology::detectCoreTypes(const std::vector<bool> &available)
+        {
+          std::vector<CoreType> types(available.size(), CoreType::UNKNOWN);
+          auto mark = [&](const std::vector<int> &cpus, CoreType type) {
+            for (int c : cpus)
+              if (c >= 0 && c < int(types.size()))
+                types[c] = type;
+          };
+
+#if defined(__linux__)
+          // kernels exporting CPU types list them as e.g. intel_core_1 and
+          // intel_atom_1
+          const std::string typesRoot = "/sys/devices/system/cpu/types/";
+          if (DIR *dir = opendir(typesRoot.c_str())) {
+            while (dirent *entry = readdir(dir)) {
+              const std::string name = entry->d_name;
+              CoreType type          = CoreType::UNKNOWN;
+              if (name.find("atom") != std::string::npos)
+                type = CoreType::EFFICIENCY;
+              else if (name.find("core") != std::string::npos)
+                type = CoreType::PERFORMANCE;
+              if (type != CoreType::UNKNOWN)
+                mark(parseCpuList(readFirstLine(typesRoot + name + "/cpulist")),
+                     type);
+            }
+            closedir(dir);
+          }
+
+          // else the separate PMUs of Intel's hybrid CPUs
+          mark(parseCpuList(readFirstLine("/sys/devices/cpu_core/cpus")),
+               CoreType::PERFORMANCE);
+          mark(parseCpuList(readFirstLine("/sys/devices/cpu_atom/cpus")),
+               CoreType::EFFICIENCY);
+
+          // the scheduler's relative capacity of each CPU (1024 for the
+          // fastest), e.g. on ARM big.LITTLE
+          std::vector<int> capacity(available.size(), 0);
+          int minCapacity = 0, maxCapacity = 0;
+          for (int c = 0; c < int(available.size()); ++c) {
+            if (!available[c])
+              continue;
+            const std::string value =
+                readFirstLine("/sys/devices/system/cpu/cpu"
+                              + std::to_string(c) + "/cpu_capacity");
+            capacity[c] = std::atoi(value.c_str());
+            if (capacity[c] <= 0)
+              continue;
+            minCapacity = minCapacity ? std::min(minCapacity, capacity[c])
+                                      : capacity[c];
+            maxCapacity = std::max(maxCapacity, capacity[c]);
+          }
+          if (minCapacity > 0 && maxCapacity > minCapacity) {
+            speedRatio = (maxCapacity + minCapacity / 2) / minCapacity;
+            const bool typed =
+                std::find_if(types.begin(), types.end(), [](CoreType t) {
+                  return t != CoreType::UNKNOWN;
+                }) != types.end();
+            for (int c = 0; !typed && c < int(types.size()); ++c)
+              if (capacity[c] > 0)
+                types[c] = capacity[c] == maxCapacity ? CoreType::PERFORMANCE
+                                                      : CoreType::EFFICIENCY;
+          }
+#elif defined(_WIN32)
+          // higher efficiency classes are faster, one class on homogeneous
+          // systems
+          DWORD length = 0;
+          GetLogicalProcessorInformationEx(
+              RelationProcessorCore, nullptr, &length);
+          std::vector<char> buffer(length);
+          std::vector<std::pair<BYTE, KAFFINITY>> cores;
+          if (length > 0
+              && GetLogicalProcessorInformationEx(
+                  RelationProcessorCore,
+                  reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(
+                      buffer.data()),
+                  &length)) {
+            for (DWORD offset = 0; offset < length;) {
+              const auto *info =
+                  reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(
+                      buffer.data() + offset);
+              // like the affinity masks above, only group 0 is considered
+              if (info->Processor.GroupMask[0].Group == 0)
+                cores.emplace_back(info->Processor.EfficiencyClass,
+                                   info->Processor.GroupMask[0].Mask);
+              offset += info->Size;
+            }
+          }
+          BYTE maxClass = 0;
+          for (const auto &core : cores)
+            maxClass = std::max(maxClass, core.first);
+          for (const auto &core : cores) {
+            std::vector<int> cpus;
+            for (int c = 0; c < int(sizeof(KAFFINITY) * 8); ++c)
+              if (core.second & (KAFFINITY(1) << c))
+                cpus.push_back(c);
+            mark(cpus,
+                 core.first == maxClass ? CoreType::PERFORMANCE
+                                        : CoreType::EFFICIENCY);
+          }
+#else
+          (void)mark;
+#endif
+
+          for (int c = 0; c < int(types.size()); ++c)
+            if (!available[c])
+              types[c] = CoreType::UNKNOWN;
+
+          const bool hybrid =
+              std::count(types.begin(), types.end(), CoreType::PERFORMANCE)
+                  > 0
+              && std::count(types.begin(), types.end(), CoreType::EFFICIENCY)
+                     > 0;
+          if (!hybrid) {
+            types.assign(types.size(), CoreType::UNKNOWN);
+            speedRatio = 1;
+          } else if (speedRatio <= 1) {
+            // without capacities from the OS, assume E-cores reach about
+            // half the throughput of P-cores, as on Intel's hybrid CPUs
+            speedRatio = 2;
+          }
+          speedRatio = std::min(speedRatio, 4);
+
+          cpuToCoreType = types;
+          for (int c = 0; c < int(types.size()); ++c)
+            if (available[c])
+              cpusOfType[int(types[c])].push_back(c);
+        }
+
+#ifdef __X86_64__
+        // Hybrid core type reported by the CPU the calling thread runs on
+        CoreType cpuidCoreType()
+        {
+          uint32_t regs[4] = {0, 0, 0, 0};
+          auto cpuid = [&](uint32_t leaf) {
+#ifdef _MSC_VER
+            int r[4];
+            __cpuidex(r, int(leaf), 0);
+            for (int i = 0; i < 4; ++i)
+              regs[i] = uint32_t(r[i]);
+#else
+            __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+          };
+
+          cpuid(0);
+          if (regs[0] < 0x1A)
+            return CoreType::UNKNOWN;
+          cpuid(7);
+          if (!((regs[3] >> 15) & 1))  // not a hybrid part
+            return CoreType::UNKNOWN;
+          cpuid(0x1A);
+          switch (regs[0] >> 24) {
+          case 0x40:  // Intel Core
+            return CoreType::PERFORMANCE;
+          case 0x20:  // Intel Atom
+            return CoreType::EFFICIENCY;
+          default:
+            return CoreType::UNKNOWN;
+          }
+        }
+#endif
+
+        const Topology &topology()
+        {
+          static Topology topo;
+          return topo;
+        }
+
+      }  // namespace
+
+      const std::vector<NumaNode> &numaTopology()
+      {
+        return topology().nodes;
+      }
+
+      int numaNodeOfCpu(int cpu)
+      {
+        const auto &map = topology().cpuToNode;
+        if (cpu < 0 || cpu >= int(map.size()) || map[cpu] < 0)
+          return 0;
+        return map[cpu];
+      }
+
+      std::vector<int> affinityCpusForThread(const AffinitySettings &affinity,
+                                             int threadIndex,
+                                             int numThreads)
+      {
+        const auto &nodes = numaTopology();
+        const size_t i    = size_t(std::max(threadIndex, 0));
+
+        switch (affinity.policy) {
+        case AffinityPolicy::COMPACT: {
+          std::vector<int> all;
+          for (const auto &node : nodes)
+            all.insert(all.end(), node.cpus.begin(), node.cpus.end());
+          return {all[i % all.size()]};
+        }
+        case AffinityPolicy::SCATTER: {
+          const auto &node = nodes[i % nodes.size()];
+          return {node.cpus[(i / nodes.size()) % node.cpus.size()]};
+        }
+        case AffinityPolicy::EXPLICIT:
+          if (affinity.cores.empty())
+            return {};
+          return {affinity.cores[i % affinity.cores.size()]};
+        case AffinityPolicy::PERFORMANCE_FIRST: {
+          std::vector<int> all;
+          for (CoreType type : {CoreType::PERFORMANCE,
+                                CoreType::UNKNOWN,
+                                CoreType::EFFICIENCY}) {
+            const auto &cpus = cpusOfCoreType(type);
+            all.insert(all.end(), cpus.begin(), cpus.end());
+          }
+          return {all[i % all.size()]};
+        }
+        case AffinityPolicy::NUMA_NODES: {
+          const size_t n     = size_t(std::max(numThreads, 1));
+          const size_t nodeI = std::min(i * nodes.size() / n, nodes.size() - 1);
+          return nodes[nodeI].cpus;
+        }
+        case AffinityPolicy::NONE:
+        default:
+          return {};
+        }
+      }
+
+      bool pinCurrentThread(const std::vector<int> &cpus)
+      {
+        if (cpus.empty())
+          return false;
+#if defined(__linux__)
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for (int c : cpus)
+          if (c >= 0 && c < CPU_SETSIZE)
+            CPU_SET(c, &mask);
+        return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#elif defined(_WIN32)
+        DWORD_PTR mask = 0;
+        for (int c : cpus)
+          if (c >= 0 && c < int(sizeof(DWORD_PTR) * 8))
+            mask |= DWORD_PTR(1) << c;
+        return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+        // e.g. macOS has no API to bind threads to CPUs
+        return false;
+#endif
+      }
+
+      int currentCpu()
+      {
+#if defined(__linux__)
+        return sched_getcpu();
+#elif defined(_WIN32)
+        return int(GetCurrentProcessorNumber());
+#else
+        return -1;
+#endif
+      }
+
+      CoreType coreTypeOfCpu(int cpu)
+      {
+        const auto &map = topology().cpuToCoreType;
+        if (cpu < 0 || cpu >= int(map.size()))
+          return CoreType::UNKNOWN;
+        return map[cpu];
+      }
+
+      CoreType coreTypeOfCpus(const std::vector<int> &cpus)
+      {
+        if (cpus.empty())
+          return CoreType::UNKNOWN;
+        const CoreType type = coreTypeOfCpu(cpus[0]);
+        for (int c : cpus)
+          if (coreTypeOfCpu(c) != type)
+            return CoreType::UNKNOWN;
+        return type;
+      }
+
+      const std::vector<int> &cpusOfCoreType(CoreType type)
+      {
+        return topology().cpusOfType[int(type)];
+      }
+
+      bool hasHybridCores()
+      {
+        return !cpusOfCoreType(CoreType::PERFORMANCE).empty();
+      }
+
+      int coreSpeedRatio()
+      {
+        return topology().speedRatio;
+      }
+
+      CoreType currentCoreType()
+      {
+        const CoreType type = coreTypeOfCpu(currentCpu());
+#ifdef __X86_64__
+        if (type == CoreType::UNKNOWN)
+          return cpuidCoreType();
+#endif
+        return type;
+      }
+
+    }  // namespace detail
+  }    // namespace tasking
+}  // namespace rkcommon
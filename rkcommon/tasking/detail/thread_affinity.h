@@ -0,0 +1,61 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../tasking_system_init.h"
+// std
+#include <vector>
+
+namespace rkcommon {
+  namespace tasking {
+    namespace detail {
+
+      struct NumaNode
+      {
+        int id{0};              // OS node id
+        std::vector<int> cpus;  // available logical CPUs, ascending
+      };
+
+      // NUMA nodes with CPUs available to the process, queried once
+      const std::vector<NumaNode> &numaTopology();
+
+      // OS id of the node 'cpu' belongs to, 0 if unknown
+      int numaNodeOfCpu(int cpu);
+
+      // CPUs worker 'threadIndex' (of 'numThreads') should be bound to under
+      // 'affinity', empty if it should not be pinned
+      std::vector<int> affinityCpusForThread(const AffinitySettings &affinity,
+                                             int threadIndex,
+                                             int numThreads);
+
+      // Restrict the calling thread to 'cpus', returns false if unsupported
+      bool pinCurrentThread(const std::vector<int> &cpus);
+
+      // Logical CPU the calling thread is running on, -1 if unknown
+      int currentCpu();
+
+      // Type of logical CPU 'cpu', UNKNOWN if the OS can't tell or all
+      // available CPUs are of the same type
+      CoreType coreTypeOfCpu(int cpu);
+
+      // The type shared by all of 'cpus', else UNKNOWN
+      CoreType coreTypeOfCpus(const std::vector<int> &cpus);
+
+      // Available CPUs of type 'type', ascending
+      const std::vector<int> &cpusOfCoreType(CoreType type);
+
+      // True if the available CPUs are of more than one type
+      bool hasHybridCores();
+
+      // How many times faster the performance cores are than the efficiency
+      // cores, 1 on homogeneous systems
+      int coreSpeedRatio();
+
+      // Type of the CPU the calling thread is running on; asks the CPU itself
+      // (CPUID leaf 0x1A) if the OS doesn't classify it
+      CoreType currentCoreType();
+
+    }  // namespace detail
+  }    // namespace tasking
+}  // namespace rkcommon
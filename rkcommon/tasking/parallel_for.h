@@ -4,6 +4,10 @@
 #pragma once
 
 #include "../traits/rktraits.h"
+#include "AffinityHint.h"
+#include "Arena.h"
+#include "CancellationToken.h"
+#include "TuningSlot.h"
 #include "detail/parallel_for.inl"
 
 #include <algorithm>
@@ -31,6 +35,149 @@ namespace rkcommon {
       detail::parallel_for_impl(nTasks, std::forward<TASK_T>(fcn));
     }
 
+    // parallel_for() run on the threads of 'arena' instead of the default pool
+    template <typename INDEX_T, typename TASK_T>
+    inline void parallel_for(Arena &arena, INDEX_T nTasks, TASK_T &&fcn)
+    {
+      arena.execute([&]() { parallel_for(nTasks, fcn); });
+    }
+
+    /* Cancellable parallel_for(): 'token' is checked between chunks of
+       indices, and once it is cancelled no further chunks are started. Which
+       indices ran before the cancellation took effect is unspecified. */
+    template <typename INDEX_T, typename TASK_T>
+    inline void parallel_for(INDEX_T nTasks,
+                             TASK_T &&fcn,
+                             const CancellationToken &token)
+    {
+      using namespace traits;
+      static_assert(is_valid_index<INDEX_T>::value,
+                    "rkcommon::tasking::parallel_for() requires the type"
+                    " INDEX_T to be unsigned char, short, int, uint, long,"
+                    " long long, unsigned long long or size_t.");
+
+      static_assert(has_operator_method_matching_param<TASK_T, INDEX_T>::value,
+                    "rkcommon::tasking::parallel_for() requires the "
+                    "implementation of method "
+                    "'void TASK_T::operator(P taskIndex), where P is of "
+                    "type INDEX_T [first parameter of parallel_for()].");
+
+      detail::parallel_for_impl(nTasks, std::forward<TASK_T>(fcn), token);
+    }
+
+    /* parallel_for() handing indices to the threads which ran them in the
+       last loop with the same 'hint', for loops over the same data repeated
+       many times; see AffinityHint */
+    template <typename INDEX_T, typename TASK_T>
+    inline void parallel_for(INDEX_T nTasks, AffinityHint &hint, TASK_T &&fcn)
+    {
+      using namespace traits;
+      static_assert(is_valid_index<INDEX_T>::value,
+                    "rkcommon::tasking::parallel_for() requires the type"
+                    " INDEX_T to be unsigned char, short, int, uint, long,"
+                    " long long, unsigned long long or size_t.");
+
+      static_assert(has_operator_method_matching_param<TASK_T, INDEX_T>::value,
+                    "rkcommon::tasking::parallel_for() requires the "
+                    "implementation of method "
+                    "'void TASK_T::operator(P taskIndex), where P is of "
+                    "type INDEX_T [first parameter of parallel_for()].");
+
+      detail::parallel_for_affinity_impl(
+          nTasks, hint, [&](INDEX_T begin, INDEX_T end) {
+            for (INDEX_T taskIndex = begin; taskIndex < end; ++taskIndex)
+              fcn(taskIndex);
+          });
+    }
+
+    /* parallel_for() in chunks sized at runtime, so that each takes about
+       the target time of 'slot', which learns the time per index from
+       the loops given it; see TuningSlot */
+    template <typename INDEX_T, typename TASK_T>
+    inline void parallel_for(INDEX_T nTasks, TuningSlot &slot, TASK_T &&fcn)
+    {
+      using namespace traits;
+      static_assert(is_valid_index<INDEX_T>::value,
+                    "rkcommon::tasking::parallel_for() requires the type"
+                    " INDEX_T to be unsigned char, short, int, uint, long,"
+                    " long long, unsigned long long or size_t.");
+
+      static_assert(has_operator_method_matching_param<TASK_T, INDEX_T>::value,
+                    "rkcommon::tasking::parallel_for() requires the "
+                    "implementation of method "
+                    "'void TASK_T::operator(P taskIndex), where P is of "
+                    "type INDEX_T [first parameter of parallel_for()].");
+
+      if (!(INDEX_T(0) < nTasks))
+        return;
+
+      detail::parallel_for_tuned_impl(
+          INDEX_T(0), nTasks, slot, [&](INDEX_T begin, INDEX_T end) {
+            for (INDEX_T taskIndex = begin; taskIndex < end; ++taskIndex)
+              fcn(taskIndex);
+          });
+    }
+
+    /* Range-based variant of parallel_for(): the domain [begin, end) is
+       split into contiguous sub-ranges of (at least) 'grainSize' indices,
+       and 'fcn(subBegin, subEnd)' is called once per sub-range. This hands
+       whole chunks to user code so inner loops can be vectorized, and lets
+       callers control the minimum amount of work per task. */
+    template <typename INDEX_T, typename TASK_T>
+    inline void parallel_for_range(INDEX_T begin,
+                                   INDEX_T end,
+                                   INDEX_T grainSize,
+                                   TASK_T &&fcn)
+    {
+      using namespace traits;
+      static_assert(is_valid_index<INDEX_T>::value,
+                    "rkcommon::tasking::parallel_for_range() requires the type"
+                    " INDEX_T to be unsigned char, short, int, uint, long,"
+                    " long long, unsigned long long or size_t.");
+
+      static_assert(has_operator_method<TASK_T>::value,
+                    "rkcommon::tasking::parallel_for_range() requires the "
+                    "implementation of method "
+                    "'void TASK_T::operator(P begin, P end)', where P is of "
+                    "type INDEX_T [first parameter of parallel_for_range()].");
+
+      if (end <= begin)
+        return;
+
+      if (grainSize < 1)
+        grainSize = 1;
+
+      detail::parallel_for_range_impl(
+          begin, end, grainSize, std::forward<TASK_T>(fcn));
+    }
+
+    /* parallel_for_range() with the grain size chosen by 'slot', e.g. in
+       place of parallel_in_blocks_of() with a hand tuned BLOCK_SIZE */
+    template <typename INDEX_T, typename TASK_T>
+    inline void parallel_for_range(INDEX_T begin,
+                                   INDEX_T end,
+                                   TuningSlot &slot,
+                                   TASK_T &&fcn)
+    {
+      using namespace traits;
+      static_assert(is_valid_index<INDEX_T>::value,
+                    "rkcommon::tasking::parallel_for_range() requires the type"
+                    " INDEX_T to be unsigned char, short, int, uint, long,"
+                    " long long, unsigned long long or size_t.");
+
+      static_assert(has_operator_method<TASK_T>::value,
+                    "rkcommon::tasking::parallel_for_range() requires the "
+                    "implementation of method "
+                    "'void TASK_T::operator(P begin, P end)', where P is of "
+                    "type INDEX_T [first parameter of parallel_for_range()].");
+
+      if (end <= begin)
+        return;
+
+      detail::parallel_for_tuned_impl(
+          begin, end, slot, std::forward<TASK_T>(fcn));
+    }
+
     // NOTE(jda) - Allow serial version of parallel_for() without the need to
     //             change the entire tasking system backend
     template <typename INDEX_T, typename TASK_T>
@@ -74,5 +221,53 @@ namespace rkcommon {
       });
     }
 
+    // parallel_in_blocks_of() placing blocks as recorded by 'hint'
+    template <int BLOCK_SIZE, typename INDEX_T, typename TASK_T>
+    inline void parallel_in_blocks_of(INDEX_T nTasks,
+                                      AffinityHint &hint,
+                                      TASK_T &&fcn)
+    {
+      using namespace traits;
+      static_assert(is_valid_index<INDEX_T>::value,
+                    "rkcommon::tasking::parallel_for() requires the type"
+                    " INDEX_T to be unsigned char, short, int, uint, long,"
+                    " or size_t.");
+
+      INDEX_T numBlocks = (nTasks + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      detail::parallel_for_affinity_impl(
+          numBlocks, hint, [&](INDEX_T firstBlock, INDEX_T endBlock) {
+            for (INDEX_T blockID = firstBlock; blockID < endBlock; ++blockID) {
+              INDEX_T begin = blockID * (INDEX_T)BLOCK_SIZE;
+              INDEX_T end   = std::min(begin + (INDEX_T)BLOCK_SIZE, nTasks);
+              fcn(begin, end);
+            }
+          });
+    }
+
+    // Cancellable parallel_in_blocks_of(): 'token' is checked before each block
+    template <int BLOCK_SIZE, typename INDEX_T, typename TASK_T>
+    inline void parallel_in_blocks_of(INDEX_T nTasks,
+                                      TASK_T &&fcn,
+                                      const CancellationToken &token)
+    {
+      using namespace traits;
+      static_assert(is_valid_index<INDEX_T>::value,
+                    "rkcommon::tasking::parallel_for() requires the type"
+                    " INDEX_T to be unsigned char, short, int, uint, long,"
+                    " or size_t.");
+
+      INDEX_T numBlocks = (nTasks + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      parallel_for(
+          numBlocks,
+          [&](INDEX_T blockID) {
+            if (token.isCancelled())
+              return;
+            INDEX_T begin = blockID * (INDEX_T)BLOCK_SIZE;
+            INDEX_T end   = std::min(begin + (INDEX_T)BLOCK_SIZE, nTasks);
+            fcn(begin, end);
+          },
+          token);
+    }
+
   }  // namespace tasking
 }  // namespace rkcommon
@@ -0,0 +1,57 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../traits/rktraits.h"
+#include "detail/parallel_for_tiled.inl"
+
+namespace rkcommon {
+  namespace tasking {
+
+    /* Multidimensional variant of parallel_for(): the 2D or 3D domain
+       [lower, upper) is split into spatially coherent tiles of (at most)
+       'tileSize' cells, and 'fcn(const box2i/box3i &tile)' is called once
+       per tile, with 'tile.upper' being exclusive. Walking a tile keeps the
+       touched data cache resident, which flattening the domain into a 1D
+       parallel_for() does not. */
+    template <typename TASK_T>
+    inline void parallel_for_tiled(const math::vec2i &lower,
+                                   const math::vec2i &upper,
+                                   const math::vec2i &tileSize,
+                                   TASK_T &&fcn)
+    {
+      static_assert(traits::has_operator_method<TASK_T>::value,
+                    "rkcommon::tasking::parallel_for_tiled() requires the "
+                    "implementation of method "
+                    "'void TASK_T::operator(const box2i &tile)'.");
+
+      if (math::anyLessThan(tileSize, math::vec2i(1)))
+        throw std::runtime_error("parallel_for_tiled(): invalid tile size");
+
+      if (!math::anyLessThan(upper, lower + 1))
+        detail::parallel_for_tiled_impl(
+            lower, upper, tileSize, std::forward<TASK_T>(fcn));
+    }
+
+    template <typename TASK_T>
+    inline void parallel_for_tiled(const math::vec3i &lower,
+                                   const math::vec3i &upper,
+                                   const math::vec3i &tileSize,
+                                   TASK_T &&fcn)
+    {
+      static_assert(traits::has_operator_method<TASK_T>::value,
+                    "rkcommon::tasking::parallel_for_tiled() requires the "
+                    "implementation of method "
+                    "'void TASK_T::operator(const box3i &tile)'.");
+
+      if (math::anyLessThan(tileSize, math::vec3i(1)))
+        throw std::runtime_error("parallel_for_tiled(): invalid tile size");
+
+      if (!math::anyLessThan(upper, lower + 1))
+        detail::parallel_for_tiled_impl(
+            lower, upper, tileSize, std::forward<TASK_T>(fcn));
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,99 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace rkcommon {
+  namespace tasking {
+
+    /* Reorder [begin, end) so that all elements for which 'pred(value)' is
+       true precede the ones for which it is false, and return the iterator
+       to the first 'false' element (e.g. the split point of a BVH node).
+       Unlike std::partition() the relative order within both halves is
+       preserved. 'pred' is evaluated once per element; like
+       parallel_compact() this uses a blocked two-pass scheme on top of
+       parallel_in_blocks_of(), and it moves the elements through a scratch
+       buffer, so the value type must be default constructible. */
+    template <int BLOCK_SIZE = 4096, typename ITERATOR_T, typename PREDICATE_T>
+    inline ITERATOR_T parallel_partition(ITERATOR_T begin,
+                                         ITERATOR_T end,
+                                         PREDICATE_T &&pred)
+    {
+      using ITERATOR_KIND =
+          typename std::iterator_traits<ITERATOR_T>::iterator_category;
+      using VALUE_T = typename std::iterator_traits<ITERATOR_T>::value_type;
+
+      static_assert(
+          std::is_same<ITERATOR_KIND, std::random_access_iterator_tag>::value,
+          "rkcommon::tasking::parallel_partition() requires random-"
+          "access iterators!");
+
+      static_assert(std::is_default_constructible<VALUE_T>::value &&
+                        std::is_move_assignable<VALUE_T>::value,
+                    "rkcommon::tasking::parallel_partition() requires a "
+                    "default constructible and move assignable value type.");
+
+      static_assert(BLOCK_SIZE > 0,
+                    "rkcommon::tasking::parallel_partition() requires "
+                    "a positive BLOCK_SIZE.");
+
+      const size_t n = std::distance(begin, end);
+      if (n <= size_t(BLOCK_SIZE))
+        return std::stable_partition(begin, end, pred);
+
+      const size_t numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      std::vector<uint8_t> flags(n);
+      std::vector<size_t> offsets(numBlocks);
+
+      parallel_in_blocks_of<BLOCK_SIZE>(n, [&](size_t first, size_t last) {
+        size_t count = 0;
+        for (size_t i = first; i < last; ++i) {
+          flags[i] = pred(begin[i]) ? 1 : 0;
+          count += flags[i];
+        }
+        offsets[first / BLOCK_SIZE] = count;
+      });
+
+      size_t numTrue = 0;
+      for (auto &o : offsets) {
+        const size_t count = o;
+        o                  = numTrue;
+        numTrue += count;
+      }
+
+      std::vector<VALUE_T> scratch(n);
+
+      parallel_in_blocks_of<BLOCK_SIZE>(n, [&](size_t first, size_t last) {
+        size_t trueIndex  = offsets[first / BLOCK_SIZE];
+        size_t falseIndex = numTrue + (first - trueIndex);
+        for (size_t i = first; i < last; ++i) {
+          const size_t outIndex = flags[i] ? trueIndex++ : falseIndex++;
+          scratch[outIndex]     = std::move(begin[i]);
+        }
+      });
+
+      parallel_in_blocks_of<BLOCK_SIZE>(n, [&](size_t first, size_t last) {
+        std::move(scratch.begin() + first, scratch.begin() + last, begin + first);
+      });
+
+      return begin + numTrue;
+    }
+
+    template <int BLOCK_SIZE = 4096, typename CONTAINER_T, typename PREDICATE_T>
+    inline auto parallel_partition(CONTAINER_T &c, PREDICATE_T &&pred)
+        -> decltype(std::begin(c))
+    {
+      return parallel_partition<BLOCK_SIZE>(
+          std::begin(c), std::end(c), std::forward<PREDICATE_T>(pred));
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,110 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "PipelineStage.h"
+#include "detail/parallel_pipeline.inl"
+
+#include <algorithm>
+#include <chrono>
+
+namespace rkcommon {
+  namespace tasking {
+
+    /*! Streams items through a chain of stages, e.g. read -> decode ->
+        filter -> encode -> write for frames or tiles, overlapping the stages
+        of different items instead of running each stage as its own
+        parallel_for() phase. The first stage produces the items until it
+        calls PipelineControl::stop(); each further stage takes the output
+        of the one before. At most 'maxTokens' items are in flight at any
+        time, which bounds the memory held by the stream.
+
+          parallel_pipeline(
+              4,
+              makePipelineStage<void, Frame>(StageMode::SERIAL_IN_ORDER,
+                  [&](PipelineControl &c) {
+                    Frame f;
+                    if (!reader.read(f))
+                      c.stop();
+                    return f;
+                  }),
+              makePipelineStage<Frame, Image>(StageMode::PARALLEL, decode),
+              makePipelineStage<Image, void>(StageMode::SERIAL_IN_ORDER,
+                  [&](Image image) { writer.write(image); }));
+
+        TBB runs tbb::parallel_pipeline. The other backends run the items as
+        tasks (OpenMP tasks on OpenMP); an item finding a serial stage busy
+        is queued with it and continued by the item leaving it, so no thread
+        ever blocks on a stage. The first stage always runs serially there.
+        Debug builds run one item after the other through all stages.
+
+        Returns the counters of each stage. */
+    template <typename... STAGES>
+    inline PipelineStatistics parallel_pipeline(size_t maxTokens,
+                                                STAGES &&... stages)
+    {
+      using chain_t = std::tuple<typename std::decay<STAGES>::type...>;
+      using first_t = typename std::tuple_element<0, chain_t>::type;
+      using last_t  = typename std::tuple_element<sizeof...(STAGES) - 1,
+                                                 chain_t>::type;
+
+      static_assert(std::is_void<typename first_t::input_type>::value,
+                    "rkcommon::tasking::parallel_pipeline() requires the "
+                    "first stage to have input type 'void'.");
+      static_assert(std::is_void<typename last_t::output_type>::value,
+                    "rkcommon::tasking::parallel_pipeline() requires the "
+                    "last stage to have output type 'void'.");
+      static_assert(
+          detail::PipelineChained<typename std::decay<STAGES>::type...>::value,
+          "rkcommon::tasking::parallel_pipeline() requires the output type "
+          "of each stage to be the input type of the next one.");
+
+      maxTokens = std::max(maxTokens, size_t(1));
+
+      const auto start = std::chrono::steady_clock::now();
+
+#ifdef RKCOMMON_TASKING_TBB
+      std::unique_ptr<detail::PipelineStageCounters[]> counters(
+          new detail::PipelineStageCounters[sizeof...(STAGES)]);
+      std::tuple<typename std::decay<STAGES>::type &...> chain(stages...);
+      tbb::task_group_context context;
+      detail::initTbbContext(context);
+      tbb::parallel_pipeline(maxTokens,
+                             detail::TbbPipelineChain<0, decltype(chain)>::make(
+                                 chain, counters.get()),
+                             context);
+      auto countersOf = [&](size_t i) -> detail::PipelineStageCounters & {
+        return counters[i];
+      };
+#else
+      detail::PipelineExecution<typename std::decay<STAGES>::type...>
+          execution(maxTokens, stages...);
+      execution.run();
+      auto countersOf = [&](size_t i) -> detail::PipelineStageCounters & {
+        return execution.counters(i);
+      };
+#endif
+
+      PipelineStatistics statistics;
+      statistics.elapsedNanoseconds = uint64_t(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count());
+
+      const char *names[] = {stages.name...};
+      for (size_t i = 0; i < sizeof...(STAGES); ++i) {
+        const detail::PipelineStageCounters &c = countersOf(i);
+        PipelineStageStatistics stage;
+        stage.name            = names[i];
+        stage.items           = c.items;
+        stage.busyNanoseconds = c.busyNanoseconds;
+        stage.deferred        = c.deferred;
+        statistics.stages.push_back(stage);
+      }
+
+      return statistics;
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -0,0 +1,116 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../traits/rktraits.h"
+#include "detail/parallel_reduce.inl"
+#include "parallel_for.h"
+// std
+#include <vector>
+
+namespace rkcommon {
+  namespace tasking {
+
+    /* This abstraction wraps a "map-reduce" over [0, nTasks): 'mapFcn(i)'
+       produces a value for each task index, which are folded together with
+       'combineFcn(a, b)' starting from 'identity'. Each worker accumulates
+       into its own partial result, so no synchronization is needed inside
+       the loop. 'combineFcn' must be associative, and 'identity' must be
+       neutral with respect to it, as the grouping of partial results depends
+       on how the tasking system schedules the work. */
+    template <typename INDEX_T,
+              typename VALUE_T,
+              typename MAP_T,
+              typename COMBINE_T>
+    inline VALUE_T parallel_reduce(INDEX_T nTasks,
+                                   const VALUE_T &identity,
+                                   MAP_T &&mapFcn,
+                                   COMBINE_T &&combineFcn)
+    {
+      using namespace traits;
+      static_assert(is_valid_index<INDEX_T>::value,
+                    "rkcommon::tasking::parallel_reduce() requires the type"
+                    " INDEX_T to be unsigned char, short, int, uint, long,"
+                    " long long, unsigned long long or size_t.");
+
+      static_assert(has_operator_method<MAP_T>::value,
+                    "rkcommon::tasking::parallel_reduce() requires the "
+                    "implementation of method "
+                    "'VALUE_T MAP_T::operator(P taskIndex)', where P is of "
+                    "type INDEX_T [first parameter of parallel_reduce()].");
+
+      static_assert(has_operator_method<COMBINE_T>::value,
+                    "rkcommon::tasking::parallel_reduce() requires the "
+                    "implementation of method "
+                    "'VALUE_T COMBINE_T::operator(VALUE_T a, VALUE_T b)'.");
+
+      return detail::parallel_reduce_impl(nTasks,
+                                          identity,
+                                          std::forward<MAP_T>(mapFcn),
+                                          std::forward<COMBINE_T>(combineFcn));
+    }
+
+    /* Deterministic parallel_reduce(): the result is the same bit for bit
+       for any number of threads and any scheduling, so e.g. floating point
+       sums are reproducible. [0, nTasks) is cut into blocks of BLOCK_SIZE
+       indices which are reduced in order, and the block results are
+       combined along a fixed binary tree: pairs of neighbouring blocks,
+       then pairs of those pairs and so on. 'combineFcn' still has to be
+       associative (up to rounding) and 'identity' neutral. Costs one value
+       of storage per block over the non-deterministic version. */
+    template <int BLOCK_SIZE = 1024,
+              typename INDEX_T,
+              typename VALUE_T,
+              typename MAP_T,
+              typename COMBINE_T>
+    inline VALUE_T parallel_reduce_deterministic(INDEX_T nTasks,
+                                                 const VALUE_T &identity,
+                                                 MAP_T &&mapFcn,
+                                                 COMBINE_T &&combineFcn)
+    {
+      using namespace traits;
+      static_assert(is_valid_index<INDEX_T>::value,
+                    "rkcommon::tasking::parallel_reduce_deterministic() "
+                    "requires the type INDEX_T to be unsigned char, short, "
+                    "int, uint, long, long long, unsigned long long or "
+                    "size_t.");
+
+      static_assert(has_operator_method<MAP_T>::value,
+                    "rkcommon::tasking::parallel_reduce_deterministic() "
+                    "requires the implementation of method "
+                    "'VALUE_T MAP_T::operator(P taskIndex)', where P is of "
+                    "type INDEX_T [first parameter of "
+                    "parallel_reduce_deterministic()].");
+
+      static_assert(has_operator_method<COMBINE_T>::value,
+                    "rkcommon::tasking::parallel_reduce_deterministic() "
+                    "requires the implementation of method "
+                    "'VALUE_T COMBINE_T::operator(VALUE_T a, VALUE_T b)'.");
+
+      static_assert(BLOCK_SIZE > 0, "BLOCK_SIZE must be positive");
+
+      if (!(INDEX_T(0) < nTasks))
+        return identity;
+
+      const size_t numBlocks = (size_t(nTasks) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      std::vector<VALUE_T> partials(numBlocks, identity);
+
+      parallel_in_blocks_of<BLOCK_SIZE>(
+          nTasks, [&](INDEX_T begin, INDEX_T end) {
+            VALUE_T acc = identity;
+            for (INDEX_T taskIndex = begin; taskIndex < end; ++taskIndex)
+              acc = combineFcn(acc, mapFcn(taskIndex));
+            partials[size_t(begin) / BLOCK_SIZE] = acc;
+          });
+
+      for (size_t width = 1; width < numBlocks; width *= 2) {
+        for (size_t i = 0; i + width < numBlocks; i += 2 * width)
+          partials[i] = combineFcn(partials[i], partials[i + width]);
+      }
+
+      return partials[0];
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
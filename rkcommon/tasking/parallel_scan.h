@@ -0,0 +1,181 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../containers/AlignedVector.h"
+#include "parallel_for.h"
+
+#include <functional>
+#include <vector>
+
+namespace rkcommon {
+  namespace tasking {
+
+    /* NOTE: the scans below use a two-pass blocked algorithm on top of
+       parallel_in_blocks_of(): the first pass reduces each block of
+       BLOCK_SIZE elements in parallel, the (short) list of block sums is
+       then scanned serially, and the second pass scans every block in
+       parallel starting from its block offset. 'op' must be associative and
+       'identity' must be neutral with respect to it. 'in' and 'out' may
+       point to the same array (in-place scan). Both return the reduction of
+       all 'n' input elements. */
+
+    namespace detail {
+
+      template <int BLOCK_SIZE, typename T, typename OP>
+      inline std::vector<T> scan_block_offsets(const T *in,
+                                               size_t n,
+                                               const T &identity,
+                                               OP &op,
+                                               T &total)
+      {
+        const size_t numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        std::vector<T> offsets(numBlocks, identity);
+
+        parallel_in_blocks_of<BLOCK_SIZE>(n, [&](size_t begin, size_t end) {
+          T acc = identity;
+          for (size_t i = begin; i < end; ++i)
+            acc = op(acc, in[i]);
+          offsets[begin / BLOCK_SIZE] = acc;
+        });
+
+        total = identity;
+        for (auto &o : offsets) {
+          const T blockSum = o;
+          o                = total;
+          total            = op(total, blockSum);
+        }
+
+        return offsets;
+      }
+
+    }  // namespace detail
+
+    template <int BLOCK_SIZE = 4096, typename T, typename OP = std::plus<T>>
+    inline T parallel_exclusive_scan(const T *in,
+                                     T *out,
+                                     size_t n,
+                                     const T &identity = T(0),
+                                     OP op             = OP())
+    {
+      static_assert(BLOCK_SIZE > 0,
+                    "rkcommon::tasking::parallel_exclusive_scan() requires "
+                    "a positive BLOCK_SIZE.");
+
+      T total = identity;
+      const auto offsets =
+          detail::scan_block_offsets<BLOCK_SIZE>(in, n, identity, op, total);
+
+      parallel_in_blocks_of<BLOCK_SIZE>(n, [&](size_t begin, size_t end) {
+        T acc = offsets[begin / BLOCK_SIZE];
+        for (size_t i = begin; i < end; ++i) {
+          const T value = in[i];
+          out[i]        = acc;
+          acc           = op(acc, value);
+        }
+      });
+
+      return total;
+    }
+
+    template <int BLOCK_SIZE = 4096, typename T, typename OP = std::plus<T>>
+    inline T parallel_inclusive_scan(const T *in,
+                                     T *out,
+                                     size_t n,
+                                     const T &identity = T(0),
+                                     OP op             = OP())
+    {
+      static_assert(BLOCK_SIZE > 0,
+                    "rkcommon::tasking::parallel_inclusive_scan() requires "
+                    "a positive BLOCK_SIZE.");
+
+      T total = identity;
+      const auto offsets =
+          detail::scan_block_offsets<BLOCK_SIZE>(in, n, identity, op, total);
+
+      parallel_in_blocks_of<BLOCK_SIZE>(n, [&](size_t begin, size_t end) {
+        T acc = offsets[begin / BLOCK_SIZE];
+        for (size_t i = begin; i < end; ++i) {
+          acc    = op(acc, in[i]);
+          out[i] = acc;
+        }
+      });
+
+      return total;
+    }
+
+    /* Stream compaction: copy every element of 'in' for which 'pred(value)'
+       is true into 'out' (resized to the number of selected elements),
+       preserving the input order. */
+    template <int BLOCK_SIZE = 4096, typename T, typename PREDICATE_T>
+    inline void parallel_compact(const T *in,
+                                 size_t n,
+                                 containers::AlignedVector<T> &out,
+                                 PREDICATE_T &&pred)
+    {
+      const size_t numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      std::vector<size_t> offsets(numBlocks);
+
+      parallel_in_blocks_of<BLOCK_SIZE>(n, [&](size_t begin, size_t end) {
+        size_t count = 0;
+        for (size_t i = begin; i < end; ++i)
+          count += pred(in[i]) ? 1 : 0;
+        offsets[begin / BLOCK_SIZE] = count;
+      });
+
+      size_t total = 0;
+      for (auto &o : offsets) {
+        const size_t count = o;
+        o                  = total;
+        total += count;
+      }
+
+      out.resize(total);
+
+      parallel_in_blocks_of<BLOCK_SIZE>(n, [&](size_t begin, size_t end) {
+        size_t outIndex = offsets[begin / BLOCK_SIZE];
+        for (size_t i = begin; i < end; ++i) {
+          if (pred(in[i]))
+            out[outIndex++] = in[i];
+        }
+      });
+    }
+
+    /* Index-list variant of parallel_compact(): collect all indices in
+       [0, n) for which 'pred(index)' is true, in increasing order. */
+    template <int BLOCK_SIZE = 4096, typename INDEX_T, typename PREDICATE_T>
+    inline void parallel_compact_indices(INDEX_T n,
+                                         containers::AlignedVector<INDEX_T> &out,
+                                         PREDICATE_T &&pred)
+    {
+      const INDEX_T numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      std::vector<INDEX_T> offsets(numBlocks);
+
+      parallel_in_blocks_of<BLOCK_SIZE>(n, [&](INDEX_T begin, INDEX_T end) {
+        INDEX_T count = 0;
+        for (INDEX_T i = begin; i < end; ++i)
+          count += pred(i) ? 1 : 0;
+        offsets[begin / BLOCK_SIZE] = count;
+      });
+
+      INDEX_T total = 0;
+      for (auto &o : offsets) {
+        const INDEX_T count = o;
+        o                   = total;
+        total += count;
+      }
+
+      out.resize(total);
+
+      parallel_in_blocks_of<BLOCK_SIZE>(n, [&](INDEX_T begin, INDEX_T end) {
+        INDEX_T outIndex = offsets[begin / BLOCK_SIZE];
+        for (INDEX_T i = begin; i < end; ++i) {
+          if (pred(i))
+            out[outIndex++] = i;
+        }
+      });
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
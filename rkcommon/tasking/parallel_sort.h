@@ -0,0 +1,81 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "detail/parallel_sort.inl"
+
+#include <functional>
+#include <iterator>
+#include <type_traits>
+
+namespace rkcommon {
+  namespace tasking {
+
+    /* Sort [begin, end) with 'comp' (not stable). TBB builds use
+       tbb::parallel_sort(); all other backends run a parallel merge sort on
+       top of parallel_for(), which needs a scratch copy of the range, so the
+       value type must be default constructible and move assignable. */
+    template <typename ITERATOR_T,
+              typename COMPARE_T = std::less<
+                  typename std::iterator_traits<ITERATOR_T>::value_type>>
+    inline void parallel_sort(ITERATOR_T begin,
+                              ITERATOR_T end,
+                              COMPARE_T comp = COMPARE_T())
+    {
+      using ITERATOR_KIND =
+          typename std::iterator_traits<ITERATOR_T>::iterator_category;
+      using VALUE_T = typename std::iterator_traits<ITERATOR_T>::value_type;
+
+      static_assert(
+          std::is_same<ITERATOR_KIND, std::random_access_iterator_tag>::value,
+          "rkcommon::tasking::parallel_sort() requires random-"
+          "access iterators!");
+
+      static_assert(std::is_default_constructible<VALUE_T>::value &&
+                        std::is_move_assignable<VALUE_T>::value,
+                    "rkcommon::tasking::parallel_sort() requires a default "
+                    "constructible and move assignable value type.");
+
+      detail::parallel_sort_impl(begin, end, comp);
+    }
+
+    template <typename CONTAINER_T>
+    inline void parallel_sort(CONTAINER_T &c)
+    {
+      parallel_sort(std::begin(c), std::end(c));
+    }
+
+    /* Stable LSD radix sort of 'n' unsigned integer keys (e.g. Morton codes),
+       permuting 'values[i]' along with 'keys[i]'. Needs scratch arrays for
+       both keys and values. */
+    template <typename KEY_T, typename VALUE_T>
+    inline void parallel_radix_sort(KEY_T *keys, VALUE_T *values, size_t n)
+    {
+      static_assert(std::is_integral<KEY_T>::value &&
+                        std::is_unsigned<KEY_T>::value,
+                    "rkcommon::tasking::parallel_radix_sort() requires "
+                    "unsigned integer keys.");
+
+      static_assert(std::is_default_constructible<VALUE_T>::value &&
+                        std::is_move_assignable<VALUE_T>::value,
+                    "rkcommon::tasking::parallel_radix_sort() requires a "
+                    "default constructible and move assignable value type.");
+
+      detail::parallel_radix_sort_impl(keys, values, n);
+    }
+
+    // Keys-only parallel_radix_sort()
+    template <typename KEY_T>
+    inline void parallel_radix_sort(KEY_T *keys, size_t n)
+    {
+      static_assert(std::is_integral<KEY_T>::value &&
+                        std::is_unsigned<KEY_T>::value,
+                    "rkcommon::tasking::parallel_radix_sort() requires "
+                    "unsigned integer keys.");
+
+      detail::parallel_radix_sort_impl(keys, static_cast<char *>(nullptr), n);
+    }
+
+  }  // namespace tasking
+}  // namespace rkcommon
@@ -4,27 +4,93 @@
 #pragma once
 
 #include "../traits/rktraits.h"
+#include "Arena.h"
+#include "CancellationToken.h"
+#include "TaskPriority.h"
 #include "detail/schedule.inl"
+// std
+#include <cstdint>
+#include <functional>
 
 namespace rkcommon {
   namespace tasking {
 
+    namespace detail {
+
+      void RKCOMMON_INTERFACE scheduleOnThread(uint32_t threadIndex,
+                                               std::function<void()> fcn);
+
+    }  // namespace detail
+
     // NOTE(jda) - This abstraction takes a lambda which should take captured
     //             variables by *value* to ensure no captured references race
     //             with the task itself.
 
-    // NOTE(jda) - No priority is associated with this call, but could be added
-    //             later with a hint enum, using a default value for the
-    //             priority to not require specifying it.
+    // NOTE(jda) - Tasks get TaskPriority::NORMAL unless a priority is passed
+    //             (see TaskPriority.h for how each backend honors it).
+    template <typename TASK_T>
+    inline void schedule(TASK_T fcn,
+                         TaskPriority priority = TaskPriority::NORMAL)
+    {
+      static_assert(traits::has_operator_method<TASK_T>::value,
+                    "rkcommon::tasking::schedule() requires the "
+                    "implementation of method 'void TASK_T::operator()'.");
+
+      detail::schedule_impl(std::move(fcn), priority);
+    }
+
+    // Cancellable schedule(): 'fcn' is skipped if 'token' has been cancelled
+    // by the time the task starts
+    template <typename TASK_T>
+    inline void schedule(TASK_T fcn, const CancellationToken &token)
+    {
+      static_assert(traits::has_operator_method<TASK_T>::value,
+                    "rkcommon::tasking::schedule() requires the "
+                    "implementation of method 'void TASK_T::operator()'.");
+
+      schedule([fcn, token]() {
+        if (!token.isCancelled())
+          fcn();
+      });
+    }
+
+    // schedule() onto the threads of 'arena' instead of the default pool
     template <typename TASK_T>
-    inline void schedule(TASK_T fcn)
+    inline void schedule(Arena &arena, TASK_T fcn)
     {
       static_assert(traits::has_operator_method<TASK_T>::value,
                     "rkcommon::tasking::schedule() requires the "
                     "implementation of method 'void TASK_T::operator()'.");
 
-      detail::schedule_impl(std::move(fcn));
+      arena.enqueue(std::move(fcn));
+    }
+
+    /* Run 'fcn' on one specific tasking thread, e.g. for work which has to
+       stay on the thread owning a GPU context or a window. 'threadIndex' is
+       in [0, numTaskingThreads()); index 0 is the application's side of the
+       tasking system: those tasks only run when a thread not owned by the
+       tasking system (e.g. the main thread) calls runPinnedTasks(), or while
+       it waits on the Internal backend. Tasks pinned to the same thread run
+       in submission order.
+
+       The Internal backend uses the enkiTS pinned task lists, so index i > 0
+       is worker thread i. The other backends have no addressable workers and
+       instead start one dedicated thread per index i > 0 on first use.
+       Throws std::runtime_error if 'threadIndex' is out of range. */
+    template <typename TASK_T>
+    inline void schedule_on_thread(uint32_t threadIndex, TASK_T fcn)
+    {
+      static_assert(traits::has_operator_method<TASK_T>::value,
+                    "rkcommon::tasking::schedule_on_thread() requires the "
+                    "implementation of method 'void TASK_T::operator()'.");
+
+      detail::scheduleOnThread(threadIndex,
+                               std::function<void()>(std::move(fcn)));
     }
 
+    // Run the tasks pinned to the calling thread so far (index 0 for threads
+    // not owned by the tasking system)
+    void RKCOMMON_INTERFACE runPinnedTasks();
+
   }  // namespace tasking
 }  // namespace rkcommon
@@ -4,14 +4,148 @@
 #pragma once
 
 #include "../common.h"
+// std
+#include <cstdint>
+#include <functional>
+#include <vector>
 
 namespace rkcommon {
   namespace tasking {
 
+    /*! Type of a CPU core on hybrid CPUs, e.g. Intel's P-cores and E-cores
+        or ARM's big.LITTLE clusters. Detected from the OS (sysfs on Linux,
+        the efficiency class on Windows) and, for the calling thread's core,
+        CPUID leaf 0x1A. Homogeneous systems only have UNKNOWN cores. */
+    enum class CoreType
+    {
+      UNKNOWN,
+      PERFORMANCE,  // the fastest cores
+      EFFICIENCY    // all slower ones
+    };
+
+    /*! Placement of the tasking system's worker threads on logical CPUs.
+        CPUs are ordered by NUMA node, then by OS CPU id, and only CPUs in
+        the process' affinity mask are used. The thread which calls
+        initTaskingSystem() (worker 0) is never pinned. */
+    enum class AffinityPolicy
+    {
+      NONE,       // leave placement to the OS (default)
+      COMPACT,    // worker i on the i-th CPU, filling one node at a time
+      SCATTER,    // workers round-robin across NUMA nodes
+      EXPLICIT,   // worker i on AffinitySettings::cores[i % cores.size()]
+      NUMA_NODES,  // one pool per NUMA node: contiguous blocks of workers
+                   // bound to (and free to migrate within) all CPUs of one
+                   // node
+      PERFORMANCE_FIRST  // like COMPACT, but filling the performance cores
+                         // of a hybrid CPU before the efficiency cores
+    };
+
+    struct AffinitySettings
+    {
+      AffinityPolicy policy{AffinityPolicy::NONE};
+      std::vector<int> cores;  // logical CPU ids, used by EXPLICIT only
+    };
+
+    /*! How idle worker threads of the Internal backend wait for new work:
+        spin (with a pause instruction and growing backoff) 'spinIterations'
+        times, then yield the CPU 'yieldIterations' times, then sleep until
+        new work is added. Sleeping costs several microseconds of wake-up
+        latency per worker, so 'alwaysHot' skips it entirely, on dedicated
+        nodes where burning a core per worker is acceptable. TBB and OpenMP
+        manage their own waiting. */
+    struct WaitPolicy
+    {
+      uint32_t spinIterations{100};
+      uint32_t yieldIterations{0};
+      bool alwaysHot{false};
+    };
+
+    /*! Implementations tasking calls can be dispatched to. A build with
+        RKCOMMON_TASKING_SYSTEM=TBB, OpenMP, Internal or Debug (SERIAL) only
+        has that one backend. A 'Dynamic' build always has INTERNAL and
+        SERIAL, plus TBB and OPENMP if they were found, and picks one at
+        runtime: the one passed to initTaskingSystem(), else the one named
+        by the RKCOMMON_TASKING_BACKEND environment variable ("tbb",
+        "openmp", "internal" or "serial"), else the first available of TBB,
+        OpenMP and Internal. */
+    enum class TaskingBackend
+    {
+      TBB,
+      OPENMP,
+      INTERNAL,
+      SERIAL
+    };
+
+    /*! Run on each thread of the tasking system before it executes any
+        task, with the thread's index (0 is the thread which called
+        initTaskingSystem()), e.g. to set up thread local allocators or
+        per-thread state of external libraries. Worker threads of the
+        Internal backend run the hooks as they start, TBB threads as they
+        first join the arena and OpenMP threads in one parallel region at
+        initialization. Denormal flushing and thread affinity requested
+        from initTaskingSystem() are applied the same way, before hooks. */
+    using WorkerInitHook = std::function<void(int threadIndex)>;
+
+    // Hooks are registered process wide and take effect with the next
+    // initTaskingSystem() call; the returned id removes them again
+    int RKCOMMON_INTERFACE addWorkerInitHook(WorkerInitHook hook);
+    void RKCOMMON_INTERFACE removeWorkerInitHook(int id);
+
     void RKCOMMON_INTERFACE initTaskingSystem(int numThreads      = -1,
                                                bool flushDenormals = false);
 
+    void RKCOMMON_INTERFACE
+    initTaskingSystem(int numThreads,
+                      bool flushDenormals,
+                      const AffinitySettings &affinity);
+
+    // Switch to 'backend' and initialize it, throws std::runtime_error if it
+    // is not available in this build. Must not be called while tasks run.
+    void RKCOMMON_INTERFACE
+    initTaskingSystem(TaskingBackend backend,
+                      int numThreads                   = -1,
+                      bool flushDenormals              = false,
+                      const AffinitySettings &affinity = {},
+                      const WaitPolicy &waitPolicy     = {});
+
+    bool RKCOMMON_INTERFACE isTaskingBackendAvailable(TaskingBackend backend);
+
+    TaskingBackend RKCOMMON_INTERFACE currentTaskingBackend();
+
     int RKCOMMON_INTERFACE numTaskingThreads();
 
+    /*! Change the number of threads running tasks, including the calling
+        thread, without restarting the tasking system: tasks in flight
+        finish and queued ones are run by the remaining threads. Between 1
+        and numTaskingThreads(), which stays unchanged; values <= 0 activate
+        all of them again. The Internal backend parks its surplus workers,
+        TBB gets a new max_allowed_parallelism limit and OpenMP, where the
+        setting is per thread, uses it for parallel regions started by the
+        calling thread. Initializes the tasking system if needed. */
+    void RKCOMMON_INTERFACE setActiveThreads(int numThreads);
+
+    int RKCOMMON_INTERFACE activeTaskingThreads();
+
+    // Number of NUMA nodes with CPUs available to this process (at least 1)
+    int RKCOMMON_INTERFACE numNumaNodes();
+
+    // OS id of the NUMA node the calling thread is currently running on, or 0
+    // if unknown. Useful to pick a node for first-touch allocation.
+    int RKCOMMON_INTERFACE currentNumaNode();
+
+    // True if the CPUs available to this process are of more than one type
+    bool RKCOMMON_INTERFACE hasHybridCores();
+
+    // Type of the core the calling thread is currently running on
+    CoreType RKCOMMON_INTERFACE currentCoreType();
+
+    /*! Type of the cores worker 'threadIndex' (see WorkerInitHook) is
+        pinned to by the affinity passed to initTaskingSystem(), UNKNOWN if
+        it is not pinned, or pinned to cores of different types. On hybrid
+        CPUs the Internal backend also cuts loops into proportionally more
+        chunks, so the performance cores take a larger share instead of
+        waiting for the efficiency cores at the end of every loop. */
+    CoreType RKCOMMON_INTERFACE workerCoreType(int threadIndex);
+
   }  // namespace tasking
 }  // namespace rkcommon
@@ -1,16 +1,28 @@
 // Copyright 2023 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
-#include <stack>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
 #include <vector>
 
 #ifdef _WIN32
 #include <process.h>
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#ifdef __APPLE__
+#include <mach/mach.h>
 #endif
 
 // We force the define on here to build the right header
@@ -18,19 +30,176 @@
 // will see the empty defines
 #define RKCOMMON_ENABLE_PROFILING
 #include "Tracing.h"
+#include "rkcommon/memory/malloc.h"
+#include "rkcommon/utility/demangle.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#endif
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include "rkcommon/networking/SocketFabric.h"
+#endif
 
-#define THREAD_EVENT_CHUNK_SIZE 8192
+#ifdef __X86_64__
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#endif
 
 namespace rkcommon {
 namespace tracing {
 
 using namespace std::chrono;
 
+// Trace clock ///////////////////////////////////////////////////////////////
+
+// Events are timestamped with the CPU's time stamp counter where it ticks at
+// a constant rate (the invariant TSC on x86, the generic timer on ARM64),
+// which takes a fraction of the time of steady_clock::now(), and with
+// steady_clock otherwise. The counter rate is calibrated against
+// steady_clock once, when the first timestamp is converted
+class TraceClock
+{
+ public:
+  TraceClock()
+      : useCounter(counterIsInvariant()),
+        startTime(steady_clock::now()),
+        startTicks(readCounter())
+  {}
+
+  // Ticks since the trace clock was created
+  uint64_t now() const
+  {
+    if (useCounter) {
+      return readCounter() - startTicks;
+    }
+    return duration_cast<nanoseconds>(steady_clock::now() - startTime).count();
+  }
+
+  // Nanoseconds since the steady_clock epoch, as in the JSON traces
+  uint64_t toNanoseconds(uint64_t ticks)
+  {
+    return duration_cast<nanoseconds>(startTime.time_since_epoch()).count()
+        + durationNanoseconds(ticks);
+  }
+
+  uint64_t durationNanoseconds(uint64_t ticks)
+  {
+    if (useCounter) {
+      std::call_once(calibrated, [&]() { calibrate(); });
+      return uint64_t(double(ticks) * nsPerTick);
+    }
+    return ticks;
+  }
+
+ private:
+  static bool counterIsInvariant()
+  {
+#ifdef __X86_64__
+    // CPUID.80000007H:EDX[8], the TSC runs at a constant rate in all
+    // P-, C- and T-states
+    unsigned int regs[4] = {};
+#ifdef _MSC_VER
+    __cpuid(reinterpret_cast<int *>(regs), int(0x80000000));
+    if (regs[0] < 0x80000007) {
+      return false;
+    }
+    __cpuid(reinterpret_cast<int *>(regs), int(0x80000007));
+#else
+    __cpuid(0x80000000, regs[0], regs[1], regs[2], regs[3]);
+    if (regs[0] < 0x80000007) {
+      return false;
+    }
+    __cpuid(0x80000007, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    return (regs[3] >> 8) & 1;
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  static uint64_t readCounter()
+  {
+#ifdef __X86_64__
+    return __rdtsc();
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return 0;
+#endif
+  }
+
+  // Measure the counter over at least 50ms since the start for an accurate
+  // rate, which short traces wait for
+  void calibrate()
+  {
+    const auto minElapsed = milliseconds(50);
+    auto elapsed = steady_clock::now() - startTime;
+    if (elapsed < minElapsed) {
+      std::this_thread::sleep_for(minElapsed - elapsed);
+    }
+    elapsed = steady_clock::now() - startTime;
+    const uint64_t ticks = readCounter() - startTicks;
+    nsPerTick = double(duration_cast<nanoseconds>(elapsed).count())
+        / double(std::max<uint64_t>(ticks, 1));
+  }
+
+  const bool useCounter;
+  const steady_clock::time_point startTime;
+  const uint64_t startTicks;
+
+  std::once_flag calibrated;
+  double nsPerTick = 1.0;
+};
+
+// Constructed before the recorder, so that it is there for all events
+static TraceClock traceClock;
+
+// The internString()s, which the elements of the set hold. Like the clock,
+// constructed before the recorder, which writes them out when destroyed
+static std::mutex internedStringsMutex;
+static std::unordered_set<std::string> internedStrings;
+
 static std::unique_ptr<TraceRecorder> traceRecorder =
     rkcommon::make_unique<TraceRecorder>();
 
 static thread_local std::shared_ptr<ThreadEventList> threadEventList = nullptr;
 
+// Begin/end pairs per CPU time sample, 0 for none
+static std::atomic<int> cpuTimeSampling(1);
+
+// Chunks each thread keeps in flight recorder mode, 0 for all
+static std::atomic<size_t> flightRecorderChunks(0);
+
+static std::atomic<TraceMode> traceMode(TraceMode::TIMELINE);
+
+// CPU time is not available on all platforms
+static const uint64_t UNKNOWN_CPU_TIME = ~uint64_t(0);
+
+// The hardware counters threads read, changed by enableHardwareCounters().
+// Threads reopen their counter group when the generation changed
+static std::mutex hardwareCountersMutex;
+static std::vector<HardwareCounter> requestedCounters;
+static std::atomic<uint32_t> hardwareCountersGeneration(0);
+static std::atomic<bool> hardwareCountersEnabled(false);
+
 std::ostream &operator<<(std::ostream &os, const EventType &ty)
 {
   switch (ty) {
@@ -49,346 +218,2413 @@ std::ostream &operator<<(std::ostream &os, const EventType &ty)
   case EventType::COUNTER:
     os << "C";
     break;
+  case EventType::FLOW_BEGIN:
+    os << "s";
+    break;
+  case EventType::FLOW_END:
+    os << "f";
+    break;
   default:
     break;
   }
   return os;
 }
 
-TraceEvent::TraceEvent()
-{
-#ifdef __linux__
-  rusage usage;
-  getrusage(RUSAGE_SELF, &usage);
-  ru_utime = usage.ru_utime;
-  ru_stime = usage.ru_stime;
-#endif
-  time = steady_clock::now();
-}
+static const int TYPE_SHIFT = 56;
+static const uint64_t TICKS_MASK = (uint64_t(1) << TYPE_SHIFT) - 1;
+
+TraceEvent::TraceEvent(const EventType type, const char *n, const char *c)
+    : name(n),
+      category(c),
+      timeAndType((traceClock.now() & TICKS_MASK)
+          | (uint64_t(type) << TYPE_SHIFT))
+{}
+
+TraceEvent::TraceEvent(
+    const EventType type, const char *n, const uint64_t value)
+    : name(n),
+      counterValue(value),
+      timeAndType((traceClock.now() & TICKS_MASK)
+          | (uint64_t(type) << TYPE_SHIFT))
+{}
 
-TraceEvent::TraceEvent(const EventType ty) : TraceEvent()
+EventType TraceEvent::type() const
 {
-  type = ty;
+  return EventType(timeAndType >> TYPE_SHIFT);
 }
 
-TraceEvent::TraceEvent(const EventType type, const char *n, const char *c)
-    : TraceEvent(type)
+uint64_t TraceEvent::ticks() const
 {
-  name = n;
-  category = c;
+  return timeAndType & TICKS_MASK;
 }
 
-TraceEvent::TraceEvent(
-    const EventType type, const char *name, const uint64_t value)
-    : TraceEvent(type, name, nullptr)
+static_assert(sizeof(TraceEvent) <= 24, "TraceEvent should stay compact");
+
+TraceEventChunk::TraceEventChunk() : count(0) {}
+
+const TraceEvent &TraceEventChunk::operator[](uint32_t i) const
 {
-  counterValue = value;
+  return reinterpret_cast<const TraceEvent *>(storage)[i];
 }
 
-void ThreadEventList::beginEvent(const char *name, const char *category)
+// Hardware counters ////////////////////////////////////////////////////////
+
+const char *counterName(HardwareCounter counter)
 {
-  getCurrentEventList().push_back(TraceEvent(
-      EventType::BEGIN, getCachedString(name), getCachedString(category)));
+  switch (counter) {
+  case HardwareCounter::CYCLES:
+    return "cycles";
+  case HardwareCounter::INSTRUCTIONS:
+    return "instructions";
+  case HardwareCounter::LLC_MISSES:
+    return "llcMisses";
+  case HardwareCounter::BRANCH_MISSES:
+    return "branchMisses";
+  case HardwareCounter::PAGE_FAULTS:
+    return "pageFaults";
+  case HardwareCounter::CONTEXT_SWITCHES:
+    return "contextSwitches";
+  default:
+    return "unknown";
+  }
 }
 
-void ThreadEventList::endEvent()
+uint64_t RegionCounters::operator[](HardwareCounter counter) const
 {
-  getCurrentEventList().push_back(TraceEvent(EventType::END));
+  return values[size_t(counter)];
 }
 
-void ThreadEventList::setMarker(const char *name, const char *category)
+double RegionCounters::ipc() const
 {
-  getCurrentEventList().push_back(TraceEvent(
-      EventType::MARKER, getCachedString(name), getCachedString(category)));
+  const uint64_t cycles = (*this)[HardwareCounter::CYCLES];
+  return cycles == 0
+      ? 0.0
+      : double((*this)[HardwareCounter::INSTRUCTIONS]) / double(cycles);
 }
 
-void ThreadEventList::setCounter(const char *name, const uint64_t counterValue)
+// A perf_event_open() group counting the calling thread in user space,
+// read with one system call
+struct ThreadEventList::HardwareCounters
 {
-  getCurrentEventList().push_back(
-      TraceEvent(EventType::COUNTER, getCachedString(name), counterValue));
-}
+  HardwareCounters(const std::vector<HardwareCounter> &counters,
+      uint32_t generation)
+      : generation(generation)
+  {
+#ifdef __linux__
+    for (HardwareCounter counter : counters) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.read_format = PERF_FORMAT_GROUP;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      switch (counter) {
+      case HardwareCounter::CYCLES:
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+      case HardwareCounter::INSTRUCTIONS:
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+      case HardwareCounter::LLC_MISSES:
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+      case HardwareCounter::BRANCH_MISSES:
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+      case HardwareCounter::PAGE_FAULTS:
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+        break;
+      case HardwareCounter::CONTEXT_SWITCHES:
+        // These happen in the kernel
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+        attr.exclude_kernel = 0;
+        break;
+      default:
+        continue;
+      }
+      const int groupFd = fds.empty() ? -1 : fds.front();
+      const int fd =
+          int(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+      if (fd >= 0) {
+        fds.push_back(fd);
+        kinds.push_back(counter);
+      }
+    }
+#else
+    (void)counters;
+#endif
+  }
+
+  ~HardwareCounters()
+  {
+#ifdef __linux__
+    for (int fd : fds) {
+      close(fd);
+    }
+#endif
+  }
+
+  // The values in the order of 'kinds'
+  bool read(uint64_t *values) const
+  {
+#ifdef __linux__
+    if (fds.empty()) {
+      return false;
+    }
+    uint64_t group[1 + size_t(HardwareCounter::COUNT)];
+    const ssize_t size = ::read(fds.front(), group, sizeof(group));
+    if (size < ssize_t(sizeof(uint64_t) * (1 + fds.size()))) {
+      return false;
+    }
+    std::copy(group + 1, group + 1 + fds.size(), values);
+    return true;
+#else
+    (void)values;
+    return false;
+#endif
+  }
+
+  const uint32_t generation;
+  // The group leader first
+  std::vector<int> fds;
+  std::vector<HardwareCounter> kinds;
+};
+
+ThreadEventList::ThreadEventList() = default;
+
+ThreadEventList::~ThreadEventList() = default;
 
-std::vector<TraceEvent> &ThreadEventList::getCurrentEventList()
+bool ThreadEventList::readHardwareCounters(uint64_t *values)
 {
-  if (events.empty() || events.back().size() >= THREAD_EVENT_CHUNK_SIZE) {
-    events.push_back(std::vector<TraceEvent>());
-    events.back().reserve(THREAD_EVENT_CHUNK_SIZE);
+  if (!hardwareCounters
+      || hardwareCounters->generation
+          != hardwareCountersGeneration.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(hardwareCountersMutex);
+    hardwareCounters = rkcommon::make_unique<HardwareCounters>(
+        requestedCounters, hardwareCountersGeneration.load());
   }
-  return events.back();
+  return hardwareCounters->read(values);
 }
 
-const char *ThreadEventList::getCachedString(const char *str)
+void ThreadEventList::recordHardwareCounters(
+    const OpenEvent &open, const uint64_t *values)
 {
-  if (!str) {
-    return nullptr;
+  const std::vector<HardwareCounter> &kinds = hardwareCounters->kinds;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    RegionCounters &region = regionCounters[open.name];
+    region.count++;
+    for (size_t i = 0; i < kinds.size(); ++i) {
+      region.values[size_t(kinds[i])] += values[i] - open.counters[i];
+    }
   }
-  // Lookup string in the uniqueEventNames list, since most strings are likely
-  // to just be static/constant data strings (e.g., rkTraceBeginEvent("X"))
-  // this caching is just based on the pointer and we skip doing more
-  // expensive string comparison. Dynamically generated strings will likely
-  // have different ptrs, though this will be wrong if some memory is
-  // re-used with different text content.
-  auto fnd = stringCache.find(str);
-  if (fnd == stringCache.end()) {
-    auto en = std::make_shared<std::string>(str);
-    stringCache[str] = en;
-    return en->c_str();
+  for (size_t i = 0; i < kinds.size(); ++i) {
+    push(TraceEvent(EventType::HW_COUNTER,
+        counterName(kinds[i]),
+        values[i] - open.counters[i]));
   }
-  return fnd->second->c_str();
 }
 
-std::shared_ptr<ThreadEventList> TraceRecorder::getThreadTraceList(
-    const std::thread::id &id)
+void ThreadEventList::addRegionCounters(
+    std::unordered_map<std::string, RegionCounters> &regions)
 {
-  std::lock_guard<std::mutex> lock(threadTraceMutex);
-  auto fnd = threadTrace.find(id);
-  if (fnd == threadTrace.end()) {
-    auto threadEventList = std::make_shared<ThreadEventList>();
-    threadTrace[id] = threadEventList;
-    return threadEventList;
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &r : regionCounters) {
+    RegionCounters &region = regions[r.first];
+    region.name = r.first;
+    region.count += r.second.count;
+    for (size_t i = 0; i < size_t(HardwareCounter::COUNT); ++i) {
+      region.values[i] += r.second.values[i];
+    }
   }
-  return fnd->second;
 }
 
-void TraceRecorder::saveLog(const char *logFile, const char *processName)
-{
-  std::lock_guard<std::mutex> lock(threadTraceMutex);
-
-  // chrome:://tracing / ui.perfetto.dev takes a JSON array of events, but to
-  // keep dependencies down we don't need a JSON library to produce this simple
-  // format
-  std::ofstream fout(logFile);
+// Event statistics /////////////////////////////////////////////////////////
 
-#ifdef _WIN32
-  const int pid = _getpid();
+static uint32_t log2Floor(uint64_t x)
+{
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanReverse64(&index, x);
+  return uint32_t(index);
 #else
-  const int pid = getpid();
+  return 63 - uint32_t(__builtin_clzll(x));
 #endif
+}
 
-  fout << "[";
+// A histogram of durations in ticks in the manner of HDR histograms: the
+// values of each power of two range are counted in SUB_BUCKETS linear
+// buckets, bounding the relative error by 1 / SUB_BUCKETS
+struct DurationHistogram
+{
+  static const uint32_t SUB_BITS = 4;
+  static const uint32_t SUB_BUCKETS = 1 << SUB_BITS;
+  static const uint32_t NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
 
-  // Emit metadata about the process name
-  if (processName) {
-    // Emit metadata event for the thread's ID/name
-    fout << "{"
-         << "\"ph\": \"M\","
-         << "\"pid\":" << pid << ","
-         << "\"tid\":" << 0 << ","
-         << "\"name\":"
-         << "\"process_name\","
-         << "\"args\":{\"name\":\"" << processName << "\"}"
-         << "},";
+  uint64_t buckets[NUM_BUCKETS] = {};
+
+  static uint32_t bucket(uint64_t value)
+  {
+    if (value < SUB_BUCKETS) {
+      return uint32_t(value);
+    }
+    const uint32_t shift = log2Floor(value) - SUB_BITS;
+    return shift * SUB_BUCKETS + uint32_t(value >> shift);
   }
 
-  // Go through each thread and output its data
-  // We renumber thread IDs here because chrome:://tracing UI doesn't display
-  // the true thread ID numbers well
-  int nextTid = 0;
-  for (const auto &trace : threadTrace) {
-    const std::thread::id tid = trace.first;
-
-    // Emit metadata event for the thread's ID/name
-    fout << "{"
-         << "\"ph\": \"M\","
-         << "\"pid\":" << pid << ","
-         << "\"tid\":" << nextTid << ","
-         << "\"name\":"
-         << "\"thread_name\","
-         << "\"args\":{\"name\":\"";
-    if (!trace.second->threadName.empty()) {
-      fout << trace.second->threadName << "\"}";
-    } else {
-      fout << tid << "\"}";
+  // The middle of the values counted in 'index'
+  static uint64_t value(uint32_t index)
+  {
+    if (index < 2 * SUB_BUCKETS) {
+      return index;
     }
-    fout << "},";
+    const uint32_t shift = index / SUB_BUCKETS - 1;
+    const uint64_t low = uint64_t(index % SUB_BUCKETS + SUB_BUCKETS) << shift;
+    return low + (uint64_t(1) << shift) / 2;
+  }
 
-    // Track the begin events so that when we hit an end we can compute CPU %
-    // and other stats to include
-    std::stack<const TraceEvent *> beginEvents;
-    for (const auto &evtChunk : trace.second->events) {
-      for (const auto &evt : evtChunk) {
-        if (evt.type == EventType::INVALID) {
-          std::cerr << "Got invalid event type!?\n";
-        }
-        if (evt.type == EventType::BEGIN) {
-          beginEvents.push(&evt);
-        }
-        if (evt.type == EventType::END && beginEvents.empty()) {
-          std::cerr << "Tracing Error: Too many rkTraceEndEvent calls!\n";
-          break;
-        }
+  void add(uint64_t value)
+  {
+    buckets[bucket(value)]++;
+  }
 
-        const uint64_t timestamp =
-            std::chrono::duration_cast<std::chrono::microseconds>(
-                evt.time.time_since_epoch())
-                .count();
-
-        fout << "{"
-             << "\"ph\": \"" << evt.type << "\","
-             << "\"pid\":" << pid << ","
-             << "\"tid\":" << nextTid << ","
-             << "\"ts\":" << timestamp << ","
-             << "\"name\":\"" << (evt.name ? evt.name : "") << "\"";
-        if (evt.type != EventType::END && evt.category) {
-          fout << ",\"cat\":\"" << evt.category << "\"";
-        }
+  void merge(const DurationHistogram &other)
+  {
+    for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+      buckets[i] += other.buckets[i];
+    }
+  }
 
-        // Compute CPU utilization % over the begin/end interval for end events
-        float utilization = 0.f;
-        uint64_t duration = 0;
-        const TraceEvent *begin = nullptr;
-        if (evt.type == EventType::END) {
-          begin = beginEvents.top();
-          utilization = cpuUtilization(*begin, evt);
-          duration = std::chrono::duration_cast<std::chrono::microseconds>(
-              evt.time - begin->time)
-                         .count();
-
-          fout << ",\"args\":{\"cpuUtilization\":" << utilization << "}";
-
-          beginEvents.pop();
-        } else if (evt.type == EventType::COUNTER) {
-          fout << ",\"args\":{\"value\":" << evt.counterValue << "}";
-        }
-        fout << "},";
-
-        // For each end event also emit an update of the CPU % utilization
-        // counter for events that were long enough to reasonably measure
-        // utilization. CPU % is emitted at the time of the beginning of the
-        // event to display the counter properly over the interval
-        if (evt.type == EventType::END && duration > 100 && begin) {
-          const uint64_t beginTimestamp =
-              std::chrono::duration_cast<std::chrono::microseconds>(
-                  begin->time.time_since_epoch())
-                  .count();
-
-          fout << "{"
-               << "\"ph\": \"C\","
-               << "\"pid\":" << pid << ","
-               << "\"tid\":" << nextTid << ","
-               << "\"ts\":" << beginTimestamp << ","
-               << "\"name\":\"cpuUtilization\","
-               << "\"cat\":\"builtin\","
-               << "\"args\":{\"value\":" << utilization << "}},";
-        }
+  // The value below which 'fraction' of the 'count' values lie
+  uint64_t percentile(double fraction, uint64_t count) const
+  {
+    const uint64_t rank = std::max<uint64_t>(1, uint64_t(fraction * count));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        return value(i);
       }
     }
-    if (!beginEvents.empty()) {
-      std::cerr << "Tracing Error: Missing end for some events!\n";
-      while (!beginEvents.empty()) {
-        std::cerr << "\t" << beginEvents.top()->name << "\n";
-        beginEvents.pop();
-      }
+    return 0;
+  }
+};
+
+struct ThreadEventList::EventAggregate
+{
+  uint64_t count = 0;
+  uint64_t totalTicks = 0;
+  uint64_t minTicks = ~uint64_t(0);
+  uint64_t maxTicks = 0;
+  // Of the pairs which recorded the CPU time, in microseconds and ticks
+  uint64_t cpuTime = 0;
+  uint64_t cpuTimeTicks = 0;
+  DurationHistogram histogram;
+
+  void add(uint64_t ticks, uint64_t cpu)
+  {
+    count++;
+    totalTicks += ticks;
+    minTicks = std::min(minTicks, ticks);
+    maxTicks = std::max(maxTicks, ticks);
+    if (cpu != UNKNOWN_CPU_TIME) {
+      cpuTime += cpu;
+      cpuTimeTicks += ticks;
     }
-    ++nextTid;
+    histogram.add(ticks);
+  }
+
+  void merge(const EventAggregate &other)
+  {
+    count += other.count;
+    totalTicks += other.totalTicks;
+    minTicks = std::min(minTicks, other.minTicks);
+    maxTicks = std::max(maxTicks, other.maxTicks);
+    cpuTime += other.cpuTime;
+    cpuTimeTicks += other.cpuTimeTicks;
+    histogram.merge(other.histogram);
+  }
+
+  EventStatistics statistics(const std::string &name,
+      const std::string &thread) const
+  {
+    EventStatistics stats;
+    stats.name = name;
+    stats.thread = thread;
+    stats.count = count;
+    stats.totalNs = traceClock.durationNanoseconds(totalTicks);
+    stats.minNs = traceClock.durationNanoseconds(minTicks);
+    stats.maxNs = traceClock.durationNanoseconds(maxTicks);
+    // Within the exact bounds
+    const auto percentile = [&](double fraction) {
+      const uint64_t ticks = std::min(
+          maxTicks, std::max(minTicks, histogram.percentile(fraction, count)));
+      return traceClock.durationNanoseconds(ticks);
+    };
+    stats.p50Ns = percentile(0.5);
+    stats.p99Ns = percentile(0.99);
+    const uint64_t cpuTimeNs = traceClock.durationNanoseconds(cpuTimeTicks);
+    if (cpuTimeNs > 0) {
+      stats.cpuUtilization =
+          float(double(cpuTime) * 1000.0 / double(cpuTimeNs) * 100.0);
+    }
+    return stats;
+  }
+};
+
+uint64_t EventStatistics::meanNs() const
+{
+  return count == 0 ? 0 : totalNs / count;
+}
+
+void ThreadEventList::addStatistics(const OpenEvent &open, uint64_t cpuTime)
+{
+  const uint64_t ticks = traceClock.now() - open.beginTicks;
+  const uint64_t cpu = cpuTime == UNKNOWN_CPU_TIME
+          || open.cpuTime == UNKNOWN_CPU_TIME
+      ? UNKNOWN_CPU_TIME
+      : cpuTime - open.cpuTime;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<EventAggregate> &aggregate = aggregates[open.name];
+  if (!aggregate) {
+    aggregate = rkcommon::make_unique<EventAggregate>();
   }
-  // We need to remove the last , we output to ensure the JSON array is correct
-  // Overwrite it with the ] character.
-  fout.seekp(-1, std::ios::cur);
-  fout << "]";
+  aggregate->add(ticks, cpu);
 }
 
-float cpuUtilization(const TraceEvent &start, const TraceEvent &end)
+// ThreadEventList //////////////////////////////////////////////////////////
+
+// The CPU time of the process in microseconds
+static uint64_t processCpuTime()
 {
 #ifdef __linux__
-  const double elapsed_cpu = end.ru_utime.tv_sec + end.ru_stime.tv_sec
-      - (start.ru_utime.tv_sec + start.ru_stime.tv_sec)
-      + 1e-6f
-          * (end.ru_utime.tv_usec + end.ru_stime.tv_usec
-              - (start.ru_utime.tv_usec + start.ru_stime.tv_usec));
-
-  const double elapsed_wall =
-      duration_cast<duration<double>>(end.time - start.time).count();
-  return elapsed_cpu / elapsed_wall * 100.0;
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return uint64_t(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+      + uint64_t(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
 #else
-  return -1.f;
+  return UNKNOWN_CPU_TIME;
 #endif
 }
 
-std::string getProcStatus()
+void ThreadEventList::beginEvent(const char *name, const char *category)
 {
-  // Note: this file doesn't exist on OS X, would we want some alternative to
-  // fetch this info?
-  std::ifstream file("/proc/self/status");
-  if (!file.is_open()) {
-    return "";
+  beginInternedEvent(getCachedString(name), getCachedString(category));
+}
+
+void ThreadEventList::beginInternedEvent(
+    const char *name, const char *category)
+{
+  const int everyNth = cpuTimeSampling.load(std::memory_order_relaxed);
+  const bool sampled = everyNth > 0 && ++unsampledBegins >= everyNth;
+
+  OpenEvent open;
+  open.name = name;
+  open.cpuTimeSampled = sampled;
+  open.countersRead = false;
+  open.countersGeneration = 0;
+  open.cpuTime = UNKNOWN_CPU_TIME;
+  if (sampled) {
+    unsampledBegins = 0;
+    open.cpuTime = processCpuTime();
+    pushCpuTime(open.cpuTime);
   }
-  return std::string(
-      std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  if (hardwareCountersEnabled.load(std::memory_order_relaxed)) {
+    open.countersRead = readHardwareCounters(open.counters);
+    open.countersGeneration = hardwareCounters->generation;
+  }
+  open.beginTicks = traceClock.now();
+  openEvents.push_back(open);
+  sampledRegion.store(name, std::memory_order_relaxed);
+  push(TraceEvent(EventType::BEGIN, name, category));
 }
 
-void getProcMemUse(uint64_t &virtMem, uint64_t &resMem)
+void ThreadEventList::endEvent()
 {
-  virtMem = 0;
-  resMem = 0;
-#ifdef __linux__
-  // TODO: Windows?
-  FILE *file = std::fopen("/proc/self/statm", "r");
-  if (file) {
-    // These values are measured in pages
-    if (std::fscanf(file, "%lu %lu", &virtMem, &resMem) == 2) {
-      const int pageSize = getpagesize();
-      virtMem *= pageSize;
-      resMem *= pageSize;
+  if (!openEvents.empty()) {
+    const OpenEvent &open = openEvents.back();
+    if (traceMode.load(std::memory_order_relaxed) != TraceMode::TIMELINE) {
+      addStatistics(
+          open, open.cpuTimeSampled ? processCpuTime() : UNKNOWN_CPU_TIME);
     }
-    std::fclose(file);
+    // Read the counters first, to leave the rest out of them
+    uint64_t counters[size_t(HardwareCounter::COUNT)];
+    const bool countersRead = open.countersRead
+        && readHardwareCounters(counters)
+        && hardwareCounters->generation == open.countersGeneration;
+    if (open.cpuTimeSampled) {
+      recordCpuTime();
+    }
+    if (countersRead) {
+      recordHardwareCounters(open, counters);
+    }
+    openEvents.pop_back();
+    sampledRegion.store(currentRegion(), std::memory_order_relaxed);
   }
-#endif
+  push(TraceEvent(EventType::END, nullptr, nullptr));
 }
 
-void initThreadEventList()
+void ThreadEventList::setMarker(const char *name, const char *category)
 {
-  if (!threadEventList) {
-    threadEventList =
-        traceRecorder->getThreadTraceList(std::this_thread::get_id());
-  }
+  push(TraceEvent(
+      EventType::MARKER, getCachedString(name), getCachedString(category)));
 }
 
-void beginEvent(const char *name, const char *category)
+void ThreadEventList::setCounter(const char *name, const uint64_t counterValue)
 {
-  initThreadEventList();
-  threadEventList->beginEvent(name, category);
+  push(TraceEvent(EventType::COUNTER, getCachedString(name), counterValue));
 }
 
-void endEvent()
+void ThreadEventList::setFlow(EventType type, const char *name, uint64_t id)
 {
-  // Begin takes care of getting the threadEventList set
-  // in thread_local storage so we can assume it exists here
-  threadEventList->endEvent();
+  push(TraceEvent(type, getCachedString(name), id));
 }
 
-void setMarker(const char *name, const char *category)
+const char *ThreadEventList::currentRegion() const
 {
-  initThreadEventList();
-  threadEventList->setMarker(name, category);
+  return openEvents.empty() ? nullptr : openEvents.back().name;
 }
 
-void setCounter(const char *name, uint64_t value)
+void ThreadEventList::setThreadName(const char *name)
 {
-  initThreadEventList();
-  threadEventList->setCounter(name, value);
+  std::lock_guard<std::mutex> lock(mutex);
+  threadName = name;
 }
 
-void recordMemUse()
+void ThreadEventList::recordCpuTime()
 {
-  initThreadEventList();
-  uint64_t virtMem = 0;
-  uint64_t resMem = 0;
-  getProcMemUse(virtMem, resMem);
+  pushCpuTime(processCpuTime());
+}
 
-  threadEventList->setCounter("rkTraceVirtMem_B", virtMem);
-  threadEventList->setCounter("rkTraceRssMem_B", resMem);
+void ThreadEventList::pushCpuTime(uint64_t cpuTime)
+{
+  if (cpuTime != UNKNOWN_CPU_TIME) {
+    push(TraceEvent(EventType::CPU_TIME, nullptr, cpuTime));
+  }
 }
 
-void setThreadName(const char *name)
+void ThreadEventList::push(const TraceEvent &event)
 {
-  initThreadEventList();
-  threadEventList->threadName = name;
+  if (traceMode.load(std::memory_order_relaxed) == TraceMode::STATISTICS) {
+    return;
+  }
+  uint32_t n = current ? current->count.load(std::memory_order_relaxed)
+                       : TraceEventChunk::SIZE;
+  if (n == TraceEventChunk::SIZE) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<TraceEventChunk> chunk;
+    const size_t maxChunks =
+        flightRecorderChunks.load(std::memory_order_relaxed);
+    if (maxChunks > 0 && chunks.size() >= maxChunks) {
+      // Reuse the oldest chunk for the flight recorder
+      chunk = std::move(chunks.front());
+      chunks.pop_front();
+      chunk->count.store(0, std::memory_order_relaxed);
+      chunk->written = 0;
+    } else if (!freeChunks.empty()) {
+      chunk = std::move(freeChunks.back());
+      freeChunks.pop_back();
+      chunk->count.store(0, std::memory_order_relaxed);
+      chunk->written = 0;
+    } else {
+      chunk = rkcommon::make_unique<TraceEventChunk>();
+    }
+    current = chunk.get();
+    chunks.push_back(std::move(chunk));
+    n = 0;
+  }
+  new (current->storage + n * sizeof(TraceEvent)) TraceEvent(event);
+  // Publish the event to a running trace stream
+  current->count.store(n + 1, std::memory_order_release);
 }
 
-void saveLog(const char *logFile, const char *processName)
+const char *ThreadEventList::getCachedString(const char *str)
 {
-  traceRecorder->saveLog(logFile, processName);
+  if (!str) {
+    return nullptr;
+  }
+  // Lookup string in the uniqueEventNames list, since most strings are likely
+  // to just be static/constant data strings (e.g., rkTraceBeginEvent("X"))
+  // this caching is just based on the pointer and we skip doing more
+  // expensive string comparison. Dynamically generated strings will likely
+  // have different ptrs, though this will be wrong if some memory is
+  // re-used with different text content.
+  auto fnd = stringCache.find(str);
+  if (fnd == stringCache.end()) {
+    const char *interned = internString(str);
+    stringCache[str] = interned;
+    return interned;
+  }
+  return fnd->second;
+}
+
+// The samples of the sampling profiler: the thread writes them from its
+// signal handler or while suspended, so it never allocates or locks, while
+// copySamples() reads them as a seqlock, dropping what may have been
+// overwritten meanwhile
+struct ThreadEventList::SampleBuffer
+{
+  explicit SampleBuffer(size_t size) : samples(size) {}
+
+  std::vector<Sample> samples;
+  // Samples recorded so far, of which the last samples.size() are held
+  std::atomic<uint64_t> count{0};
+};
+
+void ThreadEventList::recordSample(uintptr_t ip)
+{
+  SampleBuffer *buffer = sampleBuffer.get();
+  if (!buffer) {
+    return;
+  }
+  const uint64_t i = buffer->count.load(std::memory_order_relaxed);
+  Sample &sample = buffer->samples[i % buffer->samples.size()];
+  sample.ticks = traceClock.now();
+  sample.ip = ip;
+  sample.region = sampledRegion.load(std::memory_order_relaxed);
+  buffer->count.store(i + 1, std::memory_order_release);
+}
+
+void ThreadEventList::reserveSamples(size_t size)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!sampleBuffer || sampleBuffer->samples.size() != size) {
+    sampleBuffer =
+        rkcommon::make_unique<SampleBuffer>(std::max<size_t>(1, size));
+  }
+}
+
+void ThreadEventList::copySamples(std::vector<Sample> &out) const
+{
+  const SampleBuffer *buffer = sampleBuffer.get();
+  if (!buffer) {
+    return;
+  }
+  const uint64_t size = buffer->samples.size();
+  const uint64_t end = buffer->count.load(std::memory_order_acquire);
+  const uint64_t begin = end > size ? end - size : 0;
+  const size_t first = out.size();
+  for (uint64_t i = begin; i < end; ++i) {
+    out.push_back(buffer->samples[i % size]);
+  }
+
+  // The sample being written reuses the slot of the oldest one
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t now = buffer->count.load(std::memory_order_relaxed);
+  const uint64_t valid = now + 1 > size ? now + 1 - size : 0;
+  if (valid > begin) {
+    const uint64_t dropped = std::min(valid, end) - begin;
+    out.erase(out.begin() + first, out.begin() + first + size_t(dropped));
+  }
+}
+
+// Function names of instruction pointers, resolved once per address
+class Symbolizer
+{
+ public:
+  const std::string &name(uintptr_t ip)
+  {
+    auto fnd = names.find(ip);
+    if (fnd == names.end()) {
+      fnd = names.emplace(ip, resolve(ip)).first;
+    }
+    return fnd->second;
+  }
+
+ private:
+  static std::string hex(uintptr_t value)
+  {
+    std::ostringstream text;
+    text << "0x" << std::hex << value;
+    return text.str();
+  }
+
+  static std::string moduleOffset(const char *path, uintptr_t offset)
+  {
+    const char *name = path;
+    for (const char *c = path; *c; ++c) {
+      if (*c == '/' || *c == '\\') {
+        name = c + 1;
+      }
+    }
+    return std::string(name) + "+" + hex(offset);
+  }
+
+  // The exported symbol, else the module and the offset into it
+  static std::string resolve(uintptr_t ip)
+  {
+#ifdef _WIN32
+    HMODULE module = nullptr;
+    char path[MAX_PATH];
+    if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS
+                | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+            reinterpret_cast<LPCSTR>(ip),
+            &module)
+        && GetModuleFileNameA(module, path, sizeof(path)) > 0) {
+      return moduleOffset(path, ip - uintptr_t(module));
+    }
+#else
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void *>(ip), &info) != 0) {
+      if (info.dli_sname) {
+        return utility::demangle(info.dli_sname);
+      }
+      if (info.dli_fname) {
+        return moduleOffset(info.dli_fname, ip - uintptr_t(info.dli_fbase));
+      }
+    }
+#endif
+    return hex(ip);
+  }
+
+  std::unordered_map<uintptr_t, std::string> names;
+};
+
+// Chrome JSON output ////////////////////////////////////////////////////////
+
+static std::string escaped(const std::string &text);
+
+// An event as the Chrome JSON writer needs it, from memory or from a binary
+// trace. Times are in nanoseconds
+struct JsonEvent
+{
+  EventType type;
+  const char *name;
+  const char *category;
+  uint64_t time;
+  uint64_t cpuTime;
+  uint64_t counterValue;
+};
+
+// Convert 'evt', returning false for CPU_TIME events: their time is kept in
+// 'cpuTime' for the next event, which takes it
+static bool toJsonEvent(
+    const TraceEvent &evt, uint64_t &cpuTime, JsonEvent &json)
+{
+  if (evt.type() == EventType::CPU_TIME) {
+    cpuTime = 1000 * evt.counterValue;
+    return false;
+  }
+  json.type = evt.type();
+  json.name = evt.name;
+  // These hold a value in place of the category
+  const bool hasValue = json.type == EventType::COUNTER
+      || json.type == EventType::FLOW_BEGIN || json.type == EventType::FLOW_END
+      || json.type == EventType::HW_COUNTER;
+  json.category = hasValue ? nullptr : evt.category;
+  json.time = traceClock.toNanoseconds(evt.ticks());
+  json.counterValue = hasValue ? evt.counterValue : 0;
+  // Hardware counters come between the CPU time and its end event
+  json.cpuTime = UNKNOWN_CPU_TIME;
+  if (json.type != EventType::HW_COUNTER) {
+    std::swap(json.cpuTime, cpuTime);
+  }
+  return true;
+}
+
+// The events of a thread which the next ones refer to
+struct JsonThreadState
+{
+  // Open events, for the CPU utilization at their end
+  std::vector<JsonEvent> beginEvents;
+  // The HW_COUNTER events for the next end event, by counter name
+  std::vector<std::pair<const char *, uint64_t>> counters;
+  // Events a live trace dropped so far
+  uint64_t dropped = 0;
+};
+
+// chrome:://tracing / ui.perfetto.dev takes a JSON array of events, but to
+// keep dependencies down we don't need a JSON library to produce this simple
+// format
+class ChromeJsonWriter
+{
+ public:
+  ChromeJsonWriter(std::ostream &out, int pid) : out(out), pid(pid)
+  {
+    out << "[";
+  }
+
+  void finish()
+  {
+    out << "]";
+  }
+
+  void processName(const char *name)
+  {
+    next() << "{"
+           << "\"ph\": \"M\","
+           << "\"pid\":" << pid << ","
+           << "\"tid\":" << 0 << ","
+           << "\"name\":"
+           << "\"process_name\","
+           << "\"args\":{\"name\":\"" << name << "\"}"
+           << "}";
+  }
+
+  void threadName(int tid, const std::string &name)
+  {
+    next() << "{"
+           << "\"ph\": \"M\","
+           << "\"pid\":" << pid << ","
+           << "\"tid\":" << tid << ","
+           << "\"name\":"
+           << "\"thread_name\","
+           << "\"args\":{\"name\":\"" << name << "\"}"
+           << "}";
+  }
+
+  // A sample of the sampling profiler, as an instant event of the thread
+  void sample(int tid,
+      uint64_t time,
+      const std::string &function,
+      const char *region,
+      uintptr_t ip)
+  {
+    next() << "{"
+           << "\"ph\": \"i\","
+           << "\"s\":\"t\","
+           << "\"pid\":" << pid << ","
+           << "\"tid\":" << tid << ","
+           << "\"ts\":" << time / 1000 << ","
+           << "\"name\":\"" << escaped(function) << "\","
+           << "\"cat\":\"sample\","
+           << "\"args\":{\"region\":\"" << (region ? region : "")
+           << "\",\"ip\":\"0x" << std::hex << ip << std::dec << "\"}}";
+  }
+
+  // Write the event of thread 'tid', tracking its state in 'thread'.
+  // Returns false for an end event without a begin
+  bool event(int tid, JsonThreadState &thread, const JsonEvent &evt)
+  {
+    if (evt.type == EventType::INVALID) {
+      std::cerr << "Got invalid event type!?\n";
+    }
+    if (evt.type == EventType::HW_COUNTER) {
+      thread.counters.emplace_back(evt.name, evt.counterValue);
+      return true;
+    }
+    if (evt.type == EventType::END && thread.beginEvents.empty()) {
+      std::cerr << "Tracing Error: Too many rkTraceEndEvent calls!\n";
+      return false;
+    }
+
+    next() << "{"
+           << "\"ph\": \"" << evt.type << "\","
+           << "\"pid\":" << pid << ","
+           << "\"tid\":" << tid << ","
+           << "\"ts\":" << evt.time / 1000 << ","
+           << "\"name\":\"" << (evt.name ? evt.name : "") << "\"";
+    if (evt.type != EventType::END && evt.category) {
+      out << ",\"cat\":\"" << evt.category << "\"";
+    }
+
+    // Compute CPU utilization % over the begin/end interval for end events,
+    // when both recorded the CPU time, and list the hardware counters
+    if (evt.type == EventType::END) {
+      const JsonEvent begin = thread.beginEvents.back();
+      thread.beginEvents.pop_back();
+      const bool utilizationKnown = evt.cpuTime != UNKNOWN_CPU_TIME
+          && begin.cpuTime != UNKNOWN_CPU_TIME && evt.time > begin.time;
+      const float utilization = !utilizationKnown
+          ? 0.f
+          : float(double(evt.cpuTime - begin.cpuTime)
+              / double(evt.time - begin.time) * 100.0);
+
+      bool hasArgs = false;
+      auto arg = [&](const char *name) -> std::ostream & {
+        out << (hasArgs ? "," : ",\"args\":{") << "\"" << name << "\":";
+        hasArgs = true;
+        return out;
+      };
+      if (utilizationKnown) {
+        arg("cpuUtilization") << utilization;
+      }
+      uint64_t cycles = 0;
+      uint64_t instructions = 0;
+      for (const auto &counter : thread.counters) {
+        arg(counter.first) << counter.second;
+        if (std::strcmp(counter.first, "cycles") == 0) {
+          cycles = counter.second;
+        } else if (std::strcmp(counter.first, "instructions") == 0) {
+          instructions = counter.second;
+        }
+      }
+      if (cycles > 0 && instructions > 0) {
+        arg("IPC") << double(instructions) / double(cycles);
+      }
+      thread.counters.clear();
+      out << (hasArgs ? "}}" : "}");
+
+      // For each end event also emit an update of the CPU % utilization
+      // counter for events that were long enough to reasonably measure
+      // utilization. CPU % is emitted at the time of the beginning of the
+      // event to display the counter properly over the interval
+      const uint64_t duration = (evt.time - begin.time) / 1000;
+      if (utilizationKnown && duration > 100) {
+        next() << "{"
+               << "\"ph\": \"C\","
+               << "\"pid\":" << pid << ","
+               << "\"tid\":" << tid << ","
+               << "\"ts\":" << begin.time / 1000 << ","
+               << "\"name\":\"cpuUtilization\","
+               << "\"cat\":\"builtin\","
+               << "\"args\":{\"value\":" << utilization << "}}";
+      }
+      return true;
+    }
+
+    if (evt.type == EventType::COUNTER) {
+      out << ",\"args\":{\"value\":" << evt.counterValue << "}";
+    }
+    if (evt.type == EventType::FLOW_BEGIN || evt.type == EventType::FLOW_END) {
+      out << ",\"cat\":\"flow\",\"id\":" << evt.counterValue;
+      // Bind the end to the enclosing event rather than the next one
+      if (evt.type == EventType::FLOW_END) {
+        out << ",\"bp\":\"e\"";
+      }
+    }
+    out << "}";
+
+    // Track the begin events so that when we hit an end we can compute CPU %
+    // and other stats to include
+    if (evt.type == EventType::BEGIN) {
+      thread.beginEvents.push_back(evt);
+    }
+    return true;
+  }
+
+ private:
+  // The stream, after the separator from the previous element
+  std::ostream &next()
+  {
+    if (!first) {
+      out << ",";
+    }
+    first = false;
+    return out;
+  }
+
+  std::ostream &out;
+  const int pid;
+  bool first = true;
+};
+
+static void reportMissingEnds(const std::vector<JsonEvent> &beginEvents)
+{
+  if (!beginEvents.empty()) {
+    std::cerr << "Tracing Error: Missing end for some events!\n";
+    for (auto evt = beginEvents.rbegin(); evt != beginEvents.rend(); ++evt) {
+      std::cerr << "\t" << (evt->name ? evt->name : "") << "\n";
+    }
+  }
+}
+
+static int processId()
+{
+#ifdef _WIN32
+  return _getpid();
+#else
+  return getpid();
+#endif
+}
+
+static std::string threadLabel(
+    const std::thread::id &id, ThreadEventList &list)
+{
+  std::lock_guard<std::mutex> lock(list.mutex);
+  if (!list.threadName.empty()) {
+    return list.threadName;
+  }
+  std::ostringstream label;
+  label << id;
+  return label.str();
+}
+
+// TraceRecorder /////////////////////////////////////////////////////////////
+
+TraceRecorder::TraceRecorder() = default;
+
+TraceRecorder::~TraceRecorder()
+{
+  stopStream();
+  ThreadTrace *trace = threadTraces.load(std::memory_order_acquire);
+  while (trace) {
+    ThreadTrace *next = trace->next;
+    delete trace;
+    trace = next;
+  }
+}
+
+std::shared_ptr<ThreadEventList> TraceRecorder::getThreadTraceList(
+    const std::thread::id &id)
+{
+  // Each thread gets a list of its own, also when it reuses the ID of an
+  // exited one, whose list may end in the middle of an event
+  ThreadTrace *trace = new ThreadTrace;
+  trace->id = id;
+  trace->list = std::make_shared<ThreadEventList>();
+  trace->next = threadTraces.load(std::memory_order_relaxed);
+  while (!threadTraces.compare_exchange_weak(trace->next,
+      trace,
+      std::memory_order_release,
+      std::memory_order_acquire)) {
+  }
+  return trace->list;
+}
+
+void TraceRecorder::saveLog(const char *logFile, const char *processName)
+{
+  writeJson(logFile, processName, false);
+}
+
+void TraceRecorder::dumpRecent(const char *logFile, const char *processName)
+{
+  writeJson(logFile, processName, true);
+}
+
+std::vector<RegionCounters> TraceRecorder::regionCounterSummary()
+{
+  std::unordered_map<std::string, RegionCounters> regions;
+  {
+    for (ThreadTrace *trace = threadTraces.load(std::memory_order_acquire);
+         trace;
+         trace = trace->next) {
+      trace->list->addRegionCounters(regions);
+    }
+  }
+
+  std::vector<RegionCounters> summary;
+  for (auto &region : regions) {
+    summary.push_back(std::move(region.second));
+  }
+  std::sort(summary.begin(),
+      summary.end(),
+      [](const RegionCounters &a, const RegionCounters &b) {
+        return a[HardwareCounter::CYCLES] > b[HardwareCounter::CYCLES];
+      });
+  return summary;
+}
+
+std::vector<SampleHotSpot> TraceRecorder::sampleHotSpots()
+{
+  // Copied first, as resolving the functions takes a while
+  std::vector<ThreadEventList::Sample> samples;
+  for (ThreadTrace *trace = threadTraces.load(std::memory_order_acquire);
+       trace;
+       trace = trace->next) {
+    std::lock_guard<std::mutex> lock(trace->list->mutex);
+    trace->list->copySamples(samples);
+  }
+
+  Symbolizer symbols;
+  std::map<std::pair<std::string, std::string>, uint64_t> counts;
+  for (const auto &sample : samples) {
+    ++counts[std::make_pair(
+        symbols.name(sample.ip), sample.region ? sample.region : "")];
+  }
+
+  std::vector<SampleHotSpot> hotSpots;
+  for (const auto &count : counts) {
+    SampleHotSpot hotSpot;
+    hotSpot.function = count.first.first;
+    hotSpot.region = count.first.second;
+    hotSpot.count = count.second;
+    hotSpots.push_back(std::move(hotSpot));
+  }
+  std::stable_sort(hotSpots.begin(),
+      hotSpots.end(),
+      [](const SampleHotSpot &a, const SampleHotSpot &b) {
+        return a.count > b.count;
+      });
+  return hotSpots;
+}
+
+std::vector<EventStatistics> TraceRecorder::getStats(bool perThread)
+{
+  std::vector<EventStatistics> stats;
+  std::unordered_map<std::string, ThreadEventList::EventAggregate> merged;
+  {
+    for (ThreadTrace *trace = threadTraces.load(std::memory_order_acquire);
+         trace;
+         trace = trace->next) {
+      ThreadEventList &list = *trace->list;
+      const std::string thread =
+          perThread ? threadLabel(trace->id, list) : std::string();
+      std::lock_guard<std::mutex> listLock(list.mutex);
+      for (const auto &aggregate : list.aggregates) {
+        if (perThread) {
+          stats.push_back(
+              aggregate.second->statistics(aggregate.first, thread));
+        } else {
+          merged[aggregate.first].merge(*aggregate.second);
+        }
+      }
+    }
+  }
+  for (const auto &aggregate : merged) {
+    stats.push_back(aggregate.second.statistics(aggregate.first, ""));
+  }
+
+  std::sort(stats.begin(),
+      stats.end(),
+      [](const EventStatistics &a, const EventStatistics &b) {
+        return a.totalNs > b.totalNs;
+      });
+  return stats;
+}
+
+void TraceRecorder::resetStats()
+{
+  for (ThreadTrace *trace = threadTraces.load(std::memory_order_acquire);
+       trace;
+       trace = trace->next) {
+    std::lock_guard<std::mutex> listLock(trace->list->mutex);
+    trace->list->aggregates.clear();
+  }
+}
+
+void TraceRecorder::setFlightRecorder(size_t eventsPerThread)
+{
+  if (eventsPerThread > 0 && stream) {
+    throw std::runtime_error(
+        "the flight recorder cannot run along with a trace stream");
+  }
+  // One more chunk than the events need, as the last one is being filled
+  const size_t chunks = eventsPerThread == 0
+      ? 0
+      : (eventsPerThread + TraceEventChunk::SIZE - 1) / TraceEventChunk::SIZE
+          + 1;
+  flightRecorderChunks.store(chunks, std::memory_order_relaxed);
+}
+
+void TraceRecorder::writeJson(
+    const char *logFile, const char *processName, bool recent)
+{
+  std::lock_guard<std::mutex> lock(threadTraceMutex);
+
+  std::ofstream fout(logFile);
+  ChromeJsonWriter json(fout, processId());
+
+  // Emit metadata about the process name
+  if (processName) {
+    json.processName(processName);
+  }
+
+  // Go through each thread and output its data
+  // We renumber thread IDs here because chrome:://tracing UI doesn't display
+  // the true thread ID numbers well
+  int nextTid = 0;
+  Symbolizer symbols;
+  std::vector<ThreadEventList::Sample> samples;
+  for (ThreadTrace *trace = threadTraces.load(std::memory_order_acquire);
+       trace;
+       trace = trace->next) {
+    ThreadEventList &list = *trace->list;
+    json.threadName(nextTid, threadLabel(trace->id, list));
+
+    // Holding the lock keeps the thread from reusing the chunks
+    std::lock_guard<std::mutex> listLock(list.mutex);
+    JsonThreadState state;
+    uint64_t cpuTime = UNKNOWN_CPU_TIME;
+    JsonEvent evt;
+    bool valid = true;
+    for (const auto &chunk : list.chunks) {
+      const uint32_t n = chunk->count.load(std::memory_order_acquire);
+      for (uint32_t i = 0; i < n && valid; ++i) {
+        if (!toJsonEvent((*chunk)[i], cpuTime, evt)) {
+          continue;
+        }
+        // Recent events may start with the ends of dropped begins, and
+        // end with events still running
+        if (recent && evt.type == EventType::END
+            && state.beginEvents.empty()) {
+          state.counters.clear();
+          continue;
+        }
+        valid = json.event(nextTid, state, evt);
+      }
+    }
+    if (!recent) {
+      reportMissingEnds(state.beginEvents);
+    }
+
+    samples.clear();
+    list.copySamples(samples);
+    for (const auto &sample : samples) {
+      json.sample(nextTid,
+          traceClock.toNanoseconds(sample.ticks),
+          symbols.name(sample.ip),
+          sample.region,
+          sample.ip);
+    }
+    ++nextTid;
+  }
+  json.finish();
+}
+
+// Binary trace format ///////////////////////////////////////////////////////
+
+static const char TRACE_MAGIC[8] = {'R', 'K', 'T', 'R', 'A', 'C', 'E', '1'};
+
+enum class TraceRecordKind : uint8_t
+{
+  STRING = 1,
+  THREAD = 2,
+  EVENTS = 3,
+  // Events of a thread which a live trace left out
+  DROPPED = 4
+};
+
+// An event in the binary trace; strings are IDs of earlier string records,
+// 0 for none
+struct TraceRecord
+{
+  uint64_t time;
+  uint64_t cpuTime;
+  uint64_t counterValue;
+  uint32_t name;
+  uint32_t category;
+  uint8_t type;
+  uint8_t padding[7];
+};
+
+static_assert(sizeof(TraceRecord) == 40, "unexpected TraceRecord padding");
+
+template <typename T>
+static void writeRaw(std::ostream &out, const T &value)
+{
+  out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static void writeString(std::ostream &out, const std::string &str)
+{
+  writeRaw(out, uint32_t(str.size()));
+  out.write(str.data(), str.size());
+}
+
+template <typename T>
+static bool readRaw(std::istream &in, T &value)
+{
+  return bool(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+static bool readString(std::istream &in, std::string &str)
+{
+  uint32_t size = 0;
+  if (!readRaw(in, size)) {
+    return false;
+  }
+  str.resize(size);
+  return size == 0 || bool(in.read(&str[0], size));
+}
+
+// Events live traces dropped since they started
+static std::atomic<uint64_t> droppedLiveEvents(0);
+
+// The most a live trace buffers for a slow connection before it drops events
+static const size_t MAX_LIVE_PENDING = 4 << 20;
+
+struct TraceRecorder::TraceStream
+{
+  // The trace file, or the records not yet sent over a live connection
+  std::unique_ptr<std::ostream> out;
+  std::chrono::milliseconds interval;
+
+  // The connection of a live trace, -1 once closed
+  bool live = false;
+  int socket = -1;
+  std::string pending;
+
+  ~TraceStream()
+  {
+#ifndef _WIN32
+    if (socket >= 0) {
+      ::close(socket);
+    }
+#endif
+  }
+
+  // Whether the events of the flush are to be dropped, as the connection did
+  // not keep up
+  bool full() const
+  {
+    return live
+        && (socket < 0
+            || pending.size() + size_t(out->tellp()) >= MAX_LIVE_PENDING);
+  }
+
+  // Send what the connection takes without blocking or, when 'finishing',
+  // all of it, giving up on a viewer which takes nothing for a second
+  void send(bool finishing)
+  {
+    if (!live) {
+      return;
+    }
+#ifndef _WIN32
+    auto &buffer = static_cast<std::ostringstream &>(*out);
+    if (socket >= 0) {
+      pending += buffer.str();
+    }
+    buffer.str("");
+
+    int flags = finishing ? 0 : MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+    flags |= MSG_NOSIGNAL;
+#endif
+    size_t sent = 0;
+    while (socket >= 0 && sent < pending.size()) {
+      const ssize_t n = ::send(
+          socket, pending.data() + sent, pending.size() - sent, flags);
+      if (n > 0) {
+        sent += size_t(n);
+      } else if (n < 0 && errno == EINTR) {
+        continue;
+      } else if (n < 0 && !finishing
+          && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      } else {
+        std::cerr << "Tracing Warning: closing the live trace ("
+                  << std::strerror(errno) << ")\n";
+        ::close(socket);
+        socket = -1;
+      }
+    }
+    pending.erase(0, sent);
+#else
+    (void)finishing;
+#endif
+  }
+
+  // String IDs by the cached string pointers of the ThreadEventLists, which
+  // stay valid as long as the recorder
+  std::unordered_map<const char *, uint32_t> stringIds;
+
+  struct Thread
+  {
+    uint32_t index;
+    std::string name;
+    // Of a CPU_TIME event for the next event, in an earlier flush
+    uint64_t cpuTime = UNKNOWN_CPU_TIME;
+  };
+  std::unordered_map<const ThreadEventList *, Thread> threads;
+
+  // Serializes flushes, held while they run
+  std::mutex flushMutex;
+
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  bool stop = false;
+  std::thread thread;
+
+  uint32_t stringId(const char *str)
+  {
+    if (!str) {
+      return 0;
+    }
+    auto fnd = stringIds.find(str);
+    if (fnd != stringIds.end()) {
+      return fnd->second;
+    }
+    const uint32_t id = uint32_t(stringIds.size() + 1);
+    stringIds[str] = id;
+    writeRaw(*out, TraceRecordKind::STRING);
+    writeRaw(*out, id);
+    writeString(*out, str);
+    return id;
+  }
+
+  // Convert 'evt' of 'thread', returning false for CPU_TIME events
+  bool record(const TraceEvent &evt, Thread &thread, TraceRecord &record)
+  {
+    JsonEvent json;
+    if (!toJsonEvent(evt, thread.cpuTime, json)) {
+      return false;
+    }
+    record = {};
+    record.time = json.time;
+    record.cpuTime = json.cpuTime;
+    record.counterValue = json.counterValue;
+    record.name = stringId(json.name);
+    record.category = stringId(json.category);
+    record.type = uint8_t(json.type);
+    return true;
+  }
+};
+
+void TraceRecorder::startStream(const char *traceFile,
+    const char *processName,
+    std::chrono::milliseconds interval)
+{
+  stopStream();
+  if (flightRecorderChunks.load(std::memory_order_relaxed) > 0) {
+    throw std::runtime_error(
+        "a trace stream cannot run along with the flight recorder");
+  }
+
+  auto newStream = rkcommon::make_unique<TraceStream>();
+  newStream->out = rkcommon::make_unique<std::ofstream>(
+      traceFile, std::ios::binary);
+  if (!*newStream->out) {
+    throw std::runtime_error(
+        std::string("cannot open trace stream ") + traceFile);
+  }
+  newStream->interval = interval;
+  runStream(std::move(newStream), processName);
+}
+
+void TraceRecorder::startLiveStream(const char *address,
+    const char *processName,
+    std::chrono::milliseconds interval)
+{
+  stopStream();
+  if (flightRecorderChunks.load(std::memory_order_relaxed) > 0) {
+    throw std::runtime_error(
+        "a live trace cannot run along with the flight recorder");
+  }
+#ifdef _WIN32
+  (void)address;
+  (void)processName;
+  (void)interval;
+  throw std::runtime_error("live traces are not supported on Windows");
+#else
+  auto newStream = rkcommon::make_unique<TraceStream>();
+  newStream->out = rkcommon::make_unique<std::ostringstream>();
+  newStream->live = true;
+  newStream->socket = networking::connectSocket(address);
+  newStream->interval = interval;
+  // Bounds the wait for the rest of the trace when stopped
+  timeval timeout = {1, 0};
+  setsockopt(newStream->socket,
+      SOL_SOCKET,
+      SO_SNDTIMEO,
+      &timeout,
+      sizeof(timeout));
+  droppedLiveEvents.store(0, std::memory_order_relaxed);
+  runStream(std::move(newStream), processName);
+#endif
+}
+
+void TraceRecorder::runStream(
+    std::unique_ptr<TraceStream> newStream, const char *processName)
+{
+  std::ostream &out = *newStream->out;
+  out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  writeRaw(out, int32_t(processId()));
+  writeString(out, processName ? processName : "");
+
+  stream = std::move(newStream);
+  TraceStream *s = stream.get();
+  s->thread = std::thread([this, s]() {
+    std::unique_lock<std::mutex> lock(s->wakeMutex);
+    while (!s->stop) {
+      s->wake.wait_for(lock, s->interval);
+      lock.unlock();
+      flushStream();
+      lock.lock();
+    }
+  });
+}
+
+void TraceRecorder::stopStream()
+{
+  if (!stream) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(stream->wakeMutex);
+    stream->stop = true;
+  }
+  stream->wake.notify_all();
+  stream->thread.join();
+  flushStream();
+  stream->send(true);
+  stream.reset();
+}
+
+void TraceRecorder::flushStream()
+{
+  std::lock_guard<std::mutex> flushLock(stream->flushMutex);
+  TraceStream &s = *stream;
+
+  std::vector<TraceRecord> records;
+  std::vector<TraceEventChunk *> chunks;
+  for (ThreadTrace *trace = threadTraces.load(std::memory_order_acquire);
+       trace;
+       trace = trace->next) {
+    ThreadEventList &list = *trace->list;
+
+    // Thread records, again when the thread was renamed
+    auto fnd = s.threads.find(&list);
+    if (fnd == s.threads.end()) {
+      TraceStream::Thread thread;
+      thread.index = uint32_t(s.threads.size());
+      fnd = s.threads.emplace(&list, thread).first;
+    }
+    const std::string name = threadLabel(trace->id, list);
+    if (name != fnd->second.name) {
+      fnd->second.name = name;
+      writeRaw(*s.out, TraceRecordKind::THREAD);
+      writeRaw(*s.out, fnd->second.index);
+      writeString(*s.out, name);
+    }
+
+    // The chunks are written without holding the lock, the owning thread
+    // only appends to the last one and to the list
+    {
+      std::lock_guard<std::mutex> lock(list.mutex);
+      chunks.clear();
+      for (const auto &chunk : list.chunks) {
+        chunks.push_back(chunk.get());
+      }
+    }
+
+    records.clear();
+    TraceRecord record;
+    for (TraceEventChunk *chunk : chunks) {
+      const uint32_t n = chunk->count.load(std::memory_order_acquire);
+      for (; chunk->written < n; ++chunk->written) {
+        if (s.record((*chunk)[chunk->written], fnd->second, record)) {
+          records.push_back(record);
+        }
+      }
+    }
+
+    if (!records.empty() && s.full()) {
+      // Tell the viewer, if it is still there, when the gap ends
+      droppedLiveEvents.fetch_add(records.size(), std::memory_order_relaxed);
+      writeRaw(*s.out, TraceRecordKind::DROPPED);
+      writeRaw(*s.out, fnd->second.index);
+      writeRaw(*s.out, uint32_t(records.size()));
+      writeRaw(*s.out, records.back().time);
+    } else if (!records.empty()) {
+      writeRaw(*s.out, TraceRecordKind::EVENTS);
+      writeRaw(*s.out, fnd->second.index);
+      writeRaw(*s.out, uint32_t(records.size()));
+      s.out->write(reinterpret_cast<const char *>(records.data()),
+          records.size() * sizeof(TraceRecord));
+    }
+
+    // Recycle the written chunks, keeping a few for the thread to reuse
+    std::lock_guard<std::mutex> lock(list.mutex);
+    while (list.chunks.size() > 1
+        && list.chunks.front()->written == TraceEventChunk::SIZE) {
+      if (list.freeChunks.size() < 2) {
+        list.freeChunks.push_back(std::move(list.chunks.front()));
+      }
+      list.chunks.pop_front();
+    }
+  }
+
+  s.out->flush();
+  s.send(false);
+}
+
+void convertTraceToJson(const char *traceFile, const char *jsonFile)
+{
+  std::ifstream in(traceFile, std::ios::binary);
+  char magic[sizeof(TRACE_MAGIC)];
+  int32_t pid = 0;
+  std::string processName;
+  if (!in.read(magic, sizeof(magic))
+      || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0
+      || !readRaw(in, pid) || !readString(in, processName)) {
+    throw std::runtime_error(
+        std::string("not a binary trace file: ") + traceFile);
+  }
+
+  std::ofstream fout(jsonFile);
+  ChromeJsonWriter json(fout, pid);
+  if (!processName.empty()) {
+    json.processName(processName.c_str());
+  }
+
+  // Index 0 is no string; a deque keeps the c_str() pointers valid
+  std::deque<std::string> strings(1);
+  std::unordered_map<uint32_t, JsonThreadState> threads;
+  std::vector<TraceRecord> records;
+
+  // A trace cut short by a crash ends with a partial record
+  bool complete = true;
+  TraceRecordKind kind;
+  while (readRaw(in, kind)) {
+    uint32_t id = 0;
+    std::string str;
+    if (kind == TraceRecordKind::STRING) {
+      complete = readRaw(in, id) && readString(in, str);
+      if (complete && id != strings.size()) {
+        throw std::runtime_error("corrupt string record in trace");
+      }
+      strings.push_back(str);
+    } else if (kind == TraceRecordKind::THREAD) {
+      complete = readRaw(in, id) && readString(in, str);
+      if (complete) {
+        json.threadName(int(id), str);
+      }
+    } else if (kind == TraceRecordKind::DROPPED) {
+      // The events around the gap may miss their begin or end
+      uint32_t count = 0;
+      uint64_t time = 0;
+      complete = readRaw(in, id) && readRaw(in, count) && readRaw(in, time);
+      if (complete) {
+        JsonThreadState &thread = threads[id];
+        thread.dropped += count;
+        JsonEvent evt;
+        evt.type = EventType::COUNTER;
+        evt.name = "rkTraceDroppedEvents";
+        evt.category = nullptr;
+        evt.time = time;
+        evt.cpuTime = UNKNOWN_CPU_TIME;
+        evt.counterValue = thread.dropped;
+        json.event(int(id), thread, evt);
+      }
+    } else if (kind == TraceRecordKind::EVENTS) {
+      uint32_t count = 0;
+      complete = readRaw(in, id) && readRaw(in, count);
+      if (complete) {
+        records.resize(count);
+        complete = bool(in.read(reinterpret_cast<char *>(records.data()),
+            count * sizeof(TraceRecord)));
+      }
+      for (size_t i = 0; complete && i < records.size(); ++i) {
+        const TraceRecord &record = records[i];
+        if (record.name >= strings.size()
+            || record.category >= strings.size()) {
+          throw std::runtime_error("corrupt event record in trace");
+        }
+        JsonEvent evt;
+        evt.type = EventType(record.type);
+        evt.name = record.name ? strings[record.name].c_str() : nullptr;
+        evt.category =
+            record.category ? strings[record.category].c_str() : nullptr;
+        evt.time = record.time;
+        evt.cpuTime = record.cpuTime;
+        evt.counterValue = record.counterValue;
+        JsonThreadState &thread = threads[id];
+        if (thread.dropped > 0 && evt.type == EventType::END
+            && thread.beginEvents.empty()) {
+          continue;
+        }
+        json.event(int(id), thread, evt);
+      }
+    } else {
+      throw std::runtime_error("unknown record in trace");
+    }
+    if (!complete) {
+      std::cerr << "Tracing Warning: " << traceFile
+                << " ends with a partial record\n";
+      break;
+    }
+  }
+
+  for (const auto &thread : threads) {
+    if (thread.second.dropped == 0) {
+      reportMissingEnds(thread.second.beginEvents);
+    }
+  }
+  json.finish();
+}
+
+std::string getProcStatus()
+{
+  // Note: this file doesn't exist on OS X, would we want some alternative to
+  // fetch this info?
+  std::ifstream file("/proc/self/status");
+  if (!file.is_open()) {
+    return "";
+  }
+  return std::string(
+      std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void getProcMemUse(uint64_t &virtMem, uint64_t &resMem)
+{
+  virtMem = 0;
+  resMem = 0;
+#if defined(__linux__)
+  // Kept open, as each read from the start yields the current values
+  static const int statm = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+  char text[128];
+  const ssize_t size =
+      statm < 0 ? -1 : pread(statm, text, sizeof(text) - 1, 0);
+  if (size > 0) {
+    text[size] = '\0';
+    // These values are measured in pages
+    unsigned long long virtPages = 0;
+    unsigned long long resPages = 0;
+    if (std::sscanf(text, "%llu %llu", &virtPages, &resPages) == 2) {
+      const uint64_t pageSize = getpagesize();
+      virtMem = virtPages * pageSize;
+      resMem = resPages * pageSize;
+    }
+  }
+#elif defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS_EX counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(),
+          reinterpret_cast<PROCESS_MEMORY_COUNTERS *>(&counters),
+          sizeof(counters))) {
+    // The committed private memory stands in for the virtual size, which
+    // Windows does not report per process
+    virtMem = counters.PrivateUsage;
+    resMem = counters.WorkingSetSize;
+  }
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(),
+          MACH_TASK_BASIC_INFO,
+          reinterpret_cast<task_info_t>(&info),
+          &count)
+      == KERN_SUCCESS) {
+    virtMem = info.virtual_size;
+    resMem = info.resident_size;
+  }
+#endif
+}
+
+static void syncSampling();
+
+void initThreadEventList()
+{
+  if (!threadEventList) {
+    threadEventList =
+        traceRecorder->getThreadTraceList(std::this_thread::get_id());
+  }
+  syncSampling();
+}
+
+void beginEvent(const char *name, const char *category)
+{
+  initThreadEventList();
+  threadEventList->beginEvent(name, category);
+}
+
+const char *internString(const char *str)
+{
+  if (!str) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(internedStringsMutex);
+  return internedStrings.insert(str).first->c_str();
+}
+
+void beginInternedEvent(const char *name, const char *category)
+{
+  initThreadEventList();
+  threadEventList->beginInternedEvent(name, category);
+}
+
+void endEvent()
+{
+  // Begin takes care of getting the threadEventList set
+  // in thread_local storage so we can assume it exists here
+  threadEventList->endEvent();
+}
+
+void setMarker(const char *name, const char *category)
+{
+  initThreadEventList();
+  threadEventList->setMarker(name, category);
+}
+
+void setCounter(const char *name, uint64_t value)
+{
+  initThreadEventList();
+  threadEventList->setCounter(name, value);
+}
+
+void recordMemUse()
+{
+  initThreadEventList();
+  uint64_t virtMem = 0;
+  uint64_t resMem = 0;
+  getProcMemUse(virtMem, resMem);
+
+  threadEventList->setCounter("rkTraceVirtMem_B", virtMem);
+  threadEventList->setCounter("rkTraceRssMem_B", resMem);
+
+  if (memory::allocationTrackingEnabled()) {
+    recordAllocationCounters();
+  }
+}
+
+// Memory sampler //////////////////////////////////////////////////////////
+
+struct MemorySampler
+{
+  std::thread thread;
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  bool stop = false;
+};
+
+// Guards memorySampler, so that starts and stops do not overlap
+static std::mutex memorySamplerMutex;
+static std::unique_ptr<MemorySampler> memorySampler;
+
+static void stopMemorySamplerLocked()
+{
+  if (!memorySampler) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(memorySampler->wakeMutex);
+    memorySampler->stop = true;
+  }
+  memorySampler->wake.notify_all();
+  memorySampler->thread.join();
+  memorySampler.reset();
+}
+
+void startMemorySampler(int intervalMs)
+{
+  const milliseconds interval(std::max(1, intervalMs));
+  std::lock_guard<std::mutex> lock(memorySamplerMutex);
+  stopMemorySamplerLocked();
+
+  memorySampler = rkcommon::make_unique<MemorySampler>();
+  MemorySampler *s = memorySampler.get();
+  s->thread = std::thread([s, interval]() {
+    setThreadName("rkMemorySampler");
+    // At a fixed rate, however long the samples take
+    auto next = steady_clock::now();
+    std::unique_lock<std::mutex> lock(s->wakeMutex);
+    while (!s->stop) {
+      lock.unlock();
+      recordMemUse();
+      lock.lock();
+      next += interval;
+      s->wake.wait_until(lock, next, [s]() { return s->stop; });
+    }
+  });
+}
+
+void stopMemorySampler()
+{
+  std::lock_guard<std::mutex> lock(memorySamplerMutex);
+  stopMemorySamplerLocked();
+}
+
+// Sampling profiler //////////////////////////////////////////////////////
+
+// Threads arm their sampling when they see a new generation, in their next
+// initThreadEventList(). Guards the sampled threads and their timers
+static std::mutex samplingMutex;
+static std::atomic<uint32_t> samplingGeneration(0);
+static bool samplingEnabled = false;
+static int samplingIntervalUs = 1000;
+static size_t samplingBufferSize = 0;
+
+// Serializes startSampling() and stopSampling()
+static std::mutex samplingControlMutex;
+
+// The sampling of the calling thread, disarmed when it exits
+struct ThreadSampling
+{
+  // The list samples go to, set before the sampling is armed
+  ThreadEventList *list = nullptr;
+  uint32_t generation = 0;
+  bool armed = false;
+#ifdef __linux__
+  timer_t timer;
+#elif defined(_WIN32)
+  HANDLE thread = nullptr;
+  // Of the thread when last sampled, to skip threads which did not run
+  ULONG64 cycles = 0;
+#endif
+
+  ~ThreadSampling();
+
+  // Both with samplingMutex held
+  bool arm();
+  void disarm();
+};
+
+static std::vector<ThreadSampling *> sampledThreads;
+
+static thread_local ThreadSampling threadSampling;
+
+#ifdef __linux__
+
+static uintptr_t instructionPointer(void *context)
+{
+#if defined(__x86_64__)
+  return uintptr_t(
+      static_cast<ucontext_t *>(context)->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+  return uintptr_t(static_cast<ucontext_t *>(context)->uc_mcontext.pc);
+#else
+  (void)context;
+  return 0;
+#endif
+}
+
+static void samplingSignalHandler(int, siginfo_t *, void *context)
+{
+  const int savedErrno = errno;
+  // Set before the timer of the thread was armed
+  ThreadEventList *list = threadSampling.list;
+  if (list) {
+    list->recordSample(instructionPointer(context));
+  }
+  errno = savedErrno;
+}
+
+static bool installSamplingHandler()
+{
+  // Installed once and kept, signals of disarmed timers may still be pending
+  static const bool installed = []() {
+    struct sigaction action = {};
+    action.sa_sigaction = samplingSignalHandler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGPROF, &action, nullptr) == 0;
+  }();
+  return installed;
+}
+
+bool ThreadSampling::arm()
+{
+  // A timer on the CPU clock of the thread, signaling the thread itself
+  sigevent event = {};
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+#ifdef sigev_notify_thread_id
+  event.sigev_notify_thread_id = pid_t(syscall(SYS_gettid));
+#else
+  event._sigev_un._tid = pid_t(syscall(SYS_gettid));
+#endif
+  if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer) != 0) {
+    return false;
+  }
+  itimerspec spec = {};
+  spec.it_interval.tv_sec = samplingIntervalUs / 1000000;
+  spec.it_interval.tv_nsec = long(samplingIntervalUs % 1000000) * 1000;
+  spec.it_value = spec.it_interval;
+  if (timer_settime(timer, 0, &spec, nullptr) != 0) {
+    timer_delete(timer);
+    return false;
+  }
+  return true;
+}
+
+void ThreadSampling::disarm()
+{
+  timer_delete(timer);
+}
+
+#elif defined(_WIN32)
+
+// Suspends the sampled threads in turn, as Windows has no profiling signals
+struct WindowsSampler
+{
+  std::thread thread;
+  std::mutex wakeMutex;
+  std::condition_variable wake;
+  bool stop = false;
+};
+
+static std::unique_ptr<WindowsSampler> windowsSampler;
+
+static uintptr_t instructionPointer(const CONTEXT &context)
+{
+#if defined(_M_X64)
+  return uintptr_t(context.Rip);
+#elif defined(_M_ARM64)
+  return uintptr_t(context.Pc);
+#else
+  return uintptr_t(context.Eip);
+#endif
+}
+
+// Sample the threads which ran since they were last sampled
+static void sampleThreads()
+{
+  std::lock_guard<std::mutex> lock(samplingMutex);
+  for (ThreadSampling *sampled : sampledThreads) {
+    ULONG64 cycles = 0;
+    QueryThreadCycleTime(sampled->thread, &cycles);
+    if (cycles == sampled->cycles) {
+      continue;
+    }
+    sampled->cycles = cycles;
+    // Nothing which may take a lock the thread holds, like the heap's, until
+    // it is resumed
+    if (SuspendThread(sampled->thread) == DWORD(-1)) {
+      continue;
+    }
+    CONTEXT context = {};
+    context.ContextFlags = CONTEXT_CONTROL;
+    if (GetThreadContext(sampled->thread, &context)) {
+      sampled->list->recordSample(instructionPointer(context));
+    }
+    ResumeThread(sampled->thread);
+  }
+}
+
+static void startWindowsSampler(int intervalUs)
+{
+  if (windowsSampler) {
+    return;
+  }
+  windowsSampler = rkcommon::make_unique<WindowsSampler>();
+  WindowsSampler *s = windowsSampler.get();
+  const microseconds interval(intervalUs);
+  // No trace calls, which would make the thread sample itself
+  s->thread = std::thread([s, interval]() {
+    auto next = steady_clock::now();
+    std::unique_lock<std::mutex> lock(s->wakeMutex);
+    while (!s->stop) {
+      lock.unlock();
+      sampleThreads();
+      lock.lock();
+      next += interval;
+      s->wake.wait_until(lock, next, [s]() { return s->stop; });
+    }
+  });
+}
+
+static void stopWindowsSampler()
+{
+  if (!windowsSampler) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(windowsSampler->wakeMutex);
+    windowsSampler->stop = true;
+  }
+  windowsSampler->wake.notify_all();
+  windowsSampler->thread.join();
+  windowsSampler.reset();
+}
+
+bool ThreadSampling::arm()
+{
+  cycles = 0;
+  return DuplicateHandle(GetCurrentProcess(),
+      GetCurrentThread(),
+      GetCurrentProcess(),
+      &thread,
+      THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION,
+      FALSE,
+      0);
+}
+
+void ThreadSampling::disarm()
+{
+  CloseHandle(thread);
+  thread = nullptr;
+}
+
+#else
+
+bool ThreadSampling::arm()
+{
+  return false;
+}
+
+void ThreadSampling::disarm() {}
+
+#endif
+
+ThreadSampling::~ThreadSampling()
+{
+  std::lock_guard<std::mutex> lock(samplingMutex);
+  if (armed) {
+    disarm();
+    armed = false;
+    sampledThreads.erase(
+        std::find(sampledThreads.begin(), sampledThreads.end(), this));
+  }
+}
+
+// Arm or disarm the sampling of the calling thread after startSampling() or
+// stopSampling()
+static void syncSampling()
+{
+  const uint32_t generation =
+      samplingGeneration.load(std::memory_order_acquire);
+  if (threadSampling.generation == generation) {
+    return;
+  }
+  threadSampling.generation = generation;
+
+  size_t bufferSize = 0;
+  {
+    std::lock_guard<std::mutex> lock(samplingMutex);
+    if (!samplingEnabled) {
+      return;
+    }
+    bufferSize = samplingBufferSize;
+  }
+
+  // Replaced while the thread is not sampled, stopSampling() disarmed it
+#ifdef __linux__
+  sigset_t profiling;
+  sigset_t previous;
+  sigemptyset(&profiling);
+  sigaddset(&profiling, SIGPROF);
+  pthread_sigmask(SIG_BLOCK, &profiling, &previous);
+#endif
+  threadEventList->reserveSamples(bufferSize);
+  threadSampling.list = threadEventList.get();
+#ifdef __linux__
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+#endif
+
+  // Unless sampling was stopped or restarted meanwhile
+  std::lock_guard<std::mutex> lock(samplingMutex);
+  if (samplingEnabled && !threadSampling.armed
+      && samplingGeneration.load(std::memory_order_relaxed) == generation
+      && threadSampling.arm()) {
+    threadSampling.armed = true;
+    sampledThreads.push_back(&threadSampling);
+  }
+}
+
+static void stopSamplingLocked()
+{
+  {
+    std::lock_guard<std::mutex> lock(samplingMutex);
+    samplingEnabled = false;
+    samplingGeneration.fetch_add(1, std::memory_order_release);
+    for (ThreadSampling *sampled : sampledThreads) {
+      sampled->disarm();
+      sampled->armed = false;
+    }
+    sampledThreads.clear();
+  }
+#ifdef _WIN32
+  // Outside the lock, which the sampler thread takes
+  stopWindowsSampler();
+#endif
+}
+
+bool startSampling(int intervalUs, size_t samplesPerThread)
+{
+#if defined(__linux__) || defined(_WIN32)
+  std::lock_guard<std::mutex> control(samplingControlMutex);
+  stopSamplingLocked();
+#ifdef __linux__
+  if (!installSamplingHandler()) {
+    return false;
+  }
+#endif
+  {
+    std::lock_guard<std::mutex> lock(samplingMutex);
+    samplingEnabled = true;
+    samplingIntervalUs = std::max(1, intervalUs);
+    samplingBufferSize = std::max<size_t>(1, samplesPerThread);
+    samplingGeneration.fetch_add(1, std::memory_order_release);
+#ifdef _WIN32
+    startWindowsSampler(samplingIntervalUs);
+#endif
+  }
+  initThreadEventList();
+  return threadSampling.armed;
+#else
+  (void)intervalUs;
+  (void)samplesPerThread;
+  return false;
+#endif
+}
+
+void stopSampling()
+{
+  std::lock_guard<std::mutex> control(samplingControlMutex);
+  stopSamplingLocked();
+}
+
+std::vector<SampleHotSpot> sampleHotSpots()
+{
+  return traceRecorder->sampleHotSpots();
+}
+
+void recordAllocationCounters()
+{
+  // Counter names are cached by pointer in the ThreadEventList, so keep one
+  // set of persistent names per tag, along with the values needed to
+  // compute the allocation rate since the previous call
+  struct TagCounters
+  {
+    std::string live;
+    std::string peak;
+    std::string rate;
+    uint64_t lastNumAllocations = 0;
+    steady_clock::time_point lastTime;
+  };
+  static std::mutex mutex;
+  static std::unordered_map<const char *, std::unique_ptr<TagCounters>> tags;
+
+  initThreadEventList();
+  const auto now = steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &stats : memory::allocationStatistics()) {
+    auto &counters = tags[stats.tag];
+    if (!counters) {
+      counters = rkcommon::make_unique<TagCounters>();
+      const std::string prefix = std::string("rkAlloc_") + stats.tag;
+      counters->live = prefix + "_live_B";
+      counters->peak = prefix + "_peak_B";
+      counters->rate = prefix + "_allocs_per_s";
+      counters->lastTime = now;
+    }
+
+    threadEventList->setCounter(counters->live.c_str(), stats.liveBytes);
+    threadEventList->setCounter(counters->peak.c_str(), stats.peakBytes);
+
+    const double seconds =
+        duration_cast<duration<double>>(now - counters->lastTime).count();
+    if (seconds > 0.0) {
+      const double rate =
+          (stats.numAllocations - counters->lastNumAllocations) / seconds;
+      threadEventList->setCounter(counters->rate.c_str(), uint64_t(rate));
+    }
+    counters->lastNumAllocations = stats.numAllocations;
+    counters->lastTime = now;
+  }
+}
+
+void setThreadName(const char *name)
+{
+  initThreadEventList();
+  threadEventList->setThreadName(name);
+}
+
+void setCpuTimeSampling(int everyNth)
+{
+  cpuTimeSampling.store(std::max(0, everyNth), std::memory_order_relaxed);
+}
+
+void recordCpuTime()
+{
+  initThreadEventList();
+  threadEventList->recordCpuTime();
+}
+
+const char *currentRegion()
+{
+  initThreadEventList();
+  return threadEventList->currentRegion();
+}
+
+uint64_t beginFlow(const char *name)
+{
+  static std::atomic<uint64_t> nextId(1);
+  const uint64_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+  initThreadEventList();
+  threadEventList->setFlow(EventType::FLOW_BEGIN, name, id);
+  return id;
+}
+
+void endFlow(const char *name, uint64_t id)
+{
+  initThreadEventList();
+  threadEventList->setFlow(EventType::FLOW_END, name, id);
+}
+
+bool enableHardwareCounters(const std::vector<HardwareCounter> &counters)
+{
+  {
+    std::lock_guard<std::mutex> lock(hardwareCountersMutex);
+    requestedCounters = counters;
+    hardwareCountersGeneration.fetch_add(1, std::memory_order_release);
+    hardwareCountersEnabled.store(true, std::memory_order_relaxed);
+  }
+  initThreadEventList();
+  uint64_t values[size_t(HardwareCounter::COUNT)];
+  return threadEventList->readHardwareCounters(values);
+}
+
+void disableHardwareCounters()
+{
+  std::lock_guard<std::mutex> lock(hardwareCountersMutex);
+  requestedCounters.clear();
+  hardwareCountersGeneration.fetch_add(1, std::memory_order_release);
+  hardwareCountersEnabled.store(false, std::memory_order_relaxed);
+}
+
+std::vector<RegionCounters> regionCounterSummary()
+{
+  return traceRecorder->regionCounterSummary();
+}
+
+std::string regionCounterReport()
+{
+  const std::vector<RegionCounters> summary = regionCounterSummary();
+
+  // The counters some region has a value for
+  std::vector<HardwareCounter> columns;
+  for (size_t i = 0; i < size_t(HardwareCounter::COUNT); ++i) {
+    for (const auto &region : summary) {
+      if (region.values[i] > 0) {
+        columns.push_back(HardwareCounter(i));
+        break;
+      }
+    }
+  }
+
+  std::ostringstream report;
+  report << std::left << std::setw(32) << "region" << std::right
+         << std::setw(10) << "count";
+  for (HardwareCounter column : columns) {
+    report << std::setw(16) << counterName(column);
+  }
+  report << std::setw(8) << "IPC" << "\n";
+  for (const auto &region : summary) {
+    report << std::left << std::setw(32) << region.name << std::right
+           << std::setw(10) << region.count;
+    for (HardwareCounter column : columns) {
+      report << std::setw(16) << region[column];
+    }
+    report << std::setw(8) << std::fixed << std::setprecision(2)
+           << region.ipc() << "\n";
+  }
+  return report.str();
+}
+
+void saveLog(const char *logFile, const char *processName)
+{
+  traceRecorder->saveLog(logFile, processName);
+}
+
+void setTraceMode(TraceMode mode)
+{
+  traceMode.store(mode, std::memory_order_relaxed);
+}
+
+std::vector<EventStatistics> getStats(bool perThread)
+{
+  return traceRecorder->getStats(perThread);
+}
+
+void resetStats()
+{
+  traceRecorder->resetStats();
+}
+
+// 'text' with 'special' characters and control characters escaped by a
+// backslash, as JSON strings and Prometheus label values need
+static std::string escaped(const std::string &text)
+{
+  std::ostringstream out;
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (c == '\n') {
+      out << "\\n";
+    } else if (uint8_t(c) < 0x20) {
+      out << ' ';
+    } else {
+      out << c;
+    }
+  }
+  return out.str();
+}
+
+std::string statsToJson(const std::vector<EventStatistics> &stats)
+{
+  std::ostringstream json;
+  json << "[";
+  for (size_t i = 0; i < stats.size(); ++i) {
+    const EventStatistics &s = stats[i];
+    json << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << escaped(s.name)
+         << "\",";
+    if (!s.thread.empty()) {
+      json << "\"thread\":\"" << escaped(s.thread) << "\",";
+    }
+    json << "\"count\":" << s.count << ",\"totalNs\":" << s.totalNs
+         << ",\"meanNs\":" << s.meanNs() << ",\"minNs\":" << s.minNs
+         << ",\"maxNs\":" << s.maxNs << ",\"p50Ns\":" << s.p50Ns
+         << ",\"p99Ns\":" << s.p99Ns;
+    if (s.cpuUtilization >= 0.f) {
+      json << ",\"cpuUtilization\":" << s.cpuUtilization;
+    }
+    json << "}";
+  }
+  json << "\n]\n";
+  return json.str();
+}
+
+std::string statsToPrometheus(const std::vector<EventStatistics> &stats)
+{
+  const auto labels = [](const EventStatistics &s) {
+    std::string labels = "name=\"" + escaped(s.name) + "\"";
+    if (!s.thread.empty()) {
+      labels += ",thread=\"" + escaped(s.thread) + "\"";
+    }
+    return labels;
+  };
+
+  std::ostringstream text;
+  text << std::setprecision(9);
+  text << "# HELP rkcommon_trace_duration_seconds Duration of the traced "
+          "begin/end pairs\n"
+       << "# TYPE rkcommon_trace_duration_seconds summary\n";
+  for (const auto &s : stats) {
+    const std::string l = labels(s);
+    text << "rkcommon_trace_duration_seconds{" << l << ",quantile=\"0.5\"} "
+         << s.p50Ns * 1e-9 << "\n"
+         << "rkcommon_trace_duration_seconds{" << l << ",quantile=\"0.99\"} "
+         << s.p99Ns * 1e-9 << "\n"
+         << "rkcommon_trace_duration_seconds_sum{" << l << "} "
+         << s.totalNs * 1e-9 << "\n"
+         << "rkcommon_trace_duration_seconds_count{" << l << "} " << s.count
+         << "\n";
+  }
+  text << "# HELP rkcommon_trace_cpu_utilization CPU utilization in percent "
+          "over the traced begin/end pairs\n"
+       << "# TYPE rkcommon_trace_cpu_utilization gauge\n";
+  for (const auto &s : stats) {
+    if (s.cpuUtilization >= 0.f) {
+      text << "rkcommon_trace_cpu_utilization{" << labels(s) << "} "
+           << s.cpuUtilization << "\n";
+    }
+  }
+  return text.str();
+}
+
+void startTraceStream(
+    const char *traceFile, const char *processName, int intervalMs)
+{
+  traceRecorder->startStream(
+      traceFile, processName, milliseconds(std::max(1, intervalMs)));
+}
+
+void stopTraceStream()
+{
+  traceRecorder->stopStream();
+}
+
+void startLiveTrace(
+    const char *address, const char *processName, int intervalMs)
+{
+  traceRecorder->startLiveStream(
+      address, processName, milliseconds(std::max(1, intervalMs)));
+}
+
+uint64_t droppedLiveTraceEvents()
+{
+  return droppedLiveEvents.load(std::memory_order_relaxed);
+}
+
+void startFlightRecorder(size_t eventsPerThread)
+{
+  traceRecorder->setFlightRecorder(std::max<size_t>(1, eventsPerThread));
+}
+
+void stopFlightRecorder()
+{
+  traceRecorder->setFlightRecorder(0);
+}
+
+void dumpRecent(const char *logFile, const char *processName)
+{
+  traceRecorder->dumpRecent(logFile, processName);
 }
 
 } // namespace tracing
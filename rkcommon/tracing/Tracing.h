@@ -3,9 +3,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
-#include <list>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -26,89 +27,331 @@
 namespace rkcommon {
 namespace tracing {
 
-enum class EventType
+enum class EventType : uint8_t
 {
   INVALID,
   BEGIN,
   END,
   MARKER,
-  COUNTER
+  COUNTER,
+  // The process CPU time in microseconds, for the event after it
+  CPU_TIME,
+  // Arrows from the event enclosing the FLOW_BEGIN to the one enclosing the
+  // FLOW_END with the same ID in counterValue
+  FLOW_BEGIN,
+  FLOW_END,
+  // The change of a hardware counter over the end event after it
+  HW_COUNTER
 };
 
-struct RKCOMMON_INTERFACE TraceEvent
+// Counters of the perf_event_open() interface, see enableHardwareCounters()
+enum class HardwareCounter : uint8_t
 {
-  EventType type = EventType::INVALID;
-  // Refers to a string in the thread's stringCache, nullptr for end events
-  const char *name = nullptr;
-  // Refers to the event category in the thread's stringCache, may be null
-  const char *category = nullptr;
-#ifdef __linux__
-  timeval ru_utime;
-  timeval ru_stime;
-#endif
-  std::chrono::steady_clock::time_point time;
+  CYCLES,
+  INSTRUCTIONS,
+  LLC_MISSES,
+  BRANCH_MISSES,
+  PAGE_FAULTS,
+  CONTEXT_SWITCHES,
+  COUNT
+};
 
-  uint64_t counterValue = 0;
+// The name of the counter in traces: "cycles", "llcMisses", ...
+RKCOMMON_INTERFACE const char *counterName(HardwareCounter counter);
 
-  TraceEvent();
+// The totals of the hardware counters over the begin/end pairs of a region
+// (events of the same name), of all threads
+struct RKCOMMON_INTERFACE RegionCounters
+{
+  std::string name;
+  // Measured begin/end pairs
+  uint64_t count = 0;
+  uint64_t values[size_t(HardwareCounter::COUNT)] = {};
+
+  uint64_t operator[](HardwareCounter counter) const;
 
-  TraceEvent(const EventType type);
+  // Instructions per cycle, 0 if either was not counted
+  double ipc() const;
+};
+
+// The samples held of a function within an event
+struct RKCOMMON_INTERFACE SampleHotSpot
+{
+  std::string function;
+  // The innermost open event, empty for none
+  std::string region;
+  uint64_t count = 0;
+};
+
+// Events are kept small, as they are recorded at high rates: the type shares
+// a word with the timestamp, and counter values take the place of the
+// category. CPU time is not part of every event, see setCpuTimeSampling()
+struct RKCOMMON_INTERFACE TraceEvent
+{
+  // Refers to an internString(), nullptr for end events
+  const char *name = nullptr;
+  union
+  {
+    // Refers to the internString() of the event category, may be null
+    const char *category;
+    // COUNTER, CPU_TIME, HW_COUNTER and flow events
+    uint64_t counterValue;
+  };
+  // The timestamp in the low 56 bits, in ticks of the trace clock since the
+  // trace started, and the EventType in the high 8 bits
+  uint64_t timeAndType = 0;
 
   TraceEvent(const EventType type, const char *name, const char *category);
 
   TraceEvent(
       const EventType type, const char *name, const uint64_t counterValue);
+
+  EventType type() const;
+
+  uint64_t ticks() const;
+};
+
+// What the trace recorder keeps of the events, see setTraceMode()
+enum class TraceMode
+{
+  // All events, for saveLog() and trace streams
+  TIMELINE,
+  // Only the statistics of the begin/end pairs of each event name
+  STATISTICS,
+  TIMELINE_AND_STATISTICS
+};
+
+// The begin/end pairs of an event name, see getStats()
+struct RKCOMMON_INTERFACE EventStatistics
+{
+  std::string name;
+  // The thread label, empty for the statistics of all threads
+  std::string thread;
+  uint64_t count = 0;
+  // Durations in nanoseconds; the percentiles are accurate to about 3%
+  uint64_t totalNs = 0;
+  uint64_t minNs = 0;
+  uint64_t maxNs = 0;
+  uint64_t p50Ns = 0;
+  uint64_t p99Ns = 0;
+  // Over the pairs which recorded the CPU time, -1 if none did
+  float cpuUtilization = -1.f;
+
+  uint64_t meanNs() const;
+};
+
+// A fixed size block of events. The owning thread appends to the last chunk
+// of its ThreadEventList while a trace stream writes out what it has
+// published through 'count' so far
+struct RKCOMMON_INTERFACE TraceEventChunk
+{
+  static constexpr uint32_t SIZE = 4096;
+
+  TraceEventChunk();
+
+  const TraceEvent &operator[](uint32_t i) const;
+
+  // Events published by the owning thread
+  std::atomic<uint32_t> count;
+  // Events the trace stream has written, only accessed by the stream
+  uint32_t written = 0;
+
+ private:
+  friend struct ThreadEventList;
+
+  // Raw storage, so that a new chunk does not construct its events
+  alignas(TraceEvent) unsigned char storage[SIZE * sizeof(TraceEvent)];
 };
 
 struct RKCOMMON_INTERFACE ThreadEventList
 {
-  // We store events in chunks to reduce memory copy
-  // costs when when tracking very large numbers of events
-  std::list<std::vector<TraceEvent>> events;
+  ThreadEventList();
+  ~ThreadEventList();
+
+  // We store events in chunks which are never moved to reduce memory
+  // copy costs when when tracking very large numbers of events. While a
+  // trace stream runs, it recycles the chunks it has written out
+  std::deque<std::unique_ptr<TraceEventChunk>> chunks;
+  std::vector<std::unique_ptr<TraceEventChunk>> freeChunks;
+  // Guards chunks, freeChunks and threadName, which other threads read
+  std::mutex mutex;
   std::string threadName;
   // Applications are typically running a rendering loop, emitting
   // the same event name repeatedly. If these names are inline
   // strings they will have the same pointer and we can cache
-  // them in a map to reduce string copying costs and overhead
-  // Note: the string is wrapped in a shared/unique ptr
-  // to guard against copy ctor use when adding to the map which would
-  // invalidate the pointer to the string data
-  std::unordered_map<const char *, std::shared_ptr<std::string>> stringCache;
+  // their internString() by it, sparing the lock of the process wide table
+  std::unordered_map<const char *, const char *> stringCache;
+  // The statistics of each event name, by its internString(). Guarded by
+  // mutex
+  struct EventAggregate;
+  std::unordered_map<const char *, std::unique_ptr<EventAggregate>> aggregates;
 
   void beginEvent(const char *name, const char *category);
 
+  // beginEvent() for an internString() name and category
+  void beginInternedEvent(const char *name, const char *category);
+
   void endEvent();
 
   void setMarker(const char *name, const char *category);
 
   void setCounter(const char *name, const uint64_t value);
 
+  void setThreadName(const char *name);
+
+  void recordCpuTime();
+
+  void setFlow(EventType type, const char *name, uint64_t id);
+
+  // The name of the innermost open event, nullptr if there is none
+  const char *currentRegion() const;
+
+  // Read the counter group, opening it first if the counters changed.
+  // False if none of the counters could be opened
+  bool readHardwareCounters(uint64_t *values);
+
+  // Add the region totals of the thread to 'regions', by name
+  void addRegionCounters(
+      std::unordered_map<std::string, RegionCounters> &regions);
+
+  // A sample of the sampling profiler, see startSampling()
+  struct Sample
+  {
+    uint64_t ticks;
+    uintptr_t ip;
+    // The innermost open event, an internString(), may be null
+    const char *region;
+  };
+
+  // Record a sample at the instruction pointer 'ip' with the innermost open
+  // event. Async signal safe: called from the profiling signal of the
+  // thread, or while the thread is suspended
+  void recordSample(uintptr_t ip);
+
+  // Keep the last 'size' samples of the thread, dropping the ones held if
+  // the size changes. Only while the thread is not being sampled
+  void reserveSamples(size_t size);
+
+  // Append the samples held to 'out', oldest first. Called with mutex held
+  void copySamples(std::vector<Sample> &out) const;
+
  private:
-  std::vector<TraceEvent> &getCurrentEventList();
+  void push(const TraceEvent &event);
 
   const char *getCachedString(const char *str);
+
+  // The last chunk, which only the owning thread appends to
+  TraceEventChunk *current = nullptr;
+
+  // The perf_event_open() counter group of the thread, if enabled
+  struct HardwareCounters;
+  std::unique_ptr<HardwareCounters> hardwareCounters;
+  // Guarded by mutex
+  std::unordered_map<const char *, RegionCounters> regionCounters;
+
+  struct OpenEvent
+  {
+    const char *name;
+    // Whether the begin event recorded CPU time, so that its end does too
+    bool cpuTimeSampled;
+    // The hardware counters at the begin event, if read, in the order of
+    // the counter group of 'countersGeneration'
+    bool countersRead;
+    uint32_t countersGeneration;
+    uint64_t counters[size_t(HardwareCounter::COUNT)];
+    // For the statistics of the event
+    uint64_t beginTicks;
+    uint64_t cpuTime;
+  };
+  std::vector<OpenEvent> openEvents;
+  // Begin events since CPU time was last sampled
+  int unsampledBegins = 0;
+
+  // The ring of the samples, replaced under mutex
+  struct SampleBuffer;
+  std::unique_ptr<SampleBuffer> sampleBuffer;
+  // The name of the innermost open event, for the samples, which cannot
+  // look at openEvents
+  std::atomic<const char *> sampledRegion{nullptr};
+
+  // Record the change of the counters since 'open' began
+  void recordHardwareCounters(const OpenEvent &open, const uint64_t *values);
+
+  void pushCpuTime(uint64_t cpuTime);
+
+  void addStatistics(const OpenEvent &open, uint64_t cpuTime);
 };
 
 class RKCOMMON_INTERFACE TraceRecorder
 {
-  std::unordered_map<std::thread::id, std::shared_ptr<ThreadEventList>>
-      threadTrace;
-
+  // The event lists of the threads, which new threads prepend to without
+  // locking. Entries are never removed, so readers walk it as it is
+  struct ThreadTrace
+  {
+    std::thread::id id;
+    std::shared_ptr<ThreadEventList> list;
+    ThreadTrace *next;
+  };
+  std::atomic<ThreadTrace *> threadTraces{nullptr};
+
+  // Serializes the writers of the thread lists
   std::mutex threadTraceMutex;
 
+  struct TraceStream;
+  std::unique_ptr<TraceStream> stream;
+
  public:
-  /* Get the thread trace list, creating it if this is the first time
-   * this thread has requested its list. This call locks the TraceRecorder,
-   * so threads cache the returned value in thread_local storage to avoid
-   * calling this each event.
+  TraceRecorder();
+  ~TraceRecorder();
+
+  /* Create the trace list of a thread, which it caches in thread_local
+   * storage. Threads register without taking a lock, as programs starting
+   * many short lived threads would otherwise contend on it.
    */
   std::shared_ptr<ThreadEventList> getThreadTraceList(
       const std::thread::id &id);
 
+  // Write the events still held in memory as Chrome JSON
   void saveLog(const char *logFile, const char *processName);
-};
 
-float cpuUtilization(const TraceEvent &start, const TraceEvent &end);
+  // As saveLog(), for events of which the oldest may have been dropped
+  void dumpRecent(const char *logFile, const char *processName);
+
+  // The hardware counter totals of all threads
+  std::vector<RegionCounters> regionCounterSummary();
+
+  std::vector<SampleHotSpot> sampleHotSpots();
+
+  std::vector<EventStatistics> getStats(bool perThread);
+
+  void resetStats();
+
+  // Keep the last 'eventsPerThread' or more events of each thread, in a ring
+  // of chunks which the threads reuse, instead of all events; 0 keeps all
+  void setFlightRecorder(size_t eventsPerThread);
+
+  // Write all events to 'traceFile' in the binary trace format from a
+  // background thread, every 'interval' and when stopped
+  void startStream(const char *traceFile,
+      const char *processName,
+      std::chrono::milliseconds interval);
+
+  // As startStream(), to a connection to 'address'
+  void startLiveStream(const char *address,
+      const char *processName,
+      std::chrono::milliseconds interval);
+
+  void stopStream();
+
+ private:
+  void runStream(
+      std::unique_ptr<TraceStream> newStream, const char *processName);
+
+  // Append the events recorded since the last call to the stream
+  void flushStream();
+
+  void writeJson(const char *logFile, const char *processName, bool recent);
+};
 
 std::string getProcStatus();
 
@@ -127,22 +370,222 @@ void setMarker(const char *name, const char *category);
 void setCounter(const char *name, uint64_t value);
 
 // Record the built-in counters traceVirtMem and traceRssMem tracking the
-// virtual and resident memory sizes respectively
+// virtual and resident memory sizes respectively, and the allocation
+// counters below if memory::setAllocationTracking() is on
 void recordMemUse();
 
+// Record the live and peak bytes and the allocation rate of each
+// memory::ScopedAllocationTag as the counters rkAlloc_<tag>_live_B,
+// rkAlloc_<tag>_peak_B and rkAlloc_<tag>_allocs_per_s
+void recordAllocationCounters();
+
+// Record the counters of recordMemUse() from a background thread every
+// 'intervalMs' milliseconds, so that the threads doing the work never pay for
+// reading them. They appear on the timeline of the thread "rkMemorySampler"
+RKCOMMON_INTERFACE void startMemorySampler(int intervalMs = 10);
+
+// Stop the sampler and join its thread
+RKCOMMON_INTERFACE void stopMemorySampler();
+
 void setThreadName(const char *name);
 
+// Begin and end events record the process CPU time along with the wall time
+// by default, for the CPU utilization of each event. Getting it is a system
+// call, which costs more than the rest of the event: 'everyNth' > 1 records
+// it for every Nth begin/end pair of each thread only, and 0 never, leaving
+// just the timestamp to take. Events without CPU time report no utilization
+RKCOMMON_INTERFACE void setCpuTimeSampling(int everyNth);
+
+// Record the process CPU time for the next event of this thread, e.g., to
+// measure a particular begin/end pair while sampling is off
+RKCOMMON_INTERFACE void recordCpuTime();
+
 void saveLog(const char *logFile, const char *processName);
 
+// A copy of 'str' which stays valid as long as the process, the same pointer
+// for the same text. Events refer to their names by it; passing it to
+// beginInternedEvent() skips the lookup of beginEvent()
+RKCOMMON_INTERFACE const char *internString(const char *str);
+
+// beginEvent() for an internString() 'name' and 'category'
+RKCOMMON_INTERFACE void beginInternedEvent(
+    const char *name, const char *category = nullptr);
+
+// The name of the innermost event open on this thread, nullptr if there is
+// none, an internString()
+RKCOMMON_INTERFACE const char *currentRegion();
+
+// Flow events draw an arrow from the event open on the thread calling
+// beginFlow() to the one open on the thread calling endFlow() with the ID it
+// returned, e.g., from where a task was created to where it ran
+RKCOMMON_INTERFACE uint64_t beginFlow(const char *name);
+
+RKCOMMON_INTERFACE void endFlow(const char *name, uint64_t id);
+
+// Keep the full timeline of events (the default), only statistics of the
+// begin/end pairs of each event name, or both. The statistics take constant
+// memory per event name and thread, a histogram of the durations
+RKCOMMON_INTERFACE void setTraceMode(TraceMode mode);
+
+// The statistics of each event name so far, by decreasing total duration,
+// merged over all threads or 'perThread'
+RKCOMMON_INTERFACE std::vector<EventStatistics> getStats(
+    bool perThread = false);
+
+RKCOMMON_INTERFACE void resetStats();
+
+// 'stats' as a JSON array of objects with the fields of EventStatistics
+RKCOMMON_INTERFACE std::string statsToJson(
+    const std::vector<EventStatistics> &stats);
+
+// 'stats' in the Prometheus text exposition format: a summary
+// rkcommon_trace_duration_seconds with the 0.5 and 0.99 quantiles and a
+// gauge rkcommon_trace_cpu_utilization, labeled by name (and thread)
+RKCOMMON_INTERFACE std::string statsToPrometheus(
+    const std::vector<EventStatistics> &stats);
+
+// Read hardware counters at each begin and end event of every thread with
+// perf_event_open(), on Linux, and record their change over the pair. Saved
+// traces list them, with the IPC, in the arguments of the end events, and
+// regionCounterSummary() adds them up per region. Each read is a system call,
+// so counters are best combined with setCpuTimeSampling(0). 'counters' which
+// the CPU or the kernel settings (perf_event_paranoid) do not allow are left
+// out; returns false if none could be opened on the calling thread
+RKCOMMON_INTERFACE bool enableHardwareCounters(
+    const std::vector<HardwareCounter> &counters = {HardwareCounter::CYCLES,
+        HardwareCounter::INSTRUCTIONS,
+        HardwareCounter::LLC_MISSES,
+        HardwareCounter::BRANCH_MISSES});
+
+RKCOMMON_INTERFACE void disableHardwareCounters();
+
+// Start the sampling profiler: every 'intervalUs' microseconds of CPU time of a
+// thread, record where it is, its instruction pointer and innermost open event,
+// in a ring of the last 'samplesPerThread' samples of the thread. On Linux each
+// thread has a timer on its CPU clock (timer_create()) signaling it with
+// SIGPROF (at most once per scheduler tick), so the profiler takes SIGPROF over
+// from e.g. gprof; on Windows a thread suspends the threads in turn, skipping
+// those which did not run since. Threads are sampled from their first trace
+// call after the start on, the calling thread right away. Samples are resolved
+// to function names (exported symbols, so executables need -rdynamic on Linux,
+// or module and offset) only by saveLog(), dumpRecent() and sampleHotSpots(),
+// and appear in saved traces as instant events of the category "sample", not in
+// trace streams. Returns false where sampling is not supported
+RKCOMMON_INTERFACE bool startSampling(
+    int intervalUs = 1000, size_t samplesPerThread = 1 << 16);
+
+// Disarm the sampling of all threads, keeping the samples held
+RKCOMMON_INTERFACE void stopSampling();
+
+// The samples held of all threads by function and region, by decreasing count
+RKCOMMON_INTERFACE std::vector<SampleHotSpot> sampleHotSpots();
+
+// The counter totals of each region measured so far, by decreasing cycles
+RKCOMMON_INTERFACE std::vector<RegionCounters> regionCounterSummary();
+
+// regionCounterSummary() as a table
+RKCOMMON_INTERFACE std::string regionCounterReport();
+
+// Stream the trace to 'traceFile' in the compact binary format instead of
+// keeping it in memory: a background thread appends the events recorded so
+// far every 'intervalMs' milliseconds and recycles their memory, so memory
+// use stays bounded and the file holds all but the last interval's events
+// if the process crashes. The format is a header ("RKTRACE1", the process
+// ID and name) followed by string, thread name and event records; events
+// are fixed size and refer to earlier string records by ID. Live traces add
+// records of dropped events.
+RKCOMMON_INTERFACE void startTraceStream(
+    const char *traceFile, const char *processName, int intervalMs = 100);
+
+// Write the remaining events and close the stream, also a live trace
+RKCOMMON_INTERFACE void stopTraceStream();
+
+// Stream the trace live, in the format of startTraceStream(), to a viewer
+// listening at 'address' ("host:port" or "unix:/path/to/socket"), e.g.,
+// "nc -l 9000 > trace.bin" on a workstation, to watch a remote render node
+// through convertTraceToJson(). Each interval sends what the connection
+// takes without blocking; once more than a few MB wait for a slow viewer,
+// the events of the interval are dropped instead, leaving a record of the
+// gap, rather than stalling the stream thread and the memory it recycles
+RKCOMMON_INTERFACE void startLiveTrace(
+    const char *address, const char *processName, int intervalMs = 100);
+
+// The events the current or last live trace dropped
+RKCOMMON_INTERFACE uint64_t droppedLiveTraceEvents();
+
+// Flight recorder mode: keep only the last 'eventsPerThread' (or a few
+// thousand more) events of each thread, so that tracing can stay on in long
+// running processes at a constant cost in memory and time per event. Each
+// thread reuses the chunks of its oldest events for new ones once it holds
+// enough. dumpRecent() writes what they hold, e.g., when a frame took too
+// long; call it from a regular thread, a signal handler should only flag it.
+// Trace streams and the flight recorder exclude each other
+RKCOMMON_INTERFACE void startFlightRecorder(size_t eventsPerThread = 1 << 20);
+
+// Keep all events again, starting from the ones held now
+RKCOMMON_INTERFACE void stopFlightRecorder();
+
+// Write the events held in memory as Chrome JSON, like saveLog(), leaving out
+// the end events whose begin the flight recorder already dropped
+RKCOMMON_INTERFACE void dumpRecent(
+    const char *logFile, const char *processName = nullptr);
+
+// Convert a binary trace, also one cut short by a crash, to the Chrome JSON
+// that saveLog() writes, for chrome://tracing or ui.perfetto.dev
+RKCOMMON_INTERFACE void convertTraceToJson(
+    const char *traceFile, const char *jsonFile);
+
+// An event for the lifetime of the scope, see also RKCOMMON_TRACE_SCOPE
+class TraceScope
+{
+ public:
+  struct Interned
+  {
+  };
+
+  explicit TraceScope(const char *name, const char *category = nullptr)
+  {
+    beginEvent(name, category);
+  }
+
+  // For an internString() 'name' and 'category'
+  TraceScope(Interned, const char *name, const char *category = nullptr)
+  {
+    beginInternedEvent(name, category);
+  }
+
+  ~TraceScope()
+  {
+    endEvent();
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+};
+
 } // namespace tracing
 } // namespace rkcommon
 
+#define RKCOMMON_TRACE_CONCAT_(A, B) A##B
+#define RKCOMMON_TRACE_CONCAT(A, B) RKCOMMON_TRACE_CONCAT_(A, B)
+
 #ifdef RKCOMMON_ENABLE_PROFILING
 
 #define RKCOMMON_IF_TRACING_ENABLED(CMD) CMD
 
+// Trace the rest of the enclosing scope as the event NAME, a string which is
+// interned once, on first use, through a static local
+#define RKCOMMON_TRACE_SCOPE(NAME)                                         \
+  static const char *const RKCOMMON_TRACE_CONCAT(rkTraceName_, __LINE__) = \
+      rkcommon::tracing::internString(NAME);                               \
+  rkcommon::tracing::TraceScope RKCOMMON_TRACE_CONCAT(rkTraceScope_,       \
+      __LINE__)(rkcommon::tracing::TraceScope::Interned(),                 \
+      RKCOMMON_TRACE_CONCAT(rkTraceName_, __LINE__))
+
 #else
 
 #define RKCOMMON_IF_TRACING_ENABLED(CMD)
 
+#define RKCOMMON_TRACE_SCOPE(NAME)
+
 #endif
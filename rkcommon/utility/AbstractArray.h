@@ -4,6 +4,7 @@
 #pragma once
 
 #include "../common.h"
+#include "../memory/malloc.h"
 
 #include <array>
 #include <stdexcept>
@@ -31,6 +32,12 @@ namespace rkcommon {
 
       T *data() const;
 
+      /*! Where the data lives for GPU offload: device accessible data
+          (see memory::deviceAlignedMalloc()) can be used by the device as
+          it is, PAGEABLE data has to be staged for uploads. */
+      virtual memory::DeviceMemory deviceMemory() const;
+      bool isDeviceAccessible() const;
+
       T *begin() const;
       T *end() const;
 
@@ -90,6 +97,18 @@ namespace rkcommon {
       return begin();
     }
 
+    template <typename T>
+    inline memory::DeviceMemory AbstractArray<T>::deviceMemory() const
+    {
+      return memory::DeviceMemory::PAGEABLE;
+    }
+
+    template <typename T>
+    inline bool AbstractArray<T>::isDeviceAccessible() const
+    {
+      return deviceMemory() != memory::DeviceMemory::PAGEABLE;
+    }
+
     template <typename T>
     inline T *AbstractArray<T>::begin() const
     {
@@ -4,8 +4,13 @@
 #pragma once
 
 #include <string.h>
+#include <cstddef>
 #include <iostream>
+#include <new>
 #include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <typeinfo>
 
 #include "../common.h"
 #include "../traits/rktraits.h"
@@ -28,17 +33,26 @@ namespace rkcommon {
      */
     struct Any
     {
+     private:
+      // Keeps Any out of the converting constructor and assignment
+      template <typename T>
+      using NotAny = typename std::enable_if<
+          !std::is_same<typename std::decay<T>::type, Any>::value>::type;
+
+     public:
       Any() = default;
       Any(const Any &copy);
+      Any(Any &&other) noexcept;
 
-      template <typename T>
+      template <typename T, typename = NotAny<T>>
       Any(T value);
 
-      ~Any() = default;
+      ~Any();
 
       Any &operator=(const Any &rhs);
+      Any &operator=(Any &&rhs) noexcept;
 
-      template <typename T>
+      template <typename T, typename = NotAny<T>>
       Any &operator=(T rhs);
 
       bool operator==(const Any &rhs) const;
@@ -60,84 +74,151 @@ namespace rkcommon {
      private:
       // Helper types //
 
-      struct handle_base
+      // Values up to the size of an AffineSpace3f are stored inline
+      static constexpr size_t inlineSize  = 48;
+      static constexpr size_t inlineAlign = 16;
+
+      // What the held type does, one table per type instead of a virtual
+      // handle per value
+      struct Ops
       {
-        virtual ~handle_base()                            = default;
-        virtual handle_base *clone() const                = 0;
-        virtual const std::type_info &valueTypeID() const = 0;
-        virtual bool isSame(handle_base *other) const     = 0;
-        virtual void *data()                              = 0;
+        const std::type_info &(*valueTypeID)();
+        // Construct the value of 'dst' from the one of 'src'
+        void (*copy)(Any &dst, const Any &src);
+        // Take over the value of 'src', which is left destroyed
+        void (*move)(Any &dst, Any &src) noexcept;
+        void (*destroy)(Any &any) noexcept;
+        // Of two values of this type
+        bool (*equals)(const Any &a, const Any &b);
+        bool inlined;
       };
 
       template <typename T>
-      struct handle : public handle_base
+      struct OpsFor
       {
-        handle(T value);
-        handle_base *clone() const override;
-        const std::type_info &valueTypeID() const override;
-        bool isSame(handle_base *other) const override;
-        void *data() override;
-        T value;
+        static constexpr bool inlined = sizeof(T) <= inlineSize
+            && alignof(T) <= inlineAlign
+            && std::is_nothrow_move_constructible<T>::value;
+
+        static T *value(Any &any);
+        static const T *value(const Any &any);
+
+        template <typename V>
+        static void construct(Any &any, V &&v);
+
+        static const std::type_info &valueTypeID();
+        static void copy(Any &dst, const Any &src);
+        static void move(Any &dst, Any &src) noexcept;
+        static void destroy(Any &any) noexcept;
+        static bool equals(const Any &a, const Any &b);
 
         // NOTE(jda) - Use custom type trait to select a real implementation of
-        //             isSame(), or one that always returns 'false' if the
+        //             equals(), or one that always returns 'false' if the
         //             template type 'T' does not implement operator==() with
         //             itself.
         template <typename TYPE>
-        inline traits::HasOperatorEquals<TYPE, bool>  //<-- substitues to 'bool'
-        isSameImpl(handle_base *other) const;
+        static traits::HasOperatorEquals<TYPE, bool>  //<-- substitues to 'bool'
+        equalsImpl(const Any &a, const Any &b);
 
         template <typename TYPE>
-        inline traits::NoOperatorEquals<TYPE, bool>  //<-- substitutes to 'bool'
-        isSameImpl(handle_base *other) const;
+        static traits::NoOperatorEquals<TYPE, bool>  //<-- substitutes to 'bool'
+        equalsImpl(const Any &a, const Any &b);
+
+        static const Ops table;
       };
 
+      template <typename T>
+      [[noreturn]] void throwIncorrectType() const;
+
+      void reset();
+
       // Data members //
 
-      std::unique_ptr<handle_base> currentValue;
+      const Ops *ops{nullptr};
+
+      union
+      {
+        alignas(inlineAlign) unsigned char buffer[inlineSize];
+        void *heap;
+      };
     };
 
     // Inlined Any definitions ////////////////////////////////////////////////
 
-    template <typename T>
+    template <typename T, typename>
     inline Any::Any(T value)
-        : currentValue(new handle<typename std::remove_reference<T>::type>(
-              std::forward<T>(value)))
     {
       static_assert(std::is_copy_constructible<T>::value &&
                         std::is_copy_assignable<T>::value,
                     "Any can only be constructed with copyable values!");
+      OpsFor<T>::construct(*this, std::move(value));
     }
 
     inline Any::Any(const Any &copy)
-        : currentValue(copy.valid() ? copy.currentValue->clone() : nullptr)
     {
+      if (copy.ops) {
+        copy.ops->copy(*this, copy);
+        ops = copy.ops;
+      }
+    }
+
+    inline Any::Any(Any &&other) noexcept
+    {
+      if (other.ops) {
+        other.ops->move(*this, other);
+        ops       = other.ops;
+        other.ops = nullptr;
+      }
+    }
+
+    inline Any::~Any()
+    {
+      reset();
     }
 
     inline Any &Any::operator=(const Any &rhs)
     {
-      Any temp(rhs);
-      currentValue = std::move(temp.currentValue);
+      if (this != &rhs) {
+        Any temp(rhs);
+        *this = std::move(temp);
+      }
       return *this;
     }
 
-    template <typename T>
+    inline Any &Any::operator=(Any &&rhs) noexcept
+    {
+      if (this != &rhs) {
+        reset();
+        if (rhs.ops) {
+          rhs.ops->move(*this, rhs);
+          ops     = rhs.ops;
+          rhs.ops = nullptr;
+        }
+      }
+      return *this;
+    }
+
+    template <typename T, typename>
     inline Any &Any::operator=(T rhs)
     {
       static_assert(std::is_copy_constructible<T>::value &&
                         std::is_copy_assignable<T>::value,
                     "Any can only be assigned values which are copyable!");
 
-      currentValue = std::unique_ptr<handle_base>(
-          new handle<typename std::remove_reference<T>::type>(
-              std::forward<T>(rhs)));
+      reset();
+      OpsFor<T>::construct(*this, std::move(rhs));
 
       return *this;
     }
 
     inline bool Any::operator==(const Any &rhs) const
     {
-      return currentValue->isSame(rhs.currentValue.get());
+      if (!ops || !rhs.ops)
+        return !ops && !rhs.ops;
+      return (ops == rhs.ops
+              || strcmp(ops->valueTypeID().name(),
+                        rhs.ops->valueTypeID().name()) == 0)
+             && ops->equals(*this, rhs);
     }
 
     inline bool Any::operator!=(const Any &rhs) const
@@ -148,103 +229,150 @@ namespace rkcommon {
     template <typename T>
     inline T &Any::get()
     {
-      if (!valid())
-        throw std::runtime_error("Can't query value from an empty Any!");
-
-      if (is<T>())
-        return *(static_cast<T *>(currentValue->data()));
-      else {
-        std::stringstream msg;
-        msg << "Incorrect type queried for Any!" << '\n';
-        msg << "  queried type == " << nameOf<T>() << '\n';
-        msg << "  current type == "
-            << demangle(currentValue->valueTypeID().name()) << '\n';
-        throw std::runtime_error(msg.str());
-      }
+      // the table of T, unless another library holds an instance of its own
+      if (ops != &OpsFor<T>::table && !is<T>())
+        throwIncorrectType<T>();
+      return *OpsFor<T>::value(*this);
     }
 
     template <typename T>
     inline const T &Any::get() const
+    {
+      if (ops != &OpsFor<T>::table && !is<T>())
+        throwIncorrectType<T>();
+      return *OpsFor<T>::value(*this);
+    }
+
+    template <typename T>
+    inline void Any::throwIncorrectType() const
     {
       if (!valid())
         throw std::runtime_error("Can't query value from an empty Any!");
 
-      if (is<T>())
-        return *(static_cast<T *>(currentValue->data()));
-      else {
-        std::stringstream msg;
-        msg << "Incorrect type queried for Any!" << '\n';
-        msg << "  queried type == " << nameOf<T>() << '\n';
-        msg << "  current type == "
-            << demangle(currentValue->valueTypeID().name()) << '\n';
-        throw std::runtime_error(msg.str());
-      }
+      std::stringstream msg;
+      msg << "Incorrect type queried for Any!" << '\n';
+      msg << "  queried type == " << typeName<T>() << '\n';
+      msg << "  current type == " << demangledName(ops->valueTypeID())
+          << '\n';
+      throw std::runtime_error(msg.str());
     }
 
     template <typename T>
     inline bool Any::is() const
     {
-      return valid() && (strcmp(typeid(T).name(),
-                                currentValue->valueTypeID().name()) == 0);
+      return ops == &OpsFor<T>::table
+             || (valid()
+                 && strcmp(typeid(T).name(), ops->valueTypeID().name()) == 0);
     }
 
     inline bool Any::valid() const
     {
-      return currentValue.get() != nullptr;
+      return ops != nullptr;
     }
 
     inline std::string Any::toString() const
     {
       std::stringstream retval;
       retval << "Any : (currently holds value of type) --> "
-             << demangle(currentValue->valueTypeID().name());
+             << demangledName(ops->valueTypeID());
       return retval.str();
     }
 
+    inline void Any::reset()
+    {
+      if (ops) {
+        ops->destroy(*this);
+        ops = nullptr;
+      }
+    }
+
+    template <typename T>
+    const Any::Ops Any::OpsFor<T>::table = {&OpsFor<T>::valueTypeID,
+                                            &OpsFor<T>::copy,
+                                            &OpsFor<T>::move,
+                                            &OpsFor<T>::destroy,
+                                            &OpsFor<T>::equals,
+                                            OpsFor<T>::inlined};
+
+    template <typename T>
+    inline T *Any::OpsFor<T>::value(Any &any)
+    {
+      return static_cast<T *>(inlined ? (void *)any.buffer : any.heap);
+    }
+
     template <typename T>
-    inline Any::handle<T>::handle(T v) : value(std::move(v))
+    inline const T *Any::OpsFor<T>::value(const Any &any)
     {
+      return static_cast<const T *>(inlined ? (const void *)any.buffer
+                                            : any.heap);
     }
 
     template <typename T>
-    inline Any::handle_base *Any::handle<T>::clone() const
+    template <typename V>
+    inline void Any::OpsFor<T>::construct(Any &any, V &&v)
     {
-      return new handle<T>(value);
+      if (inlined)
+        new (any.buffer) T(std::forward<V>(v));
+      else
+        any.heap = new T(std::forward<V>(v));
+      any.ops = &table;
     }
 
     template <typename T>
-    inline const std::type_info &Any::handle<T>::valueTypeID() const
+    inline const std::type_info &Any::OpsFor<T>::valueTypeID()
     {
       return typeid(T);
     }
 
     template <typename T>
-    inline bool Any::handle<T>::isSame(Any::handle_base *other) const
+    inline void Any::OpsFor<T>::copy(Any &dst, const Any &src)
     {
-      return isSameImpl<T>(other);
+      if (inlined)
+        new (dst.buffer) T(*value(src));
+      else
+        dst.heap = new T(*value(src));
     }
 
     template <typename T>
-    template <typename TYPE>
-    inline traits::HasOperatorEquals<TYPE, bool> Any::handle<T>::isSameImpl(
-        Any::handle_base *other) const
+    inline void Any::OpsFor<T>::move(Any &dst, Any &src) noexcept
+    {
+      if (inlined) {
+        new (dst.buffer) T(std::move(*value(src)));
+        value(src)->~T();
+      } else {
+        dst.heap = src.heap;
+      }
+    }
+
+    template <typename T>
+    inline void Any::OpsFor<T>::destroy(Any &any) noexcept
+    {
+      if (inlined)
+        value(any)->~T();
+      else
+        delete value(any);
+    }
+
+    template <typename T>
+    inline bool Any::OpsFor<T>::equals(const Any &a, const Any &b)
     {
-      handle<T> *otherHandle = dynamic_cast<handle<T> *>(other);
-      return (otherHandle != nullptr) && (otherHandle->value == this->value);
+      return equalsImpl<T>(a, b);
     }
 
     template <typename T>
     template <typename TYPE>
-    inline traits::NoOperatorEquals<TYPE, bool> Any::handle<T>::isSameImpl(
-        Any::handle_base *) const
+    inline traits::HasOperatorEquals<TYPE, bool> Any::OpsFor<T>::equalsImpl(
+        const Any &a, const Any &b)
     {
-      return false;
+      return *value(a) == *value(b);
     }
 
     template <typename T>
-    inline void *Any::handle<T>::data()
+    template <typename TYPE>
+    inline traits::NoOperatorEquals<TYPE, bool> Any::OpsFor<T>::equalsImpl(
+        const Any &, const Any &)
     {
-      return &value;
+      return false;
     }
 
   }  // namespace utility
@@ -17,6 +17,13 @@
 
 #pragma once
 
+#include "../math/box.h"
+#include "StringView.h"
+// std
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <string>
 #include <vector>
 
@@ -71,6 +78,132 @@ namespace rkcommon {
       void parseAndRemove(ArgumentList &args);
     };
 
+    /*! What went wrong parsing arguments without exceptions; see
+      ArgumentStatus */
+    enum class ArgumentError
+    {
+      NONE,
+      //! more tokens or options than the table holds
+      TOO_MANY,
+      //! a quote which is not closed
+      UNTERMINATED_QUOTE,
+      //! an option which is not bound
+      UNKNOWN_OPTION,
+      //! an option followed by fewer values than it takes
+      MISSING_VALUE,
+      //! a value which does not parse as the bound type
+      INVALID_VALUE
+    };
+
+    /*! the outcome of tokenizing or parsing, with the index of the
+      offending token (or character, for tokenizing) on errors */
+    struct ArgumentStatus
+    {
+      ArgumentError error{ArgumentError::NONE};
+      size_t index{0};
+
+      explicit operator bool() const
+      {
+        return error == ArgumentError::NONE;
+      }
+
+      const char *message() const;
+    };
+
+    /*! splits a string of options into whitespace separated tokens,
+      kept as views of the string in a table of fixed size, e.g.
+
+        ArgumentTokens<32> tokens;
+        if (!tokens.tokenize(request.options)) ...
+
+      Tokens in single or double quotes may contain whitespace; the
+      quotes are not part of the token. Nothing is allocated, so the
+      string has to outlive the tokens. */
+    template <size_t MAX_TOKENS>
+    struct ArgumentTokens
+    {
+      ArgumentStatus tokenize(StringView text);
+
+      //! views the arguments of main(), dropping av[0]
+      ArgumentStatus assign(int ac, const char **av);
+
+      size_t size() const;
+      bool empty() const;
+
+      StringView operator[](size_t idx) const;
+
+      const StringView *begin() const;
+      const StringView *end() const;
+
+     private:
+      StringView tokens[MAX_TOKENS];
+      size_t numTokens{0};
+    };
+
+    /*! binds options ("-spp", "--bounds", ...) to typed values which
+      parse() stores the values following each option to, e.g.
+
+        int spp = 1;
+        vec3f eye;
+        OptionTable<8> options;
+        options.bind("-spp", spp);
+        options.bind("--eye", eye);
+        ...
+        const ArgumentStatus status = options.parse(tokens);
+        if (!status) ... status.message() ... tokens[status.index] ...
+
+      Options take one value per component: "--eye 0 1 2". bool
+      options are flags without a value. Tokens not starting with '-'
+      (or being a number) are positional and collected up to the table
+      size; see positional(). Parsing neither allocates nor throws. */
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL = 8>
+    struct OptionTable
+    {
+      //! false if the table is full
+      bool bind(StringView name, bool &flag);
+      bool bind(StringView name, int &value);
+      bool bind(StringView name, float &value);
+      bool bind(StringView name, StringView &value);
+      bool bind(StringView name, math::vec3f &value);
+      bool bind(StringView name, math::box3f &value);
+
+      //! Values of options already parsed are kept on errors
+      ArgumentStatus parse(const StringView *tokens, size_t numTokens);
+
+      template <size_t MAX_TOKENS>
+      ArgumentStatus parse(const ArgumentTokens<MAX_TOKENS> &tokens);
+
+      size_t numPositional() const;
+      StringView positional(size_t idx) const;
+
+     private:
+      enum class Kind
+      {
+        FLAG,
+        INT,
+        FLOAT,
+        STRING,
+        VEC3F,
+        BOX3F
+      };
+
+      struct Option
+      {
+        StringView name;
+        Kind kind;
+        void *value;
+      };
+
+      bool add(StringView name, Kind kind, void *value);
+      const Option *find(StringView name) const;
+
+      Option options[MAX_OPTIONS];
+      size_t numOptions{0};
+
+      StringView positionals[MAX_POSITIONAL];
+      size_t numPositionals{0};
+    };
+
     // ------------------------------------------------------------------
     // (header-only) implementatoin section from here on:
     // ------------------------------------------------------------------
@@ -113,5 +246,333 @@ namespace rkcommon {
       }
     }
 
+    inline const char *ArgumentStatus::message() const
+    {
+      switch (error) {
+      case ArgumentError::NONE:
+        return "no error";
+      case ArgumentError::TOO_MANY:
+        return "too many arguments";
+      case ArgumentError::UNTERMINATED_QUOTE:
+        return "unterminated quote";
+      case ArgumentError::UNKNOWN_OPTION:
+        return "unknown option";
+      case ArgumentError::MISSING_VALUE:
+        return "missing option value";
+      case ArgumentError::INVALID_VALUE:
+        return "invalid option value";
+      }
+      return "unknown error";
+    }
+
+    namespace detail {
+
+      inline bool isArgumentSpace(char c)
+      {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+      }
+
+      // strto*() need terminated strings, so values are copied to 'buf'
+      inline bool terminateArgument(StringView s, char (&buf)[64])
+      {
+        if (s.empty() || s.size() >= sizeof(buf))
+          return false;
+        std::copy(s.begin(), s.end(), buf);
+        buf[s.size()] = '\0';
+        return true;
+      }
+
+      inline bool parseArgument(StringView s, int &value)
+      {
+        char buf[64];
+        if (!terminateArgument(s, buf))
+          return false;
+        char *end    = nullptr;
+        errno        = 0;
+        const long v = std::strtol(buf, &end, 0);
+        if (*end != '\0' || errno == ERANGE || v < INT_MIN || v > INT_MAX)
+          return false;
+        value = int(v);
+        return true;
+      }
+
+      inline bool parseArgument(StringView s, float &value)
+      {
+        char buf[64];
+        if (!terminateArgument(s, buf))
+          return false;
+        char *end = nullptr;
+        value     = std::strtof(buf, &end);
+        return *end == '\0';
+      }
+
+      // "-1" or "-.5" are values rather than options
+      inline bool isOptionName(StringView s)
+      {
+        if (s.size() < 2 || s[0] != '-')
+          return false;
+        const char c = s[1];
+        return !((c >= '0' && c <= '9') || c == '.');
+      }
+
+    }  // namespace detail
+
+    template <size_t MAX_TOKENS>
+    inline ArgumentStatus ArgumentTokens<MAX_TOKENS>::tokenize(StringView text)
+    {
+      ArgumentStatus status;
+      numTokens     = 0;
+      const char *s = text.begin();
+      while (true) {
+        while (s != text.end() && detail::isArgumentSpace(*s))
+          ++s;
+        if (s == text.end())
+          break;
+
+        if (numTokens == MAX_TOKENS) {
+          status.error = ArgumentError::TOO_MANY;
+          status.index = size_t(s - text.begin());
+          break;
+        }
+
+        const char *first = s;
+        if (*s == '"' || *s == '\'') {
+          const char quote = *s++;
+          first            = s;
+          while (s != text.end() && *s != quote)
+            ++s;
+          if (s == text.end()) {
+            status.error = ArgumentError::UNTERMINATED_QUOTE;
+            status.index = size_t(first - 1 - text.begin());
+            break;
+          }
+          tokens[numTokens++] = StringView(first, size_t(s - first));
+          ++s;
+        } else {
+          while (s != text.end() && !detail::isArgumentSpace(*s))
+            ++s;
+          tokens[numTokens++] = StringView(first, size_t(s - first));
+        }
+      }
+      return status;
+    }
+
+    template <size_t MAX_TOKENS>
+    inline ArgumentStatus ArgumentTokens<MAX_TOKENS>::assign(int ac,
+                                                             const char **av)
+    {
+      ArgumentStatus status;
+      numTokens = 0;
+      for (int i = 1; i < ac; i++) {
+        if (numTokens == MAX_TOKENS) {
+          status.error = ArgumentError::TOO_MANY;
+          status.index = numTokens;
+          break;
+        }
+        tokens[numTokens++] = StringView(av[i]);
+      }
+      return status;
+    }
+
+    template <size_t MAX_TOKENS>
+    inline size_t ArgumentTokens<MAX_TOKENS>::size() const
+    {
+      return numTokens;
+    }
+
+    template <size_t MAX_TOKENS>
+    inline bool ArgumentTokens<MAX_TOKENS>::empty() const
+    {
+      return numTokens == 0;
+    }
+
+    template <size_t MAX_TOKENS>
+    inline StringView ArgumentTokens<MAX_TOKENS>::operator[](size_t idx) const
+    {
+      return tokens[idx];
+    }
+
+    template <size_t MAX_TOKENS>
+    inline const StringView *ArgumentTokens<MAX_TOKENS>::begin() const
+    {
+      return tokens;
+    }
+
+    template <size_t MAX_TOKENS>
+    inline const StringView *ArgumentTokens<MAX_TOKENS>::end() const
+    {
+      return tokens + numTokens;
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline bool OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::bind(StringView name,
+                                                               bool &flag)
+    {
+      return add(name, Kind::FLAG, &flag);
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline bool OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::bind(StringView name,
+                                                               int &value)
+    {
+      return add(name, Kind::INT, &value);
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline bool OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::bind(StringView name,
+                                                               float &value)
+    {
+      return add(name, Kind::FLOAT, &value);
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline bool OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::bind(
+        StringView name, StringView &value)
+    {
+      return add(name, Kind::STRING, &value);
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline bool OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::bind(
+        StringView name, math::vec3f &value)
+    {
+      return add(name, Kind::VEC3F, &value);
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline bool OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::bind(
+        StringView name, math::box3f &value)
+    {
+      return add(name, Kind::BOX3F, &value);
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline ArgumentStatus OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::parse(
+        const StringView *tokens, size_t numTokens)
+    {
+      ArgumentStatus status;
+      numPositionals = 0;
+
+      for (size_t i = 0; i < numTokens; ++i) {
+        status.index = i;
+
+        if (!detail::isOptionName(tokens[i])) {
+          if (numPositionals == MAX_POSITIONAL) {
+            status.error = ArgumentError::TOO_MANY;
+            return status;
+          }
+          positionals[numPositionals++] = tokens[i];
+          continue;
+        }
+
+        const Option *option = find(tokens[i]);
+        if (!option) {
+          status.error = ArgumentError::UNKNOWN_OPTION;
+          return status;
+        }
+
+        size_t numValues = 1;
+        if (option->kind == Kind::FLAG)
+          numValues = 0;
+        else if (option->kind == Kind::VEC3F)
+          numValues = 3;
+        else if (option->kind == Kind::BOX3F)
+          numValues = 6;
+
+        if (numTokens - i - 1 < numValues) {
+          status.error = ArgumentError::MISSING_VALUE;
+          return status;
+        }
+
+        // parse all components before storing any
+        float f[6];
+        int integer  = 0;
+        bool valid   = true;
+        const auto v = tokens + i + 1;
+        switch (option->kind) {
+        case Kind::FLAG:
+          *static_cast<bool *>(option->value) = true;
+          break;
+        case Kind::INT:
+          valid = detail::parseArgument(v[0], integer);
+          if (valid)
+            *static_cast<int *>(option->value) = integer;
+          break;
+        case Kind::FLOAT:
+        case Kind::VEC3F:
+        case Kind::BOX3F:
+          for (size_t c = 0; c < numValues && valid; ++c)
+            valid = detail::parseArgument(v[c], f[c]);
+          if (!valid)
+            break;
+          if (option->kind == Kind::FLOAT)
+            *static_cast<float *>(option->value) = f[0];
+          else if (option->kind == Kind::VEC3F)
+            *static_cast<math::vec3f *>(option->value) =
+                math::vec3f(f[0], f[1], f[2]);
+          else
+            *static_cast<math::box3f *>(option->value) = math::box3f(
+                math::vec3f(f[0], f[1], f[2]), math::vec3f(f[3], f[4], f[5]));
+          break;
+        case Kind::STRING:
+          *static_cast<StringView *>(option->value) = v[0];
+          break;
+        }
+
+        if (!valid) {
+          status.error = ArgumentError::INVALID_VALUE;
+          return status;
+        }
+        i += numValues;
+      }
+
+      status.index = 0;
+      return status;
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    template <size_t MAX_TOKENS>
+    inline ArgumentStatus OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::parse(
+        const ArgumentTokens<MAX_TOKENS> &tokens)
+    {
+      return parse(tokens.begin(), tokens.size());
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline size_t OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::numPositional()
+        const
+    {
+      return numPositionals;
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline StringView OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::positional(
+        size_t idx) const
+    {
+      return positionals[idx];
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline bool OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::add(StringView name,
+                                                              Kind kind,
+                                                              void *value)
+    {
+      if (numOptions == MAX_OPTIONS)
+        return false;
+      options[numOptions++] = Option{name, kind, value};
+      return true;
+    }
+
+    template <size_t MAX_OPTIONS, size_t MAX_POSITIONAL>
+    inline auto OptionTable<MAX_OPTIONS, MAX_POSITIONAL>::find(
+        StringView name) const -> const Option *
+    {
+      for (size_t i = 0; i < numOptions; ++i) {
+        if (options[i].name == name)
+          return &options[i];
+      }
+      return nullptr;
+    }
+
   }  // namespace utility
 }  // namespace rkcommon
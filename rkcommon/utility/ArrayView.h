@@ -14,7 +14,8 @@ namespace rkcommon {
 
     /*  'ArrayView<T>' implements an array interface on a pointer to data which
      *  is *NOT* owned by ArrayView. If you want ArrayView to own data, then
-     *  instead use std::array<T> or std::vector<T>.
+     *  instead use std::array<T> or std::vector<T>. A view on device
+     *  accessible memory is tagged with its memory::DeviceMemory kind.
      */
     template <typename T>
     struct ArrayView : public AbstractArray<T>
@@ -27,21 +28,34 @@ namespace rkcommon {
 
       ArrayView(std::vector<T> &init);
 
-      explicit ArrayView(T *data, size_t size);
+      explicit ArrayView(
+          T *data,
+          size_t size,
+          memory::DeviceMemory kind = memory::DeviceMemory::PAGEABLE);
 
       void reset();
-      void reset(T *data, size_t size);
+      void reset(T *data,
+                 size_t size,
+                 memory::DeviceMemory kind = memory::DeviceMemory::PAGEABLE);
 
       template <size_t SIZE>
       ArrayView &operator=(std::array<T, SIZE> &rhs);
 
       ArrayView &operator=(std::vector<T> &rhs);
+
+      memory::DeviceMemory deviceMemory() const override;
+
+     private:
+      memory::DeviceMemory kind{memory::DeviceMemory::PAGEABLE};
     };
 
     // Inlined ArrayView definitions //////////////////////////////////////////
 
     template <typename T>
-    inline ArrayView<T>::ArrayView(T *_data, size_t _size)
+    inline ArrayView<T>::ArrayView(T *_data,
+                                   size_t _size,
+                                   memory::DeviceMemory _kind)
+        : kind(_kind)
     {
       AbstractArray<T>::setPtr(_data, _size);
     }
@@ -63,12 +77,16 @@ namespace rkcommon {
     inline void ArrayView<T>::reset()
     {
       AbstractArray<T>::setPtr(nullptr, 0);
+      kind = memory::DeviceMemory::PAGEABLE;
     }
 
     template <typename T>
-    inline void ArrayView<T>::reset(T *_data, size_t _size)
+    inline void ArrayView<T>::reset(T *_data,
+                                    size_t _size,
+                                    memory::DeviceMemory _kind)
     {
       AbstractArray<T>::setPtr(_data, _size);
+      kind = _kind;
     }
 
     template <typename T>
@@ -76,6 +94,7 @@ namespace rkcommon {
     inline ArrayView<T> &ArrayView<T>::operator=(std::array<T, SIZE> &rhs)
     {
       AbstractArray<T>::setPtr(rhs.data(), rhs.size());
+      kind = memory::DeviceMemory::PAGEABLE;
       return *this;
     }
 
@@ -83,9 +102,16 @@ namespace rkcommon {
     inline ArrayView<T> &ArrayView<T>::operator=(std::vector<T> &rhs)
     {
       AbstractArray<T>::setPtr(rhs.data(), rhs.size());
+      kind = memory::DeviceMemory::PAGEABLE;
       return *this;
     }
 
+    template <typename T>
+    inline memory::DeviceMemory ArrayView<T>::deviceMemory() const
+    {
+      return kind;
+    }
+
     // ArrayView utility functions ////////////////////////////////////////////
 
     template <typename T>
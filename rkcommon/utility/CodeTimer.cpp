@@ -0,0 +1,70 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "CodeTimer.h"
+// std
+#include <thread>
+
+#if defined(__X86_64__) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+namespace rkcommon {
+  namespace utility {
+    namespace detail {
+
+      // CPUID.80000007H:EDX[8], the TSC runs at a constant rate in all P-,
+      // C- and T-states
+      static bool tscIsInvariant()
+      {
+#ifdef __X86_64__
+        unsigned int regs[4] = {};
+#ifdef _MSC_VER
+        __cpuid(reinterpret_cast<int *>(regs), int(0x80000000));
+        if (regs[0] < 0x80000007)
+          return false;
+        __cpuid(reinterpret_cast<int *>(regs), int(0x80000007));
+#else
+        __cpuid(0x80000000, regs[0], regs[1], regs[2], regs[3]);
+        if (regs[0] < 0x80000007)
+          return false;
+        __cpuid(0x80000007, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        return (regs[3] >> 8) & 1;
+#else
+        return false;
+#endif
+      }
+
+      static double calibrateTSC()
+      {
+#if defined(__aarch64__) && !defined(_MSC_VER)
+        // the generic timer reports its frequency
+        uint64_t frequency;
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+        return frequency ? 1e9 / double(frequency) : 0.0;
+#else
+        if (!tscIsInvariant())
+          return 0.0;
+
+        using namespace std::chrono;
+        const auto startTime     = steady_clock::now();
+        const uint64_t startTick = readTSC();
+        std::this_thread::sleep_for(milliseconds(10));
+        const uint64_t ticks = readTSC() - startTick;
+        const auto elapsed   = steady_clock::now() - startTime;
+        return ticks ? double(duration_cast<nanoseconds>(elapsed).count())
+                / double(ticks)
+                     : 0.0;
+#endif
+      }
+
+      double tscNanosecondsPerTick()
+      {
+        static const double nsPerTick = calibrateTSC();
+        return nsPerTick;
+      }
+
+    }  // namespace detail
+  }  // namespace utility
+}  // namespace rkcommon
@@ -3,17 +3,70 @@
 
 #pragma once
 
+#include "../common.h"
+#include "LatencyHistogram.h"
 // std
 #include <chrono>
+#include <cstdint>
+
+#ifdef __X86_64__
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
 
 namespace rkcommon {
   namespace utility {
 
+    // The clocks a CodeTimer can read
+    enum class TimerClock
+    {
+      // std::chrono::steady_clock
+      STEADY,
+      // The CPU's time stamp counter where it ticks at a constant rate (the
+      // invariant TSC on x86, the generic timer on ARM64), a fraction of the
+      // cost of steady_clock for sub-microsecond regions; STEADY elsewhere
+      TSC
+    };
+
+    namespace detail {
+
+      // Nanoseconds per tick of the time stamp counter, 0 if it does not
+      // tick at a constant rate; calibrated against steady_clock on the
+      // first call, which takes 10ms on x86
+      RKCOMMON_INTERFACE double tscNanosecondsPerTick();
+
+      inline uint64_t readTSC()
+      {
+#ifdef __X86_64__
+        return __rdtsc();
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+        uint64_t ticks;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return 0;
+#endif
+      }
+
+    }  // namespace detail
+
     /*! Helper class that assists with timing a region of code. */
     struct CodeTimer
     {
+      CodeTimer() = default;
+
+      // Also record the duration of every stop() and lap() in 'histogram',
+      // which must outlive the timer, e.g. for the p99 frame time
+      explicit CodeTimer(LatencyHistogram *histogram,
+                         TimerClock clock = TimerClock::STEADY);
+
       void start();
       void stop();
+      // stop() and start() the next region at the same time, e.g. per frame
+      void lap();
 
       double seconds() const;
       double milliseconds() const;
@@ -23,39 +76,68 @@ namespace rkcommon {
       double millisecondsSmoothed() const;
       double perSecondSmoothed() const;
 
+      // The histogram given to the constructor, nullptr if none
+      LatencyHistogram *histogram() const;
+
      private:
+      uint64_t now() const;
+
       double smooth_nom{0.0};
       double smooth_den{0.0};
 
-      std::chrono::time_point<std::chrono::steady_clock> frameEndTime;
-      std::chrono::time_point<std::chrono::steady_clock> frameStartTime;
+      // in nanoseconds of steady_clock, or in ticks of the TSC
+      uint64_t frameEndTime{0};
+      uint64_t frameStartTime{0};
+      double nsPerTick{1.0};
+      bool useTSC{false};
+
+      LatencyHistogram *latencies{nullptr};
     };
 
     // Inlined CodeTimer definitions //////////////////////////////////////////
 
+    inline CodeTimer::CodeTimer(LatencyHistogram *histogram, TimerClock clock)
+        : latencies(histogram)
+    {
+      if (clock == TimerClock::TSC) {
+        const double tscPeriod = detail::tscNanosecondsPerTick();
+        useTSC                 = tscPeriod > 0.0;
+        nsPerTick              = useTSC ? tscPeriod : 1.0;
+      }
+    }
+
     inline void CodeTimer::start()
     {
-      frameStartTime = std::chrono::steady_clock::now();
+      frameStartTime = now();
     }
 
     inline void CodeTimer::stop()
     {
-      frameEndTime = std::chrono::steady_clock::now();
+      frameEndTime = now();
 
       smooth_nom  = smooth_nom * 0.8f + seconds();
       smooth_den  = smooth_den * 0.8f + 1.f;
+
+      if (latencies) {
+        latencies->record(
+            uint64_t(double(frameEndTime - frameStartTime) * nsPerTick));
+      }
+    }
+
+    inline void CodeTimer::lap()
+    {
+      stop();
+      frameStartTime = frameEndTime;
     }
 
     inline double CodeTimer::seconds() const
     {
-      auto diff = frameEndTime - frameStartTime;
-      return std::chrono::duration<double>(diff).count();
+      return double(frameEndTime - frameStartTime) * nsPerTick * 1e-9;
     }
 
     inline double CodeTimer::milliseconds() const
     {
-      auto diff = frameEndTime - frameStartTime;
-      return std::chrono::duration<double, std::milli>(diff).count();
+      return double(frameEndTime - frameStartTime) * nsPerTick * 1e-6;
     }
 
     inline double CodeTimer::perSecond() const
@@ -78,5 +160,19 @@ namespace rkcommon {
       return smooth_den / smooth_nom;
     }
 
+    inline LatencyHistogram *CodeTimer::histogram() const
+    {
+      return latencies;
+    }
+
+    inline uint64_t CodeTimer::now() const
+    {
+      if (useTSC)
+        return detail::readTSC();
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+    }
+
   }  // namespace utility
 }  // namespace rkcommon
@@ -0,0 +1,342 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../math/vec.h"
+#include "Optional.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace rkcommon {
+  namespace utility {
+
+    /* The value a CompactOptional<T> stores for "no value": a struct with
+     *
+     *      static T empty();                // the sentinel
+     *      static bool is_empty(const T &); // true for the sentinel
+     *
+     * Defined here for floating point types (a NaN with a payload which
+     * arithmetic does not produce, so other NaNs are still values), integral
+     * types (their maximum, e.g. for "no index") and vec_t<> of these (by
+     * their x component); specialize it, or pass an own SENTINEL, for other
+     * types.
+     */
+    template <typename T, typename = void>
+    struct compact_optional_sentinel;
+
+    template <typename T>
+    struct compact_optional_sentinel<
+        T,
+        typename std::enable_if<std::is_integral<T>::value>::type>
+    {
+      static T empty()
+      {
+        return std::numeric_limits<T>::max();
+      }
+
+      static bool is_empty(const T &v)
+      {
+        return v == empty();
+      }
+    };
+
+    template <typename T>
+    struct compact_optional_sentinel<
+        T,
+        typename std::enable_if<std::is_floating_point<T>::value>::type>
+    {
+      using bits_t = typename std::
+          conditional<sizeof(T) == sizeof(uint32_t), uint32_t, uint64_t>::type;
+
+      static_assert(sizeof(T) == sizeof(bits_t),
+                    "compact_optional_sentinel<> needs float or double");
+
+      static T empty()
+      {
+        T v;
+        const bits_t bits = emptyBits();
+        std::memcpy(&v, &bits, sizeof(T));
+        return v;
+      }
+
+      static bool is_empty(const T &v)
+      {
+        bits_t bits;
+        std::memcpy(&bits, &v, sizeof(T));
+        return bits == emptyBits();
+      }
+
+     private:
+      // quiet NaNs with a payload
+      static constexpr bits_t emptyBits()
+      {
+        return sizeof(T) == sizeof(uint32_t) ? bits_t(0x7fc0deadu)
+                                             : bits_t(0x7ff800000000deadull);
+      }
+    };
+
+    template <typename T, int N, bool ALIGN, typename E>
+    struct compact_optional_sentinel<math::vec_t<T, N, ALIGN, E>>
+    {
+      using vec_type = math::vec_t<T, N, ALIGN, E>;
+
+      static vec_type empty()
+      {
+        return vec_type(compact_optional_sentinel<T>::empty());
+      }
+
+      static bool is_empty(const vec_type &v)
+      {
+        return compact_optional_sentinel<T>::is_empty(v.x);
+      }
+    };
+
+    /* 'CompactOptional' is Optional<> without the separate flag: "no value"
+     * is stored as a sentinel value of T (see compact_optional_sentinel<>),
+     * so it has the size of T, and is trivially copyable like T. Arrays of
+     * it can be memcpy()'d, and vectors of it are streamed as one block by
+     * networking::DataStreaming.
+     *
+     * The sentinel itself cannot be stored as a value: assigning it empties
+     * the CompactOptional.
+     *
+     *  Example:
+     *
+     *      std::vector<CompactOptional<uint32_t>> parent(n); // all empty
+     *      parent[3] = 0;
+     *      assert(parent[3].value_or(~0u) == 0);
+     */
+    template <typename T, typename SENTINEL = compact_optional_sentinel<T>>
+    struct CompactOptional
+    {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "rkcommon::utility::CompactOptional<T> requires T to be"
+                    " trivially copyable, use Optional<T> otherwise.");
+
+      using value_type = T;
+
+      CompactOptional();
+      CompactOptional(const T &value);
+      CompactOptional(const Optional<T> &other);
+
+      template <typename U,
+                typename = typename std::enable_if<
+                    std::is_convertible<U, T>::value>::type>
+      CompactOptional &operator=(U &&value);
+
+      CompactOptional &operator=(const Optional<T> &other);
+
+      const T *operator->() const;
+      T *operator->();
+
+      const T &operator*() const;
+      T &operator*();
+
+      bool has_value() const;
+      explicit operator bool() const;
+
+      const T &value() const;
+      T &value();
+
+      template <typename U>
+      T value_or(U &&default_value) const;
+
+      void reset();
+
+      template <typename... Args>
+      T &emplace(Args &&... args);
+
+      Optional<T> toOptional() const;
+
+      // Extra members //
+
+      std::string toString() const;
+
+     private:
+      // Data members //
+
+      T storage;
+    };
+
+    // Inlined CompactOptional definitions ////////////////////////////////////
+
+    template <typename T, typename SENTINEL>
+    inline CompactOptional<T, SENTINEL>::CompactOptional()
+        : storage(SENTINEL::empty())
+    {
+    }
+
+    template <typename T, typename SENTINEL>
+    inline CompactOptional<T, SENTINEL>::CompactOptional(const T &value)
+        : storage(value)
+    {
+    }
+
+    template <typename T, typename SENTINEL>
+    inline CompactOptional<T, SENTINEL>::CompactOptional(
+        const Optional<T> &other)
+        : storage(other ? *other : SENTINEL::empty())
+    {
+    }
+
+    template <typename T, typename SENTINEL>
+    template <typename U, typename>
+    inline CompactOptional<T, SENTINEL>
+        &CompactOptional<T, SENTINEL>::operator=(U &&rhs)
+    {
+      storage = std::forward<U>(rhs);
+      return *this;
+    }
+
+    template <typename T, typename SENTINEL>
+    inline CompactOptional<T, SENTINEL>
+        &CompactOptional<T, SENTINEL>::operator=(const Optional<T> &other)
+    {
+      storage = other ? *other : SENTINEL::empty();
+      return *this;
+    }
+
+    template <typename T, typename SENTINEL>
+    inline const T *CompactOptional<T, SENTINEL>::operator->() const
+    {
+      return &value();
+    }
+
+    template <typename T, typename SENTINEL>
+    inline T *CompactOptional<T, SENTINEL>::operator->()
+    {
+      return &value();
+    }
+
+    template <typename T, typename SENTINEL>
+    inline const T &CompactOptional<T, SENTINEL>::operator*() const
+    {
+      return value();
+    }
+
+    template <typename T, typename SENTINEL>
+    inline T &CompactOptional<T, SENTINEL>::operator*()
+    {
+      return value();
+    }
+
+    template <typename T, typename SENTINEL>
+    inline bool CompactOptional<T, SENTINEL>::has_value() const
+    {
+      return !SENTINEL::is_empty(storage);
+    }
+
+    template <typename T, typename SENTINEL>
+    inline CompactOptional<T, SENTINEL>::operator bool() const
+    {
+      return has_value();
+    }
+
+    template <typename T, typename SENTINEL>
+    inline const T &CompactOptional<T, SENTINEL>::value() const
+    {
+      return storage;
+    }
+
+    template <typename T, typename SENTINEL>
+    inline T &CompactOptional<T, SENTINEL>::value()
+    {
+      return storage;
+    }
+
+    template <typename T, typename SENTINEL>
+    template <typename U>
+    inline T CompactOptional<T, SENTINEL>::value_or(U &&default_value) const
+    {
+      static_assert(std::is_convertible<U, T>::value,
+                    "rkcommon::utility::CompactOptional<T> requires the type"
+                    " given to value_or() to be convertible to type T, the"
+                    " type parameter of CompactOptional<>.");
+      return has_value() ? value()
+                         : static_cast<T>(std::forward<U>(default_value));
+    }
+
+    template <typename T, typename SENTINEL>
+    inline void CompactOptional<T, SENTINEL>::reset()
+    {
+      storage = SENTINEL::empty();
+    }
+
+    template <typename T, typename SENTINEL>
+    template <typename... Args>
+    inline T &CompactOptional<T, SENTINEL>::emplace(Args &&... args)
+    {
+      storage = T(std::forward<Args>(args)...);
+      return value();
+    }
+
+    template <typename T, typename SENTINEL>
+    inline Optional<T> CompactOptional<T, SENTINEL>::toOptional() const
+    {
+      return has_value() ? Optional<T>(value()) : Optional<T>();
+    }
+
+    template <typename T, typename SENTINEL>
+    inline std::string CompactOptional<T, SENTINEL>::toString() const
+    {
+      return "rkcommon::utility::CompactOptional<T>";
+    }
+
+    // Comparison functions ///////////////////////////////////////////////////
+
+    template <typename T, typename S, typename U, typename R>
+    inline bool operator==(const CompactOptional<T, S> &lhs,
+                           const CompactOptional<U, R> &rhs)
+    {
+      return (lhs && rhs) && (*lhs == *rhs);
+    }
+
+    template <typename T, typename S, typename U, typename R>
+    inline bool operator!=(const CompactOptional<T, S> &lhs,
+                           const CompactOptional<U, R> &rhs)
+    {
+      return !(lhs == rhs);
+    }
+
+    template <typename T, typename S, typename U, typename R>
+    inline bool operator<(const CompactOptional<T, S> &lhs,
+                          const CompactOptional<U, R> &rhs)
+    {
+      return (lhs && rhs) && (*lhs < *rhs);
+    }
+
+    template <typename T, typename S, typename U, typename R>
+    inline bool operator<=(const CompactOptional<T, S> &lhs,
+                           const CompactOptional<U, R> &rhs)
+    {
+      return (lhs && rhs) && (*lhs <= *rhs);
+    }
+
+    template <typename T, typename S, typename U, typename R>
+    inline bool operator>(const CompactOptional<T, S> &lhs,
+                          const CompactOptional<U, R> &rhs)
+    {
+      return (lhs && rhs) && (*lhs > *rhs);
+    }
+
+    template <typename T, typename S, typename U, typename R>
+    inline bool operator>=(const CompactOptional<T, S> &lhs,
+                           const CompactOptional<U, R> &rhs)
+    {
+      return (lhs && rhs) && (*lhs >= *rhs);
+    }
+
+    template <class T, class... Args>
+    inline CompactOptional<T> make_compact_optional(Args &&... args)
+    {
+      CompactOptional<T> ret;
+      ret.emplace(std::forward<Args>(args)...);
+      return ret;
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
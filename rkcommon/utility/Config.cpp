@@ -0,0 +1,353 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Config.h"
+// std
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+
+namespace rkcommon {
+  namespace utility {
+
+    // All live settings
+    struct ConfigRegistry
+    {
+      std::mutex mutex;
+      std::vector<ConfigSetting *> settings;
+    };
+
+    static ConfigRegistry &registry()
+    {
+      static ConfigRegistry r;
+      return r;
+    }
+
+    // ConfigSetting //
+
+    ConfigSetting::ConfigSetting(const char *name,
+                                 ConfigType type,
+                                 const char *description)
+        : settingName(name), settingType(type), settingDescription(description)
+    {
+      ConfigRegistry &r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.settings.push_back(this);
+    }
+
+    ConfigSetting::~ConfigSetting()
+    {
+      ConfigRegistry &r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.settings.erase(std::remove(r.settings.begin(), r.settings.end(), this),
+                       r.settings.end());
+    }
+
+    const char *ConfigSetting::name() const
+    {
+      return settingName;
+    }
+
+    ConfigType ConfigSetting::type() const
+    {
+      return settingType;
+    }
+
+    const char *ConfigSetting::description() const
+    {
+      return settingDescription;
+    }
+
+    bool ConfigSetting::set(const std::string &text)
+    {
+      return set(text.c_str());
+    }
+
+    bool ConfigSetting::set(const char *text)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!text || !assign(text))
+          return false;
+        overridden = true;
+        loaded.store(true, std::memory_order_release);
+      }
+      changed();
+      return true;
+    }
+
+    void ConfigSetting::reset()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        overridden = false;
+        assignEnvironment();
+        loaded.store(true, std::memory_order_release);
+      }
+      changed();
+    }
+
+    bool ConfigSetting::isOverridden() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return overridden;
+    }
+
+    int ConfigSetting::addChangeHook(ChangeHook hook)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      hooks.emplace_back(nextHook, std::move(hook));
+      return nextHook++;
+    }
+
+    void ConfigSetting::removeChangeHook(int id)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      hooks.erase(std::remove_if(hooks.begin(),
+                                 hooks.end(),
+                                 [&](const std::pair<int, ChangeHook> &h) {
+                                   return h.first == id;
+                                 }),
+                  hooks.end());
+    }
+
+    void ConfigSetting::load() const
+    {
+      if (!loaded.load(std::memory_order_acquire))
+        loadSlow();
+    }
+
+    void ConfigSetting::overrideWith(const std::function<void()> &store)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        store();
+        overridden = true;
+        loaded.store(true, std::memory_order_release);
+      }
+      changed();
+    }
+
+    void ConfigSetting::loadSlow() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (loaded.load(std::memory_order_relaxed))
+        return;
+      assignEnvironment();
+      loaded.store(true, std::memory_order_release);
+    }
+
+    void ConfigSetting::assignEnvironment() const
+    {
+      const char *text = getenv(settingName);
+      if (text && !assign(text)) {
+        WARNING(std::string("ignoring invalid ") + settingName + " '" + text
+                + "'");
+        text = nullptr;
+      }
+      if (!text)
+        assign(nullptr);
+    }
+
+    void ConfigSetting::changed()
+    {
+      std::vector<std::pair<int, ChangeHook>> current;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = hooks;
+      }
+      for (const auto &h : current)
+        h.second(*this);
+    }
+
+    // Text conversions //
+
+    namespace detail {
+
+      static bool onlySpaces(const char *s)
+      {
+        while (*s == ' ' || *s == '\t')
+          ++s;
+        return *s == '\0';
+      }
+
+      bool parseConfig(const char *text, int &value)
+      {
+        char *end    = nullptr;
+        errno        = 0;
+        const long v = std::strtol(text, &end, 0);
+        if (end == text || !onlySpaces(end) || errno == ERANGE || v < INT_MIN
+            || v > INT_MAX)
+          return false;
+        value = int(v);
+        return true;
+      }
+
+      bool parseConfig(const char *text, float &value)
+      {
+        char *end     = nullptr;
+        const float v = std::strtof(text, &end);
+        if (end == text || !onlySpaces(end))
+          return false;
+        value = v;
+        return true;
+      }
+
+      bool parseConfig(const char *text, bool &value)
+      {
+        for (const char *t : {"true", "on", "yes"}) {
+          if (equalsIgnoreCase(text, t)) {
+            value = true;
+            return true;
+          }
+        }
+        for (const char *f : {"false", "off", "no"}) {
+          if (equalsIgnoreCase(text, f)) {
+            value = false;
+            return true;
+          }
+        }
+        int i = 0;
+        if (!parseConfig(text, i))
+          return false;
+        value = i != 0;
+        return true;
+      }
+
+      bool parseConfig(const char *text, std::string &value)
+      {
+        value = text;
+        return true;
+      }
+
+      bool parseConfig(const char *text, std::chrono::nanoseconds &value)
+      {
+        char *end      = nullptr;
+        const double v = std::strtod(text, &end);
+        if (end == text || v < 0.0)
+          return false;
+
+        std::string unit;
+        for (const char *c = end; *c; ++c) {
+          if (*c != ' ' && *c != '\t')
+            unit += *c;
+        }
+
+        double nsPerUnit = 1e6;
+        if (unit == "ns")
+          nsPerUnit = 1.0;
+        else if (unit == "us")
+          nsPerUnit = 1e3;
+        else if (unit == "s")
+          nsPerUnit = 1e9;
+        else if (!unit.empty() && unit != "ms")
+          return false;
+
+        value = std::chrono::nanoseconds(int64_t(v * nsPerUnit + 0.5));
+        return true;
+      }
+
+      std::string formatConfig(int value)
+      {
+        return std::to_string(value);
+      }
+
+      std::string formatConfig(float value)
+      {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%g", value);
+        return text;
+      }
+
+      std::string formatConfig(bool value)
+      {
+        return value ? "true" : "false";
+      }
+
+      std::string formatConfig(const std::string &value)
+      {
+        return value;
+      }
+
+      std::string formatConfig(std::chrono::nanoseconds value)
+      {
+        const int64_t ns = value.count();
+        if (ns != 0 && ns % 1000000000 == 0)
+          return std::to_string(ns / 1000000000) + "s";
+        if (ns != 0 && ns % 1000000 == 0)
+          return std::to_string(ns / 1000000) + "ms";
+        if (ns != 0 && ns % 1000 == 0)
+          return std::to_string(ns / 1000) + "us";
+        return std::to_string(ns) + "ns";
+      }
+
+    }  // namespace detail
+
+    // rkcommon's settings //
+
+    namespace config {
+
+      ConfigValue<std::string> &isa()
+      {
+        static ConfigValue<std::string> setting(
+            "RKCOMMON_ISA",
+            "",
+            "the highest instruction set of the multi-versioned kernels");
+        return setting;
+      }
+
+      ConfigValue<std::string> &taskingBackend()
+      {
+        static ConfigValue<std::string> setting(
+            "RKCOMMON_TASKING_BACKEND",
+            "",
+            "the tasking system of builds selecting it at runtime");
+        return setting;
+      }
+
+      ConfigValue<bool> &taskingWorkStealing()
+      {
+        static ConfigValue<bool> setting(
+            "RKCOMMON_TASKING_WORK_STEALING",
+            false,
+            "work stealing in the internal tasking system");
+        return setting;
+      }
+
+      ConfigValue<int> &asyncLoopTaskThreads()
+      {
+        static ConfigValue<int> setting(
+            "RKCOMMON_ASYNC_LOOP_TASK_THREADS",
+            4,
+            "tasking threads above which AUTO AsyncLoops run as tasks");
+        return setting;
+      }
+
+    }  // namespace config
+
+    std::vector<ConfigSetting *> configSettings()
+    {
+      // rkcommon's own, constructed on first use
+      config::isa();
+      config::taskingBackend();
+      config::taskingWorkStealing();
+      config::asyncLoopTaskThreads();
+
+      ConfigRegistry &r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      return r.settings;
+    }
+
+    ConfigSetting *findConfigSetting(const std::string &name)
+    {
+      for (ConfigSetting *setting : configSettings()) {
+        if (name == setting->name())
+          return setting;
+      }
+      return nullptr;
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
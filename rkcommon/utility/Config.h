@@ -0,0 +1,413 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+#include "StringManip.h"
+// std
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Runtime configuration read from environment variables.
+
+   Each setting parses its variable once, on first use, into a typed value
+   which later reads load without locking. Programs may override the value
+   with set() and go back to the environment with reset(); change hooks run
+   after each change. The settings of rkcommon itself are in namespace
+   config below, the one place they are documented. Like getEnvVar(),
+   environment variables are read with getenv(), so changing them after
+   the first read has no effect. */
+
+namespace rkcommon {
+  namespace utility {
+
+    enum class ConfigType
+    {
+      INT,
+      FLOAT,
+      BOOL,
+      STRING,
+      ENUM,
+      // std::chrono::nanoseconds, written with a unit, e.g. "250us", "2s";
+      // plain numbers are milliseconds
+      DURATION
+    };
+
+    class RKCOMMON_INTERFACE ConfigSetting
+    {
+     public:
+      using ChangeHook = std::function<void(const ConfigSetting &)>;
+
+      virtual ~ConfigSetting();
+
+      ConfigSetting(const ConfigSetting &) = delete;
+      ConfigSetting &operator=(const ConfigSetting &) = delete;
+
+      // the environment variable
+      const char *name() const;
+      ConfigType type() const;
+      const char *description() const;
+
+      // The current value as it would be written to the variable
+      virtual std::string str() const = 0;
+
+      /* Overrides the value with 'text', parsed like the variable; returns
+         false and keeps the value if it does not parse */
+      bool set(const std::string &text);
+      bool set(const char *text);
+
+      // Drops overrides, going back to the variable or the default
+      void reset();
+
+      bool isOverridden() const;
+
+      // 'hook' runs on the changing thread after every change of the value
+      int addChangeHook(ChangeHook hook);
+      void removeChangeHook(int id);
+
+     protected:
+      ConfigSetting(const char *name, ConfigType type, const char *description);
+
+      // Reads the variable if that did not happen yet
+      void load() const;
+
+      /* Stores the parsed 'text', or the default for nullptr; false if
+         'text' does not parse. Called with the setting locked. */
+      virtual bool assign(const char *text) const = 0;
+
+      // Runs 'store' locked as an override, then the hooks
+      void overrideWith(const std::function<void()> &store);
+
+     private:
+      void loadSlow() const;
+      void assignEnvironment() const;
+      void changed();
+
+      const char *settingName;
+      ConfigType settingType;
+      const char *settingDescription;
+
+      mutable std::mutex mutex;
+      mutable std::atomic<bool> loaded{false};
+      bool overridden{false};
+
+      std::vector<std::pair<int, ChangeHook>> hooks;
+      int nextHook{0};
+    };
+
+    namespace detail {
+
+      // Text conversions of the setting types, false if 'text' is invalid
+      RKCOMMON_INTERFACE bool parseConfig(const char *text, int &value);
+      RKCOMMON_INTERFACE bool parseConfig(const char *text, float &value);
+      // also integers, non-zero is true
+      RKCOMMON_INTERFACE bool parseConfig(const char *text, bool &value);
+      RKCOMMON_INTERFACE bool parseConfig(const char *text,
+                                          std::string &value);
+      RKCOMMON_INTERFACE bool parseConfig(const char *text,
+                                          std::chrono::nanoseconds &value);
+
+      // enums are parsed by ConfigEnum
+      template <typename E>
+      inline typename std::enable_if<std::is_enum<E>::value, bool>::type
+      parseConfig(const char *, E &)
+      {
+        return false;
+      }
+
+      RKCOMMON_INTERFACE std::string formatConfig(int value);
+      RKCOMMON_INTERFACE std::string formatConfig(float value);
+      RKCOMMON_INTERFACE std::string formatConfig(bool value);
+      RKCOMMON_INTERFACE std::string formatConfig(const std::string &value);
+      RKCOMMON_INTERFACE std::string formatConfig(
+          std::chrono::nanoseconds value);
+
+      template <typename E>
+      inline typename std::enable_if<std::is_enum<E>::value,
+                                     std::string>::type
+      formatConfig(E value)
+      {
+        return std::to_string(int(value));
+      }
+
+      template <typename T>
+      inline ConfigType configTypeOf()
+      {
+        return ConfigType::ENUM;
+      }
+
+      template <>
+      inline ConfigType configTypeOf<int>()
+      {
+        return ConfigType::INT;
+      }
+
+      template <>
+      inline ConfigType configTypeOf<float>()
+      {
+        return ConfigType::FLOAT;
+      }
+
+      template <>
+      inline ConfigType configTypeOf<bool>()
+      {
+        return ConfigType::BOOL;
+      }
+
+      template <>
+      inline ConfigType configTypeOf<std::string>()
+      {
+        return ConfigType::STRING;
+      }
+
+      template <>
+      inline ConfigType configTypeOf<std::chrono::nanoseconds>()
+      {
+        return ConfigType::DURATION;
+      }
+
+      // An atomic word holding the bits of T
+      template <typename T>
+      struct ConfigStorage
+      {
+        static_assert(std::is_trivially_copyable<T>::value
+                          && sizeof(T) <= sizeof(uint64_t),
+                      "settings are ints, floats, bools, enums, durations "
+                      "or strings");
+
+        T load() const
+        {
+          const uint64_t b = bits.load(std::memory_order_relaxed);
+          T value;
+          std::memcpy(static_cast<void *>(&value), &b, sizeof(T));
+          return value;
+        }
+
+        void store(const T &value) const
+        {
+          uint64_t b = 0;
+          std::memcpy(&b, static_cast<const void *>(&value), sizeof(T));
+          bits.store(b, std::memory_order_relaxed);
+        }
+
+        mutable std::atomic<uint64_t> bits{0};
+      };
+
+      // Strings are published by pointer and kept until the setting dies
+      template <>
+      struct ConfigStorage<std::string>
+      {
+        std::string load() const
+        {
+          return *current.load(std::memory_order_acquire);
+        }
+
+        void store(const std::string &value) const
+        {
+          values.emplace_back(new std::string(value));
+          current.store(values.back().get(), std::memory_order_release);
+        }
+
+        mutable std::atomic<const std::string *> current{nullptr};
+        mutable std::vector<std::unique_ptr<std::string>> values;
+      };
+
+    }  // namespace detail
+
+    /* A setting of type int, float, bool, std::string, an enum (see
+       ConfigEnum) or std::chrono::nanoseconds, e.g.
+
+         static ConfigValue<int> numBricks(
+             "MYAPP_NUM_BRICKS", 64, "bricks loaded ahead of rendering");
+         ...
+         prefetch(numBricks.get());
+    */
+    template <typename T>
+    class ConfigValue : public ConfigSetting
+    {
+     public:
+      ConfigValue(const char *name, T defaultValue, const char *description);
+
+      T get() const;
+      operator T() const;
+
+      // Overrides the value
+      void set(const T &value);
+      using ConfigSetting::set;
+
+      const T &defaultValue() const;
+
+      std::string str() const override;
+
+     protected:
+      virtual bool parse(const char *text, T &value) const;
+      virtual std::string format(const T &value) const;
+
+     private:
+      bool assign(const char *text) const override;
+
+      T fallback;
+      detail::ConfigStorage<T> storage;
+    };
+
+    // An enum setting, written as one of the names of its values
+    template <typename E>
+    class ConfigEnum : public ConfigValue<E>
+    {
+     public:
+      ConfigEnum(const char *name,
+                 E defaultValue,
+                 std::initializer_list<std::pair<const char *, E>> names,
+                 const char *description);
+
+     protected:
+      // case insensitive
+      bool parse(const char *text, E &value) const override;
+      std::string format(const E &value) const override;
+
+     private:
+      std::vector<std::pair<const char *, E>> names;
+    };
+
+    // All settings constructed so far, including all of rkcommon's
+    RKCOMMON_INTERFACE std::vector<ConfigSetting *> configSettings();
+
+    // The setting of environment variable 'name', nullptr if there is none
+    RKCOMMON_INTERFACE ConfigSetting *findConfigSetting(
+        const std::string &name);
+
+    namespace config {
+
+      // RKCOMMON_ISA: the highest instruction set of the multi-versioned
+      // kernels, one of "scalar", "neon", "sse2", "sse4.2", "avx2" or
+      // "avx512"; read once, when the kernels are first used
+      RKCOMMON_INTERFACE ConfigValue<std::string> &isa();
+
+      // RKCOMMON_TASKING_BACKEND: "tbb", "openmp", "internal" or "serial",
+      // for builds with a runtime selected tasking system
+      RKCOMMON_INTERFACE ConfigValue<std::string> &taskingBackend();
+
+      // RKCOMMON_TASKING_WORK_STEALING: work stealing in the internal
+      // tasking system, read by initTaskingSystem()
+      RKCOMMON_INTERFACE ConfigValue<bool> &taskingWorkStealing();
+
+      // RKCOMMON_ASYNC_LOOP_TASK_THREADS: AsyncLoops launched as AUTO run
+      // as tasks with more tasking threads than this, else on a thread
+      RKCOMMON_INTERFACE ConfigValue<int> &asyncLoopTaskThreads();
+
+    }  // namespace config
+
+    // Inlined ConfigValue definitions ////////////////////////////////////////
+
+    template <typename T>
+    inline ConfigValue<T>::ConfigValue(const char *name,
+                                       T defaultValue,
+                                       const char *description)
+        : ConfigSetting(name, detail::configTypeOf<T>(), description),
+          fallback(std::move(defaultValue))
+    {
+    }
+
+    template <typename T>
+    inline T ConfigValue<T>::get() const
+    {
+      load();
+      return storage.load();
+    }
+
+    template <typename T>
+    inline ConfigValue<T>::operator T() const
+    {
+      return get();
+    }
+
+    template <typename T>
+    inline void ConfigValue<T>::set(const T &value)
+    {
+      overrideWith([&]() { storage.store(value); });
+    }
+
+    template <typename T>
+    inline const T &ConfigValue<T>::defaultValue() const
+    {
+      return fallback;
+    }
+
+    template <typename T>
+    inline std::string ConfigValue<T>::str() const
+    {
+      return format(get());
+    }
+
+    template <typename T>
+    inline bool ConfigValue<T>::parse(const char *text, T &value) const
+    {
+      return detail::parseConfig(text, value);
+    }
+
+    template <typename T>
+    inline std::string ConfigValue<T>::format(const T &value) const
+    {
+      return detail::formatConfig(value);
+    }
+
+    template <typename T>
+    inline bool ConfigValue<T>::assign(const char *text) const
+    {
+      if (!text) {
+        storage.store(fallback);
+        return true;
+      }
+      T value = fallback;
+      if (!parse(text, value))
+        return false;
+      storage.store(value);
+      return true;
+    }
+
+    // Inlined ConfigEnum definitions /////////////////////////////////////////
+
+    template <typename E>
+    inline ConfigEnum<E>::ConfigEnum(
+        const char *name,
+        E defaultValue,
+        std::initializer_list<std::pair<const char *, E>> _names,
+        const char *description)
+        : ConfigValue<E>(name, defaultValue, description), names(_names)
+    {
+    }
+
+    template <typename E>
+    inline bool ConfigEnum<E>::parse(const char *text, E &value) const
+    {
+      for (const auto &n : names) {
+        if (equalsIgnoreCase(text, n.first)) {
+          value = n.second;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    template <typename E>
+    inline std::string ConfigEnum<E>::format(const E &value) const
+    {
+      for (const auto &n : names) {
+        if (n.second == value)
+          return n.first;
+      }
+      return detail::formatConfig(value);
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
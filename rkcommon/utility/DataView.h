@@ -4,10 +4,26 @@
 #pragma once
 
 #include "../common.h"
+#include "../tasking/parallel_for.h"
+// std
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <xmmintrin.h>
+#endif
 
 namespace rkcommon {
   namespace utility {
 
+    /* copyTo() and gather() of at least this many elements run in chunks
+       through tasking::parallel_for() when asked to be 'parallel' */
+    constexpr size_t DATAVIEW_PARALLEL_THRESHOLD = 256 * 1024;
+
+    /* Elements of type T 'stride' bytes apart, e.g. one attribute of
+       interleaved vertices; a stride of 0 repeats the first element */
     template <typename T>
     struct DataView
     {
@@ -19,11 +35,156 @@ namespace rkcommon {
       void reset(const void *data, size_t stride = sizeof(T));
       const T &operator[](size_t index) const;
 
+      const void *data() const;
+      size_t byteStride() const;
+
+      // Copies elements [first, first + count) to the contiguous 'out'
+      void copyTo(T *out,
+                  size_t first,
+                  size_t count,
+                  bool parallel = true) const;
+
+      // Copies the elements at 'indices' to the contiguous 'out'
+      void gather(const uint32_t *indices,
+                  T *out,
+                  size_t n,
+                  bool parallel = true) const;
+
      protected:
       const byte_t *ptr{nullptr};
       size_t stride{1};
     };
 
+    /* A DataView which also writes the elements in place */
+    template <typename T>
+    struct DataViewMut
+    {
+      DataViewMut() = default;
+
+      DataViewMut(void *data, size_t stride = sizeof(T));
+
+      void reset(void *data, size_t stride = sizeof(T));
+      T &operator[](size_t index) const;
+
+      void *data() const;
+      size_t byteStride() const;
+
+      // Copies the contiguous 'in' to elements [first, first + count)
+      void copyFrom(const T *in,
+                    size_t first,
+                    size_t count,
+                    bool parallel = true) const;
+
+      operator DataView<T>() const;
+
+     private:
+      byte_t *ptr{nullptr};
+      size_t stride{1};
+    };
+
+    namespace detail {
+
+      inline void prefetchRead(const void *p)
+      {
+#if defined(_MSC_VER) && !defined(__clang__)
+        _mm_prefetch(static_cast<const char *>(p), _MM_HINT_T0);
+#else
+        __builtin_prefetch(p);
+#endif
+      }
+
+      // Elements smaller than 16 bytes more than 16 bytes apart (e.g. a
+      // vec3f in a vertex) are moved as 16 bytes, one vector load and store,
+      // the excess overwritten by the next element. The source reads stay
+      // within the stride, and the last elements are copied exactly
+      template <typename T>
+      inline void copyStrided(const byte_t *src,
+                              size_t stride,
+                              T *out,
+                              size_t count,
+                              std::true_type)
+      {
+        const size_t wide = (16 + sizeof(T) - 1) / sizeof(T);
+        size_t i          = 0;
+        if (stride >= 16 && count > wide) {
+          byte_t *dst = reinterpret_cast<byte_t *>(out);
+          for (; i < count - wide; ++i)
+            std::memcpy(dst + i * sizeof(T), src + i * stride, 16);
+        }
+        for (; i < count; ++i)
+          std::memcpy(out + i, src + i * stride, sizeof(T));
+      }
+
+      template <typename T>
+      inline void copyStrided(const byte_t *src,
+                              size_t stride,
+                              T *out,
+                              size_t count,
+                              std::false_type)
+      {
+        for (size_t i = 0; i < count; ++i)
+          out[i] = *reinterpret_cast<const T *>(src + i * stride);
+      }
+
+      template <typename T>
+      using copy_wide_t =
+          std::integral_constant<bool,
+                                 std::is_trivially_copyable<T>::value
+                                     && (sizeof(T) < 16)>;
+
+      // Elements [first, first + count) of 'src', the element size apart
+      // from a stride of 0
+      template <typename T>
+      inline void copyRange(
+          const byte_t *src, size_t stride, T *out, size_t count)
+      {
+        if (stride == sizeof(T)) {
+          std::copy(reinterpret_cast<const T *>(src),
+                    reinterpret_cast<const T *>(src) + count,
+                    out);
+        } else if (stride == 0) {
+          std::fill(out, out + count, *reinterpret_cast<const T *>(src));
+        } else {
+          copyStrided(src, stride, out, count, copy_wide_t<T>());
+        }
+      }
+
+      // Random accesses, prefetched some elements ahead
+      template <typename T>
+      inline void gatherRange(const byte_t *src,
+                              size_t stride,
+                              const uint32_t *indices,
+                              T *out,
+                              size_t n)
+      {
+        const size_t distance = 16;
+        size_t i              = 0;
+        for (; i + distance < n; ++i) {
+          prefetchRead(src + indices[i + distance] * stride);
+          out[i] = *reinterpret_cast<const T *>(src + indices[i] * stride);
+        }
+        for (; i < n; ++i)
+          out[i] = *reinterpret_cast<const T *>(src + indices[i] * stride);
+      }
+
+      // fcn(begin, end) over [0, n), in chunks run in parallel if 'parallel'
+      template <typename FCN_T>
+      inline void forChunks(size_t n, bool parallel, FCN_T &&fcn)
+      {
+        if (!parallel || n < DATAVIEW_PARALLEL_THRESHOLD) {
+          fcn(size_t(0), n);
+          return;
+        }
+        const size_t chunkSize = DATAVIEW_PARALLEL_THRESHOLD / 4;
+        const size_t numChunks = (n + chunkSize - 1) / chunkSize;
+        tasking::parallel_for(numChunks, [&](size_t c) {
+          const size_t begin = c * chunkSize;
+          fcn(begin, std::min(begin + chunkSize, n));
+        });
+      }
+
+    }  // namespace detail
+
     // Inlined member definitions
     // ///////////////////////////////////////////////
 
@@ -46,5 +207,98 @@ namespace rkcommon {
       return *reinterpret_cast<const T *>(ptr + (index * stride));
     }
 
+    template <typename T>
+    inline const void *DataView<T>::data() const
+    {
+      return ptr;
+    }
+
+    template <typename T>
+    inline size_t DataView<T>::byteStride() const
+    {
+      return stride;
+    }
+
+    template <typename T>
+    inline void DataView<T>::copyTo(T *out,
+                                    size_t first,
+                                    size_t count,
+                                    bool parallel) const
+    {
+      const byte_t *src = ptr + first * stride;
+      const size_t s    = stride;
+      detail::forChunks(count, parallel, [&](size_t begin, size_t end) {
+        detail::copyRange(src + begin * s, s, out + begin, end - begin);
+      });
+    }
+
+    template <typename T>
+    inline void DataView<T>::gather(const uint32_t *indices,
+                                    T *out,
+                                    size_t n,
+                                    bool parallel) const
+    {
+      const byte_t *src = ptr;
+      const size_t s    = stride;
+      detail::forChunks(n, parallel, [&](size_t begin, size_t end) {
+        detail::gatherRange(src, s, indices + begin, out + begin, end - begin);
+      });
+    }
+
+    template <typename T>
+    inline DataViewMut<T>::DataViewMut(void *_data, size_t _stride)
+        : ptr(static_cast<byte_t *>(_data)), stride(_stride)
+    {
+    }
+
+    template <typename T>
+    inline void DataViewMut<T>::reset(void *_data, size_t _stride)
+    {
+      ptr    = static_cast<byte_t *>(_data);
+      stride = _stride;
+    }
+
+    template <typename T>
+    inline T &DataViewMut<T>::operator[](size_t index) const
+    {
+      return *reinterpret_cast<T *>(ptr + (index * stride));
+    }
+
+    template <typename T>
+    inline void *DataViewMut<T>::data() const
+    {
+      return ptr;
+    }
+
+    template <typename T>
+    inline size_t DataViewMut<T>::byteStride() const
+    {
+      return stride;
+    }
+
+    template <typename T>
+    inline void DataViewMut<T>::copyFrom(const T *in,
+                                         size_t first,
+                                         size_t count,
+                                         bool parallel) const
+    {
+      byte_t *dst    = ptr + first * stride;
+      const size_t s = stride;
+      detail::forChunks(count, parallel, [&](size_t begin, size_t end) {
+        if (s == sizeof(T)) {
+          std::copy(in + begin, in + end, reinterpret_cast<T *>(dst) + begin);
+          return;
+        }
+        for (size_t i = begin; i < end; ++i)
+          *reinterpret_cast<T *>(dst + i * s) = in[i];
+      });
+    }
+
+    template <typename T>
+    inline DataViewMut<T>::operator DataView<T>() const
+    {
+      return DataView<T>(ptr, stride);
+    }
+
   }  // namespace utility
 }  // namespace rkcommon
@@ -18,7 +18,8 @@ namespace rkcommon {
                  framebuffer. Once the new frame is ready, they are swapped.
 
         NOTE: This isn't thread safe! Any references to front() and back() must
-              be synchronized with when swap() gets called.
+              be synchronized with when swap() gets called. Threads which
+              hand values over can use MultiBufferedValue instead.
      */
     template <typename T>
     class DoubleBufferedValue
@@ -4,10 +4,12 @@
 #pragma once
 
 #include "../common.h"
+#include "../containers/UninitVector.h"
 #include "AbstractArray.h"
 
 #include <array>
 #include <cstring>
+#include <memory>
 #include <vector>
 
 namespace rkcommon {
@@ -19,9 +21,11 @@ namespace rkcommon {
     /*  'FixedArray<T>' implements an array interface on a pointer to
      *  data which is owned by the FixedArray. The array is not
      *  initialized on creation and cannot be resized, though it can
-     *  be recreated with a new size
+     *  be recreated with a new size. The memory comes from ALLOC, as for
+     *  OwnedArray.
      */
-    template <typename T>
+    template <typename T,
+              typename ALLOC = containers::uninitialized_allocator<T>>
     struct FixedArray : public AbstractArray<T>
     {
       using View = FixedArrayView<uint8_t>;
@@ -29,36 +33,51 @@ namespace rkcommon {
       FixedArray()           = default;
       ~FixedArray() override = default;
 
-      explicit FixedArray(size_t size);
+      explicit FixedArray(size_t size, const ALLOC &allocator = ALLOC());
 
-      explicit FixedArray(T *data, size_t size);
+      explicit FixedArray(T *data,
+                          size_t size,
+                          const ALLOC &allocator = ALLOC());
 
       template <size_t SIZE>
       FixedArray(std::array<T, SIZE> &init);
 
       FixedArray(std::vector<T> &init);
 
+      /* Adopts the 'size' constructed elements of 'memory', which are
+       * released with its last user (e.g. a pooled buffer) */
+      FixedArray(std::shared_ptr<T> memory, size_t size);
+
       template <size_t SIZE>
       FixedArray &operator=(std::array<T, SIZE> &rhs);
 
       FixedArray &operator=(std::vector<T> &rhs);
 
      private:
+      // default-initialized elements of 'allocator', the previous ones
+      // released with their last user
+      void allocate(size_t size);
+
+      ALLOC allocator;
       // We use a shared ptr to actually manage lifetime the data lifetime
       std::shared_ptr<T> array = nullptr;
     };
 
     // Inlined FixedArray definitions /////////////////////////////////////////
 
-    template <typename T>
-    inline FixedArray<T>::FixedArray(size_t _size)
-        : array(std::shared_ptr<T>(new T[_size], std::default_delete<T[]>()))
+    template <typename T, typename ALLOC>
+    inline FixedArray<T, ALLOC>::FixedArray(size_t _size,
+                                            const ALLOC &_allocator)
+        : allocator(_allocator)
     {
-      AbstractArray<T>::setPtr(array.get(), _size);
+      allocate(_size);
     }
 
-    template <typename T>
-    inline FixedArray<T>::FixedArray(T *_data, size_t _size) : FixedArray(_size)
+    template <typename T, typename ALLOC>
+    inline FixedArray<T, ALLOC>::FixedArray(T *_data,
+                                            size_t _size,
+                                            const ALLOC &_allocator)
+        : FixedArray(_size, _allocator)
     {
       // Note:
       // UB in memcpy if
@@ -71,39 +90,74 @@ namespace rkcommon {
         std::memcpy(array.get(), _data, _size * sizeof(T));
     }
 
-    template <typename T>
+    template <typename T, typename ALLOC>
     template <size_t SIZE>
-    inline FixedArray<T>::FixedArray(std::array<T, SIZE> &init)
+    inline FixedArray<T, ALLOC>::FixedArray(std::array<T, SIZE> &init)
         : FixedArray(init.data(), init.size())
     {
     }
 
-    template <typename T>
-    inline FixedArray<T>::FixedArray(std::vector<T> &init)
+    template <typename T, typename ALLOC>
+    inline FixedArray<T, ALLOC>::FixedArray(std::vector<T> &init)
         : FixedArray(init.data(), init.size())
     {
     }
 
-    template <typename T>
+    template <typename T, typename ALLOC>
+    inline FixedArray<T, ALLOC>::FixedArray(std::shared_ptr<T> memory,
+                                            size_t size)
+        : array(std::move(memory))
+    {
+      AbstractArray<T>::setPtr(array.get(), size);
+    }
+
+    template <typename T, typename ALLOC>
     template <size_t SIZE>
-    inline FixedArray<T> &FixedArray<T>::operator=(std::array<T, SIZE> &rhs)
+    inline FixedArray<T, ALLOC> &FixedArray<T, ALLOC>::operator=(
+        std::array<T, SIZE> &rhs)
     {
-      array = std::shared_ptr<T>(new T[rhs.size()], std::default_delete<T[]>());
-      AbstractArray<T>::setPtr(array.get(), rhs.size());
+      allocate(rhs.size());
       if (rhs.data() && rhs.size() > 0)
         std::memcpy(array.get(), rhs.data(), rhs.size() * sizeof(T));
       return *this;
     }
 
-    template <typename T>
-    inline FixedArray<T> &FixedArray<T>::operator=(std::vector<T> &rhs)
+    template <typename T, typename ALLOC>
+    inline FixedArray<T, ALLOC> &FixedArray<T, ALLOC>::operator=(
+        std::vector<T> &rhs)
     {
-      array = std::shared_ptr<T>(new T[rhs.size()], std::default_delete<T[]>());
-      AbstractArray<T>::setPtr(array.get(), rhs.size());
+      allocate(rhs.size());
       if (rhs.data() && rhs.size() > 0)
         std::memcpy(array.get(), rhs.data(), rhs.size() * sizeof(T));
       return *this;
     }
 
+    template <typename T, typename ALLOC>
+    inline void FixedArray<T, ALLOC>::allocate(size_t size)
+    {
+      using traits = std::allocator_traits<ALLOC>;
+
+      T *data  = traits::allocate(allocator, size);
+      size_t i = 0;
+      try {
+        for (; i < size; ++i)
+          ::new (static_cast<void *>(data + i)) T;
+      } catch (...) {
+        while (i > 0)
+          data[--i].~T();
+        traits::deallocate(allocator, data, size);
+        throw;
+      }
+
+      ALLOC owner  = allocator;
+      auto release = [owner, size](T *p) mutable {
+        for (size_t i = 0; i < size; ++i)
+          p[i].~T();
+        traits::deallocate(owner, p, size);
+      };
+      array = std::shared_ptr<T>(data, release);
+      AbstractArray<T>::setPtr(data, size);
+    }
+
   }  // namespace utility
 }  // namespace rkcommon
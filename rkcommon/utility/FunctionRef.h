@@ -0,0 +1,98 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace rkcommon {
+  namespace utility {
+
+    template <typename SIG>
+    class FunctionRef;
+
+    /* 'FunctionRef' is a non-owning reference to a callable, two pointers in
+     * size: one to the callable, one to a function invoking it. It never
+     * allocates and is trivially copyable, so it is the cheapest way to pass
+     * a callback which is only called before the receiving function returns.
+     *
+     * NOTE: Similar to C++26's 'std::function_ref'. The referenced callable
+     *       must outlive the FunctionRef, which makes it unsuitable for
+     *       storing callbacks; use std::function or InplaceFunction for that.
+     *
+     *  Example:
+     *
+     *      void forEachTile(FunctionRef<void(int, int)> fcn);
+     *
+     *      forEachTile([&](int x, int y) { render(x, y); });
+     */
+    template <typename R, typename... ARGS>
+    class FunctionRef<R(ARGS...)>
+    {
+     public:
+      FunctionRef() = delete;
+
+      // References a plain function
+      FunctionRef(R (*fcn)(ARGS...));
+
+      // References any other callable, e.g. a lambda
+      template <typename FCN_T,
+                typename = typename std::enable_if<
+                    !std::is_same<typename std::decay<FCN_T>::type,
+                                  FunctionRef>::value
+                    && !std::is_function<
+                        typename std::remove_reference<FCN_T>::type>::value>::
+                    type>
+      FunctionRef(FCN_T &&fcn);
+
+      FunctionRef(const FunctionRef &) = default;
+      FunctionRef &operator=(const FunctionRef &) = default;
+
+      R operator()(ARGS... args) const;
+
+     private:
+      union Target
+      {
+        void *object;
+        void (*function)();
+      };
+
+      Target target;
+      R (*callback)(Target, ARGS...);
+    };
+
+    // Inlined FunctionRef definitions ////////////////////////////////////////
+
+    template <typename R, typename... ARGS>
+    inline FunctionRef<R(ARGS...)>::FunctionRef(R (*fcn)(ARGS...))
+    {
+      using fcn_t     = R (*)(ARGS...);
+      target.function = reinterpret_cast<void (*)()>(fcn);
+      callback        = [](Target t, ARGS... args) -> R {
+        return reinterpret_cast<fcn_t>(t.function)(
+            std::forward<ARGS>(args)...);
+      };
+    }
+
+    template <typename R, typename... ARGS>
+    template <typename FCN_T, typename>
+    inline FunctionRef<R(ARGS...)>::FunctionRef(FCN_T &&fcn)
+    {
+      using fcn_t   = typename std::remove_reference<FCN_T>::type;
+      target.object = const_cast<void *>(
+          static_cast<const volatile void *>(std::addressof(fcn)));
+      callback = [](Target t, ARGS... args) -> R {
+        return (*static_cast<fcn_t *>(t.object))(std::forward<ARGS>(args)...);
+      };
+    }
+
+    template <typename R, typename... ARGS>
+    inline R FunctionRef<R(ARGS...)>::operator()(ARGS... args) const
+    {
+      return callback(target, std::forward<ARGS>(args)...);
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
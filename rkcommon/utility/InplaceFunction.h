@@ -0,0 +1,229 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rkcommon {
+  namespace utility {
+
+    template <typename SIG,
+              size_t CAPACITY  = 4 * sizeof(void *),
+              size_t ALIGNMENT = alignof(void *)>
+    class InplaceFunction;
+
+    /* 'InplaceFunction' is a copyable, owning callable like std::function,
+     * but it stores the callable in a fixed buffer of 'CAPACITY' bytes inside
+     * itself and never allocates. Callables which are too large (or too
+     * strictly aligned) are rejected at compile time rather than moved to the
+     * heap, so it is one pointer larger than CAPACITY and no slower to create
+     * or destroy than the callable itself.
+     *
+     * NOTE: Similar to SG14's 'stdext::inplace_function'. Calling an empty
+     *       InplaceFunction throws std::bad_function_call.
+     *
+     *  Example:
+     *
+     *      InplaceFunction<void(int)> f = [this](int i) { handle(i); };
+     *      f(42);
+     */
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    class InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>
+    {
+     public:
+      static constexpr size_t capacity  = CAPACITY;
+      static constexpr size_t alignment = ALIGNMENT;
+
+      InplaceFunction() = default;
+      InplaceFunction(std::nullptr_t);
+
+      template <typename FCN_T,
+                typename = typename std::enable_if<
+                    !std::is_same<typename std::decay<FCN_T>::type,
+                                  InplaceFunction>::value>::type>
+      InplaceFunction(FCN_T &&fcn);
+
+      InplaceFunction(const InplaceFunction &other);
+      InplaceFunction(InplaceFunction &&other);
+
+      ~InplaceFunction();
+
+      InplaceFunction &operator=(const InplaceFunction &other);
+      InplaceFunction &operator=(InplaceFunction &&other);
+      InplaceFunction &operator=(std::nullptr_t);
+
+      R operator()(ARGS... args) const;
+
+      explicit operator bool() const;
+
+     private:
+      struct Ops
+      {
+        R (*invoke)(void *, ARGS &&...);
+        void (*copy)(void *dst, const void *src);
+        void (*move)(void *dst, void *src);
+        void (*destroy)(void *);
+      };
+
+      template <typename FCN_T>
+      static const Ops *opsFor();
+
+      void reset();
+
+      alignas(ALIGNMENT) mutable unsigned char storage[CAPACITY];
+      const Ops *ops{nullptr};
+    };
+
+    // Inlined InplaceFunction definitions ////////////////////////////////////
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    constexpr size_t InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::capacity;
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    constexpr size_t
+        InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::alignment;
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    template <typename FCN_T>
+    inline auto InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::opsFor()
+        -> const Ops *
+    {
+      static const Ops ops = {
+          [](void *f, ARGS &&... args) -> R {
+            return (*static_cast<FCN_T *>(f))(std::forward<ARGS>(args)...);
+          },
+          [](void *dst, const void *src) {
+            new (dst) FCN_T(*static_cast<const FCN_T *>(src));
+          },
+          [](void *dst, void *src) {
+            new (dst) FCN_T(std::move(*static_cast<FCN_T *>(src)));
+            static_cast<FCN_T *>(src)->~FCN_T();
+          },
+          [](void *f) { static_cast<FCN_T *>(f)->~FCN_T(); }};
+      return &ops;
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    inline InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::InplaceFunction(
+        std::nullptr_t)
+    {
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    template <typename FCN_T, typename>
+    inline InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::InplaceFunction(
+        FCN_T &&fcn)
+    {
+      using fcn_t = typename std::decay<FCN_T>::type;
+
+      static_assert(sizeof(fcn_t) <= CAPACITY,
+                    "rkcommon::utility::InplaceFunction is too small to hold "
+                    "this callable, increase its CAPACITY.");
+      static_assert(alignof(fcn_t) <= ALIGNMENT,
+                    "rkcommon::utility::InplaceFunction is not aligned enough "
+                    "to hold this callable, increase its ALIGNMENT.");
+      static_assert(std::is_copy_constructible<fcn_t>::value,
+                    "rkcommon::utility::InplaceFunction requires copyable "
+                    "callables.");
+
+      new (storage) fcn_t(std::forward<FCN_T>(fcn));
+      ops = opsFor<fcn_t>();
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    inline InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::InplaceFunction(
+        const InplaceFunction &other)
+        : ops(other.ops)
+    {
+      if (ops)
+        ops->copy(storage, other.storage);
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    inline InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::InplaceFunction(
+        InplaceFunction &&other)
+        : ops(other.ops)
+    {
+      if (ops) {
+        ops->move(storage, other.storage);
+        other.ops = nullptr;
+      }
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    inline InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::~InplaceFunction()
+    {
+      reset();
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    inline InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>
+        &InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::operator=(
+            const InplaceFunction &other)
+    {
+      if (this != &other) {
+        reset();
+        if (other.ops)
+          other.ops->copy(storage, other.storage);
+        ops = other.ops;
+      }
+      return *this;
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    inline InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>
+        &InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::operator=(
+            InplaceFunction &&other)
+    {
+      if (this != &other) {
+        reset();
+        if (other.ops) {
+          other.ops->move(storage, other.storage);
+          ops       = other.ops;
+          other.ops = nullptr;
+        }
+      }
+      return *this;
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    inline InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>
+        &InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::operator=(
+            std::nullptr_t)
+    {
+      reset();
+      return *this;
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    inline R InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::operator()(
+        ARGS... args) const
+    {
+      if (!ops)
+        throw std::bad_function_call();
+      return ops->invoke(storage, std::forward<ARGS>(args)...);
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    inline InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::operator bool()
+        const
+    {
+      return ops != nullptr;
+    }
+
+    template <typename R, typename... ARGS, size_t CAPACITY, size_t ALIGNMENT>
+    inline void InplaceFunction<R(ARGS...), CAPACITY, ALIGNMENT>::reset()
+    {
+      if (ops) {
+        ops->destroy(storage);
+        ops = nullptr;
+      }
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
@@ -0,0 +1,155 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace rkcommon {
+  namespace utility {
+
+    /* A histogram of durations in nanoseconds, in the manner of HDR
+       histograms: the values of each power of two range are counted in
+       SUB_BUCKETS linear buckets, so percentiles are accurate to about 3%
+       over the whole range of uint64_t, in a fixed 8KB.
+
+       Recording is a few instructions and not synchronized: record on one
+       thread per histogram, e.g. a tasking::ThreadLocal<LatencyHistogram>,
+       and merge() them for the statistics of all threads. */
+    class LatencyHistogram
+    {
+     public:
+      void record(uint64_t nanoseconds);
+
+      void merge(const LatencyHistogram &other);
+
+      void reset();
+
+      uint64_t count() const;
+
+      // 0 without any values
+      uint64_t min() const;
+      uint64_t max() const;
+      double mean() const;
+
+      // The value below which 'p' percent of the values lie, e.g. 99 for the
+      // p99 latency, within min() and max()
+      uint64_t percentile(double p) const;
+
+     private:
+      static constexpr uint32_t SUB_BITS    = 4;
+      static constexpr uint32_t SUB_BUCKETS = 1 << SUB_BITS;
+      static constexpr uint32_t NUM_BUCKETS =
+          (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+      static uint32_t bucket(uint64_t value);
+
+      // the middle of the values counted in 'index'
+      static uint64_t value(uint32_t index);
+
+      uint64_t buckets[NUM_BUCKETS]{};
+      uint64_t numValues{0};
+      uint64_t total{0};
+      uint64_t minValue{~uint64_t(0)};
+      uint64_t maxValue{0};
+    };
+
+    // Inlined LatencyHistogram definitions ///////////////////////////////////
+
+    inline void LatencyHistogram::record(uint64_t nanoseconds)
+    {
+      buckets[bucket(nanoseconds)]++;
+      numValues++;
+      total += nanoseconds;
+      minValue = std::min(minValue, nanoseconds);
+      maxValue = std::max(maxValue, nanoseconds);
+    }
+
+    inline void LatencyHistogram::merge(const LatencyHistogram &other)
+    {
+      for (uint32_t i = 0; i < NUM_BUCKETS; ++i)
+        buckets[i] += other.buckets[i];
+      numValues += other.numValues;
+      total += other.total;
+      minValue = std::min(minValue, other.minValue);
+      maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    inline void LatencyHistogram::reset()
+    {
+      *this = LatencyHistogram();
+    }
+
+    inline uint64_t LatencyHistogram::count() const
+    {
+      return numValues;
+    }
+
+    inline uint64_t LatencyHistogram::min() const
+    {
+      return numValues ? minValue : 0;
+    }
+
+    inline uint64_t LatencyHistogram::max() const
+    {
+      return maxValue;
+    }
+
+    inline double LatencyHistogram::mean() const
+    {
+      return numValues ? double(total) / double(numValues) : 0.0;
+    }
+
+    inline uint64_t LatencyHistogram::percentile(double p) const
+    {
+      if (numValues == 0)
+        return 0;
+      if (p <= 0.0)
+        return minValue;
+      if (p >= 100.0)
+        return maxValue;
+
+      // the nearest rank
+      const uint64_t rank = std::max<uint64_t>(
+          1, uint64_t(std::ceil(p / 100.0 * double(numValues))));
+      uint64_t seen = 0;
+      for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank)
+          return std::min(maxValue, std::max(minValue, value(i)));
+      }
+      return maxValue;
+    }
+
+    inline uint32_t LatencyHistogram::bucket(uint64_t value)
+    {
+      if (value < SUB_BUCKETS)
+        return uint32_t(value);
+
+#if defined(__GNUC__) || defined(__clang__)
+      const uint32_t log2 = 63 - uint32_t(__builtin_clzll(value));
+#else
+      uint32_t log2 = 0;
+      for (uint64_t v = value; v >>= 1;)
+        ++log2;
+#endif
+      const uint32_t shift = log2 - SUB_BITS;
+      return shift * SUB_BUCKETS + uint32_t(value >> shift);
+    }
+
+    inline uint64_t LatencyHistogram::value(uint32_t index)
+    {
+      if (index < 2 * SUB_BUCKETS)
+        return index;
+
+      const uint32_t shift = index / SUB_BUCKETS - 1;
+      const uint64_t low   = uint64_t(index % SUB_BUCKETS + SUB_BUCKETS)
+          << shift;
+      return low + (uint64_t(1) << shift) / 2;
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
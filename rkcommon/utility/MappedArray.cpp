@@ -0,0 +1,193 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "MappedArray.h"
+// std
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rkcommon {
+  namespace utility {
+
+    static size_t mapGranularity()
+    {
+#ifdef _WIN32
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      return info.dwAllocationGranularity;
+#else
+      return size_t(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    static std::runtime_error mapError(const std::string &fileName,
+                                       const char *what)
+    {
+      return std::runtime_error("MappedFile: could not " + std::string(what) +
+                                " '" + fileName + "'");
+    }
+
+    MappedFile::MappedFile(const std::string &fileName,
+                           MapMode mode,
+                           size_t offset,
+                           size_t size,
+                           bool hugePages)
+    {
+#ifdef _WIN32
+      (void)hugePages;  // large pages only exist for pagefile-backed views
+      HANDLE file = CreateFileA(fileName.c_str(),
+                                GENERIC_READ,
+                                FILE_SHARE_READ,
+                                nullptr,
+                                OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+      if (file == INVALID_HANDLE_VALUE)
+        throw mapError(fileName, "open");
+
+      LARGE_INTEGER fileSize;
+      GetFileSizeEx(file, &fileSize);
+      const size_t totalBytes = size_t(fileSize.QuadPart);
+#else
+      const int fd = open(fileName.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw mapError(fileName, "open");
+
+      struct stat st;
+      fstat(fd, &st);
+      const size_t totalBytes = size_t(st.st_size);
+#endif
+
+      offset   = std::min(offset, totalBytes);
+      numBytes = std::min(size, totalBytes - offset);
+
+      // views have to start at a multiple of the granularity
+      const size_t viewOffset = offset / mapGranularity() * mapGranularity();
+      mappedSize              = numBytes + (offset - viewOffset);
+
+      if (numBytes > 0) {
+#ifdef _WIN32
+        mappingHandle = CreateFileMappingA(
+            file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle) {
+          base = MapViewOfFile(
+              mappingHandle,
+              mode == MapMode::READ_ONLY ? FILE_MAP_READ : FILE_MAP_COPY,
+              DWORD(uint64_t(viewOffset) >> 32),
+              DWORD(viewOffset & 0xffffffff),
+              mappedSize);
+        }
+#else
+        base = mmap(nullptr,
+                    mappedSize,
+                    mode == MapMode::READ_ONLY ? PROT_READ
+                                               : PROT_READ | PROT_WRITE,
+                    mode == MapMode::READ_ONLY ? MAP_SHARED : MAP_PRIVATE,
+                    fd,
+                    off_t(viewOffset));
+        if (base == MAP_FAILED)
+          base = nullptr;
+#ifdef MADV_HUGEPAGE
+        if (base && hugePages)
+          madvise(base, mappedSize, MADV_HUGEPAGE);
+#else
+        (void)hugePages;
+#endif
+#endif
+      }
+
+      // the mapping keeps the file referenced
+#ifdef _WIN32
+      CloseHandle(file);
+      if (numBytes > 0 && !base) {
+        if (mappingHandle)
+          CloseHandle(mappingHandle);
+        throw mapError(fileName, "map");
+      }
+#else
+      close(fd);
+      if (numBytes > 0 && !base)
+        throw mapError(fileName, "map");
+#endif
+
+      begin = static_cast<char *>(base) + (offset - viewOffset);
+      if (numBytes == 0)
+        begin = nullptr;
+    }
+
+    MappedFile::~MappedFile()
+    {
+      if (!base)
+        return;
+#ifdef _WIN32
+      UnmapViewOfFile(base);
+      CloseHandle(mappingHandle);
+#else
+      munmap(base, mappedSize);
+#endif
+    }
+
+    void *MappedFile::data() const
+    {
+      return begin;
+    }
+
+    size_t MappedFile::size() const
+    {
+      return numBytes;
+    }
+
+    void MappedFile::advise(MapAccess access, size_t offset, size_t size) const
+    {
+      if (!base || offset >= numBytes)
+        return;
+
+      size = std::min(size, numBytes - offset);
+
+#ifdef _WIN32
+      if (access == MapAccess::WILL_NEED) {
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = begin + offset;
+        range.NumberOfBytes  = size;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+      }
+#else
+      // madvise() wants a page aligned start
+      const size_t page  = mapGranularity();
+      char *const first  = begin + offset;
+      char *const start  = reinterpret_cast<char *>(
+          reinterpret_cast<uintptr_t>(first) / page * page);
+      const size_t range = size + size_t(first - start);
+
+      int advice = MADV_NORMAL;
+      switch (access) {
+      case MapAccess::SEQUENTIAL:
+        advice = MADV_SEQUENTIAL;
+        break;
+      case MapAccess::RANDOM:
+        advice = MADV_RANDOM;
+        break;
+      case MapAccess::WILL_NEED:
+        advice = MADV_WILLNEED;
+        break;
+      case MapAccess::NORMAL:
+      default:
+        break;
+      }
+      madvise(start, range, advice);
+#endif
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
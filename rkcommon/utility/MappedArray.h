@@ -0,0 +1,139 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+#include "AbstractArray.h"
+
+#include <string>
+
+namespace rkcommon {
+  namespace utility {
+
+    /*! READ_ONLY maps the file shared and read-only, writing through the
+        array faults (use a const T); COPY_ON_WRITE maps it privately, so
+        writes only create private copies of the touched pages and never
+        reach the file */
+    enum class MapMode
+    {
+      READ_ONLY,
+      COPY_ON_WRITE
+    };
+
+    /*! access pattern hints for MappedFile::advise(), madvise() on POSIX;
+        WILL_NEED starts reading the range in ahead of the first access */
+    enum class MapAccess
+    {
+      NORMAL,
+      SEQUENTIAL,
+      RANDOM,
+      WILL_NEED
+    };
+
+    /*! A byte range of a file mapped into memory (mmap / MapViewOfFile).
+        Pages are read in on first access, so opening a multi-GB file is
+        immediate. Throws std::runtime_error if the file can't be mapped. */
+    class RKCOMMON_INTERFACE MappedFile
+    {
+     public:
+      /*! map 'size' bytes starting at 'offset', up to the end of the file
+          by default; 'hugePages' asks for transparent huge pages
+          (Linux only, and only where the file system supports them) */
+      MappedFile(const std::string &fileName,
+                 MapMode mode     = MapMode::READ_ONLY,
+                 size_t offset    = 0,
+                 size_t size      = size_t(-1),
+                 bool hugePages   = false);
+      ~MappedFile();
+
+      MappedFile(const MappedFile &) = delete;
+      MappedFile &operator=(const MappedFile &) = delete;
+
+      void *data() const;
+      size_t size() const;
+
+      // Hint the access pattern for a byte range, all of it by default
+      void advise(MapAccess access,
+                  size_t offset = 0,
+                  size_t size   = size_t(-1)) const;
+
+     private:
+      void *base{nullptr};  // start of the (page aligned) view
+      size_t mappedSize{0};
+      char *begin{nullptr};  // first requested byte
+      size_t numBytes{0};
+#ifdef _WIN32
+      void *mappingHandle{nullptr};
+#endif
+    };
+
+    /*  'MappedArray<T>' implements an array interface on a memory mapped
+     *  file, so data can be used in place without reading it first. The
+     *  mapping lives as long as the MappedArray.
+     */
+    template <typename T>
+    struct MappedArray : public AbstractArray<T>
+    {
+      /*! map 'count' items starting at byte 'offset' of the file, as many
+          as the file holds by default */
+      explicit MappedArray(const std::string &fileName,
+                           MapMode mode   = MapMode::READ_ONLY,
+                           size_t offset  = 0,
+                           size_t count   = size_t(-1),
+                           bool hugePages = false);
+      ~MappedArray() override = default;
+
+      void advise(MapAccess access) const;
+
+      // Start reading the whole array in the background
+      void prefetch() const;
+
+      const MappedFile &file() const;
+
+     private:
+      MappedFile mapped;
+    };
+
+    // Inlined MappedArray definitions ////////////////////////////////////////
+
+    template <typename T>
+    inline MappedArray<T>::MappedArray(const std::string &fileName,
+                                       MapMode mode,
+                                       size_t offset,
+                                       size_t count,
+                                       bool hugePages)
+        : mapped(fileName,
+                 mode,
+                 offset,
+                 count == size_t(-1) ? count : count * sizeof(T),
+                 hugePages)
+    {
+      if (count != size_t(-1) && mapped.size() < count * sizeof(T))
+        throw std::runtime_error("MappedArray<T>: file '" + fileName +
+                                 "' is too small");
+
+      AbstractArray<T>::setPtr(static_cast<T *>(mapped.data()),
+                               mapped.size() / sizeof(T));
+    }
+
+    template <typename T>
+    inline void MappedArray<T>::advise(MapAccess access) const
+    {
+      mapped.advise(access);
+    }
+
+    template <typename T>
+    inline void MappedArray<T>::prefetch() const
+    {
+      mapped.advise(MapAccess::WILL_NEED);
+    }
+
+    template <typename T>
+    inline const MappedFile &MappedArray<T>::file() const
+    {
+      return mapped;
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
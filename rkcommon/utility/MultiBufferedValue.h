@@ -0,0 +1,456 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include "../tasking/Future.h"
+
+namespace rkcommon {
+  namespace utility {
+
+    /*! This class holds N buffers of a value for pipelining frames across
+        threads, without copying the values or locking. Writers acquire a free
+        slot, fill it and publish() it as the latest value; readers acquire the
+        latest published slot and keep it until they release it, e.g. once the
+        upload of a framebuffer to the GPU finished. Writers never acquire the
+        latest published slot or one still held by a reader, so each stage
+        works on its own buffer while the others move on.
+
+        Example (a 3 frame pipeline: build, upload and display):
+
+          MultiBufferedValue<Frame, 3> frames;
+
+          // build thread
+          auto slot = frames.acquireWrite();
+          buildFrame(*slot);
+          slot.publish();
+
+          // display thread
+          auto frame = frames.acquireRead();
+          if (frame.valid())
+            frame.releaseAfter(tasking::async_future([&]() {...}));
+
+        NOTE: the buffers are reused, so T must be default constructable and a
+              writer finds the contents of an older value in its slot. Slots
+              must not outlive the MultiBufferedValue they came from.
+     */
+    template <typename T, int N = 3>
+    class MultiBufferedValue
+    {
+      static_assert(N >= 2 && N <= 256,
+                    "rkcommon::utility::MultiBufferedValue<T, N> needs at "
+                    "least one buffer besides the latest published one, and "
+                    "at most 256");
+
+     public:
+      // A slot a writer exclusively holds until it publishes or drops it
+      class WriteSlot
+      {
+       public:
+        WriteSlot() = default;
+        ~WriteSlot();
+
+        WriteSlot(WriteSlot &&other);
+        WriteSlot &operator=(WriteSlot &&other);
+
+        WriteSlot(const WriteSlot &) = delete;
+        WriteSlot &operator=(const WriteSlot &) = delete;
+
+        bool valid() const;
+
+        T &operator*();
+        T *operator->();
+
+        // Make the value the latest one readers get, returning its version
+        uint64_t publish();
+
+       private:
+        friend class MultiBufferedValue;
+
+        WriteSlot(MultiBufferedValue *owner, int index);
+
+        MultiBufferedValue *owner{nullptr};
+        int index{-1};
+      };
+
+      // A published value, which writers leave alone until it is released
+      class ReadSlot
+      {
+       public:
+        ReadSlot() = default;
+        ~ReadSlot();
+
+        ReadSlot(ReadSlot &&other);
+        ReadSlot &operator=(ReadSlot &&other);
+
+        ReadSlot(const ReadSlot &) = delete;
+        ReadSlot &operator=(const ReadSlot &) = delete;
+
+        bool valid() const;
+
+        const T &operator*() const;
+        const T *operator->() const;
+
+        // The version publish() returned for this value
+        uint64_t version() const;
+
+        void release();
+
+        // Release the slot once 'future' is ready (also if it failed), so a
+        // task can keep using the value after this handle goes away
+        template <typename U>
+        void releaseAfter(const tasking::Future<U> &future);
+
+       private:
+        friend class MultiBufferedValue;
+
+        ReadSlot(MultiBufferedValue *owner, int index);
+
+        MultiBufferedValue *owner{nullptr};
+        int index{-1};
+      };
+
+      MultiBufferedValue()  = default;
+      ~MultiBufferedValue() = default;
+
+      MultiBufferedValue(const MultiBufferedValue &) = delete;
+      MultiBufferedValue &operator=(const MultiBufferedValue &) = delete;
+
+      // Wait for a free slot to write into; slots released after futures
+      // are released by tasks, which the internal backend runs meanwhile
+      WriteSlot acquireWrite();
+      // An invalid slot if readers hold all slots but the latest
+      WriteSlot tryAcquireWrite();
+
+      // The latest published value, an invalid slot if there is none yet
+      ReadSlot acquireRead();
+
+      // The version of the latest published value, 0 if there is none yet
+      uint64_t latestVersion() const;
+
+      // Run 'fcn(T &)' on a write slot as a task, publishing the value when
+      // it returns; the future holds its version
+      template <typename FCN_T>
+      tasking::Future<uint64_t> publishAsync(FCN_T &&fcn);
+
+     private:
+      // the slot is being written, the low bits count its readers
+      static constexpr uint32_t WRITING = 0x80000000u;
+
+      struct Slot
+      {
+        std::atomic<uint32_t> state{0};
+        uint64_t version{0};
+        T value;
+      };
+
+      static void waitForSlot();
+
+      bool tryAcquire(int index);
+      uint64_t publish(int index);
+      void abandon(int index);
+      bool tryRead(int index);
+      void releaseRead(int index);
+
+      Slot slots[N];
+      // the version of the latest value above its slot index, 0 if none
+      std::atomic<uint64_t> latest{0};
+    };
+
+    // Inlined MultiBufferedValue members /////////////////////////////////////
+
+    template <typename T, int N>
+    constexpr uint32_t MultiBufferedValue<T, N>::WRITING;
+
+    template <typename T, int N>
+    inline typename MultiBufferedValue<T, N>::WriteSlot
+    MultiBufferedValue<T, N>::acquireWrite()
+    {
+      WriteSlot slot = tryAcquireWrite();
+      while (!slot.valid()) {
+        waitForSlot();
+        slot = tryAcquireWrite();
+      }
+      return slot;
+    }
+
+    template <typename T, int N>
+    inline typename MultiBufferedValue<T, N>::WriteSlot
+    MultiBufferedValue<T, N>::tryAcquireWrite()
+    {
+      for (int i = 0; i < N; ++i) {
+        if (tryAcquire(i))
+          return WriteSlot(this, i);
+      }
+      return WriteSlot();
+    }
+
+    template <typename T, int N>
+    inline typename MultiBufferedValue<T, N>::ReadSlot
+    MultiBufferedValue<T, N>::acquireRead()
+    {
+      for (;;) {
+        const uint64_t current = latest.load(std::memory_order_acquire);
+        if (current == 0)
+          return ReadSlot();
+        const int index = int(current & 0xff);
+        if (tryRead(index))
+          return ReadSlot(this, index);
+        // a writer took the slot after a newer one was published
+        waitForSlot();
+      }
+    }
+
+    template <typename T, int N>
+    inline uint64_t MultiBufferedValue<T, N>::latestVersion() const
+    {
+      return latest.load(std::memory_order_acquire) >> 8;
+    }
+
+    template <typename T, int N>
+    template <typename FCN_T>
+    inline tasking::Future<uint64_t> MultiBufferedValue<T, N>::publishAsync(
+        FCN_T &&fcn)
+    {
+      using fcn_t = typename std::decay<FCN_T>::type;
+      fcn_t f(std::forward<FCN_T>(fcn));
+      MultiBufferedValue *self = this;
+      return tasking::async_future([self, f]() {
+        WriteSlot slot = self->acquireWrite();
+        f(*slot);
+        return slot.publish();
+      });
+    }
+
+    template <typename T, int N>
+    inline void MultiBufferedValue<T, N>::waitForSlot()
+    {
+      // the task releasing a slot may be queued behind this thread, even if
+      // it runs a task itself, e.g. in publishAsync()
+#if defined(RKCOMMON_TASKING_INTERNAL)
+      if (!tasking::detail::tryRunTaskInternal())
+#endif
+        std::this_thread::yield();
+    }
+
+    template <typename T, int N>
+    inline bool MultiBufferedValue<T, N>::tryAcquire(int index)
+    {
+      // the latest value stays readable until a newer one replaces it
+      const uint64_t current = latest.load(std::memory_order_acquire);
+      if (current != 0 && index == int(current & 0xff))
+        return false;
+      uint32_t expected = 0;
+      if (!slots[index].state.compare_exchange_strong(
+              expected, WRITING, std::memory_order_acquire))
+        return false;
+
+      // another writer may have published the slot in between
+      const uint64_t now = latest.load(std::memory_order_acquire);
+      if (now == 0 || index != int(now & 0xff))
+        return true;
+      abandon(index);
+      return false;
+    }
+
+    template <typename T, int N>
+    inline uint64_t MultiBufferedValue<T, N>::publish(int index)
+    {
+      // versions grow in the order the values become the latest one, also
+      // with several writers
+      uint64_t current = latest.load(std::memory_order_relaxed);
+      uint64_t version = 0;
+      do {
+        version = (current >> 8) + 1;
+      } while (!latest.compare_exchange_weak(
+          current, version << 8 | uint64_t(index), std::memory_order_release));
+
+      // readers which find the slot still being written retry until it is
+      // cleared
+      slots[index].version = version;
+      slots[index].state.fetch_sub(WRITING, std::memory_order_release);
+      return version;
+    }
+
+    template <typename T, int N>
+    inline void MultiBufferedValue<T, N>::abandon(int index)
+    {
+      slots[index].state.fetch_sub(WRITING, std::memory_order_release);
+    }
+
+    template <typename T, int N>
+    inline bool MultiBufferedValue<T, N>::tryRead(int index)
+    {
+      // a writer only takes a slot without readers, so counting first fences
+      // the slot off, unless a writer got it already
+      const uint32_t previous =
+          slots[index].state.fetch_add(1, std::memory_order_acquire);
+      if (!(previous & WRITING))
+        return true;
+      releaseRead(index);
+      return false;
+    }
+
+    template <typename T, int N>
+    inline void MultiBufferedValue<T, N>::releaseRead(int index)
+    {
+      slots[index].state.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Inlined WriteSlot members //////////////////////////////////////////////
+
+    template <typename T, int N>
+    inline MultiBufferedValue<T, N>::WriteSlot::WriteSlot(
+        MultiBufferedValue *_owner, int _index)
+        : owner(_owner), index(_index)
+    {
+    }
+
+    template <typename T, int N>
+    inline MultiBufferedValue<T, N>::WriteSlot::~WriteSlot()
+    {
+      if (owner)
+        owner->abandon(index);
+    }
+
+    template <typename T, int N>
+    inline MultiBufferedValue<T, N>::WriteSlot::WriteSlot(WriteSlot &&other)
+        : owner(other.owner), index(other.index)
+    {
+      other.owner = nullptr;
+      other.index = -1;
+    }
+
+    template <typename T, int N>
+    inline typename MultiBufferedValue<T, N>::WriteSlot &
+    MultiBufferedValue<T, N>::WriteSlot::operator=(WriteSlot &&other)
+    {
+      if (this != &other) {
+        if (owner)
+          owner->abandon(index);
+        owner       = other.owner;
+        index       = other.index;
+        other.owner = nullptr;
+        other.index = -1;
+      }
+      return *this;
+    }
+
+    template <typename T, int N>
+    inline bool MultiBufferedValue<T, N>::WriteSlot::valid() const
+    {
+      return owner != nullptr;
+    }
+
+    template <typename T, int N>
+    inline T &MultiBufferedValue<T, N>::WriteSlot::operator*()
+    {
+      return owner->slots[index].value;
+    }
+
+    template <typename T, int N>
+    inline T *MultiBufferedValue<T, N>::WriteSlot::operator->()
+    {
+      return &owner->slots[index].value;
+    }
+
+    template <typename T, int N>
+    inline uint64_t MultiBufferedValue<T, N>::WriteSlot::publish()
+    {
+      const uint64_t version = owner->publish(index);
+      owner                  = nullptr;
+      index                  = -1;
+      return version;
+    }
+
+    // Inlined ReadSlot members ///////////////////////////////////////////////
+
+    template <typename T, int N>
+    inline MultiBufferedValue<T, N>::ReadSlot::ReadSlot(
+        MultiBufferedValue *_owner, int _index)
+        : owner(_owner), index(_index)
+    {
+    }
+
+    template <typename T, int N>
+    inline MultiBufferedValue<T, N>::ReadSlot::~ReadSlot()
+    {
+      release();
+    }
+
+    template <typename T, int N>
+    inline MultiBufferedValue<T, N>::ReadSlot::ReadSlot(ReadSlot &&other)
+        : owner(other.owner), index(other.index)
+    {
+      other.owner = nullptr;
+      other.index = -1;
+    }
+
+    template <typename T, int N>
+    inline typename MultiBufferedValue<T, N>::ReadSlot &
+    MultiBufferedValue<T, N>::ReadSlot::operator=(ReadSlot &&other)
+    {
+      if (this != &other) {
+        release();
+        owner       = other.owner;
+        index       = other.index;
+        other.owner = nullptr;
+        other.index = -1;
+      }
+      return *this;
+    }
+
+    template <typename T, int N>
+    inline bool MultiBufferedValue<T, N>::ReadSlot::valid() const
+    {
+      return owner != nullptr;
+    }
+
+    template <typename T, int N>
+    inline const T &MultiBufferedValue<T, N>::ReadSlot::operator*() const
+    {
+      return owner->slots[index].value;
+    }
+
+    template <typename T, int N>
+    inline const T *MultiBufferedValue<T, N>::ReadSlot::operator->() const
+    {
+      return &owner->slots[index].value;
+    }
+
+    template <typename T, int N>
+    inline uint64_t MultiBufferedValue<T, N>::ReadSlot::version() const
+    {
+      return owner->slots[index].version;
+    }
+
+    template <typename T, int N>
+    inline void MultiBufferedValue<T, N>::ReadSlot::release()
+    {
+      if (owner)
+        owner->releaseRead(index);
+      owner = nullptr;
+      index = -1;
+    }
+
+    template <typename T, int N>
+    template <typename U>
+    inline void MultiBufferedValue<T, N>::ReadSlot::releaseAfter(
+        const tasking::Future<U> &future)
+    {
+      if (!owner)
+        return;
+      MultiBufferedValue *o = owner;
+      const int i           = index;
+      future.onReady([o, i]() { o->releaseRead(i); });
+      owner = nullptr;
+      index = -1;
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
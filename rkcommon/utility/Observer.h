@@ -7,6 +7,8 @@
 #include "TimeStamp.h"
 
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 namespace rkcommon {
@@ -19,22 +21,62 @@ namespace rkcommon {
     // NOTE(jda) - This can either be used as a base class or as a stand-alone
     //             member of a class. It is up to the user to decide best how to
     //             use this abstraction.
+    //
+    // Each notification renews the modification time stamp of the observable
+    // and counts a change, which observers compare against what they saw
+    // last, so notifying takes no locks. Notifications propagate to parents
+    // (e.g. from a geometry to the scenes using it), which are modified no
+    // earlier than any of their children: after a parent's observer notices a
+    // change, modifiedSince() finds the children which changed.
+    //
+    // NOTE: the parent links must not form a cycle, and observables must
+    //       outlive the notifications in flight on other threads.
     struct Observable
     {
       Observable() = default;
       virtual ~Observable();
 
+      Observable(const Observable &) = delete;
+      Observable &operator=(const Observable &) = delete;
+
       void notifyObservers();
 
+      // The time stamp of the last notification
+      size_t version() const;
+      // The number of notifications so far, including the children's
+      size_t numChanges() const;
+
+      bool modifiedSince(size_t version) const;
+
+      // Propagate notifications of this observable to 'parent'
+      void addParent(Observable &parent);
+      void removeParent(Observable &parent);
+
      private:
       friend Observer;
 
+      // links are appended without locks and only cleared (not removed)
+      // until destruction, so notifications may walk them at any time
+      struct ParentLink
+      {
+        std::atomic<Observable *> parent;
+        ParentLink *next;
+      };
+
       void registerObserver(Observer &newObserver);
       void removeObserver(Observer &toRemove);
 
+      void detachParent(Observable &parent);
+
       TimeStamp lastNotified;
+      std::atomic<size_t> changes{0};
 
+      std::atomic<ParentLink *> parents{nullptr};
+
+      // guards registration, which the notifications don't touch
+      std::mutex registrationMutex;
       std::vector<Observer *> observers;
+      std::vector<Observable *> children;
     };
 
     // Something that looks an an observable instance.
@@ -48,11 +90,18 @@ namespace rkcommon {
 
       bool wasNotified();
 
+      // The number of notifications since the last check, 0 if none
+      size_t numNotifications();
+
+      // The version of the observable seen by the last check
+      size_t lastObservedVersion() const;
+
      private:
       friend Observable;
 
-      TimeStamp lastObserved;
-      Observable *observee{nullptr};
+      size_t lastObserved{0};
+      size_t lastChanges{0};
+      std::atomic<Observable *> observee{nullptr};
     };
 
     // Inlined definitions ////////////////////////////////////////////////////
@@ -61,50 +110,160 @@ namespace rkcommon {
 
     inline Observable::~Observable()
     {
-      for (auto *observer : observers)
-        observer->observee = nullptr;
+      std::vector<Observable *> formerChildren;
+      {
+        std::lock_guard<std::mutex> lock(registrationMutex);
+        for (auto *observer : observers)
+          observer->observee = nullptr;
+        formerChildren.swap(children);
+      }
+
+      for (auto *child : formerChildren)
+        child->detachParent(*this);
+
+      ParentLink *link = parents.load();
+      while (link) {
+        Observable *parent = link->parent.load();
+        if (parent) {
+          std::lock_guard<std::mutex> lock(parent->registrationMutex);
+          auto &c        = parent->children;
+          const auto pos = std::find(c.begin(), c.end(), this);
+          if (pos != c.end())
+            c.erase(pos);
+        }
+        ParentLink *next = link->next;
+        delete link;
+        link = next;
+      }
     }
 
     inline void Observable::notifyObservers()
     {
+      // counted first, so a check which sees the new version counts it
+      changes++;
       lastNotified.renew();
+
+      ParentLink *link = parents.load(std::memory_order_acquire);
+      while (link) {
+        Observable *parent = link->parent.load(std::memory_order_acquire);
+        if (parent)
+          parent->notifyObservers();
+        link = link->next;
+      }
+    }
+
+    inline size_t Observable::version() const
+    {
+      return lastNotified;
+    }
+
+    inline size_t Observable::numChanges() const
+    {
+      return changes;
+    }
+
+    inline bool Observable::modifiedSince(size_t _version) const
+    {
+      return version() > _version;
+    }
+
+    inline void Observable::addParent(Observable &parent)
+    {
+      {
+        std::lock_guard<std::mutex> lock(parent.registrationMutex);
+        parent.children.push_back(this);
+      }
+
+      // reuse a cleared link before appending a new one
+      for (ParentLink *link = parents.load(); link; link = link->next) {
+        Observable *expected = nullptr;
+        if (link->parent.compare_exchange_strong(expected, &parent))
+          return;
+      }
+
+      auto *link   = new ParentLink;
+      link->parent = &parent;
+      link->next   = parents.load();
+      while (!parents.compare_exchange_weak(link->next, link))
+        ;
+    }
+
+    inline void Observable::removeParent(Observable &parent)
+    {
+      {
+        std::lock_guard<std::mutex> lock(parent.registrationMutex);
+        auto &c        = parent.children;
+        const auto pos = std::find(c.begin(), c.end(), this);
+        if (pos == c.end())
+          return;
+        c.erase(pos);
+      }
+      detachParent(parent);
+    }
+
+    inline void Observable::detachParent(Observable &parent)
+    {
+      for (ParentLink *link = parents.load(); link; link = link->next) {
+        Observable *expected = &parent;
+        if (link->parent.compare_exchange_strong(expected, nullptr))
+          return;
+      }
     }
 
     inline void Observable::registerObserver(Observer &newObserver)
     {
+      std::lock_guard<std::mutex> lock(registrationMutex);
       observers.push_back(&newObserver);
     }
 
     inline void Observable::removeObserver(Observer &toRemove)
     {
+      std::lock_guard<std::mutex> lock(registrationMutex);
       auto &o = observers;
       o.erase(std::remove(o.begin(), o.end(), &toRemove), o.end());
     }
 
     // Observer //
 
-    inline Observer::Observer(Observable &_observee) : observee(&_observee)
+    inline Observer::Observer(Observable &_observee)
+        : lastObserved(_observee.version()),
+          lastChanges(_observee.numChanges()),
+          observee(&_observee)
     {
-      observee->registerObserver(*this);
+      _observee.registerObserver(*this);
     }
 
     inline Observer::~Observer()
     {
-      if (observee)
-        observee->removeObserver(*this);
+      Observable *o = observee.load();
+      if (o)
+        o->removeObserver(*this);
     }
 
     inline bool Observer::wasNotified()
     {
-      if (!observee)
-        return false;
+      return numNotifications() != 0;
+    }
 
-      bool notified = lastObserved < observee->lastNotified;
+    inline size_t Observer::numNotifications()
+    {
+      Observable *o = observee.load();
+      if (!o)
+        return 0;
 
-      if (notified)
-        lastObserved.renew();
+      // a notification in flight may be counted before its version is
+      // renewed, the count is what tells if there were any
+      const size_t version       = o->version();
+      const size_t changes       = o->numChanges();
+      const size_t notifications = changes - lastChanges;
+      lastObserved               = std::max(lastObserved, version);
+      lastChanges                = changes;
+      return notifications;
+    }
 
-      return notified;
+    inline size_t Observer::lastObservedVersion() const
+    {
+      return lastObserved;
     }
 
   }  // namespace utility
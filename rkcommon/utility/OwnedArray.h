@@ -4,23 +4,37 @@
 #pragma once
 
 #include "../common.h"
+#include "../containers/UninitVector.h"
+#include "../containers/aligned_allocator.h"
 #include "AbstractArray.h"
 
 #include <array>
+#include <type_traits>
 #include <vector>
 
 namespace rkcommon {
   namespace utility {
 
     /*  'OwnedArray<T>' implements an array interface on a pointer to
-     *  data which is owned by the OwnedArray.
+     *  data which is owned by the OwnedArray. Growing it with resize(size)
+     *  leaves the new elements default-initialized (ie, not zero filled
+     *  for trivial types), as they are about to be overwritten.
+     *
+     *  The memory comes from ALLOC, 64 byte aligned by default; e.g.
+     *  containers::uninitialized_allocator<T, memory::HugePages::ADVISED>,
+     *  containers::numa_aligned_allocator<T> or memory::ArenaAllocator<T>.
+     *  With containers::device_aligned_allocator<T> the data is device
+     *  accessible if a memory::DeviceAllocator was set.
      */
-    template <typename T>
+    template <typename T,
+              typename ALLOC = containers::uninitialized_allocator<T>>
     struct OwnedArray : public AbstractArray<T>
     {
       OwnedArray()           = default;
       ~OwnedArray() override = default;
 
+      explicit OwnedArray(const ALLOC &allocator);
+
       template <size_t SIZE>
       OwnedArray(std::array<T, SIZE> &init);
 
@@ -37,72 +51,132 @@ namespace rkcommon {
       void reset(T *_data, size_t _size);
 
       void resize(size_t size, const T &val);
+      void resize(size_t size);
+
+      // resize(size) spelled out where a buffer is about to be overwritten
+      void resize_uninitialized(size_t size);
+
+      void reserve(size_t capacity);
+      size_t capacity() const;
+
+      memory::DeviceMemory deviceMemory() const override;
 
      private:
-      std::vector<T> dataBuf;
+      using buffer_t =
+          std::vector<T, containers::default_init_allocator<ALLOC>>;
+
+      buffer_t dataBuf;
     };
 
     // Inlined OwnedArray definitions /////////////////////////////////////////
 
-    template <typename T>
-    inline OwnedArray<T>::OwnedArray(T *_data, size_t _size)
+    template <typename T, typename ALLOC>
+    inline OwnedArray<T, ALLOC>::OwnedArray(const ALLOC &allocator)
+        : dataBuf(allocator)
+    {
+    }
+
+    template <typename T, typename ALLOC>
+    inline OwnedArray<T, ALLOC>::OwnedArray(T *_data, size_t _size)
         : dataBuf(_data, _data + _size)
     {
       AbstractArray<T>::setPtr(dataBuf.data(), dataBuf.size());
     }
 
-    template <typename T>
+    template <typename T, typename ALLOC>
     template <size_t SIZE>
-    inline OwnedArray<T>::OwnedArray(std::array<T, SIZE> &init)
+    inline OwnedArray<T, ALLOC>::OwnedArray(std::array<T, SIZE> &init)
         : dataBuf(init.begin(), init.end())
     {
       AbstractArray<T>::setPtr(dataBuf.data(), dataBuf.size());
     }
 
-    template <typename T>
-    inline OwnedArray<T>::OwnedArray(std::vector<T> &init) : dataBuf(init)
+    template <typename T, typename ALLOC>
+    inline OwnedArray<T, ALLOC>::OwnedArray(std::vector<T> &init)
+        : dataBuf(init.begin(), init.end())
     {
       AbstractArray<T>::setPtr(dataBuf.data(), dataBuf.size());
     }
 
-    template <typename T>
+    template <typename T, typename ALLOC>
     template <size_t SIZE>
-    inline OwnedArray<T> &OwnedArray<T>::operator=(std::array<T, SIZE> &rhs)
+    inline OwnedArray<T, ALLOC> &OwnedArray<T, ALLOC>::operator=(
+        std::array<T, SIZE> &rhs)
     {
-      dataBuf = std::vector<T>(rhs.begin(), rhs.end());
+      dataBuf = buffer_t(rhs.begin(), rhs.end(), dataBuf.get_allocator());
       AbstractArray<T>::setPtr(dataBuf.data(), dataBuf.size());
       return *this;
     }
 
-    template <typename T>
-    inline OwnedArray<T> &OwnedArray<T>::operator=(std::vector<T> &rhs)
+    template <typename T, typename ALLOC>
+    inline OwnedArray<T, ALLOC> &OwnedArray<T, ALLOC>::operator=(
+        std::vector<T> &rhs)
     {
-      dataBuf = std::vector<T>(rhs.begin(), rhs.end());
+      dataBuf = buffer_t(rhs.begin(), rhs.end(), dataBuf.get_allocator());
       AbstractArray<T>::setPtr(dataBuf.data(), dataBuf.size());
       return *this;
     }
 
-    template <typename T>
-    inline void OwnedArray<T>::reset()
+    template <typename T, typename ALLOC>
+    inline void OwnedArray<T, ALLOC>::reset()
     {
       dataBuf.clear();
       dataBuf.shrink_to_fit();
       AbstractArray<T>::setPtr(nullptr, 0);
     }
 
-    template <typename T>
-    inline void OwnedArray<T>::reset(T *_data, size_t _size)
+    template <typename T, typename ALLOC>
+    inline void OwnedArray<T, ALLOC>::reset(T *_data, size_t _size)
     {
-      dataBuf = std::vector<T>(_data, _data + _size);
+      dataBuf = buffer_t(_data, _data + _size, dataBuf.get_allocator());
       AbstractArray<T>::setPtr(dataBuf.data(), dataBuf.size());
     }
 
-    template <typename T>
-    inline void OwnedArray<T>::resize(size_t size, const T &val)
+    template <typename T, typename ALLOC>
+    inline void OwnedArray<T, ALLOC>::resize(size_t size, const T &val)
     {
       dataBuf.resize(size, val);
       AbstractArray<T>::setPtr(dataBuf.data(), dataBuf.size());
     }
 
+    template <typename T, typename ALLOC>
+    inline void OwnedArray<T, ALLOC>::resize(size_t size)
+    {
+      dataBuf.resize(size);
+      AbstractArray<T>::setPtr(dataBuf.data(), dataBuf.size());
+    }
+
+    template <typename T, typename ALLOC>
+    inline void OwnedArray<T, ALLOC>::resize_uninitialized(size_t size)
+    {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "resize_uninitialized() needs trivially copyable types");
+      resize(size);
+    }
+
+    template <typename T, typename ALLOC>
+    inline void OwnedArray<T, ALLOC>::reserve(size_t capacity)
+    {
+      dataBuf.reserve(capacity);
+      AbstractArray<T>::setPtr(dataBuf.data(), dataBuf.size());
+    }
+
+    template <typename T, typename ALLOC>
+    inline size_t OwnedArray<T, ALLOC>::capacity() const
+    {
+      return dataBuf.capacity();
+    }
+
+    template <typename T, typename ALLOC>
+    inline memory::DeviceMemory OwnedArray<T, ALLOC>::deviceMemory() const
+    {
+      // what deviceAlignedMalloc() actually returned
+      if (containers::allocator_device_memory<ALLOC>::value
+              == memory::DeviceMemory::PAGEABLE
+          || dataBuf.capacity() == 0)
+        return memory::DeviceMemory::PAGEABLE;
+      return memory::deviceMemoryOf(dataBuf.data());
+    }
+
   }  // namespace utility
 }  // namespace rkcommon
@@ -4,39 +4,166 @@
 #include "ParameterizedObject.h"
 
 #include <algorithm>
+#include <mutex>
+#include <unordered_set>
 
 namespace rkcommon {
   namespace utility {
 
-    ParameterizedObject::Param::Param(const std::string &_name) : name(_name) {}
+    // parameters beyond which lookups go through the hashed index
+    static const size_t maxScannedParams = 16;
 
-    void ParameterizedObject::removeParam(const std::string &name)
+    // the interned copy of 'name', which the elements of the set hold
+    static const char *internName(const std::string &name)
     {
-      auto foundParam = std::find_if(
-          paramList.begin(),
-          paramList.end(),
-          [&](const std::shared_ptr<Param> &p) { return p->name == name; });
+      // function statics, as keys may be constructed during static
+      // initialization of other translation units
+      static std::mutex mutex;
+      static std::unordered_set<std::string> names;
+      std::lock_guard<std::mutex> lock(mutex);
+      return names.insert(name).first->c_str();
+    }
+
+    // ParamKey definitions ///////////////////////////////////////////////////
+
+    ParamKey::ParamKey(const char *_name) : ParamKey(std::string(_name)) {}
 
-      if (foundParam != paramList.end()) {
-        paramList.erase(foundParam);
+    ParamKey::ParamKey(const std::string &_name)
+        : name(internName(_name)),
+          length(_name.size()),
+          hash(hashName(_name.c_str(), _name.size()))
+    {
+    }
+
+    // ParameterizedObject definitions ////////////////////////////////////////
+
+    ParameterizedObject::Param::Param(const std::string &_name)
+        : Param(ParamKey(_name))
+    {
+    }
+
+    ParameterizedObject::Param::Param(const ParamKey &_key)
+        : name(_key.name, _key.length), key(_key.name), hash(_key.hash)
+    {
+    }
+
+    size_t ParameterizedObject::findIndex(const char *name,
+                                          size_t length,
+                                          uint64_t hash,
+                                          const char *key) const
+    {
+      // interned names are equal if their pointers are
+      const auto matches = [&](const Param &p) {
+        return p.hash == hash
+               && (key ? p.key == key
+                       : p.name.size() == length
+                             && std::memcmp(p.name.data(), name, length)
+                                    == 0);
+      };
+
+      if (paramIndex.empty()) {
+        for (size_t i = 0; i < paramList.size(); ++i) {
+          if (matches(paramList[i]))
+            return i;
+        }
+      } else {
+        const auto range = paramIndex.equal_range(hash);
+        for (auto i = range.first; i != range.second; ++i) {
+          if (matches(paramList[i->second]))
+            return i->second;
+        }
       }
+      return paramList.size();
     }
 
     ParameterizedObject::Param *ParameterizedObject::findParam(
-        const std::string &name, bool addIfNotExist)
-    {
-      auto foundParam = std::find_if(
-          paramList.begin(),
-          paramList.end(),
-          [&](const std::shared_ptr<Param> &p) { return p->name == name; });
-
-      if (foundParam != paramList.end())
-        return foundParam->get();
-      else if (addIfNotExist) {
-        paramList.push_back(std::make_shared<Param>(name));
-        return paramList[paramList.size() - 1].get();
-      } else
+        const char *name,
+        size_t length,
+        uint64_t hash,
+        const char *key,
+        bool addIfNotExist)
+    {
+      const size_t index = findIndex(name, length, hash, key);
+      if (index < paramList.size())
+        return &paramList[index];
+      if (!addIfNotExist)
         return nullptr;
+
+      if (!removedParams.empty()) {
+        const std::string added(name, length);
+        removedParams.erase(std::remove_if(removedParams.begin(),
+                                           removedParams.end(),
+                                           [&](const RemovedParam &r) {
+                                             return r.name == added;
+                                           }),
+                            removedParams.end());
+      }
+
+      paramList.emplace_back(std::string(name, length));
+      if (!paramIndex.empty())
+        paramIndex.emplace(hash, index);
+      else if (paramList.size() > maxScannedParams) {
+        for (size_t i = 0; i < paramList.size(); ++i)
+          paramIndex.emplace(paramList[i].hash, i);
+      }
+      return &paramList.back();
     }
+
+    // erase the entry of 'index' from the entries of 'hash'
+    static void eraseIndex(std::unordered_multimap<uint64_t, size_t> &index,
+                           uint64_t hash,
+                           size_t i)
+    {
+      const auto range = index.equal_range(hash);
+      for (auto entry = range.first; entry != range.second; ++entry) {
+        if (entry->second == i) {
+          index.erase(entry);
+          return;
+        }
+      }
+    }
+
+    void ParameterizedObject::removeParam(const char *name,
+                                          size_t length,
+                                          uint64_t hash,
+                                          const char *key)
+    {
+      const size_t index = findIndex(name, length, hash, key);
+      if (index == paramList.size())
+        return;
+
+      const size_t last = paramList.size() - 1;
+      if (!paramIndex.empty()) {
+        eraseIndex(paramIndex, hash, index);
+        if (index != last) {
+          eraseIndex(paramIndex, paramList[last].hash, last);
+          paramIndex.emplace(paramList[last].hash, index);
+        }
+      }
+      RemovedParam removed{paramList[index].name, TimeStamp()};
+      auto earlier = std::find_if(
+          removedParams.begin(),
+          removedParams.end(),
+          [&](const RemovedParam &r) { return r.name == removed.name; });
+      if (earlier != removedParams.end())
+        *earlier = std::move(removed);
+      else
+        removedParams.push_back(std::move(removed));
+
+      if (index != last)
+        paramList[index] = paramList[last];
+      paramList.pop_back();
+    }
+
+    void ParameterizedObject::forgetRemovedParams(size_t before)
+    {
+      removedParams.erase(std::remove_if(removedParams.begin(),
+                                         removedParams.end(),
+                                         [&](const RemovedParam &r) {
+                                           return r.removedAt < before;
+                                         }),
+                          removedParams.end());
+    }
+
   }  // namespace utility
 }  // namespace rkcommon
@@ -4,13 +4,40 @@
 #pragma once
 
 // stl
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <unordered_map>
 #include <vector>
 // rkcommon
 #include "Any.h"
+#include "TimeStamp.h"
 
 namespace rkcommon {
   namespace utility {
 
+    /*! \brief a parameter name interned once, for lookups which compare a
+        precomputed hash and a pointer instead of the characters, e.g.:
+
+          static const ParamKey radius("radius");
+          obj.getParam<float>(radius, 1.f);
+     */
+    struct RKCOMMON_INTERFACE ParamKey
+    {
+      ParamKey(const char *name);
+      ParamKey(const std::string &name);
+
+      /*! the interned copy of the name, valid as long as the process; equal
+          names have the same pointer */
+      const char *name;
+      size_t length;
+      uint64_t hash;
+
+      /*! FNV-1a, as the keys and the parameters hash their names */
+      static uint64_t hashName(const char *name, size_t length);
+    };
+
     /*! \brief defines a basic object whose lifetime is managed by ospray */
     struct RKCOMMON_INTERFACE ParameterizedObject
     {
@@ -22,6 +49,7 @@ namespace rkcommon {
       struct RKCOMMON_INTERFACE Param
       {
         Param(const std::string &name);
+        Param(const ParamKey &key);
         ~Param() = default;
 
         template <typename T>
@@ -31,38 +59,149 @@ namespace rkcommon {
         std::string name;
 
         bool query = false;
+
+        // the interned name, for lookups
+        const char *key = nullptr;
+        uint64_t hash   = 0;
+
+        // renewed by every set()
+        TimeStamp lastModified;
+      };
+
+      /*! iterates over the parameters, dereferencing to Param * */
+      class ParamIterator
+      {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = Param *;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = Param **;
+        using reference         = Param *;
+
+        ParamIterator() = default;
+        explicit ParamIterator(std::deque<Param>::iterator it) : it(it) {}
+
+        Param *operator*() const
+        {
+          return &*it;
+        }
+
+        ParamIterator &operator++()
+        {
+          ++it;
+          return *this;
+        }
+
+        ParamIterator operator++(int)
+        {
+          ParamIterator copy(*this);
+          ++it;
+          return copy;
+        }
+
+        bool operator==(const ParamIterator &other) const
+        {
+          return it == other.it;
+        }
+
+        bool operator!=(const ParamIterator &other) const
+        {
+          return it != other.it;
+        }
+
+       private:
+        std::deque<Param>::iterator it;
       };
 
       /*! \brief check if a given parameter is available */
       bool hasParam(const std::string &name);
+      bool hasParam(const char *name);
+      bool hasParam(const ParamKey &key);
 
       /*! set a parameter with given name to given value, create param if not
        *  existing */
       template <typename T>
       void setParam(const std::string &name, const T &t);
+      template <typename T>
+      void setParam(const char *name, const T &t);
+      template <typename T>
+      void setParam(const ParamKey &key, const T &t);
 
       template <typename T>
       T getParam(const std::string &name, T valIfNotFound);
+      template <typename T>
+      T getParam(const char *name, T valIfNotFound);
+      template <typename T>
+      T getParam(const ParamKey &key, T valIfNotFound);
 
+      /*! moves the last parameter into the place of the removed one */
       void removeParam(const std::string &name);
+      void removeParam(const char *name);
+      void removeParam(const ParamKey &key);
 
       void resetAllParamQueryStatus();
 
+      /*! calls 'fcn(const Param &)' for the parameters set at or after the
+          TimeStamp value 'since', e.g. to send only what changed */
+      template <typename FCN_T>
+      void forEachParamSince(size_t since, FCN_T &&fcn) const;
+
+      /*! calls 'fcn(const std::string &name)' for the parameters removed at
+          or after 'since' and not set again since */
+      template <typename FCN_T>
+      void forEachRemovedParamSince(size_t since, FCN_T &&fcn) const;
+
+      /*! forgets the removals before 'before', once no delta will be taken
+          from earlier stamps */
+      void forgetRemovedParams(size_t before);
+
      protected:
+      /*! the parameters stay in place as others are added, until one is
+          removed */
       Param *findParam(const std::string &name, bool addIfNotExist = false);
+      Param *findParam(const char *name, bool addIfNotExist = false);
+      Param *findParam(const ParamKey &key, bool addIfNotExist = false);
 
-      std::vector<std::shared_ptr<Param>>::iterator params_begin();
-      std::vector<std::shared_ptr<Param>>::iterator params_end();
+      ParamIterator params_begin();
+      ParamIterator params_end();
 
      private:
+      /*! 'key' is the interned name if known, to compare instead of the
+          characters; paramList.size() if there is no such parameter */
+      size_t findIndex(const char *name,
+                       size_t length,
+                       uint64_t hash,
+                       const char *key) const;
+
+      Param *findParam(const char *name,
+                       size_t length,
+                       uint64_t hash,
+                       const char *key,
+                       bool addIfNotExist);
+
+      void removeParam(const char *name,
+                       size_t length,
+                       uint64_t hash,
+                       const char *key);
+
       // Data members //
 
-      /*! \brief list of parameters attached to this object */
-      // NOTE(jda) - Use std::shared_ptr because copy/move of a
-      //             ParameterizedObject would end up copying parameters, where
-      //             destruction of each copy should only result in freeing the
-      //             parameters *once*
-      std::vector<std::shared_ptr<Param>> paramList;
+      /*! \brief list of parameters attached to this object, in blocks of
+          contiguous storage */
+      std::deque<Param> paramList;
+
+      /*! parameter indices by hash, once there are too many parameters to
+          scan through */
+      std::unordered_multimap<uint64_t, size_t> paramIndex;
+
+      struct RemovedParam
+      {
+        std::string name;
+        size_t removedAt;
+      };
+
+      /*! the removed parameters, for forEachRemovedParamSince() */
+      std::vector<RemovedParam> removedParams;
     };
 
     // Inlined ParameterizedObject definitions ////////////////////////////////
@@ -71,6 +210,7 @@ namespace rkcommon {
     inline void ParameterizedObject::Param::set(const T &v)
     {
       data = v;
+      lastModified.renew();
     }
 
     inline bool ParameterizedObject::hasParam(const std::string &name)
@@ -78,6 +218,16 @@ namespace rkcommon {
       return findParam(name, false) != nullptr;
     }
 
+    inline bool ParameterizedObject::hasParam(const char *name)
+    {
+      return findParam(name, false) != nullptr;
+    }
+
+    inline bool ParameterizedObject::hasParam(const ParamKey &key)
+    {
+      return findParam(key, false) != nullptr;
+    }
+
     template <typename T>
     inline void ParameterizedObject::setParam(const std::string &name,
                                               const T &t)
@@ -85,9 +235,28 @@ namespace rkcommon {
       findParam(name, true)->set(t);
     }
 
+    template <typename T>
+    inline void ParameterizedObject::setParam(const char *name, const T &t)
+    {
+      findParam(name, true)->set(t);
+    }
+
+    template <typename T>
+    inline void ParameterizedObject::setParam(const ParamKey &key,
+                                              const T &t)
+    {
+      findParam(key, true)->set(t);
+    }
+
     template <typename T>
     inline T ParameterizedObject::getParam(const std::string &name,
                                            T valIfNotFound)
+    {
+      return getParam<T>(name.c_str(), valIfNotFound);
+    }
+
+    template <typename T>
+    inline T ParameterizedObject::getParam(const char *name, T valIfNotFound)
     {
       Param *param = findParam(name);
       if (!param)
@@ -98,22 +267,111 @@ namespace rkcommon {
       return param->data.get<T>();
     }
 
+    template <typename T>
+    inline T ParameterizedObject::getParam(const ParamKey &key,
+                                           T valIfNotFound)
+    {
+      Param *param = findParam(key);
+      if (!param)
+        return valIfNotFound;
+      if (!param->data.is<T>())
+        return valIfNotFound;
+      param->query = true;
+      return param->data.get<T>();
+    }
+
+    inline void ParameterizedObject::removeParam(const std::string &name)
+    {
+      removeParam(name.c_str(),
+                  name.size(),
+                  ParamKey::hashName(name.c_str(), name.size()),
+                  nullptr);
+    }
+
+    inline void ParameterizedObject::removeParam(const char *name)
+    {
+      const size_t length = std::strlen(name);
+      removeParam(name, length, ParamKey::hashName(name, length), nullptr);
+    }
+
+    inline void ParameterizedObject::removeParam(const ParamKey &key)
+    {
+      removeParam(key.name, key.length, key.hash, key.name);
+    }
+
     inline void ParameterizedObject::resetAllParamQueryStatus()
     {
       for (auto p = params_begin(); p != params_end(); ++p)
         (*p)->query = false;
     }
 
-    inline std::vector<std::shared_ptr<ParameterizedObject::Param>>::iterator
+    template <typename FCN_T>
+    inline void ParameterizedObject::forEachParamSince(size_t since,
+                                                       FCN_T &&fcn) const
+    {
+      for (const Param &p : paramList) {
+        if (p.lastModified >= since)
+          fcn(p);
+      }
+    }
+
+    template <typename FCN_T>
+    inline void ParameterizedObject::forEachRemovedParamSince(
+        size_t since, FCN_T &&fcn) const
+    {
+      for (const RemovedParam &r : removedParams) {
+        if (r.removedAt >= since)
+          fcn(r.name);
+      }
+    }
+
+    inline ParameterizedObject::Param *ParameterizedObject::findParam(
+        const std::string &name, bool addIfNotExist)
+    {
+      return findParam(name.c_str(),
+                       name.size(),
+                       ParamKey::hashName(name.c_str(), name.size()),
+                       nullptr,
+                       addIfNotExist);
+    }
+
+    inline ParameterizedObject::Param *ParameterizedObject::findParam(
+        const char *name, bool addIfNotExist)
+    {
+      const size_t length = std::strlen(name);
+      return findParam(name,
+                       length,
+                       ParamKey::hashName(name, length),
+                       nullptr,
+                       addIfNotExist);
+    }
+
+    inline ParameterizedObject::Param *ParameterizedObject::findParam(
+        const ParamKey &key, bool addIfNotExist)
+    {
+      return findParam(
+          key.name, key.length, key.hash, key.name, addIfNotExist);
+    }
+
+    inline ParameterizedObject::ParamIterator
     ParameterizedObject::params_begin()
     {
-      return paramList.begin();
+      return ParamIterator(paramList.begin());
+    }
+
+    inline ParameterizedObject::ParamIterator ParameterizedObject::params_end()
+    {
+      return ParamIterator(paramList.end());
     }
 
-    inline std::vector<std::shared_ptr<ParameterizedObject::Param>>::iterator
-    ParameterizedObject::params_end()
+    inline uint64_t ParamKey::hashName(const char *name, size_t length)
     {
-      return paramList.end();
+      uint64_t hash = 14695981039346656037ull;
+      for (size_t i = 0; i < length; ++i) {
+        hash ^= uint8_t(name[i]);
+        hash *= 1099511628211ull;
+      }
+      return hash;
     }
 
   }  // namespace utility
@@ -0,0 +1,349 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "PixelConvert.h"
+#include "../math/dispatch.h"
+#include "../math/fastmath.h"
+#include "../math/half.h"
+#include "../tasking/parallel_for.h"
+// std
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace rkcommon {
+  namespace utility {
+
+    using namespace rkcommon::math;
+
+    static constexpr int W = NATIVE_PACKET_WIDTH < 4 ? 4 : NATIVE_PACKET_WIDTH;
+
+    // pixels converted a chunk at a time, one plane per channel
+    static constexpr int chunkSize = 256;
+
+    static size_t bytesPerPixel(PixelFormat format)
+    {
+      switch (format) {
+      case PixelFormat::RGBA8:
+      case PixelFormat::SRGBA8:
+        return 4;
+      case PixelFormat::RGB8:
+      case PixelFormat::SRGB8:
+        return 3;
+      case PixelFormat::RGBA16F:
+        return 4 * sizeof(half);
+      case PixelFormat::RGBA32F:
+        return 4 * sizeof(float);
+      case PixelFormat::L8:
+        return 1;
+      case PixelFormat::L32F:
+        return sizeof(float);
+      }
+      throw std::runtime_error("unknown pixel format");
+    }
+
+    static bool isSRGB(PixelFormat format)
+    {
+      return format == PixelFormat::SRGBA8 || format == PixelFormat::SRGB8;
+    }
+
+    static bool is8Bit(PixelFormat format)
+    {
+      return format != PixelFormat::RGBA16F && format != PixelFormat::RGBA32F
+          && format != PixelFormat::L32F;
+    }
+
+    static bool isLuminance(PixelFormat format)
+    {
+      return format == PixelFormat::L8 || format == PixelFormat::L32F;
+    }
+
+    // Channel planes of a chunk of pixels
+    struct Planes
+    {
+      alignas(64) float r[chunkSize];
+      alignas(64) float g[chunkSize];
+      alignas(64) float b[chunkSize];
+      alignas(64) float a[chunkSize];
+      // interleaved floats of RGBA16F pixels
+      alignas(64) float rgba[4 * chunkSize];
+    };
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      static void decode(const uint8_t *in,
+                         PixelFormat format,
+                         Planes &p,
+                         size_t n)
+      {
+        const float s = 1.f / 255.f;
+        switch (format) {
+        case PixelFormat::RGBA8:
+        case PixelFormat::SRGBA8:
+          for (size_t i = 0; i < n; ++i) {
+            p.r[i] = in[4 * i] * s;
+            p.g[i] = in[4 * i + 1] * s;
+            p.b[i] = in[4 * i + 2] * s;
+            p.a[i] = in[4 * i + 3] * s;
+          }
+          break;
+        case PixelFormat::RGB8:
+        case PixelFormat::SRGB8:
+          for (size_t i = 0; i < n; ++i) {
+            p.r[i] = in[3 * i] * s;
+            p.g[i] = in[3 * i + 1] * s;
+            p.b[i] = in[3 * i + 2] * s;
+            p.a[i] = 1.f;
+          }
+          break;
+        case PixelFormat::RGBA16F:
+          convert(reinterpret_cast<const half *>(in), p.rgba, 4 * n);
+          for (size_t i = 0; i < n; ++i) {
+            p.r[i] = p.rgba[4 * i];
+            p.g[i] = p.rgba[4 * i + 1];
+            p.b[i] = p.rgba[4 * i + 2];
+            p.a[i] = p.rgba[4 * i + 3];
+          }
+          break;
+        case PixelFormat::RGBA32F: {
+          const float *f = reinterpret_cast<const float *>(in);
+          for (size_t i = 0; i < n; ++i) {
+            p.r[i] = f[4 * i];
+            p.g[i] = f[4 * i + 1];
+            p.b[i] = f[4 * i + 2];
+            p.a[i] = f[4 * i + 3];
+          }
+        } break;
+        case PixelFormat::L8:
+          for (size_t i = 0; i < n; ++i) {
+            p.r[i] = p.g[i] = p.b[i] = in[i] * s;
+            p.a[i]                   = 1.f;
+          }
+          break;
+        case PixelFormat::L32F: {
+          const float *f = reinterpret_cast<const float *>(in);
+          for (size_t i = 0; i < n; ++i) {
+            p.r[i] = p.g[i] = p.b[i] = f[i];
+            p.a[i]                   = 1.f;
+          }
+        } break;
+        }
+      }
+
+      static void encode(Planes &p,
+                         uint8_t *out,
+                         PixelFormat format,
+                         size_t n)
+      {
+        // 8 bit values have been quantized to [0.5, 255.5) already
+        switch (format) {
+        case PixelFormat::RGBA8:
+        case PixelFormat::SRGBA8:
+          for (size_t i = 0; i < n; ++i) {
+            out[4 * i]     = uint8_t(p.r[i]);
+            out[4 * i + 1] = uint8_t(p.g[i]);
+            out[4 * i + 2] = uint8_t(p.b[i]);
+            out[4 * i + 3] = uint8_t(p.a[i]);
+          }
+          break;
+        case PixelFormat::RGB8:
+        case PixelFormat::SRGB8:
+          for (size_t i = 0; i < n; ++i) {
+            out[3 * i]     = uint8_t(p.r[i]);
+            out[3 * i + 1] = uint8_t(p.g[i]);
+            out[3 * i + 2] = uint8_t(p.b[i]);
+          }
+          break;
+        case PixelFormat::RGBA16F:
+          for (size_t i = 0; i < n; ++i) {
+            p.rgba[4 * i]     = p.r[i];
+            p.rgba[4 * i + 1] = p.g[i];
+            p.rgba[4 * i + 2] = p.b[i];
+            p.rgba[4 * i + 3] = p.a[i];
+          }
+          convert(p.rgba, reinterpret_cast<half *>(out), 4 * n);
+          break;
+        case PixelFormat::RGBA32F: {
+          float *f = reinterpret_cast<float *>(out);
+          for (size_t i = 0; i < n; ++i) {
+            f[4 * i]     = p.r[i];
+            f[4 * i + 1] = p.g[i];
+            f[4 * i + 2] = p.b[i];
+            f[4 * i + 3] = p.a[i];
+          }
+        } break;
+        case PixelFormat::L8:
+          for (size_t i = 0; i < n; ++i)
+            out[i] = uint8_t(p.r[i]);
+          break;
+        case PixelFormat::L32F:
+          std::memcpy(out, p.r, n * sizeof(float));
+          break;
+        }
+      }
+
+      void convertPixels(const void *in,
+                         PixelFormat inFormat,
+                         void *out,
+                         PixelFormat outFormat,
+                         size_t n,
+                         const PixelConversion &conversion)
+      {
+        const bool toneMapped = conversion.exposure != 1.f
+            || conversion.tonemap != Tonemap::NONE;
+        const bool toLuminance = isLuminance(outFormat);
+        const bool to8Bit      = is8Bit(outFormat);
+
+        // sRGB colors are copied as they are if nothing changes them
+        const bool keepSRGB = isSRGB(inFormat) && isSRGB(outFormat)
+            && !toneMapped && !toLuminance;
+        const bool decodeSRGB = isSRGB(inFormat) && !keepSRGB;
+        const bool encodeSRGB = isSRGB(outFormat) && !keepSRGB;
+
+        const vfloat<W> zero(0.f);
+        const vfloat<W> one(1.f);
+
+        const auto tonemap = [&](vfloat<W> x) -> vfloat<W> {
+          x = x * conversion.exposure;
+          switch (conversion.tonemap) {
+          case Tonemap::NONE:
+            return x;
+          case Tonemap::REINHARD:
+            x = max(x, zero);
+            return x / (x + 1.f);
+          case Tonemap::ACES: {
+            x = max(x, zero);
+            const vfloat<W> y =
+                (x * (x * 2.51f + 0.03f)) / (x * (x * 2.43f + 0.59f) + 0.14f);
+            return min(y, one);
+          }
+          }
+          return x;
+        };
+
+        const auto quantize = [&](vfloat<W> v) {
+          return min(max(v, zero), one) * 255.f + 0.5f;
+        };
+
+        const uint8_t *src   = static_cast<const uint8_t *>(in);
+        uint8_t *dst         = static_cast<uint8_t *>(out);
+        const size_t inSize  = bytesPerPixel(inFormat);
+        const size_t outSize = bytesPerPixel(outFormat);
+
+        Planes p;
+        for (size_t begin = 0; begin < n; begin += chunkSize) {
+          const size_t count = std::min<size_t>(chunkSize, n - begin);
+          decode(src + begin * inSize, inFormat, p, count);
+
+          // whole packets, the lanes past the end of the chunk are ignored
+          const size_t packets = (count + W - 1) / W * W;
+          for (size_t i = count; i < packets; ++i)
+            p.r[i] = p.g[i] = p.b[i] = p.a[i] = 0.f;
+
+          for (size_t i = 0; i < packets; i += W) {
+            vfloat<W> r = vfloat<W>::loadu(p.r + i);
+            vfloat<W> g = vfloat<W>::loadu(p.g + i);
+            vfloat<W> b = vfloat<W>::loadu(p.b + i);
+            vfloat<W> a = vfloat<W>::loadu(p.a + i);
+
+            if (decodeSRGB) {
+              r = srgb_to_linear(r);
+              g = srgb_to_linear(g);
+              b = srgb_to_linear(b);
+            }
+            if (toneMapped) {
+              r = tonemap(r);
+              g = tonemap(g);
+              b = tonemap(b);
+            }
+            if (toLuminance)
+              r = r * 0.2126f + g * 0.7152f + b * 0.0722f;
+            if (encodeSRGB) {
+              r = linear_to_srgb(r);
+              g = linear_to_srgb(g);
+              b = linear_to_srgb(b);
+            }
+            if (to8Bit) {
+              r = quantize(r);
+              g = quantize(g);
+              b = quantize(b);
+              a = quantize(a);
+            }
+
+            vfloat<W>::storeu(p.r + i, r);
+            vfloat<W>::storeu(p.g + i, g);
+            vfloat<W>::storeu(p.b + i, b);
+            vfloat<W>::storeu(p.a + i, a);
+          }
+
+          encode(p, dst + begin * outSize, outFormat, count);
+        }
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // PixelConvert.h definitions /////////////////////////////////////////////
+
+    using ConvertFcn = void(const void *,
+                            PixelFormat,
+                            void *,
+                            PixelFormat,
+                            size_t,
+                            const PixelConversion &);
+
+    RKCOMMON_ISA_DECLARE(ConvertFcn convertPixels)
+
+    size_t pixelSize(PixelFormat format)
+    {
+      return bytesPerPixel(format);
+    }
+
+    void convertPixels(const void *in,
+                       PixelFormat inFormat,
+                       void *out,
+                       PixelFormat outFormat,
+                       size_t n,
+                       const PixelConversion &conversion)
+    {
+      if (inFormat == outFormat && conversion.exposure == 1.f
+          && conversion.tonemap == Tonemap::NONE) {
+        if (in != out)
+          std::memmove(out, in, n * bytesPerPixel(inFormat));
+        return;
+      }
+
+      static ConvertFcn *const fcn =
+          RKCOMMON_ISA_SELECT(ConvertFcn, convertPixels);
+      fcn(in, inFormat, out, outFormat, n, conversion);
+    }
+
+    void convertPixels(const void *in,
+                       PixelFormat inFormat,
+                       void *out,
+                       PixelFormat outFormat,
+                       int sizeX,
+                       int sizeY,
+                       const PixelConversion &conversion)
+    {
+      const size_t inRow  = bytesPerPixel(inFormat) * sizeX;
+      const size_t outRow = bytesPerPixel(outFormat) * sizeX;
+      const uint8_t *src  = static_cast<const uint8_t *>(in);
+      uint8_t *dst        = static_cast<uint8_t *>(out);
+
+      tasking::parallel_for(sizeY, [&](int y) {
+        const int outY = conversion.flipY ? sizeY - 1 - y : y;
+        convertPixels(src + y * inRow,
+                      inFormat,
+                      dst + outY * outRow,
+                      outFormat,
+                      size_t(sizeX),
+                      conversion);
+      });
+    }
+#endif
+
+  }  // namespace utility
+}  // namespace rkcommon
@@ -0,0 +1,73 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+
+namespace rkcommon {
+  namespace utility {
+
+    /* Pixel formats of framebuffers and images, all with the channels
+       interleaved in this order. 8 bit formats are unsigned normalized; the
+       SRGB ones encode the colors with the sRGB curve and keep alpha linear.
+       Luminance is the linear Rec. 709 weighted sum of the colors. */
+    enum class PixelFormat
+    {
+      RGBA8,
+      SRGBA8,
+      RGB8,
+      SRGB8,
+      RGBA16F,
+      RGBA32F,
+      L8,
+      L32F
+    };
+
+    // bytes per pixel of 'format'
+    RKCOMMON_INTERFACE size_t pixelSize(PixelFormat format);
+
+    enum class Tonemap
+    {
+      NONE,
+      // x / (1 + x)
+      REINHARD,
+      // Narkowicz' fit of the ACES filmic curve
+      ACES
+    };
+
+    struct PixelConversion
+    {
+      // scales the colors before tonemapping
+      float exposure{1.f};
+      Tonemap tonemap{Tonemap::NONE};
+      // the rows of the output in the opposite order of the input
+      bool flipY{false};
+    };
+
+    /* Converts 'sizeY' rows of 'sizeX' pixels, tightly packed, from 'in' to
+       'out' in one pass: decoding, exposure and tonemapping of the colors,
+       encoding and the flip. The rows are converted in parallel, a packet of
+       pixels at a time with the vector instructions of the host CPU. 'in'
+       and 'out' may only be the same array if the formats have the same size
+       and the rows are not flipped. */
+    RKCOMMON_INTERFACE void convertPixels(
+        const void *in,
+        PixelFormat inFormat,
+        void *out,
+        PixelFormat outFormat,
+        int sizeX,
+        int sizeY,
+        const PixelConversion &conversion = PixelConversion());
+
+    // Converts 'n' pixels on the calling thread
+    RKCOMMON_INTERFACE void convertPixels(
+        const void *in,
+        PixelFormat inFormat,
+        void *out,
+        PixelFormat outFormat,
+        size_t n,
+        const PixelConversion &conversion = PixelConversion());
+
+  }  // namespace utility
+}  // namespace rkcommon
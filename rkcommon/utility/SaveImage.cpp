@@ -0,0 +1,823 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "SaveImage.h"
+#include "PixelConvert.h"
+#include "../math/dispatch.h"
+#include "../math/half.h"
+#include "../tasking/parallel_for.h"
+#include "../tasking/schedule.h"
+// std
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace rkcommon {
+  namespace utility {
+
+    // pixels converted a chunk at a time by the kernel
+    static constexpr int chunkSize = 256;
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      void convertToHalfPlanes(const vec4f *in, half *out, size_t n)
+      {
+        // EXR stores the channels in alphabetical order: A, B, G, R
+        float planes[4][chunkSize];
+        for (size_t begin = 0; begin < n; begin += chunkSize) {
+          const size_t count = std::min<size_t>(chunkSize, n - begin);
+          for (size_t i = 0; i < count; ++i) {
+            const vec4f &p = in[begin + i];
+            planes[0][i]   = p.w;
+            planes[1][i]   = p.z;
+            planes[2][i]   = p.y;
+            planes[3][i]   = p.x;
+          }
+          for (int c = 0; c < 4; ++c)
+            convert(planes[c], out + c * n + begin, count);
+        }
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // SaveImage.h definitions ////////////////////////////////////////////////
+
+    using ConvertHalfFcn = void(const vec4f *, half *, size_t);
+
+    RKCOMMON_ISA_DECLARE(ConvertHalfFcn convertToHalfPlanes)
+
+    void convertToRGBA8(const vec4f *in, uint32_t *out, size_t n, bool srgb)
+    {
+      convertPixels(in,
+                    PixelFormat::RGBA32F,
+                    out,
+                    srgb ? PixelFormat::SRGBA8 : PixelFormat::RGBA8,
+                    n);
+    }
+
+    static void convertToHalfPlanes(const vec4f *in, half *out, size_t n)
+    {
+      static ConvertHalfFcn *const fcn =
+          RKCOMMON_ISA_SELECT(ConvertHalfFcn, convertToHalfPlanes);
+      fcn(in, out, n);
+    }
+
+    ImageFormat imageFormat(const std::string &fileName)
+    {
+      const size_t dot = fileName.rfind('.');
+      std::string ext  = dot == std::string::npos ? "" : fileName.substr(dot);
+      std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+      if (ext == ".ppm")
+        return ImageFormat::PPM;
+      if (ext == ".pfm")
+        return ImageFormat::PFM;
+      if (ext == ".qoi")
+        return ImageFormat::QOI;
+      if (ext == ".png")
+        return ImageFormat::PNG;
+      if (ext == ".exr")
+        return ImageFormat::EXR;
+      throw std::runtime_error("unknown image format of '" + fileName + "'");
+    }
+
+    // Pixel sources //////////////////////////////////////////////////////////
+
+    // Rows of the image top to bottom, from pixels stored bottom to top
+    struct ImageSource
+    {
+      int sizeX;
+      int sizeY;
+      const vec4f *rgba32f;
+      const uint32_t *rgba8;
+      bool srgb;
+
+      const vec4f *row32f(int y) const
+      {
+        return rgba32f + size_t(sizeY - 1 - y) * sizeX;
+      }
+
+      const uint32_t *row8(int y) const
+      {
+        return rgba8 + size_t(sizeY - 1 - y) * sizeX;
+      }
+
+      void rowRGBA32F(int y, vec4f *out) const
+      {
+        if (rgba32f) {
+          std::memcpy(out, row32f(y), sizeX * sizeof(vec4f));
+          return;
+        }
+        convertPixels(
+            row8(y), PixelFormat::RGBA8, out, PixelFormat::RGBA32F, sizeX);
+      }
+
+      // all rows top to bottom, converted in parallel
+      void convertTo(PixelFormat format, void *out) const
+      {
+        PixelConversion conversion;
+        conversion.flipY = true;
+        if (rgba8) {
+          convertPixels(
+              rgba8, PixelFormat::RGBA8, out, format, sizeX, sizeY, conversion);
+        } else {
+          if (srgb && format == PixelFormat::RGBA8)
+            format = PixelFormat::SRGBA8;
+          if (srgb && format == PixelFormat::RGB8)
+            format = PixelFormat::SRGB8;
+          convertPixels(rgba32f,
+                        PixelFormat::RGBA32F,
+                        out,
+                        format,
+                        sizeX,
+                        sizeY,
+                        conversion);
+        }
+      }
+    };
+
+    // the whole image as RGBA8 top to bottom, converted in parallel
+    static std::vector<uint32_t> imageRGBA8(const ImageSource &image)
+    {
+      std::vector<uint32_t> rgba(size_t(image.sizeX) * image.sizeY);
+      image.convertTo(PixelFormat::RGBA8, rgba.data());
+      return rgba;
+    }
+
+    // Byte output ////////////////////////////////////////////////////////////
+
+    static void appendBytes(std::vector<uint8_t> &out,
+                            const void *bytes,
+                            size_t n)
+    {
+      const uint8_t *b = static_cast<const uint8_t *>(bytes);
+      out.insert(out.end(), b, b + n);
+    }
+
+    static void appendString(std::vector<uint8_t> &out, const char *s)
+    {
+      appendBytes(out, s, std::strlen(s) + 1);
+    }
+
+    static void appendBE32(std::vector<uint8_t> &out, uint32_t v)
+    {
+      const uint8_t b[4] = {
+          uint8_t(v >> 24), uint8_t(v >> 16), uint8_t(v >> 8), uint8_t(v)};
+      appendBytes(out, b, 4);
+    }
+
+    // EXR and PFM are little endian, as is the host
+    template <typename T>
+    static void appendLE(std::vector<uint8_t> &out, T v)
+    {
+      appendBytes(out, &v, sizeof(v));
+    }
+
+    // PPM and PFM ////////////////////////////////////////////////////////////
+
+    static std::vector<uint8_t> encodePPM(const ImageSource &image)
+    {
+      const std::string header = "P6\n" + std::to_string(image.sizeX) + " "
+          + std::to_string(image.sizeY) + "\n255\n";
+
+      std::vector<uint8_t> out(header.begin(), header.end());
+      const size_t begin = out.size();
+      out.resize(begin + 3 * size_t(image.sizeX) * image.sizeY);
+      image.convertTo(PixelFormat::RGB8, out.data() + begin);
+      return out;
+    }
+
+    static std::vector<uint8_t> encodePFM(const ImageSource &image)
+    {
+      const std::string header = "PF\n" + std::to_string(image.sizeX) + " "
+          + std::to_string(image.sizeY) + "\n-1.0\n";
+      const size_t rowSize = 3 * sizeof(float) * image.sizeX;
+
+      std::vector<uint8_t> out(header.begin(), header.end());
+      const size_t begin = out.size();
+      out.resize(begin + rowSize * image.sizeY);
+
+      // PFM stores the rows bottom to top, too
+      tasking::parallel_for(image.sizeY, [&](int y) {
+        std::vector<vec4f> row(image.sizeX);
+        image.rowRGBA32F(image.sizeY - 1 - y, row.data());
+        uint8_t *dst = out.data() + begin + y * rowSize;
+        for (int x = 0; x < image.sizeX; ++x)
+          std::memcpy(dst + 3 * sizeof(float) * x, &row[x], 3 * sizeof(float));
+      });
+      return out;
+    }
+
+    // QOI, see qoiformat.org /////////////////////////////////////////////////
+
+    static std::vector<uint8_t> encodeQOI(const ImageSource &image)
+    {
+      const std::vector<uint32_t> rgba = imageRGBA8(image);
+
+      std::vector<uint8_t> out;
+      out.reserve(14 + rgba.size() * 5 + 8);
+      appendBytes(out, "qoif", 4);
+      appendBE32(out, image.sizeX);
+      appendBE32(out, image.sizeY);
+      out.push_back(4);
+      out.push_back(image.rgba32f && !image.srgb ? 1 : 0);
+
+      uint8_t index[64][4] = {};
+      uint8_t prev[4]      = {0, 0, 0, 255};
+      int run              = 0;
+
+      const uint8_t *px  = reinterpret_cast<const uint8_t *>(rgba.data());
+      const uint8_t *end = px + 4 * rgba.size();
+      for (; px != end; px += 4) {
+        if (std::memcmp(px, prev, 4) == 0) {
+          if (++run == 62 || px + 4 == end) {
+            out.push_back(uint8_t(0xc0 | (run - 1)));
+            run = 0;
+          }
+          continue;
+        }
+
+        if (run > 0) {
+          out.push_back(uint8_t(0xc0 | (run - 1)));
+          run = 0;
+        }
+
+        const int h = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+        if (std::memcmp(index[h], px, 4) == 0) {
+          out.push_back(uint8_t(h));
+        } else {
+          std::memcpy(index[h], px, 4);
+
+          if (px[3] == prev[3]) {
+            const int8_t vr = int8_t(px[0] - prev[0]);
+            const int8_t vg = int8_t(px[1] - prev[1]);
+            const int8_t vb = int8_t(px[2] - prev[2]);
+            const int vgR   = vr - vg;
+            const int vgB   = vb - vg;
+
+            if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+              out.push_back(
+                  uint8_t(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+            } else if (vgR > -9 && vgR < 8 && vg > -33 && vg < 32 && vgB > -9
+                       && vgB < 8) {
+              out.push_back(uint8_t(0x80 | (vg + 32)));
+              out.push_back(uint8_t((vgR + 8) << 4 | (vgB + 8)));
+            } else {
+              out.push_back(0xfe);
+              appendBytes(out, px, 3);
+            }
+          } else {
+            out.push_back(0xff);
+            appendBytes(out, px, 4);
+          }
+        }
+        std::memcpy(prev, px, 4);
+      }
+
+      const uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+      appendBytes(out, padding, 8);
+      return out;
+    }
+
+    // PNG ////////////////////////////////////////////////////////////////////
+
+    static uint32_t crc32(const uint8_t *data, size_t n, uint32_t crc = 0)
+    {
+      static const std::vector<uint32_t> table = []() {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+          uint32_t c = i;
+          for (int k = 0; k < 8; ++k)
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+          t[i] = c;
+        }
+        return t;
+      }();
+
+      crc = ~crc;
+      for (size_t i = 0; i < n; ++i)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+      return ~crc;
+    }
+
+    static const uint32_t adlerBase = 65521;
+
+    static uint32_t adler32(const uint8_t *data, size_t n)
+    {
+      uint32_t a = 1, b = 0;
+      while (n > 0) {
+        // the largest block which cannot overflow the sums
+        const size_t block = std::min<size_t>(n, 5552);
+        for (size_t i = 0; i < block; ++i) {
+          a += data[i];
+          b += a;
+        }
+        a %= adlerBase;
+        b %= adlerBase;
+        data += block;
+        n -= block;
+      }
+      return b << 16 | a;
+    }
+
+    // the checksum of two concatenated blocks, as zlib's adler32_combine()
+    static uint32_t adler32Combine(uint32_t adler1,
+                                   uint32_t adler2,
+                                   size_t length2)
+    {
+      const uint32_t rem = uint32_t(length2 % adlerBase);
+      uint32_t sum1      = adler1 & 0xffff;
+      uint32_t sum2      = uint32_t((uint64_t(rem) * sum1) % adlerBase);
+      sum1 += (adler2 & 0xffff) + adlerBase - 1;
+      sum2 += (adler1 >> 16) + (adler2 >> 16) + adlerBase - rem;
+      if (sum1 >= adlerBase)
+        sum1 -= adlerBase;
+      if (sum1 >= adlerBase)
+        sum1 -= adlerBase;
+      if (sum2 >= 2 * adlerBase)
+        sum2 -= 2 * adlerBase;
+      if (sum2 >= adlerBase)
+        sum2 -= adlerBase;
+      return sum2 << 16 | sum1;
+    }
+
+    // writes deflate's least significant bit first bit stream
+    struct BitWriter
+    {
+      explicit BitWriter(std::vector<uint8_t> &_out) : out(_out) {}
+
+      void put(uint32_t value, int n)
+      {
+        bits |= uint64_t(value) << count;
+        count += n;
+        if (count >= 32) {
+          appendLE(out, uint32_t(bits));
+          bits >>= 32;
+          count -= 32;
+        }
+      }
+
+      // pad to the next byte
+      void align()
+      {
+        for (; count > 0; count -= 8) {
+          out.push_back(uint8_t(bits));
+          bits >>= 8;
+        }
+        count = 0;
+      }
+
+      std::vector<uint8_t> &out;
+      uint64_t bits{0};
+      int count{0};
+    };
+
+    // the fixed Huffman codes of deflate, bit reversed for the BitWriter
+    struct FixedCodes
+    {
+      FixedCodes()
+      {
+        for (int v = 0; v < 288; ++v) {
+          if (v < 144)
+            set(v, 0x30 + v, 8);
+          else if (v < 256)
+            set(v, 0x190 + v - 144, 9);
+          else if (v < 280)
+            set(v, v - 256, 7);
+          else
+            set(v, 0xc0 + v - 280, 8);
+        }
+        for (int d = 0; d < 30; ++d)
+          distanceCode[d] = reverse(d, 5);
+      }
+
+      static uint32_t reverse(uint32_t code, int length)
+      {
+        uint32_t r = 0;
+        for (int i = 0; i < length; ++i)
+          r |= ((code >> i) & 1) << (length - 1 - i);
+        return r;
+      }
+
+      void set(int v, uint32_t code, int length)
+      {
+        literalCode[v]   = reverse(code, length);
+        literalLength[v] = length;
+      }
+
+      uint32_t literalCode[288];
+      int literalLength[288];
+      uint32_t distanceCode[30];
+    };
+
+    static int log2Floor(uint32_t v)
+    {
+      int l = 0;
+      while (v >>= 1)
+        ++l;
+      return l;
+    }
+
+    /* Compresses 'n' bytes as one block with the fixed Huffman codes, which
+       ends on a byte boundary: with an empty stored block unless it is the
+       last one (as zlib's Z_SYNC_FLUSH does), so that blocks compressed in
+       parallel can be concatenated */
+    static void deflateBlock(const uint8_t *src,
+                             size_t n,
+                             bool last,
+                             std::vector<uint8_t> &out)
+    {
+      static const FixedCodes codes;
+      const int hashBits    = 15;
+      const size_t window   = 32768;
+      const size_t maxMatch = 258;
+
+      BitWriter bits(out);
+      bits.put(last ? 3 : 2, 3);
+
+      const auto literal = [&](int v) {
+        bits.put(codes.literalCode[v], codes.literalLength[v]);
+      };
+
+      const auto match = [&](size_t length, size_t distance) {
+        if (length == 258) {
+          literal(285);
+        } else if (length < 11) {
+          literal(int(254 + length));
+        } else {
+          const uint32_t l = uint32_t(length - 3);
+          const int b      = log2Floor(l);
+          literal(257 + 4 * (b - 1) + ((l >> (b - 2)) & 3));
+          bits.put(l & ((1u << (b - 2)) - 1), b - 2);
+        }
+
+        const uint32_t d = uint32_t(distance - 1);
+        if (d < 4) {
+          bits.put(codes.distanceCode[d], 5);
+        } else {
+          const int l = log2Floor(d);
+          bits.put(codes.distanceCode[2 * l + ((d >> (l - 1)) & 1)], 5);
+          bits.put(d & ((1u << (l - 1)) - 1), l - 1);
+        }
+      };
+
+      const auto load32 = [&](size_t i) {
+        uint32_t v;
+        std::memcpy(&v, src + i, 4);
+        return v;
+      };
+
+      // the last position of each hash of 4 bytes, one candidate per match
+      std::vector<int32_t> head(size_t(1) << hashBits, -1);
+      size_t i = 0;
+      while (i + 4 <= n) {
+        const uint32_t v        = load32(i);
+        const uint32_t h        = (v * 2654435761u) >> (32 - hashBits);
+        const int32_t candidate = head[h];
+        head[h]                 = int32_t(i);
+
+        if (candidate >= 0 && i - candidate <= window
+            && load32(candidate) == v) {
+          const size_t limit = std::min(maxMatch, n - i);
+          size_t length      = 4;
+          while (length < limit && src[candidate + length] == src[i + length])
+            ++length;
+          match(length, i - candidate);
+          i += length;
+        } else {
+          literal(src[i++]);
+        }
+      }
+      for (; i < n; ++i)
+        literal(src[i]);
+
+      literal(256);
+      if (!last) {
+        bits.put(0, 3);
+        bits.align();
+        const uint8_t storedBlock[4] = {0, 0, 0xff, 0xff};
+        appendBytes(out, storedBlock, 4);
+      }
+      bits.align();
+    }
+
+    static void appendChunk(std::vector<uint8_t> &out,
+                            const char *type,
+                            const std::vector<uint8_t> &data)
+    {
+      appendBE32(out, uint32_t(data.size()));
+      const size_t begin = out.size();
+      appendBytes(out, type, 4);
+      appendBytes(out, data.data(), data.size());
+      appendBE32(out, crc32(out.data() + begin, out.size() - begin));
+    }
+
+    static std::vector<uint8_t> encodePNG(const ImageSource &image)
+    {
+      const std::vector<uint32_t> rgba = imageRGBA8(image);
+      const size_t rowSize = 4 * size_t(image.sizeX);
+      const uint8_t *pixels = reinterpret_cast<const uint8_t *>(rgba.data());
+
+      // strips of about 256KB, compressed independently
+      const int stripRows =
+          int(std::max<size_t>(1, (256 * 1024) / (rowSize + 1)));
+      const int numStrips = (image.sizeY + stripRows - 1) / stripRows;
+
+      std::vector<std::vector<uint8_t>> chunks(numStrips);
+      std::vector<uint32_t> adlers(numStrips);
+      std::vector<size_t> lengths(numStrips);
+
+      tasking::parallel_for(numStrips, [&](int s) {
+        const int begin = s * stripRows;
+        const int end   = std::min(image.sizeY, begin + stripRows);
+
+        // filter type 2 ("up"): the difference to the row above
+        std::vector<uint8_t> filtered((end - begin) * (rowSize + 1));
+        uint8_t *dst = filtered.data();
+        for (int y = begin; y < end; ++y) {
+          const uint8_t *row = pixels + y * rowSize;
+          *dst++             = 2;
+          if (y == 0) {
+            std::memcpy(dst, row, rowSize);
+          } else {
+            const uint8_t *above = row - rowSize;
+            for (size_t x = 0; x < rowSize; ++x)
+              dst[x] = uint8_t(row[x] - above[x]);
+          }
+          dst += rowSize;
+        }
+
+        adlers[s]  = adler32(filtered.data(), filtered.size());
+        lengths[s] = filtered.size();
+        deflateBlock(
+            filtered.data(), filtered.size(), s == numStrips - 1, chunks[s]);
+      });
+
+      uint32_t adler = 1;
+      for (int s = 0; s < numStrips; ++s)
+        adler = adler32Combine(adler, adlers[s], lengths[s]);
+
+      // the zlib stream ends with the checksum of all filtered rows
+      appendBE32(chunks.back(), adler);
+
+      std::vector<uint8_t> header;
+      appendBE32(header, image.sizeX);
+      appendBE32(header, image.sizeY);
+      // 8 bits per channel, RGBA, deflate, adaptive filters, no interlacing
+      const uint8_t format[5] = {8, 6, 0, 0, 0};
+      appendBytes(header, format, 5);
+
+      const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+      std::vector<uint8_t> out(signature, signature + 8);
+      appendChunk(out, "IHDR", header);
+
+      // zlib header: deflate with a 32KB window, no dictionary
+      appendChunk(out, "IDAT", std::vector<uint8_t>{0x78, 0x01});
+      for (auto &chunk : chunks) {
+        appendChunk(out, "IDAT", chunk);
+        std::vector<uint8_t>().swap(chunk);
+      }
+
+      appendChunk(out, "IEND", std::vector<uint8_t>());
+      return out;
+    }
+
+    // EXR, uncompressed half scanlines ///////////////////////////////////////
+
+    static void appendAttribute(std::vector<uint8_t> &out,
+                                const char *name,
+                                const char *type,
+                                const std::vector<uint8_t> &value)
+    {
+      appendString(out, name);
+      appendString(out, type);
+      appendLE(out, int32_t(value.size()));
+      appendBytes(out, value.data(), value.size());
+    }
+
+    static std::vector<uint8_t> encodeEXR(const ImageSource &image)
+    {
+      std::vector<uint8_t> out;
+      appendLE(out, uint32_t(20000630));
+      appendLE(out, uint32_t(2));
+
+      std::vector<uint8_t> channels;
+      for (const char *name : {"A", "B", "G", "R"}) {
+        appendString(channels, name);
+        // half, linear, reserved bytes, x and y sampling
+        appendLE(channels, int32_t(1));
+        appendLE(channels, uint32_t(0));
+        appendLE(channels, int32_t(1));
+        appendLE(channels, int32_t(1));
+      }
+      channels.push_back(0);
+      appendAttribute(out, "channels", "chlist", channels);
+
+      appendAttribute(out, "compression", "compression", {0});
+
+      std::vector<uint8_t> window;
+      appendLE(window, int32_t(0));
+      appendLE(window, int32_t(0));
+      appendLE(window, int32_t(image.sizeX - 1));
+      appendLE(window, int32_t(image.sizeY - 1));
+      appendAttribute(out, "dataWindow", "box2i", window);
+      appendAttribute(out, "displayWindow", "box2i", window);
+
+      appendAttribute(out, "lineOrder", "lineOrder", {0});
+
+      std::vector<uint8_t> one;
+      appendLE(one, 1.f);
+      appendAttribute(out, "pixelAspectRatio", "float", one);
+      appendAttribute(
+          out, "screenWindowCenter", "v2f", std::vector<uint8_t>(8));
+      appendAttribute(out, "screenWindowWidth", "float", one);
+      out.push_back(0);
+
+      // one scanline per block: y, size and the planes of the channels
+      const size_t planeSize  = sizeof(half) * image.sizeX;
+      const size_t blockSize  = 8 + 4 * planeSize;
+      const size_t firstBlock = out.size() + 8 * size_t(image.sizeY);
+      for (int y = 0; y < image.sizeY; ++y)
+        appendLE(out, uint64_t(firstBlock + y * blockSize));
+
+      out.resize(firstBlock + blockSize * image.sizeY);
+      tasking::parallel_for(image.sizeY, [&](int y) {
+        std::vector<vec4f> row(image.sizeX);
+        std::vector<half> planes(4 * size_t(image.sizeX));
+        image.rowRGBA32F(y, row.data());
+        convertToHalfPlanes(row.data(), planes.data(), image.sizeX);
+
+        uint8_t *block         = out.data() + firstBlock + y * blockSize;
+        const int32_t header[] = {y, int32_t(4 * planeSize)};
+        std::memcpy(block, header, 8);
+        std::memcpy(block + 8, planes.data(), 4 * planeSize);
+      });
+      return out;
+    }
+
+    // Encoding and writing ///////////////////////////////////////////////////
+
+    static std::vector<uint8_t> encode(ImageFormat format,
+                                       const ImageSource &image)
+    {
+      if (image.sizeX <= 0 || image.sizeY <= 0)
+        throw std::runtime_error("cannot encode an empty image");
+
+      switch (format) {
+      case ImageFormat::PPM:
+        return encodePPM(image);
+      case ImageFormat::PFM:
+        return encodePFM(image);
+      case ImageFormat::QOI:
+        return encodeQOI(image);
+      case ImageFormat::PNG:
+        return encodePNG(image);
+      case ImageFormat::EXR:
+        return encodeEXR(image);
+      }
+      throw std::runtime_error("unknown image format");
+    }
+
+    std::vector<uint8_t> encodeImage(ImageFormat format,
+                                     int sizeX,
+                                     int sizeY,
+                                     const vec4f *pixel,
+                                     bool srgb)
+    {
+      return encode(format, ImageSource{sizeX, sizeY, pixel, nullptr, srgb});
+    }
+
+    std::vector<uint8_t> encodeImage(ImageFormat format,
+                                     int sizeX,
+                                     int sizeY,
+                                     const uint32_t *pixel)
+    {
+      return encode(format, ImageSource{sizeX, sizeY, nullptr, pixel, true});
+    }
+
+    // The background I/O thread, which writes the files in order
+    class ImageWriter
+    {
+     public:
+      ~ImageWriter()
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          stop = true;
+        }
+        queued.notify_one();
+        if (thread.joinable())
+          thread.join();
+      }
+
+      void write(const std::string &fileName,
+                 std::vector<uint8_t> bytes,
+                 const tasking::Promise<void> &written)
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          jobs.push_back(Job{fileName, std::move(bytes), written});
+          if (!thread.joinable())
+            thread = std::thread([this]() { run(); });
+        }
+        queued.notify_one();
+      }
+
+     private:
+      struct Job
+      {
+        std::string fileName;
+        std::vector<uint8_t> bytes;
+        tasking::Promise<void> written;
+      };
+
+      void run()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+          queued.wait(lock, [&]() { return stop || !jobs.empty(); });
+          if (jobs.empty())
+            return;
+
+          Job job = std::move(jobs.front());
+          jobs.pop_front();
+          lock.unlock();
+
+          FILE *file = fopen(job.fileName.c_str(), "wb");
+          bool ok    = file
+              && fwrite(job.bytes.data(), 1, job.bytes.size(), file)
+                  == job.bytes.size();
+          if (file && fclose(file) != 0)
+            ok = false;
+
+          if (ok) {
+            job.written.setValue();
+          } else {
+            job.written.setException(std::make_exception_ptr(
+                std::runtime_error("cannot write '" + job.fileName + "'")));
+          }
+
+          lock.lock();
+        }
+      }
+
+      std::mutex mutex;
+      std::condition_variable queued;
+      std::deque<Job> jobs;
+      bool stop{false};
+      std::thread thread;
+    };
+
+    static ImageWriter &imageWriter()
+    {
+      static ImageWriter writer;
+      return writer;
+    }
+
+    static tasking::Future<void> saveInBackground(const std::string &fileName,
+                                                  const ImageSource &image)
+    {
+      const ImageFormat format = imageFormat(fileName);
+      tasking::Promise<void> written;
+
+      tasking::schedule([=]() {
+        try {
+          imageWriter().write(fileName, encode(format, image), written);
+        } catch (...) {
+          written.setException(std::current_exception());
+        }
+      });
+
+      return written.getFuture();
+    }
+
+    tasking::Future<void> saveImage(const std::string &fileName,
+                                    int sizeX,
+                                    int sizeY,
+                                    const vec4f *pixel,
+                                    bool srgb)
+    {
+      return saveInBackground(
+          fileName, ImageSource{sizeX, sizeY, pixel, nullptr, srgb});
+    }
+
+    tasking::Future<void> saveImage(const std::string &fileName,
+                                    int sizeX,
+                                    int sizeY,
+                                    const uint32_t *pixel)
+    {
+      return saveInBackground(
+          fileName, ImageSource{sizeX, sizeY, nullptr, pixel, true});
+    }
+#endif
+
+  }  // namespace utility
+}  // namespace rkcommon
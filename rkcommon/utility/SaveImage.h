@@ -11,9 +11,13 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string>
+#include <vector>
 
 #include "../math/vec.h"
+#include "../memory/ScratchBuffer.h"
 #include "../memory/malloc.h"
+#include "../tasking/Future.h"
+#include "PixelConvert.h"
 
 namespace rkcommon {
   namespace utility {
@@ -34,7 +38,8 @@ namespace rkcommon {
         throw std::runtime_error("Can't open file for writeP[FP]M!");
 
       fprintf(file, header, sizeX, sizeY);
-      auto out = STACK_BUFFER(COMP_T, N_COMP * sizeX);
+      memory::ScratchScope scratch;
+      auto *out = scratch.allocate<COMP_T>(N_COMP * sizeX);
       for (int y = 0; y < sizeY; y++) {
         auto *in = (const COMP_T *)&pixel[(FLIP ? sizeY - 1 - y : y) * sizeX];
         for (int x = 0; x < sizeX; x++)
@@ -51,8 +56,26 @@ namespace rkcommon {
                          const int sizeY,
                          const uint32_t *pixel)
     {
-      writeImage<unsigned char, 3, uint32_t, 4, true>(
-          fileName, "P6\n%i %i\n255\n", sizeX, sizeY, pixel);
+      FILE *file = fopen(fileName.c_str(), "wb");
+      if (file == nullptr)
+        throw std::runtime_error("Can't open file for writeP[FP]M!");
+
+      // the RGB rows top to bottom in one parallel pass
+      std::vector<unsigned char> rgb(3 * size_t(sizeX) * sizeY);
+      PixelConversion conversion;
+      conversion.flipY = true;
+      convertPixels(pixel,
+                    PixelFormat::RGBA8,
+                    rgb.data(),
+                    PixelFormat::RGB8,
+                    sizeX,
+                    sizeY,
+                    conversion);
+
+      fprintf(file, "P6\n%i %i\n255\n", sizeX, sizeY);
+      fwrite(rgb.data(), rgb.size(), 1, file);
+      fprintf(file, "\n");
+      fclose(file);
     }
 
     inline void writePGM(const std::string &fileName,
@@ -109,5 +132,63 @@ namespace rkcommon {
           fName, "PF4\n%i %i\n-1.0\n", sizeX, sizeY, p);
     }
 
+    // Encoded images ///////////////////////////////////////////////////////
+
+    /* Unlike the writers above, the functions below take the format from the
+       file name extension (.ppm, .pfm, .qoi, .png or .exr, any case) and all
+       of them take the pixel rows bottom to top, as writePPM() does. 8 bit
+       formats get 'srgb' encoded colors (with linear alpha) from vec4f
+       pixels, which EXR and PFM keep as linear half or float values.
+
+       QOI and PNG are lossless; PNG compresses strips of rows in parallel,
+       each into its own deflate block with fixed Huffman codes and a fast
+       LZ77 match search, trading some size for speed. */
+
+    enum class ImageFormat
+    {
+      PPM,
+      PFM,
+      QOI,
+      PNG,
+      EXR
+    };
+
+    // Throws for unknown extensions
+    RKCOMMON_INTERFACE ImageFormat imageFormat(const std::string &fileName);
+
+    // 'n' RGBA8 pixels, in parallel packets for the host CPU
+    RKCOMMON_INTERFACE void convertToRGBA8(const vec4f *in,
+                                           uint32_t *out,
+                                           size_t n,
+                                           bool srgb = true);
+
+    // The complete file contents, rows converted in parallel
+    RKCOMMON_INTERFACE std::vector<uint8_t> encodeImage(ImageFormat format,
+                                                        int sizeX,
+                                                        int sizeY,
+                                                        const vec4f *pixel,
+                                                        bool srgb = true);
+
+    RKCOMMON_INTERFACE std::vector<uint8_t> encodeImage(ImageFormat format,
+                                                        int sizeX,
+                                                        int sizeY,
+                                                        const uint32_t *pixel);
+
+    /* Encodes the image as a task and writes it on a background I/O thread,
+       which writes the images in the order they are encoded. The pixels
+       must stay valid until the future is ready; it holds any error. */
+    RKCOMMON_INTERFACE tasking::Future<void> saveImage(
+        const std::string &fileName,
+        int sizeX,
+        int sizeY,
+        const vec4f *pixel,
+        bool srgb = true);
+
+    RKCOMMON_INTERFACE tasking::Future<void> saveImage(
+        const std::string &fileName,
+        int sizeX,
+        int sizeY,
+        const uint32_t *pixel);
+
   }  // namespace utility
 }  // namespace rkcommon
@@ -3,7 +3,12 @@
 
 #pragma once
 
+#include "StringView.h"
+// std
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -30,43 +35,295 @@ namespace rkcommon {
     inline bool beginsWith(const std::string &inputString,
                            const std::string &startsWithString)
     {
-      auto startingMatch = longestBeginningMatch(inputString, startsWithString);
-      return startingMatch.size() == startsWithString.size();
+      return inputString.compare(
+                 0, startsWithString.size(), startsWithString)
+          == 0;
+    }
+
+    /* A set of delimiter characters. A single delimiter is searched for with
+       memchr(), which the C library vectorizes; larger sets are looked up in
+       a 256 bit table. */
+    class Delimiters
+    {
+     public:
+      Delimiters(char delim) : single(delim)
+      {
+        insert(delim);
+      }
+
+      Delimiters(StringView delims) : single(delims.size() == 1 ? delims[0] : 0)
+      {
+        isSingle = delims.size() == 1;
+        for (char c : delims)
+          insert(c);
+      }
+
+      bool contains(char c) const
+      {
+        const uint8_t u = uint8_t(c);
+        return (bits[u >> 6] >> (u & 63)) & 1;
+      }
+
+      // first delimiter in [begin, end), or end
+      const char *find(const char *begin, const char *end) const
+      {
+        if (isSingle) {
+          const void *p = std::memchr(begin, single, end - begin);
+          return p ? static_cast<const char *>(p) : end;
+        }
+        while (begin != end && !contains(*begin))
+          ++begin;
+        return begin;
+      }
+
+      // first character in [begin, end) which is no delimiter, or end
+      const char *skip(const char *begin, const char *end) const
+      {
+        while (begin != end && contains(*begin))
+          ++begin;
+        return begin;
+      }
+
+     private:
+      void insert(char c)
+      {
+        const uint8_t u = uint8_t(c);
+        bits[u >> 6] |= uint64_t(1) << (u & 63);
+      }
+
+      uint64_t bits[4]{};
+      char single;
+      bool isSingle{true};
+    };
+
+    /* Iterates over the pieces of a string, finding each one when advanced.
+       With 'keepEmpty', every delimiter ends a piece (as in split() on a
+       single character); otherwise runs of delimiters separate the pieces
+       and no piece is empty. */
+    class TokenIterator
+    {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type        = StringView;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const StringView *;
+      using reference         = const StringView &;
+
+      TokenIterator() = default;
+
+      TokenIterator(StringView input, Delimiters delims, bool keepEmpty)
+          : next(input.begin()),
+            last(input.end()),
+            delims(delims),
+            keepEmpty(keepEmpty)
+      {
+        advance();
+      }
+
+      const StringView &operator*() const
+      {
+        return token;
+      }
+
+      const StringView *operator->() const
+      {
+        return &token;
+      }
+
+      TokenIterator &operator++()
+      {
+        advance();
+        return *this;
+      }
+
+      TokenIterator operator++(int)
+      {
+        TokenIterator it = *this;
+        advance();
+        return it;
+      }
+
+      // all iterators past the last piece are equal
+      bool operator==(const TokenIterator &other) const
+      {
+        return next == other.next;
+      }
+
+      bool operator!=(const TokenIterator &other) const
+      {
+        return next != other.next;
+      }
+
+     private:
+      void advance()
+      {
+        if (next && !keepEmpty)
+          next = delims.skip(next, last);
+        // same pieces as std::getline() would produce: a trailing delimiter
+        // does not start another (empty) piece
+        if (next == last) {
+          next  = nullptr;
+          token = StringView();
+          return;
+        }
+        const char *end = delims.find(next, last);
+        token           = StringView(next, end - next);
+        next            = end == last ? last : end + 1;
+      }
+
+      const char *next{nullptr};
+      const char *last{nullptr};
+      StringView token;
+      Delimiters delims{'\0'};
+      bool keepEmpty{true};
+    };
+
+    /* The pieces of a string, for range based for loops */
+    class TokenRange
+    {
+     public:
+      TokenRange(StringView input, Delimiters delims, bool keepEmpty)
+          : first(input, delims, keepEmpty)
+      {
+      }
+
+      TokenIterator begin() const
+      {
+        return first;
+      }
+
+      TokenIterator end() const
+      {
+        return TokenIterator();
+      }
+
+     private:
+      TokenIterator first;
+    };
+
+    /* lazily split a string on a single character delimiter; the pieces
+       view 'input', which must outlive them */
+    inline TokenRange tokens(StringView input, char delim)
+    {
+      return TokenRange(input, delim, true);
+    }
+
+    /* lazily split a string on a set of delimiters */
+    inline TokenRange tokens(StringView input, StringView delims)
+    {
+      return TokenRange(input, Delimiters(delims), false);
+    }
+
+    /* split a string on a single character delimiter, appending views of
+       the pieces to 'tokens'; with a containers::SmallVector<StringView, N>
+       nothing is allocated for inputs of up to N pieces */
+    template <typename CONTAINER_T>
+    inline void split_view(StringView input, char delim, CONTAINER_T &tokens)
+    {
+      for (StringView token : utility::tokens(input, delim))
+        tokens.push_back(token);
+    }
+
+    /* split a string on a set of delimiters, appending views of the pieces
+       to 'tokens' */
+    template <typename CONTAINER_T>
+    inline void split_view(StringView input,
+                           StringView delims,
+                           CONTAINER_T &tokens)
+    {
+      for (StringView token : utility::tokens(input, delims))
+        tokens.push_back(token);
+    }
+
+    /* split a string on a single character delimiter, appending the pieces
+       to 'tokens'; a containers::SmallVector<std::string, N> there avoids
+       allocating the list for inputs of up to N pieces */
+    template <typename CONTAINER_T>
+    inline void split(const std::string &input,
+                      char delim,
+                      CONTAINER_T &tokens)
+    {
+      using T = typename CONTAINER_T::value_type;
+      for (StringView token : utility::tokens(input, delim))
+        tokens.push_back(T(token));
     }
 
     /* split a string on a single character delimiter */
     inline std::vector<std::string> split(const std::string &input, char delim)
     {
-      std::stringstream ss(input);
-      std::string item;
       std::vector<std::string> elems;
-      while (std::getline(ss, item, delim))
-        elems.push_back(std::move(item));
+      split(input, delim, elems);
       return elems;
     }
 
+    /* split a string on a set of delimiters, appending the pieces to
+       'tokens' */
+    template <typename CONTAINER_T>
+    inline void split(const std::string &input,
+                      const std::string &delim,
+                      CONTAINER_T &tokens)
+    {
+      using T = typename CONTAINER_T::value_type;
+      for (StringView token : utility::tokens(input, delim))
+        tokens.push_back(T(token));
+    }
+
     /* split a string on a set of delimiters */
     inline std::vector<std::string> split(const std::string &input,
                                           const std::string &delim)
     {
       std::vector<std::string> tokens;
-      size_t pos = 0;
-      while (1) {
-        size_t begin = input.find_first_not_of(delim, pos);
-        if (begin == input.npos)
-          return tokens;
-        size_t end = input.find_first_of(delim, begin);
-        tokens.push_back(input.substr(
-            begin, (end == input.npos) ? input.npos : (end - begin)));
-        pos = end;
+      split(input, delim, tokens);
+      return tokens;
+    }
+
+    namespace detail {
+
+      // branch free, so that loops over strings vectorize
+      inline char lowerCaseASCII(char c)
+      {
+        const uint8_t u = uint8_t(c);
+        return char(u + ((uint8_t(u - 'A') < 26) << 5));
       }
+
+      inline char upperCaseASCII(char c)
+      {
+        const uint8_t u = uint8_t(c);
+        return char(u - ((uint8_t(u - 'a') < 26) << 5));
+      }
+
+    }  // namespace detail
+
+    /* convert ASCII letters to lower case in place; a loop the compiler
+       vectorizes, unlike calls to ::tolower() */
+    inline void lowerCaseInPlace(char *str, size_t size)
+    {
+      for (size_t i = 0; i < size; ++i)
+        str[i] = detail::lowerCaseASCII(str[i]);
+    }
+
+    inline void lowerCaseInPlace(std::string &str)
+    {
+      lowerCaseInPlace(&str[0], str.size());
+    }
+
+    /* convert ASCII letters to upper case in place */
+    inline void upperCaseInPlace(char *str, size_t size)
+    {
+      for (size_t i = 0; i < size; ++i)
+        str[i] = detail::upperCaseASCII(str[i]);
+    }
+
+    inline void upperCaseInPlace(std::string &str)
+    {
+      upperCaseInPlace(&str[0], str.size());
     }
 
     /* return lower case version of the input string */
     inline std::string lowerCase(const std::string &str)
     {
       std::string retval = str;
-      std::transform(retval.begin(), retval.end(), retval.begin(), ::tolower);
+      lowerCaseInPlace(retval);
       return retval;
     }
 
@@ -74,9 +331,22 @@ namespace rkcommon {
     inline std::string upperCase(const std::string &str)
     {
       std::string retval = str;
-      std::transform(retval.begin(), retval.end(), retval.begin(), ::toupper);
+      upperCaseInPlace(retval);
       return retval;
     }
 
+    /* compare two strings ignoring the case of ASCII letters, without
+       converting either */
+    inline bool equalsIgnoreCase(StringView a, StringView b)
+    {
+      if (a.size() != b.size())
+        return false;
+      for (size_t i = 0; i < a.size(); ++i) {
+        if (detail::lowerCaseASCII(a[i]) != detail::lowerCaseASCII(b[i]))
+          return false;
+      }
+      return true;
+    }
+
   }  // namespace utility
 }  // namespace rkcommon
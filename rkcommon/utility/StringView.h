@@ -0,0 +1,100 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace rkcommon {
+  namespace utility {
+
+    /* A non-owning view of a range of characters, not null terminated,
+       standing in for C++17's std::string_view. The characters must outlive
+       the view. Positions past the end are std::string::npos. */
+    class StringView
+    {
+     public:
+      StringView() = default;
+      StringView(const char *s) : ptr(s), length(s ? std::strlen(s) : 0) {}
+      StringView(const char *s, size_t n) : ptr(s), length(n) {}
+      StringView(const std::string &s) : ptr(s.data()), length(s.size()) {}
+
+      const char *data() const
+      {
+        return ptr;
+      }
+
+      size_t size() const
+      {
+        return length;
+      }
+
+      bool empty() const
+      {
+        return length == 0;
+      }
+
+      const char *begin() const
+      {
+        return ptr;
+      }
+
+      const char *end() const
+      {
+        return ptr + length;
+      }
+
+      char operator[](size_t i) const
+      {
+        return ptr[i];
+      }
+
+      StringView substr(size_t pos, size_t n = std::string::npos) const
+      {
+        pos = pos < length ? pos : length;
+        return StringView(ptr + pos, n < length - pos ? n : length - pos);
+      }
+
+      size_t find(char c, size_t pos = 0) const
+      {
+        for (size_t i = pos; i < length; ++i)
+          if (ptr[i] == c)
+            return i;
+        return std::string::npos;
+      }
+
+      std::string str() const
+      {
+        return std::string(ptr, length);
+      }
+
+      explicit operator std::string() const
+      {
+        return str();
+      }
+
+     private:
+      const char *ptr{nullptr};
+      size_t length{0};
+    };
+
+    inline bool operator==(StringView a, StringView b)
+    {
+      return a.size() == b.size()
+          && (a.size() == 0 || std::memcmp(a.data(), b.data(), a.size()) == 0);
+    }
+
+    inline bool operator!=(StringView a, StringView b)
+    {
+      return !(a == b);
+    }
+
+    inline std::ostream &operator<<(std::ostream &o, StringView s)
+    {
+      return o.write(s.data(), s.size());
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
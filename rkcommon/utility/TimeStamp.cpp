@@ -8,6 +8,19 @@ namespace rkcommon {
 
     std::atomic<size_t> TimeStamp::global{0};
 
+    // Each thread takes its values from a block reserved from 'global', so
+    // that a thread renewing many stamps in a row writes the shared counter
+    // once per block rather than for every stamp
+    static constexpr size_t blockSize = 64;
+
+    struct TimeStampBlock
+    {
+      size_t next{0};
+      size_t end{0};
+    };
+
+    static thread_local TimeStampBlock block;
+
     TimeStamp::TimeStamp(const TimeStamp &other)
     {
       this->value = other.value.load();
@@ -42,7 +55,18 @@ namespace rkcommon {
 
     size_t TimeStamp::nextValue()
     {
-      return global++;
+      // Stamps must also order across threads: one taken after another (as
+      // seen through any synchronization) compares greater. Once another
+      // thread reserved a block, the counter is past the end of ours and
+      // that block may hold the greater values, so ours is given up. What
+      // this thread saw of the counter includes every block whose values
+      // happened before, so a block ending at the counter is past them all
+      if (block.next == block.end
+          || global.load(std::memory_order_relaxed) != block.end) {
+        block.next = global.fetch_add(blockSize);
+        block.end  = block.next + blockSize;
+      }
+      return block.next++;
     }
 
   }  // namespace utility
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
 
 namespace rkcommon {
@@ -13,6 +14,9 @@ namespace rkcommon {
      * "doublebuffering" a single value. Note that all values from the producer
      * thread overwrite the "queued" value, where the consumer thread will
      * always get the last value set by the producer thread.
+     *
+     * NOTE: both threads take a lock to hand the value over, see
+     *       TripleBufferedValue for a lock-free alternative.
      */
     template <typename T>
     class TransactionalValue
@@ -35,7 +39,7 @@ namespace rkcommon {
       bool update();
 
      private:
-      bool newValue{false};
+      std::atomic<bool> newValue{false};
       T queuedValue;
       T currentValue;
 
@@ -58,7 +62,7 @@ namespace rkcommon {
     {
       std::lock_guard<std::mutex> lock{mutex};
       queuedValue = ot;
-      newValue    = true;
+      newValue.store(true, std::memory_order_release);
       return *this;
     }
 
@@ -67,8 +71,8 @@ namespace rkcommon {
         const TransactionalValue<T> &fp)
     {
       std::lock_guard<std::mutex> lock{mutex};
-      queuedValue = fp.ref();
-      newValue    = true;
+      queuedValue = fp.currentValue;
+      newValue.store(true, std::memory_order_release);
       return *this;
     }
 
@@ -88,11 +92,11 @@ namespace rkcommon {
     inline bool TransactionalValue<T>::update()
     {
       bool didUpdate = false;
-      if (newValue) {
+      if (newValue.load(std::memory_order_acquire)) {
         std::lock_guard<std::mutex> lock{mutex};
         currentValue = std::move(queuedValue);
-        newValue     = false;
-        didUpdate    = true;
+        newValue.store(false, std::memory_order_relaxed);
+        didUpdate = true;
       }
 
       return didUpdate;
@@ -0,0 +1,124 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace rkcommon {
+  namespace utility {
+
+    /*! This class is a lock-free drop-in for TransactionalValue: one producer
+        thread assigns values for one consumer thread, which picks up the last
+        complete one with update() and reads it with ref() or get().
+
+        The value lives in three buffers: the producer writes into its own
+        "back" buffer and then exchanges it with the "middle" one in a single
+        atomic operation, which the consumer in turn exchanges with its
+        "front" buffer. Neither thread ever waits for the other or copies a
+        value while the other one is blocked; values the consumer did not pick
+        up in time are overwritten.
+
+        NOTE: the buffers are reused, so T must be default constructable and
+              an assignment may find the contents of an older value.
+     */
+    template <typename T>
+    class TripleBufferedValue
+    {
+     public:
+      TripleBufferedValue()  = default;
+      ~TripleBufferedValue() = default;
+
+      template <typename OtherType>
+      TripleBufferedValue(const OtherType &ot);
+
+      template <typename OtherType>
+      TripleBufferedValue &operator=(const OtherType &ot);
+
+      TripleBufferedValue<T> &operator=(const TripleBufferedValue<T> &fp);
+
+      T &ref();
+      T get();
+
+      bool update();
+
+     private:
+      // the middle buffer holds a value the consumer has not seen yet
+      static constexpr int NEW_VALUE = 0x4;
+
+      void publish();
+
+      T values[3];
+
+      // only touched by the consumer thread
+      int front{0};
+      // exchanged between the threads, with NEW_VALUE
+      std::atomic<int> middle{1};
+      // only touched by the producer thread
+      int back{2};
+    };
+
+    // Inlined TripleBufferedValue Members ////////////////////////////////////
+
+    template <typename T>
+    constexpr int TripleBufferedValue<T>::NEW_VALUE;
+
+    template <typename T>
+    template <typename OtherType>
+    inline TripleBufferedValue<T>::TripleBufferedValue(const OtherType &ot)
+    {
+      values[front] = ot;
+    }
+
+    template <typename T>
+    template <typename OtherType>
+    inline TripleBufferedValue<T> &TripleBufferedValue<T>::operator=(
+        const OtherType &ot)
+    {
+      values[back] = ot;
+      publish();
+      return *this;
+    }
+
+    template <typename T>
+    inline TripleBufferedValue<T> &TripleBufferedValue<T>::operator=(
+        const TripleBufferedValue<T> &fp)
+    {
+      values[back] = fp.values[fp.front];
+      publish();
+      return *this;
+    }
+
+    template <typename T>
+    inline T &TripleBufferedValue<T>::ref()
+    {
+      return values[front];
+    }
+
+    template <typename T>
+    inline T TripleBufferedValue<T>::get()
+    {
+      return values[front];
+    }
+
+    template <typename T>
+    inline bool TripleBufferedValue<T>::update()
+    {
+      if (!(middle.load(std::memory_order_relaxed) & NEW_VALUE))
+        return false;
+
+      // acquire the value the producer wrote, release the old front buffer
+      front = middle.exchange(front, std::memory_order_acq_rel) & ~NEW_VALUE;
+      return true;
+    }
+
+    template <typename T>
+    inline void TripleBufferedValue<T>::publish()
+    {
+      back = middle.exchange(back | NEW_VALUE, std::memory_order_acq_rel)
+             & ~NEW_VALUE;
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
@@ -0,0 +1,181 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "TypedArrayView.h"
+#include "../math/dispatch.h"
+#include "../tasking/parallel_for.h"
+// std
+#include <cstring>
+
+namespace rkcommon {
+  namespace utility {
+
+    using namespace rkcommon::math;
+
+    // conversions of at least this many elements are split into parallel tasks
+    static constexpr size_t parallelThreshold = 256 * 1024;
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      // Dense loops of plain casts, vectorized by the compiler
+      template <typename IN_T, typename OUT_T>
+      static void convertRange(const byte_t *in,
+                               size_t stride,
+                               OUT_T *out,
+                               size_t n)
+      {
+        if (stride == sizeof(IN_T)) {
+          const IN_T *values = reinterpret_cast<const IN_T *>(in);
+          for (size_t i = 0; i < n; ++i)
+            out[i] = OUT_T(values[i]);
+        } else {
+          for (size_t i = 0; i < n; ++i)
+            out[i] = detail::convertValue<IN_T, OUT_T>(in + i * stride);
+        }
+      }
+
+      // Half floats through their bulk conversion, F16C or NEON
+      template <typename OUT_T>
+      static void convertHalf(const byte_t *in,
+                              size_t stride,
+                              OUT_T *out,
+                              size_t n)
+      {
+        const size_t chunkSize = 256;
+        float values[chunkSize];
+        for (size_t begin = 0; begin < n; begin += chunkSize) {
+          const size_t count = std::min(chunkSize, n - begin);
+          if (stride == sizeof(half)) {
+            convert(reinterpret_cast<const half *>(in) + begin, values, count);
+          } else {
+            for (size_t i = 0; i < count; ++i) {
+              values[i] =
+                  detail::convertValue<half, float>(in + (begin + i) * stride);
+            }
+          }
+          for (size_t i = 0; i < count; ++i)
+            out[begin + i] = OUT_T(values[i]);
+        }
+      }
+
+      template <typename OUT_T>
+      static void convertAny(const byte_t *in,
+                             DataType type,
+                             size_t stride,
+                             OUT_T *out,
+                             size_t n)
+      {
+        switch (type) {
+        case DataType::UINT8:
+          convertRange<uint8_t>(in, stride, out, n);
+          break;
+        case DataType::INT8:
+          convertRange<int8_t>(in, stride, out, n);
+          break;
+        case DataType::UINT16:
+          convertRange<uint16_t>(in, stride, out, n);
+          break;
+        case DataType::INT16:
+          convertRange<int16_t>(in, stride, out, n);
+          break;
+        case DataType::UINT32:
+          convertRange<uint32_t>(in, stride, out, n);
+          break;
+        case DataType::INT32:
+          convertRange<int32_t>(in, stride, out, n);
+          break;
+        case DataType::HALF:
+          convertHalf(in, stride, out, n);
+          break;
+        case DataType::BFLOAT16:
+          convertRange<bfloat16>(in, stride, out, n);
+          break;
+        case DataType::FLOAT:
+          convertRange<float>(in, stride, out, n);
+          break;
+        case DataType::DOUBLE:
+          convertRange<double>(in, stride, out, n);
+          break;
+        }
+      }
+
+      void convertToFloat(
+          const byte_t *in, DataType type, size_t stride, float *out, size_t n)
+      {
+        convertAny(in, type, stride, out, n);
+      }
+
+      void convertToDouble(
+          const byte_t *in, DataType type, size_t stride, double *out, size_t n)
+      {
+        convertAny(in, type, stride, out, n);
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // TypedArrayView.h definitions ///////////////////////////////////////////
+
+    template <typename T>
+    using ConvertFcn = void(const byte_t *, DataType, size_t, T *, size_t);
+
+    RKCOMMON_ISA_DECLARE(ConvertFcn<float> convertToFloat)
+    RKCOMMON_ISA_DECLARE(ConvertFcn<double> convertToDouble)
+
+    template <typename T>
+    static void convertParallel(ConvertFcn<T> *fcn,
+                                const void *in,
+                                DataType type,
+                                size_t stride,
+                                T *out,
+                                size_t n,
+                                bool parallel)
+    {
+      const byte_t *src = static_cast<const byte_t *>(in);
+      if (!parallel || n < parallelThreshold) {
+        fcn(src, type, stride, out, n);
+        return;
+      }
+
+      const size_t chunkSize = parallelThreshold / 4;
+      const size_t numChunks = (n + chunkSize - 1) / chunkSize;
+      tasking::parallel_for(numChunks, [&](size_t c) {
+        const size_t begin = c * chunkSize;
+        const size_t count = std::min(chunkSize, n - begin);
+        fcn(src + begin * stride, type, stride, out + begin, count);
+      });
+    }
+
+    namespace detail {
+
+      void convertValues(const void *in,
+                         DataType type,
+                         size_t stride,
+                         float *out,
+                         size_t n,
+                         bool parallel)
+      {
+        static ConvertFcn<float> *const fcn =
+            RKCOMMON_ISA_SELECT(ConvertFcn<float>, convertToFloat);
+        convertParallel(fcn, in, type, stride, out, n, parallel);
+      }
+
+      void convertValues(const void *in,
+                         DataType type,
+                         size_t stride,
+                         double *out,
+                         size_t n,
+                         bool parallel)
+      {
+        static ConvertFcn<double> *const fcn =
+            RKCOMMON_ISA_SELECT(ConvertFcn<double>, convertToDouble);
+        convertParallel(fcn, in, type, stride, out, n, parallel);
+      }
+
+    }  // namespace detail
+#endif
+
+  }  // namespace utility
+}  // namespace rkcommon
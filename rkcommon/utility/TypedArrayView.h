@@ -0,0 +1,480 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "../common.h"
+#include "../math/half.h"
+#include "../math/range.h"
+#include "AbstractArray.h"
+#include "DataView.h"
+// std
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace rkcommon {
+  namespace utility {
+
+    // Element types of a TypedArrayView
+    enum class DataType
+    {
+      UINT8,
+      INT8,
+      UINT16,
+      INT16,
+      UINT32,
+      INT32,
+      HALF,
+      BFLOAT16,
+      FLOAT,
+      DOUBLE
+    };
+
+    // bytes per element of 'type'
+    inline size_t dataTypeSize(DataType type);
+
+    // The DataType of T, for the types listed in DataType
+    template <typename T>
+    struct DataTypeOf;
+
+    namespace detail {
+
+      /* Converts 'n' elements of 'type', 'stride' bytes apart, to 'out'.
+         Dense arrays are converted with the vector instructions of the host
+         CPU, in parallel when large and asked to be 'parallel'. */
+      RKCOMMON_INTERFACE void convertValues(const void *in,
+                                            DataType type,
+                                            size_t stride,
+                                            float *out,
+                                            size_t n,
+                                            bool parallel);
+
+      RKCOMMON_INTERFACE void convertValues(const void *in,
+                                            DataType type,
+                                            size_t stride,
+                                            double *out,
+                                            size_t n,
+                                            bool parallel);
+
+    }  // namespace detail
+
+    template <typename T>
+    class ConvertedChunks;
+
+    /* A view of an array whose element type is only known at runtime, e.g.
+       uint8, half or float data as it was loaded. The elements, 'stride'
+       bytes apart, are read converted to float or double: in bulk with
+       convertTo(), one chunk at a time with chunks(), or one at a time with
+       get(). Like DataView, the view does not own the data. */
+    class TypedArrayView
+    {
+     public:
+      TypedArrayView() = default;
+
+      // a 'stride' of 0 means the elements are tightly packed
+      TypedArrayView(const void *data,
+                     DataType type,
+                     size_t size,
+                     size_t stride = 0);
+
+      template <typename T>
+      TypedArrayView(const T *data, size_t size, size_t stride = sizeof(T));
+
+      template <typename T>
+      TypedArrayView(const AbstractArray<T> &array);
+
+      const void *data() const;
+      DataType type() const;
+      size_t size() const;
+      bool empty() const;
+      size_t byteStride() const;
+      bool isDense() const;
+
+      template <typename T>
+      bool is() const;
+
+      // The elements as their own type, throws if that is not T
+      template <typename T>
+      DataView<T> as() const;
+
+      // Element 'index' converted to T
+      template <typename T>
+      T get(size_t index) const;
+
+      // Elements [range.lower, range.upper)
+      TypedArrayView slice(const math::range_t<size_t> &range) const;
+
+      // Converts elements [range.lower, range.upper) to float or double
+      template <typename T>
+      void convertTo(const math::range_t<size_t> &range,
+                     T *out,
+                     bool parallel = true) const;
+
+      // Converts all elements to float or double
+      template <typename T>
+      void convertTo(T *out, bool parallel = true) const;
+
+      /* The elements converted to T 'chunkSize' at a time into a buffer of
+         the returned object, or not at all for tightly packed T */
+      template <typename T>
+      ConvertedChunks<T> chunks(size_t chunkSize = 1024) const;
+
+     private:
+      const byte_t *ptr{nullptr};
+      DataType dataType{DataType::UINT8};
+      size_t numItems{0};
+      size_t stride{1};
+    };
+
+    // A range of elements converted to T, valid until the next chunk
+    template <typename T>
+    struct ConvertedChunk
+    {
+      // the index of the first element in the view
+      size_t first{0};
+      size_t size{0};
+      const T *data{nullptr};
+
+      const T &operator[](size_t i) const
+      {
+        return data[i];
+      }
+
+      const T *begin() const
+      {
+        return data;
+      }
+
+      const T *end() const
+      {
+        return data + size;
+      }
+    };
+
+    /* The chunks of a TypedArrayView converted to T, for single pass range
+       based for loops:
+
+         for (const ConvertedChunk<float> &c : view.chunks<float>())
+           for (size_t i = 0; i < c.size; ++i)
+             sum += c[i];
+    */
+    template <typename T>
+    class ConvertedChunks
+    {
+     public:
+      class iterator
+      {
+       public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = ConvertedChunk<T>;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const ConvertedChunk<T> *;
+        using reference         = const ConvertedChunk<T> &;
+
+        iterator() = default;
+        iterator(ConvertedChunks *parent, size_t first);
+
+        reference operator*() const;
+        pointer operator->() const;
+        iterator &operator++();
+
+        bool operator==(const iterator &other) const;
+        bool operator!=(const iterator &other) const;
+
+       private:
+        ConvertedChunks *parent{nullptr};
+        size_t first{0};
+      };
+
+      ConvertedChunks(const TypedArrayView &view, size_t chunkSize);
+
+      iterator begin();
+      iterator end();
+
+     private:
+      void load(size_t first);
+
+      TypedArrayView view;
+      size_t chunkSize;
+      std::vector<T> buffer;
+      ConvertedChunk<T> current;
+    };
+
+    // Inlined definitions ////////////////////////////////////////////////////
+
+    inline size_t dataTypeSize(DataType type)
+    {
+      switch (type) {
+      case DataType::UINT8:
+      case DataType::INT8:
+        return 1;
+      case DataType::UINT16:
+      case DataType::INT16:
+      case DataType::HALF:
+      case DataType::BFLOAT16:
+        return 2;
+      case DataType::UINT32:
+      case DataType::INT32:
+      case DataType::FLOAT:
+        return 4;
+      case DataType::DOUBLE:
+        return 8;
+      }
+      return 0;
+    }
+
+#define RKCOMMON_DATA_TYPE_OF(T, TYPE)                 \
+  template <>                                          \
+  struct DataTypeOf<T>                                 \
+  {                                                    \
+    static constexpr DataType value = DataType::TYPE; \
+  };
+
+    RKCOMMON_DATA_TYPE_OF(uint8_t, UINT8)
+    RKCOMMON_DATA_TYPE_OF(int8_t, INT8)
+    RKCOMMON_DATA_TYPE_OF(uint16_t, UINT16)
+    RKCOMMON_DATA_TYPE_OF(int16_t, INT16)
+    RKCOMMON_DATA_TYPE_OF(uint32_t, UINT32)
+    RKCOMMON_DATA_TYPE_OF(int32_t, INT32)
+    RKCOMMON_DATA_TYPE_OF(math::half, HALF)
+    RKCOMMON_DATA_TYPE_OF(math::bfloat16, BFLOAT16)
+    RKCOMMON_DATA_TYPE_OF(float, FLOAT)
+    RKCOMMON_DATA_TYPE_OF(double, DOUBLE)
+
+#undef RKCOMMON_DATA_TYPE_OF
+
+    namespace detail {
+
+      template <typename IN_T, typename T>
+      inline T convertValue(const byte_t *p)
+      {
+        IN_T value;
+        std::memcpy(&value, p, sizeof(value));
+        return T(value);
+      }
+
+    }  // namespace detail
+
+    // TypedArrayView //
+
+    inline TypedArrayView::TypedArrayView(const void *_data,
+                                          DataType _type,
+                                          size_t _size,
+                                          size_t _stride)
+        : ptr(static_cast<const byte_t *>(_data)),
+          dataType(_type),
+          numItems(_size),
+          stride(_stride ? _stride : dataTypeSize(_type))
+    {
+    }
+
+    template <typename T>
+    inline TypedArrayView::TypedArrayView(const T *_data,
+                                          size_t _size,
+                                          size_t _stride)
+        : TypedArrayView(_data, DataTypeOf<T>::value, _size, _stride)
+    {
+    }
+
+    template <typename T>
+    inline TypedArrayView::TypedArrayView(const AbstractArray<T> &array)
+        : TypedArrayView(array.data(), array.size())
+    {
+    }
+
+    inline const void *TypedArrayView::data() const
+    {
+      return ptr;
+    }
+
+    inline DataType TypedArrayView::type() const
+    {
+      return dataType;
+    }
+
+    inline size_t TypedArrayView::size() const
+    {
+      return numItems;
+    }
+
+    inline bool TypedArrayView::empty() const
+    {
+      return numItems == 0;
+    }
+
+    inline size_t TypedArrayView::byteStride() const
+    {
+      return stride;
+    }
+
+    inline bool TypedArrayView::isDense() const
+    {
+      return stride == dataTypeSize(dataType);
+    }
+
+    template <typename T>
+    inline bool TypedArrayView::is() const
+    {
+      return dataType == DataTypeOf<T>::value;
+    }
+
+    template <typename T>
+    inline DataView<T> TypedArrayView::as() const
+    {
+      if (!is<T>())
+        throw std::runtime_error("TypedArrayView is not of the requested type");
+      return DataView<T>(ptr, stride);
+    }
+
+    template <typename T>
+    inline T TypedArrayView::get(size_t index) const
+    {
+      const byte_t *p = ptr + index * stride;
+      switch (dataType) {
+      case DataType::UINT8:
+        return detail::convertValue<uint8_t, T>(p);
+      case DataType::INT8:
+        return detail::convertValue<int8_t, T>(p);
+      case DataType::UINT16:
+        return detail::convertValue<uint16_t, T>(p);
+      case DataType::INT16:
+        return detail::convertValue<int16_t, T>(p);
+      case DataType::UINT32:
+        return detail::convertValue<uint32_t, T>(p);
+      case DataType::INT32:
+        return detail::convertValue<int32_t, T>(p);
+      case DataType::HALF:
+        return T(detail::convertValue<math::half, float>(p));
+      case DataType::BFLOAT16:
+        return T(detail::convertValue<math::bfloat16, float>(p));
+      case DataType::FLOAT:
+        return detail::convertValue<float, T>(p);
+      case DataType::DOUBLE:
+        return detail::convertValue<double, T>(p);
+      }
+      return T();
+    }
+
+    inline TypedArrayView TypedArrayView::slice(
+        const math::range_t<size_t> &range) const
+    {
+      return TypedArrayView(
+          ptr + range.lower * stride, dataType, range.size(), stride);
+    }
+
+    template <typename T>
+    inline void TypedArrayView::convertTo(const math::range_t<size_t> &range,
+                                          T *out,
+                                          bool parallel) const
+    {
+      detail::convertValues(ptr + range.lower * stride,
+                            dataType,
+                            stride,
+                            out,
+                            range.size(),
+                            parallel);
+    }
+
+    template <typename T>
+    inline void TypedArrayView::convertTo(T *out, bool parallel) const
+    {
+      detail::convertValues(ptr, dataType, stride, out, numItems, parallel);
+    }
+
+    template <typename T>
+    inline ConvertedChunks<T> TypedArrayView::chunks(size_t chunkSize) const
+    {
+      return ConvertedChunks<T>(*this, chunkSize);
+    }
+
+    // ConvertedChunks //
+
+    template <typename T>
+    inline ConvertedChunks<T>::ConvertedChunks(const TypedArrayView &_view,
+                                               size_t _chunkSize)
+        : view(_view), chunkSize(std::max<size_t>(_chunkSize, 1))
+    {
+      if (!(view.is<T>() && view.isDense()))
+        buffer.resize(std::min(chunkSize, view.size()));
+    }
+
+    template <typename T>
+    inline typename ConvertedChunks<T>::iterator ConvertedChunks<T>::begin()
+    {
+      load(0);
+      return iterator(this, 0);
+    }
+
+    template <typename T>
+    inline typename ConvertedChunks<T>::iterator ConvertedChunks<T>::end()
+    {
+      return iterator(this, view.size());
+    }
+
+    template <typename T>
+    inline void ConvertedChunks<T>::load(size_t first)
+    {
+      current.first = first;
+      current.size  = std::min(chunkSize, view.size() - first);
+      if (current.size == 0)
+        return;
+
+      if (buffer.empty()) {
+        current.data = static_cast<const T *>(view.data()) + first;
+      } else {
+        view.convertTo(math::range_t<size_t>(first, first + current.size),
+                       buffer.data(),
+                       false);
+        current.data = buffer.data();
+      }
+    }
+
+    template <typename T>
+    inline ConvertedChunks<T>::iterator::iterator(ConvertedChunks *_parent,
+                                                  size_t _first)
+        : parent(_parent), first(_first)
+    {
+    }
+
+    template <typename T>
+    inline typename ConvertedChunks<T>::iterator::reference
+        ConvertedChunks<T>::iterator::operator*() const
+    {
+      return parent->current;
+    }
+
+    template <typename T>
+    inline typename ConvertedChunks<T>::iterator::pointer
+        ConvertedChunks<T>::iterator::operator->() const
+    {
+      return &parent->current;
+    }
+
+    template <typename T>
+    inline typename ConvertedChunks<T>::iterator &
+        ConvertedChunks<T>::iterator::operator++()
+    {
+      first += parent->current.size;
+      parent->load(first);
+      return *this;
+    }
+
+    template <typename T>
+    inline bool ConvertedChunks<T>::iterator::operator==(
+        const iterator &other) const
+    {
+      return parent == other.parent && first == other.first;
+    }
+
+    template <typename T>
+    inline bool ConvertedChunks<T>::iterator::operator!=(
+        const iterator &other) const
+    {
+      return !(*this == other);
+    }
+
+  }  // namespace utility
+}  // namespace rkcommon
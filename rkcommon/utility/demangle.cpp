@@ -2,6 +2,11 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "demangle.h"
+// std
+#include <cstring>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
 
 #ifdef __GNUG__
 #include <cxxabi.h>
@@ -29,5 +34,64 @@ namespace rkcommon {
     }
 #endif
 
+    const char *demangledName(const std::type_info &type)
+    {
+      // the names of all threads, never erased, so the pointers stay valid
+      static std::mutex mutex;
+      static std::unordered_map<std::type_index, std::string> names;
+
+      thread_local std::unordered_map<std::type_index, const char *> cache;
+
+      const std::type_index index(type);
+      auto cached = cache.find(index);
+      if (cached != cache.end())
+        return cached->second;
+
+      const char *name = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = names.find(index);
+        if (found == names.end())
+          found = names.emplace(index, demangle(type.name())).first;
+        name = found->second.c_str();
+      }
+      cache.emplace(index, name);
+      return name;
+    }
+
+    namespace detail {
+
+      std::string typeNameInSignature(const char *signature)
+      {
+        const std::string s(signature);
+#if defined(_MSC_VER) && !defined(__clang__)
+        // "const char *__cdecl ...::signatureOf<class Foo>(void)"
+        const std::string prefix = "signatureOf<";
+        const size_t begin       = s.find(prefix);
+        const size_t end         = s.rfind(">(void)");
+        if (begin == std::string::npos || end == std::string::npos)
+          return std::string();
+        std::string name = s.substr(begin + prefix.size(),
+                                    end - begin - prefix.size());
+        for (const char *tag : {"class ", "struct ", "enum ", "union "}) {
+          if (name.compare(0, std::strlen(tag), tag) == 0)
+            return name.substr(std::strlen(tag));
+        }
+        return name;
+#else
+        // "const char* ...::signatureOf() [with T = Foo]" (GCC) or
+        // "const char *...::signatureOf() [T = Foo]" (clang)
+        const std::string prefix = "T = ";
+        const size_t begin       = s.find(prefix);
+        const size_t end         = s.rfind(']');
+        if (begin == std::string::npos || end == std::string::npos
+            || end < begin)
+          return std::string();
+        return s.substr(begin + prefix.size(), end - begin - prefix.size());
+#endif
+      }
+
+    }  // namespace detail
+
   }  // namespace utility
-}  // namespace rkcommon
\ No newline at end of file
+}  // namespace rkcommon
@@ -13,11 +13,48 @@ namespace rkcommon {
 
     RKCOMMON_INTERFACE std::string demangle(const char *name);
 
+    /* The demangled name of 'type', demangled once per type and process;
+       the returned string lives as long as the process. Repeated lookups
+       from the same thread do not lock. */
+    RKCOMMON_INTERFACE const char *demangledName(const std::type_info &type);
+
+    namespace detail {
+
+      template <typename T>
+      inline const char *signatureOf()
+      {
+#if defined(_MSC_VER) && !defined(__clang__)
+        return __FUNCSIG__;
+#else
+        return __PRETTY_FUNCTION__;
+#endif
+      }
+
+      // The name of T within signatureOf<T>(), empty if not found
+      RKCOMMON_INTERFACE std::string typeNameInSignature(const char *signature);
+
+    }  // namespace detail
+
+    /* The name of T as the compiler spells it in function signatures, e.g.
+       for trace events: taken from the signature of a function template
+       instance once per T, without runtime demangling. Spellings may differ
+       between compilers, e.g. in default template arguments. */
+    template <class T>
+    inline const char *typeName()
+    {
+      static const std::string name = []() {
+        const std::string n =
+            detail::typeNameInSignature(detail::signatureOf<T>());
+        return n.empty() ? std::string(demangledName(typeid(T))) : n;
+      }();
+      return name.c_str();
+    }
+
     template <class T>
     inline std::string nameOf()
     {
-      return demangle(typeid(T).name());
+      return typeName<T>();
     }
 
   }  // namespace utility
-}  // namespace rkcommon
\ No newline at end of file
+}  // namespace rkcommon
@@ -3,7 +3,12 @@
 
 #pragma once
 
+#include "../math/morton.h"
 #include "../math/vec.h"
+#include "../tasking/parallel_for.h"
+#include "../tasking/tasking_system_init.h"
+// std
+#include <vector>
 
 namespace rkcommon {
 
@@ -12,6 +17,9 @@ namespace rkcommon {
   template <int NDIMS>
   struct multidim_index_iterator;
 
+  template <int NDIMS>
+  struct multidim_index_range;
+
   template <int NDIMS>
   struct multidim_index_sequence
   {
@@ -32,6 +40,9 @@ namespace rkcommon {
     multidim_index_iterator<NDIMS> begin() const;
     multidim_index_iterator<NDIMS> end() const;
 
+    // at most 'nChunks' contiguous, non-empty ranges of about equal size
+    std::vector<multidim_index_range<NDIMS>> split(size_t nChunks) const;
+
    private:
     vec_t<size_t, NDIMS> dims{0};
   };
@@ -39,6 +50,138 @@ namespace rkcommon {
   using index_sequence_2D = multidim_index_sequence<2>;
   using index_sequence_3D = multidim_index_sequence<3>;
 
+  /* The indices [first, last) of a multidim_index_sequence, as split() hands
+     them out to parallel workers. */
+  template <int NDIMS>
+  struct multidim_index_range
+  {
+    multidim_index_range(const vec_t<size_t, NDIMS> &_dims,
+                         size_t _first,
+                         size_t _last);
+
+    size_t first_index() const;
+    size_t last_index() const;
+    size_t size() const;
+
+    multidim_index_iterator<NDIMS> begin() const;
+    multidim_index_iterator<NDIMS> end() const;
+
+   private:
+    vec_t<size_t, NDIMS> dims{0};
+    size_t first{0};
+    size_t last{0};
+  };
+
+  template <int NDIMS>
+  struct tiled_index_iterator;
+
+  template <int NDIMS>
+  struct tiled_index_range;
+
+  /* Visits the same coordinates as multidim_index_sequence, tile by tile:
+     the tiles of (at most) 'tileSize' follow each other in x-fastest order,
+     and so do the coordinates within each tile. Consecutive coordinates thus
+     stay within a small neighborhood, like zorder_index_sequence, but for
+     any dimensions and without skipping padding. */
+  template <int NDIMS>
+  struct tiled_index_sequence
+  {
+    static_assert(NDIMS == 2 || NDIMS == 3,
+                  "rkcommon::tiled_index_sequence is currently limited to"
+                  " only 2 or 3 dimensions. (NDIMS == 2 || NDIMS == 3)");
+
+    tiled_index_sequence(const vec_t<size_t, NDIMS> &_dims,
+                         const vec_t<size_t, NDIMS> &_tileSize);
+
+    vec_t<size_t, NDIMS> dimensions() const;
+    vec_t<size_t, NDIMS> tile_size() const;
+
+    size_t total_indices() const;
+
+    // number of tiles along each dimension, and in total
+    vec_t<size_t, NDIMS> num_tiles() const;
+    size_t total_tiles() const;
+
+    // the coordinates [lower, upper) covered by tile 'i'
+    vec_t<size_t, NDIMS> tile_lower(size_t i) const;
+    vec_t<size_t, NDIMS> tile_upper(size_t i) const;
+
+    tiled_index_iterator<NDIMS> begin() const;
+    tiled_index_iterator<NDIMS> end() const;
+
+    // at most 'nChunks' non-empty ranges of whole, consecutive tiles
+    std::vector<tiled_index_range<NDIMS>> split(size_t nChunks) const;
+
+   private:
+    vec_t<size_t, NDIMS> dims{0};
+    vec_t<size_t, NDIMS> tileSize{1};
+    multidim_index_sequence<NDIMS> tiles;
+  };
+
+  using tiled_sequence_2D = tiled_index_sequence<2>;
+  using tiled_sequence_3D = tiled_index_sequence<3>;
+
+  // The tiles [firstTile, lastTile) of a tiled_index_sequence
+  template <int NDIMS>
+  struct tiled_index_range
+  {
+    tiled_index_range(const tiled_index_sequence<NDIMS> &_seq,
+                      size_t _firstTile,
+                      size_t _lastTile);
+
+    size_t first_tile() const;
+    size_t last_tile() const;
+
+    tiled_index_iterator<NDIMS> begin() const;
+    tiled_index_iterator<NDIMS> end() const;
+
+   private:
+    tiled_index_sequence<NDIMS> seq;
+    size_t firstTile{0};
+    size_t lastTile{0};
+  };
+
+  template <int NDIMS>
+  struct zorder_index_iterator;
+
+  /* Visits the same coordinates as multidim_index_sequence, but in Morton
+     (Z-)order, so that consecutive coordinates stay close in every
+     dimension. Each dimension is padded to the next power of two, and
+     dimensions with fewer bits drop out of the bit interleaving once those
+     are used up. The iterator skips the codes in the padding, which are
+     fewer than 2^NDIMS - 1 per visited coordinate. */
+  template <int NDIMS>
+  struct zorder_index_sequence
+  {
+    static_assert(NDIMS == 2 || NDIMS == 3,
+                  "rkcommon::zorder_index_sequence is currently limited to"
+                  " only 2 or 3 dimensions. (NDIMS == 2 || NDIMS == 3)");
+
+    zorder_index_sequence(const vec_t<size_t, NDIMS> &_dims);
+
+    vec_t<size_t, NDIMS> dimensions() const;
+
+    size_t total_indices() const;
+
+    // the coordinates of Morton code 'code'
+    vec_t<size_t, NDIMS> reshape(uint64_t code) const;
+
+    bool contains(const vec_t<size_t, NDIMS> &coords) const;
+
+    zorder_index_iterator<NDIMS> begin() const;
+    zorder_index_iterator<NDIMS> end() const;
+
+   private:
+    friend struct zorder_index_iterator<NDIMS>;
+
+    vec_t<size_t, NDIMS> dims{0};
+    uint64_t masks[NDIMS];  // code bits of each dimension
+    uint64_t numCodes{0};
+  };
+
+  using zorder_sequence_2D = zorder_index_sequence<2>;
+  using zorder_sequence_3D = zorder_index_sequence<3>;
+
   template <int NDIMS>
   struct multidim_index_iterator
   {
@@ -46,7 +189,7 @@ namespace rkcommon {
     multidim_index_iterator(const vec_t<size_t, NDIMS> &_dims, size_t start)
         : multidim_index_iterator(_dims)
     {
-      current_index = start;
+      jump_to(start);
     }
 
     // Traditional iterator interface methods //
@@ -74,10 +217,75 @@ namespace rkcommon {
     size_t current() const;
 
    private:
+    // increments the coordinates instead of dividing the index again
+    void advance();
+
     multidim_index_sequence<NDIMS> dims;
     size_t current_index{0};
+    vec_t<size_t, NDIMS> coords{0};
   };
 
+  template <int NDIMS>
+  struct zorder_index_iterator
+  {
+    zorder_index_iterator(const zorder_index_sequence<NDIMS> &_seq,
+                          uint64_t _code)
+        : seq(_seq), code(_code)
+    {
+    }
+
+    vec_t<size_t, NDIMS> operator*() const;
+
+    zorder_index_iterator &operator++();
+
+    bool operator==(const zorder_index_iterator &other) const;
+    bool operator!=(const zorder_index_iterator &other) const;
+
+   private:
+    zorder_index_sequence<NDIMS> seq;
+    uint64_t code{0};
+  };
+
+  template <int NDIMS>
+  struct tiled_index_iterator
+  {
+    tiled_index_iterator(const tiled_index_sequence<NDIMS> &_seq,
+                         size_t _tile);
+
+    vec_t<size_t, NDIMS> operator*() const;
+
+    tiled_index_iterator &operator++();
+
+    bool operator==(const tiled_index_iterator &other) const;
+    bool operator!=(const tiled_index_iterator &other) const;
+
+   private:
+    void enter(size_t tile);
+
+    tiled_index_sequence<NDIMS> seq;
+    size_t tile{0};
+    vec_t<size_t, NDIMS> lower{0};
+    vec_t<size_t, NDIMS> upper{0};
+    vec_t<size_t, NDIMS> coords{0};
+  };
+
+  namespace tasking {
+
+    /* parallel_for() over the coordinates of an index sequence:
+       'fcn(const vec_t<size_t, NDIMS> &coords)' is called for every
+       coordinate. Each task walks a contiguous chunk of the sequence (whole
+       tiles for a tiled_index_sequence) by incrementing coordinates, so the
+       loop does no index division. */
+    template <int NDIMS, typename TASK_T>
+    inline void parallel_for(const multidim_index_sequence<NDIMS> &seq,
+                             TASK_T &&fcn);
+
+    template <int NDIMS, typename TASK_T>
+    inline void parallel_for(const tiled_index_sequence<NDIMS> &seq,
+                             TASK_T &&fcn);
+
+  }  // namespace tasking
+
   // Inlined multidim_index_sequence definitions //////////////////////////////
 
   template <int NDIMS>
@@ -141,26 +349,94 @@ namespace rkcommon {
     return multidim_index_iterator<NDIMS>(dims, total_indices());
   }
 
+  namespace detail {
+
+    // [begin, end) of chunk 'i' of 'n' about equal chunks of 'total' items
+    inline size_t chunk_begin(size_t i, size_t n, size_t total)
+    {
+      return total / n * i + std::min(i, total % n);
+    }
+
+  }  // namespace detail
+
+  template <int NDIMS>
+  inline std::vector<multidim_index_range<NDIMS>>
+  multidim_index_sequence<NDIMS>::split(size_t nChunks) const
+  {
+    const size_t total = total_indices();
+    nChunks            = std::min(std::max(nChunks, size_t(1)), total);
+
+    std::vector<multidim_index_range<NDIMS>> chunks;
+    for (size_t i = 0; i < nChunks; ++i) {
+      const size_t first = rkcommon::detail::chunk_begin(i, nChunks, total);
+      const size_t last  = rkcommon::detail::chunk_begin(i + 1, nChunks, total);
+      chunks.emplace_back(dims, first, last);
+    }
+    return chunks;
+  }
+
+  // Inlined multidim_index_range definitions /////////////////////////////////
+
+  template <int NDIMS>
+  inline multidim_index_range<NDIMS>::multidim_index_range(
+      const vec_t<size_t, NDIMS> &_dims, size_t _first, size_t _last)
+      : dims(_dims), first(_first), last(_last)
+  {
+  }
+
+  template <int NDIMS>
+  inline size_t multidim_index_range<NDIMS>::first_index() const
+  {
+    return first;
+  }
+
+  template <int NDIMS>
+  inline size_t multidim_index_range<NDIMS>::last_index() const
+  {
+    return last;
+  }
+
+  template <int NDIMS>
+  inline size_t multidim_index_range<NDIMS>::size() const
+  {
+    return last - first;
+  }
+
+  template <int NDIMS>
+  inline multidim_index_iterator<NDIMS> multidim_index_range<NDIMS>::begin()
+      const
+  {
+    return multidim_index_iterator<NDIMS>(dims, first);
+  }
+
+  template <int NDIMS>
+  inline multidim_index_iterator<NDIMS> multidim_index_range<NDIMS>::end()
+      const
+  {
+    return multidim_index_iterator<NDIMS>(dims, last);
+  }
+
   // Inlined multidim_index_iterator definitions //////////////////////////////
 
   template <int NDIMS>
   inline vec_t<size_t, NDIMS> multidim_index_iterator<NDIMS>::operator*() const
   {
-    return dims.reshape(current_index);
+    return coords;
   }
 
   template <int NDIMS>
   inline multidim_index_iterator<NDIMS>
   multidim_index_iterator<NDIMS>::operator++()
   {
-    return multidim_index_iterator<NDIMS>(dims.dimensions(), ++current_index);
+    advance();
+    return *this;
   }
 
   template <int NDIMS>
   inline multidim_index_iterator<NDIMS>
       &multidim_index_iterator<NDIMS>::operator++(int)
   {
-    current_index++;
+    advance();
     return *this;
   }
 
@@ -168,14 +444,15 @@ namespace rkcommon {
   inline multidim_index_iterator<NDIMS>
   multidim_index_iterator<NDIMS>::operator--()
   {
-    return multidim_index_iterator<NDIMS>(dims.dimensions(), --current_index);
+    jump_to(current_index - 1);
+    return *this;
   }
 
   template <int NDIMS>
   inline multidim_index_iterator<NDIMS>
       &multidim_index_iterator<NDIMS>::operator--(int)
   {
-    current_index--;
+    jump_to(current_index - 1);
     return *this;
   }
 
@@ -184,7 +461,7 @@ namespace rkcommon {
       &multidim_index_iterator<NDIMS>::operator+(
           const multidim_index_iterator &other)
   {
-    current_index += other.current_index;
+    jump_to(current_index + other.current_index);
     return *this;
   }
 
@@ -193,7 +470,7 @@ namespace rkcommon {
       &multidim_index_iterator<NDIMS>::operator-(
           const multidim_index_iterator &other)
   {
-    current_index -= other.current_index;
+    jump_to(current_index - other.current_index);
     return *this;
   }
 
@@ -201,7 +478,7 @@ namespace rkcommon {
   inline multidim_index_iterator<NDIMS>
       &multidim_index_iterator<NDIMS>::operator+(size_t offset)
   {
-    current_index += offset;
+    jump_to(current_index + offset);
     return *this;
   }
 
@@ -209,7 +486,7 @@ namespace rkcommon {
   inline multidim_index_iterator<NDIMS>
       &multidim_index_iterator<NDIMS>::operator-(size_t offset)
   {
-    current_index -= offset;
+    jump_to(current_index - offset);
     return *this;
   }
 
@@ -232,6 +509,22 @@ namespace rkcommon {
   inline void multidim_index_iterator<NDIMS>::jump_to(size_t index)
   {
     current_index = index;
+    // empty sequences have nothing to divide by
+    coords = dims.total_indices() == 0 ? vec_t<size_t, NDIMS>(0)
+                                       : dims.reshape(index);
+  }
+
+  template <int NDIMS>
+  inline void multidim_index_iterator<NDIMS>::advance()
+  {
+    current_index++;
+    const vec_t<size_t, NDIMS> d = dims.dimensions();
+    for (int i = 0; i < NDIMS - 1; ++i) {
+      if (++coords[i] < d[i])
+        return;
+      coords[i] = 0;
+    }
+    coords[NDIMS - 1]++;
   }
 
   template <int NDIMS>
@@ -240,4 +533,319 @@ namespace rkcommon {
     return current_index;
   }
 
+  // Inlined zorder_index_sequence definitions ///////////////////////////////
+
+  template <int NDIMS>
+  inline zorder_index_sequence<NDIMS>::zorder_index_sequence(
+      const vec_t<size_t, NDIMS> &_dims)
+      : dims(_dims)
+  {
+    int bits[NDIMS];
+    int maxBits = 0;
+    for (int d = 0; d < NDIMS; ++d) {
+      masks[d] = 0;
+      bits[d]  = 0;
+      while ((size_t(1) << bits[d]) < dims[d])
+        bits[d]++;
+      maxBits = std::max(maxBits, bits[d]);
+    }
+
+    int pos = 0;
+    for (int level = 0; level < maxBits; ++level)
+      for (int d = 0; d < NDIMS; ++d)
+        if (level < bits[d])
+          masks[d] |= uint64_t(1) << pos++;
+
+    numCodes = dims.long_product() == 0 ? 0 : uint64_t(1) << pos;
+  }
+
+  template <int NDIMS>
+  inline vec_t<size_t, NDIMS> zorder_index_sequence<NDIMS>::dimensions() const
+  {
+    return dims;
+  }
+
+  template <int NDIMS>
+  inline size_t zorder_index_sequence<NDIMS>::total_indices() const
+  {
+    return dims.long_product();
+  }
+
+  template <int NDIMS>
+  inline vec_t<size_t, NDIMS> zorder_index_sequence<NDIMS>::reshape(
+      uint64_t code) const
+  {
+    vec_t<size_t, NDIMS> coords;
+    for (int d = 0; d < NDIMS; ++d)
+      coords[d] = size_t(math::detail::extractBits(code, masks[d]));
+    return coords;
+  }
+
+  template <int NDIMS>
+  inline bool zorder_index_sequence<NDIMS>::contains(
+      const vec_t<size_t, NDIMS> &coords) const
+  {
+    for (int d = 0; d < NDIMS; ++d)
+      if (coords[d] >= dims[d])
+        return false;
+    return true;
+  }
+
+  template <int NDIMS>
+  inline zorder_index_iterator<NDIMS> zorder_index_sequence<NDIMS>::begin()
+      const
+  {
+    return zorder_index_iterator<NDIMS>(*this, 0);
+  }
+
+  template <int NDIMS>
+  inline zorder_index_iterator<NDIMS> zorder_index_sequence<NDIMS>::end() const
+  {
+    return zorder_index_iterator<NDIMS>(*this, numCodes);
+  }
+
+  // Inlined zorder_index_iterator definitions ///////////////////////////////
+
+  template <int NDIMS>
+  inline vec_t<size_t, NDIMS> zorder_index_iterator<NDIMS>::operator*() const
+  {
+    return seq.reshape(code);
+  }
+
+  template <int NDIMS>
+  inline zorder_index_iterator<NDIMS>
+      &zorder_index_iterator<NDIMS>::operator++()
+  {
+    do {
+      code++;
+    } while (code < seq.numCodes && !seq.contains(seq.reshape(code)));
+    return *this;
+  }
+
+  template <int NDIMS>
+  inline bool zorder_index_iterator<NDIMS>::operator==(
+      const zorder_index_iterator &other) const
+  {
+    return seq.dims == other.seq.dims && code == other.code;
+  }
+
+  template <int NDIMS>
+  inline bool zorder_index_iterator<NDIMS>::operator!=(
+      const zorder_index_iterator &other) const
+  {
+    return !(*this == other);
+  }
+
+  // Inlined tiled_index_sequence definitions ////////////////////////////////
+
+  template <int NDIMS>
+  inline tiled_index_sequence<NDIMS>::tiled_index_sequence(
+      const vec_t<size_t, NDIMS> &_dims, const vec_t<size_t, NDIMS> &_tileSize)
+      : dims(_dims),
+        tileSize(max(_tileSize, vec_t<size_t, NDIMS>(1))),
+        tiles((dims + tileSize - 1) / tileSize)
+  {
+  }
+
+  template <int NDIMS>
+  inline vec_t<size_t, NDIMS> tiled_index_sequence<NDIMS>::dimensions() const
+  {
+    return dims;
+  }
+
+  template <int NDIMS>
+  inline vec_t<size_t, NDIMS> tiled_index_sequence<NDIMS>::tile_size() const
+  {
+    return tileSize;
+  }
+
+  template <int NDIMS>
+  inline size_t tiled_index_sequence<NDIMS>::total_indices() const
+  {
+    return dims.long_product();
+  }
+
+  template <int NDIMS>
+  inline vec_t<size_t, NDIMS> tiled_index_sequence<NDIMS>::num_tiles() const
+  {
+    return tiles.dimensions();
+  }
+
+  template <int NDIMS>
+  inline size_t tiled_index_sequence<NDIMS>::total_tiles() const
+  {
+    return tiles.total_indices();
+  }
+
+  template <int NDIMS>
+  inline vec_t<size_t, NDIMS> tiled_index_sequence<NDIMS>::tile_lower(
+      size_t i) const
+  {
+    if (total_tiles() == 0)
+      return vec_t<size_t, NDIMS>(0);
+    return min(tiles.reshape(i) * tileSize, dims);
+  }
+
+  template <int NDIMS>
+  inline vec_t<size_t, NDIMS> tiled_index_sequence<NDIMS>::tile_upper(
+      size_t i) const
+  {
+    if (total_tiles() == 0)
+      return vec_t<size_t, NDIMS>(0);
+    return min(tiles.reshape(i) * tileSize + tileSize, dims);
+  }
+
+  template <int NDIMS>
+  inline tiled_index_iterator<NDIMS> tiled_index_sequence<NDIMS>::begin() const
+  {
+    return tiled_index_iterator<NDIMS>(*this, 0);
+  }
+
+  template <int NDIMS>
+  inline tiled_index_iterator<NDIMS> tiled_index_sequence<NDIMS>::end() const
+  {
+    return tiled_index_iterator<NDIMS>(*this, total_tiles());
+  }
+
+  template <int NDIMS>
+  inline std::vector<tiled_index_range<NDIMS>>
+  tiled_index_sequence<NDIMS>::split(size_t nChunks) const
+  {
+    const size_t total = total_tiles();
+    nChunks            = std::min(std::max(nChunks, size_t(1)), total);
+
+    std::vector<tiled_index_range<NDIMS>> chunks;
+    for (size_t i = 0; i < nChunks; ++i) {
+      const size_t first = rkcommon::detail::chunk_begin(i, nChunks, total);
+      const size_t last  = rkcommon::detail::chunk_begin(i + 1, nChunks, total);
+      chunks.emplace_back(*this, first, last);
+    }
+    return chunks;
+  }
+
+  // Inlined tiled_index_range definitions ///////////////////////////////////
+
+  template <int NDIMS>
+  inline tiled_index_range<NDIMS>::tiled_index_range(
+      const tiled_index_sequence<NDIMS> &_seq,
+      size_t _firstTile,
+      size_t _lastTile)
+      : seq(_seq), firstTile(_firstTile), lastTile(_lastTile)
+  {
+  }
+
+  template <int NDIMS>
+  inline size_t tiled_index_range<NDIMS>::first_tile() const
+  {
+    return firstTile;
+  }
+
+  template <int NDIMS>
+  inline size_t tiled_index_range<NDIMS>::last_tile() const
+  {
+    return lastTile;
+  }
+
+  template <int NDIMS>
+  inline tiled_index_iterator<NDIMS> tiled_index_range<NDIMS>::begin() const
+  {
+    return tiled_index_iterator<NDIMS>(seq, firstTile);
+  }
+
+  template <int NDIMS>
+  inline tiled_index_iterator<NDIMS> tiled_index_range<NDIMS>::end() const
+  {
+    return tiled_index_iterator<NDIMS>(seq, lastTile);
+  }
+
+  // Inlined tiled_index_iterator definitions ////////////////////////////////
+
+  template <int NDIMS>
+  inline tiled_index_iterator<NDIMS>::tiled_index_iterator(
+      const tiled_index_sequence<NDIMS> &_seq, size_t _tile)
+      : seq(_seq)
+  {
+    enter(_tile);
+  }
+
+  template <int NDIMS>
+  inline void tiled_index_iterator<NDIMS>::enter(size_t _tile)
+  {
+    tile   = _tile;
+    lower  = seq.tile_lower(tile);
+    upper  = seq.tile_upper(tile);
+    coords = lower;
+  }
+
+  template <int NDIMS>
+  inline vec_t<size_t, NDIMS> tiled_index_iterator<NDIMS>::operator*() const
+  {
+    return coords;
+  }
+
+  template <int NDIMS>
+  inline tiled_index_iterator<NDIMS> &tiled_index_iterator<NDIMS>::operator++()
+  {
+    for (int i = 0; i < NDIMS; ++i) {
+      if (++coords[i] < upper[i])
+        return *this;
+      coords[i] = lower[i];
+    }
+    enter(tile + 1);
+    return *this;
+  }
+
+  template <int NDIMS>
+  inline bool tiled_index_iterator<NDIMS>::operator==(
+      const tiled_index_iterator &other) const
+  {
+    return seq.dimensions() == other.seq.dimensions() &&
+           tile == other.tile && coords == other.coords;
+  }
+
+  template <int NDIMS>
+  inline bool tiled_index_iterator<NDIMS>::operator!=(
+      const tiled_index_iterator &other) const
+  {
+    return !(*this == other);
+  }
+
+  // Inlined parallel_for() over index sequences //////////////////////////////
+
+  namespace tasking {
+
+    namespace detail {
+
+      // a few chunks per thread, so uneven work still balances
+      inline size_t index_sequence_chunks()
+      {
+        return size_t(std::max(1, numTaskingThreads())) * 4;
+      }
+
+    }  // namespace detail
+
+    template <int NDIMS, typename TASK_T>
+    inline void parallel_for(const multidim_index_sequence<NDIMS> &seq,
+                             TASK_T &&fcn)
+    {
+      const auto chunks = seq.split(detail::index_sequence_chunks());
+      parallel_for(chunks.size(), [&](size_t i) {
+        for (const auto &coords : chunks[i])
+          fcn(coords);
+      });
+    }
+
+    template <int NDIMS, typename TASK_T>
+    inline void parallel_for(const tiled_index_sequence<NDIMS> &seq,
+                             TASK_T &&fcn)
+    {
+      const auto chunks = seq.split(detail::index_sequence_chunks());
+      parallel_for(chunks.size(), [&](size_t i) {
+        for (const auto &coords : chunks[i])
+          fcn(coords);
+      });
+    }
+
+  }  // namespace tasking
+
 }  // namespace rkcommon
@@ -0,0 +1,432 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "random.h"
+#include "../math/dispatch.h"
+#include "../math/packet.h"
+#include "../tasking/parallel_for.h"
+
+namespace rkcommon {
+  namespace utility {
+
+    // floats per parallel task
+    static constexpr size_t RANDOM_CHUNK_SIZE = 64 * 1024;
+
+    namespace {
+
+      /* The Philox rounds run on W blocks at once, one per lane of integer
+         registers: 16 lanes with AVX-512, 8 with AVX2 and 4 with SSE2 (or
+         NEON through sse2neon). The 32x32 -> 64 bit products come from two
+         mul_epu32, for the even and the odd lanes. */
+
+#if defined(__AVX512F__) && !defined(RKCOMMON_NO_SIMD)
+      constexpr int W = 16;
+
+      struct vuint
+      {
+        __m512i v;
+      };
+
+      inline vuint set1(uint32_t a)
+      {
+        return {_mm512_set1_epi32(int(a))};
+      }
+
+      // base, base + 1, ..., base + W - 1
+      inline vuint lanes(uint32_t base)
+      {
+        const __m512i index = _mm512_setr_epi32(
+            0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        return {_mm512_add_epi32(_mm512_set1_epi32(int(base)), index)};
+      }
+
+      inline vuint operator^(vuint a, vuint b)
+      {
+        return {_mm512_xor_si512(a.v, b.v)};
+      }
+
+      inline vuint operator^(vuint a, uint32_t b)
+      {
+        return a ^ set1(b);
+      }
+
+      inline void mulhilo(uint32_t m, vuint a, vuint &hi, vuint &lo)
+      {
+        const __m512i vm   = _mm512_set1_epi32(int(m));
+        const __m512i even = _mm512_mul_epu32(a.v, vm);
+        const __m512i odd  = _mm512_mul_epu32(_mm512_srli_epi64(a.v, 32), vm);
+        // (lo0, lo2, hi0, hi2) and (lo1, lo3, hi1, hi3) per 128-bit lane
+        const _MM_PERM_ENUM perm = _MM_PERM_ENUM(_MM_SHUFFLE(3, 1, 2, 0));
+        const __m512i e          = _mm512_shuffle_epi32(even, perm);
+        const __m512i o          = _mm512_shuffle_epi32(odd, perm);
+        lo.v                     = _mm512_unpacklo_epi32(e, o);
+        hi.v                     = _mm512_unpackhi_epi32(e, o);
+      }
+
+      inline __m512 toUniform(vuint a)
+      {
+        return _mm512_mul_ps(
+            _mm512_cvtepi32_ps(_mm512_srli_epi32(a.v, 8)),
+            _mm512_set1_ps(1.f / 16777216.f));
+      }
+
+      // the 4 * W floats of blocks (c0[i], c1[i], c2[i], c3[i]) in order
+      inline void storeUniform(
+          float *out, vuint c0, vuint c1, vuint c2, vuint c3)
+      {
+        const __m512 f0 = toUniform(c0);
+        const __m512 f1 = toUniform(c1);
+        const __m512 f2 = toUniform(c2);
+        const __m512 f3 = toUniform(c3);
+        const __m512 t0 = _mm512_unpacklo_ps(f0, f1);
+        const __m512 t1 = _mm512_unpacklo_ps(f2, f3);
+        const __m512 t2 = _mm512_unpackhi_ps(f0, f1);
+        const __m512 t3 = _mm512_unpackhi_ps(f2, f3);
+        // blocks (0, 4, 8, 12), (1, 5, 9, 13), ...
+        const __m512 r0 = _mm512_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m512 r1 = _mm512_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m512 r2 = _mm512_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m512 r3 = _mm512_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        // blocks (0, 4, 1, 5), (2, 6, 3, 7), (8, 12, 9, 13), (10, 14, 11, 15)
+        const __m512 u0 = _mm512_shuffle_f32x4(r0, r1, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m512 u1 = _mm512_shuffle_f32x4(r2, r3, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m512 u2 = _mm512_shuffle_f32x4(r0, r1, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m512 u3 = _mm512_shuffle_f32x4(r2, r3, _MM_SHUFFLE(3, 2, 3, 2));
+        _mm512_storeu_ps(out,
+                         _mm512_shuffle_f32x4(u0, u1, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm512_storeu_ps(out + 16,
+                         _mm512_shuffle_f32x4(u0, u1, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm512_storeu_ps(out + 32,
+                         _mm512_shuffle_f32x4(u2, u3, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm512_storeu_ps(out + 48,
+                         _mm512_shuffle_f32x4(u2, u3, _MM_SHUFFLE(3, 1, 3, 1)));
+      }
+#elif defined(__AVX2__) && !defined(RKCOMMON_NO_SIMD)
+      constexpr int W = 8;
+
+      struct vuint
+      {
+        __m256i v;
+      };
+
+      inline vuint set1(uint32_t a)
+      {
+        return {_mm256_set1_epi32(int(a))};
+      }
+
+      // base, base + 1, ..., base + W - 1
+      inline vuint lanes(uint32_t base)
+      {
+        return {_mm256_add_epi32(_mm256_set1_epi32(int(base)),
+                                 _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))};
+      }
+
+      inline vuint operator^(vuint a, vuint b)
+      {
+        return {_mm256_xor_si256(a.v, b.v)};
+      }
+
+      inline vuint operator^(vuint a, uint32_t b)
+      {
+        return a ^ set1(b);
+      }
+
+      inline void mulhilo(uint32_t m, vuint a, vuint &hi, vuint &lo)
+      {
+        const __m256i vm   = _mm256_set1_epi32(int(m));
+        const __m256i even = _mm256_mul_epu32(a.v, vm);
+        const __m256i odd  = _mm256_mul_epu32(_mm256_srli_epi64(a.v, 32), vm);
+        // (lo0, lo2, hi0, hi2) and (lo1, lo3, hi1, hi3) per 128-bit lane
+        const __m256i e = _mm256_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i o = _mm256_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0));
+        lo.v            = _mm256_unpacklo_epi32(e, o);
+        hi.v            = _mm256_unpackhi_epi32(e, o);
+      }
+
+      inline __m256 toUniform(vuint a)
+      {
+        return _mm256_mul_ps(
+            _mm256_cvtepi32_ps(_mm256_srli_epi32(a.v, 8)),
+            _mm256_set1_ps(1.f / 16777216.f));
+      }
+
+      // the 4 * W floats of blocks (c0[i], c1[i], c2[i], c3[i]) in order
+      inline void storeUniform(
+          float *out, vuint c0, vuint c1, vuint c2, vuint c3)
+      {
+        const __m256 f0 = toUniform(c0);
+        const __m256 f1 = toUniform(c1);
+        const __m256 f2 = toUniform(c2);
+        const __m256 f3 = toUniform(c3);
+        const __m256 t0 = _mm256_unpacklo_ps(f0, f1);
+        const __m256 t1 = _mm256_unpacklo_ps(f2, f3);
+        const __m256 t2 = _mm256_unpackhi_ps(f0, f1);
+        const __m256 t3 = _mm256_unpackhi_ps(f2, f3);
+        // blocks (0, 4), (1, 5), (2, 6) and (3, 7)
+        const __m256 b04 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 b15 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 b26 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 b37 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        _mm256_storeu_ps(out, _mm256_permute2f128_ps(b04, b15, 0x20));
+        _mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(b26, b37, 0x20));
+        _mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(b04, b15, 0x31));
+        _mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(b26, b37, 0x31));
+      }
+#elif defined(RKCOMMON_PACKET_SSE)
+      constexpr int W = 4;
+
+      struct vuint
+      {
+        __m128i v;
+      };
+
+      inline vuint set1(uint32_t a)
+      {
+        return {_mm_set1_epi32(int(a))};
+      }
+
+      // base, base + 1, ..., base + W - 1
+      inline vuint lanes(uint32_t base)
+      {
+        return {_mm_add_epi32(_mm_set1_epi32(int(base)),
+                              _mm_setr_epi32(0, 1, 2, 3))};
+      }
+
+      inline vuint operator^(vuint a, vuint b)
+      {
+        return {_mm_xor_si128(a.v, b.v)};
+      }
+
+      inline vuint operator^(vuint a, uint32_t b)
+      {
+        return a ^ set1(b);
+      }
+
+      inline void mulhilo(uint32_t m, vuint a, vuint &hi, vuint &lo)
+      {
+        const __m128i vm   = _mm_set1_epi32(int(m));
+        const __m128i even = _mm_mul_epu32(a.v, vm);
+        const __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), vm);
+        // (lo0, lo2, hi0, hi2) and (lo1, lo3, hi1, hi3)
+        const __m128i e = _mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i o = _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 2, 0));
+        lo.v            = _mm_unpacklo_epi32(e, o);
+        hi.v            = _mm_unpackhi_epi32(e, o);
+      }
+
+      inline __m128 toUniform(vuint a)
+      {
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(a.v, 8)),
+                          _mm_set1_ps(1.f / 16777216.f));
+      }
+
+      // the 4 * W floats of blocks (c0[i], c1[i], c2[i], c3[i]) in order
+      inline void storeUniform(
+          float *out, vuint c0, vuint c1, vuint c2, vuint c3)
+      {
+        __m128 f0 = toUniform(c0);
+        __m128 f1 = toUniform(c1);
+        __m128 f2 = toUniform(c2);
+        __m128 f3 = toUniform(c3);
+        _MM_TRANSPOSE4_PS(f0, f1, f2, f3);
+        _mm_storeu_ps(out, f0);
+        _mm_storeu_ps(out + 4, f1);
+        _mm_storeu_ps(out + 8, f2);
+        _mm_storeu_ps(out + 12, f3);
+      }
+#else
+      constexpr int W = 4;
+
+      // per-lane fallback with the same interface
+      struct vuint
+      {
+        uint32_t v[W];
+      };
+
+      inline vuint set1(uint32_t a)
+      {
+        vuint r;
+        for (int i = 0; i < W; ++i)
+          r.v[i] = a;
+        return r;
+      }
+
+      inline vuint lanes(uint32_t base)
+      {
+        vuint r;
+        for (int i = 0; i < W; ++i)
+          r.v[i] = base + uint32_t(i);
+        return r;
+      }
+
+      inline vuint operator^(vuint a, vuint b)
+      {
+        for (int i = 0; i < W; ++i)
+          a.v[i] ^= b.v[i];
+        return a;
+      }
+
+      inline vuint operator^(vuint a, uint32_t b)
+      {
+        return a ^ set1(b);
+      }
+
+      inline void mulhilo(uint32_t m, vuint a, vuint &hi, vuint &lo)
+      {
+        for (int i = 0; i < W; ++i) {
+          const uint64_t p = uint64_t(m) * a.v[i];
+          hi.v[i]          = uint32_t(p >> 32);
+          lo.v[i]          = uint32_t(p);
+        }
+      }
+
+      inline void storeUniform(
+          float *out, vuint c0, vuint c1, vuint c2, vuint c3)
+      {
+        for (int i = 0; i < W; ++i) {
+          out[4 * i + 0] = detail::uniformFloat(c0.v[i]);
+          out[4 * i + 1] = detail::uniformFloat(c1.v[i]);
+          out[4 * i + 2] = detail::uniformFloat(c2.v[i]);
+          out[4 * i + 3] = detail::uniformFloat(c3.v[i]);
+        }
+      }
+#endif
+
+      // philox_stream::block() of W consecutive blocks, as uniform floats
+      inline void uniformBlocks(const philox_stream &s,
+                                uint64_t block,
+                                float *out)
+      {
+        vuint c0 = lanes(uint32_t(block));
+        vuint c1 = set1(uint32_t(block >> 32));
+        vuint c2 = set1(s.stream[0]);
+        vuint c3 = set1(s.stream[1]);
+
+        uint32_t k0 = s.key[0], k1 = s.key[1];
+        for (int round = 0; round < 10; ++round) {
+          vuint hi0, lo0, hi1, lo1;
+          mulhilo(detail::PHILOX_M0, c0, hi0, lo0);
+          mulhilo(detail::PHILOX_M1, c2, hi1, lo1);
+          c0 = hi1 ^ c1 ^ k0;
+          c1 = lo1;
+          c2 = hi0 ^ c3 ^ k1;
+          c3 = lo0;
+          k0 += detail::PHILOX_W0;
+          k1 += detail::PHILOX_W1;
+        }
+
+        storeUniform(out, c0, c1, c2, c3);
+      }
+
+    }  // namespace
+
+    // out[i] = s.uniform(first + i), one block() per 4 floats
+    static void uniformScalar(const philox_stream &s,
+                              uint64_t first,
+                              float *out,
+                              size_t n)
+    {
+      size_t i = 0;
+      while (i < n) {
+        const uint64_t index    = first + i;
+        const math::vec4ui bits = s.block(index / 4);
+        for (size_t c = index % 4; c < 4 && i < n; ++c, ++i)
+          out[i] = detail::uniformFloat(bits[c]);
+      }
+    }
+
+    static void uniformRange(const philox_stream &s,
+                             uint64_t first,
+                             float *out,
+                             size_t n)
+    {
+      // up to the first full block
+      size_t i = std::min(n, size_t((4 - first % 4) % 4));
+      uniformScalar(s, first, out, i);
+
+      for (; i + 4 * W <= n; i += 4 * W) {
+        const uint64_t block = (first + i) / 4;
+        // the lanes add to the low counter word only
+        if (uint32_t(block) <= UINT32_MAX - (W - 1))
+          uniformBlocks(s, block, out + i);
+        else
+          uniformScalar(s, first + i, out + i, 4 * W);
+      }
+
+      uniformScalar(s, first + i, out + i, n - i);
+    }
+
+    // entry points, built once per instruction set (see dispatch.h) ///////////
+
+    namespace RKCOMMON_ISA_NAMESPACE {
+
+      void fillUniform(const philox_stream &stream,
+                       uint64_t first,
+                       float *out,
+                       size_t n,
+                       bool parallel)
+      {
+        if (!parallel || n < RANDOM_PARALLEL_THRESHOLD) {
+          uniformRange(stream, first, out, n);
+          return;
+        }
+
+        const size_t chunks = math::divRoundUp(n, RANDOM_CHUNK_SIZE);
+        tasking::parallel_for(chunks, [&](size_t c) {
+          const size_t begin = c * RANDOM_CHUNK_SIZE;
+          uniformRange(stream,
+                       first + begin,
+                       out + begin,
+                       std::min(n - begin, RANDOM_CHUNK_SIZE));
+        });
+      }
+
+    }  // namespace RKCOMMON_ISA_NAMESPACE
+
+#ifdef RKCOMMON_ISA_DISPATCHER
+    // random.h definitions ////////////////////////////////////////////////////
+
+    static_assert(sizeof(math::vec2f) == 2 * sizeof(float),
+                  "vec2f must be tightly packed");
+    static_assert(sizeof(math::vec3f) == 3 * sizeof(float),
+                  "vec3f must be tightly packed");
+
+    using FillUniformFcn = void(
+        const philox_stream &, uint64_t, float *, size_t, bool);
+
+    RKCOMMON_ISA_DECLARE(FillUniformFcn fillUniform)
+
+    void fillUniform(const philox_stream &stream,
+                     uint64_t first,
+                     float *out,
+                     size_t n,
+                     bool parallel)
+    {
+      static FillUniformFcn *const fcn =
+          RKCOMMON_ISA_SELECT(FillUniformFcn, fillUniform);
+      fcn(stream, first, out, n, parallel);
+    }
+
+    void fillUniform(const philox_stream &stream,
+                     uint64_t first,
+                     math::vec2f *out,
+                     size_t n,
+                     bool parallel)
+    {
+      fillUniform(
+          stream, first, reinterpret_cast<float *>(out), 2 * n, parallel);
+    }
+
+    void fillUniform(const philox_stream &stream,
+                     uint64_t first,
+                     math::vec3f *out,
+                     size_t n,
+                     bool parallel)
+    {
+      fillUniform(
+          stream, first, reinterpret_cast<float *>(out), 3 * n, parallel);
+    }
+#endif
+
+  }  // namespace utility
+}  // namespace rkcommon
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include "../common.h"
 #include "../math/vec.h"
 #include "detail/pcg_random.hpp"
@@ -63,6 +64,109 @@ namespace rkcommon {
       T l, u;
     };
 
+    /* Counter-based random numbers (Philox4x32-10, Salmon et al., "Parallel
+       Random Numbers: As Easy as 1, 2, 3", SC'11). A philox_stream holds no
+       state: the i-th number of stream 'stream' under 'seed' is a pure
+       function of (seed, stream, i), so every task of a parallel_for() can
+       use its own stream (e.g. its task index) or its own range of indices
+       of a shared one, and get the same numbers on every run and for any
+       partitioning. Each block index yields four 32-bit values; the
+       uniform() floats are 24-bit and lie in [0, 1). random.ih has the same
+       generator for ISPC. */
+    class philox_stream
+    {
+     public:
+      philox_stream(uint64_t seed = 0, uint64_t stream = 0);
+
+      // the four 32-bit values of block 'index'
+      math::vec4ui block(uint64_t index) const;
+
+      // value 'index % 4' of block 'index / 4', as a float in [0, 1)
+      float uniform(uint64_t index) const;
+
+      uint32_t key[2];
+      uint32_t stream[2];
+    };
+
+    /* out[i] = stream.uniform(first + i), and likewise for the 2n or 3n
+       components of the vec2f/vec3f versions. Computed several blocks at
+       a time with SIMD; with 'parallel' arrays of at least
+       RANDOM_PARALLEL_THRESHOLD floats are split across
+       tasking::parallel_for(), which does not change the results. */
+
+    constexpr size_t RANDOM_PARALLEL_THRESHOLD = 256 * 1024;
+
+    RKCOMMON_INTERFACE void fillUniform(const philox_stream &stream,
+                                        uint64_t first,
+                                        float *out,
+                                        size_t n,
+                                        bool parallel = true);
+
+    RKCOMMON_INTERFACE void fillUniform(const philox_stream &stream,
+                                        uint64_t first,
+                                        math::vec2f *out,
+                                        size_t n,
+                                        bool parallel = true);
+
+    RKCOMMON_INTERFACE void fillUniform(const philox_stream &stream,
+                                        uint64_t first,
+                                        math::vec3f *out,
+                                        size_t n,
+                                        bool parallel = true);
+
+    // Inlined philox_stream definitions //////////////////////////////////////
+
+    namespace detail {
+
+      constexpr uint32_t PHILOX_M0 = 0xD2511F53u;
+      constexpr uint32_t PHILOX_M1 = 0xCD9E8D57u;
+      constexpr uint32_t PHILOX_W0 = 0x9E3779B9u;
+      constexpr uint32_t PHILOX_W1 = 0xBB67AE85u;
+
+      inline void philoxRound(uint32_t c[4], uint32_t k0, uint32_t k1)
+      {
+        const uint64_t p0 = uint64_t(PHILOX_M0) * c[0];
+        const uint64_t p1 = uint64_t(PHILOX_M1) * c[2];
+        const uint32_t c1 = c[1];
+        c[0]              = uint32_t(p1 >> 32) ^ c1 ^ k0;
+        c[1]              = uint32_t(p1);
+        c[2]              = uint32_t(p0 >> 32) ^ c[3] ^ k1;
+        c[3]              = uint32_t(p0);
+      }
+
+      // 24 random bits to a float in [0, 1)
+      inline float uniformFloat(uint32_t bits)
+      {
+        return float(bits >> 8) * (1.f / 16777216.f);
+      }
+
+    }  // namespace detail
+
+    inline philox_stream::philox_stream(uint64_t seed, uint64_t stream)
+        : key{uint32_t(seed), uint32_t(seed >> 32)},
+          stream{uint32_t(stream), uint32_t(stream >> 32)}
+    {
+    }
+
+    inline math::vec4ui philox_stream::block(uint64_t index) const
+    {
+      uint32_t c[4] = {
+          uint32_t(index), uint32_t(index >> 32), stream[0], stream[1]};
+      uint32_t k0 = key[0], k1 = key[1];
+      for (int round = 0; round < 9; ++round) {
+        detail::philoxRound(c, k0, k1);
+        k0 += detail::PHILOX_W0;
+        k1 += detail::PHILOX_W1;
+      }
+      detail::philoxRound(c, k0, k1);
+      return math::vec4ui(c[0], c[1], c[2], c[3]);
+    }
+
+    inline float philox_stream::uniform(uint64_t index) const
+    {
+      return detail::uniformFloat(block(index / 4)[index % 4]);
+    }
+
     inline math::vec3f makeRandomColor(const unsigned int i)
     {
       const unsigned int mx = 13 * 17 * 43;
@@ -2,7 +2,21 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "XML.h"
+#include "../tasking/parallel_for.h"
+// std
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <type_traits>
 
 namespace rkcommon {
   namespace xml {
@@ -43,12 +57,48 @@ namespace rkcommon {
       return getProp(propName, std::string());
     }
 
+    // Parsing ////////////////////////////////////////////////////////////////
+
+    /*! the text to parse; reads past the end return 0 as the old null
+      terminated buffer did, so the text may be a mapped file */
+    struct Cursor
+    {
+      const char *s;
+      const char *end;
+
+      char operator*() const
+      {
+        return s < end ? *s : 0;
+      }
+
+      char operator[](size_t i) const
+      {
+        return size_t(end - s) > i ? s[i] : 0;
+      }
+
+      Cursor &operator++()
+      {
+        ++s;
+        return *this;
+      }
+    };
+
     static bool isWhite(char s)
     {
       return s == ' ' || s == '\t' || s == '\n' || s == '\r';
     }
 
-    static void expect(char *&s, const char w)
+    static bool isAlpha(char s)
+    {
+      return (s >= 'a' && s <= 'z') || (s >= 'A' && s <= 'Z');
+    }
+
+    static bool isDigit(char s)
+    {
+      return s >= '0' && s <= '9';
+    }
+
+    static void expect(const Cursor &s, const char w)
     {
       if (*s != w) {
         std::stringstream err;
@@ -58,7 +108,7 @@ namespace rkcommon {
       }
     }
 
-    static void expect(char *&s, const char w0, const char w1)
+    static void expect(const Cursor &s, const char w0, const char w1)
     {
       if (*s != w0 && *s != w1) {
         std::stringstream err;
@@ -68,104 +118,82 @@ namespace rkcommon {
       }
     }
 
-    static void consume(char *&s, const char w)
+    static void consume(Cursor &s, const char w)
     {
       expect(s, w);
       ++s;
     }
 
-    static void consumeComment(char *&s)
+    static void consumeComment(Cursor &s)
     {
       consume(s, '<');
       consume(s, '!');
-      while (!((s[0] == 0) || (s[0] == '-' && s[1] == '-' && s[2] == '>')))
+      while (!((*s == 0) || (s[0] == '-' && s[1] == '-' && s[2] == '>')))
         ++s;
       consume(s, '-');
       consume(s, '-');
       consume(s, '>');
     }
 
-    static void consume(char *&s, const char *word)
+    static void consume(Cursor &s, const char *word)
     {
       const char *in = word;
       while (*word) {
-        try {
-          consume(s, *word);
-          ++word;
-        } catch (...) {
+        if (*s != *word) {
           std::stringstream err;
           err << "error reading XML file: expecting '" << in
               << "', but could not find it";
           throw std::runtime_error(err.str());
         }
+        ++s;
+        ++word;
       }
     }
 
-    static std::string makeString(const char *begin, const char *end)
+    static StringView makeView(const char *begin, const char *end)
     {
       if (!begin || !end || begin > end)
-        throw std::runtime_error("invalid substring in osp::xml::makeString");
-      if (begin == end)
-        return "";
-
-      char *mem = new char[end - begin + 1];
-      memcpy(mem, begin, end - begin);
-      mem[end - begin] = 0;
-
-      std::string s = mem;
-      delete[] mem;
-      return s;
+        throw std::runtime_error("invalid substring in osp::xml::makeView");
+      return StringView(begin, end - begin);
     }
 
-    static void parseString(char *&s, std::string &value)
+    static void parseString(Cursor &s, StringView &value)
     {
-      if (*s == '"') {
-        consume(s, '"');
-        char *begin = s;
-        while (*s != '"') {
-          if (*s == '\\')
-            ++s;
+      const char quote = *s == '"' ? '"' : '\'';
+      consume(s, quote);
+      const char *begin = s.s;
+      while (*s != quote) {
+        if (*s == 0)
+          throw std::runtime_error("XML error: unterminated string");
+        if (*s == '\\')
           ++s;
-        }
-        char *end = s;
-        value     = makeString(begin, end);
-        consume(s, '"');
-      } else {
-        consume(s, '\'');
-        char *begin = s;
-        while (*s != '\'') {
-          if (*s == '\\')
-            ++s;
-          ++s;
-        }
-        char *end = s;
-        value     = makeString(begin, end);
-        consume(s, '\'');
+        ++s;
       }
+      value = makeView(begin, s.s);
+      consume(s, quote);
     }
 
-    static bool parseIdentifier(char *&s, std::string &identifier)
+    static bool parseIdentifier(Cursor &s, StringView &identifier)
     {
-      if (isalpha(*s) || *s == '_') {
-        char *begin = s;
+      if (isAlpha(*s) || *s == '_') {
+        const char *begin = s.s;
         ++s;
-        while (isalpha(*s) || isdigit(*s) || *s == '_' || *s == '.') {
+        while (isAlpha(*s) || isDigit(*s) || *s == '_' || *s == '.') {
           ++s;
         }
-        char *end  = s;
-        identifier = makeString(begin, end);
+        identifier = makeView(begin, s.s);
         return true;
       }
       return false;
     }
 
-    static void skipWhites(char *&s)
+    static void skipWhites(Cursor &s)
     {
       while (isWhite(*s))
         ++s;
     }
 
-    static bool parseProp(char *&s, std::string &name, std::string &value)
+    static bool parseProp(Cursor &s, StringView &name, StringView &value)
     {
       if (!parseIdentifier(s, name))
         return false;
@@ -177,85 +205,195 @@ namespace rkcommon {
       return true;
     }
 
-    static bool skipComment(char *&s)
+    static bool skipComment(Cursor &s)
     {
-      if (*s == '<' && s[1] == '!') {
+      if (s[0] == '<' && s[1] == '!') {
         consumeComment(s);
         return true;
       }
       return false;
     }
 
-    static Node parseNode(char *&s)
+    /*! a character after an odd number of backslashes is escaped */
+    static bool isEscaped(const char *begin, const char *c)
+    {
+      const char *b = c;
+      while (b > begin && b[-1] == '\\')
+        --b;
+      return (c - b) % 2 == 1;
+    }
+
+    /*! skips the rest of a tag after its name, over quoted property values;
+      returns if the tag closed itself with '/>' */
+    static bool skipTag(Cursor &s)
+    {
+      const char *p = s.s;
+      char last     = 0;
+      while (p < s.end && *p != '>') {
+        if (*p == '"' || *p == '\'') {
+          const char quote = *p;
+          const char *q    = p;
+          do {
+            q = static_cast<const char *>(
+                std::memchr(q + 1, quote, s.end - q - 1));
+            if (!q)
+              throw std::runtime_error("XML error: unterminated string");
+          } while (isEscaped(p + 1, q));
+          p    = q + 1;
+          last = 0;
+        } else {
+          last = *p++;
+        }
+      }
+      if (p == s.end)
+        throw std::runtime_error("XML error: unterminated tag");
+      s.s = p + 1;
+      return last == '/';
+    }
+
+    static void warnPartialFile()
+    {
+      std::cout << "#osp:xml: warning: xml file ended with still-open"
+                   " nodes (this typically indicates a partial xml file)"
+                << std::endl;
+    }
+
+    /*! skips the rest of a node after its name, including its children,
+      only looking for the tags; the end tags are not matched against the
+      start tags. Returns false if the text ended first */
+    static bool skipNode(Cursor &s)
+    {
+      if (skipTag(s))
+        return true;
+
+      size_t depth = 1;
+      while (depth > 0) {
+        const void *next = std::memchr(s.s, '<', s.end - s.s);
+        if (!next) {
+          s.s = s.end;
+          return false;
+        }
+        s.s = static_cast<const char *>(next);
+
+        if (s[1] == '!') {
+          consumeComment(s);
+        } else if (s[1] == '/') {
+          consume(s, "</");
+          skipTag(s);
+          --depth;
+        } else {
+          ++s;
+          if (!skipTag(s))
+            ++depth;
+        }
+      }
+      return true;
+    }
+
+    /*! parses a node into 'builder', which gets the calls openNode(name),
+      then addProp(name, value) for each property, endProps(),
+      setContent(content) and the children's calls, and closeNode(name).
+      If openNode() returns false, the node is skipped up to closeNode() */
+    template <typename BUILDER>
+    static void parseNode(Cursor &s, BUILDER &builder);
+
+    /*! the first part of parseNode(), returns false if the node has been
+      closed already */
+    template <typename BUILDER>
+    static bool parseStartTag(Cursor &s,
+                              BUILDER &builder,
+                              StringView &nodeName)
     {
       consume(s, '<');
-      Node node;
 
-      if (!parseIdentifier(s, node.name))
+      if (!parseIdentifier(s, nodeName))
         throw std::runtime_error("XML error: could not parse node name");
+      if (!builder.openNode(nodeName)) {
+        if (!skipNode(s))
+          warnPartialFile();
+        builder.closeNode(nodeName);
+        return false;
+      }
 
       skipWhites(s);
 
-      std::string name, value;
+      StringView name, value;
       while (parseProp(s, name, value)) {
-        node.properties[name] = value;
+        builder.addProp(name, value);
         skipWhites(s);
       }
+      builder.endProps();
 
       if (*s == '/') {
         consume(s, "/>");
-        return node;
+        builder.closeNode(nodeName);
+        return false;
       }
 
       consume(s, ">");
+      return true;
+    }
 
+    /*! the rest of parseNode(), after the start tag */
+    template <typename BUILDER>
+    static void parseBody(Cursor &s, BUILDER &builder, StringView nodeName)
+    {
+      bool hasContent = false;
       while (1) {
         skipWhites(s);
         if (skipComment(s))
           continue;
-        if (*s == '<' && s[1] == '/') {
+        if (s[0] == '<' && s[1] == '/') {
           consume(s, "</");
-          std::string nodeName;
-          parseIdentifier(s, nodeName);
-          if (nodeName != node.name) {
-            throw std::runtime_error("invalid XML node - started with'<" +
-                                     node.name + "...'>, but ended with '</" +
-                                     nodeName + ">");
+          StringView endName;
+          parseIdentifier(s, endName);
+          if (endName != nodeName) {
+            throw std::runtime_error("invalid XML node - started with'<"
+                                     + nodeName.str()
+                                     + "...'>, but ended with '</"
+                                     + endName.str() + ">");
           }
           consume(s, ">");
           break;
           // either end of current node
         } else if (*s == '<') {
           // child node
-          node.child.push_back(parseNode(s));
+          parseNode(s, builder);
         } else if (*s == 0) {
-          std::cout << "#osp:xml: warning: xml file ended with still-open"
-                       " nodes (this typically indicates a partial xml file)"
-                    << std::endl;
-          return node;
+          warnPartialFile();
+          break;
         } else {
-          if (node.content != "") {
+          if (hasContent) {
             throw std::runtime_error(
                 "invalid XML node - two different"
                 " contents!?");
           }
           // content
-          char *begin = s;
+          const char *begin = s.s;
           while (*s != '<' && *s != 0)
             ++s;
-          char *end = s;
-          while (isspace(end[-1]))
+          const char *end = s.s;
+          while (isspace((unsigned char)end[-1]))
             --end;
-          node.content = makeString(begin, end);
+          builder.setContent(makeView(begin, end));
+          hasContent = true;
         }
       }
-      return node;
+      builder.closeNode(nodeName);
+    }
+
+    template <typename BUILDER>
+    static void parseNode(Cursor &s, BUILDER &builder)
+    {
+      StringView nodeName;
+      if (parseStartTag(s, builder, nodeName))
+        parseBody(s, builder, nodeName);
     }
 
-    static bool parseHeader(char *&s)
+    static bool parseHeader(Cursor &s)
     {
       consume(s, "<?xml");
-      if (*s == '?' && s[1] == '>') {
+      if (s[0] == '?' && s[1] == '>') {
         consume(s, "?>");
         return true;
       }
@@ -265,7 +403,7 @@ namespace rkcommon {
 
       skipWhites(s);
 
-      std::string name, value;
+      StringView name, value;
       while (parseProp(s, name, value)) {
         // ignore header prop
         skipWhites(s);
@@ -275,7 +413,134 @@ namespace rkcommon {
       return true;
     }
 
-    void parseXML(XMLDoc &doc, char *s)
+    /*! parses the nodes and comments up to the end of the text */
+    template <typename BUILDER>
+    static void parseNodes(Cursor s, BUILDER &builder)
+    {
+      while (1) {
+        skipWhites(s);
+        if (*s == 0)
+          break;
+        if (!skipComment(s))
+          parseNode(s, builder);
+      }
+    }
+
+    // parts of a node's children parsed in parallel have at least this size
+    static constexpr size_t minPartSize = 256 << 10;
+
+    /*! finds the children of the node starting at 's' by only scanning for
+      tags, and splits them into parts of the text to parse in parallel; the
+      node's end tag starts at 'end'. Returns false if the node has content
+      other than its children, is malformed or is too small to split */
+    static bool splitChildren(Cursor s,
+                              std::vector<Cursor> &parts,
+                              const char *&end)
+    {
+      try {
+        ++s;
+        StringView name;
+        if (!parseIdentifier(s, name) || skipTag(s))
+          return false;
+
+        std::vector<const char *> starts;
+        while (1) {
+          const void *next = std::memchr(s.s, '<', s.end - s.s);
+          if (!next)
+            return false;
+          for (const char *c = s.s; c != next; ++c)
+            if (!isWhite(*c))
+              return false;
+          s.s = static_cast<const char *>(next);
+
+          if (s[1] == '!') {
+            consumeComment(s);
+          } else if (s[1] == '/') {
+            end = s.s;
+            break;
+          } else {
+            starts.push_back(s.s);
+            ++s;
+            if (!parseIdentifier(s, name) || !skipNode(s))
+              return false;
+          }
+        }
+        if (starts.empty() || size_t(end - starts[0]) < 2 * minPartSize)
+          return false;
+
+        const size_t partSize =
+            std::max(minPartSize, size_t(end - starts[0]) / 256);
+        const char *begin = starts[0];
+        for (const char *start : starts) {
+          if (size_t(start - begin) >= partSize) {
+            parts.push_back(Cursor{begin, start});
+            begin = start;
+          }
+        }
+        parts.push_back(Cursor{begin, end});
+        return parts.size() > 1;
+      } catch (const std::runtime_error &) {
+        // the sequential parser reports the error
+        return false;
+      }
+    }
+
+    /*! parseNode(), parsing the children of the node in parallel. The
+      builder needs a default constructible 'Part' type to parse a part of
+      the children into, and adopt(Part &) to append the part's nodes */
+    template <typename BUILDER>
+    static void parseNodeParallel(Cursor &s, BUILDER &builder)
+    {
+      std::vector<Cursor> parts;
+      const char *end = nullptr;
+      if (!splitChildren(s, parts, end)) {
+        parseNode(s, builder);
+        return;
+      }
+
+      StringView nodeName;
+      if (!parseStartTag(s, builder, nodeName))
+        return;
+
+      using Part = typename BUILDER::Part;
+      std::vector<std::unique_ptr<Part>> results(parts.size());
+      std::vector<std::exception_ptr> errors(parts.size());
+      tasking::parallel_for(parts.size(), [&](size_t i) {
+        try {
+          results[i].reset(new Part);
+          parseNodes(parts[i], *results[i]);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
+
+      // in document order, as if parsed sequentially
+      for (size_t i = 0; i < parts.size(); ++i) {
+        if (errors[i])
+          std::rethrow_exception(errors[i]);
+        builder.adopt(*results[i]);
+      }
+
+      s.s = end;
+      parseBody(s, builder, nodeName);
+    }
+
+    template <typename BUILDER>
+    static void parseTopNode(Cursor &s, BUILDER &builder, std::true_type)
+    {
+      parseNodeParallel(s, builder);
+    }
+
+    template <typename BUILDER>
+    static void parseTopNode(Cursor &s, BUILDER &builder, std::false_type)
+    {
+      parseNode(s, builder);
+    }
+
+    /*! parses a document into 'builder'; with PARALLEL, the children of
+      the top level nodes are parsed in parallel */
+    template <bool PARALLEL, typename BUILDER>
+    static void parseDocument(Cursor s, BUILDER &builder)
     {
       if (s[0] == '<' && s[1] == '?') {
         if (!parseHeader(s))
@@ -288,7 +553,7 @@ namespace rkcommon {
           continue;
         }
 
-        doc.child.push_back(parseNode(s));
+        parseTopNode(s, builder, std::integral_constant<bool, PARALLEL>());
         skipWhites(s);
       }
 
@@ -296,47 +561,202 @@ namespace rkcommon {
         throw std::runtime_error("un-parsed junk at end of file");
     }
 
-    void Writer::spaces()
+    /*! builds a tree of Nodes, copying the strings */
+    struct NodeBuilder
     {
-      for (size_t i = 0; i < state.size(); i++)
-        fprintf(xml, "  ");
-    }
+      using Part = NodeBuilder;
 
-    void Writer::writeProperty(const std::string &name,
-                               const std::string &value)
+      NodeBuilder() : root(local) {}
+      explicit NodeBuilder(Node &root) : root(root) {}
+
+      bool openNode(StringView name)
+      {
+        Node &parent = open.empty() ? root : *open.back();
+        parent.child.emplace_back();
+        open.push_back(&parent.child.back());
+        open.back()->name = name.str();
+        return true;
+      }
+
+      void addProp(StringView name, StringView value)
+      {
+        open.back()->properties[name.str()] = value.str();
+      }
+
+      void endProps() {}
+
+      void setContent(StringView content)
+      {
+        open.back()->content = content.str();
+      }
+
+      void closeNode(StringView)
+      {
+        open.pop_back();
+      }
+
+      void adopt(NodeBuilder &part)
+      {
+        Node &parent = open.empty() ? root : *open.back();
+        for (auto &node : part.root.child)
+          parent.child.push_back(std::move(node));
+      }
+
+     private:
+      Node local;
+      Node &root;
+      // a node's children only grow while it's the innermost open node
+      std::vector<Node *> open;
+    };
+
+    /*! memory for the nodes and properties of a MappedXMLDoc, allocated in
+      blocks which are only freed with the document */
+    struct NodeArena
     {
-      assert(xml);
-      assert(!state.empty());
-      State *s = state.top();
-      (void)s;
-      assert(s);
-      assert(!s->hasContent);  // content may not be written before properties
-      fprintf(xml, " %s=\"%s\"", name.c_str(), value.c_str());
-    }
+      std::vector<std::unique_ptr<char[]>> blocks;
+      size_t used{0};
+      size_t capacity{0};
 
-    void Writer::openNode(const std::string &type)
+      template <typename T>
+      MappedRange<T> store(const T *items, size_t count)
+      {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "the arena doesn't call destructors");
+
+        MappedRange<T> range;
+        if (count == 0)
+          return range;
+
+        const size_t align = alignof(std::max_align_t);
+        const size_t bytes = (count * sizeof(T) + align - 1) / align * align;
+        if (blocks.empty() || used + bytes > capacity) {
+          // blocks grow with the document, so there are few of them
+          capacity =
+              std::max(bytes, std::max<size_t>(64 << 10, capacity * 2));
+          blocks.emplace_back(new char[capacity]);
+          used = 0;
+        }
+
+        T *first = reinterpret_cast<T *>(blocks.back().get() + used);
+        std::uninitialized_copy(items, items + count, first);
+        used += bytes;
+
+        range.first = first;
+        range.count = count;
+        return range;
+      }
+
+      /*! takes over the blocks of 'other', keeping the current block last */
+      void adopt(NodeArena &other)
+      {
+        const auto pos = blocks.empty() ? blocks.end() : blocks.end() - 1;
+        blocks.insert(pos,
+                      std::make_move_iterator(other.blocks.begin()),
+                      std::make_move_iterator(other.blocks.end()));
+        if (blocks.size() == other.blocks.size()) {
+          used     = other.used;
+          capacity = other.capacity;
+        }
+        other.blocks.clear();
+      }
+    };
+
+    /*! builds a tree of MappedNodes with views into the text, gathering
+      the properties and children of the open nodes on stacks until they
+      are complete, then storing them in its arena */
+    struct MappedBuilder
     {
-      assert(xml);
-      spaces();
-      fprintf(xml, "<%s", type.c_str());
-      State *s = new State;
-      s->type  = type;
-      state.push(s);
-    }
+      using Part = MappedBuilder;
 
-    void Writer::closeNode()
+      bool openNode(StringView name)
+      {
+        MappedNode node;
+        node.name = name;
+        open.push_back(node);
+        firstChild.push_back(children.size());
+        return true;
+      }
+
+      void addProp(StringView name, StringView value)
+      {
+        props.push_back({name, value});
+      }
+
+      void endProps()
+      {
+        open.back().properties = arena.store(props.data(), props.size());
+        props.clear();
+      }
+
+      void setContent(StringView content)
+      {
+        open.back().content = content;
+      }
+
+      void closeNode(StringView)
+      {
+        const size_t first = firstChild.back();
+        MappedNode node    = open.back();
+        node.child =
+            arena.store(children.data() + first, children.size() - first);
+        children.resize(first);
+        open.pop_back();
+        firstChild.pop_back();
+        children.push_back(node);
+      }
+
+      void adopt(MappedBuilder &part)
+      {
+        children.insert(
+            children.end(), part.children.begin(), part.children.end());
+        arena.adopt(part.arena);
+      }
+
+      /*! the top level nodes become the children of 'doc', which takes
+        over the arena */
+      void finish(MappedXMLDoc &doc)
+      {
+        doc.child = arena.store(children.data(), children.size());
+        doc.arena = std::move(arena.blocks);
+      }
+
+     private:
+      NodeArena arena;
+      std::vector<MappedNode> open;
+      std::vector<MappedProperty> props;
+      // the completed children of all open nodes, and where each node's own
+      // children start
+      std::vector<MappedNode> children;
+      std::vector<size_t> firstChild;
+    };
+
+    /*! forwards the events to an XMLHandler, keeping nothing */
+    struct HandlerBuilder
     {
-      assert(xml);
-      assert(!state.empty());
-      State *s = state.top();
-      assert(s);
-      if (s->hasContent)
-        fprintf(xml, "</%s>", s->type.c_str());
-      else
-        fprintf(xml, "/>\n");
-      delete s;
-      state.pop();
-    }
+      XMLHandler &handler;
+
+      bool openNode(StringView name)
+      {
+        return handler.onStartNode(name);
+      }
+
+      void addProp(StringView name, StringView value)
+      {
+        handler.onProperty(name, value);
+      }
+
+      void endProps() {}
+
+      void setContent(StringView content)
+      {
+        handler.onContent(content);
+      }
+
+      void closeNode(StringView name)
+      {
+        handler.onEndNode(name);
+      }
+    };
 
     XMLDoc readXML(const std::string &fn)
     {
@@ -360,7 +780,9 @@ namespace rkcommon {
         (void)rc;
         XMLDoc doc;
         doc.fileName = fn;
-        parseXML(doc, mem.data());
+        NodeBuilder builder(doc);
+        parseDocument<true>(Cursor{mem.data(), mem.data() + numBytes},
+                            builder);
         fclose(file);
         return doc;
       } catch (const std::runtime_error &e) {
@@ -369,19 +791,350 @@ namespace rkcommon {
       }
     }
 
-    Writer::Writer(FILE *xml, FILE *bin) : xml(xml), bin(bin) {}
+    void parseXML(const char *text, size_t size, XMLHandler &handler)
+    {
+      HandlerBuilder builder{handler};
+      parseDocument<false>(Cursor{text, text + size}, builder);
+    }
+
+    void parseXML(const std::string &fn, XMLHandler &handler)
+    {
+      utility::MappedFile file(fn);
+      file.advise(utility::MapAccess::SEQUENTIAL);
+      parseXML(static_cast<const char *>(file.data()), file.size(), handler);
+    }
+
+    // MappedNode / MappedXMLDoc //
+
+    bool MappedNode::hasProp(StringView propName) const
+    {
+      for (const auto &p : properties)
+        if (p.name == propName)
+          return true;
+      return false;
+    }
+
+    StringView MappedNode::getProp(StringView propName,
+                                   StringView fallbackValue) const
+    {
+      for (const auto &p : properties)
+        if (p.name == propName)
+          return p.value;
+      return fallbackValue;
+    }
+
+    MappedXMLDoc::MappedXMLDoc(const std::string &fn)
+        : fileName(fn), file(new utility::MappedFile(fn))
+    {
+      file->advise(utility::MapAccess::SEQUENTIAL);
+    }
+
+    MappedXMLDoc::~MappedXMLDoc() = default;
+
+    std::unique_ptr<MappedXMLDoc> mapXML(const std::string &fn)
+    {
+      std::unique_ptr<MappedXMLDoc> doc(new MappedXMLDoc(fn));
+      const char *text = static_cast<const char *>(doc->file->data());
+
+      MappedBuilder builder;
+      parseDocument<true>(Cursor{text, text + doc->file->size()}, builder);
+      builder.finish(*doc);
+      return doc;
+    }
+
+    // Writer //
+
+    /*! writes the blobs of the side-file in the order they come, on the
+      calling thread or a background thread */
+    struct Writer::DataWriter
+    {
+      DataWriter(FILE *bin, bool async) : bin(bin), async(async) {}
+
+      ~DataWriter()
+      {
+        submitPending();
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          stop = true;
+        }
+        queued.notify_one();
+        if (thread.joinable())
+          thread.join();
+      }
+
+      void copy(const void *ptr, size_t size)
+      {
+        if (size < coalesceSize) {
+          const char *bytes = static_cast<const char *>(ptr);
+          pending.insert(pending.end(), bytes, bytes + size);
+          if (pending.size() >= coalesceSize)
+            submitPending();
+          return;
+        }
+
+        submitPending();
+        if (async) {
+          const char *bytes = static_cast<const char *>(ptr);
+          submit(Job{nullptr, 0, std::vector<char>(bytes, bytes + size)});
+        } else {
+          writeBytes(ptr, size);
+        }
+      }
+
+      void share(std::shared_ptr<const void> data, size_t size)
+      {
+        if (size < coalesceSize) {
+          copy(data.get(), size);
+          return;
+        }
+        submitPending();
+        if (async)
+          submit(Job{std::move(data), size, {}});
+        else
+          writeBytes(data.get(), size);
+      }
+
+      void pad(size_t size)
+      {
+        pending.resize(pending.size() + size, 0);
+      }
+
+      void flush()
+      {
+        submitPending();
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          done.wait(lock, [&]() { return jobs.empty() && !writing; });
+        }
+        if (bin && fflush(bin) != 0)
+          failed = true;
+        if (failed)
+          throw std::runtime_error("xml::Writer: could not write binary data");
+      }
+
+     private:
+      // blobs below this size are gathered into writes of about this size
+      static constexpr size_t coalesceSize = 1 << 20;
+      // copies queued for the background thread, before writeData() waits
+      static constexpr size_t maxQueuedCopies = 64 << 20;
+
+      struct Job
+      {
+        std::shared_ptr<const void> data;
+        size_t size;
+        std::vector<char> bytes;
+      };
+
+      void writeBytes(const void *ptr, size_t size)
+      {
+        if (!bin || fwrite(ptr, 1, size, bin) != size)
+          failed = true;
+      }
+
+      void submitPending()
+      {
+        if (pending.empty())
+          return;
+        std::vector<char> bytes;
+        bytes.swap(pending);
+        if (async)
+          submit(Job{nullptr, 0, std::move(bytes)});
+        else
+          writeBytes(bytes.data(), bytes.size());
+      }
+
+      void submit(Job job)
+      {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          done.wait(lock, [&]() { return queuedCopies < maxQueuedCopies; });
+          queuedCopies += job.bytes.size();
+          jobs.push_back(std::move(job));
+          if (!thread.joinable())
+            thread = std::thread([this]() { run(); });
+        }
+        queued.notify_one();
+      }
+
+      void run()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+          queued.wait(lock, [&]() { return stop || !jobs.empty(); });
+          if (jobs.empty())
+            return;
+
+          Job job = std::move(jobs.front());
+          jobs.pop_front();
+          writing = true;
+          lock.unlock();
+
+          if (job.data)
+            writeBytes(job.data.get(), job.size);
+          else
+            writeBytes(job.bytes.data(), job.bytes.size());
+
+          lock.lock();
+          writing = false;
+          queuedCopies -= job.bytes.size();
+          done.notify_all();
+        }
+      }
+
+      FILE *bin;
+      bool async;
+      std::atomic<bool> failed{false};
+
+      std::vector<char> pending;
+
+      std::mutex mutex;
+      std::condition_variable queued;
+      std::condition_variable done;
+      std::deque<Job> jobs;
+      size_t queuedCopies{0};
+      bool writing{false};
+      bool stop{false};
+      std::thread thread;
+    };
+
+    // the XML text is written in blocks of about this size
+    static constexpr size_t textBlockSize = 1 << 20;
+
+    Writer::Writer(FILE *xml, FILE *bin, bool asyncData)
+        : xml(xml), bin(bin), data(new DataWriter(bin, asyncData))
+    {
+      if (bin) {
+        const long pos = ftell(bin);
+        binOffset      = pos > 0 ? size_t(pos) : 0;
+      }
+    }
+
+    Writer::~Writer()
+    {
+      // errors are only reported by flush()
+      flushText();
+    }
+
+    void Writer::flushText()
+    {
+      if (!text.empty() && xml)
+        fwrite(text.data(), 1, text.size(), xml);
+      text.clear();
+    }
+
+    void Writer::flush()
+    {
+      assert(xml);
+      const bool written =
+          fwrite(text.data(), 1, text.size(), xml) == text.size();
+      text.clear();
+      if (!written || fflush(xml) != 0)
+        throw std::runtime_error("xml::Writer: could not write XML");
+      data->flush();
+    }
+
+    void Writer::spaces()
+    {
+      text.append(2 * state.size(), ' ');
+    }
+
+    /*! ends the start tag of the open node before its first child */
+    void Writer::beginContent()
+    {
+      if (state.empty() || state.back().hasContent)
+        return;
+      text += ">\n";
+      state.back().hasContent = true;
+    }
 
     /*! write document header, may only be called once */
     void Writer::writeHeader(const std::string &version)
     {
       assert(xml);
-      fprintf(xml, "<?xml version=\"%s\"?>\n", version.c_str());
+      text += "<?xml version=\"" + version + "\"?>\n";
     }
 
     /*! write document footer. may only be called once, at end of write */
     void Writer::writeFooter()
     {
       assert(xml);
+      assert(state.empty());
+      flush();
+    }
+
+    void Writer::openNode(const std::string &type)
+    {
+      assert(xml);
+      beginContent();
+      spaces();
+      text += '<';
+      text += type;
+      state.push_back(State());
+      state.back().type = type;
+    }
+
+    void Writer::writeProperty(const std::string &name,
+                               const std::string &value)
+    {
+      assert(xml);
+      assert(!state.empty());
+      // content may not be written before properties
+      assert(!state.back().hasContent);
+      text += ' ';
+      text += name;
+      text += "=\"";
+      text += value;
+      text += '"';
+    }
+
+    void Writer::writeContent(const std::string &name,
+                              const std::string &value)
+    {
+      assert(xml);
+      beginContent();
+      spaces();
+      text += '<' + name + '>' + value + "</" + name + ">\n";
+    }
+
+    void Writer::closeNode()
+    {
+      assert(xml);
+      assert(!state.empty());
+      const State s = std::move(state.back());
+      state.pop_back();
+      if (s.hasContent) {
+        spaces();
+        text += "</" + s.type + ">\n";
+      } else {
+        text += "/>\n";
+      }
+      if (text.size() >= textBlockSize)
+        flushText();
+    }
+
+    void Writer::alignData(size_t alignment)
+    {
+      const size_t padding = (alignment - binOffset % alignment) % alignment;
+      data->pad(padding);
+      binOffset += padding;
+    }
+
+    size_t Writer::writeData(const void *ptr, size_t size)
+    {
+      assert(bin);
+      const size_t offset = binOffset;
+      data->copy(ptr, size);
+      binOffset += size;
+      return offset;
+    }
+
+    size_t Writer::writeData(std::shared_ptr<const void> shared, size_t size)
+    {
+      assert(bin);
+      const size_t offset = binOffset;
+      data->share(std::move(shared), size);
+      binOffset += size;
+      return offset;
     }
 
   }  // namespace xml
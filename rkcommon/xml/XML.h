@@ -7,11 +7,13 @@
 #include "../common.h"
 #include "../math/vec.h"
 #include "../os/FileName.h"
+#include "../utility/AbstractArray.h"
+#include "../utility/MappedArray.h"
+#include "../utility/StringView.h"
 
 // stl
 #include <map>
 #include <memory>
-#include <stack>
 #include <vector>
 
 namespace rkcommon {
@@ -73,10 +75,163 @@ namespace rkcommon {
       exception */
     RKCOMMON_INTERFACE XMLDoc readXML(const std::string &fn);
 
-    /*! helper class for writing sg nodes in XML format */
-    struct Writer
+    // Zero-copy parsing //////////////////////////////////////////////////////
+
+    using utility::StringView;
+
+    /*! a contiguous range of nodes or properties of a mapped document */
+    template <typename T>
+    struct MappedRange
+    {
+      const T *first{nullptr};
+      size_t count{0};
+
+      const T *begin() const
+      {
+        return first;
+      }
+      const T *end() const
+      {
+        return first + count;
+      }
+      size_t size() const
+      {
+        return count;
+      }
+      bool empty() const
+      {
+        return count == 0;
+      }
+      const T &operator[](size_t i) const
+      {
+        return first[i];
+      }
+    };
+
+    struct MappedProperty
+    {
+      StringView name;
+      StringView value;
+    };
+
+    /*! a XML node of a MappedXMLDoc, with the same structure as Node: the
+      strings are views into the mapped file, and the properties and
+      children are arrays in the arena of the document */
+    struct RKCOMMON_INTERFACE MappedNode
+    {
+      bool hasProp(StringView name) const;
+
+      /*! return value of property with given name if present, else return
+       * 'fallbackValue' */
+      StringView getProp(StringView name,
+                         StringView fallbackValue = StringView()) const;
+
+      StringView name;
+      StringView content;
+      MappedRange<MappedProperty> properties;
+      MappedRange<MappedNode> child;
+    };
+
+    /*! an entire xml document parsed in place: the document owns the read
+      only mapping of the file and the arena holding its nodes, which only
+      live as long as the document. Opening a file maps it without reading
+      it; parsing then touches every page once, in order. */
+    struct RKCOMMON_INTERFACE MappedXMLDoc : public MappedNode
+    {
+      MappedXMLDoc(const MappedXMLDoc &) = delete;
+      MappedXMLDoc &operator=(const MappedXMLDoc &) = delete;
+      ~MappedXMLDoc();
+
+      FileName fileName;
+
+     private:
+      friend RKCOMMON_INTERFACE std::unique_ptr<MappedXMLDoc> mapXML(
+          const std::string &fn);
+      friend struct MappedBuilder;
+
+      explicit MappedXMLDoc(const std::string &fn);
+
+      std::unique_ptr<utility::MappedFile> file;
+      std::vector<std::unique_ptr<char[]>> arena;
+    };
+
+    /*! parse an XML file in place, like readXML(), without copying any of
+      its strings. Throws a std::runtime_error if the file can't be mapped
+      or parsed */
+    RKCOMMON_INTERFACE std::unique_ptr<MappedXMLDoc> mapXML(
+        const std::string &fn);
+
+    // Streaming //////////////////////////////////////////////////////////////
+
+    /*! receives the nodes of a document from parseXML() as they are parsed,
+      in document order. The strings are views into the text, valid until
+      parseXML() returns */
+    struct RKCOMMON_INTERFACE XMLHandler
+    {
+      virtual ~XMLHandler() = default;
+
+      /*! return false to skip the node: its properties, content and
+        children are then only scanned for the end of the node, and the
+        next event is its onEndNode() */
+      virtual bool onStartNode(StringView name)
+      {
+        (void)name;
+        return true;
+      }
+
+      virtual void onProperty(StringView name, StringView value)
+      {
+        (void)name;
+        (void)value;
+      }
+
+      virtual void onContent(StringView content)
+      {
+        (void)content;
+      }
+
+      virtual void onEndNode(StringView name)
+      {
+        (void)name;
+      }
+    };
+
+    /*! parse an XML file into 'handler' without building a tree. The file
+      is mapped and read once in order, so the memory used is bounded by
+      the nesting depth of the nodes. Throws a std::runtime_error on errors,
+      which may come after some of the events */
+    RKCOMMON_INTERFACE void parseXML(const std::string &fn,
+                                     XMLHandler &handler);
+
+    /*! parse the XML text of 'size' characters into 'handler' */
+    RKCOMMON_INTERFACE void parseXML(const char *text,
+                                     size_t size,
+                                     XMLHandler &handler);
+
+    /*! map 'count' items of type T written through Writer::writeData() at
+      byte 'offset' of the binary side-file 'binFileName', without reading
+      them in */
+    template <typename T>
+    inline std::shared_ptr<utility::MappedArray<const T>> mapData(
+        const std::string &binFileName, size_t offset, size_t count)
     {
-      Writer(FILE *xml, FILE *bin);
+      return std::make_shared<utility::MappedArray<const T>>(
+          binFileName, utility::MapMode::READ_ONLY, offset, count);
+    }
+
+    /*! helper class for writing sg nodes in XML format. The XML text is
+      gathered in a buffer and written in large blocks. Binary data goes to
+      the side-file at offsets assigned when it is queued; with 'asyncData'
+      a background thread writes it, so writeData() doesn't wait for the
+      disk. Small blobs are coalesced into larger writes. Write errors
+      throw a std::runtime_error from flush() or writeFooter() */
+    struct RKCOMMON_INTERFACE Writer
+    {
+      Writer(FILE *xml, FILE *bin, bool asyncData = false);
+      ~Writer();
+
+      Writer(const Writer &) = delete;
+      Writer &operator=(const Writer &) = delete;
 
       /*! write document header, may only be called once */
       void writeHeader(const std::string &version);
@@ -86,14 +241,25 @@ namespace rkcommon {
       //! open a new xml node with given node type */
       void openNode(const std::string &type);
       void writeProperty(const std::string &name, const std::string &value);
+      /*! write a child node '<name>value</name>' of the open node */
       void writeContent(const std::string &name, const std::string &value);
       //! close last open node type */
       void closeNode();
       /*! align output pos on binary file to given alignment */
       void alignData(size_t alignment);
       /*! write given data into data file, and return offset value at
-          which it was written */
+          which it was written; asynchronous writes copy the data */
       size_t writeData(const void *ptr, size_t size);
+      /*! like writeData(), without copying the data: 'data' is kept alive
+          until it has been written */
+      size_t writeData(std::shared_ptr<const void> data, size_t size);
+
+      template <typename T>
+      size_t writeData(const std::shared_ptr<utility::AbstractArray<T>> &a);
+
+      /*! write out everything written so far, waiting for queued data */
+      void flush();
+
       FILE *xml, *bin;
 
      private:
@@ -103,9 +269,28 @@ namespace rkcommon {
         std::string type;
       };
 
+      struct DataWriter;
+
       void spaces();
-      std::stack<State *> state;
+      void beginContent();
+      void flushText();
+
+      std::vector<State> state;
+      std::string text;
+      size_t binOffset{0};
+      std::unique_ptr<DataWriter> data;
     };
 
+    // Inlined definitions ////////////////////////////////////////////////////
+
+    template <typename T>
+    inline size_t Writer::writeData(
+        const std::shared_ptr<utility::AbstractArray<T>> &a)
+    {
+      // shares ownership of the array, pointing at its elements
+      return writeData(std::shared_ptr<const void>(a, a->data()),
+                       a->size() * sizeof(T));
+    }
+
   }  // namespace xml
 }  // namespace rkcommon
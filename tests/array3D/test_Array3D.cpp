@@ -1,5 +1,317 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/array3D/Array3D.h"
+#include "rkcommon/array3D/BrickedArray3D.h"
+
+#include <limits>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+
+template struct rkcommon::array3D::ActualArray3D<float>;
+
+void numaArray3D()
+{
+  using namespace rkcommon::math;
+  rkcommon::array3D::ActualArray3D<float> a(
+      vec3i(64), rkcommon::memory::NumaPolicy::FIRST_TOUCH_PARALLEL);
+  a.set(vec3i(1), 1.f);
+}
+
+// getRow() and getBlock() must match get() cell by cell
+template <typename T>
+static void checkRows(const Array3D<T> &array,
+                      const vec3i &lower,
+                      const vec3i &upper)
+{
+  const box3i box(lower, upper);
+  const vec3i dims = box.size();
+  std::vector<T> block(longProduct(dims));
+  array.getBlock(box, block.data());
+
+  size_t i = 0;
+  for_each(box, [&](const vec3i &idx) {
+    INFO("idx = " << idx);
+    REQUIRE(block[i++] == array.get(idx));
+  });
+
+  std::vector<T> row(dims.x);
+  array.getRow(lower, dims.x, row.data());
+  for (int x = 0; x < dims.x; x++)
+    REQUIRE(row[x] == array.get(lower + vec3i(x, 0, 0)));
+}
+
+TEST_CASE("getRow() and getBlock() match get()", "[Array3D]")
+{
+  const vec3i dims(21, 6, 5);
+  auto actual = std::make_shared<ActualArray3D<int>>(dims);
+  for_each(dims, [&](const vec3i &idx) {
+    actual->set(idx, int(longIndex(idx, dims)));
+  });
+
+  SECTION("ActualArray3D, clamped outside the volume")
+  {
+    checkRows<int>(*actual, vec3i(0), dims);
+    checkRows<int>(*actual, vec3i(-3, -1, 2), vec3i(25, 7, 6));
+  }
+
+  SECTION("BrickedArray3D, clamped outside the volume")
+  {
+    const BrickedArray3D<int, 4> bricked(*actual);
+    checkRows<int>(bricked, vec3i(0), dims);
+    checkRows<int>(bricked, vec3i(-3, -1, 2), vec3i(25, 7, 6));
+  }
+
+  SECTION("IndexShiftedArray3D")
+  {
+    const IndexShiftedArray3D<int> shifted(actual, vec3i(5, -2, 1));
+    checkRows<int>(shifted, vec3i(0), dims);
+    checkRows<int>(shifted, vec3i(3, 1, 1), vec3i(20, 4, 3));
+  }
+
+  SECTION("SubBoxArray3D")
+  {
+    const box3i clipBox(vec3i(2, 1, 1), vec3i(19, 5, 4));
+    const SubBoxArray3D<int> sub(actual, clipBox);
+    checkRows<int>(sub, vec3i(0), sub.size());
+  }
+
+  SECTION("Array3DRepeater")
+  {
+    const Array3DRepeater<int> repeated(actual, dims);
+    checkRows<int>(repeated, vec3i(0), dims * 3);
+    checkRows<int>(repeated, vec3i(17, 4, 3), vec3i(60, 9, 12));
+  }
+
+  SECTION("MultiSliceArray3D")
+  {
+    std::vector<std::shared_ptr<Array3D<int>>> slices;
+    for (int z = 0; z < dims.z; z++)
+      slices.push_back(std::make_shared<SubBoxArray3D<int>>(
+          actual, box3i(vec3i(0, 0, z), vec3i(dims.x, dims.y, z + 1))));
+    const MultiSliceArray3D<int> stack(slices);
+    checkRows<int>(stack, vec3i(0), dims);
+  }
+
+  SECTION("Array3DAccessor")
+  {
+    const Array3DAccessor<int, float> accessor(actual);
+    checkRows<float>(accessor, vec3i(0), dims);
+
+    // longer than the conversion buffer
+    auto wide = std::make_shared<ActualArray3D<int>>(vec3i(1000, 1, 1));
+    for (int x = 0; x < 1000; x++)
+      wide->set(vec3i(x, 0, 0), x);
+    checkRows<float>(Array3DAccessor<int, float>(wide),
+                     vec3i(0),
+                     vec3i(1000, 1, 1));
+  }
+
+  const range1i range = actual->getValueRange();
+  CHECK(range.lower == 0);
+  CHECK(range.upper == int(longProduct(dims)) - 1);
+  CHECK(actual->getValueRange(vec3i(1, 2, 3), vec3i(2, 3, 4)).lower ==
+        int(longIndex(vec3i(1, 2, 3), dims)));
+}
+
+TEST_CASE("parallel getValueRange() and macrocell grids", "[Array3D]")
+{
+  // large enough to be split across tasks
+  const vec3i dims(67, 45, 39);
+  ActualArray3D<float> volume(dims);
+  for_each(dims, [&](const vec3i &idx) {
+    volume.set(idx, float((idx.x * 7 + idx.y * 13 + idx.z * 29) % 101));
+  });
+  volume.set(vec3i(66, 20, 38), -5.f);
+  volume.set(vec3i(3, 44, 0), 200.f);
+
+  auto bruteForce = [&](const vec3i &lower, const vec3i &upper) {
+    range1f r = volume.get(lower);
+    for_each(
+        lower, upper, [&](const vec3i &idx) { r.extend(volume.get(idx)); });
+    return r;
+  };
+
+  const range1f range = volume.getValueRange();
+  CHECK(range.lower == -5.f);
+  CHECK(range.upper == 200.f);
+
+  // through the generic row path as well
+  const Array3DAccessor<float, double> accessor(
+      std::shared_ptr<Array3D<float>>(&volume, [](Array3D<float> *) {}));
+  CHECK(accessor.getValueRange().lower == -5.0);
+  CHECK(accessor.getValueRange().upper == 200.0);
+
+  const vec3i lower(5, 1, 2), upper(60, 44, 30);
+  CHECK(volume.getValueRange(lower, upper).lower ==
+        bruteForce(lower, upper).lower);
+  CHECK(volume.getValueRange(lower, upper).upper ==
+        bruteForce(lower, upper).upper);
+
+  const int cellSize = 8;
+  auto grid          = volume.computeMacrocellGrid(cellSize);
+  CHECK(grid->size() == vec3i(9, 6, 5));
+
+  auto checkGrid = [&]() {
+    for_each(grid->size(), [&](const vec3i &c) {
+      const vec3i cellLower = c * cellSize;
+      const vec3i cellUpper = min(cellLower + cellSize + 1, dims);
+      const range1f expected = bruteForce(cellLower, cellUpper);
+      INFO("macrocell " << c);
+      REQUIRE(grid->get(c).lower == expected.lower);
+      REQUIRE(grid->get(c).upper == expected.upper);
+    });
+  };
+  checkGrid();
+
+  // on a macrocell border, so it belongs to up to 8 of them
+  volume.set(vec3i(16, 8, 24), 500.f);
+  volume.set(vec3i(3, 44, 0), 0.f);
+  volume.updateMacrocellGrid(
+      *grid, cellSize, box3i(vec3i(16, 8, 24), vec3i(17, 9, 25)));
+  volume.updateMacrocellGrid(
+      *grid, cellSize, box3i(vec3i(3, 44, 0), vec3i(4, 45, 1)));
+  checkGrid();
+}
+
+TEST_CASE("materialize(), copy() and fill()", "[Array3D]")
+{
+  // several tiles of rows, and rows longer than a conversion piece
+  const vec3i dims(300, 250, 7);
+  auto bytes = std::make_shared<ActualArray3D<uint8_t>>(dims);
+  for_each(dims, [&](const vec3i &idx) {
+    bytes->set(idx, uint8_t(idx.x * 3 + idx.y * 5 + idx.z));
+  });
+  const Array3DAccessor<uint8_t, float> accessor(bytes);
+
+  auto checkFloats = [&](const ActualArray3D<float> &floats) {
+    REQUIRE(floats.size() == dims);
+    for_each(dims, [&](const vec3i &idx) {
+      REQUIRE(floats.get(idx) == float(bytes->get(idx)));
+    });
+  };
+
+  SECTION("of the same type")
+  {
+    auto floats = materialize(accessor);
+    checkFloats(*floats);
+  }
+
+  SECTION("converted")
+  {
+    auto floats = materialize<float>(*bytes, memory::NumaPolicy::LOCAL);
+    checkFloats(*floats);
+    auto doubles = materialize<double>(accessor);
+    CHECK(doubles->get(vec3i(299, 249, 6)) == double(bytes->get(dims - 1)));
+  }
+
+  SECTION("copy() into an existing array")
+  {
+    ActualArray3D<float> floats(dims);
+    copy(*bytes, floats);
+    checkFloats(floats);
+
+    ActualArray3D<float> other(vec3i(3));
+    CHECK_THROWS(copy(*bytes, other));
+  }
+
+  SECTION("fill() and clear()")
+  {
+    fill(*bytes, uint8_t(9));
+    CHECK(bytes->getValueRange() == range_t<uint8_t>(9, 9));
+    bytes->clear(uint8_t(4));
+    CHECK(bytes->getValueRange() == range_t<uint8_t>(4, 4));
+  }
+}
+
+TEST_CASE("sampleTrilinear()", "[Array3D]")
+{
+  // trilinear interpolation reproduces linear functions
+  const vec3i dims(13, 7, 9);
+  auto linear = [](const vec3f &p) {
+    return 1.f + 2.f * p.x + 3.f * p.y - 0.5f * p.z;
+  };
+  ActualArray3D<float> volume(dims);
+  for_each(dims, [&](const vec3i &idx) { volume.set(idx, linear(idx)); });
+
+  // a count that leaves a remainder for every packet width
+  std::vector<vec3f> pos;
+  for (int i = 0; i < 101; i++) {
+    pos.push_back(vec3f((i * 37 % 120) / 10.f,
+                        (i * 11 % 60) / 10.f,
+                        (i * 23 % 80) / 10.f));
+  }
+  pos.push_back(vec3f(dims - 1));
+  pos.push_back(vec3f(0.f));
+
+  const BrickedArray3D<float, 4> bricked(volume);
+  const Array3DAccessor<float, double> accessor(
+      std::shared_ptr<Array3D<float>>(&volume, [](Array3D<float> *) {}));
+
+  std::vector<float> fromActual(pos.size()), fromBricked(pos.size());
+  std::vector<double> fromAccessor(pos.size());
+  volume.sampleTrilinear(pos.data(), fromActual.data(), pos.size());
+  bricked.sampleTrilinear(pos.data(), fromBricked.data(), pos.size());
+  accessor.sampleTrilinear(pos.data(), fromAccessor.data(), pos.size());
+
+  for (size_t i = 0; i < pos.size(); i++) {
+    INFO("pos = " << pos[i]);
+    const float expected = linear(pos[i]);
+    REQUIRE(fromActual[i] == Approx(expected).margin(1e-4f));
+    REQUIRE(fromBricked[i] == Approx(expected).margin(1e-4f));
+    REQUIRE(fromAccessor[i] == Approx(expected).margin(1e-4f));
+    REQUIRE(volume.sampleTrilinear(pos[i]) == Approx(expected).margin(1e-4f));
+    REQUIRE(bricked.sampleTrilinear(pos[i]) ==
+            Approx(expected).margin(1e-4f));
+  }
+
+  SECTION("outside the volume")
+  {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    std::vector<vec3f> outsidePos(32, vec3f(4.5f, 2.f, 3.25f));
+    outsidePos[1]  = vec3f(-1.f, 2.f, 3.f);
+    outsidePos[10] = vec3f(4.f, 7.5f, 3.f);
+    outsidePos[17] = vec3f(4.f, 2.f, 100.f);
+    outsidePos[31] = vec3f(nan, 2.f, 3.f);
+
+    std::vector<float> clamped(outsidePos.size()), masked(outsidePos.size());
+    const Array3D<float> &array = bricked;
+    array.sampleTrilinear(outsidePos.data(), clamped.data(), clamped.size());
+    array.sampleTrilinear(
+        outsidePos.data(), masked.data(), masked.size(), -100.f);
+
+    const float inside = linear(vec3f(4.5f, 2.f, 3.25f));
+    for (size_t i = 0; i < outsidePos.size(); i++) {
+      INFO("i = " << i);
+      const bool isOutside = i == 1 || i == 10 || i == 17 || i == 31;
+      if (isOutside)
+        REQUIRE(masked[i] == -100.f);
+      else
+        REQUIRE(masked[i] == Approx(inside).margin(1e-4f));
+    }
+    CHECK(clamped[1] == Approx(linear(vec3f(0.f, 2.f, 3.f))));
+    CHECK(clamped[10] == Approx(linear(vec3f(4.f, 6.f, 3.f))));
+    CHECK(clamped[17] == Approx(linear(vec3f(4.f, 2.f, 8.f))));
+    CHECK(clamped[31] == Approx(linear(vec3f(0.f, 2.f, 3.f))));
+  }
+
+  SECTION("integer values are rounded")
+  {
+    ActualArray3D<uint8_t> bytes(vec3i(2, 1, 1));
+    bytes.set(vec3i(0), 0);
+    bytes.set(vec3i(1, 0, 0), 255);
+    CHECK(bytes.sampleTrilinear(vec3f(0.5f, 0.f, 0.f)) == 128);
+    CHECK(bytes.sampleTrilinear(vec3f(0.1f, 0.f, 0.f)) == 26);
+  }
+
+  SECTION("value types that cannot be interpolated throw")
+  {
+    const ActualArray3D<range1f> ranges(vec3i(2));
+    const Array3D<range1f> &array = ranges;
+    CHECK_THROWS(array.sampleTrilinear(vec3f(0.5f)));
+  }
+}
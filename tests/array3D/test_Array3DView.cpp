@@ -0,0 +1,119 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/array3D/Array3DView.h"
+
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+
+static const vec3i dims(21, 6, 5);
+
+static std::shared_ptr<ActualArray3D<int>> makeActual()
+{
+  auto actual = std::make_shared<ActualArray3D<int>>(dims);
+  for_each(dims, [&](const vec3i &idx) {
+    actual->set(idx, int(longIndex(idx, dims)));
+  });
+  return actual;
+}
+
+// a view must match the virtual wrapper it replaces cell by cell
+template <typename V, typename T>
+static void checkMatches(const V &v, const Array3D<T> &expected)
+{
+  static_assert(std::is_same<typename V::value_type, T>::value,
+                "views keep the value type of the wrapper");
+  REQUIRE(v.size() == expected.size());
+  for_each(v.size(), [&](const vec3i &idx) {
+    INFO("idx = " << idx);
+    REQUIRE(v.get(idx) == expected.get(idx));
+  });
+}
+
+TEST_CASE("Array3D views match the virtual wrappers", "[Array3DView]")
+{
+  auto actual = makeActual();
+
+  SECTION("view")
+  {
+    checkMatches(view(*actual), *actual);
+    // through the interface, as the array's type is unknown
+    const Array3D<int> &base = *actual;
+    checkMatches(view(base), *actual);
+  }
+
+  SECTION("convert")
+  {
+    checkMatches(convert<float>(*actual),
+                 Array3DAccessor<int, float>(actual));
+  }
+
+  SECTION("subBox")
+  {
+    const box3i clipBox(vec3i(2, 1, 1), vec3i(19, 5, 4));
+    checkMatches(subBox(*actual, clipBox),
+                 SubBoxArray3D<int>(actual, clipBox));
+  }
+
+  SECTION("repeat")
+  {
+    // Array3DRepeater matches while the periods agree
+    checkMatches(repeat(*actual, dims), Array3DRepeater<int>(actual, dims));
+
+    const auto repeated = repeat(*actual, dims * 3);
+    CHECK(repeated.size() == dims * 3);
+    for (int x = 0; x < dims.x; x++) {
+      const vec3i where(x, 2, 3);
+      CHECK(repeated.get(where + vec3i(dims.x, 0, 0)) ==
+            actual->get(vec3i(dims.x - 1 - x, 2, 3)));
+      CHECK(repeated.get(where + dims * 2) == actual->get(where));
+    }
+    CHECK(repeated.get(dims) == actual->get(dims - 1));
+  }
+
+  SECTION("shift")
+  {
+    checkMatches(shift(*actual, vec3i(5, -2, 1)),
+                 IndexShiftedArray3D<int>(actual, vec3i(5, -2, 1)));
+  }
+
+  SECTION("stacked")
+  {
+    const box3i clipBox(vec3i(2, 1, 1), vec3i(19, 5, 4));
+    const auto stacked =
+        subBox(shift(convert<float>(*actual), vec3i(3, 1, 2)), clipBox);
+
+    auto accessor = std::make_shared<Array3DAccessor<int, float>>(actual);
+    auto shifted = std::make_shared<IndexShiftedArray3D<float>>(
+        accessor, vec3i(3, 1, 2));
+    checkMatches(stacked, SubBoxArray3D<float>(shifted, clipBox));
+  }
+}
+
+TEST_CASE("Array3D views as Array3D", "[Array3DView]")
+{
+  auto actual = makeActual();
+  const box3i clipBox(vec3i(2, 1, 1), vec3i(19, 5, 4));
+  const auto stacked =
+      convert<float>(subBox(repeat(*actual, dims * 2), clipBox));
+
+  const std::shared_ptr<Array3D<float>> wrapped = makeArray3D(stacked);
+  CHECK(wrapped->size() == clipBox.size());
+  CHECK(wrapped->numElements() == longProduct(clipBox.size()));
+
+  std::vector<float> block(wrapped->numElements());
+  wrapped->getBlock(box3i(vec3i(0), clipBox.size()), block.data());
+  size_t i = 0;
+  range1f expected = stacked.get(vec3i(0));
+  for_each(clipBox.size(), [&](const vec3i &idx) {
+    REQUIRE(block[i++] == stacked.get(idx));
+    expected.extend(stacked.get(idx));
+  });
+
+  CHECK(wrapped->getValueRange().lower == expected.lower);
+  CHECK(wrapped->getValueRange().upper == expected.upper);
+}
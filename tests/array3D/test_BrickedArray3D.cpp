@@ -0,0 +1,100 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/array3D/BrickedArray3D.h"
+
+#include <atomic>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+
+static float valueAt(const vec3i &idx)
+{
+  return float(idx.x + 100 * idx.y + 10000 * idx.z);
+}
+
+TEST_CASE("BrickedArray3D round trips ActualArray3D", "[BrickedArray3D]")
+{
+  // not a multiple of the brick size, to cover the padded bricks
+  const vec3i dims(19, 8, 13);
+
+  ActualArray3D<float> actual(dims);
+  for_each(dims, [&](const vec3i &idx) { actual.set(idx, valueAt(idx)); });
+
+  const BrickedArray3D<float> bricked(actual);
+  CHECK(bricked.size() == dims);
+  CHECK(bricked.numElements() == actual.numElements());
+  CHECK(bricked.numBricks() == vec3i(3, 1, 2));
+
+  for_each(dims, [&](const vec3i &idx) {
+    REQUIRE(bricked.get(idx) == valueAt(idx));
+  });
+  // clamped like ActualArray3D::get()
+  CHECK(bricked.get(vec3i(-1, 20, 5)) == valueAt(vec3i(0, 7, 5)));
+  CHECK(bricked.getValueRange().lower == valueAt(vec3i(0)));
+  CHECK(bricked.getValueRange().upper == valueAt(dims - 1));
+
+  // from the generic interface, with another brick size
+  const BrickedArray3D<float, 4> bricked4(
+      static_cast<const Array3D<float> &>(actual));
+  for_each(dims, [&](const vec3i &idx) {
+    REQUIRE(bricked4.get(idx) == valueAt(idx));
+  });
+
+  ActualArray3D<float> back(dims);
+  back.clear(-1.f);
+  bricked.copyTo(back);
+  for_each(dims, [&](const vec3i &idx) {
+    REQUIRE(back.get(idx) == valueAt(idx));
+  });
+
+  // the cell corners through cellOffsets(), also across bricks
+  for_each(dims - 1, [&](const vec3i &idx) {
+    const vec3ul o     = bricked.cellOffsets(idx);
+    const size_t base  = bricked.indexOf(idx);
+    const float *value = bricked.value.data();
+    REQUIRE(value[base + o.x] == valueAt(idx + vec3i(1, 0, 0)));
+    REQUIRE(value[base + o.y] == valueAt(idx + vec3i(0, 1, 0)));
+    REQUIRE(value[base + o.z] == valueAt(idx + vec3i(0, 0, 1)));
+    REQUIRE(value[base + o.x + o.y + o.z] == valueAt(idx + 1));
+  });
+
+  ActualArray3D<float> wrongSize(dims + 1);
+  CHECK_THROWS(bricked.copyTo(wrongSize));
+}
+
+TEST_CASE("BrickedArray3D brick iteration", "[BrickedArray3D]")
+{
+  const vec3i dims(20, 9, 17);
+  BrickedArray3D<int> bricked(dims);
+  bricked.clear(0);
+
+  std::atomic<size_t> voxels(0);
+  bricked.parallel_for_each_brick([&](const box3i &bounds, int *data) {
+    CHECK(!anyLessThan(bounds.lower, vec3i(0)));
+    CHECK(!anyLessThan(dims, bounds.upper));
+    for_each(bounds, [&](const vec3i &idx) {
+      data[BrickedArray3D<int>::localIndex(idx - bounds.lower)] += 1;
+    });
+    voxels += longProduct(bounds.size());
+  });
+  CHECK(voxels == longProduct(dims));
+
+  // every voxel was visited exactly once, and set() / get() agree
+  for_each(dims, [&](const vec3i &idx) {
+    REQUIRE(bricked.get(idx) == 1);
+    bricked.set(idx, int(longIndex(idx, dims)));
+  });
+
+  size_t bricks = 0;
+  bricked.for_each_brick([&](const box3i &bounds, const int *data) {
+    const vec3i brick = bounds.lower / 8;
+    CHECK(data == bricked.brickData(brick));
+    CHECK(bounds == bricked.brickBounds(brick));
+    CHECK(data[0] == int(longIndex(bounds.lower, dims)));
+    bricks++;
+  });
+  CHECK(bricks == longProduct(bricked.numBricks()));
+}
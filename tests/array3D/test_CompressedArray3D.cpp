@@ -0,0 +1,182 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/array3D/CompressedArray3D.h"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+
+// not a multiple of the brick size along any axis
+static const vec3i dims(37, 21, 19);
+
+template <typename T, typename FCN_T>
+static std::shared_ptr<ActualArray3D<T>> makeVolume(FCN_T &&fcn)
+{
+  auto v = std::make_shared<ActualArray3D<T>>(dims);
+  for_each(dims, [&](const vec3i &idx) { v->set(idx, T(fcn(idx))); });
+  return v;
+}
+
+// bit exact, so NaN and -0 count as well
+template <typename T>
+static void checkLossless(std::shared_ptr<ActualArray3D<T>> volume)
+{
+  const ActualArray3D<T> &reference = *volume;
+  const CompressedArray3D<T, 8> compressed(reference);
+  CHECK(compressed.size() == dims);
+  CHECK(compressed.numElements() == longProduct(dims));
+  CHECK(compressed.compression() == Compression::LOSSLESS);
+
+  for_each(box3i(vec3i(-1), dims + 1), [&](const vec3i &idx) {
+    const T a = compressed.get(idx), b = reference.get(idx);
+    INFO("idx = " << idx);
+    REQUIRE(std::memcmp(&a, &b, sizeof(T)) == 0);
+  });
+
+  // reaches past the faces and across bricks along every axis
+  const box3i box(vec3i(-2), dims + 3);
+  std::vector<T> block(longProduct(box.size())), expected(block.size());
+  compressed.getBlock(box, block.data());
+  reference.getBlock(box, expected.data());
+  REQUIRE(std::memcmp(block.data(), expected.data(), block.size() * sizeof(T))
+          == 0);
+}
+
+TEST_CASE("CompressedArray3D lossless", "[CompressedArray3D]")
+{
+  SECTION("smooth float field")
+  {
+    // one exponent throughout, so neighbors differ in few mantissa bits
+    auto volume = makeVolume<float>([](const vec3i &i) {
+      return 1024.f + 0.25f * float(i.x + 2 * i.y - 3 * i.z + 57);
+    });
+    checkLossless(volume);
+    const ActualArray3D<float> &reference = *volume;
+
+    const CompressedArray3D<float> compressed(reference);
+    const size_t paddedBytes =
+        longProduct(compressed.numBricks()) * 16 * 16 * 16 * sizeof(float);
+    CHECK(compressed.compressedBytes() * 2 < paddedBytes);
+
+    const range1f range = compressed.getValueRange();
+    CHECK(range.lower == reference.getValueRange().lower);
+    CHECK(range.upper == reference.getValueRange().upper);
+  }
+
+  SECTION("special floats")
+  {
+    const float values[] = {-0.f,
+                            std::numeric_limits<float>::quiet_NaN(),
+                            std::numeric_limits<float>::infinity(),
+                            -std::numeric_limits<float>::infinity(),
+                            std::numeric_limits<float>::denorm_min(),
+                            -std::numeric_limits<float>::max(),
+                            1.f};
+    checkLossless(makeVolume<float>(
+        [&](const vec3i &i) { return values[(i.x * 3 + i.y + i.z) % 7]; }));
+  }
+
+  SECTION("integer and double fields")
+  {
+    checkLossless(makeVolume<uint8_t>(
+        [](const vec3i &i) { return (i.x * i.y + i.z) & 255; }));
+    checkLossless(makeVolume<int16_t>(
+        [](const vec3i &i) { return i.x * 100 - i.y * 1000 + i.z; }));
+    checkLossless(makeVolume<int64_t>([](const vec3i &i) {
+      return (int64_t(i.x) << 40) - (int64_t(i.y * i.z) << 20) - i.x;
+    }));
+    checkLossless(makeVolume<double>(
+        [](const vec3i &i) { return std::sin(i.x * 0.1) * i.y - i.z; }));
+  }
+}
+
+TEST_CASE("CompressedArray3D fixed rate", "[CompressedArray3D]")
+{
+  auto volume = makeVolume<float>([](const vec3i &i) {
+    return std::sin(i.x * 0.3f) + std::cos(i.y * 0.2f) * i.z;
+  });
+  const ActualArray3D<float> &reference = *volume;
+  const range1f range = reference.getValueRange();
+
+  for (int bits : {4, 8, 12}) {
+    const CompressedArray3D<float> compressed(
+        reference, Compression::FIXED_RATE, bits);
+    // every 64 values share a range at most as wide as the whole volume's
+    const float maxError = range.size() / ((1 << bits) - 1);
+    for_each(dims, [&](const vec3i &idx) {
+      INFO("bits = " << bits << ", idx = " << idx);
+      REQUIRE(std::abs(compressed.get(idx) - reference.get(idx)) <= maxError);
+    });
+
+    // 2 floats of range per 64 values
+    const size_t expected = longProduct(compressed.numBricks()) * 16 * 16 *
+        16 * (bits + 1) / 8;
+    CHECK(compressed.compressedBytes() >= expected);
+    CHECK(compressed.compressedBytes() < expected + 64 * 1024);
+  }
+
+  SECTION("integers round to the nearest value")
+  {
+    auto bytes = makeVolume<uint8_t>([](const vec3i &i) { return i.x * 6; });
+    const CompressedArray3D<uint8_t> exact(*bytes, Compression::FIXED_RATE, 8);
+    for_each(dims, [&](const vec3i &idx) {
+      REQUIRE(exact.get(idx) == bytes->get(idx));
+    });
+  }
+
+  CHECK_THROWS(CompressedArray3D<float>(reference, Compression::FIXED_RATE, 0));
+  CHECK_THROWS(
+      CompressedArray3D<float>(reference, Compression::FIXED_RATE, 33));
+}
+
+TEST_CASE("CompressedArray3D value ranges", "[CompressedArray3D]")
+{
+  auto volume = makeVolume<int>(
+      [](const vec3i &i) { return (i.x * 7 + i.y * 13 + i.z * 29) % 101; });
+  const ActualArray3D<int> &reference = *volume;
+  const CompressedArray3D<int, 8> compressed(reference);
+
+  const box3i regions[] = {box3i(vec3i(0), dims),
+                           box3i(vec3i(8), vec3i(16)),
+                           box3i(vec3i(3, 5, 7), vec3i(30, 9, 18)),
+                           box3i(vec3i(-4), vec3i(2)),
+                           box3i(dims - 2, dims + 5),
+                           box3i(vec3i(5), vec3i(5))};
+  for (const box3i &r : regions) {
+    INFO("region = " << r);
+    const range1i expected = reference.getValueRange(r.lower, r.upper);
+    const range1i actual   = compressed.getValueRange(r.lower, r.upper);
+    CHECK(actual.lower == expected.lower);
+    CHECK(actual.upper == expected.upper);
+  }
+}
+
+TEST_CASE("CompressedArray3D concurrent readers", "[CompressedArray3D]")
+{
+  auto volume = makeVolume<int>(
+      [](const vec3i &i) { return int(longIndex(i, dims)); });
+  const ActualArray3D<int> &reference = *volume;
+  const CompressedArray3D<int, 4> compressed(reference);
+
+  std::vector<int> mismatches(dims.z, 0);
+  tasking::parallel_for(dims.z, [&](int z) {
+    for (int y = 0; y < dims.y; y++)
+      for (int x = 0; x < dims.x; x++) {
+        const vec3i idx(x, y, z);
+        mismatches[z] += compressed.get(idx) != reference.get(idx);
+      }
+  });
+  for (int z = 0; z < dims.z; z++)
+    REQUIRE(mismatches[z] == 0);
+
+  std::vector<int> brick(4 * 4 * 4);
+  compressed.decompressBrick(vec3i(1, 2, 3), brick.data());
+  CHECK(brick[BrickedArray3D<int, 4>::localIndex(vec3i(1, 2, 3))] ==
+        reference.get(vec3i(5, 10, 15)));
+}
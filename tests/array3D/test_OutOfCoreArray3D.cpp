@@ -0,0 +1,135 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/array3D/OutOfCoreArray3D.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+
+static const char *fileName = "test_OutOfCoreArray3D.raw";
+
+// not a multiple of the brick size along any axis
+static const vec3i dims(37, 21, 19);
+
+static ActualArray3D<float> &reference()
+{
+  static ActualArray3D<float> v(dims);
+  static bool initialized = false;
+  if (!initialized) {
+    for_each(dims, [&](const vec3i &idx) {
+      v.set(idx, float((idx.x * 7 + idx.y * 13 + idx.z * 29) % 101));
+    });
+    initialized = true;
+  }
+  return v;
+}
+
+static void writeLinear()
+{
+  FILE *file = fopen(fileName, "wb");
+  fwrite(reference().value, sizeof(float), longProduct(dims), file);
+  fclose(file);
+}
+
+static void checkMatches(const Array3D<float> &volume)
+{
+  for_each(box3i(vec3i(-2), dims + 2), [&](const vec3i &idx) {
+    INFO("idx = " << idx);
+    REQUIRE(volume.get(idx) == reference().get(idx));
+  });
+
+  std::vector<float> block(longProduct(dims + 4));
+  volume.getBlock(box3i(vec3i(-2), dims + 2), block.data());
+  size_t i = 0;
+  for_each(box3i(vec3i(-2), dims + 2), [&](const vec3i &idx) {
+    REQUIRE(block[i++] == reference().get(idx));
+  });
+
+  CHECK(volume.getValueRange().lower == reference().getValueRange().lower);
+  CHECK(volume.getValueRange().upper == reference().getValueRange().upper);
+
+  std::vector<vec3f> pos;
+  for (int j = 0; j < 100; j++)
+    pos.push_back(vec3f(j * 0.37f, j * 0.2f, j * 0.19f));
+  std::vector<float> sampled(pos.size()), expected(pos.size());
+  volume.sampleTrilinear(pos.data(), sampled.data(), pos.size());
+  reference().sampleTrilinear(pos.data(), expected.data(), pos.size());
+  for (size_t j = 0; j < pos.size(); j++)
+    REQUIRE(sampled[j] == Approx(expected[j]).margin(1e-4f));
+}
+
+TEST_CASE("OutOfCoreArray3D on a linear file", "[OutOfCoreArray3D]")
+{
+  writeLinear();
+
+  const size_t brickBytes = 8 * 8 * 8 * sizeof(float);
+  OutOfCoreArray3D<float, 8> volume(fileName, dims, 4 * brickBytes);
+  CHECK(volume.size() == dims);
+  CHECK(volume.numElements() == longProduct(dims));
+  CHECK(volume.numBricks() == vec3i(5, 3, 3));
+
+  checkMatches(volume);
+  CHECK(volume.residentBricks() <= 4);
+  CHECK(volume.stats().evicted > 0);
+
+  std::remove(fileName);
+}
+
+TEST_CASE("OutOfCoreArray3D on a bricked file", "[OutOfCoreArray3D]")
+{
+  saveBricked(fileName, BrickedArray3D<float, 8>(reference()));
+
+  OutOfCoreArray3D<float, 8> volume(
+      fileName, dims, 1 << 20, VolumeFileLayout::BRICKED);
+  checkMatches(volume);
+  // the whole volume fits
+  CHECK(volume.residentBricks() == 45);
+
+  std::remove(fileName);
+}
+
+TEST_CASE("OutOfCoreArray3D brick cache", "[OutOfCoreArray3D]")
+{
+  writeLinear();
+
+  SECTION("hits, misses and evictions")
+  {
+    OutOfCoreArray3D<float, 8> volume(fileName, dims, 0);
+    volume.setPrefetchNeighbors(false);
+
+    volume.get(vec3i(1, 2, 3));
+    volume.get(vec3i(7, 7, 7));
+    CHECK(volume.stats().misses == 1);
+    CHECK(volume.stats().hits == 1);
+
+    // a budget below one brick still keeps one
+    volume.get(vec3i(8, 0, 0));
+    CHECK(volume.residentBricks() == 1);
+    CHECK(volume.stats().evicted == 1);
+  }
+
+  SECTION("prefetches outliving the array are harmless")
+  {
+    {
+      OutOfCoreArray3D<float, 8> volume(fileName, dims, 1 << 20);
+      volume.prefetch(box3i(vec3i(0), dims));
+      CHECK(volume.get(vec3i(0)) == reference().get(vec3i(0)));
+    }
+    // run the tasks that were left behind, if any
+    tasking::parallel_for(64, [](int) {});
+  }
+
+  SECTION("files that are too small throw")
+  {
+    using Volume = OutOfCoreArray3D<float, 8>;
+    CHECK_THROWS(Volume(fileName, dims + 1, 1 << 20));
+    CHECK_THROWS(Volume(fileName, dims, 1 << 20, VolumeFileLayout::BRICKED));
+  }
+
+  std::remove(fileName);
+}
@@ -0,0 +1,138 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/array3D/Pyramid.h"
+#include "rkcommon/tasking/parallel_for.h"
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+
+// the filter over the cells below 'idx', straight from the definition
+template <typename T>
+static T expected(const Array3D<T> &below,
+                  const vec3i &idx,
+                  PyramidFilter filter)
+{
+  const vec3i dims = below.size();
+  float sum        = 0.f;
+  int count        = 0;
+  T lo = below.get(2 * idx), hi = lo;
+  for (int z = 2 * idx.z; z < std::min(2 * idx.z + 2, dims.z); z++)
+    for (int y = 2 * idx.y; y < std::min(2 * idx.y + 2, dims.y); y++)
+      for (int x = 2 * idx.x; x < std::min(2 * idx.x + 2, dims.x); x++) {
+        const T v = below.get(vec3i(x, y, z));
+        sum += v;
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+        count++;
+      }
+  if (filter == PyramidFilter::MIN)
+    return lo;
+  if (filter == PyramidFilter::MAX)
+    return hi;
+  return array3D::detail::fromInterpolant<T>(sum / count);
+}
+
+template <typename T>
+static void checkLevel(const Array3D<T> &level,
+                       const Array3D<T> &below,
+                       PyramidFilter filter)
+{
+  REQUIRE(level.size() == pyramidLevelSize(below.size()));
+  for_each(level.size(), [&](const vec3i &idx) {
+    if (std::is_integral<T>::value)
+      REQUIRE(level.get(idx) == expected(below, idx, filter));
+    else
+      REQUIRE(level.get(idx) == Approx(expected(below, idx, filter)));
+  });
+}
+
+template <typename T>
+static void checkPyramid(const ActualArray3D<T> &source, PyramidFilter filter)
+{
+  const auto levels = buildPyramid(source, filter);
+  REQUIRE(int(levels.size()) == pyramidNumLevels(source.size()) - 1);
+  CHECK(levels.back()->size() == vec3i(1));
+  checkLevel<T>(*levels[0], source, filter);
+  for (size_t l = 1; l < levels.size(); l++)
+    checkLevel<T>(*levels[l], *levels[l - 1], filter);
+}
+
+TEST_CASE("Pyramid level sizes", "[Pyramid]")
+{
+  CHECK(pyramidLevelSize(vec3i(64, 33, 1)) == vec3i(32, 17, 1));
+  CHECK(pyramidNumLevels(vec3i(64, 33, 1)) == 7);
+  CHECK(pyramidNumLevels(vec3i(1)) == 1);
+  CHECK(pyramidNumLevels(vec3i(2, 1, 1)) == 2);
+}
+
+TEST_CASE("Pyramid filters", "[Pyramid]")
+{
+  // odd sizes, so that edges have fewer than 8 cells below
+  const vec3i dims(67, 30, 13);
+
+  ActualArray3D<float> floats(dims);
+  ActualArray3D<uint8_t> bytes(dims);
+  for_each(dims, [&](const vec3i &idx) {
+    const int h = (idx.x * 7 + idx.y * 13 + idx.z * 29) % 251;
+    floats.set(idx, h * .5f - 20.f);
+    bytes.set(idx, uint8_t(h));
+  });
+
+  for (PyramidFilter filter :
+       {PyramidFilter::AVERAGE, PyramidFilter::MIN, PyramidFilter::MAX}) {
+    checkPyramid(floats, filter);
+    checkPyramid(bytes, filter);
+  }
+
+  // the whole volume ends in its range, and the mean for the average
+  const auto minLevels = buildPyramid(floats, PyramidFilter::MIN);
+  const auto maxLevels = buildPyramid(floats, PyramidFilter::MAX);
+  CHECK(minLevels.back()->get(vec3i(0)) == floats.getValueRange().lower);
+  CHECK(maxLevels.back()->get(vec3i(0)) == floats.getValueRange().upper);
+
+  CHECK(buildPyramid(floats, PyramidFilter::BOX, 2).size() == 2);
+}
+
+TEST_CASE("Pyramid levels on demand", "[Pyramid]")
+{
+  const vec3i dims(40, 21, 9);
+  auto source = std::make_shared<ActualArray3D<float>>(dims);
+  for_each(dims, [&](const vec3i &idx) {
+    source->set(idx, float(idx.x + 2 * idx.y + 3 * idx.z));
+  });
+  const auto levels = buildPyramid(*source, PyramidFilter::MAX);
+
+  VolumePyramid<float> pyramid(source, PyramidFilter::MAX);
+  CHECK(pyramid.numLevels() == int(levels.size()) + 1);
+  CHECK(pyramid.levelSize(2) == levels[1]->size());
+  CHECK(pyramid.cachedBytes() == 0);
+  CHECK(&pyramid.level(0) == source.get());
+
+  // asking for level 3 computes (and keeps) the ones below it
+  const Array3D<float> &level3 = pyramid.level(3);
+  CHECK(pyramid.isCached(1));
+  CHECK(pyramid.isCached(2));
+  CHECK(!pyramid.isCached(4));
+  for_each(level3.size(), [&](const vec3i &idx) {
+    REQUIRE(level3.get(idx) == levels[2]->get(idx));
+  });
+  CHECK(&pyramid.level(3) == &level3);
+
+  // from several threads at once
+  const int n = pyramid.numLevels();
+  tasking::parallel_for(4 * n, [&](int i) {
+    const Array3D<float> &level = pyramid.level(i % n);
+    REQUIRE(level.size() == pyramid.levelSize(i % n));
+  });
+  for (int l = 1; l < n; l++)
+    CHECK(pyramid.level(l).get(vec3i(0)) == levels[l - 1]->get(vec3i(0)));
+  CHECK(pyramid.cachedBytes() > 0);
+
+  pyramid.clear();
+  CHECK(!pyramid.isCached(1));
+  CHECK(pyramid.cachedBytes() == 0);
+  CHECK_THROWS(pyramid.level(n));
+}
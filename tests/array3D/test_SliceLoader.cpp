@@ -0,0 +1,160 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/array3D/SliceLoader.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+
+static const vec3i dims(37, 21, 19);
+
+static uint16_t valueAt(const vec3i &idx)
+{
+  return uint16_t(idx.x * 7 + idx.y * 131 + idx.z * 1009);
+}
+
+static std::vector<uint16_t> sliceValues(int z)
+{
+  std::vector<uint16_t> values;
+  for (int y = 0; y < dims.y; y++)
+    for (int x = 0; x < dims.x; x++)
+      values.push_back(valueAt(vec3i(x, y, z)));
+  return values;
+}
+
+static void writeFile(const std::string &fileName,
+                      int firstSlice,
+                      int numSlices,
+                      size_t header = 0)
+{
+  FILE *file = fopen(fileName.c_str(), "wb");
+  const std::vector<char> zeros(header, 0);
+  fwrite(zeros.data(), 1, header, file);
+  for (int z = firstSlice; z < firstSlice + numSlices; z++) {
+    const std::vector<uint16_t> values = sliceValues(z);
+    fwrite(values.data(), sizeof(uint16_t), values.size(), file);
+  }
+  fclose(file);
+}
+
+static const size_t sliceBytes = size_t(dims.x) * dims.y * sizeof(uint16_t);
+
+TEST_CASE("SliceLoader on a raw file", "[SliceLoader]")
+{
+  const std::string fileName = "test_SliceLoader.raw";
+  writeFile(fileName, 0, dims.z, 16);
+
+  SliceLoader<float> loader(dims,
+                            rawSliceReader(fileName, sliceBytes, 16),
+                            rawSliceDecoder<uint16_t, float>(),
+                            2);
+
+  SECTION("slices are usable while the others load")
+  {
+    CHECK(loader.loadedSlices() == 0);
+    CHECK(loader.slice(0) == nullptr);
+
+    auto first = loader.next();
+    REQUIRE(first);
+    CHECK(first->size() == vec3i(dims.x, dims.y, 1));
+    CHECK(loader.loadedSlices() == 1);
+    CHECK(loader.slice(0) == first);
+    CHECK(first->get(vec3i(3, 4, 0)) == float(valueAt(vec3i(3, 4, 0))));
+  }
+
+  SECTION("the whole volume")
+  {
+    auto volume = loader.array();
+    CHECK(loader.loadedSlices() == dims.z);
+    CHECK(loader.next() == nullptr);
+    REQUIRE(volume->size() == dims);
+    for_each(dims, [&](const vec3i &idx) {
+      REQUIRE(volume->get(idx) == float(valueAt(idx)));
+    });
+  }
+
+  std::remove(fileName.c_str());
+}
+
+TEST_CASE("SliceLoader on a stack of files", "[SliceLoader]")
+{
+  std::vector<std::string> fileNames;
+  for (int z = 0; z < dims.z; z++) {
+    fileNames.push_back("test_SliceLoader_" + std::to_string(z) + ".raw");
+    writeFile(fileNames.back(), z, 1);
+  }
+
+  SECTION("each file is a slice")
+  {
+    SliceLoader<uint16_t> loader(
+        dims, sliceFileReader(fileNames), rawSliceDecoder<uint16_t>());
+    auto volume = loader.array();
+    for_each(dims, [&](const vec3i &idx) {
+      REQUIRE(volume->get(idx) == valueAt(idx));
+    });
+  }
+
+  SECTION("read errors surface in next()")
+  {
+    fileNames.resize(dims.z / 2);
+    SliceLoader<uint16_t> loader(
+        dims, sliceFileReader(fileNames), rawSliceDecoder<uint16_t>());
+    for (int z = 0; z < dims.z / 2; z++)
+      REQUIRE(loader.next());
+    CHECK_THROWS(loader.next());
+    CHECK_THROWS(loader.next());
+    CHECK(loader.loadedSlices() == dims.z / 2);
+  }
+
+  SECTION("short slices fail to decode")
+  {
+    SliceLoader<uint16_t> loader(vec3i(dims.x + 1, dims.y, dims.z),
+                                 sliceFileReader(fileNames),
+                                 rawSliceDecoder<uint16_t>());
+    CHECK_THROWS(loader.next());
+  }
+
+  for (const std::string &fileName : fileNames)
+    std::remove(fileName.c_str());
+}
+
+TEST_CASE("forEachSliceWindow", "[SliceLoader]")
+{
+  const std::string fileName = "test_SliceLoader.raw";
+  writeFile(fileName, 0, dims.z);
+
+  const int radius = 2;
+  SliceLoader<float> loader(dims,
+                            rawSliceReader(fileName, sliceBytes),
+                            rawSliceDecoder<uint16_t, float>());
+
+  // mean over z, clamped at the ends
+  int nextZ = 0;
+  forEachSliceWindow(loader, radius, [&](const SliceWindow<float> &window) {
+    REQUIRE(window.z == nextZ++);
+    REQUIRE(int(window.slices.size()) <= 2 * radius + 1);
+    // slices behind the window are released
+    CHECK(loader.slice(window.z - radius - 1) == nullptr);
+
+    for (int y = 0; y < dims.y; y += 5)
+      for (int x = 0; x < dims.x; x += 3) {
+        float sum = 0.f, expected = 0.f;
+        for (int dz = -radius; dz <= radius; dz++) {
+          const vec3i where(x, y, window.z + dz);
+          sum += window.get(where);
+          expected += valueAt(
+              vec3i(x, y, clamp(window.z + dz, 0, dims.z - 1)));
+        }
+        REQUIRE(sum == expected);
+      }
+  });
+  CHECK(nextZ == dims.z);
+
+  std::remove(fileName.c_str());
+}
@@ -0,0 +1,147 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/array3D/SparseArray3D.h"
+
+#include <atomic>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+
+// a sphere shell of values in an otherwise empty volume
+static float valueAt(const vec3i &idx)
+{
+  const vec3f d = vec3f(idx) - vec3f(70.f, 40.f, 50.f);
+  const float r = length(d);
+  return r > 20.f && r < 24.f ? r + idx.x * .01f : 0.f;
+}
+
+template <typename ARRAY_T>
+static void checkMatches(const ARRAY_T &sparse,
+                         const ActualArray3D<float> &dense)
+{
+  const vec3i dims = dense.size();
+  CHECK(sparse.size() == dims);
+  CHECK(sparse.numElements() == dense.numElements());
+
+  for_each(dims, [&](const vec3i &idx) {
+    REQUIRE(sparse.get(idx) == dense.get(idx));
+    REQUIRE(sparse.isActive(idx) == (dense.get(idx) != 0.f));
+  });
+  // clamped like ActualArray3D::get()
+  CHECK(sparse.get(vec3i(-1, 100, 30)) == dense.get(vec3i(-1, 100, 30)));
+
+  std::vector<float> row(dims.x + 6), denseRow(dims.x + 6);
+  for (int y = 15; y < 65; y += 7) {
+    sparse.getRow(vec3i(-3, y, 50), dims.x + 6, row.data());
+    dense.getRow(vec3i(-3, y, 50), dims.x + 6, denseRow.data());
+    CHECK(row == denseRow);
+  }
+
+  // whole volume, regions inside a node, and regions across leaves
+  CHECK(sparse.getValueRange() == dense.getValueRange());
+  const box3i regions[] = {box3i(vec3i(0), vec3i(16)),
+                           box3i(vec3i(45, 17, 30), vec3i(96, 64, 71)),
+                           box3i(vec3i(60, 30, 40), vec3i(61, 31, 41)),
+                           box3i(vec3i(3, 5, 7), vec3i(140, 90, 101)),
+                           box3i(vec3i(-5, 60, 70), vec3i(200, 200, 200))};
+  for (const box3i &r : regions) {
+    CHECK(sparse.getValueRange(r.lower, r.upper) ==
+          dense.getValueRange(r.lower, r.upper));
+  }
+}
+
+TEST_CASE("SparseArray3D from a dense array", "[SparseArray3D]")
+{
+  // several root cells, not a multiple of the leaf size
+  const vec3i dims(140, 90, 101);
+  ActualArray3D<float> dense(dims);
+  for_each(dims, [&](const vec3i &idx) { dense.set(idx, valueAt(idx)); });
+
+  const SparseArray3D<float> sparse(dense, 0.f);
+  checkMatches(sparse, dense);
+
+  size_t active = 0;
+  for_each(dims, [&](const vec3i &idx) { active += valueAt(idx) != 0.f; });
+  CHECK(sparse.numActiveCells() == active);
+  CHECK(sparse.background() == 0.f);
+
+  // only the leaves around the shell are stored
+  CHECK(sparse.numLeaves() < longProduct(dims) / (8 * 8 * 8) / 4);
+  CHECK(sparse.memoryBytes() < dense.numElements() * sizeof(float) / 4);
+
+  // with a smaller tree
+  const SparseArray3D<float, 4, 4> small(dense, 0.f);
+  checkMatches(small, dense);
+}
+
+TEST_CASE("SparseArray3D from a voxel stream", "[SparseArray3D]")
+{
+  const vec3i dims(140, 90, 101);
+  ActualArray3D<float> dense(dims);
+  dense.clear(-1.f);
+
+  std::vector<vec3i> coords;
+  std::vector<float> values;
+  // backwards, and every cell with a value twice; the later one wins
+  for (int z = dims.z - 1; z >= 0; z--)
+    for (int y = dims.y - 1; y >= 0; y--)
+      for (int x = dims.x - 1; x >= 0; x--) {
+        const vec3i idx(x, y, z);
+        if (valueAt(idx) == 0.f)
+          continue;
+        coords.push_back(idx);
+        values.push_back(-2.f);
+      }
+  const size_t n = coords.size();
+  for (size_t i = 0; i < n; i++) {
+    coords.push_back(coords[i]);
+    values.push_back(valueAt(coords[i]));
+    dense.set(coords[i], valueAt(coords[i]));
+  }
+
+  const SparseArray3D<float> sparse(
+      dims, -1.f, coords.data(), values.data(), coords.size());
+  CHECK(sparse.numActiveCells() == n);
+  for_each(dims, [&](const vec3i &idx) {
+    REQUIRE(sparse.get(idx) == dense.get(idx));
+  });
+  CHECK(sparse.getValueRange() == dense.getValueRange());
+
+  const vec3i outside(0, dims.y, 0);
+  CHECK_THROWS(SparseArray3D<float>(dims, -1.f, &outside, values.data(), 1));
+}
+
+TEST_CASE("SparseArray3D active cells", "[SparseArray3D]")
+{
+  const vec3i dims(140, 90, 101);
+  ActualArray3D<float> dense(dims);
+  for_each(dims, [&](const vec3i &idx) { dense.set(idx, valueAt(idx)); });
+  const SparseArray3D<float> sparse(dense, 0.f);
+
+  size_t count = 0;
+  sparse.for_each_active([&](const vec3i &idx, float value) {
+    REQUIRE(value == valueAt(idx));
+    REQUIRE(value != 0.f);
+    count++;
+  });
+  CHECK(count == sparse.numActiveCells());
+
+  std::atomic<size_t> parallelCount(0);
+  sparse.parallel_for_each_active([&](const vec3i &, float value) {
+    if (value != 0.f)
+      parallelCount++;
+  });
+  CHECK(parallelCount == count);
+
+  // an empty volume has no tree at all
+  ActualArray3D<float> empty(dims);
+  empty.clear(0.f);
+  const SparseArray3D<float> none(empty, 0.f);
+  CHECK(none.numLeaves() == 0);
+  CHECK(none.numNodes() == 0);
+  CHECK(none.get(vec3i(3)) == 0.f);
+  CHECK(none.getValueRange() == range1f(0.f));
+}
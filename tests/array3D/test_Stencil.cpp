@@ -0,0 +1,164 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/array3D/Stencil.h"
+// std
+#include <numeric>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+
+static const vec3i dims(83, 37, 21);
+
+static float valueAt(const vec3i &idx)
+{
+  return float((idx.x * 7 + idx.y * 13 + idx.z * 29) % 101) - 50.f;
+}
+
+// the filter straight from its definition, with clamped get()s
+static float convolveNaive(const Array3D<float> &in,
+                           const vec3i &idx,
+                           const std::vector<float> &w)
+{
+  const int r = int(w.size() / 2);
+  float sum   = 0.f;
+  for (int z = -r; z <= r; z++)
+    for (int y = -r; y <= r; y++)
+      for (int x = -r; x <= r; x++) {
+        sum += w[x + r] * w[y + r] * w[z + r] *
+               in.get(clamp(idx + vec3i(x, y, z), vec3i(0), dims - 1));
+      }
+  return sum;
+}
+
+TEST_CASE("Stencil central differences", "[Stencil]")
+{
+  ActualArray3D<float> in(dims);
+  for_each(dims, [&](const vec3i &idx) { in.set(idx, valueAt(idx)); });
+
+  // small tiles, so that there are many tile borders
+  ActualArray3D<vec3f> gradient(dims);
+  applyStencil(
+      in,
+      gradient,
+      vec3i(1),
+      [](const StencilTile<float> &tile,
+         const vec3i &begin,
+         int count,
+         vec3f *out) {
+        const float *c     = tile.at(begin);
+        const ptrdiff_t sy = tile.stride(1), sz = tile.stride(2);
+        for (int x = 0; x < count; x++) {
+          out[x] = .5f * vec3f(c[x + 1] - c[x - 1],
+                               c[x + sy] - c[x - sy],
+                               c[x + sz] - c[x - sz]);
+        }
+      },
+      vec3i(16, 8, 4));
+
+  for_each(dims, [&](const vec3i &idx) {
+    auto at = [&](const vec3i &d) {
+      return in.get(clamp(idx + d, vec3i(0), dims - 1));
+    };
+    const vec3f expected(at(vec3i(1, 0, 0)) - at(vec3i(-1, 0, 0)),
+                         at(vec3i(0, 1, 0)) - at(vec3i(0, -1, 0)),
+                         at(vec3i(0, 0, 1)) - at(vec3i(0, 0, -1)));
+    REQUIRE(gradient.get(idx) == .5f * expected);
+  });
+
+  ActualArray3D<vec3f> wrongSize(dims - 1);
+  CHECK_THROWS(applyStencil(
+      in,
+      wrongSize,
+      vec3i(1),
+      [](const StencilTile<float> &, const vec3i &, int, vec3f *) {}));
+}
+
+TEST_CASE("Stencil dilation", "[Stencil]")
+{
+  ActualArray3D<uint8_t> in(dims);
+  in.clear(0);
+  in.set(vec3i(40, 20, 10), 255);
+  in.set(vec3i(0, 0, 0), 100);
+
+  PingPongBuffers<uint8_t> buffers(dims);
+  std::copy(in.value, in.value + in.numElements(), buffers.back().value);
+  buffers.swap();
+
+  // three steps of a 6-neighborhood max grow diamonds of radius 3
+  for (int step = 0; step < 3; step++) {
+    applyStencil(buffers.front(),
+                 buffers.back(),
+                 vec3i(1),
+                 [](const StencilTile<uint8_t> &tile,
+                    const vec3i &begin,
+                    int count,
+                    uint8_t *out) {
+                   const uint8_t *c = tile.at(begin);
+                   const ptrdiff_t s[3] = {1, tile.stride(1), tile.stride(2)};
+                   for (int x = 0; x < count; x++) {
+                     uint8_t v = c[x];
+                     for (int a = 0; a < 3; a++)
+                       v = std::max(v, std::max(c[x - s[a]], c[x + s[a]]));
+                     out[x] = v;
+                   }
+                 });
+    buffers.swap();
+  }
+
+  for_each(dims, [&](const vec3i &idx) {
+    const vec3i d = idx - vec3i(40, 20, 10);
+    const int expected =
+        std::abs(d.x) + std::abs(d.y) + std::abs(d.z) <= 3
+            ? 255
+            : idx.x + idx.y + idx.z <= 3 ? 100 : 0;
+    REQUIRE(int(buffers.front().get(idx)) == expected);
+  });
+}
+
+TEST_CASE("Stencil separable convolution", "[Stencil]")
+{
+  ActualArray3D<float> in(dims);
+  for_each(dims, [&](const vec3i &idx) { in.set(idx, valueAt(idx)); });
+
+  const std::vector<float> w = gaussianWeights(1.5f, 3);
+  REQUIRE(w.size() == 7);
+  CHECK(std::accumulate(w.begin(), w.end(), 0.f) == Approx(1.f));
+  CHECK(w[3] > w[2]);
+
+  ActualArray3D<float> out(dims);
+  convolveSeparable(in, out, w);
+  for_each(dims, [&](const vec3i &idx) {
+    REQUIRE(out.get(idx) == Approx(convolveNaive(in, idx, w)).margin(1e-4));
+  });
+
+  // different kernels per axis; a single weight leaves the axis alone
+  convolveSeparable(in, out, {.25f, .5f, .25f}, {1.f}, {1.f});
+  for_each(dims, [&](const vec3i &idx) {
+    const vec3i left  = max(idx - vec3i(1, 0, 0), vec3i(0));
+    const vec3i right = min(idx + vec3i(1, 0, 0), dims - 1);
+    const float expected =
+        .25f * in.get(left) + .5f * in.get(idx) + .25f * in.get(right);
+    REQUIRE(out.get(idx) == Approx(expected));
+  });
+
+  // integers round once, at the end
+  ActualArray3D<uint8_t> bytes(dims), smoothed(dims);
+  for_each(dims, [&](const vec3i &idx) {
+    bytes.set(idx, uint8_t(valueAt(idx) + 50.f));
+  });
+  const std::vector<float> box(3, 1.f / 3.f);
+  convolveSeparable(bytes, smoothed, box);
+  ActualArray3D<float> floats(dims);
+  for_each(dims, [&](const vec3i &idx) {
+    floats.set(idx, float(bytes.get(idx)));
+  });
+  for_each(dims, [&](const vec3i &idx) {
+    REQUIRE(std::abs(smoothed.get(idx) - convolveNaive(floats, idx, box))
+            <= .5001f);
+  });
+
+  CHECK_THROWS(convolveSeparable(in, out, {.5f, .5f}));
+}
@@ -1,5 +1,70 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/array3D/for_each.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::array3D;
+
+TEST_CASE("parallel_for_each 3D", "[for_each]")
+{
+  const vec3i lower(1, 2, 3);
+  const vec3i upper(37, 21, 18);
+  const vec3i dims = upper + 1;
+
+  std::vector<int> counts(longProduct(dims), 0);
+
+  parallel_for_each(lower, upper, vec3i(8), [&](const vec3i &idx) {
+    counts[longIndex(idx, dims)]++;
+  });
+
+  size_t visited = 0;
+  for_each(dims, [&](const vec3i &idx) {
+    const bool inside = !anyLessThan(idx, lower) && anyLessThan(idx, upper) &&
+                        !anyLessThan(upper, idx + 1);
+    const int count = counts[longIndex(idx, dims)];
+    REQUIRE(count == (inside ? 1 : 0));
+    visited += count;
+  });
+
+  REQUIRE(visited == longProduct(upper - lower));
+}
+
+TEST_CASE("parallel_for_each 2D", "[for_each]")
+{
+  const vec2i size(123, 45);
+
+  std::vector<int> counts(size.long_product(), 0);
+
+  parallel_for_each(vec2i(0), size, vec2i(16, 4), [&](const vec2i &idx) {
+    counts[idx.x + size_t(size.x) * idx.y]++;
+  });
+
+  REQUIRE(std::count(counts.begin(), counts.end(), 1) == ptrdiff_t(counts.size()));
+}
+
+TEST_CASE("parallel_for_tiled tiles", "[for_each]")
+{
+  std::atomic<int> numTiles{0};
+  std::atomic<long> numVoxels{0};
+
+  tasking::parallel_for_tiled(
+      vec3i(0), vec3i(33, 16, 17), vec3i(16), [&](const box3i &tile) {
+        numTiles++;
+        numVoxels += tile.size().long_product();
+      });
+
+  REQUIRE(numTiles == 3 * 1 * 2);
+  REQUIRE(numVoxels == 33 * 16 * 17);
+
+  tasking::parallel_for_tiled(
+      vec3i(4), vec3i(4, 8, 8), vec3i(2), [&](const box3i &) { numTiles++; });
+
+  REQUIRE(numTiles == 3 * 1 * 2);
+}
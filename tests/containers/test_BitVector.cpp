@@ -0,0 +1,152 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/containers/BitVector.h"
+
+#include <atomic>
+#include <vector>
+
+using rkcommon::containers::BitVector;
+
+TEST_CASE("BitVector single bits", "[BitVector]")
+{
+  BitVector b(130);
+  REQUIRE(b.size() == 130);
+  REQUIRE(b.numWords() == 3);
+  REQUIRE(b.none());
+
+  b.set(0);
+  b.set(64);
+  b.set(129, true);
+  b.flip(5);
+  REQUIRE(b[0]);
+  REQUIRE(b.test(5));
+  REQUIRE(b[64]);
+  REQUIRE(b[129]);
+  REQUIRE(!b[1]);
+  REQUIRE(b.count() == 4);
+
+  b.reset(5);
+  REQUIRE(!b[5]);
+  REQUIRE(b.count() == 3);
+
+  REQUIRE_THROWS_AS(b.test(130), std::out_of_range);
+}
+
+TEST_CASE("BitVector whole vector operations", "[BitVector]")
+{
+  BitVector b(100);
+  b.set();
+  REQUIRE(b.all());
+  REQUIRE(b.count() == 100);
+  // the bits past size() stay zero
+  REQUIRE(b.data()[1] == (uint64_t(1) << 36) - 1);
+
+  b.flip();
+  REQUIRE(b.none());
+
+  BitVector ones(70, true);
+  REQUIRE(ones.count() == 70);
+  ones.resize(200, true);
+  REQUIRE(ones.count() == 200);
+  ones.resize(10);
+  REQUIRE(ones.count() == 10);
+  ones.resize(100);
+  REQUIRE(ones.count() == 10);
+}
+
+TEST_CASE("BitVector count matches a reference", "[BitVector]")
+{
+  for (size_t n : {0, 1, 63, 64, 65, 200, 1000, 4099}) {
+    BitVector b(n);
+    size_t expected = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if ((i * 7919) % 5 < 2) {
+        b.set(i);
+        expected++;
+      }
+    }
+    REQUIRE(b.count() == expected);
+  }
+}
+
+TEST_CASE("BitVector find_next_set", "[BitVector]")
+{
+  BitVector b(1000);
+  REQUIRE(b.find_first_set() == 1000);
+
+  const std::vector<size_t> bits = {3, 63, 64, 500, 999};
+  for (size_t i : bits)
+    b.set(i);
+
+  std::vector<size_t> found;
+  for (size_t i = b.find_first_set(); i < b.size(); i = b.find_next_set(i + 1))
+    found.push_back(i);
+  REQUIRE(found == bits);
+
+  REQUIRE(b.find_next_set(65) == 500);
+  REQUIRE(b.find_next_set(1000) == 1000);
+}
+
+TEST_CASE("BitVector bulk operations", "[BitVector]")
+{
+  const size_t N = 1000;
+  BitVector a(N), b(N);
+  for (size_t i = 0; i < N; ++i) {
+    a.set(i, i % 2 == 0);
+    b.set(i, i % 3 == 0);
+  }
+
+  const BitVector andBits = a & b;
+  const BitVector orBits  = a | b;
+  const BitVector xorBits = a ^ b;
+  BitVector andNotBits    = a;
+  andNotBits.andNot(b);
+
+  for (size_t i = 0; i < N; ++i) {
+    REQUIRE(andBits[i] == (i % 6 == 0));
+    REQUIRE(orBits[i] == (i % 2 == 0 || i % 3 == 0));
+    REQUIRE(xorBits[i] == ((i % 2 == 0) != (i % 3 == 0)));
+    REQUIRE(andNotBits[i] == (i % 2 == 0 && i % 3 != 0));
+  }
+
+  REQUIRE((a ^ a).none());
+  REQUIRE((a | a) == a);
+  REQUIRE(a != b);
+
+  BitVector other(N + 1);
+  REQUIRE_THROWS(a &= other);
+}
+
+TEST_CASE("BitVector parallel_for_each_set_bit", "[BitVector]")
+{
+  // dense at the start, sparse afterwards
+  const size_t N = 200000;
+  BitVector b(N);
+  for (size_t i = 0; i < 10000; ++i)
+    b.set(i);
+  for (size_t i = 10000; i < N; i += 1000)
+    b.set(i);
+
+  std::vector<std::atomic<int>> visits(N);
+  for (auto &v : visits)
+    v = 0;
+
+  b.parallel_for_each_set_bit([&](size_t i) { visits[i]++; });
+
+  size_t visited = 0;
+  bool correct   = true;
+  for (size_t i = 0; i < N; ++i) {
+    correct = correct && visits[i] == (b[i] ? 1 : 0);
+    visited += visits[i];
+  }
+  REQUIRE(correct);
+  REQUIRE(visited == b.count());
+
+  BitVector empty(N);
+  bool called = false;
+  empty.parallel_for_each_set_bit([&](size_t) { called = true; });
+  REQUIRE(!called);
+}
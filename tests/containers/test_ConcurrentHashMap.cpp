@@ -0,0 +1,123 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/containers/ConcurrentHashMap.h"
+// std
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace rkcommon::containers;
+
+TEST_CASE("ConcurrentHashMap insert, find and erase", "[ConcurrentHashMap]")
+{
+  ConcurrentHashMap<std::string, std::string> map;
+  CHECK(map.empty());
+  CHECK(map.find("a") == nullptr);
+
+  auto a = map.emplace("a", "alpha");
+  CHECK(a.first == "alpha");
+  CHECK(a.second);
+  CHECK(!map.emplace("a", "other").second);
+  CHECK(*map.find("a") == "alpha");
+  // the same object
+  CHECK(&a.first == map.find("a"));
+
+  auto b = map.insert_or_assign("b", "beta");
+  CHECK(b.second);
+  auto b2 = map.insert_or_assign("b", "bravo");
+  CHECK(!b2.second);
+  CHECK(b2.first == "bravo");
+  CHECK(*map.find("b") == "bravo");
+  CHECK(map.size() == 2);
+
+  CHECK(map.erase("a"));
+  CHECK(!map.erase("a"));
+  CHECK(!map.contains("a"));
+  CHECK(map.contains("b"));
+  CHECK(map.size() == 1);
+
+  map.clear();
+  CHECK(map.empty());
+  CHECK(map.find("b") == nullptr);
+}
+
+TEST_CASE("ConcurrentHashMap references survive growth", "[ConcurrentHashMap]")
+{
+  ConcurrentHashMap<int, int> map;
+  std::vector<const int *> refs;
+  for (int i = 0; i < 10000; i++)
+    refs.push_back(&map.emplace(i, 3 * i).first);
+
+  CHECK(map.size() == 10000);
+  for (int i = 0; i < 10000; i++) {
+    REQUIRE(map.find(i) == refs[i]);
+    REQUIRE(*refs[i] == 3 * i);
+  }
+
+  size_t visited = 0;
+  long sum       = 0;
+  map.for_each([&](int k, int v) {
+    visited++;
+    sum += v - 3 * k;
+  });
+  CHECK(visited == 10000);
+  CHECK(sum == 0);
+}
+
+TEST_CASE("ConcurrentHashMap concurrent readers and writers",
+          "[ConcurrentHashMap]")
+{
+  ConcurrentHashMap<int, std::string> map;
+  const int numKeys = 4096;
+  for (int i = 0; i < numKeys; i += 2)
+    map.emplace(i, std::to_string(i));
+
+  std::atomic<bool> stop(false);
+  std::atomic<int> wrong(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&]() {
+      while (!stop) {
+        for (int i = 0; i < numKeys; i++) {
+          auto guard          = map.pin();
+          const std::string *v = map.find(i);
+          // keys are either absent or have the right value
+          if (v && *v != std::to_string(i))
+            wrong++;
+          // even keys are never erased
+          if (i % 2 == 0 && !v)
+            wrong++;
+        }
+      }
+    });
+  }
+
+  // the odd keys come and go, while the table grows
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 2; t++) {
+    writers.emplace_back([&, t]() {
+      for (int round = 0; round < 20; round++) {
+        for (int i = 1 + 2 * t; i < numKeys; i += 4)
+          map.insert_or_assign(i, std::to_string(i));
+        for (int i = 1 + 2 * t; i < numKeys; i += 4)
+          map.erase(i);
+      }
+      for (int i = numKeys + t; i < 4 * numKeys; i += 2)
+        map.emplace(i, std::to_string(i));
+    });
+  }
+  for (auto &w : writers)
+    w.join();
+  stop = true;
+  for (auto &r : readers)
+    r.join();
+
+  CHECK(wrong == 0);
+  CHECK(map.size() == size_t(numKeys / 2 + 3 * numKeys));
+  for (int i = 1; i < numKeys; i += 2)
+    REQUIRE(!map.contains(i));
+}
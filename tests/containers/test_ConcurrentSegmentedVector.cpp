@@ -0,0 +1,104 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/containers/ConcurrentSegmentedVector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace rkcommon;
+using rkcommon::containers::ConcurrentSegmentedVector;
+
+TEST_CASE("ConcurrentSegmentedVector serial growth", "[ConcurrentSegmentedVector]")
+{
+  ConcurrentSegmentedVector<int, 4> v;
+  REQUIRE(v.empty());
+
+  std::vector<int *> addresses;
+  for (int i = 0; i < 1000; ++i) {
+    REQUIRE(v.push_back(i) == size_t(i));
+    addresses.push_back(&v.back());
+  }
+  REQUIRE(v.size() == 1000);
+
+  // growing never moves existing elements
+  for (int i = 0; i < 1000; ++i) {
+    REQUIRE(&v[i] == addresses[i]);
+    REQUIRE(v[i] == i);
+  }
+
+  const size_t first = v.grow_by(100, -1);
+  REQUIRE(first == 1000);
+  REQUIRE(v.size() == 1100);
+  REQUIRE(std::count(v.begin(), v.end(), -1) == 100);
+
+  // chunks cover all elements in order
+  size_t total = 0;
+  int expected = 0;
+  bool ordered = true;
+  v.forEachChunk([&](const int *begin, size_t count) {
+    for (size_t i = 0; i < count && expected < 1000; ++i)
+      ordered = ordered && begin[i] == expected++;
+    total += count;
+  });
+  REQUIRE(total == 1100);
+  REQUIRE(ordered);
+
+  v.clear();
+  REQUIRE(v.empty());
+  REQUIRE(v.begin() == v.end());
+}
+
+TEST_CASE("ConcurrentSegmentedVector destroys its elements",
+          "[ConcurrentSegmentedVector]")
+{
+  auto counter = std::make_shared<int>(0);
+  {
+    ConcurrentSegmentedVector<std::shared_ptr<int>> v;
+    v.grow_by(500, counter);
+    v.emplace_back(counter);
+    REQUIRE(counter.use_count() == 502);
+  }
+  REQUIRE(counter.use_count() == 1);
+}
+
+TEST_CASE("ConcurrentSegmentedVector parallel growth",
+          "[ConcurrentSegmentedVector]")
+{
+  ConcurrentSegmentedVector<int> v;
+
+  const int N     = 10000;
+  const int CHUNK = 7;
+
+  tasking::parallel_for(N, [&](int i) {
+    if (i % 2) {
+      v.push_back(i);
+    } else {
+      // each chunk is contiguous in index space
+      const size_t first = v.grow_by(CHUNK);
+      for (int c = 0; c < CHUNK; ++c)
+        v[first + c] = i;
+    }
+  });
+
+  const size_t expectedSize = N / 2 + (N / 2) * CHUNK;
+  REQUIRE(v.size() == expectedSize);
+
+  std::vector<int> counts(N, 0);
+  for (int i : v)
+    counts[i]++;
+  for (int i = 0; i < N; ++i)
+    REQUIRE(counts[i] == (i % 2 ? 1 : CHUNK));
+
+  std::atomic<long long> sum{0};
+  v.parallel_for_each([&](int &i) { sum += i; });
+
+  long long expectedSum = 0;
+  for (int i = 0; i < N; ++i)
+    expectedSum += (i % 2 ? 1 : CHUNK) * (long long)i;
+  REQUIRE(sum.load() == expectedSum);
+}
@@ -0,0 +1,105 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/containers/FlatHashMap.h"
+
+#include <map>
+#include <random>
+#include <string>
+
+using rkcommon::containers::FlatHashMap;
+
+TEST_CASE("FlatHashMap basic operations", "[FlatHashMap]")
+{
+  FlatHashMap<int, int> map;
+  REQUIRE(map.empty());
+  REQUIRE(!map.contains(1));
+  REQUIRE(map.find(1) == map.end());
+  REQUIRE(map.begin() == map.end());
+
+  map[1] = 10;
+  map[2] = 20;
+  REQUIRE(map.size() == 2);
+  REQUIRE(map.at(1) == 10);
+  REQUIRE(map.find(2)->second == 20);
+  REQUIRE_THROWS(map.at(3));
+
+  auto inserted = map.insert(std::make_pair(1, 30));
+  REQUIRE(!inserted.second);
+  REQUIRE(inserted.first->second == 10);
+
+  REQUIRE(map.erase(1));
+  REQUIRE(!map.erase(1));
+  REQUIRE(!map.contains(1));
+  REQUIRE(map.size() == 1);
+
+  map.clear();
+  REQUIRE(map.empty());
+  REQUIRE(!map.contains(2));
+}
+
+TEST_CASE("FlatHashMap matches std::map", "[FlatHashMap]")
+{
+  FlatHashMap<uint64_t, int> map;
+  std::map<uint64_t, int> reference;
+
+  std::mt19937 rng(42);
+  for (int i = 0; i < 100000; ++i) {
+    const uint64_t key = rng() % 5000;
+    if (rng() % 3 == 0) {
+      REQUIRE(map.erase(key) == (reference.erase(key) == 1));
+    } else {
+      map[key]       = i;
+      reference[key] = i;
+    }
+  }
+
+  REQUIRE(map.size() == reference.size());
+  for (const auto &item : reference)
+    REQUIRE(map.at(item.first) == item.second);
+
+  size_t visited = 0;
+  for (const auto &item : map) {
+    REQUIRE(reference.at(item.first) == item.second);
+    ++visited;
+  }
+  REQUIRE(visited == reference.size());
+}
+
+TEST_CASE("FlatHashMap heterogeneous string lookup", "[FlatHashMap]")
+{
+  FlatHashMap<std::string, int> map;
+  map["alpha"] = 1;
+  map["beta"]  = 2;
+
+  const char *key = "beta";
+  REQUIRE(map.contains(key));
+  REQUIRE(map.at(key) == 2);
+  REQUIRE(map.at("alpha") == 1);
+  REQUIRE(!map.contains("gamma"));
+  REQUIRE(map.erase("alpha"));
+  REQUIRE(!map.contains(std::string("alpha")));
+}
+
+TEST_CASE("FlatHashMap copy, move and reserve", "[FlatHashMap]")
+{
+  FlatHashMap<std::string, std::string> map;
+  map.reserve(1000);
+  const size_t capacity = map.capacity();
+  for (int i = 0; i < 1000; ++i)
+    map[std::to_string(i)] = std::to_string(i * 2);
+  REQUIRE(map.capacity() == capacity);
+
+  FlatHashMap<std::string, std::string> copy(map);
+  REQUIRE(copy.size() == 1000);
+  REQUIRE(copy.at("999") == "1998");
+
+  FlatHashMap<std::string, std::string> moved(std::move(map));
+  REQUIRE(moved.size() == 1000);
+  REQUIRE(moved.at("10") == "20");
+
+  copy = moved;
+  REQUIRE(copy.at("500") == "1000");
+}
@@ -7,6 +7,7 @@
 #include "rkcommon/containers/FlatMap.h"
 #undef private
 
+#include <cstdint>
 #include <string>
 
 using rkcommon::containers::FlatMap;
@@ -122,3 +123,74 @@ SCENARIO("FlatMap interface tests", "[FlatMap]")
     }
   }
 }
+
+TEST_CASE("FlatMap with sorted keys", "[FlatMap]")
+{
+  using rkcommon::containers::SortedKeys;
+
+  FlatMap<std::string, int, SortedKeys> fm;
+  fm["c"] = 3;
+  fm["a"] = 1;
+  fm["b"] = 2;
+  fm["a"] = 4;
+
+  REQUIRE(fm.size() == 3);
+  REQUIRE(fm.at_index(0).first == "a");
+  REQUIRE(fm.at_index(1).first == "b");
+  REQUIRE(fm.at_index(2).first == "c");
+  REQUIRE(fm.at("a") == 4);
+  REQUIRE(!fm.contains("d"));
+  REQUIRE_THROWS(fm.at("d"));
+
+  fm.erase("b");
+  REQUIRE(fm.size() == 2);
+  REQUIRE(!fm.contains("b"));
+  REQUIRE(fm.at_index(1).first == "c");
+}
+
+TEMPLATE_TEST_CASE(
+    "FlatMap with split keys", "[FlatMap]", int32_t, uint64_t, short)
+{
+  using rkcommon::containers::SplitKeys;
+
+  FlatMap<TestType, int, SplitKeys> fm;
+
+  // enough keys to use full SIMD vectors plus a scalar tail
+  const int N = 37;
+  for (int i = 0; i < N; ++i)
+    fm[TestType(i * 3)] = i;
+
+  REQUIRE(fm.size() == N);
+  for (int i = 0; i < N; ++i) {
+    REQUIRE(fm.contains(TestType(i * 3)));
+    REQUIRE(fm.at(TestType(i * 3)) == i);
+    REQUIRE(!fm.contains(TestType(i * 3 + 1)));
+  }
+
+  // insertion order is kept
+  REQUIRE(fm.at_index(5).first == TestType(15));
+
+  fm.erase(TestType(15));
+  REQUIRE(fm.size() == N - 1);
+  REQUIRE(!fm.contains(TestType(15)));
+  REQUIRE(fm.at(TestType(18)) == 6);
+  REQUIRE(fm.at_index(5).first == TestType(18));
+
+  fm.clear();
+  REQUIRE(fm.empty());
+  REQUIRE(!fm.contains(TestType(0)));
+}
+
+TEST_CASE("FlatMap with split pointer keys", "[FlatMap]")
+{
+  using rkcommon::containers::SplitKeys;
+
+  int objects[10];
+  FlatMap<const int *, int, SplitKeys> fm;
+  for (int i = 0; i < 10; ++i)
+    fm[&objects[i]] = i;
+
+  for (int i = 0; i < 10; ++i)
+    REQUIRE(fm.at(&objects[i]) == i);
+  REQUIRE(!fm.contains(nullptr));
+}
@@ -0,0 +1,142 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/containers/LRUCache.h"
+// std
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace rkcommon::containers;
+
+TEST_CASE("LRUCache evicts the least recently used", "[LRUCache]")
+{
+  // one shard, so that the order is global
+  LRUCache<int, int> cache(3 * sizeof(int), 1);
+  CHECK(cache.numShards() == 1);
+  CHECK(cache.memoryBudget() == 3 * sizeof(int));
+
+  cache.insert(1, 10);
+  cache.insert(2, 20);
+  cache.insert(3, 30);
+  CHECK(cache.size() == 3);
+  CHECK(cache.memoryBytes() == 3 * sizeof(int));
+
+  // 1 becomes the most recent, so 2 goes first
+  CHECK(*cache.get(1) == 10);
+  cache.insert(4, 40);
+  CHECK(!cache.contains(2));
+  CHECK(cache.get(2) == nullptr);
+  CHECK(cache.contains(1));
+  CHECK(cache.contains(3));
+  CHECK(cache.contains(4));
+
+  // replacing keeps the size
+  CHECK(*cache.insert(3, 31) == 31);
+  CHECK(*cache.get(3) == 31);
+  CHECK(cache.size() == 3);
+
+  const LRUCacheStats stats = cache.stats();
+  CHECK(stats.hits == 2);
+  CHECK(stats.misses == 1);
+  CHECK(stats.evictions == 1);
+  CHECK(stats.entries == 3);
+  CHECK(stats.bytes == 3 * sizeof(int));
+
+  cache.resetStats();
+  CHECK(cache.stats().hits == 0);
+  CHECK(cache.stats().entries == 3);
+
+  CHECK(cache.erase(4));
+  CHECK(!cache.erase(4));
+  CHECK(cache.size() == 2);
+  cache.clear();
+  CHECK(cache.size() == 0);
+  CHECK(cache.memoryBytes() == 0);
+
+  // no-op without RKCOMMON_ENABLE_PROFILING
+  cache.traceStatistics("testCache");
+}
+
+TEST_CASE("LRUCache memory budget", "[LRUCache]")
+{
+  using Blob = std::vector<char>;
+  LRUCache<int, Blob> cache(
+      1000, 4, [](const Blob &b) { return b.size(); });
+  CHECK(cache.numShards() == 4);
+
+  for (int i = 0; i < 100; i++) {
+    auto blob = cache.get_or_load(i, [](int k) { return Blob(50 + k % 7); });
+    REQUIRE(blob->size() == size_t(50 + i % 7));
+    REQUIRE(cache.memoryBytes() <= 1000);
+  }
+  CHECK(cache.size() < 100);
+  CHECK(cache.stats().evictions == 100 - cache.size());
+
+  // values handed out stay valid after eviction
+  auto held = cache.get_or_load(1000, [](int) { return Blob(10, 'x'); });
+  cache.clear();
+  CHECK((*held)[9] == 'x');
+
+  // a value larger than the budget of its shard is kept on its own
+  cache.insert(7, Blob(5000));
+  CHECK(cache.contains(7));
+  CHECK(cache.memoryBytes() == 5000);
+
+  // non-power of two shard counts round up
+  LRUCache<int, Blob> odd(1000, 5);
+  CHECK(odd.numShards() == 8);
+}
+
+TEST_CASE("LRUCache loads each key once under contention", "[LRUCache]")
+{
+  LRUCache<int, int> cache(1 << 20);
+  const int numKeys = 32;
+  std::vector<std::atomic<int>> loads(numKeys);
+  for (auto &l : loads)
+    l = 0;
+
+  std::vector<std::thread> threads;
+  std::atomic<int> wrong(0);
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 4 * numKeys; i++) {
+        const int key = i % numKeys;
+        auto v        = cache.get_or_load(key, [&](int k) {
+          loads[k]++;
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          return 3 * k;
+        });
+        if (*v != 3 * key)
+          wrong++;
+      }
+    });
+  }
+  for (auto &t : threads)
+    t.join();
+
+  CHECK(wrong == 0);
+  for (int k = 0; k < numKeys; k++)
+    CHECK(loads[k] == 1);
+
+  const LRUCacheStats stats = cache.stats();
+  CHECK(stats.hits + stats.misses == size_t(8 * 4 * numKeys));
+  CHECK(stats.entries == size_t(numKeys));
+}
+
+TEST_CASE("LRUCache loader exceptions", "[LRUCache]")
+{
+  LRUCache<int, int> cache(1024);
+  CHECK_THROWS_AS(cache.get_or_load(
+                      1, [](int) -> int { throw std::runtime_error("io"); }),
+                  std::runtime_error);
+  CHECK(!cache.contains(1));
+
+  // the next lookup loads again
+  CHECK(*cache.get_or_load(1, [](int) { return 5; }) == 5);
+  CHECK(*cache.get_or_load(1, [](int) { return 6; }) == 5);
+}
@@ -0,0 +1,125 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/containers/RingBuffer.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace rkcommon::containers;
+
+TEMPLATE_TEST_CASE("RingBuffer single threaded", "[RingBuffer]", SPSC, MPMC)
+{
+  RingBuffer<int, TestType> rb(5);
+  REQUIRE(rb.capacity() == 8);
+  REQUIRE(rb.empty());
+
+  for (int i = 0; i < 8; ++i)
+    REQUIRE(rb.try_push(i));
+  REQUIRE(!rb.try_push(8));
+  REQUIRE(rb.size() == 8);
+
+  int v = -1;
+  for (int i = 0; i < 8; ++i) {
+    REQUIRE(rb.try_pop(v));
+    REQUIRE(v == i);
+  }
+  REQUIRE(!rb.try_pop(v));
+  REQUIRE(rb.empty());
+
+  // bulk operations wrap around the end of the storage
+  const int in[6] = {10, 11, 12, 13, 14, 15};
+  REQUIRE(rb.try_push_n(in, 3) == 3);
+  REQUIRE(rb.try_push_n(in + 3, 3) == 3);
+  REQUIRE(rb.try_push_n(in, 6) == 2);
+
+  int out[10];
+  REQUIRE(rb.try_pop_n(out, 10) == 8);
+  REQUIRE(std::equal(in, in + 6, out));
+  REQUIRE(out[6] == 10);
+  REQUIRE(out[7] == 11);
+}
+
+TEST_CASE("RingBuffer owns its items", "[RingBuffer]")
+{
+  auto item = std::make_shared<int>(1);
+
+  {
+    RingBuffer<std::shared_ptr<int>, SPSC> rb(4);
+    rb.push(item);
+    rb.push(item);
+    REQUIRE(item.use_count() == 3);
+
+    auto popped = rb.pop();
+    REQUIRE(*popped == 1);
+  }
+
+  REQUIRE(item.use_count() == 1);
+}
+
+TEST_CASE("RingBuffer SPSC across threads", "[RingBuffer]")
+{
+  const int N_ITEMS = 100000;
+
+  RingBuffer<int, SPSC> rb(64);
+
+  std::thread producer([&]() {
+    for (int i = 0; i < N_ITEMS; ++i)
+      rb.push(i);
+  });
+
+  bool inOrder = true;
+  for (int i = 0; i < N_ITEMS; ++i)
+    inOrder &= rb.pop() == i;
+
+  producer.join();
+
+  REQUIRE(inOrder);
+  REQUIRE(rb.empty());
+}
+
+TEST_CASE("RingBuffer MPMC across threads", "[RingBuffer]")
+{
+  const int N_THREADS = 4;
+  const int N_ITEMS   = 20000;
+
+  RingBuffer<int, MPMC> rb(128);
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < N_THREADS; ++p) {
+    threads.emplace_back([&, p]() {
+      int batch[4];
+      for (int i = 0; i < N_ITEMS; i += 4) {
+        for (int j = 0; j < 4; ++j)
+          batch[j] = p * N_ITEMS + i + j;
+        size_t pushed = 0;
+        while (pushed < 4)
+          pushed += rb.try_push_n(batch + pushed, 4 - pushed);
+      }
+    });
+  }
+
+  std::vector<std::vector<int>> received(N_THREADS);
+  for (int c = 0; c < N_THREADS; ++c) {
+    threads.emplace_back([&, c]() {
+      for (int i = 0; i < N_ITEMS; ++i)
+        received[c].push_back(rb.pop());
+    });
+  }
+
+  for (auto &t : threads)
+    t.join();
+
+  std::vector<int> all;
+  for (auto &r : received)
+    all.insert(all.end(), r.begin(), r.end());
+  std::sort(all.begin(), all.end());
+
+  REQUIRE(all.size() == size_t(N_THREADS * N_ITEMS));
+  for (int i = 0; i < N_THREADS * N_ITEMS; ++i)
+    REQUIRE(all[i] == i);
+}
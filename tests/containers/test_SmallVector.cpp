@@ -0,0 +1,76 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/containers/SmallVector.h"
+
+#include <memory>
+#include <string>
+
+using rkcommon::containers::SmallVector;
+
+TEST_CASE("SmallVector stays inline up to N elements", "[SmallVector]")
+{
+  SmallVector<int, 4> v;
+  REQUIRE(v.empty());
+  REQUIRE(v.isSmall());
+  REQUIRE(v.capacity() == 4);
+
+  for (int i = 0; i < 4; ++i)
+    v.push_back(i);
+  REQUIRE(v.isSmall());
+  REQUIRE(v.size() == 4);
+
+  v.push_back(4);
+  REQUIRE(!v.isSmall());
+  REQUIRE(v.size() == 5);
+  for (int i = 0; i < 5; ++i)
+    REQUIRE(v[i] == i);
+
+  v.erase(v.begin() + 1);
+  REQUIRE(v == SmallVector<int, 4>({0, 2, 3, 4}));
+  REQUIRE_THROWS(v.at(4));
+
+  v.resize(2);
+  REQUIRE(v.back() == 2);
+  v.clear();
+  REQUIRE(v.empty());
+}
+
+TEST_CASE("SmallVector copy and move", "[SmallVector]")
+{
+  SmallVector<std::string, 2> small{"a", "b"};
+  SmallVector<std::string, 2> large{"a", "b", "c"};
+
+  SmallVector<std::string, 2> copy(large);
+  REQUIRE(copy == large);
+
+  SmallVector<std::string, 2> movedSmall(std::move(small));
+  REQUIRE(movedSmall.size() == 2);
+  REQUIRE(movedSmall[1] == "b");
+  REQUIRE(movedSmall.isSmall());
+
+  const std::string *heap = large.data();
+  SmallVector<std::string, 2> movedLarge(std::move(large));
+  REQUIRE(movedLarge.data() == heap);
+  REQUIRE(large.empty());
+
+  copy = movedSmall;
+  REQUIRE(copy == movedSmall);
+}
+
+TEST_CASE("SmallVector destroys its elements", "[SmallVector]")
+{
+  auto item = std::make_shared<int>(1);
+  {
+    SmallVector<std::shared_ptr<int>, 2> v;
+    for (int i = 0; i < 5; ++i)
+      v.emplace_back(item);
+    v.push_back(v.front());
+    REQUIRE(item.use_count() == 7);
+    v.pop_back();
+    REQUIRE(item.use_count() == 6);
+  }
+  REQUIRE(item.use_count() == 1);
+}
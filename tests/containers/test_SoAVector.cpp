@@ -0,0 +1,135 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/containers/SoAVector.h"
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+using rkcommon::containers::AlignedVector;
+using rkcommon::containers::SoAVector;
+
+template <typename VEC_T>
+static AlignedVector<VEC_T> makeAoS(size_t count)
+{
+  AlignedVector<VEC_T> aos(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto *v = &aos[i].x;
+    for (int c = 0; c < SoAVector<VEC_T>::NUM_COMPONENTS; ++c)
+      v[c] = typename VEC_T::scalar_t(i * 10 + c);
+  }
+  return aos;
+}
+
+template <typename VEC_T>
+static void testRoundTrip()
+{
+  // odd sizes exercise the scalar tail after the SIMD blocks
+  for (size_t count : {0, 1, 3, 4, 7, 64, 67}) {
+    const auto aos = makeAoS<VEC_T>(count);
+
+    SoAVector<VEC_T> soa;
+    soa.gather(aos);
+    REQUIRE(soa.size() == count);
+
+    for (size_t i = 0; i < count; ++i) {
+      for (int c = 0; c < SoAVector<VEC_T>::NUM_COMPONENTS; ++c)
+        REQUIRE(soa.data(c)[i] == (&aos[i].x)[c]);
+    }
+
+    AlignedVector<VEC_T> out;
+    soa.scatter(out);
+    REQUIRE(out.size() == count);
+    for (size_t i = 0; i < count; ++i) {
+      for (int c = 0; c < SoAVector<VEC_T>::NUM_COMPONENTS; ++c)
+        REQUIRE((&out[i].x)[c] == (&aos[i].x)[c]);
+    }
+  }
+}
+
+TEST_CASE("SoAVector gather/scatter round trip", "[SoAVector]")
+{
+  testRoundTrip<vec2f>();
+  testRoundTrip<vec3f>();
+  testRoundTrip<vec3fa>();
+  testRoundTrip<vec4f>();
+  testRoundTrip<vec3i>();
+  testRoundTrip<vec4d>();
+}
+
+TEST_CASE("SoAVector proxy references", "[SoAVector]")
+{
+  SoAVector<vec3f> v(4, vec3f(1.f, 2.f, 3.f));
+  REQUIRE(v.size() == 4);
+  REQUIRE(vec3f(v[3]) == vec3f(1.f, 2.f, 3.f));
+
+  v[1] = vec3f(4.f, 5.f, 6.f);
+  REQUIRE(v.data(0)[1] == 4.f);
+  REQUIRE(v.data(1)[1] == 5.f);
+  REQUIRE(v.data(2)[1] == 6.f);
+
+  v[2].y = 7.f;
+  REQUIRE(v.data(1)[2] == 7.f);
+
+  // assigning one proxy to another copies the values
+  v[0] = v[1];
+  REQUIRE(vec3f(v[0]) == vec3f(4.f, 5.f, 6.f));
+  REQUIRE(vec3f(v[1]) == vec3f(4.f, 5.f, 6.f));
+
+  const auto &cv = v;
+  vec3f sum      = vec3f(0.f);
+  for (size_t i = 0; i < cv.size(); ++i)
+    sum += vec3f(cv[i]);
+  REQUIRE(sum == vec3f(10.f, 19.f, 18.f));
+
+  v.push_back(vec3f(8.f));
+  REQUIRE(v.size() == 5);
+  REQUIRE(v.at(4).z == 8.f);
+  REQUIRE_THROWS_AS(v.at(5), std::out_of_range);
+
+  v.pop_back();
+  REQUIRE(v.size() == 4);
+  v.clear();
+  REQUIRE(v.empty());
+}
+
+TEST_CASE("SoAVector component streams", "[SoAVector]")
+{
+  SoAVector<vec4f> v;
+  v.gather(makeAoS<vec4f>(100));
+
+  for (int c = 0; c < 4; ++c)
+    REQUIRE(memory::isAligned(v.data(c)));
+
+  // scale all x's through the ArrayView
+  auto xs = v.component(0);
+  REQUIRE(xs.size() == 100);
+  for (auto &x : xs)
+    x *= 2.f;
+  REQUIRE(v[10].x == 200.f);
+
+  auto ws = v.componentView(3);
+  REQUIRE(ws[10] == 103.f);
+}
+
+TEST_CASE("SoAVector gather from a strided DataView", "[SoAVector]")
+{
+  struct Vertex
+  {
+    vec3f position;
+    vec2f texcoord;
+  };
+
+  std::vector<Vertex> vertices(10);
+  for (size_t i = 0; i < vertices.size(); ++i)
+    vertices[i] = {vec3f(float(i), float(i + 1), float(i + 2)), vec2f(-1.f)};
+
+  utility::DataView<vec3f> positions(&vertices[0].position, sizeof(Vertex));
+
+  SoAVector<vec3f> v;
+  v.gather(positions, vertices.size());
+  REQUIRE(v.size() == 10);
+  for (size_t i = 0; i < v.size(); ++i)
+    REQUIRE(vec3f(v[i]) == vertices[i].position);
+}
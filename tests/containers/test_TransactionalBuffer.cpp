@@ -3,10 +3,16 @@
 
 #include "../catch.hpp"
 
+// ahead of the define, which must only open up TransactionalBuffer
+#include "rkcommon/memory/malloc.h"
 #define private public
 #include "rkcommon/containers/TransactionalBuffer.h"
 #undef private
 
+#include <algorithm>
+#include <memory>
+#include <thread>
+
 using rkcommon::containers::TransactionalBuffer;
 
 SCENARIO("TransactionalBuffer interface tests", "[TransactionalBuffer]")
@@ -45,3 +51,79 @@ SCENARIO("TransactionalBuffer interface tests", "[TransactionalBuffer]")
     }
   }
 }
+
+TEST_CASE("TransactionalBuffer consume reuses storage", "[TransactionalBuffer]")
+{
+  TransactionalBuffer<int> tb;
+
+  std::vector<int> recycled;
+  recycled.reserve(100);
+  const int *storage = recycled.data();
+
+  tb.push_back(1);
+  auto first = tb.consume();
+  REQUIRE(first.size() == 1);
+
+  // the buffer now continues in 'recycled'
+  tb.consume(std::move(recycled));
+  tb.push_back(2);
+  REQUIRE(tb.buffer.data() == storage);
+
+  auto second = tb.consume(std::move(first));
+  REQUIRE(second.size() == 1);
+  REQUIRE(second[0] == 2);
+  REQUIRE(tb.empty());
+}
+
+TEST_CASE("MPSCTransactionalBuffer", "[TransactionalBuffer]")
+{
+  using rkcommon::containers::MPSCTransactionalBuffer;
+
+  const int N_PRODUCERS = 8;
+  const int N_ITEMS     = 10000;
+
+  MPSCTransactionalBuffer<int> tb;
+  REQUIRE(tb.empty());
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < N_PRODUCERS; ++p) {
+    producers.emplace_back([&, p]() {
+      for (int i = 0; i < N_ITEMS; ++i)
+        tb.push_back(p * N_ITEMS + i);
+    });
+  }
+
+  // consume concurrently with the producers
+  std::vector<int> all;
+  std::vector<int> batch;
+  while (all.size() < size_t(N_PRODUCERS * N_ITEMS)) {
+    batch = tb.consume(std::move(batch));
+    all.insert(all.end(), batch.begin(), batch.end());
+  }
+
+  for (auto &t : producers)
+    t.join();
+
+  REQUIRE(tb.empty());
+  REQUIRE(tb.consume().empty());
+
+  std::sort(all.begin(), all.end());
+  for (int i = 0; i < N_PRODUCERS * N_ITEMS; ++i)
+    REQUIRE(all[i] == i);
+}
+
+TEST_CASE("MPSCTransactionalBuffer keeps per producer order",
+          "[TransactionalBuffer]")
+{
+  using rkcommon::containers::MPSCTransactionalBuffer;
+
+  MPSCTransactionalBuffer<std::unique_ptr<int>> tb;
+  for (int i = 0; i < 100; ++i)
+    tb.push_back(std::unique_ptr<int>(new int(i)));
+  REQUIRE(tb.size() == 100);
+
+  auto v = tb.consume();
+  REQUIRE(v.size() == 100);
+  for (int i = 0; i < 100; ++i)
+    REQUIRE(*v[i] == i);
+}
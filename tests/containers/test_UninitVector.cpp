@@ -0,0 +1,49 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/containers/UninitVector.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace rkcommon;
+using rkcommon::containers::UninitVector;
+
+TEST_CASE("UninitVector does not zero fill on resize", "[UninitVector]")
+{
+  UninitVector<int> v(100, 7);
+  REQUIRE(memory::isAligned(v.data()));
+
+  // shrinking keeps the capacity, so growing again reuses the old elements
+  v.resize(10);
+  v.resize(100);
+  REQUIRE(std::count(v.begin(), v.end(), 7) == 100);
+
+  // non-trivial types are still constructed
+  UninitVector<std::string> s;
+  s.resize(3);
+  REQUIRE(s[2].empty());
+  s.emplace_back("x");
+  REQUIRE(s.back() == "x");
+}
+
+TEST_CASE("UninitVector backed by huge pages", "[UninitVector]")
+{
+  const size_t N = (size_t(8) << 20) / sizeof(float);
+
+  UninitVector<float, memory::HugePages::ADVISED> transparent(N);
+  std::fill(transparent.begin(), transparent.end(), 1.f);
+  REQUIRE(std::count(transparent.begin(), transparent.end(), 1.f)
+          == ptrdiff_t(N));
+
+  // falls back to advised huge pages without a reserved pool
+  UninitVector<float, memory::HugePages::RESERVED> explicitPages(N, 2.f);
+  REQUIRE(explicitPages[N - 1] == 2.f);
+
+  // small allocations use alignedMalloc()
+  UninitVector<float, memory::HugePages::RESERVED> small(16, 3.f);
+  REQUIRE(memory::isAligned(small.data()));
+  REQUIRE(small[15] == 3.f);
+}
@@ -1,5 +1,58 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/math/AffineSpace.h"
+
+using namespace rkcommon::math;
+
+template <typename BOX_T, typename AFFINE_T>
+static BOX_T xfmCorners(const AFFINE_T &m, const BOX_T &b)
+{
+  BOX_T dst(empty);
+  for (int i = 0; i < 8; ++i) {
+    const typename BOX_T::bound_t corner(i & 1 ? b.upper.x : b.lower.x,
+                                         i & 2 ? b.upper.y : b.lower.y,
+                                         i & 4 ? b.upper.z : b.lower.z);
+    dst.extend(xfmPoint(m, corner));
+  }
+  return dst;
+}
+
+template <typename BOX_T>
+static void checkNear(const BOX_T &a, const BOX_T &b)
+{
+  for (int i = 0; i < 3; ++i) {
+    CHECK(a.lower[i] == Approx(b.lower[i]).margin(1e-5));
+    CHECK(a.upper[i] == Approx(b.upper[i]).margin(1e-5));
+  }
+}
+
+template <typename BOX_T, typename AFFINE_T>
+static void test_xfmBounds()
+{
+  using V = typename BOX_T::bound_t;
+
+  const AFFINE_T xfm = AFFINE_T::translate(V(1.f, -2.f, 3.f)) *
+                       AFFINE_T::rotate(V(1.f, 1.f, 0.f), .7f) *
+                       AFFINE_T::scale(V(2.f, -.5f, 1.5f));
+
+  const BOX_T boxes[] = {BOX_T(V(-1.f), V(1.f)),
+                         BOX_T(V(0.f, 1.f, 2.f), V(3.f, 4.f, 5.f)),
+                         BOX_T(V(-2.f, 0.f, 1.f), V(-1.f, 0.f, 1.f)),
+                         BOX_T(V(4.f), V(4.f))};
+
+  for (const auto &b : boxes)
+    checkNear(xfmBounds(xfm, b), xfmCorners(xfm, b));
+
+  CHECK(xfmBounds(xfm, BOX_T(empty)).empty());
+  CHECK(xfmBounds(AFFINE_T(one), boxes[1]) == boxes[1]);
+}
+
+TEST_CASE("xfmBounds() matches the bounds of the transformed corners",
+          "[AffineSpace]")
+{
+  test_xfmBounds<box3f, AffineSpace3f>();
+  test_xfmBounds<box3fa, AffineSpace3fa>();
+}
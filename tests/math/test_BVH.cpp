@@ -0,0 +1,257 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/BVH.h"
+// std
+#include <algorithm>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+
+static std::vector<box3f> testBoxes(size_t n, float offset = 0.f)
+{
+  std::vector<box3f> boxes(n);
+  uint32_t state = 12345;
+  auto rnd       = [&]() {
+    state = state * 1664525u + 1013904223u;
+    return float(state >> 8) / float(1 << 24);
+  };
+  for (size_t i = 0; i < n; ++i) {
+    const vec3f p(100.f * rnd() + offset, 100.f * rnd(), 10.f * rnd());
+    boxes[i] = box3f(p, p + vec3f(rnd(), 2.f * rnd(), rnd()));
+  }
+  return boxes;
+}
+
+static std::vector<uint32_t> bruteForceQuery(const std::vector<box3f> &boxes,
+                                             const box3f &q)
+{
+  std::vector<uint32_t> result;
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    if (touchingOrOverlapping(boxes[i], q))
+      result.push_back(uint32_t(i));
+  }
+  return result;
+}
+
+static std::vector<uint32_t> bvhQuery(const BVH &bvh, const box3f &q)
+{
+  std::vector<uint32_t> result;
+  bvh.query(q, [&](uint32_t primID) { result.push_back(primID); });
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// Closest box along the ray, by entry distance
+static uint32_t bruteForcePick(const std::vector<box3f> &boxes,
+                               const vec3f &org,
+                               const vec3f &dir)
+{
+  uint32_t hit = BVH::INVALID;
+  float tHit   = inf;
+  for (size_t i = 0; i < boxes.size(); ++i) {
+    const range1f t = intersectRayBox(org, dir, boxes[i]);
+    if (!t.empty() && t.lower < tHit) {
+      hit  = uint32_t(i);
+      tHit = t.lower;
+    }
+  }
+  return hit;
+}
+
+static uint32_t bvhPick(const BVH &bvh,
+                        const std::vector<box3f> &boxes,
+                        const vec3f &org,
+                        const vec3f &dir)
+{
+  uint32_t hit = BVH::INVALID;
+  range1f tRange(0.f, inf);
+  bvh.intersect(org, dir, tRange, [&](uint32_t primID, range1f &t) {
+    const range1f tBox = intersectRayBox(org, dir, boxes[primID], t);
+    if (!tBox.empty() && (tBox.lower < t.upper || hit == BVH::INVALID)) {
+      hit     = primID;
+      t.upper = tBox.lower;
+    }
+  });
+  return hit;
+}
+
+static void checkStructure(const BVH &bvh,
+                           const std::vector<box3f> &boxes,
+                           int maxLeafSize)
+{
+  const auto &nodes = bvh.nodes();
+  REQUIRE(!nodes.empty());
+  CHECK(reinterpret_cast<uintptr_t>(nodes.data()) % 64 == 0);
+
+  std::vector<int> seen(boxes.size(), 0);
+  for (size_t n = 0; n < nodes.size(); ++n) {
+    for (int i = 0; i < BVH::WIDTH; ++i) {
+      if (nodes[n].child[i] == BVH::INVALID)
+        continue;
+      const box3f b = nodes[n].childBounds(i);
+      if (nodes[n].count[i] == 0) {
+        CHECK(nodes[n].child[i] > n);
+        CHECK(nodes[nodes[n].child[i]].bounds() == b);
+      } else {
+        CHECK(nodes[n].count[i] <= uint32_t(maxLeafSize));
+        box3f leaf(empty);
+        for (uint32_t p = 0; p < nodes[n].count[i]; ++p) {
+          const uint32_t id = bvh.primIDs()[nodes[n].child[i] + p];
+          leaf.extend(boxes[id]);
+          seen[id]++;
+        }
+        CHECK(leaf == b);
+      }
+    }
+  }
+
+  CHECK(std::count(seen.begin(), seen.end(), 1) == long(boxes.size()));
+}
+
+static void checkQueries(const BVH &bvh, const std::vector<box3f> &boxes)
+{
+  CHECK(bvh.numPrimitives() == boxes.size());
+
+  box3f all(empty);
+  for (const auto &b : boxes)
+    all.extend(b);
+  CHECK(bvh.bounds() == all);
+
+  for (int i = 0; i < 20; ++i) {
+    const vec3f p(5.f * i, 97.f - 4.f * i, 5.f);
+    const box3f q(p, p + vec3f(3.f + i, 2.f, 1.f));
+    CHECK(bvhQuery(bvh, q) == bruteForceQuery(boxes, q));
+  }
+
+  for (int i = 0; i < 20; ++i) {
+    const vec3f org(-10.f, 3.f + 4.5f * i, 5.f);
+    const vec3f dir(1.f, .1f * (i % 5) - .2f, .01f * i);
+    CHECK(bvhPick(bvh, boxes, org, dir) == bruteForcePick(boxes, org, dir));
+  }
+}
+
+TEST_CASE("BVH empty", "[BVH]")
+{
+  BVH bvh;
+  CHECK(bvh.empty());
+
+  bvh.build(nullptr, 0);
+  CHECK(bvh.empty());
+  CHECK(bvh.bounds().empty());
+
+  int calls = 0;
+  range1f t(0.f, inf);
+  bvh.query(box3f(vec3f(0.f), vec3f(1.f)), [&](uint32_t) { calls++; });
+  bvh.intersect(
+      vec3f(0.f), vec3f(1.f), t, [&](uint32_t, range1f &) { calls++; });
+  CHECK(calls == 0);
+}
+
+TEST_CASE("BVH few primitives", "[BVH]")
+{
+  const std::vector<box3f> boxes = testBoxes(3);
+  BVH bvh(boxes.data(), boxes.size());
+  CHECK(bvh.numNodes() == 1);
+  checkStructure(bvh, boxes, 4);
+  checkQueries(bvh, boxes);
+}
+
+TEST_CASE("BVH build", "[BVH]")
+{
+  const std::vector<box3f> boxes = testBoxes(20000);
+
+  BVHBuildSettings settings;
+  SECTION("SAH, serial")
+  {
+    settings.parallel = false;
+  }
+  SECTION("SAH, parallel") {}
+  SECTION("SAH, large leaves")
+  {
+    settings.maxLeafSize = 16;
+    settings.numBins     = 64;
+  }
+  SECTION("Morton")
+  {
+    settings.mortonPresort = true;
+  }
+
+  BVH bvh(boxes.data(), boxes.size(), settings);
+  checkStructure(bvh, boxes, settings.maxLeafSize);
+  checkQueries(bvh, boxes);
+}
+
+TEST_CASE("BVH identical primitives", "[BVH]")
+{
+  const std::vector<box3f> boxes(1000, box3f(vec3f(1.f), vec3f(2.f)));
+
+  BVHBuildSettings settings;
+  SECTION("SAH") {}
+  SECTION("Morton")
+  {
+    settings.mortonPresort = true;
+  }
+
+  BVH bvh(boxes.data(), boxes.size(), settings);
+  checkStructure(bvh, boxes, settings.maxLeafSize);
+  CHECK(bvhQuery(bvh, box3f(vec3f(0.f), vec3f(1.f))).size() == 1000);
+  CHECK(bvhQuery(bvh, box3f(vec3f(3.f), vec3f(4.f))).empty());
+}
+
+TEST_CASE("BVH refit", "[BVH]")
+{
+  const std::vector<box3f> boxes = testBoxes(5000);
+  BVH bvh(boxes.data(), boxes.size());
+
+  // the same boxes, moved far along x
+  const std::vector<box3f> moved = testBoxes(5000, 1000.f);
+  bvh.refit(moved.data());
+
+  checkStructure(bvh, moved, 4);
+  checkQueries(bvh, moved);
+  CHECK(!bvhQuery(bvh, box3f(vec3f(1000.f, 0.f, 0.f), vec3f(1100.f))).empty());
+  CHECK(bvhQuery(bvh, box3f(vec3f(0.f), vec3f(100.f))).empty());
+}
+
+TEST_CASE("BVH batched queries", "[BVH]")
+{
+  const std::vector<box3f> boxes = testBoxes(10000);
+  BVH bvh(boxes.data(), boxes.size());
+
+  const size_t n = 500;
+  std::vector<box3f> queries(n);
+  std::vector<vec3f> orgs(n), dirs(n);
+  std::vector<range1f> tRanges(n, range1f(0.f, inf));
+  for (size_t i = 0; i < n; ++i) {
+    const vec3f p(.2f * i, 100.f - .2f * i, 5.f);
+    queries[i] = box3f(p, p + vec3f(1.f));
+    orgs[i]    = vec3f(-1.f, .2f * i, 5.f);
+    dirs[i]    = vec3f(1.f, .001f * i, 0.f);
+  }
+
+  std::vector<size_t> counts(n, 0);
+  bvh.query(queries.data(), n, [&](size_t i, uint32_t) { counts[i]++; });
+
+  std::vector<uint32_t> hits(n, BVH::INVALID);
+  bvh.intersect(orgs.data(),
+                dirs.data(),
+                tRanges.data(),
+                n,
+                [&](size_t i, uint32_t primID, range1f &t) {
+                  const range1f tBox =
+                      intersectRayBox(orgs[i], dirs[i], boxes[primID], t);
+                  if (!tBox.empty()) {
+                    hits[i]  = primID;
+                    t.upper = tBox.lower;
+                  }
+                });
+
+  for (size_t i = 0; i < n; ++i) {
+    CHECK(counts[i] == bruteForceQuery(boxes, queries[i]).size());
+    CHECK(hits[i] == bvhPick(bvh, boxes, orgs[i], dirs[i]));
+  }
+}
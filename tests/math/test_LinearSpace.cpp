@@ -75,6 +75,54 @@ TEST_CASE("linear space functions", "[linear]")
   }
 }
 
+TEST_CASE("single precision det(), inverse() and transposed()", "[linear]")
+{
+  // the generic code in double precision as the reference
+  const LinearSpace3<vec3d> ref(
+      vec3d(2, -1, .5), vec3d(.25, 3, 1), vec3d(-1, .5, 4));
+  const LinearSpace3<vec3d> refInverse = ref.inverse();
+
+  auto checkNear = [](const vec3f &a, const vec3d &b) {
+    CHECK(a.x == Approx(b.x).margin(1e-6));
+    CHECK(a.y == Approx(b.y).margin(1e-6));
+    CHECK(a.z == Approx(b.z).margin(1e-6));
+  };
+
+  SECTION("LinearSpace3f")
+  {
+    const linear3f l(ref);
+    CHECK(l.det() == Approx(ref.det()));
+    const linear3f inv = l.inverse();
+    checkNear(inv.vx, refInverse.vx);
+    checkNear(inv.vy, refInverse.vy);
+    checkNear(inv.vz, refInverse.vz);
+    CHECK(l.transposed() == linear3f(ref.transposed()));
+  }
+
+  SECTION("LinearSpace3fa")
+  {
+    const LinearSpace3fa l(ref);
+    CHECK(l.det() == Approx(ref.det()));
+    const LinearSpace3fa inv = l.inverse();
+    checkNear(inv.vx, refInverse.vx);
+    checkNear(inv.vy, refInverse.vy);
+    checkNear(inv.vz, refInverse.vz);
+    CHECK(l.transposed() == LinearSpace3fa(ref.transposed()));
+  }
+
+  SECTION("rcpOrthonormal")
+  {
+    const linear3f r = linear3f::rotate(vec3f(1.f, 2.f, 3.f), .5f);
+    CHECK(rcpOrthonormal(r) == r.transposed());
+    const linear3f i = rcpOrthonormal(r) * r;
+    CHECK(i.vx.x == Approx(1.f));
+    CHECK(i.vy.y == Approx(1.f));
+    CHECK(i.vz.z == Approx(1.f));
+    CHECK(i.vx.y == Approx(0.f).margin(1e-6));
+    CHECK(i.vz.x == Approx(0.f).margin(1e-6));
+  }
+}
+
 TEST_CASE("linear space constants", "[linear]")
 {
   SECTION("scale")
@@ -190,6 +190,16 @@ inline void test_slerp()
   REQUIRE(CmpT(slerp(.5f, T(1, 0, 0, 0), T(0, 1, 0, 0)), T(rsqrt(two), rsqrt(two), 0, 0)));
 }
 
+template <typename T>
+inline void test_nlerp()
+{
+  typename T::Scalar two = 2;
+  REQUIRE(CmpT(nlerp(.5f, T(1, 0, 0, 0), T(0, 1, 0, 0)), T(rsqrt(two), rsqrt(two), 0, 0)));
+  // takes the shorter way around
+  typename T::Scalar five = 5;
+  REQUIRE(CmpT(nlerp(.5f, T(1, 0, 0, 0), T(-.6, .8, 0, 0)), T(-2 * rsqrt(five), rsqrt(five), 0, 0)));
+}
+
 TEST_CASE("Quaternion functions", "[quat]")
 {
   SECTION("Test conj")
@@ -245,4 +255,10 @@ TEST_CASE("Quaternion functions", "[quat]")
     test_slerp<quatf>();
     test_slerp<quatd>();
   }
+
+  SECTION("Test nlerp")
+  {
+    test_nlerp<quatf>();
+    test_nlerp<quatd>();
+  }
 }
@@ -0,0 +1,124 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/bounds.h"
+// std
+#include <cmath>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+
+static std::vector<vec3f> testPoints(size_t n)
+{
+  std::vector<vec3f> points(n);
+  for (size_t i = 0; i < n; ++i) {
+    const float t = float(i);
+    points[i] = vec3f(std::sin(t) * t, std::cos(.3f * t) - t, .01f * (i % 97));
+  }
+  return points;
+}
+
+static std::vector<box3f> testBoxes(size_t n)
+{
+  const std::vector<vec3f> points = testPoints(n);
+  std::vector<box3f> boxes(n);
+  for (size_t i = 0; i < n; ++i)
+    boxes[i] = box3f(points[i], points[i] + vec3f(.5f, float(i % 5), 2.f));
+  return boxes;
+}
+
+static void checkPointBounds(size_t n, bool parallel)
+{
+  const std::vector<vec3f> points = testPoints(n);
+
+  box3f ref(empty);
+  for (const auto &p : points)
+    ref.extend(p);
+
+  CHECK(computeBounds(points.data(), n, parallel) == ref);
+  CHECK(computeBounds(utility::DataView<vec3f>(points.data()), n, parallel) ==
+        ref);
+}
+
+static void checkBoxBounds(size_t n, bool parallel)
+{
+  const std::vector<box3f> boxes = testBoxes(n);
+
+  box3f ref(empty);
+  box3f refCentroids(empty);
+  for (const auto &b : boxes) {
+    ref.extend(b);
+    refCentroids.extend(b.center());
+  }
+
+  box3f centroids;
+  CHECK(computeBounds(boxes.data(), n, &centroids, parallel) == ref);
+  CHECK(centroids == refCentroids);
+  CHECK(computeBounds(boxes.data(), n, nullptr, parallel) == ref);
+
+  const utility::DataView<box3f> view(boxes.data());
+  box3f viewCentroids;
+  CHECK(computeBounds(view, n, &viewCentroids, parallel) == ref);
+  CHECK(viewCentroids == refCentroids);
+}
+
+TEST_CASE("computeBounds() of points matches box3f::extend()", "[bounds]")
+{
+  for (size_t n : {1, 2, 3, 5, 8, 17, 100})
+    checkPointBounds(n, false);
+
+  checkPointBounds(BOUNDS_PARALLEL_THRESHOLD + 7, true);
+}
+
+TEST_CASE("computeBounds() of boxes also returns centroid bounds",
+          "[bounds]")
+{
+  for (size_t n : {1, 2, 3, 5, 8, 17, 100})
+    checkBoxBounds(n, false);
+
+  checkBoxBounds(BOUNDS_PARALLEL_THRESHOLD + 7, true);
+}
+
+TEST_CASE("computeBounds() reads strided input through a DataView",
+          "[bounds]")
+{
+  struct Primitive
+  {
+    box3f bounds;
+    int geomID;
+    vec3f position;
+  };
+
+  const std::vector<box3f> boxes = testBoxes(29);
+  std::vector<Primitive> prims(boxes.size());
+  std::vector<vec3f> positions(boxes.size());
+  for (size_t i = 0; i < prims.size(); ++i) {
+    prims[i].bounds   = boxes[i];
+    prims[i].position = positions[i] = boxes[i].upper;
+  }
+
+  box3f centroids, refCentroids;
+  const box3f bounds = computeBounds(
+      utility::DataView<box3f>(&prims[0].bounds, sizeof(Primitive)),
+      prims.size(),
+      &centroids);
+  CHECK(bounds == computeBounds(boxes.data(), boxes.size(), &refCentroids));
+  CHECK(centroids == refCentroids);
+
+  CHECK(computeBounds(
+            utility::DataView<vec3f>(&prims[0].position, sizeof(Primitive)),
+            prims.size()) ==
+        computeBounds(positions.data(), positions.size()));
+}
+
+TEST_CASE("computeBounds() of empty arrays is empty", "[bounds]")
+{
+  box3f centroids(zero);
+  CHECK(computeBounds(static_cast<const vec3f *>(nullptr), 0).empty());
+  CHECK(computeBounds(static_cast<const box3f *>(nullptr), 0, &centroids)
+            .empty());
+  CHECK(centroids.empty());
+}
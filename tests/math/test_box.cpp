@@ -131,6 +131,10 @@ inline void test_intersectRayBox()
   range_t<T> r = intersectRayBox(V(0), normalize(V(1)), X(V(1), V(2)));
   REQUIRE(abs(r.lower - length(V(1))) <= T(ulp));
   REQUIRE(abs(r.upper - length(V(2))) <= 2 * T(ulp)); // rcp is multiplied by box.upper
+
+  const RayInvDir<T, N> ray(V(0), normalize(V(1)));
+  REQUIRE(intersectRayBox(ray, X(V(1), V(2))) == r);
+  REQUIRE(intersectRayBox(ray, X(V(-2), V(-1))).empty());
 }
 
 TEST_CASE("box intersectRayBox function", "[box]")
@@ -140,3 +144,23 @@ TEST_CASE("box intersectRayBox function", "[box]")
   test_intersectRayBox<double, 2>();
   test_intersectRayBox<double, 3>();
 }
+
+TEST_CASE("box constant expressions", "[box]")
+{
+  constexpr box3f unit(vec3f(0.f), vec3f(1.f));
+  constexpr box3f shifted = unit + vec3f(.5f);
+  static_assert(shifted.size() == vec3f(1.f), "");
+  static_assert(shifted.center() == vec3f(1.f), "");
+  static_assert(volume(box3i(vec3i(0), vec3i(2, 3, 4))) == 24, "");
+  static_assert(area(box2f(vec2f(0.f), vec2f(2.f, 3.f))) == 6.f, "");
+  static_assert(touchingOrOverlapping(unit, shifted), "");
+  static_assert(!touchingOrOverlapping(unit, unit + vec3f(2.f)), "");
+  static_assert(disjoint(unit, unit + vec3f(2.f)), "");
+  static_assert(unit.contains(vec3f(.5f)), "");
+  static_assert(!unit.empty(), "");
+  static_assert(box3f(empty).empty(), "");
+  static_assert(range1f(2.f, 4.f).center() == 3.f, "");
+  static_assert(range1i(2, 4) * 2 == range1i(4, 8), "");
+
+  CHECK(shifted == box3f(vec3f(.5f), vec3f(1.5f)));
+}
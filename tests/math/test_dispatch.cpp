@@ -0,0 +1,38 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/common.h"
+// std
+#include <cstring>
+
+using namespace rkcommon;
+
+TEST_CASE("isaName() names every instruction set", "[dispatch]")
+{
+  CHECK(std::strcmp(isaName(CpuIsa::Scalar), "scalar") == 0);
+  CHECK(std::strcmp(isaName(CpuIsa::NEON), "neon") == 0);
+  CHECK(std::strcmp(isaName(CpuIsa::SSE2), "sse2") == 0);
+  CHECK(std::strcmp(isaName(CpuIsa::SSE42), "sse4.2") == 0);
+  CHECK(std::strcmp(isaName(CpuIsa::AVX2), "avx2") == 0);
+  CHECK(std::strcmp(isaName(CpuIsa::AVX512), "avx512") == 0);
+}
+
+TEST_CASE("activeIsa() runs on the host", "[dispatch]")
+{
+  const CpuIsa host   = hostIsa();
+  const CpuIsa active = activeIsa();
+
+  CHECK(active <= host);
+  CHECK(activeIsa() == active);
+
+#if defined(RKCOMMON_NO_SIMD)
+  CHECK(active == CpuIsa::Scalar);
+#elif defined(__x86_64__) || defined(_M_X64)
+  CHECK(host >= CpuIsa::SSE2);
+  CHECK(active >= CpuIsa::SSE2);
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  CHECK(active == CpuIsa::NEON);
+#endif
+}
@@ -0,0 +1,213 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/fastmath.h"
+// std
+#include <vector>
+
+using namespace rkcommon::math;
+
+using P = MathPrecision;
+
+static const int numSamples = 100000;
+
+static double ulpError(float a, double ref)
+{
+  const float r   = std::fabs(float(ref));
+  const float ulp = std::nextafter(r, float(pos_inf)) - r;
+  return std::fabs(a - ref) / ulp;
+}
+
+struct MaxError
+{
+  double ulp{0.0};
+  double rel{0.0};
+  double abs{0.0};
+};
+
+// errors of 'f' against the double precision 'ref' over [lo, hi]
+template <typename F, typename REF_F>
+static MaxError sweep(float lo, float hi, F &&f, REF_F &&ref)
+{
+  MaxError e;
+  for (int i = 0; i <= numSamples; ++i) {
+    const float x    = lo + (hi - lo) * (float(i) / numSamples);
+    const double r   = ref(double(x));
+    const float fx   = f(x);
+    const double err = std::fabs(fx - r);
+    e.ulp            = std::max(e.ulp, ulpError(fx, r));
+    e.abs            = std::max(e.abs, err);
+    if (r != 0.0)
+      e.rel = std::max(e.rel, err / std::fabs(r));
+  }
+  return e;
+}
+
+TEST_CASE("Accurate fast_exp/fast_log are within 2 ulp", "[fastmath]")
+{
+  auto exp = [](double x) { return std::exp(x); };
+  auto exp2 = [](double x) { return std::exp2(x); };
+  auto log = [](double x) { return std::log(x); };
+  auto log2 = [](double x) { return std::log2(x); };
+
+  CHECK(sweep(-87.f, 88.f, fast_exp<P::Accurate>, exp).ulp <= 2.0);
+  CHECK(sweep(-126.f, 127.f, fast_exp2<P::Accurate>, exp2).ulp <= 2.0);
+  CHECK(sweep(.5f, 2.f, fast_log<P::Accurate>, log).ulp <= 2.0);
+  CHECK(sweep(1e-3f, 1e3f, fast_log<P::Accurate>, log).ulp <= 2.0);
+  CHECK(sweep(.5f, 2.f, fast_log2<P::Accurate>, log2).ulp <= 2.0);
+  CHECK(sweep(1e-3f, 1e3f, fast_log2<P::Accurate>, log2).ulp <= 2.0);
+}
+
+TEST_CASE("Fast fast_exp/fast_log are within 1e-4 relative", "[fastmath]")
+{
+  auto exp = [](double x) { return std::exp(x); };
+  auto exp2 = [](double x) { return std::exp2(x); };
+  auto log = [](double x) { return std::log(x); };
+  auto log2 = [](double x) { return std::log2(x); };
+
+  CHECK(sweep(-87.f, 88.f, fast_exp<P::Fast>, exp).rel <= 1.1e-4);
+  CHECK(sweep(-126.f, 127.f, fast_exp2<P::Fast>, exp2).rel <= 1.1e-4);
+  CHECK(sweep(.5f, 2.f, fast_log<P::Fast>, log).rel <= 1e-4);
+  CHECK(sweep(1e-3f, 1e3f, fast_log2<P::Fast>, log2).rel <= 1e-4);
+}
+
+TEST_CASE("fast_pow() error grows with y * log2(x)", "[fastmath]")
+{
+  auto gamma = [](float x) { return fast_pow<P::Accurate>(x, 1.f / 2.2f); };
+  auto gammaFast = [](float x) { return fast_pow<P::Fast>(x, 1.f / 2.2f); };
+  auto refGamma = [](double x) { return std::pow(x, double(1.f / 2.2f)); };
+
+  CHECK(sweep(1e-3f, 1.f, gamma, refGamma).ulp <= 8.0);
+  CHECK(sweep(1e-3f, 1.f, gammaFast, refGamma).rel <= 1.2e-4);
+
+  auto cube = [](float x) { return fast_pow<P::Accurate>(x, 3.f); };
+  auto refCube = [](double x) { return x * x * x; };
+  CHECK(sweep(.5f, 2.f, cube, refCube).ulp <= 4.0);
+}
+
+TEST_CASE("fast_sin/fast_cos absolute error up to |x| = 8192", "[fastmath]")
+{
+  auto sin = [](double x) { return std::sin(x); };
+  auto cos = [](double x) { return std::cos(x); };
+
+  CHECK(sweep(-.78f, .78f, fast_sin<P::Accurate>, sin).ulp <= 2.0);
+  CHECK(sweep(-10.f, 10.f, fast_sin<P::Accurate>, sin).abs <= 2e-7);
+  CHECK(sweep(-10.f, 10.f, fast_cos<P::Accurate>, cos).abs <= 2e-7);
+  CHECK(sweep(-8192.f, 8192.f, fast_sin<P::Accurate>, sin).abs <= 2e-7);
+  CHECK(sweep(-8192.f, 8192.f, fast_cos<P::Accurate>, cos).abs <= 2e-7);
+  CHECK(sweep(-8192.f, 8192.f, fast_sin<P::Fast>, sin).abs <= 1e-4);
+  CHECK(sweep(-8192.f, 8192.f, fast_cos<P::Fast>, cos).abs <= 1e-4);
+
+  float s, c;
+  fast_sincos(2.f, s, c);
+  CHECK(s == fast_sin(2.f));
+  CHECK(c == fast_cos(2.f));
+}
+
+TEST_CASE("fast_rcp/fast_rsqrt", "[fastmath]")
+{
+  auto rcp = [](double x) { return 1.0 / x; };
+  auto rsqrt = [](double x) { return 1.0 / std::sqrt(x); };
+
+  CHECK(sweep(1e-3f, 1e3f, fast_rcp<P::Fast>, rcp).rel <= 1e-6);
+  CHECK(sweep(1e-3f, 1e3f, fast_rsqrt<P::Fast>, rsqrt).rel <= 1e-6);
+  CHECK(sweep(1e-3f, 1e3f, fast_rcp<P::Accurate>, rcp).ulp <= .5);
+  CHECK(sweep(1e-3f, 1e3f, fast_rsqrt<P::Accurate>, rsqrt).ulp <= 1.5);
+}
+
+TEST_CASE("fast math special values", "[fastmath]")
+{
+  CHECK(fast_exp(-200.f) == 0.f);
+  CHECK(fast_exp(200.f) == float(pos_inf));
+  CHECK(fast_exp2(0.f) == 1.f);
+  CHECK(fast_exp2(10.f) == 1024.f);
+  CHECK(fast_exp2<P::Fast>(-3.f) == .125f);
+
+  CHECK(fast_log(0.f) == float(neg_inf));
+  CHECK(std::isnan(fast_log(-1.f)));
+  CHECK(fast_log(float(pos_inf)) == float(pos_inf));
+  CHECK(fast_log(1.f) == 0.f);
+  CHECK(fast_log2(8.f) == 3.f);
+
+  CHECK(fast_pow(0.f, 2.f) == 0.f);
+  CHECK(fast_pow(0.f, 0.f) == 1.f);
+  CHECK(fast_pow(1.f, 7.f) == 1.f);
+  CHECK(fast_pow(0.f, -1.f) == float(pos_inf));
+}
+
+template <int W>
+inline void test_packets()
+{
+  vfloat<W> x;
+  for (int i = 0; i < W; ++i)
+    x[i] = .37f + 1.3f * i;
+
+  auto checkLanes = [&](const vfloat<W> &v, float (*f)(float)) {
+    for (int i = 0; i < W; ++i)
+      CHECK(v[i] == Approx(f(x[i])).epsilon(1e-6));
+  };
+
+  checkLanes(fast_exp(x), fast_exp<P::Accurate>);
+  checkLanes(fast_exp2<P::Fast>(x), fast_exp2<P::Fast>);
+  checkLanes(fast_log(x), fast_log<P::Accurate>);
+  checkLanes(fast_log2<P::Fast>(x), fast_log2<P::Fast>);
+  checkLanes(fast_sin(x), fast_sin<P::Accurate>);
+  checkLanes(fast_cos<P::Fast>(x), fast_cos<P::Fast>);
+  checkLanes(fast_rsqrt(x), fast_rsqrt<P::Accurate>);
+
+  const vfloat<W> p = fast_pow(x, 2.2f);
+  vfloat<W> s, c;
+  fast_sincos(x, s, c);
+  for (int i = 0; i < W; ++i) {
+    CHECK(p[i] == Approx(fast_pow(x[i], 2.2f)).epsilon(1e-6));
+    CHECK(s[i] == Approx(fast_sin(x[i])).epsilon(1e-6));
+    CHECK(c[i] == Approx(fast_cos(x[i])).epsilon(1e-6));
+  }
+
+  const vec3vf<W> v(x, x + 1.f, x * 2.f);
+  const vec3vf<W> e = fast_exp(v);
+  for (int i = 0; i < W; ++i)
+    CHECK(e.z[i] == Approx(fast_exp(2.f * x[i])).epsilon(1e-6));
+}
+
+TEST_CASE("fast math on packets matches the scalar versions", "[fastmath]")
+{
+  test_packets<1>();
+  test_packets<2>();
+  test_packets<4>();
+  test_packets<8>();
+  test_packets<16>();
+}
+
+TEST_CASE("fast math on vec_t is component-wise", "[fastmath]")
+{
+  const vec3f v(.5f, 1.f, 2.f);
+  CHECK(fast_log(v) == vec3f(fast_log(.5f), 0.f, fast_log(2.f)));
+  CHECK(fast_pow<P::Fast>(vec4f(v, 4.f), .5f).w ==
+        fast_pow<P::Fast>(4.f, .5f));
+  CHECK(fast_sin(vec2f(0.f, 1.f)) == vec2f(0.f, fast_sin(1.f)));
+  CHECK(fast_exp(vec3fa(1.f)) == vec3fa(fast_exp(1.f)));
+}
+
+TEST_CASE("sRGB conversion of buffers", "[fastmath]")
+{
+  const size_t n = 37;
+  std::vector<float> linear(n);
+  for (size_t i = 0; i < n; ++i)
+    linear[i] = float(i) / (n - 4) - .05f;
+
+  std::vector<float> srgb(n);
+  linear_to_srgb(linear.data(), srgb.data(), n);
+  for (size_t i = 0; i < n; ++i)
+    CHECK(srgb[i] == Approx(linear_to_srgb(linear[i])).epsilon(2e-4));
+
+  std::vector<float> roundTrip = srgb;
+  srgb_to_linear(roundTrip.data(), roundTrip.data(), n);
+  for (size_t i = 0; i < n; ++i) {
+    CHECK(roundTrip[i] == Approx(srgb_to_linear(srgb[i])).epsilon(2e-4));
+    CHECK(roundTrip[i] ==
+          Approx(std::max(linear[i], 0.f)).epsilon(5e-4).margin(1e-6));
+  }
+}
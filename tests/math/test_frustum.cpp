@@ -0,0 +1,119 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/frustum.h"
+// std
+#include <random>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+
+static const AffineSpace3f camera = AffineSpace3f::lookat(
+    vec3f(1.f, 2.f, 3.f), vec3f(1.f, 2.f, -7.f), vec3f(0.f, 1.f, 0.f));
+
+// a small box around the camera space point 'p'
+static box3f boxAt(const vec3f &p, float radius = .1f)
+{
+  const vec3f c = xfmPoint(camera, p);
+  return box3f(c - radius, c + radius);
+}
+
+TEST_CASE("perspective frustum", "[frustum]")
+{
+  // 90 degrees: |x| <= 2 z and |y| <= z
+  const Frustum f = Frustum::perspective(camera, 90.f, 2.f, 1.f, 100.f);
+
+  CHECK(f.isVisible(boxAt(vec3f(0.f, 0.f, 5.f))));
+  CHECK(f.isVisible(boxAt(vec3f(19.f, -9.f, 10.f))));
+  CHECK(!f.isVisible(boxAt(vec3f(21.f, 0.f, 10.f))));
+  CHECK(!f.isVisible(boxAt(vec3f(-21.f, 0.f, 10.f))));
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, 11.f, 10.f))));
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, -11.f, 10.f))));
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, 0.f, -5.f))));
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, 0.f, .5f))));
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, 0.f, 101.f))));
+
+  // boxes across a plane are kept
+  CHECK(f.isVisible(boxAt(vec3f(20.5f, 0.f, 10.f), 1.f)));
+  CHECK(f.isVisible(boxAt(vec3f(0.f, 0.f, 100.5f), 1.f)));
+  // and so is one around the whole frustum
+  CHECK(f.isVisible(boxAt(vec3f(0.f), 1000.f)));
+
+  // unit normals, pointing inside
+  const vec3f inside = xfmPoint(camera, vec3f(0.f, 0.f, 5.f));
+  for (const vec4f &p : f.planes) {
+    CHECK(length(vec3f(p.x, p.y, p.z)) == Approx(1.f));
+    CHECK(dot(vec3f(p.x, p.y, p.z), inside) + p.w > 0.f);
+  }
+}
+
+TEST_CASE("orthographic frustum", "[frustum]")
+{
+  const Frustum f = Frustum::orthographic(camera, 4.f, 1.5f, 0.f, 50.f);
+
+  CHECK(f.isVisible(boxAt(vec3f(2.8f, 1.8f, 20.f))));
+  CHECK(!f.isVisible(boxAt(vec3f(3.2f, 0.f, 20.f))));
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, -2.2f, 20.f))));
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, 0.f, -.2f))));
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, 0.f, 50.2f))));
+}
+
+TEST_CASE("frustum plane hints", "[frustum]")
+{
+  const Frustum f = Frustum::perspective(camera, 60.f, 1.f, .1f, 100.f);
+
+  int hint = 0;
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, 0.f, 200.f)), &hint));
+  CHECK(hint == Frustum::FAR_PLANE);
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, 0.f, 300.f)), &hint));
+  CHECK(hint == Frustum::FAR_PLANE);
+  CHECK(!f.isVisible(boxAt(vec3f(0.f, -50.f, 10.f)), &hint));
+  CHECK(hint == Frustum::BOTTOM);
+
+  // visible boxes leave the hint alone
+  CHECK(f.isVisible(boxAt(vec3f(0.f, 0.f, 10.f)), &hint));
+  CHECK(hint == Frustum::BOTTOM);
+}
+
+template <typename BOX_T>
+static void checkBatch(size_t n, bool parallel)
+{
+  const Frustum f = Frustum::perspective(camera, 60.f, 1.5f, .1f, 100.f);
+
+  // boxes in and around the frustum
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<float> xy(-60.f, 60.f);
+  std::uniform_real_distribution<float> z(-20.f, 120.f);
+  std::uniform_real_distribution<float> size(0.f, 4.f);
+  std::vector<BOX_T> boxes(n);
+  for (auto &b : boxes) {
+    const vec3f c = xfmPoint(camera, vec3f(xy(rng), xy(rng), z(rng)));
+    const vec3f r(size(rng), size(rng), size(rng));
+    b.lower = c - r;
+    b.upper = c + r;
+  }
+
+  std::vector<uint8_t> mask(n, 2);
+  f.cull(boxes.data(), n, mask.data(), parallel);
+  size_t visible = 0;
+  for (size_t i = 0; i < n; i++) {
+    REQUIRE(mask[i] == (f.isVisible(boxes[i]) ? 1 : 0));
+    visible += mask[i];
+  }
+  if (n > 100) {
+    CHECK(visible > n / 20);
+    CHECK(visible < n / 2);
+  }
+}
+
+TEST_CASE("frustum culling of box arrays", "[frustum]")
+{
+  checkBatch<box3f>(1003, false);
+  checkBatch<box3fa>(1003, false);
+  checkBatch<box3f>(3, false);
+  checkBatch<box3f>(100003, true);
+  checkBatch<box3fa>(100003, true);
+}
@@ -0,0 +1,131 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/array3D/Array3D.h"
+#include "rkcommon/math/half.h"
+#include "rkcommon/utility/DataView.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+
+TEST_CASE("half converts exactly representable values", "[half]")
+{
+  CHECK(half(0.f).bits == 0x0000);
+  CHECK(half(-0.f).bits == 0x8000);
+  CHECK(half(1.f).bits == 0x3c00);
+  CHECK(half(-2.f).bits == 0xc000);
+  CHECK(half(65504.f).bits == 0x7bff);
+  CHECK(half(6.103515625e-05f).bits == 0x0400);
+  CHECK(half(5.9604644775390625e-08f).bits == 0x0001);
+  CHECK(half(float(pos_inf)).bits == 0x7c00);
+  CHECK(half(float(neg_inf)).bits == 0xfc00);
+
+  CHECK(float(half::fromBits(0x3555)) == 0.333251953125f);
+  CHECK(float(half::fromBits(0x0001)) == 5.9604644775390625e-08f);
+  CHECK(std::isnan(float(half(std::numeric_limits<float>::quiet_NaN()))));
+}
+
+TEST_CASE("half rounds to nearest even", "[half]")
+{
+  CHECK(half(1.f + 1.f / 2048).bits == 0x3c00);
+  CHECK(half(1.f + 3.f / 2048).bits == 0x3c02);
+  CHECK(half(1.f + 1.1f / 2048).bits == 0x3c01);
+  CHECK(half(65519.f).bits == 0x7bff);
+  CHECK(half(65520.f).bits == 0x7c00);
+  CHECK(half(1e-8f).bits == 0x0000);
+  CHECK(half(4e-8f).bits == 0x0001);
+}
+
+TEST_CASE("every half survives a round trip through float", "[half]")
+{
+  int mismatches = 0;
+  for (uint32_t b = 0; b < 0x10000; ++b) {
+    const float f = half::fromBits(uint16_t(b));
+    if (std::isnan(f))
+      mismatches += (half(f).bits & 0x7c00) != 0x7c00;
+    else
+      mismatches += half(f).bits != b;
+  }
+  CHECK(mismatches == 0);
+}
+
+TEST_CASE("bfloat16 keeps the upper half of a float", "[half]")
+{
+  CHECK(bfloat16(1.f).bits == 0x3f80);
+  CHECK(bfloat16(-3.f).bits == 0xc040);
+  CHECK(bfloat16(float(pos_inf)).bits == 0x7f80);
+  CHECK(std::isnan(float(bfloat16(std::numeric_limits<float>::quiet_NaN()))));
+  CHECK(std::isnan(float(bfloat16(detail::bitsToFloat(0x7f800001)))));
+
+  // 1 + 2^-8 is halfway between 1 and 1 + 2^-7
+  CHECK(bfloat16(1.f + 1.f / 256).bits == 0x3f80);
+  CHECK(bfloat16(1.f + 3.f / 256).bits == 0x3f82);
+
+  int mismatches = 0;
+  for (uint32_t b = 0; b < 0x10000; ++b) {
+    const float f = bfloat16::fromBits(uint16_t(b));
+    if (!std::isnan(f))
+      mismatches += bfloat16(f).bits != b;
+  }
+  CHECK(mismatches == 0);
+}
+
+TEST_CASE("vec3h stores 16-bit components", "[half]")
+{
+  static_assert(sizeof(vec3h) == 6, "vec3h must be tightly packed");
+
+  const vec3f v(.5f, -1.25f, 1024.f);
+  const vec3h h(v);
+  CHECK(vec3f(h) == v);
+  CHECK(vec4f(vec4h(1.f)) == vec4f(1.f));
+  CHECK(h.x + h.y == -.75f);
+}
+
+TEST_CASE("bulk convert() matches scalar conversion", "[half]")
+{
+  const size_t n = 37;
+  std::vector<float> in(n);
+  for (size_t i = 0; i < n; ++i)
+    in[i] = (float(i) - 11.3f) * 17.1f;
+
+  std::vector<half> h(n);
+  std::vector<bfloat16> b(n);
+  convert(in.data(), h.data(), n);
+  convert(in.data(), b.data(), n);
+
+  std::vector<float> fromHalf(n), fromBFloat16(n);
+  convert(h.data(), fromHalf.data(), n);
+  convert(b.data(), fromBFloat16.data(), n);
+
+  for (size_t i = 0; i < n; ++i) {
+    CHECK(h[i].bits == half(in[i]).bits);
+    CHECK(b[i].bits == bfloat16(in[i]).bits);
+    CHECK(fromHalf[i] == float(half(in[i])));
+    CHECK(fromBFloat16[i] == float(bfloat16(in[i])));
+  }
+}
+
+TEST_CASE("half data reads back as float through views", "[half]")
+{
+  struct Vertex
+  {
+    vec3h normal;
+    half u, v;
+  };
+
+  std::vector<Vertex> vertices(5);
+  for (size_t i = 0; i < vertices.size(); ++i)
+    vertices[i].normal = vec3f(0.f, float(i), 1.f);
+
+  const utility::DataView<vec3h> normals(&vertices[0].normal, sizeof(Vertex));
+  CHECK(vec3f(normals[3]) == vec3f(0.f, 3.f, 1.f));
+
+  auto volume = std::make_shared<array3D::ActualArray3D<half>>(vec3i(2));
+  volume->set(vec3i(1, 0, 1), 2.5f);
+  const array3D::Array3DAccessor<half, float> accessor(volume);
+  CHECK(accessor.get(vec3i(1, 0, 1)) == 2.5f);
+}
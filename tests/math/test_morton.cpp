@@ -0,0 +1,212 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/morton.h"
+// std
+#include <set>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+
+// reference interleave, one bit at a time
+template <typename CODE_T, int N>
+static CODE_T interleave(const vec_t<uint32_t, N> &p, int bits)
+{
+  CODE_T code = 0;
+  for (int b = 0; b < bits; ++b)
+    for (int d = 0; d < N; ++d)
+      code |= CODE_T((p[d] >> b) & 1) << (N * b + d);
+  return code;
+}
+
+static uint32_t testCoord(uint32_t i, int bits)
+{
+  return (i * 2654435761u) >> (32 - bits);
+}
+
+TEST_CASE("Morton codes interleave the coordinate bits", "[morton]")
+{
+  CHECK(mortonEncode(vec2ui(1, 0)) == 1);
+  CHECK(mortonEncode(vec2ui(0, 1)) == 2);
+  CHECK(mortonEncode(vec3ui(0, 0, 1)) == 4);
+  CHECK(mortonEncode(vec3ui(3, 3, 3)) == 63);
+  CHECK(mortonEncode(vec3ui(1023, 1023, 1023)) == (1u << 30) - 1);
+  CHECK(mortonEncode64(vec3ui(1u << 20, 0, 0)) == uint64_t(1) << 60);
+  CHECK(mortonEncode64(vec2ui(0, 1u << 31)) == uint64_t(1) << 63);
+
+  for (uint32_t i = 0; i < 1000; ++i) {
+    const vec2ui p2(testCoord(i, 16), testCoord(i + 7, 16));
+    const vec3ui p3(
+        testCoord(i, 10), testCoord(i + 7, 10), testCoord(i + 13, 10));
+    const vec2ui q2(testCoord(i, 32), testCoord(i + 7, 32));
+    const vec3ui q3(
+        testCoord(i, 21), testCoord(i + 7, 21), testCoord(i + 13, 21));
+
+    CHECK(mortonEncode(p2) == (interleave<uint32_t, 2>(p2, 16)));
+    CHECK(mortonEncode(p3) == (interleave<uint32_t, 3>(p3, 10)));
+    CHECK(mortonEncode64(q2) == (interleave<uint64_t, 2>(q2, 32)));
+    CHECK(mortonEncode64(q3) == (interleave<uint64_t, 3>(q3, 21)));
+
+    CHECK(mortonDecode<2>(mortonEncode(p2)) == p2);
+    CHECK(mortonDecode<3>(mortonEncode(p3)) == p3);
+    CHECK(mortonDecode64<2>(mortonEncode64(q2)) == q2);
+    CHECK(mortonDecode64<3>(mortonEncode64(q3)) == q3);
+  }
+}
+
+TEST_CASE("Morton codes ignore coordinate bits that do not fit", "[morton]")
+{
+  CHECK(mortonEncode(vec3ui(1024 + 5, 0, 0)) == mortonEncode(vec3ui(5, 0, 0)));
+  CHECK(mortonEncode(vec2ui(0, 0x10003)) == mortonEncode(vec2ui(0, 3)));
+}
+
+TEST_CASE("Hilbert codes visit neighboring cells in order", "[morton]")
+{
+  SECTION("2D")
+  {
+    const int bits = 4;
+    const uint32_t n = 1u << (2 * bits);
+    std::set<uint32_t> seen;
+    vec2ui prev = hilbertDecode<2>(0u, bits);
+    CHECK(prev == vec2ui(0));
+    for (uint32_t h = 0; h < n; ++h) {
+      const vec2ui p = hilbertDecode<2>(h, bits);
+      CHECK(hilbertEncode(p, bits) == h);
+      CHECK(p.x < 16);
+      CHECK(p.y < 16);
+      if (h > 0) {
+        const uint32_t dist = (p.x > prev.x ? p.x - prev.x : prev.x - p.x) +
+                              (p.y > prev.y ? p.y - prev.y : prev.y - p.y);
+        CHECK(dist == 1);
+      }
+      seen.insert(mortonEncode(p));
+      prev = p;
+    }
+    CHECK(seen.size() == n);
+  }
+
+  SECTION("3D")
+  {
+    const int bits = 3;
+    const uint32_t n = 1u << (3 * bits);
+    std::set<uint32_t> seen;
+    vec3ui prev = hilbertDecode<3>(0u, bits);
+    for (uint32_t h = 0; h < n; ++h) {
+      const vec3ui p = hilbertDecode<3>(h, bits);
+      CHECK(hilbertEncode(p, bits) == h);
+      if (h > 0) {
+        const uint32_t dist = (p.x > prev.x ? p.x - prev.x : prev.x - p.x) +
+                              (p.y > prev.y ? p.y - prev.y : prev.y - p.y) +
+                              (p.z > prev.z ? p.z - prev.z : prev.z - p.z);
+        CHECK(dist == 1);
+      }
+      seen.insert(mortonEncode(p));
+      prev = p;
+    }
+    CHECK(seen.size() == n);
+  }
+
+  SECTION("full precision round trips")
+  {
+    for (uint32_t i = 0; i < 1000; ++i) {
+      const vec2ui p2(testCoord(i, 16), testCoord(i + 3, 16));
+      const vec3ui p3(
+          testCoord(i, 10), testCoord(i + 3, 10), testCoord(i + 5, 10));
+      const vec2ui q2(testCoord(i, 32), testCoord(i + 3, 32));
+      const vec3ui q3(
+          testCoord(i, 21), testCoord(i + 3, 21), testCoord(i + 5, 21));
+      CHECK(hilbertDecode<2>(hilbertEncode(p2)) == p2);
+      CHECK(hilbertDecode<3>(hilbertEncode(p3)) == p3);
+      CHECK(hilbertDecode64<2>(hilbertEncode64(q2)) == q2);
+      CHECK(hilbertDecode64<3>(hilbertEncode64(q3)) == q3);
+    }
+  }
+}
+
+TEST_CASE("quantize() maps a box to its grid cells", "[morton]")
+{
+  const box3f bounds(vec3f(-1.f, 0.f, 2.f), vec3f(1.f, 4.f, 2.f));
+
+  CHECK(quantize(bounds.lower, bounds, 10) == vec3ui(0));
+  CHECK(quantize(bounds.upper, bounds, 10) == vec3ui(1023, 1023, 0));
+  CHECK(quantize(vec3f(0.f, 1.f, 2.f), bounds, 2) == vec3ui(2, 1, 0));
+  CHECK(quantize(vec3f(-5.f, 9.f, 7.f), bounds, 4) == vec3ui(0, 15, 0));
+
+  const box2f bounds2(vec2f(0.f), vec2f(8.f, 2.f));
+  CHECK(quantize(vec2f(3.5f, 1.9f), bounds2, 3) == vec2ui(3, 7));
+}
+
+static std::vector<vec3f> testPoints(size_t n)
+{
+  std::vector<vec3f> points(n);
+  for (size_t i = 0; i < n; ++i)
+    points[i] = vec3f(i % 101, float(i % 37) - 18.f, .25f * (i % 13));
+  return points;
+}
+
+template <typename CODE_T>
+static void checkMortonCodes(size_t n, bool parallel)
+{
+  const std::vector<vec3f> points = testPoints(n);
+  box3f bounds(empty);
+  for (const auto &p : points)
+    bounds.extend(p);
+
+  std::vector<CODE_T> codes(n);
+  mortonCodes(bounds, points.data(), codes.data(), n, parallel);
+
+  const int bits = sizeof(CODE_T) == 8 ? 21 : 10;
+  for (size_t i = 0; i < n; ++i) {
+    const vec3ui q = quantize(points[i], bounds, bits);
+    CHECK(codes[i] == CODE_T(sizeof(CODE_T) == 8 ? mortonEncode64(q)
+                                                 : mortonEncode(q)));
+  }
+}
+
+TEST_CASE("mortonCodes() matches quantize() and mortonEncode()", "[morton]")
+{
+  SECTION("small arrays, including partial packets")
+  {
+    for (size_t n : {1, 3, 4, 7, 16, 33}) {
+      checkMortonCodes<uint32_t>(n, false);
+      checkMortonCodes<uint64_t>(n, false);
+    }
+  }
+
+  SECTION("arrays split across parallel_for()")
+  {
+    checkMortonCodes<uint32_t>(MORTON_PARALLEL_THRESHOLD + 5, true);
+    checkMortonCodes<uint64_t>(MORTON_PARALLEL_THRESHOLD + 5, true);
+  }
+}
+
+TEST_CASE("mortonCodes() reads strided input through a DataView", "[morton]")
+{
+  struct Vertex
+  {
+    vec3f position;
+    float u, v;
+  };
+
+  const size_t n = 45;
+  const std::vector<vec3f> positions = testPoints(n);
+  std::vector<Vertex> vertices(n);
+  for (size_t i = 0; i < n; ++i)
+    vertices[i].position = positions[i];
+
+  const box3f bounds(vec3f(0.f, -18.f, 0.f), vec3f(100.f, 18.f, 3.f));
+  const utility::DataView<vec3f> view(&vertices[0].position, sizeof(Vertex));
+
+  std::vector<uint32_t> fromView(n), fromArray(n);
+  mortonCodes(bounds, view, fromView.data(), n);
+  mortonCodes(bounds, positions.data(), fromArray.data(), n);
+  CHECK(fromView == fromArray);
+
+  std::vector<uint64_t> fromView64(n), fromArray64(n);
+  mortonCodes(bounds, view, fromView64.data(), n);
+  mortonCodes(bounds, positions.data(), fromArray64.data(), n);
+  CHECK(fromView64 == fromArray64);
+}
@@ -0,0 +1,339 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/packet.h"
+
+using namespace rkcommon::math;
+
+#define RUN_FOR_ALL_WIDTHS(name)                                              \
+  name<2>();                                                                  \
+  name<4>();                                                                  \
+  name<8>();                                                                  \
+  name<16>();
+
+template <int W>
+inline vfloat<W> iota(float start)
+{
+  vfloat<W> v;
+  for (int i = 0; i < W; ++i)
+    v[i] = start + i;
+  return v;
+}
+
+template <int W>
+inline void test_arithmetic()
+{
+  const vfloat<W> a = iota<W>(1.f);
+  const vfloat<W> b = iota<W>(-3.f);
+
+  const vfloat<W> sum  = a + b;
+  const vfloat<W> prod = 2.f * a * b - 1.f;
+  const vfloat<W> quot = a / 2.f;
+  const vfloat<W> neg  = -b;
+  const vfloat<W> mn   = min(a, b);
+  const vfloat<W> mx   = max(a, b);
+  const vfloat<W> ab   = abs(b);
+  const vfloat<W> sq   = sqrt(a * a);
+  const vfloat<W> fm   = madd(a, b, a);
+
+  vfloat<W> acc = a;
+  acc += b;
+  acc *= 2.f;
+
+  for (int i = 0; i < W; ++i) {
+    CHECK(sum[i] == a[i] + b[i]);
+    CHECK(prod[i] == 2.f * a[i] * b[i] - 1.f);
+    CHECK(quot[i] == a[i] / 2.f);
+    CHECK(neg[i] == -b[i]);
+    CHECK(mn[i] == std::min(a[i], b[i]));
+    CHECK(mx[i] == std::max(a[i], b[i]));
+    CHECK(ab[i] == std::abs(b[i]));
+    CHECK(sq[i] == a[i]);
+    CHECK(fm[i] == a[i] * b[i] + a[i]);
+    CHECK(acc[i] == (a[i] + b[i]) * 2.f);
+  }
+
+  const vfloat<W> r  = rcp(a);
+  const vfloat<W> rs = rsqrt(a);
+  for (int i = 0; i < W; ++i) {
+    CHECK(r[i] == Approx(1.f / a[i]).epsilon(1e-6));
+    CHECK(rs[i] == Approx(1.f / std::sqrt(a[i])).epsilon(1e-6));
+  }
+}
+
+template <int W>
+inline void test_masks()
+{
+  const vfloat<W> a = iota<W>(0.f);
+  const vfloat<W> h(W / 2);
+
+  const vbool<W> lo = a < h;
+  const vbool<W> hi = a >= h;
+
+  CHECK(popcnt(lo) == W / 2);
+  CHECK(movemask(lo) == (1u << (W / 2)) - 1);
+  CHECK(none(lo & hi));
+  CHECK(all(lo | hi));
+  CHECK(all(lo ^ hi));
+  CHECK(movemask(!lo) == movemask(hi));
+  CHECK(any(a == 1.f));
+  CHECK(none(a != a));
+  CHECK(all(a <= a));
+  CHECK(none(a > a));
+
+  const vfloat<W> s = select(lo, a, vfloat<W>(-1.f));
+  for (int i = 0; i < W; ++i) {
+    CHECK(lo[i] == (i < W / 2));
+    CHECK(s[i] == (i < W / 2 ? float(i) : -1.f));
+  }
+}
+
+template <int W>
+inline void test_load_store()
+{
+  alignas(64) float data[W];
+  for (int i = 0; i < W; ++i)
+    data[i] = float(i);
+
+  const vfloat<W> a = vfloat<W>::load(data);
+  const vfloat<W> u = vfloat<W>::loadu(data);
+  const vbool<W> front = a < float(W / 2);
+
+  const vfloat<W> m = vfloat<W>::loadu(front, data);
+
+  alignas(64) float out[W];
+  vfloat<W>::store(out, a + 1.f);
+  for (int i = 0; i < W; ++i) {
+    CHECK(a[i] == data[i]);
+    CHECK(u[i] == data[i]);
+    CHECK(m[i] == (front[i] ? data[i] : 0.f));
+    CHECK(out[i] == data[i] + 1.f);
+  }
+
+  vfloat<W>::storeu(front, out, vfloat<W>(-1.f));
+  for (int i = 0; i < W; ++i)
+    CHECK(out[i] == (front[i] ? -1.f : data[i] + 1.f));
+}
+
+template <int W>
+inline void test_reductions()
+{
+  const vfloat<W> a = iota<W>(-2.f);
+  CHECK(reduce_add(a) == W * (W - 1) / 2 - 2 * W);
+  CHECK(reduce_min(a) == -2.f);
+  CHECK(reduce_max(a) == W - 3.f);
+}
+
+template <int W>
+inline void test_vectors()
+{
+  vec3f in[W];
+  for (int i = 0; i < W; ++i)
+    in[i] = vec3f(i, 2 * i + 1, -i);
+
+  const vec3vf<W> v = loadAoS<W>(in);
+  const vec3vf<W> w(1.f, 2.f, 3.f);
+
+  const vfloat<W> d  = dot(v, w);
+  const vec3vf<W> c  = cross(v, w);
+  const vec3vf<W> s  = v * 2.f + w;
+  const vfloat<W> rm = reduce_max(v);
+
+  vec3f out[W];
+  storeAoS(out, s);
+
+  for (int i = 0; i < W; ++i) {
+    CHECK(extract(v, i) == in[i]);
+    CHECK(d[i] == dot(in[i], vec3f(1, 2, 3)));
+    CHECK(extract(c, i) == cross(in[i], vec3f(1, 2, 3)));
+    CHECK(out[i] == in[i] * 2.f + vec3f(1, 2, 3));
+    CHECK(rm[i] == reduce_max(in[i]));
+  }
+}
+
+template <int W>
+inline void test_transposed()
+{
+  // W records of 6 floats, e.g. box3f
+  float in[6 * W];
+  for (int i = 0; i < 6 * W; ++i)
+    in[i] = float(i);
+
+  vfloat<W> v[4];
+  loadTransposed4<W>(in + 1, 6, v);
+  for (int i = 0; i < W; ++i)
+    for (int k = 0; k < 4; ++k)
+      CHECK(v[k][i] == in[6 * i + 1 + k]);
+
+  float out[6 * W];
+  for (int i = 0; i < 6 * W; ++i)
+    out[i] = -1.f;
+  storeTransposed4<W>(out + 1, 6, v);
+  for (int i = 0; i < W; ++i) {
+    CHECK(out[6 * i] == -1.f);
+    for (int k = 0; k < 4; ++k)
+      CHECK(out[6 * i + 1 + k] == in[6 * i + 1 + k]);
+    CHECK(out[6 * i + 5] == -1.f);
+  }
+}
+
+template <int W>
+inline void test_boxes()
+{
+  box3vf<W> b(empty);
+  CHECK(all(isEmpty(b)));
+
+  const vfloat<W> t = iota<W>(0.f);
+  b.extend(vec3vf<W>(t, -t, 0.f));
+  b.extend(vec3vf<W>(t + 1.f, t, 1.f));
+  CHECK(none(isEmpty(b)));
+
+  const vbool<W> inside = contains(b, vec3vf<W>(t + .5f, 0.f, .5f));
+  const vbool<W> outside = contains(b, vec3vf<W>(t + 2.f, 0.f, .5f));
+  CHECK(all(inside));
+  CHECK(none(outside));
+
+  const box3f all = reduce_bounds(b);
+  CHECK(all.lower == vec3f(0.f, -(W - 1.f), 0.f));
+  CHECK(all.upper == vec3f(W, W - 1.f, 1.f));
+
+  const vbool<W> first = t < 1.f;
+  const box3f one = reduce_bounds(first, b);
+  CHECK(one == box3f(vec3f(0.f), vec3f(1.f, 0.f, 1.f)));
+  CHECK(extract(b, 0) == one);
+
+  const rangevf<W> r = select(first, rangevf<W>(t, t + 1.f), rangevf<W>(0.f));
+  CHECK(r.lower[0] == 0.f);
+  CHECK(r.upper[0] == 1.f);
+}
+
+template <int W>
+inline void test_transforms()
+{
+  const AffineSpace3f xfm = AffineSpace3f::translate(vec3f(1.f, 2.f, 3.f)) *
+                            AffineSpace3f::rotate(vec3f(0, 0, 1), .5f) *
+                            AffineSpace3f::scale(vec3f(2.f, 1.f, .5f));
+
+  vec3f in[W];
+  for (int i = 0; i < W; ++i)
+    in[i] = vec3f(i, 1.f - i, .5f * i);
+
+  const vec3vf<W> p = loadAoS<W>(in);
+  const vec3vf<W> tp = xfmPoint(xfm, p);
+  const vec3vf<W> tv = xfmVector(xfm, p);
+  const vec3vf<W> tn = xfmNormal(xfm, p);
+
+  auto checkLane = [](const vec3vf<W> &v, int i, const vec3f &ref) {
+    CHECK(v.x[i] == Approx(ref.x));
+    CHECK(v.y[i] == Approx(ref.y));
+    CHECK(v.z[i] == Approx(ref.z));
+  };
+
+  for (int i = 0; i < W; ++i) {
+    checkLane(tp, i, xfmPoint(xfm, in[i]));
+    checkLane(tv, i, xfmVector(xfm, in[i]));
+    checkLane(tn, i, xfmNormal(xfm, in[i]));
+  }
+
+  box3vf<W> b(loadAoS<W>(in), loadAoS<W>(in) + vec3vf<W>(1.f));
+  const box3vf<W> tb = xfmBounds(xfm, b);
+  for (int i = 0; i < W; ++i) {
+    const box3f ref = xfmBounds(xfm, extract(b, i));
+    checkLane(tb.lower, i, ref.lower);
+    checkLane(tb.upper, i, ref.upper);
+  }
+}
+
+template <int W>
+inline void test_intersectRayBox()
+{
+  // box i is a unit cube at x = i, every other box dropped below the ray
+  box3vf<W> boxes;
+  for (int i = 0; i < W; ++i) {
+    const vec3f lower(i, i % 2 ? -3.f : -.5f, -.5f);
+    boxes.lower.x[i] = lower.x;
+    boxes.lower.y[i] = lower.y;
+    boxes.lower.z[i] = lower.z;
+    boxes.upper.x[i] = lower.x + 1.f;
+    boxes.upper.y[i] = lower.y + 1.f;
+    boxes.upper.z[i] = lower.z + 1.f;
+  }
+
+  const RayInvDir3f ray(vec3f(-1.f, 0.f, 0.f), vec3f(1.f, 0.f, 0.f));
+  const range1f tRange(0.f, W / 2 + .5f);
+  const RayBoxHit<W> hits = intersectRayBox(ray, boxes, tRange);
+
+  for (int i = 0; i < W; ++i) {
+    const range1f ref = intersectRayBox(ray, extract(boxes, i), tRange);
+    CHECK(hits.hit[i] == !ref.empty());
+    CHECK(hits.hit[i] == (i % 2 == 0 && i < W / 2));
+    if (hits.hit[i]) {
+      CHECK(hits.t.lower[i] == Approx(ref.lower));
+      CHECK(hits.t.upper[i] == Approx(ref.upper));
+    }
+  }
+
+  // W rays through the unit cube along x, fanned out in y
+  vec3vf<W> org(vfloat<W>(-2.f), iota<W>(0.f) * .25f - .4f, vfloat<W>(0.f));
+  const RayInvDir3vf<W> rays(org, vec3vf<W>(1.f, 0.f, 0.f));
+  const box3f box(vec3f(-.5f), vec3f(.5f));
+  const RayBoxHit<W> rayHits = intersectRayBox(rays, box);
+
+  for (int i = 0; i < W; ++i) {
+    const range1f ref = intersectRayBox(extract(org, i), vec3f(1, 0, 0), box);
+    CHECK(rayHits.hit[i] == !ref.empty());
+    CHECK(rayHits.hit[i] == (org.y[i] >= -.5f && org.y[i] <= .5f));
+    if (rayHits.hit[i]) {
+      CHECK(rayHits.t.lower[i] == Approx(ref.lower));
+      CHECK(rayHits.t.upper[i] == Approx(ref.upper));
+    }
+  }
+}
+
+TEST_CASE("vfloat arithmetic matches scalar math", "[packet]")
+{
+  RUN_FOR_ALL_WIDTHS(test_arithmetic);
+}
+
+TEST_CASE("vbool masks and select", "[packet]")
+{
+  RUN_FOR_ALL_WIDTHS(test_masks);
+}
+
+TEST_CASE("vfloat plain and masked loads/stores", "[packet]")
+{
+  RUN_FOR_ALL_WIDTHS(test_load_store);
+}
+
+TEST_CASE("vfloat horizontal reductions", "[packet]")
+{
+  RUN_FOR_ALL_WIDTHS(test_reductions);
+}
+
+TEST_CASE("vec3vf gathers, computes and scatters AoS data", "[packet]")
+{
+  RUN_FOR_ALL_WIDTHS(test_vectors);
+}
+
+TEST_CASE("loadTransposed4() and storeTransposed4() of strided records",
+          "[packet]")
+{
+  RUN_FOR_ALL_WIDTHS(test_transposed);
+}
+
+TEST_CASE("box3vf per lane tests and reductions", "[packet]")
+{
+  RUN_FOR_ALL_WIDTHS(test_boxes);
+}
+
+TEST_CASE("uniform AffineSpace3f transforms of packets", "[packet]")
+{
+  RUN_FOR_ALL_WIDTHS(test_transforms);
+}
+
+TEST_CASE("packet ray/box slab tests match intersectRayBox()", "[packet]")
+{
+  RUN_FOR_ALL_WIDTHS(test_intersectRayBox);
+}
@@ -0,0 +1,188 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/quantize.h"
+// std
+#include <random>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+
+static const box3f domain(vec3f(-3.f, 100.f, -.5f), vec3f(7.f, 1200.f, .25f));
+
+// points in the domain, with its corners; 'n' is not a multiple of 4
+static std::vector<vec3f> randomPoints(size_t n)
+{
+  std::mt19937 rng(17);
+  std::uniform_real_distribution<float> t(0.f, 1.f);
+  std::vector<vec3f> points{domain.lower, domain.upper};
+  while (points.size() < n) {
+    const vec3f u(t(rng), t(rng), t(rng));
+    points.push_back(domain.lower + u * domain.size());
+  }
+  return points;
+}
+
+template <typename T>
+static void checkRoundTrip()
+{
+  const QuantizationDomain<T> quantization(domain);
+  const vec3f maxError = quantization.maxError();
+  CHECK(quantization.domain() == domain);
+
+  const std::vector<vec3f> points = randomPoints(1003);
+  for (const vec3f &p : points) {
+    const vec3f q = quantization.dequantize(quantization.quantize(p));
+    REQUIRE(!anyLessThan(maxError, abs(q - p)));
+  }
+  CHECK(quantization.quantize(domain.lower) == QuantizedVec3<T>{0, 0, 0});
+  const T top = std::numeric_limits<T>::max();
+  CHECK(quantization.quantize(domain.upper) == QuantizedVec3<T>{top, top, top});
+
+  // outside of the domain clamps to it
+  CHECK(quantization.quantize(domain.lower - 1.f) == QuantizedVec3<T>{0, 0, 0});
+  CHECK(quantization.quantize(domain.upper + 1.f) ==
+        QuantizedVec3<T>{top, top, top});
+}
+
+TEST_CASE("QuantizationDomain round trip error", "[quantize]")
+{
+  checkRoundTrip<uint16_t>();
+  checkRoundTrip<uint32_t>();
+
+  // 32 bit levels are finer than the float result, which then bounds
+  const QuantizationDomain<uint16_t> q16(domain);
+  const QuantizationDomain<uint32_t> q32(domain);
+  CHECK(q32.stepSize().y < q16.stepSize().y / 60000.f);
+  CHECK(q32.maxError().y < q16.maxError().y / 10.f);
+  CHECK(q16.stepSize().y == Approx(1100.f / 65535.f));
+}
+
+template <typename T>
+static void checkBulk(bool parallel)
+{
+  const QuantizationDomain<T> quantization(domain);
+  const std::vector<vec3f> points = randomPoints(parallel ? 300001 : 1003);
+  const size_t n                  = points.size();
+
+  std::vector<QuantizedVec3<T>> q(n);
+  quantization.quantize(points.data(), q.data(), n, parallel);
+  std::vector<vec3f> p(n);
+  quantization.dequantize(q.data(), p.data(), n, parallel);
+  for (size_t i = 0; i < n; i++) {
+    REQUIRE(q[i] == quantization.quantize(points[i]));
+    REQUIRE(p[i] == quantization.dequantize(q[i]));
+  }
+}
+
+TEST_CASE("QuantizationDomain bulk matches single points", "[quantize]")
+{
+  checkBulk<uint16_t>(false);
+  checkBulk<uint32_t>(false);
+  checkBulk<uint16_t>(true);
+  checkBulk<uint32_t>(true);
+}
+
+TEST_CASE("QuantizationDomain with a flat axis", "[quantize]")
+{
+  const box3f flat(vec3f(0.f, 2.f, 0.f), vec3f(1.f, 2.f, 1.f));
+  const QuantizationDomain<uint16_t> quantization(flat);
+  CHECK(quantization.stepSize().y == 0.f);
+
+  const QuantizedVec3us q = quantization.quantize(vec3f(.5f, 2.f, 1.f));
+  CHECK(q.y == 0);
+  CHECK(q.z == 65535);
+  CHECK(quantization.dequantize(q).y == 2.f);
+}
+
+TEST_CASE("octahedral normals", "[quantize]")
+{
+  std::mt19937 rng(5);
+  std::normal_distribution<float> g;
+  std::vector<vec3f> normals{vec3f(1.f, 0.f, 0.f),
+                             vec3f(-1.f, 0.f, 0.f),
+                             vec3f(0.f, 1.f, 0.f),
+                             vec3f(0.f, -1.f, 0.f),
+                             vec3f(0.f, 0.f, 1.f),
+                             vec3f(0.f, 0.f, -1.f)};
+  while (normals.size() < 10001)
+    normals.push_back(normalize(vec3f(g(rng), g(rng), g(rng))));
+
+  for (const vec3f &n : normals) {
+    const vec3f d = decodeOctahedral(encodeOctahedral(n));
+    REQUIRE(length(d - n) < 1e-4f);
+    REQUIRE(length(d) == Approx(1.f));
+  }
+  // unnormalized input
+  CHECK(decodeOctahedral(encodeOctahedral(vec3f(0.f, 0.f, -5.f))) ==
+        vec3f(0.f, 0.f, -1.f));
+
+  std::vector<vec2s> encoded(normals.size());
+  encodeOctahedral(normals.data(), encoded.data(), normals.size());
+  std::vector<vec3f> decoded(normals.size());
+  decodeOctahedral(encoded.data(), decoded.data(), normals.size());
+  for (size_t i = 0; i < normals.size(); i++) {
+    REQUIRE(encoded[i] == encodeOctahedral(normals[i]));
+    REQUIRE(decoded[i] == decodeOctahedral(encoded[i]));
+  }
+}
+
+// interleaved vertices, as in a vertex buffer
+struct Vertex
+{
+  QuantizedVec3us position;
+  vec2s normal;
+  float u;
+};
+
+TEST_CASE("quantized views of interleaved vertices", "[quantize]")
+{
+  const QuantizationDomain<uint16_t> quantization(domain);
+  const std::vector<vec3f> points = randomPoints(1003);
+  const size_t n                  = points.size();
+
+  std::vector<Vertex> vertices(n);
+  for (size_t i = 0; i < n; i++) {
+    vertices[i].position = quantization.quantize(points[i]);
+    vertices[i].normal   = encodeOctahedral(points[i]);
+  }
+
+  const DequantizedView<uint16_t> positions(
+      utility::DataView<QuantizedVec3us>(&vertices[0].position,
+                                         sizeof(Vertex)),
+      quantization);
+  const OctahedralNormalView normals(
+      utility::DataView<vec2s>(&vertices[0].normal, sizeof(Vertex)));
+
+  std::vector<vec3f> p(n - 10), nrm(n - 10);
+  positions.copyTo(p.data(), 10, n - 10);
+  normals.copyTo(nrm.data(), 10, n - 10);
+  for (size_t i = 0; i < n - 10; i++) {
+    REQUIRE(p[i] == quantization.dequantize(vertices[i + 10].position));
+    REQUIRE(p[i] == positions[i + 10]);
+    REQUIRE(nrm[i] == decodeOctahedral(vertices[i + 10].normal));
+    REQUIRE(nrm[i] == normals[i + 10]);
+  }
+
+  const std::vector<uint32_t> indices{5, 1002, 0, 5, 77};
+  std::vector<vec3f> gathered(indices.size()), gatheredN(indices.size());
+  positions.gather(indices.data(), gathered.data(), indices.size());
+  normals.gather(indices.data(), gatheredN.data(), indices.size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    CHECK(gathered[i] == positions[indices[i]]);
+    CHECK(gatheredN[i] == normals[indices[i]]);
+  }
+
+  // packed positions take the direct path
+  std::vector<QuantizedVec3us> packed(n);
+  for (size_t i = 0; i < n; i++)
+    packed[i] = vertices[i].position;
+  const DequantizedView<uint16_t> packedView(
+      utility::DataView<QuantizedVec3us>(packed.data()), quantization);
+  std::vector<vec3f> q(n - 10);
+  packedView.copyTo(q.data(), 10, n - 10);
+  CHECK(p == q);
+}
@@ -0,0 +1,217 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/quaternionArray.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+
+// quaternions in SoA layout
+struct QuaternionArray
+{
+  QuaternionArray(size_t n) : r(n), i(n), j(n), k(n) {}
+
+  void set(size_t idx, const quatf &q)
+  {
+    r[idx] = q.r;
+    i[idx] = q.i;
+    j[idx] = q.j;
+    k[idx] = q.k;
+  }
+
+  QuaternionStreams streams()
+  {
+    return QuaternionStreams(r.data(), i.data(), j.data(), k.data());
+  }
+
+  std::vector<float> r, i, j, k;
+};
+
+static quatf testRotation(size_t idx)
+{
+  const vec3f axis(1.f + idx % 3, float(idx % 5) - 2.f, .5f + idx % 7);
+  return quatf::rotate(axis, .37f * (idx % 19) - 3.f);
+}
+
+static AffineSpace3f testTransform(size_t idx)
+{
+  const float s = .5f + .25f * (idx % 4);
+  LinearSpace3f scaleShear(vec3f(s, 0.f, 0.f),
+                           vec3f(.1f * (idx % 3), 2.f - s, 0.f),
+                           vec3f(-.2f, .3f * (idx % 2), s));
+  if (idx % 5 == 4)  // mirrored
+    scaleShear.vz.z = -scaleShear.vz.z;
+  return AffineSpace3f(LinearSpace3f(testRotation(idx)) * scaleShear,
+                       vec3f(float(idx), -2.f * idx, .5f));
+}
+
+static void checkNear(const quatf &a, const quatf &b, float eps)
+{
+  CHECK(a.r == Approx(b.r).margin(eps));
+  CHECK(a.i == Approx(b.i).margin(eps));
+  CHECK(a.j == Approx(b.j).margin(eps));
+  CHECK(a.k == Approx(b.k).margin(eps));
+}
+
+static void checkNear(const vec3f &a, const vec3f &b, float eps = 1e-5f)
+{
+  CHECK(a.x == Approx(b.x).margin(eps));
+  CHECK(a.y == Approx(b.y).margin(eps));
+  CHECK(a.z == Approx(b.z).margin(eps));
+}
+
+static void checkNear(const AffineSpace3f &a, const AffineSpace3f &b)
+{
+  checkNear(a.l.vx, b.l.vx);
+  checkNear(a.l.vy, b.l.vy);
+  checkNear(a.l.vz, b.l.vz);
+  checkNear(a.p, b.p, 1e-4f);
+}
+
+static void checkInterpolation(size_t n, bool parallel)
+{
+  QuaternionArray a(n), b(n), s(n), sFast(n), nl(n), nlFast(n);
+  for (size_t idx = 0; idx < n; ++idx) {
+    a.set(idx, testRotation(idx));
+    b.set(idx, testRotation(idx * 7 + 3));
+  }
+  // nearly equal and exactly opposite rotations
+  b.set(0, -a.streams()[0]);
+  if (n > 1)
+    b.set(1, normalize(a.streams()[1] + quatf(0.f, 1e-3f, 0.f, 0.f)));
+
+  for (float t : {0.f, .3f, 1.f}) {
+    const MathPrecision fast = MathPrecision::Fast;
+    const MathPrecision accurate = MathPrecision::Accurate;
+    slerp(t, a.streams(), b.streams(), s.streams(), n, accurate, parallel);
+    slerp(t, a.streams(), b.streams(), sFast.streams(), n, fast, parallel);
+    nlerp(t, a.streams(), b.streams(), nl.streams(), n, accurate, parallel);
+    nlerp(t, a.streams(), b.streams(), nlFast.streams(), n, fast, parallel);
+
+    for (size_t idx = 0; idx < n; ++idx) {
+      const quatf qa = a.streams()[idx];
+      const quatf qb = b.streams()[idx];
+      checkNear(s.streams()[idx], slerp(t, qa, qb), 1e-5f);
+      checkNear(sFast.streams()[idx], slerp(t, qa, qb), 1e-3f);
+      checkNear(nl.streams()[idx], nlerp(t, qa, qb), 1e-6f);
+      checkNear(nlFast.streams()[idx], nlerp(t, qa, qb), 1e-4f);
+    }
+  }
+}
+
+TEST_CASE("batched slerp() and nlerp() match the scalar versions",
+          "[quaternionArray]")
+{
+  SECTION("small arrays, including partial packets")
+  {
+    for (size_t n : {1, 3, 4, 7, 16, 33})
+      checkInterpolation(n, false);
+  }
+
+  SECTION("arrays split across parallel_for()")
+  {
+    checkInterpolation(QUATERNION_PARALLEL_THRESHOLD + 5, true);
+  }
+}
+
+TEST_CASE("slerp() can interpolate in place", "[quaternionArray]")
+{
+  const size_t n = 9;
+  QuaternionArray a(n), b(n);
+  for (size_t idx = 0; idx < n; ++idx) {
+    a.set(idx, testRotation(idx));
+    b.set(idx, testRotation(idx + 1));
+  }
+  QuaternionArray ref = a;
+  slerp(.5f, a.streams(), b.streams(), ref.streams(), n);
+  slerp(.5f, a.streams(), b.streams(), a.streams(), n);
+  CHECK(a.r == ref.r);
+  CHECK(a.k == ref.k);
+}
+
+TEST_CASE("toLinearSpace() matches LinearSpace3f(quatf)", "[quaternionArray]")
+{
+  const size_t n = 21;
+  QuaternionArray q(n);
+  for (size_t idx = 0; idx < n; ++idx)
+    q.set(idx, testRotation(idx));
+
+  std::vector<LinearSpace3f> out(n);
+  toLinearSpace(q.streams(), out.data(), n);
+
+  for (size_t idx = 0; idx < n; ++idx) {
+    const LinearSpace3f ref(q.streams()[idx]);
+    checkNear(out[idx].vx, ref.vx);
+    checkNear(out[idx].vy, ref.vy);
+    checkNear(out[idx].vz, ref.vz);
+  }
+}
+
+TEST_CASE("decompose() and compose() round trip", "[quaternionArray]")
+{
+  const size_t n = 23;
+  std::vector<AffineSpace3f> xfms(n);
+  for (size_t idx = 0; idx < n; ++idx)
+    xfms[idx] = testTransform(idx);
+
+  QuaternionArray rotation(n);
+  std::vector<LinearSpace3f> scaleShear(n);
+  std::vector<vec3f> translation(n);
+  decompose(xfms.data(),
+            rotation.streams(),
+            scaleShear.data(),
+            translation.data(),
+            n);
+
+  for (size_t idx = 0; idx < n; ++idx) {
+    const quatf q = rotation.streams()[idx];
+    CHECK(dot(q, q) == Approx(1.f).epsilon(1e-5));
+    CHECK(translation[idx] == xfms[idx].p);
+    CHECK(scaleShear[idx].vx.y == 0.f);
+    CHECK(scaleShear[idx].vx.z == 0.f);
+    CHECK(scaleShear[idx].vy.z == 0.f);
+    CHECK((scaleShear[idx].vz.z < 0.f) == (idx % 5 == 4));
+  }
+
+  std::vector<AffineSpace3f> out(n);
+  compose(rotation.streams(),
+          scaleShear.data(),
+          translation.data(),
+          out.data(),
+          n);
+  for (size_t idx = 0; idx < n; ++idx)
+    checkNear(out[idx], xfms[idx]);
+}
+
+TEST_CASE("interpolateTransforms() interpolates the decomposed keys",
+          "[quaternionArray]")
+{
+  const size_t n = 13;
+  std::vector<AffineSpace3f> keys0(n), keys1(n);
+  for (size_t idx = 0; idx < n; ++idx) {
+    keys0[idx] = testTransform(idx);
+    keys1[idx] = testTransform(idx + 4);
+  }
+
+  std::vector<AffineSpace3f> out(n);
+  interpolateTransforms(0.f, keys0.data(), keys1.data(), out.data(), n);
+  for (size_t idx = 0; idx < n; ++idx)
+    checkNear(out[idx], keys0[idx]);
+
+  interpolateTransforms(1.f, keys0.data(), keys1.data(), out.data(), n);
+  for (size_t idx = 0; idx < n; ++idx)
+    checkNear(out[idx], keys1[idx]);
+
+  // a pure rotation keeps its length along the way
+  const AffineSpace3f r0(LinearSpace3f(quatf(one)), vec3f(0.f));
+  const AffineSpace3f r1(LinearSpace3f(quatf::rotate(vec3f(0, 0, 1), 3.f)),
+                         vec3f(2.f, 0.f, 0.f));
+  AffineSpace3f half;
+  interpolateTransforms(.5f, &r0, &r1, &half, 1);
+  checkNear(half.l.vx, vec3f(std::cos(1.5f), std::sin(1.5f), 0.f));
+  checkNear(half.p, vec3f(1.f, 0.f, 0.f));
+}
@@ -437,3 +437,94 @@ TEST_CASE("Vector reductions", "[vec]")
     test_reduce_max_4<vec4d>();
   }
 }
+
+TEST_CASE("vec4f and vec3fa match the scalar results", "[vec]")
+{
+  const vec4f a(1.5f, -2.f, 3.25f, 0.1f);
+  const vec4f b(0.3f, 4.f, -1.f, 7.f);
+
+  const vec4f sum = a + b;
+  const vec4f quot = a / b;
+  const vec4f scaled = 2.f * a - b * 0.5f;
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE(sum[i] == a[i] + b[i]);
+    REQUIRE(quot[i] == a[i] / b[i]);
+    REQUIRE(scaled[i] == 2.f * a[i] - b[i] * 0.5f);
+    REQUIRE(rcp(a)[i] == rcp(a[i]));
+    REQUIRE(madd(a, b, a)[i] == a[i] * b[i] + a[i]);
+  }
+  REQUIRE(dot(a, b) == a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+  REQUIRE(-a == vec4f(-1.5f, 2.f, -3.25f, -0.1f));
+  REQUIRE(min(a, b) == vec4f(0.3f, -2.f, -1.f, 0.1f));
+  REQUIRE(max(a, b) == vec4f(1.5f, 4.f, 3.25f, 7.f));
+
+  vec4f c = a;
+  c += b;
+  c *= 2.f;
+  REQUIRE(c == (a + b) * 2.f);
+
+  const vec3fa p(1.5f, -2.f, 3.25f);
+  const vec3fa q(0.3f, 4.f, -1.f);
+  const vec3f r = p * q;
+  REQUIRE(r == vec3f(1.5f * 0.3f, -2.f * 4.f, 3.25f * -1.f));
+  REQUIRE(dot(p, q) == p.x * q.x + p.y * q.y + p.z * q.z);
+  REQUIRE(madd(p, q, p) == vec3fa(madd(p.x, q.x, p.x),
+                                  madd(p.y, q.y, p.y),
+                                  madd(p.z, q.z, p.z)));
+
+  const vec3fa n = normalize(p);
+  const float s  = rsqrt(dot(p, p));
+  REQUIRE(n == vec3fa(p.x * s, p.y * s, p.z * s));
+
+  // like std::min/max, ties return the first argument
+  REQUIRE(std::signbit(min(vec4f(0.f), vec4f(-0.f)).x) == false);
+  REQUIRE(std::signbit(max(vec3fa(-0.f), vec3fa(0.f)).y) == true);
+}
+
+// a table as it would be used in e.g. Marching Cubes, built at compile time
+static constexpr vec3i cubeCorners[8] = {vec3i(0, 0, 0),
+                                         vec3i(1, 0, 0),
+                                         vec3i(0, 1, 0),
+                                         vec3i(1, 1, 0),
+                                         vec3i(0, 0, 1),
+                                         vec3i(1, 0, 1),
+                                         vec3i(0, 1, 1),
+                                         vec3i(1, 1, 1)};
+
+TEST_CASE("Vector constant expressions", "[vec]")
+{
+  static_assert(cubeCorners[7] - cubeCorners[1] == vec3i(0, 1, 1), "");
+  static_assert(2 * cubeCorners[3] + 1 == vec3i(3, 3, 1), "");
+  static_assert(-cubeCorners[5] != cubeCorners[5], "");
+  static_assert(anyLessThan(cubeCorners[4], cubeCorners[3]), "");
+  static_assert(dot(vec3f(1.f, 2.f, 3.f), vec3f(4.f)) == 24.f, "");
+  static_assert(cross(vec3f(1.f, 0.f, 0.f), vec3f(0.f, 1.f, 0.f)) ==
+                    vec3f(0.f, 0.f, 1.f),
+                "");
+  static_assert(vec3l(vec3i(3, 4, 5)).long_product() == 60, "");
+  static_assert(vec2f(1.5f, 2.f).sum() == 3.5f, "");
+  static_assert(reduce_add(vec4i(1, 2, 3, 4)) == 10, "");
+  static_assert(reduce_mul(vec4i(1, 2, 3, 4)) == 24, "");
+  static_assert(madd(vec3f(2.f), vec3f(3.f), vec3f(1.f)) == vec3f(7.f), "");
+  static_assert(vec2i(7, 9) % 4 == vec2i(3, 1), "");
+
+#if defined(RKCOMMON_HAS_IS_CONSTANT_EVALUATED) && !defined(RKCOMMON_NO_SIMD)
+  // the SSE overloads fall back to scalar code
+  constexpr vec4f a(1.f, 2.f, 3.f, 4.f);
+  static_assert(a + a == vec4f(2.f, 4.f, 6.f, 8.f), "");
+  static_assert(a * 2.f - a == a, "");
+  static_assert(dot(a, a) == 30.f, "");
+  static_assert(min(a, vec4f(2.f)) == vec4f(1.f, 2.f, 2.f, 2.f), "");
+  static_assert(max(-a, vec4f(-2.f)) == vec4f(-1.f, -2.f, -2.f, -2.f), "");
+  static_assert(madd(a, a, a) == vec4f(2.f, 6.f, 12.f, 20.f), "");
+  constexpr vec3fa p(1.f, 2.f, 3.f);
+  static_assert(p / 2.f == vec3f(.5f, 1.f, 1.5f), "");
+  static_assert(dot(p, p) == 14.f, "");
+#endif
+
+  // ...and the same operations give the same results at runtime
+  const vec4f a4(1.f, 2.f, 3.f, 4.f);
+  CHECK(min(a4, vec4f(2.f)) == vec4f(1.f, 2.f, 2.f, 2.f));
+  CHECK(dot(a4, a4) == 30.f);
+  CHECK(cubeCorners[6] == vec3i(0, 1, 1));
+}
@@ -0,0 +1,224 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/xfmArray.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+
+static AffineSpace3f testTransform()
+{
+  return AffineSpace3f::translate(vec3f(1.f, -2.f, 3.f)) *
+         AffineSpace3f::rotate(vec3f(1.f, 1.f, 0.f), .7f) *
+         AffineSpace3f::scale(vec3f(2.f, .5f, 1.5f));
+}
+
+static std::vector<vec3f> testPoints(size_t n)
+{
+  std::vector<vec3f> points(n);
+  for (size_t i = 0; i < n; ++i)
+    points[i] = vec3f(i % 101, float(i % 37) - 18.f, .25f * (i % 13));
+  return points;
+}
+
+static void checkNear(const vec3f &a, const vec3f &b)
+{
+  CHECK(a.x == Approx(b.x).margin(1e-5));
+  CHECK(a.y == Approx(b.y).margin(1e-5));
+  CHECK(a.z == Approx(b.z).margin(1e-5));
+}
+
+static void checkPoints(size_t n, bool parallel)
+{
+  const AffineSpace3f xfm  = testTransform();
+  const std::vector<vec3f> in = testPoints(n);
+  std::vector<vec3f> out(n);
+
+  const box3f bounds = xfmPoints(xfm, in.data(), out.data(), n, parallel);
+
+  box3f ref(empty);
+  for (size_t i = 0; i < n; ++i) {
+    const vec3f p = xfmPoint(xfm, in[i]);
+    checkNear(out[i], p);
+    ref.extend(p);
+  }
+
+  checkNear(bounds.lower, ref.lower);
+  checkNear(bounds.upper, ref.upper);
+}
+
+TEST_CASE("xfmPoints() matches xfmPoint() and returns the bounds",
+          "[xfmArray]")
+{
+  SECTION("small arrays, including partial packets")
+  {
+    for (size_t n : {1, 3, 4, 7, 16, 33})
+      checkPoints(n, false);
+  }
+
+  SECTION("arrays split across parallel_for()")
+  {
+    checkPoints(XFM_PARALLEL_THRESHOLD + 5, true);
+  }
+}
+
+TEST_CASE("xfmPoints() of an empty array returns empty bounds", "[xfmArray]")
+{
+  const box3f bounds = xfmPoints(testTransform(), nullptr, nullptr, 0);
+  CHECK(bounds.empty());
+}
+
+TEST_CASE("xfmPoints() reads strided input through a DataView", "[xfmArray]")
+{
+  struct Vertex
+  {
+    vec3f position;
+    vec3f normal;
+    float u, v;
+  };
+
+  const size_t n = 45;
+  const std::vector<vec3f> positions = testPoints(n);
+  std::vector<Vertex> vertices(n);
+  for (size_t i = 0; i < n; ++i)
+    vertices[i].position = positions[i];
+
+  const AffineSpace3f xfm = testTransform();
+  std::vector<vec3f> fromView(n);
+  std::vector<vec3f> fromArray(n);
+
+  const utility::DataView<vec3f> view(&vertices[0].position, sizeof(Vertex));
+  const box3f viewBounds = xfmPoints(xfm, view, fromView.data(), n);
+  const box3f arrayBounds =
+      xfmPoints(xfm, positions.data(), fromArray.data(), n);
+
+  CHECK(fromView == fromArray);
+  CHECK(viewBounds == arrayBounds);
+}
+
+TEST_CASE("xfmPoints() can transform in place", "[xfmArray]")
+{
+  const AffineSpace3f xfm = testTransform();
+  const std::vector<vec3f> in = testPoints(21);
+
+  std::vector<vec3f> ref(in.size());
+  xfmPoints(xfm, in.data(), ref.data(), in.size());
+
+  std::vector<vec3f> inPlace = in;
+  xfmPoints(xfm, inPlace.data(), inPlace.data(), inPlace.size());
+
+  CHECK(inPlace == ref);
+}
+
+TEST_CASE("xfmVectors() and xfmNormals() match the scalar versions",
+          "[xfmArray]")
+{
+  const AffineSpace3f xfm = testTransform();
+
+  for (size_t n : {size_t(5), XFM_PARALLEL_THRESHOLD + 3}) {
+    const std::vector<vec3f> in = testPoints(n);
+    std::vector<vec3f> vectors(n);
+    std::vector<vec3f> normals(n);
+
+    xfmVectors(xfm, in.data(), vectors.data(), n);
+    xfmNormals(xfm, utility::DataView<vec3f>(in.data()), normals.data(), n);
+
+    for (size_t i = 0; i < n; i += 7) {
+      checkNear(vectors[i], xfmVector(xfm, in[i]));
+      checkNear(normals[i], xfmNormal(xfm, in[i]));
+    }
+  }
+}
+
+TEST_CASE("xfmBounds() of instance arrays matches the scalar version",
+          "[xfmArray]")
+{
+  for (size_t n : {size_t(1), size_t(13), XFM_PARALLEL_THRESHOLD + 9}) {
+    std::vector<AffineSpace3f> xfms(n);
+    std::vector<box3f> boxes(n);
+    const std::vector<vec3f> points = testPoints(n);
+    for (size_t i = 0; i < n; ++i) {
+      xfms[i] = AffineSpace3f::translate(points[i]) *
+                AffineSpace3f::rotate(vec3f(0.f, 1.f, 1.f), .1f * (i % 17));
+      boxes[i] = i % 5 == 3 ? box3f(empty)
+                            : box3f(-points[i], points[i] + vec3f(1.f));
+    }
+
+    std::vector<box3f> out(n);
+    const box3f bounds = xfmBounds(xfms.data(), boxes.data(), out.data(), n);
+
+    box3f ref(empty);
+    for (size_t i = 0; i < n; ++i) {
+      const box3f b = xfmBounds(xfms[i], boxes[i]);
+      CHECK(out[i].empty() == b.empty());
+      if (!b.empty()) {
+        checkNear(out[i].lower, b.lower);
+        checkNear(out[i].upper, b.upper);
+      }
+      ref.extend(b);
+    }
+    checkNear(bounds.lower, ref.lower);
+    checkNear(bounds.upper, ref.upper);
+  }
+}
+
+TEST_CASE("xfmBounds() of instances can share one object box", "[xfmArray]")
+{
+  const size_t n = 19;
+  std::vector<AffineSpace3f> xfms(n);
+  for (size_t i = 0; i < n; ++i)
+    xfms[i] = AffineSpace3f::translate(vec3f(2.f * i, 0.f, 0.f));
+
+  const box3f object(vec3f(-1.f), vec3f(1.f));
+  std::vector<box3f> out(n);
+  const box3f bounds =
+      xfmBounds(utility::DataView<AffineSpace3f>(xfms.data()),
+                utility::DataView<box3f>(&object, 0),
+                out.data(),
+                n);
+
+  for (size_t i = 0; i < n; ++i)
+    CHECK(out[i] == box3f(vec3f(2.f * i - 1.f, -1.f, -1.f),
+                          vec3f(2.f * i + 1.f, 1.f, 1.f)));
+  CHECK(bounds == box3f(vec3f(-1.f), vec3f(2.f * n - 1.f, 1.f, 1.f)));
+}
+
+TEST_CASE("rcp() of transform arrays matches the scalar version",
+          "[xfmArray]")
+{
+  for (size_t n : {size_t(1), size_t(13), XFM_PARALLEL_THRESHOLD + 9}) {
+    std::vector<AffineSpace3f> xfms(n);
+    std::vector<AffineSpace3f> rigid(n);
+    const std::vector<vec3f> points = testPoints(n);
+    for (size_t i = 0; i < n; ++i) {
+      rigid[i] = AffineSpace3f::translate(points[i]) *
+                 AffineSpace3f::rotate(vec3f(0.f, 1.f, 1.f), .1f * (i % 17));
+      xfms[i] = rigid[i] * AffineSpace3f::scale(vec3f(1.f + i % 3, 2.f, .5f));
+    }
+
+    std::vector<AffineSpace3f> out(n);
+    rcp(xfms.data(), out.data(), n);
+    for (size_t i = 0; i < n; i += 7) {
+      const AffineSpace3f ref = rcp(xfms[i]);
+      checkNear(out[i].l.vx, ref.l.vx);
+      checkNear(out[i].l.vy, ref.l.vy);
+      checkNear(out[i].l.vz, ref.l.vz);
+      checkNear(out[i].p, ref.p);
+    }
+
+    // in place
+    std::vector<AffineSpace3f> inv(rigid);
+    rcpOrthonormal(inv.data(), inv.data(), n);
+    for (size_t i = 0; i < n; i += 7) {
+      const AffineSpace3f ref = rcp(rigid[i]);
+      checkNear(inv[i].l.vx, ref.l.vx);
+      checkNear(inv[i].l.vy, ref.l.vy);
+      checkNear(inv[i].l.vz, ref.l.vz);
+      checkNear(inv[i].p, ref.p);
+    }
+  }
+}
@@ -1,5 +1,33 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/memory/DeletedUniquePtr.h"
+
+using namespace rkcommon::memory;
+
+TEST_CASE("DeletedUniquePtr calls its deleter", "[DeletedUniquePtr]")
+{
+  int deleted = 0;
+  {
+    auto p = make_deleted_unique<int>(
+        [&](int *i) {
+          deleted += *i;
+          delete i;
+        },
+        5);
+    REQUIRE(*p == 5);
+
+    DeletedUniquePtr<int> moved = std::move(p);
+    REQUIRE(!p);
+    REQUIRE(deleted == 0);
+  }
+  REQUIRE(deleted == 5);
+}
+
+TEST_CASE("DeletedUniquePtr stores its deleter inline", "[DeletedUniquePtr]")
+{
+  // the pointer plus a deleter of up to two pointers and its dispatch table
+  REQUIRE(sizeof(DeletedUniquePtr<int>) <= 4 * sizeof(void *));
+}
@@ -0,0 +1,94 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/memory/EpochManager.h"
+#include "rkcommon/tasking/parallel_for.h"
+
+#include <atomic>
+#include <new>
+
+using namespace rkcommon::memory;
+
+static std::atomic<int> numFreed{0};
+
+static void countingFree(void *ptr)
+{
+  alignedFree(ptr);
+  numFreed++;
+}
+
+TEST_CASE("retired memory waits for pinned readers", "[EpochManager]")
+{
+  numFreed = 0;
+  EpochManager epochs;
+
+  {
+    auto guard = epochs.pin();
+    epochs.retire(alignedMalloc(16), &countingFree);
+
+    // the epoch can advance at most once while this thread is pinned
+    for (int i = 0; i < 10; ++i)
+      epochs.collect();
+    REQUIRE(numFreed == 0);
+    REQUIRE(epochs.numRetired() == 1);
+
+    // nesting keeps the thread pinned
+    { auto inner = epochs.pin(); }
+    epochs.collect();
+    REQUIRE(numFreed == 0);
+  }
+
+  for (int i = 0; i < 3; ++i)
+    epochs.collect();
+  REQUIRE(numFreed == 1);
+  REQUIRE(epochs.numRetired() == 0);
+}
+
+TEST_CASE("destructor frees everything retired", "[EpochManager]")
+{
+  numFreed = 0;
+  {
+    EpochManager epochs;
+    auto guard = epochs.pin();
+    for (int i = 0; i < 10; ++i)
+      epochs.retire(alignedMalloc(16), &countingFree);
+  }
+  REQUIRE(numFreed == 10);
+}
+
+struct Node
+{
+  explicit Node(int _value) : value(_value) {}
+  ~Node()
+  {
+    value = -1;
+  }
+  int value;
+};
+
+TEST_CASE("readers never see freed nodes", "[EpochManager]")
+{
+  EpochManager epochs;
+  std::atomic<Node *> head{new (alignedMalloc(sizeof(Node))) Node(0)};
+  std::atomic<bool> bad{false};
+
+  rkcommon::tasking::parallel_for(4, [&](int task) {
+    for (int i = 1; i <= 2000; ++i) {
+      if (task == 0) {
+        // writer: replace the node and retire the old one
+        Node *fresh = new (alignedMalloc(sizeof(Node))) Node(i);
+        Node *old   = head.exchange(fresh);
+        epochs.retireObject(old);
+      } else {
+        auto guard = epochs.pin();
+        if (head.load()->value < 0)
+          bad = true;
+      }
+    }
+  });
+
+  REQUIRE(!bad);
+  epochs.retireObject(head.load());
+}
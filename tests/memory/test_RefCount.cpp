@@ -4,8 +4,10 @@
 #include "../catch.hpp"
 #include "rkcommon/memory/RefCount.h"
 
-using rkcommon::memory::Ref;
-using rkcommon::memory::RefCount;
+#include <thread>
+#include <vector>
+
+using namespace rkcommon::memory;
 
 SCENARIO("Ref interface tests", "[Ref]")
 {
@@ -32,3 +34,143 @@ SCENARIO("Ref interface tests", "[Ref]")
     }
   }
 }
+
+template <typename COUNTER>
+struct Counted : public BasicRefCountedObject<COUNTER>
+{
+  explicit Counted(int &_alive) : alive(_alive)
+  {
+    alive++;
+  }
+
+  ~Counted() override
+  {
+    alive--;
+  }
+
+  int &alive;
+};
+
+TEMPLATE_TEST_CASE("reference counter policies",
+                   "[Ref]",
+                   AtomicRefCounter,
+                   SingleThreadRefCounter,
+                   BiasedRefCounter)
+{
+  int alive = 0;
+  {
+    Ref<Counted<TestType>> a(new Counted<TestType>(alive));
+    a->refDec();  // Ref<> took its own reference
+    REQUIRE(a->useCount() == 1);
+    {
+      auto b = a;
+      REQUIRE(a->useCount() == 2);
+      RefView<Counted<TestType>> view(b);
+      REQUIRE(view->useCount() == 2);
+      REQUIRE(view.ref()->useCount() == 3);
+    }
+    REQUIRE(a->useCount() == 1);
+    REQUIRE(alive == 1);
+  }
+  REQUIRE(alive == 0);
+}
+
+TEST_CASE("biased reference counts from other threads", "[Ref]")
+{
+  using Object = Counted<BiasedRefCounter>;
+
+  int alive = 0;
+  Ref<Object> owned(new Object(alive));
+  owned->refDec();
+
+  // other threads release references the owner handed them, and take and
+  // release their own
+  std::vector<Ref<Object>> handedOut(4, owned);
+  std::vector<std::thread> threads;
+  for (auto &r : handedOut) {
+    threads.emplace_back([&r]() {
+      for (int i = 0; i < 1000; ++i) {
+        Ref<Object> copy = r;
+      }
+      r = nullptr;
+    });
+  }
+  for (auto &t : threads)
+    t.join();
+
+  REQUIRE(owned->useCount() == 1);
+  REQUIRE(alive == 1);
+
+  // the last reference goes away on another thread, the owner has to merge
+  // to see that
+  {
+    Ref<Object> last = owned;
+    owned            = nullptr;
+    std::thread([&last]() { last = nullptr; }).join();
+  }
+  REQUIRE(alive == 1);
+  BiasedRefCounter::mergeQueued();
+  REQUIRE(alive == 0);
+
+  // objects owned by an exited thread are merged by whoever releases them
+  Ref<Object> orphan;
+  std::thread([&]() {
+    orphan = new Object(alive);
+    orphan->refDec();
+  }).join();
+  REQUIRE(alive == 1);
+  orphan = nullptr;
+  REQUIRE(alive == 0);
+}
+
+struct Pooled : public RefCount
+{
+  Pooled(int &_alive, int _value) : alive(_alive), value(_value)
+  {
+    alive++;
+  }
+
+  ~Pooled() override
+  {
+    alive--;
+  }
+
+  int &alive;
+  int value;
+};
+
+TEST_CASE("make_intrusive from the type's pool", "[Ref]")
+{
+  int alive = 0;
+  Pooled *first = nullptr;
+  {
+    auto a = make_intrusive<Pooled>(alive, 1);
+    auto b = make_intrusive<Pooled>(alive, 2);
+    REQUIRE(alive == 2);
+    REQUIRE(a->useCount() == 1);
+    REQUIRE(a->value == 1);
+    REQUIRE(b->value == 2);
+    first = a.ptr;
+  }
+  REQUIRE(alive == 0);
+
+  // the released slot is reused
+  auto c = make_intrusive<Pooled>(alive, 3);
+  REQUIRE(c.ptr == first);
+  REQUIRE(c->value == 3);
+}
+
+TEST_CASE("make_intrusive in an Arena", "[Ref]")
+{
+  Arena arena;
+  int alive = 0;
+  {
+    Ref<Pooled> a = make_intrusive<Pooled>(arena, alive, 1);
+    Ref<Pooled> b = a;
+    REQUIRE(alive == 1);
+    REQUIRE(a->useCount() == 2);
+    REQUIRE(arena.bytesUsed() >= sizeof(Pooled));
+  }
+  REQUIRE(alive == 0);
+  arena.reset();
+}
@@ -0,0 +1,93 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/memory/ScratchBuffer.h"
+#include "rkcommon/tasking/parallel_for.h"
+
+#include <atomic>
+#include <cstdint>
+
+using namespace rkcommon::memory;
+
+TEST_CASE("ScratchBuffer allocations are aligned and rewound",
+          "[ScratchBuffer]")
+{
+  ScratchBuffer buffer(1024);
+  REQUIRE(buffer.bytesUsed() == 0);
+
+  {
+    ScratchScope outer(buffer);
+    auto *a = outer.allocate<float>(10);
+    REQUIRE(uintptr_t(a) % 64 == 0);
+    const size_t afterOuter = buffer.bytesUsed();
+    REQUIRE(afterOuter >= 10 * sizeof(float));
+
+    {
+      ScratchScope inner(buffer);
+      auto *b = static_cast<char *>(inner.allocate(3, 1));
+      auto *c = inner.allocate<double>(4, 16);
+      REQUIRE(b >= reinterpret_cast<char *>(a + 10));
+      REQUIRE(uintptr_t(c) % 16 == 0);
+    }
+
+    REQUIRE(buffer.bytesUsed() == afterOuter);
+  }
+
+  REQUIRE(buffer.bytesUsed() == 0);
+}
+
+TEST_CASE("ScratchBuffer grows once and is then reused", "[ScratchBuffer]")
+{
+  ScratchBuffer buffer(1024);
+
+  {
+    ScratchScope scope(buffer);
+    // larger than the initial block, forces new blocks
+    auto *a = scope.allocate<uint8_t>(4000);
+    auto *b = scope.allocate<uint8_t>(20000);
+    a[3999] = b[19999] = 1;
+  }
+
+  const size_t reserved = buffer.bytesReserved();
+  REQUIRE(reserved >= 24000);
+
+  for (int i = 0; i < 10; ++i) {
+    ScratchScope scope(buffer);
+    scope.allocate<uint8_t>(4000);
+    scope.allocate<uint8_t>(20000);
+  }
+
+  // merged into one block, fitting the peak without growing again
+  REQUIRE(buffer.bytesReserved() == reserved);
+}
+
+TEST_CASE("ScratchBuffer reserve", "[ScratchBuffer]")
+{
+  ScratchBuffer buffer(64);
+  buffer.reserve(1 << 20);
+  REQUIRE(buffer.bytesReserved() >= size_t(1) << 20);
+
+  ScratchScope scope(buffer);
+  scope.allocate<uint8_t>(1000000, 1);
+  REQUIRE(buffer.bytesReserved() == size_t(1) << 20);
+}
+
+TEST_CASE("ScratchBuffer per tasking thread", "[ScratchBuffer]")
+{
+  std::atomic<int> errors{0};
+
+  rkcommon::tasking::parallel_for(1000, [&](int i) {
+    ScratchScope scratch;
+    int *values = scratch.allocate<int>(1000 + i);
+    for (int j = 0; j < 1000 + i; ++j)
+      values[j] = i;
+    for (int j = 0; j < 1000 + i; ++j)
+      if (values[j] != i)
+        errors++;
+  });
+
+  REQUIRE(errors == 0);
+  REQUIRE(ScratchBuffer::current().bytesUsed() == 0);
+}
@@ -1,5 +1,310 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
+#include "rkcommon/containers/AlignedVector.h"
+#include "rkcommon/containers/FlatMap.h"
 #include "rkcommon/memory/malloc.h"
+#include "rkcommon/tasking/parallel_for.h"
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::memory;
+
+TEST_CASE("Arena bump allocation and reset", "[malloc]")
+{
+  Arena arena(4096);
+  REQUIRE(arena.bytesReserved() == 0);
+
+  void *a = arena.allocate(100);
+  void *b = arena.allocate(100, 256);
+  REQUIRE(isAligned(a));
+  REQUIRE(isAligned(b, 256));
+  REQUIRE(a != b);
+  REQUIRE(arena.bytesUsed() == 200);
+  REQUIRE(arena.bytesReserved() == 4096);
+
+  // larger than a block
+  float *big = arena.allocate<float>(10000);
+  big[9999]  = 1.f;
+  REQUIRE(arena.bytesReserved() >= 4096 + 40000);
+
+  // the next frame reuses the blocks
+  const size_t reserved = arena.bytesReserved();
+  arena.reset();
+  REQUIRE(arena.bytesUsed() == 0);
+  REQUIRE(arena.allocate(100) == a);
+  arena.allocate<float>(10000);
+  REQUIRE(arena.bytesReserved() == reserved);
+
+  arena.release();
+  REQUIRE(arena.bytesReserved() == 0);
+}
+
+TEST_CASE("ArenaAllocator backs vectors and FlatMap", "[malloc]")
+{
+  Arena arena;
+
+  containers::ArenaVector<int> v{memory::ArenaAllocator<int>(arena)};
+  for (int i = 0; i < 1000; ++i)
+    v.push_back(i);
+  REQUIRE(v[999] == 999);
+  REQUIRE(isAligned(v.data()));
+
+  using alloc_t = ArenaAllocator<std::pair<int, std::string>>;
+  containers::FlatMap<int, std::string, containers::SplitKeys, alloc_t> m{
+      alloc_t(arena)};
+  m[1] = "one";
+  m[2] = "two";
+  REQUIRE(m.at(2) == "two");
+  REQUIRE(m.contains(1));
+
+  REQUIRE(arena.bytesUsed() > 1000 * sizeof(int));
+}
+
+TEST_CASE("FixedPool reuses slots", "[malloc]")
+{
+  FixedPool<std::string> pool(4);
+
+  std::string *a = pool.create("a");
+  std::string *b = pool.create(100, 'b');
+  REQUIRE(*a == "a");
+  REQUIRE(b->size() == 100);
+  REQUIRE(isAligned(a, alignof(std::string)));
+
+  pool.destroy(a);
+  REQUIRE(pool.create("c") == a);
+
+  std::set<std::string *> unique;
+  std::vector<std::string *> many;
+  for (int i = 0; i < 100; ++i) {
+    many.push_back(pool.create(std::to_string(i)));
+    unique.insert(many.back());
+  }
+  REQUIRE(unique.size() == 100);
+  for (int i = 0; i < 100; ++i)
+    REQUIRE(*many[i] == std::to_string(i));
+
+  for (auto *s : many)
+    pool.destroy(s);
+  pool.destroy(a);
+  pool.destroy(b);
+}
+
+TEST_CASE("FixedPool returns slots across threads", "[malloc]")
+{
+  FixedPool<int> pool;
+
+  const int N = 10000;
+  std::vector<int *> ptrs(N);
+
+  // allocate on one thread, release on the workers
+  for (int i = 0; i < N; ++i)
+    ptrs[i] = pool.create(i);
+
+  std::atomic<long long> sum{0};
+  tasking::parallel_for(N, [&](int i) {
+    sum += *ptrs[i];
+    pool.destroy(ptrs[i]);
+  });
+  REQUIRE(sum.load() == (long long)N * (N - 1) / 2);
+
+  // the returned slots are picked up again by the allocating thread
+  std::set<int *> before(ptrs.begin(), ptrs.end());
+  int reused = 0;
+  for (int i = 0; i < N; ++i) {
+    int *p = pool.allocate();
+    reused += before.count(p) ? 1 : 0;
+    pool.deallocate(p);
+  }
+  REQUIRE(reused > 0);
+
+  // and allocating from many threads at once
+  std::vector<int *> parallelPtrs(N);
+  tasking::parallel_for(N, [&](int i) { parallelPtrs[i] = pool.create(i); });
+  std::set<int *> unique(parallelPtrs.begin(), parallelPtrs.end());
+  REQUIRE(unique.size() == size_t(N));
+  for (int i = 0; i < N; ++i)
+    REQUIRE(*parallelPtrs[i] == i);
+  tasking::parallel_for(N, [&](int i) { pool.destroy(parallelPtrs[i]); });
+}
+
+static const AllocationStats *findTag(const std::vector<AllocationStats> &all,
+                                      const std::string &tag)
+{
+  for (const auto &s : all) {
+    if (tag == s.tag)
+      return &s;
+  }
+  return nullptr;
+}
+
+TEST_CASE("allocation tracking by tag", "[malloc]")
+{
+  REQUIRE(!allocationTrackingEnabled());
+
+  // not tracked while tracking is off
+  void *before = alignedMalloc(1000);
+
+  setAllocationTracking(true);
+
+  void *a = nullptr;
+  void *b = nullptr;
+  {
+    ScopedAllocationTag tag("test_malloc_outer");
+    a = alignedMalloc(4096);
+    {
+      ScopedAllocationTag inner("test_malloc_inner");
+      b = alignedMalloc(100);
+    }
+    alignedFree(alignedMalloc(8192));
+  }
+
+  auto stats        = allocationStatistics();
+  const auto *outer = findTag(stats, "test_malloc_outer");
+  const auto *inner = findTag(stats, "test_malloc_inner");
+  REQUIRE(outer);
+  REQUIRE(inner);
+  REQUIRE(outer->liveBytes == 4096);
+  REQUIRE(outer->peakBytes == 4096 + 8192);
+  REQUIRE(outer->allocatedBytes == 4096 + 8192);
+  REQUIRE(outer->numAllocations == 2);
+  REQUIRE(outer->numFrees == 1);
+  REQUIRE(inner->liveBytes == 100);
+
+  setAllocationTracking(false);
+
+  // allocations made while tracking was on are still accounted
+  alignedFree(a);
+  alignedFree(b);
+  alignedFree(before);
+
+  stats = allocationStatistics();
+  REQUIRE(findTag(stats, "test_malloc_outer")->liveBytes == 0);
+  REQUIRE(findTag(stats, "test_malloc_outer")->peakBytes == 4096 + 8192);
+  REQUIRE(findTag(stats, "test_malloc_inner")->liveBytes == 0);
+}
+
+TEST_CASE("numaAlignedMalloc with every policy", "[malloc]")
+{
+  const NumaPolicy policies[] = {NumaPolicy::LOCAL,
+                                 NumaPolicy::INTERLEAVED,
+                                 NumaPolicy::FIRST_TOUCH_PARALLEL};
+
+  for (auto policy : policies) {
+    for (size_t size : {size_t(100), hugePageSize() * 3 + 123}) {
+      char *p = static_cast<char *>(numaAlignedMalloc(size, 64, policy));
+      REQUIRE(p != nullptr);
+      REQUIRE(size_t(p) % 64 == 0);
+      REQUIRE(p[0] == 0);
+      REQUIRE(p[size - 1] == 0);
+      p[size - 1] = 1;
+      numaAlignedFree(p, size);
+    }
+  }
+}
+
+TEST_CASE("NumaAlignedVector", "[malloc]")
+{
+  rkcommon::containers::NumaAlignedVector<int> v(1 << 20, 3);
+  REQUIRE(size_t(v.data()) % 64 == 0);
+  v.push_back(4);
+  REQUIRE(v.size() == (1 << 20) + 1);
+  REQUIRE(v.front() == 3);
+  REQUIRE(v.back() == 4);
+
+  rkcommon::containers::NumaAlignedVector<float, NumaPolicy::INTERLEAVED> w;
+  w.resize(10, 1.f);
+  REQUIRE(w[9] == 1.f);
+}
+
+namespace {
+
+  // stands in for a GPU runtime's pinned/shared allocations
+  struct FakeDevice
+  {
+    int allocations{0};
+    int frees{0};
+    DeviceMemory lastKind{DeviceMemory::PAGEABLE};
+
+    DeviceAllocator allocator()
+    {
+      DeviceAllocator a;
+      a.allocate = [](size_t size, size_t align, DeviceMemory kind, void *p) {
+        auto *device     = static_cast<FakeDevice *>(p);
+        device->lastKind = kind;
+        device->allocations++;
+        return alignedMalloc(size, align);
+      };
+      a.free = [](void *ptr, size_t, DeviceMemory, void *p) {
+        static_cast<FakeDevice *>(p)->frees++;
+        alignedFree(ptr);
+      };
+      a.userData = this;
+      return a;
+    }
+  };
+
+}  // namespace
+
+TEST_CASE("deviceAlignedMalloc through a DeviceAllocator", "[malloc]")
+{
+  FakeDevice device;
+  setDeviceAllocator(device.allocator());
+
+  for (size_t align : {size_t(16), size_t(64), size_t(4096)}) {
+    char *p = static_cast<char *>(
+        deviceAlignedMalloc(1000, DeviceMemory::SHARED, align));
+    REQUIRE(p != nullptr);
+    REQUIRE(size_t(p) % align == 0);
+    REQUIRE(deviceMemoryOf(p) == DeviceMemory::SHARED);
+    REQUIRE(device.lastKind == DeviceMemory::SHARED);
+    p[999] = 1;
+    deviceAlignedFree(p);
+  }
+  REQUIRE(device.allocations == 3);
+  REQUIRE(device.frees == 3);
+
+  // PAGEABLE memory does not need the device allocator
+  void *pageable = deviceAlignedMalloc(100, DeviceMemory::PAGEABLE);
+  REQUIRE(deviceMemoryOf(pageable) == DeviceMemory::PAGEABLE);
+  REQUIRE(device.allocations == 3);
+  deviceAlignedFree(pageable);
+
+  // freed through the allocator it came from
+  void *pinned = deviceAlignedMalloc(100);
+  REQUIRE(deviceMemoryOf(pinned) == DeviceMemory::HOST_PINNED);
+  setDeviceAllocator(DeviceAllocator());
+  deviceAlignedFree(pinned);
+  REQUIRE(device.frees == 4);
+
+  // without a device allocator
+  void *fallback = deviceAlignedMalloc(100, DeviceMemory::HOST_PINNED);
+  REQUIRE(fallback != nullptr);
+  REQUIRE(size_t(fallback) % 64 == 0);
+  REQUIRE(deviceMemoryOf(fallback) == DeviceMemory::PAGEABLE);
+  deviceAlignedFree(fallback);
+  REQUIRE(device.allocations == 4);
+}
+
+TEST_CASE("DeviceAlignedVector", "[malloc]")
+{
+  FakeDevice device;
+  setDeviceAllocator(device.allocator());
+  {
+    rkcommon::containers::DeviceAlignedVector<int> v(1000, 3);
+    REQUIRE(size_t(v.data()) % 64 == 0);
+    REQUIRE(deviceMemoryOf(v.data()) == DeviceMemory::HOST_PINNED);
+    v.push_back(4);
+    REQUIRE(v.back() == 4);
+    REQUIRE(v[999] == 3);
+  }
+  setDeviceAllocator(DeviceAllocator());
+  REQUIRE(device.allocations > 0);
+  REQUIRE(device.frees == device.allocations);
+}
@@ -0,0 +1,37 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "rkcommon/utility/OwnedArray.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Messages and comparisons shared by the networking tests
+
+// 'size' bytes of a pattern, which differs between seeds
+inline std::shared_ptr<rkcommon::utility::OwnedArray<uint8_t>> makeMessage(
+    size_t size, int seed = 0)
+{
+  auto message = std::make_shared<rkcommon::utility::OwnedArray<uint8_t>>();
+  message->resize(size);
+  for (size_t i = 0; i < size; i++)
+    (*message)[i] = uint8_t(i * 7 + seed);
+  return message;
+}
+
+inline bool sameBytes(const rkcommon::utility::AbstractArray<uint8_t> &a,
+                      const rkcommon::utility::AbstractArray<uint8_t> &b)
+{
+  return a.size() == b.size()
+      && (a.size() == 0 || std::memcmp(a.data(), b.data(), a.size()) == 0);
+}
+
+inline bool sameBytes(const rkcommon::utility::AbstractArray<uint8_t> &a,
+                      const std::vector<uint8_t> &b)
+{
+  return a.size() == b.size()
+      && (a.size() == 0 || std::memcmp(a.data(), b.data(), a.size()) == 0);
+}
@@ -0,0 +1,140 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+#include "message_helpers.h"
+
+#include "rkcommon/networking/BatchingFabric.h"
+
+#include <cstring>
+#include <deque>
+#include <thread>
+
+using namespace rkcommon;
+using namespace rkcommon::networking;
+
+// delivers the messages sent to it in order, to any rank
+struct Wire : public Fabric
+{
+  void sendBcast(std::shared_ptr<utility::AbstractArray<uint8_t>> buf) override
+  {
+    send(buf, 0);
+  }
+
+  void flushBcastSends() override {}
+
+  void recvBcast(utility::AbstractArray<uint8_t> &buf) override
+  {
+    recv(buf, 0);
+  }
+
+  void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+            int) override
+  {
+    messages.push_back(buf);
+    sent++;
+  }
+
+  void recv(utility::AbstractArray<uint8_t> &buf, int) override
+  {
+    REQUIRE(!messages.empty());
+    REQUIRE(messages.front()->size() == buf.size());
+    std::memcpy(buf.data(), messages.front()->data(), buf.size());
+    messages.pop_front();
+  }
+
+  std::deque<std::shared_ptr<utility::AbstractArray<uint8_t>>> messages;
+  int sent = 0;
+};
+
+TEST_CASE("BatchingFabric coalesces messages", "[BatchingFabric]")
+{
+  auto wire = std::make_shared<Wire>();
+  BatchingPolicy policy;
+  policy.maxDelay = std::chrono::seconds(10);
+  BatchingFabric sender(wire, policy);
+  BatchingFabric receiver(wire, policy);
+
+  std::vector<std::shared_ptr<utility::OwnedArray<uint8_t>>> sent;
+  for (int i = 0; i < 100; i++) {
+    sent.push_back(makeMessage(i % 10, i));
+    sender.send(sent.back(), 1);
+  }
+  CHECK(wire->sent == 0);
+
+  // a message larger than a batch goes right away, with the batch before
+  sent.push_back(makeMessage(100000, 3));
+  sender.send(sent.back(), 1);
+  CHECK(wire->sent == 2);
+
+  sent.push_back(makeMessage(5, 4));
+  sender.send(sent.back(), 1);
+  sender.flush();
+  CHECK(wire->sent == 4);
+
+  for (auto &message : sent)
+    CHECK(sameBytes(*receiver.recvShared(0), *message));
+  CHECK(wire->messages.empty());
+
+  SECTION("recv() checks the message size")
+  {
+    sender.send(makeMessage(8, 0), 1);
+    sender.flush();
+    utility::OwnedArray<uint8_t> buf;
+    buf.resize(4);
+    CHECK_THROWS(receiver.recv(buf, 0));
+  }
+}
+
+TEST_CASE("BatchingFabric flush policy", "[BatchingFabric]")
+{
+  auto wire = std::make_shared<Wire>();
+
+  SECTION("batches are sent once full")
+  {
+    BatchingPolicy policy;
+    policy.maxBatchMessages = 10;
+    policy.maxDelay         = std::chrono::seconds(10);
+    BatchingFabric sender(wire, policy);
+    for (int i = 0; i < 25; i++)
+      sender.send(makeMessage(4, i), 1);
+    CHECK(wire->sent == 4);
+  }
+
+  SECTION("old batches are sent by later calls")
+  {
+    BatchingPolicy policy;
+    policy.maxDelay = std::chrono::milliseconds(1);
+    BatchingFabric sender(wire, policy);
+    sender.send(makeMessage(4, 0), 1);
+    CHECK(wire->sent == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    sender.poll();
+    CHECK(wire->sent == 2);
+  }
+
+  SECTION("receiving sends the batches")
+  {
+    BatchingFabric fabric(wire, BatchingPolicy::throughput());
+    fabric.send(makeMessage(4, 0), 1);
+    auto reply = fabric.recvShared(1);
+    CHECK(sameBytes(*reply, *makeMessage(4, 0)));
+  }
+
+  SECTION("broadcasts are batched separately")
+  {
+    BatchingFabric sender(wire, BatchingPolicy::throughput());
+    BatchingFabric receiver(wire, BatchingPolicy::throughput());
+    for (int i = 0; i < 10; i++)
+      sender.sendBcast(makeMessage(16, i));
+    sender.flushBcastSends();
+    CHECK(wire->sent == 2);
+
+    for (int i = 0; i < 10; i++) {
+      utility::OwnedArray<uint8_t> buf;
+      buf.resize(16);
+      receiver.recvBcast(buf);
+      CHECK(sameBytes(buf, *makeMessage(16, i)));
+    }
+  }
+}
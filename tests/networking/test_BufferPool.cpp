@@ -0,0 +1,270 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/networking/BufferPool.h"
+#include "rkcommon/networking/DataStreaming.h"
+#include "rkcommon/networking/Fabric.h"
+
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::networking;
+
+namespace {
+
+  // delivers the messages sent to it in order, to any rank
+  struct Loopback : public Fabric
+  {
+    void sendBcast(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf) override
+    {
+      send(buf, 0);
+    }
+
+    void flushBcastSends() override {}
+
+    void recvBcast(utility::AbstractArray<uint8_t> &buf) override
+    {
+      recv(buf, 0);
+    }
+
+    void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+              int) override
+    {
+      messages.push_back(buf);
+    }
+
+    void recv(utility::AbstractArray<uint8_t> &buf, int) override
+    {
+      REQUIRE(!messages.empty());
+      REQUIRE(messages.front()->size() == buf.size());
+      std::memcpy(buf.data(), messages.front()->data(), buf.size());
+      messages.pop_front();
+    }
+
+    std::deque<std::shared_ptr<utility::AbstractArray<uint8_t>>> messages;
+  };
+
+}  // namespace
+
+TEST_CASE("BufferPool recycles buffers", "[BufferPool]")
+{
+  BufferPool pool;
+
+  SECTION("released buffers are handed out again")
+  {
+    const uint8_t *first = nullptr;
+    {
+      auto buf = pool.acquire(1000);
+      REQUIRE(buf->size() == 1000);
+      std::memset(buf->data(), 7, buf->size());
+      first = buf->data();
+    }
+    CHECK(pool.stats().retainedBuffers == 1);
+    CHECK(pool.stats().retainedBytes == 1024);
+
+    auto again = pool.acquire(600);
+    CHECK(again->data() == first);
+    CHECK(again->size() == 600);
+    CHECK(pool.stats().retainedBuffers == 0);
+    CHECK(pool.stats().acquires == 2);
+    CHECK(pool.stats().hits == 1);
+  }
+
+  SECTION("buffers are reused for their size class and the two below")
+  {
+    pool.acquire(2000);
+    auto larger = pool.acquire(2049);
+    CHECK(pool.stats().hits == 0);
+    pool.acquire(500);
+    CHECK(pool.stats().hits == 1);
+    auto smallest = pool.acquire(200);
+    CHECK(pool.stats().hits == 1);
+    CHECK(pool.stats().retainedBytes == 2048);
+    auto same = pool.acquire(1025);
+    CHECK(pool.stats().hits == 2);
+  }
+
+  SECTION("buffers in use are not shared")
+  {
+    auto a = pool.acquire(100);
+    auto b = pool.acquire(100);
+    CHECK(a->data() != b->data());
+    CHECK(pool.stats().hits == 0);
+  }
+
+  SECTION("empty buffers")
+  {
+    CHECK(pool.acquire(0)->size() == 0);
+    CHECK(pool.acquireFixed(0)->size() == 0);
+  }
+
+  SECTION("trim() frees the retained buffers")
+  {
+    pool.acquire(1 << 16);
+    pool.acquire(100);
+    CHECK(pool.stats().retainedBuffers == 2);
+    pool.trim();
+    CHECK(pool.stats().retainedBuffers == 0);
+    CHECK(pool.stats().retainedBytes == 0);
+  }
+}
+
+TEST_CASE("BufferPool limits", "[BufferPool]")
+{
+  SECTION("the retained memory stays within its budget")
+  {
+    BufferPool pool(4096, 1 << 20);
+    {
+      std::vector<std::shared_ptr<utility::AbstractArray<uint8_t>>> held;
+      for (int i = 0; i < 10; i++)
+        held.push_back(pool.acquire(1024));
+    }
+    CHECK(pool.stats().retainedBuffers == 4);
+    CHECK(pool.stats().retainedBytes == 4096);
+  }
+
+  SECTION("buffers over the maximum size are not kept")
+  {
+    BufferPool pool(size_t(64) << 20, 1 << 16);
+    auto big = pool.acquire((1 << 16) + 1);
+    REQUIRE(big->size() == (1 << 16) + 1);
+    big.reset();
+    CHECK(pool.stats().retainedBuffers == 0);
+
+    pool.acquire(1 << 16);
+    CHECK(pool.stats().retainedBuffers == 1);
+  }
+
+  SECTION("a maximum size between size classes")
+  {
+    BufferPool pool(size_t(64) << 20, 3000);
+    // allocated to size, as its class is over the maximum, but kept in the
+    // class below
+    auto buf = pool.acquire(2500);
+    REQUIRE(buf->size() == 2500);
+    buf.reset();
+    CHECK(pool.stats().retainedBuffers == 1);
+
+    pool.acquire(2000);
+    CHECK(pool.stats().hits == 1);
+  }
+
+  SECTION("buffers may outlive their pool")
+  {
+    std::shared_ptr<utility::AbstractArray<uint8_t>> buf;
+    {
+      BufferPool pool;
+      buf = pool.acquire(4096);
+    }
+    std::memset(buf->data(), 1, buf->size());
+    buf.reset();
+  }
+}
+
+TEST_CASE("BufferPool writers", "[BufferPool]")
+{
+  BufferPool pool;
+
+  SECTION("BufferWriter buffers go back with the capacity they grew to")
+  {
+    {
+      BufferWriter writer(pool);
+      for (int i = 0; i < 10000; i++)
+        writer << i;
+      REQUIRE(writer.buffer->size() == 10000 * sizeof(int));
+    }
+    const size_t retained = pool.stats().retainedBytes;
+    CHECK(retained >= 10000 * sizeof(int));
+
+    BufferWriter writer(pool, 10000 * sizeof(int));
+    CHECK(writer.buffer->size() == 0);
+    CHECK(writer.buffer->capacity() == retained);
+    CHECK(pool.stats().hits == 1);
+  }
+
+  SECTION("FixedBufferWriter views keep the buffer from the pool")
+  {
+    std::shared_ptr<utility::FixedArray<uint8_t>::View> view;
+    {
+      FixedBufferWriter writer(256, pool);
+      REQUIRE(writer.capacity() == 256);
+      writer << 1.5f << 42;
+      view = writer.getWrittenView();
+    }
+    CHECK(pool.stats().retainedBuffers == 0);
+    REQUIRE(view->size() == 8);
+    float f;
+    std::memcpy(&f, view->begin(), sizeof(f));
+    CHECK(f == 1.5f);
+
+    view.reset();
+    CHECK(pool.stats().retainedBuffers == 1);
+  }
+}
+
+TEST_CASE("BufferPool fabrics", "[BufferPool]")
+{
+  auto pool = std::make_shared<BufferPool>();
+  Loopback fabric;
+  CHECK(&fabric.bufferPool() == defaultBufferPool().get());
+  fabric.setBufferPool(pool);
+  CHECK(&fabric.bufferPool() == pool.get());
+  CHECK_THROWS(fabric.setBufferPool(nullptr));
+
+  auto message = pool->acquire(1000);
+  for (size_t i = 0; i < message->size(); i++)
+    (*message)[i] = uint8_t(i);
+  fabric.send(message, 1);
+  fabric.sendBcast(message);
+  message.reset();
+
+  auto received = fabric.recvPooled(1000, 1);
+  REQUIRE(received->size() == 1000);
+  for (size_t i = 0; i < received->size(); i++)
+    REQUIRE((*received)[i] == uint8_t(i));
+
+  auto bcast = fabric.recvBcastPooled(1000);
+  CHECK(std::memcmp(bcast->data(), received->data(), 1000) == 0);
+
+  fabric.messages.clear();
+  received.reset();
+  bcast.reset();
+  CHECK(pool->stats().acquires == 3);
+  CHECK(pool->stats().retainedBuffers == 3);
+}
+
+TEST_CASE("BufferPool is thread-safe", "[BufferPool]")
+{
+  BufferPool pool(size_t(1) << 20);
+
+  // Catch assertions are not thread-safe
+  std::atomic<int> overwritten{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&pool, &overwritten, t]() {
+      for (int i = 0; i < 2000; i++) {
+        const size_t size = size_t(64) << ((i + t) % 8);
+        auto buf          = pool.acquire(size);
+        std::memset(buf->data(), t, size);
+        for (size_t j = 0; j < size; j += 61)
+          overwritten += (*buf)[j] != uint8_t(t);
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  CHECK(overwritten == 0);
+
+  const BufferPoolStats s = pool.stats();
+  CHECK(s.acquires == 8000);
+  CHECK(s.hits > 0);
+  CHECK(s.retainedBytes <= pool.maxRetainedBytes());
+}
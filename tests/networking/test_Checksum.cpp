@@ -0,0 +1,227 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+#include "message_helpers.h"
+
+#include "rkcommon/networking/Checksum.h"
+
+#include <cstring>
+#include <deque>
+#include <string>
+
+using namespace rkcommon;
+using namespace rkcommon::networking;
+
+namespace {
+
+  // bit by bit, as the reference
+  uint32_t referenceCrc32c(const uint8_t *p, size_t size)
+  {
+    uint32_t crc = ~0u;
+    for (size_t i = 0; i < size; i++) {
+      crc ^= p[i];
+      for (int bit = 0; bit < 8; bit++)
+        crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+    }
+    return ~crc;
+  }
+
+  // delivers the messages sent to it in order, to any rank, and can
+  // corrupt them on the way
+  struct NoisyWire : public Fabric
+  {
+    void sendBcast(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf) override
+    {
+      send(buf, 0);
+    }
+
+    void flushBcastSends() override {}
+
+    void recvBcast(utility::AbstractArray<uint8_t> &buf) override
+    {
+      recv(buf, 0);
+    }
+
+    void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+              int) override
+    {
+      auto copy = std::make_shared<utility::OwnedArray<uint8_t>>();
+      copy->resize(buf->size());
+      std::memcpy(copy->data(), buf->data(), buf->size());
+      if (flipByte < copy->size())
+        (*copy)[flipByte] ^= 0x10;
+      messages.push_back(copy);
+    }
+
+    void recv(utility::AbstractArray<uint8_t> &buf, int) override
+    {
+      REQUIRE(!messages.empty());
+      REQUIRE(messages.front()->size() == buf.size());
+      std::memcpy(buf.data(), messages.front()->data(), buf.size());
+      messages.pop_front();
+    }
+
+    std::deque<std::shared_ptr<utility::AbstractArray<uint8_t>>> messages;
+    size_t flipByte = size_t(-1);
+  };
+
+}  // namespace
+
+TEST_CASE("crc32c", "[Checksum]")
+{
+  SECTION("known values")
+  {
+    CHECK(crc32c(nullptr, 0) == 0);
+    CHECK(crc32c("123456789", 9) == 0xe3069283u);
+
+    const uint8_t zeros[32] = {};
+    CHECK(crc32c(zeros, sizeof(zeros)) == 0x8a9136aau);
+  }
+
+  SECTION("matches the reference at every size and alignment")
+  {
+    auto data = makeMessage(300);
+    for (size_t offset = 0; offset < 8; offset++) {
+      for (size_t size = 0; size + offset <= data->size(); size += 7) {
+        const uint8_t *p = data->data() + offset;
+        REQUIRE(crc32c(p, size) == referenceCrc32c(p, size));
+      }
+    }
+  }
+
+  SECTION("matches the reference on long buffers")
+  {
+    // around the runs of 3x8 KiB and 3x256 bytes the hardware path splits
+    // buffers into
+    auto data = makeMessage(100000);
+    for (size_t size : {768, 24575, 24576, 24577, 50000, 99995}) {
+      for (size_t offset : {0, 5}) {
+        const uint8_t *p = data->data() + offset;
+        REQUIRE(crc32c(p, size) == referenceCrc32c(p, size));
+      }
+    }
+  }
+
+  SECTION("continues from the checksum of the bytes before")
+  {
+    auto data = makeMessage(1000);
+    const uint32_t whole = crc32c(data->data(), data->size());
+    for (size_t split : {0, 1, 9, 500, 999, 1000}) {
+      const uint32_t first = crc32c(data->data(), split);
+      CHECK(crc32c(data->data() + split, data->size() - split, first)
+            == whole);
+    }
+  }
+}
+
+TEST_CASE("ChecksummingWriteStream and ChecksummingReadStream", "[Checksum]")
+{
+  BufferWriter buffer;
+  ChecksummingWriteStream writer(buffer);
+
+  auto floats = std::make_shared<utility::OwnedArray<float>>();
+  floats->resize(100);
+  for (size_t i = 0; i < floats->size(); i++)
+    (*floats)[i] = float(i) * 0.5f;
+  std::shared_ptr<utility::AbstractArray<float>> array = floats;
+
+  writer << 42 << std::string("frame");
+  writeAligned(writer, array);
+  CHECK(writer.position() == buffer.position());
+  CHECK(writer.checksum()
+        == crc32c(buffer.buffer->data(), buffer.buffer->size()));
+  const size_t firstSize = buffer.position();
+  writer.writeChecksum();
+  CHECK(writer.checksum() == 0);
+
+  writer << 1.5;
+  writer.writeChecksum();
+
+  SECTION("the trailers verify")
+  {
+    BufferReader in(buffer.buffer);
+    ChecksummingReadStream reader(in);
+    int i;
+    std::string s;
+    std::vector<float> v;
+    reader >> i >> s;
+    readAligned(reader, v);
+    REQUIRE_NOTHROW(reader.verifyChecksum());
+    CHECK(i == 42);
+    CHECK(s == "frame");
+    CHECK(v.size() == 100);
+    CHECK(v[99] == 49.5f);
+
+    double d;
+    reader >> d;
+    REQUIRE_NOTHROW(reader.verifyChecksum());
+    CHECK(d == 1.5);
+    CHECK(reader.end());
+  }
+
+  SECTION("corrupted bytes are detected")
+  {
+    // in the last float
+    (*buffer.buffer)[firstSize - 1] ^= 1;
+    BufferReader in(buffer.buffer);
+    ChecksummingReadStream reader(in);
+    int i;
+    std::string s;
+    std::vector<float> v;
+    reader >> i >> s;
+    readAligned(reader, v);
+    CHECK_THROWS(reader.verifyChecksum());
+
+    // the next section is checked on its own
+    double d;
+    reader >> d;
+    CHECK_NOTHROW(reader.verifyChecksum());
+  }
+}
+
+TEST_CASE("ChecksummingFabric", "[Checksum]")
+{
+  auto wire = std::make_shared<NoisyWire>();
+  ChecksummingFabric fabric(wire);
+
+  SECTION("messages arrive with a trailer and verify")
+  {
+    for (size_t size : {0, 3, 5000, 100000}) {
+      auto message = makeMessage(size);
+      fabric.send(message, 1);
+      REQUIRE(wire->messages.back()->size() == size + sizeof(uint32_t));
+
+      utility::OwnedArray<uint8_t> received;
+      received.resize(size);
+      REQUIRE_NOTHROW(fabric.recv(received, 1));
+      CHECK(std::memcmp(received.data(), message->data(), size) == 0);
+    }
+  }
+
+  SECTION("broadcasts verify")
+  {
+    auto message = makeMessage(70000);
+    fabric.sendBcast(message);
+    auto received = fabric.recvBcastPooled(70000);
+    CHECK(std::memcmp(received->data(), message->data(), 70000) == 0);
+  }
+
+  SECTION("corruption in the message or its trailer throws")
+  {
+    for (size_t flip : {0, 4999, 5000, 5003}) {
+      wire->flipByte = flip;
+      fabric.send(makeMessage(5000), 1);
+      utility::OwnedArray<uint8_t> received;
+      received.resize(5000);
+      CHECK_THROWS(fabric.recv(received, 1));
+    }
+
+    wire->flipByte = 1;
+    fabric.sendBcast(makeMessage(10));
+    utility::OwnedArray<uint8_t> received;
+    received.resize(10);
+    CHECK_THROWS(fabric.recvBcast(received));
+  }
+}
@@ -0,0 +1,180 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+#include "message_helpers.h"
+
+#include "rkcommon/networking/CompressedStream.h"
+
+#include <cstring>
+#include <deque>
+#include <random>
+
+using namespace rkcommon;
+using namespace rkcommon::networking;
+
+// a mesh-like payload: a grid of vertices with normals and material ids
+static std::vector<uint8_t> makeScene(size_t numVertices)
+{
+  struct Vertex
+  {
+    float position[3];
+    float normal[3];
+    uint32_t material;
+  };
+
+  std::vector<uint8_t> scene(numVertices * sizeof(Vertex));
+  for (size_t i = 0; i < numVertices; i++) {
+    const Vertex v = {{float(i % 256), float(i / 256), 0.f},
+                      {0.f, 0.f, 1.f},
+                      uint32_t(i / 1024)};
+    std::memcpy(scene.data() + i * sizeof(Vertex), &v, sizeof(Vertex));
+  }
+  return scene;
+}
+
+static std::vector<uint8_t> makeRandom(size_t size)
+{
+  std::mt19937 rng(7);
+  std::vector<uint8_t> bytes(size);
+  for (auto &b : bytes)
+    b = uint8_t(rng());
+  return bytes;
+}
+
+static std::shared_ptr<utility::OwnedArray<uint8_t>> toArray(
+    const std::vector<uint8_t> &bytes)
+{
+  auto array = std::make_shared<utility::OwnedArray<uint8_t>>();
+  array->resize(bytes.size());
+  std::memcpy(array->data(), bytes.data(), bytes.size());
+  return array;
+}
+
+TEST_CASE("CompressedWriteStream round trip", "[CompressedStream]")
+{
+  const auto compression = GENERATE(StreamCompression::LZ4,
+                                    StreamCompression::LZ4_HIGH);
+  const auto scene       = makeScene(10000);
+  const auto noise       = makeRandom(5000);
+
+  BufferWriter writer;
+  // small blocks, to cover several per compressBlocks() pass
+  CompressedWriteStream compressed(writer, compression, 4096, 4);
+  compressed << scene << int32_t(42) << noise << std::string("end");
+  compressed.flush();
+  CHECK(compressed.rawSize() == compressed.position());
+  CHECK(compressed.compressedSize() == writer.buffer->size());
+  CHECK(compressed.compressedSize() * 3 < compressed.rawSize());
+
+  BufferReader reader(writer.buffer);
+  CompressedReadStream decompressed(reader);
+  std::vector<uint8_t> scene2, noise2;
+  int32_t value = 0;
+  std::string str;
+  decompressed >> scene2 >> value >> noise2 >> str;
+  CHECK(scene2 == scene);
+  CHECK(value == 42);
+  CHECK(noise2 == noise);
+  CHECK(str == "end");
+  CHECK(decompressed.end());
+}
+
+TEST_CASE("CompressedWriteStream stores incompressible blocks",
+          "[CompressedStream]")
+{
+  const auto noise = makeRandom(100000);
+
+  BufferWriter writer;
+  CompressedWriteStream compressed(writer, StreamCompression::LZ4, 8192);
+  compressed.write(noise.data(), noise.size());
+  compressed.flush();
+  // 8 bytes of framing per block, nothing else
+  CHECK(writer.buffer->size() == noise.size() + 8 * 13);
+
+  BufferReader reader(writer.buffer);
+  CompressedReadStream decompressed(reader);
+  std::vector<uint8_t> noise2(noise.size());
+  decompressed.read(noise2.data(), noise2.size());
+  CHECK(noise2 == noise);
+}
+
+TEST_CASE("compressBuffer() and decompressBuffer()", "[CompressedStream]")
+{
+  const auto scene = makeScene(200000);
+
+  auto packed = compressBuffer(*toArray(scene), StreamCompression::LZ4_HIGH);
+  CHECK(packed->size() * 3 < scene.size());
+  CHECK(sameBytes(*decompressBuffer(*packed), scene));
+
+  SECTION("empty buffers")
+  {
+    auto empty = compressBuffer(utility::OwnedArray<uint8_t>());
+    CHECK(empty->size() == 0);
+    CHECK(decompressBuffer(*empty)->size() == 0);
+  }
+
+  SECTION("corrupt buffers throw")
+  {
+    auto truncated = std::make_shared<utility::OwnedArray<uint8_t>>(
+        packed->begin(), packed->size() - 1);
+    CHECK_THROWS(decompressBuffer(*truncated));
+
+    // overlong runs and matches pointing before the block
+    for (size_t i = 20; i < packed->size(); i += 97)
+      (*packed)[i] = 0xff;
+    CHECK_THROWS(decompressBuffer(*packed));
+
+    BufferReader reader(packed);
+    CompressedReadStream decompressed(reader);
+    std::vector<uint8_t> scene2(scene.size());
+    CHECK_THROWS(decompressed.read(scene2.data(), scene2.size()));
+  }
+}
+
+// delivers the messages sent to it in order, to any rank
+struct LoopbackFabric : public Fabric
+{
+  void sendBcast(std::shared_ptr<utility::AbstractArray<uint8_t>> buf) override
+  {
+    messages.push_back(buf);
+  }
+
+  void flushBcastSends() override {}
+
+  void recvBcast(utility::AbstractArray<uint8_t> &buf) override
+  {
+    recv(buf, 0);
+  }
+
+  void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+            int) override
+  {
+    messages.push_back(buf);
+  }
+
+  void recv(utility::AbstractArray<uint8_t> &buf, int) override
+  {
+    REQUIRE(!messages.empty());
+    REQUIRE(messages.front()->size() == buf.size());
+    std::memcpy(buf.data(), messages.front()->data(), buf.size());
+    messages.pop_front();
+  }
+
+  std::deque<std::shared_ptr<utility::AbstractArray<uint8_t>>> messages;
+};
+
+TEST_CASE("sendCompressed() and recvCompressed()", "[CompressedStream]")
+{
+  const auto scene = makeScene(50000);
+  LoopbackFabric fabric;
+
+  sendCompressed(fabric, *toArray(scene), 1);
+  REQUIRE(fabric.messages.size() == 2);
+  CHECK(fabric.messages[1]->size() * 3 < scene.size());
+  CHECK(sameBytes(*recvCompressed(fabric, 0), scene));
+
+  sendBcastCompressed(fabric, *toArray(scene));
+  CHECK(sameBytes(*recvBcastCompressed(fabric), scene));
+  CHECK(fabric.messages.empty());
+}
@@ -0,0 +1,499 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+#include "message_helpers.h"
+
+#include "rkcommon/array3D/Array3D.h"
+#include "rkcommon/containers/UninitVector.h"
+#include "rkcommon/math/vec.h"
+#include "rkcommon/networking/DataStreaming.h"
+#include "rkcommon/networking/Fabric.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+using namespace rkcommon::networking;
+
+// a header, a large and a small shared array and some small fields
+static void serialize(WriteStream &out,
+                      const std::shared_ptr<utility::AbstractArray<float>> &big,
+                      const std::shared_ptr<utility::AbstractArray<int>> &small)
+{
+  out << 42 << std::string("mesh") << big << small;
+  out << std::vector<int>{1, 2, 3} << big;
+}
+
+static std::shared_ptr<utility::OwnedArray<float>> makeBig()
+{
+  auto big = std::make_shared<utility::OwnedArray<float>>();
+  big->resize(10000, 0.f);
+  for (size_t i = 0; i < big->size(); i++)
+    (*big)[i] = float(i) * 0.5f;
+  return big;
+}
+
+static std::shared_ptr<utility::OwnedArray<int>> makeSmall()
+{
+  auto small = std::make_shared<utility::OwnedArray<int>>();
+  small->resize(10, 7);
+  return small;
+}
+
+TEST_CASE("IOVecWriter references large shared arrays", "[DataStreaming]")
+{
+  auto big   = makeBig();
+  auto small = makeSmall();
+
+  BufferWriter reference;
+  serialize(reference, big, small);
+
+  IOVecWriter writer;
+  serialize(writer, big, small);
+
+  SECTION("the bytes match a BufferWriter")
+  {
+    CHECK(writer.size() == reference.buffer->size());
+    CHECK(sameBytes(*writer.coalesce(), *reference.buffer));
+  }
+
+  SECTION("only small fields are copied")
+  {
+    const auto segments = writer.segments();
+    // copied, big, copied, big
+    REQUIRE(segments.size() == 4);
+    CHECK(segments[1].data == big->data());
+    CHECK(segments[3].data == big->data());
+    CHECK(writer.copiedSize() < 200);
+  }
+
+  SECTION("the writer keeps shared arrays alive")
+  {
+    std::weak_ptr<utility::OwnedArray<float>> weak = big;
+    big.reset();
+    CHECK(!weak.expired());
+    CHECK(sameBytes(*writer.coalesce(), *reference.buffer));
+  }
+
+  SECTION("streams that cannot reference copy")
+  {
+    WriteSizeCalculator size;
+    serialize(size, big, small);
+    CHECK(size.writtenSize == reference.buffer->size());
+  }
+
+  SECTION("the bytes read back")
+  {
+    BufferReader reader(writer.coalesce());
+    int header;
+    std::string name;
+    size_t count;
+    reader >> header >> name >> count;
+    CHECK(header == 42);
+    CHECK(name == "mesh");
+    REQUIRE(count == 10000);
+    auto view = reader.getView<float>(count);
+    CHECK((*view)[4321] == 4321 * 0.5f);
+  }
+}
+
+#ifndef _WIN32
+TEST_CASE("IOVecWriter::writeTo() gathers into a file descriptor",
+          "[DataStreaming]")
+{
+  auto big = makeBig();
+  IOVecWriter writer(1);
+  // more segments than one writev() call takes
+  for (int i = 0; i < 3000; i++)
+    writer << i << big;
+
+  const char *fileName = "test_DataStreaming.bin";
+  FILE *file           = fopen(fileName, "wb");
+  writer.writeTo(fileno(file));
+  fclose(file);
+
+  BufferReader reader{std::string(fileName)};
+  CHECK(sameBytes(*reader.buffer, *writer.coalesce()));
+  std::remove(fileName);
+}
+#endif
+
+struct RecordingFabric : public Fabric
+{
+  void sendBcast(std::shared_ptr<utility::AbstractArray<uint8_t>>) override {}
+  void flushBcastSends() override {}
+  void recvBcast(utility::AbstractArray<uint8_t> &) override {}
+  void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+            int rank) override
+  {
+    sent     = buf;
+    sentRank = rank;
+  }
+  void recv(utility::AbstractArray<uint8_t> &, int) override {}
+
+  std::shared_ptr<utility::AbstractArray<uint8_t>> sent;
+  int sentRank = -1;
+};
+
+TEST_CASE("Fabric::sendSegments() coalesces by default", "[DataStreaming]")
+{
+  auto big   = makeBig();
+  auto small = makeSmall();
+
+  IOVecWriter writer;
+  serialize(writer, big, small);
+
+  RecordingFabric fabric;
+  fabric.sendSegments(writer, 3);
+  CHECK(fabric.sentRank == 3);
+  REQUIRE(fabric.sent);
+  CHECK(sameBytes(*fabric.sent, *writer.coalesce()));
+}
+
+// counts the calls, to tell bulk from per element streaming
+struct CountingWriter : public BufferWriter
+{
+  void write(const void *mem, size_t size) override
+  {
+    writes++;
+    BufferWriter::write(mem, size);
+  }
+
+  int writes = 0;
+};
+
+TEST_CASE("std::vector streaming", "[DataStreaming]")
+{
+  SECTION("trivially copyable elements are written in one block")
+  {
+    std::vector<vec3f> vertices;
+    for (int i = 0; i < 1000; i++)
+      vertices.push_back(vec3f(i, -i, 0.5f * i));
+
+    CountingWriter writer;
+    writer << vertices;
+    CHECK(writer.writes == 2);
+
+    // the same bytes as element by element
+    BufferWriter perElement;
+    perElement << vertices.size();
+    for (const auto &v : vertices)
+      perElement << v;
+    CHECK(sameBytes(*writer.buffer, *perElement.buffer));
+
+    BufferReader reader(writer.buffer);
+    containers::UninitVector<vec3f> readBack;
+    reader >> readBack;
+    CHECK(reader.end());
+    REQUIRE(readBack.size() == vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+      REQUIRE(readBack[i] == vertices[i]);
+  }
+
+  SECTION("other elements are streamed one by one")
+  {
+    const std::vector<std::string> names{"a", "", "mesh"};
+    CountingWriter writer;
+    writer << names;
+    CHECK(writer.writes == 7);
+
+    BufferReader reader(writer.buffer);
+    std::vector<std::string> readBack;
+    reader >> readBack;
+    CHECK(readBack == names);
+  }
+
+  SECTION("empty vectors")
+  {
+    BufferWriter writer;
+    writer << std::vector<float>();
+    BufferReader reader(writer.buffer);
+    std::vector<float> readBack(3, 1.f);
+    reader >> readBack;
+    CHECK(readBack.empty());
+    CHECK(reader.end());
+  }
+}
+
+TEST_CASE("FixedBufferWriter fills up to its capacity", "[DataStreaming]")
+{
+  FixedBufferWriter writer(8);
+  writer << 1 << 2.f;
+  CHECK(writer.available() == 0);
+  CHECK_THROWS(writer << uint8_t(3));
+  CHECK_THROWS(writer.reserve(1));
+  CHECK(writer.reserve(0) != nullptr);
+}
+
+TEST_CASE("BufferWriter growth and reuse", "[DataStreaming]")
+{
+  auto big   = makeBig();
+  auto small = makeSmall();
+
+  SECTION("many small writes grow the capacity geometrically")
+  {
+    BufferWriter writer;
+    size_t grows = 0, capacity = 0;
+    for (int i = 0; i < 100000; i++) {
+      writer << i;
+      if (writer.buffer->capacity() != capacity) {
+        grows++;
+        capacity = writer.buffer->capacity();
+      }
+    }
+    CHECK(writer.buffer->size() == 100000 * sizeof(int));
+    CHECK(grows < 32);
+    for (int i = 0; i < 100000; i += 997) {
+      int v;
+      std::memcpy(&v, writer.buffer->data() + i * sizeof(int), sizeof(int));
+      REQUIRE(v == i);
+    }
+  }
+
+  SECTION("writing no data writes zeros")
+  {
+    BufferWriter writer;
+    writer << 1.f;
+    writer.write(nullptr, 64);
+    REQUIRE(writer.buffer->size() == 68);
+    for (size_t i = 4; i < 68; i++)
+      REQUIRE((*writer.buffer)[i] == 0);
+  }
+
+  SECTION("two pass writes size the buffer exactly")
+  {
+    BufferWriter reference;
+    serialize(reference, big, small);
+
+    BufferWriter writer;
+    writer.writeSized(
+        [&](WriteStream &stream) { serialize(stream, big, small); });
+    CHECK(writer.buffer->capacity() == reference.buffer->size());
+    CHECK(sameBytes(*writer.buffer, *reference.buffer));
+  }
+
+  SECTION("pooled buffers keep their capacity across frames")
+  {
+    auto pooled = std::make_shared<utility::OwnedArray<uint8_t>>();
+    BufferWriter first(pooled);
+    first.reserve(1 << 20);
+    serialize(first, big, small);
+    const uint8_t *storage = pooled->data();
+    const size_t firstSize = pooled->size();
+
+    BufferWriter second(pooled);
+    CHECK(pooled->size() == 0);
+    serialize(second, big, small);
+    CHECK(pooled->data() == storage);
+    CHECK(pooled->size() == firstSize);
+
+    second.clear();
+    CHECK(second.buffer->size() == 0);
+    CHECK(second.buffer->capacity() >= size_t(1 << 20));
+  }
+}
+
+TEST_CASE("BufferReader views in place", "[DataStreaming]")
+{
+  const std::shared_ptr<utility::AbstractArray<float>> big = makeBig();
+
+  SECTION("aligned arrays are used in place")
+  {
+    BufferWriter writer;
+    writer << std::string("header") << uint8_t(1);
+    writeAligned(writer, big);
+    writer << 42;
+    // pads from the writer's position, also through other streams
+    WriteSizeCalculator size;
+    size << std::string("header") << uint8_t(1);
+    writeAligned(size, big);
+    size << 42;
+    CHECK(size.writtenSize == writer.buffer->size());
+
+    std::shared_ptr<utility::AbstractArray<float>> floats;
+    {
+      BufferReader reader(writer.buffer);
+      std::string header;
+      uint8_t one;
+      reader >> header >> one;
+      floats = reader.viewAligned<float>();
+      int last;
+      reader >> last;
+      CHECK(last == 42);
+      CHECK(reader.end());
+    }
+
+    // the reader is gone, the view keeps the buffer alive
+    const uint8_t *bytes = writer.buffer->data();
+    writer.buffer.reset();
+    REQUIRE(floats->size() == big->size());
+    CHECK((const uint8_t *)floats->data() > bytes);
+    CHECK(uintptr_t(floats->data()) % 64 == 0);
+    CHECK(std::memcmp(floats->data(), big->data(), big->size() * 4) == 0);
+
+    const array3D::ActualArray3D<float> volume(vec3i(100, 10, 10),
+                                               floats->data());
+    CHECK(volume.get(vec3i(3, 2, 1)) == (*big)[1203]);
+  }
+
+  SECTION("misaligned views copy")
+  {
+    BufferWriter writer;
+    writer << uint8_t(1) << *big;
+    BufferReader reader(writer.buffer);
+    uint8_t one;
+    size_t count;
+    reader >> one >> count;
+    auto floats = reader.view<float>(count);
+    CHECK((const uint8_t *)floats->data() !=
+          writer.buffer->data() + sizeof(uint8_t) + sizeof(size_t));
+    CHECK(std::memcmp(floats->data(), big->data(), big->size() * 4) == 0);
+    CHECK(reader.end());
+  }
+
+  SECTION("any stream reads aligned arrays")
+  {
+    BufferWriter writer;
+    writer << uint8_t(1);
+    writeAligned(writer, *big, 4096);
+    BufferReader reader(writer.buffer);
+    uint8_t one;
+    std::vector<float> floats;
+    reader >> one;
+    readAligned(reader, floats);
+    CHECK(reader.end());
+    REQUIRE(floats.size() == big->size());
+    CHECK(std::memcmp(floats.data(), big->data(), big->size() * 4) == 0);
+  }
+
+  SECTION("streams that do not count bytes cannot pad")
+  {
+    CountingWriter counted;
+    writeAligned(counted, *big);
+    struct Discard : public WriteStream
+    {
+      void write(const void *, size_t) override {}
+    } discard;
+    CHECK_THROWS(writeAligned(discard, *big));
+    CHECK_THROWS(writeAligned(counted, *big, 48));
+  }
+}
+
+TEST_CASE("Varints", "[DataStreaming]")
+{
+  const uint64_t values[] = {
+      0, 1, 127, 128, 300, 16383, 16384, 1ull << 35, ~0ull};
+  const size_t sizes[] = {1, 1, 1, 2, 2, 2, 3, 6, 10};
+
+  for (int i = 0; i < 9; i++) {
+    BufferWriter writer;
+    writeVarint(writer, values[i]);
+    CHECK(writer.buffer->size() == sizes[i]);
+    BufferReader reader(writer.buffer);
+    CHECK(readVarint(reader) == values[i]);
+    CHECK(reader.end());
+  }
+
+  SECTION("signed values are zig-zag mapped")
+  {
+    CHECK(zigZagEncode(0) == 0);
+    CHECK(zigZagEncode(-1) == 1);
+    CHECK(zigZagEncode(1) == 2);
+    CHECK(zigZagEncode(INT64_MIN) == ~0ull);
+
+    BufferWriter writer;
+    for (int64_t v : {int64_t(-64), int64_t(63), INT64_MIN, INT64_MAX})
+      writeSignedVarint(writer, v);
+    CHECK(writer.buffer->size() == 1 + 1 + 10 + 10);
+    BufferReader reader(writer.buffer);
+    CHECK(readSignedVarint(reader) == -64);
+    CHECK(readSignedVarint(reader) == 63);
+    CHECK(readSignedVarint(reader) == INT64_MIN);
+    CHECK(readSignedVarint(reader) == INT64_MAX);
+  }
+
+  SECTION("overlong varints throw")
+  {
+    BufferWriter writer;
+    for (int i = 0; i < 11; i++)
+      writer << uint8_t(0x80);
+    BufferReader reader(writer.buffer);
+    CHECK_THROWS(readVarint(reader));
+  }
+}
+
+TEST_CASE("Packed integer arrays", "[DataStreaming]")
+{
+  const auto coding = GENERATE(PackedCoding::PLAIN,
+                               PackedCoding::DELTA,
+                               PackedCoding::SIGNED_DELTA);
+
+  // values of all byte lengths, and counts covering the scalar tail
+  std::mt19937 rng(3);
+  std::vector<uint32_t> values;
+  for (int i = 0; i < 1003; i++)
+    values.push_back(rng() >> (8 * (rng() % 4)));
+
+  for (size_t count : {0, 1, 3, 4, 5, 8, 1003}) {
+    std::vector<uint32_t> in(values.begin(), values.begin() + count);
+    BufferWriter writer;
+    writePacked(writer, in, coding);
+    writer << 42;
+
+    BufferReader reader(writer.buffer);
+    std::vector<uint32_t> out{7};
+    readPacked(reader, out, coding);
+    int tail = 0;
+    reader >> tail;
+    CHECK(out == in);
+    CHECK(tail == 42);
+  }
+}
+
+TEST_CASE("Packed integer arrays shrink index payloads", "[DataStreaming]")
+{
+  SECTION("sorted IDs")
+  {
+    std::mt19937 rng(5);
+    std::vector<uint32_t> ids{1000000};
+    for (int i = 1; i < 100000; i++)
+      ids.push_back(ids.back() + 1 + rng() % 200);
+
+    BufferWriter writer;
+    writePacked(writer, ids, PackedCoding::DELTA);
+    CHECK(writer.buffer->size() * 3 < ids.size() * sizeof(uint32_t));
+
+    BufferReader reader(writer.buffer);
+    std::vector<uint32_t> out;
+    readPacked(reader, out, PackedCoding::DELTA);
+    CHECK(out == ids);
+  }
+
+  SECTION("index buffers")
+  {
+    // the triangles of a 256 x 256 vertex grid
+    const uint32_t n = 256;
+    std::vector<uint32_t> triangles;
+    for (uint32_t y = 0; y + 1 < n; y++) {
+      for (uint32_t x = 0; x + 1 < n; x++) {
+        const uint32_t i = y * n + x;
+        for (uint32_t v : {i, i + 1, i + n, i + 1, i + n + 1, i + n})
+          triangles.push_back(v);
+      }
+    }
+    const utility::OwnedArray<uint32_t> indices(triangles);
+
+    BufferWriter writer;
+    writePacked(writer, indices, PackedCoding::SIGNED_DELTA);
+    CHECK(writer.buffer->size() * 2 < indices.size() * sizeof(uint32_t));
+
+    BufferReader reader(writer.buffer);
+    std::vector<uint32_t> out;
+    readPacked(reader, out, PackedCoding::SIGNED_DELTA);
+    REQUIRE(out.size() == indices.size());
+    CHECK(std::equal(out.begin(), out.end(), indices.begin()));
+  }
+}
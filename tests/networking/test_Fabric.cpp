@@ -0,0 +1,101 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+#include "message_helpers.h"
+
+#include "rkcommon/networking/Fabric.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+using namespace rkcommon;
+using namespace rkcommon::networking;
+
+namespace {
+
+  /* delivers the messages sent to it in order per rank (-1 for the
+     broadcasts), blocking receives until they have arrived; it is used from
+     the receive thread, so it reports errors by throwing */
+  struct Mailbox : public Fabric
+  {
+    void sendBcast(
+        std::shared_ptr<utility::AbstractArray<uint8_t>> buf) override
+    {
+      send(buf, -1);
+    }
+
+    void flushBcastSends() override {}
+
+    void recvBcast(utility::AbstractArray<uint8_t> &buf) override
+    {
+      recv(buf, -1);
+    }
+
+    void send(std::shared_ptr<utility::AbstractArray<uint8_t>> buf,
+              int rank) override
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      messages[rank].push_back(buf);
+      arrived.notify_all();
+    }
+
+    void recv(utility::AbstractArray<uint8_t> &buf, int rank) override
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      auto &queue = messages[rank];
+      arrived.wait(lock, [&]() { return !queue.empty(); });
+      auto message = queue.front();
+      queue.pop_front();
+      if (message->size() != buf.size())
+        throw std::runtime_error("Mailbox: wrong size");
+      std::memcpy(buf.data(), message->data(), buf.size());
+    }
+
+    std::mutex mutex;
+    std::condition_variable arrived;
+    std::map<int, std::deque<std::shared_ptr<utility::AbstractArray<uint8_t>>>>
+        messages;
+  };
+
+}  // namespace
+
+TEST_CASE("Fabric default async receives", "[Fabric]")
+{
+  auto pool = std::make_shared<BufferPool>();
+  Mailbox fabric;
+  fabric.setBufferPool(pool);
+
+  SECTION("receives complete in order, into pooled buffers")
+  {
+    auto first  = fabric.recvAsync(100, 1);
+    auto second = fabric.recvAsync(200, 1);
+    auto bcast  = fabric.recvBcastAsync(300);
+    CHECK(!first.isReady());
+
+    fabric.send(makeMessage(100, 1), 1);
+    fabric.send(makeMessage(200, 2), 1);
+    fabric.sendBcast(makeMessage(300, 3));
+
+    CHECK(sameBytes(*first.get(), *makeMessage(100, 1)));
+    CHECK(sameBytes(*second.get(), *makeMessage(200, 2)));
+    CHECK(sameBytes(*bcast.get(), *makeMessage(300, 3)));
+    CHECK(pool->stats().acquires == 3);
+  }
+
+  SECTION("errors of the receive end up in the future")
+  {
+    auto wrong = fabric.recvAsync(10, 2);
+    fabric.send(makeMessage(20, 0), 2);
+    CHECK_THROWS(wrong.get());
+
+    // and the next receive goes on
+    auto next = fabric.recvAsync(5, 2);
+    fabric.send(makeMessage(5, 1), 2);
+    CHECK(sameBytes(*next.get(), *makeMessage(5, 1)));
+  }
+}
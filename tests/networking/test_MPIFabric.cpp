@@ -0,0 +1,77 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#define CATCH_CONFIG_RUNNER
+#include "../catch.hpp"
+#include "message_helpers.h"
+
+#include "rkcommon/networking/MPIFabric.h"
+#include "rkcommon/utility/OwnedArray.h"
+
+#include <cstring>
+
+using namespace rkcommon;
+using namespace rkcommon::networking;
+
+// run on several ranks, e.g. with 'mpiexec -n 3'
+int main(int argc, char *argv[])
+{
+  MPI_Init(&argc, &argv);
+  const int result = Catch::Session().run(argc, argv);
+  MPI_Finalize();
+  return result;
+}
+
+TEST_CASE("MPIFabric broadcasts", "[MPIFabric]")
+{
+  // small chunks, so the messages take several
+  MPIFabric fabric(MPI_COMM_WORLD, 0, 1000);
+  REQUIRE(fabric.numRanks() > 1);
+
+  const size_t sizes[] = {0, 10, 1000, 12345};
+  if (fabric.rank() == 0) {
+    std::vector<MPIFabric::Handle> handles;
+    for (size_t size : sizes)
+      handles.push_back(fabric.isendBcast(makeMessage(size, int(size))));
+    fabric.sendBcast(makeMessage(100000, 1));
+    fabric.flushBcastSends();
+    for (auto &handle : handles)
+      CHECK(handle.test());
+  } else {
+    CHECK_THROWS(fabric.sendBcast(makeMessage(10, 0)));
+    for (size_t size : sizes) {
+      utility::OwnedArray<uint8_t> received;
+      received.resize(size);
+      fabric.recvBcast(received);
+      CHECK(sameBytes(received, *makeMessage(size, int(size))));
+    }
+    utility::OwnedArray<uint8_t> received;
+    received.resize(100000);
+    fabric.recvBcast(received);
+    CHECK(sameBytes(received, *makeMessage(100000, 1)));
+  }
+}
+
+TEST_CASE("MPIFabric point to point", "[MPIFabric]")
+{
+  MPIFabric fabric(MPI_COMM_WORLD, 0, 4096);
+  const int rank = fabric.rank();
+  const int next = (rank + 1) % fabric.numRanks();
+  const int prev = (rank + fabric.numRanks() - 1) % fabric.numRanks();
+
+  // around the ring, with both messages in flight before receiving
+  MPIFabric::Handle first = fabric.isend(makeMessage(50000, rank), next);
+  fabric.send(makeMessage(100, rank + 1), next);
+
+  utility::OwnedArray<uint8_t> received;
+  received.resize(50000);
+  fabric.recv(received, prev);
+  CHECK(sameBytes(received, *makeMessage(50000, prev)));
+  received.resize(100);
+  fabric.recv(received, prev);
+  CHECK(sameBytes(received, *makeMessage(100, prev + 1)));
+
+  first.wait();
+  CHECK(first.test());
+  fabric.flushBcastSends();
+}
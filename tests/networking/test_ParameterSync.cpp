@@ -0,0 +1,159 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/AffineSpace.h"
+#include "rkcommon/math/box.h"
+#include "rkcommon/networking/ParameterSync.h"
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+using namespace rkcommon::networking;
+using rkcommon::utility::ParameterizedObject;
+
+namespace {
+
+  // a delta of 'object' since 'since', applied to 'copy'; returns the size
+  size_t sync(ParameterizedObject &object,
+              ParameterizedObject &copy,
+              size_t &since)
+  {
+    BufferWriter writer;
+    since = writeParamDelta(writer, object, since);
+    BufferReader reader(writer.buffer);
+    applyParamDelta(reader, copy);
+    CHECK(reader.end());
+    return writer.buffer->size();
+  }
+
+}  // namespace
+
+TEST_CASE("ParameterSync round trips the supported types", "[ParameterSync]")
+{
+  ParameterizedObject object, copy;
+  object.setParam("bool", true);
+  object.setParam("int", -123456);
+  object.setParam("uint", 42u);
+  object.setParam("int64", -(int64_t(1) << 40));
+  object.setParam("uint64", uint64_t(1) << 63);
+  object.setParam("float", 1.5f);
+  object.setParam("double", 0.1);
+  object.setParam("string", std::string("checkerboard"));
+  object.setParam("empty", std::string());
+  object.setParam("vec2f", vec2f(1.f, 2.f));
+  object.setParam("vec3f", vec3f(1.f, 2.f, 3.f));
+  object.setParam("vec4f", vec4f(1.f, 2.f, 3.f, 4.f));
+  object.setParam("vec2i", vec2i(-1, 2));
+  object.setParam("vec3i", vec3i(-1, 2, -3));
+  object.setParam("vec4i", vec4i(-1, 2, -3, 4));
+  object.setParam("box3f", box3f(vec3f(-1.f), vec3f(1.f)));
+  object.setParam("affine3f", affine3f::translate(vec3f(1.f, 2.f, 3.f)));
+
+  size_t since = 0;
+  sync(object, copy, since);
+
+  CHECK(copy.getParam<bool>("bool", false) == true);
+  CHECK(copy.getParam<int>("int", 0) == -123456);
+  CHECK(copy.getParam<unsigned int>("uint", 0) == 42u);
+  CHECK(copy.getParam<int64_t>("int64", 0) == -(int64_t(1) << 40));
+  CHECK(copy.getParam<uint64_t>("uint64", 0) == uint64_t(1) << 63);
+  CHECK(copy.getParam<float>("float", 0.f) == 1.5f);
+  CHECK(copy.getParam<double>("double", 0.0) == 0.1);
+  CHECK(copy.getParam<std::string>("string", "") == "checkerboard");
+  CHECK(copy.hasParam("empty"));
+  CHECK(copy.getParam<std::string>("empty", "x").empty());
+  CHECK(copy.getParam<vec2f>("vec2f", vec2f(0.f)) == vec2f(1.f, 2.f));
+  CHECK(copy.getParam<vec3f>("vec3f", vec3f(0.f)) == vec3f(1.f, 2.f, 3.f));
+  CHECK(copy.getParam<vec4f>("vec4f", vec4f(0.f))
+        == vec4f(1.f, 2.f, 3.f, 4.f));
+  CHECK(copy.getParam<vec2i>("vec2i", vec2i(0)) == vec2i(-1, 2));
+  CHECK(copy.getParam<vec3i>("vec3i", vec3i(0)) == vec3i(-1, 2, -3));
+  CHECK(copy.getParam<vec4i>("vec4i", vec4i(0)) == vec4i(-1, 2, -3, 4));
+  const box3f box = copy.getParam<box3f>("box3f", box3f());
+  CHECK(box.lower == vec3f(-1.f));
+  CHECK(box.upper == vec3f(1.f));
+  CHECK(copy.getParam<affine3f>("affine3f", affine3f(one)).p
+        == vec3f(1.f, 2.f, 3.f));
+}
+
+TEST_CASE("ParameterSync sends only what changed", "[ParameterSync]")
+{
+  ParameterizedObject object, copy;
+  for (int i = 0; i < 1000; i++)
+    object.setParam("param" + std::to_string(i), float(i));
+
+  size_t since     = 0;
+  const size_t all = sync(object, copy, since);
+  CHECK(copy.getParam<float>("param999", 0.f) == 999.f);
+
+  SECTION("nothing changed")
+  {
+    CHECK(sync(object, copy, since) == 2);
+  }
+
+  SECTION("a few changes")
+  {
+    object.setParam("param7", 70.f);
+    object.setParam("param500", std::string("now a string"));
+    object.setParam("new", 1);
+    object.removeParam("param3");
+
+    const size_t delta = sync(object, copy, since);
+    CHECK(delta < all / 50);
+    CHECK(copy.getParam<float>("param7", 0.f) == 70.f);
+    CHECK(copy.getParam<std::string>("param500", "") == "now a string");
+    CHECK(copy.getParam<int>("new", 0) == 1);
+    CHECK(!copy.hasParam("param3"));
+    CHECK(copy.getParam<float>("param8", 0.f) == 8.f);
+
+    // and then nothing again
+    CHECK(sync(object, copy, since) == 2);
+  }
+
+  SECTION("removed and set again")
+  {
+    object.removeParam("param1");
+    object.setParam("param1", -1.f);
+    object.removeParam("param2");
+    sync(object, copy, since);
+    CHECK(copy.getParam<float>("param1", 0.f) == -1.f);
+    CHECK(!copy.hasParam("param2"));
+
+    object.forgetRemovedParams(since);
+    CHECK(sync(object, copy, since) == 2);
+  }
+}
+
+TEST_CASE("ParameterSync skips unsupported types", "[ParameterSync]")
+{
+  struct Opaque
+  {
+    int x;
+  };
+
+  ParameterizedObject object, copy;
+  object.setParam("opaque", Opaque{1});
+  object.setParam("radius", 2.f);
+
+  BufferWriter writer;
+  std::vector<std::string> skipped;
+  writeParamDelta(writer, object, 0, &skipped);
+  REQUIRE(skipped.size() == 1);
+  CHECK(skipped[0] == "opaque");
+
+  BufferReader reader(writer.buffer);
+  applyParamDelta(reader, copy);
+  CHECK(!copy.hasParam("opaque"));
+  CHECK(copy.getParam<float>("radius", 0.f) == 2.f);
+
+  SECTION("unknown tags throw")
+  {
+    BufferWriter bad;
+    writeVarint(bad, 1);  // one parameter
+    writeVarint(bad, 1);  // named "x"
+    bad << 'x' << uint8_t(200);
+    BufferReader badReader(bad.buffer);
+    CHECK_THROWS(applyParamDelta(badReader, copy));
+  }
+}
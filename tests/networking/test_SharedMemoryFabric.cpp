@@ -0,0 +1,123 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _WIN32
+
+#include "../catch.hpp"
+#include "message_helpers.h"
+
+#include "rkcommon/networking/SharedMemoryFabric.h"
+#include "rkcommon/networking/SocketFabric.h"
+#include "rkcommon/utility/OwnedArray.h"
+
+#include <unistd.h>
+#include <cstring>
+#include <thread>
+
+using namespace rkcommon;
+using namespace rkcommon::networking;
+
+static std::string segmentName(const char *test)
+{
+  return std::string("/rkcommon_test_") + test + "_"
+      + std::to_string(getpid());
+}
+
+TEST_CASE("SharedMemoryFabric messages", "[SharedMemoryFabric]")
+{
+  const std::string name = segmentName("messages");
+  // the workers are threads here, but could as well be processes
+  SharedMemoryFabric root(name, 0, 3, 4096, 1 << 20);
+  std::vector<std::thread> workers;
+  for (int rank = 1; rank < 3; rank++) {
+    workers.emplace_back([&, rank]() {
+      SharedMemoryFabric fabric(name, rank, 3, 4096, 1 << 20);
+
+      // more than the ring holds, through the ring and through the heap
+      for (size_t size : {size_t(10), size_t(50000), size_t(300000)}) {
+        utility::OwnedArray<uint8_t> received;
+        received.resize(size);
+        fabric.recvBcast(received);
+        REQUIRE(sameBytes(received, *makeMessage(size, 1)));
+      }
+
+      // in place from the root's heap
+      auto shared = fabric.recvShared(0);
+      REQUIRE(shared->size() == 1000);
+      CHECK(sameBytes(*shared, *makeMessage(1000, 2)));
+
+      auto reply = fabric.allocate(100);
+      std::memcpy(reply->data(), makeMessage(100, rank)->data(), 100);
+      fabric.send(reply, 0);
+      fabric.flushBcastSends();
+    });
+  }
+
+  root.minHeapMessage = 100000;
+  for (size_t size : {size_t(10), size_t(50000), size_t(300000)})
+    root.sendBcast(makeMessage(size, 1));
+
+  auto shared = root.allocate(1000);
+  std::memcpy(shared->data(), makeMessage(1000, 2)->data(), 1000);
+  const uint8_t *where = shared->data();
+  root.send(shared, 1);
+  root.send(shared, 2);
+
+  for (int rank = 1; rank < 3; rank++) {
+    utility::OwnedArray<uint8_t> reply;
+    reply.resize(100);
+    root.recv(reply, rank);
+    CHECK(sameBytes(reply, *makeMessage(100, rank)));
+  }
+  root.flushBcastSends();
+  for (auto &w : workers)
+    w.join();
+
+  // the heap blocks are reused once all ranks are done with them, so the
+  // whole heap is free again
+  shared.reset();
+  auto whole = root.allocate((1 << 20) - 64);
+  CHECK(whole->data() < where);
+  CHECK(whole->data() + whole->size() > where);
+}
+
+TEST_CASE("SharedMemoryFabric mismatched sizes", "[SharedMemoryFabric]")
+{
+  const std::string name = segmentName("sizes");
+  SharedMemoryFabric root(name, 0, 2);
+  SharedMemoryFabric worker(name, 1, 2);
+  root.send(makeMessage(10, 0), 1);
+  utility::OwnedArray<uint8_t> received;
+  received.resize(11);
+  CHECK_THROWS(worker.recv(received, 0));
+  CHECK_THROWS(root.send(makeMessage(10, 0), 0));
+}
+
+TEST_CASE("Fabrics between ranks on one host", "[SharedMemoryFabric]")
+{
+  SocketListener listener("127.0.0.1:0");
+  std::vector<std::shared_ptr<Fabric>> workers(2);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 2; i++) {
+    threads.emplace_back([&, i]() {
+      workers[i] = connectFabric(listener.address(), i + 1);
+    });
+  }
+  std::shared_ptr<Fabric> root = acceptFabric(listener, 2);
+  for (auto &t : threads)
+    t.join();
+
+  CHECK(std::dynamic_pointer_cast<SharedMemoryFabric>(root));
+  for (auto &worker : workers)
+    REQUIRE(std::dynamic_pointer_cast<SharedMemoryFabric>(worker));
+
+  root->sendBcast(makeMessage(1000, 3));
+  for (auto &worker : workers) {
+    utility::OwnedArray<uint8_t> received;
+    received.resize(1000);
+    worker->recvBcast(received);
+    CHECK(sameBytes(received, *makeMessage(1000, 3)));
+  }
+}
+
+#endif
@@ -0,0 +1,213 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _WIN32
+
+#include "../catch.hpp"
+#include "message_helpers.h"
+
+#include "rkcommon/networking/DataStreaming.h"
+#include "rkcommon/networking/SocketFabric.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <thread>
+
+using namespace rkcommon;
+using namespace rkcommon::networking;
+
+// a root and its workers, set up through a listener at 'address'
+static void connectAll(
+    const std::string &address,
+    int numWorkers,
+    std::shared_ptr<SocketFabric> &root,
+    std::vector<std::shared_ptr<SocketFabric>> &workers)
+{
+  SocketListener listener(address);
+  workers.resize(numWorkers);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < numWorkers; i++) {
+    threads.emplace_back([&, i]() {
+      workers[i] = SocketFabric::connect(listener.address(), i + 1);
+    });
+  }
+  root = listener.accept(numWorkers);
+  for (auto &t : threads)
+    t.join();
+}
+
+TEST_CASE("SocketFabric point to point", "[SocketFabric]")
+{
+  int pair[2];
+  REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+  SocketFabric root(0, 2, {-1, pair[0]});
+  SocketFabric worker(1, 2, {pair[1]});
+  CHECK(root.numRanks() == 2);
+  CHECK(worker.rank() == 1);
+
+  SECTION("sends return before the bytes are received")
+  {
+    // more than the socket buffers hold
+    auto big = makeMessage(32 << 20, 1);
+    root.send(big, 1);
+    auto small = makeMessage(100, 2);
+    root.send(small, 1);
+
+    utility::OwnedArray<uint8_t> received;
+    received.resize(big->size());
+    worker.recv(received, 0);
+    CHECK(sameBytes(received, *big));
+    received.resize(small->size());
+    worker.recv(received, 0);
+    CHECK(sameBytes(received, *small));
+    root.flushBcastSends();
+
+    // and back
+    worker.send(small, 0);
+    worker.flushBcastSends();
+    root.recv(received, 1);
+    CHECK(sameBytes(received, *small));
+  }
+
+  SECTION("segments arrive as the coalesced bytes")
+  {
+    std::shared_ptr<utility::AbstractArray<uint8_t>> big =
+        makeMessage(1 << 20, 3);
+    IOVecWriter writer;
+    writer << 42 << std::string("frame") << big << 7.f;
+    root.sendSegments(writer, 1);
+
+    auto expected = writer.coalesce();
+    utility::OwnedArray<uint8_t> received;
+    received.resize(expected->size());
+    worker.recv(received, 0);
+    CHECK(sameBytes(received, *expected));
+  }
+
+  SECTION("unknown ranks throw")
+  {
+    CHECK_THROWS(root.send(makeMessage(10, 0), 2));
+    CHECK_THROWS(worker.send(makeMessage(10, 0), 2));
+    CHECK_THROWS(worker.sendBcast(makeMessage(10, 0)));
+  }
+}
+
+TEST_CASE("SocketFabric errors surface in later calls", "[SocketFabric]")
+{
+  int pair[2];
+  REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+  SocketFabric root(0, 2, {-1, pair[0]});
+  ::close(pair[1]);
+
+  root.send(makeMessage(1 << 20, 0), 1);
+  CHECK_THROWS(root.flushBcastSends());
+  CHECK_THROWS(root.send(makeMessage(10, 0), 1));
+}
+
+TEST_CASE("SocketFabric async receives", "[SocketFabric]")
+{
+  std::shared_ptr<SocketFabric> root;
+  std::vector<std::shared_ptr<SocketFabric>> workers;
+  connectAll("127.0.0.1:0", 3, root, workers);
+
+  using Future =
+      tasking::Future<std::shared_ptr<utility::AbstractArray<uint8_t>>>;
+
+  SECTION("receives from all ranks are waited for at once")
+  {
+    // posted before anything is sent, in sizes which take several reads
+    const size_t sizes[] = {10, 0, 3 << 20, 1};
+    std::vector<Future> futures;
+    for (int r = 1; r < 4; r++) {
+      for (size_t size : sizes)
+        futures.push_back(root->recvAsync(size, r));
+    }
+    CHECK(!futures.front().isReady());
+
+    // the last rank first
+    for (int w = 2; w >= 0; w--) {
+      for (size_t size : sizes)
+        workers[w]->send(makeMessage(size, w + int(size)), 0);
+      workers[w]->flushBcastSends();
+    }
+
+    size_t i = 0;
+    for (int r = 1; r < 4; r++) {
+      for (size_t size : sizes) {
+        auto received = futures[i++].get();
+        REQUIRE(sameBytes(*received, *makeMessage(size, r - 1 + int(size))));
+      }
+    }
+  }
+
+  SECTION("broadcasts")
+  {
+    Future frame = workers[1]->recvBcastAsync(5000);
+    root->sendBcast(makeMessage(5000, 9));
+    CHECK(sameBytes(*frame.get(), *makeMessage(5000, 9)));
+    for (int w : {0, 2}) {
+      auto received = workers[w]->recvPooled(5000, 0);
+      CHECK(sameBytes(*received, *makeMessage(5000, 9)));
+    }
+  }
+
+  SECTION("a closed connection fails its receives")
+  {
+    Future lost = root->recvAsync(100, 2);
+    workers[1]->send(makeMessage(50, 0), 0);
+    workers[1].reset();
+    CHECK_THROWS(lost.get());
+
+    // the others still work
+    Future other = root->recvAsync(10, 1);
+    workers[0]->send(makeMessage(10, 1), 0);
+    CHECK(sameBytes(*other.get(), *makeMessage(10, 1)));
+  }
+
+  SECTION("destroying the fabric fails pending receives")
+  {
+    Future pending = workers[0]->recvAsync(10, 0);
+    workers[0].reset();
+    CHECK_THROWS(pending.get());
+  }
+}
+
+TEST_CASE("SocketFabric broadcasts", "[SocketFabric]")
+{
+  const std::string addresses[] = {
+      "127.0.0.1:0", "unix:/tmp/rkcommon_test_SocketFabric"};
+  for (const std::string &address : addresses) {
+    INFO("address = " << address);
+    std::shared_ptr<SocketFabric> root;
+    std::vector<std::shared_ptr<SocketFabric>> workers;
+    connectAll(address, 3, root, workers);
+    CHECK(root->numRanks() == 4);
+
+    for (int frame = 0; frame < 3; frame++)
+      root->sendBcast(makeMessage(100000 + frame, frame));
+
+    for (const auto &worker : workers) {
+      CHECK(worker->numRanks() == 4);
+      for (int frame = 0; frame < 3; frame++) {
+        utility::OwnedArray<uint8_t> received;
+        received.resize(100000 + frame);
+        worker->recvBcast(received);
+        REQUIRE(sameBytes(received, *makeMessage(100000 + frame, frame)));
+      }
+
+      // replies to the root
+      worker->send(makeMessage(10, worker->rank()), 0);
+    }
+    root->flushBcastSends();
+
+    for (int r = 1; r < 4; r++) {
+      utility::OwnedArray<uint8_t> reply;
+      reply.resize(10);
+      root->recv(reply, r);
+      CHECK(sameBytes(reply, *makeMessage(10, r)));
+    }
+  }
+}
+
+#endif
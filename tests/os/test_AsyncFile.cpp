@@ -0,0 +1,165 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/memory/malloc.h"
+#include "rkcommon/os/AsyncFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace rkcommon;
+
+namespace {
+
+  const char *fileName = "test_AsyncFile.bin";
+
+  std::vector<uint8_t> makeData(size_t size, int seed)
+  {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++)
+      data[i] = uint8_t(i * 13 + seed + (i >> 8));
+    return data;
+  }
+
+  // both backends where there is a native one
+  AsyncFileOptions pickOptions()
+  {
+    AsyncFileOptions options;
+    SECTION("native backend") {}
+    SECTION("thread backend")
+    {
+      options.useThreads = true;
+    }
+    return options;
+  }
+
+}  // namespace
+
+TEST_CASE("AsyncFile writes and reads at offsets", "[AsyncFile]")
+{
+  const AsyncFileOptions options = pickOptions();
+  const size_t chunk             = 100000;
+  const int numChunks            = 16;
+
+  std::vector<std::vector<uint8_t>> chunks;
+  for (int i = 0; i < numChunks; i++)
+    chunks.push_back(makeData(chunk, i));
+
+  {
+    AsyncFile file(fileName, AsyncFile::WRITE, options);
+    INFO(file.backend());
+
+    // in reverse, so the file grows from the end
+    std::vector<tasking::Future<size_t>> writes;
+    for (int i = numChunks - 1; i >= 0; i--)
+      writes.push_back(file.writeAt(chunks[i].data(), chunk, i * chunk));
+    for (auto &w : writes)
+      CHECK(w.get() == chunk);
+    CHECK(file.size() == numChunks * chunk);
+  }
+
+  AsyncFile file(fileName, AsyncFile::READ, options);
+  std::vector<std::vector<uint8_t>> read(numChunks);
+  std::vector<tasking::Future<size_t>> reads;
+  for (int i = 0; i < numChunks; i++) {
+    read[i].resize(chunk);
+    reads.push_back(file.readAt(read[i].data(), chunk, i * chunk));
+  }
+  for (int i = 0; i < numChunks; i++) {
+    CHECK(reads[i].get() == chunk);
+    CHECK(read[i] == chunks[i]);
+  }
+
+  SECTION("reads stop at the end of the file")
+  {
+    std::vector<uint8_t> tail(chunk);
+    CHECK(file.readAt(tail.data(), chunk, (numChunks - 1) * chunk + 10).get()
+          == chunk - 10);
+    CHECK(std::memcmp(tail.data(), chunks.back().data() + 10, chunk - 10)
+          == 0);
+    CHECK(file.readAt(tail.data(), chunk, numChunks * chunk).get() == 0);
+    CHECK(file.readAt(tail.data(), 0, 0).get() == 0);
+  }
+
+  SECTION("errors end up in the futures")
+  {
+    // a read-only file
+    uint8_t byte = 0;
+    CHECK_THROWS(file.writeAt(&byte, 1, 0).get());
+  }
+
+  file.wait();
+  std::remove(fileName);
+}
+
+TEST_CASE("AsyncFile with unbuffered I/O", "[AsyncFile]")
+{
+  AsyncFileOptions options = pickOptions();
+  options.direct           = true;
+
+  const size_t alignment = AsyncFile::directAlignment();
+  const size_t size      = 64 * alignment;
+  const std::vector<uint8_t> data = makeData(size + 100, 7);
+
+  {
+    AsyncFile file(fileName, AsyncFile::WRITE, options);
+    // an unaligned part and an aligned one
+    auto tail = file.writeAt(data.data() + size, 100, size);
+    void *aligned = memory::alignedMalloc(size, alignment);
+    std::memcpy(aligned, data.data(), size);
+    CHECK(file.writeAt(aligned, size, 0).get() == size);
+    CHECK(tail.get() == 100);
+    memory::alignedFree(aligned);
+  }
+
+  AsyncFile file(fileName, AsyncFile::READ, options);
+  INFO(file.backend() << (file.isDirect() ? ", direct" : ""));
+
+  uint8_t *buffer =
+      (uint8_t *)memory::alignedMalloc(size + alignment, alignment);
+
+  // aligned
+  CHECK(file.readAt(buffer, size, 0).get() == size);
+  CHECK(std::memcmp(buffer, data.data(), size) == 0);
+
+  // aligned, across the end of the file
+  CHECK(file.readAt(buffer, size + alignment, 0).get() == size + 100);
+  CHECK(std::memcmp(buffer, data.data(), size + 100) == 0);
+
+  // unaligned
+  CHECK(file.readAt(buffer + 1, 1000, 3).get() == 1000);
+  CHECK(std::memcmp(buffer + 1, data.data() + 3, 1000) == 0);
+
+  memory::alignedFree(buffer);
+  std::remove(fileName);
+}
+
+TEST_CASE("AsyncFile bounds the requests in flight", "[AsyncFile]")
+{
+  AsyncFileOptions options = pickOptions();
+  options.queueDepth       = 2;
+
+  const std::vector<uint8_t> data = makeData(4096, 1);
+  {
+    AsyncFile file(fileName, AsyncFile::READ_WRITE, options);
+    for (int i = 0; i < 100; i++)
+      file.writeAt(data.data() + i * 40, 40, i * 40);
+    // waited for by the destructor
+  }
+
+  AsyncFile file(fileName, AsyncFile::READ, options);
+  CHECK(file.size() == 4000);
+  std::vector<uint8_t> read(4000);
+  CHECK(file.readAt(read.data(), 4000, 0).get() == 4000);
+  CHECK(std::memcmp(read.data(), data.data(), 4000) == 0);
+
+  std::remove(fileName);
+}
+
+TEST_CASE("AsyncFile reports files which cannot be opened", "[AsyncFile]")
+{
+  CHECK_THROWS(AsyncFile("does/not/exist.bin", AsyncFile::READ));
+}
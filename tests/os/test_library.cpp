@@ -1,5 +1,117 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/os/library.h"
+// std
+#include <string>
+
+using namespace rkcommon;
+
+// test_module.cpp is built next to the test suite
+static void anchor() {}
+
+static const char *moduleName = "rkcommon_test_module";
+
+TEST_CASE("Library symbol lookup", "[library]")
+{
+  const void *anchorAddress = reinterpret_cast<const void *>(&anchor);
+  LibraryRepository *repo   = LibraryRepository::getInstance();
+
+  static SymbolHandle<int(int, int)> add("rkcommon_test_module_add");
+  REQUIRE(!add);
+  REQUIRE_THROWS(add(1, 2));
+
+  const uint64_t before = LibraryRepository::generation();
+  loadLibrary(anchorAddress, moduleName);
+  REQUIRE(repo->libraryExists(moduleName));
+  REQUIRE(LibraryRepository::generation() != before);
+
+  SECTION("untyped and typed lookups")
+  {
+    void *sym = getSymbol("rkcommon_test_module_add");
+    REQUIRE(sym != nullptr);
+    // cached, also for symbols which are missing
+    REQUIRE(getSymbol("rkcommon_test_module_add") == sym);
+    REQUIRE(getSymbol("rkcommon_test_module_missing") == nullptr);
+    REQUIRE(getSymbol("rkcommon_test_module_missing") == nullptr);
+
+    auto fcn = getSymbol<int(int, int)>("rkcommon_test_module_add");
+    REQUIRE(fcn(2, 3) == 5);
+    auto name = repo->getSymbol<const char *()>("rkcommon_test_module_name");
+    REQUIRE(std::string(name()) == moduleName);
+  }
+
+  SECTION("batches of entry points")
+  {
+    auto syms = getSymbols({"rkcommon_test_module_name",
+                            "rkcommon_test_module_missing",
+                            "rkcommon_test_module_add"});
+    REQUIRE(syms.size() == 3);
+    REQUIRE(syms[0] == getSymbol("rkcommon_test_module_name"));
+    REQUIRE(syms[1] == nullptr);
+    REQUIRE(syms[2] == getSymbol("rkcommon_test_module_add"));
+  }
+
+  SECTION("static handles")
+  {
+    REQUIRE(add);
+    REQUIRE(add(20, 22) == 42);
+    REQUIRE(add.get() == getSymbol<int(int, int)>("rkcommon_test_module_add"));
+  }
+
+  // unloading invalidates both the cache and the handles
+  unloadLibrary(moduleName);
+  REQUIRE(!repo->libraryExists(moduleName));
+  REQUIRE(getSymbol("rkcommon_test_module_add") == nullptr);
+  REQUIRE(!add);
+}
+
+TEST_CASE("Library load options", "[library]")
+{
+  const void *anchorAddress = reinterpret_cast<const void *>(&anchor);
+
+  SECTION("deferred opening")
+  {
+    LibraryOptions options;
+    options.deferred = true;
+
+    Library lib(anchorAddress, moduleName, {}, options);
+    REQUIRE(!lib.isOpen());
+    REQUIRE(lib.getSymbol("rkcommon_test_module_add") != nullptr);
+    REQUIRE(lib.isOpen());
+
+    // errors show up on first use
+    Library missing(anchorAddress, "rkcommon_no_such_module", {}, options);
+    REQUIRE_THROWS(missing.getSymbol("rkcommon_test_module_add"));
+    REQUIRE_THROWS(Library(anchorAddress, "rkcommon_no_such_module", {}));
+  }
+
+  SECTION("immediate binding")
+  {
+    LibraryOptions options;
+    options.lazyBinding = false;
+
+    Library lib(anchorAddress, moduleName, {}, options);
+    REQUIRE(lib.isOpen());
+    REQUIRE(lib.getSymbol("rkcommon_test_module_name") != nullptr);
+  }
+
+  SECTION("batches of libraries")
+  {
+    LibraryRepository *repo = LibraryRepository::getInstance();
+
+    loadLibraries(anchorAddress, {moduleName, moduleName});
+    REQUIRE(repo->libraryExists(moduleName));
+    REQUIRE(getSymbol("rkcommon_test_module_add") != nullptr);
+    unloadLibrary(moduleName);
+
+    // the libraries which load are kept, the first error is thrown
+    REQUIRE_THROWS(
+        loadLibraries(anchorAddress, {"rkcommon_no_such_module", moduleName}));
+    REQUIRE(repo->libraryExists(moduleName));
+    REQUIRE(!repo->libraryExists("rkcommon_no_such_module"));
+    unloadLibrary(moduleName);
+  }
+}
@@ -0,0 +1,20 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// A library for test_library.cpp to load
+
+#ifdef _WIN32
+#define TEST_MODULE_EXPORT extern "C" __declspec(dllexport)
+#else
+#define TEST_MODULE_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+TEST_MODULE_EXPORT int rkcommon_test_module_add(int a, int b)
+{
+  return a + b;
+}
+
+TEST_MODULE_EXPORT const char *rkcommon_test_module_name()
+{
+  return "rkcommon_test_module";
+}
@@ -0,0 +1,100 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/async.h"
+#include "rkcommon/tasking/parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace rkcommon::tasking;
+
+TEST_CASE("Arena properties", "[Arena]")
+{
+  Arena arena(2, Arena::Priority::HIGH);
+  REQUIRE(arena.maxConcurrency() == 2);
+  REQUIRE(arena.priority() == Arena::Priority::HIGH);
+
+  Arena defaultArena;
+  REQUIRE(defaultArena.maxConcurrency() >= 1);
+  REQUIRE(defaultArena.priority() == Arena::Priority::NORMAL);
+  REQUIRE(defaultArena.coreType() == CoreType::UNKNOWN);
+}
+
+TEST_CASE("parallel_for in an Arena preferring performance cores", "[Arena]")
+{
+  Arena arena(2, Arena::Priority::HIGH, CoreType::PERFORMANCE);
+  REQUIRE(arena.coreType() == CoreType::PERFORMANCE);
+
+  std::vector<int> v(100000, 0);
+  parallel_for(arena, int(v.size()), [&](int i) { v[i] = 1; });
+
+  REQUIRE(std::count(v.begin(), v.end(), 1) == int(v.size()));
+}
+
+TEST_CASE("parallel_for in an Arena", "[Arena]")
+{
+  Arena arena(2);
+
+  std::vector<int> v(100000, 0);
+  parallel_for(arena, int(v.size()), [&](int i) { v[i] = 1; });
+
+  REQUIRE(std::count(v.begin(), v.end(), 1) == int(v.size()));
+}
+
+TEST_CASE("nested parallel_for in Arena::execute", "[Arena]")
+{
+  Arena arena(2, Arena::Priority::LOW);
+
+  std::atomic<int> sum{0};
+  arena.execute([&]() {
+    parallel_for(16, [&](int) {
+      parallel_for(16, [&](int) { sum++; });
+    });
+  });
+
+  REQUIRE(sum.load() == 256);
+}
+
+TEST_CASE("async and schedule in an Arena", "[Arena]")
+{
+  Arena arena(2);
+
+  auto future = async(arena, []() { return 42; });
+  REQUIRE(future.get() == 42);
+
+  std::atomic<bool> ran{false};
+  schedule(arena, [&]() { ran = true; });
+  while (!ran.load())
+    std::this_thread::yield();
+  REQUIRE(ran.load());
+}
+
+// the Debug backend runs tasks synchronously, so this would deadlock
+#if defined(RKCOMMON_TASKING_TBB) || defined(RKCOMMON_TASKING_OMP) \
+    || defined(RKCOMMON_TASKING_INTERNAL)
+TEST_CASE("separate Arenas run independently", "[Arena]")
+{
+  Arena background(1, Arena::Priority::LOW);
+  Arena interactive(2, Arena::Priority::HIGH);
+
+  std::atomic<bool> release{false};
+  auto blocked = async(background, [&]() {
+    while (!release.load())
+      std::this_thread::yield();
+    return 1;
+  });
+
+  // the interactive arena makes progress while the background one is busy
+  std::vector<int> v(1000, 0);
+  parallel_for(interactive, int(v.size()), [&](int i) { v[i] = 1; });
+  REQUIRE(std::count(v.begin(), v.end(), 1) == int(v.size()));
+
+  release = true;
+  REQUIRE(blocked.get() == 1);
+}
+#endif
@@ -1,5 +1,96 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/tasking/AsyncLoop.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace rkcommon::tasking;
+
+static void waitForIterations(const std::atomic<int> &iterations, int n)
+{
+  while (iterations.load() < n)
+    std::this_thread::yield();
+}
+
+TEST_CASE("AsyncLoop start and stop", "[AsyncLoop]")
+{
+  std::atomic<int> iterations{0};
+
+  AsyncLoop loop([&]() { iterations++; }, AsyncLoop::THREAD);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  REQUIRE(iterations.load() == 0);
+
+  loop.start();
+  waitForIterations(iterations, 10);
+  loop.stop();
+
+  const int stoppedAt = iterations.load();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  REQUIRE(iterations.load() == stoppedAt);
+
+  const AsyncLoop::Statistics stats = loop.statistics();
+  REQUIRE(stats.starts == 1);
+  REQUIRE(stats.stops == 1);
+  REQUIRE(stats.iterations == size_t(stoppedAt));
+  REQUIRE(stats.lastStartLatency >= 0.0);
+  REQUIRE(stats.maxStopLatency >= stats.lastStopLatency);
+
+  loop.resetStatistics();
+  REQUIRE(loop.statistics().iterations == 0);
+  REQUIRE(loop.statistics().starts == 0);
+}
+
+TEST_CASE("AsyncLoop stop interrupts the loop body", "[AsyncLoop]")
+{
+  std::atomic<int> iterations{0};
+
+  // without interruption an iteration would take 10 seconds
+  AsyncLoop loop(
+      [&](const CancellationToken &interrupt) {
+        iterations++;
+        const auto end =
+            std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!interrupt.isCancelled()
+               && std::chrono::steady_clock::now() < end)
+          std::this_thread::yield();
+      },
+      AsyncLoop::THREAD);
+
+  for (int i = 1; i <= 2; ++i) {
+    loop.start();
+    waitForIterations(iterations, i);
+    loop.stop(AsyncLoop::INTERRUPT);
+  }
+
+  REQUIRE(iterations.load() == 2);
+  REQUIRE(loop.statistics().maxStopLatency < 5.0);
+}
+
+TEST_CASE("AsyncLoop target rate", "[AsyncLoop]")
+{
+  std::atomic<int> iterations{0};
+
+  AsyncLoop loop([&]() { iterations++; }, AsyncLoop::THREAD);
+  loop.setTargetRate(10.0);
+  REQUIRE(loop.targetRate() == Approx(10.0));
+
+  loop.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  loop.stop();
+
+  // ~3 iterations, unpaced this would be millions
+  REQUIRE(iterations.load() >= 1);
+  REQUIRE(iterations.load() <= 6);
+
+  // stopping does not wait out the 100ms sleep between iterations
+  REQUIRE(loop.statistics().maxStopLatency < 0.05);
+
+  loop.setTargetRate(0.0);
+  REQUIRE(loop.targetRate() == 0.0);
+}
@@ -13,3 +13,12 @@ TEST_CASE("AsyncTask", "[AsyncTask]")
   float retValue = t.get();
   REQUIRE(retValue == 1.f);
 }
+
+TEST_CASE("AsyncTask with priorities", "[AsyncTask]")
+{
+  using rkcommon::tasking::TaskPriority;
+
+  AsyncTask<int> low([=]() { return 1; }, TaskPriority::LOW);
+  AsyncTask<int> high([=]() { return 2; }, TaskPriority::HIGH);
+  REQUIRE(low.get() + high.get() == 3);
+}
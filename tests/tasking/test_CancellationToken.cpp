@@ -0,0 +1,101 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/AsyncLoop.h"
+#include "rkcommon/tasking/parallel_for.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace rkcommon::tasking;
+
+TEST_CASE("CancellationToken state", "[CancellationToken]")
+{
+  CancellationToken token;
+  REQUIRE(!token.isCancelled());
+
+  CancellationToken copy = token;
+  copy.cancel();
+  REQUIRE(token.isCancelled());
+
+  token.reset();
+  REQUIRE(!copy.isCancelled());
+}
+
+TEST_CASE("parallel_for with a token", "[CancellationToken]")
+{
+  const int N_TASKS = 1000000;
+
+  SECTION("runs everything when not cancelled")
+  {
+    CancellationToken token;
+    std::atomic<int> count{0};
+    parallel_for(N_TASKS, [&](int) { count++; }, token);
+    REQUIRE(count.load() == N_TASKS);
+  }
+
+  SECTION("runs nothing when already cancelled")
+  {
+    CancellationToken token;
+    token.cancel();
+    std::atomic<int> count{0};
+    parallel_for(N_TASKS, [&](int) { count++; }, token);
+    REQUIRE(count.load() == 0);
+  }
+
+  SECTION("stops early when cancelled from inside the loop")
+  {
+    CancellationToken token;
+    std::atomic<int> count{0};
+    parallel_for(
+        N_TASKS,
+        [&](int) {
+          if (++count == 1)
+            token.cancel();
+        },
+        token);
+    REQUIRE(count.load() < N_TASKS);
+  }
+}
+
+TEST_CASE("parallel_in_blocks_of with a token", "[CancellationToken]")
+{
+  const int N_TASKS = 1 << 20;
+
+  CancellationToken token;
+  std::atomic<int> count{0};
+  parallel_in_blocks_of<64>(
+      N_TASKS,
+      [&](int begin, int end) {
+        count += end - begin;
+        token.cancel();
+      },
+      token);
+
+  REQUIRE(count.load() > 0);
+  REQUIRE(count.load() < N_TASKS);
+}
+
+TEST_CASE("AsyncLoop with a token", "[CancellationToken]")
+{
+  CancellationToken token;
+  std::atomic<int> iterations{0};
+
+  AsyncLoop loop(
+      [&]() {
+        if (++iterations == 10)
+          token.cancel();
+      },
+      token,
+      AsyncLoop::THREAD);
+
+  loop.start();
+  while (iterations.load() < 10)
+    std::this_thread::yield();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  REQUIRE(iterations.load() == 10);
+}
@@ -0,0 +1,106 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/Future.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace rkcommon::tasking;
+
+TEST_CASE("Future get", "[Future]")
+{
+  auto f = async_future([]() { return 42; });
+  REQUIRE(f.valid());
+  REQUIRE(f.get() == 42);
+  REQUIRE(f.isReady());
+  REQUIRE(f.get() == 42);
+}
+
+TEST_CASE("Future then chain", "[Future]")
+{
+  std::atomic<int> sideEffect{0};
+
+  auto f = async_future([]() { return 2; })
+               .then([](int v) { return v * 10; })
+               .then([](int v) { return std::to_string(v); })
+               .then([&](const std::string &s) { sideEffect = int(s.size()); });
+
+  f.wait();
+  REQUIRE(sideEffect == 2);
+
+  auto g = f.then([]() { return 1.5f; });
+  REQUIRE(g.get() == 1.5f);
+}
+
+TEST_CASE("Future exception propagation", "[Future]")
+{
+  std::atomic<bool> ranContinuation{false};
+
+  auto f = async_future([]() -> int { throw std::runtime_error("fail"); })
+               .then([&](int v) {
+                 ranContinuation = true;
+                 return v;
+               });
+
+  REQUIRE_THROWS_AS(f.get(), std::runtime_error);
+  REQUIRE(!ranContinuation);
+}
+
+TEST_CASE("Future when_all", "[Future]")
+{
+  std::vector<Future<int>> futures;
+  for (int i = 0; i < 16; ++i)
+    futures.push_back(async_future([=]() { return i * i; }));
+
+  auto all = when_all(futures);
+  const auto &values = all.get();
+
+  REQUIRE(values.size() == 16);
+  for (int i = 0; i < 16; ++i)
+    REQUIRE(values[i] == i * i);
+
+  REQUIRE(when_all(std::vector<Future<int>>()).get().empty());
+}
+
+TEST_CASE("Future when_any", "[Future]")
+{
+  std::vector<Future<int>> futures;
+  futures.push_back(make_ready_future(7));
+  futures.push_back(async_future([]() { return 8; }));
+
+  const size_t index = when_any(futures).get();
+  REQUIRE(index < futures.size());
+  REQUIRE(futures[index].isReady());
+}
+
+TEST_CASE("Future invalid", "[Future]")
+{
+  Future<int> f;
+  REQUIRE(!f.valid());
+  REQUIRE_THROWS(f.wait());
+}
+
+TEST_CASE("Future Promise", "[Future]")
+{
+  Promise<int> promise;
+  auto f    = promise.getFuture();
+  auto next = f.then([](const int &v) { return v + 1; });
+  REQUIRE(!f.isReady());
+
+  std::thread producer([promise]() { promise.setValue(41); });
+  REQUIRE(next.get() == 42);
+  producer.join();
+
+  Promise<void> failed;
+  failed.setException(
+      std::make_exception_ptr(std::runtime_error("cannot write")));
+  REQUIRE_THROWS_AS(failed.getFuture().get(), std::runtime_error);
+
+  Promise<void> done;
+  done.setValue();
+  REQUIRE(done.getFuture().isReady());
+}
@@ -0,0 +1,94 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/Task.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+
+#ifdef RKCOMMON_HAS_COROUTINES
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace rkcommon::tasking;
+
+static Task<int> square(int x)
+{
+  co_await schedule_on();
+  co_return x * x;
+}
+
+static Task<int> constant(int x)
+{
+  co_return x;
+}
+
+static Task<int> sumOfSquares(int n)
+{
+  int sum = 0;
+  for (int i = 0; i < n; ++i)
+    sum += co_await square(i);
+  co_return sum;
+}
+
+static Task<void> fill(std::vector<int> &values)
+{
+  co_await async_parallel_for(int(values.size()), [&](int i) {
+    values[i] = 2 * i;
+  });
+}
+
+static Task<int> fail()
+{
+  co_await schedule_on();
+  throw std::runtime_error("failed");
+  co_return 0;
+}
+
+TEST_CASE("Task chains resume on the tasking system", "[Task]")
+{
+  initTaskingSystem();
+
+  REQUIRE(sync_wait(sumOfSquares(100)) == 328350);
+
+  std::vector<int> values(1000, 0);
+  sync_wait(fill(values));
+  for (int i = 0; i < 1000; ++i)
+    REQUIRE(values[i] == 2 * i);
+}
+
+TEST_CASE("Task exceptions and futures", "[Task]")
+{
+  REQUIRE_THROWS_AS(sync_wait(fail()), std::runtime_error);
+
+  // runs synchronously up to its first suspension, here to its end
+  auto future = to_future(constant(7));
+  REQUIRE(future.get() == 7);
+  REQUIRE(sync_wait(square(8)) == 64);
+}
+
+TEST_CASE("Task many in flight", "[Task]")
+{
+  const int N_TASKS = 2000;
+
+  std::atomic<int> done{0};
+  auto one = [&]() -> Task<void> {
+    co_await schedule_on(TaskPriority::LOW);
+    done++;
+  };
+
+  auto all = [&]() -> Task<void> {
+    std::vector<Task<void>> tasks;
+    for (int i = 0; i < N_TASKS; ++i)
+      tasks.push_back(one());
+    for (auto &t : tasks)
+      co_await t;
+  };
+
+  sync_wait(all());
+  REQUIRE(done == N_TASKS);
+}
+
+#endif
@@ -0,0 +1,91 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/TaskGraph.h"
+
+#include <atomic>
+#include <vector>
+
+using rkcommon::tasking::TaskGraph;
+
+TEST_CASE("TaskGraph diamond", "[TaskGraph]")
+{
+  std::atomic<int> clock{0};
+  int a = -1, b = -1, c = -1, d = -1;
+
+  TaskGraph g;
+  auto na = g.addNode([&]() { a = clock++; });
+  auto nb = g.addNode([&]() { b = clock++; });
+  auto nc = g.addNode([&]() { c = clock++; });
+  auto nd = g.addNode([&]() { d = clock++; });
+
+  g.addEdge(na, nb);
+  g.addEdge(na, nc);
+  g.addEdge(nb, nd);
+  g.addEdge(nc, nd);
+
+  g.execute();
+
+  REQUIRE(clock == 4);
+  REQUIRE(a < b);
+  REQUIRE(a < c);
+  REQUIRE(b < d);
+  REQUIRE(c < d);
+}
+
+TEST_CASE("TaskGraph reuse", "[TaskGraph]")
+{
+  const int N_NODES = 200;
+
+  std::vector<int> counts(N_NODES, 0);
+  std::vector<int> stamps(N_NODES, 0);
+  std::atomic<int> clock{0};
+
+  TaskGraph g;
+  for (int i = 0; i < N_NODES; ++i) {
+    g.addNode([&, i]() {
+      counts[i]++;
+      stamps[i] = clock++;
+    });
+  }
+
+  // a chain of layers of 10 nodes, each depending on the whole previous layer
+  for (int i = 10; i < N_NODES; ++i) {
+    const int layerBegin = (i / 10 - 1) * 10;
+    for (int j = layerBegin; j < layerBegin + 10; ++j)
+      g.addEdge(j, i);
+  }
+
+  const int N_FRAMES = 20;
+  for (int frame = 0; frame < N_FRAMES; ++frame) {
+    clock = 0;
+    g.execute();
+
+    for (int i = 10; i < N_NODES; ++i) {
+      const int layerBegin = (i / 10 - 1) * 10;
+      for (int j = layerBegin; j < layerBegin + 10; ++j)
+        REQUIRE(stamps[j] < stamps[i]);
+    }
+  }
+
+  for (auto c : counts)
+    REQUIRE(c == N_FRAMES);
+}
+
+TEST_CASE("TaskGraph errors", "[TaskGraph]")
+{
+  TaskGraph g;
+  g.execute(); // empty graph is a no-op
+
+  auto n0 = g.addNode([]() {});
+  auto n1 = g.addNode([]() {});
+
+  REQUIRE_THROWS(g.addEdge(n0, n0));
+  REQUIRE_THROWS(g.addEdge(n0, 5));
+
+  g.addEdge(n0, n1);
+  g.addEdge(n1, n0);
+  REQUIRE_THROWS(g.execute());
+}
@@ -0,0 +1,40 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/TaskingStatistics.h"
+#include "rkcommon/tasking/parallel_for.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+
+#include <atomic>
+
+using namespace rkcommon::tasking;
+
+TEST_CASE("statistics count executed tasks", "[TaskingStatistics]")
+{
+  initTaskingSystem(2);
+  resetStatistics();
+
+  std::atomic<int> count{0};
+  parallel_for(10000, [&](int) { count++; });
+  REQUIRE(count == 10000);
+
+  const TaskingStatistics stats = getStatistics();
+  if (!stats.enabled) {
+    // compiled out, or a backend which doesn't collect statistics
+    REQUIRE(stats.workers.empty());
+    return;
+  }
+
+  REQUIRE(stats.workers.size() == size_t(numTaskingThreads()));
+
+  const WorkerStatistics total = stats.total();
+  REQUIRE(total.tasksExecuted > 0);
+  REQUIRE(total.splits + total.pipeFullFallbacks > 0);
+
+  resetStatistics();
+  REQUIRE(getStatistics().total().tasksExecuted == 0);
+
+  traceStatistics();
+}
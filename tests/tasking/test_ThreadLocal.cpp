@@ -0,0 +1,78 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/ThreadLocal.h"
+#include "rkcommon/tasking/parallel_for.h"
+
+#include <thread>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::tasking;
+
+TEST_CASE("ThreadLocal sum", "[ThreadLocal]")
+{
+  const int N = 100000;
+
+  ThreadLocal<long> partials(0);
+  REQUIRE(partials.size() == 0);
+  REQUIRE(partials.combine([](long a, long b) { return a + b; }) == 0);
+
+  parallel_for(N, [&](int i) { partials.local() += i; });
+
+  REQUIRE(partials.size() >= 1);
+  REQUIRE(partials.combine([](long a, long b) { return a + b; }) ==
+          long(N) * (N - 1) / 2);
+
+  long sum = 0;
+  size_t instances = 0;
+  partials.for_each([&](long v) {
+    sum += v;
+    ++instances;
+  });
+  REQUIRE(instances == partials.size());
+  REQUIRE(sum == long(N) * (N - 1) / 2);
+
+  partials.clear();
+  REQUIRE(partials.size() == 0);
+}
+
+TEST_CASE("ThreadLocal lazy construction", "[ThreadLocal]")
+{
+  ThreadLocal<std::vector<int>> scratch(std::vector<int>(16, 7));
+
+  bool exists = true;
+  auto &v     = scratch.local(exists);
+  REQUIRE(!exists);
+  REQUIRE(v.size() == 16);
+  REQUIRE(v[0] == 7);
+
+  v.push_back(1);
+  REQUIRE(&scratch.local(exists) == &v);
+  REQUIRE(exists);
+  REQUIRE(scratch.local().size() == 17);
+}
+
+TEST_CASE("ThreadLocal with many threads", "[ThreadLocal]")
+{
+  ThreadLocal<int> counters;
+
+  // more threads than fit the first segment of slots
+  for (int round = 0; round < 2; ++round) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 20; ++t) {
+      threads.emplace_back([&]() {
+        for (int i = 0; i < 1000; ++i)
+          counters.local()++;
+      });
+    }
+    for (auto &t : threads)
+      t.join();
+  }
+
+  int total = 0;
+  counters.for_each([&](int c) { total += c; });
+  REQUIRE(total == 40 * 1000);
+}
@@ -13,3 +13,12 @@ TEST_CASE("async", "[async]")
   int retvalue = future.get();
   REQUIRE(retvalue == 1);
 }
+
+TEST_CASE("async with priorities", "[async]")
+{
+  using rkcommon::tasking::TaskPriority;
+
+  auto low  = async([=]() { return 1; }, TaskPriority::LOW);
+  auto high = async([=]() { return 2; }, TaskPriority::HIGH);
+  REQUIRE(low.get() + high.get() == 3);
+}
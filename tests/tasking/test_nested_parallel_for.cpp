@@ -0,0 +1,139 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/parallel_for.h"
+#include "rkcommon/tasking/parallel_reduce.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+using namespace rkcommon::tasking;
+
+TEST_CASE("nested parallel_for", "[nested_parallel_for]")
+{
+  const int OUTER = 64;
+  const int INNER = 10000;
+
+  std::vector<int> v(OUTER * INNER, 0);
+
+  parallel_for(OUTER, [&](int o) {
+    parallel_for(INNER, [&](int i) { v[o * INNER + i] += 1; });
+  });
+
+  REQUIRE(std::count(v.begin(), v.end(), 1) == OUTER * INNER);
+}
+
+TEST_CASE("three levels of nested parallel_for", "[nested_parallel_for]")
+{
+  const int N = 32;
+
+  std::vector<int> v(N * N * N, 0);
+
+  parallel_for(N, [&](int a) {
+    parallel_for(N, [&](int b) {
+      parallel_for(N, [&](int c) { v[(a * N + b) * N + c] += 1; });
+    });
+  });
+
+  REQUIRE(std::count(v.begin(), v.end(), 1) == N * N * N);
+}
+
+TEST_CASE("nested loops which cannot split", "[nested_parallel_for]")
+{
+  // many outer iterations, each with an inner loop of a single element
+  std::atomic<int> count{0};
+
+  parallel_for(10000, [&](int) {
+    parallel_for(1, [&](int) { count++; });
+    parallel_for(0, [&](int) { count += 1000; });
+  });
+
+  REQUIRE(count.load() == 10000);
+}
+
+TEST_CASE("nested parallel_for_range and parallel_reduce",
+          "[nested_parallel_for]")
+{
+  const int OUTER = 32;
+  const int INNER = 5000;
+
+  std::vector<long long> sums(OUTER, 0);
+
+  parallel_for(OUTER, [&](int o) {
+    std::vector<int> v(INNER, 0);
+    parallel_for_range(0, INNER, 16, [&](int b, int e) {
+      for (int i = b; i < e; ++i)
+        v[i] = o + i;
+    });
+    sums[o] = parallel_reduce(
+        INNER,
+        0ll,
+        [&](int i) { return (long long)v[i]; },
+        [](long long a, long long b) { return a + b; });
+  });
+
+  for (int o = 0; o < OUTER; ++o)
+    REQUIRE(sums[o] == (long long)o * INNER + (long long)INNER * (INNER - 1) / 2);
+}
+
+#ifdef RKCOMMON_TASKING_INTERNAL
+#include "rkcommon/tasking/detail/TaskSys.h"
+
+TEST_CASE("nesting depth", "[nested_parallel_for]")
+{
+  using namespace rkcommon::tasking::detail;
+
+  REQUIRE(enki::TaskScheduler::GetNestingDepth() == 0);
+
+  std::atomic<int> badOuter{0};
+  std::atomic<int> badInner{0};
+
+  parallel_for(64, [&](int) {
+    if (enki::TaskScheduler::GetNestingDepth() != 1)
+      badOuter++;
+    parallel_for(64, [&](int) {
+      // inner loops which are run inline stay at the outer depth
+      if (enki::TaskScheduler::GetNestingDepth() < 1)
+        badInner++;
+    });
+  });
+
+  REQUIRE(badOuter.load() == 0);
+  REQUIRE(badInner.load() == 0);
+  REQUIRE(enki::TaskScheduler::GetNestingDepth() == 0);
+}
+
+TEST_CASE("nested waits help first", "[nested_parallel_for]")
+{
+  using namespace rkcommon::tasking::detail;
+
+  for (bool workStealing : {false, true}) {
+    initTaskSystemInternal(4, workStealing);
+
+    // a thread waiting on its inner loop must not start another outer
+    // iteration on top of the one it is already in
+    static thread_local int activeOuter = 0;
+    std::atomic<int> maxActiveOuter{0};
+    std::atomic<int> sum{0};
+
+    parallel_for(256, [&](int) {
+      const int active = ++activeOuter;
+      int seen         = maxActiveOuter.load();
+      while (active > seen && !maxActiveOuter.compare_exchange_weak(seen, active))
+        ;
+
+      parallel_for(1000, [&](int) { sum++; });
+
+      --activeOuter;
+    });
+
+    REQUIRE(sum.load() == 256 * 1000);
+    REQUIRE(maxActiveOuter.load() == 1);
+  }
+
+  initTaskSystemInternal();
+}
+#endif
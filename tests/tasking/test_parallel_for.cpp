@@ -3,9 +3,11 @@
 
 #include "../catch.hpp"
 
+#include "rkcommon/tasking/TaskingStatistics.h"
 #include "rkcommon/tasking/parallel_for.h"
 
 #include <algorithm>
+#include <string>
 #include <vector>
 
 using rkcommon::tasking::parallel_for;
@@ -28,3 +30,161 @@ TEST_CASE("parallel_for", "[parallel_for]")
 
   REQUIRE(found == v.end());
 }
+
+TEST_CASE("parallel_for_range", "[parallel_for]")
+{
+  using rkcommon::tasking::parallel_for_range;
+
+  const size_t N_ELEMENTS = size_t(1e7);
+  const size_t GRAIN_SIZE = 1024;
+
+  std::vector<int> v(N_ELEMENTS, 0);
+
+  parallel_for_range(size_t(0), N_ELEMENTS, GRAIN_SIZE, [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i)
+      v[i] += 1;
+  });
+
+  REQUIRE(std::count(v.begin(), v.end(), 1) == ptrdiff_t(N_ELEMENTS));
+}
+
+TEST_CASE("parallel_for_range with offset", "[parallel_for]")
+{
+  using rkcommon::tasking::parallel_for_range;
+
+  const int BEGIN = 100;
+  const int END   = 10000;
+
+  std::vector<int> v(END, 0);
+
+  parallel_for_range(BEGIN, END, 7, [&](int b, int e) {
+    for (int i = b; i < e; ++i)
+      v[i] += 1;
+  });
+
+  REQUIRE(std::count(v.begin(), v.begin() + BEGIN, 0) == BEGIN);
+  REQUIRE(std::count(v.begin() + BEGIN, v.end(), 1) == END - BEGIN);
+}
+
+TEST_CASE("parallel_for with an AffinityHint", "[parallel_for]")
+{
+  using rkcommon::tasking::AffinityHint;
+  using rkcommon::tasking::parallel_in_blocks_of;
+
+  AffinityHint hint;
+  std::vector<int> v(100000, 0);
+
+  // the same loop repeated, then a different size and a reset hint
+  for (int iteration = 0; iteration < 10; ++iteration)
+    parallel_for(int(v.size()), hint, [&](int i) { v[i]++; });
+  REQUIRE(std::count(v.begin(), v.end(), 10) == int(v.size()));
+
+  parallel_for(int(v.size() / 2), hint, [&](int i) { v[i]++; });
+  REQUIRE(std::count(v.begin(), v.end(), 11) == int(v.size() / 2));
+
+  hint.reset();
+  parallel_for(0, hint, [&](int i) { v[i]++; });
+  parallel_for(1, hint, [&](int i) { v[i]++; });
+  REQUIRE(v[0] == 12);
+
+  std::vector<int> blocks(v.size(), 0);
+  for (int iteration = 0; iteration < 3; ++iteration) {
+    parallel_in_blocks_of<64>(int(blocks.size()), hint, [&](int b, int e) {
+      for (int i = b; i < e; ++i)
+        blocks[i]++;
+    });
+  }
+  REQUIRE(std::count(blocks.begin(), blocks.end(), 3) == int(blocks.size()));
+}
+
+TEST_CASE("parallel_for with a TuningSlot", "[parallel_for]")
+{
+  using namespace rkcommon::tasking;
+
+  static TuningSlot slot("test_parallel_for", std::chrono::microseconds(20));
+  REQUIRE(slot.numLoops() == 0);
+
+  std::vector<int> v(100000, 0);
+  for (int iteration = 0; iteration < 5; ++iteration)
+    parallel_for(int(v.size()), slot, [&](int i) { v[i]++; });
+  REQUIRE(std::count(v.begin(), v.end(), 5) == int(v.size()));
+
+  std::vector<int> ranges(v.size(), 0);
+  parallel_for_range(0, int(ranges.size()), slot, [&](int b, int e) {
+    for (int i = b; i < e; ++i)
+      ranges[i]++;
+  });
+  REQUIRE(std::count(ranges.begin(), ranges.end(), 1)
+          == int(ranges.size()));
+
+  const TaskingStatistics stats = getStatistics();
+  auto tuned = std::find_if(
+      stats.tunedLoops.begin(),
+      stats.tunedLoops.end(),
+      [](const TunedLoopStatistics &l) {
+        return std::string(l.name) == "test_parallel_for";
+      });
+  REQUIRE(tuned != stats.tunedLoops.end());
+
+#ifndef RKCOMMON_TASKING_TBB
+  // a cheap body is batched into large chunks
+  REQUIRE(tuned->loops == 6);
+  REQUIRE(tuned->nanosecondsPerIndex > 0.0);
+  REQUIRE(tuned->grainSize > 1);
+  REQUIRE(tuned->grainSize == slot.grainSize(v.size()));
+#endif
+
+  slot.reset();
+  REQUIRE(slot.lastGrainSize() == 0);
+}
+
+#ifdef RKCOMMON_TASKING_INTERNAL
+#include "rkcommon/tasking/detail/TaskSys.h"
+
+TEST_CASE("parallel_for work stealing", "[parallel_for]")
+{
+  using namespace rkcommon::tasking::detail;
+
+  // force a worker thread so ranges are actually stolen on small machines
+  initTaskSystemInternal(2, true);
+
+  const int N_ELEMENTS = 100000;
+
+  std::vector<int> v(N_ELEMENTS, 0);
+
+  // irregular per-index cost
+  parallel_for(N_ELEMENTS, [&](int taskIndex) {
+    int value = 1;
+    for (int i = 0; i < (taskIndex % 97) * (taskIndex % 13); ++i)
+      value = (value * 7 + i) % 5 + 1;
+    v[taskIndex] = value > 0 ? 1 : 0;
+  });
+
+  initTaskSystemInternal();
+
+  REQUIRE(std::count(v.begin(), v.end(), 1) == N_ELEMENTS);
+}
+
+TEST_CASE("parallel_for AffinityHint replay", "[parallel_for]")
+{
+  using namespace rkcommon::tasking::detail;
+  using rkcommon::tasking::AffinityHint;
+
+  initTaskSystemInternal(4);
+
+  AffinityHint hint;
+  std::vector<int> v(10000, 0);
+  for (int iteration = 0; iteration < 5; ++iteration)
+    parallel_for(int(v.size()), hint, [&](int i) { v[i]++; });
+  REQUIRE(std::count(v.begin(), v.end(), 5) == int(v.size()));
+
+  // every chunk has a recorded owner, one of the threads
+  const AffinityRecord &record = hint.internalRecord();
+  REQUIRE(record.numThreads == 4);
+  REQUIRE(record.numChunks() == 16);
+  for (uint32_t owner : record.owner)
+    REQUIRE(owner < 4);
+
+  initTaskSystemInternal();
+}
+#endif
@@ -0,0 +1,49 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/parallel_partition.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::tasking;
+
+TEST_CASE("parallel_partition", "[parallel_partition]")
+{
+  const size_t N = 100003;
+
+  std::vector<int> v(N);
+  for (size_t i = 0; i < N; ++i)
+    v[i] = int((i * 37) % 1001);
+
+  auto isSmall = [](int x) { return x < 300; };
+
+  std::vector<int> expected = v;
+  const auto expectedSplit =
+      std::stable_partition(expected.begin(), expected.end(), isSmall);
+
+  const auto split = parallel_partition<1024>(v.begin(), v.end(), isSmall);
+
+  REQUIRE(split - v.begin() == expectedSplit - expected.begin());
+  REQUIRE(v == expected);
+}
+
+TEST_CASE("parallel_partition small and degenerate", "[parallel_partition]")
+{
+  std::vector<int> v = {5, 1, 4, 2, 3};
+
+  auto split = parallel_partition(v, [](int x) { return x % 2 == 0; });
+  REQUIRE(split - v.begin() == 2);
+  REQUIRE(v == std::vector<int>({4, 2, 5, 1, 3}));
+
+  std::vector<int> all(10000, 1);
+  REQUIRE(parallel_partition<64>(all, [](int) { return true; }) == all.end());
+  REQUIRE(parallel_partition<64>(all, [](int) { return false; }) ==
+          all.begin());
+
+  std::vector<int> empty;
+  REQUIRE(parallel_partition(empty, [](int) { return true; }) == empty.end());
+}
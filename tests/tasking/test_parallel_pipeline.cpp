@@ -0,0 +1,119 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/parallel_pipeline.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace rkcommon::tasking;
+
+TEST_CASE("parallel_pipeline keeps the order of serial in-order stages",
+          "[parallel_pipeline]")
+{
+  initTaskingSystem();
+
+  const int N_ITEMS = 1000;
+  const size_t MAX_TOKENS = 8;
+
+  int next = 0;
+  std::atomic<int> inFlight{0};
+  std::atomic<int> maxInFlight{0};
+  std::vector<int> written;
+
+  auto statistics = parallel_pipeline(
+      MAX_TOKENS,
+      makePipelineStage<void, int>(
+          StageMode::SERIAL_IN_ORDER,
+          [&](PipelineControl &control) {
+            if (next == N_ITEMS) {
+              control.stop();
+              return 0;
+            }
+            const int n = ++inFlight;
+            int seen    = maxInFlight;
+            while (n > seen && !maxInFlight.compare_exchange_weak(seen, n))
+              ;
+            return next++;
+          },
+          "read"),
+      makePipelineStage<int, long>(
+          StageMode::PARALLEL,
+          [](int i) { return long(i) * long(i); },
+          "square"),
+      makePipelineStage<long, void>(
+          StageMode::SERIAL_IN_ORDER,
+          [&](long v) {
+            written.push_back(int(v));
+            inFlight--;
+          },
+          "write"));
+
+  REQUIRE(written.size() == size_t(N_ITEMS));
+  for (int i = 0; i < N_ITEMS; ++i)
+    REQUIRE(written[i] == i * i);
+  REQUIRE(maxInFlight <= int(MAX_TOKENS));
+
+  REQUIRE(statistics.stages.size() == 3);
+  REQUIRE(std::string(statistics.stages[1].name) == "square");
+  for (const auto &stage : statistics.stages)
+    REQUIRE(stage.items == size_t(N_ITEMS));
+}
+
+TEST_CASE("parallel_pipeline with serial out-of-order and move-only items",
+          "[parallel_pipeline]")
+{
+  const int N_ITEMS = 500;
+
+  int next = 0;
+  int running = 0;
+  bool overlapped = false;
+  std::vector<int> seen(N_ITEMS, 0);
+
+  parallel_pipeline(
+      3,
+      makePipelineStage<void, std::unique_ptr<int>>(
+          StageMode::SERIAL_IN_ORDER,
+          [&](PipelineControl &control) {
+            if (next == N_ITEMS)
+              control.stop();
+            return std::unique_ptr<int>(new int(next++));
+          }),
+      makePipelineStage<std::unique_ptr<int>, std::unique_ptr<int>>(
+          StageMode::SERIAL_OUT_OF_ORDER,
+          [&](std::unique_ptr<int> v) {
+            // serial: never two items in here at once
+            if (++running > 1)
+              overlapped = true;
+            seen[*v]++;
+            running--;
+            return v;
+          }),
+      makePipelineStage<std::unique_ptr<int>, void>(
+          StageMode::PARALLEL, [](std::unique_ptr<int> v) { REQUIRE(v); }));
+
+  REQUIRE(!overlapped);
+  for (int count : seen)
+    REQUIRE(count == 1);
+}
+
+TEST_CASE("parallel_pipeline which stops at once", "[parallel_pipeline]")
+{
+  int consumed = 0;
+  auto statistics = parallel_pipeline(
+      4,
+      makePipelineStage<void, int>(StageMode::SERIAL_IN_ORDER,
+                                   [](PipelineControl &control) {
+                                     control.stop();
+                                     return 0;
+                                   }),
+      makePipelineStage<int, void>(StageMode::SERIAL_IN_ORDER,
+                                   [&](int) { consumed++; }));
+
+  REQUIRE(consumed == 0);
+  REQUIRE(statistics.stages[0].items == 0);
+}
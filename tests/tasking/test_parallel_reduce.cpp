@@ -0,0 +1,104 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/range.h"
+#include "rkcommon/tasking/parallel_reduce.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+
+#include <algorithm>
+#include <vector>
+
+using rkcommon::tasking::parallel_reduce;
+
+TEST_CASE("parallel_reduce sum", "[parallel_reduce]")
+{
+  const size_t N_ELEMENTS = size_t(1e7);
+
+  std::vector<int> v(N_ELEMENTS, 1);
+
+  const size_t sum = parallel_reduce(
+      N_ELEMENTS,
+      size_t(0),
+      [&](size_t taskIndex) { return size_t(v[taskIndex]); },
+      [](size_t a, size_t b) { return a + b; });
+
+  REQUIRE(sum == N_ELEMENTS);
+}
+
+TEST_CASE("parallel_reduce range", "[parallel_reduce]")
+{
+  using rkcommon::math::range1i;
+
+  const int N_ELEMENTS = 100000;
+
+  const range1i r = parallel_reduce(
+      N_ELEMENTS,
+      range1i(),
+      [&](int taskIndex) { return range1i(taskIndex - N_ELEMENTS / 2); },
+      [](range1i a, const range1i &b) {
+        a.extend(b);
+        return a;
+      });
+
+  REQUIRE(r.lower == -N_ELEMENTS / 2);
+  REQUIRE(r.upper == N_ELEMENTS / 2 - 1);
+}
+
+TEST_CASE("parallel_reduce empty", "[parallel_reduce]")
+{
+  const int result = parallel_reduce(
+      0, 0, [](int) { return 1; }, [](int a, int b) { return a + b; });
+
+  REQUIRE(result == 0);
+}
+
+TEST_CASE("parallel_reduce_deterministic", "[parallel_reduce]")
+{
+  using rkcommon::tasking::initTaskingSystem;
+  using rkcommon::tasking::parallel_reduce_deterministic;
+
+  // magnitudes far apart, so the grouping of the sum shows in the result
+  const int N_ELEMENTS = 1000000;
+  std::vector<float> v(N_ELEMENTS);
+  for (int i = 0; i < N_ELEMENTS; ++i)
+    v[i] = (i % 7 == 0 ? 1e7f : 1e-3f) * (i % 2 ? 1.f : -0.999f);
+
+  auto sum = [&]() {
+    return parallel_reduce_deterministic<256>(
+        N_ELEMENTS,
+        0.f,
+        [&](int i) { return v[i]; },
+        [](float a, float b) { return a + b; });
+  };
+
+  // the fixed tree, computed serially
+  std::vector<float> blocks;
+  for (int b = 0; b < N_ELEMENTS; b += 256) {
+    float acc = 0.f;
+    for (int i = b; i < std::min(b + 256, N_ELEMENTS); ++i)
+      acc += v[i];
+    blocks.push_back(acc);
+  }
+  for (size_t w = 1; w < blocks.size(); w *= 2)
+    for (size_t i = 0; i + w < blocks.size(); i += 2 * w)
+      blocks[i] += blocks[i + w];
+  const float expected = blocks[0];
+
+  for (int numThreads : {1, 2, 4, -1}) {
+    initTaskingSystem(numThreads);
+    for (int run = 0; run < 3; ++run)
+      REQUIRE(sum() == expected);
+  }
+
+  REQUIRE(parallel_reduce_deterministic(
+              0, 5, [](int) { return 1; }, [](int a, int b) { return a + b; })
+          == 5);
+  REQUIRE(parallel_reduce_deterministic<3>(
+              size_t(10),
+              size_t(0),
+              [](size_t i) { return i; },
+              [](size_t a, size_t b) { return a + b; })
+          == 45);
+}
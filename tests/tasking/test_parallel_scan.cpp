@@ -0,0 +1,96 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/parallel_scan.h"
+
+#include <numeric>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::tasking;
+
+TEST_CASE("parallel_exclusive_scan", "[parallel_scan]")
+{
+  const size_t N = 100003;
+
+  std::vector<int> in(N);
+  for (size_t i = 0; i < N; ++i)
+    in[i] = int(i % 7);
+
+  std::vector<int> out(N);
+  const int total = parallel_exclusive_scan<1024>(in.data(), out.data(), N);
+
+  int expected = 0;
+  for (size_t i = 0; i < N; ++i) {
+    REQUIRE(out[i] == expected);
+    expected += in[i];
+  }
+  REQUIRE(total == expected);
+
+  // in-place
+  parallel_exclusive_scan<1024>(in.data(), in.data(), N);
+  REQUIRE(in == out);
+}
+
+TEST_CASE("parallel_inclusive_scan", "[parallel_scan]")
+{
+  const size_t N = 50000;
+
+  std::vector<long> in(N, 2);
+  std::vector<long> out(N);
+
+  const long total = parallel_inclusive_scan<333>(in.data(), out.data(), N, 0l);
+
+  for (size_t i = 0; i < N; ++i)
+    REQUIRE(out[i] == long(2 * (i + 1)));
+  REQUIRE(total == long(2 * N));
+}
+
+TEST_CASE("parallel_inclusive_scan max", "[parallel_scan]")
+{
+  std::vector<int> in = {3, 1, 4, 1, 5, 9, 2, 6};
+  std::vector<int> out(in.size());
+
+  parallel_inclusive_scan<3>(in.data(),
+      out.data(),
+      in.size(),
+      0,
+      [](int a, int b) { return std::max(a, b); });
+
+  REQUIRE(out == std::vector<int>({3, 3, 4, 4, 5, 9, 9, 9}));
+}
+
+TEST_CASE("parallel_compact", "[parallel_scan]")
+{
+  const size_t N = 20000;
+
+  std::vector<int> in(N);
+  std::iota(in.begin(), in.end(), 0);
+
+  containers::AlignedVector<int> out;
+  parallel_compact<512>(
+      in.data(), N, out, [](int v) { return v % 3 == 0; });
+
+  REQUIRE(out.size() == (N + 2) / 3);
+  for (size_t i = 0; i < out.size(); ++i)
+    REQUIRE(out[i] == int(3 * i));
+
+  containers::AlignedVector<size_t> indices;
+  parallel_compact_indices<512>(N, indices, [&](size_t i) { return in[i] % 5 == 1; });
+
+  REQUIRE(indices.size() == N / 5);
+  for (size_t i = 0; i < indices.size(); ++i)
+    REQUIRE(indices[i] == 5 * i + 1);
+}
+
+TEST_CASE("parallel_scan empty", "[parallel_scan]")
+{
+  int dummy = 0;
+  REQUIRE(parallel_exclusive_scan(&dummy, &dummy, 0) == 0);
+
+  containers::AlignedVector<int> out(3);
+  parallel_compact(&dummy, 0, out, [](int) { return true; });
+  REQUIRE(out.empty());
+}
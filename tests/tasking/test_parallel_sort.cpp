@@ -0,0 +1,89 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/parallel_sort.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::tasking;
+
+TEST_CASE("parallel_sort", "[parallel_sort]")
+{
+  // sizes below, at and well above the serial cutoff, and an odd run count
+  for (size_t N : {size_t(0), size_t(1), size_t(1000), size_t(100003),
+                   size_t(16384 * 5 + 7)}) {
+    std::mt19937 rng(static_cast<unsigned>(N));
+    std::vector<int> v(N);
+    for (auto &x : v)
+      x = int(rng() % 1000);  // many duplicates
+
+    std::vector<int> expected = v;
+    std::sort(expected.begin(), expected.end());
+
+    parallel_sort(v);
+    REQUIRE(v == expected);
+  }
+}
+
+TEST_CASE("parallel_sort with comparator", "[parallel_sort]")
+{
+  const size_t N = 200000;
+
+  std::vector<float> v(N);
+  for (size_t i = 0; i < N; ++i)
+    v[i] = float((i * 7919) % N);
+
+  parallel_sort(v.begin(), v.end(), std::greater<float>());
+
+  REQUIRE(v.front() == float(N - 1));
+  REQUIRE(std::is_sorted(v.begin(), v.end(), std::greater<float>()));
+}
+
+TEST_CASE("parallel_radix_sort", "[parallel_sort]")
+{
+  const size_t N = 300001;
+
+  std::mt19937_64 rng(42);
+  std::vector<uint64_t> keys(N);
+  std::vector<uint32_t> values(N);
+  for (size_t i = 0; i < N; ++i) {
+    keys[i]   = rng() >> 20;  // leave the top digits constant
+    values[i] = uint32_t(i);
+  }
+  // a few equal keys to check stability
+  keys[10] = keys[20] = keys[30] = 5;
+
+  const std::vector<uint64_t> originalKeys = keys;
+
+  parallel_radix_sort(keys.data(), values.data(), N);
+
+  REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+  for (size_t i = 0; i < N; ++i)
+    REQUIRE(originalKeys[values[i]] == keys[i]);
+  for (size_t i = 1; i < N; ++i) {
+    if (keys[i - 1] == keys[i])
+      REQUIRE(values[i - 1] < values[i]);
+  }
+}
+
+TEST_CASE("parallel_radix_sort keys only", "[parallel_sort]")
+{
+  for (size_t N : {size_t(0), size_t(1), size_t(77), size_t(70000)}) {
+    std::vector<uint32_t> keys(N);
+    for (size_t i = 0; i < N; ++i)
+      keys[i] = uint32_t((N - i) * 2654435761u);
+
+    std::vector<uint32_t> expected = keys;
+    std::sort(expected.begin(), expected.end());
+
+    parallel_radix_sort(keys.data(), N);
+    REQUIRE(keys == expected);
+  }
+}
@@ -22,3 +22,93 @@ TEST_CASE("schedule", "[schedule]")
 
   REQUIRE(val.load() == 1);
 }
+
+TEST_CASE("schedule many small and large tasks", "[schedule]")
+{
+  const int N_TASKS = 10000;
+
+  // larger than a task's inline functor storage
+  struct LargeCapture
+  {
+    char data[256];
+  };
+
+  std::atomic<int> count{0};
+  auto *count_p = &count;
+
+  LargeCapture large{};
+  large.data[0] = 1;
+
+  for (int i = 0; i < N_TASKS; ++i) {
+    if (i % 2)
+      schedule([=]() { (*count_p)++; });
+    else
+      schedule([=]() { *count_p += large.data[0]; });
+  }
+
+  while (count.load() != N_TASKS)
+    ;
+
+  REQUIRE(count.load() == N_TASKS);
+}
+
+TEST_CASE("schedule with priorities", "[schedule]")
+{
+  using rkcommon::tasking::TaskPriority;
+
+  std::atomic<int> count{0};
+  auto *count_p = &count;
+
+  for (int i = 0; i < 100; ++i) {
+    schedule([=]() { (*count_p)++; }, TaskPriority::LOW);
+    schedule([=]() { (*count_p)++; }, TaskPriority::NORMAL);
+    schedule([=]() { (*count_p)++; }, TaskPriority::HIGH);
+  }
+
+  while (count.load() != 300)
+    ;
+
+  REQUIRE(count.load() == 300);
+}
+
+#ifdef RKCOMMON_TASKING_INTERNAL
+#include "rkcommon/tasking/detail/TaskSys.h"
+
+#include <vector>
+
+TEST_CASE("enkiTS runs higher priorities first", "[TaskPriority]")
+{
+  struct RecordingTask : public enki::ITaskSet
+  {
+    RecordingTask(std::vector<int> &order, int id) : order(order), id(id) {}
+    void ExecuteRange(enki::TaskSetPartition, uint32_t) override
+    {
+      order.push_back(id);
+    }
+    std::vector<int> &order;
+    int id;
+  };
+
+  // a single thread: nothing runs until this thread waits
+  enki::TaskScheduler ts;
+  ts.Initialize(1);
+
+  std::vector<int> order;
+  RecordingTask low(order, 2), med(order, 1), high(order, 0);
+  low.m_Priority  = enki::TASK_PRIORITY_LOW;
+  med.m_Priority  = enki::TASK_PRIORITY_MED;
+  high.m_Priority = enki::TASK_PRIORITY_HIGH;
+
+  ts.AddTaskSetToPipe(&low);
+  ts.AddTaskSetToPipe(&med);
+  ts.AddTaskSetToPipe(&high);
+
+  // waiting for a normal priority task leaves low priority work alone
+  ts.WaitforTask(&med);
+  REQUIRE(order == std::vector<int>({0, 1}));
+  REQUIRE(!low.GetIsComplete());
+
+  ts.WaitforAll();
+  REQUIRE(order == std::vector<int>({0, 1, 2}));
+}
+#endif
@@ -0,0 +1,70 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/schedule.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace rkcommon::tasking;
+
+TEST_CASE("schedule_on_thread main thread", "[schedule_on_thread]")
+{
+  initTaskingSystem(2);
+
+  std::vector<int> order;
+  for (int i = 0; i < 10; ++i)
+    schedule_on_thread(0, [&order, i]() { order.push_back(i); });
+
+  const auto caller = std::this_thread::get_id();
+  std::thread::id ranOn;
+  schedule_on_thread(0, [&]() { ranOn = std::this_thread::get_id(); });
+
+  runPinnedTasks();
+
+  REQUIRE(order == std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+  REQUIRE(ranOn == caller);
+
+  REQUIRE_THROWS_AS(
+      schedule_on_thread(uint32_t(numTaskingThreads()), []() {}),
+      std::runtime_error);
+}
+
+TEST_CASE("schedule_on_thread worker thread", "[schedule_on_thread]")
+{
+  initTaskingSystem(2);
+
+  if (numTaskingThreads() < 2)
+    return;
+
+  const int N = 100;
+  std::atomic<int> ran{0};
+  std::mutex mutex;
+  std::vector<std::thread::id> threads;
+
+  for (int i = 0; i < N; ++i) {
+    schedule_on_thread(1, [&]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.push_back(std::this_thread::get_id());
+      ran++;
+    });
+  }
+
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (ran.load() != N && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::yield();
+
+  REQUIRE(ran.load() == N);
+  for (const auto &id : threads) {
+    REQUIRE(id == threads.front());
+    REQUIRE(id != std::this_thread::get_id());
+  }
+}
@@ -0,0 +1,240 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/parallel_for.h"
+#include "rkcommon/tasking/parallel_for_tiled.h"
+#include "rkcommon/tasking/parallel_reduce.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+using namespace rkcommon::tasking;
+
+TEST_CASE("NUMA queries", "[tasking_system_init]")
+{
+  const int numNodes = numNumaNodes();
+  REQUIRE(numNodes >= 1);
+  REQUIRE(currentNumaNode() >= 0);
+}
+
+TEST_CASE("core type queries", "[tasking_system_init]")
+{
+  if (hasHybridCores())
+    REQUIRE(currentCoreType() != CoreType::UNKNOWN);
+
+  AffinitySettings affinity;
+  affinity.policy = AffinityPolicy::PERFORMANCE_FIRST;
+  initTaskingSystem(2, false, affinity);
+
+  // the initializing thread is never pinned
+  REQUIRE(workerCoreType(0) == CoreType::UNKNOWN);
+  if (numTaskingThreads() > 1) {
+    REQUIRE(workerCoreType(1)
+            == (hasHybridCores() ? CoreType::PERFORMANCE
+                                 : CoreType::UNKNOWN));
+  }
+
+  initTaskingSystem();
+  REQUIRE(workerCoreType(1) == CoreType::UNKNOWN);
+}
+
+TEST_CASE("initTaskingSystem with affinity", "[tasking_system_init]")
+{
+  const AffinityPolicy policies[] = {AffinityPolicy::COMPACT,
+                                     AffinityPolicy::SCATTER,
+                                     AffinityPolicy::EXPLICIT,
+                                     AffinityPolicy::NUMA_NODES,
+                                     AffinityPolicy::PERFORMANCE_FIRST};
+
+  for (auto policy : policies) {
+    AffinitySettings affinity;
+    affinity.policy = policy;
+    affinity.cores  = {0};
+
+    initTaskingSystem(2, false, affinity);
+
+    std::vector<int> v(10000, 0);
+    parallel_for(int(v.size()), [&](int i) { v[i] = 1; });
+
+    REQUIRE(std::count(v.begin(), v.end(), 1) == int(v.size()));
+  }
+
+  initTaskingSystem();
+}
+
+TEST_CASE("initTaskingSystem with a backend", "[tasking_system_init]")
+{
+  const TaskingBackend initial = currentTaskingBackend();
+  REQUIRE(isTaskingBackendAvailable(initial));
+
+  const TaskingBackend backends[] = {TaskingBackend::TBB,
+                                     TaskingBackend::OPENMP,
+                                     TaskingBackend::INTERNAL,
+                                     TaskingBackend::SERIAL};
+
+  for (auto backend : backends) {
+    if (!isTaskingBackendAvailable(backend)) {
+      REQUIRE_THROWS_AS(initTaskingSystem(backend, 2), std::runtime_error);
+      REQUIRE(currentTaskingBackend() == initial);
+      continue;
+    }
+
+    initTaskingSystem(backend, 2);
+    REQUIRE(currentTaskingBackend() == backend);
+
+    std::vector<int> v(10000, 0);
+    parallel_for(int(v.size()), [&](int i) { v[i]++; });
+    REQUIRE(std::count(v.begin(), v.end(), 1) == int(v.size()));
+
+    const int sum = parallel_reduce(
+        int(v.size()),
+        0,
+        [&](int i) { return v[i]; },
+        [](int a, int b) { return a + b; });
+    REQUIRE(sum == int(v.size()));
+  }
+
+  initTaskingSystem(initial);
+}
+
+TEST_CASE("initTaskingSystem with a wait policy", "[tasking_system_init]")
+{
+  WaitPolicy hybrid;
+  hybrid.spinIterations  = 1000;
+  hybrid.yieldIterations = 100;
+
+  WaitPolicy hot;
+  hot.alwaysHot = true;
+
+  for (const auto &policy : {hybrid, hot, WaitPolicy()}) {
+    initTaskingSystem(currentTaskingBackend(), 2, false, {}, policy);
+
+    // repeated short loops with idle gaps, as in interactive rendering
+    for (int frame = 0; frame < 10; ++frame) {
+      std::vector<int> v(1000, 0);
+      parallel_for(int(v.size()), [&](int i) { v[i] = 1; });
+      REQUIRE(std::count(v.begin(), v.end(), 1) == int(v.size()));
+    }
+  }
+
+  initTaskingSystem();
+}
+
+static thread_local int t_initializedIndex = -1;
+
+TEST_CASE("initTaskingSystem with worker init hooks", "[tasking_system_init]")
+{
+#if defined(__x86_64__) || defined(_M_X64)
+  const unsigned int csr = _mm_getcsr();
+#endif
+
+  std::atomic<int> numInits{0};
+  const int hook = addWorkerInitHook([&](int index) {
+    t_initializedIndex = index;
+    numInits++;
+  });
+
+  initTaskingSystem(4, true);
+  REQUIRE(t_initializedIndex == 0);
+
+  // every thread running tasks was initialized before its first task
+  std::atomic<int> numUninitialized{0};
+  std::atomic<int> numDenormal{0};
+  parallel_for(10000, [&](int) {
+    if (t_initializedIndex < 0)
+      numUninitialized++;
+#if defined(__x86_64__) || defined(_M_X64)
+    const unsigned int ftzDaz = 0x8040;
+    if ((_mm_getcsr() & ftzDaz) != ftzDaz)
+      numDenormal++;
+#endif
+  });
+  // tiled loops as well
+  using rkcommon::math::box3i;
+  using rkcommon::math::vec3i;
+  parallel_for_tiled(vec3i(0), vec3i(64), vec3i(8), [&](const box3i &) {
+#if defined(__x86_64__) || defined(_M_X64)
+    const unsigned int ftzDaz = 0x8040;
+    if ((_mm_getcsr() & ftzDaz) != ftzDaz)
+      numDenormal++;
+#endif
+  });
+  REQUIRE(numUninitialized == 0);
+  REQUIRE(numDenormal == 0);
+  REQUIRE(numInits >= 1);
+  REQUIRE(numInits <= numTaskingThreads());
+
+  // removed hooks don't run with the next initialization
+  removeWorkerInitHook(hook);
+  initTaskingSystem();
+  const int numBefore = numInits;
+  parallel_for(1000, [](int) {});
+  REQUIRE(numInits == numBefore);
+
+#if defined(__x86_64__) || defined(_M_X64)
+  _mm_setcsr(csr);
+#endif
+}
+
+TEST_CASE("setActiveThreads", "[tasking_system_init]")
+{
+  initTaskingSystem(4);
+  const int numThreads = numTaskingThreads();
+
+  setActiveThreads(2);
+  REQUIRE(numTaskingThreads() == numThreads);
+  REQUIRE(activeTaskingThreads() == std::min(2, numThreads));
+
+  // let spinning workers notice
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  std::vector<int> v(100000, 0);
+  parallel_for(int(v.size()), [&](int i) {
+    v[i] = 1;
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.insert(std::this_thread::get_id());
+  });
+  REQUIRE(std::count(v.begin(), v.end(), 1) == int(v.size()));
+  if (currentTaskingBackend() == TaskingBackend::INTERNAL)
+    REQUIRE(threads.size() <= 2);
+
+  setActiveThreads(0);
+  REQUIRE(activeTaskingThreads() == numThreads);
+
+  // resizing while loops run keeps their work
+  std::atomic<bool> done{false};
+  std::thread resizer([&]() {
+    for (int n = 1; !done; n = n % 4 + 1) {
+      setActiveThreads(n);
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+  bool complete = true;
+  for (int loop = 0; loop < 100; ++loop) {
+    const int sum = parallel_reduce(
+        int(v.size()),
+        0,
+        [&](int i) { return v[i]; },
+        [](int a, int b) { return a + b; });
+    complete &= sum == int(v.size());
+  }
+  done = true;
+  resizer.join();
+  REQUIRE(complete);
+
+  initTaskingSystem();
+}
@@ -0,0 +1,71 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// the tasking headers trace their tasks in this file
+#define RKCOMMON_ENABLE_PROFILING
+
+#include "../catch.hpp"
+
+#include "rkcommon/tasking/AsyncTask.h"
+#include "rkcommon/tasking/parallel_for.h"
+#include "rkcommon/tasking/schedule.h"
+#include "rkcommon/tasking/tasking_system_init.h"
+#include "rkcommon/tracing/Tracing.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <string>
+
+using namespace rkcommon::tasking;
+using namespace rkcommon::tracing;
+
+static size_t countOf(const std::string &text, const std::string &pattern)
+{
+  size_t count = 0;
+  for (size_t i = text.find(pattern); i != std::string::npos;
+       i       = text.find(pattern, i + 1))
+    count++;
+  return count;
+}
+
+TEST_CASE("Tasks are traced on their workers", "[TaskTracing]")
+{
+  const char *jsonFile = "test_TaskTracing.json";
+  initTaskingSystem(4);
+
+  beginEvent("tracedFrame", "test");
+  CHECK(std::string(currentRegion()) == "tracedFrame");
+
+  std::atomic<int> count{0};
+  parallel_for(1000, [&](int) { count++; });
+  CHECK(count == 1000);
+
+  std::promise<void> scheduled;
+  schedule([&]() { scheduled.set_value(); });
+  scheduled.get_future().wait();
+
+  AsyncTask<int> task([]() { return 42; });
+  CHECK(task.get() == 42);
+  endEvent();
+  CHECK(currentRegion() == nullptr);
+
+  saveLog(jsonFile, "test_TaskTracing");
+  std::ifstream file(jsonFile);
+  const std::string json((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+
+  // the frame, and at least one chunk of the loop plus the two tasks
+  CHECK(countOf(json, "\"name\":\"tracedFrame\"") >= 4);
+  CHECK(countOf(json, "\"cat\":\"tasking\"") >= 3);
+  // a flow from the frame to each call
+  CHECK(countOf(json, "\"ph\": \"s\"") == 3);
+  CHECK(countOf(json, "\"ph\": \"f\"") == 3);
+  CHECK(countOf(json, "\"name\":\"parallel_for\",\"cat\":\"flow\"") == 2);
+  CHECK(countOf(json, "\"name\":\"schedule\",\"cat\":\"flow\"") == 2);
+  CHECK(countOf(json, "\"name\":\"async\",\"cat\":\"flow\"") == 2);
+
+  std::remove(jsonFile);
+}
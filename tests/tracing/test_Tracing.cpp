@@ -0,0 +1,540 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+// for RKCOMMON_TRACE_SCOPE
+#define RKCOMMON_ENABLE_PROFILING
+#include "rkcommon/tracing/Tracing.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace rkcommon::tracing;
+
+static std::string readFile(const char *fileName)
+{
+  std::ifstream file(fileName, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+static size_t countOf(const std::string &text, const std::string &pattern)
+{
+  size_t count = 0;
+  for (size_t i = text.find(pattern); i != std::string::npos;
+       i       = text.find(pattern, i + 1))
+    count++;
+  return count;
+}
+
+// The "ts" of the event at 'pos' in Chrome JSON, in microseconds
+static long long timestampAt(const std::string &json, size_t pos)
+{
+  const size_t ts = json.rfind("\"ts\":", pos);
+  return std::atoll(json.c_str() + ts + 5);
+}
+
+// Stream out the events which earlier test cases left in memory, e.g. on
+// tasking threads, so that a trace holds only the events of its test case
+static void discardHeldEvents()
+{
+  const char *scratchFile = "test_Tracing_discarded.bin";
+  startTraceStream(scratchFile, "discarded", 1);
+  stopTraceStream();
+  std::remove(scratchFile);
+}
+
+TEST_CASE("Binary trace streams", "[Tracing]")
+{
+  const char *traceFile = "test_Tracing.bin";
+  const char *jsonFile  = "test_Tracing.json";
+  const int numEvents   = 20000;
+
+  discardHeldEvents();
+  startTraceStream(traceFile, "test_Tracing", 1);
+  // several chunks of events, of which the stream recycles the written ones
+  std::thread worker([&]() {
+    setThreadName("worker");
+    for (int i = 0; i < numEvents; i++) {
+      beginEvent("work", "test");
+      setCounter("iteration", i);
+      endEvent();
+    }
+  });
+  worker.join();
+  stopTraceStream();
+
+  convertTraceToJson(traceFile, jsonFile);
+  std::string json = readFile(jsonFile);
+  CHECK(json.front() == '[');
+  CHECK(json.back() == ']');
+  CHECK(countOf(json, "\"name\":\"work\"") == size_t(numEvents));
+  CHECK(countOf(json, "\"name\":\"iteration\"") == size_t(numEvents));
+  CHECK(countOf(json, "\"ph\": \"E\"") == size_t(numEvents));
+  CHECK(countOf(json, "\"args\":{\"name\":\"worker\"}") == 1);
+  CHECK(countOf(json, "\"args\":{\"name\":\"test_Tracing\"}") == 1);
+
+  // a trace cut short by a crash converts up to the partial record
+  const std::string trace = readFile(traceFile);
+  std::ofstream(traceFile, std::ios::binary)
+      .write(trace.data(), trace.size() / 2);
+  convertTraceToJson(traceFile, jsonFile);
+  json = readFile(jsonFile);
+  CHECK(json.back() == ']');
+  const size_t partial = countOf(json, "\"name\":\"work\"");
+  CHECK(partial > 0);
+  CHECK(partial < size_t(numEvents));
+
+  CHECK_THROWS(convertTraceToJson(jsonFile, jsonFile));
+
+  std::remove(traceFile);
+  std::remove(jsonFile);
+}
+
+TEST_CASE("CPU time sampling and timestamps", "[Tracing]")
+{
+  const char *traceFile = "test_Tracing_sampling.bin";
+  const char *jsonFile  = "test_Tracing_sampling.json";
+
+  startTraceStream(traceFile, "test_Tracing", 1);
+  std::thread worker([&]() {
+    setCpuTimeSampling(0);
+    for (int i = 0; i < 100; i++) {
+      beginEvent("unsampled", "test");
+      endEvent();
+    }
+    setCpuTimeSampling(10);
+    for (int i = 0; i < 100; i++) {
+      beginEvent("sampled", "test");
+      endEvent();
+    }
+    setCpuTimeSampling(0);
+    recordCpuTime();
+    beginEvent("sleep", "test");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    recordCpuTime();
+    endEvent();
+    setCpuTimeSampling(1);
+  });
+  worker.join();
+  stopTraceStream();
+
+  convertTraceToJson(traceFile, jsonFile);
+  const std::string json = readFile(jsonFile);
+  CHECK(countOf(json, "\"ph\": \"E\"") == 201);
+#ifdef __linux__
+  CHECK(countOf(json, "\"args\":{\"cpuUtilization\":") == 11);
+#else
+  CHECK(countOf(json, "\"args\":{\"cpuUtilization\":") == 0);
+#endif
+
+  // the calibrated timestamps measure the sleep
+  const size_t begin = json.find("\"name\":\"sleep\"");
+  REQUIRE(begin != std::string::npos);
+  const size_t end = json.find("\"ph\": \"E\"", begin);
+  REQUIRE(end != std::string::npos);
+  const long long duration =
+      timestampAt(json, json.find("\"name\"", end)) - timestampAt(json, begin);
+  CHECK(duration >= 19000);
+  CHECK(duration < 200000);
+
+  std::remove(traceFile);
+  std::remove(jsonFile);
+}
+
+TEST_CASE("Flight recorder", "[Tracing]")
+{
+  const char *jsonFile = "test_Tracing_recent.json";
+  const int numEvents  = 100000;
+  const int keep       = 10000;
+
+  discardHeldEvents();
+  startFlightRecorder(keep);
+  CHECK_THROWS(startTraceStream("test_Tracing_recent.bin", "test", 1));
+  std::thread worker([&]() {
+    // three events per iteration
+    setCpuTimeSampling(0);
+    for (int i = 0; i < numEvents; i++) {
+      beginEvent("recent", "test");
+      setCounter("recentIteration", i);
+      endEvent();
+    }
+    // dumped while still running
+    beginEvent("running", "test");
+    dumpRecent(jsonFile, "test_Tracing");
+    endEvent();
+    setCpuTimeSampling(1);
+  });
+  worker.join();
+  stopFlightRecorder();
+
+  // the last events of the thread, from a begin on
+  const std::string json = readFile(jsonFile);
+  CHECK(json.back() == ']');
+  const size_t begins = countOf(json, "\"name\":\"recent\"");
+  CHECK(3 * begins >= size_t(keep) - 3);
+  CHECK(3 * begins < size_t(keep + 2 * 4096));
+  CHECK(countOf(json, "\"value\":" + std::to_string(numEvents - 1)) == 1);
+  CHECK(countOf(json, "\"value\":0}") == 0);
+  CHECK(countOf(json, "\"name\":\"running\"") == 1);
+
+  std::remove(jsonFile);
+}
+
+TEST_CASE("Memory sampler", "[Tracing]")
+{
+  const char *traceFile = "test_Tracing_memory.bin";
+  const char *jsonFile  = "test_Tracing_memory.json";
+
+  startTraceStream(traceFile, "test_Tracing", 1);
+  startMemorySampler(1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // restarting replaces the sampler thread
+  startMemorySampler(1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  stopMemorySampler();
+  stopMemorySampler();
+  stopTraceStream();
+
+  convertTraceToJson(traceFile, jsonFile);
+  const std::string json = readFile(jsonFile);
+  const size_t samples   = countOf(json, "\"name\":\"rkTraceRssMem_B\"");
+  CHECK(samples >= 10);
+  CHECK(samples < 200);
+  CHECK(countOf(json, "\"name\":\"rkTraceVirtMem_B\"") == samples);
+  CHECK(countOf(json, "\"args\":{\"name\":\"rkMemorySampler\"}") == 2);
+#if defined(__linux__) || defined(_WIN32) || defined(__APPLE__)
+  const size_t rss = json.find("\"name\":\"rkTraceRssMem_B\"");
+  const size_t value = json.find("\"value\":", rss);
+  REQUIRE(value != std::string::npos);
+  CHECK(std::atoll(json.c_str() + value + 8) > 0);
+#endif
+
+  std::remove(traceFile);
+  std::remove(jsonFile);
+}
+
+TEST_CASE("Hardware counters", "[Tracing]")
+{
+  const char *jsonFile = "test_Tracing_counters.json";
+
+  // hardware events are often not available in virtual machines, software
+  // events are
+  const bool counting = enableHardwareCounters(
+      {HardwareCounter::PAGE_FAULTS, HardwareCounter::CONTEXT_SWITCHES});
+  for (int i = 0; i < 10; i++) {
+    beginEvent("counted", "test");
+    // switches out of this thread
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    endEvent();
+  }
+  disableHardwareCounters();
+  beginEvent("uncounted", "test");
+  endEvent();
+  saveLog(jsonFile, "test_Tracing");
+
+  const std::vector<RegionCounters> summary = regionCounterSummary();
+  const std::string json = readFile(jsonFile);
+  std::remove(jsonFile);
+  for (const auto &region : summary)
+    CHECK(region.name != "uncounted");
+  if (!counting) {
+    WARN("perf_event_open() is not available");
+    CHECK(summary.empty());
+    CHECK(countOf(json, "\"pageFaults\":") == 0);
+    return;
+  }
+
+  REQUIRE(summary.size() == 1);
+  CHECK(summary[0].name == "counted");
+  CHECK(summary[0].count == 10);
+  CHECK(summary[0][HardwareCounter::CONTEXT_SWITCHES] >= 10);
+  CHECK(countOf(json, "\"pageFaults\":") == 10);
+  CHECK(countOf(json, "\"contextSwitches\":") == 10);
+  CHECK(regionCounterReport().find("counted") != std::string::npos);
+}
+
+TEST_CASE("Event statistics", "[Tracing]")
+{
+  const char *jsonFile = "test_Tracing_stats.json";
+
+  setTraceMode(TraceMode::STATISTICS);
+  resetStats();
+  std::thread worker([&]() {
+    setThreadName("statsWorker");
+    for (int i = 0; i < 10; i++) {
+      beginEvent("sleep \"2ms\"", "test");
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      endEvent();
+    }
+    for (int i = 0; i < 1000; i++) {
+      beginEvent("short", "test");
+      endEvent();
+    }
+  });
+  worker.join();
+  setTraceMode(TraceMode::TIMELINE);
+
+  // no timeline events were kept
+  saveLog(jsonFile, "test_Tracing");
+  const std::string json = readFile(jsonFile);
+  std::remove(jsonFile);
+  CHECK(countOf(json, "\"name\":\"short\"") == 0);
+
+  const std::vector<EventStatistics> stats = getStats();
+  REQUIRE(stats.size() == 2);
+  CHECK(stats[0].name == "sleep \"2ms\"");
+  CHECK(stats[0].thread.empty());
+  CHECK(stats[0].count == 10);
+  CHECK(stats[0].minNs >= 2000000);
+  CHECK(stats[0].minNs <= stats[0].p50Ns);
+  CHECK(stats[0].p50Ns <= stats[0].p99Ns);
+  CHECK(stats[0].p99Ns <= stats[0].maxNs);
+  CHECK(stats[0].meanNs() >= stats[0].minNs);
+#ifdef __linux__
+  CHECK(stats[0].cpuUtilization >= 0.f);
+  CHECK(stats[0].cpuUtilization < 50.f);
+#endif
+  CHECK(stats[1].name == "short");
+  CHECK(stats[1].count == 1000);
+
+  const std::vector<EventStatistics> perThread = getStats(true);
+  REQUIRE(perThread.size() == 2);
+  CHECK(perThread[0].thread == "statsWorker");
+
+  const std::string prometheus = statsToPrometheus(stats);
+  CHECK(countOf(prometheus,
+            "rkcommon_trace_duration_seconds_count{name=\"short\"} 1000")
+      == 1);
+  CHECK(countOf(prometheus, "name=\"sleep \\\"2ms\\\"\",quantile=\"0.99\"")
+      == 1);
+  const std::string statsJson = statsToJson(perThread);
+  CHECK(countOf(statsJson, "\"thread\":\"statsWorker\"") == 2);
+  CHECK(countOf(statsJson, "\"count\":1000,") == 1);
+
+  resetStats();
+  CHECK(getStats().empty());
+}
+
+static void tracedFunction()
+{
+  RKCOMMON_TRACE_SCOPE("tracedFunction");
+}
+
+TEST_CASE("Interned strings and trace scopes", "[Tracing]")
+{
+  const char *jsonFile = "test_Tracing_scopes.json";
+
+  const std::string name = "interned";
+  const char *interned = internString(name.c_str());
+  CHECK(std::string(interned) == name);
+  CHECK(interned != name.c_str());
+  CHECK(internString(std::string(name).c_str()) == interned);
+  CHECK(internString(nullptr) == nullptr);
+
+  // transient threads register while others record
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 16; i++) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 100; j++) {
+        TraceScope scope("scoped", "test");
+        CHECK(currentRegion() == internString("scoped"));
+        tracedFunction();
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  {
+    TraceScope scope(TraceScope::Interned(), interned);
+    CHECK(currentRegion() == interned);
+  }
+  CHECK(currentRegion() == nullptr);
+  saveLog(jsonFile, "test_Tracing");
+
+  const std::string json = readFile(jsonFile);
+  std::remove(jsonFile);
+  CHECK(countOf(json, "\"name\":\"scoped\"") == 1600);
+  CHECK(countOf(json, "\"name\":\"tracedFunction\"") == 1600);
+  CHECK(countOf(json, "\"name\":\"interned\"") == 1);
+}
+
+#ifndef _WIN32
+// A viewer of live traces on a free local port, which reads the trace into
+// a file once read() is called
+struct TraceViewer
+{
+  TraceViewer()
+  {
+    listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t size = sizeof(addr);
+    REQUIRE(::bind(listener, (const sockaddr *)&addr, sizeof(addr)) == 0);
+    REQUIRE(::listen(listener, 1) == 0);
+    ::getsockname(listener, (sockaddr *)&addr, &size);
+    address = "127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+  }
+
+  ~TraceViewer()
+  {
+    ::close(listener);
+  }
+
+  void read(const char *traceFile)
+  {
+    reader = std::thread([=]() {
+      const int fd = ::accept(listener, nullptr, nullptr);
+      std::ofstream out(traceFile, std::ios::binary);
+      char buffer[65536];
+      ssize_t n = 0;
+      while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        out.write(buffer, n);
+      ::close(fd);
+    });
+  }
+
+  int listener = -1;
+  std::string address;
+  std::thread reader;
+};
+
+TEST_CASE("Live traces", "[Tracing]")
+{
+  const char *traceFile = "test_Tracing_live.bin";
+  const char *jsonFile  = "test_Tracing_live.json";
+  setCpuTimeSampling(0);
+
+  SECTION("a viewer which keeps up gets all events")
+  {
+    TraceViewer viewer;
+    viewer.read(traceFile);
+    startLiveTrace(viewer.address.c_str(), "test_Tracing", 1);
+    std::thread worker([&]() {
+      for (int i = 0; i < 10000; i++) {
+        beginEvent("live", "test");
+        endEvent();
+      }
+    });
+    worker.join();
+    stopTraceStream();
+    viewer.reader.join();
+
+    CHECK(droppedLiveTraceEvents() == 0);
+    convertTraceToJson(traceFile, jsonFile);
+    const std::string json = readFile(jsonFile);
+    CHECK(countOf(json, "\"name\":\"live\"") == 10000);
+    CHECK(countOf(json, "rkTraceDroppedEvents") == 0);
+  }
+
+  SECTION("a stalled viewer loses events but does not stall the trace")
+  {
+    TraceViewer viewer;
+    startLiveTrace(viewer.address.c_str(), "test_Tracing", 1);
+    const int numEvents = 1000000;
+    std::thread worker([&]() {
+      for (int i = 0; i < numEvents; i++) {
+        beginEvent("stalled", "test");
+        endEvent();
+      }
+    });
+    worker.join();
+    // the viewer catches up
+    viewer.read(traceFile);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    stopTraceStream();
+    viewer.reader.join();
+
+    CHECK(droppedLiveTraceEvents() > 0);
+    convertTraceToJson(traceFile, jsonFile);
+    const std::string json = readFile(jsonFile);
+    CHECK(json.back() == ']');
+    CHECK(countOf(json, "\"name\":\"stalled\"") < size_t(numEvents));
+    CHECK(countOf(json, "rkTraceDroppedEvents") > 0);
+  }
+
+  CHECK_THROWS(startLiveTrace("127.0.0.1:1", "test_Tracing"));
+  setCpuTimeSampling(1);
+  std::remove(traceFile);
+  std::remove(jsonFile);
+}
+#endif
+
+#ifdef __linux__
+// Not inlined, so that the samples land in it
+__attribute__((noinline)) static double spin(std::chrono::milliseconds time)
+{
+  volatile double sum = 0.0;
+  const auto end      = std::chrono::steady_clock::now() + time;
+  while (std::chrono::steady_clock::now() < end) {
+    for (int i = 0; i < 1000; i++)
+      sum = sum + i * 0.5;
+  }
+  return sum;
+}
+
+TEST_CASE("Sampling profiler", "[Tracing]")
+{
+  const char *jsonFile = "test_Tracing_samples.json";
+
+  REQUIRE(startSampling(200, 4096));
+  {
+    RKCOMMON_TRACE_SCOPE("spinning");
+    spin(std::chrono::milliseconds(100));
+  }
+  // threads are sampled from their first trace call on
+  std::thread worker([]() {
+    setThreadName("sampledWorker");
+    TraceScope scope("workerSpinning");
+    spin(std::chrono::milliseconds(50));
+  });
+  worker.join();
+  stopSampling();
+  stopSampling();
+
+  const std::vector<SampleHotSpot> hotSpots = sampleHotSpots();
+  uint64_t inSpinning = 0;
+  uint64_t inWorker   = 0;
+  for (const auto &hotSpot : hotSpots) {
+    CHECK(!hotSpot.function.empty());
+    if (hotSpot.region == "spinning")
+      inSpinning += hotSpot.count;
+    else if (hotSpot.region == "workerSpinning")
+      inWorker += hotSpot.count;
+  }
+  // CPU clock timers expire on scheduler ticks, so fewer than 500 and 250
+  CHECK(inSpinning > 0);
+  CHECK(inWorker > 0);
+
+  // not sampled any more
+  spin(std::chrono::milliseconds(20));
+  uint64_t total = 0;
+  for (const auto &hotSpot : sampleHotSpots())
+    total += hotSpot.count;
+  uint64_t before = 0;
+  for (const auto &hotSpot : hotSpots)
+    before += hotSpot.count;
+  CHECK(total == before);
+
+  saveLog(jsonFile, "test_Tracing");
+  const std::string json = readFile(jsonFile);
+  CHECK(countOf(json, "\"cat\":\"sample\"") == total);
+  CHECK(countOf(json, "\"args\":{\"region\":\"spinning\"") == inSpinning);
+
+  std::remove(jsonFile);
+}
+#endif
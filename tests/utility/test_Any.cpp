@@ -3,10 +3,14 @@
 
 #include "../catch.hpp"
 
+#include "rkcommon/math/AffineSpace.h"
 #include "rkcommon/math/box.h"
 #include "rkcommon/math/vec.h"
 #include "rkcommon/utility/Any.h"
 
+#include <array>
+#include <memory>
+
 using namespace rkcommon::utility;
 using namespace rkcommon::math;
 
@@ -130,3 +134,60 @@ TEST_CASE("Any 'OSPObject' type behavior", "[Any]")
   test_interface<OSPObject>(static_cast<OSPObject>(val1),
                             static_cast<OSPObject>(val2));
 }
+
+TEST_CASE("Any 'AffineSpace3f' type behavior", "[Any]")
+{
+  test_interface<AffineSpace3f>(AffineSpace3f(one),
+                                AffineSpace3f::translate(vec3f(1.f)));
+}
+
+TEST_CASE("Any values larger than the inline storage", "[Any]")
+{
+  std::array<float, 64> large;
+  large.fill(1.f);
+  std::array<float, 64> large2 = large;
+  large2[63]                   = 2.f;
+  test_interface<std::array<float, 64>>(large, large2);
+}
+
+TEST_CASE("Any move semantics", "[Any]")
+{
+  SECTION("Moving steals the value, leaving the source empty")
+  {
+    Any v = std::string("Hello");
+    Any v2(std::move(v));
+    REQUIRE(!v.valid());
+    verify_value<std::string>(v2, "Hello");
+
+    Any v3;
+    v3 = std::move(v2);
+    REQUIRE(!v2.valid());
+    verify_value<std::string>(v3, "Hello");
+  }
+
+  SECTION("Held values are destroyed once")
+  {
+    auto counted = std::make_shared<int>(1);
+    {
+      Any v = counted;
+      Any v2(v);
+      REQUIRE(counted.use_count() == 3);
+      Any v3(std::move(v2));
+      REQUIRE(counted.use_count() == 3);
+      v = 5;
+      REQUIRE(counted.use_count() == 2);
+    }
+    REQUIRE(counted.use_count() == 1);
+  }
+
+  SECTION("Empty values compare equal")
+  {
+    REQUIRE(Any() == Any());
+    REQUIRE(Any() != Any(1));
+  }
+
+  SECTION("Values of different types are not equal")
+  {
+    REQUIRE(Any(1) != Any(1.f));
+  }
+}
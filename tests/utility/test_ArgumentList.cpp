@@ -67,3 +67,106 @@ TEST_CASE("ArgumentsParser correctness", "[ArgumentList]")
   REQUIRE(args.size() == 1);
   REQUIRE(args[0] == "arg2");
 }
+
+using namespace rkcommon::math;
+using namespace rkcommon::utility;
+
+TEST_CASE("ArgumentTokens tokenizing", "[ArgumentList]")
+{
+  ArgumentTokens<8> tokens;
+
+  REQUIRE(tokens.tokenize("  -spp 4\t--name 'two words' \"\" x  "));
+  REQUIRE(tokens.size() == 6);
+  REQUIRE(tokens[0] == "-spp");
+  REQUIRE(tokens[1] == "4");
+  REQUIRE(tokens[3] == "two words");
+  REQUIRE(tokens[4].empty());
+  REQUIRE(tokens[5] == "x");
+
+  REQUIRE(tokens.tokenize(""));
+  REQUIRE(tokens.empty());
+
+  ArgumentStatus status = tokens.tokenize("a 'b c");
+  REQUIRE(status.error == ArgumentError::UNTERMINATED_QUOTE);
+  REQUIRE(status.index == 2);
+
+  ArgumentTokens<2> few;
+  status = few.tokenize("a b c");
+  REQUIRE(status.error == ArgumentError::TOO_MANY);
+  REQUIRE(status.index == 4);
+
+  REQUIRE(tokens.assign(5, test_arguments));
+  REQUIRE(tokens.size() == 4);
+  REQUIRE(tokens[0] == "arg1");
+}
+
+TEST_CASE("OptionTable typed options", "[ArgumentList]")
+{
+  int spp      = 1;
+  float scale  = 1.f;
+  bool verbose = false;
+  StringView name;
+  vec3f eye;
+  box3f bounds;
+
+  OptionTable<6, 2> options;
+  REQUIRE(options.bind("-spp", spp));
+  REQUIRE(options.bind("--scale", scale));
+  REQUIRE(options.bind("-v", verbose));
+  REQUIRE(options.bind("--name", name));
+  REQUIRE(options.bind("--eye", eye));
+  REQUIRE(options.bind("--bounds", bounds));
+  REQUIRE(!options.bind("--more", spp));
+
+  ArgumentTokens<32> tokens;
+  REQUIRE(tokens.tokenize("scene.obj -spp 0x10 --scale -.5 -v --name 'a b' "
+                          "--eye 1 2 3 --bounds -1 -1 -1 1 1 1 out.png"));
+
+  const ArgumentStatus status = options.parse(tokens);
+  REQUIRE(status);
+  REQUIRE(spp == 16);
+  REQUIRE(scale == -0.5f);
+  REQUIRE(verbose);
+  REQUIRE(name == "a b");
+  REQUIRE(eye == vec3f(1.f, 2.f, 3.f));
+  REQUIRE(bounds.lower == vec3f(-1.f));
+  REQUIRE(bounds.upper == vec3f(1.f));
+  REQUIRE(options.numPositional() == 2);
+  REQUIRE(options.positional(0) == "scene.obj");
+  REQUIRE(options.positional(1) == "out.png");
+}
+
+TEST_CASE("OptionTable errors", "[ArgumentList]")
+{
+  int spp = 1;
+  vec3f eye(0.f);
+
+  OptionTable<2> options;
+  options.bind("-spp", spp);
+  options.bind("--eye", eye);
+
+  ArgumentTokens<8> tokens;
+
+  tokens.tokenize("-spp 2 --up 0 1 0");
+  ArgumentStatus status = options.parse(tokens);
+  REQUIRE(status.error == ArgumentError::UNKNOWN_OPTION);
+  REQUIRE(status.index == 2);
+  REQUIRE(spp == 2);
+  REQUIRE(std::string(status.message()) == "unknown option");
+
+  tokens.tokenize("--eye 1 2");
+  status = options.parse(tokens);
+  REQUIRE(status.error == ArgumentError::MISSING_VALUE);
+  REQUIRE(status.index == 0);
+
+  // no component is stored if one is invalid
+  tokens.tokenize("-spp 3 --eye 1 x 3");
+  status = options.parse(tokens);
+  REQUIRE(status.error == ArgumentError::INVALID_VALUE);
+  REQUIRE(status.index == 2);
+  REQUIRE(spp == 3);
+  REQUIRE(eye == vec3f(0.f));
+
+  tokens.tokenize("-spp 99999999999");
+  REQUIRE(options.parse(tokens).error == ArgumentError::INVALID_VALUE);
+}
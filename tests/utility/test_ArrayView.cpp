@@ -108,4 +108,15 @@ TEST_CASE("ArrayView::reset", "[ArrayView]")
     view.reset(array.data(), array.size());
     verify_N(view, 10);
   }
+
+  SECTION("ArrayView::reset on device accessible memory")
+  {
+    REQUIRE(!view.isDeviceAccessible());
+    view.reset(vector.data(), 5, rkcommon::memory::DeviceMemory::SHARED);
+    verify_N(view, 5);
+    REQUIRE(view.deviceMemory() == rkcommon::memory::DeviceMemory::SHARED);
+    REQUIRE(view.isDeviceAccessible());
+    view = vector;
+    REQUIRE(!view.isDeviceAccessible());
+  }
 }
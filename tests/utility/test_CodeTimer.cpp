@@ -1,5 +1,47 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/utility/CodeTimer.h"
+// std
+#include <thread>
+
+using namespace rkcommon::utility;
+
+TEST_CASE("CodeTimer durations", "[CodeTimer]")
+{
+  const TimerClock clock = GENERATE(TimerClock::STEADY, TimerClock::TSC);
+
+  LatencyHistogram histogram;
+  CodeTimer timer(&histogram, clock);
+  REQUIRE(timer.histogram() == &histogram);
+
+  timer.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  timer.stop();
+  REQUIRE(timer.milliseconds() >= 19.0);
+  REQUIRE(timer.milliseconds() < 1000.0);
+  REQUIRE(timer.seconds() == Approx(timer.milliseconds() / 1000.0));
+  REQUIRE(histogram.count() == 1);
+  REQUIRE(histogram.max() >= 19000000);
+
+  // laps cover the time between them without gaps
+  timer.start();
+  for (int i = 0; i < 3; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    timer.lap();
+  }
+  REQUIRE(histogram.count() == 4);
+  REQUIRE(histogram.min() >= 1900000);
+  REQUIRE(timer.perSecondSmoothed() > 0.0);
+}
+
+TEST_CASE("CodeTimer without a histogram", "[CodeTimer]")
+{
+  CodeTimer timer;
+  REQUIRE(timer.histogram() == nullptr);
+  timer.start();
+  timer.stop();
+  REQUIRE(timer.seconds() >= 0.0);
+}
@@ -0,0 +1,141 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/networking/DataStreaming.h"
+#include "rkcommon/utility/CompactOptional.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::utility;
+
+static_assert(sizeof(CompactOptional<float>) == sizeof(float), "");
+static_assert(sizeof(CompactOptional<uint32_t>) == sizeof(uint32_t), "");
+static_assert(sizeof(CompactOptional<math::vec3f>) == sizeof(math::vec3f),
+              "");
+static_assert(std::is_trivially_copyable<CompactOptional<float>>::value, "");
+static_assert(
+    std::is_trivially_copyable<CompactOptional<math::vec3f>>::value, "");
+
+template <typename T>
+static void verifyOptional(const T &value)
+{
+  CompactOptional<T> opt;
+  REQUIRE(!opt);
+  REQUIRE(!opt.has_value());
+  REQUIRE(opt.value_or(value) == value);
+
+  opt = value;
+  REQUIRE(opt);
+  REQUIRE(*opt == value);
+  REQUIRE(opt.value() == value);
+
+  CompactOptional<T> copy = opt;
+  REQUIRE(copy == opt);
+
+  opt.reset();
+  REQUIRE(!opt);
+  REQUIRE(opt != copy);
+
+  opt.emplace(value);
+  REQUIRE(opt.has_value());
+}
+
+TEST_CASE("CompactOptional has the API of Optional", "[CompactOptional]")
+{
+  verifyOptional(1.5f);
+  verifyOptional(-2.0);
+  verifyOptional(uint32_t(7));
+  verifyOptional(int64_t(-7));
+  verifyOptional(math::vec3f(1.f, 2.f, 3.f));
+  verifyOptional(math::vec2i(0, -1));
+
+  CompactOptional<math::vec3f> v = math::vec3f(1.f, 2.f, 3.f);
+  REQUIRE(v->y == 2.f);
+
+  REQUIRE(make_compact_optional<float>(3.f).value() == 3.f);
+}
+
+TEST_CASE("CompactOptional sentinels", "[CompactOptional]")
+{
+  // NaNs and zeros are values
+  CompactOptional<float> f = std::nanf("");
+  REQUIRE(f.has_value());
+  REQUIRE(std::isnan(*f));
+  f = 0.f / 0.f;
+  REQUIRE(f.has_value());
+  f = 0.f;
+  REQUIRE(f.has_value());
+
+  // the sentinel is not
+  f = compact_optional_sentinel<float>::empty();
+  REQUIRE(!f);
+  CompactOptional<uint32_t> index = ~0u;
+  REQUIRE(!index);
+
+  // own sentinels
+  struct NegativeIsEmpty
+  {
+    static int empty()
+    {
+      return -1;
+    }
+    static bool is_empty(int v)
+    {
+      return v < 0;
+    }
+  };
+  CompactOptional<int, NegativeIsEmpty> count;
+  REQUIRE(!count);
+  count = -5;
+  REQUIRE(!count);
+  count = 5;
+  REQUIRE(count.value_or(0) == 5);
+}
+
+TEST_CASE("CompactOptional converts from and to Optional",
+          "[CompactOptional]")
+{
+  Optional<float> empty, full(2.f);
+  CompactOptional<float> c(full);
+  REQUIRE(*c == 2.f);
+  c = empty;
+  REQUIRE(!c);
+  REQUIRE(!c.toOptional());
+  c = full;
+  REQUIRE(c.toOptional().value() == 2.f);
+}
+
+TEST_CASE("CompactOptional arrays are copied and streamed in bulk",
+          "[CompactOptional]")
+{
+  std::vector<CompactOptional<float>> values(1000);
+  for (size_t i = 0; i < values.size(); i += 3)
+    values[i] = float(i);
+
+  std::vector<CompactOptional<float>> copy(values.size());
+  std::memcpy(copy.data(), values.data(), values.size() * sizeof(float));
+  REQUIRE(copy[3] == values[3]);
+  REQUIRE(!copy[4]);
+
+  static_assert(networking::detail::is_bulk_streamable<
+                    CompactOptional<float>>::value,
+                "");
+  networking::BufferWriter writer;
+  writer << values;
+  REQUIRE(writer.buffer->size() == sizeof(size_t) + 1000 * sizeof(float));
+
+  networking::BufferReader reader(writer.buffer);
+  std::vector<CompactOptional<float>> read;
+  reader >> read;
+  REQUIRE(read.size() == values.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    REQUIRE(read[i].has_value() == (i % 3 == 0));
+    if (read[i])
+      REQUIRE(*read[i] == float(i));
+  }
+}
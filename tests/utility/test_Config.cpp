@@ -0,0 +1,137 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/utility/Config.h"
+// std
+#include <cstdlib>
+
+using namespace rkcommon::utility;
+using namespace std::chrono;
+
+static void setEnv(const char *name, const char *value)
+{
+#ifdef _WIN32
+  _putenv_s(name, value);
+#else
+  setenv(name, value, 1);
+#endif
+}
+
+enum class Mode
+{
+  FAST,
+  EXACT
+};
+
+TEST_CASE("Config values from the environment", "[Config]")
+{
+  setEnv("RKCOMMON_TEST_INT", "42");
+  setEnv("RKCOMMON_TEST_FLOAT", "0.5");
+  setEnv("RKCOMMON_TEST_BOOL", "on");
+  setEnv("RKCOMMON_TEST_STRING", "text");
+  setEnv("RKCOMMON_TEST_ENUM", "Exact");
+  setEnv("RKCOMMON_TEST_DURATION", "250us");
+  setEnv("RKCOMMON_TEST_INVALID", "12 apples");
+
+  ConfigValue<int> i("RKCOMMON_TEST_INT", 1, "an int");
+  ConfigValue<float> f("RKCOMMON_TEST_FLOAT", 1.f, "a float");
+  ConfigValue<bool> b("RKCOMMON_TEST_BOOL", false, "a bool");
+  ConfigValue<std::string> s("RKCOMMON_TEST_STRING", "", "a string");
+  ConfigEnum<Mode> e("RKCOMMON_TEST_ENUM",
+                     Mode::FAST,
+                     {{"fast", Mode::FAST}, {"exact", Mode::EXACT}},
+                     "an enum");
+  ConfigValue<nanoseconds> d(
+      "RKCOMMON_TEST_DURATION", milliseconds(1), "a duration");
+  ConfigValue<int> invalid("RKCOMMON_TEST_INVALID", 7, "not an int");
+  ConfigValue<int> unset("RKCOMMON_TEST_UNSET", 3, "no variable");
+
+  REQUIRE(i.get() == 42);
+  REQUIRE(f.get() == 0.5f);
+  REQUIRE(b.get());
+  REQUIRE(s.get() == "text");
+  REQUIRE(e.get() == Mode::EXACT);
+  REQUIRE(d.get() == microseconds(250));
+  REQUIRE(invalid.get() == 7);
+  REQUIRE(unset.get() == 3);
+
+  REQUIRE(i.type() == ConfigType::INT);
+  REQUIRE(e.type() == ConfigType::ENUM);
+  REQUIRE(d.type() == ConfigType::DURATION);
+  REQUIRE(e.str() == "exact");
+  REQUIRE(d.str() == "250us");
+  REQUIRE(f.str() == "0.5");
+
+  // read once: later changes of the variable are not seen
+  setEnv("RKCOMMON_TEST_INT", "43");
+  REQUIRE(i.get() == 42);
+
+  REQUIRE(findConfigSetting("RKCOMMON_TEST_INT") == &i);
+}
+
+TEST_CASE("Config overrides and change hooks", "[Config]")
+{
+  ConfigValue<int> value("RKCOMMON_TEST_OVERRIDE", 5, "an int");
+
+  int numChanges = 0;
+  std::string seen;
+  const int hook = value.addChangeHook([&](const ConfigSetting &setting) {
+    numChanges++;
+    seen = setting.str();
+  });
+
+  value.set(8);
+  REQUIRE(value.get() == 8);
+  REQUIRE(value.isOverridden());
+  REQUIRE(numChanges == 1);
+  REQUIRE(seen == "8");
+
+  REQUIRE(value.set("0x10"));
+  REQUIRE(value == 16);
+  REQUIRE(!value.set("sixteen"));
+  REQUIRE(value == 16);
+  REQUIRE(numChanges == 2);
+
+  value.reset();
+  REQUIRE(value.get() == 5);
+  REQUIRE(!value.isOverridden());
+  REQUIRE(numChanges == 3);
+
+  value.removeChangeHook(hook);
+  value.set(9);
+  REQUIRE(numChanges == 3);
+
+  ConfigValue<bool> flag("RKCOMMON_TEST_FLAG", true, "a bool");
+  REQUIRE(flag.set("false"));
+  REQUIRE(!flag.get());
+  REQUIRE(flag.set("1"));
+  REQUIRE(flag.get());
+
+  ConfigValue<nanoseconds> duration(
+      "RKCOMMON_TEST_TIMEOUT", seconds(1), "a duration");
+  REQUIRE(duration.str() == "1s");
+  REQUIRE(duration.set("20"));
+  REQUIRE(duration.get() == milliseconds(20));
+  REQUIRE(!duration.set("20 parsecs"));
+}
+
+TEST_CASE("Config settings of rkcommon", "[Config]")
+{
+  const auto settings = configSettings();
+  REQUIRE(findConfigSetting("RKCOMMON_ISA") == &config::isa());
+  REQUIRE(findConfigSetting("RKCOMMON_TASKING_BACKEND") != nullptr);
+  REQUIRE(findConfigSetting("RKCOMMON_NO_SUCH_SETTING") == nullptr);
+
+  for (const ConfigSetting *setting : settings)
+    REQUIRE(std::string(setting->description()).size() > 0);
+
+  // settings are unregistered with their destruction
+  const size_t numSettings = settings.size();
+  {
+    ConfigValue<int> local("RKCOMMON_TEST_LOCAL", 0, "an int");
+    REQUIRE(configSettings().size() == numSettings + 1);
+  }
+  REQUIRE(configSettings().size() == numSettings);
+}
@@ -1,5 +1,120 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
+#include "rkcommon/math/vec.h"
 #include "rkcommon/utility/DataView.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+using namespace rkcommon::utility;
+
+// interleaved vertices, the normal at an offset which ends at the stride
+struct Vertex
+{
+  vec3f position;
+  float u;
+  vec2f st;
+  vec3f normal;
+};
+
+static std::vector<Vertex> vertices(size_t n)
+{
+  std::vector<Vertex> v(n);
+  for (size_t i = 0; i < n; ++i) {
+    const float f = float(i);
+    v[i].position = vec3f(f, f + 0.25f, f + 0.5f);
+    v[i].u        = -f;
+    v[i].st       = vec2f(2.f * f, 3.f * f);
+    v[i].normal   = vec3f(-f, -2.f * f, -3.f * f);
+  }
+  return v;
+}
+
+TEST_CASE("DataView copyTo()", "[DataView]")
+{
+  // one count above DATAVIEW_PARALLEL_THRESHOLD
+  const size_t n = GENERATE(size_t(1), size_t(7), size_t(1000), size_t(300000));
+  const std::vector<Vertex> v = vertices(n);
+
+  DataView<vec3f> normals(&v[0].normal, sizeof(Vertex));
+  std::vector<vec3f> out(n);
+  normals.copyTo(out.data(), 0, n);
+  bool equal = true;
+  for (size_t i = 0; i < n; ++i)
+    equal &= out[i] == v[i].normal;
+  REQUIRE(equal);
+
+  DataView<vec2f> st(&v[0].st, sizeof(Vertex));
+  std::vector<vec2f> sts(n);
+  st.copyTo(sts.data(), 0, n, false);
+  equal = true;
+  for (size_t i = 0; i < n; ++i)
+    equal &= sts[i] == v[i].st;
+  REQUIRE(equal);
+
+  // a range in the middle leaves the rest of 'out' alone
+  if (n > 3) {
+    std::vector<vec3f> part(n, vec3f(7.f));
+    DataView<vec3f>(&v[0].position, sizeof(Vertex))
+        .copyTo(part.data(), 1, n - 3);
+    REQUIRE(part[0] == v[1].position);
+    REQUIRE(part[n - 4] == v[n - 3].position);
+    REQUIRE(part[n - 3] == vec3f(7.f));
+  }
+}
+
+TEST_CASE("DataView contiguous and repeated elements", "[DataView]")
+{
+  const std::vector<float> values = {1.f, 2.f, 3.f, 4.f, 5.f};
+
+  std::vector<float> out(3);
+  DataView<float>(values.data()).copyTo(out.data(), 2, 3);
+  REQUIRE(out == std::vector<float>({3.f, 4.f, 5.f}));
+
+  DataView<float>(&values[1], 0).copyTo(out.data(), 0, 3);
+  REQUIRE(out == std::vector<float>({2.f, 2.f, 2.f}));
+}
+
+TEST_CASE("DataView gather()", "[DataView]")
+{
+  const size_t n              = 1000;
+  const std::vector<Vertex> v = vertices(n);
+
+  std::vector<uint32_t> indices(2 * n);
+  for (size_t i = 0; i < indices.size(); ++i)
+    indices[i] = uint32_t((i * 7919) % n);
+
+  DataView<vec3f> positions(&v[0].position, sizeof(Vertex));
+  std::vector<vec3f> out(indices.size());
+  positions.gather(indices.data(), out.data(), indices.size());
+
+  bool equal = true;
+  for (size_t i = 0; i < indices.size(); ++i)
+    equal &= out[i] == v[indices[i]].position;
+  REQUIRE(equal);
+}
+
+TEST_CASE("DataViewMut writes in place", "[DataView]")
+{
+  std::vector<Vertex> v = vertices(100);
+
+  DataViewMut<vec3f> normals(&v[0].normal, sizeof(Vertex));
+  normals[3] = vec3f(1.f);
+  REQUIRE(v[3].normal == vec3f(1.f));
+
+  std::vector<vec3f> in(10, vec3f(0.f, 0.f, 1.f));
+  normals.copyFrom(in.data(), 50, in.size());
+  REQUIRE(v[49].normal == vec3f(-49.f, -98.f, -147.f));
+  REQUIRE(v[50].normal == vec3f(0.f, 0.f, 1.f));
+  REQUIRE(v[59].normal == vec3f(0.f, 0.f, 1.f));
+  REQUIRE(v[60].normal == vec3f(-60.f, -120.f, -180.f));
+  // the other attributes are kept
+  REQUIRE(v[55].st == vec2f(110.f, 165.f));
+
+  const DataView<vec3f> view = normals;
+  REQUIRE(view[50] == vec3f(0.f, 0.f, 1.f));
+}
@@ -0,0 +1,63 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/utility/FunctionRef.h"
+
+#include <functional>
+#include <string>
+
+using rkcommon::utility::FunctionRef;
+
+static int twice(int i)
+{
+  return 2 * i;
+}
+
+static int callWith(FunctionRef<int(int)> fcn, int i)
+{
+  return fcn(i);
+}
+
+TEST_CASE("FunctionRef calls what it references", "[FunctionRef]")
+{
+  REQUIRE(sizeof(FunctionRef<int(int)>) == 2 * sizeof(void *));
+
+  SECTION("lambdas")
+  {
+    int calls = 0;
+    auto fcn  = [&](int i) {
+      calls++;
+      return i + 1;
+    };
+    REQUIRE(callWith(fcn, 1) == 2);
+    REQUIRE(callWith([](int i) { return i * i; }, 3) == 9);
+    REQUIRE(calls == 1);
+  }
+
+  SECTION("plain functions")
+  {
+    REQUIRE(callWith(twice, 4) == 8);
+    REQUIRE(callWith(&twice, 5) == 10);
+  }
+
+  SECTION("std::function")
+  {
+    std::function<int(int)> fcn = twice;
+    REQUIRE(callWith(fcn, 6) == 12);
+  }
+}
+
+TEST_CASE("FunctionRef references, it does not copy", "[FunctionRef]")
+{
+  std::string suffix = "a";
+  auto append = [&suffix](const std::string &s) { return s + suffix; };
+
+  FunctionRef<std::string(const std::string &)> ref(append);
+  FunctionRef<std::string(const std::string &)> copy = ref;
+
+  suffix = "b";
+  REQUIRE(ref("x") == "xb");
+  REQUIRE(copy("y") == "yb");
+}
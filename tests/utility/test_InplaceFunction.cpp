@@ -0,0 +1,69 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/utility/InplaceFunction.h"
+
+#include <memory>
+
+using rkcommon::utility::InplaceFunction;
+
+TEST_CASE("InplaceFunction stores and calls callables", "[InplaceFunction]")
+{
+  InplaceFunction<int(int)> empty;
+  REQUIRE(!empty);
+  REQUIRE_THROWS_AS(empty(1), std::bad_function_call);
+
+  int offset = 10;
+  InplaceFunction<int(int)> f = [offset](int i) { return i + offset; };
+  REQUIRE(f);
+  REQUIRE(f(1) == 11);
+
+  InplaceFunction<int(int)> copy = f;
+  REQUIRE(copy(2) == 12);
+  REQUIRE(f(3) == 13);
+
+  InplaceFunction<int(int)> moved = std::move(copy);
+  REQUIRE(moved(4) == 14);
+  REQUIRE(!copy);
+
+  moved = nullptr;
+  REQUIRE(!moved);
+}
+
+TEST_CASE("InplaceFunction manages the lifetime of its callable",
+          "[InplaceFunction]")
+{
+  auto counter = std::make_shared<int>(0);
+  {
+    InplaceFunction<void()> f = [counter]() { (*counter)++; };
+    REQUIRE(counter.use_count() == 2);
+
+    InplaceFunction<void()> copy = f;
+    REQUIRE(counter.use_count() == 3);
+
+    f();
+    copy();
+    REQUIRE(*counter == 2);
+
+    copy = InplaceFunction<void()>();
+    REQUIRE(counter.use_count() == 2);
+
+    f = [] {};
+    REQUIRE(counter.use_count() == 1);
+  }
+  REQUIRE(counter.use_count() == 1);
+}
+
+TEST_CASE("InplaceFunction size", "[InplaceFunction]")
+{
+  using small_t = InplaceFunction<void(), 2 * sizeof(void *)>;
+  REQUIRE(sizeof(small_t) == 3 * sizeof(void *));
+  REQUIRE(small_t::capacity == 2 * sizeof(void *));
+
+  int a = 0, b = 0;
+  small_t f = [&a, &b]() { a = b = 1; };
+  f();
+  REQUIRE(a + b == 2);
+}
@@ -0,0 +1,61 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/utility/LatencyHistogram.h"
+// std
+#include <cmath>
+
+using rkcommon::utility::LatencyHistogram;
+
+TEST_CASE("LatencyHistogram statistics", "[LatencyHistogram]")
+{
+  LatencyHistogram h;
+  REQUIRE(h.count() == 0);
+  REQUIRE(h.min() == 0);
+  REQUIRE(h.max() == 0);
+  REQUIRE(h.percentile(50) == 0);
+
+  // 1us .. 1ms in 1us steps
+  for (uint64_t i = 1; i <= 1000; ++i)
+    h.record(i * 1000);
+
+  REQUIRE(h.count() == 1000);
+  REQUIRE(h.min() == 1000);
+  REQUIRE(h.max() == 1000000);
+  REQUIRE(h.mean() == Approx(500500.0));
+
+  for (double p : {1.0, 50.0, 95.0, 99.0, 99.9}) {
+    const double expected = p * 10000.0;
+    REQUIRE(std::abs(double(h.percentile(p)) - expected) <= 0.035 * expected);
+  }
+  REQUIRE(h.percentile(0) == h.min());
+  REQUIRE(h.percentile(100) == h.max());
+
+  SECTION("small and huge values")
+  {
+    LatencyHistogram e;
+    e.record(0);
+    e.record(3);
+    e.record(~uint64_t(0));
+    REQUIRE(e.percentile(33) == 0);
+    REQUIRE(e.percentile(66) == 3);
+    REQUIRE(e.percentile(100) == ~uint64_t(0));
+  }
+
+  SECTION("merging")
+  {
+    LatencyHistogram slow;
+    for (int i = 0; i < 1000; ++i)
+      slow.record(50000000);
+    h.merge(slow);
+    REQUIRE(h.count() == 2000);
+    REQUIRE(h.max() == 50000000);
+    REQUIRE(h.percentile(40) < 1000000);
+    REQUIRE(h.percentile(60) == Approx(50000000).epsilon(0.03));
+
+    h.reset();
+    REQUIRE(h.count() == 0);
+  }
+}
@@ -0,0 +1,81 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/array3D/Array3D.h"
+#include "rkcommon/networking/DataStreaming.h"
+#include "rkcommon/utility/MappedArray.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::utility;
+
+static const char *fileName = "test_MappedArray.raw";
+
+static void writeFloats(size_t count)
+{
+  std::vector<float> values(count);
+  for (size_t i = 0; i < count; ++i)
+    values[i] = float(i);
+  FILE *file = fopen(fileName, "wb");
+  fwrite(values.data(), sizeof(float), count, file);
+  fclose(file);
+}
+
+TEST_CASE("MappedArray maps a file in place", "[MappedArray]")
+{
+  writeFloats(10000);
+
+  SECTION("read-only, whole file")
+  {
+    MappedArray<const float> a(fileName);
+    a.prefetch();
+    REQUIRE(a.size() == 10000);
+    REQUIRE(a[0] == 0.f);
+    REQUIRE(a[9999] == 9999.f);
+  }
+
+  SECTION("range at an unaligned offset")
+  {
+    MappedArray<const float> a(
+        fileName, MapMode::READ_ONLY, 5001 * sizeof(float), 10);
+    REQUIRE(a.size() == 10);
+    REQUIRE(a[0] == 5001.f);
+    REQUIRE(a.at(9) == 5010.f);
+  }
+
+  SECTION("copy-on-write never reaches the file")
+  {
+    {
+      MappedArray<float> a(fileName, MapMode::COPY_ON_WRITE);
+      a[1] = -1.f;
+      REQUIRE(a[1] == -1.f);
+    }
+    MappedArray<const float> b(fileName);
+    REQUIRE(b[1] == 1.f);
+  }
+
+  SECTION("too small or missing files throw")
+  {
+    REQUIRE_THROWS(
+        MappedArray<const float>(fileName, MapMode::READ_ONLY, 0, 20000));
+    REQUIRE_THROWS(MappedArray<const float>("does_not_exist.raw"));
+  }
+
+  SECTION("as Array3D and BufferReader")
+  {
+    auto volume = array3D::mmapRAW<float>(fileName, math::vec3i(10, 10, 100));
+    REQUIRE(volume->get(math::vec3i(1, 2, 3)) == 321.f);
+
+    networking::BufferReader reader(fileName);
+    float first[2];
+    reader.read(first, sizeof(first));
+    REQUIRE(first[1] == 1.f);
+    REQUIRE(reader.getView<float>(3)->at(2) == 4.f);
+  }
+
+  std::remove(fileName);
+}
@@ -0,0 +1,140 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/utility/MultiBufferedValue.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace rkcommon;
+using namespace rkcommon::utility;
+
+TEST_CASE("MultiBufferedValue slots", "[MultiBufferedValue]")
+{
+  MultiBufferedValue<int, 3> value;
+  REQUIRE(!value.acquireRead().valid());
+  REQUIRE(value.latestVersion() == 0);
+
+  auto write = value.acquireWrite();
+  REQUIRE(write.valid());
+  *write = 1;
+  REQUIRE(!value.acquireRead().valid());
+  REQUIRE(write.publish() == 1);
+  REQUIRE(!write.valid());
+
+  auto first = value.acquireRead();
+  REQUIRE(first.valid());
+  REQUIRE(*first == 1);
+  REQUIRE(first.version() == 1);
+
+  // dropping a write slot leaves the latest value as it is
+  {
+    auto dropped = value.acquireWrite();
+    *dropped     = 2;
+  }
+  REQUIRE(value.latestVersion() == 1);
+  REQUIRE(*value.acquireRead() == 1);
+
+  write  = value.acquireWrite();
+  *write = 2;
+  write.publish();
+  REQUIRE(value.latestVersion() == 2);
+  REQUIRE(*first == 1);
+
+  // the first value is still read and the second one is the latest
+  auto third = value.tryAcquireWrite();
+  REQUIRE(third.valid());
+  REQUIRE(!value.tryAcquireWrite().valid());
+
+  first.release();
+  REQUIRE(!first.valid());
+  auto fourth = value.tryAcquireWrite();
+  REQUIRE(fourth.valid());
+
+  *third = 3;
+  REQUIRE(third.publish() == 3);
+  *fourth = 4;
+  REQUIRE(fourth.publish() == 4);
+
+  auto latest = value.acquireRead();
+  REQUIRE(*latest == 4);
+  REQUIRE(latest.version() == 4);
+}
+
+TEST_CASE("MultiBufferedValue pipeline", "[MultiBufferedValue]")
+{
+  struct Frame
+  {
+    int first{0};
+    int second{0};
+  };
+
+  const int numFrames = 20000;
+  MultiBufferedValue<Frame, 3> frames;
+  std::atomic<bool> done{false};
+
+  std::thread producer([&]() {
+    for (int i = 1; i <= numFrames; ++i) {
+      auto slot    = frames.acquireWrite();
+      slot->first  = i;
+      slot->second = -i;
+      slot.publish();
+    }
+    done = true;
+  });
+
+  int last     = 0;
+  bool intact  = true;
+  bool ordered = true;
+  while (last != numFrames) {
+    const bool finished = done;
+    auto frame          = frames.acquireRead();
+    if (frame.valid()) {
+      intact &= frame->second == -frame->first;
+      intact &= frame.version() == uint64_t(frame->first);
+      ordered &= frame->first >= last;
+      last = frame->first;
+    }
+    if (finished && last != numFrames)
+      break;
+  }
+  producer.join();
+
+  REQUIRE(intact);
+  REQUIRE(ordered);
+  REQUIRE(last == numFrames);
+}
+
+TEST_CASE("MultiBufferedValue futures", "[Future]")
+{
+  MultiBufferedValue<int, 2> value;
+
+  auto version = value.publishAsync([](int &v) { v = 1; });
+  REQUIRE(version.get() == 1);
+
+  // the display stage keeps the first value until its task is done
+  std::atomic<bool> displayed{false};
+  auto frame = value.acquireRead();
+  REQUIRE(*frame == 1);
+  frame.releaseAfter(tasking::async_future([&]() {
+    while (!displayed)
+      std::this_thread::yield();
+  }));
+  REQUIRE(!frame.valid());
+
+  // nothing may wait on tasks here, a single thread would run the display
+  // task and spin forever
+  auto second = value.acquireWrite();
+  *second = 2;
+  second.publish();
+  REQUIRE(!value.tryAcquireWrite().valid());
+
+  displayed = true;
+  auto write = value.acquireWrite();
+  REQUIRE(write.valid());
+  *write = 3;
+  write.publish();
+  REQUIRE(*value.acquireRead() == 3);
+}
@@ -5,6 +5,9 @@
 
 #include "rkcommon/utility/Observer.h"
 
+#include <thread>
+#include <vector>
+
 using namespace rkcommon::utility;
 
 SCENARIO("Observable/Observer interfaces", "[Observers]")
@@ -37,3 +40,103 @@ SCENARIO("Observable/Observer interfaces", "[Observers]")
     }
   }
 }
+
+TEST_CASE("Observer counts notifications", "[Observers]")
+{
+  Observable at;
+  Observer look(at);
+
+  REQUIRE(look.numNotifications() == 0);
+
+  at.notifyObservers();
+  at.notifyObservers();
+  at.notifyObservers();
+  REQUIRE(look.lastObservedVersion() < at.version());
+  REQUIRE(look.numNotifications() == 3);
+  REQUIRE(look.lastObservedVersion() == at.version());
+  REQUIRE(look.numNotifications() == 0);
+  REQUIRE(!look.wasNotified());
+
+  // observers created later only see later notifications
+  Observer late(at);
+  REQUIRE(!late.wasNotified());
+  at.notifyObservers();
+  REQUIRE(late.numNotifications() == 1);
+  REQUIRE(look.numNotifications() == 1);
+}
+
+TEST_CASE("Observable hierarchies", "[Observers]")
+{
+  // new observables count as modified since any earlier version
+  Observable geometry1;
+  Observable geometry2;
+  Observable scene;
+  geometry1.addParent(scene);
+  geometry2.addParent(scene);
+
+  Observer sceneChanges(scene);
+  const size_t committed = sceneChanges.lastObservedVersion();
+
+  geometry2.notifyObservers();
+  REQUIRE(sceneChanges.numNotifications() == 1);
+  REQUIRE(!geometry1.modifiedSince(committed));
+  REQUIRE(geometry2.modifiedSince(committed));
+  REQUIRE(scene.version() >= geometry2.version());
+
+  geometry2.removeParent(scene);
+  geometry2.notifyObservers();
+  REQUIRE(!sceneChanges.wasNotified());
+
+  // removed links are reused
+  geometry2.addParent(scene);
+  geometry2.notifyObservers();
+  REQUIRE(sceneChanges.numNotifications() == 1);
+
+  // destroying either side of a link detaches it
+  {
+    Observable instance;
+    instance.addParent(scene);
+    geometry1.addParent(instance);
+    geometry1.notifyObservers();
+    REQUIRE(sceneChanges.numNotifications() == 2);
+  }
+  geometry1.notifyObservers();
+  REQUIRE(sceneChanges.numNotifications() == 1);
+
+  {
+    Observable group;
+    geometry1.addParent(group);
+  }
+  geometry1.notifyObservers();
+  REQUIRE(sceneChanges.numNotifications() == 1);
+}
+
+TEST_CASE("Observable notified from several threads", "[Observers]")
+{
+  Observable scene;
+  Observable geometries[4];
+  for (auto &g : geometries)
+    g.addParent(scene);
+
+  Observer look(scene);
+
+  const int notificationsPerThread = 10000;
+  std::vector<std::thread> threads;
+  for (auto &g : geometries) {
+    Observable *geometry = &g;
+    threads.emplace_back([=]() {
+      for (int i = 0; i < notificationsPerThread; ++i)
+        geometry->notifyObservers();
+    });
+  }
+
+  size_t seen = 0;
+  for (auto &t : threads) {
+    seen += look.numNotifications();
+    t.join();
+  }
+  seen += look.numNotifications();
+
+  REQUIRE(seen == 4 * notificationsPerThread);
+  REQUIRE(scene.numChanges() == 4 * notificationsPerThread);
+}
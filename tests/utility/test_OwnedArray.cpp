@@ -1,5 +1,122 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
+#include "rkcommon/containers/aligned_allocator.h"
+#include "rkcommon/utility/FixedArray.h"
 #include "rkcommon/utility/OwnedArray.h"
+
+#include <numeric>
+
+using namespace rkcommon;
+using namespace rkcommon::utility;
+
+template <typename ARRAY_T>
+static void verifyIota(const ARRAY_T &array, size_t n)
+{
+  REQUIRE(array.size() == n);
+  std::vector<int> expected(n);
+  std::iota(expected.begin(), expected.end(), 0);
+  REQUIRE(std::equal(expected.begin(), expected.end(), array.begin()));
+}
+
+TEST_CASE("OwnedArray resizing", "[OwnedArray]")
+{
+  OwnedArray<int> array;
+  REQUIRE(!array);
+
+  array.resize_uninitialized(100);
+  REQUIRE(array.size() == 100);
+  std::iota(array.begin(), array.end(), 0);
+  REQUIRE(reinterpret_cast<uintptr_t>(array.data()) % 64 == 0);
+
+  // the existing elements are kept
+  array.resize_uninitialized(200);
+  std::iota(array.begin() + 100, array.end(), 100);
+  verifyIota(array, 200);
+
+  array.resize(300, 7);
+  REQUIRE(array[299] == 7);
+
+  array.reset();
+  REQUIRE(array.size() == 0);
+}
+
+TEST_CASE("OwnedArray allocators", "[OwnedArray]")
+{
+  std::vector<int> values(1000);
+  std::iota(values.begin(), values.end(), 0);
+
+  SECTION("huge pages")
+  {
+    using Allocator =
+        containers::uninitialized_allocator<int, memory::HugePages::ADVISED>;
+    OwnedArray<int, Allocator> array(values);
+    verifyIota(array, values.size());
+  }
+
+  SECTION("NUMA placement")
+  {
+    OwnedArray<int, containers::numa_aligned_allocator<int>> array;
+    array = values;
+    verifyIota(array, values.size());
+  }
+
+  SECTION("arena")
+  {
+    memory::Arena arena;
+    OwnedArray<int, memory::ArenaAllocator<int>> array(
+        (memory::ArenaAllocator<int>(arena)));
+    array.reset(values.data(), values.size());
+    verifyIota(array, values.size());
+    REQUIRE(arena.bytesUsed() >= values.size() * sizeof(int));
+  }
+
+  SECTION("device accessible")
+  {
+    OwnedArray<int> pageable(values);
+    REQUIRE(!pageable.isDeviceAccessible());
+
+    // ordinary memory without a device allocator
+    using Allocator = containers::device_aligned_allocator<int>;
+    OwnedArray<int, Allocator> array(values);
+    verifyIota(array, values.size());
+    REQUIRE(array.deviceMemory() == memory::DeviceMemory::PAGEABLE);
+
+    memory::DeviceAllocator device;
+    device.allocate =
+        [](size_t size, size_t align, memory::DeviceMemory, void *) {
+          return memory::alignedMalloc(size, align);
+        };
+    device.free = [](void *ptr, size_t, memory::DeviceMemory, void *) {
+      memory::alignedFree(ptr);
+    };
+    memory::setDeviceAllocator(device);
+    array.reset(values.data(), values.size());
+    memory::setDeviceAllocator(memory::DeviceAllocator());
+    verifyIota(array, values.size());
+    REQUIRE(array.deviceMemory() == memory::DeviceMemory::HOST_PINNED);
+    REQUIRE(array.isDeviceAccessible());
+  }
+}
+
+TEST_CASE("FixedArray allocators", "[OwnedArray]")
+{
+  std::vector<int> values(1000);
+  std::iota(values.begin(), values.end(), 0);
+
+  FixedArray<int> array(values);
+  verifyIota(array, values.size());
+  REQUIRE(reinterpret_cast<uintptr_t>(array.data()) % 64 == 0);
+
+  // copies share the data
+  FixedArray<int> copy = array;
+  REQUIRE(copy.data() == array.data());
+
+  memory::Arena arena;
+  FixedArray<int, memory::ArenaAllocator<int>> inArena(
+      values.data(), values.size(), memory::ArenaAllocator<int>(arena));
+  verifyIota(inArena, values.size());
+  REQUIRE(arena.bytesUsed() >= values.size() * sizeof(int));
+}
@@ -37,3 +37,58 @@ SCENARIO("ParameterizedObject interface", "[ParameterizedObject]")
     }
   }
 }
+
+// exposes the protected iteration
+struct Object : public ParameterizedObject
+{
+  size_t numParams()
+  {
+    size_t n = 0;
+    for (auto p = params_begin(); p != params_end(); ++p)
+      n += (*p)->name.empty() ? 0 : 1;
+    return n;
+  }
+};
+
+TEST_CASE("ParameterizedObject keys and many parameters",
+          "[ParameterizedObject]")
+{
+  using rkcommon::utility::ParamKey;
+
+  Object obj;
+  const ParamKey radius("radius");
+  CHECK(ParamKey(std::string("radius")).name == radius.name);
+  CHECK(ParamKey("other").name != radius.name);
+
+  obj.setParam(radius, 2.f);
+  CHECK(obj.getParam<float>("radius", 0.f) == 2.f);
+  CHECK(obj.getParam<float>(std::string("radius"), 0.f) == 2.f);
+  CHECK(obj.getParam<float>(radius, 0.f) == 2.f);
+
+  // past the parameters which are scanned through, into the hashed index
+  const int numParams = 64;
+  for (int i = 0; i < numParams; i++)
+    obj.setParam("param" + std::to_string(i), i);
+  CHECK(obj.numParams() == numParams + 1);
+  for (int i = 0; i < numParams; i++)
+    CHECK(obj.getParam<int>("param" + std::to_string(i), -1) == i);
+  CHECK(obj.getParam<float>(radius, 0.f) == 2.f);
+
+  // removing moves the last parameter into the gap
+  obj.removeParam(radius);
+  obj.removeParam("param10");
+  obj.removeParam(std::string("param20"));
+  obj.removeParam("missing");
+  CHECK(obj.numParams() == numParams - 2);
+  CHECK(!obj.hasParam(radius));
+  CHECK(!obj.hasParam("param10"));
+  CHECK(!obj.hasParam("param20"));
+  for (int i = 0; i < numParams; i++) {
+    if (i != 10 && i != 20)
+      CHECK(obj.getParam<int>("param" + std::to_string(i), -1) == i);
+  }
+
+  obj.setParam("param10", 100);
+  CHECK(obj.getParam<int>(ParamKey("param10"), -1) == 100);
+  CHECK(obj.numParams() == numParams - 1);
+}
@@ -0,0 +1,281 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/math/half.h"
+#include "rkcommon/math/rkmath.h"
+#include "rkcommon/utility/PixelConvert.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+using namespace rkcommon::utility;
+
+// more pixels than a chunk and a packet, with a partial packet at the end
+static const int numPixels = 1000;
+
+static std::vector<float> testPixels()
+{
+  std::vector<float> rgba(4 * numPixels);
+  for (int i = 0; i < numPixels; ++i) {
+    rgba[4 * i]     = (i % 256) / 255.f;
+    rgba[4 * i + 1] = ((i * 7) % 256) / 255.f;
+    rgba[4 * i + 2] = ((i * 13) % 256) / 255.f;
+    rgba[4 * i + 3] = ((i * 3) % 256) / 255.f;
+  }
+  return rgba;
+}
+
+TEST_CASE("PixelConvert pixel sizes", "[PixelConvert]")
+{
+  REQUIRE(pixelSize(PixelFormat::RGBA8) == 4);
+  REQUIRE(pixelSize(PixelFormat::SRGBA8) == 4);
+  REQUIRE(pixelSize(PixelFormat::RGB8) == 3);
+  REQUIRE(pixelSize(PixelFormat::SRGB8) == 3);
+  REQUIRE(pixelSize(PixelFormat::RGBA16F) == 8);
+  REQUIRE(pixelSize(PixelFormat::RGBA32F) == 16);
+  REQUIRE(pixelSize(PixelFormat::L8) == 1);
+  REQUIRE(pixelSize(PixelFormat::L32F) == 4);
+}
+
+TEST_CASE("PixelConvert 8 bit round trips", "[PixelConvert]")
+{
+  const std::vector<float> pixels = testPixels();
+
+  std::vector<uint8_t> rgba8(4 * numPixels);
+  convertPixels(pixels.data(),
+                PixelFormat::RGBA32F,
+                rgba8.data(),
+                PixelFormat::RGBA8,
+                size_t(numPixels));
+
+  bool exact = true;
+  for (size_t i = 0; i < rgba8.size(); ++i)
+    exact &= rgba8[i] == uint8_t(pixels[i] * 255.f + 0.5f);
+  REQUIRE(exact);
+
+  // through floats, every value is kept
+  for (PixelFormat format : {PixelFormat::RGBA32F, PixelFormat::RGBA16F}) {
+    std::vector<uint8_t> through(pixelSize(format) * numPixels);
+    std::vector<uint8_t> back(rgba8.size());
+    convertPixels(rgba8.data(),
+                  PixelFormat::RGBA8,
+                  through.data(),
+                  format,
+                  size_t(numPixels));
+    convertPixels(through.data(),
+                  format,
+                  back.data(),
+                  PixelFormat::RGBA8,
+                  size_t(numPixels));
+    REQUIRE(back == rgba8);
+  }
+
+  // dropping alpha
+  std::vector<uint8_t> rgb8(3 * numPixels);
+  convertPixels(rgba8.data(),
+                PixelFormat::RGBA8,
+                rgb8.data(),
+                PixelFormat::RGB8,
+                size_t(numPixels));
+  bool dropped = true;
+  for (int i = 0; i < numPixels; ++i)
+    for (int c = 0; c < 3; ++c)
+      dropped &= rgb8[3 * i + c] == rgba8[4 * i + c];
+  REQUIRE(dropped);
+}
+
+TEST_CASE("PixelConvert sRGB", "[PixelConvert]")
+{
+  const std::vector<float> pixels = testPixels();
+
+  std::vector<uint8_t> srgb8(4 * numPixels);
+  convertPixels(pixels.data(),
+                PixelFormat::RGBA32F,
+                srgb8.data(),
+                PixelFormat::SRGBA8,
+                size_t(numPixels));
+
+  bool close = true;
+  for (int i = 0; i < numPixels; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      // rounded, from the approximation within 1e-4
+      const float expected = linear_to_srgb(pixels[4 * i + c]) * 255.f;
+      close &= std::abs(srgb8[4 * i + c] - expected) <= 0.55f;
+    }
+    // alpha stays linear
+    close &= srgb8[4 * i + 3] == uint8_t(pixels[4 * i + 3] * 255.f + 0.5f);
+  }
+  REQUIRE(close);
+
+  // sRGB values decoded to floats and encoded again are kept
+  std::vector<float> linear(4 * numPixels);
+  std::vector<uint8_t> back(srgb8.size());
+  convertPixels(srgb8.data(),
+                PixelFormat::SRGBA8,
+                linear.data(),
+                PixelFormat::RGBA32F,
+                size_t(numPixels));
+  convertPixels(linear.data(),
+                PixelFormat::RGBA32F,
+                back.data(),
+                PixelFormat::SRGBA8,
+                size_t(numPixels));
+  REQUIRE(back == srgb8);
+
+  // sRGB to sRGB is copied as it is, with or without alpha
+  std::vector<uint8_t> srgb(3 * numPixels);
+  convertPixels(srgb8.data(),
+                PixelFormat::SRGBA8,
+                srgb.data(),
+                PixelFormat::SRGB8,
+                size_t(numPixels));
+  bool copied = true;
+  for (int i = 0; i < numPixels; ++i)
+    for (int c = 0; c < 3; ++c)
+      copied &= srgb[3 * i + c] == srgb8[4 * i + c];
+  REQUIRE(copied);
+}
+
+TEST_CASE("PixelConvert half floats", "[PixelConvert]")
+{
+  const std::vector<float> pixels = testPixels();
+
+  std::vector<half> rgba16f(4 * numPixels);
+  convertPixels(pixels.data(),
+                PixelFormat::RGBA32F,
+                rgba16f.data(),
+                PixelFormat::RGBA16F,
+                size_t(numPixels));
+
+  bool matches = true;
+  for (size_t i = 0; i < pixels.size(); ++i)
+    matches &= rgba16f[i].bits == half(pixels[i]).bits;
+  REQUIRE(matches);
+
+  std::vector<float> back(pixels.size());
+  convertPixels(rgba16f.data(),
+                PixelFormat::RGBA16F,
+                back.data(),
+                PixelFormat::RGBA32F,
+                size_t(numPixels));
+  bool close = true;
+  for (size_t i = 0; i < pixels.size(); ++i)
+    close &= std::abs(back[i] - pixels[i]) <= 1e-3f;
+  REQUIRE(close);
+}
+
+TEST_CASE("PixelConvert luminance", "[PixelConvert]")
+{
+  const float rgba[8] = {1.f, 0.f, 0.f, 0.5f, 0.2f, 0.4f, 0.8f, 1.f};
+
+  float l[2];
+  convertPixels(rgba, PixelFormat::RGBA32F, l, PixelFormat::L32F, size_t(2));
+  REQUIRE(l[0] == Approx(0.2126f));
+  REQUIRE(l[1] == Approx(0.2126f * 0.2f + 0.7152f * 0.4f + 0.0722f * 0.8f));
+
+  uint8_t l8[2];
+  convertPixels(rgba, PixelFormat::RGBA32F, l8, PixelFormat::L8, size_t(2));
+  REQUIRE(l8[0] == uint8_t(0.2126f * 255.f + 0.5f));
+
+  // luminance expands to gray with opaque alpha
+  uint8_t gray[4];
+  convertPixels(l8, PixelFormat::L8, gray, PixelFormat::RGBA8, size_t(1));
+  REQUIRE(gray[0] == l8[0]);
+  REQUIRE(gray[1] == l8[0]);
+  REQUIRE(gray[2] == l8[0]);
+  REQUIRE(gray[3] == 255);
+}
+
+TEST_CASE("PixelConvert tonemapping", "[PixelConvert]")
+{
+  const float rgba[8] = {0.f, 1.f, 3.f, 4.f, 100.f, 0.5f, -1.f, 0.25f};
+
+  PixelConversion conversion;
+  float out[8];
+
+  conversion.exposure = 2.f;
+  convertPixels(rgba,
+                PixelFormat::RGBA32F,
+                out,
+                PixelFormat::RGBA32F,
+                size_t(2),
+                conversion);
+  REQUIRE(out[1] == 2.f);
+  REQUIRE(out[2] == 6.f);
+  // alpha is not exposed
+  REQUIRE(out[3] == 4.f);
+
+  conversion.exposure = 1.f;
+  conversion.tonemap  = Tonemap::REINHARD;
+  convertPixels(rgba,
+                PixelFormat::RGBA32F,
+                out,
+                PixelFormat::RGBA32F,
+                size_t(2),
+                conversion);
+  REQUIRE(out[0] == 0.f);
+  REQUIRE(out[1] == Approx(0.5f));
+  REQUIRE(out[2] == Approx(0.75f));
+  REQUIRE(out[4] == Approx(100.f / 101.f));
+  REQUIRE(out[6] == 0.f);
+
+  conversion.tonemap = Tonemap::ACES;
+  convertPixels(rgba,
+                PixelFormat::RGBA32F,
+                out,
+                PixelFormat::RGBA32F,
+                size_t(2),
+                conversion);
+  REQUIRE(out[0] == 0.f);
+  REQUIRE(out[1] == Approx(2.54f / 3.16f));
+  REQUIRE(out[4] == 1.f);
+  REQUIRE(out[5] > 0.f);
+  REQUIRE(out[5] < out[1]);
+}
+
+TEST_CASE("PixelConvert images", "[PixelConvert]")
+{
+  const int sizeX = 67;
+  const int sizeY = 31;
+
+  std::vector<uint32_t> rgba(sizeX * sizeY);
+  for (int i = 0; i < sizeX * sizeY; ++i)
+    rgba[i] = uint32_t(i) * 2654435761u;
+
+  std::vector<uint8_t> rgb(3 * rgba.size());
+  PixelConversion conversion;
+  conversion.flipY = true;
+  convertPixels(rgba.data(),
+                PixelFormat::RGBA8,
+                rgb.data(),
+                PixelFormat::RGB8,
+                sizeX,
+                sizeY,
+                conversion);
+
+  bool flipped = true;
+  for (int y = 0; y < sizeY; ++y) {
+    for (int x = 0; x < sizeX; ++x) {
+      const uint32_t p = rgba[(sizeY - 1 - y) * sizeX + x];
+      const uint8_t *c = &rgb[3 * (y * sizeX + x)];
+      flipped &= c[0] == (p & 0xff) && c[1] == ((p >> 8) & 0xff)
+          && c[2] == ((p >> 16) & 0xff);
+    }
+  }
+  REQUIRE(flipped);
+
+  // the same format flipped is a copy of the rows
+  std::vector<uint32_t> copy(rgba.size());
+  convertPixels(rgba.data(),
+                PixelFormat::RGBA8,
+                copy.data(),
+                PixelFormat::RGBA8,
+                sizeX,
+                sizeY,
+                conversion);
+  REQUIRE(copy[0] == rgba[(sizeY - 1) * sizeX]);
+  REQUIRE(copy[rgba.size() - 1] == rgba[sizeX - 1]);
+}
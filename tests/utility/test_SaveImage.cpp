@@ -1,5 +1,416 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
+#include "rkcommon/math/half.h"
 #include "rkcommon/utility/SaveImage.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace rkcommon::utility;
+using namespace rkcommon::math;
+
+// a gradient with some noise, flat areas and repetitions
+static std::vector<vec4f> testImage(int sizeX, int sizeY)
+{
+  std::vector<vec4f> pixels(size_t(sizeX) * sizeY);
+  uint32_t state = 1;
+  for (int y = 0; y < sizeY; ++y) {
+    for (int x = 0; x < sizeX; ++x) {
+      state         = state * 1664525u + 1013904223u;
+      const float n = (state >> 24) / 2550.f;
+      vec4f &p      = pixels[size_t(y) * sizeX + x];
+      p             = vec4f(float(x) / sizeX, float(y) / sizeY, n, 1.f);
+      if (x < sizeX / 4)
+        p = vec4f(0.5f, 0.25f, 0.f, 1.f);
+      if (y % 7 == 3)
+        p.w = 0.5f;
+    }
+  }
+  return pixels;
+}
+
+static uint32_t readBE32(const uint8_t *b)
+{
+  return uint32_t(b[0]) << 24 | uint32_t(b[1]) << 16 | uint32_t(b[2]) << 8
+         | b[3];
+}
+
+// Decoders of what the encoders write ////////////////////////////////////////
+
+// inflates the fixed Huffman and stored blocks of a zlib stream
+static std::vector<uint8_t> inflate(const std::vector<uint8_t> &in)
+{
+  size_t bitPos   = 16;  // after the zlib header
+  const auto bits = [&](int n) {
+    uint32_t v = 0;
+    for (int i = 0; i < n; ++i, ++bitPos)
+      v |= uint32_t((in[bitPos / 8] >> (bitPos % 8)) & 1) << i;
+    return v;
+  };
+  // Huffman codes are stored most significant bit first
+  const auto code = [&](int n) {
+    uint32_t v = 0;
+    for (int i = 0; i < n; ++i)
+      v = v << 1 | bits(1);
+    return v;
+  };
+  const auto literal = [&]() {
+    uint32_t v = code(7);
+    if (v < 24)
+      return int(v + 256);
+    v = v << 1 | bits(1);
+    if (v >= 0x30 && v < 0xc0)
+      return int(v - 0x30);
+    if (v >= 0xc0 && v < 0xc8)
+      return int(v - 0xc0 + 280);
+    v = v << 1 | bits(1);
+    return int(v - 0x190 + 144);
+  };
+
+  static const int lengthBase[] = {3,  4,  5,  6,   7,   8,   9,   10,  11, 13,
+                                   15, 17, 19, 23,  27,  31,  35,  43,  51, 59,
+                                   67, 83, 99, 115, 131, 163, 195, 227, 258};
+  static const int lengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                    1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                    4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+  std::vector<uint8_t> out;
+  bool last = false;
+  while (!last) {
+    last           = bits(1);
+    const int type = bits(2);
+    if (type == 0) {
+      bitPos         = (bitPos + 7) / 8 * 8;
+      const size_t n = in[bitPos / 8] | in[bitPos / 8 + 1] << 8;
+      bitPos += 32;
+      out.insert(out.end(),
+                 in.begin() + bitPos / 8,
+                 in.begin() + bitPos / 8 + n);
+      bitPos += 8 * n;
+      continue;
+    }
+    REQUIRE(type == 1);
+
+    for (;;) {
+      const int v = literal();
+      if (v < 256) {
+        out.push_back(uint8_t(v));
+        continue;
+      }
+      if (v == 256)
+        break;
+      const int length   = lengthBase[v - 257] + bits(lengthExtra[v - 257]);
+      const int d        = code(5);
+      const int extra    = d < 4 ? 0 : d / 2 - 1;
+      const int base     = d < 4 ? d + 1 : ((2 + d % 2) << extra) + 1;
+      const int distance = base + bits(extra);
+      REQUIRE(size_t(distance) <= out.size());
+      for (int i = 0; i < length; ++i)
+        out.push_back(out[out.size() - distance]);
+    }
+  }
+  return out;
+}
+
+// the RGBA8 pixels of a PNG as encodePNG() writes it, top to bottom
+static std::vector<uint8_t> decodePNG(const std::vector<uint8_t> &png,
+                                      int &sizeX,
+                                      int &sizeY)
+{
+  const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+  REQUIRE(std::memcmp(png.data(), signature, 8) == 0);
+
+  std::vector<uint8_t> zlib;
+  size_t pos = 8;
+  while (pos < png.size()) {
+    const uint32_t length = readBE32(&png[pos]);
+    const std::string type(png.begin() + pos + 4, png.begin() + pos + 8);
+    const uint8_t *data = &png[pos + 8];
+
+    // the CRC covers the type and the data
+    uint32_t crc = ~0u;
+    for (size_t i = 0; i < length + 4; ++i) {
+      crc ^= png[pos + 4 + i];
+      for (int k = 0; k < 8; ++k)
+        crc = crc & 1 ? 0xedb88320u ^ (crc >> 1) : crc >> 1;
+    }
+    REQUIRE(~crc == readBE32(data + length));
+
+    if (type == "IHDR") {
+      sizeX = readBE32(data);
+      sizeY = readBE32(data + 4);
+      REQUIRE(data[8] == 8);
+      REQUIRE(data[9] == 6);
+    } else if (type == "IDAT") {
+      zlib.insert(zlib.end(), data, data + length);
+    }
+    pos += 12 + length;
+  }
+
+  const std::vector<uint8_t> filtered = inflate(zlib);
+  const size_t rowSize                = 4 * size_t(sizeX);
+  REQUIRE(filtered.size() == (rowSize + 1) * sizeY);
+
+  uint32_t a = 1, b = 0;
+  for (uint8_t v : filtered) {
+    a = (a + v) % 65521;
+    b = (b + a) % 65521;
+  }
+  REQUIRE((b << 16 | a) == readBE32(&zlib[zlib.size() - 4]));
+
+  std::vector<uint8_t> pixels(rowSize * sizeY);
+  for (int y = 0; y < sizeY; ++y) {
+    const uint8_t *row = &filtered[y * (rowSize + 1)];
+    REQUIRE(row[0] == 2);
+    for (size_t x = 0; x < rowSize; ++x) {
+      const uint8_t above = y > 0 ? pixels[(y - 1) * rowSize + x] : 0;
+      pixels[y * rowSize + x] = uint8_t(row[1 + x] + above);
+    }
+  }
+  return pixels;
+}
+
+static std::vector<uint8_t> decodeQOI(const std::vector<uint8_t> &qoi,
+                                      int &sizeX,
+                                      int &sizeY)
+{
+  REQUIRE(std::memcmp(qoi.data(), "qoif", 4) == 0);
+  sizeX = readBE32(&qoi[4]);
+  sizeY = readBE32(&qoi[8]);
+  REQUIRE(qoi[12] == 4);
+
+  std::vector<uint8_t> pixels;
+  uint8_t index[64][4]   = {};
+  uint8_t px[4]          = {0, 0, 0, 255};
+  size_t pos             = 14;
+  const size_t numPixels = size_t(sizeX) * sizeY;
+  while (pixels.size() < 4 * numPixels) {
+    const uint8_t op = qoi[pos++];
+    int run          = 1;
+    if (op == 0xfe) {
+      std::memcpy(px, &qoi[pos], 3);
+      pos += 3;
+    } else if (op == 0xff) {
+      std::memcpy(px, &qoi[pos], 4);
+      pos += 4;
+    } else if ((op & 0xc0) == 0x00) {
+      std::memcpy(px, index[op], 4);
+    } else if ((op & 0xc0) == 0x40) {
+      px[0] += ((op >> 4) & 3) - 2;
+      px[1] += ((op >> 2) & 3) - 2;
+      px[2] += (op & 3) - 2;
+    } else if ((op & 0xc0) == 0x80) {
+      const int vg    = (op & 0x3f) - 32;
+      const uint8_t n = qoi[pos++];
+      px[0] += vg - 8 + (n >> 4);
+      px[1] += vg;
+      px[2] += vg - 8 + (n & 0xf);
+    } else {
+      run = (op & 0x3f) + 1;
+    }
+    std::memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64],
+                px,
+                4);
+    for (int i = 0; i < run; ++i)
+      pixels.insert(pixels.end(), px, px + 4);
+  }
+
+  const uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+  REQUIRE(pos + 8 == qoi.size());
+  REQUIRE(std::memcmp(&qoi[pos], padding, 8) == 0);
+  return pixels;
+}
+
+// the RGBA8 pixels of an image top to bottom, as the 8 bit encoders see them
+static std::vector<uint8_t> flippedRGBA8(const std::vector<vec4f> &pixels,
+                                         int sizeX,
+                                         int sizeY)
+{
+  std::vector<uint32_t> rgba(pixels.size());
+  convertToRGBA8(pixels.data(), rgba.data(), pixels.size());
+  std::vector<uint8_t> flipped;
+  for (int y = sizeY - 1; y >= 0; --y) {
+    const uint8_t *row = (const uint8_t *)&rgba[size_t(y) * sizeX];
+    flipped.insert(flipped.end(), row, row + 4 * sizeX);
+  }
+  return flipped;
+}
+
+// Tests //////////////////////////////////////////////////////////////////////
+
+TEST_CASE("SaveImage formats", "[SaveImage]")
+{
+  REQUIRE(imageFormat("frame.png") == ImageFormat::PNG);
+  REQUIRE(imageFormat("dir.v2/frame.EXR") == ImageFormat::EXR);
+  REQUIRE(imageFormat("frame.qoi") == ImageFormat::QOI);
+  REQUIRE(imageFormat("frame.ppm") == ImageFormat::PPM);
+  REQUIRE(imageFormat("frame.pfm") == ImageFormat::PFM);
+  REQUIRE_THROWS(imageFormat("frame.tiff"));
+  REQUIRE_THROWS(imageFormat("frame"));
+}
+
+TEST_CASE("SaveImage RGBA8 conversion", "[SaveImage]")
+{
+  // more than a packet, with a tail
+  std::vector<vec4f> pixels;
+  for (int i = 0; i < 37; ++i) {
+    const float v = i / 36.f;
+    pixels.push_back(vec4f(v, 1.f - v, 2.f * v - 0.5f, v));
+  }
+
+  std::vector<uint32_t> linear(pixels.size()), srgb(pixels.size());
+  convertToRGBA8(pixels.data(), linear.data(), pixels.size(), false);
+  convertToRGBA8(pixels.data(), srgb.data(), pixels.size(), true);
+
+  const auto unorm = [](float v) {
+    return int(std::min(std::max(v, 0.f), 1.f) * 255.f + 0.5f);
+  };
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    const uint8_t *l = (const uint8_t *)&linear[i];
+    const uint8_t *s = (const uint8_t *)&srgb[i];
+    for (int c = 0; c < 4; ++c) {
+      const float v = pixels[i][c];
+      REQUIRE(l[c] == unorm(v));
+      // alpha stays linear
+      const int expected = unorm(c == 3 ? v : linear_to_srgb(v));
+      REQUIRE(std::abs(s[c] - expected) <= 1);
+    }
+  }
+}
+
+TEST_CASE("SaveImage PNG", "[SaveImage]")
+{
+  // tall enough for several strips
+  const int sizeX = 300, sizeY = 500;
+  const std::vector<vec4f> pixels = testImage(sizeX, sizeY);
+  const std::vector<uint8_t> png =
+      encodeImage(ImageFormat::PNG, sizeX, sizeY, pixels.data());
+
+  int x = 0, y = 0;
+  const std::vector<uint8_t> decoded = decodePNG(png, x, y);
+  REQUIRE(x == sizeX);
+  REQUIRE(y == sizeY);
+  REQUIRE(decoded == flippedRGBA8(pixels, sizeX, sizeY));
+  REQUIRE(png.size() < decoded.size() / 2);
+
+  // RGBA8 input is written as it is
+  std::vector<uint32_t> rgba(pixels.size());
+  convertToRGBA8(pixels.data(), rgba.data(), rgba.size());
+  REQUIRE(encodeImage(ImageFormat::PNG, sizeX, sizeY, rgba.data()) == png);
+}
+
+TEST_CASE("SaveImage QOI", "[SaveImage]")
+{
+  const int sizeX = 123, sizeY = 45;
+  const std::vector<vec4f> pixels = testImage(sizeX, sizeY);
+  const std::vector<uint8_t> qoi =
+      encodeImage(ImageFormat::QOI, sizeX, sizeY, pixels.data());
+
+  int x = 0, y = 0;
+  REQUIRE(decodeQOI(qoi, x, y) == flippedRGBA8(pixels, sizeX, sizeY));
+  REQUIRE(x == sizeX);
+  REQUIRE(y == sizeY);
+  REQUIRE(qoi[13] == 0);
+
+  REQUIRE(encodeImage(ImageFormat::QOI, sizeX, sizeY, pixels.data(), false)[13]
+          == 1);
+}
+
+TEST_CASE("SaveImage EXR", "[SaveImage]")
+{
+  const int sizeX = 20, sizeY = 10;
+  const std::vector<vec4f> pixels = testImage(sizeX, sizeY);
+  const std::vector<uint8_t> exr =
+      encodeImage(ImageFormat::EXR, sizeX, sizeY, pixels.data());
+
+  const uint8_t magic[4] = {0x76, 0x2f, 0x31, 0x01};
+  REQUIRE(std::memcmp(exr.data(), magic, 4) == 0);
+
+  // the header ends where the offsets of the scanlines begin
+  const size_t blockSize = 8 + 4 * 2 * sizeX;
+  const size_t dataSize  = size_t(sizeY) * (8 + blockSize);
+  const size_t offsets   = exr.size() - dataSize;
+  REQUIRE(exr[offsets - 1] == 0);
+
+  for (int y = 0; y < sizeY; ++y) {
+    uint64_t offset;
+    std::memcpy(&offset, &exr[offsets + 8 * y], 8);
+    REQUIRE(offset == offsets + 8 * sizeY + y * blockSize);
+
+    int32_t line[2];
+    std::memcpy(line, &exr[offset], 8);
+    REQUIRE(line[0] == y);
+    REQUIRE(line[1] == int32_t(blockSize - 8));
+
+    // channels A, B, G, R, of the rows top to bottom
+    for (int x = 0; x < sizeX; ++x) {
+      const vec4f &p = pixels[size_t(sizeY - 1 - y) * sizeX + x];
+      for (int c = 0; c < 4; ++c) {
+        uint16_t bits;
+        std::memcpy(&bits, &exr[offset + 8 + 2 * (c * sizeX + x)], 2);
+        REQUIRE(float(half::fromBits(bits)) == float(half(p[3 - c])));
+      }
+    }
+  }
+}
+
+TEST_CASE("SaveImage PPM and PFM", "[SaveImage]")
+{
+  const int sizeX = 7, sizeY = 3;
+  const std::vector<vec4f> pixels = testImage(sizeX, sizeY);
+
+  const std::vector<uint8_t> ppm =
+      encodeImage(ImageFormat::PPM, sizeX, sizeY, pixels.data());
+  const std::string ppmHeader = "P6\n7 3\n255\n";
+  REQUIRE(std::string(ppm.begin(), ppm.begin() + ppmHeader.size())
+          == ppmHeader);
+  REQUIRE(ppm.size() == ppmHeader.size() + 3 * sizeX * sizeY);
+
+  const std::vector<uint8_t> rgba = flippedRGBA8(pixels, sizeX, sizeY);
+  for (int i = 0; i < sizeX * sizeY; ++i) {
+    for (int c = 0; c < 3; ++c)
+      REQUIRE(ppm[ppmHeader.size() + 3 * i + c] == rgba[4 * i + c]);
+  }
+
+  const std::vector<uint8_t> pfm =
+      encodeImage(ImageFormat::PFM, sizeX, sizeY, pixels.data());
+  const std::string pfmHeader = "PF\n7 3\n-1.0\n";
+  REQUIRE(std::string(pfm.begin(), pfm.begin() + pfmHeader.size())
+          == pfmHeader);
+  REQUIRE(pfm.size() == pfmHeader.size() + 12 * sizeX * sizeY);
+
+  // bottom to top, as the pixels are
+  for (int i = 0; i < sizeX * sizeY; ++i) {
+    vec3f rgb;
+    std::memcpy(&rgb, &pfm[pfmHeader.size() + 12 * i], 12);
+    REQUIRE(rgb == vec3f(pixels[i].x, pixels[i].y, pixels[i].z));
+  }
+}
+
+TEST_CASE("SaveImage in the background", "[async]")
+{
+  const int sizeX = 64, sizeY = 32;
+  const std::vector<vec4f> pixels = testImage(sizeX, sizeY);
+
+  const char *fileName = "test_SaveImage.png";
+  saveImage(fileName, sizeX, sizeY, pixels.data()).get();
+
+  std::ifstream file(fileName, std::ios::binary);
+  const std::vector<uint8_t> written((std::istreambuf_iterator<char>(file)),
+                                     std::istreambuf_iterator<char>());
+  file.close();
+  std::remove(fileName);
+  REQUIRE(written
+          == encodeImage(ImageFormat::PNG, sizeX, sizeY, pixels.data()));
+
+  REQUIRE_THROWS(
+      saveImage("no/such/directory/frame.qoi", sizeX, sizeY, pixels.data())
+          .get());
+  REQUIRE_THROWS(saveImage("frame.tiff", sizeX, sizeY, pixels.data()));
+}
@@ -3,6 +3,7 @@
 
 #include "../catch.hpp"
 
+#include "rkcommon/containers/SmallVector.h"
 #include "rkcommon/utility/StringManip.h"
 
 TEST_CASE("longestBeginningMatch() correctness", "[StringManip]")
@@ -32,6 +33,23 @@ TEST_CASE("split() correctness", "[StringManip]")
   REQUIRE(output[2] == "str2");
 }
 
+TEST_CASE("split() into a SmallVector", "[StringManip]")
+{
+  using rkcommon::containers::SmallVector;
+
+  SmallVector<std::string, 4> output;
+  rkcommon::utility::split("a,,b,", ',', output);
+  REQUIRE(output.isSmall());
+  REQUIRE(output.size() == 3);
+  REQUIRE(output[0] == "a");
+  REQUIRE(output[1] == "");
+  REQUIRE(output[2] == "b");
+
+  output.clear();
+  rkcommon::utility::split("  x y\tz ", " \t", output);
+  REQUIRE(output == SmallVector<std::string, 4>({"x", "y", "z"}));
+}
+
 TEST_CASE("lowerCase() correctness", "[StringManip]")
 {
   std::string input = "ABCd";
@@ -47,3 +65,70 @@ TEST_CASE("upperCase() correctness", "[StringManip]")
   auto output = rkcommon::utility::upperCase(input);
   REQUIRE(output == "ABCD");
 }
+
+TEST_CASE("split_view() into a SmallVector", "[StringManip]")
+{
+  using rkcommon::containers::SmallVector;
+  using rkcommon::utility::StringView;
+
+  const std::string input = "a,,b,";
+  SmallVector<StringView, 4> output;
+  rkcommon::utility::split_view(input, ',', output);
+  REQUIRE(output.isSmall());
+  REQUIRE(output.size() == 3);
+  REQUIRE(output[0] == "a");
+  REQUIRE(output[1] == "");
+  REQUIRE(output[2] == "b");
+  // views of the input, not copies
+  REQUIRE(output[2].data() == &input[3]);
+
+  output.clear();
+  rkcommon::utility::split_view("  x y\tz ", " \t", output);
+  REQUIRE(output.size() == 3);
+  REQUIRE(output[0] == "x");
+  REQUIRE(output[1] == "y");
+  REQUIRE(output[2] == "z");
+
+  output.clear();
+  rkcommon::utility::split_view("", ',', output);
+  rkcommon::utility::split_view(" \t ", " \t", output);
+  REQUIRE(output.empty());
+}
+
+TEST_CASE("tokens() iterates lazily", "[StringManip]")
+{
+  using rkcommon::utility::StringView;
+
+  // long enough for the library's vectorized search
+  std::string input;
+  for (int i = 0; i < 100; ++i)
+    input += std::to_string(i) + (i % 7 ? ";" : ";;");
+
+  std::vector<std::string> pieces;
+  for (StringView token : rkcommon::utility::tokens(input, ';'))
+    pieces.push_back(token.str());
+  REQUIRE(pieces == rkcommon::utility::split(input, ';'));
+  REQUIRE(pieces.size() == 115);
+  REQUIRE(pieces[1] == "");
+  REQUIRE(pieces.back() == "99");
+
+  auto words = rkcommon::utility::tokens("--size 1 2\t3", " \t");
+  auto it    = words.begin();
+  REQUIRE(*it == "--size");
+  REQUIRE((++it)->size() == 1);
+  REQUIRE(std::distance(words.begin(), words.end()) == 4);
+}
+
+TEST_CASE("in-place case conversion", "[StringManip]")
+{
+  std::string input = "Mixed_Case 09@[`{";
+
+  rkcommon::utility::lowerCaseInPlace(input);
+  REQUIRE(input == "mixed_case 09@[`{");
+  rkcommon::utility::upperCaseInPlace(input);
+  REQUIRE(input == "MIXED_CASE 09@[`{");
+
+  REQUIRE(rkcommon::utility::equalsIgnoreCase("Linear", "LINEAR"));
+  REQUIRE(!rkcommon::utility::equalsIgnoreCase("linear", "linears"));
+  REQUIRE(!rkcommon::utility::equalsIgnoreCase("@", "`"));
+}
@@ -1,5 +1,58 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/utility/TimeStamp.h"
+// std
+#include <thread>
+#include <vector>
+
+using rkcommon::utility::TimeStamp;
+
+TEST_CASE("TimeStamp ordering on one thread", "[TimeStamp]")
+{
+  TimeStamp a;
+  TimeStamp b;
+  REQUIRE(size_t(b) > size_t(a));
+
+  // across many blocks of values
+  size_t last      = b;
+  bool increasing = true;
+  for (int i = 0; i < 1000; ++i) {
+    a.renew();
+    increasing &= size_t(a) > last;
+    last = a;
+  }
+  REQUIRE(increasing);
+
+  TimeStamp copy = a;
+  REQUIRE(size_t(copy) == size_t(a));
+  copy.renew();
+  REQUIRE(size_t(copy) > size_t(a));
+}
+
+TEST_CASE("TimeStamp ordering across threads", "[TimeStamp]")
+{
+  // stamps taken after joining another thread are greater than its stamps,
+  // even though this thread reserved its block of values first
+  TimeStamp before;
+  for (int round = 0; round < 10; ++round) {
+    std::vector<size_t> values(100);
+    std::thread t([&]() {
+      TimeStamp s;
+      for (auto &v : values) {
+        s.renew();
+        v = s;
+      }
+    });
+    t.join();
+
+    TimeStamp after;
+    bool ordered = true;
+    for (size_t v : values)
+      ordered &= size_t(after) > v && v > size_t(before);
+    REQUIRE(ordered);
+    before = after;
+  }
+}
@@ -1,5 +1,93 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/utility/TransactionalValue.h"
+#include "rkcommon/utility/TripleBufferedValue.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace rkcommon::utility;
+
+// a value which is torn if the consumer sees a partially written one
+struct Pair
+{
+  int first{0};
+  int second{0};
+};
+
+TEMPLATE_TEST_CASE("TransactionalValue single threaded",
+                   "[TransactionalValue]",
+                   TransactionalValue<int>,
+                   TripleBufferedValue<int>)
+{
+  TestType value(1);
+  REQUIRE(value.get() == 1);
+  REQUIRE(!value.update());
+
+  value = 2;
+  REQUIRE(value.get() == 1);
+  REQUIRE(value.update());
+  REQUIRE(value.get() == 2);
+  REQUIRE(!value.update());
+
+  // only the last value is handed over
+  value = 3;
+  value = 4;
+  value = 5;
+  REQUIRE(value.update());
+  REQUIRE(value.ref() == 5);
+  REQUIRE(!value.update());
+  REQUIRE(value.get() == 5);
+
+  value.ref() = 6;
+  REQUIRE(value.get() == 6);
+
+  TestType other(7);
+  value = other;
+  REQUIRE(value.update());
+  REQUIRE(value.get() == 7);
+}
+
+TEMPLATE_TEST_CASE("TransactionalValue producer and consumer",
+                   "[TransactionalValue]",
+                   TransactionalValue<Pair>,
+                   TripleBufferedValue<Pair>)
+{
+  const int numValues = 100000;
+  TestType value;
+  std::atomic<bool> done{false};
+
+  std::thread producer([&]() {
+    for (int i = 1; i <= numValues; ++i) {
+      Pair p;
+      p.first  = i;
+      p.second = -i;
+      value    = p;
+    }
+    done = true;
+  });
+
+  int last     = 0;
+  bool intact  = true;
+  bool ordered = true;
+  while (last != numValues) {
+    const bool finished = done;
+    if (value.update()) {
+      const Pair p = value.get();
+      intact &= p.second == -p.first;
+      ordered &= p.first > last;
+      last = p.first;
+    } else if (finished) {
+      break;
+    }
+  }
+  producer.join();
+
+  REQUIRE(intact);
+  REQUIRE(ordered);
+  // the consumer always ends up with the latest value
+  REQUIRE(last == numValues);
+}
@@ -0,0 +1,143 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/utility/ArrayView.h"
+#include "rkcommon/utility/TypedArrayView.h"
+// std
+#include <vector>
+
+using namespace rkcommon;
+using namespace rkcommon::math;
+using namespace rkcommon::utility;
+
+template <typename T>
+static std::vector<T> testValues(size_t n)
+{
+  std::vector<T> values(n);
+  for (size_t i = 0; i < n; ++i)
+    values[i] = T(float(i % 100));
+  return values;
+}
+
+TEMPLATE_TEST_CASE("TypedArrayView conversion of each type",
+                   "[TypedArrayView]",
+                   uint8_t,
+                   int8_t,
+                   uint16_t,
+                   int16_t,
+                   uint32_t,
+                   int32_t,
+                   half,
+                   bfloat16,
+                   float,
+                   double)
+{
+  // a partial chunk and vector at the end
+  const size_t n                 = 1000;
+  const std::vector<TestType> in = testValues<TestType>(n);
+  const TypedArrayView view(in.data(), n);
+
+  REQUIRE(view.is<TestType>());
+  REQUIRE(view.isDense());
+  REQUIRE(view.size() == n);
+  REQUIRE(dataTypeSize(view.type()) == sizeof(TestType));
+
+  std::vector<float> f(n);
+  view.convertTo(f.data());
+  std::vector<double> d(n);
+  view.convertTo(d.data());
+
+  bool converted = true;
+  for (size_t i = 0; i < n; ++i) {
+    converted &= f[i] == float(i % 100);
+    converted &= d[i] == double(i % 100);
+    converted &= view.get<float>(i) == float(i % 100);
+  }
+  REQUIRE(converted);
+
+  // a range of every other element
+  const TypedArrayView strided(in.data(), n / 2, 2 * sizeof(TestType));
+  REQUIRE(!strided.isDense());
+  std::vector<float> part(10);
+  strided.convertTo(range_t<size_t>(5, 15), part.data());
+  for (size_t i = 0; i < part.size(); ++i)
+    REQUIRE(part[i] == float(2 * (5 + i) % 100));
+}
+
+TEST_CASE("TypedArrayView type access", "[TypedArrayView]")
+{
+  std::vector<uint16_t> values = testValues<uint16_t>(100);
+  ArrayView<uint16_t> array(values);
+
+  const TypedArrayView view(array);
+  REQUIRE(view.type() == DataType::UINT16);
+  REQUIRE(view.as<uint16_t>()[42] == 42);
+  REQUIRE_THROWS(view.as<float>());
+
+  const TypedArrayView raw(values.data(), DataType::UINT16, values.size());
+  REQUIRE(raw.byteStride() == sizeof(uint16_t));
+
+  const TypedArrayView part = view.slice(range_t<size_t>(10, 20));
+  REQUIRE(part.size() == 10);
+  REQUIRE(part.get<double>(0) == 10.0);
+  REQUIRE(part.get<int>(9) == 19);
+}
+
+TEST_CASE("TypedArrayView chunks", "[TypedArrayView]")
+{
+  const size_t n                  = 2500;
+  const std::vector<half> halves  = testValues<half>(n);
+  const std::vector<float> floats = testValues<float>(n);
+
+  SECTION("converted")
+  {
+    const TypedArrayView view(halves.data(), n);
+    size_t next  = 0;
+    bool inOrder = true;
+    for (const ConvertedChunk<float> &c : view.chunks<float>(1000)) {
+      inOrder &= c.first == next;
+      for (size_t i = 0; i < c.size; ++i)
+        inOrder &= c[i] == float((c.first + i) % 100);
+      next += c.size;
+    }
+    REQUIRE(inOrder);
+    REQUIRE(next == n);
+  }
+
+  SECTION("tightly packed T is not copied")
+  {
+    const TypedArrayView view(floats.data(), n);
+    size_t numChunks = 0;
+    for (const ConvertedChunk<float> &c : view.chunks<float>(1000)) {
+      REQUIRE(c.data == floats.data() + c.first);
+      numChunks++;
+    }
+    REQUIRE(numChunks == 3);
+  }
+
+  SECTION("empty views")
+  {
+    const TypedArrayView view;
+    REQUIRE(view.empty());
+    auto chunks = view.chunks<float>();
+    REQUIRE(chunks.begin() == chunks.end());
+  }
+}
+
+TEST_CASE("TypedArrayView parallel conversion", "[TypedArrayView]")
+{
+  // above the threshold for parallel conversion
+  const size_t n                    = 600 * 1000;
+  const std::vector<uint8_t> values = testValues<uint8_t>(n);
+  const TypedArrayView view(values.data(), n);
+
+  std::vector<float> out(n);
+  view.convertTo(out.data());
+
+  bool converted = true;
+  for (size_t i = 0; i < n; ++i)
+    converted &= out[i] == float(i % 100);
+  REQUIRE(converted);
+}
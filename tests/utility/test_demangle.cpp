@@ -1,5 +1,55 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/utility/demangle.h"
+// std
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace rkcommon::utility;
+
+namespace test_demangle {
+  struct Foo
+  {
+  };
+
+  template <typename T>
+  struct Bar
+  {
+  };
+}  // namespace test_demangle
+
+TEST_CASE("typeName() from signatures", "[demangle]")
+{
+  REQUIRE(std::string(typeName<int>()) == "int");
+  REQUIRE(std::string(typeName<test_demangle::Foo>()) == "test_demangle::Foo");
+  REQUIRE(std::string(typeName<test_demangle::Bar<float>>())
+          == "test_demangle::Bar<float>");
+
+  // one string per type
+  REQUIRE(typeName<int>() == typeName<int>());
+  REQUIRE(nameOf<double>() == "double");
+}
+
+TEST_CASE("demangledName() cache", "[demangle]")
+{
+  const char *name = demangledName(typeid(test_demangle::Foo));
+  REQUIRE(std::string(name) == demangle(typeid(test_demangle::Foo).name()));
+  REQUIRE(demangledName(typeid(test_demangle::Foo)) == name);
+
+  // the same strings from all threads
+  std::vector<const char *> names(4);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < names.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      names[i] = demangledName(typeid(test_demangle::Foo));
+    });
+  }
+  for (auto &t : threads)
+    t.join();
+  for (const char *n : names)
+    REQUIRE(n == name);
+}
@@ -1,5 +1,163 @@
 // Copyright 2009 Intel Corporation
 // SPDX-License-Identifier: Apache-2.0
 
-// only test compliation, no functional tests (yet)
+#include "../catch.hpp"
+
 #include "rkcommon/utility/multidim_index_sequence.h"
+// std
+#include <set>
+
+using namespace rkcommon;
+
+TEST_CASE("zorder_index_sequence visits every index once in Morton order",
+          "[multidim_index_sequence]")
+{
+  const vec3ul dims(5, 3, 9);
+  const zorder_sequence_3D zorder(dims);
+  const index_sequence_3D linear(dims);
+
+  std::set<size_t> seen;
+  bool first        = true;
+  uint64_t prevCode = 0;
+  for (const auto &c : zorder) {
+    REQUIRE(c.x < dims.x);
+    REQUIRE(c.y < dims.y);
+    REQUIRE(c.z < dims.z);
+    seen.insert(linear.flatten(c));
+
+    const uint64_t code = mortonEncode64(vec3ui(c.x, c.y, c.z));
+    if (!first)
+      CHECK(code > prevCode);
+    prevCode = code;
+    first    = false;
+  }
+
+  CHECK(seen.size() == zorder.total_indices());
+}
+
+TEST_CASE("zorder_index_sequence of power of two dimensions",
+          "[multidim_index_sequence]")
+{
+  const zorder_sequence_2D zorder(vec2ul(4, 4));
+
+  uint32_t i = 0;
+  for (const auto &c : zorder) {
+    CHECK(mortonEncode(vec2ui(c.x, c.y)) == i);
+    i++;
+  }
+  CHECK(i == 16);
+
+  const zorder_sequence_2D none(vec2ul(0, 4));
+  CHECK(!(none.begin() != none.end()));
+}
+
+TEST_CASE("multidim_index_sequence iterates by incrementing coordinates",
+          "[multidim_index_sequence]")
+{
+  const index_sequence_3D seq(vec3ul(5, 3, 4));
+
+  size_t i = 0;
+  for (const auto &c : seq) {
+    REQUIRE(c == seq.reshape(i));
+    i++;
+  }
+  CHECK(i == seq.total_indices());
+
+  auto it = seq.begin();
+  it.jump_to(17);
+  CHECK(*it == seq.reshape(17));
+  it--;
+  CHECK(*it == seq.reshape(16));
+  it + 10;
+  CHECK(*it == seq.reshape(26));
+
+  const index_sequence_2D none(vec2ul(0, 4));
+  CHECK(!(none.begin() != none.end()));
+}
+
+TEST_CASE("multidim_index_sequence split()", "[multidim_index_sequence]")
+{
+  const index_sequence_3D seq(vec3ul(7, 5, 3));
+
+  for (size_t n : {1, 2, 4, 7, 64, 105, 1000}) {
+    const auto chunks = seq.split(n);
+    CHECK(chunks.size() == std::min<size_t>(n, seq.total_indices()));
+
+    // contiguous, in order and about equal
+    size_t next = 0;
+    for (const auto &chunk : chunks) {
+      REQUIRE(chunk.first_index() == next);
+      REQUIRE(chunk.size() >= seq.total_indices() / chunks.size());
+      REQUIRE(chunk.size() <= seq.total_indices() / chunks.size() + 1);
+      for (const auto &c : chunk)
+        REQUIRE(seq.flatten(c) == next++);
+    }
+    CHECK(next == seq.total_indices());
+  }
+
+  CHECK(index_sequence_2D(vec2ul(4, 0)).split(8).empty());
+}
+
+TEST_CASE("tiled_index_sequence visits every index once, tile by tile",
+          "[multidim_index_sequence]")
+{
+  const vec3ul dims(7, 5, 3);
+  const tiled_sequence_3D tiled(dims, vec3ul(4, 2, 2));
+  const index_sequence_3D linear(dims);
+
+  CHECK(tiled.num_tiles() == vec3ul(2, 3, 2));
+  CHECK(tiled.total_tiles() == 12);
+
+  std::set<size_t> seen;
+  size_t tile = 0, inTile = 0;
+  for (const auto &c : tiled) {
+    // move on to the tile containing 'c' once the current one is done
+    const vec3ul lower = tiled.tile_lower(tile);
+    const vec3ul upper = tiled.tile_upper(tile);
+    if (inTile == (upper - lower).long_product()) {
+      tile++;
+      inTile = 0;
+    }
+    REQUIRE(c.x >= tiled.tile_lower(tile).x);
+    REQUIRE(c.y >= tiled.tile_lower(tile).y);
+    REQUIRE(c.z >= tiled.tile_lower(tile).z);
+    REQUIRE(c.x < tiled.tile_upper(tile).x);
+    REQUIRE(c.y < tiled.tile_upper(tile).y);
+    REQUIRE(c.z < tiled.tile_upper(tile).z);
+    inTile++;
+    seen.insert(linear.flatten(c));
+  }
+  CHECK(tile == tiled.total_tiles() - 1);
+  CHECK(seen.size() == linear.total_indices());
+
+  // whole tiles per chunk
+  size_t count = 0, nextTile = 0;
+  for (const auto &chunk : tiled.split(5)) {
+    REQUIRE(chunk.first_tile() == nextTile);
+    nextTile = chunk.last_tile();
+    for (const auto &c : chunk) {
+      (void)c;
+      count++;
+    }
+  }
+  CHECK(nextTile == tiled.total_tiles());
+  CHECK(count == linear.total_indices());
+
+  const tiled_sequence_2D none(vec2ul(0, 4), vec2ul(8));
+  CHECK(!(none.begin() != none.end()));
+}
+
+TEST_CASE("parallel_for over index sequences", "[multidim_index_sequence]")
+{
+  const vec3ul dims(33, 17, 9);
+  const index_sequence_3D linear(dims);
+
+  std::vector<int> visits(linear.total_indices(), 0);
+  tasking::parallel_for(linear,
+                        [&](const vec3ul &c) { visits[linear.flatten(c)]++; });
+  tasking::parallel_for(tiled_sequence_3D(dims, vec3ul(8)),
+                        [&](const vec3ul &c) { visits[linear.flatten(c)]++; });
+
+  for (int v : visits)
+    REQUIRE(v == 2);
+}
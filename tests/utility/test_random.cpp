@@ -2,10 +2,13 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include <random>
+#include <vector>
 #include "../catch.hpp"
 #include "rkcommon/utility/random.h"
 
+using namespace rkcommon::math;
 using rkcommon::utility::pcg32_biased_float_distribution;
+using rkcommon::utility::philox_stream;
 
 TEST_CASE("random", "[random]")
 {
@@ -28,4 +31,71 @@ TEST_CASE("random", "[random]")
       REQUIRE(val <= upper);
     }
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("philox_stream matches the Philox4x32-10 known answers", "[random]")
+{
+  // Random123 kat_vectors: counter (index, stream) under key (seed)
+  philox_stream zero(0, 0);
+  CHECK(zero.block(0)
+        == vec4ui(0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8));
+
+  philox_stream ones(0xffffffffffffffffull, 0xffffffffffffffffull);
+  CHECK(ones.block(0xffffffffffffffffull)
+        == vec4ui(0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd));
+
+  philox_stream pi(0x299f31d0a4093822ull, 0x0370734413198a2eull);
+  CHECK(pi.block(0x85a308d3243f6a88ull)
+        == vec4ui(0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1));
+}
+
+TEST_CASE("philox_stream uniform floats", "[random]")
+{
+  philox_stream s(1234, 5);
+  float sum = 0.f;
+  for (uint64_t i = 0; i < 4096; ++i) {
+    const float u = s.uniform(i);
+    REQUIRE(u >= 0.f);
+    REQUIRE(u < 1.f);
+    sum += u;
+  }
+  CHECK(sum / 4096 == Approx(0.5f).margin(0.02f));
+
+  // different streams and seeds are different sequences
+  CHECK(s.block(0) != philox_stream(1234, 6).block(0));
+  CHECK(s.block(0) != philox_stream(1235, 5).block(0));
+}
+
+TEST_CASE("fillUniform() matches philox_stream::uniform()", "[random]")
+{
+  const philox_stream s(42, 7);
+
+  // unaligned starts and lengths, and blocks around the 2^32 carry
+  const uint64_t firsts[] = {0, 1, 3, 6, 4 * 0xfffffff0ull + 2};
+  const size_t sizes[]    = {0, 1, 5, 31, 32, 33, 1000, 300 * 1024 + 3};
+
+  for (uint64_t first : firsts) {
+    for (size_t n : sizes) {
+      for (bool parallel : {false, true}) {
+        std::vector<float> out(n, -1.f);
+        rkcommon::utility::fillUniform(s, first, out.data(), n, parallel);
+
+        INFO("first = " << first << " n = " << n);
+        for (size_t i = 0; i < n; ++i)
+          REQUIRE(out[i] == s.uniform(first + i));
+      }
+    }
+  }
+
+  std::vector<vec2f> out2(100);
+  rkcommon::utility::fillUniform(s, 9, out2.data(), out2.size());
+  std::vector<vec3f> out3(100);
+  rkcommon::utility::fillUniform(s, 9, out3.data(), out3.size());
+  for (size_t i = 0; i < 100; ++i) {
+    CHECK(out2[i] == vec2f(s.uniform(9 + 2 * i), s.uniform(10 + 2 * i)));
+    CHECK(out3[i]
+          == vec3f(s.uniform(9 + 3 * i),
+                   s.uniform(10 + 3 * i),
+                   s.uniform(11 + 3 * i)));
+  }
+}
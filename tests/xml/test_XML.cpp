@@ -0,0 +1,324 @@
+// Copyright 2009 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "../catch.hpp"
+
+#include "rkcommon/utility/OwnedArray.h"
+#include "rkcommon/xml/XML.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+using namespace rkcommon;
+using namespace rkcommon::xml;
+
+static const char *fileName = "test_XML.xml";
+
+static void writeFile(const std::string &text)
+{
+  FILE *file = fopen(fileName, "wb");
+  fwrite(text.data(), 1, text.size(), file);
+  fclose(file);
+}
+
+static const char *scene =
+    "<?xml version=\"1.0\"?>\n"
+    "<!-- a comment -->\n"
+    "<scene name=\"test\" version='2'>\n"
+    "  <mesh id=\"0\" material=\"glass\">\n"
+    "    <vertex format=\"vec3f\" ofs=\"0\" size=\"12\"/>\n"
+    "    <!-- another one -->\n"
+    "    <index>0 1 2  </index>\n"
+    "  </mesh>\n"
+    "  <instance mesh=\"0\"/>\n"
+    "  <light>\n"
+    "    the sun\n"
+    "  </light>\n"
+    "</scene>\n";
+
+// the same tree in both representations
+static void compare(const Node &node, const MappedNode &mapped)
+{
+  REQUIRE(mapped.name == node.name);
+  REQUIRE(mapped.content == node.content);
+  REQUIRE(mapped.properties.size() == node.properties.size());
+  for (const auto &p : node.properties)
+    REQUIRE(mapped.getProp(p.first) == p.second);
+  REQUIRE(mapped.child.size() == node.child.size());
+  for (size_t i = 0; i < node.child.size(); ++i)
+    compare(node.child[i], mapped.child[i]);
+}
+
+TEST_CASE("XML documents", "[XML]")
+{
+  writeFile(scene);
+
+  const XMLDoc doc = readXML(fileName);
+  REQUIRE(doc.child.size() == 1);
+
+  const Node &root = doc.child[0];
+  REQUIRE(root.name == "scene");
+  REQUIRE(root.getProp("name") == "test");
+  REQUIRE(root.getProp("version") == "2");
+  REQUIRE(root.child.size() == 3);
+  REQUIRE(root.child[0].child[1].name == "index");
+  REQUIRE(root.child[0].child[1].content == "0 1 2");
+  REQUIRE(root.child[2].content == "the sun");
+
+  SECTION("mapped in place")
+  {
+    auto mapped = mapXML(fileName);
+    REQUIRE(mapped->fileName.str() == fileName);
+    compare(doc, *mapped);
+
+    const MappedNode &mesh = mapped->child[0].child[0];
+    REQUIRE(mesh.hasProp("material"));
+    REQUIRE(!mesh.hasProp("materials"));
+    REQUIRE(mesh.getProp("missing", "fallback") == "fallback");
+    REQUIRE(mesh.child[0].properties[1].name == "ofs");
+    REQUIRE(mesh.child[0].properties[1].value == "0");
+
+    size_t numNodes = 0;
+    for (const MappedNode &n : mapped->child[0].child)
+      numNodes += 1 + n.child.size();
+    REQUIRE(numNodes == 5);
+  }
+
+  std::remove(fileName);
+}
+
+TEST_CASE("XML parse errors", "[XML]")
+{
+  SECTION("mismatched tags")
+  {
+    writeFile("<a><b></a></b>");
+    REQUIRE_THROWS(readXML(fileName));
+    REQUIRE_THROWS(mapXML(fileName));
+  }
+
+  SECTION("unterminated string at the end of the file")
+  {
+    writeFile("<a name=\"open");
+    REQUIRE_THROWS(readXML(fileName));
+    REQUIRE_THROWS(mapXML(fileName));
+  }
+
+  SECTION("missing file")
+  {
+    REQUIRE_THROWS(readXML("no_such_file.xml"));
+    REQUIRE_THROWS(mapXML("no_such_file.xml"));
+  }
+
+  SECTION("empty file")
+  {
+    writeFile("");
+    REQUIRE(readXML(fileName).child.empty());
+    REQUIRE(mapXML(fileName)->child.empty());
+  }
+
+  std::remove(fileName);
+}
+
+// Records the events as a string, skipping the nodes named 'skip'
+struct Recorder : public XMLHandler
+{
+  std::string events;
+  std::string skip;
+  int depth{0};
+  int maxDepth{0};
+
+  bool onStartNode(StringView name) override
+  {
+    events += "<" + name.str();
+    maxDepth = std::max(maxDepth, ++depth);
+    return name != skip;
+  }
+
+  void onProperty(StringView name, StringView value) override
+  {
+    events += " " + name.str() + "=" + value.str();
+  }
+
+  void onContent(StringView content) override
+  {
+    events += "[" + content.str() + "]";
+  }
+
+  void onEndNode(StringView name) override
+  {
+    events += "/" + name.str() + ">";
+    --depth;
+  }
+};
+
+TEST_CASE("XML streaming", "[XML]")
+{
+  writeFile(scene);
+
+  Recorder all;
+  parseXML(fileName, all);
+  REQUIRE(all.events
+          == "<scene name=test version=2"
+             "<mesh id=0 material=glass"
+             "<vertex format=vec3f ofs=0 size=12/vertex>"
+             "<index[0 1 2]/index>"
+             "/mesh>"
+             "<instance mesh=0/instance>"
+             "<light[the sun]/light>"
+             "/scene>");
+  REQUIRE(all.depth == 0);
+  REQUIRE(all.maxDepth == 3);
+
+  SECTION("skipping subtrees")
+  {
+    Recorder some;
+    some.skip = "mesh";
+    parseXML(fileName, some);
+    REQUIRE(some.events
+            == "<scene name=test version=2"
+               "<mesh/mesh>"
+               "<instance mesh=0/instance>"
+               "<light[the sun]/light>"
+               "/scene>");
+  }
+
+  SECTION("skipped subtrees are only scanned for tags")
+  {
+    const std::string text =
+        "<a><b x=\"1 > 0\" y='</b>'><c/><!-- <b> --><b>text</b></b>"
+        "<d/></a>";
+    Recorder some;
+    some.skip = "b";
+    parseXML(text.data(), text.size(), some);
+    REQUIRE(some.events == "<a<b/b><d/d>/a>");
+  }
+
+  std::remove(fileName);
+}
+
+TEST_CASE("XML writer", "[XML]")
+{
+  const bool asyncData = GENERATE(false, true);
+  const char *binFileName = "test_XML.bin";
+
+  // blobs below and above the size which is coalesced
+  std::vector<int> small(10);
+  std::vector<float> large(1 << 19);
+  for (size_t i = 0; i < small.size(); ++i)
+    small[i] = int(i);
+  for (size_t i = 0; i < large.size(); ++i)
+    large[i] = float(i);
+  auto shared = std::make_shared<utility::OwnedArray<float>>(large);
+
+  size_t smallOffset = 0, largeOffset = 0, sharedOffset = 0;
+  {
+    FILE *xml = fopen(fileName, "wb");
+    FILE *bin = fopen(binFileName, "wb");
+    Writer writer(xml, bin, asyncData);
+    writer.writeHeader("1.0");
+    writer.openNode("scene");
+    writer.writeProperty("name", "test");
+
+    writer.openNode("mesh");
+    writer.writeProperty("id", "0");
+    writer.writeData("x", 1);
+    writer.alignData(16);
+    smallOffset = writer.writeData(small.data(), sizeof(int) * small.size());
+    writer.alignData(64);
+    largeOffset = writer.writeData(large.data(), sizeof(float) * large.size());
+    sharedOffset = writer.writeData(
+        std::static_pointer_cast<utility::AbstractArray<float>>(shared));
+    shared.reset();
+    writer.writeContent("index", "0 1 2");
+    writer.closeNode();
+
+    writer.openNode("instance");
+    writer.closeNode();
+    writer.closeNode();
+    writer.writeFooter();
+
+    fclose(xml);
+    fclose(bin);
+  }
+
+  REQUIRE(smallOffset == 16);
+  REQUIRE(largeOffset == 64);
+  REQUIRE(sharedOffset == 64 + sizeof(float) * large.size());
+
+  auto doc = mapXML(fileName);
+  REQUIRE(doc->child.size() == 1);
+  const MappedNode &scene = doc->child[0];
+  REQUIRE(scene.name == "scene");
+  REQUIRE(scene.getProp("name") == "test");
+  REQUIRE(scene.child.size() == 2);
+  REQUIRE(scene.child[0].getProp("id") == "0");
+  REQUIRE(scene.child[0].child[0].name == "index");
+  REQUIRE(scene.child[0].child[0].content == "0 1 2");
+  REQUIRE(scene.child[1].name == "instance");
+
+  auto smallData = mapData<int>(binFileName, smallOffset, small.size());
+  REQUIRE(std::equal(small.begin(), small.end(), smallData->begin()));
+  auto largeData = mapData<float>(binFileName, largeOffset, large.size());
+  REQUIRE(std::equal(large.begin(), large.end(), largeData->begin()));
+  auto sharedData = mapData<float>(binFileName, sharedOffset, large.size());
+  REQUIRE(std::equal(large.begin(), large.end(), sharedData->begin()));
+
+  std::remove(fileName);
+  std::remove(binFileName);
+}
+
+// A root with enough children to be parsed in parts, in parallel
+static std::string largeScene(size_t numMeshes)
+{
+  std::string text = "<?xml version=\"1.0\"?>\n<scene>\n";
+  for (size_t i = 0; i < numMeshes; ++i) {
+    const std::string id = std::to_string(i);
+    text += "  <mesh id=\"" + id + "\" name='mesh > " + id + "'>\n"
+        + "    <!-- <mesh> -->\n"
+        + "    <vertex ofs=\"" + id + "\"/>\n"
+        + "    <index>" + id + " " + id + "</index>\n"
+        + "  </mesh>\n";
+  }
+  return text + "</scene>\n";
+}
+
+TEST_CASE("XML parallel parsing", "[XML]")
+{
+  const size_t numMeshes = 20000;
+  writeFile(largeScene(numMeshes));
+
+  const XMLDoc doc = readXML(fileName);
+  REQUIRE(doc.child.size() == 1);
+  const Node &scene = doc.child[0];
+  REQUIRE(scene.child.size() == numMeshes);
+
+  bool ordered = true;
+  for (size_t i = 0; i < numMeshes; ++i) {
+    const Node &mesh = scene.child[i];
+    ordered &= mesh.getProp("id") == std::to_string(i);
+    ordered &= mesh.child.size() == 2;
+    ordered &= mesh.child[1].content
+        == std::to_string(i) + " " + std::to_string(i);
+  }
+  REQUIRE(ordered);
+
+  auto mapped = mapXML(fileName);
+  compare(doc, *mapped);
+
+  Recorder events;
+  parseXML(fileName, events);
+  REQUIRE(events.maxDepth == 3);
+
+  SECTION("errors in any part")
+  {
+    std::string text = largeScene(numMeshes);
+    const size_t pos = text.find("</index>", text.size() / 2);
+    text.replace(pos, 8, "</indox>");
+    writeFile(text);
+    REQUIRE_THROWS(readXML(fileName));
+    REQUIRE_THROWS(mapXML(fileName));
+  }
+
+  std::remove(fileName);
+}